@@ -20,7 +20,7 @@ CONFIG += link_pkgconfig
 
 packagesExist(IlmBase){
   PKGCONFIG += IlmBase
-  LIBS += -lIlmImf -lHalf
+  LIBS += -lIlmImf -lHalf -lIlmThread
 	DEFINES += USE_EXR
 	message("Use IlmBase library for EXR files")
 }
@@ -29,11 +29,18 @@ packagesExist(libtiff-4){
   PKGCONFIG += libtiff-4
 }
 win32|packagesExist(libtiff-4) {
-  LIBS += -ltiff
+  LIBS += -ltiff -lz
   DEFINES += USE_TIFF
   message("Use tiff library for TIFF files")
 }
 
+packagesExist(libjpeg){
+  PKGCONFIG += libjpeg
+  LIBS += -ljpeg
+  DEFINES += USE_JPEG
+  message("Use jpeg library for JPG files")
+}
+
 packagesExist(sndfile){
   PKGCONFIG += sndfile
 }
@@ -43,6 +50,26 @@ win32|packagesExist(sndfile) {
   message("Use sndfile library for WAV files")
 }
 
+# SIMD implementation of vector and matrix classes (qmake CONFIG+=simd_algebra)
+simd_algebra {
+  DEFINES += USE_SIMD_ALGEBRA
+  message("Use SIMD implementation of vector algebra")
+}
+
+# recording of rendering pipeline events for chrome://tracing (qmake CONFIG+=trace)
+trace {
+  DEFINES += USE_TRACE
+  message("Use tracing of rendering pipeline")
+}
+
+# rendering of simple scenes by OpenCL devices (qmake CONFIG+=opencl)
+opencl {
+  DEFINES += USE_OPENCL
+  macx:LIBS += -framework OpenCL
+  !macx:LIBS += -lOpenCL
+  message("Use OpenCL rendering backend")
+}
+
 TARGET = mandelbulber2 
 TEMPLATE = app
 
@@ -82,7 +109,7 @@ QMAKE_CXXFLAGS += -ffast-math -fopenmp -std=c++11
 # test hardcoded lib path for gsl in travis container 
 QMAKE_CXXFLAGS += -I/usr/include/gsl
 
-LIBS += -lpng -lgsl -lgslcblas -fopenmp
+LIBS += -lpng -lz -lgsl -lgslcblas -fopenmp
 win32:LIBS += -lz
 
 # rh: ugly absolute paths for libpng and libjpeg on my windows system
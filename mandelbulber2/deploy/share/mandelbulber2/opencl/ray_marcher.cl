@@ -0,0 +1,765 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * RayMarcher kernel - rendering of simple scenes by OpenCL devices
+ *
+ * Kernel is used by cOpenClEngine and calculates the same primary rays as
+ * cRenderWorker::RenderPixel() in single precision: ray-marching with the analytic DE
+ * of Mandelbulb or Mandelbox formula, normal vectors, shading and shadows of main light,
+ * ambient occlusion and background gradient. Scenes with other features are rendered
+ * by CPU
+ */
+
+
+#define PERSP_THREE_POINT 0
+#define PERSP_FISH_EYE 1
+#define PERSP_EQUIRECTANGULAR 2
+#define PERSP_FISH_EYE_CUT 3
+
+#define FORMULA_MANDELBULB 0
+#define FORMULA_MANDELBOX 1
+
+#define AO_NONE 0
+#define AO_FAST 1
+#define AO_MULTIPLE_RAYS 2
+
+#define MAX_RAYMARCHING_STEPS 10000
+
+// scene parameters. Layout has to be the same as sClParams in opencl_engine.cpp
+typedef struct
+{
+	float4 camera;
+	float4 rotX; // columns of camera rotation matrix
+	float4 rotY;
+	float4 rotZ;
+	float4 rotInvX; // columns of inverted camera rotation matrix
+	float4 rotInvY;
+	float4 rotInvZ;
+	float4 lightVector;
+	float4 repeat;
+	float4 fractalPosition;
+	float4 fractalRotX;
+	float4 fractalRotY;
+	float4 fractalRotZ;
+	float4 constantMultiplier;
+	float4 juliaConstant;
+	float4 mboxOffset;
+	float4 mboxRotX;
+	float4 mboxRotY;
+	float4 mboxRotZ;
+	float4 mboxColorFactor; // w is factor of r
+	float4 mainLightColour;
+	float4 background1; // in 16-bit units
+	float4 background2;
+	float4 background3;
+	float4 materialColour;
+	float4 specularColour;
+	float4 luminosity;
+
+	float fov;
+	float aspectRatio;
+	float imageScaleX;
+	float imageScaleY;
+	float imageOffsetX;
+	float imageOffsetY;
+	float resolution;
+	float detailLevel;
+	float DEThresh;
+	float DEFactor;
+	float viewDistanceMax;
+	float reduceDetail;
+	float relaxation;
+	float smoothness;
+	float iterationLODFactor;
+	float iterationLODReference;
+	float bailout;
+	float initialW;
+	float power;
+	float alphaAngleOffset;
+	float betaAngleOffset;
+	float mboxFoldingLimit;
+	float mboxFoldingValue;
+	float mboxScale;
+	float mboxMR2;
+	float mboxFR2;
+	float mboxFactor1;
+	float mboxColorSp1;
+	float mboxColorSp2;
+	float mainLightIntensity;
+	float mainLightVisibility;
+	float mainLightVisibilitySize;
+	float shading;
+	float specularExponent;
+	float specularDiffuse;
+	float shadowConeTan;
+	float aoIntensity;
+	float aoFastTune;
+	float coloringSpeed;
+	float paletteOffset;
+
+	int perspectiveType;
+	int formula;
+	int N;
+	int minN;
+	int iterThreshMode;
+	int checkForBailout;
+	int addConstant;
+	int juliaEnabled;
+	int mboxMainRotation;
+	int constantDEThreshold;
+	int tetrahedralNormals;
+	int mainLightEnable;
+	int shadowEnabled;
+	int penetratingLights;
+	int softShadows;
+	int aoMode;
+	int aoQuality;
+	int aoVectorsCount;
+	int usePalette;
+	int padding[1];
+} sClParams;
+
+// direction of ambient occlusion ray and colour of light map
+typedef struct
+{
+	float4 direction;
+	float4 colour;
+} sClAOVector;
+
+typedef struct
+{
+	float4 image; // w is depth
+	float4 colour; // w is alpha
+	float4 normal;
+} sClPixel;
+
+// state of fractal iteration
+typedef struct
+{
+	float3 z;
+	float3 c;
+	float r;
+	float r_dz;
+	float DE;
+	float color;
+} sClFractalState;
+
+float3 Rotate(float3 v, float4 x, float4 y, float4 z)
+{
+	return x.xyz * v.x + y.xyz * v.y + z.xyz * v.z;
+}
+
+bool IsNotANumber(float3 v)
+{
+	return !isfinite(v.x) || !isfinite(v.y) || !isfinite(v.z);
+}
+
+// the same as CVector3::operator%
+float3 Mod(float3 a, float3 b)
+{
+	return (float3)(b.x > 0.0f ? fmod(a.x, b.x) : a.x, b.y > 0.0f ? fmod(a.y, b.y) : a.y,
+		b.z > 0.0f ? fmod(a.z, b.z) : a.z);
+}
+
+// pseudo-random numbers of step length
+float Random(uint *seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	return (*seed >> 8) * (1.0f / 16777216.0f);
+}
+
+// the same as cRenderWorker::CalcDistThresh()
+float DistThresh(__constant sClParams *p, float3 point)
+{
+	float distThresh;
+	if (p->constantDEThreshold)
+		distThresh = p->DEThresh;
+	else
+		distThresh = length(p->camera.xyz - point) * p->resolution * p->fov / p->detailLevel;
+	if (p->perspectiveType != PERSP_THREE_POINT) distThresh *= M_PI_F;
+	return distThresh / p->reduceDetail;
+}
+
+// the same as cRenderWorker::CalcDelta()
+float Delta(__constant sClParams *p, float3 point)
+{
+	float delta = length(p->camera.xyz - point) * p->resolution * p->fov;
+	if (p->perspectiveType != PERSP_THREE_POINT) delta *= M_PI_F;
+	return delta;
+}
+
+// the same as IterationLimit() in calculate_distance.cpp
+int IterationLimit(__constant sClParams *p, float detailSize, bool normalMode)
+{
+	int N = p->N;
+	if (p->iterationLODFactor > 0.0f && p->iterationLODReference > 0.0f
+			&& detailSize > p->iterationLODReference)
+	{
+		float reduction = p->iterationLODFactor * log2(detailSize / p->iterationLODReference);
+		int minN = max(p->minN, (int)(p->N * 0.25f));
+		N = min(p->N, max(minN, (int)(p->N - reduction)));
+	}
+	return normalMode ? N * 5 : N;
+}
+
+// repeat, move and rotate
+void FractalInit(__constant sClParams *p, float3 point, sClFractalState *s)
+{
+	float3 repeat = p->repeat.xyz;
+	if (length(repeat) > 0.0f)
+		point = Mod(Mod(point - repeat * 0.5f, repeat) + repeat, repeat) - repeat * 0.5f;
+	point = Rotate(point - p->fractalPosition.xyz, p->fractalRotX, p->fractalRotY, p->fractalRotZ);
+	s->z = point;
+	s->c = point;
+	s->r = length(point);
+	s->r_dz = 1.0f;
+	s->DE = 1.0f;
+	s->color = 1.0f;
+}
+
+// MandelbulbIteration() or MandelboxIteration() and addition of constant
+void FractalIteration(__constant sClParams *p, sClFractalState *s)
+{
+	if (p->formula == FORMULA_MANDELBULB)
+	{
+		float th0 = asin(s->z.z / s->r) + p->betaAngleOffset;
+		float ph0 = atan2(s->z.y, s->z.x) + p->alphaAngleOffset;
+		float rp = pow(s->r, p->power - 1.0f);
+		float th = th0 * p->power;
+		float ph = ph0 * p->power;
+		float cth = cos(th);
+		s->r_dz = rp * s->r_dz * p->power + 1.0f;
+		rp *= s->r;
+		s->z = (float3)(cth * cos(ph), cth * sin(ph), sin(th)) * rp;
+	}
+	else
+	{
+		float3 z = s->z;
+		float limit = p->mboxFoldingLimit;
+		float value = p->mboxFoldingValue;
+		if (z.x > limit)
+		{
+			z.x = value - z.x;
+			s->color += p->mboxColorFactor.x;
+		}
+		else if (z.x < -limit)
+		{
+			z.x = -value - z.x;
+			s->color += p->mboxColorFactor.x;
+		}
+		if (z.y > limit)
+		{
+			z.y = value - z.y;
+			s->color += p->mboxColorFactor.y;
+		}
+		else if (z.y < -limit)
+		{
+			z.y = -value - z.y;
+			s->color += p->mboxColorFactor.y;
+		}
+		if (z.z > limit)
+		{
+			z.z = value - z.z;
+			s->color += p->mboxColorFactor.z;
+		}
+		else if (z.z < -limit)
+		{
+			z.z = -value - z.z;
+			s->color += p->mboxColorFactor.z;
+		}
+
+		float r2 = dot(z, z);
+		z += p->mboxOffset.xyz;
+		if (r2 < p->mboxMR2)
+		{
+			z *= p->mboxFactor1;
+			s->DE *= p->mboxFactor1;
+			s->color += p->mboxColorSp1;
+		}
+		else if (r2 < p->mboxFR2)
+		{
+			float factor = p->mboxFR2 / r2;
+			z *= factor;
+			s->DE *= factor;
+			s->color += p->mboxColorSp2;
+		}
+		z -= p->mboxOffset.xyz;
+
+		if (p->mboxMainRotation) z = Rotate(z, p->mboxRotX, p->mboxRotY, p->mboxRotZ);
+
+		s->z = z * p->mboxScale;
+		s->DE = s->DE * fabs(p->mboxScale) + 1.0f;
+	}
+
+	if (p->addConstant)
+	{
+		if (p->juliaEnabled)
+			s->z += p->juliaConstant.xyz;
+		else
+			s->z += s->c * p->constantMultiplier.xyz;
+	}
+	s->r = sqrt(dot(s->z, s->z) + p->initialW * p->initialW);
+}
+
+// the same as CalculateDistance() for fractal with analytic DE
+float Distance(
+	__constant sClParams *p, float3 point, float detailSize, bool normalMode, bool *maxiterOut)
+{
+	int maxN = IterationLimit(p, detailSize, normalMode);
+	sClFractalState s;
+	FractalInit(p, point, &s);
+
+	bool maxiter = p->iterThreshMode;
+	int iters = maxN;
+	for (int i = 0; i < maxN; i++)
+	{
+		float3 lastZ = s.z;
+		FractalIteration(p, &s);
+
+		if (IsNotANumber(s.z))
+		{
+			s.z = lastZ;
+			s.r = length(lastZ);
+			maxiter = true;
+			iters = i;
+			break;
+		}
+		if (p->checkForBailout
+				&& (s.r > p->bailout || length(s.z - lastZ) / s.r < 0.1f / p->bailout))
+		{
+			maxiter = false;
+			iters = i;
+			break;
+		}
+	}
+	iters++;
+
+	float distance;
+	if (p->formula == FORMULA_MANDELBULB)
+		distance = (s.r_dz > 0.0f) ? 0.5f * s.r * log(s.r) / s.r_dz : s.r;
+	else
+		distance = (s.DE > 0.0f) ? s.r / fabs(s.DE) : s.r;
+
+	if (maxiter) distance = 0.0f;
+	if (iters < p->minN && distance < detailSize) distance = detailSize;
+	if (p->iterThreshMode && !normalMode && !maxiter && distance < detailSize)
+		distance = detailSize * 1.01f;
+	if (isnan(distance)) distance = 0.0f;
+
+	*maxiterOut = maxiter;
+	return distance;
+}
+
+// colour index of standard fractal colouring
+float ColourIndex(__constant sClParams *p, float3 point)
+{
+	sClFractalState s;
+	FractalInit(p, point, &s);
+
+	float minimumR = 100.0f;
+	int maxN = p->N * 10;
+	for (int i = 0; i < maxN; i++)
+	{
+		float3 lastZ = s.z;
+		FractalIteration(p, &s);
+
+		if (IsNotANumber(s.z))
+		{
+			s.z = lastZ;
+			s.r = length(lastZ);
+			break;
+		}
+		if (p->formula != FORMULA_MANDELBOX && s.r < minimumR) minimumR = s.r;
+		if (s.r > 1e15f || length(s.z - lastZ) / s.r < 1e-15f) break;
+	}
+
+	if (p->formula == FORMULA_MANDELBOX)
+		return s.color * 100.0f + s.r * p->mboxColorFactor.w / 1e13f;
+	else
+		return minimumR * 5000.0f;
+}
+
+// the same as CalculateViewVector()
+float3 ViewVector(__constant sClParams *p, float2 normalizedPoint)
+{
+	float3 viewVector;
+	float fov = p->fov;
+	if (p->perspectiveType == PERSP_FISH_EYE || p->perspectiveType == PERSP_FISH_EYE_CUT)
+	{
+		float2 v = normalizedPoint * M_PI_F;
+		float r = length(v);
+		if (r == 0.0f)
+			viewVector = (float3)(0.0f, 1.0f, 0.0f);
+		else
+			viewVector = (float3)(v.x / r * sin(r * fov), cos(r * fov), v.y / r * sin(r * fov));
+	}
+	else if (p->perspectiveType == PERSP_EQUIRECTANGULAR)
+	{
+		float2 v = normalizedPoint * M_PI_F;
+		viewVector = (float3)(sin(fov * v.x) * cos(fov * v.y), cos(fov * v.x) * cos(fov * v.y),
+			sin(fov * v.y));
+	}
+	else
+	{
+		viewVector = (float3)(normalizedPoint.x * fov, 1.0f, normalizedPoint.y * fov);
+	}
+	return Rotate(normalize(viewVector), p->rotX, p->rotY, p->rotZ);
+}
+
+// the same as cRenderWorker::CalculateNormals()
+float3 Normal(__constant sClParams *p, float3 point, float delta, float distThresh)
+{
+	float d = delta * p->smoothness;
+	float3 normal;
+	bool maxiter;
+	if (p->tetrahedralNormals)
+	{
+		const float3 v0 = (float3)(1.0f, -1.0f, -1.0f);
+		const float3 v1 = (float3)(-1.0f, -1.0f, 1.0f);
+		const float3 v2 = (float3)(-1.0f, 1.0f, -1.0f);
+		const float3 v3 = (float3)(1.0f, 1.0f, 1.0f);
+		normal = v0 * Distance(p, point + v0 * d, distThresh, true, &maxiter)
+						 + v1 * Distance(p, point + v1 * d, distThresh, true, &maxiter)
+						 + v2 * Distance(p, point + v2 * d, distThresh, true, &maxiter)
+						 + v3 * Distance(p, point + v3 * d, distThresh, true, &maxiter);
+	}
+	else
+	{
+		float3 dx = (float3)(d, 0.0f, 0.0f);
+		float3 dy = (float3)(0.0f, d, 0.0f);
+		float3 dz = (float3)(0.0f, 0.0f, d);
+		normal.x = Distance(p, point + dx, distThresh, true, &maxiter)
+							 - Distance(p, point - dx, distThresh, true, &maxiter);
+		normal.y = Distance(p, point + dy, distThresh, true, &maxiter)
+							 - Distance(p, point - dy, distThresh, true, &maxiter);
+		normal.z = Distance(p, point + dz, distThresh, true, &maxiter)
+							 - Distance(p, point - dz, distThresh, true, &maxiter);
+	}
+
+	if (normal.x == 0.0f && normal.y == 0.0f && normal.z == 0.0f) return (float3)(1.0f, 0.0f, 0.0f);
+	normal = normalize(normal);
+	if (IsNotANumber(normal)) return (float3)(1.0f, 0.0f, 0.0f);
+	return normal;
+}
+
+// the same as cRenderWorker::MainShadow()
+float MainShadow(__constant sClParams *p, float3 point, float delta, float distThresh)
+{
+	float factor = p->penetratingLights ? delta / p->resolution : p->viewDistanceMax;
+	float dist = distThresh;
+	float shadowTemp = 1.0f;
+	float maxSoft = 0.0f;
+	bool maxiter;
+
+	// in single precision too short steps could not move the point
+	int count = 0;
+	for (float i = distThresh; i < factor && count < MAX_RAYMARCHING_STEPS;
+			 i += dist * p->DEFactor, count++)
+	{
+		float3 point2 = point + p->lightVector.xyz * i;
+		dist = Distance(p, point2, distThresh, false, &maxiter);
+
+		if (p->softShadows)
+		{
+			float angle = (dist - distThresh) / i;
+			if (angle < 0.0f || dist < distThresh) angle = 0.0f;
+			float softShadow = 1.0f - angle / p->shadowConeTan;
+			if (p->penetratingLights) softShadow *= (factor - i) / factor;
+			maxSoft = fmax(maxSoft, fmax(softShadow, 0.0f));
+		}
+
+		if (dist < distThresh)
+		{
+			shadowTemp -= (factor - i) / factor;
+			if (!p->penetratingLights) shadowTemp = 0.0f;
+			if (shadowTemp < 0.0f) shadowTemp = 0.0f;
+			break;
+		}
+	}
+	return p->softShadows ? 1.0f - maxSoft : shadowTemp;
+}
+
+// the same as cRenderWorker::FastAmbientOcclusion()
+float FastAmbientOcclusion(__constant sClParams *p, float3 point, float3 normal, float distThresh)
+{
+	float aoTemp = 0.0f;
+	float lastDist = 1e20f;
+	bool maxiter;
+	for (int i = 1; i < p->aoQuality * p->aoQuality; i++)
+	{
+		float scan = i * i * distThresh;
+		float dist = Distance(p, point + normal * scan, distThresh, false, &maxiter);
+		if (dist > lastDist * 2.0f) dist = lastDist * 2.0f;
+		lastDist = dist;
+		aoTemp += 1.0f / pown(2.0f, i) * (scan - p->aoFastTune * dist) / distThresh;
+	}
+	return fmax(1.0f - 0.2f * aoTemp, 0.0f);
+}
+
+// the same as cRenderWorker::AmbientOcclusion()
+float3 AmbientOcclusion(__constant sClParams *p, __global const sClAOVector *vectors,
+	float3 point, float delta, float distThresh, float lastDist)
+{
+	float startDist = delta;
+	float endDist = delta / p->resolution;
+	float3 ao = (float3)(0.0f, 0.0f, 0.0f);
+	bool maxiter;
+
+	for (int i = 0; i < p->aoVectorsCount; i++)
+	{
+		float3 v = vectors[i].direction.xyz;
+		float dist = lastDist;
+		float shadowTemp = 1.0f;
+		int count = 0;
+		for (float r = startDist; r < endDist && count < MAX_RAYMARCHING_STEPS;
+				 r += dist * 2.0f, count++)
+		{
+			dist = Distance(p, point + v * r, distThresh, false, &maxiter);
+			if (dist < distThresh || maxiter)
+			{
+				shadowTemp = fmax(shadowTemp - (endDist - r) / endDist, 0.0f);
+				break;
+			}
+		}
+		ao += shadowTemp * vectors[i].colour.xyz;
+	}
+	return ao / p->aoVectorsCount;
+}
+
+// the same as cRenderWorker::SurfaceColour()
+float3 SurfaceColour(__constant sClParams *p, __global const float4 *palette, float3 point)
+{
+	if (!p->usePalette) return p->materialColour.xyz;
+
+	int nrCol = convert_int_sat(floor(ColourIndex(p, point)));
+	nrCol = abs(nrCol) % (248 * 256);
+	int colorNumber = (int)(nrCol * p->coloringSpeed + 256.0f * p->paletteOffset) % 65536;
+	// the last entry is the colour of negative indices
+	return palette[colorNumber < 0 ? 65536 : colorNumber].xyz;
+}
+
+// the same as cRenderWorker::BackgroundShader() without textures
+float3 BackgroundShader(__constant sClParams *p, float3 viewVector)
+{
+	float grad = viewVector.z + 1.0f;
+	float3 pixel;
+	if (grad < 1.0f)
+		pixel = p->background3.xyz * (1.0f - grad) + p->background2.xyz * grad;
+	else
+		pixel = p->background2.xyz * (2.0f - grad) + p->background1.xyz * (grad - 1.0f);
+	// colour is stored in 16-bit integers by CPU
+	pixel = floor(pixel) / 65536.0f;
+
+	float light =
+		(dot(viewVector, p->lightVector.xyz) - 1.0f) * 360.0f / p->mainLightVisibilitySize;
+	light = 1.0f / (1.0f + pown(light, 6)) * p->mainLightVisibility * p->mainLightIntensity;
+	return pixel + light * p->mainLightColour.xyz;
+}
+
+// the same as cRenderWorker::ObjectShaderVariant() for materials without textures
+float3 ObjectShader(__constant sClParams *p, __global const sClAOVector *aoVectors, float3 point,
+	float3 normal, float3 viewVector, float delta, float distThresh, float lastDist,
+	float3 colour)
+{
+	float3 lightVector = p->lightVector.xyz;
+	float3 mainLight = p->mainLightIntensity * p->mainLightColour.xyz;
+
+	float shade = 0.0f;
+	float shadow = 1.0f;
+	float3 specular = (float3)(0.0f, 0.0f, 0.0f);
+	if (p->mainLightEnable)
+	{
+		shade = fmax(dot(normal, lightVector), 0.0f);
+		shade = p->mainLightIntensity * ((1.0f - p->shading) + p->shading * shade);
+
+		if (p->shadowEnabled) shadow = MainShadow(p, point, delta, distThresh);
+
+		float3 halfVector = normalize(lightVector - viewVector);
+		float shade2 = fmax(dot(normal, halfVector), 0.0f);
+		shade2 = fmin(pow(shade2, p->specularExponent) / p->specularDiffuse, 15.0f);
+		specular = shade2 * p->specularColour.xyz;
+	}
+
+	float3 ambient = (float3)(0.0f, 0.0f, 0.0f);
+	if (p->aoMode == AO_FAST)
+		ambient = (float3)(FastAmbientOcclusion(p, point, normal, distThresh));
+	else if (p->aoMode == AO_MULTIPLE_RAYS)
+		ambient = AmbientOcclusion(p, aoVectors, point, delta, distThresh, lastDist);
+	ambient *= p->aoIntensity;
+
+	float3 output = (ambient + mainLight * shade * shadow) * colour + p->luminosity.xyz;
+	output += mainLight * specular * shadow;
+	return fmax(output, 0.0f);
+}
+
+// one work item per pixel of tiles. Tiles are given as x1, y1, x2, y2 clipped to the image
+// and pixels of each tile are stored in separate block of tileSize * tileSize pixels
+__kernel void RayMarcher(__constant sClParams *p, __global const float4 *palette,
+	__global const sClAOVector *aoVectors, __global const int4 *tiles, __global sClPixel *out,
+	int tileSize)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int tile = get_global_id(2);
+	int4 region = tiles[tile];
+	int xs = region.x + x;
+	int ys = region.y + y;
+	if (xs >= region.z || ys >= region.w) return;
+	__global sClPixel *pixel = &out[(tile * tileSize + y) * tileSize + x];
+
+	// calculate point in image coordinate system
+	float2 imagePoint =
+		(float2)(p->imageScaleX * xs + p->imageOffsetX, p->imageScaleY * ys + p->imageOffsetY);
+	imagePoint.x *= p->aspectRatio;
+
+	// full dome hemisphere cut
+	if (p->perspectiveType == PERSP_FISH_EYE_CUT && length(imagePoint) > 0.5f / p->fov)
+	{
+		pixel->image = (float4)(0.0f, 0.0f, 0.0f, 1e20f);
+		pixel->colour = (float4)(0.0f, 0.0f, 0.0f, 1.0f);
+		pixel->normal = (float4)(0.5f, 0.5f, 1.0f, 0.0f);
+		return;
+	}
+
+	float3 start = p->camera.xyz;
+	float3 direction = normalize(ViewVector(p, imagePoint));
+	uint seed = (uint)(xs * 1973 + ys * 9277 + 26699) | 1u;
+
+	float scan = 0.0f;
+	float3 point = (float3)(0.0f, 0.0f, 0.0f);
+	float3 lastPoint = point;
+	float dist = 0.0f;
+	float step = 0.0f;
+	float distThresh = 0.0f;
+	float previousDist = 0.0f;
+	float conservativeStep = 0.0f;
+	bool found = false;
+	bool deadComputation = false;
+	bool relaxedStep = false;
+	bool maxiter;
+
+	// ray-marching, the same as cRenderWorker::RayMarchingStep()
+	int stepIndex = 0;
+	while (stepIndex < MAX_RAYMARCHING_STEPS)
+	{
+		lastPoint = point;
+		point = start + direction * scan;
+		if (point.x == lastPoint.x && point.y == lastPoint.y && point.z == lastPoint.z)
+		{
+			point = lastPoint;
+			found = true;
+			deadComputation = true;
+			break;
+		}
+
+		distThresh = DistThresh(p, point);
+		float d = fmin(Distance(p, point, distThresh, false, &maxiter), 3.0f);
+
+		// relaxed step could jump over the surface, so it is repeated as conservative step
+		if (relaxedStep && previousDist + d < step)
+		{
+			scan += conservativeStep - step;
+			step = conservativeStep;
+			relaxedStep = false;
+			continue;
+		}
+
+		dist = d;
+		if (dist < distThresh)
+		{
+			found = true;
+			break;
+		}
+
+		step = (dist - 0.5f * distThresh) * p->DEFactor * (1.0f - Random(&seed) * 0.1f);
+		conservativeStep = step;
+		previousDist = dist;
+		relaxedStep = p->relaxation > 1.0f;
+		if (relaxedStep) step *= p->relaxation;
+		scan += step;
+		stepIndex++;
+
+		// end of the ray has to be reached by conservative step
+		if (scan > p->viewDistanceMax && relaxedStep)
+		{
+			scan += conservativeStep - step;
+			step = conservativeStep;
+			relaxedStep = false;
+		}
+		if (scan > p->viewDistanceMax) break;
+	}
+
+	// binary searching, the same as cRenderWorker::RefineHitBisection()
+	if (found && !deadComputation)
+	{
+		float searchLimit = 1.0f - 0.01f * p->detailLevel;
+		step *= 0.5f;
+		for (int i = 0; i < 30; i++)
+		{
+			if (dist < distThresh && dist > distThresh * searchLimit) break;
+			if (dist > distThresh)
+				scan += step;
+			else if (dist < distThresh * searchLimit)
+				scan -= step;
+			point = start + direction * scan;
+			distThresh = DistThresh(p, point);
+			dist = Distance(p, point, distThresh, false, &maxiter);
+			step *= 0.5f;
+		}
+	}
+	if (p->iterThreshMode)
+	{
+		scan -= distThresh;
+		point = start + direction * scan;
+	}
+
+	if (found)
+	{
+		float delta = Delta(p, point);
+		float3 normal = Normal(p, point, delta, distThresh);
+		float3 colour = SurfaceColour(p, palette, point);
+		float3 result = ObjectShader(
+			p, aoVectors, point, normal, direction, delta, distThresh, dist, colour);
+		float3 normalRotated = Rotate(normal, p->rotInvX, p->rotInvY, p->rotInvZ);
+
+		pixel->image = (float4)(result, scan);
+		pixel->colour = (float4)(colour, 1.0f);
+		pixel->normal = (float4)((1.0f + normalRotated.x) * 0.5f, (1.0f + normalRotated.z) * 0.5f,
+			1.0f - normalRotated.y, 0.0f);
+	}
+	else
+	{
+		// normal vector of background is opposite to the camera direction
+		pixel->image = (float4)(BackgroundShader(p, direction), 1e20f);
+		pixel->colour = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+		pixel->normal = (float4)(0.5f, 0.5f, 2.0f, 0.0f);
+	}
+}
@@ -230,6 +230,10 @@ void cDockFractal::slotFractalSwap(int swapA, int swapB)
 {
 	// qDebug() << "swapping " << swapA << " with " << swapB;
 
+	// formula widgets of both tabs are needed to swap their parameters
+	fractalTabs[swapA]->CreatePendingFormulaWidget();
+	fractalTabs[swapB]->CreatePendingFormulaWidget();
+
 	// read all data from ui
 	gMainInterface->SynchronizeInterface(gPar, gParFractal, qInterface::read);
 
@@ -237,7 +241,7 @@ void cDockFractal::slotFractalSwap(int swapA, int swapB)
 	QStringList gParFormulaSpecificFields({"formula", "formula_iterations", "formula_weight",
 		"formula_start_iteration", "formula_stop_iteration", "julia_mode", "julia_c",
 		"fractal_constant_factor", "formula_position", "formula_rotation", "formula_repeat",
-		"formula_scale", "dont_add_c_constant", "check_for_bailout"});
+		"formula_scale", "formula_bounding_radius", "dont_add_c_constant", "check_for_bailout"});
 
 	for (int i = 0; i < gParFormulaSpecificFields.size(); i++)
 	{
@@ -62,6 +62,18 @@ void cDockImageAdjustments::slotDisableAutoRefresh()
 	gMainInterface->DisablePeriodicRefresh();
 }
 
+void cDockImageAdjustments::slotPreviewImageAdjustments()
+{
+	// values are taken directly from widgets, because reading of whole dock would overwrite
+	// parameters while they are being written to the interface
+	sImageAdjustments imageAdjustments;
+	imageAdjustments.brightness = ui->spinbox_brightness->value();
+	imageAdjustments.contrast = ui->spinbox_contrast->value();
+	imageAdjustments.imageGamma = ui->spinbox_gamma->value();
+	imageAdjustments.hdrEnabled = ui->checkBox_hdr->isChecked();
+	gMainInterface->PreviewImageAdjustments(imageAdjustments);
+}
+
 void cDockImageAdjustments::ConnectSignals()
 {
 	connect(ui->comboBox_perspective_type, SIGNAL(currentIndexChanged(int)), this,
@@ -112,6 +124,14 @@ void cDockImageAdjustments::ConnectSignals()
 	connect(ui->spinbox_contrast, SIGNAL(valueChanged(double)), this, SLOT(slotDisableAutoRefresh()));
 	connect(ui->spinbox_gamma, SIGNAL(valueChanged(double)), this, SLOT(slotDisableAutoRefresh()));
 	connect(ui->checkBox_hdr, SIGNAL(stateChanged(int)), this, SLOT(slotDisableAutoRefresh()));
+
+	connect(ui->spinbox_brightness, SIGNAL(valueChanged(double)), this,
+		SLOT(slotPreviewImageAdjustments()));
+	connect(ui->spinbox_contrast, SIGNAL(valueChanged(double)), this,
+		SLOT(slotPreviewImageAdjustments()));
+	connect(
+		ui->spinbox_gamma, SIGNAL(valueChanged(double)), this, SLOT(slotPreviewImageAdjustments()));
+	connect(ui->checkBox_hdr, SIGNAL(stateChanged(int)), this, SLOT(slotPreviewImageAdjustments()));
 }
 
 void cDockImageAdjustments::slotChangedComboImageProportion(int index)
@@ -86,6 +86,7 @@ private slots:
 	void slotQualityPresetNormal();
 	void slotQualityPresetHigh();
 	void slotDisableAutoRefresh();
+	void slotPreviewImageAdjustments();
 
 private:
 	void ConnectSignals();
@@ -145,7 +145,8 @@ void cDockRenderingEngine::slotNetRenderClientListUpdate()
 	if (table->columnCount() == 0)
 	{
 		QStringList header;
-		header << tr("Name") << tr("Host") << tr("CPUs") << tr("Status") << tr("Lines done");
+		header << tr("Name") << tr("Host") << tr("CPUs") << tr("Status") << tr("Lines done")
+					 << tr("Lines/s");
 		table->setColumnCount(header.size());
 		table->setHorizontalHeaderLabels(header);
 	}
@@ -203,6 +204,7 @@ void cDockRenderingEngine::slotNetRenderClientListUpdate(int i, int j)
 			break;
 		}
 		case 4: cell->setText(QString::number(gNetRender->GetClient(i).linesRendered)); break;
+		case 5: cell->setText(QString::number(gNetRender->GetClient(i).linesPerSecond, 'f', 1)); break;
 	}
 }
 
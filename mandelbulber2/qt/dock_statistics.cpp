@@ -34,6 +34,7 @@
 
 #include "dock_statistics.h"
 
+#include "../src/distance_query.hpp"
 #include "../src/initparameters.hpp"
 #include "../src/interface.hpp"
 #include "../src/render_window.hpp"
@@ -43,8 +44,25 @@
 cDockStatistics::cDockStatistics(QWidget *parent) : QWidget(parent), ui(new Ui::cDockStatistics)
 {
 	ui->setupUi(this);
+	distanceRequestId = 0;
 	ui->tableWidget_statistics->verticalHeader()->setDefaultSectionSize(
 		gPar->Get<int>("ui_font_size") + 6);
+
+	// rows with times of rendering stages are added after rows defined in the form
+	QTableWidget *table = ui->tableWidget_statistics;
+	firstStageRow = table->rowCount();
+	table->setRowCount(firstStageRow + renderStageCount + 2);
+	for (int i = 0; i < renderStageCount; i++)
+	{
+		table->setVerticalHeaderItem(firstStageRow + i,
+			new QTableWidgetItem(tr("Thread time: %1").arg(cStageTimer::StageName(i))));
+	}
+	table->setVerticalHeaderItem(firstStageRow + renderStageCount,
+		new QTableWidgetItem(tr("Screen space ambient occlusion time")));
+	table->setVerticalHeaderItem(
+		firstStageRow + renderStageCount + 1, new QTableWidgetItem(tr("Depth of field time")));
+	for (int row = firstStageRow; row < table->rowCount(); row++)
+		table->setItem(row, 0, new QTableWidgetItem("0"));
 }
 
 cDockStatistics::~cDockStatistics()
@@ -57,6 +75,19 @@ void cDockStatistics::UpdateDistanceToFractal(double distance)
 	ui->tableWidget_statistics->item(5, 0)->setText(QString::number(distance));
 }
 
+void cDockStatistics::RequestDistanceToFractal(
+	CVector3 point, const cParameterContainer *par, const cFractalContainer *parFractal)
+{
+	connect(gDistanceQuery, SIGNAL(distancesCalculated(int, QList<double>)), this,
+		SLOT(slotDistancesCalculated(int, QList<double>)), Qt::UniqueConnection);
+	distanceRequestId = gDistanceQuery->Request(QList<CVector3>() << point, par, parFractal);
+}
+
+void cDockStatistics::slotDistancesCalculated(int requestId, QList<double> distances)
+{
+	if (requestId == distanceRequestId) UpdateDistanceToFractal(distances.first());
+}
+
 void cDockStatistics::slotUpdateStatistics(cStatistics stat)
 {
 	ui->label_histogram_de->SetBarcolor(QColor(0, 255, 0));
@@ -71,6 +102,32 @@ void cDockStatistics::slotUpdateStatistics(cStatistics stat)
 		QString::number(stat.GetNumberOfIterationsPerSecond()));
 	ui->tableWidget_statistics->item(3, 0)->setText(stat.GetDETypeString());
 	ui->tableWidget_statistics->item(4, 0)->setText(QString::number(stat.GetMissedDEPercentage()));
+	ui->tableWidget_statistics->item(6, 0)->setText(
+		QString::number(stat.GetPrimitiveEvaluationsPerStep()));
+	ui->tableWidget_statistics->item(7, 0)->setText(QString::number(stat.raymarchingRelaxation));
+	ui->tableWidget_statistics->item(8, 0)->setText(
+		QString::number(stat.numberOfRelaxationFallbacks));
+	ui->tableWidget_statistics->item(9, 0)->setText(
+		QString::number(stat.numberOfAntiAliasedPixels));
+	ui->tableWidget_statistics->item(10, 0)->setText(stat.GetShaderVariantString());
+	ui->tableWidget_statistics->item(11, 0)->setText(
+		QString::number(stat.GetRefinementStepsPerHit()));
+
+	double totalStageTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		totalStageTime += stat.stageTimes[i];
+	for (int i = 0; i < renderStageCount; i++)
+	{
+		double percent = totalStageTime > 0.0 ? stat.stageTimes[i] / totalStageTime * 100.0 : 0.0;
+		ui->tableWidget_statistics->item(firstStageRow + i, 0)
+			->setText(tr("%1 s (%2%)")
+									.arg(QString::number(stat.stageTimes[i], 'f', 3))
+									.arg(QString::number(percent, 'f', 1)));
+	}
+	ui->tableWidget_statistics->item(firstStageRow + renderStageCount, 0)
+		->setText(tr("%1 s").arg(QString::number(stat.ssaoTime, 'f', 3)));
+	ui->tableWidget_statistics->item(firstStageRow + renderStageCount + 1, 0)
+		->setText(tr("%1 s").arg(QString::number(stat.dofTime, 'f', 3)));
 	gMainInterface->mainWindow->GetWidgetDockRenderingEngine()->UpdateLabelWrongDEPercentage(
 		tr("Percentage of wrong distance estimations: %1").arg(stat.GetMissedDEPercentage()));
 	gMainInterface->mainWindow->GetWidgetDockRenderingEngine()->UpdateLabelUsedDistanceEstimation(
@@ -37,10 +37,13 @@
 
 #include <QWidget>
 
+#include "../src/algebra.hpp"
 #include "../src/statistics.h"
 
 // forward declarations
 class cAutomatedWidgets;
+class cFractalContainer;
+class cParameterContainer;
 
 namespace Ui
 {
@@ -55,12 +58,20 @@ public:
 	~cDockStatistics();
 
 	void UpdateDistanceToFractal(double distance);
+	// distance is calculated in background and shown when ready
+	void RequestDistanceToFractal(
+		CVector3 point, const cParameterContainer *par, const cFractalContainer *parFractal);
 
 public slots:
 	void slotUpdateStatistics(cStatistics);
 
+private slots:
+	void slotDistancesCalculated(int requestId, QList<double> distances);
+
 private:
 	Ui::cDockStatistics *ui;
+	int firstStageRow; // first row with times of rendering stages
+	int distanceRequestId; // the last requested distance, older results are ignored
 };
 
 #endif /* MANDELBULBER2_QT_DOCK_STATISTICS_H_ */
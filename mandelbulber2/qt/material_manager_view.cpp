@@ -112,6 +112,9 @@ void cMaterialManagerView::slotLoadMaterial()
 {
 	cSettings parSettings(cSettings::formatFullText);
 
+	// example materials are installed on first use of the materials folder
+	RetrieveExampleMaterials(false);
+
 	QFileDialog dialog(this);
 	dialog.setOption(QFileDialog::DontUseNativeDialog);
 	dialog.setFileMode(QFileDialog::ExistingFiles);
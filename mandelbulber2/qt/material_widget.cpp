@@ -110,18 +110,9 @@ void cMaterialWidget::InitializeData()
 		QElapsedTimer timer;
 		timer.start();
 
-		cParameterContainer params;
-		cFractalContainer fractal;
-
-		params.SetContainerName("material");
-		InitParams(&params);
-
-		for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
-		{
-			fractal.at(i).SetContainerName(QString("fractal") + QString::number(i));
-			InitFractalParams(&fractal.at(i));
-		}
-		InitMaterialParams(1, &params);
+		// only material parameters are swapped in the prepared scene
+		cParameterContainer params = PreviewScene().params;
+		cFractalContainer fractal = PreviewScene().fractal;
 
 		// copy parameters from main parameter container to temporary container for material
 		for (int i = 0; i < cMaterial::paramsList.size(); i++)
@@ -131,20 +122,9 @@ void cMaterialWidget::InitializeData()
 			params.SetFromOneParameter(cMaterial::Name(cMaterial::paramsList.at(i), 1), parameter);
 		}
 
-		params.Set("camera", CVector3(1.5, -2.5, 0.7));
-		params.Set("raytraced_reflections", true);
-		params.Set("N", 10);
-		params.Set("detail_level", 0.2);
-		params.Set("smoothness", 5.0);
-		fractal.at(0).Set("power", 5);
-		params.Set("julia_mode", true);
-		params.Set("textured_background", true);
-		params.Set("file_background",
-			QDir::toNativeSeparators(systemData.sharedDir + "textures" + QDir::separator() + "grid.png"));
+		// preview scene overrides some of material settings
 		params.Set("mat1_texture_scale", CVector3(1.0, 1.0, 1.0));
 		params.Set("mat1_displacement_texture_height", 0.01);
-		params.Set("main_light_intensity", 1.2);
-		params.Set("shadows_enabled", false);
 
 		// call parent assignation
 		// maybe disable preview saving, to not pollute hard drive?
@@ -162,6 +142,47 @@ void cMaterialWidget::InitializeData()
 	}
 }
 
+const cMaterialWidget::sPreviewScene &cMaterialWidget::PreviewScene()
+{
+	// scene is the same for all material previews, so it's initialized only once
+	static sPreviewScene *scene = NULL;
+	if (!scene)
+	{
+		scene = new sPreviewScene;
+		cParameterContainer &params = scene->params;
+		cFractalContainer &fractal = scene->fractal;
+
+		params.SetContainerName("material");
+		InitParams(&params);
+
+		for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+		{
+			fractal.at(i).SetContainerName(QString("fractal") + QString::number(i));
+			InitFractalParams(&fractal.at(i));
+		}
+		InitMaterialParams(1, &params);
+
+		params.Set("camera", CVector3(1.5, -2.5, 0.7));
+		params.Set("raytraced_reflections", true);
+		params.Set("N", 10);
+		params.Set("detail_level", 0.2);
+		params.Set("smoothness", 5.0);
+		fractal.at(0).Set("power", 5);
+		params.Set("julia_mode", true);
+		params.Set("textured_background", true);
+		params.Set("file_background",
+			QDir::toNativeSeparators(systemData.sharedDir + "textures" + QDir::separator() + "grid.png"));
+		params.Set("main_light_intensity", 1.2);
+		params.Set("shadows_enabled", false);
+	}
+	return *scene;
+}
+
+void cMaterialWidget::ListOfTextures(QList<cTexture::sTextureRequest> *list) const
+{
+	if (dataAssigned) cMaterial::ListOfTextures(actualMaterialIndex, &paramsCopy, list);
+}
+
 void cMaterialWidget::slotPeriodicRender(void)
 {
 	if (!visibleRegion().isEmpty())
@@ -40,7 +40,9 @@
 #define MANDELBULBER2_QT_MATERIAL_WIDGET_H_
 
 #include "thumbnail_widget.h"
+#include "../src/fractal_container.hpp"
 #include "../src/parameters.hpp"
+#include "../src/texture.hpp"
 
 class cMaterialWidget : public cThumbnailWidget
 {
@@ -52,8 +54,17 @@ public:
 	void AssignMaterial(
 		cParameterContainer *_params, int materialIndex, QWidget *_materialEditorWidget = NULL);
 	void AssignMaterial(const QString &settings, int materialIndex);
+	// textures needed to render the preview of assigned material
+	void ListOfTextures(QList<cTexture::sTextureRequest> *list) const;
 
 private:
+	struct sPreviewScene
+	{
+		cParameterContainer params;
+		cFractalContainer fractal;
+	};
+	static const sPreviewScene &PreviewScene();
+
 	cParameterContainer *paramsHandle;
 	cParameterContainer paramsCopy;
 	int actualMaterialIndex;
@@ -83,6 +83,8 @@ void cMeshExportDialog::on_pushButton_start_render_layers_clicked()
 		int samplesX = gPar->Get<int>("voxel_samples_x");
 		int samplesY = gPar->Get<int>("voxel_samples_y");
 		int samplesZ = gPar->Get<int>("voxel_samples_z");
+		cMeshExport::enumMeshFileFormat outputFormat =
+			cMeshExport::enumMeshFileFormat(gPar->Get<int>("mesh_output_format"));
 
 		QFileInfo fi(outFname);
 		if (fi.exists())
@@ -100,8 +102,8 @@ void cMeshExportDialog::on_pushButton_start_render_layers_clicked()
 		}
 
 		slicerBusy = true;
-		meshExport = new cMeshExport(
-			samplesX, samplesY, samplesZ, limitMin, limitMax, fi.absoluteFilePath(), maxIter);
+		meshExport = new cMeshExport(samplesX, samplesY, samplesZ, limitMin, limitMax,
+			fi.absoluteFilePath(), maxIter, outputFormat);
 		QObject::connect(meshExport,
 			SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
 			SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
@@ -32,10 +32,12 @@
  * PlayerWidget - promoted QWidget to display video of image sequence from folder
  * The folder can be assigned with SetFilePath(). The widget will play the image
  * sequence inside the folder with simple player functionality.
+ * Frames are taken from cPlayerFrameCache, which decodes them ahead of playback.
  */
 
 #include "player_widget.hpp"
 #include "../src/initparameters.hpp"
+#include "../src/player_frame_cache.hpp"
 #include "my_double_spin_box.h"
 
 PlayerWidget::PlayerWidget(QWidget *parent) : QWidget(parent)
@@ -47,6 +49,7 @@ PlayerWidget::PlayerWidget(QWidget *parent) : QWidget(parent)
 	positionSlider = new QSlider(Qt::Horizontal);
 	playTimer = new QTimer;
 	fpsSpinBox = new MyDoubleSpinBox;
+	frameCache = new cPlayerFrameCache(this);
 
 	currentIndex = 0;
 	playTimer->setInterval(30);
@@ -120,6 +123,7 @@ void PlayerWidget::updateFromFolder()
 	QStringList imageFileExtensions({"*.jpg", "*.jpeg", "*.png", "*.tiff"});
 	imageDir.setNameFilters(imageFileExtensions);
 	imageFiles = imageDir.entryList(QDir::NoDotAndDotDot | QDir::Files);
+	frameCache->SetFiles(dirPath, imageFiles);
 
 	if (imageFiles.size() == 0)
 	{
@@ -179,11 +183,13 @@ void PlayerWidget::updateFrame()
 		return;
 	}
 	if (imageFiles.size() == 0) return;
-	QString fileName = dirPath + "/" + imageFiles.at(currentIndex);
-	QPixmap pix(fileName);
+	if (currentIndex >= imageFiles.size()) currentIndex = 0;
+	// frames are decoded already downscaled to the label
+	frameCache->SetTargetSize(imageLabel->size());
+	QPixmap pix = QPixmap::fromImage(frameCache->GetFrame(currentIndex));
 	if (pix.isNull())
 	{
-		qWarning() << "Image could not be loaded, " << fileName;
+		qWarning() << "Image could not be loaded, " << dirPath + "/" + imageFiles.at(currentIndex);
 		return;
 	}
 	infoLabel->setText(QObject::tr("Frame %1 of %2").arg(currentIndex + 1).arg(imageFiles.size()));
@@ -43,6 +43,7 @@
 
 // forward declarations
 class MyDoubleSpinBox;
+class cPlayerFrameCache;
 
 class PlayerWidget : public QWidget
 {
@@ -73,6 +74,7 @@ private:
 	QLabel *imageLabel;
 	MyDoubleSpinBox *fpsSpinBox;
 	QTimer *playTimer;
+	cPlayerFrameCache *frameCache;
 	QStringList imageFiles;
 	int currentIndex;
 	QString dirPath;
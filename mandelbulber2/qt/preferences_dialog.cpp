@@ -50,6 +50,7 @@
 #include "../src/render_window.hpp"
 #include "../src/settings.hpp"
 #include "../src/system.hpp"
+#include "../src/thumbnail_store.hpp"
 #include "ui_preferences_dialog.h"
 
 cPreferencesDialog::cPreferencesDialog(QWidget *parent)
@@ -148,9 +149,11 @@ void cPreferencesDialog::on_pushButton_select_textures_path_clicked()
 
 void cPreferencesDialog::on_pushButton_clear_thumbnail_cache_clicked()
 {
+	// thumbnails from older versions which are not yet moved to the store are also counted
 	QDir thumbnailDir(systemData.GetThumbnailsFolder());
-	thumbnailDir.setFilter(QDir::AllEntries | QDir::NoDotAndDotDot);
-	int thumbnailDirCount = thumbnailDir.count();
+	thumbnailDir.setNameFilters(QStringList() << "????????????????????????????????.*");
+	thumbnailDir.setFilter(QDir::Files);
+	int thumbnailDirCount = thumbnailDir.count() + cThumbnailStore::Instance()->Count();
 
 	// confirmation dialog before clearing
 	QMessageBox::StandardButton reply;
@@ -165,6 +168,7 @@ void cPreferencesDialog::on_pushButton_clear_thumbnail_cache_clicked()
 		// match exact 32 char hash images, example filename: c0ad626d8c25ab6a25c8d19a53960c8a.png
 		DeleteAllFilesFromDirectory(
 			systemData.GetThumbnailsFolder(), "????????????????????????????????.*");
+		cThumbnailStore::Instance()->Clear();
 	}
 	else
 	{
@@ -268,14 +272,8 @@ void cPreferencesDialog::on_pushButton_generate_thumbnail_cache_clicked()
 				}
 				else
 				{
-					// "touch" the file, to mark it with current time stamp
-					QFile file(thumbWidget->GetThumbnailFileName());
-					if (file.open(QIODevice::Append))
-					{
-						QDataStream out(&file);
-						out << "";
-						file.close();
-					}
+					// mark it as recently used, so it is not dropped from the store
+					cThumbnailStore::Instance()->Touch(thumbWidget->GetHash());
 				}
 			}
 		}
@@ -37,11 +37,11 @@
 #include "../qt/my_progress_bar.h"
 #include "../qt/thumbnail_widget.h"
 #include "../src/fractal_container.hpp"
-#include "../src/initparameters.hpp"
 #include "../src/interface.hpp"
 #include "../src/queue.hpp"
 #include "../src/render_window.hpp"
 #include "../src/settings.hpp"
+#include "../src/settings_preview_loader.hpp"
 #include "../src/system.hpp"
 
 PreviewFileDialog::PreviewFileDialog(QWidget *parent) : QFileDialog(parent)
@@ -60,6 +60,9 @@ PreviewFileDialog::PreviewFileDialog(QWidget *parent) : QFileDialog(parent)
 
 	thumbWidget = new cThumbnailWidget(200, 200, 1, this);
 
+	// settings files are decoded in background
+	settingsLoader = new cSettingsPreviewLoader(this);
+
 	description = new QLabel("", this);
 	description->setAlignment(Qt::AlignCenter);
 	description->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Fixed);
@@ -97,6 +100,10 @@ PreviewFileDialog::PreviewFileDialog(QWidget *parent) : QFileDialog(parent)
 	connect(presetAddButton, SIGNAL(clicked()), this, SLOT(OnPresetAdd()));
 	connect(queueAddButton, SIGNAL(clicked()), this, SLOT(OnQueueAdd()));
 	connect(thumbWidget, SIGNAL(thumbnailRendered()), this, SLOT(slotHideProgressBar()));
+	connect(settingsLoader,
+		SIGNAL(settingsLoaded(QString, bool, QString, cParameterContainer, cFractalContainer, bool)),
+		this,
+		SLOT(slotSettingsLoaded(QString, bool, QString, cParameterContainer, cFractalContainer, bool)));
 	connect(thumbWidget, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
 		this, SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
 }
@@ -132,41 +139,11 @@ void PreviewFileDialog::OnCurrentChanged(const QString &_filename)
 		thumbWidget->show();
 		description->show();
 		preview->hide();
-		cSettings parSettings(cSettings::formatFullText);
-		parSettings.BeQuiet(true);
-		if (parSettings.LoadFromFile(filename))
-		{
-			progressBar->show();
-			cParameterContainer *par = new cParameterContainer;
-			cFractalContainer *parFractal = new cFractalContainer;
-			InitParams(par);
-			for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
-				InitFractalParams(&parFractal->at(i));
-
-			/****************** TEMPORARY CODE FOR MATERIALS *******************/
-
-			InitMaterialParams(1, par);
-
-			/*******************************************************************/
-
-			if (parSettings.Decode(par, parFractal))
-			{
-				description->setText(par->Get<QString>("description"));
-				thumbWidget->AssignParameters(*par, *parFractal);
-				thumbWidget->update();
-			}
-			else
-			{
-				description->setText(" ");
-				preview->setText(" ");
-				info->setText(" ");
-			}
-			delete par;
-			delete parFractal;
-		}
+		settingsLoader->Request(filename, 200, 200, 1);
 	}
 	else
 	{
+		settingsLoader->Cancel();
 		thumbWidget->hide();
 		description->hide();
 		preview->show();
@@ -186,6 +163,26 @@ void PreviewFileDialog::OnCurrentChanged(const QString &_filename)
 	}
 }
 
+void PreviewFileDialog::slotSettingsLoaded(QString fileName, bool valid, QString _description,
+	cParameterContainer par, cFractalContainer fractal, bool thumbnailStored)
+{
+	if (fileName != filename) return;
+	if (valid)
+	{
+		// thumbnail which has to be rendered reports progress
+		if (!thumbnailStored) progressBar->show();
+		description->setText(_description);
+		thumbWidget->AssignParameters(par, fractal);
+		thumbWidget->update();
+	}
+	else
+	{
+		description->setText(" ");
+		preview->setText(" ");
+		info->setText(" ");
+	}
+}
+
 void PreviewFileDialog::slotUpdateProgressAndStatus(
 	const QString &text, const QString &progressText, double progress)
 {
@@ -41,8 +41,12 @@
 #include <QPushButton>
 #include <QVBoxLayout>
 
+#include "../src/fractal_container.hpp"
+#include "../src/parameters.hpp"
+
 // forward declarations
 class cThumbnailWidget;
+class cSettingsPreviewLoader;
 class MyProgressBar;
 
 class PreviewFileDialog : public QFileDialog
@@ -58,6 +62,8 @@ protected slots:
 	void slotUpdateProgressAndStatus(
 		const QString &text, const QString &progressText, double progress);
 	void slotHideProgressBar();
+	void slotSettingsLoaded(QString fileName, bool valid, QString description,
+		cParameterContainer par, cFractalContainer fractal, bool thumbnailStored);
 
 private:
 	QVBoxLayout *vboxlayout;
@@ -66,6 +72,7 @@ private:
 	QPushButton *presetAddButton;
 	QPushButton *queueAddButton;
 	QString filename;
+	cSettingsPreviewLoader *settingsLoader;
 
 protected:
 	QLabel *preview;
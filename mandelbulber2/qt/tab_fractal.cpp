@@ -40,6 +40,7 @@
 #include "../src/automated_widgets.hpp"
 #include "../src/error_message.hpp"
 #include "../src/fractal_container.hpp"
+#include "../src/formula_benchmark.hpp"
 #include "../src/fractal_list.hpp"
 #include "../src/interface.hpp"
 #include "../src/my_ui_loader.h"
@@ -55,6 +56,7 @@ cTabFractal::cTabFractal(QWidget *parent) : QWidget(parent), ui(new Ui::cTabFrac
 	ConnectSignals();
 
 	fractalWidget = NULL;
+	pendingFractalIndex = -1;
 	tabIndex = 0;
 }
 
@@ -105,6 +107,22 @@ void cTabFractal::Init(bool firstTab, int _tabIndex)
 	{
 		ui->comboBox_formula->addItem(
 			QIcon(fractalList[f].getIconName()), fractalList[f].nameInComboBox, f);
+
+		// results of formula benchmark
+		if (fractalList[f].nsPerIteration > 0.0)
+		{
+			QString toolTip = QObject::tr("%1 ns per iteration, %2% of points reach bailout")
+													.arg(fractalList[f].nsPerIteration, 0, 'f', 1)
+													.arg(fractalList[f].bailoutRatio * 100.0, 0, 'f', 0);
+			if (cFormulaBenchmark::IsExpensive(fractalList[f]))
+			{
+				toolTip = QObject::tr("Expensive formula: ") + toolTip;
+				ui->comboBox_formula->setItemData(
+					ui->comboBox_formula->count() - 1, QColor(Qt::darkRed), Qt::ForegroundRole);
+			}
+			ui->comboBox_formula->setItemData(
+				ui->comboBox_formula->count() - 1, toolTip, Qt::ToolTipRole);
+		}
 	}
 
 	// set headings and separator of formulas and transforms
@@ -144,105 +162,127 @@ void cTabFractal::Init(bool firstTab, int _tabIndex)
 
 void cTabFractal::slotChangedComboFractal(int indexInComboBox)
 {
-	QString comboName = this->sender()->objectName();
 	int index = qobject_cast<QComboBox *>(this->sender())->itemData(indexInComboBox).toInt();
 
 	QString fullFormulaName = fractalList[index].nameInComboBox;
 	if (fractalList[index].internalID > 0)
 	{
-		QString formulaName = fractalList[index].internalName;
-		QString uiFilename =
-			systemData.sharedDir + "qt_data" + QDir::separator() + "fractal_" + formulaName + ".ui";
-
 		if (fractalWidget) delete fractalWidget;
 		fractalWidget = NULL;
 
-		MyUiLoader loader;
-		QFile uiFile(uiFilename);
+		// formula widget of hidden tab is created when the tab is shown for the first time
+		if (isVisible())
+			LoadFormulaWidget(index);
+		else
+			pendingFractalIndex = index;
 
-		if (uiFile.exists())
+		switch (fractalList[index].cpixelAddition)
 		{
-			uiFile.open(QFile::ReadOnly);
-			fractalWidget = loader.load(&uiFile);
-			QVBoxLayout *layout = ui->verticalLayout_fractal;
-			layout->addWidget(fractalWidget);
-			uiFile.close();
-			fractalWidget->show();
-			automatedWidgets->ConnectSignalsForSlidersInWindow(fractalWidget);
-			SynchronizeInterfaceWindow(fractalWidget, &gParFractal->at(tabIndex), qInterface::write);
-
-			switch (fractalList[index].cpixelAddition)
+			case fractal::cpixelEnabledByDefault:
+				ui->checkBox_dont_add_c_constant->setText(QObject::tr("Don't add global C constant"));
+				ui->checkBox_dont_add_c_constant->setEnabled(true);
+				break;
+
+			case fractal::cpixelDisabledByDefault:
 			{
-				case fractal::cpixelEnabledByDefault:
-					ui->checkBox_dont_add_c_constant->setText(QObject::tr("Don't add global C constant"));
-					ui->checkBox_dont_add_c_constant->setEnabled(true);
-					break;
-
-				case fractal::cpixelDisabledByDefault:
-				{
-					ui->checkBox_dont_add_c_constant->setText(QObject::tr("Add global C constant"));
-					ui->checkBox_dont_add_c_constant->setEnabled(true);
-					break;
-				}
-
-				case fractal::cpixelAlreadyHas:
-				{
-					ui->checkBox_dont_add_c_constant->setText(QObject::tr("Don't add global C constant"));
-					ui->checkBox_dont_add_c_constant->setEnabled(false);
-					break;
-				}
-			};
-
-			fractal::enumCPixelAddition cPixelAddition = fractalList[index].cpixelAddition;
-			bool booleanState =
-				gMainInterface->mainWindow->GetWidgetDockFractal()->AreBooleanFractalsEnabled();
-
-			if (cPixelAddition == fractal::cpixelAlreadyHas)
-				CConstantAdditionSetVisible(false);
-			else
-				CConstantAdditionSetVisible(booleanState);
+				ui->checkBox_dont_add_c_constant->setText(QObject::tr("Add global C constant"));
+				ui->checkBox_dont_add_c_constant->setEnabled(true);
+				break;
+			}
 
-			if (fractalList[index].internalID == fractal::kaleidoscopicIFS)
+			case fractal::cpixelAlreadyHas:
 			{
-				QWidget *pushButton_preset_dodecahedron =
-					fractalWidget->findChild<QWidget *>("pushButton_preset_dodecahedron");
-				QApplication::connect(pushButton_preset_dodecahedron, SIGNAL(clicked()), this,
-					SLOT(slotPressedButtonIFSDefaultsDodecahedron()));
-				QWidget *pushButton_preset_icosahedron =
-					fractalWidget->findChild<QWidget *>("pushButton_preset_icosahedron");
-				QApplication::connect(pushButton_preset_icosahedron, SIGNAL(clicked()), this,
-					SLOT(slotPressedButtonIFSDefaultsIcosahedron()));
-				QWidget *pushButton_preset_octahedron =
-					fractalWidget->findChild<QWidget *>("pushButton_preset_octahedron");
-				QApplication::connect(pushButton_preset_octahedron, SIGNAL(clicked()), this,
-					SLOT(slotPressedButtonIFSDefaultsOctahedron()));
-				QWidget *pushButton_preset_menger_sponge =
-					fractalWidget->findChild<QWidget *>("pushButton_preset_menger_sponge");
-				QApplication::connect(pushButton_preset_menger_sponge, SIGNAL(clicked()), this,
-					SLOT(slotPressedButtonIFSDefaultsMengerSponge()));
-				QWidget *pushButton_preset_reset =
-					fractalWidget->findChild<QWidget *>("pushButton_preset_reset");
-				QApplication::connect(pushButton_preset_reset, SIGNAL(clicked()), this,
-					SLOT(slotPressedButtonIFSDefaultsReset()));
+				ui->checkBox_dont_add_c_constant->setText(QObject::tr("Don't add global C constant"));
+				ui->checkBox_dont_add_c_constant->setEnabled(false);
+				break;
 			}
-		}
+		};
+
+		fractal::enumCPixelAddition cPixelAddition = fractalList[index].cpixelAddition;
+		bool booleanState =
+			gMainInterface->mainWindow->GetWidgetDockFractal()->AreBooleanFractalsEnabled();
+
+		if (cPixelAddition == fractal::cpixelAlreadyHas)
+			CConstantAdditionSetVisible(false);
 		else
-		{
-			cErrorMessage::showMessage(
-				QString("Can't open file ") + uiFilename + QString("\nFractal ui file can't be loaded"),
-				cErrorMessage::errorMessage, gMainInterface->mainWindow);
-		}
+			CConstantAdditionSetVisible(booleanState);
 	}
 	else
 	{
 		if (fractalWidget) delete fractalWidget;
 		fractalWidget = NULL;
+		pendingFractalIndex = -1;
 	}
 
 	gMainInterface->mainWindow->GetWidgetDockFractal()->SetTabText(
 		tabIndex, QString("#%1: %2").arg(tabIndex + 1).arg(fullFormulaName));
 }
 
+void cTabFractal::LoadFormulaWidget(int index)
+{
+	pendingFractalIndex = -1;
+
+	QString formulaName = fractalList[index].internalName;
+	QString uiFilename =
+		systemData.sharedDir + "qt_data" + QDir::separator() + "fractal_" + formulaName + ".ui";
+
+	MyUiLoader loader;
+	QFile uiFile(uiFilename);
+
+	if (uiFile.exists())
+	{
+		uiFile.open(QFile::ReadOnly);
+		fractalWidget = loader.load(&uiFile);
+		QVBoxLayout *layout = ui->verticalLayout_fractal;
+		layout->addWidget(fractalWidget);
+		uiFile.close();
+		fractalWidget->show();
+		automatedWidgets->ConnectSignalsForSlidersInWindow(fractalWidget);
+		SynchronizeInterfaceWindow(fractalWidget, &gParFractal->at(tabIndex), qInterface::write);
+
+		if (fractalList[index].internalID == fractal::kaleidoscopicIFS)
+		{
+			QWidget *pushButton_preset_dodecahedron =
+				fractalWidget->findChild<QWidget *>("pushButton_preset_dodecahedron");
+			QApplication::connect(pushButton_preset_dodecahedron, SIGNAL(clicked()), this,
+				SLOT(slotPressedButtonIFSDefaultsDodecahedron()));
+			QWidget *pushButton_preset_icosahedron =
+				fractalWidget->findChild<QWidget *>("pushButton_preset_icosahedron");
+			QApplication::connect(pushButton_preset_icosahedron, SIGNAL(clicked()), this,
+				SLOT(slotPressedButtonIFSDefaultsIcosahedron()));
+			QWidget *pushButton_preset_octahedron =
+				fractalWidget->findChild<QWidget *>("pushButton_preset_octahedron");
+			QApplication::connect(pushButton_preset_octahedron, SIGNAL(clicked()), this,
+				SLOT(slotPressedButtonIFSDefaultsOctahedron()));
+			QWidget *pushButton_preset_menger_sponge =
+				fractalWidget->findChild<QWidget *>("pushButton_preset_menger_sponge");
+			QApplication::connect(pushButton_preset_menger_sponge, SIGNAL(clicked()), this,
+				SLOT(slotPressedButtonIFSDefaultsMengerSponge()));
+			QWidget *pushButton_preset_reset =
+				fractalWidget->findChild<QWidget *>("pushButton_preset_reset");
+			QApplication::connect(pushButton_preset_reset, SIGNAL(clicked()), this,
+				SLOT(slotPressedButtonIFSDefaultsReset()));
+		}
+	}
+	else
+	{
+		cErrorMessage::showMessage(
+			QString("Can't open file ") + uiFilename + QString("\nFractal ui file can't be loaded"),
+			cErrorMessage::errorMessage, gMainInterface->mainWindow);
+	}
+}
+
+void cTabFractal::CreatePendingFormulaWidget()
+{
+	if (pendingFractalIndex >= 0) LoadFormulaWidget(pendingFractalIndex);
+}
+
+void cTabFractal::showEvent(QShowEvent *event)
+{
+	CreatePendingFormulaWidget();
+	QWidget::showEvent(event);
+}
+
 void cTabFractal::FormulaTransformSetVisible(bool visible)
 {
 	ui->groupBox_formula_transform->setVisible(visible);
@@ -304,6 +344,7 @@ void cTabFractal::FrameIterationFormulaSetEnabled(bool enabled)
 
 void cTabFractal::SynchronizeFractal(cParameterContainer *fractal, qInterface::enumReadWrite mode)
 {
+	// parameters of formula which widget wasn't created yet stay in the container
 	SynchronizeInterfaceWindow(fractalWidget, fractal, mode);
 }
 
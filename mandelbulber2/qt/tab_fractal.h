@@ -33,6 +33,7 @@
  * tab_fractal.ui is the layout ui for the outer ui.
  * The formula specific ui is loaded dynamically in slotChangedComboFractal()
  * and reads the corresponding ui from qt_data/fractal_<FORMULA_NAME>.ui
+ * Formula ui of hidden tab is loaded when the tab is shown for the first time
  */
 
 #ifndef MANDELBULBER2_QT_TAB_FRACTAL_H_
@@ -68,6 +69,11 @@ public:
 	int GetCurrentFractalIndexOnList();
 	void SynchronizeInterface(cParameterContainer *par, qInterface::enumReadWrite mode);
 	void SynchronizeFractal(cParameterContainer *fractal, qInterface::enumReadWrite mode);
+	// formula widget which is waiting for the first show of the tab is created immediately
+	void CreatePendingFormulaWidget();
+
+protected:
+	virtual void showEvent(QShowEvent *event);
 
 private slots:
 	void slotChangedComboFractal(int indexInComboBox);
@@ -82,11 +88,13 @@ private slots:
 
 private:
 	void ConnectSignals();
+	void LoadFormulaWidget(int index);
 
 	Ui::cTabFractal *ui;
 
 	int tabIndex;
 	QWidget *fractalWidget;
+	int pendingFractalIndex; // formula which widget will be created on show (-1 if none)
 
 	cAutomatedWidgets *automatedWidgets;
 };
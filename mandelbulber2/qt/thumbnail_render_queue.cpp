@@ -0,0 +1,101 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cThumbnailRenderQueue - prioritized rendering of thumbnail widgets
+ */
+
+#include "thumbnail_render_queue.h"
+
+#include <QTimer>
+
+#include "thumbnail_widget.h"
+#include "../src/system.hpp"
+
+cThumbnailRenderQueue::cThumbnailRenderQueue() : QObject()
+{
+	// every thumbnail job uses its own threads, so only few of them are rendered together
+	maxRendering = qMax(1, systemData.numberOfThreads / 2);
+}
+
+cThumbnailRenderQueue *cThumbnailRenderQueue::Instance()
+{
+	static cThumbnailRenderQueue queue;
+	return &queue;
+}
+
+void cThumbnailRenderQueue::Request(cThumbnailWidget *widget, bool visible)
+{
+	if (renderingWidgets.contains(widget)) return;
+
+	if (visible)
+	{
+		// the most recently painted widget goes first
+		backgroundQueue.removeAll(widget);
+		visibleQueue.removeAll(widget);
+		visibleQueue.prepend(widget);
+	}
+	else if (!visibleQueue.contains(widget) && !backgroundQueue.contains(widget))
+	{
+		backgroundQueue.append(widget);
+	}
+
+	// widgets are started from event loop, so many requests are sorted before rendering starts
+	QTimer::singleShot(0, this, SLOT(slotStartNext()));
+}
+
+void cThumbnailRenderQueue::Remove(cThumbnailWidget *widget)
+{
+	visibleQueue.removeAll(widget);
+	backgroundQueue.removeAll(widget);
+	Finished(widget);
+}
+
+void cThumbnailRenderQueue::Finished(cThumbnailWidget *widget)
+{
+	if (renderingWidgets.remove(widget)) QTimer::singleShot(0, this, SLOT(slotStartNext()));
+}
+
+void cThumbnailRenderQueue::slotStartNext()
+{
+	while (renderingWidgets.size() < maxRendering)
+	{
+		cThumbnailWidget *widget;
+		if (!visibleQueue.isEmpty())
+			widget = visibleQueue.takeFirst();
+		else if (!backgroundQueue.isEmpty())
+			widget = backgroundQueue.takeFirst();
+		else
+			break;
+
+		renderingWidgets.insert(widget);
+		widget->slotRender();
+	}
+}
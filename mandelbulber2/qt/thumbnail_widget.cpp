@@ -33,14 +33,19 @@
  *
  * This class holds an cImage and fractal settings can be assigned with AssignParameters().
  * The class then asynchroniously renders the fractal as a thumbnail and displays it.
- * The fractal thumbnails can also be cached in filesystem for faster loading.
+ * The fractal thumbnails can also be cached in filesystem for faster loading and recently
+ * used ones in memory. Rendering is scheduled by cThumbnailRenderQueue.
  * Signals for progress and render finish can be connected, see also usage in PreviewFileDialog.
  */
 
 #include "thumbnail_widget.h"
 
+#include <QFile>
 #include <QImage>
 #include <QPaintEvent>
+#include <QThread>
+
+#include "thumbnail_render_queue.h"
 
 #include "../src/cimage.hpp"
 #include "../src/global_data.hpp"
@@ -50,6 +55,26 @@
 #include "../src/rendering_configuration.hpp"
 #include "../src/common_math.h"
 #include "../src/system.hpp"
+#include "../src/thumbnail.hpp"
+#include "../src/thumbnail_cache.hpp"
+#include "../src/thumbnail_store.hpp"
+
+cThumbnailImageLoader::cThumbnailImageLoader(const QString &_fileName, int _width, int _height)
+		: QObject(), fileName(_fileName), width(_width), height(_height)
+{
+}
+
+void cThumbnailImageLoader::slotLoad()
+{
+	QImage image(fileName);
+	if (!image.isNull())
+	{
+		image = image.scaled(width, height, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		image = image.convertToFormat(QImage::Format_RGB888);
+	}
+	emit loaded(image);
+	emit finished();
+}
 
 cThumbnailWidget::cThumbnailWidget(QWidget *parent) : QWidget(parent)
 {
@@ -75,15 +100,10 @@ void cThumbnailWidget::Init(QWidget *parent)
 	hasParameters = false;
 	disableTimer = false;
 	disableThumbnailCache = false;
-	connect(this, SIGNAL(renderRequest()), this, SLOT(slotRender()));
 	params = new cParameterContainer;
 	fractal = new cFractalContainer;
 	useOneCPUCore = false;
 
-	timer = new QTimer(parent);
-	timer->setSingleShot(true);
-	connect(timer, SIGNAL(timeout()), this, SLOT(slotRandomRender()));
-
 	lastRenderTime = 0.0;
 
 	instanceIndex = instanceCount;
@@ -104,6 +124,7 @@ void cThumbnailWidget::SetSize(int _width, int _height, int _oversample)
 
 cThumbnailWidget::~cThumbnailWidget()
 {
+	cThumbnailRenderQueue::Instance()->Remove(this);
 	stopRequest = true;
 	if (image)
 	{
@@ -126,15 +147,8 @@ void cThumbnailWidget::paintEvent(QPaintEvent *event)
 	if (image)
 	{
 		event->accept();
-		if (hasParameters)
-		{
-			if (!isRendered)
-			{
-				isRendered = true;
-				timer->stop();
-				emit renderRequest();
-			}
-		}
+		// painted widget is visible, so it gets the highest priority
+		if (hasParameters && !isRendered) cThumbnailRenderQueue::Instance()->Request(this, true);
 		image->RedrawInWidget(this);
 	}
 }
@@ -148,13 +162,9 @@ void cThumbnailWidget::AssignParameters(
 		if (!fractal) fractal = new cFractalContainer;
 		*params = _params;
 		*fractal = _fractal;
-		params->Set("image_width", tWidth * oversample);
-		params->Set("image_height", tHeight * oversample);
-		params->Set("stereo_mode", (int)cStereo::stereoRedCyan);
-		cSettings tempSettings(cSettings::formatCondensedText);
-		tempSettings.CreateText(params, fractal);
+		PrepareParameters(params, tWidth, tHeight, oversample);
 		oldHash = hash;
-		hash = tempSettings.GetHashCode();
+		hash = cSettings::StructuralHash(params, fractal);
 
 		if (hash != oldHash)
 		{
@@ -167,45 +177,41 @@ void cThumbnailWidget::AssignParameters(
 			emit settingsChanged();
 
 			isRendered = false;
+			sourceImageFile.clear();
 			hasParameters = true;
 
-			QString thumbnailFileName = GetThumbnailFileName();
-			if (QFileInfo::exists(thumbnailFileName) && !disableThumbnailCache)
+			QString cacheKey = cThumbnailCache::Key(hash, tWidth, tHeight);
+			QImage qimage;
+			bool cached = false;
+			if (!disableThumbnailCache)
 			{
+				// recently used thumbnails are already decoded in memory
+				cached = cThumbnailCache::Find(cacheKey, &qimage);
+				if (!cached && LoadStoredThumbnail(hash, params, fractal, tWidth, tHeight, &qimage))
+				{
+					cThumbnailCache::Insert(cacheKey, qimage);
+					cached = true;
+				}
+			}
+
+			if (cached)
+			{
+				cThumbnailRenderQueue::Instance()->Remove(this);
 				stopRequest = true;
 				isRendered = true;
 				while (image->IsUsed())
 				{
 					// just wait and pray
 				}
-
-				QPixmap pixmap;
-				pixmap.load(thumbnailFileName);
-				pixmap = pixmap.scaled(tWidth, tHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-				QImage qimage = pixmap.toImage();
-				qimage = qimage.convertToFormat(QImage::Format_RGB888);
-				sRGB8 *bitmap;
-				bitmap = (sRGB8 *)(qimage.bits());
-				int bwidth = qimage.width();
-				int bheight = qimage.height();
-				sRGB8 *previewPointer = (sRGB8 *)image->GetPreviewPrimaryPtr();
-				sRGB8 *preview2Pointer = (sRGB8 *)image->GetPreviewPtr();
-				memcpy(previewPointer, bitmap, sizeof(sRGB8) * bwidth * bheight);
-				memcpy(preview2Pointer, bitmap, sizeof(sRGB8) * bwidth * bheight);
-				delete params;
-				params = NULL;
-				delete fractal;
-				fractal = NULL;
-				emit thumbnailRendered();
+				ShowImage(qimage);
 			}
 			else
 			{
 				if (!disableTimer)
 				{
-					// render thumbnail after random time. It forces rendering of widgets when they are not
-					// visible. It makes rendering of widgets when they are idle.
-
-					timer->start(Random(100000) * 10 + 1);
+					// widgets which are not visible are rendered in background when there is nothing more
+					// important to render
+					cThumbnailRenderQueue::Instance()->Request(this, false);
 				}
 			}
 		}
@@ -216,19 +222,79 @@ void cThumbnailWidget::AssignParameters(
 	}
 }
 
+void cThumbnailWidget::PrepareParameters(
+	cParameterContainer *params, int width, int height, int oversample)
+{
+	params->Set("image_width", width * oversample);
+	params->Set("image_height", height * oversample);
+	params->Set("stereo_mode", (int)cStereo::stereoRedCyan);
+}
+
+void cThumbnailWidget::ShowImage(const QImage &qimage)
+{
+	sRGB8 *bitmap;
+	bitmap = (sRGB8 *)(qimage.bits());
+	int bwidth = qimage.width();
+	int bheight = qimage.height();
+	sRGB8 *previewPointer = (sRGB8 *)image->GetPreviewPrimaryPtr();
+	sRGB8 *preview2Pointer = (sRGB8 *)image->GetPreviewPtr();
+	memcpy(previewPointer, bitmap, sizeof(sRGB8) * bwidth * bheight);
+	memcpy(preview2Pointer, bitmap, sizeof(sRGB8) * bwidth * bheight);
+	delete params;
+	params = NULL;
+	delete fractal;
+	fractal = NULL;
+	emit thumbnailRendered();
+}
+
+bool cThumbnailWidget::LoadStoredThumbnail(const QString &hash, const cParameterContainer *params,
+	const cFractalContainer *fractal, int width, int height, QImage *image)
+{
+	if (!cThumbnail::FindStored(hash, params, fractal, image)) return false;
+	*image = image->scaled(width, height, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	*image = image->convertToFormat(QImage::Format_RGB888);
+	return true;
+}
+
+bool cThumbnailWidget::PreloadStoredThumbnail(const cParameterContainer &_params,
+	const cFractalContainer &fractal, int width, int height, int oversample)
+{
+	cParameterContainer params = _params;
+	PrepareParameters(&params, width, height, oversample);
+	QString hash = cSettings::StructuralHash(&params, &fractal);
+	QString cacheKey = cThumbnailCache::Key(hash, width, height);
+
+	QImage image;
+	if (cThumbnailCache::Find(cacheKey, &image)) return true;
+	if (!LoadStoredThumbnail(hash, &params, &fractal, width, height, &image)) return false;
+	cThumbnailCache::Insert(cacheKey, image);
+	return true;
+}
+
 void cThumbnailWidget::slotRender()
 {
+	if (!params || !fractal)
+	{
+		// thumbnail was already rendered or loaded from cache
+		cThumbnailRenderQueue::Instance()->Finished(this);
+		return;
+	}
+
+	if (!sourceImageFile.isEmpty() && QFile::exists(sourceImageFile))
+	{
+		LoadSourceImage();
+		return;
+	}
+
 	if (image)
 	{
+		isRendered = true;
 		stopRequest = true;
 		while (image->IsUsed())
 		{
 			// just wait and pray
 			Wait(100);
 		}
-
-		// random wait to not generate to many events at exactly the same time
-		Wait(Random(100) + 50);
 		stopRequest = false;
 
 		cRenderJob *renderJob = new cRenderJob(params, fractal, image, &stopRequest, (QWidget *)this);
@@ -249,14 +315,12 @@ void cThumbnailWidget::slotRender()
 		renderJob->moveToThread(thread);
 		QObject::connect(thread, SIGNAL(started()), renderJob, SLOT(slotExecute()));
 
-		while (renderJob->GetRunningJobCount() > systemData.numberOfThreads * 5)
-		{
-		}
 		thread->setObjectName("ThumbnailWorker");
 		thread->start();
 
 		QObject::connect(renderJob, SIGNAL(finished()), renderJob, SLOT(deleteLater()));
 		QObject::connect(renderJob, SIGNAL(finished()), thread, SLOT(quit()));
+		QObject::connect(renderJob, SIGNAL(finished()), this, SLOT(slotRenderFinished()));
 		QObject::connect(renderJob, SIGNAL(fullyRendered(const QString &, const QString &)), this,
 			SLOT(slotFullyRendered()));
 		QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
@@ -267,6 +331,50 @@ void cThumbnailWidget::slotRender()
 	}
 }
 
+void cThumbnailWidget::LoadSourceImage()
+{
+	isRendered = true;
+	sourceImageHash = hash;
+	cThumbnailImageLoader *loader = new cThumbnailImageLoader(sourceImageFile, tWidth, tHeight);
+	// if the file cannot be loaded, the thumbnail will be rendered
+	sourceImageFile.clear();
+
+	QThread *thread = new QThread;
+	loader->moveToThread(thread);
+	QObject::connect(thread, SIGNAL(started()), loader, SLOT(slotLoad()));
+	QObject::connect(loader, SIGNAL(loaded(QImage)), this, SLOT(slotSourceImageLoaded(QImage)));
+	QObject::connect(loader, SIGNAL(finished()), loader, SLOT(deleteLater()));
+	QObject::connect(loader, SIGNAL(finished()), thread, SLOT(quit()));
+	QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+	thread->setObjectName("ThumbnailLoader");
+	thread->start();
+}
+
+void cThumbnailWidget::slotSourceImageLoaded(QImage qimage)
+{
+	cThumbnailRenderQueue::Instance()->Finished(this);
+
+	if (hash != sourceImageHash || !params || !fractal)
+	{
+		// parameters were changed during loading
+		if (params && fractal && !isRendered && !disableTimer)
+			cThumbnailRenderQueue::Instance()->Request(this, false);
+		return;
+	}
+
+	if (qimage.isNull())
+	{
+		isRendered = false;
+		cThumbnailRenderQueue::Instance()->Request(this, true);
+		return;
+	}
+
+	if (!disableThumbnailCache)
+		cThumbnailCache::Insert(cThumbnailCache::Key(hash, tWidth, tHeight), qimage);
+	ShowImage(qimage);
+	update();
+}
+
 void cThumbnailWidget::slotFullyRendered()
 {
 	isRendered = true;
@@ -274,11 +382,11 @@ void cThumbnailWidget::slotFullyRendered()
 	{
 		QImage qImage((const uchar *)image->ConvertTo8bit(), image->GetWidth(), image->GetHeight(),
 			image->GetWidth() * sizeof(sRGB8), QImage::Format_RGB888);
-		QPixmap pixmap;
-		pixmap.convertFromImage(qImage);
+		cThumbnailStore::Instance()->Insert(hash, qImage);
 
-		QString thumbnailFileName = GetThumbnailFileName();
-		pixmap.save(thumbnailFileName, "PNG");
+		QImage scaledImage =
+			qImage.scaled(tWidth, tHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		cThumbnailCache::Insert(cThumbnailCache::Key(hash, tWidth, tHeight), scaledImage);
 	}
 	lastRenderTime = renderingTimeTimer.nsecsElapsed() / 1e9;
 	delete params;
@@ -288,18 +396,9 @@ void cThumbnailWidget::slotFullyRendered()
 	emit thumbnailRendered();
 }
 
-void cThumbnailWidget::slotRandomRender()
+void cThumbnailWidget::slotRenderFinished()
 {
-	if (cRenderJob::GetRunningJobCount() > systemData.numberOfThreads)
-	{
-		// if it's to busy, render later
-		timer->start(Random(100000) * 10 + 1);
-	}
-	else
-	{
-		isRendered = true;
-		slotRender();
-	}
+	cThumbnailRenderQueue::Instance()->Finished(this);
 }
 
 void cThumbnailWidget::slotSetMinimumSize(int width, int height)
@@ -307,9 +406,4 @@ void cThumbnailWidget::slotSetMinimumSize(int width, int height)
 	setMinimumSize(width, height);
 }
 
-QString cThumbnailWidget::GetThumbnailFileName()
-{
-	return systemData.GetThumbnailsFolder() + QDir::separator() + hash + QString(".png");
-}
-
 int cThumbnailWidget::instanceCount = 0;
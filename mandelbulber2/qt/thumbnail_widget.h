@@ -35,11 +35,14 @@
  * The class then asynchroniously renders the fractal as a thumbnail and displays it.
  * The fractal thumbnails can also be cached in filesystem for faster loading.
  * Signals for progress and render finish can be connected, see also usage in PreviewFileDialog.
+ * When an image of the same scene was already rendered to disk (e.g. animation frame), it can be
+ * set with SetSourceImageFile(). It's then scaled down in background instead of rendering.
  */
 
 #ifndef MANDELBULBER2_QT_THUMBNAIL_WIDGET_H_
 #define MANDELBULBER2_QT_THUMBNAIL_WIDGET_H_
 
+#include <QImage>
 #include <QWidget>
 #include <qprogressbar.h>
 #include <QElapsedTimer>
@@ -49,6 +52,27 @@ class cParameterContainer;
 class cFractalContainer;
 class cImage;
 
+// loads and scales down source image of thumbnail in own thread
+class cThumbnailImageLoader : public QObject
+{
+	Q_OBJECT
+public:
+	cThumbnailImageLoader(const QString &_fileName, int _width, int _height);
+
+public slots:
+	void slotLoad();
+
+signals:
+	// image is null if the file cannot be loaded
+	void loaded(QImage image);
+	void finished();
+
+private:
+	QString fileName;
+	int width;
+	int height;
+};
+
 class cThumbnailWidget : public QWidget
 {
 	Q_OBJECT
@@ -60,20 +84,38 @@ public:
 	void SetSize(int _width, int _height, int _oversample);
 	void AssignParameters(const cParameterContainer &_params, const cFractalContainer &_fractal);
 	void UseOneCPUCore(bool onlyOne) { useOneCPUCore = onlyOne; }
+	// widget is not rendered in background when it's not visible
 	void DisableTimer() { disableTimer = true; }
 	void DisableThumbnailCache() { disableThumbnailCache = true; }
+	// image already rendered with the same parameters. Used if the file exists when thumbnail
+	// is about to be rendered. Has to be set after AssignParameters()
+	void SetSourceImageFile(const QString &fileName) { sourceImageFile = fileName; }
 	bool IsRendered() { return isRendered; }
-	QString GetThumbnailFileName();
+	QString GetHash() const { return hash; }
+
+	// parameters of thumbnail image (size and stereo mode)
+	static void PrepareParameters(cParameterContainer *params, int width, int height, int oversample);
+	// looks for stored thumbnail and puts it to memory cache, so AssignParameters() with the same
+	// parameters doesn't need to read it. Can be called from any thread
+	static bool PreloadStoredThumbnail(const cParameterContainer &params,
+		const cFractalContainer &fractal, int width, int height, int oversample);
 
 	static int instanceCount;
 	int instanceIndex;
 
 private:
 	void paintEvent(QPaintEvent *event);
+	// stored thumbnail scaled to size of widget
+	static bool LoadStoredThumbnail(const QString &hash, const cParameterContainer *params,
+		const cFractalContainer *fractal, int width, int height, QImage *image);
+	// copies image (not bigger than the widget) to the preview
+	void ShowImage(const QImage &qimage);
+	void LoadSourceImage();
 
 private slots:
 	void slotFullyRendered();
-	void slotRandomRender();
+	void slotRenderFinished();
+	void slotSourceImageLoaded(QImage qimage);
 
 public slots:
 	void slotSetMinimumSize(int width, int height);
@@ -88,6 +130,8 @@ private:
 	int oversample;
 	QString hash;
 	QString oldHash;
+	QString sourceImageFile;
+	QString sourceImageHash; // hash of parameters when loading of source image was started
 	QProgressBar *progressBar;
 	bool stopRequest;
 	bool isRendered;
@@ -95,15 +139,12 @@ private:
 	bool useOneCPUCore;
 	bool disableTimer;
 	bool disableThumbnailCache;
-	// timer for random trigger for rendering (renders thumbnail even when is not visible)
-	QTimer *timer;
 	QElapsedTimer renderingTimeTimer;
 
 protected:
 	double lastRenderTime;
 
 signals:
-	void renderRequest();
 	void thumbnailRendered();
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
 	void settingsChanged();
@@ -0,0 +1,518 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAdaptiveMesh - adaptive octree mesh extraction with dual contouring
+ */
+
+#include "adaptive_mesh.hpp"
+
+#include <cmath>
+
+// cells are never merged to leaves bigger than 2^ADAPTIVE_MESH_LEAF_LEVELS of the finest cells
+#define ADAPTIVE_MESH_LEAF_LEVELS 4
+// minimum cosine of angle between normals in a cell which can be represented by one vertex
+#define ADAPTIVE_MESH_MIN_NORMAL_DOT 0.9
+
+// child index is x * 4 + y * 2 + z. The same numbering is used for corners
+static const int edgevmap[12][2] = {{0, 4}, {1, 5}, {2, 6}, {3, 7}, {0, 2}, {1, 3}, {4, 6},
+	{5, 7}, {0, 1}, {2, 3}, {4, 5}, {6, 7}};
+
+static const int cellProcFaceMask[12][3] = {{0, 4, 0}, {1, 5, 0}, {2, 6, 0}, {3, 7, 0},
+	{0, 2, 1}, {4, 6, 1}, {1, 3, 1}, {5, 7, 1}, {0, 1, 2}, {2, 3, 2}, {4, 5, 2}, {6, 7, 2}};
+
+static const int cellProcEdgeMask[6][5] = {
+	{0, 1, 2, 3, 0}, {4, 5, 6, 7, 0}, {0, 4, 1, 5, 1}, {2, 6, 3, 7, 1}, {0, 2, 4, 6, 2},
+	{1, 3, 5, 7, 2}};
+
+static const int faceProcFaceMask[3][4][3] = {{{4, 0, 0}, {5, 1, 0}, {6, 2, 0}, {7, 3, 0}},
+	{{2, 0, 1}, {6, 4, 1}, {3, 1, 1}, {7, 5, 1}}, {{1, 0, 2}, {3, 2, 2}, {5, 4, 2}, {7, 6, 2}}};
+
+static const int faceProcEdgeMask[3][4][6] = {
+	{{1, 4, 0, 5, 1, 1}, {1, 6, 2, 7, 3, 1}, {0, 4, 6, 0, 2, 2}, {0, 5, 7, 1, 3, 2}},
+	{{0, 2, 3, 0, 1, 0}, {0, 6, 7, 4, 5, 0}, {1, 2, 0, 6, 4, 2}, {1, 3, 1, 7, 5, 2}},
+	{{1, 1, 0, 3, 2, 0}, {1, 5, 4, 7, 6, 0}, {0, 1, 5, 0, 4, 1}, {0, 3, 7, 2, 6, 1}}};
+
+static const int faceProcEdgeOrder[2][4] = {{0, 0, 1, 1}, {0, 1, 0, 1}};
+
+static const int edgeProcEdgeMask[3][2][5] = {{{3, 2, 1, 0, 0}, {7, 6, 5, 4, 0}},
+	{{5, 1, 4, 0, 1}, {7, 3, 6, 2, 1}}, {{6, 4, 2, 0, 2}, {7, 5, 3, 1, 2}}};
+
+static const int processEdgeMask[3][4] = {{3, 2, 1, 0}, {7, 5, 6, 4}, {11, 10, 9, 8}};
+
+cAdaptiveMesh::cAdaptiveMesh(CVector3 lower, double cellSize, int maxDepth, double isovalue,
+	double safetyFactor, double tolerance)
+{
+	this->lower = lower;
+	this->cellSize = cellSize;
+	this->maxDepth = maxDepth;
+	this->isovalue = isovalue;
+	this->safetyFactor = safetyFactor;
+	this->tolerance = tolerance;
+	currentDepth = 0;
+	minLeafDepth = qMax(0, maxDepth - ADAPTIVE_MESH_LEAF_LEVELS);
+
+	nodes.append(sNode());
+	currentLevel.append(0);
+}
+
+qint64 cAdaptiveMesh::CornerKey(const sNode &node, int corner) const
+{
+	qint64 size = qint64(1) << (maxDepth - node.depth);
+	qint64 gridSize = (qint64(1) << maxDepth) + 1;
+	qint64 x = node.x + ((corner >> 2) & 1) * size;
+	qint64 y = node.y + ((corner >> 1) & 1) * size;
+	qint64 z = node.z + (corner & 1) * size;
+	return (x * gridSize + y) * gridSize + z;
+}
+
+CVector3 cAdaptiveMesh::CornerPosition(const sNode &node, int corner) const
+{
+	int size = 1 << (maxDepth - node.depth);
+	CVector3 position(node.x + ((corner >> 2) & 1) * size, node.y + ((corner >> 1) & 1) * size,
+		node.z + (corner & 1) * size);
+	return lower + position * cellSize;
+}
+
+bool cAdaptiveMesh::BuildNextLevel(cField *field)
+{
+	if (currentLevel.isEmpty()) return false;
+
+	double nodeSize = cellSize * (1 << (maxDepth - currentDepth));
+	double halfDiagonal = 0.5 * sqrt(3.0) * nodeSize;
+
+	// nodes far from the surface are rejected by distance estimated in their centres
+	int count = currentLevel.size();
+	QVector<CVector3> centres(count);
+	QVector<double> centreValues(count);
+	for (int i = 0; i < count; i++)
+	{
+		centres[i] = CornerPosition(nodes[currentLevel[i]], 0) + CVector3(0.5, 0.5, 0.5) * nodeSize;
+	}
+	field->Evaluate(centres.data(), count, centreValues.data(), NULL);
+
+	QVector<int> nearSurface;
+	for (int i = 0; i < count; i++)
+	{
+		// rejected nodes stay as empty leaves
+		if (centreValues[i] * safetyFactor - halfDiagonal <= isovalue)
+			nearSurface.append(currentLevel[i]);
+	}
+	currentLevel = nearSurface;
+
+	EvaluateCorners(field);
+
+	QVector<int> nextLevel;
+	for (int i = 0; i < currentLevel.size(); i++)
+	{
+		int nodeIndex = currentLevel[i];
+		if (ProcessNode(nodeIndex)) continue;
+
+		// subdivision
+		sNode parent = nodes[nodeIndex];
+		int firstChild = nodes.size();
+		nodes[nodeIndex].firstChild = firstChild;
+		int half = 1 << (maxDepth - parent.depth - 1);
+		for (int c = 0; c < 8; c++)
+		{
+			sNode child;
+			child.depth = parent.depth + 1;
+			child.x = parent.x + ((c >> 2) & 1) * half;
+			child.y = parent.y + ((c >> 1) & 1) * half;
+			child.z = parent.z + (c & 1) * half;
+			nodes.append(child);
+			nextLevel.append(firstChild + c);
+		}
+	}
+	currentLevel = nextLevel;
+	currentDepth++;
+
+	return !currentLevel.isEmpty();
+}
+
+void cAdaptiveMesh::EvaluateCorners(cField *field)
+{
+	// corners are shared between neighbouring nodes and levels, so every one is calculated once
+	QVector<qint64> keys;
+	QVector<CVector3> positions;
+	for (int i = 0; i < currentLevel.size(); i++)
+	{
+		const sNode &node = nodes[currentLevel[i]];
+		for (int c = 0; c < 8; c++)
+		{
+			qint64 key = CornerKey(node, c);
+			if (!corners.contains(key))
+			{
+				corners.insert(key, sCorner());
+				keys.append(key);
+				positions.append(CornerPosition(node, c));
+			}
+		}
+	}
+
+	// normals are calculated as gradients of distance estimation
+	double delta = 0.5 * cellSize;
+	const CVector3 offsets[6] = {CVector3(delta, 0.0, 0.0), CVector3(-delta, 0.0, 0.0),
+		CVector3(0.0, delta, 0.0), CVector3(0.0, -delta, 0.0), CVector3(0.0, 0.0, delta),
+		CVector3(0.0, 0.0, -delta)};
+
+	// corners are calculated in chunks to limit memory usage
+	const int chunkSize = 65536;
+	for (int first = 0; first < keys.size(); first += chunkSize)
+	{
+		int count = qMin(chunkSize, keys.size() - first);
+		QVector<double> values(count);
+		QVector<double> colors(count);
+		field->Evaluate(positions.data() + first, count, values.data(), colors.data());
+
+		QVector<CVector3> gradientPoints(count * 6);
+		QVector<double> gradientValues(count * 6);
+		for (int i = 0; i < count; i++)
+		{
+			for (int k = 0; k < 6; k++)
+				gradientPoints[i * 6 + k] = positions[first + i] + offsets[k];
+		}
+		field->Evaluate(gradientPoints.data(), count * 6, gradientValues.data(), NULL);
+
+		for (int i = 0; i < count; i++)
+		{
+			const double *g = gradientValues.data() + i * 6;
+			CVector3 normal(g[0] - g[1], g[2] - g[3], g[4] - g[5]);
+			double length = normal.Length();
+			if (length > 0.0) normal /= length;
+
+			sCorner &corner = corners[keys[first + i]];
+			corner.value = values[i];
+			corner.colorIndex = colors[i];
+			corner.normal = normal;
+		}
+	}
+}
+
+bool cAdaptiveMesh::ProcessNode(int nodeIndex)
+{
+	sNode &node = nodes[nodeIndex];
+
+	sCorner cornerSamples[8];
+	unsigned char signs = 0;
+	for (int c = 0; c < 8; c++)
+	{
+		cornerSamples[c] = corners.value(CornerKey(node, c));
+		if (cornerSamples[c].value <= isovalue) signs |= 1 << c;
+	}
+	node.signs = signs;
+
+	bool finest = node.depth >= maxDepth;
+	if (signs == 0 || signs == 255)
+	{
+		// cells without sign change are refined to find thin parts of the surface. Only interior
+		// is not refined to the finest level
+		return finest || (signs == 255 && node.depth >= minLeafDepth);
+	}
+	if (!finest && node.depth < minLeafDepth) return false;
+
+	// intersections of the surface with edges of the cell
+	CVector3 points[12];
+	CVector3 normals[12];
+	CVector3 massPoint;
+	double colorIndex = 0.0;
+	int count = 0;
+	for (int e = 0; e < 12; e++)
+	{
+		int c1 = edgevmap[e][0];
+		int c2 = edgevmap[e][1];
+		if (((signs >> c1) & 1) == ((signs >> c2) & 1)) continue;
+
+		const sCorner &s1 = cornerSamples[c1];
+		const sCorner &s2 = cornerSamples[c2];
+		double t = (isovalue - s1.value) / (s2.value - s1.value);
+		t = qBound(0.0, t, 1.0);
+
+		CVector3 p1 = CornerPosition(node, c1);
+		CVector3 p2 = CornerPosition(node, c2);
+		points[count] = p1 + (p2 - p1) * t;
+		CVector3 normal = s1.normal + (s2.normal - s1.normal) * t;
+		double length = normal.Length();
+		if (length > 0.0) normal /= length;
+		normals[count] = normal;
+		massPoint += points[count];
+		colorIndex += s1.colorIndex + (s2.colorIndex - s1.colorIndex) * t;
+		count++;
+	}
+	massPoint /= count;
+	colorIndex /= count;
+
+	double error;
+	CVector3 vertex = SolveQEF(points, normals, count, massPoint, &error);
+
+	CVector3 meanNormal;
+	for (int i = 0; i < count; i++)
+		meanNormal += normals[i];
+	double meanLength = meanNormal.Length();
+	if (meanLength > 0.0) meanNormal /= meanLength;
+
+	if (!finest)
+	{
+		// bigger cell is used only if the surface inside is flat enough
+		if (sqrt(error / count) > tolerance * cellSize) return false;
+
+		if (meanLength == 0.0) return false;
+		for (int i = 0; i < count; i++)
+		{
+			if (normals[i].Dot(meanNormal) < ADAPTIVE_MESH_MIN_NORMAL_DOT) return false;
+		}
+	}
+
+	// vertex has to stay inside the cell
+	CVector3 cellMin = CornerPosition(node, 0);
+	CVector3 cellMax = CornerPosition(node, 7);
+	if (vertex.x < cellMin.x || vertex.y < cellMin.y || vertex.z < cellMin.z
+			|| vertex.x > cellMax.x || vertex.y > cellMax.y || vertex.z > cellMax.z)
+	{
+		vertex = massPoint;
+	}
+
+	node.vertex = vertices.size();
+	vertices.append(vertex);
+	colorIndices.append(colorIndex);
+	vertexNormals.append(meanNormal);
+	return true;
+}
+
+CVector3 cAdaptiveMesh::SolveQEF(const CVector3 *points, const CVector3 *normals, int count,
+	CVector3 massPoint, double *error) const
+{
+	// normal equations of planes relative to the mass point
+	double ata[3][3] = {{0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+	double atb[3] = {0.0, 0.0, 0.0};
+	for (int i = 0; i < count; i++)
+	{
+		double n[3] = {normals[i].x, normals[i].y, normals[i].z};
+		double d = normals[i].Dot(points[i] - massPoint);
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+				ata[r][c] += n[r] * n[c];
+			atb[r] += n[r] * d;
+		}
+	}
+
+	// eigenvectors of symmetric matrix by Jacobi rotations
+	double v[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+	for (int sweep = 0; sweep < 10; sweep++)
+	{
+		for (int p = 0; p < 2; p++)
+		{
+			for (int q = p + 1; q < 3; q++)
+			{
+				if (fabs(ata[p][q]) < 1e-15) continue;
+				double theta = (ata[q][q] - ata[p][p]) / (2.0 * ata[p][q]);
+				double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0);
+				double s = t * c;
+				for (int k = 0; k < 3; k++)
+				{
+					double akp = ata[k][p];
+					double akq = ata[k][q];
+					ata[k][p] = c * akp - s * akq;
+					ata[k][q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double apk = ata[p][k];
+					double aqk = ata[q][k];
+					ata[p][k] = c * apk - s * aqk;
+					ata[q][k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					double vkp = v[k][p];
+					double vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+
+	// pseudo-inverse. Directions with small eigenvalues are not constrained by the planes, so
+	// vertex stays there at the mass point
+	double maxEigenvalue = qMax(ata[0][0], qMax(ata[1][1], ata[2][2]));
+	CVector3 shift;
+	for (int k = 0; k < 3; k++)
+	{
+		double eigenvalue = ata[k][k];
+		if (eigenvalue <= 0.1 * maxEigenvalue || eigenvalue <= 0.0) continue;
+		CVector3 eigenvector(v[0][k], v[1][k], v[2][k]);
+		double projection = eigenvector.x * atb[0] + eigenvector.y * atb[1] + eigenvector.z * atb[2];
+		shift += eigenvector * (projection / eigenvalue);
+	}
+	CVector3 result = massPoint + shift;
+
+	*error = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		double distance = normals[i].Dot(result - points[i]);
+		*error += distance * distance;
+	}
+	return result;
+}
+
+void cAdaptiveMesh::Contour()
+{
+	triangles.clear();
+	if (!nodes.isEmpty()) CellProc(0);
+}
+
+void cAdaptiveMesh::CellProc(int node)
+{
+	int first = nodes[node].firstChild;
+	if (first < 0) return;
+
+	for (int i = 0; i < 8; i++)
+		CellProc(first + i);
+
+	for (int i = 0; i < 12; i++)
+	{
+		FaceProc(
+			first + cellProcFaceMask[i][0], first + cellProcFaceMask[i][1], cellProcFaceMask[i][2]);
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		int edgeNodes[4];
+		for (int j = 0; j < 4; j++)
+			edgeNodes[j] = first + cellProcEdgeMask[i][j];
+		EdgeProc(edgeNodes, cellProcEdgeMask[i][4]);
+	}
+}
+
+void cAdaptiveMesh::FaceProc(int node0, int node1, int dir)
+{
+	int faceNodes[2] = {node0, node1};
+	bool leaf0 = nodes[node0].firstChild < 0;
+	bool leaf1 = nodes[node1].firstChild < 0;
+	if (leaf0 && leaf1) return;
+
+	// leaves are used in place of their non-existing children
+	for (int i = 0; i < 4; i++)
+	{
+		int children[2];
+		for (int j = 0; j < 2; j++)
+		{
+			int first = nodes[faceNodes[j]].firstChild;
+			children[j] = (first < 0) ? faceNodes[j] : first + faceProcFaceMask[dir][i][j];
+		}
+		FaceProc(children[0], children[1], faceProcFaceMask[dir][i][2]);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		const int *mask = faceProcEdgeMask[dir][i];
+		const int *order = faceProcEdgeOrder[mask[0]];
+		int edgeNodes[4];
+		for (int j = 0; j < 4; j++)
+		{
+			int parent = faceNodes[order[j]];
+			int first = nodes[parent].firstChild;
+			edgeNodes[j] = (first < 0) ? parent : first + mask[1 + j];
+		}
+		EdgeProc(edgeNodes, mask[5]);
+	}
+}
+
+void cAdaptiveMesh::EdgeProc(const int *edgeNodes, int dir)
+{
+	bool allLeaves = true;
+	for (int j = 0; j < 4; j++)
+	{
+		if (nodes[edgeNodes[j]].firstChild >= 0) allLeaves = false;
+	}
+
+	if (allLeaves)
+	{
+		ProcessEdge(edgeNodes, dir);
+		return;
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		int children[4];
+		for (int j = 0; j < 4; j++)
+		{
+			int first = nodes[edgeNodes[j]].firstChild;
+			children[j] = (first < 0) ? edgeNodes[j] : first + edgeProcEdgeMask[dir][i][j];
+		}
+		EdgeProc(children, edgeProcEdgeMask[dir][i][4]);
+	}
+}
+
+void cAdaptiveMesh::ProcessEdge(const int *edgeNodes, int dir)
+{
+	// signs on the edge are taken from the smallest cell
+	int deepest = 0;
+	for (int j = 1; j < 4; j++)
+	{
+		if (nodes[edgeNodes[j]].depth > nodes[edgeNodes[deepest]].depth) deepest = j;
+	}
+	const sNode &node = nodes[edgeNodes[deepest]];
+	int edge = processEdgeMask[dir][deepest];
+	bool inside1 = (node.signs >> edgevmap[edge][0]) & 1;
+	bool inside2 = (node.signs >> edgevmap[edge][1]) & 1;
+	if (inside1 == inside2) return;
+
+	int v[4];
+	for (int j = 0; j < 4; j++)
+	{
+		v[j] = nodes[edgeNodes[j]].vertex;
+		// neighbour was rejected by distance estimation
+		if (v[j] < 0) return;
+	}
+
+	if (!inside1)
+	{
+		AddTriangle(v[0], v[1], v[3]);
+		AddTriangle(v[0], v[3], v[2]);
+	}
+	else
+	{
+		AddTriangle(v[0], v[3], v[1]);
+		AddTriangle(v[0], v[2], v[3]);
+	}
+}
+
+void cAdaptiveMesh::AddTriangle(int v1, int v2, int v3)
+{
+	// quads between cells of different sizes have only one triangle
+	if (v1 == v2 || v2 == v3 || v3 == v1) return;
+	triangles.append(v1);
+	triangles.append(v2);
+	triangles.append(v3);
+}
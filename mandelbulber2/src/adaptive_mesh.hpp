@@ -0,0 +1,136 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAdaptiveMesh - adaptive octree mesh extraction with dual contouring
+ *
+ * The octree is refined only around the surface. Cells far from the surface are
+ * rejected by distance estimation and flat parts of the surface are represented by
+ * larger cells. Every cell crossing the surface gets one vertex placed by
+ * minimization of quadratic error function of intersection points and normals.
+ * Cells are connected to quads by traversal of octree faces and edges (Ju et al.)
+ */
+
+#ifndef MANDELBULBER2_SRC_ADAPTIVE_MESH_HPP_
+#define MANDELBULBER2_SRC_ADAPTIVE_MESH_HPP_
+
+#include <QHash>
+#include <QVector>
+
+#include "algebra.hpp"
+
+class cAdaptiveMesh
+{
+public:
+	// source of distance values
+	class cField
+	{
+	public:
+		virtual ~cField() {}
+		// calculates values of many points at once. colorIndices can be NULL
+		virtual void Evaluate(
+			const CVector3 *points, int count, double *values, double *colorIndices) = 0;
+	};
+
+	// octree covers cube with size of 2^maxDepth cells of the finest level
+	cAdaptiveMesh(CVector3 lower, double cellSize, int maxDepth, double isovalue,
+		double safetyFactor, double tolerance);
+
+	// refines next level of octree. Returns false if there is nothing more to refine
+	bool BuildNextLevel(cField *field);
+	int GetCurrentLevel() const { return currentDepth; }
+	int GetMaxDepth() const { return maxDepth; }
+
+	// creates vertices and triangles from leaves of octree
+	void Contour();
+
+	const QVector<CVector3> &GetVertices() const { return vertices; }
+	const QVector<double> &GetColorIndices() const { return colorIndices; }
+	const QVector<CVector3> &GetNormals() const { return vertexNormals; }
+	// three indices of vertices for every triangle
+	const QVector<qint32> &GetTriangles() const { return triangles; }
+
+private:
+	struct sNode
+	{
+		sNode() : firstChild(-1), vertex(-1), signs(0), depth(0), x(0), y(0), z(0) {}
+		// -1 for leaves
+		int firstChild;
+		// -1 if cell doesn't cross the surface
+		int vertex;
+		// bit set for every corner inside the fractal
+		unsigned char signs;
+		unsigned char depth;
+		// minimum corner in units of the finest cells
+		int x, y, z;
+	};
+
+	struct sCorner
+	{
+		sCorner() : value(0.0), colorIndex(0.0) {}
+		double value;
+		double colorIndex;
+		CVector3 normal;
+	};
+
+	qint64 CornerKey(const sNode &node, int corner) const;
+	CVector3 CornerPosition(const sNode &node, int corner) const;
+	void EvaluateCorners(cField *field);
+	// decides if node becomes a leaf and calculates its vertex. Returns true if node is final
+	bool ProcessNode(int nodeIndex);
+	CVector3 SolveQEF(const CVector3 *points, const CVector3 *normals, int count,
+		CVector3 massPoint, double *error) const;
+
+	void CellProc(int node);
+	void FaceProc(int node0, int node1, int dir);
+	void EdgeProc(const int *edgeNodes, int dir);
+	void ProcessEdge(const int *edgeNodes, int dir);
+	void AddTriangle(int v1, int v2, int v3);
+
+	CVector3 lower;
+	double cellSize;
+	int maxDepth;
+	int currentDepth;
+	int minLeafDepth;
+	double isovalue;
+	double safetyFactor;
+	double tolerance;
+
+	QVector<sNode> nodes;
+	QVector<int> currentLevel; // nodes to be processed in next step
+	QHash<qint64, sCorner> corners;
+
+	QVector<CVector3> vertices;
+	QVector<double> colorIndices;
+	QVector<CVector3> vertexNormals;
+	QVector<qint32> triangles;
+};
+
+#endif /* MANDELBULBER2_SRC_ADAPTIVE_MESH_HPP_ */
@@ -0,0 +1,177 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAdaptiveSampling class - rendering of sparse pixels where dense sampling is wasted
+ */
+
+#include "adaptive_sampling.hpp"
+
+#include <cmath>
+
+#include "cimage.hpp"
+#include "fractparams.hpp"
+#include "render_data.hpp"
+#include "stereo.h"
+#include "system.hpp"
+
+cAdaptiveSampling::cAdaptiveSampling(
+	const cParamRender *params, const sRenderData *data, int _width, int _height)
+{
+	width = _width;
+	height = _height;
+
+	maxStep = 1;
+	while (maxStep * 2 <= params->adaptiveSamplingMaxStep)
+		maxStep *= 2;
+
+	segmentWidth = width;
+	if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoLeftRight)
+		segmentWidth = max(width / 2, 1);
+	blocksPerLine = (segmentWidth + maxStep - 1) / maxStep;
+	steps.resize(blocksPerLine * height);
+
+	// the same aspect ratio as used by cRenderWorker::RenderPass()
+	double aspectRatio = (double)data->fullImageSize.x / data->fullImageSize.y;
+	if (params->perspectiveType == params::perspEquirectangular)
+		aspectRatio = 2.0;
+	else if (data->stereo.isEnabled())
+		aspectRatio = data->stereo.ModifyAspectRatio(aspectRatio);
+
+	const cTexture &foveationMap = data->textures.foveationMap;
+	bool flipY = data->imageRegion.y1 > data->imageRegion.y2;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int block = 0; block < blocksPerLine; block++)
+		{
+			// density of rays is taken from the middle of the block
+			int x = min(block * maxStep + maxStep / 2, segmentWidth - 1);
+			CVector2<double> imagePoint =
+				data->screenRegion.transpose(data->imageRegion, CVector2<int>(x, y));
+			if (data->stereo.isEnabled()) imagePoint = data->stereo.ModifyImagePoint(imagePoint);
+
+			double density = 1.0;
+			if (params->adaptiveSamplingEnabled)
+				density = RelativeSolidAngle(
+					params, CVector2<double>(imagePoint.x * aspectRatio, imagePoint.y));
+
+			// bright parts of the map are rendered in full resolution
+			if (foveationMap.IsLoaded())
+			{
+				CVector2<double> mapPoint(
+					imagePoint.x + 0.5, flipY ? 0.5 - imagePoint.y : imagePoint.y + 0.5);
+				sRGBfloat acuity = foveationMap.Pixel(mapPoint);
+				density *= (acuity.R + acuity.G + acuity.B) / 3.0;
+			}
+
+			int step = 1;
+			while (step < maxStep && step * 2 * density <= 1.0)
+				step *= 2;
+			steps[y * blocksPerLine + block] = step;
+		}
+	}
+
+	qint64 renderedPixels = 0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < segmentWidth; x++)
+		{
+			if (IsRendered(x, y)) renderedPixels++;
+		}
+	}
+	renderedFraction = (double)renderedPixels / ((qint64)segmentWidth * height);
+}
+
+double cAdaptiveSampling::RelativeSolidAngle(const cParamRender *params, CVector2<double> point)
+{
+	switch (params->perspectiveType)
+	{
+		case params::perspEquirectangular:
+		{
+			// lines of the same latitude get shorter towards the poles
+			double latitude = params->fov * M_PI * point.y;
+			return max(cos(latitude), 0.0);
+		}
+		case params::perspFishEye:
+		case params::perspFishEyeCut:
+		{
+			// equidistant projection
+			double angle = params->fov * M_PI * point.Length();
+			if (angle < 1e-6) return 1.0;
+			return max(sin(angle) / angle, 0.0);
+		}
+		default: return 1.0;
+	}
+}
+
+void cAdaptiveSampling::Reconstruct(cImage *image) const
+{
+	const sImageOptional *optional = image->GetImageOptional();
+	int segments = width / segmentWidth;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int segment = 0; segment < segments; segment++)
+		{
+			int start = segment * segmentWidth;
+			int previous = start;
+			for (int x = start + 1; x < start + segmentWidth; x++)
+			{
+				if (!IsRendered(x, y)) continue;
+
+				sRGBfloat left = image->GetPixelImage(previous, y);
+				sRGBfloat right = image->GetPixelImage(x, y);
+				for (int xx = previous + 1; xx < x; xx++)
+				{
+					// colour is interpolated linearly, other buffers are taken from the nearest pixel
+					float t = (float)(xx - previous) / (x - previous);
+					sRGBfloat pixel(left.R + (right.R - left.R) * t, left.G + (right.G - left.G) * t,
+						left.B + (right.B - left.B) * t);
+					image->PutPixelImage(xx, y, pixel);
+
+					int nearest = (t < 0.5f) ? previous : x;
+					image->PutPixelColour(xx, y, image->GetPixelColor(nearest, y));
+					image->PutPixelAlpha(xx, y, image->GetPixelAlpha(nearest, y));
+					image->PutPixelZBuffer(xx, y, image->GetPixelZBuffer(nearest, y));
+					image->PutPixelOpacity(xx, y, image->GetPixelOpacity(nearest, y));
+					if (optional->optionalNormal)
+						image->PutPixelNormal(xx, y, image->GetPixelNormal(nearest, y));
+					if (optional->optionalWorldPosition)
+						image->PutPixelWorldPosition(xx, y, image->GetPixelWorldPosition(nearest, y));
+					if (optional->optionalObjectId)
+						image->PutPixelObjectId(xx, y, image->GetPixelObjectId(nearest, y));
+					if (optional->optionalCost) image->PutPixelCost(xx, y, image->GetPixelCost(nearest, y));
+				}
+				previous = x;
+			}
+		}
+	}
+}
@@ -0,0 +1,86 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAdaptiveSampling class - rendering of sparse pixels where dense sampling is wasted
+ *
+ * Pixels of equirectangular and fisheye images near the edges of the projection
+ * cover smaller solid angle than pixels in the centre, and a foveation map can
+ * mark parts of the image which are seen with low acuity. In each line only every
+ * n-th pixel of such areas is rendered (n is a power of two chosen for blocks of
+ * pixels) and the pixels between are interpolated after the main passes.
+ */
+
+
+#ifndef MANDELBULBER2_SRC_ADAPTIVE_SAMPLING_HPP_
+#define MANDELBULBER2_SRC_ADAPTIVE_SAMPLING_HPP_
+
+#include <QVector>
+
+#include "algebra.hpp"
+
+// forward declarations
+class cImage;
+class cParamRender;
+struct sRenderData;
+
+class cAdaptiveSampling
+{
+public:
+	cAdaptiveSampling(const cParamRender *params, const sRenderData *data, int width, int height);
+
+	// false if the pixel is interpolated from neighbours
+	inline bool IsRendered(int x, int y) const
+	{
+		int localX = x % segmentWidth;
+		int step = steps[y * blocksPerLine + localX / maxStep];
+		return localX % step == 0 || localX == segmentWidth - 1;
+	}
+
+	// fills pixels which were not rendered with values of rendered neighbours in the line
+	void Reconstruct(cImage *image) const;
+
+	double GetRenderedFraction() const { return renderedFraction; }
+
+private:
+	// solid angle of the pixel relative to the pixel in the centre of the image
+	static double RelativeSolidAngle(const cParamRender *params, CVector2<double> point);
+
+	int width;
+	int height;
+	// both halves of left-right stereo image are sampled in the same way
+	int segmentWidth;
+	int maxStep;
+	int blocksPerLine;
+	QVector<unsigned char> steps;
+	double renderedFraction;
+};
+
+#endif /* MANDELBULBER2_SRC_ADAPTIVE_SAMPLING_HPP_ */
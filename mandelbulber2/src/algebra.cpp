@@ -139,15 +139,6 @@ CMatrix33 CMatrix33::operator*(const CMatrix33 &matrix) const
 	return result;
 }
 
-CVector3 CMatrix33::operator*(const CVector3 &vector) const
-{
-	CVector3 result;
-	result.x = m11 * vector.x + m12 * vector.y + m13 * vector.z;
-	result.y = m21 * vector.x + m22 * vector.y + m23 * vector.z;
-	result.z = m31 * vector.x + m32 * vector.y + m33 * vector.z;
-	return result;
-}
-
 /**************** class RotationMatrix **********************/
 CRotationMatrix::CRotationMatrix()
 {
@@ -254,19 +245,6 @@ void CRotationMatrix::SetRotation3(CVector3 rotation)
 	RotateX(rotation.z);
 }
 
-CVector3 CRotationMatrix::RotateVector(const CVector3 &vector) const
-{
-	if (!zero)
-	{
-		CVector3 vector2 = matrix * vector;
-		return vector2;
-	}
-	else
-	{
-		return vector;
-	}
-}
-
 void CRotationMatrix::Null()
 {
 	// CRotationMatrix();
@@ -47,6 +47,7 @@
 #include <QString>
 #include <gsl/gsl_sys.h>
 #include <math.h>
+#include "algebra_simd.h"
 
 /************************* vector 3D **********************/
 class CVector3
@@ -82,6 +83,23 @@ public:
 		y = vector[1];
 		z = vector[2];
 	}
+#ifdef ALGEBRA_SIMD
+	// x and y are calculated as one SIMD vector, z as scalar
+	inline CVector3 operator+(const CVector3 &vector) const
+	{
+		CVector3 result;
+		simd2dStore(&result.x, simd2dAdd(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		result.z = z + vector.z;
+		return result;
+	}
+	inline CVector3 operator-(const CVector3 &vector) const
+	{
+		CVector3 result;
+		simd2dStore(&result.x, simd2dSub(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		result.z = z - vector.z;
+		return result;
+	}
+#else
 	inline CVector3 operator+(const CVector3 &vector) const
 	{
 		return CVector3(x + vector.x, y + vector.y, z + vector.z);
@@ -90,6 +108,7 @@ public:
 	{
 		return CVector3(x - vector.x, y - vector.y, z - vector.z);
 	}
+#endif
 	inline CVector3 operator%(const CVector3 &vector) const
 	{
 		return CVector3((vector.x > 0.0 ? fmod(x, vector.x) : x),
@@ -100,6 +119,29 @@ public:
 		if (vector.Length() == 0.0) return *this;
 		return (((*this - vector * 0.5) % vector) + vector) % vector - vector * 0.5;
 	}
+#ifdef ALGEBRA_SIMD
+	inline CVector3 operator*(const double &scalar) const
+	{
+		CVector3 result;
+		simd2dStore(&result.x, simd2dMul(simd2dLoad(&x), simd2dSet1(scalar)));
+		result.z = z * scalar;
+		return result;
+	}
+	inline CVector3 operator*(const CVector3 &vector) const
+	{
+		CVector3 result;
+		simd2dStore(&result.x, simd2dMul(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		result.z = z * vector.z;
+		return result;
+	}
+	inline CVector3 operator/(const double &scalar) const
+	{
+		CVector3 result;
+		simd2dStore(&result.x, simd2dDiv(simd2dLoad(&x), simd2dSet1(scalar)));
+		result.z = z / scalar;
+		return result;
+	}
+#else
 	inline CVector3 operator*(const double &scalar) const
 	{
 		return CVector3(x * scalar, y * scalar, z * scalar);
@@ -112,6 +154,7 @@ public:
 	{
 		return CVector3(x / scalar, y / scalar, z / scalar);
 	}
+#endif
 	inline CVector3 &operator=(const CVector3 &vector)
 	{
 		x = vector.x;
@@ -119,6 +162,44 @@ public:
 		z = vector.z;
 		return *this;
 	}
+#ifdef ALGEBRA_SIMD
+	inline CVector3 &operator+=(const CVector3 &vector)
+	{
+		simd2dStore(&x, simd2dAdd(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		z += vector.z;
+		return *this;
+	}
+	inline CVector3 &operator-=(const CVector3 &vector)
+	{
+		simd2dStore(&x, simd2dSub(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		z -= vector.z;
+		return *this;
+	}
+	inline CVector3 &operator*=(const double &scalar)
+	{
+		simd2dStore(&x, simd2dMul(simd2dLoad(&x), simd2dSet1(scalar)));
+		z *= scalar;
+		return *this;
+	}
+	inline CVector3 &operator*=(const CVector3 &vector)
+	{
+		simd2dStore(&x, simd2dMul(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		z *= vector.z;
+		return *this;
+	}
+	inline CVector3 &operator/=(const double &scalar)
+	{
+		simd2dStore(&x, simd2dDiv(simd2dLoad(&x), simd2dSet1(scalar)));
+		z /= scalar;
+		return *this;
+	}
+	inline CVector3 &operator/=(const CVector3 &vector)
+	{
+		simd2dStore(&x, simd2dDiv(simd2dLoad(&x), simd2dLoad(&vector.x)));
+		z /= vector.z;
+		return *this;
+	}
+#else
 	inline CVector3 &operator+=(const CVector3 &vector)
 	{
 		x += vector.x;
@@ -161,6 +242,7 @@ public:
 		z /= vector.z;
 		return *this;
 	}
+#endif
 	inline bool operator==(const CVector3 &vector) const
 	{
 		return x == vector.x && y == vector.y && z == vector.z;
@@ -181,8 +263,12 @@ public:
 	inline CVector3 Abs()
 	{
 		CVector3 c;
+#ifdef ALGEBRA_SIMD
+		simd2dStore(&c.x, simd2dAbs(simd2dLoad(&x)));
+#else
 		c.x = fabs(x);
 		c.y = fabs(y);
+#endif
 		c.z = fabs(z);
 		return c;
 	}
@@ -225,7 +311,7 @@ public:
 
 inline CVector3 operator*(double scalar, CVector3 vector)
 {
-	return CVector3(vector.x * scalar, vector.y * scalar, vector.z * scalar);
+	return vector * scalar;
 }
 
 inline CVector3 operator/(double scalar, CVector3 vector)
@@ -234,10 +320,7 @@ inline CVector3 operator/(double scalar, CVector3 vector)
 }
 inline CVector3 fabs(CVector3 v)
 {
-	v.x = fabs(v.x);
-	v.y = fabs(v.y);
-	v.z = fabs(v.z);
-	return v;
+	return v.Abs();
 }
 
 /******************* Structured vector 3D ****************/
@@ -308,6 +391,72 @@ public:
 		z = v[2];
 		w = v[3];
 	}
+#ifdef ALGEBRA_SIMD
+	// all components are calculated as one SIMD vector
+	inline CVector4 operator+(const CVector4 &v) const
+	{
+		CVector4 result;
+		simd4dStore(&result.x, simd4dAdd(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return result;
+	}
+	inline CVector4 operator-(const CVector4 &v) const
+	{
+		CVector4 result;
+		simd4dStore(&result.x, simd4dSub(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return result;
+	}
+	inline CVector4 operator*(const double &s) const
+	{
+		CVector4 result;
+		simd4dStore(&result.x, simd4dMul(simd4dLoad(&x), simd4dSet1(s)));
+		return result;
+	}
+	inline CVector4 operator*(const CVector4 &v) const
+	{
+		CVector4 result;
+		simd4dStore(&result.x, simd4dMul(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return result;
+	}
+	inline CVector4 operator/(const double &s) const
+	{
+		CVector4 result;
+		simd4dStore(&result.x, simd4dDiv(simd4dLoad(&x), simd4dSet1(s)));
+		return result;
+	}
+	inline CVector4 &operator=(const CVector4 &v)
+	{
+		x = v.x;
+		y = v.y;
+		z = v.z;
+		w = v.w;
+		return *this;
+	}
+	inline CVector4 &operator+=(const CVector4 &v)
+	{
+		simd4dStore(&x, simd4dAdd(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return *this;
+	}
+	inline CVector4 &operator-=(const CVector4 &v)
+	{
+		simd4dStore(&x, simd4dSub(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return *this;
+	}
+	inline CVector4 &operator*=(const double &s)
+	{
+		simd4dStore(&x, simd4dMul(simd4dLoad(&x), simd4dSet1(s)));
+		return *this;
+	}
+	inline CVector4 &operator*=(const CVector4 &v)
+	{
+		simd4dStore(&x, simd4dMul(simd4dLoad(&x), simd4dLoad(&v.x)));
+		return *this;
+	}
+	inline CVector4 &operator/=(const double &s)
+	{
+		simd4dStore(&x, simd4dDiv(simd4dLoad(&x), simd4dSet1(s)));
+		return *this;
+	}
+#else
 	inline CVector4 operator+(const CVector4 &v) const
 	{
 		return CVector4(x + v.x, y + v.y, z + v.z, w + v.w);
@@ -370,6 +519,7 @@ public:
 		w /= s;
 		return *this;
 	}
+#endif
 	inline bool operator==(const CVector4 &v) const
 	{
 		return x == v.x && y == v.y && z == v.z && w == v.w;
@@ -379,10 +529,14 @@ public:
 	inline CVector4 Abs()
 	{
 		CVector4 c;
+#ifdef ALGEBRA_SIMD
+		simd4dStore(&c.x, simd4dAbs(simd4dLoad(&x)));
+#else
 		c.x = fabs(x);
 		c.y = fabs(y);
 		c.z = fabs(z);
 		c.w = fabs(w);
+#endif
 		return c;
 	}
 	inline CVector3 GetXYZ() { return CVector3(x, y, z); }
@@ -420,7 +574,7 @@ public:
 
 inline CVector4 operator*(double scalar, CVector4 vector)
 {
-	return CVector4(vector.x * scalar, vector.y * scalar, vector.z * scalar, vector.w * scalar);
+	return vector * scalar;
 }
 
 inline CVector4 operator/(double scalar, CVector4 vector)
@@ -430,11 +584,7 @@ inline CVector4 operator/(double scalar, CVector4 vector)
 
 inline CVector4 fabs(CVector4 v)
 {
-	v.x = fabs(v.x);
-	v.y = fabs(v.y);
-	v.z = fabs(v.z);
-	v.w = fabs(v.w);
-	return v;
+	return v.Abs();
 }
 /************************* vector 2D **********************/
 
@@ -558,7 +708,22 @@ public:
 	CMatrix33(const CMatrix33 &matrix);
 	CMatrix33(const CVector3 &v1, const CVector3 &v2, const CVector3 &v3);
 	CMatrix33 operator*(const CMatrix33 &matrix) const;
-	CVector3 operator*(const CVector3 &vector) const;
+	inline CVector3 operator*(const CVector3 &vector) const
+	{
+		CVector3 result;
+#ifdef ALGEBRA_SIMD
+		// x and y of result are calculated from matrix columns
+		simd2d xy = simd2dMul(simd2dSet(m11, m21), simd2dSet1(vector.x));
+		xy = simd2dAdd(xy, simd2dMul(simd2dSet(m12, m22), simd2dSet1(vector.y)));
+		xy = simd2dAdd(xy, simd2dMul(simd2dSet(m13, m23), simd2dSet1(vector.z)));
+		simd2dStore(&result.x, xy);
+#else
+		result.x = m11 * vector.x + m12 * vector.y + m13 * vector.z;
+		result.y = m21 * vector.x + m22 * vector.y + m23 * vector.z;
+#endif
+		result.z = m31 * vector.x + m32 * vector.y + m33 * vector.z;
+		return result;
+	}
 	CMatrix33 &operator=(const CMatrix33 &);
 	double m11;
 	double m12;
@@ -580,7 +745,13 @@ public:
 	void RotateY(double angle);
 	void RotateZ(double angle);
 	void Null();
-	CVector3 RotateVector(const CVector3 &vector) const;
+	inline CVector3 RotateVector(const CVector3 &vector) const
+	{
+		if (!zero)
+			return matrix * vector;
+		else
+			return vector;
+	}
 	double GetAlfa() const;
 	double GetBeta() const;
 	double GetGamma() const;
@@ -0,0 +1,281 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * SIMD helper functions used by CVector3, CVector4, CMatrix33 and texture sampler
+ * when USE_SIMD_ALGEBRA is defined. SSE2 and AVX are used on x86, NEON on AArch64.
+ */
+
+#ifndef MANDELBULBER2_SRC_ALGEBRA_SIMD_H_
+#define MANDELBULBER2_SRC_ALGEBRA_SIMD_H_
+
+#ifdef USE_SIMD_ALGEBRA
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALGEBRA_SIMD
+#define ALGEBRA_SIMD_SSE2
+#include <emmintrin.h>
+#ifdef __AVX__
+#define ALGEBRA_SIMD_AVX
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define ALGEBRA_SIMD
+#define ALGEBRA_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#endif // USE_SIMD_ALGEBRA
+
+#ifdef ALGEBRA_SIMD
+
+/*********************** 2 x double ***********************/
+#ifdef ALGEBRA_SIMD_SSE2
+typedef __m128d simd2d;
+
+inline simd2d simd2dLoad(const double *p)
+{
+	return _mm_loadu_pd(p);
+}
+inline void simd2dStore(double *p, simd2d a)
+{
+	_mm_storeu_pd(p, a);
+}
+inline simd2d simd2dSet1(double s)
+{
+	return _mm_set1_pd(s);
+}
+inline simd2d simd2dSet(double lo, double hi)
+{
+	return _mm_set_pd(hi, lo);
+}
+inline simd2d simd2dAdd(simd2d a, simd2d b)
+{
+	return _mm_add_pd(a, b);
+}
+inline simd2d simd2dSub(simd2d a, simd2d b)
+{
+	return _mm_sub_pd(a, b);
+}
+inline simd2d simd2dMul(simd2d a, simd2d b)
+{
+	return _mm_mul_pd(a, b);
+}
+inline simd2d simd2dDiv(simd2d a, simd2d b)
+{
+	return _mm_div_pd(a, b);
+}
+inline simd2d simd2dAbs(simd2d a)
+{
+	return _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+}
+#endif // ALGEBRA_SIMD_SSE2
+
+#ifdef ALGEBRA_SIMD_NEON
+typedef float64x2_t simd2d;
+
+inline simd2d simd2dLoad(const double *p)
+{
+	return vld1q_f64(p);
+}
+inline void simd2dStore(double *p, simd2d a)
+{
+	vst1q_f64(p, a);
+}
+inline simd2d simd2dSet1(double s)
+{
+	return vdupq_n_f64(s);
+}
+inline simd2d simd2dSet(double lo, double hi)
+{
+	return vsetq_lane_f64(hi, vdupq_n_f64(lo), 1);
+}
+inline simd2d simd2dAdd(simd2d a, simd2d b)
+{
+	return vaddq_f64(a, b);
+}
+inline simd2d simd2dSub(simd2d a, simd2d b)
+{
+	return vsubq_f64(a, b);
+}
+inline simd2d simd2dMul(simd2d a, simd2d b)
+{
+	return vmulq_f64(a, b);
+}
+inline simd2d simd2dDiv(simd2d a, simd2d b)
+{
+	return vdivq_f64(a, b);
+}
+inline simd2d simd2dAbs(simd2d a)
+{
+	return vabsq_f64(a);
+}
+#endif // ALGEBRA_SIMD_NEON
+
+/*********************** 4 x double ***********************/
+#ifdef ALGEBRA_SIMD_AVX
+typedef __m256d simd4d;
+
+inline simd4d simd4dLoad(const double *p)
+{
+	return _mm256_loadu_pd(p);
+}
+inline void simd4dStore(double *p, simd4d a)
+{
+	_mm256_storeu_pd(p, a);
+}
+inline simd4d simd4dSet1(double s)
+{
+	return _mm256_set1_pd(s);
+}
+inline simd4d simd4dAdd(simd4d a, simd4d b)
+{
+	return _mm256_add_pd(a, b);
+}
+inline simd4d simd4dSub(simd4d a, simd4d b)
+{
+	return _mm256_sub_pd(a, b);
+}
+inline simd4d simd4dMul(simd4d a, simd4d b)
+{
+	return _mm256_mul_pd(a, b);
+}
+inline simd4d simd4dDiv(simd4d a, simd4d b)
+{
+	return _mm256_div_pd(a, b);
+}
+inline simd4d simd4dAbs(simd4d a)
+{
+	return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+}
+#else
+// pair of 2 x double vectors
+struct simd4d
+{
+	simd2d lo;
+	simd2d hi;
+};
+
+inline simd4d simd4dLoad(const double *p)
+{
+	simd4d r = {simd2dLoad(p), simd2dLoad(p + 2)};
+	return r;
+}
+inline void simd4dStore(double *p, simd4d a)
+{
+	simd2dStore(p, a.lo);
+	simd2dStore(p + 2, a.hi);
+}
+inline simd4d simd4dSet1(double s)
+{
+	simd4d r = {simd2dSet1(s), simd2dSet1(s)};
+	return r;
+}
+inline simd4d simd4dAdd(simd4d a, simd4d b)
+{
+	simd4d r = {simd2dAdd(a.lo, b.lo), simd2dAdd(a.hi, b.hi)};
+	return r;
+}
+inline simd4d simd4dSub(simd4d a, simd4d b)
+{
+	simd4d r = {simd2dSub(a.lo, b.lo), simd2dSub(a.hi, b.hi)};
+	return r;
+}
+inline simd4d simd4dMul(simd4d a, simd4d b)
+{
+	simd4d r = {simd2dMul(a.lo, b.lo), simd2dMul(a.hi, b.hi)};
+	return r;
+}
+inline simd4d simd4dDiv(simd4d a, simd4d b)
+{
+	simd4d r = {simd2dDiv(a.lo, b.lo), simd2dDiv(a.hi, b.hi)};
+	return r;
+}
+inline simd4d simd4dAbs(simd4d a)
+{
+	simd4d r = {simd2dAbs(a.lo), simd2dAbs(a.hi)};
+	return r;
+}
+#endif // ALGEBRA_SIMD_AVX
+
+/*********************** 4 x float ***********************/
+#ifdef ALGEBRA_SIMD_SSE2
+typedef __m128 simd4f;
+
+inline simd4f simd4fLoad(const float *p)
+{
+	return _mm_loadu_ps(p);
+}
+inline void simd4fStore(float *p, simd4f a)
+{
+	_mm_storeu_ps(p, a);
+}
+inline simd4f simd4fSet1(float s)
+{
+	return _mm_set1_ps(s);
+}
+inline simd4f simd4fAdd(simd4f a, simd4f b)
+{
+	return _mm_add_ps(a, b);
+}
+inline simd4f simd4fMul(simd4f a, simd4f b)
+{
+	return _mm_mul_ps(a, b);
+}
+#endif // ALGEBRA_SIMD_SSE2
+
+#ifdef ALGEBRA_SIMD_NEON
+typedef float32x4_t simd4f;
+
+inline simd4f simd4fLoad(const float *p)
+{
+	return vld1q_f32(p);
+}
+inline void simd4fStore(float *p, simd4f a)
+{
+	vst1q_f32(p, a);
+}
+inline simd4f simd4fSet1(float s)
+{
+	return vdupq_n_f32(s);
+}
+inline simd4f simd4fAdd(simd4f a, simd4f b)
+{
+	return vaddq_f32(a, b);
+}
+inline simd4f simd4fMul(simd4f a, simd4f b)
+{
+	return vmulq_f32(a, b);
+}
+#endif // ALGEBRA_SIMD_NEON
+
+#endif // ALGEBRA_SIMD
+
+#endif /* MANDELBULBER2_SRC_ALGEBRA_SIMD_H_ */
@@ -49,17 +49,23 @@
 #include "../src/rendered_image_widget.hpp"
 #include "animation_frames.hpp"
 #include "cimage.hpp"
+#include "concurrent_frames.hpp"
 #include "dock_animation.h"
 #include "dock_statistics.h"
 #include "dock_navigation.h"
 #include "files.h"
+#include "frame_claims.hpp"
+#include "frame_time_controller.hpp"
 #include "global_data.hpp"
 #include "headless.h"
+#include "image_save_queue.hpp"
 #include "initparameters.hpp"
 #include "interface.hpp"
 #include "netrender.hpp"
 #include "render_job.hpp"
+#include "render_time_budget.hpp"
 #include "rendering_configuration.hpp"
+#include "resource_report.hpp"
 #include "ui_dock_animation.h"
 #include "undo.h"
 
@@ -141,6 +147,9 @@ cFlightAnimation::cFlightAnimation(cInterface *_interface, cAnimationFrames *_fr
 	rotationDirection = 0;
 	recordPause = false;
 	orthogonalStrafe = false;
+	netRenderServerFrame = -1;
+	netRenderFrameDistribution = false;
+	resourceReport = NULL;
 }
 
 void cFlightAnimation::slotRecordFlight()
@@ -305,8 +314,18 @@ void cFlightAnimation::RecordFlight(bool continueRecording)
 	config.SetMaxRenderTime(params->Get<double>("flight_sec_per_frame"));
 
 	renderJob->Init(cRenderJob::flightAnimRecord, config);
+	renderJob->SetCheckerboard(params->Get<bool>("flight_checkerboard"));
 	mainInterface->stopRequest = false;
 
+	// quality of frames is adjusted to keep the frame rate
+	cFrameTimeController frameTimeController;
+	bool useFrameTimeControl = params->Get<bool>("frame_time_control");
+	if (useFrameTimeControl)
+	{
+		frameTimeController.SetTargetFrameTime(1.0 / params->Get<int>("frame_time_target_fps"));
+		renderJob->SetFrameTimeController(&frameTimeController);
+	}
+
 	// vector for speed and rotation control
 	CVector3 cameraSpeed;
 	CVector3 cameraAcceleration;
@@ -343,6 +362,14 @@ void cFlightAnimation::RecordFlight(bool continueRecording)
 			tr("Recording flight animation. Frame: ") + QString::number(index), 0.0,
 			cProgressText::progress_ANIMATION);
 
+		// when the camera stops, last frame is refined to full quality
+		if (recordPause && useFrameTimeControl && !frameTimeController.IsFullQuality())
+		{
+			renderJob->SetFrameTimeController(NULL);
+			renderJob->Execute();
+			renderJob->SetFrameTimeController(&frameTimeController);
+		}
+
 		bool wasPaused = false;
 		while (recordPause)
 		{
@@ -364,6 +391,7 @@ void cFlightAnimation::RecordFlight(bool continueRecording)
 
 			config.SetMaxRenderTime(params->Get<double>("flight_sec_per_frame"));
 			renderJob->UpdateConfig(config);
+			renderJob->SetCheckerboard(params->Get<bool>("flight_checkerboard"));
 
 			if (mainInterface->stopRequest) break;
 		}
@@ -706,6 +734,19 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 	connect(
 		renderJob, SIGNAL(updateStatistics(cStatistics)), this, SIGNAL(updateStatistics(cStatistics)));
 
+	// frames are claimed with lock files, so many instances can render to the same folder
+	bool farmMode = params->Get<bool>("anim_farm_mode");
+	cFrameClaims farmClaims(params->Get<int>("anim_farm_claim_timeout"));
+
+	// frames are saved in background while next frame is rendered
+	// (in farm mode frame has to be saved before its claim is released)
+	cImageSaveQueue saveQueue(farmMode ? 0 : params->Get<int>("anim_save_queue_depth"));
+
+	// NetRender clients render whole frames instead of lines of every frame
+	bool distributeFrames = gNetRender->IsServer() && gNetRender->GetClientCount() > 0
+													&& params->Get<bool>("netrender_frame_distribution")
+													&& !params->Get<bool>("stereo_enabled") && !farmMode;
+
 	cRenderingConfiguration config;
 	config.EnableNetRender();
 
@@ -715,8 +756,14 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 		config.DisableProgressiveRender();
 		config.EnableNetRender();
 	}
+	if (distributeFrames) config.DisableNetRender();
 
 	renderJob->Init(cRenderJob::flightAnim, config);
+
+	// SSAO and DOF of frame are done by the save queue while next frame is rendered
+	renderJob->SetDeferredPostProcessing(
+		params->Get<bool>("anim_deferred_post_processing") && !farmMode);
+
 	*stopRequest = false;
 
 	cProgressText progressText;
@@ -740,7 +787,8 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 
 		int unrenderedTotal = frames->GetUnrenderedTotal();
 
-		if (frames->GetNumberOfFrames() > 0 && unrenderedTotal == 0)
+		// in farm mode other instances could have finished the animation
+		if (frames->GetNumberOfFrames() > 0 && unrenderedTotal == 0 && !farmMode)
 		{
 			bool deletePreviousRender;
 			QString questionTitle = QObject::tr("Truncate Image Folder");
@@ -784,11 +832,29 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 			}
 		}
 
+		if (distributeFrames) distributeFrames = StartNetRenderFrameDistribution(renderJob);
+
+		bool pipelineFrames = gNetRender->IsServer() && !distributeFrames
+													&& params->Get<bool>("netrender_job_pipelining")
+													&& !params->Get<bool>("stereo_enabled") && !farmMode;
+		bool farmFramesSkipped = false;
+
+		// small frames are rendered concurrently, each one with own image
+		QScopedPointer<cConcurrentFrames> concurrentFrames;
+		int numberOfConcurrentFrames = cConcurrentFrames::NumberOfConcurrentFrames(params);
+		if (numberOfConcurrentFrames > 1 && !distributeFrames && !pipelineFrames)
+		{
+			concurrentFrames.reset(new cConcurrentFrames(
+				numberOfConcurrentFrames, params->Get<int>("limit_CPU_cores"), cRenderJob::flightAnim));
+		}
+
 		for (int index = 0; index < frames->GetNumberOfFrames(); ++index)
 		{
 
 			double percentDoneFrame;
-			if (unrenderedTotal > 0)
+			if (unrenderedTotal > 0 && distributeFrames)
+				percentDoneFrame = 1.0 - (frames->GetUnrenderedTotal() * 1.0) / unrenderedTotal;
+			else if (unrenderedTotal > 0)
 				percentDoneFrame = (frames->GetUnrenderedTillIndex(index) * 1.0) / unrenderedTotal;
 			else
 				percentDoneFrame = 1.0;
@@ -809,6 +875,17 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 				continue;
 			}
 
+			// frame is being rendered by NetRender client
+			if (distributeFrames && gNetRender->IsFrameAssigned(index)) continue;
+
+			// frame is rendered by other instance of render farm
+			if (farmMode && !farmClaims.Claim(GetFlightFilename(index)))
+			{
+				if (!QFile::exists(GetFlightFilename(index))) farmFramesSkipped = true;
+				continue;
+			}
+			netRenderServerFrame = index;
+
 			emit updateProgressAndStatus(QObject::tr("Animation start"),
 				QObject::tr("Frame %1 of %2").arg((index + 1)).arg(frames->GetNumberOfFrames()) + " "
 					+ progressTxt,
@@ -823,28 +900,89 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 				mainInterface->SynchronizeInterface(params, fractalParams, qInterface::write);
 
 				// show distance in statistics table
-				double distance = mainInterface->GetDistanceForPoint(
+				mainInterface->mainWindow->GetWidgetDockStatistics()->RequestDistanceToFractal(
 					params->Get<CVector3>("camera"), params, fractalParams);
-				mainInterface->mainWindow->GetWidgetDockStatistics()->UpdateDistanceToFractal(distance);
 			}
 
-			if (gNetRender->IsServer())
+			// with pipelining clients are already working on this frame
+			if (gNetRender->IsServer() && !distributeFrames && !gNetRender->HasNextJob())
 			{
 				gNetRender->WaitForAllClientsReady(10.0);
 			}
 
 			params->Set("frame_no", index);
+			if (pipelineFrames) SetNextNetRenderFrame(renderJob, index);
 
-			renderJob->UpdateParameters(params, fractalParams);
+			if (concurrentFrames)
+			{
+				concurrentFrames->AddFrame(*params, *fractalParams, GetFlightFilename(index),
+					(ImageFileSave::enumImageFileType)params->Get<int>("flight_animation_image_type"));
+				if (concurrentFrames->IsFull() && !concurrentFrames->RenderFrames(stopRequest, &saveQueue))
+					throw false;
+				continue;
+			}
+
+			// quality of the frame is reduced to render it within time budget
+			if (params->Get<double>("render_time_budget") > 0.0)
+			{
+				cParameterContainer framePar = *params;
+				cRenderTimeBudget timeBudget(params->Get<double>("render_time_budget"));
+				timeBudget.Fit(&framePar, *fractalParams);
+				renderJob->UpdateParameters(&framePar, fractalParams);
+			}
+			else
+			{
+				renderJob->UpdateParameters(params, fractalParams);
+			}
 			int result = renderJob->Execute();
 			if (!result) throw false;
+			if (resourceReport) resourceReport->AddStatistics(renderJob->GetStatistics());
 
 			QString filename = GetFlightFilename(index);
 			ImageFileSave::enumImageFileType fileType =
 				(ImageFileSave::enumImageFileType)params->Get<int>("flight_animation_image_type");
-			SaveImage(filename, fileType, image, gMainInterface->mainWindow);
+			saveQueue.Enqueue(filename, fileType, image, gMainInterface->mainWindow,
+				renderJob->IsPostProcessingDeferred() ? renderJob->GetParameters() : NULL);
+			farmClaims.Release();
+
+			netRenderServerFrame = -1;
+			if (distributeFrames)
+			{
+				cAnimationFrames::sAnimationFrame frame = frames->GetFrame(index);
+				frame.alreadyRendered = true;
+				frames->ModifyFrame(index, frame);
+			}
+		}
+
+		// the last incomplete batch of concurrent frames
+		if (concurrentFrames && !concurrentFrames->RenderFrames(stopRequest, &saveQueue))
+			throw false;
+
+		if (distributeFrames)
+		{
+			if (!WaitForNetRenderFrames(stopRequest)) throw false;
+			StopNetRenderFrameDistribution();
+
+			// frames of disconnected clients are missing
+			if (frames->GetUnrenderedTotal() > 0)
+			{
+				delete renderJob;
+				return RenderFlight(stopRequest);
+			}
 		}
 
+		// claims of terminated instances will expire, so missing frames are checked again
+		if (farmFramesSkipped)
+		{
+			emit updateProgressAndStatus(QObject::tr("Waiting for other instances"),
+				progressText.getText(1.0), 1.0, cProgressText::progress_ANIMATION);
+			cFrameClaims::WaitForOtherInstances(stopRequest);
+			if (*stopRequest) throw false;
+			delete renderJob;
+			return RenderFlight(stopRequest);
+		}
+
+		saveQueue.Flush();
 		emit updateProgressAndStatus(QObject::tr("Animation finished"), progressText.getText(1.0), 1.0,
 			cProgressText::progress_ANIMATION);
 		emit notifyRenderFlightRenderStatus(
@@ -853,6 +991,7 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 	}
 	catch (bool ex)
 	{
+		StopNetRenderFrameDistribution();
 		emit updateProgressAndStatus(QObject::tr("Rendering terminated"), progressText.getText(1.0),
 			cProgressText::progress_ANIMATION);
 		emit updateProgressHide();
@@ -864,6 +1003,101 @@ bool cFlightAnimation::RenderFlight(bool *stopRequest)
 	return true;
 }
 
+void cFlightAnimation::SetNextNetRenderFrame(cRenderJob *renderJob, int index)
+{
+	int nextIndex = index + 1;
+	while (nextIndex < frames->GetNumberOfFrames() && frames->GetFrame(nextIndex).alreadyRendered)
+		nextIndex++;
+
+	if (nextIndex < frames->GetNumberOfFrames())
+	{
+		cParameterContainer nextParams = *params;
+		cFractalContainer nextFractalParams = *fractalParams;
+		frames->GetFrameAndConsolidate(nextIndex, &nextParams, &nextFractalParams);
+		nextParams.Set("frame_no", nextIndex);
+		renderJob->SetNextNetRenderJob(&nextParams, &nextFractalParams);
+	}
+	else
+	{
+		renderJob->SetNextNetRenderJob(NULL, NULL);
+	}
+}
+
+bool cFlightAnimation::StartNetRenderFrameDistribution(cRenderJob *renderJob)
+{
+	if (!gNetRender->Block()) return false;
+
+	netRenderTextures = renderJob->CreateListOfUsedTextures();
+	connect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotNetRenderClientIdle(int)));
+	connect(gNetRender, SIGNAL(FrameReceived(int, bool)), this,
+		SLOT(slotNetRenderFrameReceived(int, bool)));
+	netRenderFrameDistribution = true;
+	gNetRender->StartFrameDistribution();
+	return true;
+}
+
+void cFlightAnimation::StopNetRenderFrameDistribution()
+{
+	if (!netRenderFrameDistribution) return;
+
+	netRenderFrameDistribution = false;
+	netRenderServerFrame = -1;
+	gNetRender->StopFrameDistribution();
+	disconnect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotNetRenderClientIdle(int)));
+	disconnect(gNetRender, SIGNAL(FrameReceived(int, bool)), this,
+		SLOT(slotNetRenderFrameReceived(int, bool)));
+	gNetRender->Release();
+}
+
+bool cFlightAnimation::WaitForNetRenderFrames(bool *stopRequest)
+{
+	while (gNetRender->GetNumberOfAssignedFrames() > 0)
+	{
+		if (*stopRequest) return false;
+		gApplication->processEvents();
+		Wait(10);
+	}
+	return true;
+}
+
+void cFlightAnimation::slotNetRenderClientIdle(int clientIndex)
+{
+	// image size is the same in all frames
+	if (!gNetRender->HasMemoryForFrame(clientIndex, *params))
+	{
+		WriteLog(QString("NetRender - client #%1 doesn't have enough memory for frames")
+							 .arg(clientIndex),
+			1);
+		return;
+	}
+
+	// client gets the first frame which is not rendered yet
+	for (int index = 0; index < frames->GetNumberOfFrames(); ++index)
+	{
+		if (frames->GetFrame(index).alreadyRendered || index == netRenderServerFrame
+				|| gNetRender->IsFrameAssigned(index))
+			continue;
+
+		cParameterContainer frameParams = *params;
+		cFractalContainer frameFractal = *fractalParams;
+		frames->GetFrameAndConsolidate(index, &frameParams, &frameFractal);
+		frameParams.Set("frame_no", index);
+		gNetRender->SendFrame(clientIndex, index, frameParams, frameFractal, netRenderTextures,
+			params->Get<int>("flight_animation_image_type"), GetFlightFilename(index));
+		return;
+	}
+}
+
+void cFlightAnimation::slotNetRenderFrameReceived(int frameIndex, bool success)
+{
+	if (success && frameIndex < frames->GetNumberOfFrames())
+	{
+		cAnimationFrames::sAnimationFrame frame = frames->GetFrame(frameIndex);
+		frame.alreadyRendered = true;
+		frames->ModifyFrame(frameIndex, frame);
+	}
+}
+
 void cFlightAnimation::RefreshTable()
 {
 	PrepareTable();
@@ -890,6 +1124,7 @@ void cFlightAnimation::RefreshTable()
 			thumbWidget->UseOneCPUCore(true);
 			frames->GetFrameAndConsolidate(i, &tempPar, &tempFract);
 			thumbWidget->AssignParameters(tempPar, tempFract);
+			thumbWidget->SetSourceImageFile(GetFlightFilename(i));
 			table->setCellWidget(0, newColumn, thumbWidget);
 		}
 		if (i % 100 == 0)
@@ -1244,7 +1479,7 @@ void cFlightAnimation::slotExportFlightToKeyframes()
 	mainInterface->SynchronizeInterface(params, fractalParams, qInterface::read);
 	gUndo.Store(params, fractalParams, gAnimFrames, gKeyframes);
 
-	if (gKeyframes->GetFrames().size() > 0)
+	if (gKeyframes->GetNumberOfFrames() > 0)
 	{
 		QMessageBox::StandardButton reply;
 		reply = QMessageBox::question(mainInterface->mainWindow->GetCentralWidget(),
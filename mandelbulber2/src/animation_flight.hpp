@@ -55,6 +55,8 @@ class cInterface;
 class cFractalContainer;
 class cParameterContainer;
 class MyTableWidgetAnim;
+class cRenderJob;
+class cResourceReport;
 
 namespace Ui
 {
@@ -86,6 +88,8 @@ public:
 	void InterpolateForward(int row, int column);
 	QString GetFlightFilename(int index);
 	void UpdateLimitsForFrameRange(void);
+	// statistics of rendered frames are added to the report (NULL - no report)
+	void SetResourceReport(cResourceReport *report) { resourceReport = report; }
 
 public slots:
 	bool slotRenderFlight();
@@ -109,6 +113,8 @@ private slots:
 	void slotMovedSliderFirstFrame(int value);
 	void slotMovedSliderLastFrame(int value);
 	void slotCellDoubleClicked(int row, int column);
+	void slotNetRenderClientIdle(int clientIndex);
+	void slotNetRenderFrameReceived(int frameIndex, bool success);
 
 private:
 	void PrepareTable();
@@ -116,6 +122,12 @@ private:
 	int AddVariableToTable(
 		const cAnimationFrames::sParameterDescription &parameterDescription, int index);
 	int AddColumn(const cAnimationFrames::sAnimationFrame &frame, int indexOfExistingColumn = -1);
+	bool StartNetRenderFrameDistribution(cRenderJob *renderJob);
+	void StopNetRenderFrameDistribution();
+	// NetRender clients get the next unrendered frame while rendering the current one
+	void SetNextNetRenderFrame(cRenderJob *renderJob, int index);
+	// returns false if rendering was stopped
+	bool WaitForNetRenderFrames(bool *stopRequest);
 	cInterface *mainInterface;
 	Ui::cDockAnimation *ui;
 	cAnimationFrames *frames;
@@ -134,6 +146,10 @@ private:
 	double linearSpeedSp;
 	// QList<cThumbnailWidget*> thumbnailWidgets;
 	bool recordPause;
+	bool netRenderFrameDistribution; // whole frames are rendered by NetRender clients
+	int netRenderServerFrame; // frame rendered by server during frame distribution (-1 if none)
+	QStringList netRenderTextures; // textures sent with frames to NetRender clients
+	cResourceReport *resourceReport;
 
 signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress,
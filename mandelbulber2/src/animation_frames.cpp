@@ -33,6 +33,9 @@
  *
  * Handles the 2D matrix of the list of parameters / list of frames
  * and exposes functions to modify this matrix.
+ *
+ * Frames are stored in columns: values of one parameter from all frames are kept
+ * in one contiguous array. Container of a single frame is created only on demand.
  */
 
 #include "animation_frames.hpp"
@@ -51,17 +54,17 @@ cAnimationFrames::~cAnimationFrames()
 void cAnimationFrames::AddFrame(
 	const cParameterContainer &params, const cFractalContainer &fractal, int index)
 {
-	sAnimationFrame frame;
-	frame.alreadyRendered = false;
+	int indexTemp = index;
+	if (index == -1) indexTemp = frameStates.size();
+	InsertEmptyFrame(indexTemp);
+
 	for (int i = 0; i < listOfParameters.size(); ++i)
 	{
 		const cParameterContainer *container =
 			ContainerSelector(listOfParameters[i].containerName, &params, &fractal);
 		if (container)
 		{
-			QString parameterName = listOfParameters[i].parameterName;
-			frame.parameters.AddParamFromOneParameter(container->GetContainerName() + "_" + parameterName,
-				container->GetAsOneParameter(parameterName));
+			StoreValue(i, indexTemp, container->GetAsOneParameter(listOfParameters[i].parameterName));
 		}
 		else
 		{
@@ -70,9 +73,6 @@ void cAnimationFrames::AddFrame(
 									<< listOfParameters[i].containerName;
 		}
 	}
-	int indexTemp = index;
-	if (index == -1) indexTemp = frames.size();
-	frames.insert(indexTemp, frame);
 }
 
 void cAnimationFrames::AddAnimatedParameter(
@@ -83,10 +83,10 @@ void cAnimationFrames::AddAnimatedParameter(
 		listOfParameters.append(
 			sParameterDescription(parameterName, defaultValue.GetOriginalContainerName(),
 				defaultValue.GetValueType(), defaultValue.GetMorphType()));
-		for (int i = 0; i < frames.size(); ++i)
+		columns.append(sFrameColumn());
+		for (int i = 0; i < frameStates.size(); ++i)
 		{
-			frames[i].parameters.AddParamFromOneParameter(
-				defaultValue.GetOriginalContainerName() + "_" + parameterName, defaultValue);
+			StoreValue(columns.size() - 1, i, defaultValue);
 		}
 	}
 	else
@@ -134,17 +134,17 @@ bool cAnimationFrames::AddAnimatedParameter(const QString &fullParameterName,
 
 int cAnimationFrames::GetUnrenderedTotal()
 {
-	return GetUnrenderedTillIndex(frames.count() - 1);
+	return GetUnrenderedTillIndex(frameStates.count() - 1);
 }
 
 int cAnimationFrames::GetUnrenderedTillIndex(int index)
 {
-	if (index >= 0 && index < frames.count())
+	if (index >= 0 && index < frameStates.count())
 	{
 		int count = 0;
 		for (int i = 0; i < index; i++)
 		{
-			if (!frames.at(i).alreadyRendered) count++;
+			if (!frameStates.at(i).alreadyRendered) count++;
 		}
 		return count;
 	}
@@ -157,17 +157,23 @@ int cAnimationFrames::GetUnrenderedTillIndex(int index)
 
 int cAnimationFrames::GetNumberOfFrames() const
 {
-	return frames.count();
+	return frameStates.count();
 }
 
 void cAnimationFrames::Clear()
 {
-	frames.clear();
+	frameStates.clear();
+	for (int i = 0; i < columns.size(); ++i)
+	{
+		columns[i].values.clear();
+		columns[i].otherValues.clear();
+	}
 }
 
 void cAnimationFrames::ClearAll()
 {
-	frames.clear();
+	frameStates.clear();
+	columns.clear();
 	listOfParameters.clear();
 }
 
@@ -255,9 +261,19 @@ cParameterContainer *cAnimationFrames::ContainerSelector(
 
 cAnimationFrames::sAnimationFrame cAnimationFrames::GetFrame(int index) const
 {
-	if (index >= 0 && index < frames.count())
+	if (index >= 0 && index < frameStates.count())
 	{
-		return frames.at(index);
+		sAnimationFrame frame;
+		for (int i = 0; i < listOfParameters.size(); ++i)
+		{
+			if (columns.at(i).prototype.IsEmpty()) continue;
+			frame.parameters.AddParamFromOneParameter(FullParameterName(i), GetFrameValue(index, i));
+		}
+		const sFrameState &state = frameStates.at(index);
+		frame.thumbnail = state.thumbnail;
+		frame.alreadyRendered = state.alreadyRendered;
+		frame.alreadyRenderedSubFrames = state.alreadyRenderedSubFrames;
+		return frame;
 	}
 	else
 	{
@@ -269,18 +285,17 @@ cAnimationFrames::sAnimationFrame cAnimationFrames::GetFrame(int index) const
 void cAnimationFrames::GetFrameAndConsolidate(
 	int index, cParameterContainer *params, cFractalContainer *fractal)
 {
-	if (index >= 0 && index < frames.count())
+	if (index >= 0 && index < frameStates.count())
 	{
-		cParameterContainer frame = frames.at(index).parameters;
-
 		for (int i = 0; i < listOfParameters.size(); ++i)
 		{
+			if (columns.at(i).prototype.IsEmpty()) continue;
 			cParameterContainer *container =
 				ContainerSelector(listOfParameters[i].containerName, params, fractal);
-			QString parameterName = listOfParameters[i].parameterName;
-			cOneParameter oneParameter =
-				frame.GetAsOneParameter(listOfParameters[i].containerName + "_" + parameterName);
-			container->SetFromOneParameter(parameterName, oneParameter);
+			sParameterDescription &description = listOfParameters[i];
+			description.containerHandle =
+				container->FindHandle(description.parameterName, description.containerHandle);
+			container->SetFromOneParameter(description.containerHandle, GetFrameValue(index, i));
 		}
 	}
 	else
@@ -291,17 +306,12 @@ void cAnimationFrames::GetFrameAndConsolidate(
 
 void cAnimationFrames::RemoveAnimatedParameter(const QString &fullParameterName)
 {
-	for (int i = 0; i < frames.size(); ++i)
-	{
-		frames[i].parameters.DeleteParameter(fullParameterName);
-	}
-
 	for (int i = 0; i < listOfParameters.size(); ++i)
 	{
-		if (listOfParameters[i].containerName + "_" + listOfParameters[i].parameterName
-				== fullParameterName)
+		if (FullParameterName(i) == fullParameterName)
 		{
 			listOfParameters.removeAt(i);
+			columns.removeAt(i);
 			break;
 		}
 	}
@@ -309,21 +319,200 @@ void cAnimationFrames::RemoveAnimatedParameter(const QString &fullParameterName)
 
 void cAnimationFrames::DeleteFrames(int begin, int end)
 {
-	for (int i = end; i >= begin; i--)
+	if (begin < 0 || end >= frameStates.size() || end < begin) return;
+	int count = end - begin + 1;
+
+	for (int i = 0; i < columns.size(); ++i)
 	{
-		frames.removeAt(i);
+		sFrameColumn &column = columns[i];
+		if (column.components > 0)
+			column.values.remove(begin * column.components, count * column.components);
+		else
+			column.otherValues.remove(begin, count);
 	}
+	frameStates.erase(frameStates.begin() + begin, frameStates.begin() + end + 1);
 }
 
 void cAnimationFrames::ModifyFrame(int index, sAnimationFrame &frame)
 {
-	if (index >= 0 && index < frames.size())
+	if (index >= 0 && index < frameStates.size())
 	{
-		frames[index] = frame;
+		StoreFrame(index, frame);
 	}
 }
 
 void cAnimationFrames::AddFrame(const sAnimationFrame &frame)
 {
-	frames.append(frame);
+	InsertEmptyFrame(frameStates.size());
+	StoreFrame(frameStates.size() - 1, frame);
+}
+
+void cAnimationFrames::Override(
+	QList<sAnimationFrame> _frames, QList<sParameterDescription> _listOfParameters)
+{
+	SetListOfParametersAndClear(_listOfParameters);
+	for (int i = 0; i < _frames.size(); ++i)
+	{
+		AddFrame(_frames.at(i));
+	}
+}
+
+QList<cAnimationFrames::sAnimationFrame> cAnimationFrames::GetFrames() const
+{
+	QList<sAnimationFrame> list;
+	for (int i = 0; i < frameStates.size(); ++i)
+	{
+		list.append(GetFrame(i));
+	}
+	return list;
+}
+
+void cAnimationFrames::SetListOfParametersAndClear(
+	QList<sParameterDescription> _listOfParameters)
+{
+	listOfParameters = _listOfParameters;
+	frameStates.clear();
+	columns.clear();
+	// types of columns will be taken from first added frame
+	for (int i = 0; i < listOfParameters.size(); ++i)
+	{
+		columns.append(sFrameColumn());
+	}
+}
+
+int cAnimationFrames::NumberOfComponents(enumVarType type)
+{
+	switch (type)
+	{
+		case typeInt:
+		case typeDouble:
+		case typeBool: return 1;
+		case typeRgb:
+		case typeVector3: return 3;
+		case typeVector4: return 4;
+		default: return 0;
+	}
+}
+
+void cAnimationFrames::InsertEmptyFrame(int index)
+{
+	for (int i = 0; i < columns.size(); ++i)
+	{
+		sFrameColumn &column = columns[i];
+		if (column.components > 0)
+			column.values.insert(index * column.components, column.components, 0.0);
+		else
+			column.otherValues.insert(index, cMultiVal());
+	}
+	frameStates.insert(index, sFrameState());
+}
+
+void cAnimationFrames::StoreFrame(int index, const sAnimationFrame &frame)
+{
+	for (int i = 0; i < listOfParameters.size(); ++i)
+	{
+		sParameterDescription &description = listOfParameters[i];
+		description.frameHandle =
+			frame.parameters.FindHandle(FullParameterName(i), description.frameHandle);
+		if (frame.parameters.IsValidHandle(description.frameHandle))
+			StoreValue(i, index, frame.parameters.GetAsOneParameter(description.frameHandle));
+	}
+
+	sFrameState &state = frameStates[index];
+	state.thumbnail = frame.thumbnail;
+	state.alreadyRendered = frame.alreadyRendered;
+	state.alreadyRenderedSubFrames = frame.alreadyRenderedSubFrames;
+}
+
+void cAnimationFrames::StoreValue(int parameterIndex, int index, const cOneParameter &value)
+{
+	sFrameColumn &column = columns[parameterIndex];
+	if (column.prototype.IsEmpty())
+	{
+		// type of the column is known after the first value is stored
+		column.prototype = value;
+		column.components = NumberOfComponents(value.GetValueType());
+		column.values.fill(0.0, column.components * frameStates.size());
+		column.otherValues.fill(cMultiVal(), column.components > 0 ? 0 : frameStates.size());
+	}
+
+	cMultiVal multi = value.GetMultival(valueActual);
+	if (column.components > 0)
+	{
+		double *values = column.values.data() + index * column.components;
+		switch (column.prototype.GetValueType())
+		{
+			case typeRgb:
+			{
+				sRGB v;
+				multi.Get(v);
+				values[0] = v.R;
+				values[1] = v.G;
+				values[2] = v.B;
+				break;
+			}
+			case typeVector3:
+			{
+				CVector3 v;
+				multi.Get(v);
+				values[0] = v.x;
+				values[1] = v.y;
+				values[2] = v.z;
+				break;
+			}
+			case typeVector4:
+			{
+				CVector4 v;
+				multi.Get(v);
+				values[0] = v.x;
+				values[1] = v.y;
+				values[2] = v.z;
+				values[3] = v.w;
+				break;
+			}
+			case typeInt:
+			case typeBool:
+			{
+				int v;
+				multi.Get(v);
+				values[0] = v;
+				break;
+			}
+			default: multi.Get(values[0]); break;
+		}
+	}
+	else
+	{
+		column.otherValues[index] = multi;
+	}
+}
+
+cOneParameter cAnimationFrames::GetFrameValue(int index, int parameterIndex) const
+{
+	const sFrameColumn &column = columns.at(parameterIndex);
+	cOneParameter value = column.prototype;
+	if (value.IsEmpty()) return value;
+
+	if (column.components > 0)
+	{
+		const double *values = column.values.constData() + index * column.components;
+		cMultiVal multi;
+		switch (value.GetValueType())
+		{
+			case typeRgb: multi.Store(sRGB((int)values[0], (int)values[1], (int)values[2])); break;
+			case typeVector3: multi.Store(CVector3(values[0], values[1], values[2])); break;
+			case typeVector4:
+				multi.Store(CVector4(values[0], values[1], values[2], values[3]));
+				break;
+			case typeInt: multi.Store((int)values[0]); break;
+			case typeBool: multi.Store(values[0] != 0.0); break;
+			default: multi.Store(values[0]); break;
+		}
+		value.SetMultival(multi, valueActual);
+	}
+	else
+	{
+		value.SetMultival(column.otherValues.at(index), valueActual);
+	}
+	return value;
 }
@@ -33,6 +33,9 @@
  *
  * Handles the 2D matrix of the list of parameters / list of frames
  * and exposes functions to modify this matrix.
+ *
+ * Frames are stored in columns: values of one parameter from all frames are kept
+ * in one contiguous array. Container of a single frame is created only on demand.
  */
 
 #ifndef MANDELBULBER2_SRC_ANIMATION_FRAMES_HPP_
@@ -72,6 +75,9 @@ public:
 		QString containerName;
 		parameterContainer::enumVarType varType;
 		parameterContainer::enumMorphType morphType;
+		// last used handles in frame and in destination container
+		sParameterHandle frameHandle;
+		sParameterHandle containerHandle;
 	};
 
 	cAnimationFrames();
@@ -79,7 +85,7 @@ public:
 	void AddFrame(
 		const cParameterContainer &params, const cFractalContainer &fractal, int index = -1);
 	void AddFrame(const sAnimationFrame &frame);
-	void ModifyFrame(int index, sAnimationFrame &frame);
+	virtual void ModifyFrame(int index, sAnimationFrame &frame);
 	void GetFrameAndConsolidate(int index, cParameterContainer *params, cFractalContainer *fractal);
 	sAnimationFrame GetFrame(int index) const;
 	int GetNumberOfFrames() const;
@@ -98,22 +104,52 @@ public:
 	cParameterContainer *ContainerSelector(
 		QString containerName, cParameterContainer *params, cFractalContainer *fractal) const;
 	void DeleteFrames(int begin, int end);
-	void Override(QList<sAnimationFrame> _frames, QList<sParameterDescription> _listOfParameters)
-	{
-		frames = _frames;
-		listOfParameters = _listOfParameters;
-	}
-	QList<sAnimationFrame> GetFrames() const { return frames; }
+	void Override(QList<sAnimationFrame> _frames, QList<sParameterDescription> _listOfParameters);
+	QList<sAnimationFrame> GetFrames() const;
 	QList<sParameterDescription> GetListOfParameters() const { return listOfParameters; }
-	void SetListOfParametersAndClear(QList<sParameterDescription> _listOfParameters)
-	{
-		listOfParameters = _listOfParameters;
-		frames.clear();
-	}
+	void SetListOfParametersAndClear(QList<sParameterDescription> _listOfParameters);
 	int IndexOnList(QString parameterName, QString containerName);
 
+	// value of one animated parameter (index on list of parameters) in given frame
+	cOneParameter GetFrameValue(int index, int parameterIndex) const;
+
 protected:
-	QList<sAnimationFrame> frames;
+	// values of one animated parameter from all frames
+	struct sFrameColumn
+	{
+		sFrameColumn() : components(0) {}
+
+		// type, limits and morph type of the parameter
+		cOneParameter prototype;
+		// number of numbers per frame, 0 for strings and palettes kept in otherValues
+		int components;
+		QVector<double> values;
+		QVector<cMultiVal> otherValues;
+	};
+
+	// data of the frame which is not a parameter
+	struct sFrameState
+	{
+		sFrameState() : alreadyRendered(false) {}
+
+		QImage thumbnail;
+		bool alreadyRendered;
+		QList<bool> alreadyRenderedSubFrames;
+	};
+
+	static int NumberOfComponents(enumVarType type);
+	void InsertEmptyFrame(int index);
+	void StoreFrame(int index, const sAnimationFrame &frame);
+	void StoreValue(int parameterIndex, int index, const cOneParameter &value);
+	QString FullParameterName(int parameterIndex) const
+	{
+		return listOfParameters.at(parameterIndex).containerName + "_"
+					 + listOfParameters.at(parameterIndex).parameterName;
+	}
+
+	// columns are in the same order as listOfParameters
+	QList<sFrameColumn> columns;
+	QList<sFrameState> frameStates;
 	QList<sParameterDescription> listOfParameters;
 };
 
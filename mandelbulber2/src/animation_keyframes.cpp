@@ -46,19 +46,31 @@
 #include "../qt/system_tray.hpp"
 #include "../qt/thumbnail_widget.h"
 #include "../src/render_window.hpp"
+#include "calculate_distance.hpp"
 #include "cimage.hpp"
+#include "concurrent_frames.hpp"
 #include "dock_animation.h"
 #include "dock_statistics.h"
 #include "files.h"
+#include "fractparams.hpp"
+#include "frame_claims.hpp"
 #include "global_data.hpp"
 #include "headless.h"
+#include "image_save_queue.hpp"
 #include "interface.hpp"
 #include "netrender.hpp"
+#include "nine_fractals.hpp"
 #include "render_job.hpp"
+#include "render_time_budget.hpp"
 #include "rendering_configuration.hpp"
+#include "resource_report.hpp"
+#include "settings.hpp"
 #include "ui_dock_animation.h"
 #include "undo.h"
 
+// number of frames interpolated at once when checking for collisions
+#define COLLISION_CHECK_WINDOW 64
+
 cKeyframeAnimation *gKeyframeAnimation = NULL;
 
 cKeyframeAnimation::cKeyframeAnimation(cInterface *_interface, cKeyframes *_frames, cImage *_image,
@@ -69,6 +81,9 @@ cKeyframeAnimation::cKeyframeAnimation(cInterface *_interface, cKeyframes *_fram
 	imageWidget = _imageWidget;
 	params = _params;
 	fractalParams = _fractal;
+	netRenderFrameDistribution = false;
+	netRenderServerFrame = -1;
+	resourceReport = NULL;
 
 	if (mainInterface->mainWindow)
 	{
@@ -500,6 +515,19 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 	connect(
 		renderJob, SIGNAL(updateStatistics(cStatistics)), this, SIGNAL(updateStatistics(cStatistics)));
 
+	// frames are claimed with lock files, so many instances can render to the same folder
+	bool farmMode = params->Get<bool>("anim_farm_mode");
+	cFrameClaims farmClaims(params->Get<int>("anim_farm_claim_timeout"));
+
+	// frames are saved in background while next frame is rendered
+	// (in farm mode frame has to be saved before its claim is released)
+	cImageSaveQueue saveQueue(farmMode ? 0 : params->Get<int>("anim_save_queue_depth"));
+
+	// NetRender clients render whole frames instead of lines of every frame
+	bool distributeFrames = gNetRender->IsServer() && gNetRender->GetClientCount() > 0
+													&& params->Get<bool>("netrender_frame_distribution")
+													&& !params->Get<bool>("stereo_enabled") && !farmMode;
+
 	cRenderingConfiguration config;
 	config.EnableNetRender();
 
@@ -509,9 +537,14 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 		config.DisableProgressiveRender();
 		config.EnableNetRender();
 	}
+	if (distributeFrames) config.DisableNetRender();
 
 	renderJob->Init(cRenderJob::keyframeAnim, config);
 
+	// SSAO and DOF of frame are done by the save queue while next frame is rendered
+	renderJob->SetDeferredPostProcessing(
+		params->Get<bool>("anim_deferred_post_processing") && !farmMode);
+
 	cProgressText progressText;
 	progressText.ResetTimer();
 
@@ -572,7 +605,8 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 		int unrenderedTotal = keyframes->GetUnrenderedTotal();
 
 		// message if all frames are already rendered
-		if (keyframes->GetNumberOfFrames() - 1 > 0 && unrenderedTotal == 0)
+		// in farm mode other instances could have finished the animation
+		if (keyframes->GetNumberOfFrames() - 1 > 0 && unrenderedTotal == 0 && !farmMode)
 		{
 			bool deletePreviousRender;
 			QString questionTitle = QObject::tr("Truncate Image Folder");
@@ -621,22 +655,60 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 
 		gKeyframes->ClearMorphCache();
 
-		// main loop for rendering of frames
-		for (int index = 0; index < keyframes->GetNumberOfFrames() - 1; ++index)
+		if (distributeFrames) distributeFrames = StartNetRenderFrameDistribution(renderJob);
+
+		bool pipelineFrames = gNetRender->IsServer() && !distributeFrames
+													&& params->Get<bool>("netrender_job_pipelining")
+													&& !params->Get<bool>("stereo_enabled") && !farmMode;
+		bool farmFramesSkipped = false;
+
+		// small frames are rendered concurrently, each one with own image
+		QScopedPointer<cConcurrentFrames> concurrentFrames;
+		int numberOfConcurrentFrames = cConcurrentFrames::NumberOfConcurrentFrames(params);
+		if (numberOfConcurrentFrames > 1 && !distributeFrames && !pipelineFrames)
+		{
+			concurrentFrames.reset(new cConcurrentFrames(
+				numberOfConcurrentFrames, params->Get<int>("limit_CPU_cores"), cRenderJob::keyframeAnim));
+		}
+
+		// hashes of parameters of rendered frames and their file names
+		QHash<QString, QString> renderedFrames;
+		bool skipIdenticalFrames = params->Get<bool>("keyframe_skip_identical_frames")
+															 && !distributeFrames && !pipelineFrames;
+
+		// with frame distribution frames of disconnected clients are missing after the first pass.
+		// They are rendered locally in the second one
+		QList<int> framesToRender = UnrenderedFrames();
+		for (int pass = 0; pass < 2 && !framesToRender.isEmpty(); pass++)
 		{
-			//-------------- rendering of interpolated keyframes ----------------
-			for (int subindex = 0; subindex < keyframes->GetFramesPerKeyframe(); subindex++)
+			// main loop for rendering of frames
+			for (int i = 0; i < framesToRender.size(); i++)
 			{
-				// skip already rendered frame
+				int frameIndex = framesToRender.at(i);
+				int index = frameIndex / keyframes->GetFramesPerKeyframe();
+				int subindex = frameIndex % keyframes->GetFramesPerKeyframe();
+
+				// skip frame already rendered by NetRender client
 				if (keyframes->GetFrame(index).alreadyRenderedSubFrames[subindex])
 				{
 					continue;
 				}
 
-				int frameIndex = index * keyframes->GetFramesPerKeyframe() + subindex;
+				// frame is being rendered by NetRender client
+				if (distributeFrames && gNetRender->IsFrameAssigned(frameIndex)) continue;
+
+				// frame is rendered by other instance of render farm
+				if (farmMode && !farmClaims.Claim(GetKeyframeFilename(index, subindex)))
+				{
+					if (!QFile::exists(GetKeyframeFilename(index, subindex))) farmFramesSkipped = true;
+					continue;
+				}
+				netRenderServerFrame = frameIndex;
 
 				double percentDoneFrame;
-				if (unrenderedTotal > 0)
+				if (unrenderedTotal > 0 && distributeFrames)
+					percentDoneFrame = 1.0 - (keyframes->GetUnrenderedTotal() * 1.0) / unrenderedTotal;
+				else if (unrenderedTotal > 0)
 					percentDoneFrame =
 						(keyframes->GetUnrenderedTillIndex(frameIndex) * 1.0) / unrenderedTotal;
 				else
@@ -649,6 +721,9 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 					percentDoneFrame, cProgressText::progress_ANIMATION);
 
 				if (*stopRequest) throw false;
+
+				// next frames are interpolated in advance, so it's not done for every frame separately
+				keyframes->PrecalculateInterpolatedFrames(frameIndex, systemData.numberOfThreads * 4);
 				keyframes->GetInterpolatedFrameAndConsolidate(frameIndex, params, fractalParams);
 
 				// recalculation of camera rotation and distance (just for display purposes)
@@ -664,28 +739,109 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 					mainInterface->SynchronizeInterface(params, fractalParams, qInterface::write);
 
 					// show distance in statistics table
-					double distance = mainInterface->GetDistanceForPoint(
+					mainInterface->mainWindow->GetWidgetDockStatistics()->RequestDistanceToFractal(
 						params->Get<CVector3>("camera"), params, fractalParams);
-					mainInterface->mainWindow->GetWidgetDockStatistics()->UpdateDistanceToFractal(distance);
 				}
 
-				if (gNetRender->IsServer())
+				// with pipelining clients are already working on this frame
+				if (gNetRender->IsServer() && !distributeFrames && !gNetRender->HasNextJob())
 				{
 					gNetRender->WaitForAllClientsReady(10.0);
 				}
 
 				params->Set("frame_no", frameIndex);
-				renderJob->UpdateParameters(params, fractalParams);
+
+				// frame with the same parameters as already rendered one is copied
+				if (skipIdenticalFrames)
+				{
+					QString frameHash = FrameHash(params, fractalParams);
+					QString filename = GetKeyframeFilename(index, subindex);
+					if (renderedFrames.contains(frameHash))
+					{
+						// source frame has to be saved before copying
+						if (concurrentFrames && !concurrentFrames->RenderFrames(stopRequest, &saveQueue))
+							throw false;
+						saveQueue.Flush();
+						if (CopyFrameFiles(renderedFrames.value(frameHash), filename))
+						{
+							farmClaims.Release();
+							netRenderServerFrame = -1;
+							continue;
+						}
+					}
+					renderedFrames.insert(frameHash, filename);
+				}
+
+				if (pipelineFrames) SetNextNetRenderFrame(renderJob, frameIndex);
+
+				if (concurrentFrames)
+				{
+					concurrentFrames->AddFrame(*params, *fractalParams, GetKeyframeFilename(index, subindex),
+						(ImageFileSave::enumImageFileType)params->Get<int>("keyframe_animation_image_type"));
+					if (concurrentFrames->IsFull())
+					{
+						if (!concurrentFrames->RenderFrames(stopRequest, &saveQueue)) throw false;
+					}
+					continue;
+				}
+
+				// quality of the frame is reduced to render it within time budget
+				if (params->Get<double>("render_time_budget") > 0.0)
+				{
+					cParameterContainer framePar = *params;
+					cRenderTimeBudget timeBudget(params->Get<double>("render_time_budget"));
+					timeBudget.Fit(&framePar, *fractalParams);
+					renderJob->UpdateParameters(&framePar, fractalParams);
+				}
+				else
+				{
+					renderJob->UpdateParameters(params, fractalParams);
+				}
 				int result = renderJob->Execute();
 				if (!result) throw false;
+				if (resourceReport) resourceReport->AddStatistics(renderJob->GetStatistics());
 				QString filename = GetKeyframeFilename(index, subindex);
 				ImageFileSave::enumImageFileType fileType =
 					(ImageFileSave::enumImageFileType)params->Get<int>("keyframe_animation_image_type");
-				SaveImage(filename, fileType, image, gMainInterface->mainWindow);
+				saveQueue.Enqueue(filename, fileType, image, gMainInterface->mainWindow,
+					renderJob->IsPostProcessingDeferred() ? renderJob->GetParameters() : NULL);
+				farmClaims.Release();
+
+				netRenderServerFrame = -1;
+				if (distributeFrames)
+				{
+					cAnimationFrames::sAnimationFrame frame = keyframes->GetFrame(index);
+					frame.alreadyRenderedSubFrames[subindex] = true;
+					keyframes->ModifyFrame(index, frame);
+				}
 			}
-			//--------------------------------------------------------------------
+
+			// the last incomplete batch of concurrent frames
+			if (concurrentFrames && !concurrentFrames->RenderFrames(stopRequest, &saveQueue))
+				throw false;
+
+			if (!distributeFrames) break;
+
+			if (!WaitForNetRenderFrames(stopRequest)) throw false;
+			StopNetRenderFrameDistribution();
+			distributeFrames = false;
+
+			// frames of disconnected clients are missing
+			framesToRender = UnrenderedFrames();
 		}
 
+		// claims of terminated instances will expire, so missing frames are checked again
+		if (farmFramesSkipped)
+		{
+			emit updateProgressAndStatus(QObject::tr("Waiting for other instances"),
+				progressText.getText(1.0), 1.0, cProgressText::progress_ANIMATION);
+			cFrameClaims::WaitForOtherInstances(stopRequest);
+			if (*stopRequest) throw false;
+			delete renderJob;
+			return RenderKeyframes(stopRequest);
+		}
+
+		saveQueue.Flush();
 		emit updateProgressAndStatus(QObject::tr("Animation finished"), progressText.getText(1.0), 1.0,
 			cProgressText::progress_ANIMATION);
 		emit updateProgressHide();
@@ -694,6 +850,7 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 	}
 	catch (bool ex)
 	{
+		StopNetRenderFrameDistribution();
 		emit updateProgressAndStatus(QObject::tr("Rendering terminated"), progressText.getText(1.0),
 			cProgressText::progress_ANIMATION);
 		emit updateProgressHide();
@@ -705,6 +862,135 @@ bool cKeyframeAnimation::RenderKeyframes(bool *stopRequest)
 	return true;
 }
 
+void cKeyframeAnimation::SetNextNetRenderFrame(cRenderJob *renderJob, int index)
+{
+	int framesPerKeyframe = keyframes->GetFramesPerKeyframe();
+	int totalFrames = (keyframes->GetNumberOfFrames() - 1) * framesPerKeyframe;
+
+	int nextIndex = index + 1;
+	while (nextIndex < totalFrames
+				 && keyframes->GetFrame(nextIndex / framesPerKeyframe)
+							.alreadyRenderedSubFrames[nextIndex % framesPerKeyframe])
+		nextIndex++;
+
+	if (nextIndex < totalFrames)
+	{
+		cParameterContainer nextParams = *params;
+		cFractalContainer nextFractalParams = *fractalParams;
+		keyframes->GetInterpolatedFrameAndConsolidate(nextIndex, &nextParams, &nextFractalParams);
+
+		// the same values as calculated in main loop of RenderKeyframes()
+		CVector3 camera = nextParams.Get<CVector3>("camera");
+		CVector3 target = nextParams.Get<CVector3>("target");
+		CVector3 top = nextParams.Get<CVector3>("camera_top");
+		cCameraTarget cameraTarget(camera, target, top);
+		nextParams.Set("camera_rotation", cameraTarget.GetRotation() * 180.0 / M_PI);
+		nextParams.Set("camera_distance_to_target", cameraTarget.GetDistance());
+		nextParams.Set("frame_no", nextIndex);
+		renderJob->SetNextNetRenderJob(&nextParams, &nextFractalParams);
+	}
+	else
+	{
+		renderJob->SetNextNetRenderJob(NULL, NULL);
+	}
+}
+
+bool cKeyframeAnimation::StartNetRenderFrameDistribution(cRenderJob *renderJob)
+{
+	if (!gNetRender->Block()) return false;
+
+	netRenderTextures = renderJob->CreateListOfUsedTextures();
+	connect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotNetRenderClientIdle(int)));
+	connect(gNetRender, SIGNAL(FrameReceived(int, bool)), this,
+		SLOT(slotNetRenderFrameReceived(int, bool)));
+	netRenderFrameDistribution = true;
+	gNetRender->StartFrameDistribution();
+	return true;
+}
+
+void cKeyframeAnimation::StopNetRenderFrameDistribution()
+{
+	if (!netRenderFrameDistribution) return;
+
+	netRenderFrameDistribution = false;
+	netRenderServerFrame = -1;
+	gNetRender->StopFrameDistribution();
+	disconnect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotNetRenderClientIdle(int)));
+	disconnect(gNetRender, SIGNAL(FrameReceived(int, bool)), this,
+		SLOT(slotNetRenderFrameReceived(int, bool)));
+	gNetRender->Release();
+}
+
+bool cKeyframeAnimation::WaitForNetRenderFrames(bool *stopRequest)
+{
+	while (gNetRender->GetNumberOfAssignedFrames() > 0)
+	{
+		if (*stopRequest) return false;
+		gApplication->processEvents();
+		Wait(10);
+	}
+	return true;
+}
+
+QList<int> cKeyframeAnimation::UnrenderedFrames() const
+{
+	QList<int> frames;
+	for (int index = 0; index < keyframes->GetNumberOfFrames() - 1; ++index)
+	{
+		cAnimationFrames::sAnimationFrame frame = keyframes->GetFrame(index);
+		for (int subindex = 0; subindex < keyframes->GetFramesPerKeyframe(); subindex++)
+		{
+			if (!frame.alreadyRenderedSubFrames[subindex])
+				frames.append(index * keyframes->GetFramesPerKeyframe() + subindex);
+		}
+	}
+	return frames;
+}
+
+void cKeyframeAnimation::slotNetRenderClientIdle(int clientIndex)
+{
+	// image size is the same in all frames
+	if (!gNetRender->HasMemoryForFrame(clientIndex, *params))
+	{
+		WriteLog(QString("NetRender - client #%1 doesn't have enough memory for frames")
+							 .arg(clientIndex),
+			1);
+		return;
+	}
+
+	// client gets the first frame which is not rendered yet
+	for (int index = 0; index < keyframes->GetNumberOfFrames() - 1; ++index)
+	{
+		for (int subindex = 0; subindex < keyframes->GetFramesPerKeyframe(); subindex++)
+		{
+			int frameIndex = index * keyframes->GetFramesPerKeyframe() + subindex;
+			if (keyframes->GetFrame(index).alreadyRenderedSubFrames[subindex]
+					|| frameIndex == netRenderServerFrame || gNetRender->IsFrameAssigned(frameIndex))
+				continue;
+
+			cParameterContainer frameParams = *params;
+			cFractalContainer frameFractal = *fractalParams;
+			keyframes->GetInterpolatedFrameAndConsolidate(frameIndex, &frameParams, &frameFractal);
+			frameParams.Set("frame_no", frameIndex);
+			gNetRender->SendFrame(clientIndex, frameIndex, frameParams, frameFractal, netRenderTextures,
+				params->Get<int>("keyframe_animation_image_type"), GetKeyframeFilename(index, subindex));
+			return;
+		}
+	}
+}
+
+void cKeyframeAnimation::slotNetRenderFrameReceived(int frameIndex, bool success)
+{
+	int index = frameIndex / keyframes->GetFramesPerKeyframe();
+	int subindex = frameIndex % keyframes->GetFramesPerKeyframe();
+	if (success && index < keyframes->GetNumberOfFrames() - 1)
+	{
+		cAnimationFrames::sAnimationFrame frame = keyframes->GetFrame(index);
+		frame.alreadyRenderedSubFrames[subindex] = true;
+		keyframes->ModifyFrame(index, frame);
+	}
+}
+
 void cKeyframeAnimation::RefreshTable()
 {
 	mainInterface->progressBarAnimation->show();
@@ -731,6 +1017,8 @@ void cKeyframeAnimation::RefreshTable()
 			keyframes->GetFrameAndConsolidate(i, &tempPar, &tempFract);
 			tempPar.Set("frame_no", keyframes->GetFramesPerKeyframe() * i);
 			thumbWidget->AssignParameters(tempPar, tempFract);
+			// first frame of keyframe can be already rendered
+			thumbWidget->SetSourceImageFile(GetKeyframeFilename(i, 0));
 			table->setCellWidget(0, newColumn, thumbWidget);
 		}
 		if (i % 100 == 0)
@@ -1069,7 +1357,7 @@ void cKeyframeAnimation::slotExportKeyframesToFlight()
 	gUndo.Store(params, fractalParams, gAnimFrames, keyframes);
 	keyframes->SetFramesPerKeyframe(params->Get<int>("frames_per_keyframe"));
 
-	if (gAnimFrames->GetFrames().size() > 0)
+	if (gAnimFrames->GetNumberOfFrames() > 0)
 	{
 		QMessageBox::StandardButton reply;
 		reply = QMessageBox::question(
@@ -1139,34 +1427,157 @@ QList<int> cKeyframeAnimation::CheckForCollisions(double minDist, bool *stopRequ
 
 	*stopRequest = false;
 
-	for (int key = 0; key < keyframes->GetNumberOfFrames() - 1; key++)
+	int totalFrames = (keyframes->GetNumberOfFrames() - 1) * keyframes->GetFramesPerKeyframe();
+	if (totalFrames <= 0) return listOfCollisions;
+
+	// when only the camera moves, the fractal is the same in all frames
+	bool staticScene = !IsWaterEnabled(&tempPar);
+	QStringList cameraParameters = cParamRender::UpdatableParameters();
+	QList<cAnimationFrames::sParameterDescription> animated = keyframes->GetListOfUsedParameters();
+	for (int i = 0; i < animated.size(); i++)
 	{
-		updateProgressAndStatus(QObject::tr("Checking for collissions"),
-			QObject::tr("Checking for collissions on keyframe # %1").arg(key),
-			(double)key / (keyframes->GetNumberOfFrames() - 1.0), cProgressText::progress_ANIMATION);
+		if (animated[i].containerName != "main"
+				|| !cameraParameters.contains(animated[i].parameterName))
+			staticScene = false;
+	}
 
-		for (int subindex = 0; subindex < keyframes->GetFramesPerKeyframe(); subindex++)
+	QVector<double> distances(totalFrames, -1.0); // -1 means not checked
+	QList<int> framesToCheck;
+	if (staticScene)
+	{
+		// positions of camera in all frames
+		QVector<CVector3> cameras(totalFrames);
+		for (int frameIndex = 0; frameIndex < totalFrames; frameIndex++)
+		{
+			if (frameIndex % COLLISION_CHECK_WINDOW == 0)
+			{
+				updateProgressAndStatus(QObject::tr("Checking for collissions"),
+					QObject::tr("Interpolating camera positions"), 0.0, cProgressText::progress_ANIMATION);
+				gApplication->processEvents();
+				if (*stopRequest) return listOfCollisions;
+				keyframes->PrecalculateInterpolatedFrames(frameIndex, COLLISION_CHECK_WINDOW);
+			}
+			keyframes->GetInterpolatedFrameAndConsolidate(frameIndex, &tempPar, &tempFractPar);
+			cameras[frameIndex] = tempPar.Get<CVector3>("camera");
+		}
+
+		cParamRender paramRender(&tempPar);
+		cNineFractals fractals(&tempFractPar, &tempPar);
+
+		// coarse sweep
+		int step = qMax(1, keyframes->GetFramesPerKeyframe() / 8);
+		for (int frameIndex = 0; frameIndex < totalFrames; frameIndex += step)
+			framesToCheck.append(frameIndex);
+		if (framesToCheck.last() != totalFrames - 1) framesToCheck.append(totalFrames - 1);
+		if (!CalculateCollisionDistances(
+					paramRender, fractals, cameras, framesToCheck, &distances, 0.0, 0.5, stopRequest))
+			return listOfCollisions;
+
+		// refinement. Frame is safe if it is much closer to the checked frame than the fractal.
+		// Distance estimation is not exact, so only half of the distance is used
+		QList<int> refinedFrames;
+		int previous = 0;
+		for (int k = 1; k < framesToCheck.size(); k++)
+		{
+			int next = framesToCheck.at(k);
+			for (int frameIndex = previous + 1; frameIndex < next; frameIndex++)
+			{
+				double safePrevious = 0.5 * (distances[previous] - minDist);
+				double safeNext = 0.5 * (distances[next] - minDist);
+				if ((cameras[frameIndex] - cameras[previous]).Length() >= safePrevious
+						&& (cameras[frameIndex] - cameras[next]).Length() >= safeNext)
+					refinedFrames.append(frameIndex);
+			}
+			previous = next;
+		}
+		if (!CalculateCollisionDistances(
+					paramRender, fractals, cameras, refinedFrames, &distances, 0.5, 0.5, stopRequest))
+			return listOfCollisions;
+	}
+	else
+	{
+		// every frame has own fractal parameters, so they are prepared in windows
+		for (int first = 0; first < totalFrames; first += COLLISION_CHECK_WINDOW)
 		{
+			updateProgressAndStatus(QObject::tr("Checking for collissions"),
+				QObject::tr("Checking for collissions on frame # %1").arg(first),
+				(double)first / totalFrames, cProgressText::progress_ANIMATION);
 			gApplication->processEvents();
 			if (*stopRequest) return listOfCollisions;
-			int frameIndex = key * keyframes->GetFramesPerKeyframe() + subindex;
-			keyframes->GetInterpolatedFrameAndConsolidate(frameIndex, &tempPar, &tempFractPar);
-			tempPar.Set("frame_no", frameIndex);
-			CVector3 point = tempPar.Get<CVector3>("camera");
-			double dist = mainInterface->GetDistanceForPoint(point, &tempPar, &tempFractPar);
-			if (dist < minDist)
+
+			int count = qMin(COLLISION_CHECK_WINDOW, totalFrames - first);
+			keyframes->PrecalculateInterpolatedFrames(first, count);
+			QVector<cParameterContainer> framePars(count);
+			QVector<cFractalContainer> frameFractals(count);
+			for (int i = 0; i < count; i++)
 			{
-				listOfCollisions.append(frameIndex);
+				keyframes->GetInterpolatedFrameAndConsolidate(first + i, &tempPar, &tempFractPar);
+				tempPar.Set("frame_no", first + i);
+				framePars[i] = tempPar;
+				frameFractals[i] = tempFractPar;
+			}
+
+#pragma omp parallel for schedule(dynamic, 1)
+			for (int i = 0; i < count; i++)
+			{
+				cParamRender paramRender(&framePars[i]);
+				cNineFractals fractals(&frameFractals[i], &framePars[i]);
+				sDistanceIn in(framePars[i].Get<CVector3>("camera"), 0, false);
+				sDistanceOut out;
+				distances[first + i] = CalculateDistance(paramRender, fractals, in, &out);
 			}
 		}
 	}
 
+	for (int frameIndex = 0; frameIndex < totalFrames; frameIndex++)
+	{
+		if (distances[frameIndex] >= 0.0 && distances[frameIndex] < minDist)
+			listOfCollisions.append(frameIndex);
+	}
+
 	updateProgressAndStatus(QObject::tr("Checking for collissions"),
 		QObject::tr("Checking for collisions finished"), 1.0, cProgressText::progress_ANIMATION);
 
 	return listOfCollisions;
 }
 
+bool cKeyframeAnimation::CalculateCollisionDistances(const cParamRender &paramRender,
+	const cNineFractals &fractals, const QVector<CVector3> &cameras, const QList<int> &frames,
+	QVector<double> *distances, double progressStart, double progressRange, bool *stopRequest)
+{
+	const int batchSize = 16;
+	QVector<CVector3> points(frames.size());
+	for (int i = 0; i < frames.size(); i++)
+		points[i] = cameras[frames.at(i)];
+	QVector<double> results(frames.size());
+	QVector<double> detailSizes(batchSize, 0.0);
+
+	// points are calculated in batches, and groups of batches between refreshing of progress
+	int pointsPerStep = batchSize * qMax(1, systemData.numberOfThreads) * 4;
+	for (int first = 0; first < frames.size(); first += pointsPerStep)
+	{
+		updateProgressAndStatus(QObject::tr("Checking for collissions"),
+			QObject::tr("Checking for collissions on frame # %1").arg(frames.at(first)),
+			progressStart + progressRange * first / frames.size(), cProgressText::progress_ANIMATION);
+		gApplication->processEvents();
+		if (*stopRequest) return false;
+
+		int last = qMin(first + pointsPerStep, frames.size());
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int batch = first; batch < last; batch += batchSize)
+		{
+			int count = qMin(batchSize, last - batch);
+			sDistanceOut outs[batchSize];
+			CalculateDistanceBatch(paramRender, fractals, points.constData() + batch,
+				detailSizes.constData(), count, results.data() + batch, outs);
+		}
+	}
+
+	for (int i = 0; i < frames.size(); i++)
+		(*distances)[frames.at(i)] = results[i];
+	return true;
+}
+
 void cKeyframeAnimation::slotValidate()
 {
 	// updating parameters
@@ -1246,3 +1657,53 @@ void cKeyframeAnimation::slotSetConstantTargetDistance()
 	}
 	RefreshTable();
 }
+
+QString cKeyframeAnimation::FrameHash(
+	const cParameterContainer *par, const cFractalContainer *fractPar)
+{
+	// frame number changes only animation of water
+	cParameterContainer frame = *par;
+	if (!IsWaterEnabled(&frame)) frame.Set("frame_no", frame.GetDefault<int>("frame_no"));
+
+	return cSettings::StructuralHash(&frame, fractPar);
+}
+
+bool cKeyframeAnimation::IsWaterEnabled(const cParameterContainer *par)
+{
+	QList<QString> parameterList = par->GetListOfParameters();
+	for (int i = 0; i < parameterList.size(); i++)
+	{
+		const QString &name = parameterList.at(i);
+		if (name.startsWith("primitive_water_") && name.endsWith("_enabled") && par->Get<bool>(name))
+			return true;
+	}
+	return false;
+}
+
+bool cKeyframeAnimation::CopyFrameFiles(const QString &sourceFilename, const QString &destFilename)
+{
+	// every image channel can be saved in separate file with postfix after frame name
+	QFileInfo sourceInfo(sourceFilename);
+	QString sourceBase = sourceInfo.completeBaseName();
+	QString destBase = QFileInfo(destFilename).absolutePath() + QDir::separator()
+										 + QFileInfo(destFilename).completeBaseName();
+	QStringList files = sourceInfo.absoluteDir().entryList(
+		QStringList() << sourceBase + ".*" << sourceBase + "_*", QDir::Files);
+
+	bool copied = false;
+	for (int i = 0; i < files.size(); i++)
+	{
+		if (files.at(i).endsWith(".lock")) continue;
+		QString source = sourceInfo.absolutePath() + QDir::separator() + files.at(i);
+		QString dest = destBase + files.at(i).mid(sourceBase.length());
+		if (QFile::exists(dest)) QFile::remove(dest);
+		if (!QFile::copy(source, dest))
+		{
+			qWarning() << "cKeyframeAnimation::CopyFrameFiles(): cannot copy" << source << "to" << dest;
+			return false;
+		}
+		copied = true;
+	}
+	if (copied) WriteLogString("Identical frame copied", destFilename, 2);
+	return copied;
+}
@@ -54,6 +54,10 @@ class cInterface;
 class cFractalContainer;
 class cParameterContainer;
 class MyTableWidgetKeyframes;
+class cRenderJob;
+class cResourceReport;
+class cParamRender;
+class cNineFractals;
 
 namespace Ui
 {
@@ -80,6 +84,8 @@ public:
 	parameterContainer::enumMorphType GetMorphType(int row);
 	void ChangeMorphType(int row, parameterContainer::enumMorphType morphType);
 	QList<int> CheckForCollisions(double minDist, bool *stopRequest);
+	// statistics of rendered frames are added to the report (NULL - no report)
+	void SetResourceReport(cResourceReport *report) { resourceReport = report; }
 
 public slots:
 	void UpdateLimitsForFrameRange();
@@ -101,6 +107,8 @@ private slots:
 	void slotValidate();
 	void slotCellDoubleClicked(int row, int column);
 	void slotSetConstantTargetDistance();
+	void slotNetRenderClientIdle(int clientIndex);
+	void slotNetRenderFrameReceived(int frameIndex, bool success);
 
 private:
 	void PrepareTable();
@@ -110,7 +118,25 @@ private:
 	int AddColumn(const cAnimationFrames::sAnimationFrame &frame, int index = -1);
 	void NewKeyframe(int index);
 	QString GetKeyframeFilename(int index, int subIndex);
+	// hash of frame parameters which affect the image
+	static QString FrameHash(const cParameterContainer *par, const cFractalContainer *fractPar);
+	// copies all files of rendered frame. Returns false if nothing was copied
+	static bool CopyFrameFiles(const QString &sourceFilename, const QString &destFilename);
+	// water is the only object which changes with frame number
+	static bool IsWaterEnabled(const cParameterContainer *par);
+	// distances to fractal from camera positions of given frames. Returns false when stopped
+	bool CalculateCollisionDistances(const cParamRender &paramRender, const cNineFractals &fractals,
+		const QVector<CVector3> &cameras, const QList<int> &frames, QVector<double> *distances,
+		double progressStart, double progressRange, bool *stopRequest);
 	QColor MorphType2Color(parameterContainer::enumMorphType morphType);
+	bool StartNetRenderFrameDistribution(cRenderJob *renderJob);
+	void StopNetRenderFrameDistribution();
+	// NetRender clients get the next unrendered frame while rendering the current one
+	void SetNextNetRenderFrame(cRenderJob *renderJob, int index);
+	// returns false if rendering was stopped
+	bool WaitForNetRenderFrames(bool *stopRequest);
+	// indexes of frames which are not rendered yet
+	QList<int> UnrenderedFrames() const;
 
 	cInterface *mainInterface;
 	Ui::cDockAnimation *ui;
@@ -123,6 +149,10 @@ private:
 	QVector<int> parameterRows; // position of parameter in table
 	QVector<int> rowParameter;	// index of parameter in row
 	MyTableWidgetKeyframes *table;
+	bool netRenderFrameDistribution; // whole frames are rendered by NetRender clients
+	int netRenderServerFrame; // frame rendered by server during frame distribution (-1 if none)
+	QStringList netRenderTextures; // textures sent with frames to NetRender clients
+	cResourceReport *resourceReport;
 
 signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress,
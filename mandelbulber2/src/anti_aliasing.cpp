@@ -0,0 +1,123 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAntiAliasing class - adaptive supersampling of edge pixels
+ */
+
+#include "anti_aliasing.hpp"
+
+#include "cimage.hpp"
+
+cAntiAliasing::cAntiAliasing(const cRegion<int> &_screenRegion, int _gridSize)
+{
+	screenRegion = _screenRegion;
+	gridSize = _gridSize;
+	if (gridSize < 2) gridSize = 2;
+	width = screenRegion.width;
+	height = screenRegion.height;
+	edges.fill(0, width * height);
+	nextRow.store(screenRegion.y1);
+	rendering = false;
+}
+
+cAntiAliasing::~cAntiAliasing()
+{
+}
+
+// difference between two pixels. Colours are compared in displayable range
+static double PixelDifference(const cImage *image, int x1, int y1, int x2, int y2)
+{
+	sRGBfloat c1 = image->GetPixelImage(x1, y1);
+	sRGBfloat c2 = image->GetPixelImage(x2, y2);
+	double diff = fabs(qBound(0.0f, c1.R, 1.0f) - qBound(0.0f, c2.R, 1.0f));
+	diff = qMax(diff, (double)fabs(qBound(0.0f, c1.G, 1.0f) - qBound(0.0f, c2.G, 1.0f)));
+	diff = qMax(diff, (double)fabs(qBound(0.0f, c1.B, 1.0f) - qBound(0.0f, c2.B, 1.0f)));
+
+	// relative difference of depth (silhouettes and background)
+	double z1 = image->GetPixelZBuffer(x1, y1);
+	double z2 = image->GetPixelZBuffer(x2, y2);
+	double zMin = qMin(z1, z2);
+	if (zMin > 0.0) diff = qMax(diff, fabs(z1 - z2) / zMin);
+
+	if (image->GetImageOptional()->optionalNormal)
+	{
+		sRGBfloat n1 = image->GetPixelNormal(x1, y1);
+		sRGBfloat n2 = image->GetPixelNormal(x2, y2);
+		diff = qMax(diff, (double)fabs(n1.R - n2.R));
+		diff = qMax(diff, (double)fabs(n1.G - n2.G));
+		diff = qMax(diff, (double)fabs(n1.B - n2.B));
+	}
+	return diff;
+}
+
+int cAntiAliasing::DetectEdges(const cImage *image, double threshold)
+{
+	int count = 0;
+	for (int y = screenRegion.y1; y < screenRegion.y2; y++)
+	{
+		for (int x = screenRegion.x1; x < screenRegion.x2; x++)
+		{
+			int index = (y - screenRegion.y1) * width + x - screenRegion.x1;
+			if (x + 1 < screenRegion.x2 && PixelDifference(image, x, y, x + 1, y) > threshold)
+			{
+				edges[index] = 1;
+				edges[index + 1] = 1;
+			}
+			if (y + 1 < screenRegion.y2 && PixelDifference(image, x, y, x, y + 1) > threshold)
+			{
+				edges[index] = 1;
+				edges[index + width] = 1;
+			}
+		}
+	}
+	for (int i = 0; i < edges.size(); i++)
+		if (edges[i]) count++;
+	return count;
+}
+
+bool cAntiAliasing::IsEdge(int x, int y) const
+{
+	return edges[(y - screenRegion.y1) * width + x - screenRegion.x1];
+}
+
+CVector2<double> cAntiAliasing::GetSampleOffset(int index) const
+{
+	int ix = index % gridSize;
+	int iy = index / gridSize;
+	return CVector2<double>((ix + 0.5) / gridSize - 0.5, (iy + 0.5) / gridSize - 0.5);
+}
+
+int cAntiAliasing::NextRow()
+{
+	int row = nextRow.fetchAndAddOrdered(1);
+	if (row >= screenRegion.y2) return -1;
+	return row;
+}
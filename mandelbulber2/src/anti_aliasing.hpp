@@ -0,0 +1,82 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAntiAliasing class - adaptive supersampling of edge pixels
+ *
+ * After the image is rendered with one primary sample per pixel, pixels
+ * which differ too much from their neighbours in colour, depth or normal
+ * vector are marked and later refined with a grid of sub-pixel samples.
+ */
+
+#ifndef MANDELBULBER2_SRC_ANTI_ALIASING_HPP_
+#define MANDELBULBER2_SRC_ANTI_ALIASING_HPP_
+
+#include <QAtomicInt>
+#include <QVector>
+
+#include "region.hpp"
+
+// forward declarations
+class cImage;
+
+class cAntiAliasing
+{
+public:
+	cAntiAliasing(const cRegion<int> &_screenRegion, int _gridSize);
+	~cAntiAliasing();
+
+	// marks pixels on discontinuities. Returns number of marked pixels
+	int DetectEdges(const cImage *image, double threshold);
+	bool IsEdge(int x, int y) const;
+
+	// sub-pixel samples are placed on regular grid (gridSize x gridSize) in pixel
+	int GetNumberOfSamples() const { return gridSize * gridSize; }
+	CVector2<double> GetSampleOffset(int index) const;
+
+	const cRegion<int> &GetRegion() const { return screenRegion; }
+
+	// lines are distributed between rendering threads. Returns -1 if all lines are taken
+	int NextRow();
+
+	bool IsRendering() const { return rendering; }
+	void SetRendering(bool _rendering) { rendering = _rendering; }
+
+private:
+	cRegion<int> screenRegion;
+	int gridSize;
+	int width;
+	int height;
+	QVector<char> edges;
+	QAtomicInt nextRow;
+	bool rendering;
+};
+
+#endif /* MANDELBULBER2_SRC_ANTI_ALIASING_HPP_ */
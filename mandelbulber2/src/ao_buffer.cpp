@@ -0,0 +1,129 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAOBuffer class - multi-ray ambient occlusion rendered in reduced resolution
+ */
+
+#include "ao_buffer.hpp"
+
+// relative depth difference at which weight of sample drops to zero (per one sample spacing)
+#define AO_BUFFER_DEPTH_TOLERANCE 0.02
+// minimum sum of weights of similar samples
+#define AO_BUFFER_MIN_WEIGHT 0.2
+
+cAOBuffer::cAOBuffer(const cRegion<int> &_screenRegion, int _scale)
+{
+	screenRegion = _screenRegion;
+	scale = _scale;
+	if (scale < 1) scale = 1;
+	width = (screenRegion.width + scale - 1) / scale + 1;
+	height = (screenRegion.height + scale - 1) / scale + 1;
+	samples.resize(width * height);
+	nextRow.store(0);
+	rendering = false;
+}
+
+cAOBuffer::~cAOBuffer()
+{
+}
+
+CVector2<int> cAOBuffer::GetSamplePixel(int bx, int by) const
+{
+	int x = qMin(screenRegion.x1 + bx * scale, screenRegion.x2 - 1);
+	int y = qMin(screenRegion.y1 + by * scale, screenRegion.y2 - 1);
+	return CVector2<int>(x, y);
+}
+
+void cAOBuffer::SetSample(
+	int bx, int by, const sRGBAfloat &ao, double depth, const CVector3 &normal)
+{
+	sSample &sample = samples[by * width + bx];
+	sample.ao = ao;
+	sample.depth = depth;
+	sample.normal = normal;
+}
+
+bool cAOBuffer::Interpolate(
+	CVector2<double> pixel, double depth, const CVector3 &normal, sRGBAfloat *ao) const
+{
+	double gx = (pixel.x - screenRegion.x1) / scale;
+	double gy = (pixel.y - screenRegion.y1) / scale;
+	int bx = (int)floor(gx);
+	int by = (int)floor(gy);
+	double fx = gx - bx;
+	double fy = gy - by;
+	double depthTolerance = depth * AO_BUFFER_DEPTH_TOLERANCE * scale;
+
+	sRGBAfloat sum(0.0, 0.0, 0.0, 0.0);
+	double totalWeight = 0.0;
+	for (int j = 0; j <= 1; j++)
+	{
+		for (int i = 0; i <= 1; i++)
+		{
+			int x = bx + i;
+			int y = by + j;
+			if (x < 0 || x >= width || y < 0 || y >= height) continue;
+
+			const sSample &sample = samples[y * width + x];
+			if (sample.depth == 0.0f) continue;
+
+			double weight = (i ? fx : 1.0 - fx) * (j ? fy : 1.0 - fy);
+
+			// range weights: samples on other surfaces are rejected
+			double depthDiff = fabs(sample.depth - depth) / depthTolerance;
+			if (depthDiff >= 1.0) continue;
+			weight *= 1.0 - depthDiff;
+			double cosAngle = sample.normal.Dot(normal);
+			if (cosAngle <= 0.0) continue;
+			weight *= cosAngle * cosAngle * cosAngle * cosAngle;
+
+			sum.R += sample.ao.R * weight;
+			sum.G += sample.ao.G * weight;
+			sum.B += sample.ao.B * weight;
+			totalWeight += weight;
+		}
+	}
+
+	if (totalWeight < AO_BUFFER_MIN_WEIGHT) return false;
+
+	ao->R = sum.R / totalWeight;
+	ao->G = sum.G / totalWeight;
+	ao->B = sum.B / totalWeight;
+	ao->A = 1.0;
+	return true;
+}
+
+int cAOBuffer::NextRow()
+{
+	int row = nextRow.fetchAndAddOrdered(1);
+	if (row >= height) return -1;
+	return row;
+}
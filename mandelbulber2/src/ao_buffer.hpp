@@ -0,0 +1,91 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAOBuffer class - multi-ray ambient occlusion rendered in reduced resolution
+ *
+ * Ambient occlusion of primary ray hits is calculated for every n-th pixel
+ * before the main passes and then upsampled with bilateral filter which
+ * takes into account depth and normal vectors of surrounding samples. If no
+ * sample is similar enough, ambient occlusion is calculated for the pixel.
+ */
+
+#ifndef MANDELBULBER2_SRC_AO_BUFFER_HPP_
+#define MANDELBULBER2_SRC_AO_BUFFER_HPP_
+
+#include <QAtomicInt>
+#include <QVector>
+
+#include "algebra.hpp"
+#include "color_structures.hpp"
+#include "region.hpp"
+
+class cAOBuffer
+{
+public:
+	cAOBuffer(const cRegion<int> &_screenRegion, int _scale);
+	~cAOBuffer();
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	// screen coordinates of pixel where sample is calculated
+	CVector2<int> GetSamplePixel(int bx, int by) const;
+
+	void SetSample(int bx, int by, const sRGBAfloat &ao, double depth, const CVector3 &normal);
+	// bilateral upsampling. Returns false if there are no similar samples around the pixel
+	bool Interpolate(
+		CVector2<double> pixel, double depth, const CVector3 &normal, sRGBAfloat *ao) const;
+
+	// rows of samples are distributed between rendering threads. Returns -1 if all rows are taken
+	int NextRow();
+
+	bool IsRendering() const { return rendering; }
+	void SetRendering(bool _rendering) { rendering = _rendering; }
+
+private:
+	struct sSample
+	{
+		sSample() : depth(0.0f) {}
+		sRGBAfloat ao;
+		CVector3 normal;
+		float depth; // 0 if nothing found
+	};
+
+	cRegion<int> screenRegion;
+	int scale;
+	int width;
+	int height;
+	QVector<sSample> samples;
+	QAtomicInt nextRow;
+	bool rendering;
+};
+
+#endif /* MANDELBULBER2_SRC_AO_BUFFER_HPP_ */
@@ -40,9 +40,13 @@
 #include <QAudioRecorder>
 #include <QAudioFormat>
 #include <QAudioDecoder>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
 #include <QFileInfo>
 
 #include "audio_fft_data.h"
+#include "system.hpp"
 #ifdef USE_SNDFILE
 #include <sndfile.h>
 #endif
@@ -54,17 +58,42 @@ cAudioTrack::cAudioTrack(QObject *parent) : QObject(parent)
 	length = 0;
 	sampleRate = 44100;
 	loaded = false;
+	mappedAudio = NULL;
 }
 
 cAudioTrack::~cAudioTrack()
 {
-	// TODO Auto-generated destructor stub
+	ClosePCMCache();
 }
 
 void cAudioTrack::LoadAudio(const QString &filename)
 {
 	QString sufix = QFileInfo(filename).suffix();
 	loaded = false;
+	fftAudio.clear();
+	rawAudio.clear();
+	memoryReserved = false;
+	length = 0;
+	ClosePCMCache();
+
+	// hash of file content identifies cached PCM and FFT data
+	fileHash.clear();
+	QFile file(filename);
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QCryptographicHash hashCrypt(QCryptographicHash::Md4);
+		hashCrypt.addData(&file);
+		fileHash = hashCrypt.result().toHex();
+		file.close();
+	}
+
+	// audio decoded before is taken from the cache without decoding
+	if (OpenPCMCache())
+	{
+		loaded = true;
+		emit loadingFinished();
+		return;
+	}
 
 #ifdef USE_SNDFILE
 	if (sufix.toLower() == "wav")
@@ -87,26 +116,31 @@ void cAudioTrack::LoadAudio(const QString &filename)
 
 		if (sfinfo.frames > 0)
 		{
-			rawAudio.reserve(sfinfo.frames);
-			rawAudio.resize(sfinfo.frames);
-
-			float *tempBuff = new float[sfinfo.frames * sfinfo.channels];
-			sf_count_t readSamples = sf_readf_float(infile, tempBuff, sfinfo.frames);
-
-			for (int64_t i = 0; i < readSamples; i++)
+			bool cached = BeginPCMCache();
+			if (!cached) rawAudio.reserve(sfinfo.frames);
+
+			// file is decoded in chunks, so only one chunk is kept in memory
+			const int chunkSize = 65536;
+			float *tempBuff = new float[chunkSize * sfinfo.channels];
+			QVector<float> chunk(chunkSize);
+			sf_count_t readSamples;
+			while ((readSamples = sf_readf_float(infile, tempBuff, chunkSize)) > 0)
 			{
-				float sample = 0.0;
-				for (int chan = 0; chan < sfinfo.channels; chan++)
+				for (int64_t i = 0; i < readSamples; i++)
 				{
-					sample += tempBuff[i * sfinfo.channels + chan];
+					float sample = 0.0;
+					for (int chan = 0; chan < sfinfo.channels; chan++)
+					{
+						sample += tempBuff[i * sfinfo.channels + chan];
+					}
+					sample /= sfinfo.channels;
+					chunk[i] = sample;
 				}
-				sample /= sfinfo.channels;
-				rawAudio[i] = sample;
+				AppendSamples(chunk.constData(), readSamples);
 			}
 
-			length = readSamples;
-
 			delete[] tempBuff;
+			if (cached) FinishPCMCache();
 		}
 
 		sf_close(infile);
@@ -124,6 +158,8 @@ void cAudioTrack::LoadAudio(const QString &filename)
 		desiredFormat.setSampleRate(sampleRate);
 		desiredFormat.setSampleSize(16);
 
+		BeginPCMCache();
+
 		decoder = new QAudioDecoder(this);
 		decoder->setAudioFormat(desiredFormat);
 		decoder->setSourceFilename(filename);
@@ -145,7 +181,7 @@ void cAudioTrack::slotReadBuffer()
 	qint64 totalSamplesApprox = (duration + 1000) * sampleRate / 1000;
 
 	// reservation of memory if length is already known
-	if (duration > 0 && !memoryReserved)
+	if (duration > 0 && !memoryReserved && !pcmCacheFile.isOpen())
 	{
 		rawAudio.reserve(totalSamplesApprox);
 		memoryReserved = true;
@@ -156,12 +192,13 @@ void cAudioTrack::slotReadBuffer()
 	{
 		qint16 *frames = audioBuffer.data<qint16>();
 
+		QVector<float> samples(frameCount);
 		for (int i = 0; i < frameCount; i++)
 		{
-			rawAudio.append(frames[i] / 32768.0);
+			samples[i] = frames[i] / 32768.0;
 		}
+		AppendSamples(samples.constData(), frameCount);
 	}
-	length = rawAudio.size();
 	double percent = (double)length / totalSamplesApprox * 100.0;
 	emit loadingProgress(percent);
 }
@@ -170,6 +207,7 @@ void cAudioTrack::slotFinished()
 {
 	qDebug() << "finished";
 	qDebug() << length << (double)length / sampleRate;
+	if (pcmCacheFile.isOpen()) FinishPCMCache();
 	loaded = true;
 	emit loadingFinished();
 }
@@ -178,7 +216,7 @@ float cAudioTrack::getSample(int sampleIndex) const
 {
 	if (isLoaded() && sampleIndex < length)
 	{
-		return rawAudio[sampleIndex];
+		return mappedAudio ? mappedAudio[sampleIndex] : rawAudio[sampleIndex];
 	}
 	else
 	{
@@ -189,17 +227,115 @@ float cAudioTrack::getSample(int sampleIndex) const
 void cAudioTrack::slotError(QAudioDecoder::Error error)
 {
 	qDebug() << "error" << error;
+	// incomplete data cannot be used next time
+	if (pcmCacheFile.isOpen())
+	{
+		pcmCacheFile.close();
+		pcmCacheFile.remove();
+	}
+}
+
+QString cAudioTrack::PCMCacheFileName() const
+{
+	if (fileHash.isEmpty()) return QString();
+	return systemData.GetAudioCacheFolder() + QDir::separator() + fileHash + ".pcm";
+}
+
+bool cAudioTrack::OpenPCMCache()
+{
+	QString cacheFileName = PCMCacheFileName();
+	if (cacheFileName.isEmpty()) return false;
+
+	pcmCacheFile.setFileName(cacheFileName);
+	qint64 fileSize = pcmCacheFile.size();
+	if (fileSize <= qint64(sizeof(quint32)) || !pcmCacheFile.open(QIODevice::ReadOnly)) return false;
+
+	// pages of the file are read by the system only when samples are accessed
+	uchar *mapped = pcmCacheFile.map(0, fileSize);
+	if (!mapped)
+	{
+		pcmCacheFile.close();
+		return false;
+	}
+
+	quint32 header;
+	memcpy(&header, mapped, sizeof(header));
+	sampleRate = header;
+	mappedAudio = reinterpret_cast<const float *>(mapped + sizeof(quint32));
+	length = (fileSize - sizeof(quint32)) / sizeof(float);
+	WriteLog("cAudioTrack::LoadAudio(): audio taken from cache " + cacheFileName, 2);
+	return true;
+}
+
+bool cAudioTrack::BeginPCMCache()
+{
+	QString cacheFileName = PCMCacheFileName();
+	if (cacheFileName.isEmpty()) return false;
+
+	// decoded data is written to temporary file which is renamed when decoding is finished
+	pcmCacheFile.setFileName(cacheFileName + ".part");
+	if (!pcmCacheFile.open(QIODevice::WriteOnly))
+	{
+		qWarning() << "cAudioTrack::BeginPCMCache(): cannot write" << pcmCacheFile.fileName();
+		return false;
+	}
+	quint32 header = sampleRate;
+	pcmCacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	return true;
+}
+
+void cAudioTrack::AppendSamples(const float *samples, int count)
+{
+	if (pcmCacheFile.isOpen())
+	{
+		pcmCacheFile.write(reinterpret_cast<const char *>(samples), qint64(count) * sizeof(float));
+	}
+	else
+	{
+		for (int i = 0; i < count; i++)
+			rawAudio.append(samples[i]);
+	}
+	length += count;
+}
+
+void cAudioTrack::FinishPCMCache()
+{
+	pcmCacheFile.close();
+	QFile::remove(PCMCacheFileName());
+	if (!pcmCacheFile.rename(PCMCacheFileName()) || !OpenPCMCache())
+	{
+		qCritical() << "cAudioTrack::FinishPCMCache(): cannot use cache file" << PCMCacheFileName();
+		length = 0;
+	}
+}
+
+void cAudioTrack::ClosePCMCache()
+{
+	if (mappedAudio)
+	{
+		pcmCacheFile.unmap(
+			const_cast<uchar *>(reinterpret_cast<const uchar *>(mappedAudio) - sizeof(quint32)));
+		mappedAudio = NULL;
+	}
+	if (pcmCacheFile.isOpen()) pcmCacheFile.close();
 }
 
 void cAudioTrack::calculateFFT(double framesPerSecond)
 {
 	int fftSize = cAudioFFTdata::fftSize;
+	fftAudio.clear();
 
 	if (loaded && length > fftSize)
 	{
 		int numberOfFrames = length * framesPerSecond / sampleRate;
-		fftAudio.reserve(numberOfFrames);
 
+		QString cacheFileName = FFTCacheFileName(framesPerSecond);
+		if (!cacheFileName.isEmpty() && LoadFFTFromCache(cacheFileName, numberOfFrames)) return;
+
+		fftAudio.resize(numberOfFrames);
+
+		// frames are independent, so they are transformed in parallel
+#pragma omp parallel for schedule(dynamic, 64)
 		for (int frame = 0; frame < numberOfFrames; ++frame)
 		{
 			int sampleOffset = frame * sampleRate / framesPerSecond;
@@ -216,14 +352,54 @@ void cAudioTrack::calculateFFT(double framesPerSecond)
 			gsl_fft_complex_radix2_forward(data, 1, fftSize);
 
 			//write ready FFT data to storage buffer
-			cAudioFFTdata fftFrame;
+			cAudioFFTdata &fftFrame = fftAudio[frame];
 			for(int i = 0; i < fftSize; i++)
 			{
 				double re = fftData[2 * i];
 				double im = fftData[2 * i + 1];
 				fftFrame.data[i] = sqrt(re * re + im * im);
 			}
-			fftAudio.append(fftFrame);
 		}
+
+		if (!cacheFileName.isEmpty()) SaveFFTToCache(cacheFileName);
+	}
+}
+
+QString cAudioTrack::FFTCacheFileName(double framesPerSecond) const
+{
+	if (fileHash.isEmpty()) return QString();
+	return systemData.GetAudioCacheFolder() + QDir::separator() + fileHash + "_"
+				 + QString::number(framesPerSecond, 'g', 12) + "_" + QString::number(sampleRate) + "_"
+				 + QString::number(cAudioFFTdata::fftSize) + ".fft";
+}
+
+bool cAudioTrack::LoadFFTFromCache(const QString &cacheFileName, int numberOfFrames)
+{
+	QFile file(cacheFileName);
+	qint64 dataSize = qint64(numberOfFrames) * sizeof(cAudioFFTdata);
+	if (file.size() != dataSize || !file.open(QIODevice::ReadOnly)) return false;
+
+	fftAudio.resize(numberOfFrames);
+	if (file.read(reinterpret_cast<char *>(fftAudio.data()), dataSize) != dataSize)
+	{
+		fftAudio.clear();
+		return false;
+	}
+	WriteLog("cAudioTrack::calculateFFT(): FFT data loaded from " + cacheFileName, 2);
+	return true;
+}
+
+void cAudioTrack::SaveFFTToCache(const QString &cacheFileName) const
+{
+	QFile file(cacheFileName);
+	if (file.open(QIODevice::WriteOnly))
+	{
+		file.write(reinterpret_cast<const char *>(fftAudio.constData()),
+			qint64(fftAudio.size()) * sizeof(cAudioFFTdata));
+		file.close();
+	}
+	else
+	{
+		qWarning() << "cAudioTrack::SaveFFTToCache(): cannot write" << cacheFileName;
 	}
 }
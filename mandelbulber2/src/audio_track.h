@@ -37,6 +37,7 @@
 
 #include <QObject>
 #include <QAudioDecoder>
+#include <QFile>
 
 //forward declarations
 class cAudioFFTdata;
@@ -55,6 +56,7 @@ public:
 	bool isLoaded() const { return loaded; }
 	int getSampleRate() const { return sampleRate; }
 	float getSample(int sampleIndex) const;
+	// FFT of every animation frame. Results are stored in audio cache folder
 	void calculateFFT(double framesPerSecond);
 
 private slots:
@@ -63,11 +65,27 @@ private slots:
 	void slotError(QAudioDecoder::Error error);
 
 private:
+	// decoded samples are stored in cache file which is memory-mapped, so the whole track
+	// doesn't have to be kept in memory
+	QString PCMCacheFileName() const;
+	bool OpenPCMCache();
+	bool BeginPCMCache();
+	void AppendSamples(const float *samples, int count);
+	void FinishPCMCache();
+	void ClosePCMCache();
+
+	QString FFTCacheFileName(double framesPerSecond) const;
+	bool LoadFFTFromCache(const QString &cacheFileName, int numberOfFrames);
+	void SaveFFTToCache(const QString &cacheFileName) const;
+
 	QAudioDecoder *decoder;
-	QVector<float> rawAudio;
+	QVector<float> rawAudio; // used only if cache file cannot be written
+	QFile pcmCacheFile;
+	const float *mappedAudio;
 	QVector<cAudioFFTdata> fftAudio;
 	bool memoryReserved;
 	int length;
+	QString fileHash;
 
 	int sampleRate;
 	bool loaded;
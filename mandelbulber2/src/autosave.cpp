@@ -0,0 +1,264 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAutosave - writing of autosave file in background
+ */
+
+#include "autosave.hpp"
+
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#include "settings.hpp"
+#include "system.hpp"
+#include "undo.h"
+
+cAutosave *gAutosave = NULL;
+
+cAutosaveWriter::cAutosaveWriter(const QString &_snapshotFile, const QString &_journalFile)
+		: QObject(), snapshotFile(_snapshotFile), journalFile(_journalFile)
+{
+	pending = false;
+	writing = false;
+	hasLastState = false;
+	journalEntries = 0;
+}
+
+bool cAutosaveWriter::SetPendingState(const sAutosaveState &state)
+{
+	QMutexLocker lock(&mutex);
+	pendingState = state;
+	bool request = !pending;
+	pending = true;
+	return request;
+}
+
+void cAutosaveWriter::WaitForFinish()
+{
+	QMutexLocker lock(&mutex);
+	while (pending || writing)
+		finished.wait(&mutex);
+}
+
+void cAutosaveWriter::Reset()
+{
+	QMutexLocker lock(&mutex);
+	hasLastState = false;
+	lastState = sAutosaveState();
+	journalEntries = 0;
+}
+
+void cAutosaveWriter::slotWrite()
+{
+	mutex.lock();
+	if (!pending)
+	{
+		mutex.unlock();
+		return;
+	}
+	sAutosaveState state = pendingState;
+	pendingState = sAutosaveState();
+	pending = false;
+	writing = true;
+	mutex.unlock();
+
+	WriteLog("Autosave started", 2);
+	QStringList mainNames;
+	QList<QStringList> fractalNames;
+	if (!hasLastState || journalEntries >= AUTOSAVE_SNAPSHOT_INTERVAL
+			|| !ChangedParameters(lastState, state, &mainNames, &fractalNames))
+	{
+		WriteSnapshot(&state);
+	}
+	else
+	{
+		AppendJournal(&state, mainNames, fractalNames);
+	}
+	lastState = state;
+	hasLastState = true;
+	WriteLog("Autosave finished", 2);
+
+	mutex.lock();
+	writing = false;
+	finished.wakeAll();
+	mutex.unlock();
+}
+
+bool cAutosaveWriter::ChangedParameters(const sAutosaveState &oldState,
+	const sAutosaveState &newState, QStringList *mainNames, QList<QStringList> *fractalNames)
+{
+	// added or deleted parameters (primitives, materials) need whole snapshot
+	if (oldState.mainParams.GetLayoutStamp() != newState.mainParams.GetLayoutStamp()) return false;
+	for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+	{
+		if (oldState.fractParams.at(f).GetLayoutStamp() != newState.fractParams.at(f).GetLayoutStamp())
+			return false;
+	}
+	if (!SameFrames(oldState.animationFrames, newState.animationFrames)) return false;
+	if (!SameFrames(oldState.animationKeyframes, newState.animationKeyframes)) return false;
+	if (oldState.animationKeyframes.GetFramesPerKeyframe()
+			!= newState.animationKeyframes.GetFramesPerKeyframe())
+		return false;
+
+	*mainNames = ChangedParameters(oldState.mainParams, newState.mainParams);
+	// description is multi-line text, which is stored only in snapshot
+	if (mainNames->contains("description")) return false;
+
+	fractalNames->clear();
+	for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+		fractalNames->append(ChangedParameters(oldState.fractParams.at(f), newState.fractParams.at(f)));
+	return true;
+}
+
+QStringList cAutosaveWriter::ChangedParameters(
+	const cParameterContainer &oldPar, const cParameterContainer &newPar)
+{
+	// both containers have the same layout, so handles are the same
+	QStringList names;
+	for (int i = 0; i < newPar.GetNumberOfHandles(); i++)
+	{
+		sParameterHandle handle(i);
+		if (!newPar.IsValidHandle(handle)) continue;
+		if (oldPar.GetModificationStamp(handle) != newPar.GetModificationStamp(handle))
+			names.append(newPar.GetNameOfHandle(handle));
+	}
+	return names;
+}
+
+bool cAutosaveWriter::SameFrames(
+	const cAnimationFrames &oldFrames, const cAnimationFrames &newFrames)
+{
+	if (!cUndo::SameFramesLayout(oldFrames, newFrames)) return false;
+	for (int i = 0; i < newFrames.GetNumberOfFrames(); i++)
+	{
+		cAnimationFrames::sAnimationFrame oldFrame = oldFrames.GetFrame(i);
+		cAnimationFrames::sAnimationFrame newFrame = newFrames.GetFrame(i);
+		if (oldFrame.alreadyRendered != newFrame.alreadyRendered
+				|| oldFrame.alreadyRenderedSubFrames != newFrame.alreadyRenderedSubFrames
+				|| !cUndo::SameParameters(oldFrame.parameters, newFrame.parameters))
+			return false;
+	}
+	return true;
+}
+
+void cAutosaveWriter::WriteSnapshot(sAutosaveState *state)
+{
+	// journal belongs to the previous snapshot
+	QFile::remove(journalFile);
+	cSettings parSettings(cSettings::formatCondensedText);
+	parSettings.CreateText(&state->mainParams, &state->fractParams, &state->animationFrames,
+		&state->animationKeyframes);
+	parSettings.SaveToFile(snapshotFile);
+	journalEntries = 0;
+}
+
+void cAutosaveWriter::AppendJournal(
+	sAutosaveState *state, const QStringList &mainNames, const QList<QStringList> &fractalNames)
+{
+	cSettings parSettings(cSettings::formatFullText);
+	if (parSettings.CreateTextOfParameters(
+				&state->mainParams, &state->fractParams, mainNames, fractalNames)
+			== 0)
+		return;
+
+	QFile qfile(journalFile);
+	if (qfile.open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		QTextStream outstream(&qfile);
+		outstream << parSettings.GetSettingsText();
+		outstream.flush();
+		qfile.close();
+		journalEntries++;
+	}
+}
+
+cAutosave::cAutosave(const QString &_snapshotFile, const QString &_journalFile, QObject *parent)
+		: QObject(parent), snapshotFile(_snapshotFile), journalFile(_journalFile)
+{
+	thread = new QThread;
+	thread->setObjectName("Autosave");
+	writer = new cAutosaveWriter(snapshotFile, journalFile);
+	writer->moveToThread(thread);
+	connect(this, SIGNAL(write()), writer, SLOT(slotWrite()));
+	thread->start();
+}
+
+cAutosave::~cAutosave()
+{
+	// the last autosave has to be finished before exit
+	writer->WaitForFinish();
+	thread->quit();
+	thread->wait();
+	delete writer;
+	delete thread;
+}
+
+void cAutosave::Store(const cParameterContainer *par, const cFractalContainer *parFractal,
+	const cAnimationFrames *frames, const cKeyframes *keyframes)
+{
+	sAutosaveState state;
+	state.mainParams = *par;
+	state.fractParams = *parFractal;
+	if (frames) state.animationFrames = *frames;
+	if (keyframes) state.animationKeyframes = *keyframes;
+	if (writer->SetPendingState(state)) emit write();
+}
+
+void cAutosave::Remove()
+{
+	writer->WaitForFinish();
+	QFile::remove(snapshotFile);
+	QFile::remove(journalFile);
+	writer->Reset();
+}
+
+bool cAutosave::Exists() const
+{
+	return QFile::exists(snapshotFile);
+}
+
+bool cAutosave::Load(cParameterContainer *par, cFractalContainer *parFractal,
+	cAnimationFrames *frames, cKeyframes *keyframes)
+{
+	writer->WaitForFinish();
+
+	cSettings parSettings(cSettings::formatFullText);
+	if (!parSettings.LoadFromFile(snapshotFile)) return false;
+	if (!parSettings.Decode(par, parFractal, frames, keyframes)) return false;
+
+	if (QFile::exists(journalFile))
+	{
+		cSettings journal(cSettings::formatFullText);
+		if (journal.LoadFromFile(journalFile)) journal.DecodeParameters(par, parFractal);
+	}
+	return true;
+}
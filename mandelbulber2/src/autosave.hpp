@@ -0,0 +1,145 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cAutosave - writing of autosave file in background
+ *
+ * Settings are autosaved before every render. Writing of whole settings with animation frames
+ * can take a lot of time, so it is done in separate thread. Autosaves requested while the previous
+ * one is being written are coalesced - only the newest state is written. When only parameters
+ * have changed since the last write, the changed parameters are appended to journal file instead
+ * of writing whole snapshot. Snapshot is written when animation frames or set of parameters have
+ * changed and after every AUTOSAVE_SNAPSHOT_INTERVAL journal entries.
+ */
+
+#ifndef MANDELBULBER2_SRC_AUTOSAVE_HPP_
+#define MANDELBULBER2_SRC_AUTOSAVE_HPP_
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include "animation_frames.hpp"
+#include "fractal_container.hpp"
+#include "keyframes.hpp"
+#include "parameters.hpp"
+
+// forward declarations
+class QThread;
+
+// number of journal entries after which whole snapshot is written again
+#define AUTOSAVE_SNAPSHOT_INTERVAL 50
+
+struct sAutosaveState
+{
+	cParameterContainer mainParams;
+	cFractalContainer fractParams;
+	cAnimationFrames animationFrames;
+	cKeyframes animationKeyframes;
+};
+
+// writes autosave files in own thread
+class cAutosaveWriter : public QObject
+{
+	Q_OBJECT
+public:
+	cAutosaveWriter(const QString &_snapshotFile, const QString &_journalFile);
+
+	// state replaces pending state which was not written yet. Returns true if writing has to be
+	// requested (there was no pending state)
+	bool SetPendingState(const sAutosaveState &state);
+	void WaitForFinish();
+	// next write will be the whole snapshot
+	void Reset();
+
+public slots:
+	void slotWrite();
+
+private:
+	// lists of parameters changed since the last write. Returns false if changes cannot be
+	// written to journal
+	static bool ChangedParameters(const sAutosaveState &oldState, const sAutosaveState &newState,
+		QStringList *mainNames, QList<QStringList> *fractalNames);
+	static QStringList ChangedParameters(
+		const cParameterContainer &oldPar, const cParameterContainer &newPar);
+	static bool SameFrames(const cAnimationFrames &oldFrames, const cAnimationFrames &newFrames);
+	void WriteSnapshot(sAutosaveState *state);
+	void AppendJournal(
+		sAutosaveState *state, const QStringList &mainNames, const QList<QStringList> &fractalNames);
+
+	QString snapshotFile;
+	QString journalFile;
+
+	QMutex mutex;
+	QWaitCondition finished;
+	sAutosaveState pendingState;
+	bool pending;
+	bool writing;
+
+	// state of the last write, used only by writer thread
+	sAutosaveState lastState;
+	bool hasLastState;
+	int journalEntries;
+};
+
+class cAutosave : public QObject
+{
+	Q_OBJECT
+public:
+	cAutosave(const QString &_snapshotFile, const QString &_journalFile, QObject *parent = NULL);
+	~cAutosave();
+
+	// containers are implicitly shared, so state is copied cheaply and written in background
+	void Store(const cParameterContainer *par, const cFractalContainer *parFractal,
+		const cAnimationFrames *frames, const cKeyframes *keyframes);
+	void WaitForFinish() { writer->WaitForFinish(); }
+	// removes autosave files (when application is closed properly)
+	void Remove();
+	bool Exists() const;
+	// loads snapshot and applies journal
+	bool Load(cParameterContainer *par, cFractalContainer *parFractal, cAnimationFrames *frames,
+		cKeyframes *keyframes);
+
+signals:
+	// internal signal to writer
+	void write();
+
+private:
+	QThread *thread;
+	cAutosaveWriter *writer;
+	QString snapshotFile;
+	QString journalFile;
+};
+
+extern cAutosave *gAutosave;
+
+#endif /* MANDELBULBER2_SRC_AUTOSAVE_HPP_ */
@@ -0,0 +1,273 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cBenchmark class - renders fixed suite of example scenes and measures performance
+ */
+
+#include "benchmark.hpp"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "animation_frames.hpp"
+#include "cimage.hpp"
+#include "fractal_container.hpp"
+#include "initparameters.hpp"
+#include "keyframes.hpp"
+#include "nine_fractals.hpp"
+#include "numa_topology.hpp"
+#include "render_job.hpp"
+#include "rendering_configuration.hpp"
+#include "settings.hpp"
+#include "system.hpp"
+#include "thread_tuning.hpp"
+
+cBenchmark::cBenchmark()
+{
+	// scenes are taken from bundled examples, so results are comparable between installations
+	AddScene("mandelbulb", "mandelbulb001.fract", QStringList());
+	AddScene("mandelbox", "mandelbox001.fract", QStringList());
+	AddScene("hybrid", "hybrid001.fract", QStringList());
+	AddScene("boolean", "boolean001.fract", QStringList());
+	AddScene("ambient_occlusion", "mandelbox002.fract",
+		QStringList() << "ambient_occlusion_enabled=true"
+									<< "ambient_occlusion_mode=1"
+									<< "ambient_occlusion_quality=4");
+	AddScene("depth_of_field", "mandelbulb002.fract",
+		QStringList() << "DOF_enabled=true"
+									<< "DOF_monte_carlo=true"
+									<< "DOF_samples=16");
+	AddScene("volumetric", "iteration fog.fract", QStringList());
+}
+
+cBenchmark::~cBenchmark()
+{
+}
+
+void cBenchmark::AddScene(
+	const QString &name, const QString &file, const QStringList &overrides, int width, int height)
+{
+	sScene scene;
+	scene.name = name;
+	scene.file = file;
+	scene.overrides = overrides;
+	scene.width = width;
+	scene.height = height;
+	scenes.append(scene);
+}
+
+QByteArray cBenchmark::Run()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QJsonArray results;
+	for (int i = 0; i < scenes.size(); i++)
+	{
+		WriteLogString("Benchmark scene", scenes[i].name, 1);
+		results.append(RenderScene(scenes[i]));
+	}
+
+	QJsonObject document;
+	document["version"] = QString(MANDELBULBER_VERSION_STRING);
+	document["cpu_threads"] = get_cpu_count();
+	document["scenes"] = results;
+	document["total_time"] = timer.nsecsElapsed() / 1e9;
+	return QJsonDocument(document).toJson();
+}
+
+QJsonObject cBenchmark::RenderScene(const sScene &scene)
+{
+	QJsonObject result;
+	result["name"] = scene.name;
+	result["file"] = scene.file;
+
+	QJsonObject mainRun;
+	int maxThreads = get_cpu_count();
+	if (!Render(scene, scene.width, scene.height, maxThreads, &mainRun))
+	{
+		result["error"] = mainRun["error"];
+		return result;
+	}
+	result["result"] = mainRun;
+
+	// thread scaling is measured in smaller resolution, because single thread renders are slow
+	QList<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.append(threads);
+	threadCounts.append(maxThreads);
+
+	QJsonArray scaling;
+	double singleThreadTime = 0.0;
+	double allThreadsTime = 0.0;
+	for (int i = 0; i < threadCounts.size(); i++)
+	{
+		QJsonObject run;
+		if (!Render(scene, scene.width / 2, scene.height / 2, threadCounts[i], &run)) break;
+		double time = run["render_time"].toDouble();
+		if (threadCounts[i] == 1) singleThreadTime = time;
+		allThreadsTime = time;
+		scaling.append(run);
+	}
+	result["thread_scaling"] = scaling;
+	if (singleThreadTime > 0.0 && allThreadsTime > 0.0)
+	{
+		double speedup = singleThreadTime / allThreadsTime;
+		result["speedup"] = speedup;
+		result["parallel_efficiency"] = speedup / maxThreads;
+	}
+
+	// speedup of SMT siblings is remembered for auto-tuning of number of threads
+	int physicalCores = cNumaTopology::Instance()->GetNumberOfPhysicalCores();
+	if (physicalCores < maxThreads && allThreadsTime > 0.0)
+	{
+		QJsonObject physicalRun;
+		if (Render(scene, scene.width / 2, scene.height / 2, physicalCores, &physicalRun))
+		{
+			double smtSpeedup = physicalRun["render_time"].toDouble() / allThreadsTime;
+			result["physical_cores"] = physicalRun;
+			result["smt_speedup"] = smtSpeedup;
+			cThreadTuning::StoreChoice(
+				mainRun["formula_key"].toString(), cThreadTuning::ChoiceForSpeedup(smtSpeedup));
+		}
+	}
+	return result;
+}
+
+bool cBenchmark::Render(
+	const sScene &scene, int width, int height, int threads, QJsonObject *result)
+{
+	QString fileName = QDir::toNativeSeparators(
+		systemData.sharedDir + "examples" + QDir::separator() + scene.file);
+	if (!QFileInfo::exists(fileName))
+	{
+		(*result)["error"] = QString("file not found: ") + fileName;
+		return false;
+	}
+
+	// every render starts from default parameters, so previous scenes don't affect the result
+	cParameterContainer params;
+	cFractalContainer fractals;
+	cAnimationFrames frames;
+	cKeyframes keyframes;
+	params.SetContainerName("main");
+	InitParams(&params);
+	InitMaterialParams(1, &params);
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		fractals.at(i).SetContainerName(QString("fractal") + QString::number(i));
+		InitFractalParams(&fractals.at(i));
+	}
+
+	cSettings settings(cSettings::formatFullText);
+	settings.BeQuiet(true);
+	if (!settings.LoadFromFile(fileName) || !settings.Decode(&params, &fractals, &frames, &keyframes))
+	{
+		(*result)["error"] = QString("cannot load settings: ") + fileName;
+		return false;
+	}
+
+	for (int i = 0; i < scene.overrides.size(); i++)
+	{
+		QStringList keyValue = scene.overrides[i].split('=');
+		if (keyValue.size() == 2) params.Set(keyValue[0], keyValue[1]);
+	}
+	params.Set("image_width", width);
+	params.Set("image_height", height);
+	params.Set("limit_CPU_cores", get_cpu_count());
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+	config.EnableIgnoreErros();
+	config.SetThreadsLimit(threads);
+
+	bool stopRequest = false;
+	cImage image(width, height);
+	cRenderJob renderJob(&params, &fractals, &image, &stopRequest);
+
+	// preparation (textures, fractal formulas, lights) is measured separately from rendering
+	QElapsedTimer timer;
+	timer.start();
+	if (!renderJob.Init(cRenderJob::still, config))
+	{
+		(*result)["error"] = QString("cannot initialize render job");
+		return false;
+	}
+	double setupTime = timer.nsecsElapsed() / 1e9;
+
+	timer.restart();
+	bool finished = renderJob.Execute();
+	double renderTime = timer.nsecsElapsed() / 1e9;
+	if (!finished)
+	{
+		(*result)["error"] = QString("rendering failed");
+		return false;
+	}
+
+	cStatistics statistics = renderJob.GetStatistics();
+	double pixels = (double)width * height;
+
+	(*result)["threads"] = threads;
+	(*result)["width"] = width;
+	(*result)["height"] = height;
+	(*result)["setup_time"] = setupTime;
+	(*result)["render_time"] = renderTime;
+	(*result)["iterations"] = statistics.GetTotalNumberOfIterations();
+	(*result)["iterations_per_second"] = statistics.GetTotalNumberOfIterations() / renderTime;
+	(*result)["rays_per_second"] = statistics.numberOfRaymarchings / renderTime;
+	(*result)["pixels_per_second"] = pixels / renderTime;
+	(*result)["de_type"] = statistics.GetDETypeString();
+	cNineFractals nineFractals(&fractals, &params);
+	(*result)["formula_key"] = cThreadTuning::Key(&nineFractals);
+
+	QJsonObject stages;
+	stages["prepass"] = statistics.prepassTime;
+	stages["main_pass"] = statistics.mainPassTime;
+	stages["anti_aliasing"] = statistics.antiAliasingTime;
+	stages["post_processing"] = statistics.postProcessingTime;
+	stages["ssao"] = statistics.ssaoTime;
+	stages["dof"] = statistics.dofTime;
+	(*result)["stages"] = stages;
+
+	// thread time of shader stages, names are not translated to keep the keys stable
+	const char *stageKeys[renderStageCount] = {"other", "primary_rays", "secondary_rays",
+		"normals", "shading", "shadows", "ambient_occlusion", "volumetric", "background"};
+	QJsonObject threadStages;
+	for (int i = 0; i < renderStageCount; i++)
+		threadStages[stageKeys[i]] = statistics.stageTimes[i];
+	(*result)["thread_stages"] = threadStages;
+	return true;
+}
@@ -0,0 +1,77 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cBenchmark class - renders fixed suite of example scenes and measures performance
+ *
+ * Every scene is rendered with all threads and with smaller numbers of threads to
+ * measure thread scaling. Results are reported as JSON document, so they can be
+ * compared between machines and program versions. On CPUs with SMT scenes are
+ * also rendered with physical cores only and the faster choice is remembered for
+ * auto-tuning of number of threads.
+ */
+
+#ifndef MANDELBULBER2_SRC_BENCHMARK_HPP_
+#define MANDELBULBER2_SRC_BENCHMARK_HPP_
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class cBenchmark
+{
+public:
+	cBenchmark();
+	~cBenchmark();
+
+	// renders all scenes and returns results as JSON text
+	QByteArray Run();
+
+private:
+	struct sScene
+	{
+		QString name;
+		QString file;
+		// overrides of scene parameters in KEY=VALUE form
+		QStringList overrides;
+		int width;
+		int height;
+	};
+
+	void AddScene(const QString &name, const QString &file, const QStringList &overrides,
+		int width = 640, int height = 480);
+	QJsonObject RenderScene(const sScene &scene);
+	bool Render(const sScene &scene, int width, int height, int threads, QJsonObject *result);
+
+	QList<sScene> scenes;
+};
+
+#endif /* MANDELBULBER2_SRC_BENCHMARK_HPP_ */
@@ -34,10 +34,19 @@
  *
  * CalculateDistance() function calculates resultant distance to all
  * objects on scene including boolean operators.
+ *
+ * CalculateDistanceBatch() calculates distances for a group of points
+ * (e.g. packet of coherent primary rays).
+ *
+ * CalculateDistanceMinPlane() and CalculateBoundingBoxSampled() find limits of
+ * the fractal for the bounding box.
  */
 
 #include "calculate_distance.hpp"
 
+#include <QThread>
+#include <QVector>
+
 #include "compute_fractal.hpp"
 #include "displacement_map.hpp"
 #include "fractal_enums.h"
@@ -50,32 +59,149 @@
 
 using namespace std;
 
-double CalculateDistance(const cParamRender &params, const cNineFractals &fractals,
-	const sDistanceIn &in, sDistanceOut *out, sRenderData *data)
-{
-	double distance;
-	out->objectId = 0;
-	out->totalIters = 0;
+// number of points passed together to ComputeBatch() by CalculateDistanceBatch()
+#define DISTANCE_BATCH_CHUNK 32
 
-	double limitBoxDist = 0.0;
+// minimum part of iterations left by distance-dependent iteration limit
+#define ITERATION_LOD_MIN_PART 0.25
+
+// maximum number of iterations for given detail size. Details added by the last iterations are
+// much smaller than pixel footprint of distant geometry, so they can be skipped there
+static inline int IterationLimit(
+	const cParamRender &params, double detailSize, bool normalCalculationMode)
+{
+	int N = params.N;
+	if (params.iterationLODFactor > 0.0 && params.iterationLODReference > 0.0
+			&& detailSize > params.iterationLODReference)
+	{
+		double reduction = params.iterationLODFactor * log2(detailSize / params.iterationLODReference);
+		int minN = max(params.minN, (int)(params.N * ITERATION_LOD_MIN_PART));
+		N = min(params.N, max(minN, (int)(params.N - reduction)));
+	}
+	return normalCalculationMode ? N * 5 : N;
+}
 
+// checks if point is far outside of limit box. Then output data is filled and true is returned
+static inline bool OutsideLimitBox(
+	const cParamRender &params, const sDistanceIn &in, double *limitBoxDist, sDistanceOut *out)
+{
 	if (params.limitsEnabled)
 	{
 		double distance_a = max(in.point.x - params.limitMax.x, -(in.point.x - params.limitMin.x));
 		double distance_b = max(in.point.y - params.limitMax.y, -(in.point.y - params.limitMin.y));
 		double distance_c = max(in.point.z - params.limitMax.z, -(in.point.z - params.limitMin.z));
-		limitBoxDist = max(max(distance_a, distance_b), distance_c);
+		*limitBoxDist = max(max(distance_a, distance_b), distance_c);
 
-		if (limitBoxDist > in.detailSize)
+		if (*limitBoxDist > in.detailSize)
 		{
-			out->maxiter = false;
-			out->distance = limitBoxDist;
+			out->distance = *limitBoxDist;
 			out->objectId = 0;
 			out->maxiter = false;
 			out->iters = 0;
-			return limitBoxDist;
+			return true;
 		}
 	}
+	return false;
+}
+
+// combines fractal distance with primitives and limit box
+static inline double FinalizeDistance(const cParamRender &params, const sDistanceIn &in,
+	double limitBoxDist, double distance, sDistanceOut *out, sRenderData *data)
+{
+	distance = min(distance,
+		params.primitives.TotalDistance(
+			in.point, distance, &out->objectId, data, in.detailSize, &out->primitiveEvaluations));
+
+	//****************************************************
+
+	if (params.limitsEnabled)
+	{
+		if (limitBoxDist < in.detailSize)
+		{
+			distance = max(distance, limitBoxDist);
+		}
+	}
+
+	if (distance == distance / 0.0) // check if not a number
+	{
+		distance = 0.0;
+	}
+
+	out->distance = distance;
+
+	return distance;
+}
+
+// lower limit of distance to the object of boolean operator (in global coordinates). point is in
+// coordinates of the formula. Returns 0 if there is no bounding sphere
+static inline double BoundingSphereDistance(
+	const cParamRender &params, const CVector3 &point, int formulaIndex, sRenderData *data)
+{
+	if (params.formulaBoundingRadius[formulaIndex] <= 0.0) return 0.0;
+	double boundDist = (point.Length() - params.formulaBoundingRadius[formulaIndex])
+										 / params.formulaScale[formulaIndex]
+										 - DisplacementMaxHeight(formulaIndex, data);
+	return max(boundDist, 0.0);
+}
+
+// corrections of distance calculated with analytic DE
+static inline double AnalyticDistance(const cParamRender &params, const sDistanceIn &in,
+	const sFractalOut &fractOut, sDistanceOut *out)
+{
+	double distance = fractOut.distance;
+	// qDebug() << "computed distance" << distance;
+	out->maxiter = fractOut.maxiter;
+	out->iters = fractOut.iters;
+	out->colorIndex = fractOut.colorIndex;
+	out->totalIters += fractOut.iters;
+	if (fractOut.periodic) out->periodicOrbits++;
+
+	// if (distance < 1e-20) distance = 1e-20;
+
+	if (out->maxiter) distance = 0.0;
+
+	if (fractOut.iters < params.minN && distance < in.detailSize) distance = in.detailSize;
+
+	if (params.interiorMode && !in.normalCalculationMode)
+	{
+		if (distance < 0.5 * in.detailSize || fractOut.maxiter)
+		{
+			distance = in.detailSize;
+			out->maxiter = false;
+		}
+	}
+	else if (params.interiorMode && in.normalCalculationMode)
+	{
+		if (distance < 0.9 * in.detailSize)
+		{
+			distance = in.detailSize - distance;
+			out->maxiter = false;
+		}
+	}
+
+	if (params.common.iterThreshMode && !in.normalCalculationMode && !fractOut.maxiter)
+	{
+		if (distance < in.detailSize)
+		{
+			distance = in.detailSize * 1.01;
+		}
+	}
+
+	return distance;
+}
+
+double CalculateDistance(const cParamRender &params, const cNineFractals &fractals,
+	const sDistanceIn &in, sDistanceOut *out, sRenderData *data)
+{
+	double distance;
+	out->objectId = 0;
+	out->totalIters = 0;
+	out->periodicOrbits = 0;
+	out->primitiveEvaluations = -1;
+
+	double limitBoxDist = 0.0;
+
+	if (OutsideLimitBox(params, in, &limitBoxDist, out)) return limitBoxDist;
 
 	if (params.booleanOperatorsEnabled)
 	{
@@ -87,9 +213,19 @@ double CalculateDistance(const cParamRender &params, const cNineFractals &fracta
 		point *= params.formulaScale[0];
 		inTemp.point = point;
 
-		distance = CalculateDistanceSimple(params, fractals, inTemp, out, 0) / params.formulaScale[0];
-
-		distance = DisplacementMap(distance, in.point, 0, data);
+		// far from bounding sphere the distance to the sphere is used
+		double boundDist = BoundingSphereDistance(params, point, 0, data);
+		if (boundDist > in.detailSize)
+		{
+			distance = boundDist;
+			out->maxiter = false;
+			out->iters = 0;
+		}
+		else
+		{
+			distance = CalculateDistanceSimple(params, fractals, inTemp, out, 0) / params.formulaScale[0];
+			distance = DisplacementMap(distance, in.point, 0, data, in.detailSize);
+		}
 
 		for (int i = 0; i < NUMBER_OF_FRACTALS - 1; i++)
 		{
@@ -103,10 +239,20 @@ double CalculateDistance(const cParamRender &params, const cNineFractals &fracta
 				point *= params.formulaScale[i + 1];
 				inTemp.point = point;
 
+				// objects which cannot change the result are skipped
+				double boundDist = BoundingSphereDistance(params, point, i + 1, data);
+				if (params.booleanOperator[i] == params::booleanOperatorOR && boundDist > distance)
+					continue;
+				// (1.5 is the limit used below by booleanOperatorSUB)
+				if (params.booleanOperator[i] == params::booleanOperatorSUB
+						&& (distance >= in.detailSize
+								 || (distance >= 0.0 && boundDist >= in.detailSize * 1.5)))
+					continue;
+
 				double distTemp = CalculateDistanceSimple(params, fractals, inTemp, &outTemp, i + 1)
 													/ params.formulaScale[i + 1];
 
-				distTemp = DisplacementMap(distTemp, in.point, i + 1, data);
+				distTemp = DisplacementMap(distTemp, in.point, i + 1, data, in.detailSize);
 
 				params::enumBooleanOperator boolOperator = params.booleanOperator[i];
 
@@ -170,30 +316,124 @@ double CalculateDistance(const cParamRender &params, const cNineFractals &fracta
 	else
 	{
 		distance = CalculateDistanceSimple(params, fractals, in, out, -1);
-		distance = DisplacementMap(distance, in.point, 0, data);
+		distance = DisplacementMap(distance, in.point, 0, data, in.detailSize);
 	}
 
-	distance =
-		min(distance, params.primitives.TotalDistance(in.point, distance, &out->objectId, data));
-
-	//****************************************************
+	return FinalizeDistance(params, in, limitBoxDist, distance, out, data);
+}
 
-	if (params.limitsEnabled)
+// with calcModeCombined colour index is calculated by the same iteration loop as distance
+template <fractal::enumCalculationMode Mode>
+static void CalculateDistanceBatchMode(const cParamRender &params, const cNineFractals &fractals,
+	const CVector3 *points, const double *detailSizes, int count, double *distances,
+	sDistanceOut *outs, sRenderData *data, bool normalCalculationMode, const CVector3 *pointsLow)
+{
+	if (params.booleanOperatorsEnabled || fractals.GetDEType(-1) != fractal::analyticDEType)
 	{
-		if (limitBoxDist < in.detailSize)
+		for (int i = 0; i < count; i++)
 		{
-			distance = max(distance, limitBoxDist);
+			sDistanceIn in(points[i], detailSizes[i], normalCalculationMode);
+			distances[i] = CalculateDistance(params, fractals, in, &outs[i], data);
 		}
+
+		if (Mode == fractal::calcModeCombined)
+		{
+			// there is no common iteration loop for these fractals
+			const int chunkSize = DISTANCE_BATCH_CHUNK;
+			sFractalIn fractIn(CVector3(), params.minN, params.N, params.common, -1);
+			sFractalOut fractOuts[chunkSize];
+			for (int first = 0; first < count; first += chunkSize)
+			{
+				int n = min(chunkSize, count - first);
+				for (int k = 0; k < n; k++)
+					fractOuts[k].colorIndex = 0;
+				ComputeBatch<fractal::calcModeColouring>(fractals, fractIn, points + first, n, fractOuts);
+				for (int k = 0; k < n; k++)
+					outs[first + k].colorIndex = fractOuts[k].colorIndex;
+			}
+		}
+		return;
 	}
 
-	if (distance == distance / 0.0) // check if not a number
+	if (!params.doubleDoublePrecision) pointsLow = NULL;
+
+	// points inside limit box are collected and calculated together
+	sFractalIn fractIn(CVector3(), params.minN, params.N, params.common, -1);
+	CVector3 chunkPoints[DISTANCE_BATCH_CHUNK];
+	CVector3 chunkPointsLow[DISTANCE_BATCH_CHUNK];
+	double chunkLimitBoxDist[DISTANCE_BATCH_CHUNK];
+	int chunkIndex[DISTANCE_BATCH_CHUNK];
+	sFractalOut fractOuts[DISTANCE_BATCH_CHUNK];
+
+	int i = 0;
+	while (i < count)
 	{
-		distance = 0.0;
+		// single precision is used only if it's enough for all points of the chunk
+		bool singlePrecision = params.singlePrecision;
+		// double-double numbers are used if they are needed by any point of the chunk
+		bool doubleDouble = false;
+		double minDetailSize = 0.0;
+		int chunkSize = 0;
+		for (; i < count && chunkSize < DISTANCE_BATCH_CHUNK; i++)
+		{
+			sDistanceIn in(points[i], detailSizes[i], normalCalculationMode);
+			outs[i].objectId = 0;
+			outs[i].totalIters = 0;
+			outs[i].periodicOrbits = 0;
+			outs[i].primitiveEvaluations = -1;
+			double limitBoxDist = 0.0;
+			if (OutsideLimitBox(params, in, &limitBoxDist, &outs[i]))
+			{
+				distances[i] = limitBoxDist;
+				outs[i].colorIndex = 0;
+			}
+			else
+			{
+				chunkPoints[chunkSize] = points[i];
+				if (pointsLow) chunkPointsLow[chunkSize] = pointsLow[i];
+				chunkLimitBoxDist[chunkSize] = limitBoxDist;
+				chunkIndex[chunkSize] = i;
+				fractOuts[chunkSize].colorIndex = 0;
+				chunkSize++;
+				if (detailSizes[i] < points[i].Length() * SINGLE_PRECISION_LIMIT) singlePrecision = false;
+				if (pointsLow && detailSizes[i] < points[i].Length() * DOUBLE_DOUBLE_PRECISION_LIMIT)
+					doubleDouble = true;
+				if (chunkSize == 1 || detailSizes[i] < minDetailSize) minDetailSize = detailSizes[i];
+			}
+		}
+
+		// all points of the chunk use iteration limit of the finest detail
+		fractIn.maxN = IterationLimit(params, minDetailSize, normalCalculationMode);
+
+		ComputeBatch<Mode>(fractals, fractIn, chunkPoints, chunkSize, fractOuts, singlePrecision,
+			doubleDouble ? chunkPointsLow : NULL);
+
+		for (int k = 0; k < chunkSize; k++)
+		{
+			int index = chunkIndex[k];
+			sDistanceIn in(points[index], detailSizes[index], normalCalculationMode);
+			double distance = AnalyticDistance(params, in, fractOuts[k], &outs[index]);
+			distance = DisplacementMap(distance, in.point, 0, data, in.detailSize);
+			distances[index] =
+				FinalizeDistance(params, in, chunkLimitBoxDist[k], distance, &outs[index], data);
+		}
 	}
+}
 
-	out->distance = distance;
+void CalculateDistanceBatch(const cParamRender &params, const cNineFractals &fractals,
+	const CVector3 *points, const double *detailSizes, int count, double *distances,
+	sDistanceOut *outs, sRenderData *data, bool normalCalculationMode, const CVector3 *pointsLow)
+{
+	CalculateDistanceBatchMode<fractal::calcModeNormal>(params, fractals, points, detailSizes,
+		count, distances, outs, data, normalCalculationMode, pointsLow);
+}
 
-	return distance;
+void CalculateDistanceAndColourBatch(const cParamRender &params, const cNineFractals &fractals,
+	const CVector3 *points, const double *detailSizes, int count, double *distances,
+	sDistanceOut *outs)
+{
+	CalculateDistanceBatchMode<fractal::calcModeCombined>(
+		params, fractals, points, detailSizes, count, distances, outs, NULL, false, NULL);
 }
 
 double CalculateDistanceSimple(const cParamRender &params, const cNineFractals &fractals,
@@ -201,7 +441,7 @@ double CalculateDistanceSimple(const cParamRender &params, const cNineFractals &
 {
 	double distance = 0;
 
-	int N = in.normalCalculationMode ? params.N * 5 : params.N;
+	int N = IterationLimit(params, in.detailSize, in.normalCalculationMode);
 
 	sFractalIn fractIn(in.point, params.minN, N, params.common, forcedFormulaIndex);
 	sFractalOut fractOut;
@@ -212,74 +452,27 @@ double CalculateDistanceSimple(const cParamRender &params, const cNineFractals &
 		if (fractals.GetDEType(forcedFormulaIndex) == fractal::analyticDEType)
 		{
 			Compute<fractal::calcModeNormal>(fractals, fractIn, &fractOut);
-			distance = fractOut.distance;
-			// qDebug() << "computed distance" << distance;
-			out->maxiter = fractOut.maxiter;
-			out->iters = fractOut.iters;
-			out->colorIndex = fractOut.colorIndex;
-			out->totalIters += fractOut.iters;
-
-			// if (distance < 1e-20) distance = 1e-20;
-
-			if (out->maxiter) distance = 0.0;
-
-			if (fractOut.iters < params.minN && distance < in.detailSize) distance = in.detailSize;
-
-			if (params.interiorMode && !in.normalCalculationMode)
-			{
-				if (distance < 0.5 * in.detailSize || fractOut.maxiter)
-				{
-					distance = in.detailSize;
-					out->maxiter = false;
-				}
-			}
-			else if (params.interiorMode && in.normalCalculationMode)
-			{
-				if (distance < 0.9 * in.detailSize)
-				{
-					distance = in.detailSize - distance;
-					out->maxiter = false;
-				}
-			}
-
-			if (params.common.iterThreshMode && !in.normalCalculationMode && !fractOut.maxiter)
-			{
-				if (distance < in.detailSize)
-				{
-					distance = in.detailSize * 1.01;
-				}
-			}
+			distance = AnalyticDistance(params, in, fractOut, out);
 		}
 		else
 		{
 			double deltaDE = 1e-10;
 
-			Compute<fractal::calcModeDeltaDE1>(fractals, fractIn, &fractOut);
+			// central point and shifted points are iterated together
+			sFractalOut deltaOuts[DELTA_DE_POINTS];
+			ComputeDeltaDE(fractals, fractIn, deltaDE, deltaOuts);
+			fractOut = deltaOuts[0];
 			double r = fractOut.z.Length();
 			bool maxiter = out->maxiter = fractOut.maxiter;
 			out->iters = fractOut.iters;
 			out->colorIndex = fractOut.colorIndex;
 			out->totalIters += fractOut.iters;
 
-			fractIn.maxN = fractOut.iters; // for other directions must be the same number of iterations
-
-			fractIn.point = in.point + CVector3(deltaDE, 0.0, 0.0);
-			Compute<fractal::calcModeDeltaDE1>(fractals, fractIn, &fractOut);
-			double r2 = fractOut.z.Length();
-			double dr1 = fabs(r2 - r) / deltaDE;
-			out->totalIters += fractOut.iters;
-
-			fractIn.point = in.point + CVector3(0.0, deltaDE, 0.0);
-			Compute<fractal::calcModeDeltaDE1>(fractals, fractIn, &fractOut);
-			r2 = fractOut.z.Length();
-			double dr2 = fabs(r2 - r) / deltaDE;
-			out->totalIters += fractOut.iters;
-
-			fractIn.point = in.point + CVector3(0.0, 0.0, deltaDE);
-			Compute<fractal::calcModeDeltaDE1>(fractals, fractIn, &fractOut);
-			r2 = fractOut.z.Length();
-			double dr3 = fabs(r2 - r) / deltaDE;
-			out->totalIters += fractOut.iters;
+			double dr1 = fabs(deltaOuts[1].z.Length() - r) / deltaDE;
+			double dr2 = fabs(deltaOuts[2].z.Length() - r) / deltaDE;
+			double dr3 = fabs(deltaOuts[3].z.Length() - r) / deltaDE;
+			out->totalIters += deltaOuts[1].iters + deltaOuts[2].iters + deltaOuts[3].iters;
+			fractOut = deltaOuts[3];
 
 			double dr = sqrt(dr1 * dr1 + dr2 * dr2 + dr3 * dr3);
 
@@ -361,25 +554,43 @@ double CalculateDistanceMinPlane(const cParamRender &params, const cNineFractals
 	CVector3 rotationAxis = planePoint;
 	rotationAxis.Normalize();
 
+	// transversal vectors don't change between steps
+	CVector3 transversalVects[transVectorAngles + 1];
+	for (int i = 0; i <= transVectorAngles; i++)
+	{
+		double angle = (1.0 * i / transVectorAngles) * 2.0 * M_PI;
+		CVector3 transversalVect = orthDdirection;
+		transversalVects[i] = transversalVect.RotateAroundVectorByAngle(rotationAxis, angle);
+		transversalVects[i].Normalize();
+	}
+
+	// events can be processed only by the main thread when planes are searched in parallel
+	bool mainThread = gApplication && QThread::currentThread() == gApplication->thread();
+
 	while (distStep == 0 || distStep > 0.00001)
 	{
+		// all candidate points of the step are calculated in one batch
+		CVector3 points[transVectorAngles + 1];
+		double detailSizes[transVectorAngles + 1];
+		double distances[transVectorAngles + 1];
+		sDistanceOut outs[transVectorAngles + 1];
+		for (int i = 0; i <= transVectorAngles; i++)
+		{
+			points[i] = point + direction * distStep;
+			if (i > 0) points[i] += transversalVects[i] * distStep / 2.0;
+			detailSizes[i] = 0.0;
+		}
+		CalculateDistanceBatch(
+			params, fractals, points, detailSizes, transVectorAngles + 1, distances, outs);
+
 		CVector3 pointNextBest(0, 0, 0);
 		double newDistStepMin = 0;
 		for (int i = 0; i <= transVectorAngles; i++)
 		{
-			double angle = (1.0 * i / transVectorAngles) * 2.0 * M_PI;
-			CVector3 transversalVect = orthDdirection;
-			transversalVect = transversalVect.RotateAroundVectorByAngle(rotationAxis, angle);
-			transversalVect.Normalize();
-			CVector3 pointNext = point + direction * distStep;
-			if (i > 0) pointNext += transversalVect * distStep / 2.0;
-			sDistanceIn in(pointNext, 0, false);
-			sDistanceOut out;
-			double dist = CalculateDistance(params, fractals, in, &out);
-			double newDistStep = dist * detail * 0.5;
+			double newDistStep = distances[i] * detail * 0.5;
 			if (newDistStep < newDistStepMin || newDistStepMin == 0)
 			{
-				pointNextBest = pointNext;
+				pointNextBest = points[i];
 				newDistStepMin = newDistStep;
 			}
 		}
@@ -393,7 +604,7 @@ double CalculateDistanceMinPlane(const cParamRender &params, const cNineFractals
 			qDebug() << "surface not found!";
 			return 0;
 		}
-		gApplication->processEvents();
+		if (mainThread) gApplication->processEvents();
 		if (*stopRequest)
 		{
 			return 0;
@@ -401,3 +612,71 @@ double CalculateDistanceMinPlane(const cParamRender &params, const cNineFractals
 	}
 	return CVector3(point - planePoint).Dot(direction);
 }
+
+bool CalculateBoundingBoxSampled(const cParamRender &params, const cNineFractals &fractals,
+	double outerBounding, int samples, CVector3 *boxMin, CVector3 *boxMax, bool *stopRequest)
+{
+	double cellSize = 2.0 * outerBounding / samples;
+	// surface is not closer than estimated distance, so sample farther than half of diagonal
+	// of grid cell means that the cell is empty
+	double emptyDistance = 0.5 * sqrt(3.0) * cellSize;
+
+	QVector<CVector3> sliceMin(samples);
+	QVector<CVector3> sliceMax(samples);
+	QVector<bool> sliceFound(samples, false);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int z = 0; z < samples; z++)
+	{
+		if (*stopRequest) continue;
+
+		// rows of samples are calculated in batches
+		QVector<CVector3> points(samples);
+		QVector<double> detailSizes(samples, 0.0);
+		QVector<double> distances(samples);
+		QVector<sDistanceOut> outs(samples);
+		double pz = -outerBounding + (z + 0.5) * cellSize;
+		for (int y = 0; y < samples; y++)
+		{
+			double py = -outerBounding + (y + 0.5) * cellSize;
+			for (int x = 0; x < samples; x++)
+				points[x] = CVector3(-outerBounding + (x + 0.5) * cellSize, py, pz);
+			CalculateDistanceBatch(params, fractals, points.data(), detailSizes.data(), samples,
+				distances.data(), outs.data());
+
+			for (int x = 0; x < samples; x++)
+			{
+				if (distances[x] >= emptyDistance) continue;
+				if (!sliceFound[z])
+				{
+					sliceMin[z] = sliceMax[z] = points[x];
+					sliceFound[z] = true;
+				}
+				sliceMin[z] = CVector3(qMin(sliceMin[z].x, points[x].x), qMin(sliceMin[z].y, py), pz);
+				sliceMax[z] = CVector3(qMax(sliceMax[z].x, points[x].x), qMax(sliceMax[z].y, py), pz);
+			}
+		}
+	}
+
+	bool found = false;
+	for (int z = 0; z < samples; z++)
+	{
+		if (!sliceFound[z]) continue;
+		if (!found)
+		{
+			*boxMin = sliceMin[z];
+			*boxMax = sliceMax[z];
+			found = true;
+		}
+		*boxMin = CVector3(qMin(boxMin->x, sliceMin[z].x), qMin(boxMin->y, sliceMin[z].y),
+			qMin(boxMin->z, sliceMin[z].z));
+		*boxMax = CVector3(qMax(boxMax->x, sliceMax[z].x), qMax(boxMax->y, sliceMax[z].y),
+			qMax(boxMax->z, sliceMax[z].z));
+	}
+	if (!found || *stopRequest) return false;
+
+	// surface can be anywhere within empty distance from occupied samples
+	*boxMin -= CVector3(emptyDistance, emptyDistance, emptyDistance);
+	*boxMax += CVector3(emptyDistance, emptyDistance, emptyDistance);
+	return true;
+}
@@ -34,6 +34,10 @@
  *
  * CalculateDistance() function calculates resultant distance to all
  * objects on scene including boolean operators.
+ *
+ * CalculateDistanceBatch() calculates distances for a group of points
+ * (e.g. packet of coherent primary rays or taps of normal vector).
+ * CalculateDistanceAndColourBatch() gets also colour index in the same pass.
  */
 
 #ifndef MANDELBULBER2_SRC_CALCULATE_DISTANCE_HPP_
@@ -63,15 +67,34 @@ struct sDistanceOut
 	double colorIndex;
 	int iters;
 	int totalIters;
+	int periodicOrbits; // number of fractal evaluations stopped by periodicity check
 	int objectId;
+	int primitiveEvaluations; // -1 if there are no primitives
 	bool maxiter;
 };
 
 double CalculateDistance(const cParamRender &params, const cNineFractals &fractals,
 	const sDistanceIn &in, sDistanceOut *out, sRenderData *data = NULL);
+// pointsLow are low parts of points beyond double precision (can be NULL). They are used for
+// deep zooms when params.doubleDoublePrecision is set
+void CalculateDistanceBatch(const cParamRender &params, const cNineFractals &fractals,
+	const CVector3 *points, const double *detailSizes, int count, double *distances,
+	sDistanceOut *outs, sRenderData *data = NULL, bool normalCalculationMode = false,
+	const CVector3 *pointsLow = NULL);
+// like CalculateDistanceBatch(), but outs[].colorIndex is filled as well. Fractals with analytic
+// DE calculate distance and colour in one iteration loop (calcModeCombined)
+void CalculateDistanceAndColourBatch(const cParamRender &params, const cNineFractals &fractals,
+	const CVector3 *points, const double *detailSizes, int count, double *distances,
+	sDistanceOut *outs);
 double CalculateDistanceSimple(const cParamRender &params, const cNineFractals &fractals,
 	const sDistanceIn &in, sDistanceOut *out, int forcedFormulaIndex);
 double CalculateDistanceMinPlane(const cParamRender &params, const cNineFractals &fractals,
 	const CVector3 point, const CVector3 direction, const CVector3 orthDdirection, bool *stopRequest);
+// number of samples along every axis used by CalculateBoundingBoxSampled()
+#define BOUNDING_BOX_SAMPLES 64
+// bounding box of the fractal from distances in grid of samples x samples x samples inside of
+// cube (-outerBounding, outerBounding). Returns false if nothing was found
+bool CalculateBoundingBoxSampled(const cParamRender &params, const cNineFractals &fractals,
+	double outerBounding, int samples, CVector3 *boxMin, CVector3 *boxMax, bool *stopRequest);
 
 #endif /* MANDELBULBER2_SRC_CALCULATE_DISTANCE_HPP_ */
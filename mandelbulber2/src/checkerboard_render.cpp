@@ -0,0 +1,139 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCheckerboardRender class - rendering of half of pixels of flight animation frames
+ */
+
+#include "checkerboard_render.hpp"
+
+#include <cmath>
+
+#include "cimage.hpp"
+
+cCheckerboardRender::cCheckerboardRender()
+{
+	reprojected = false;
+	parity = 1;
+}
+
+void cCheckerboardRender::PrepareFrame(const cParamRender *params, const sRenderData *data,
+	int width, int height, const QString &sceneHash)
+{
+	parity = 1 - parity;
+	reprojection.PrepareScene(sceneHash);
+	reprojected = reprojection.Reproject(params, data, width, height);
+}
+
+void cCheckerboardRender::StoreFrame(
+	const cImage *image, const cParamRender *params, const sRenderData *data)
+{
+	reprojection.StoreFrame(image, params, data);
+}
+
+void cCheckerboardRender::Reconstruct(cImage *image) const
+{
+	const sImageOptional *optional = image->GetImageOptional();
+	int width = image->GetWidth();
+	int height = image->GetHeight();
+	const int offsetX[4] = {-1, 1, 0, 0};
+	const int offsetY[4] = {0, 0, -1, 1};
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (IsRendered(x, y)) continue;
+
+			// all direct neighbours were rendered
+			sRGBfloat average;
+			float minDepth = 1e20f;
+			float maxDepth = 0.0f;
+			int count = 0;
+			int neighbourX[4], neighbourY[4];
+			for (int i = 0; i < 4; i++)
+			{
+				int nx = x + offsetX[i];
+				int ny = y + offsetY[i];
+				if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
+				sRGBfloat pixel = image->GetPixelImage(nx, ny);
+				average.R += pixel.R;
+				average.G += pixel.G;
+				average.B += pixel.B;
+				float depth = image->GetPixelZBuffer(nx, ny);
+				minDepth = qMin(minDepth, depth);
+				maxDepth = qMax(maxDepth, depth);
+				neighbourX[count] = nx;
+				neighbourY[count] = ny;
+				count++;
+			}
+			if (count == 0) continue;
+			average.R /= count;
+			average.G /= count;
+			average.B /= count;
+
+			// previous frame is used where it shows the same surface as the neighbours
+			sRGBfloat colour = average;
+			float depth = minDepth;
+			sRGBfloat reprojectedColour;
+			float reprojectedDepth;
+			if (reprojected
+					&& reprojection.GetReprojectedPixel(x, y, &reprojectedColour, &reprojectedDepth)
+					&& reprojectedDepth >= minDepth * (1.0 - CHECKERBOARD_DEPTH_TOLERANCE)
+					&& reprojectedDepth <= maxDepth * (1.0 + CHECKERBOARD_DEPTH_TOLERANCE))
+			{
+				colour = reprojectedColour;
+				depth = reprojectedDepth;
+			}
+			image->PutPixelImage(x, y, colour);
+
+			// other buffers are taken from the neighbour with the most similar depth
+			int nearest = 0;
+			for (int i = 1; i < count; i++)
+			{
+				if (fabs(image->GetPixelZBuffer(neighbourX[i], neighbourY[i]) - depth)
+						< fabs(image->GetPixelZBuffer(neighbourX[nearest], neighbourY[nearest]) - depth))
+					nearest = i;
+			}
+			int nx = neighbourX[nearest];
+			int ny = neighbourY[nearest];
+			image->PutPixelZBuffer(x, y, depth);
+			image->PutPixelColour(x, y, image->GetPixelColor(nx, ny));
+			image->PutPixelAlpha(x, y, image->GetPixelAlpha(nx, ny));
+			image->PutPixelOpacity(x, y, image->GetPixelOpacity(nx, ny));
+			if (optional->optionalNormal) image->PutPixelNormal(x, y, image->GetPixelNormal(nx, ny));
+			if (optional->optionalWorldPosition)
+				image->PutPixelWorldPosition(x, y, image->GetPixelWorldPosition(nx, ny));
+			if (optional->optionalObjectId)
+				image->PutPixelObjectId(x, y, image->GetPixelObjectId(nx, ny));
+			if (optional->optionalCost) image->PutPixelCost(x, y, image->GetPixelCost(nx, ny));
+		}
+	}
+}
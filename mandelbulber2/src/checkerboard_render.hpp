@@ -0,0 +1,84 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCheckerboardRender class - rendering of half of pixels of flight animation frames
+ *
+ * Every frame only pixels of one parity of the checkerboard pattern are rendered.
+ * The parity alternates with every frame. Missing pixels are taken from the
+ * previous frame reprojected into the new camera (cTemporalDepth) when the
+ * reprojected depth agrees with the rendered neighbours. Otherwise they are
+ * interpolated from the four rendered neighbours (disocclusions, edges of the
+ * image and background). Reprojected depth is also used as start distance of rays.
+ */
+
+#ifndef MANDELBULBER2_SRC_CHECKERBOARD_RENDER_HPP_
+#define MANDELBULBER2_SRC_CHECKERBOARD_RENDER_HPP_
+
+#include <QString>
+
+#include "temporal_depth.hpp"
+
+// relative difference of depth between reprojected pixel and its neighbours which is accepted
+#define CHECKERBOARD_DEPTH_TOLERANCE 0.05
+
+// forward declarations
+class cImage;
+class cParamRender;
+struct sRenderData;
+
+class cCheckerboardRender
+{
+public:
+	cCheckerboardRender();
+
+	// switches the pattern and reprojects previous frame into the camera of the new one. Previous
+	// frame is forgotten if anything else than the camera was changed
+	void PrepareFrame(const cParamRender *params, const sRenderData *data, int width, int height,
+		const QString &sceneHash);
+	// reprojection of previous frame or NULL if there is no previous frame
+	cTemporalDepth *GetReprojection() { return reprojected ? &reprojection : NULL; }
+
+	// false if the pixel is reconstructed
+	inline bool IsRendered(int x, int y) const { return ((x + y) & 1) == parity; }
+
+	// fills pixels which were not rendered
+	void Reconstruct(cImage *image) const;
+	// finished frame is used for the next one
+	void StoreFrame(const cImage *image, const cParamRender *params, const sRenderData *data);
+	void Clear() { reprojection.Clear(); }
+
+private:
+	cTemporalDepth reprojection;
+	bool reprojected;
+	int parity;
+};
+
+#endif /* MANDELBULBER2_SRC_CHECKERBOARD_RENDER_HPP_ */
@@ -35,6 +35,7 @@
 #include "cimage.hpp"
 #include <QtCore>
 #include <qpainter.h>
+#include "trace.hpp"
 
 cImage::cImage(int w, int h, bool _allocLater)
 {
@@ -51,6 +52,7 @@ void cImage::construct()
 	image8 = NULL;
 	image16 = NULL;
 	imageFloat = NULL;
+	imageHalf = NULL;
 	alphaBuffer8 = NULL;
 	alphaBuffer16 = NULL;
 	opacityBuffer = NULL;
@@ -60,8 +62,15 @@ void cImage::construct()
 
 	// optional image buffers
 	normalFloat = NULL;
+	normalHalf = NULL;
 	normal8 = NULL;
 	normal16 = NULL;
+	worldPosition = NULL;
+	objectIdBuffer = NULL;
+	costBuffer = NULL;
+	cost8 = NULL;
+	gBuffer = NULL;
+	clearPending = false;
 
 	AllocMem();
 	progressiveFactor = 1;
@@ -74,6 +83,7 @@ void cImage::construct()
 	previewHeight = 0;
 
 	gammaTablePrepared = false;
+	adjustmentsPreviewOnly = false;
 
 	isMainImage = false;
 }
@@ -103,21 +113,43 @@ bool cImage::AllocMem(void)
 		{
 			try
 			{
-				imageFloat = new sRGBfloat[width * height];
-				image16 = new sRGB16[width * height];
-				image8 = new sRGB8[width * height];
-				zBuffer = new float[width * height];
-				alphaBuffer8 = new unsigned char[width * height];
-				alphaBuffer16 = new unsigned short[width * height];
-				opacityBuffer = new unsigned short[width * height];
-				colourBuffer = new sRGB8[width * height];
+				if (opt.halfFloat)
+					imageHalf = NewBuffer<sRGBhalf>();
+				else
+					imageFloat = NewBuffer<sRGBfloat>();
+				image16 = NewBuffer<sRGB16>();
+				zBuffer = NewBuffer<float>();
+				alphaBuffer16 = NewBuffer<unsigned short>();
+				opacityBuffer = NewBuffer<unsigned short>();
+				colourBuffer = NewBuffer<sRGB8>();
 				if (opt.optionalNormal)
 				{
-					normalFloat = new sRGBfloat[width * height];
-					normal16 = new sRGB16[width * height];
-					normal8 = new sRGB8[width * height];
+					if (opt.halfFloat)
+						normalHalf = NewBuffer<sRGBhalf>();
+					else
+						normalFloat = NewBuffer<sRGBfloat>();
+				}
+				if (opt.optionalWorldPosition) worldPosition = NewBuffer<sRGBfloat>();
+				if (opt.optionalObjectId) objectIdBuffer = NewBuffer<float>();
+				if (opt.optionalCost) costBuffer = NewBuffer<sRGBfloat>();
+				if (opt.optionalGBuffer) gBuffer = NewBuffer<sGBufferPixel>();
+
+				// in lean mode derived buffers are allocated when they are needed
+				if (!opt.leanMemory)
+				{
+					image8 = NewBuffer<sRGB8>();
+					alphaBuffer8 = NewBuffer<unsigned char>();
+					if (opt.optionalNormal)
+					{
+						normal16 = NewBuffer<sRGB16>();
+						normal8 = NewBuffer<sRGB8>();
+					}
 				}
-				ClearImage();
+				// with first touch buffers are cleared by rendering threads
+				if (opt.firstTouch && !opt.memoryMapped)
+					clearPending = true;
+				else
+					ClearImage();
 			}
 			catch (std::bad_alloc &ba)
 			{
@@ -148,6 +180,47 @@ bool cImage::AllocMem(void)
 	return true;
 }
 
+void *cImage::MapBuffer(qint64 size)
+{
+	QTemporaryFile *file = new QTemporaryFile(
+		QDir(opt.scratchFolder).absoluteFilePath("mandelbulber_image_XXXXXX.tmp"));
+	uchar *buffer = NULL;
+	if (file->open() && file->resize(size)) buffer = file->map(0, size);
+	if (!buffer)
+	{
+		qCritical() << "cImage::MapBuffer(): cannot map scratch file" << file->fileName() << ":"
+								<< file->errorString();
+		delete file;
+		throw std::bad_alloc();
+	}
+	mappedBuffers.insert(buffer, file);
+	return buffer;
+}
+
+bool cImage::UnmapBuffer(void *buffer)
+{
+	QFile *file = mappedBuffers.take(buffer);
+	if (!file) return false;
+	file->unmap(static_cast<uchar *>(buffer));
+	delete file; // temporary file is removed
+	return true;
+}
+
+void *cImage::AllocUntouchedBuffer(qint64 size)
+{
+	void *buffer = malloc(size);
+	if (!buffer) throw std::bad_alloc();
+	untouchedBuffers.insert(buffer);
+	return buffer;
+}
+
+bool cImage::FreeUntouchedBuffer(void *buffer)
+{
+	if (!untouchedBuffers.remove(buffer)) return false;
+	free(buffer);
+	return true;
+}
+
 bool cImage::ChangeSize(int w, int h, sImageOptional optional)
 {
 	if (w != width || h != height || !(optional == *GetImageOptional()) || allocLater)
@@ -165,51 +238,113 @@ bool cImage::ChangeSize(int w, int h, sImageOptional optional)
 	return true;
 }
 
+bool cImage::CopyFrom(const cImage *source)
+{
+	if (!ChangeSize(source->width, source->height, source->opt)) return false;
+	adj = source->adj;
+	gammaTablePrepared = false;
+	CalculateGammaTable();
+
+	unsigned long int size = (unsigned long int)width * height;
+	if (imageHalf)
+		memcpy(imageHalf, source->imageHalf, sizeof(sRGBhalf) * size);
+	else
+		memcpy(imageFloat, source->imageFloat, sizeof(sRGBfloat) * size);
+	memcpy(image16, source->image16, sizeof(sRGB16) * size);
+	memcpy(alphaBuffer16, source->alphaBuffer16, sizeof(unsigned short) * size);
+	memcpy(opacityBuffer, source->opacityBuffer, sizeof(unsigned short) * size);
+	memcpy(colourBuffer, source->colourBuffer, sizeof(sRGB8) * size);
+	memcpy(zBuffer, source->zBuffer, sizeof(float) * size);
+	if (normalFloat && source->normalFloat)
+		memcpy(normalFloat, source->normalFloat, sizeof(sRGBfloat) * size);
+	if (normalHalf && source->normalHalf)
+		memcpy(normalHalf, source->normalHalf, sizeof(sRGBhalf) * size);
+	if (worldPosition && source->worldPosition)
+		memcpy(worldPosition, source->worldPosition, sizeof(sRGBfloat) * size);
+	if (objectIdBuffer && source->objectIdBuffer)
+		memcpy(objectIdBuffer, source->objectIdBuffer, sizeof(float) * size);
+	if (costBuffer && source->costBuffer)
+		memcpy(costBuffer, source->costBuffer, sizeof(sRGBfloat) * size);
+	if (gBuffer && source->gBuffer)
+		memcpy(gBuffer, source->gBuffer, sizeof(sGBufferPixel) * size);
+
+	// derived buffers which don't exist in source are calculated when needed
+	if (image8 && source->image8) memcpy(image8, source->image8, sizeof(sRGB8) * size);
+	if (alphaBuffer8 && source->alphaBuffer8)
+		memcpy(alphaBuffer8, source->alphaBuffer8, sizeof(unsigned char) * size);
+	if (normal16 && source->normal16) memcpy(normal16, source->normal16, sizeof(sRGB16) * size);
+	if (normal8 && source->normal8) memcpy(normal8, source->normal8, sizeof(sRGB8) * size);
+	clearPending = source->clearPending;
+	return true;
+}
+
 void cImage::ClearImage(void)
 {
-	memset(imageFloat, 0, (unsigned long int)sizeof(sRGBfloat) * width * height);
-	memset(image16, 0, (unsigned long int)sizeof(sRGB16) * width * height);
-	memset(image8, 0, (unsigned long int)sizeof(sRGB8) * width * height);
-	memset(alphaBuffer8, 0, (unsigned long int)sizeof(unsigned char) * width * height);
-	memset(alphaBuffer16, 0, (unsigned long int)sizeof(unsigned short) * width * height);
-	memset(opacityBuffer, 0, (unsigned long int)sizeof(unsigned short) * width * height);
-	memset(colourBuffer, 0, (unsigned long int)sizeof(sRGB8) * width * height);
+	ClearImageLines(0, height);
+	clearPending = false;
+}
+
+void cImage::ClearImageLines(int y1, int y2)
+{
+	y1 = qMax(y1, 0);
+	y2 = qMin(y2, height);
+	if (y2 <= y1) return;
+	long int first = (long int)y1 * width;
+	long int count = (long int)(y2 - y1) * width;
+
+	if (imageHalf)
+		memset(imageHalf + first, 0, (unsigned long int)sizeof(sRGBhalf) * count);
+	else
+		memset(imageFloat + first, 0, (unsigned long int)sizeof(sRGBfloat) * count);
+	memset(image16 + first, 0, (unsigned long int)sizeof(sRGB16) * count);
+	if (image8) memset(image8 + first, 0, (unsigned long int)sizeof(sRGB8) * count);
+	if (alphaBuffer8)
+		memset(alphaBuffer8 + first, 0, (unsigned long int)sizeof(unsigned char) * count);
+	memset(alphaBuffer16 + first, 0, (unsigned long int)sizeof(unsigned short) * count);
+	memset(opacityBuffer + first, 0, (unsigned long int)sizeof(unsigned short) * count);
+	memset(colourBuffer + first, 0, (unsigned long int)sizeof(sRGB8) * count);
 	if (opt.optionalNormal)
 	{
-		if (normalFloat) memset(normalFloat, 0, (unsigned long int)sizeof(sRGBfloat) * width * height);
-		if (normal16) memset(normal16, 0, (unsigned long int)sizeof(sRGB16) * width * height);
-		if (normal8) memset(normal8, 0, (unsigned long int)sizeof(sRGB8) * width * height);
+		if (normalFloat) memset(normalFloat + first, 0, (unsigned long int)sizeof(sRGBfloat) * count);
+		if (normalHalf) memset(normalHalf + first, 0, (unsigned long int)sizeof(sRGBhalf) * count);
+		if (normal16) memset(normal16 + first, 0, (unsigned long int)sizeof(sRGB16) * count);
+		if (normal8) memset(normal8 + first, 0, (unsigned long int)sizeof(sRGB8) * count);
 	}
-	for (long int i = 0; i < width * height; ++i)
+	if (worldPosition)
+		memset(worldPosition + first, 0, (unsigned long int)sizeof(sRGBfloat) * count);
+	if (costBuffer) memset(costBuffer + first, 0, (unsigned long int)sizeof(sRGBfloat) * count);
+	if (gBuffer) memset(gBuffer + first, 0, (unsigned long int)sizeof(sGBufferPixel) * count);
+	for (long int i = first; i < first + count; ++i)
 		zBuffer[i] = 1e20;
+	if (objectIdBuffer)
+	{
+		for (long int i = first; i < first + count; ++i)
+			objectIdBuffer[i] = -1.0f;
+	}
 }
 
 void cImage::FreeImage(void)
 {
 	isAllocated = false;
 	// qDebug() << "void cImage::FreeImage(void)";
-	if (imageFloat) delete[] imageFloat;
-	imageFloat = NULL;
-	if (image16) delete[] image16;
-	image16 = NULL;
-	if (image8) delete[] image8;
-	image8 = NULL;
-	if (alphaBuffer8) delete[] alphaBuffer8;
-	alphaBuffer8 = NULL;
-	if (alphaBuffer16) delete[] alphaBuffer16;
-	alphaBuffer16 = NULL;
-	if (opacityBuffer) delete[] opacityBuffer;
-	opacityBuffer = NULL;
-	if (colourBuffer) delete[] colourBuffer;
-	colourBuffer = NULL;
-	if (zBuffer) delete[] zBuffer;
-	zBuffer = NULL;
-	if (normalFloat) delete[] normalFloat;
-	normalFloat = NULL;
-	if (normal16) delete[] normal16;
-	normal16 = NULL;
-	if (normal8) delete[] normal8;
-	normal8 = NULL;
+	DeleteBuffer(imageFloat);
+	DeleteBuffer(imageHalf);
+	DeleteBuffer(image16);
+	DeleteBuffer(image8);
+	DeleteBuffer(alphaBuffer8);
+	DeleteBuffer(alphaBuffer16);
+	DeleteBuffer(opacityBuffer);
+	DeleteBuffer(colourBuffer);
+	DeleteBuffer(zBuffer);
+	DeleteBuffer(normalFloat);
+	DeleteBuffer(normalHalf);
+	DeleteBuffer(normal16);
+	DeleteBuffer(normal8);
+	DeleteBuffer(worldPosition);
+	DeleteBuffer(objectIdBuffer);
+	DeleteBuffer(costBuffer);
+	DeleteBuffer(cost8);
+	DeleteBuffer(gBuffer);
 	if (gammaTable) delete[] gammaTable;
 	gammaTable = NULL;
 	gammaTablePrepared = false;
@@ -218,42 +353,7 @@ void cImage::FreeImage(void)
 sRGB16 cImage::CalculatePixel(sRGBfloat pixel)
 {
 	CalculateGammaTable();
-	float R = pixel.R * adj.brightness;
-	float G = pixel.G * adj.brightness;
-	float B = pixel.B * adj.brightness;
-
-	R = (R - 0.5) * adj.contrast + 0.5;
-	G = (G - 0.5) * adj.contrast + 0.5;
-	B = (B - 0.5) * adj.contrast + 0.5;
-
-	if (R < 0.0) R = 0.0;
-	if (G < 0.0) G = 0.0;
-	if (B < 0.0) B = 0.0;
-
-	// R = sqrt(tanh(R*R));
-	// G = sqrt(tanh(G*G));
-	// B = sqrt(tanh(B*B));
-	if (adj.hdrEnabled)
-	{
-		R = tanh(R);
-		G = tanh(G);
-		B = tanh(B);
-	}
-
-	if (R > 1.0) R = 1.0;
-	if (G > 1.0) G = 1.0;
-	if (B > 1.0) B = 1.0;
-
-	sRGB16 newPixel16;
-
-	newPixel16.R = R * 65535.0;
-	newPixel16.G = G * 65535.0;
-	newPixel16.B = B * 65535.0;
-	newPixel16.R = gammaTable[newPixel16.R];
-	newPixel16.G = gammaTable[newPixel16.G];
-	newPixel16.B = gammaTable[newPixel16.B];
-
-	return newPixel16;
+	return ToneMapPixel(pixel);
 }
 
 void cImage::CalculateGammaTable(void)
@@ -272,21 +372,35 @@ void cImage::CalculateGammaTable(void)
 
 void cImage::CompileImage(QList<int> *list)
 {
-	int listIndex = 0;
-	for (int y = 0; y < height; y++)
+	TRACE_SCOPE("cImage::CompileImage", "post");
+
+	// gamma table has to be ready before it's used by many threads
+	CalculateGammaTable();
+	if (!list) adjustmentsPreviewOnly = false;
+
+	int numberOfLines = list ? list->size() : height;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < numberOfLines; i++)
 	{
-		if (list)
+		int y = list ? list->at(i) : i;
+		sRGBfloat *lineFloat;
+		QVector<sRGBfloat> lineBuffer;
+		if (imageHalf)
+		{
+			// half precision line is converted at once
+			lineBuffer.resize(width);
+			lineFloat = lineBuffer.data();
+			HalfToPixelArray(&imageHalf[(unsigned long int)y * width], lineFloat, width);
+		}
+		else
 		{
-			if (listIndex >= list->size()) break;
-			y = list->at(listIndex);
-			listIndex++;
+			lineFloat = &imageFloat[(unsigned long int)y * width];
 		}
+		sRGB16 *line16 = &image16[(unsigned long int)y * width];
 		for (int x = 0; x < width; x++)
 		{
-			unsigned long int address = x + y * width;
-			sRGBfloat pixel = imageFloat[address];
-			sRGB16 newPixel16 = CalculatePixel(pixel);
-			image16[address] = newPixel16;
+			line16[x] = ToneMapPixel(lineFloat[x]);
 		}
 	}
 }
@@ -298,7 +412,8 @@ int cImage::GetUsedMB(void) const
 	long int zBufferSize = (long int)width * height * sizeof(float);
 	long int alphaSize16 = (long int)width * height * sizeof(unsigned short);
 	long int alphaSize8 = (long int)width * height * sizeof(unsigned char);
-	long int imageFloatSize = (long int)width * height * sizeof(sRGBfloat);
+	long int floatPixelSize = opt.halfFloat ? sizeof(sRGBhalf) : sizeof(sRGBfloat);
+	long int imageFloatSize = (long int)width * height * floatPixelSize;
 	long int image16Size = (long int)width * height * sizeof(sRGB16);
 	long int image8Size = (long int)width * height * sizeof(sRGB8);
 	long int colorSize = (long int)width * height * sizeof(sRGB8);
@@ -306,10 +421,21 @@ int cImage::GetUsedMB(void) const
 	long int optionalSize = 0;
 	if (opt.optionalNormal)
 	{
-		optionalSize += (long int)width * height * sizeof(sRGBfloat);
+		optionalSize += (long int)width * height * floatPixelSize;
 		optionalSize += (long int)width * height * sizeof(sRGB16);
 		optionalSize += (long int)width * height * sizeof(sRGB8);
 	}
+	if (opt.leanMemory)
+	{
+		alphaSize8 = alphaBuffer8 ? alphaSize8 : 0;
+		image8Size = image8 ? image8Size : 0;
+		if (!normal16) optionalSize -= (long int)width * height * sizeof(sRGB16);
+		if (!normal8) optionalSize -= (long int)width * height * sizeof(sRGB8);
+	}
+	if (opt.optionalWorldPosition) optionalSize += (long int)width * height * sizeof(sRGBfloat);
+	if (opt.optionalObjectId) optionalSize += (long int)width * height * sizeof(float);
+	if (opt.optionalCost) optionalSize += (long int)width * height * sizeof(sRGBfloat);
+	if (opt.optionalGBuffer) optionalSize += (long int)width * height * sizeof(sGBufferPixel);
 	mb = (zBufferSize + alphaSize16 + alphaSize8 + image16Size + image8Size + imageFloatSize
 				 + colorSize + opacitySize + optionalSize)
 			 / 1024 / 1024;
@@ -322,10 +448,12 @@ void cImage::SetImageParameters(sImageAdjustments adjustments)
 	adj = adjustments;
 	gammaTablePrepared = false;
 	CalculateGammaTable();
+	adjustmentsPreviewOnly = false;
 }
 
 unsigned char *cImage::ConvertTo8bit(void)
 {
+	if (!image8) image8 = NewBuffer<sRGB8>();
 	for (long int i = 0; i < width * height; i++)
 	{
 		image8[i].R = image16[i].R / 256;
@@ -335,8 +463,37 @@ unsigned char *cImage::ConvertTo8bit(void)
 	return (unsigned char *)image8;
 }
 
+unsigned char *cImage::ConvertTo8bit(const QList<int> &lines)
+{
+	if (!image8) return ConvertTo8bit();
+
+	for (int i = 0; i < lines.size(); i++)
+	{
+		int y = lines.at(i);
+		if (y < 0 || y >= height) continue;
+		long int end = (long int)(y + 1) * width;
+		for (long int index = (long int)y * width; index < end; index++)
+		{
+			image8[index].R = image16[index].R / 256;
+			image8[index].G = image16[index].G / 256;
+			image8[index].B = image16[index].B / 256;
+		}
+	}
+	return (unsigned char *)image8;
+}
+
+QRegion cImage::TakePreviewDirtyRegion()
+{
+	previewMutex.lock();
+	QRegion region = previewDirtyRegion;
+	previewDirtyRegion = QRegion();
+	previewMutex.unlock();
+	return region;
+}
+
 unsigned char *cImage::ConvertAlphaTo8bit(void)
 {
+	if (!alphaBuffer8) alphaBuffer8 = NewBuffer<unsigned char>();
 	for (long int i = 0; i < width * height; i++)
 	{
 		alphaBuffer8[i] = alphaBuffer16[i] / 256;
@@ -347,11 +504,10 @@ unsigned char *cImage::ConvertAlphaTo8bit(void)
 unsigned char *cImage::ConvertNormalto16Bit(void)
 {
 	if (!opt.optionalNormal) return NULL;
+	if (!normal16) normal16 = NewBuffer<sRGB16>();
 	for (long int i = 0; i < width * height; i++)
 	{
-		normal16[i].R = normalFloat[i].R * 65535;
-		normal16[i].G = normalFloat[i].G * 65535;
-		normal16[i].B = normalFloat[i].B * 65535;
+		normal16[i] = Normal16bit(GetNormalFloat(i));
 	}
 	return (unsigned char *)normal16;
 }
@@ -359,15 +515,58 @@ unsigned char *cImage::ConvertNormalto16Bit(void)
 unsigned char *cImage::ConvertNormalto8Bit(void)
 {
 	if (!opt.optionalNormal) return NULL;
+	if (!normal8) normal8 = NewBuffer<sRGB8>();
 	for (long int i = 0; i < width * height; i++)
 	{
-		normal8[i].R = normalFloat[i].R * 255;
-		normal8[i].G = normalFloat[i].G * 255;
-		normal8[i].B = normalFloat[i].B * 255;
+		normal8[i] = Normal8bit(GetNormalFloat(i));
 	}
 	return (unsigned char *)normal8;
 }
 
+unsigned char *cImage::ConvertCostTo8Bit(void)
+{
+	if (!opt.optionalCost) return NULL;
+	if (!cost8) cost8 = NewBuffer<sRGB8>();
+
+	float maxCost = 0.0f;
+	for (long int i = 0; i < width * height; i++)
+		maxCost = qMax(maxCost, costBuffer[i].R);
+	float logMax = logf(1.0f + maxCost);
+
+	// during progressive passes only the first pixel of block has valid cost
+	int step = qMax(progressiveFactor, 1);
+	for (long int i = 0; i < width * height; i++)
+	{
+		long int origin = i;
+		if (step > 1)
+		{
+			long int x = i % width;
+			long int y = i / width;
+			origin = (x / step * step) + (y / step * step) * width;
+		}
+		float t = (logMax > 0.0f) ? logf(1.0f + costBuffer[origin].R) / logMax : 0.0f;
+
+		// blue - cyan - green - yellow - red
+		float r = qBound(0.0f, 4.0f * t - 2.0f, 1.0f);
+		float g = qBound(0.0f, (t < 0.75f) ? 4.0f * t : 4.0f - 4.0f * t, 1.0f);
+		float b = qBound(0.0f, 2.0f - 4.0f * t, 1.0f);
+		cost8[i] = sRGB8(r * 255, g * 255, b * 255);
+	}
+	return (unsigned char *)cost8;
+}
+
+void cImage::FreeDerivedBuffers(void)
+{
+	if (!opt.leanMemory) return;
+
+	// preview is calculated from 8-bit image
+	if (!previewAllocated) DeleteBuffer(image8);
+	DeleteBuffer(alphaBuffer8);
+	DeleteBuffer(normal16);
+	DeleteBuffer(normal8);
+	DeleteBuffer(cost8);
+}
+
 sRGB8 cImage::Interpolation(float x, float y) const
 {
 	sRGB8 colour = sRGB8(0, 0, 0);
@@ -416,6 +615,7 @@ unsigned char *cImage::CreatePreview(
 	previewWidth = w;
 	previewHeight = h;
 	previewScale = scale;
+	previewFloat.clear();
 	unsigned char *ptr = (unsigned char *)preview;
 
 	if (widget) imageWidget = widget;
@@ -433,9 +633,40 @@ void cImage::UpdatePreview(QList<int> *list)
 		int w = previewWidth;
 		int h = previewHeight;
 
+		// image has changed, so downsampled float image is not valid anymore
+		previewFloat.clear();
+
+		// 8-bit image doesn't contain previewed adjustments
+		if (adjustmentsPreviewOnly && !list)
+		{
+			ToneMapPreview();
+			previewMutex.unlock();
+			return;
+		}
+
+		// in lean memory mode 8-bit image is created with the first preview
+		if (!image8) ConvertTo8bit();
+
 		if (width == w && height == h)
 		{
-			memcpy(preview, image8, width * height * sizeof(sRGB8));
+			if (list)
+			{
+				for (int i = 0; i < list->size(); i++)
+				{
+					int y = list->at(i);
+					if (y < 0 || y >= height) continue;
+					size_t offset = (size_t)y * width;
+					memcpy(&preview[offset], &image8[offset], width * sizeof(sRGB8));
+					memcpy(&preview2[offset], &image8[offset], width * sizeof(sRGB8));
+					previewDirtyRegion += QRect(0, y, w, 1);
+				}
+			}
+			else
+			{
+				memcpy(preview, image8, width * height * sizeof(sRGB8));
+				memcpy(preview2, preview, w * h * sizeof(sRGB8));
+				previewDirtyRegion = QRegion(0, 0, w, h);
+			}
 		}
 		else
 		{
@@ -450,11 +681,26 @@ void cImage::UpdatePreview(QList<int> *list)
 			float deltaX = scaleX / countX;
 			float deltaY = scaleY / countY;
 
-			int listIndex = 0;
+			// sampling positions are the same for all lines, so they are calculated only once
+			QVector<int> columnIndex(w * countX);
+			QVector<int> columnFraction(w * countX);
+			for (int x = 0; x < w; x++)
+			{
+				for (int i = 0; i < countX; i++)
+				{
+					float xx = x * scaleX + i * deltaX;
+					int index = x * countX + i;
+					columnIndex[index] = (xx > 0 && xx < width - 1) ? (int)xx : -1;
+					columnFraction[index] = (xx - (int)xx) * 256;
+				}
+			}
 
+			// lines of preview which need to be updated
+			QVector<int> lines;
+			lines.reserve(h);
+			int listIndex = 0;
 			for (int y = 0; y < h; y++)
 			{
-
 				if (list)
 				{
 					if (listIndex >= list->size()) break;
@@ -467,10 +713,14 @@ void cImage::UpdatePreview(QList<int> *list)
 						if (listIndex >= list->size()) break;
 					}
 				}
+				lines.append(y);
+			}
 
-				//#ifndef WIN32
-				//#pragma omp parallel for
-				//#endif
+			int numberOfLines = lines.size();
+#pragma omp parallel for schedule(dynamic, 1)
+			for (int n = 0; n < numberOfLines; n++)
+			{
+				int y = lines[n];
 				for (int x = 0; x < w; x++)
 				{
 					int R = 0;
@@ -479,17 +729,30 @@ void cImage::UpdatePreview(QList<int> *list)
 					for (int j = 0; j < countY; j++)
 					{
 						float yy = y * scaleY + j * deltaY;
+						if (yy <= 0 || yy >= height - 1) continue;
+						int iy = yy;
+						int ry = (yy - iy) * 256;
+						const sRGB8 *line1 = &image8[iy * width];
+						const sRGB8 *line2 = &image8[(iy + 1) * width];
 
 						for (int i = 0; i < countX; i++)
 						{
-							float xx = x * scaleX + i * deltaX;
-							if (xx > 0 && xx < width - 1 && yy > 0 && yy < height - 1)
-							{
-								sRGB8 oldPixel = Interpolation(xx, yy);
-								R += oldPixel.R;
-								G += oldPixel.G;
-								B += oldPixel.B;
-							}
+							int ix = columnIndex[x * countX + i];
+							if (ix < 0) continue;
+							int rx = columnFraction[x * countX + i];
+
+							// bilinear interpolation the same as in Interpolation()
+							int w1 = (255 - rx) * (255 - ry);
+							int w2 = rx * (255 - ry);
+							int w3 = (255 - rx) * ry;
+							int w4 = rx * ry;
+							sRGB8 k1 = line1[ix];
+							sRGB8 k2 = line1[ix + 1];
+							sRGB8 k3 = line2[ix];
+							sRGB8 k4 = line2[ix + 1];
+							R += (k1.R * w1 + k2.R * w2 + k3.R * w3 + k4.R * w4) / 65536;
+							G += (k1.G * w1 + k2.G * w2 + k3.G * w3 + k4.G * w4) / 65536;
+							B += (k1.B * w1 + k2.B * w2 + k3.B * w3 + k4.B * w4) / 65536;
 						} // next i
 					}		// next j
 					sRGB8 newpixel;
@@ -499,8 +762,14 @@ void cImage::UpdatePreview(QList<int> *list)
 					preview[x + y * w] = newpixel;
 				} // next x
 			}		// next y
+
+			for (int n = 0; n < numberOfLines; n++)
+			{
+				int y = lines[n];
+				memcpy(&preview2[y * w], &preview[y * w], w * sizeof(sRGB8));
+				previewDirtyRegion += QRect(0, y, w, 1);
+			}
 		}
-		memcpy(preview2, preview, w * h * sizeof(sRGB8));
 		previewMutex.unlock();
 	}
 	else
@@ -509,6 +778,75 @@ void cImage::UpdatePreview(QList<int> *list)
 	}
 }
 
+void cImage::PreviewImageAdjustments(const sImageAdjustments &adjustments)
+{
+	if (!previewAllocated || allocLater) return;
+
+	SetImageParameters(adjustments);
+
+	previewMutex.lock();
+	ToneMapPreview();
+	previewMutex.unlock();
+
+	adjustmentsPreviewOnly = true;
+}
+
+void cImage::DownsampleFloatPreview()
+{
+	int w = previewWidth;
+	int h = previewHeight;
+	previewFloat.resize(w * h);
+
+	// average of all image pixels covered by preview pixel
+	float scaleX = (float)width / w;
+	float scaleY = (float)height / h;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < h; y++)
+	{
+		int y1 = qMin(int(y * scaleY), height - 1);
+		int y2 = qMax(qMin(int((y + 1) * scaleY), height), y1 + 1);
+		for (int x = 0; x < w; x++)
+		{
+			int x1 = qMin(int(x * scaleX), width - 1);
+			int x2 = qMax(qMin(int((x + 1) * scaleX), width), x1 + 1);
+			sRGBfloat sum(0.0f, 0.0f, 0.0f);
+			for (int yy = y1; yy < y2; yy++)
+			{
+				for (int xx = x1; xx < x2; xx++)
+				{
+					sRGBfloat pixel = GetImageFloat((long int)yy * width + xx);
+					sum.R += pixel.R;
+					sum.G += pixel.G;
+					sum.B += pixel.B;
+				}
+			}
+			float factor = 1.0f / ((x2 - x1) * (y2 - y1));
+			previewFloat[x + y * w] = sRGBfloat(sum.R * factor, sum.G * factor, sum.B * factor);
+		}
+	}
+}
+
+void cImage::ToneMapPreview()
+{
+	int w = previewWidth;
+	int h = previewHeight;
+	if (previewFloat.size() != w * h) DownsampleFloatPreview();
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			sRGB16 pixel = ToneMapPixel(previewFloat[x + y * w]);
+			sRGB8 pixel8(pixel.R / 256, pixel.G / 256, pixel.B / 256);
+			preview[x + y * w] = pixel8;
+			preview2[x + y * w] = pixel8;
+		}
+	}
+	previewDirtyRegion = QRegion(0, 0, w, h);
+}
+
 unsigned char *cImage::GetPreviewPtr(void)
 {
 	unsigned char *ptr = 0;
@@ -570,28 +908,40 @@ void cImage::RedrawInWidget(QWidget *qwidget)
 	}
 }
 
-void cImage::Squares(int y, int pFactor)
+void cImage::FillOptionalBlocks(int x1, int y1, int x2, int y2, int step)
 {
-	progressiveFactor = pFactor;
-	for (int x = 0; x <= width - pFactor; x += pFactor)
+	if (step <= 1) return;
+	if (!opt.optionalNormal && !opt.optionalWorldPosition && !opt.optionalObjectId
+			&& !opt.optionalCost && !opt.optionalGBuffer)
+		return;
+
+	x1 = qMax(x1, 0);
+	y1 = qMax(y1, 0);
+	x2 = qMin(x2, width);
+	y2 = qMin(y2, height);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = y1; y < y2; y++)
 	{
-		sRGBfloat pixelTemp = imageFloat[x + y * width];
-		float zBufferTemp = zBuffer[x + y * width];
-		sRGB8 colourTemp = colourBuffer[x + y * width];
-		unsigned short alphaTemp = alphaBuffer16[x + y * width];
-		unsigned short opacityTemp = opacityBuffer[x + y * width];
-
-		for (int yy = 0; yy < pFactor; yy++)
+		int yOrigin = y1 + (y - y1) / step * step;
+		for (int x = x1; x < x2; x++)
 		{
-			for (int xx = 0; xx < pFactor; xx++)
+			int xOrigin = x1 + (x - x1) / step * step;
+			if (x == xOrigin && y == yOrigin) continue;
+
+			long int index = x + (long int)y * width;
+			long int origin = xOrigin + (long int)yOrigin * width;
+			if (opt.optionalNormal)
 			{
-				if (xx == 0 && yy == 0) continue;
-				imageFloat[x + xx + (y + yy) * width] = pixelTemp;
-				zBuffer[x + xx + (y + yy) * width] = zBufferTemp;
-				colourBuffer[x + xx + (y + yy) * width] = colourTemp;
-				alphaBuffer16[x + xx + (y + yy) * width] = alphaTemp;
-				opacityBuffer[x + xx + (y + yy) * width] = opacityTemp;
+				if (normalHalf)
+					normalHalf[index] = normalHalf[origin];
+				else
+					normalFloat[index] = normalFloat[origin];
 			}
+			if (opt.optionalWorldPosition) worldPosition[index] = worldPosition[origin];
+			if (opt.optionalObjectId) objectIdBuffer[index] = objectIdBuffer[origin];
+			if (opt.optionalCost) costBuffer[index] = costBuffer[origin];
+			if (opt.optionalGBuffer) gBuffer[index] = gBuffer[origin];
 		}
 	}
 }
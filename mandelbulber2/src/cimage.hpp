@@ -36,20 +36,90 @@
 #define MANDELBULBER2_SRC_CIMAGE_HPP_
 
 //#include <QtGui/QWidget>
+#include <cmath>
+
+#include "algebra.hpp"
 #include "color_structures.hpp"
+#include "half_float.h"
 #include "image_adjustments.h"
+#include <QFile>
+#include <QMap>
 #include <QMutex>
+#include <QRegion>
+#include <QSet>
+#include <QVector>
 #include <QWidget>
 
 struct sImageOptional
 {
-	sImageOptional() : optionalNormal(false) {}
+	sImageOptional()
+			: optionalNormal(false),
+				optionalWorldPosition(false),
+				optionalObjectId(false),
+				optionalCost(false),
+				optionalGBuffer(false),
+				leanMemory(false),
+				halfFloat(false),
+				memoryMapped(false),
+				firstTouch(false)
+	{
+	}
 	inline bool operator==(sImageOptional other) const
 	{
-		return other.optionalNormal == optionalNormal;
+		return other.optionalNormal == optionalNormal
+					 && other.optionalWorldPosition == optionalWorldPosition
+					 && other.optionalObjectId == optionalObjectId && other.optionalCost == optionalCost
+					 && other.optionalGBuffer == optionalGBuffer
+					 && other.leanMemory == leanMemory && other.halfFloat == halfFloat
+					 && other.memoryMapped == memoryMapped && other.scratchFolder == scratchFolder
+					 && other.firstTouch == firstTouch;
 	}
 
 	bool optionalNormal;
+	// world coordinates of surface seen by primary ray
+	bool optionalWorldPosition;
+	// index of object seen by primary ray (-1 for background)
+	bool optionalObjectId;
+	// rendering cost of pixel (R - DE evaluations, G - fractal iterations, B - ray-marching steps)
+	bool optionalCost;
+	// geometry of primary ray hits used to re-shade the image without ray-marching
+	bool optionalGBuffer;
+	// 8-bit and 16-bit normal buffers are not kept, but calculated when needed
+	bool leanMemory;
+	// float image and normal buffers are stored in half precision
+	bool halfFloat;
+	// image buffers are stored in memory-mapped scratch files instead of RAM
+	bool memoryMapped;
+	QString scratchFolder;
+	// buffers are not cleared at allocation, but by rendering threads, so memory pages are placed
+	// on NUMA nodes of threads which render them
+	bool firstTouch;
+};
+
+// geometry of surface seen by primary ray
+struct sGBufferPixel
+{
+	sGBufferPixel()
+			: depth(0.0f),
+				distThresh(0.0f),
+				lastDist(0.0f),
+				colorIndex(0.0f),
+				orbitTrapR(0.0f),
+				objectId(0),
+				found(false),
+				fractalDataValid(false)
+	{
+	}
+	CVector3 point;
+	CVector3 normal; // final normal vector (with normal map applied)
+	float depth;
+	float distThresh;
+	float lastDist;
+	float colorIndex;
+	float orbitTrapR;
+	int objectId;
+	bool found;
+	bool fractalDataValid;
 };
 
 struct sAllImageData
@@ -71,7 +141,14 @@ public:
 	~cImage();
 	bool IsAllocated() const { return isAllocated; }
 	bool ChangeSize(int w, int h, sImageOptional optional);
+	// copy of all image layers and adjustments of other image
+	bool CopyFrom(const cImage *source);
 	void ClearImage(void);
+	// clears lines y1 to y2 - 1 of all buffers
+	void ClearImageLines(int y1, int y2);
+	// buffers were allocated with first-touch option and are not cleared yet
+	bool IsClearPending() const { return clearPending; }
+	void MarkCleared() { clearPending = false; }
 
 	bool IsUsed() const { return isUsed; }
 	void BlockImage() { isUsed = true; }
@@ -82,7 +159,7 @@ public:
 
 	inline void PutPixelImage(int x, int y, sRGBfloat pixel)
 	{
-		if (x >= 0 && x < width && y >= 0 && y < height) imageFloat[x + y * width] = pixel;
+		if (x >= 0 && x < width && y >= 0 && y < height) SetImageFloat(x + y * width, pixel);
 	}
 	inline void PutPixelImage16(int x, int y, sRGB16 pixel)
 	{
@@ -106,12 +183,34 @@ public:
 	}
 	inline void PutPixelNormal(int x, int y, sRGBfloat normal)
 	{
-		if (x >= 0 && x < width && y >= 0 && y < height) normalFloat[x + y * width] = normal;
+		if (x >= 0 && x < width && y >= 0 && y < height)
+		{
+			if (normalHalf)
+				normalHalf[x + y * width] = PixelToHalf(normal);
+			else
+				normalFloat[x + y * width] = normal;
+		}
+	}
+	inline void PutPixelWorldPosition(int x, int y, sRGBfloat position)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) worldPosition[x + y * width] = position;
+	}
+	inline void PutPixelObjectId(int x, int y, float id)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) objectIdBuffer[x + y * width] = id;
+	}
+	inline void PutPixelCost(int x, int y, sRGBfloat cost)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) costBuffer[x + y * width] = cost;
+	}
+	inline void PutPixelGBuffer(int x, int y, const sGBufferPixel &pixel)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) gBuffer[x + y * width] = pixel;
 	}
 	inline sRGBfloat GetPixelImage(int x, int y) const
 	{
 		if (x >= 0 && x < width && y >= 0 && y < height)
-			return imageFloat[x + y * width];
+			return GetImageFloat(x + y * width);
 		else
 			return BlackFloat();
 	}
@@ -125,7 +224,7 @@ public:
 	inline sRGB8 GetPixelImage8(int x, int y) const
 	{
 		if (x >= 0 && x < width && y >= 0 && y < height)
-			return image8[x + y * width];
+			return image8 ? image8[x + y * width] : To8bit(image16[x + y * width]);
 		else
 			return Black8();
 	}
@@ -139,7 +238,7 @@ public:
 	inline unsigned char GetPixelAlpha8(int x, int y) const
 	{
 		if (x >= 0 && x < width && y >= 0 && y < height)
-			return alphaBuffer8[x + y * width];
+			return alphaBuffer8 ? alphaBuffer8[x + y * width] : alphaBuffer16[x + y * width] / 256;
 		else
 			return 0;
 	}
@@ -167,19 +266,46 @@ public:
 	inline sRGBfloat GetPixelNormal(int x, int y) const
 	{
 		if (!opt.optionalNormal) return BlackFloat();
-		if (x >= 0 && x < width && y >= 0 && y < height) return normalFloat[x + y * width];
+		if (x >= 0 && x < width && y >= 0 && y < height) return GetNormalFloat(x + y * width);
 		return BlackFloat();
 	}
+	inline sRGBfloat GetPixelWorldPosition(int x, int y) const
+	{
+		if (!opt.optionalWorldPosition) return BlackFloat();
+		if (x >= 0 && x < width && y >= 0 && y < height) return worldPosition[x + y * width];
+		return BlackFloat();
+	}
+	inline float GetPixelObjectId(int x, int y) const
+	{
+		if (!opt.optionalObjectId) return -1.0f;
+		if (x >= 0 && x < width && y >= 0 && y < height) return objectIdBuffer[x + y * width];
+		return -1.0f;
+	}
+	inline sRGBfloat GetPixelCost(int x, int y) const
+	{
+		if (!opt.optionalCost) return BlackFloat();
+		if (x >= 0 && x < width && y >= 0 && y < height) return costBuffer[x + y * width];
+		return BlackFloat();
+	}
+	// returns pixel with found == false if there is no G-buffer
+	inline sGBufferPixel GetPixelGBuffer(int x, int y) const
+	{
+		if (opt.optionalGBuffer && x >= 0 && x < width && y >= 0 && y < height)
+			return gBuffer[x + y * width];
+		return sGBufferPixel();
+	}
 	inline sRGB16 GetPixelNormal16(int x, int y) const
 	{
 		if (!opt.optionalNormal) return Black16();
-		if (x >= 0 && x < width && y >= 0 && y < height) return normal16[x + y * width];
+		if (x >= 0 && x < width && y >= 0 && y < height)
+			return normal16 ? normal16[x + y * width] : Normal16bit(GetNormalFloat(x + y * width));
 		return Black16();
 	}
 	inline sRGB8 GetPixelNormal8(int x, int y) const
 	{
 		if (!opt.optionalNormal) return Black8();
-		if (x >= 0 && x < width && y >= 0 && y < height) return normal8[x + y * width];
+		if (x >= 0 && x < width && y >= 0 && y < height)
+			return normal8 ? normal8[x + y * width] : Normal8bit(GetNormalFloat(x + y * width));
 		return Black8();
 	}
 	inline void BlendPixelImage16(int x, int y, double factor, sRGB16 other)
@@ -193,9 +319,11 @@ public:
 	inline void BlendPixelImage(int x, int y, double factor, sRGBfloat other)
 	{
 		double factorN = 1.0 - factor;
-		imageFloat[x + y * width].R = imageFloat[x + y * width].R * factorN + other.R * factor;
-		imageFloat[x + y * width].G = imageFloat[x + y * width].G * factorN + other.G * factor;
-		imageFloat[x + y * width].B = imageFloat[x + y * width].B * factorN + other.B * factor;
+		sRGBfloat pixel = GetImageFloat(x + y * width);
+		pixel.R = pixel.R * factorN + other.R * factor;
+		pixel.G = pixel.G * factorN + other.G * factor;
+		pixel.B = pixel.B * factorN + other.B * factor;
+		SetImageFloat(x + y * width, pixel);
 	}
 
 	inline void BlendPixelAlpha(int x, int y, double factor, unsigned short int other)
@@ -209,8 +337,16 @@ public:
 	unsigned short *GetAlphaBufPtr(void) { return alphaBuffer16; }
 	unsigned char *GetAlphaBufPtr8(void) { return alphaBuffer8; }
 	float *GetZBufferPtr(void) { return zBuffer; }
+	sRGBfloat *GetWorldPositionPtr(void) { return worldPosition; }
+	float *GetObjectIdPtr(void) { return objectIdBuffer; }
+	sRGBfloat *GetCostPtr(void) { return costBuffer; }
 	sRGB8 *GetColorPtr(void) { return colourBuffer; }
 	unsigned short *GetOpacityPtr(void) { return opacityBuffer; }
+	// float buffers are allocated in full or in half precision (the other pointer is NULL)
+	sRGBfloat *GetImageFloatPtr(void) { return imageFloat; }
+	sRGBhalf *GetImageHalfPtr(void) { return imageHalf; }
+	sRGBfloat *GetNormalFloatPtr(void) { return normalFloat; }
+	sRGBhalf *GetNormalHalfPtr(void) { return normalHalf; }
 	size_t GetZBufferSize(void) const { return sizeof(float) * height * width; }
 	QWidget *GetImageWidget(void) { return imageWidget; }
 
@@ -229,17 +365,32 @@ public:
 	sImageOptional *GetImageOptional(void) { return &opt; }
 
 	unsigned char *ConvertTo8bit(void);
+	// converts only given lines
+	unsigned char *ConvertTo8bit(const QList<int> &lines);
 	unsigned char *ConvertAlphaTo8bit(void);
 	unsigned char *ConvertNormalto16Bit(void);
 	unsigned char *ConvertNormalto8Bit(void);
+	// heatmap of DE evaluations (logarithmic scale)
+	unsigned char *ConvertCostTo8Bit(void);
+	// frees buffers which are allocated only on demand in lean memory mode
+	void FreeDerivedBuffers(void);
 	unsigned char *CreatePreview(double scale, int visibleWidth, int visibleHeight, QWidget *widget);
 	void UpdatePreview(QList<int> *list = NULL);
+	// part of preview changed by UpdatePreview() since last call. Widget has to repaint only this
+	// part, QPainter in paintEvent() clips redrawing of the preview to it
+	QRegion TakePreviewDirtyRegion();
 	unsigned char *GetPreviewPtr(void);
 	unsigned char *GetPreviewPrimaryPtr(void);
 	bool IsPreview(void) const;
+	// tone mapping with new adjustments calculated only for pixels of the preview, so it doesn't
+	// depend on image resolution. 16-bit and 8-bit images stay unchanged until CompileImage()
+	void PreviewImageAdjustments(const sImageAdjustments &adjustments);
+	bool IsAdjustmentsPreviewOnly(void) const { return adjustmentsPreviewOnly; }
 	void RedrawInWidget(QWidget *qwidget = NULL);
 	double GetPreviewScale() const { return previewScale; }
-	void Squares(int y, int progressiveFactor);
+	// optional buffers get only one sample per block in progressive passes. Pixels of the region
+	// which are not on the grid of given step are filled with sample of their block
+	void FillOptionalBlocks(int x1, int y1, int x2, int y2, int step);
 	void CalculateGammaTable(void);
 	sRGB16 CalculatePixel(sRGBfloat pixel);
 
@@ -250,20 +401,101 @@ public:
 	void CircleBorder(double x, double y, float z, double r, sRGB8 border, double borderWidth,
 		sRGBfloat opacity, int layer);
 
+	// step of current progressive pass. Only the first pixel of each block of optional buffers is
+	// valid, so displayed optional buffers are sampled at block origins
 	int progressiveFactor;
 
 private:
 	bool isAllocated;
 	sRGB8 Interpolation(float x, float y) const;
+	void DownsampleFloatPreview(void);
+	void ToneMapPreview(void);
 	bool AllocMem(void);
 	void FreeImage(void);
+
+	// image buffers allocated in RAM or in memory-mapped scratch file
+	template <typename T>
+	T *NewBuffer()
+	{
+		if (opt.memoryMapped) return static_cast<T *>(MapBuffer(sizeof(T) * width * height));
+		if (opt.firstTouch) return static_cast<T *>(AllocUntouchedBuffer(sizeof(T) * width * height));
+		return new T[width * height];
+	}
+	template <typename T>
+	void DeleteBuffer(T *&buffer)
+	{
+		if (buffer && !UnmapBuffer(buffer) && !FreeUntouchedBuffer(buffer)) delete[] buffer;
+		buffer = NULL;
+	}
+	void *MapBuffer(qint64 size);
+	bool UnmapBuffer(void *buffer);
+	// raw memory without constructors called, so pages are not touched by allocating thread
+	void *AllocUntouchedBuffer(qint64 size);
+	bool FreeUntouchedBuffer(void *buffer);
 	inline sRGB16 Black16(void) const { return sRGB16(0, 0, 0); }
+
+	// brightness, contrast, HDR and gamma correction (gamma table has to be prepared)
+	inline sRGB16 ToneMapPixel(sRGBfloat pixel) const
+	{
+		float brightness = adj.brightness;
+		float contrast = adj.contrast;
+		float R = (pixel.R * brightness - 0.5f) * contrast + 0.5f;
+		float G = (pixel.G * brightness - 0.5f) * contrast + 0.5f;
+		float B = (pixel.B * brightness - 0.5f) * contrast + 0.5f;
+
+		R = qMax(R, 0.0f);
+		G = qMax(G, 0.0f);
+		B = qMax(B, 0.0f);
+
+		if (adj.hdrEnabled)
+		{
+			R = tanhf(R);
+			G = tanhf(G);
+			B = tanhf(B);
+		}
+
+		R = qMin(R, 1.0f);
+		G = qMin(G, 1.0f);
+		B = qMin(B, 1.0f);
+
+		return sRGB16(gammaTable[(unsigned short)(R * 65535.0f)],
+			gammaTable[(unsigned short)(G * 65535.0f)], gammaTable[(unsigned short)(B * 65535.0f)]);
+	}
 	inline sRGB8 Black8(void) const { return sRGB8(0, 0, 0); }
+	// access to float buffers, which can be stored in half precision
+	inline sRGBfloat GetImageFloat(long int index) const
+	{
+		return imageHalf ? HalfToPixel(imageHalf[index]) : imageFloat[index];
+	}
+	inline void SetImageFloat(long int index, const sRGBfloat &pixel)
+	{
+		if (imageHalf)
+			imageHalf[index] = PixelToHalf(pixel);
+		else
+			imageFloat[index] = pixel;
+	}
+	inline sRGBfloat GetNormalFloat(long int index) const
+	{
+		return normalHalf ? HalfToPixel(normalHalf[index]) : normalFloat[index];
+	}
 	inline sRGBfloat BlackFloat(void) const { return sRGBfloat(0, 0, 0); }
+	static inline sRGB8 To8bit(sRGB16 pixel)
+	{
+		return sRGB8(pixel.R / 256, pixel.G / 256, pixel.B / 256);
+	}
+	static inline sRGB16 Normal16bit(sRGBfloat normal)
+	{
+		return sRGB16(normal.R * 65535, normal.G * 65535, normal.B * 65535);
+	}
+	static inline sRGB8 Normal8bit(sRGBfloat normal)
+	{
+		return sRGB8(normal.R * 255, normal.G * 255, normal.B * 255);
+	}
 
 	sRGB8 *image8;
 	sRGB16 *image16;
 	sRGBfloat *imageFloat;
+	sRGBhalf *imageHalf; // used instead of imageFloat in half precision mode
 
 	unsigned char *alphaBuffer8;
 	unsigned short *alphaBuffer16;
@@ -273,8 +505,14 @@ private:
 
 	// optional image buffers
 	sRGBfloat *normalFloat;
+	sRGBhalf *normalHalf;
 	sRGB8 *normal8;
 	sRGB16 *normal16;
+	sRGBfloat *worldPosition;
+	float *objectIdBuffer;
+	sRGBfloat *costBuffer;
+	sRGB8 *cost8;
+	sGBufferPixel *gBuffer;
 
 	sRGB8 *preview;
 	sRGB8 *preview2;
@@ -296,6 +534,13 @@ private:
 	bool allocLater;
 
 	QMutex previewMutex;
+	QRegion previewDirtyRegion;
+	// float image downsampled to preview size, used for previewing of image adjustments
+	QVector<sRGBfloat> previewFloat;
+	bool adjustmentsPreviewOnly;
+	QMap<void *, QFile *> mappedBuffers;
+	QSet<void *> untouchedBuffers;
+	bool clearPending;
 
 	volatile bool isUsed;
 };
@@ -33,6 +33,7 @@
  */
 
 #include "color_palette.hpp"
+#include "algebra_simd.h"
 #include "common_math.h"
 #include "random.hpp"
 #include <QtCore>
@@ -49,6 +50,7 @@ void cColorPalette::AppendColor(const sRGB &color)
 	palette.append(color);
 	isInitialized = true;
 	paletteSize = palette.size();
+	lookupTable.clear();
 }
 
 void cColorPalette::ChangeColor(int index, const sRGB &color)
@@ -56,6 +58,7 @@ void cColorPalette::ChangeColor(int index, const sRGB &color)
 	if (index < paletteSize && index >= 0)
 	{
 		palette[index] = color;
+		lookupTable.clear();
 	}
 	else
 	{
@@ -132,6 +135,55 @@ sRGB cColorPalette::IndexToColour(int index) const
 	return colour;
 }
 
+void cColorPalette::PrepareLookupTable()
+{
+	lookupTable.clear();
+	if (!isInitialized) return;
+
+	lookupTable.resize(paletteSize * 2);
+	for (int col = 0; col < paletteSize; col++)
+	{
+		const sRGB &color1 = palette[col];
+		const sRGB &color2 = palette[(col + 1) % paletteSize];
+		lookupTable[col * 2] =
+			sRGBAfloat(color1.R / 256.0f, color1.G / 256.0f, color1.B / 256.0f, 0.0f);
+		lookupTable[col * 2 + 1] = sRGBAfloat((color2.R - color1.R) / 65536.0f,
+			(color2.G - color1.G) / 65536.0f, (color2.B - color1.B) / 65536.0f, 0.0f);
+	}
+}
+
+sRGBfloat cColorPalette::IndexToColourFloat(int index) const
+{
+	if (lookupTable.isEmpty())
+	{
+		sRGB colour = IndexToColour(index);
+		return sRGBfloat(colour.R / 256.0f, colour.G / 256.0f, colour.B / 256.0f);
+	}
+
+	int col, delta;
+	if (index < 0)
+	{
+		col = paletteSize - 1;
+		delta = 0;
+	}
+	else
+	{
+		col = (index / 256) % paletteSize;
+		delta = index % 256;
+	}
+	const sRGBAfloat &base = lookupTable[col * 2];
+	const sRGBAfloat &step = lookupTable[col * 2 + 1];
+
+#ifdef ALGEBRA_SIMD
+	float result[4];
+	simd4fStore(result, simd4fAdd(simd4fLoad(&base.R),
+												simd4fMul(simd4fLoad(&step.R), simd4fSet1(float(delta)))));
+	return sRGBfloat(result[0], result[1], result[2]);
+#else
+	return sRGBfloat(base.R + step.R * delta, base.G + step.G * delta, base.B + step.B * delta);
+#endif
+}
+
 sRGB cColorPalette::GetColor(int index) const
 {
 	sRGB colour(255, 255, 255);
@@ -46,12 +46,19 @@ public:
 	void AppendColor(const sRGB &color);
 	void ChangeColor(int index, const sRGB &color);
 	sRGB IndexToColour(int index) const;
+	// the same interpolation as IndexToColour(), but taken from lookup table. Result is divided
+	// by 256
+	sRGBfloat IndexToColourFloat(int index) const;
+	// has to be called after palette is filled, before IndexToColourFloat() is used
+	void PrepareLookupTable();
 	sRGB GetColor(int index) const;
 	int GetSize() const { return paletteSize; }
 	bool IsInitialized() const { return isInitialized; }
 
 private:
 	QVector<sRGB> palette;
+	// pairs of base colour and colour increment per index step for each palette entry
+	QVector<sRGBAfloat> lookupTable;
 	bool isInitialized;
 	int paletteSize;
 };
@@ -34,19 +34,31 @@
 
 #include "command_line_interface.hpp"
 
+#include <QJsonArray>
+#include <QJsonDocument>
+
 #include "../src/interface.hpp"
 #include "animation_frames.hpp"
+#include "benchmark.hpp"
+#include "de_factor_optimizer.hpp"
+#include "formula_benchmark.hpp"
 #include "error_message.hpp"
 #include "fractal_container.hpp"
 #include "global_data.hpp"
 #include "headless.h"
 #include "initparameters.hpp"
 #include "keyframes.hpp"
+#include "mesh_export.hpp"
 #include "netrender.hpp"
 #include "queue.hpp"
+#include "render_estimate.hpp"
+#include "render_service.hpp"
+#include "parameter_sweep.hpp"
 #include "settings.hpp"
 #include "system.hpp"
 #include "test.hpp"
+#include "progress_stream.hpp"
+#include "trace.hpp"
 
 cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 {
@@ -79,6 +91,11 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 		QCoreApplication::translate("main", "Stops rendering on frame number <N>."),
 		QCoreApplication::translate("main", "N"));
 
+	QCommandLineOption farmOption(QStringList({"farm"}),
+		QCoreApplication::translate("main",
+			"Renders animation together with other instances which use the same output folder. "
+			"Frames are claimed with lock files."));
+
 	QCommandLineOption overrideOption(
 		QStringList({"O", "override"}),
 		QCoreApplication::translate("main",
@@ -125,6 +142,12 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 			" (Host can be of type IPv4, IPv6 and Domain name address)."),
 		QCoreApplication::translate("main", "N.N.N.N"));
 
+	QCommandLineOption relayOption(QStringList({"R", "relay"}),
+		QCoreApplication::translate("main",
+			"Sets application as a netrender relay: a client of the server given with --host, which "
+			"forwards work to clients connected to it on given port."),
+		QCoreApplication::translate("main", "N"));
+
 	QCommandLineOption portOption(QStringList({"p", "port"}),
 		QCoreApplication::translate("main", "Sets network port number for netrender (default 5555)."),
 		QCoreApplication::translate("main", "N"));
@@ -143,17 +166,105 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 	QCommandLineOption testOption(QStringList({"t", "test"}),
 		QCoreApplication::translate("main", "Runs testcases on the mandelbulber instance"));
 
+	QCommandLineOption benchmarkOption(QStringList({"benchmark"}),
+		QCoreApplication::translate("main",
+			"Renders standard suite of example scenes and prints performance results in JSON format "
+			"(or saves them to the file set with --output)."));
+
+	QCommandLineOption formulaBenchmarkOption(QStringList({"benchmark-formulas"}),
+		QCoreApplication::translate("main",
+			"Measures time of one iteration and bailout behaviour of every fractal formula.\n"
+			"Results are printed in JSON format (or saved to the file set with --output)\n"
+			"and remembered to show expensive formulas in the UI."));
+
+	QCommandLineOption estimateOption(QStringList({"estimate"}),
+		QCoreApplication::translate("main",
+			"Estimates time of rendering of the image, animation (with --flight or --keyframe)\n"
+			"or all items of the queue (with --queue) by rendering a small sample of pixels.\n"
+			"Estimation is printed in JSON format."));
+
+	QCommandLineOption optimizeDEOption(QStringList({"optimize-de"}),
+		QCoreApplication::translate("main",
+			"Finds the biggest DE factor which gives less than TARGET percent of wrong\n"
+			"distance estimations (e.g. 0.1) and uses it for rendering. Only a few thousand\n"
+			"rays are marched, so it takes about a second."),
+		QCoreApplication::translate("main", "TARGET"));
+
+	QCommandLineOption resumeOption(QStringList({"resume"}),
+		QCoreApplication::translate("main",
+			"Resumes interrupted rendering of still image (also with --queue). Finished lines\n"
+			"are saved next to the output image to .checkpoint file every\n"
+			"'checkpoint_interval' seconds and only missing lines are rendered."));
+
+	QCommandLineOption resourceReportOption(QStringList({"resource-report"}),
+		QCoreApplication::translate("main",
+			"Saves report of used resources (CPU time of rendering stages, peak memory,\n"
+			"bytes of files and NetRender traffic of clients) as <image>.report.json next to\n"
+			"the output image. Queue saves also queue_report_<time>.json for the whole run.\n"
+			"Sets parameter 'resource_reports' only for this run."));
+
+	QCommandLineOption timeBudgetOption(QStringList({"time-budget"}),
+		QCoreApplication::translate("main",
+			"Reduces supersampling, DOF and AO samples and detail level, so every frame\n"
+			"(or still image) is rendered within <N> seconds. Time is estimated from tiny\n"
+			"sample before the frame. Sets parameter 'render_time_budget'."),
+		QCoreApplication::translate("main", "N"));
+
+	QCommandLineOption sweepOption(QStringList({"sweep"}),
+		QCoreApplication::translate("main",
+			"Renders variations of parameters of still image. Specify ranges in the form\n"
+			"KEY=START:END:STEPS or list KEY=VALUE1,VALUE2 separated by '#' (all combinations\n"
+			"are rendered) or name of CSV file with keys in the first row. Images are saved\n"
+			"as <output>_00001, <output>_00002, ..."),
+		QCoreApplication::translate("main", "..."));
+
+	QCommandLineOption serviceOption(QStringList({"service"}),
+		QCoreApplication::translate("main",
+			"Starts render service on localhost port <N>. Jobs are sent with HTTP requests:\n"
+			"POST /render with JSON {\"settings\", \"overrides\", \"format\", \"output\"},\n"
+			"GET /status and POST /quit. Rendering threads and textures are kept between jobs."),
+		QCoreApplication::translate("main", "N"));
+
 	QCommandLineOption touchOption(
 		QStringList({"T", "touch"}),
 		QCoreApplication::translate(
 			"main", "Resaves a settings file (can be used to update a settings file)"));
 
 	QCommandLineOption voxelOption(QStringList({"V", "voxel"}),
-		QCoreApplication::translate("main", "Renders the voxel volume in a stack of images."));
+		QCoreApplication::translate("main",
+			"Renders the voxel volume in a stack of images or in one sparse volume file,\n"
+			"depending on 'voxel_output_format' parameter."));
+
+	QCommandLineOption meshOption(QStringList({"M", "mesh"}),
+		QCoreApplication::translate("main",
+			"Exports mesh of the volume to the file (output file can be set with --output).\n"
+			"Formats set by 'mesh_output_format' parameter:\n"
+			"  0 - PLY text format (default)\n"
+			"  1 - PLY binary format\n"
+			"  2 - STL binary format\n"
+			"  3 - OBJ text format"));
 
 	QCommandLineOption statsOption(QStringList({"stats"}),
 		QCoreApplication::translate("main", "Shows statistics while rendering in CLI mode."));
 
+	QCommandLineOption statsJsonOption(QStringList({"stats-json"}),
+		QCoreApplication::translate("main",
+			"Writes progress, statistics, saved images and NetRender status to this file\n"
+			"as newline-delimited JSON events."),
+		QCoreApplication::translate("main", "FILE"));
+
+	QCommandLineOption progressFdOption(QStringList({"progress-fd"}),
+		QCoreApplication::translate("main",
+			"Like --stats-json, but events are written to already opened file descriptor.\n"
+			"With descriptor 1 (stdout) progress bars are not displayed."),
+		QCoreApplication::translate("main", "N"));
+
+	QCommandLineOption traceOption(QStringList({"trace"}),
+		QCoreApplication::translate("main",
+			"Records events of rendering pipeline to this file (JSON for chrome://tracing).\n"
+			"Available only if program was compiled with USE_TRACE."),
+		QCoreApplication::translate("main", "FILE"));
+
 	QCommandLineOption helpInputOption(
 		QStringList({"help-input"}), QCoreApplication::translate("main", "Shows help about input."));
 	QCommandLineOption helpExamplesOption(
@@ -174,20 +285,35 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 	parser.addOption(silentOption);
 	parser.addOption(startOption);
 	parser.addOption(endOption);
+	parser.addOption(farmOption);
 	parser.addOption(listOption);
 	parser.addOption(formatOption);
 	parser.addOption(resOption);
 	parser.addOption(fpkOption);
 	parser.addOption(serverOption);
 	parser.addOption(hostOption);
+	parser.addOption(relayOption);
 	parser.addOption(portOption);
 	parser.addOption(noColorOption);
 	parser.addOption(queueOption);
 	parser.addOption(testOption);
+	parser.addOption(benchmarkOption);
+	parser.addOption(formulaBenchmarkOption);
+	parser.addOption(estimateOption);
+	parser.addOption(optimizeDEOption);
+	parser.addOption(resumeOption);
+	parser.addOption(resourceReportOption);
+	parser.addOption(timeBudgetOption);
+	parser.addOption(sweepOption);
+	parser.addOption(serviceOption);
 	parser.addOption(touchOption);
 	parser.addOption(voxelOption);
+	parser.addOption(meshOption);
 	parser.addOption(overrideOption);
 	parser.addOption(statsOption);
+	parser.addOption(statsJsonOption);
+	parser.addOption(progressFdOption);
+	parser.addOption(traceOption);
 	parser.addOption(helpInputOption);
 	parser.addOption(helpExamplesOption);
 
@@ -208,6 +334,7 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 	cliData.silent = parser.isSet(silentOption);
 	cliData.startFrameText = parser.value(startOption);
 	cliData.endFrameText = parser.value(endOption);
+	cliData.farm = parser.isSet(farmOption);
 	cliData.overrideParametersText = parser.value(overrideOption);
 	cliData.imageFileFormat = parser.value(formatOption);
 	cliData.resolution = parser.value(resOption);
@@ -215,15 +342,48 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 	cliData.server = parser.isSet(serverOption);
 	cliData.host = parser.value(hostOption);
 	cliData.portText = parser.value(portOption);
+	cliData.relayPortText = parser.value(relayOption);
 	cliData.outputText = parser.value(outputOption);
 	cliData.listParameters = parser.isSet(listOption);
 	cliData.queue = parser.isSet(queueOption);
 	cliData.voxel = parser.isSet(voxelOption);
+	cliData.mesh = parser.isSet(meshOption);
 	cliData.test = parser.isSet(testOption);
+	cliData.benchmark = parser.isSet(benchmarkOption);
+	cliData.formulaBenchmark = parser.isSet(formulaBenchmarkOption);
+	cliData.estimate = parser.isSet(estimateOption);
+	cliData.optimizeDEText = parser.value(optimizeDEOption);
+	cliData.timeBudgetText = parser.value(timeBudgetOption);
+	cliData.sweepText = parser.value(sweepOption);
+	cliData.servicePortText = parser.value(serviceOption);
 	cliData.touch = parser.isSet(touchOption);
 	cliData.showInputHelp = parser.isSet(helpInputOption);
 	cliData.showExampleHelp = parser.isSet(helpExamplesOption);
 	systemData.statsOnCLI = parser.isSet(statsOption);
+	systemData.resumeRendering = parser.isSet(resumeOption);
+	systemData.resourceReports = parser.isSet(resourceReportOption);
+
+	if (parser.isSet(statsJsonOption) || parser.isSet(progressFdOption))
+	{
+		bool isDescriptor = parser.isSet(progressFdOption);
+		QString target =
+			isDescriptor ? parser.value(progressFdOption) : parser.value(statsJsonOption);
+		if (!cProgressStream::Open(target, isDescriptor))
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Cannot open progress stream ") + target, cErrorMessage::errorMessage);
+			exit(cliErrorProgressStreamInvalid);
+		}
+	}
+
+	if (parser.isSet(traceOption))
+	{
+#ifdef USE_TRACE
+		cTrace::Enable(parser.value(traceOption));
+#else
+		qWarning() << "Option --trace is not available. Compile program with USE_TRACE";
+#endif
+	}
 
 #ifdef WIN32 /* WINDOWS */
 	systemData.useColor = false;
@@ -234,6 +394,10 @@ cCommandLineInterface::cCommandLineInterface(QCoreApplication *qapplication)
 	if (cliData.listParameters) cliData.nogui = true;
 	if (cliData.queue) cliData.nogui = true;
 	if (cliData.test) cliData.nogui = true;
+	if (cliData.benchmark) cliData.nogui = true;
+	if (cliData.formulaBenchmark) cliData.nogui = true;
+	if (cliData.estimate) cliData.nogui = true;
+	if (cliData.servicePortText != "") cliData.nogui = true;
 	cliTODO = modeBootOnly;
 }
 
@@ -255,6 +419,17 @@ void cCommandLineInterface::ReadCLI(void)
 	// run test cases
 	if (cliData.test) runTestCasesAndExit();
 
+	// run performance benchmark
+	if (cliData.benchmark) runBenchmarkAndExit();
+	if (cliData.formulaBenchmark) runFormulaBenchmarkAndExit();
+
+	// render service doesn't need settings file, jobs come with own settings
+	if (cliData.servicePortText != "")
+	{
+		handleService();
+		return;
+	}
+
 	// check netrender server / client
 	if (cliData.server)
 		handleServer();
@@ -299,9 +474,24 @@ void cCommandLineInterface::ReadCLI(void)
 	// end frame of animation
 	if (cliData.endFrameText != "") handleEndFrame();
 
+	// rendering of animation by many instances
+	if (cliData.farm) gPar->Set("anim_farm_mode", true);
+
+	// DE factor is optimized for final resolution and overridden parameters
+	if (cliData.optimizeDEText != "") handleOptimizeDE();
+
+	// variations of parameters
+	if (cliData.sweepText != "") handleSweep();
+
+	// quality is adjusted to time budget
+	if (cliData.timeBudgetText != "") handleTimeBudget();
+
 	// voxel export
 	if (cliData.voxel) handleVoxel();
 
+	// mesh export
+	if (cliData.mesh) handleMesh();
+
 	// folder for animation frames
 	if (cliData.outputText != "" && cliTODO == modeFlight)
 	{
@@ -321,7 +511,7 @@ void cCommandLineInterface::ReadCLI(void)
 	}
 
 	if (cliData.nogui && cliTODO != modeKeyframe && cliTODO != modeFlight && cliTODO != modeQueue
-			&& cliTODO != modeVoxel)
+			&& cliTODO != modeVoxel && cliTODO != modeMesh)
 	{
 		// creating output filename if it's not specified
 		if (cliData.outputText == "")
@@ -336,15 +526,41 @@ void cCommandLineInterface::ReadCLI(void)
 
 void cCommandLineInterface::ProcessCLI(void)
 {
+	cProgressStream::ConnectNetRender(gNetRender);
+
+	if (cliData.estimate) runEstimateAndExit();
+
 	switch (cliTODO)
 	{
 		case modeNetrender:
 		{
-			gNetRender->SetClient(gPar->Get<QString>("netrender_client_remote_address"),
-				gPar->Get<int>("netrender_client_remote_port"));
+			if (cliData.relayPortText != "")
+			{
+				gNetRender->SetRelay(gPar->Get<QString>("netrender_client_remote_address"),
+					gPar->Get<int>("netrender_client_remote_port"),
+					gPar->Get<int>("netrender_server_local_port"));
+			}
+			else
+			{
+				gNetRender->SetClient(gPar->Get<QString>("netrender_client_remote_address"),
+					gPar->Get<int>("netrender_client_remote_port"));
+			}
 			gApplication->exec();
 			break;
 		}
+		case modeService:
+		{
+			cRenderService *service = new cRenderService;
+			if (!service->Listen(cliData.servicePortText.toInt()))
+			{
+				delete service;
+				exit(cliErrorServiceInvalidPort);
+			}
+			QObject::connect(service, SIGNAL(finished()), gApplication, SLOT(quit()));
+			gApplication->exec();
+			delete service;
+			break;
+		}
 		case modeFlight:
 		{
 			gMainInterface->headless = new cHeadless();
@@ -360,7 +576,15 @@ void cCommandLineInterface::ProcessCLI(void)
 		case modeStill:
 		{
 			gMainInterface->headless = new cHeadless();
-			gMainInterface->headless->RenderStillImage(cliData.outputText, cliData.imageFileFormat);
+			if (cliData.sweepText != "")
+			{
+				gMainInterface->headless->RenderSweep(
+					cliData.outputText, cliData.imageFileFormat, cliData.sweepText);
+			}
+			else
+			{
+				gMainInterface->headless->RenderStillImage(cliData.outputText, cliData.imageFileFormat);
+			}
 			break;
 		}
 		case modeQueue:
@@ -375,6 +599,12 @@ void cCommandLineInterface::ProcessCLI(void)
 			gMainInterface->headless->RenderVoxel();
 			break;
 		}
+		case modeMesh:
+		{
+			gMainInterface->headless = new cHeadless();
+			gMainInterface->headless->RenderMesh();
+			break;
+		}
 		case modeBootOnly:
 		{
 			// nothing to be done
@@ -403,6 +633,59 @@ void cCommandLineInterface::printExampleHelpAndExit() const
 					 "within frames 200 till 300.")
 			<< "\n\n";
 
+	out << cHeadless::colorize(QObject::tr("Render farm without server"), cHeadless::ansiBlue)
+			<< "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 -n -K --farm -o /shared/frames path/to/keyframe_fractal.fract",
+					 cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Many instances started with the same command render frames of the animation into "
+					 "the shared folder. Frames of terminated instances are rendered again after "
+					 "anim_farm_claim_timeout minutes (default 60).")
+			<< "\n\n";
+
+	out << cHeadless::colorize(QObject::tr("Resuming of long render"), cHeadless::ansiBlue)
+			<< "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 -n --resume -o big_image path/to/fractal.fract", cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Finished lines are saved to big_image.checkpoint every checkpoint_interval seconds "
+					 "(default 300). After crash the same command renders only missing lines.")
+			<< "\n\n";
+
+	out << cHeadless::colorize(QObject::tr("Parameter sweep"), cHeadless::ansiBlue) << "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 -n --sweep \"DE_factor=0.5:1:3#fractal1_power=6,8\" -o sweep "
+					 "path/to/fractal.fract",
+					 cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Renders 6 images sweep_00001 ... sweep_00006 with all combinations of values. The "
+					 "scene is loaded once and rendering threads are reused.")
+			<< "\n\n";
+
+	out << cHeadless::colorize(QObject::tr("Render service"), cHeadless::ansiBlue) << "\n";
+	out << cHeadless::colorize("mandelbulber2 --service 5572", cHeadless::ansiYellow) << "\n";
+	out << cHeadless::colorize(
+					 "curl --data-binary @job.json http://localhost:5572/render -o image.jpg",
+					 cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Keeps the process running and renders jobs sent by HTTP. job.json contains "
+					 "{\"settings\": \"<text of .fract file>\", \"overrides\": \"image_width=800\"}.")
+			<< "\n\n";
+
+	out << cHeadless::colorize(QObject::tr("Benchmark"), cHeadless::ansiBlue) << "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 --benchmark -o results.json", cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Renders the standard suite of example scenes and saves iterations, rays and pixels "
+					 "per second, times of rendering stages and thread scaling in JSON format.")
+			<< "\n\n";
+
 	out << cHeadless::colorize(QObject::tr("Network render"), cHeadless::ansiBlue) << "\n";
 	out << cHeadless::colorize("mandelbulber2 -n --host 192.168.100.1", cHeadless::ansiYellow)
 			<< cHeadless::colorize(" # (1) client", cHeadless::ansiGreen) << "\n";
@@ -416,6 +699,14 @@ void cCommandLineInterface::printExampleHelpAndExit() const
 					 "the server.\nOn the server run (2) with the settings required for the render and "
 					 "additionally '--server'.\nThe server will start and wait a short time for the "
 					 "clients to connect. Then the whole system will start rendering.")
+			<< "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 -n --host 192.168.100.1 --relay 5556", cHeadless::ansiYellow)
+			<< cHeadless::colorize(" # (3) relay", cHeadless::ansiGreen) << "\n";
+	out << QObject::tr(
+					 "With many clients they can be split into groups. Each group connects to a relay (3) "
+					 "instead of the server (clients use '--port 5556'). The relay forwards jobs to its "
+					 "clients and sends their results to the server in larger messages.")
 			<< "\n\n";
 
 	out << cHeadless::colorize(QObject::tr("Voxel volume render"), cHeadless::ansiBlue) << "\n";
@@ -431,6 +722,18 @@ void cCommandLineInterface::printExampleHelpAndExit() const
 					 "of 10(x) times 10(y) and save as black and white images to working folder/slices.")
 			<< "\n\n";
 
+	out << cHeadless::colorize(QObject::tr("Mesh export"), cHeadless::ansiBlue) << "\n";
+	out << cHeadless::colorize(
+					 "mandelbulber2 --mesh -n path/to/fractal.fract -o path/to/mesh.ply"
+					 " -O 'mesh_output_format=1#voxel_samples_x=200#voxel_samples_y=200#"
+					 "voxel_samples_z=200'",
+					 cHeadless::ansiYellow)
+			<< "\n";
+	out << QObject::tr(
+					 "Exports mesh of the fractal in the limits of the scene with a resolution of "
+					 "200x200x200 and saves it as a binary PLY file.")
+			<< "\n\n";
+
 	out << cHeadless::colorize(QObject::tr("Queue render"), cHeadless::ansiBlue) << "\n";
 	out << cHeadless::colorize(
 					 "nohup mandelbulber2 -q > /tmp/queue.log 2>&1 &", cHeadless::ansiYellow)
@@ -505,6 +808,120 @@ void cCommandLineInterface::runTestCasesAndExit() const
 	exit(status);
 }
 
+void cCommandLineInterface::runBenchmarkAndExit() const
+{
+	cBenchmark benchmark;
+	QString tuningChoices = gPar->Get<QString>("threads_tuning_choices");
+	QByteArray results = benchmark.Run();
+
+	// SMT choices measured by benchmark are used by auto-tuning of threads
+	if (gPar->Get<QString>("threads_tuning_choices") != tuningChoices)
+	{
+		cSettings parSettings(cSettings::formatAppSettings);
+		parSettings.CreateText(gPar, gParFractal, gAnimFrames, gKeyframes);
+		parSettings.SaveToFile(systemData.GetIniFile());
+	}
+
+	if (cliData.outputText != "")
+	{
+		QFile file(cliData.outputText);
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Cannot write benchmark results to file ") + cliData.outputText,
+				cErrorMessage::errorMessage);
+			exit(cliErrorBenchmarkOutputInvalid);
+		}
+		file.write(results);
+		file.close();
+	}
+	else
+	{
+		QTextStream out(stdout);
+		out << results;
+		out.flush();
+	}
+	exit(0);
+}
+
+void cCommandLineInterface::runFormulaBenchmarkAndExit() const
+{
+	cFormulaBenchmark benchmark;
+	QByteArray results = benchmark.Run();
+
+	if (cliData.outputText != "")
+	{
+		QFile file(cliData.outputText);
+		if (!file.open(QIODevice::WriteOnly))
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Cannot write benchmark results to file ") + cliData.outputText,
+				cErrorMessage::errorMessage);
+			exit(cliErrorBenchmarkOutputInvalid);
+		}
+		file.write(results);
+		file.close();
+	}
+	else
+	{
+		QTextStream out(stdout);
+		out << results;
+		out.flush();
+	}
+	exit(0);
+}
+
+void cCommandLineInterface::runEstimateAndExit() const
+{
+	QJsonObject document;
+	if (cliTODO == modeQueue)
+	{
+		QJsonArray items;
+		double totalTime = 0.0;
+		QList<cQueue::structQueueItem> queueList = gQueue->GetListFromQueueFile();
+		for (int i = 0; i < queueList.size(); i++)
+		{
+			cRenderEstimate estimate;
+			QJsonObject item;
+			if (gQueue->EstimateRenderTime(queueList[i], &estimate))
+			{
+				item = estimate.ToJson();
+				totalTime += estimate.GetTotalTime();
+			}
+			else
+			{
+				item["error"] = QString("estimation failed");
+			}
+			item["file"] = queueList[i].filename;
+			item["type"] = cQueue::GetTypeText(queueList[i].renderType);
+			items.append(item);
+		}
+		document["items"] = items;
+		document["total_time"] = totalTime;
+	}
+	else
+	{
+		cRenderEstimate::enumJobType jobType = cRenderEstimate::jobStill;
+		if (cliTODO == modeFlight) jobType = cRenderEstimate::jobFlight;
+		if (cliTODO == modeKeyframe) jobType = cRenderEstimate::jobKeyframe;
+		int numberOfFrames = cRenderEstimate::NumberOfFrames(*gPar, gAnimFrames, gKeyframes, jobType);
+
+		cRenderEstimate estimate;
+		if (!estimate.Estimate(*gPar, *gParFractal, numberOfFrames))
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Estimation of rendering time failed"), cErrorMessage::errorMessage);
+			exit(cliErrorEstimateFailed);
+		}
+		document = estimate.ToJson();
+	}
+
+	QTextStream out(stdout);
+	out << QJsonDocument(document).toJson();
+	out.flush();
+	exit(0);
+}
+
 void cCommandLineInterface::handleServer()
 {
 	QTextStream out(stdout);
@@ -554,11 +971,37 @@ void cCommandLineInterface::handleClient()
 		}
 		gPar->Set("netrender_client_remote_port", port);
 	}
+	if (cliData.relayPortText != "")
+	{
+		int port = cliData.relayPortText.toInt(&checkParse);
+		if (!checkParse || port <= 0)
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Specified relay port is invalid\n"), cErrorMessage::errorMessage);
+			parser.showHelp(cliErrorRelayInvalidPort);
+		}
+		gPar->Set("netrender_server_local_port", port);
+	}
 	cliData.nogui = true;
 	systemData.noGui = true;
 	cliTODO = modeNetrender;
 }
 
+void cCommandLineInterface::handleService()
+{
+	bool checkParse = true;
+	int port = cliData.servicePortText.toInt(&checkParse);
+	if (!checkParse || port <= 0 || port > 65535)
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Specified service port is invalid\n"), cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorServiceInvalidPort);
+	}
+	cliData.nogui = true;
+	systemData.noGui = true;
+	cliTODO = modeService;
+}
+
 void cCommandLineInterface::handleQueue()
 {
 	cliTODO = modeQueue;
@@ -668,8 +1111,13 @@ void cCommandLineInterface::handleArgs()
 
 void cCommandLineInterface::handleOverrideParameters()
 {
-	QStringList overrideParameters =
-		cliData.overrideParametersText.split("#", QString::SkipEmptyParts);
+	OverrideParameters(cliData.overrideParametersText, gPar, gParFractal);
+}
+
+void cCommandLineInterface::OverrideParameters(
+	const QString &overrideText, cParameterContainer *par, cFractalContainer *parFractal)
+{
+	QStringList overrideParameters = overrideText.split("#", QString::SkipEmptyParts);
 	for (int i = 0; i < overrideParameters.size(); i++)
 	{
 		int fractalIndex = -1;
@@ -685,17 +1133,74 @@ void cCommandLineInterface::handleOverrideParameters()
 		{
 			if (fractalIndex >= 0 && fractalIndex < NUMBER_OF_FRACTALS)
 			{
-				gParFractal->at(fractalIndex)
+				parFractal->at(fractalIndex)
 					.Set(overrideParameter[0].trimmed(), overrideParameter[1].trimmed());
 			}
 			else
 			{
-				gPar->Set(overrideParameter[0].trimmed(), overrideParameter[1].trimmed());
+				par->Set(overrideParameter[0].trimmed(), overrideParameter[1].trimmed());
 			}
 		}
 	}
 }
 
+void cCommandLineInterface::handleOptimizeDE()
+{
+	bool checkParse = true;
+	double qualityTarget = cliData.optimizeDEText.toDouble(&checkParse);
+	if (!checkParse || qualityTarget <= 0.0)
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Specified target of DE factor optimization not valid\n"
+									"it has to be percentage of wrong distance estimations > 0"),
+			cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorOptimizeDEInvalid);
+	}
+
+	bool stopRequest = false;
+	double missedDE = 0.0;
+	cDEFactorOptimizer optimizer(gPar, gParFractal);
+	double DEFactor = optimizer.Optimize(qualityTarget, &stopRequest, &missedDE);
+	if (DEFactor > 0.0)
+	{
+		gPar->Set("DE_factor", DEFactor);
+		QTextStream out(stdout);
+		out << QObject::tr("Optimal DE factor is: %1 which gives %2% of bad distance estimations")
+						 .arg(DEFactor)
+						 .arg(missedDE)
+				<< "\n";
+		out.flush();
+	}
+}
+
+void cCommandLineInterface::handleSweep()
+{
+	cParameterSweep sweep;
+	if (!sweep.Parse(cliData.sweepText))
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Specified sweep is not valid\n") + sweep.GetErrorText(),
+			cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorSweepInvalid);
+	}
+	cliData.nogui = true;
+	systemData.noGui = true;
+}
+
+void cCommandLineInterface::handleTimeBudget()
+{
+	bool checkParse = true;
+	double timeBudget = cliData.timeBudgetText.toDouble(&checkParse);
+	if (!checkParse || timeBudget <= 0.0)
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Specified time budget is not valid\nit has to be number of seconds > 0"),
+			cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorTimeBudgetInvalid);
+	}
+	gPar->Set("render_time_budget", timeBudget);
+}
+
 void cCommandLineInterface::handleResolution()
 {
 	bool checkParse = true;
@@ -906,3 +1411,30 @@ void cCommandLineInterface::handleVoxel()
 	cliData.nogui = true;
 	systemData.noGui = true;
 }
+
+void cCommandLineInterface::handleMesh()
+{
+	if (cliData.outputText != "") gPar->Set("mesh_output_filename", cliData.outputText);
+
+	QFileInfo fileInfo(gPar->Get<QString>("mesh_output_filename"));
+	if (!fileInfo.absoluteDir().exists())
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Cannot start mesh export. Specified folder (%1) does not exist.")
+				.arg(fileInfo.absolutePath()),
+			cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorMeshOutputFolderDoesNotExists);
+	}
+
+	int format = gPar->Get<int>("mesh_output_format");
+	if (format < cMeshExport::meshFormatPlyText || format > cMeshExport::meshFormatObjText)
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Specified mesh format (%1) is not valid").arg(format),
+			cErrorMessage::errorMessage);
+		parser.showHelp(cliErrorMeshFormatInvalid);
+	}
+	cliTODO = modeMesh;
+	cliData.nogui = true;
+	systemData.noGui = true;
+}
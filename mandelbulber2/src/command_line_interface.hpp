@@ -36,6 +36,10 @@
 #define MANDELBULBER2_SRC_COMMAND_LINE_INTERFACE_HPP_
 #include <QtCore>
 
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+
 class cCommandLineInterface
 {
 public:
@@ -46,11 +50,13 @@ public:
 	{
 		modeBootOnly,
 		modeNetrender,
+		modeService,
 		modeKeyframe,
 		modeFlight,
 		modeStill,
 		modeQueue,
-		modeVoxel
+		modeVoxel,
+		modeMesh
 	};
 	enum cliErrors
 	{
@@ -62,6 +68,14 @@ public:
 		cliErrorFPKInvalid = -15,
 		cliErrorImageFileFormatInvalid = -16,
 		cliErrorSettingsFileNotSpecified = -17,
+		cliErrorRelayInvalidPort = -18,
+		cliErrorBenchmarkOutputInvalid = -19,
+		cliErrorProgressStreamInvalid = -20,
+		cliErrorEstimateFailed = -21,
+		cliErrorOptimizeDEInvalid = -22,
+		cliErrorServiceInvalidPort = -23,
+		cliErrorSweepInvalid = -24,
+		cliErrorTimeBudgetInvalid = -25,
 
 		cliErrorFlightNoFrames = -30,
 		cliErrorFlightStartFrameOutOfRange = -31,
@@ -73,12 +87,17 @@ public:
 		cliErrorKeyframeEndFrameSmallerStartFrame = -42,
 		cliErrorKeyframeEndFrameOutOfRange = -43,
 
-		cliErrorVoxelOutputFolderDoesNotExists = -50
+		cliErrorVoxelOutputFolderDoesNotExists = -50,
+		cliErrorMeshOutputFolderDoesNotExists = -51,
+		cliErrorMeshFormatInvalid = -52
 	};
 
 	void ReadCLI(void);
 	void ProcessCLI(void);
 	bool isNoGUI(void) const { return cliData.nogui; }
+	// applies KEY1=VALUE1#KEY2=VALUE2 list (format of --override option)
+	static void OverrideParameters(
+		const QString &overrideText, cParameterContainer *par, cFractalContainer *parFractal);
 
 private:
 	// ## helper methods for ReadCLI
@@ -87,13 +106,20 @@ private:
 	void printInputHelpAndExit() const;
 	void printParametersAndExit();
 	void runTestCasesAndExit() const;
+	void runBenchmarkAndExit() const;
+	void runFormulaBenchmarkAndExit() const;
+	void runEstimateAndExit() const;
 
 	// argument handling methods
 	void handleServer();
 	void handleClient();
+	void handleService();
 	void handleQueue();
 	void handleArgs();
 	void handleOverrideParameters();
+	void handleOptimizeDE();
+	void handleSweep();
+	void handleTimeBudget();
 	void handleResolution();
 	void handleFpk();
 	void handleImageFileFormat();
@@ -102,6 +128,7 @@ private:
 	void handleStartFrame();
 	void handleEndFrame();
 	void handleVoxel();
+	void handleMesh();
 
 	struct sCliData
 	{
@@ -115,16 +142,26 @@ private:
 		bool silent;
 		bool queue;
 		bool voxel;
+		bool mesh;
 		bool test;
+		bool benchmark;
+		bool formulaBenchmark;
+		bool estimate;
 		bool touch;
+		bool farm;
 		QString startFrameText;
 		QString endFrameText;
 		QString overrideParametersText;
 		QString imageFileFormat;
 		QString resolution;
+		QString optimizeDEText;
+		QString servicePortText;
+		QString sweepText;
+		QString timeBudgetText;
 		QString fpkText;
 		QString host;
 		QString portText;
+		QString relayPortText;
 		QString outputText;
 	} cliData;
 
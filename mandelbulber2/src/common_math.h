@@ -115,6 +115,115 @@ inline double LimitAngle(double angle)
 	return fmod(fmod(angle - 180.0, 360.0) + 360.0, 360.0) - 180.0;
 }
 
+// fast approximations of transcendental functions used by "fast math" formula mode.
+// Maximum error of FastAtan2() and FastAsin() is about 2e-6 rad, of FastSinCos() about 3e-7
+
+// polynomial approximation of atan(x) for |x| <= 1
+template <typename T>
+inline T FastAtanUnit(T x)
+{
+	T x2 = x * x;
+	return x
+				 * (T(0.99997726) + x2 * (T(-0.33262347) + x2 * (T(0.19354346) + x2 * (T(-0.11643287)
+																				+ x2 * (T(0.05265332) + x2 * T(-0.01172120))))));
+}
+
+template <typename T>
+inline T FastAtan2(T y, T x)
+{
+	T ax = fabs(x);
+	T ay = fabs(y);
+	bool swap = ay > ax;
+	T den = swap ? ay : ax;
+	T a = (den > T(0)) ? FastAtanUnit((swap ? ax : ay) / den) : T(0);
+	a = swap ? T(M_PI_2) - a : a;
+	a = (x < T(0)) ? T(M_PI) - a : a;
+	return (y < T(0)) ? -a : a;
+}
+
+template <typename T>
+inline T FastAsin(T x)
+{
+	return FastAtan2(x, sqrt(fabs(T(1) - x * x)));
+}
+
+// sine and cosine calculated together with reduction to [-pi/4, pi/4]
+template <typename T>
+inline void FastSinCos(T angle, T *sinOut, T *cosOut)
+{
+	T quadrant = floor(angle * T(M_2_PI) + T(0.5));
+	T a = angle - quadrant * T(M_PI_2);
+	int q = int(quadrant) & 3;
+	T a2 = a * a;
+	T s = a * (T(1) + a2 * (T(-1.0 / 6.0) + a2 * (T(1.0 / 120.0) + a2 * T(-1.0 / 5040.0))));
+	T c = T(1) + a2 * (T(-0.5) + a2 * (T(1.0 / 24.0) + a2 * (T(-1.0 / 720.0) + a2 * T(1.0 / 40320.0))));
+	switch (q)
+	{
+		case 0:
+			*sinOut = s;
+			*cosOut = c;
+			break;
+		case 1:
+			*sinOut = c;
+			*cosOut = -s;
+			break;
+		case 2:
+			*sinOut = -s;
+			*cosOut = -c;
+			break;
+		default:
+			*sinOut = -c;
+			*cosOut = s;
+			break;
+	}
+}
+
+// Mandelbulb power 8 iteration calculated only with multiplications (triplex power computed by
+// squaring of complex numbers). r is length of z. Returns r^7 for derivative calculation
+template <typename T>
+inline T MandelbulbPower8Polynomial(T &x, T &y, T &z, T r)
+{
+	T rho2 = x * x + y * y;
+	T q2 = rho2 + z * z;
+
+	// (rho + i*z)^8 gives elevation angle multiplied by 8
+	T a = sqrt(rho2);
+	T b = z;
+	for (int n = 0; n < 3; n++)
+	{
+		T a2 = a * a - b * b;
+		b = T(2) * a * b;
+		a = a2;
+	}
+
+	// (x + i*y)^8 gives azimuth angle multiplied by 8
+	T c = x;
+	T d = y;
+	for (int n = 0; n < 3; n++)
+	{
+		T c2 = c * c - d * d;
+		d = T(2) * c * d;
+		c = c2;
+	}
+
+	T rho4 = rho2 * rho2;
+	T rho8 = rho4 * rho4;
+	T cosPh = (rho8 > T(0)) ? c / rho8 : T(1);
+	T sinPh = (rho8 > T(0)) ? d / rho8 : T(0);
+
+	// correction if r is not equal to length of (x, y, z)
+	T r2 = r * r;
+	T k = (q2 > T(0)) ? r2 / q2 : T(1);
+	T k2 = k * k;
+	T scale = k2 * k2;
+
+	x = a * cosPh * scale;
+	y = a * sinPh * scale;
+	z = b * scale;
+
+	return r2 * r2 * r2 * r;
+}
+
 // Smooth transition between two vectors with vector length control
 template <typename T>
 T SmoothCVector(const T &v1, const T &v2, double k);
@@ -50,6 +50,9 @@ struct sFractalFoldings
 struct sCommonParams
 {
 	bool iterThreshMode;
+	// iterations of interior points are stopped when orbit becomes periodic
+	bool periodicityCheck;
+	double periodicityTolerance;
 
 	int fakeLightsMaxIter;
 	int fakeLightsMinIter;
@@ -34,6 +34,7 @@
 
 #include "compute_fractal.hpp"
 #include "common_math.h"
+#include "double_double.hpp"
 #include "fractal.h"
 #include "fractal_formulas.hpp"
 #include "nine_fractals.hpp"
@@ -52,1326 +53,2284 @@
 
 using namespace fractal;
 
-template <fractal::enumCalculationMode Mode>
-void Compute(const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out)
-{
-	// QTextStream outStream(stdout);
-	// clock_t tim;
-	// tim = rdtsc();
-
-	// repeat, move and rotate
-	CVector3 point2 = in.point.mod(in.common.repeat) - in.common.fractalPosition;
-	point2 = in.common.mRotFractalRotation.RotateVector(point2);
-
-	CVector3 z = point2;
-	double r = z.Length();
-	CVector3 c = z;
-	double minimumR = 100.0;
+const sFractalColoring sFractalIn::noColoring;
 
-	double w;
-	if (in.forcedFormulaIndex >= 0)
+// formulas which iterate 4D vector (z.x, z.y, z.z, w)
+static inline bool Is4DFormula(enumFractalFormula formula)
+{
+	switch (formula)
 	{
-		w = fractals.GetInitialWAxis(in.forcedFormulaIndex);
+		case quaternion4D:
+		case mandelboxVaryScale4D:
+		case bristorbrot4D:
+		case menger4D:
+		case mixPinski4D:
+		case sierpinski4D:
+		case transfAdditionConstant4D:
+		case transfBoxFold4D:
+		case transfFabsAddConstant4D:
+		case transfFabsAddConstantV24D:
+		case transfFabsAddConditional4D:
+		case transfIterationWeight4D:
+		case transfReciprocal4D:
+		case transfScale4D:
+		case transfSphericalFold4D:
+			return true;
+		default: return false;
 	}
-	else
+}
+
+// one iteration of 4D formula on packed vector
+static inline void Iterate4DFormula(enumFractalFormula formula, int i, CVector4 &z4D,
+	const cFractal *fractal, sExtendedAux &extendedAux)
+{
+	switch (formula)
 	{
-		w = fractals.GetInitialWAxis(0);
+		case quaternion4D:
+			Quaternion4DIteration(z4D, fractal);
+			break;
+		case mandelboxVaryScale4D:
+			MandelboxVaryScale4DIteration(z4D, fractal, extendedAux);
+			break;
+		case bristorbrot4D:
+			Bristorbrot4DIteration(z4D, fractal, extendedAux);
+			break;
+		case menger4D:
+			Menger4DIteration(z4D, i, fractal, extendedAux);
+			break;
+		case mixPinski4D:
+			MixPinski4DIteration(z4D, i, fractal, extendedAux);
+			break;
+		case sierpinski4D:
+			Sierpinski4DIteration(z4D, i, fractal, extendedAux);
+			break;
+		case transfAdditionConstant4D:
+			TransformAdditionConstant4DIteration(z4D, fractal);
+			break;
+		case transfBoxFold4D:
+			TransformBoxFold4DIteration(z4D, fractal, extendedAux);
+			break;
+		case transfFabsAddConstant4D:
+			TransformFabsAddConstant4DIteration(z4D, fractal);
+			break;
+		case transfFabsAddConstantV24D:
+			TransformFabsAddConstantV24DIteration(z4D, fractal);
+			break;
+		case transfFabsAddConditional4D:
+			TransformFabsAddConditional4DIteration(z4D, fractal, extendedAux);
+			break;
+		case transfIterationWeight4D:
+			TransformIterationWeight4DIteration(z4D, i, fractal, extendedAux);
+			break;
+		case transfReciprocal4D:
+			TransformReciprocal4DIteration(z4D, fractal, extendedAux);
+			break;
+		case transfScale4D:
+			TransformScale4DIteration(z4D, fractal, extendedAux);
+			break;
+		case transfSphericalFold4D:
+			TransformSphericalFold4DIteration(z4D, fractal, extendedAux);
+			break;
+		default: break;
 	}
+}
 
-	double orbitTrapTotal = 0.0;
-
-	enumFractalFormula formula = fractal::none;
-
-	if (in.common.iterThreshMode)
-		out->maxiter = true;
-	else
-		out->maxiter = false;
+// one iteration of fractal formula (foldings, formula, addition of constant and r calculation).
+// If FormulaHint is not negative, it's the formula known at compile time
+template <int FormulaHint>
+static inline const cFractal *IterateFormula(const cNineFractals &fractals, const sFractalIn &in,
+	int i, int sequence, CVector3 &z, double &w, double &r, CVector3 &c,
+	sExtendedAux &extendedAux)
+{
+	// foldings
+	if (in.common.foldings.boxEnable)
+	{
+		BoxFolding(z, &in.common.foldings, extendedAux);
+		r = z.Length();
+	}
 
-	int fractalIndex = 0;
-	if (in.forcedFormulaIndex >= 0) fractalIndex = in.forcedFormulaIndex;
+	if (in.common.foldings.sphericalEnable)
+	{
+		extendedAux.r = r;
+		SphericalFolding(z, &in.common.foldings, extendedAux);
+		r = z.Length();
+	}
 
-	const cFractal *defaultFractal = fractals.GetFractal(fractalIndex);
+	const cFractal *fractal = fractals.GetFractal(sequence);
+	const enumFractalFormula formula =
+		(FormulaHint >= 0) ? (enumFractalFormula)FormulaHint : fractal->formula;
+	const sIterationOps &iterationOps = fractals.GetIterationOps(sequence);
 
-	sExtendedAux extendedAux;
+	// temporary vector for weight function
+	CVector3 tempZ = z;
 
-	extendedAux.r_dz = 1.0;
 	extendedAux.r = r;
-	extendedAux.color = 1.0;
-	extendedAux.actualScale = fractals.GetFractal(fractalIndex)->mandelbox.scale;
-	extendedAux.DE = 1.0;
-	extendedAux.c = c;
-	extendedAux.cw = 0;
-	extendedAux.foldFactor = 0.0;
-	extendedAux.minRFactor = 0.0;
-	extendedAux.scaleFactor = 0.0;
-	// extendedAux.newR = 1e+20;
-	// extendedAux.axisBias = 1e+20;
-	// extendedAux.orbitTraps = 1e+20;
-	// extendedAux.transformSampling = 1e+20;
-
-	// main iteration loop
-	int i;
-	int sequence = 0;
-
-	CVector3 lastGoodZ;
-	CVector3 lastZ;
 
-	for (i = 0; i < in.maxN; i++)
+	if ((iterationOps.ops & iterationOpFormula) && Is4DFormula(formula))
 	{
-		lastGoodZ = lastZ;
-		lastZ = z;
-
-		// hybrid fractal sequence
-		if (in.forcedFormulaIndex >= 0)
-		{
-			sequence = in.forcedFormulaIndex;
-		}
-		else
-		{
-			sequence = fractals.GetSequence(i);
-		}
-
-		// foldings
-		if (in.common.foldings.boxEnable)
-		{
-			BoxFolding(z, &in.common.foldings, extendedAux);
-			r = z.Length();
-		}
-
-		if (in.common.foldings.sphericalEnable)
+		// 4D formulas get vector packed once with w as fourth component
+		CVector4 z4D(z, w);
+		Iterate4DFormula(formula, i, z4D, fractal, extendedAux);
+		z = z4D.GetXYZ();
+		w = z4D.w;
+	}
+	else if (iterationOps.ops & iterationOpFormula)
+	{
+		// calls for fractal formulas
+		switch (formula)
 		{
-			extendedAux.r = r;
-			SphericalFolding(z, &in.common.foldings, extendedAux);
-			r = z.Length();
-		}
-
-		const cFractal *fractal = fractals.GetFractal(sequence);
-		formula = fractal->formula;
-
-		// temporary vector for weight function
-		CVector3 tempZ = z;
-
-		extendedAux.r = r;
+			case mandelbulb:
+			{
+				MandelbulbIteration(z, fractal, extendedAux);
+				break;
+			}
+			case mandelbulb2:
+			{
+				Mandelbulb2Iteration(z, extendedAux);
+				break;
+			}
+			case mandelbulb3:
+			{
+				Mandelbulb3Iteration(z, extendedAux);
+				break;
+			}
+			case mandelbulb4:
+			{
+				Mandelbulb4Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case fast_mandelbulb_power2:
+			{
+				MandelbulbPower2Iteration(z, extendedAux);
+				break;
+			}
+			case xenodreambuie:
+			{
+				XenodreambuieIteration(z, fractal, extendedAux);
+				break;
+			}
+			case mandelbox:
+			{
+				MandelboxIteration(z, fractal, extendedAux);
+				break;
+			}
+			case smoothMandelbox:
+			{
+				SmoothMandelboxIteration(z, fractal, extendedAux);
+				break;
+			}
+			case boxFoldBulbPow2:
+			{
+				BoxFoldBulbPow2Iteration(z, fractal);
+				break;
+			}
+			case menger_sponge:
+			{
+				MengerSpongeIteration(z, extendedAux);
+				break;
+			}
+			case kaleidoscopicIFS:
+			{
+				KaleidoscopicIFSIteration(z, fractal, extendedAux);
+				break;
+			}
+			case aexion:
+			{
+				AexionIteration(z, w, i, fractal, extendedAux);
+				break;
+			}
+			case hypercomplex:
+			{
+				HypercomplexIteration(z, w, extendedAux);
+				break;
+			}
+			case quaternion:
+			{
+				QuaternionIteration(z, w, extendedAux);
+				break;
+			}
+			case benesi:
+			{
+				BenesiIteration(z, c, extendedAux);
+				break;
+			}
+			case bristorbrot:
+			{
+				BristorbrotIteration(z, extendedAux);
+				break;
+			}
+			case ides:
+			{
+				IdesIteration(z, fractal);
+				break;
+			}
+			case ides2:
+			{
+				Ides2Iteration(z, fractal);
+				break;
+			}
+			case buffalo:
+			{
+				BuffaloIteration(z, fractal, extendedAux);
+				break;
+			}
+			case quickdudley:
+			{
+				QuickDudleyIteration(z);
+				break;
+			}
+			case quickDudleyMod:
+			{
+				QuickDudleyModIteration(z, fractal);
+				break;
+			}
+			case lkmitch:
+			{
+				LkmitchIteration(z);
+				break;
+			}
+			case makin3d2:
+			{
+				Makin3D2Iteration(z);
+				break;
+			}
+			case msltoeDonut:
+			{
+				MsltoeDonutIteration(z, fractal, extendedAux);
+				break;
+			}
+			case msltoesym2Mod:
+			{
+				MsltoeSym2ModIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case msltoesym3Mod:
+			{
+				MsltoeSym3ModIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case msltoesym3Mod2:
+			{
+				MsltoeSym3Mod2Iteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case msltoesym3Mod3:
+			{
+				MsltoeSym3Mod3Iteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case msltoesym4Mod:
+			{
+				MsltoeSym4ModIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case msltoeToroidal:
+			{
+				MsltoeToroidalIteration(z, fractal, extendedAux);
+				break;
+			}
+			case msltoeToroidalMulti:
+			{
+				MsltoeToroidalMultiIteration(z, fractal, extendedAux);
+				break;
+			}
+			case generalizedFoldBox:
+			{
+				GeneralizedFoldBoxIteration(z, fractal, extendedAux);
+				break;
+			}
+			case aboxMod1:
+			{
+				AboxMod1Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case aboxMod2:
+			{
+				AboxMod2Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case aboxModKali:
+			{
+				AboxModKaliIteration(z, fractal, extendedAux);
+				break;
+			}
+			case aboxModKaliEiffie:
+			{
+				AboxModKaliEiffieIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case aboxVSIcen1:
+			{
+				AboxVSIcen1Iteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case aexionOctopusMod:
+			{
+				AexionOctopusModIteration(z, c, fractal);
+				break;
+			}
+			case amazingSurf:
+			{
+				AmazingSurfIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case amazingSurfMod1:
+			{
+				AmazingSurfMod1Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case amazingSurfMulti:
+			{
+				AmazingSurfMultiIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case benesiPineTree:
+			{
+				BenesiPineTreeIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case benesiT1PineTree:
+			{
+				BenesiT1PineTreeIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case benesiMagTransforms:
+			{
+				BenesiMagTransformsIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case benesiPwr2s:
+			{
+				BenesiPwr2sIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case collatz:
+			{
+				CollatzIteration(z, extendedAux);
+				break;
+			}
+			case collatzMod:
+			{
+				CollatzModIteration(z, c, fractal, extendedAux);
+				break;
+			}
 
-		if (!fractals.IsHybrid() || fractals.GetWeight(sequence) > 0.0)
-		{
-			// calls for fractal formulas
-			switch (formula)
+			case eiffieMsltoe:
 			{
-				case mandelbulb:
-				{
-					MandelbulbIteration(z, fractal, extendedAux);
-					break;
-				}
-				case mandelbulb2:
-				{
-					Mandelbulb2Iteration(z, extendedAux);
-					break;
-				}
-				case mandelbulb3:
-				{
-					Mandelbulb3Iteration(z, extendedAux);
-					break;
-				}
-				case mandelbulb4:
-				{
-					Mandelbulb4Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case fast_mandelbulb_power2:
-				{
-					MandelbulbPower2Iteration(z, extendedAux);
-					break;
-				}
-				case xenodreambuie:
-				{
-					XenodreambuieIteration(z, fractal, extendedAux);
-					break;
-				}
-				case mandelbox:
-				{
-					MandelboxIteration(z, fractal, extendedAux);
-					break;
-				}
-				case smoothMandelbox:
-				{
-					SmoothMandelboxIteration(z, fractal, extendedAux);
-					break;
-				}
-				case boxFoldBulbPow2:
-				{
-					BoxFoldBulbPow2Iteration(z, fractal);
-					break;
-				}
-				case menger_sponge:
-				{
-					MengerSpongeIteration(z, extendedAux);
-					break;
-				}
-				case kaleidoscopicIFS:
-				{
-					KaleidoscopicIFSIteration(z, fractal, extendedAux);
-					break;
-				}
-				case aexion:
-				{
-					AexionIteration(z, w, i, fractal, extendedAux);
-					break;
-				}
-				case hypercomplex:
-				{
-					HypercomplexIteration(z, w, extendedAux);
-					break;
-				}
-				case quaternion:
-				{
-					QuaternionIteration(z, w, extendedAux);
-					break;
-				}
-				case benesi:
-				{
-					BenesiIteration(z, c, extendedAux);
-					break;
-				}
-				case bristorbrot:
-				{
-					BristorbrotIteration(z, extendedAux);
-					break;
-				}
-				case ides:
-				{
-					IdesIteration(z, fractal);
-					break;
-				}
-				case ides2:
-				{
-					Ides2Iteration(z, fractal);
-					break;
-				}
-				case buffalo:
-				{
-					BuffaloIteration(z, fractal, extendedAux);
-					break;
-				}
-				case quickdudley:
-				{
-					QuickDudleyIteration(z);
-					break;
-				}
-				case quickDudleyMod:
-				{
-					QuickDudleyModIteration(z, fractal);
-					break;
-				}
-				case lkmitch:
-				{
-					LkmitchIteration(z);
-					break;
-				}
-				case makin3d2:
-				{
-					Makin3D2Iteration(z);
-					break;
-				}
-				case msltoeDonut:
-				{
-					MsltoeDonutIteration(z, fractal, extendedAux);
-					break;
-				}
-				case msltoesym2Mod:
-				{
-					MsltoeSym2ModIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case msltoesym3Mod:
-				{
-					MsltoeSym3ModIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case msltoesym3Mod2:
-				{
-					MsltoeSym3Mod2Iteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case msltoesym3Mod3:
-				{
-					MsltoeSym3Mod3Iteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case msltoesym4Mod:
-				{
-					MsltoeSym4ModIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case msltoeToroidal:
-				{
-					MsltoeToroidalIteration(z, fractal, extendedAux);
-					break;
-				}
-				case msltoeToroidalMulti:
-				{
-					MsltoeToroidalMultiIteration(z, fractal, extendedAux);
-					break;
-				}
-				case generalizedFoldBox:
-				{
-					GeneralizedFoldBoxIteration(z, fractal, extendedAux);
-					break;
-				}
-				case aboxMod1:
-				{
-					AboxMod1Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case aboxMod2:
-				{
-					AboxMod2Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case aboxModKali:
-				{
-					AboxModKaliIteration(z, fractal, extendedAux);
-					break;
-				}
-				case aboxModKaliEiffie:
-				{
-					AboxModKaliEiffieIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case aboxVSIcen1:
-				{
-					AboxVSIcen1Iteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case aexionOctopusMod:
-				{
-					AexionOctopusModIteration(z, c, fractal);
-					break;
-				}
-				case amazingSurf:
-				{
-					AmazingSurfIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case amazingSurfMod1:
-				{
-					AmazingSurfMod1Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case amazingSurfMulti:
-				{
-					AmazingSurfMultiIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case benesiPineTree:
-				{
-					BenesiPineTreeIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case benesiT1PineTree:
-				{
-					BenesiT1PineTreeIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case benesiMagTransforms:
-				{
-					BenesiMagTransformsIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case benesiPwr2s:
-				{
-					BenesiPwr2sIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case collatz:
-				{
-					CollatzIteration(z, extendedAux);
-					break;
-				}
-				case collatzMod:
-				{
-					CollatzModIteration(z, c, fractal, extendedAux);
-					break;
-				}
+				EiffieMsltoeIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case foldBoxMod1:
+			{
+				FoldBoxMod1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case iqBulb:
+			{
+				IQbulbIteration(z, fractal, extendedAux);
+				break;
+			}
+			case kalisets1:
+			{
+				Kalisets1Iteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case mandelboxMenger:
+			{
+				MandelboxMengerIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case mandelbulbBermarte:
+			{
+				MandelbulbBermarteIteration(z, fractal, extendedAux);
+				break;
+			}
+			case mandelbulbKali:
+			{
+				MandelbulbKaliIteration(z, fractal, extendedAux);
+				break;
+			}
+			case mandelbulbKaliMulti:
+			{
+				MandelbulbKaliMultiIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case mandelbulbMulti:
+			{
+				MandelbulbMultiIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case mandelbulbVaryPowerV1:
+			{
+				MandelbulbVaryPowerV1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerCrossKIFS:
+			{
+				MengerCrossKIFSIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerCrossMod1:
+			{
+				MengerCrossMod1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerMod1:
+			{
+				MengerMod1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerMiddleMod:
+			{
+				MengerMiddleModIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case mengerPrismShape:
+			{
+				MengerPrismShapeIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerPrismShape2:
+			{
+				MengerPrismShape2Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case mengerPwr2Poly:
+			{
+				MengerPwr2PolyIteration(z, c, i, fractal, extendedAux);
+				break;
+			}
+			case pseudoKleinian1:
+			{
+				PseudoKleinian1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case pseudoKleinian2:
+			{
+				PseudoKleinian2Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case pseudoKleinian3:
+			{
+				PseudoKleinian3Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case quaternion3D:
+			{
+				Quaternion3DIteration(z, fractal, extendedAux);
+				break;
+			}
+			case riemannSphereMsltoe:
+			{
+				RiemannSphereMsltoeIteration(z, fractal);
+				break;
+			}
+			case riemannSphereMsltoeV1:
+			{
+				RiemannSphereMsltoeV1Iteration(z, fractal);
+				break;
+			}
+			case riemannBulbMsltoeMod2:
+			{
+				RiemannBulbMsltoeMod2Iteration(z, fractal);
+				break;
+			}
+			case sierpinski3D:
+			{
+				Sierpinski3DIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case fastImagscaPower2:
+			{
+				FastImagscaPower2Iteration(z);
+				break;
+			}
 
-				case eiffieMsltoe:
-				{
-					EiffieMsltoeIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case foldBoxMod1:
-				{
-					FoldBoxMod1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case iqBulb:
-				{
-					IQbulbIteration(z, fractal, extendedAux);
-					break;
-				}
-				case kalisets1:
-				{
-					Kalisets1Iteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case mandelboxMenger:
-				{
-					MandelboxMengerIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case mandelbulbBermarte:
-				{
-					MandelbulbBermarteIteration(z, fractal, extendedAux);
-					break;
-				}
-				case mandelbulbKali:
-				{
-					MandelbulbKaliIteration(z, fractal, extendedAux);
-					break;
-				}
-				case mandelbulbKaliMulti:
-				{
-					MandelbulbKaliMultiIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case mandelbulbMulti:
-				{
-					MandelbulbMultiIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case mandelbulbVaryPowerV1:
-				{
-					MandelbulbVaryPowerV1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerCrossKIFS:
-				{
-					MengerCrossKIFSIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerCrossMod1:
-				{
-					MengerCrossMod1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerMod1:
-				{
-					MengerMod1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerMiddleMod:
-				{
-					MengerMiddleModIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case mengerPrismShape:
-				{
-					MengerPrismShapeIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerPrismShape2:
+				// transforms  ------------------------------------------------------------------
+				//				case transfAdditionConstant:
 				{
-					MengerPrismShape2Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case mengerPwr2Poly:
-				{
-					MengerPwr2PolyIteration(z, c, i, fractal, extendedAux);
-					break;
-				}
-				case pseudoKleinian1:
-				{
-					PseudoKleinian1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case pseudoKleinian2:
-				{
-					PseudoKleinian2Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case pseudoKleinian3:
-				{
-					PseudoKleinian3Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case quaternion3D:
-				{
-					Quaternion3DIteration(z, fractal, extendedAux);
-					break;
-				}
-				case riemannSphereMsltoe:
-				{
-					RiemannSphereMsltoeIteration(z, fractal);
-					break;
-				}
-				case riemannSphereMsltoeV1:
-				{
-					RiemannSphereMsltoeV1Iteration(z, fractal);
-					break;
-				}
-				case riemannBulbMsltoeMod2:
-				{
-					RiemannBulbMsltoeMod2Iteration(z, fractal);
-					break;
-				}
-				case sierpinski3D:
-				{
-					Sierpinski3DIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case fastImagscaPower2:
-				{
-					FastImagscaPower2Iteration(z);
+					TransformAdditionConstantIteration(z, fractal);
 					break;
 				}
+			case transfAdditionConstantVaryV1:
+			{
+				TransformAdditionConstantVaryV1Iteration(z, i, fractal);
+				break;
+			}
+			case transfAddCpixel:
+			{
+				TransformAddCpixelIteration(z, c, fractal);
+				break;
+			}
+			case transfAddCpixelAxisSwap:
+			{
+				TransformAddCpixelAxisSwapIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case transfAddCpixelCxCyAxisSwap:
+			{
+				TransformAddCpixelCxCyAxisSwapIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case transfAddCpixelPosNeg:
+			{
+				TransformAddCpixelPosNegIteration(z, c, fractal);
+				break;
+			}
+			case transfAddCpixelVaryV1:
+			{
+				TransformAddCpixelVaryV1Iteration(z, c, i, fractal);
+				break;
+			}
+			case transfAddExp2Z:
+			{
+				TransformAddExp2ZIteration(z, fractal, extendedAux);
+				break;
+			}
 
-					// transforms  ------------------------------------------------------------------
-					//				case transfAdditionConstant:
-					{
-						TransformAdditionConstantIteration(z, fractal);
-						break;
-					}
-				case transfAdditionConstantVaryV1:
-				{
-					TransformAdditionConstantVaryV1Iteration(z, i, fractal);
-					break;
-				}
-				case transfAddCpixel:
-				{
-					TransformAddCpixelIteration(z, c, fractal);
-					break;
-				}
-				case transfAddCpixelAxisSwap:
-				{
-					TransformAddCpixelAxisSwapIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case transfAddCpixelCxCyAxisSwap:
-				{
-					TransformAddCpixelCxCyAxisSwapIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case transfAddCpixelPosNeg:
-				{
-					TransformAddCpixelPosNegIteration(z, c, fractal);
-					break;
-				}
-				case transfAddCpixelVaryV1:
-				{
-					TransformAddCpixelVaryV1Iteration(z, c, i, fractal);
-					break;
-				}
-				case transfAddExp2Z:
+			case transfBenesiT1:
+			{
+				TransformBenesiT1Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfBenesiT1Mod:
+			{
+				TransformBenesiT1ModIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfBenesiT2:
+			{
+				TransformBenesiT2Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfBenesiT3:
+			{
+				TransformBenesiT3Iteration(z, fractal);
+				break;
+			}
+			case transfBenesiT4:
+			{
+				TransformBenesiT4Iteration(z, fractal);
+				break;
+			}
+			case transfBenesiT5b:
+			{
+				TransformBenesiT5bIteration(z, fractal);
+				break;
+			}
+			case transfBenesiMagForward:
+			{
+				TransformBenesiMagForwardIteration(z);
+				break;
+			}
+			case transfBenesiMagBackward:
+			{
+				TransformBenesiMagBackwardIteration(z);
+				break;
+			}
+			case transfBenesiCubeSphere:
+			{
+				TransformBenesiCubeSphereIteration(z);
+				break;
+			}
+			case transfBenesiSphereCube:
+			{
+				TransformBenesiSphereCubeIteration(z);
+				break;
+			}
+			case transfBoxFold:
+			{
+				TransformBoxFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfBoxFoldVaryV1:
+			{
+				TransformBoxFoldVaryV1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfBoxFoldXYZ:
+			{
+				TransformBoxFoldXYZIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfBoxOffset:
+			{
+				TransformBoxOffsetIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfFabsAddConstant:
+			{
+				TransformFabsAddConstantIteration(z, fractal);
+				break;
+			}
+			case transfFabsAddConstantV2:
+			{
+				TransformFabsAddConstantV2Iteration(z, fractal);
+				break;
+			}
+			case transfFabsAddConditional:
+			{
+				TransformFabsAddConditionalIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfFabsAddMulti:
+			{
+				TransformFabsAddMultiIteration(z, fractal);
+				break;
+			}
+			case transfFoldingTetra3D:
+			{
+				TransformFoldingTetra3DIteration(z, fractal);
+				break;
+			}
+			case transfIterationWeight:
+			{
+				TransformIterationWeightIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfInvCylindrical:
+			{
+				TransformInvCylindricalIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfLinCombineCxyz:
+			{
+				TransformLinCombineCxyz(z, c, fractal, extendedAux);
+				break;
+			}
+			case transfMultipleAngle:
+			{
+				TransformMultipleAngle(z, fractal, extendedAux);
+				break;
+			}
+			case transfNegFabsAddConstant:
+			{
+				TransformNegFabsAddConstantIteration(z, fractal);
+				break;
+			}
+			case transfOctoFold:
+			{
+				TransformOctoFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfPwr2Polynomial:
+			{
+				TransformPwr2PolynomialIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfRotation:
+			{
+				TransformRotationIteration(z, fractal);
+				break;
+			}
+			case transfRotationVaryV1:
+			{
+				TransformRotationVaryV1Iteration(z, i, fractal);
+				break;
+			}
+			case transfRotatedFolding:
+			{
+				TransformRotatedFoldingIteration(z, fractal);
+				break;
+			}
+			case transfRpow3:
+			{
+				TransformRpow3Iteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfScale:
+			{
+				TransformScaleIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfScaleVaryVCL:
+			{
+				TransformScaleVaryVCLIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfScaleVaryV1:
+			{
+				TransformScaleVaryV1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfScale3D:
+			{
+				TransformScale3DIteration(z, fractal, extendedAux);
+				break;
+			}
+			case platonicSolid:
+			{
+				TransformPlatonicSolidIteration(z, fractal);
+				break;
+			}
+			case transfRPower:
+			{
+				TransformPowerR(z, fractal, extendedAux);
+				break;
+			}
+			case transfSphereInvC:
+			{
+				TransformSphereInvCIteration(z, c, fractal);
+				break;
+			}
+			case transfSphereInv:
+			{
+				TransformSphereInvIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalOffset:
+			{
+				TransformSphericalOffsetIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalOffsetVCL:
+			{
+				TransformSphericalOffsetVCLIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalFold:
+			{
+				TransformSphericalFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalFoldAbox:
+			{
+				TransformSphericalFoldAboxIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalFoldVaryV1:
+			{
+				TransformSphericalFoldVaryV1Iteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfSpherFoldVaryVCL:
+			{
+				TransformSpherFoldVaryVCLIteration(z, i, fractal, extendedAux);
+				break;
+			}
+			case transfSphericalPwrFold:
+			{
+				TransformSphericalPwrFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSurfBoxFold:
+			{
+				TransformSurfBoxFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfSurfFoldMulti:
+			{
+				TransformSurfFoldMultiIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfZvectorAxisSwap:
+			{
+				TransformZvectorAxisSwapIteration(z, i, fractal);
+				break;
+			}
+			case transfRotationFoldingPlane:
+			{
+				TransformRotationFoldingPlane(z, fractal, extendedAux);
+				break;
+			}
+			case transfQuaternionFold:
+			{
+				TransformQuaternionFoldIteration(z, c, fractal, extendedAux);
+				break;
+			}
+			case transfMengerFold:
+			{
+				TransformMengerFoldIteration(z, fractal, extendedAux);
+				break;
+			}
+			case transfReciprocal3:
+			{
+				TransformReciprocal3Iteration(z, fractal, extendedAux);
+				break;
+			}
+
+			default:
+				double high = fractals.GetBailout(sequence) * 10.0;
+				z = CVector3(high, high, high);
+				break;
+		}
+	}
+
+	// addition of constant (Julia constant and x/y swap for aboxMod1 and amazingSurf are
+	// resolved in cNineFractals::CompileIterationOps)
+	if (iterationOps.ops & iterationOpAddJuliaC)
+	{
+		z += iterationOps.juliaC;
+	}
+	else if (iterationOps.ops & iterationOpAddC)
+	{
+		if (iterationOps.ops & iterationOpSwapXY)
+			z += CVector3(c.y, c.x, c.z) * iterationOps.multiplier;
+		else
+			z += c * iterationOps.multiplier;
+	}
+
+	if (iterationOps.ops & iterationOpSmooth)
+	{
+		z = SmoothCVector(tempZ, z, iterationOps.weight);
+	}
+
+	// r calculation
+	// r = sqrt(z.x * z.x + z.y * z.y + z.z * z.z + w * w);
+	switch (formula)
+	{
+		case fastImagscaPower2:
+		{
+			CVector3 z2 = z * z;
+			r = sqrt(z2.x + z2.y + z2.z) + (z2.y * z2.z) / (z2.x);
+			break;
+		}
+		// scator magnitudes
+		// magnitude in imaginary scator algebra
+
+		case pseudoKleinian1:
+		{
+			r = sqrt(z.x * z.x + z.y * z.y);
+			break;
+		}
+
+		default:
+		{
+			r = sqrt(z.x * z.x + z.y * z.y + z.z * z.z + w * w);
+			break;
+		}
+	}
+
+	return fractal;
+}
+
+typedef const cFractal *(*fnIterateFormula)(const cNineFractals &fractals, const sFractalIn &in,
+	int i, int sequence, CVector3 &z, double &w, double &r, CVector3 &c,
+	sExtendedAux &extendedAux);
+
+struct sIterateFormula
+{
+	enumFractalFormula formula;
+	fnIterateFormula function;
+};
+
+#define ITERATE_FORMULA(F) \
+	{ \
+		F, &IterateFormula<F> \
+	}
+
+// iteration specialized for every formula. Formula selection, addition of constant and
+// r calculation are resolved at compile time
+static const sIterateFormula iterateFormulas[] = {
+	ITERATE_FORMULA(mandelbulb), ITERATE_FORMULA(mandelbulb2), ITERATE_FORMULA(mandelbulb3),
+	ITERATE_FORMULA(mandelbulb4), ITERATE_FORMULA(fast_mandelbulb_power2),
+	ITERATE_FORMULA(xenodreambuie), ITERATE_FORMULA(mandelbox), ITERATE_FORMULA(smoothMandelbox),
+	ITERATE_FORMULA(boxFoldBulbPow2), ITERATE_FORMULA(menger_sponge),
+	ITERATE_FORMULA(kaleidoscopicIFS), ITERATE_FORMULA(aexion), ITERATE_FORMULA(hypercomplex),
+	ITERATE_FORMULA(quaternion), ITERATE_FORMULA(benesi), ITERATE_FORMULA(bristorbrot),
+	ITERATE_FORMULA(ides), ITERATE_FORMULA(ides2), ITERATE_FORMULA(buffalo),
+	ITERATE_FORMULA(quickdudley), ITERATE_FORMULA(quickDudleyMod), ITERATE_FORMULA(lkmitch),
+	ITERATE_FORMULA(makin3d2), ITERATE_FORMULA(msltoeDonut), ITERATE_FORMULA(msltoesym2Mod),
+	ITERATE_FORMULA(msltoesym3Mod), ITERATE_FORMULA(msltoesym3Mod2), ITERATE_FORMULA(msltoesym3Mod3),
+	ITERATE_FORMULA(msltoesym4Mod), ITERATE_FORMULA(msltoeToroidal),
+	ITERATE_FORMULA(msltoeToroidalMulti), ITERATE_FORMULA(generalizedFoldBox),
+	ITERATE_FORMULA(aboxMod1), ITERATE_FORMULA(aboxMod2), ITERATE_FORMULA(aboxModKali),
+	ITERATE_FORMULA(aboxModKaliEiffie), ITERATE_FORMULA(aboxVSIcen1),
+	ITERATE_FORMULA(aexionOctopusMod), ITERATE_FORMULA(amazingSurf), ITERATE_FORMULA(amazingSurfMod1),
+	ITERATE_FORMULA(amazingSurfMulti), ITERATE_FORMULA(benesiPineTree),
+	ITERATE_FORMULA(benesiT1PineTree), ITERATE_FORMULA(benesiMagTransforms),
+	ITERATE_FORMULA(benesiPwr2s), ITERATE_FORMULA(collatz), ITERATE_FORMULA(collatzMod),
+	ITERATE_FORMULA(eiffieMsltoe), ITERATE_FORMULA(foldBoxMod1), ITERATE_FORMULA(iqBulb),
+	ITERATE_FORMULA(kalisets1), ITERATE_FORMULA(mandelboxMenger), ITERATE_FORMULA(mandelbulbBermarte),
+	ITERATE_FORMULA(mandelbulbKali), ITERATE_FORMULA(mandelbulbKaliMulti),
+	ITERATE_FORMULA(mandelbulbMulti), ITERATE_FORMULA(mandelbulbVaryPowerV1),
+	ITERATE_FORMULA(mengerCrossKIFS), ITERATE_FORMULA(mengerCrossMod1), ITERATE_FORMULA(mengerMod1),
+	ITERATE_FORMULA(mengerMiddleMod), ITERATE_FORMULA(mengerPrismShape),
+	ITERATE_FORMULA(mengerPrismShape2), ITERATE_FORMULA(mengerPwr2Poly),
+	ITERATE_FORMULA(pseudoKleinian1), ITERATE_FORMULA(pseudoKleinian2),
+	ITERATE_FORMULA(pseudoKleinian3), ITERATE_FORMULA(quaternion3D),
+	ITERATE_FORMULA(riemannSphereMsltoe), ITERATE_FORMULA(riemannSphereMsltoeV1),
+	ITERATE_FORMULA(riemannBulbMsltoeMod2), ITERATE_FORMULA(sierpinski3D),
+	ITERATE_FORMULA(fastImagscaPower2), ITERATE_FORMULA(transfAdditionConstantVaryV1),
+	ITERATE_FORMULA(transfAddCpixel), ITERATE_FORMULA(transfAddCpixelAxisSwap),
+	ITERATE_FORMULA(transfAddCpixelCxCyAxisSwap), ITERATE_FORMULA(transfAddCpixelPosNeg),
+	ITERATE_FORMULA(transfAddCpixelVaryV1), ITERATE_FORMULA(transfAddExp2Z),
+	ITERATE_FORMULA(transfBenesiT1), ITERATE_FORMULA(transfBenesiT1Mod),
+	ITERATE_FORMULA(transfBenesiT2), ITERATE_FORMULA(transfBenesiT3), ITERATE_FORMULA(transfBenesiT4),
+	ITERATE_FORMULA(transfBenesiT5b), ITERATE_FORMULA(transfBenesiMagForward),
+	ITERATE_FORMULA(transfBenesiMagBackward), ITERATE_FORMULA(transfBenesiCubeSphere),
+	ITERATE_FORMULA(transfBenesiSphereCube), ITERATE_FORMULA(transfBoxFold),
+	ITERATE_FORMULA(transfBoxFoldVaryV1), ITERATE_FORMULA(transfBoxFoldXYZ),
+	ITERATE_FORMULA(transfBoxOffset), ITERATE_FORMULA(transfFabsAddConstant),
+	ITERATE_FORMULA(transfFabsAddConstantV2), ITERATE_FORMULA(transfFabsAddConditional),
+	ITERATE_FORMULA(transfFabsAddMulti), ITERATE_FORMULA(transfFoldingTetra3D),
+	ITERATE_FORMULA(transfIterationWeight), ITERATE_FORMULA(transfInvCylindrical),
+	ITERATE_FORMULA(transfLinCombineCxyz), ITERATE_FORMULA(transfMultipleAngle),
+	ITERATE_FORMULA(transfNegFabsAddConstant), ITERATE_FORMULA(transfOctoFold),
+	ITERATE_FORMULA(transfPwr2Polynomial), ITERATE_FORMULA(transfRotation),
+	ITERATE_FORMULA(transfRotationVaryV1), ITERATE_FORMULA(transfRotatedFolding),
+	ITERATE_FORMULA(transfRpow3), ITERATE_FORMULA(transfScale), ITERATE_FORMULA(transfScaleVaryVCL),
+	ITERATE_FORMULA(transfScaleVaryV1), ITERATE_FORMULA(transfScale3D),
+	ITERATE_FORMULA(platonicSolid), ITERATE_FORMULA(transfRPower), ITERATE_FORMULA(transfSphereInvC),
+	ITERATE_FORMULA(transfSphereInv), ITERATE_FORMULA(transfSphericalOffset),
+	ITERATE_FORMULA(transfSphericalOffsetVCL), ITERATE_FORMULA(transfSphericalFold),
+	ITERATE_FORMULA(transfSphericalFoldAbox), ITERATE_FORMULA(transfSphericalFoldVaryV1),
+	ITERATE_FORMULA(transfSpherFoldVaryVCL), ITERATE_FORMULA(transfSphericalPwrFold),
+	ITERATE_FORMULA(transfSurfBoxFold), ITERATE_FORMULA(transfSurfFoldMulti),
+	ITERATE_FORMULA(transfZvectorAxisSwap), ITERATE_FORMULA(transfRotationFoldingPlane),
+	ITERATE_FORMULA(transfQuaternionFold), ITERATE_FORMULA(transfMengerFold),
+	ITERATE_FORMULA(transfReciprocal3), ITERATE_FORMULA(quaternion4D),
+	ITERATE_FORMULA(mandelboxVaryScale4D), ITERATE_FORMULA(bristorbrot4D), ITERATE_FORMULA(menger4D),
+	ITERATE_FORMULA(mixPinski4D), ITERATE_FORMULA(sierpinski4D),
+	ITERATE_FORMULA(transfAdditionConstant4D), ITERATE_FORMULA(transfBoxFold4D),
+	ITERATE_FORMULA(transfFabsAddConstant4D), ITERATE_FORMULA(transfFabsAddConstantV24D),
+	ITERATE_FORMULA(transfFabsAddConditional4D), ITERATE_FORMULA(transfIterationWeight4D),
+	ITERATE_FORMULA(transfReciprocal4D), ITERATE_FORMULA(transfScale4D),
+	ITERATE_FORMULA(transfSphericalFold4D)};
+
+int SelectIterateFunction(int formula)
+{
+	int numberOfFunctions = sizeof(iterateFormulas) / sizeof(sIterateFormula);
+	for (int f = 0; f < numberOfFunctions; f++)
+		if (iterateFormulas[f].formula == formula) return f;
+	return -1;
+}
+
+// iteration by function specialized for the formula of hybrid slot (selected at job start)
+static inline const cFractal *IterateFormulaFunction(const cNineFractals &fractals,
+	const sFractalIn &in, int i, int sequence, CVector3 &z, double &w, double &r, CVector3 &c,
+	sExtendedAux &extendedAux)
+{
+	int function = fractals.GetIterateFunction(sequence);
+	if (function >= 0)
+		return iterateFormulas[function].function(fractals, in, i, sequence, z, w, r, c, extendedAux);
+	return IterateFormula<-1>(fractals, in, i, sequence, z, w, r, c, extendedAux);
+}
+
+// iteration of the formula selected by hybrid sequence. Formulas F0..F2 are calculated by code
+// specialized at compile time, other ones by functions specialized for single formula
+template <int F0, int F1, int F2>
+static inline const cFractal *IterateSequence(const cNineFractals &fractals, const sFractalIn &in,
+	int i, int sequence, CVector3 &z, double &w, double &r, CVector3 &c,
+	sExtendedAux &extendedAux)
+{
+	const enumFractalFormula formula = fractals.GetFractal(sequence)->formula;
+	if (F0 >= 0 && formula == F0)
+		return IterateFormula<F0>(fractals, in, i, sequence, z, w, r, c, extendedAux);
+	if (F1 >= 0 && formula == F1)
+		return IterateFormula<F1>(fractals, in, i, sequence, z, w, r, c, extendedAux);
+	if (F2 >= 0 && formula == F2)
+		return IterateFormula<F2>(fractals, in, i, sequence, z, w, r, c, extendedAux);
+	return IterateFormulaFunction(fractals, in, i, sequence, z, w, r, c, extendedAux);
+}
+
+// distance estimated analytically from the state of iteration at the moment of bailout
+static inline double AnalyticDEDistance(const cNineFractals &fractals, enumFractalFormula formula,
+	const CVector3 &z, double r, const sExtendedAux &extendedAux)
+{
+	double distance = r;
+	if (fractals.IsHybrid())
+	{
+		if (extendedAux.r_dz > 0)
+		{
+			if (fractals.GetDEFunctionType(0) == fractal::linearDEFunction)
+			{
+				distance = r / fabs(extendedAux.DE);
+			}
+			else if (fractals.GetDEFunctionType(0) == fractal::logarithmicDEFunction)
+			{
+				distance = 0.5 * r * log(r) / extendedAux.r_dz;
+			}
+			else if (fractals.GetDEFunctionType(0) == fractal::pseudoKleinianDEFunction)
+			{
+				double rxy = sqrt(z.x * z.x + z.y * z.y);
+				distance = max(rxy - 0.92784, fabs(rxy * z.z) / r) / (extendedAux.DE);
+			}
+		}
+		else
+		{
+			distance = r;
+		}
+	}
+	else
+	{
+		switch (formula)
+		{
+			case benesi:
+			case benesiPineTree:
+			case benesiT1PineTree:
+			case benesiPwr2s:
+			case bristorbrot:
+			case bristorbrot4D:
+			case buffalo:
+			case eiffieMsltoe:
+			case fast_mandelbulb_power2:
+			case hypercomplex:
+			case iqBulb:
+			case mandelbulb:
+			case mandelbulb2:
+			case mandelbulb3:
+			case mandelbulb4:
+			case mandelbulbBermarte:
+			case mandelbulbKali:
+			case mandelbulbKaliMulti:
+			case mandelbulbMulti:
+			case mandelbulbVaryPowerV1:
+			case msltoesym2Mod:
+			case msltoesym3Mod:
+			case msltoesym3Mod2:
+			case msltoesym3Mod3:
+			case msltoesym4Mod:
+			case msltoeToroidal:			// TODO fix??
+			case msltoeToroidalMulti: // TODO fix??
+			case quaternion:
+			case transfQuaternionFold: // hmmm, this issue again
+			case quaternion3D:
+			case xenodreambuie:
+			{
+				if (extendedAux.r_dz > 0)
+					distance = 0.5 * r * log(r) / extendedAux.r_dz;
+				else
+					distance = r;
+				break;
+			}
+			case mandelbox:
+			case mandelboxMenger:
+			case smoothMandelbox:
+			case mandelboxVaryScale4D:
+			case generalizedFoldBox:
+			case foldBoxMod1:
+			case aboxModKali:
+			case aboxModKaliEiffie:
+			case aboxMod1:
+			case aboxMod2:
+			case amazingSurf:
+			case amazingSurfMod1:
+			case amazingSurfMulti:
+			case kalisets1:
+			case aboxVSIcen1:
+			case pseudoKleinian1:
+			{
+				if (extendedAux.DE > 0)
+					distance = r / fabs(extendedAux.DE);
+				else
+					distance = r;
+				break;
+			}
+			case kaleidoscopicIFS:
+			case menger_sponge:
+			case mengerCrossKIFS:
+			case mengerCrossMod1:
+			case mengerPrismShape:
+			case mengerPrismShape2:
+			case collatz:
+			case collatzMod:
+			case mengerMod1:
+			case mengerMiddleMod:
+			case transfMengerFold: // hmmm, this issue again
+			case mengerPwr2Poly:
+			case mixPinski4D:
+			case sierpinski4D:
+			case sierpinski3D:
+			case menger4D:
+			{
+				if (extendedAux.DE > 0)
+					distance = (r - 2.0) / (extendedAux.DE);
+				else
+					distance = r;
+				break;
+			}
+			case pseudoKleinian2:
+			case pseudoKleinian3:
+			{
+				if (extendedAux.DE > 0)
 				{
-					TransformAddExp2ZIteration(z, fractal, extendedAux);
-					break;
+					double rxy = sqrt(z.x * z.x + z.y * z.y);
+					distance = max(rxy - 0.92784, fabs(rxy * z.z) / r) / (extendedAux.DE);
 				}
+				else
+					distance = r;
+				break;
+			}
 
-				case transfBenesiT1:
-				{
-					TransformBenesiT1Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfBenesiT1Mod:
-				{
-					TransformBenesiT1ModIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfBenesiT2:
-				{
-					TransformBenesiT2Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfBenesiT3:
-				{
-					TransformBenesiT3Iteration(z, fractal);
-					break;
-				}
-				case transfBenesiT4:
-				{
-					TransformBenesiT4Iteration(z, fractal);
-					break;
-				}
-				case transfBenesiT5b:
-				{
-					TransformBenesiT5bIteration(z, fractal);
-					break;
-				}
-				case transfBenesiMagForward:
-				{
-					TransformBenesiMagForwardIteration(z);
-					break;
-				}
-				case transfBenesiMagBackward:
-				{
-					TransformBenesiMagBackwardIteration(z);
-					break;
-				}
-				case transfBenesiCubeSphere:
-				{
-					TransformBenesiCubeSphereIteration(z);
-					break;
-				}
-				case transfBenesiSphereCube:
-				{
-					TransformBenesiSphereCubeIteration(z);
-					break;
-				}
-				case transfBoxFold:
-				{
-					TransformBoxFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfBoxFoldVaryV1:
-				{
-					TransformBoxFoldVaryV1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfBoxFoldXYZ:
-				{
-					TransformBoxFoldXYZIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfBoxOffset:
-				{
-					TransformBoxOffsetIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfFabsAddConstant:
-				{
-					TransformFabsAddConstantIteration(z, fractal);
-					break;
-				}
-				case transfFabsAddConstantV2:
-				{
-					TransformFabsAddConstantV2Iteration(z, fractal);
-					break;
-				}
-				case transfFabsAddConditional:
-				{
-					TransformFabsAddConditionalIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfFabsAddMulti:
-				{
-					TransformFabsAddMultiIteration(z, fractal);
-					break;
-				}
-				case transfFoldingTetra3D:
-				{
-					TransformFoldingTetra3DIteration(z, fractal);
-					break;
-				}
-				case transfIterationWeight:
-				{
-					TransformIterationWeightIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfInvCylindrical:
-				{
-					TransformInvCylindricalIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfLinCombineCxyz:
-				{
-					TransformLinCombineCxyz(z, c, fractal, extendedAux);
-					break;
-				}
-				case transfMultipleAngle:
-				{
-					TransformMultipleAngle(z, fractal, extendedAux);
-					break;
-				}
-				case transfNegFabsAddConstant:
-				{
-					TransformNegFabsAddConstantIteration(z, fractal);
-					break;
-				}
-				case transfOctoFold:
-				{
-					TransformOctoFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfPwr2Polynomial:
-				{
-					TransformPwr2PolynomialIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfRotation:
-				{
-					TransformRotationIteration(z, fractal);
-					break;
-				}
-				case transfRotationVaryV1:
-				{
-					TransformRotationVaryV1Iteration(z, i, fractal);
-					break;
-				}
-				case transfRotatedFolding:
-				{
-					TransformRotatedFoldingIteration(z, fractal);
-					break;
-				}
-				case transfRpow3:
-				{
-					TransformRpow3Iteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfScale:
-				{
-					TransformScaleIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfScaleVaryVCL:
-				{
-					TransformScaleVaryVCLIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfScaleVaryV1:
-				{
-					TransformScaleVaryV1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfScale3D:
-				{
-					TransformScale3DIteration(z, fractal, extendedAux);
-					break;
-				}
-				case platonicSolid:
-				{
-					TransformPlatonicSolidIteration(z, fractal);
-					break;
-				}
-				case transfRPower:
-				{
-					TransformPowerR(z, fractal, extendedAux);
-					break;
-				}
-				case transfSphereInvC:
-				{
-					TransformSphereInvCIteration(z, c, fractal);
-					break;
-				}
-				case transfSphereInv:
-				{
-					TransformSphereInvIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalOffset:
-				{
-					TransformSphericalOffsetIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalOffsetVCL:
-				{
-					TransformSphericalOffsetVCLIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalFold:
-				{
-					TransformSphericalFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalFoldAbox:
-				{
-					TransformSphericalFoldAboxIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalFoldVaryV1:
-				{
-					TransformSphericalFoldVaryV1Iteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfSpherFoldVaryVCL:
-				{
-					TransformSpherFoldVaryVCLIteration(z, i, fractal, extendedAux);
-					break;
-				}
-				case transfSphericalPwrFold:
-				{
-					TransformSphericalPwrFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSurfBoxFold:
-				{
-					TransformSurfBoxFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfSurfFoldMulti:
-				{
-					TransformSurfFoldMultiIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfZvectorAxisSwap:
-				{
-					TransformZvectorAxisSwapIteration(z, i, fractal);
-					break;
-				}
-				case transfRotationFoldingPlane:
-				{
-					TransformRotationFoldingPlane(z, fractal, extendedAux);
-					break;
-				}
-				case transfQuaternionFold:
-				{
-					TransformQuaternionFoldIteration(z, c, fractal, extendedAux);
-					break;
-				}
-				case transfMengerFold:
-				{
-					TransformMengerFoldIteration(z, fractal, extendedAux);
-					break;
-				}
-				case transfReciprocal3:
-				{
-					TransformReciprocal3Iteration(z, fractal, extendedAux);
-					break;
-				}
+			default: distance = -1.0; break;
+		}
+	}
+	return distance;
+}
+
+// length of z used by colouring algorithm to find minimum distance of orbit
+static inline double ColouringLength(const sFractalIn &in, const CVector3 &z, double r)
+{
+	double length = 0.0;
+	switch (in.fractalColoring.coloringAlgorithm)
+	{
+		case sFractalColoring::fractalColoringStandard:
+		{
+			length = r;
+			break;
+		}
+		case sFractalColoring::fractalColoringZDotPoint:
+		{
+			length = fabs(z.Dot(in.point));
+			break;
+		}
+		case sFractalColoring::fractalColoringSphere:
+		{
+			length = fabs((z - in.point).Length() - in.fractalColoring.sphereRadius);
+			break;
+		}
+		case sFractalColoring::fractalColoringCross:
+		{
+			length = dMin(fabs(z.x), fabs(z.y), fabs(z.z));
+			break;
+		}
+		case sFractalColoring::fractalColoringLine:
+		{
+			length = fabs(z.Dot(in.fractalColoring.lineDirection));
+			break;
+		}
+		case sFractalColoring::fractalColoringNone:
+		{
+			length = r;
+			break;
+		}
+	}
+	return length;
+}
+
+// colour index calculated from the state of iteration at the end of colouring
+static inline double ColouringIndex(const cNineFractals &fractals, const sFractalIn &in,
+	enumFractalFormula formula, const cFractal *defaultFractal, int i, double r, double minimumR,
+	const sExtendedAux &extendedAux)
+{
+	double colorIndex = 0.0;
+	double mboxDE = 1.0;
+	mboxDE = extendedAux.DE;
+	double r2 = r / fabs(mboxDE);
+	if (r2 > 20) r2 = 20;
+
+	if (fractals.IsHybrid())
+	{
+		if (minimumR > 100) minimumR = 100;
+
+		double mboxColor = 0.0;
+
+		mboxColor = extendedAux.color;
+
+		if (mboxColor > 1000) mboxColor = 1000;
+
+		colorIndex = minimumR * 1000.0 + mboxColor * 100 + r2 * 5000.0;
+		/*colorIndex =
+
+				extendedAux.color * 100.0 * extendedAux.foldFactor	 // folds part
+
+				+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
+
+				+ 1.0 * r2 * 5000.0 // for backwards compatability
+
+				+ extendedAux.scaleFactor * r * i / 1e15						 // scale part conditional on i & r
+				+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+							? minimumR * extendedAux.minRFactor * 1000.0
+							: 0.0);*/
+	}
+	else
+	{
+		switch (formula)
+		{
+			case mandelbox:
+			case smoothMandelbox:
+			case mandelboxVaryScale4D:
+			case generalizedFoldBox:
+
+			case foldBoxMod1:
+				colorIndex =
+					extendedAux.color * 100.0														 // folds part
+					+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
+					+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+								? minimumR * 1000.0
+								: 0.0);
+				break;
+
+			case mengerMod1:
+			case aboxModKali:
+			case aboxMod1:
+			case menger_sponge:
+			case collatz:
+			case collatzMod:
+			case kaleidoscopicIFS:
+			case mengerPwr2Poly:
+			case mengerMiddleMod: colorIndex = minimumR * 1000.0; break;
+
+			case amazingSurf: colorIndex = minimumR * 200.0; break;
+
+			case amazingSurfMulti:
+			case mandelboxMenger:
+			case amazingSurfMod1:
+			case aboxModKaliEiffie:
+				colorIndex =
+					extendedAux.color * 100.0 * extendedAux.foldFactor	 // folds part
+					+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
+					+ extendedAux.scaleFactor * r2 * 5000.0							 // for backwards compatability
+					//+ extendedAux.scaleFactor * r * i / 1e15						 // scale part conditional on i &
+					// r
+					+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+								? minimumR * extendedAux.minRFactor * 1000.0
+								: 0.0);
+				break;
+
+			case msltoeDonut: colorIndex = extendedAux.color * 2000.0 / i; break;
+
+			default: colorIndex = minimumR * 5000.0; break;
+		}
+	}
+	return colorIndex;
+}
+
+// fractal computation. F0..F2 are formulas of the hybrid sequence known at compile time (-1 for
+// generic code)
+template <fractal::enumCalculationMode Mode, int F0, int F1, int F2>
+static void ComputeKernel(const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out)
+{
+	// QTextStream outStream(stdout);
+	// clock_t tim;
+	// tim = rdtsc();
+
+	// repeat, move and rotate
+	CVector3 point2 = in.point.mod(in.common.repeat) - in.common.fractalPosition;
+	point2 = in.common.mRotFractalRotation.RotateVector(point2);
+
+	CVector3 z = point2;
+	double r = z.Length();
+	CVector3 c = z;
+	double minimumR = 100.0;
+
+	double w;
+	if (in.forcedFormulaIndex >= 0)
+	{
+		w = fractals.GetInitialWAxis(in.forcedFormulaIndex);
+	}
+	else
+	{
+		w = fractals.GetInitialWAxis(0);
+	}
 
-				// 4D  ---------------------------------------------------------------------------
-				case quaternion4D:
-				{
-					CVector4 z4D(z, w);
-					Quaternion4DIteration(z4D, fractal);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case mandelboxVaryScale4D:
-				{
-					CVector4 z4D(z, w);
-					MandelboxVaryScale4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case bristorbrot4D:
-				{
-					CVector4 z4D(z, w);
-					Bristorbrot4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case menger4D:
-				{
-					CVector4 z4D(z, w);
-					Menger4DIteration(z4D, i, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case mixPinski4D:
-				{
-					CVector4 z4D(z, w);
-					MixPinski4DIteration(z4D, i, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case sierpinski4D:
-				{
-					CVector4 z4D(z, w);
-					Sierpinski4DIteration(z4D, i, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
-				}
-				case transfAdditionConstant4D:
+	double orbitTrapTotal = 0.0;
+
+	enumFractalFormula formula = fractal::none;
+
+	if (in.common.iterThreshMode)
+		out->maxiter = true;
+	else
+		out->maxiter = false;
+
+	int fractalIndex = 0;
+	if (in.forcedFormulaIndex >= 0) fractalIndex = in.forcedFormulaIndex;
+
+	const cFractal *defaultFractal = fractals.GetFractal(fractalIndex);
+
+	sExtendedAux extendedAux;
+
+	extendedAux.r_dz = 1.0;
+	extendedAux.r = r;
+	extendedAux.color = 1.0;
+	extendedAux.actualScale = fractals.GetFractal(fractalIndex)->mandelbox.scale;
+	extendedAux.DE = 1.0;
+	extendedAux.c = c;
+	extendedAux.cw = 0;
+	extendedAux.foldFactor = 0.0;
+	extendedAux.minRFactor = 0.0;
+	extendedAux.scaleFactor = 0.0;
+	// extendedAux.newR = 1e+20;
+	// extendedAux.axisBias = 1e+20;
+	// extendedAux.orbitTraps = 1e+20;
+	// extendedAux.transformSampling = 1e+20;
+
+	// main iteration loop
+	int i;
+	int sequence = 0;
+
+	// colouring uses ten times more iterations than distance (like SurfaceColour())
+	int maxN = (Mode == calcModeCombined) ? in.maxN * 10 : in.maxN;
+	bool distanceDone = false;
+	bool colouringDone = false;
+	bool orbitTrapDone = false;
+
+	CVector3 lastGoodZ;
+	CVector3 lastZ;
+
+	// Brent's cycle detection. Orbit point is saved at iterations which are powers of 2 and
+	// following points are compared with it. Only distance modes can stop before bailout
+	const bool periodicityCheck =
+		in.common.periodicityCheck && (Mode == calcModeNormal || Mode == calcModeDeltaDE1);
+	CVector3 periodicZ = z;
+	int periodicNext = 1;
+	out->periodic = false;
+
+	for (i = 0; i < maxN; i++)
+	{
+		lastGoodZ = lastZ;
+		lastZ = z;
+
+		// hybrid fractal sequence
+		if (in.forcedFormulaIndex >= 0)
+		{
+			sequence = in.forcedFormulaIndex;
+		}
+		else
+		{
+			sequence = fractals.GetSequence(i);
+		}
+
+		const cFractal *fractal =
+			IterateSequence<F0, F1, F2>(fractals, in, i, sequence, z, w, r, c, extendedAux);
+		formula = fractal->formula;
+		const sFormulaHotParams &hot = fractals.GetHotParams(sequence);
+
+		if (z.IsNotANumber())
+		{
+			z = lastZ;
+			r = z.Length();
+			w = 0.0;
+			if (Mode != calcModeCombined || !distanceDone) out->maxiter = true;
+			break;
+		}
+
+		// escape conditions
+		if (hot.checkForBailout)
+		{
+			if (Mode == calcModeNormal)
+			{
+				if (r > hot.bailout)
 				{
-					CVector4 z4D(z, w);
-					TransformAdditionConstant4DIteration(z4D, fractal);
-					z = z4D.GetXYZ();
-					w = z4D.w;
+					out->maxiter = false;
 					break;
 				}
-				case transfBoxFold4D:
+
+				if ((z - lastZ).Length() / r < 0.1 / hot.bailout)
 				{
-					CVector4 z4D(z, w);
-					TransformBoxFold4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
+					out->maxiter = false;
 					break;
 				}
-				case transfFabsAddConstant4D:
+			}
+			else if (Mode == calcModeDeltaDE1)
+			{
+				if (r > hot.bailout)
 				{
-					CVector4 z4D(z, w);
-					TransformFabsAddConstant4DIteration(z4D, fractal);
-					z = z4D.GetXYZ();
-					w = z4D.w;
+					out->maxiter = false;
 					break;
 				}
-				case transfFabsAddConstantV24D:
+
+				if ((z - lastZ).Length() / r < 0.1 / hot.bailout)
 				{
-					CVector4 z4D(z, w);
-					TransformFabsAddConstantV24DIteration(z4D, fractal);
-					z = z4D.GetXYZ();
-					w = z4D.w;
+					out->maxiter = false;
 					break;
 				}
-				case transfFabsAddConditional4D:
+			}
+			else if (Mode == calcModeDeltaDE2)
+			{
+				if (i == in.maxN) break;
+			}
+			else if (Mode == calcModeColouring)
+			{
+				double len = ColouringLength(in, z, r);
+				if (fractal->formula != mandelbox
+						|| in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
 				{
-					CVector4 z4D(z, w);
-					TransformFabsAddConditional4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
+					if (len < minimumR) minimumR = len;
 				}
-				case transfIterationWeight4D:
+				if (r > 1e15 || (z - lastZ).Length() / r < 1e-15) break;
+			}
+			else if (Mode == calcModeOrbitTrap)
+			{
+				CVector3 delta = z - in.common.fakeLightsOrbitTrap;
+				double distance = delta.Length();
+				if (i >= in.common.fakeLightsMinIter && i <= in.common.fakeLightsMaxIter)
+					orbitTrapTotal += (1.0f / (distance * distance));
+				if (distance > 1000)
 				{
-					CVector4 z4D(z, w);
-					TransformIterationWeight4DIteration(z4D, i, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
+					out->orbitTrapR = orbitTrapTotal;
 					break;
 				}
-				case transfReciprocal4D:
+			}
+			else if (Mode == calcModeCombined)
+			{
+				// distance is estimated at the moment of bailout. Colouring and orbit trap are continued
+				// until their own escape conditions
+				if (!distanceDone
+						&& (r > hot.bailout
+								 || (z - lastZ).Length() / r < 0.1 / hot.bailout))
 				{
-					CVector4 z4D(z, w);
-					TransformReciprocal4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
+					out->maxiter = false;
+					out->distance = AnalyticDEDistance(fractals, formula, z, r, extendedAux);
+					out->iters = i + 1;
+					out->z = z;
+					distanceDone = true;
 				}
-				case transfScale4D:
+				if (!colouringDone)
 				{
-					CVector4 z4D(z, w);
-					TransformScale4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
+					double len = ColouringLength(in, z, r);
+					if (fractal->formula != mandelbox
+							|| in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+					{
+						if (len < minimumR) minimumR = len;
+					}
+					if (r > 1e15 || (z - lastZ).Length() / r < 1e-15)
+					{
+						out->colorIndex =
+							ColouringIndex(fractals, in, formula, defaultFractal, i, r, minimumR, extendedAux);
+						colouringDone = true;
+					}
 				}
-				case transfSphericalFold4D:
+				if (!orbitTrapDone)
 				{
-					CVector4 z4D(z, w);
-					TransformSphericalFold4DIteration(z4D, fractal, extendedAux);
-					z = z4D.GetXYZ();
-					w = z4D.w;
-					break;
+					double distance = (z - in.common.fakeLightsOrbitTrap).Length();
+					if (i >= in.common.fakeLightsMinIter && i <= in.common.fakeLightsMaxIter)
+						orbitTrapTotal += (1.0f / (distance * distance));
+					if (distance > 1000)
+					{
+						out->orbitTrapR = orbitTrapTotal;
+						orbitTrapDone = true;
+					}
 				}
+				if (distanceDone && colouringDone && orbitTrapDone) break;
+			}
+		}
+
+		if (z.IsNotANumber()) // detection of dead computation
+		{
+			// if(Mode != calcModeColouring)
+			// qWarning() << "Dead computation\n"
+			//		<< "iteration: " << i << "Formula:" << formula << "Sequence:" << sequence
+			//		<< "\nPoint:" << in.point.Debug()
+			//		<< "\nLast good z:" << lastGoodZ.Debug()
+			//		<< "\nPrevious z:" << lastZ.Debug();
+			z = lastGoodZ;
+			break;
+		}
+
+		if (periodicityCheck)
+		{
+			// the same point is reached again, so orbit never escapes
+			if (i >= in.minN && (z - periodicZ).Length() < in.common.periodicityTolerance)
+			{
+				out->maxiter = true;
+				out->periodic = true;
+				break;
+			}
+			if (i == periodicNext)
+			{
+				periodicZ = z;
+				periodicNext *= 2;
+			}
+		}
+
+		// here distance and orbit trap calculations end without bailout
+		if (Mode == calcModeCombined && i == in.maxN - 1)
+		{
+			if (!distanceDone)
+			{
+				out->distance = AnalyticDEDistance(fractals, formula, z, r, extendedAux);
+				out->iters = in.maxN + 1;
+				out->z = z;
+				distanceDone = true;
+			}
+			if (!orbitTrapDone) out->orbitTrapR = orbitTrapTotal;
+			orbitTrapDone = true;
+			if (colouringDone) break;
+		}
+	}
+
+	// final calculations
+	if (Mode == calcModeNormal)
+	{
+		out->distance = AnalyticDEDistance(fractals, formula, z, r, extendedAux);
+	}
+	// color calculation
+	else if (Mode == calcModeColouring)
+	{
+		out->colorIndex =
+			ColouringIndex(fractals, in, formula, defaultFractal, i, r, minimumR, extendedAux);
+	}
+	else if (Mode == calcModeCombined)
+	{
+		// parts which were interrupted by dead computation
+		if (!distanceDone)
+		{
+			out->distance = AnalyticDEDistance(fractals, formula, z, r, extendedAux);
+			out->iters = i + 1;
+			out->z = z;
+		}
+		if (!colouringDone)
+			out->colorIndex =
+				ColouringIndex(fractals, in, formula, defaultFractal, i, r, minimumR, extendedAux);
+		return;
+	}
+	else
+	{
+		out->distance = 0.0;
+		// orbit trap is also valid when iterations end without escape
+		if (Mode == calcModeOrbitTrap) out->orbitTrapR = orbitTrapTotal;
+	}
+
+	out->iters = i + 1;
+	out->z =  z;// CVector3( z.x, z.y, w);// z;
+	// tim = rdtsc() - tim; perf+= tim; perfCount++; outStream << (double)perf/perfCount - 560.0 <<
+	// endl;
+	//------------- 3249 ns for all calculation  ----------------
+}
+
+typedef void (*fnComputeKernel)(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+
+// kernels for one shape of hybrid sequence, indexed by calculation mode
+struct sComputeKernel
+{
+	int formulas[COMPUTE_KERNEL_FORMULAS];
+	fnComputeKernel modes[calcModeCombined + 1];
+};
+
+#define COMPUTE_KERNEL(F0, F1, F2) \
+	{ \
+		{F0, F1, F2}, \
+		{ \
+			&ComputeKernel<calcModeNormal, F0, F1, F2>, \
+			&ComputeKernel<calcModeColouring, F0, F1, F2>, NULL, \
+			&ComputeKernel<calcModeDeltaDE1, F0, F1, F2>, \
+			&ComputeKernel<calcModeDeltaDE2, F0, F1, F2>, \
+			&ComputeKernel<calcModeOrbitTrap, F0, F1, F2>, \
+			&ComputeKernel<calcModeCombined, F0, F1, F2> \
+		} \
+	}
+
+// the most common shapes of hybrid sequences. Shapes with less formulas have to be first
+static const sComputeKernel computeKernels[] = {
+	COMPUTE_KERNEL(mandelbulb, -1, -1), COMPUTE_KERNEL(mandelbox, -1, -1),
+	COMPUTE_KERNEL(menger_sponge, -1, -1), COMPUTE_KERNEL(amazingSurf, -1, -1),
+	COMPUTE_KERNEL(kaleidoscopicIFS, -1, -1), COMPUTE_KERNEL(mandelbulb, mandelbox, -1),
+	COMPUTE_KERNEL(mandelbox, menger_sponge, -1), COMPUTE_KERNEL(mandelbulb, menger_sponge, -1),
+	COMPUTE_KERNEL(amazingSurf, mandelbox, -1),
+	COMPUTE_KERNEL(mandelbulb, mandelbox, menger_sponge)};
+
+int SelectComputeKernel(const cNineFractals &fractals)
+{
+	// collect formulas used in the sequence
+	bool used[NUMBER_OF_FRACTALS] = {false};
+	used[0] = true;
+	for (int i = 0; i < fractals.GetSequenceLength(); i++)
+		used[fractals.GetSequence(i)] = true;
+
+	int numberOfKernels = sizeof(computeKernels) / sizeof(sComputeKernel);
+	for (int k = 0; k < numberOfKernels; k++)
+	{
+		bool match = true;
+		for (int f = 0; f < NUMBER_OF_FRACTALS && match; f++)
+		{
+			if (!used[f]) continue;
+			int formula = fractals.GetFractal(f)->formula;
+			bool found = false;
+			for (int n = 0; n < COMPUTE_KERNEL_FORMULAS; n++)
+				if (computeKernels[k].formulas[n] == formula) found = true;
+			match = found;
+		}
+		if (match) return k;
+	}
+	return -1;
+}
+
+template <fractal::enumCalculationMode Mode>
+void Compute(const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out)
+{
+	int kernel = fractals.GetComputeKernel();
+	if (kernel >= 0 && in.forcedFormulaIndex < 0)
+		computeKernels[kernel].modes[Mode](fractals, in, out);
+	else
+		ComputeKernel<Mode, -1, -1, -1>(fractals, in, out);
+}
+
+template void Compute<calcModeNormal>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+template void Compute<calcModeDeltaDE1>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+template void Compute<calcModeDeltaDE2>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+template void Compute<calcModeColouring>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+template void Compute<calcModeOrbitTrap>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+template void Compute<calcModeCombined>(
+	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
+
+// ---------------------------------------------------------------------------
+// batched computation of many points
+// ---------------------------------------------------------------------------
+
+// number of points calculated together by vectorized path of ComputeBatch()
+#define COMPUTE_BATCH_LANES 8
+
+// lanes in SoA layout. T is float or double
+template <typename T>
+struct sComputeBatchLanes
+{
+	T x[COMPUTE_BATCH_LANES];
+	T y[COMPUTE_BATCH_LANES];
+	T z[COMPUTE_BATCH_LANES];
+	T lastX[COMPUTE_BATCH_LANES];
+	T lastY[COMPUTE_BATCH_LANES];
+	T lastZ[COMPUTE_BATCH_LANES];
+	T cx[COMPUTE_BATCH_LANES];
+	T cy[COMPUTE_BATCH_LANES];
+	T cz[COMPUTE_BATCH_LANES];
+	T r[COMPUTE_BATCH_LANES];
+	T r_dz[COMPUTE_BATCH_LANES];
+	T DE[COMPUTE_BATCH_LANES];
+	// state of lane at the moment of escape. Lanes are iterated together, so escaped lanes are
+	// restored from it after every iteration instead of overflowing to inf or NaN
+	T escapedX[COMPUTE_BATCH_LANES];
+	T escapedY[COMPUTE_BATCH_LANES];
+	T escapedZ[COMPUTE_BATCH_LANES];
+	T escapedR[COMPUTE_BATCH_LANES];
+	T escapedRdz[COMPUTE_BATCH_LANES];
+	T escapedDE[COMPUTE_BATCH_LANES];
+	double orbitTrapTotal[COMPUTE_BATCH_LANES];
+	bool active[COMPUTE_BATCH_LANES];
+};
+
+// returns true if vectorized path calculates the same iterations and escape conditions as
+// Compute(). Results differ only by rounding (float lanes, double-double lanes, fast math)
+template <fractal::enumCalculationMode Mode>
+static bool ComputeBatchVectorizable(const cNineFractals &fractals, int sequence)
+{
+	if (Mode != calcModeNormal && Mode != calcModeDeltaDE1 && Mode != calcModeOrbitTrap)
+		return false;
+	if (fractals.IsHybrid()) return false;
+
+	const cFractal *fractal = fractals.GetFractal(sequence);
+	switch (fractal->formula)
+	{
+		case mandelbulb: return true;
+		case mandelbox: return !fractal->mandelbox.rotationsEnabled;
+		default: return false;
+	}
+}
+
+// returns true if the fractal can be calculated by vectorized path with double-double numbers
+static bool ComputeBatchDoubleDoubleCapable(
+	const cNineFractals &fractals, const sFractalIn &in, int sequence)
+{
+	// there is no modulo for double-double numbers
+	if (in.common.repeat.Length() > 0.0) return false;
+
+	// there are no trigonometric functions for double-double numbers
+	const cFractal *fractal = fractals.GetFractal(sequence);
+	if (fractal->formula == mandelbulb)
+		return fractal->bulb.power == 8.0 && fractal->bulb.alphaAngleOffset == 0.0
+					 && fractal->bulb.betaAngleOffset == 0.0;
+	return true;
+}
+
+// conversion of lane values for code which works in double precision
+static inline double LaneToDouble(double v)
+{
+	return v;
+}
+static inline double LaneToDouble(float v)
+{
+	return v;
+}
+static inline double LaneToDouble(const sDoubleDouble &v)
+{
+	return v.ToDouble();
+}
+
+// rotation of lane vector
+template <typename T>
+static inline void BatchRotate(const CRotationMatrix &rot, T &x, T &y, T &z)
+{
+	CVector3 v = rot.RotateVector(CVector3(x, y, z));
+	x = v.x;
+	y = v.y;
+	z = v.z;
+}
+
+// double-double numbers are rotated without rounding to double
+static inline void BatchRotate(
+	const CRotationMatrix &rot, sDoubleDouble &x, sDoubleDouble &y, sDoubleDouble &z)
+{
+	CMatrix33 m = rot.GetMatrix();
+	sDoubleDouble rx = x * m.m11 + y * m.m12 + z * m.m13;
+	sDoubleDouble ry = x * m.m21 + y * m.m22 + z * m.m23;
+	sDoubleDouble rz = x * m.m31 + y * m.m32 + z * m.m33;
+	x = rx;
+	y = ry;
+	z = rz;
+}
+
+// initial values of lane (repeat, move and rotate). Low part of the point is used only by
+// double-double numbers and can be NULL
+template <typename T>
+static inline void BatchInitPoint(sComputeBatchLanes<T> &l, int k, const sFractalIn &in,
+	const CVector3 &point, const CVector3 *pointLow)
+{
+	Q_UNUSED(pointLow);
+	CVector3 point2 = point.mod(in.common.repeat) - in.common.fractalPosition;
+	point2 = in.common.mRotFractalRotation.RotateVector(point2);
+	l.x[k] = l.cx[k] = point2.x;
+	l.y[k] = l.cy[k] = point2.y;
+	l.z[k] = l.cz[k] = point2.z;
+	l.r[k] = point2.Length();
+}
+
+// repeat is not used with double-double numbers (see ComputeBatchDoubleDoubleCapable())
+static inline void BatchInitPoint(sComputeBatchLanes<sDoubleDouble> &l, int k,
+	const sFractalIn &in, const CVector3 &point, const CVector3 *pointLow)
+{
+	sDoubleDouble x = sDoubleDouble(point.x) - in.common.fractalPosition.x;
+	sDoubleDouble y = sDoubleDouble(point.y) - in.common.fractalPosition.y;
+	sDoubleDouble z = sDoubleDouble(point.z) - in.common.fractalPosition.z;
+	if (pointLow)
+	{
+		x += pointLow->x;
+		y += pointLow->y;
+		z += pointLow->z;
+	}
+	BatchRotate(in.common.mRotFractalRotation, x, y, z);
+	l.x[k] = l.cx[k] = x;
+	l.y[k] = l.cy[k] = y;
+	l.z[k] = l.cz[k] = z;
+	l.r[k] = sqrt(x * x + y * y + z * z);
+}
+
+// box folding (the same as BoxFolding(), without colouring)
+template <typename T>
+static inline void BatchBoxFolding(
+	sComputeBatchLanes<T> &l, int n, const sFractalFoldings &foldings)
+{
+	const T limit = foldings.boxLimit;
+	const T value = foldings.boxValue;
+	for (int k = 0; k < n; k++)
+	{
+		l.x[k] = l.x[k] > limit ? value - l.x[k] : (l.x[k] < -limit ? -value - l.x[k] : l.x[k]);
+		l.y[k] = l.y[k] > limit ? value - l.y[k] : (l.y[k] < -limit ? -value - l.y[k] : l.y[k]);
+		l.z[k] = l.z[k] > limit ? value - l.z[k] : (l.z[k] < -limit ? -value - l.z[k] : l.z[k]);
+		l.r[k] = sqrt(l.x[k] * l.x[k] + l.y[k] * l.y[k] + l.z[k] * l.z[k]);
+	}
+}
 
-				default:
-					double high = fractals.GetBailout(sequence) * 10.0;
-					z = CVector3(high, high, high);
-					break;
-			}
-		}
+// spherical folding (the same as SphericalFolding(), without colouring)
+template <typename T>
+static inline void BatchSphericalFolding(
+	sComputeBatchLanes<T> &l, int n, const sFractalFoldings &foldings)
+{
+	const T fR2_2 = foldings.sphericalOuter * foldings.sphericalOuter;
+	const T mR2_2 = foldings.sphericalInner * foldings.sphericalInner;
+	const T fold_factor1_2 = fR2_2 / mR2_2;
+	const T sqrtFoldFactor1 = sqrt(fold_factor1_2);
+	for (int k = 0; k < n; k++)
+	{
+		T r2_2 = l.r[k] * l.r[k];
+		T factor = r2_2 < mR2_2 ? fold_factor1_2 : (r2_2 < fR2_2 ? fR2_2 / r2_2 : T(1.0));
+		bool folded = r2_2 < fR2_2;
+		l.x[k] *= factor;
+		l.y[k] *= factor;
+		l.z[k] *= factor;
+		l.DE[k] *= factor;
+		l.r_dz[k] = folded ? l.r_dz[k] * sqrtFoldFactor1 : l.r_dz[k];
+		l.r[k] = sqrt(l.x[k] * l.x[k] + l.y[k] * l.y[k] + l.z[k] * l.z[k]);
+	}
+}
 
-		// addition of constant
-		if (fractals.IsAddCConstant(sequence))
+// the same as MandelbulbIteration()
+template <typename T>
+static inline void BatchMandelbulbIteration(
+	sComputeBatchLanes<T> &l, int n, const sFormulaHotParams &hot)
+{
+	const T power = hot.bulbPower;
+	const T alphaOffset = hot.bulbAlphaOffset;
+	const T betaOffset = hot.bulbBetaOffset;
+
+	if (hot.fastMath)
+	{
+		if (hot.bulbPower == 8.0 && hot.bulbAlphaOffset == 0.0 && hot.bulbBetaOffset == 0.0)
 		{
-			switch (formula)
+			for (int k = 0; k < n; k++)
 			{
-				case aboxMod1:
-				case amazingSurf:
-					// case amazingSurfMod1:
-					{
-						if (fractals.IsJuliaEnabled(sequence))
-						{
-							CVector3 juliaC =
-								fractals.GetJuliaConstant(sequence) * fractals.GetConstantMultiplier(sequence);
-							z += CVector3(juliaC.y, juliaC.x, juliaC.z);
-						}
-						else
-						{
-							z += CVector3(c.y, c.x, c.z) * fractals.GetConstantMultiplier(sequence);
-						}
-						break;
-					}
-
-				default:
-				{
-					if (fractals.IsJuliaEnabled(sequence))
-					{
-						z += fractals.GetJuliaConstant(sequence) * fractals.GetConstantMultiplier(sequence);
-					}
-					else
-					{
-						z += c * fractals.GetConstantMultiplier(sequence);
-					}
-					break;
-				}
+				T rp = MandelbulbPower8Polynomial(l.x[k], l.y[k], l.z[k], l.r[k]);
+				l.r_dz[k] = rp * l.r_dz[k] * T(8.0) + T(1.0);
 			}
 		}
-
-		if (fractals.IsHybrid())
-		{
-			z = SmoothCVector(tempZ, z, fractals.GetWeight(sequence));
-		}
-
-		// r calculation
-		// r = sqrt(z.x * z.x + z.y * z.y + z.z * z.z + w * w);
-		switch (fractal->formula)
+		else
 		{
-			case fastImagscaPower2:
+			for (int k = 0; k < n; k++)
 			{
-				CVector3 z2 = z * z;
-				r = sqrt(z2.x + z2.y + z2.z) + (z2.y * z2.z) / (z2.x);
-				break;
+				T th0 = FastAsin(l.z[k] / l.r[k]) + betaOffset;
+				T ph0 = FastAtan2(l.y[k], l.x[k]) + alphaOffset;
+				T rp = pow(l.r[k], power - T(1.0));
+				T sth, cth, sph, cph;
+				FastSinCos(th0 * power, &sth, &cth);
+				FastSinCos(ph0 * power, &sph, &cph);
+				l.r_dz[k] = rp * l.r_dz[k] * power + T(1.0);
+				rp *= l.r[k];
+				l.x[k] = cth * cph * rp;
+				l.y[k] = cth * sph * rp;
+				l.z[k] = sth * rp;
 			}
-			// scator magnitudes
-			// magnitude in imaginary scator algebra
+		}
+		return;
+	}
 
-			case pseudoKleinian1:
-			{
-				r = sqrt(z.x * z.x + z.y * z.y);
-				break;
-			}
+	for (int k = 0; k < n; k++)
+	{
+		T th0 = asin(l.z[k] / l.r[k]) + betaOffset;
+		T ph0 = atan2(l.y[k], l.x[k]) + alphaOffset;
+		T rp = pow(l.r[k], power - T(1.0));
+		T th = th0 * power;
+		T ph = ph0 * power;
+		T cth = cos(th);
+		l.r_dz[k] = rp * l.r_dz[k] * power + T(1.0);
+		rp *= l.r[k];
+		l.x[k] = cth * cos(ph) * rp;
+		l.y[k] = cth * sin(ph) * rp;
+		l.z[k] = sin(th) * rp;
+	}
+}
 
-			default:
-			{
-				r = sqrt(z.x * z.x + z.y * z.y + z.z * z.z + w * w);
-				break;
-			}
-		}
+// double-double version is used only for power 8 without angle offsets (see
+// ComputeBatchDoubleDoubleCapable())
+static inline void BatchMandelbulbIteration(
+	sComputeBatchLanes<sDoubleDouble> &l, int n, const sFormulaHotParams &hot)
+{
+	Q_UNUSED(hot);
+	for (int k = 0; k < n; k++)
+	{
+		sDoubleDouble rp = MandelbulbPower8Polynomial(l.x[k], l.y[k], l.z[k], l.r[k]);
+		l.r_dz[k] = rp * l.r_dz[k] * 8.0 + 1.0;
+	}
+}
 
-		if (z.IsNotANumber())
+// the same as MandelboxIteration() without fold rotations and colouring
+template <typename T>
+static inline void BatchMandelboxIteration(
+	sComputeBatchLanes<T> &l, int n, const sFormulaHotParams &hot)
+{
+	const T limit = hot.mboxFoldingLimit;
+	const T value = hot.mboxFoldingValue;
+	const T scale = hot.mboxScale;
+	const T fabsScale = fabs(hot.mboxScale);
+	const T mR2 = hot.mboxMR2;
+	const T fR2 = hot.mboxFR2;
+	const T mboxFactor1 = hot.mboxFactor1;
+	const T offsetX = hot.mboxOffset.x;
+	const T offsetY = hot.mboxOffset.y;
+	const T offsetZ = hot.mboxOffset.z;
+	for (int k = 0; k < n; k++)
+	{
+		T x = l.x[k] > limit ? value - l.x[k] : (l.x[k] < -limit ? -value - l.x[k] : l.x[k]);
+		T y = l.y[k] > limit ? value - l.y[k] : (l.y[k] < -limit ? -value - l.y[k] : l.y[k]);
+		T z = l.z[k] > limit ? value - l.z[k] : (l.z[k] < -limit ? -value - l.z[k] : l.z[k]);
+
+		T r2 = x * x + y * y + z * z;
+		T factor = r2 < mR2 ? mboxFactor1 : (r2 < fR2 ? fR2 / r2 : T(1.0));
+
+		l.x[k] = (x + offsetX) * factor - offsetX;
+		l.y[k] = (y + offsetY) * factor - offsetY;
+		l.z[k] = (z + offsetZ) * factor - offsetZ;
+		l.DE[k] *= factor;
+	}
+
+	if (hot.mboxMainRotationEnabled)
+	{
+		for (int k = 0; k < n; k++)
+			BatchRotate(hot.mboxMainRot, l.x[k], l.y[k], l.z[k]);
+	}
+
+	for (int k = 0; k < n; k++)
+	{
+		l.x[k] *= scale;
+		l.y[k] *= scale;
+		l.z[k] *= scale;
+		l.DE[k] = l.DE[k] * fabsScale + T(1.0);
+	}
+}
+
+template <fractal::enumCalculationMode Mode, typename T>
+static void ComputeBatchLanes(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, const CVector3 *pointsLow, int n, sFractalOut *outs)
+{
+	sComputeBatchLanes<T> l;
+
+	int sequence = (in.forcedFormulaIndex >= 0) ? in.forcedFormulaIndex : 0;
+	const sFormulaHotParams &hot = fractals.GetHotParams(sequence);
+	const enumFractalFormula formula = hot.formula;
+	const T w = fractals.GetInitialWAxis(sequence);
+	const double bailout = hot.bailout;
+	const int ops = hot.iterationOps.ops;
+	const bool addCConstant = ops & (iterationOpAddC | iterationOpAddJuliaC);
+	const bool juliaEnabled = ops & iterationOpAddJuliaC;
+	const CVector3 constantMultiplier = hot.iterationOps.multiplier;
+	const CVector3 juliaC = hot.iterationOps.juliaC;
+	const bool checkForBailout = hot.checkForBailout;
+
+	for (int k = 0; k < n; k++)
+	{
+		BatchInitPoint(l, k, in, points[k], pointsLow ? &pointsLow[k] : NULL);
+		l.lastX[k] = l.lastY[k] = l.lastZ[k] = 0.0;
+		l.r_dz[k] = 1.0;
+		l.DE[k] = 1.0;
+		l.orbitTrapTotal[k] = 0.0;
+		l.active[k] = true;
+		outs[k].maxiter = in.common.iterThreshMode;
+		outs[k].iters = in.maxN;
+	}
+
+	int activeCount = n;
+
+	for (int i = 0; i < in.maxN && activeCount > 0; i++)
+	{
+		for (int k = 0; k < n; k++)
 		{
-			z = lastZ;
-			r = z.Length();
-			w = 0.0;
-			out->maxiter = true;
-			break;
+			l.lastX[k] = l.x[k];
+			l.lastY[k] = l.y[k];
+			l.lastZ[k] = l.z[k];
 		}
 
-		// escape conditions
-		if (fractals.IsCheckForBailout(sequence))
+		// foldings
+		if (in.common.foldings.boxEnable) BatchBoxFolding(l, n, in.common.foldings);
+		if (in.common.foldings.sphericalEnable) BatchSphericalFolding(l, n, in.common.foldings);
+
+		// formula
+		if (formula == mandelbulb)
+			BatchMandelbulbIteration(l, n, hot);
+		else
+			BatchMandelboxIteration(l, n, hot);
+
+		// addition of constant
+		if (addCConstant)
 		{
-			if (Mode == calcModeNormal)
+			const T juliaX = juliaC.x;
+			const T juliaY = juliaC.y;
+			const T juliaZ = juliaC.z;
+			const T multiplierX = constantMultiplier.x;
+			const T multiplierY = constantMultiplier.y;
+			const T multiplierZ = constantMultiplier.z;
+			if (juliaEnabled)
 			{
-				if (r > fractals.GetBailout(sequence))
-				{
-					out->maxiter = false;
-					break;
-				}
-
-				if ((z - lastZ).Length() / r < 0.1 / fractals.GetBailout(sequence))
+				for (int k = 0; k < n; k++)
 				{
-					out->maxiter = false;
-					break;
+					l.x[k] += juliaX;
+					l.y[k] += juliaY;
+					l.z[k] += juliaZ;
 				}
 			}
-			else if (Mode == calcModeDeltaDE1)
+			else
 			{
-				if (r > fractals.GetBailout(sequence))
-				{
-					out->maxiter = false;
-					break;
-				}
-
-				if ((z - lastZ).Length() / r < 0.1 / fractals.GetBailout(sequence))
+				for (int k = 0; k < n; k++)
 				{
-					out->maxiter = false;
-					break;
+					l.x[k] += l.cx[k] * multiplierX;
+					l.y[k] += l.cy[k] * multiplierY;
+					l.z[k] += l.cz[k] * multiplierZ;
 				}
 			}
-			else if (Mode == calcModeDeltaDE2)
+		}
+
+		// r calculation
+		for (int k = 0; k < n; k++)
+			l.r[k] = sqrt(l.x[k] * l.x[k] + l.y[k] * l.y[k] + l.z[k] * l.z[k] + w * w);
+
+		// escaped lanes are frozen with masked select
+		for (int k = 0; k < n; k++)
+		{
+			const bool active = l.active[k];
+			l.x[k] = active ? l.x[k] : l.escapedX[k];
+			l.y[k] = active ? l.y[k] : l.escapedY[k];
+			l.z[k] = active ? l.z[k] : l.escapedZ[k];
+			l.r[k] = active ? l.r[k] : l.escapedR[k];
+			l.r_dz[k] = active ? l.r_dz[k] : l.escapedRdz[k];
+			l.DE[k] = active ? l.DE[k] : l.escapedDE[k];
+		}
+
+		// escape conditions are checked separately for each lane
+		for (int k = 0; k < n; k++)
+		{
+			if (!l.active[k]) continue;
+
+			CVector3 z(LaneToDouble(l.x[k]), LaneToDouble(l.y[k]), LaneToDouble(l.z[k]));
+			CVector3 lastZ(
+				LaneToDouble(l.lastX[k]), LaneToDouble(l.lastY[k]), LaneToDouble(l.lastZ[k]));
+			double r = LaneToDouble(l.r[k]);
+			bool finished = false;
+
+			// the same as detection of dead computation in Compute(), which is done just after
+			// iteration of the formula
+			if (z.IsNotANumber())
 			{
-				if (i == in.maxN) break;
+				l.x[k] = l.lastX[k];
+				l.y[k] = l.lastY[k];
+				l.z[k] = l.lastZ[k];
+				l.r[k] = lastZ.Length();
+				outs[k].maxiter = true;
+				finished = true;
 			}
-			else if (Mode == calcModeColouring)
+			else if (checkForBailout)
 			{
-				double len = 0.0;
-				switch (in.fractalColoring.coloringAlgorithm)
+				if (Mode == calcModeOrbitTrap)
 				{
-					case sFractalColoring::fractalColoringStandard:
-					{
-						len = r;
-						break;
-					}
-					case sFractalColoring::fractalColoringZDotPoint:
-					{
-						len = fabs(z.Dot(in.point));
-						break;
-					}
-					case sFractalColoring::fractalColoringSphere:
-					{
-						len = fabs((z - in.point).Length() - in.fractalColoring.sphereRadius);
-						break;
-					}
-					case sFractalColoring::fractalColoringCross:
-					{
-						len = dMin(fabs(z.x), fabs(z.y), fabs(z.z));
-						break;
-					}
-					case sFractalColoring::fractalColoringLine:
-					{
-						len = fabs(z.Dot(in.fractalColoring.lineDirection));
-						break;
-					}
-					case sFractalColoring::fractalColoringNone:
-					{
-						len = r;
-						break;
-					}
+					// the same escape condition as in Compute<calcModeOrbitTrap>()
+					double distance = (z - in.common.fakeLightsOrbitTrap).Length();
+					if (i >= in.common.fakeLightsMinIter && i <= in.common.fakeLightsMaxIter)
+						l.orbitTrapTotal[k] += (1.0f / (distance * distance));
+					if (distance > 1000) finished = true;
 				}
-				if (fractal->formula != mandelbox
-						|| in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+				else if (r > bailout || (z - lastZ).Length() / r < 0.1 / bailout)
 				{
-					if (len < minimumR) minimumR = len;
+					outs[k].maxiter = false;
+					finished = true;
 				}
-				if (r > 1e15 || (z - lastZ).Length() / r < 1e-15) break;
 			}
-			else if (Mode == calcModeOrbitTrap)
+
+			if (finished)
 			{
-				CVector3 delta = z - in.common.fakeLightsOrbitTrap;
-				double distance = delta.Length();
-				if (i >= in.common.fakeLightsMinIter && i <= in.common.fakeLightsMaxIter)
-					orbitTrapTotal += (1.0f / (distance * distance));
-				if (distance > 1000)
-				{
-					out->orbitTrapR = orbitTrapTotal;
-					break;
-				}
+				l.active[k] = false;
+				l.escapedX[k] = l.x[k];
+				l.escapedY[k] = l.y[k];
+				l.escapedZ[k] = l.z[k];
+				l.escapedR[k] = l.r[k];
+				l.escapedRdz[k] = l.r_dz[k];
+				l.escapedDE[k] = l.DE[k];
+				outs[k].iters = i;
+				activeCount--;
 			}
 		}
-
-		if (z.IsNotANumber()) // detection of dead computation
-		{
-			// if(Mode != calcModeColouring)
-			// qWarning() << "Dead computation\n"
-			//		<< "iteration: " << i << "Formula:" << formula << "Sequence:" << sequence
-			//		<< "\nPoint:" << in.point.Debug()
-			//		<< "\nLast good z:" << lastGoodZ.Debug()
-			//		<< "\nPrevious z:" << lastZ.Debug();
-			z = lastGoodZ;
-			break;
-		}
 	}
 
 	// final calculations
-	if (Mode == calcModeNormal)
+	for (int k = 0; k < n; k++)
 	{
-		if (fractals.IsHybrid())
+		// iteration loop ended without break
+		if (l.active[k]) outs[k].iters = in.maxN;
+
+		double r = LaneToDouble(l.r[k]);
+		if (Mode == calcModeNormal)
 		{
-			if (extendedAux.r_dz > 0)
+			if (formula == mandelbulb)
 			{
-				if (fractals.GetDEFunctionType(0) == fractal::linearDEFunction)
-				{
-					out->distance = r / fabs(extendedAux.DE);
-				}
-				else if (fractals.GetDEFunctionType(0) == fractal::logarithmicDEFunction)
-				{
-					out->distance = 0.5 * r * log(r) / extendedAux.r_dz;
-				}
-				else if (fractals.GetDEFunctionType(0) == fractal::pseudoKleinianDEFunction)
-				{
-					double rxy = sqrt(z.x * z.x + z.y * z.y);
-					out->distance = max(rxy - 0.92784, fabs(rxy * z.z) / r) / (extendedAux.DE);
-				}
+				double r_dz = LaneToDouble(l.r_dz[k]);
+				outs[k].distance = (r_dz > 0) ? 0.5 * r * log(r) / r_dz : r;
 			}
 			else
 			{
-				out->distance = r;
+				double DE = LaneToDouble(l.DE[k]);
+				outs[k].distance = (DE > 0) ? r / fabs(DE) : r;
 			}
 		}
 		else
 		{
-			switch (formula)
-			{
-				case benesi:
-				case benesiPineTree:
-				case benesiT1PineTree:
-				case benesiPwr2s:
-				case bristorbrot:
-				case bristorbrot4D:
-				case buffalo:
-				case eiffieMsltoe:
-				case fast_mandelbulb_power2:
-				case hypercomplex:
-				case iqBulb:
-				case mandelbulb:
-				case mandelbulb2:
-				case mandelbulb3:
-				case mandelbulb4:
-				case mandelbulbBermarte:
-				case mandelbulbKali:
-				case mandelbulbKaliMulti:
-				case mandelbulbMulti:
-				case mandelbulbVaryPowerV1:
-				case msltoesym2Mod:
-				case msltoesym3Mod:
-				case msltoesym3Mod2:
-				case msltoesym3Mod3:
-				case msltoesym4Mod:
-				case msltoeToroidal:			// TODO fix??
-				case msltoeToroidalMulti: // TODO fix??
-				case quaternion:
-				case transfQuaternionFold: // hmmm, this issue again
-				case quaternion3D:
-				case xenodreambuie:
-				{
-					if (extendedAux.r_dz > 0)
-						out->distance = 0.5 * r * log(r) / extendedAux.r_dz;
-					else
-						out->distance = r;
-					break;
-				}
-				case mandelbox:
-				case mandelboxMenger:
-				case smoothMandelbox:
-				case mandelboxVaryScale4D:
-				case generalizedFoldBox:
-				case foldBoxMod1:
-				case aboxModKali:
-				case aboxModKaliEiffie:
-				case aboxMod1:
-				case aboxMod2:
-				case amazingSurf:
-				case amazingSurfMod1:
-				case amazingSurfMulti:
-				case kalisets1:
-				case aboxVSIcen1:
-				case pseudoKleinian1:
-				{
-					if (extendedAux.DE > 0)
-						out->distance = r / fabs(extendedAux.DE);
-					else
-						out->distance = r;
-					break;
-				}
-				case kaleidoscopicIFS:
-				case menger_sponge:
-				case mengerCrossKIFS:
-				case mengerCrossMod1:
-				case mengerPrismShape:
-				case mengerPrismShape2:
-				case collatz:
-				case collatzMod:
-				case mengerMod1:
-				case mengerMiddleMod:
-				case transfMengerFold: // hmmm, this issue again
-				case mengerPwr2Poly:
-				case mixPinski4D:
-				case sierpinski4D:
-				case sierpinski3D:
-				case menger4D:
-				{
-					if (extendedAux.DE > 0)
-						out->distance = (r - 2.0) / (extendedAux.DE);
-					else
-						out->distance = r;
-					break;
-				}
-				case pseudoKleinian2:
-				case pseudoKleinian3:
-				{
-					if (extendedAux.DE > 0)
-					{
-						double rxy = sqrt(z.x * z.x + z.y * z.y);
-						out->distance = max(rxy - 0.92784, fabs(rxy * z.z) / r) / (extendedAux.DE);
-					}
-					else
-						out->distance = r;
-					break;
-				}
+			outs[k].distance = 0.0;
+		}
+		if (Mode == calcModeOrbitTrap) outs[k].orbitTrapR = l.orbitTrapTotal[k];
 
-				default: out->distance = -1.0; break;
-			}
+		outs[k].iters = outs[k].iters + 1;
+		outs[k].z = CVector3(LaneToDouble(l.x[k]), LaneToDouble(l.y[k]), LaneToDouble(l.z[k]));
+		outs[k].periodic = false;
+	}
+}
+
+template <fractal::enumCalculationMode Mode>
+void ComputeBatch(const cNineFractals &fractals, const sFractalIn &in, const CVector3 *points,
+	int count, sFractalOut *outs, bool singlePrecision, const CVector3 *pointsLow)
+{
+	int sequence = (in.forcedFormulaIndex >= 0) ? in.forcedFormulaIndex : 0;
+
+	// lanes don't have periodicity check, which can change results of distance modes
+	bool periodicityCheck = in.common.periodicityCheck && Mode != calcModeOrbitTrap;
+	if (!periodicityCheck && ComputeBatchVectorizable<Mode>(fractals, sequence))
+	{
+		bool doubleDouble = pointsLow && ComputeBatchDoubleDoubleCapable(fractals, in, sequence);
+		for (int first = 0; first < count; first += COMPUTE_BATCH_LANES)
+		{
+			int n = min(COMPUTE_BATCH_LANES, count - first);
+			if (doubleDouble)
+				ComputeBatchLanes<Mode, sDoubleDouble>(
+					fractals, in, &points[first], &pointsLow[first], n, &outs[first]);
+			else if (singlePrecision)
+				ComputeBatchLanes<Mode, float>(fractals, in, &points[first], NULL, n, &outs[first]);
+			else
+				ComputeBatchLanes<Mode, double>(fractals, in, &points[first], NULL, n, &outs[first]);
 		}
 	}
-	// color calculation
-	else if (Mode == calcModeColouring)
+	else
 	{
-		double mboxDE = 1.0;
-		mboxDE = extendedAux.DE;
-		double r2 = r / fabs(mboxDE);
-		if (r2 > 20) r2 = 20;
-
-		if (fractals.IsHybrid())
+		sFractalIn pointIn = in;
+		for (int k = 0; k < count; k++)
 		{
-			if (minimumR > 100) minimumR = 100;
+			pointIn.point = points[k];
+			Compute<Mode>(fractals, pointIn, &outs[k]);
+		}
+	}
+}
 
-			double mboxColor = 0.0;
+template void ComputeBatch<calcModeNormal>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
+template void ComputeBatch<calcModeDeltaDE1>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
+template void ComputeBatch<calcModeDeltaDE2>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
+template void ComputeBatch<calcModeColouring>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
+template void ComputeBatch<calcModeOrbitTrap>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
+template void ComputeBatch<calcModeCombined>(const cNineFractals &fractals, const sFractalIn &in,
+	const CVector3 *points, int count, sFractalOut *outs, bool singlePrecision,
+	const CVector3 *pointsLow);
 
-			mboxColor = extendedAux.color;
+// ---------------------------------------------------------------------------
+// delta DE calculated in one pass
+// ---------------------------------------------------------------------------
 
-			if (mboxColor > 1000) mboxColor = 1000;
+// state of one point iterated by ComputeDeltaDE()
+struct sDeltaDELane
+{
+	CVector3 z;
+	CVector3 c;
+	CVector3 lastZ;
+	CVector3 lastGoodZ;
+	double r;
+	double w;
+	sExtendedAux extendedAux;
+	int lastIteration;
+	int maxN;
+	bool active;
+	bool maxiter;
+};
 
-			out->colorIndex = minimumR * 1000.0 + mboxColor * 100 + r2 * 5000.0;
-			/*out->colorIndex =
+void ComputeDeltaDE(
+	const cNineFractals &fractals, const sFractalIn &in, double delta, sFractalOut *outs)
+{
+	const CVector3 shifts[DELTA_DE_POINTS] = {CVector3(0.0, 0.0, 0.0), CVector3(delta, 0.0, 0.0),
+		CVector3(0.0, delta, 0.0), CVector3(0.0, 0.0, delta)};
 
-					extendedAux.color * 100.0 * extendedAux.foldFactor	 // folds part
+	int fractalIndex = 0;
+	if (in.forcedFormulaIndex >= 0) fractalIndex = in.forcedFormulaIndex;
+	const double initialW = fractals.GetInitialWAxis(fractalIndex);
+	const double actualScale = fractals.GetFractal(fractalIndex)->mandelbox.scale;
 
-					+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
+	sDeltaDELane lanes[DELTA_DE_POINTS];
+	for (int k = 0; k < DELTA_DE_POINTS; k++)
+	{
+		sDeltaDELane &lane = lanes[k];
 
-					+ 1.0 * r2 * 5000.0 // for backwards compatability
+		// repeat, move and rotate
+		CVector3 point2 = (in.point + shifts[k]).mod(in.common.repeat) - in.common.fractalPosition;
+		point2 = in.common.mRotFractalRotation.RotateVector(point2);
 
-					+ extendedAux.scaleFactor * r * i / 1e15						 // scale part conditional on i & r
-					+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
-								? minimumR * extendedAux.minRFactor * 1000.0
-								: 0.0);*/
+		lane.z = point2;
+		lane.c = point2;
+		lane.r = point2.Length();
+		lane.w = initialW;
+
+		lane.extendedAux.r_dz = 1.0;
+		lane.extendedAux.r = lane.r;
+		lane.extendedAux.color = 1.0;
+		lane.extendedAux.actualScale = actualScale;
+		lane.extendedAux.DE = 1.0;
+		lane.extendedAux.c = lane.c;
+		lane.extendedAux.cw = 0;
+		lane.extendedAux.foldFactor = 0.0;
+		lane.extendedAux.minRFactor = 0.0;
+		lane.extendedAux.scaleFactor = 0.0;
+
+		// shifted points are iterated up to the number of iterations of central point (known at the
+		// end), so the limit is the same as in case of separate calls of Compute()
+		lane.maxN = (k == 0) ? in.maxN : in.maxN + 1;
+		lane.lastIteration = lane.maxN;
+		lane.active = true;
+		lane.maxiter = in.common.iterThreshMode;
+	}
+
+	int activeCount = DELTA_DE_POINTS;
+
+	for (int i = 0; activeCount > 0; i++)
+	{
+		// hybrid fractal sequence is common for all points
+		int sequence;
+		if (in.forcedFormulaIndex >= 0)
+		{
+			sequence = in.forcedFormulaIndex;
 		}
 		else
 		{
-			switch (formula)
-			{
-				case mandelbox:
-				case smoothMandelbox:
-				case mandelboxVaryScale4D:
-				case generalizedFoldBox:
-
-				case foldBoxMod1:
-					out->colorIndex =
-						extendedAux.color * 100.0														 // folds part
-						+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
-						+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
-									? minimumR * 1000.0
-									: 0.0);
-					break;
+			sequence = fractals.GetSequence(i);
+		}
+		const sFormulaHotParams &hot = fractals.GetHotParams(sequence);
+		const bool checkForBailout = hot.checkForBailout;
+		const double bailout = hot.bailout;
 
-				case mengerMod1:
-				case aboxModKali:
-				case aboxMod1:
-				case menger_sponge:
-				case collatz:
-				case collatzMod:
-				case kaleidoscopicIFS:
-				case mengerPwr2Poly:
-				case mengerMiddleMod: out->colorIndex = minimumR * 1000.0; break;
-
-				case amazingSurf: out->colorIndex = minimumR * 200.0; break;
-
-				case amazingSurfMulti:
-				case mandelboxMenger:
-				case amazingSurfMod1:
-				case aboxModKaliEiffie:
-					out->colorIndex =
-						extendedAux.color * 100.0 * extendedAux.foldFactor	 // folds part
-						+ r * defaultFractal->mandelbox.color.factorR / 1e13 // abs z part
-						+ extendedAux.scaleFactor * r2 * 5000.0							 // for backwards compatability
-						//+ extendedAux.scaleFactor * r * i / 1e15						 // scale part conditional on i &
-						// r
-						+ ((in.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
-									? minimumR * extendedAux.minRFactor * 1000.0
-									: 0.0);
-					break;
+		for (int k = 0; k < DELTA_DE_POINTS; k++)
+		{
+			sDeltaDELane &lane = lanes[k];
+			if (!lane.active) continue;
+
+			bool finished = false;
+
+			if (i >= lane.maxN)
+			{
+				lane.lastIteration = lane.maxN;
+				lane.active = false;
+				activeCount--;
+				continue;
+			}
 
-				case msltoeDonut: out->colorIndex = extendedAux.color * 2000.0 / i; break;
+			lane.lastGoodZ = lane.lastZ;
+			lane.lastZ = lane.z;
 
-				default: out->colorIndex = minimumR * 5000.0; break;
+			IterateFormula<-1>(
+				fractals, in, i, sequence, lane.z, lane.w, lane.r, lane.c, lane.extendedAux);
+
+			if (lane.z.IsNotANumber())
+			{
+				lane.z = lane.lastZ;
+				lane.r = lane.z.Length();
+				lane.w = 0.0;
+				lane.maxiter = true;
+				finished = true;
+			}
+			else if (checkForBailout)
+			{
+				if (lane.r > bailout || (lane.z - lane.lastZ).Length() / lane.r < 0.1 / bailout)
+				{
+					lane.maxiter = false;
+					finished = true;
+				}
+			}
+
+			if (finished)
+			{
+				lane.lastIteration = i;
+				lane.active = false;
+				activeCount--;
+			}
+
+			// number of iterations for shifted points is limited by central point
+			if (k == 0 && !lane.active)
+			{
+				for (int m = 1; m < DELTA_DE_POINTS; m++)
+					lanes[m].maxN = lane.lastIteration + 1;
 			}
 		}
 	}
-	else
+
+	for (int k = 0; k < DELTA_DE_POINTS; k++)
 	{
-		out->distance = 0.0;
+		outs[k].distance = 0.0;
+		outs[k].colorIndex = 0.0;
+		outs[k].maxiter = lanes[k].maxiter;
+		outs[k].iters = lanes[k].lastIteration + 1;
+		outs[k].z = lanes[k].z;
+		outs[k].periodic = false;
 	}
-
-	out->iters = i + 1;
-	out->z =  z;// CVector3( z.x, z.y, w);// z;
-	// tim = rdtsc() - tim; perf+= tim; perfCount++; outStream << (double)perf/perfCount - 560.0 <<
-	// endl;
-	//------------- 3249 ns for all calculation  ----------------
 }
-
-template void Compute<calcModeNormal>(
-	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
-template void Compute<calcModeDeltaDE1>(
-	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
-template void Compute<calcModeDeltaDE2>(
-	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
-template void Compute<calcModeColouring>(
-	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
-template void Compute<calcModeOrbitTrap>(
-	const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
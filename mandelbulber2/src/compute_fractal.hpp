@@ -42,16 +42,18 @@
 // forward declarations
 class cNineFractals;
 
+// common parameters and colouring are not copied. They are immutable parameters of the job (from
+// cParamRender and materials) which have to live longer than the structure
 struct sFractalIn
 {
 	CVector3 point;
 	int minN;
 	int maxN;
-	sCommonParams common;
+	const sCommonParams &common;
 	int forcedFormulaIndex;
-	sFractalColoring fractalColoring;
+	const sFractalColoring &fractalColoring;
 	sFractalIn(CVector3 _point, int _minN, int _maxN, const sCommonParams &_common,
-		int _forcedFormulaIndex, const sFractalColoring &_fractalColoring = sFractalColoring())
+		int _forcedFormulaIndex, const sFractalColoring &_fractalColoring = noColoring)
 			: point(_point),
 				minN(_minN),
 				maxN(_maxN),
@@ -60,6 +62,9 @@ struct sFractalIn
 				fractalColoring(_fractalColoring)
 	{
 	}
+
+	// default colouring when it's not needed by calculation mode
+	static const sFractalColoring noColoring;
 };
 
 struct sFractalOut
@@ -71,9 +76,43 @@ struct sFractalOut
 	double orbitTrapR;
 	int iters;
 	bool maxiter;
+	bool periodic; // iterations were stopped because orbit is periodic
 };
 
+// maximum number of formulas in hybrid sequence handled by specialized kernels
+#define COMPUTE_KERNEL_FORMULAS 3
+
 template <fractal::enumCalculationMode Mode>
 void Compute(const cNineFractals &fractals, const sFractalIn &in, sFractalOut *out);
 
+// selects kernel specialized for formulas used by the fractal (done once at job start).
+// Returns -1 if there is no specialized kernel and generic code has to be used
+int SelectComputeKernel(const cNineFractals &fractals);
+
+// selects iteration function specialized for the formula (done once at job start for every
+// hybrid slot). Returns -1 if formula has to be calculated by generic code
+int SelectIterateFunction(int formula);
+
+// calculates many points at once. in.point is ignored, all other input data is common for all
+// points. Selected formulas are calculated in SoA layout, other ones use Compute().
+// With singlePrecision the SoA path uses float numbers. If pointsLow (low parts of points
+// beyond double precision) is not NULL, the SoA path uses double-double numbers where possible
+template <fractal::enumCalculationMode Mode>
+void ComputeBatch(const cNineFractals &fractals, const sFractalIn &in, const CVector3 *points,
+	int count, sFractalOut *outs, bool singlePrecision = false, const CVector3 *pointsLow = NULL);
+
+// minimum ratio of detail size to distance from the origin for which single precision is enough
+#define SINGLE_PRECISION_LIMIT 1e-4
+
+// ratio of detail size to distance from the origin below which double-double numbers are used
+#define DOUBLE_DOUBLE_PRECISION_LIMIT 1e-12
+
+// number of points calculated by ComputeDeltaDE()
+#define DELTA_DE_POINTS 4
+
+// calculates in one pass the point and three points shifted by delta along x, y and z axis
+// (calcModeDeltaDE1). outs[0] is for the central point
+void ComputeDeltaDE(
+	const cNineFractals &fractals, const sFractalIn &in, double delta, sFractalOut *outs);
+
 #endif /* MANDELBULBER2_SRC_COMPUTE_FRACTAL_HPP_ */
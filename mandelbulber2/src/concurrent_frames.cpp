@@ -0,0 +1,181 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cConcurrentFrames class - rendering of many small animation frames at the same time
+ */
+
+#include "concurrent_frames.hpp"
+
+#include "cimage.hpp"
+#include "global_data.hpp"
+#include "image_save_queue.hpp"
+#include "netrender.hpp"
+#include "rendering_configuration.hpp"
+#include "system.hpp"
+
+cConcurrentFrameWorker::cConcurrentFrameWorker(cConcurrentFrames *_owner, int _slot) : QObject()
+{
+	owner = _owner;
+	slot = _slot;
+}
+
+void cConcurrentFrameWorker::slotRender()
+{
+	owner->RenderSlot(slot);
+}
+
+cConcurrentFrames::cConcurrentFrames(
+	int _numberOfSlots, int _totalThreads, cRenderJob::enumMode _mode)
+		: QObject()
+{
+	numberOfSlots = qMax(1, _numberOfSlots);
+	threadsPerFrame = qMax(1, _totalThreads / numberOfSlots);
+	mode = _mode;
+	stopRequest = NULL;
+	finishedFrames = 0;
+	failed = false;
+
+	for (int i = 0; i < numberOfSlots; i++)
+	{
+		images.append(new cImage(200, 200));
+		renderJobs.append(NULL);
+
+		QThread *thread = new QThread;
+		thread->setObjectName("ConcurrentFrame #" + QString::number(i));
+		cConcurrentFrameWorker *worker = new cConcurrentFrameWorker(this, i);
+		worker->moveToThread(thread);
+		thread->start();
+		threads.append(thread);
+		workers.append(worker);
+	}
+}
+
+cConcurrentFrames::~cConcurrentFrames()
+{
+	for (int i = 0; i < numberOfSlots; i++)
+	{
+		threads[i]->quit();
+		threads[i]->wait();
+		delete workers[i];
+		delete threads[i];
+		if (renderJobs[i]) delete renderJobs[i];
+		delete images[i];
+	}
+}
+
+int cConcurrentFrames::NumberOfConcurrentFrames(const cParameterContainer *params)
+{
+	// with NetRender lines of every frame are already distributed
+	if (gNetRender->IsServer() && gNetRender->GetClientCount() > 0) return 1;
+	if (params->Get<bool>("anim_farm_mode")) return 1;
+	int frames = params->Get<int>("anim_concurrent_frames");
+	return qBound(1, frames, qMax(1, params->Get<int>("limit_CPU_cores")));
+}
+
+void cConcurrentFrames::AddFrame(const cParameterContainer &params,
+	const cFractalContainer &fractal, const QString &filename,
+	ImageFileSave::enumImageFileType fileType)
+{
+	sFrame frame;
+	frame.params = params;
+	frame.fractal = fractal;
+	frame.filename = filename;
+	frame.fileType = fileType;
+	frames.append(frame);
+}
+
+bool cConcurrentFrames::RenderFrames(bool *_stopRequest, cImageSaveQueue *saveQueue)
+{
+	if (frames.isEmpty()) return true;
+
+	stopRequest = _stopRequest;
+	mutex.lock();
+	finishedFrames = 0;
+	failed = false;
+	mutex.unlock();
+
+	for (int i = 0; i < frames.size(); i++)
+		QMetaObject::invokeMethod(workers[i], "slotRender", Qt::QueuedConnection);
+
+	// events of calling thread are still processed while frames are rendered
+	mutex.lock();
+	while (finishedFrames < frames.size())
+	{
+		frameFinished.wait(&mutex, 100);
+		mutex.unlock();
+		gApplication->processEvents();
+		mutex.lock();
+	}
+	bool result = !failed;
+	mutex.unlock();
+
+	if (result)
+	{
+		for (int i = 0; i < frames.size(); i++)
+			saveQueue->Enqueue(frames[i].filename, frames[i].fileType, images[i]);
+	}
+	frames.clear();
+	return result;
+}
+
+void cConcurrentFrames::RenderSlot(int slot)
+{
+	const sFrame &frame = frames.at(slot);
+	WriteLog("cConcurrentFrames::RenderSlot() " + frame.filename, 2);
+
+	bool result;
+	if (!renderJobs[slot])
+	{
+		renderJobs[slot] =
+			new cRenderJob(&frame.params, &frame.fractal, images[slot], stopRequest, NULL);
+
+		// concurrent frames don't refresh the main image and don't report progress
+		cRenderingConfiguration config;
+		config.DisableRefresh();
+		config.DisableProgressiveRender();
+		config.DisableNetRender();
+		config.SetThreadsLimit(threadsPerFrame);
+		result = renderJobs[slot]->Init(mode, config);
+	}
+	else
+	{
+		renderJobs[slot]->UpdateParameters(&frame.params, &frame.fractal);
+		result = true;
+	}
+
+	if (result) result = renderJobs[slot]->Execute();
+
+	mutex.lock();
+	if (!result) failed = true;
+	finishedFrames++;
+	frameFinished.wakeAll();
+	mutex.unlock();
+}
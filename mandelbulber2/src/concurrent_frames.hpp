@@ -0,0 +1,128 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cConcurrentFrames class - rendering of many small animation frames at the same time
+ *
+ * With small images the rendering threads are not saturated by one frame, so several
+ * frames are rendered concurrently. Every frame has own image, render job and share of
+ * threads. Finished frames are scheduled for saving in order of frame numbers.
+ */
+
+#ifndef MANDELBULBER2_SRC_CONCURRENT_FRAMES_HPP_
+#define MANDELBULBER2_SRC_CONCURRENT_FRAMES_HPP_
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "file_image.hpp"
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+#include "render_job.hpp"
+
+// forward declarations
+class cImage;
+class cImageSaveQueue;
+class cConcurrentFrames;
+
+// renders frames of one slot in own thread
+class cConcurrentFrameWorker : public QObject
+{
+	Q_OBJECT
+
+public:
+	cConcurrentFrameWorker(cConcurrentFrames *_owner, int _slot);
+
+public slots:
+	void slotRender();
+
+private:
+	cConcurrentFrames *owner;
+	int slot;
+};
+
+class cConcurrentFrames : public QObject
+{
+	Q_OBJECT
+
+public:
+	// _numberOfSlots - number of frames rendered at the same time
+	// _totalThreads - rendering threads shared by all frames
+	cConcurrentFrames(int _numberOfSlots, int _totalThreads, cRenderJob::enumMode _mode);
+	~cConcurrentFrames();
+
+	bool IsFull() const { return frames.size() >= numberOfSlots; }
+	bool IsEmpty() const { return frames.isEmpty(); }
+
+	// adds frame to the batch. It will be rendered by RenderFrames()
+	void AddFrame(const cParameterContainer &params, const cFractalContainer &fractal,
+		const QString &filename, ImageFileSave::enumImageFileType fileType);
+
+	// renders all collected frames concurrently and schedules them for saving in the same order
+	// as they were added. Returns false if rendering was terminated
+	bool RenderFrames(bool *stopRequest, cImageSaveQueue *saveQueue);
+
+	// concurrent rendering is used only for small images and without NetRender
+	static int NumberOfConcurrentFrames(const cParameterContainer *params);
+
+private:
+	friend class cConcurrentFrameWorker;
+
+	struct sFrame
+	{
+		cParameterContainer params;
+		cFractalContainer fractal;
+		QString filename;
+		ImageFileSave::enumImageFileType fileType;
+	};
+
+	void RenderSlot(int slot);
+
+	int numberOfSlots;
+	int threadsPerFrame;
+	cRenderJob::enumMode mode;
+	bool *stopRequest;
+
+	QList<sFrame> frames;
+	QList<cImage *> images;
+	QList<cRenderJob *> renderJobs;
+	QList<QThread *> threads;
+	QList<cConcurrentFrameWorker *> workers;
+
+	QMutex mutex;
+	QWaitCondition frameFinished;
+	int finishedFrames;
+	bool failed;
+};
+
+#endif /* MANDELBULBER2_SRC_CONCURRENT_FRAMES_HPP_ */
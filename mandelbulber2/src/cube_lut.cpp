@@ -0,0 +1,124 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCubeLUT class - colours of directions stored on faces of a cube
+ */
+
+#include "cube_lut.hpp"
+
+#include <cmath>
+
+cCubeLUT::cCubeLUT()
+{
+	size = 0;
+}
+
+void cCubeLUT::Resize(int _size)
+{
+	size = _size;
+	texels.fill(sRGBAfloat(), 6 * size * size);
+}
+
+// faces: 0 = +x, 1 = -x, 2 = +y, 3 = -y, 4 = +z, 5 = -z. Coordinates u, v are in range -1..1
+CVector3 cCubeLUT::Direction(int face, int x, int y) const
+{
+	double u = (x + 0.5) / size * 2.0 - 1.0;
+	double v = (y + 0.5) / size * 2.0 - 1.0;
+	switch (face)
+	{
+		case 0: return CVector3(1.0, u, v);
+		case 1: return CVector3(-1.0, u, v);
+		case 2: return CVector3(u, 1.0, v);
+		case 3: return CVector3(u, -1.0, v);
+		case 4: return CVector3(u, v, 1.0);
+		default: return CVector3(u, v, -1.0);
+	}
+}
+
+sRGBAfloat cCubeLUT::Get(const CVector3 &direction) const
+{
+	double ax = fabs(direction.x);
+	double ay = fabs(direction.y);
+	double az = fabs(direction.z);
+
+	int face;
+	double u, v;
+	if (ax >= ay && ax >= az)
+	{
+		if (ax == 0.0) return Texel(0, 0, 0);
+		face = (direction.x > 0.0) ? 0 : 1;
+		u = direction.y / ax;
+		v = direction.z / ax;
+	}
+	else if (ay >= az)
+	{
+		face = (direction.y > 0.0) ? 2 : 3;
+		u = direction.x / ay;
+		v = direction.z / ay;
+	}
+	else
+	{
+		face = (direction.z > 0.0) ? 4 : 5;
+		u = direction.x / az;
+		v = direction.y / az;
+	}
+
+	// texel coordinates clamped to the face
+	double fx = (u + 1.0) * 0.5 * size - 0.5;
+	double fy = (v + 1.0) * 0.5 * size - 0.5;
+	if (fx < 0.0) fx = 0.0;
+	if (fy < 0.0) fy = 0.0;
+	if (fx > size - 1) fx = size - 1;
+	if (fy > size - 1) fy = size - 1;
+
+	int x1 = (int)fx;
+	int y1 = (int)fy;
+	int x2 = (x1 < size - 1) ? x1 + 1 : x1;
+	int y2 = (y1 < size - 1) ? y1 + 1 : y1;
+	float kx = fx - x1;
+	float ky = fy - y1;
+
+	const sRGBAfloat &c11 = Texel(face, x1, y1);
+	const sRGBAfloat &c21 = Texel(face, x2, y1);
+	const sRGBAfloat &c12 = Texel(face, x1, y2);
+	const sRGBAfloat &c22 = Texel(face, x2, y2);
+
+	sRGBAfloat colour;
+	colour.R =
+		(c11.R * (1.0f - kx) + c21.R * kx) * (1.0f - ky) + (c12.R * (1.0f - kx) + c22.R * kx) * ky;
+	colour.G =
+		(c11.G * (1.0f - kx) + c21.G * kx) * (1.0f - ky) + (c12.G * (1.0f - kx) + c22.G * kx) * ky;
+	colour.B =
+		(c11.B * (1.0f - kx) + c21.B * kx) * (1.0f - ky) + (c12.B * (1.0f - kx) + c22.B * kx) * ky;
+	colour.A =
+		(c11.A * (1.0f - kx) + c21.A * kx) * (1.0f - ky) + (c12.A * (1.0f - kx) + c22.A * kx) * ky;
+	return colour;
+}
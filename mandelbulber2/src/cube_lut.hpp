@@ -0,0 +1,82 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cCubeLUT class - colours of directions stored on faces of a cube
+ *
+ * Background and environment map depend only on the direction of the ray. They
+ * are evaluated once for every texel of six cube faces and later looked up
+ * with bilinear interpolation, which needs no trigonometric functions. Key
+ * describes the source parameters, so the table can be kept between frames.
+ */
+
+#ifndef MANDELBULBER2_SRC_CUBE_LUT_HPP_
+#define MANDELBULBER2_SRC_CUBE_LUT_HPP_
+
+#include <QString>
+#include <QVector>
+
+#include "algebra.hpp"
+#include "color_structures.hpp"
+
+class cCubeLUT
+{
+public:
+	cCubeLUT();
+
+	// allocates faces of size x size texels
+	void Resize(int _size);
+	int GetSize() const { return size; }
+
+	// direction of centre of texel
+	CVector3 Direction(int face, int x, int y) const;
+	void Set(int face, int x, int y, const sRGBAfloat &colour)
+	{
+		texels[(face * size + y) * size + x] = colour;
+	}
+
+	// bilinear interpolation of colour in given direction (doesn't need to be normalized)
+	sRGBAfloat Get(const CVector3 &direction) const;
+
+	const QString &GetKey() const { return key; }
+	void SetKey(const QString &_key) { key = _key; }
+
+private:
+	const sRGBAfloat &Texel(int face, int x, int y) const
+	{
+		return texels[(face * size + y) * size + x];
+	}
+
+	QVector<sRGBAfloat> texels;
+	int size;
+	QString key;
+};
+
+#endif /* MANDELBULBER2_SRC_CUBE_LUT_HPP_ */
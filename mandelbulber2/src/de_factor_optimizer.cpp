@@ -0,0 +1,282 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDEFactorOptimizer class - search of optimal DE factor with sparse rays
+ */
+
+#include "de_factor_optimizer.hpp"
+
+#include "calculate_distance.hpp"
+#include "camera_target.hpp"
+#include "fractal_container.hpp"
+#include "fractparams.hpp"
+#include "nine_fractals.hpp"
+#include "parameters.hpp"
+#include "projection_3d.hpp"
+#include "random.hpp"
+#include "system.hpp"
+
+// DE factor of reference march. It is small enough to not overstep surface of typical fractal
+static const double referenceDEFactor = 0.2;
+
+cDEFactorOptimizer::cDEFactorOptimizer(
+	const cParameterContainer *par, const cFractalContainer *fractal)
+{
+	params = new cParamRender(par);
+	fractals = new cNineFractals(fractal, par);
+
+	// distance threshold is the same as in full resolution image
+	params->resolution = 1.0 / par->Get<int>("image_height");
+	double aspectRatio = double(par->Get<int>("image_width")) / par->Get<int>("image_height");
+	if (params->perspectiveType == params::perspEquirectangular) aspectRatio = 2.0;
+
+	referenceReady = false;
+	numberOfHits = 0;
+	numberOfCandidates = 0;
+
+	// stratified directions: one jittered ray in every cell of grid with image proportions
+	CRotationMatrix mRot;
+	cCameraTarget cameraTarget(params->camera, params->target, params->topVector);
+	CVector3 viewAngle = cameraTarget.GetRotation();
+	mRot.RotateZ(viewAngle.x);
+	mRot.RotateX(viewAngle.y);
+	mRot.RotateY(viewAngle.z);
+
+	int gridHeight = qMax(1, int(sqrt(DE_OPTIMIZER_RAYS / aspectRatio)));
+	int gridWidth = qMax(1, int(DE_OPTIMIZER_RAYS / gridHeight));
+
+	cRandom random;
+	random.Initialize(1);
+	rays.resize(gridWidth * gridHeight);
+	for (int y = 0; y < gridHeight; y++)
+	{
+		for (int x = 0; x < gridWidth; x++)
+		{
+			CVector2<double> imagePoint;
+			imagePoint.x = ((x + random.DoubleRandom(0.0, 1.0)) / gridWidth - 0.5) * aspectRatio;
+			imagePoint.y = (y + random.DoubleRandom(0.0, 1.0)) / gridHeight - 0.5;
+			CVector3 direction =
+				CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+			direction.Normalize();
+			rays[y * gridWidth + x].direction = direction;
+		}
+	}
+}
+
+cDEFactorOptimizer::~cDEFactorOptimizer()
+{
+	delete params;
+	delete fractals;
+}
+
+double cDEFactorOptimizer::CalcDistThresh(CVector3 point) const
+{
+	double distThresh;
+	if (params->constantDEThreshold)
+		distThresh = params->DEThresh;
+	else
+		distThresh =
+			(params->camera - point).Length() * params->resolution * params->fov / params->detailLevel;
+	if (params->perspectiveType == params::perspEquirectangular
+			|| params->perspectiveType == params::perspFishEye
+			|| params->perspectiveType == params::perspFishEyeCut)
+		distThresh *= M_PI;
+	return distThresh;
+}
+
+bool cDEFactorOptimizer::March(
+	const CVector3 &direction, double DEFactor, double *depth, bool *overstep, bool *stop) const
+{
+	// the same stepping as in cRenderWorker::RayMarchingStep(), but without random jitter
+	const int maxSteps = 10000;
+	double thresholdFactor = params->interiorMode ? 0.8 : 0.5;
+	double scan = params->viewDistanceMin;
+	*overstep = false;
+
+	for (int i = 0; i < maxSteps; i++)
+	{
+		if ((i & 255) == 255 && (*stop || systemData.globalStopRequest)) return false;
+
+		CVector3 point = params->camera + direction * scan;
+		double distThresh = CalcDistThresh(point);
+		sDistanceIn in(point, distThresh, false);
+		sDistanceOut out;
+		double dist = CalculateDistance(*params, *fractals, in, &out);
+		if (dist > 3.0) dist = 3.0;
+
+		if (dist < distThresh)
+		{
+			*overstep = dist < 0.1 * distThresh;
+			*depth = scan;
+			return true;
+		}
+
+		scan += (dist - thresholdFactor * distThresh) * DEFactor;
+		if (scan > params->viewDistanceMax) break;
+	}
+	*depth = scan;
+	return false;
+}
+
+bool cDEFactorOptimizer::PrepareReference(bool *stopRequest)
+{
+	if (referenceReady) return true;
+
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < rays.size(); i++)
+	{
+		if (*stopRequest) continue;
+		sRay &ray = rays[i];
+		bool overstep;
+		ray.hit = March(ray.direction, referenceDEFactor, &ray.depth, &overstep, stopRequest);
+		ray.distThresh = CalcDistThresh(params->camera + ray.direction * ray.depth);
+	}
+	if (*stopRequest || systemData.globalStopRequest) return false;
+
+	numberOfHits = 0;
+	for (int i = 0; i < rays.size(); i++)
+		if (rays[i].hit) numberOfHits++;
+
+	referenceReady = true;
+	WriteLogDouble("cDEFactorOptimizer: reference rays hitting the surface", numberOfHits, 2);
+	return true;
+}
+
+double cDEFactorOptimizer::MissedDEPercentage(double DEFactor, bool *stopRequest)
+{
+	if (!PrepareReference(stopRequest)) return -1.0;
+	numberOfCandidates++;
+
+	QVector<char> missed(rays.size(), 0);
+#pragma omp parallel for schedule(dynamic, 16)
+	for (int i = 0; i < rays.size(); i++)
+	{
+		if (*stopRequest) continue;
+		const sRay &ray = rays[i];
+		double depth;
+		bool overstep;
+		bool hit = March(ray.direction, DEFactor, &depth, &overstep, stopRequest);
+
+		// surface is accepted a little behind reference hit, because threshold grows with distance
+		if (hit && overstep)
+			missed[i] = 1;
+		else if (ray.hit && (!hit || depth > ray.depth + 2.0 * ray.distThresh))
+			missed[i] = 1;
+	}
+	if (*stopRequest || systemData.globalStopRequest) return -1.0;
+
+	int count = 0;
+	for (int i = 0; i < missed.size(); i++)
+		count += missed[i];
+	return double(count) / rays.size() * 100.0;
+}
+
+double cDEFactorOptimizer::Optimize(double qualityTarget, bool *stopRequest, double *missedDE)
+{
+	numberOfCandidates = 0;
+
+	// bracketing of the searched factor. Factor 'good' meets the target, factor 'bad' doesn't
+	double good = 0.0;
+	double bad = 0.0;
+	double goodMissed = 0.0;
+	double factor = 1.0;
+	double missed = MissedDEPercentage(factor, stopRequest);
+	if (missed < 0.0) return -1.0;
+
+	if (missed < qualityTarget)
+	{
+		good = factor;
+		goodMissed = missed;
+		while (factor < 10000.0)
+		{
+			factor *= 2.0;
+			missed = MissedDEPercentage(factor, stopRequest);
+			if (missed < 0.0) return -1.0;
+			if (missed >= qualityTarget)
+			{
+				bad = factor;
+				break;
+			}
+			good = factor;
+			goodMissed = missed;
+		}
+		// even the biggest factor is accurate enough
+		if (bad == 0.0)
+		{
+			if (missedDE) *missedDE = goodMissed;
+			return good;
+		}
+	}
+	else
+	{
+		bad = factor;
+		while (factor > 0.001)
+		{
+			factor *= 0.5;
+			missed = MissedDEPercentage(factor, stopRequest);
+			if (missed < 0.0) return -1.0;
+			if (missed < qualityTarget)
+			{
+				good = factor;
+				goodMissed = missed;
+				break;
+			}
+			bad = factor;
+		}
+		// the target cannot be reached
+		if (good == 0.0)
+		{
+			if (missedDE) *missedDE = missed;
+			return factor;
+		}
+	}
+
+	// bisection in logarithmic scale until the factor is known with 5% precision
+	while (bad / good > 1.05)
+	{
+		factor = sqrt(good * bad);
+		missed = MissedDEPercentage(factor, stopRequest);
+		if (missed < 0.0) return -1.0;
+		if (missed < qualityTarget)
+		{
+			good = factor;
+			goodMissed = missed;
+		}
+		else
+		{
+			bad = factor;
+		}
+	}
+
+	WriteLogDouble("cDEFactorOptimizer: optimal DE factor", good, 2);
+	if (missedDE) *missedDE = goodMissed;
+	return good;
+}
@@ -0,0 +1,102 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDEFactorOptimizer class - search of optimal DE factor with sparse rays
+ *
+ * Instead of rendering of whole images, a few thousand stratified rays are
+ * marched with each candidate DE factor and results are compared with reference
+ * march done with small DE factor. Ray is wrong if the surface was overstepped
+ * or found behind the reference hit. The biggest factor which gives less wrong
+ * rays than requested is found with bisection.
+ */
+
+#ifndef MANDELBULBER2_SRC_DE_FACTOR_OPTIMIZER_HPP_
+#define MANDELBULBER2_SRC_DE_FACTOR_OPTIMIZER_HPP_
+
+#include <QVector>
+
+#include "algebra.hpp"
+
+// number of rays (approximately) used to test every DE factor
+#define DE_OPTIMIZER_RAYS 2048
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+class cParamRender;
+class cNineFractals;
+
+class cDEFactorOptimizer
+{
+public:
+	cDEFactorOptimizer(const cParameterContainer *par, const cFractalContainer *fractal);
+	~cDEFactorOptimizer();
+
+	// finds the biggest DE factor which gives less than qualityTarget percent of wrong rays.
+	// Returns -1 if optimization was stopped
+	double Optimize(double qualityTarget, bool *stopRequest, double *missedDE = NULL);
+
+	// percentage of wrong rays for given DE factor. Returns -1 if stopped
+	double MissedDEPercentage(double DEFactor, bool *stopRequest);
+
+	int GetNumberOfRays() const { return rays.size(); }
+	int GetNumberOfHits() const { return numberOfHits; }
+	// number of tested DE factors in last optimization
+	int GetNumberOfCandidates() const { return numberOfCandidates; }
+
+private:
+	struct sRay
+	{
+		sRay() : hit(false), depth(0.0), distThresh(0.0) {}
+		CVector3 direction;
+		// results of reference march
+		bool hit;
+		double depth;
+		double distThresh;
+	};
+
+	void PrepareRays();
+	bool PrepareReference(bool *stopRequest);
+	double CalcDistThresh(CVector3 point) const;
+	// marches the ray. Returns true if surface was found. *overstep is set if the last step went
+	// too deep below the surface
+	bool March(
+		const CVector3 &direction, double DEFactor, double *depth, bool *overstep, bool *stop) const;
+
+	cParamRender *params;
+	cNineFractals *fractals;
+	QVector<sRay> rays;
+	bool referenceReady;
+	int numberOfHits;
+	int numberOfCandidates;
+};
+
+#endif /* MANDELBULBER2_SRC_DE_FACTOR_OPTIMIZER_HPP_ */
@@ -0,0 +1,230 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPostRenderingDenoiser class - edge-aware filter of noise of Monte Carlo effects
+ */
+
+#include "denoiser.hpp"
+
+#include <cmath>
+
+#include "cimage.hpp"
+#include "global_data.hpp"
+#include "progress_text.hpp"
+#include "trace.hpp"
+
+// relative difference of depth at which weight of sample drops to 1/e (for step of 1 pixel)
+#define DENOISER_SIGMA_DEPTH 0.02
+// exponent of dot product of normal vectors
+#define DENOISER_NORMAL_POWER 64.0
+// squared difference of surface colour at which weight of sample drops to 1/e
+#define DENOISER_SIGMA_ALBEDO 0.01
+// luminance difference in units of local noise at which weight of sample drops to 1/e
+#define DENOISER_SIGMA_LUMINANCE 4.0
+
+cPostRenderingDenoiser::cPostRenderingDenoiser(cImage *_image) : QObject(), image(_image)
+{
+}
+
+void cPostRenderingDenoiser::Render(
+	const cRegion<int> &region, double strength, int iterations, bool *stopRequest)
+{
+	TRACE_SCOPE("cPostRenderingDenoiser::Render", "post");
+
+	int width = region.width;
+	int height = region.height;
+	if (width <= 0 || height <= 0) return;
+
+	QString statusText = QObject::tr("Denoising");
+	cProgressText progressText;
+	progressText.ResetTimer();
+	emit updateProgressAndStatus(statusText, progressText.getText(0.0), 0.0);
+	gApplication->processEvents();
+
+	PrepareBuffers(region);
+
+	for (int i = 0; i < iterations; i++)
+	{
+		if (*stopRequest) break;
+		FilterIteration(width, height, 1 << i, strength);
+
+		double percentDone = double(i + 1) / iterations;
+		emit updateProgressAndStatus(statusText, progressText.getText(percentDone), percentDone);
+		gApplication->processEvents();
+	}
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			image->PutPixelImage(x + region.x1, y + region.y1, colour[x + y * width]);
+		}
+	}
+
+	guide.clear();
+	colour.clear();
+	colourTemp.clear();
+	variance.clear();
+	varianceTemp.clear();
+}
+
+void cPostRenderingDenoiser::PrepareBuffers(const cRegion<int> &region)
+{
+	int width = region.width;
+	int height = region.height;
+	qint64 size = qint64(width) * height;
+	guide.resize(size);
+	colour.resize(size);
+	colourTemp.resize(size);
+	variance.resize(size);
+	varianceTemp.resize(size);
+
+	bool normalAvailable = image->GetImageOptional()->optionalNormal;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int sx = x + region.x1;
+			int sy = y + region.y1;
+			int ptr = x + y * width;
+			sGuide &pixelGuide = guide[ptr];
+			pixelGuide.depth = image->GetPixelZBuffer(sx, sy);
+			// normals are stored by render worker in range 0..1
+			if (normalAvailable && pixelGuide.depth < 1e19f)
+			{
+				sRGBfloat normal = image->GetPixelNormal(sx, sy);
+				pixelGuide.normal = CVector3(2.0 * normal.R - 1.0, 2.0 * normal.G - 1.0, 1.0 - normal.B);
+			}
+			sRGB8 albedo = image->GetPixelColor(sx, sy);
+			pixelGuide.albedo = sRGBfloat(albedo.R / 255.0f, albedo.G / 255.0f, albedo.B / 255.0f);
+			colour[ptr] = image->GetPixelImage(sx, sy);
+		}
+	}
+
+	// noise is estimated with variance of luminance of 3x3 neighbourhood
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			double sum = 0.0;
+			double sum2 = 0.0;
+			int count = 0;
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				int yy = y + dy;
+				if (yy < 0 || yy >= height) continue;
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					int xx = x + dx;
+					if (xx < 0 || xx >= width) continue;
+					double l = Luminance(colour[xx + yy * width]);
+					sum += l;
+					sum2 += l * l;
+					count++;
+				}
+			}
+			double mean = sum / count;
+			variance[x + y * width] = qMax(0.0, sum2 / count - mean * mean);
+		}
+	}
+}
+
+void cPostRenderingDenoiser::FilterIteration(int width, int height, int step, double strength)
+{
+	const float kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+	double sigmaDepth = DENOISER_SIGMA_DEPTH * step;
+	double sigmaLuminance = DENOISER_SIGMA_LUMINANCE * strength;
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int ptr = x + y * width;
+			const sGuide &centreGuide = guide[ptr];
+			float centreLuminance = Luminance(colour[ptr]);
+			double luminanceRange = sigmaLuminance * sqrt(variance[ptr]) + 1e-6;
+			bool centreBackground = centreGuide.normal.Length() < 0.5;
+
+			double sumR = 0.0, sumG = 0.0, sumB = 0.0;
+			double sumWeight = 0.0;
+			double sumVariance = 0.0;
+			for (int ky = 0; ky < 5; ky++)
+			{
+				int yy = y + (ky - 2) * step;
+				if (yy < 0 || yy >= height) continue;
+				for (int kx = 0; kx < 5; kx++)
+				{
+					int xx = x + (kx - 2) * step;
+					if (xx < 0 || xx >= width) continue;
+					int samplePtr = xx + yy * width;
+					const sGuide &sampleGuide = guide[samplePtr];
+					const sRGBfloat &sample = colour[samplePtr];
+
+					double weightNormal;
+					if (centreBackground || sampleGuide.normal.Length() < 0.5)
+						weightNormal = (centreBackground && sampleGuide.normal.Length() < 0.5) ? 1.0 : 0.0;
+					else
+						weightNormal =
+							pow(qMax(0.0, centreGuide.normal.Dot(sampleGuide.normal)), DENOISER_NORMAL_POWER);
+					if (weightNormal <= 0.0) continue;
+
+					double depthDiff = fabs(sampleGuide.depth - centreGuide.depth)
+														 / (sigmaDepth * centreGuide.depth + 1e-10);
+					double albedoR = sampleGuide.albedo.R - centreGuide.albedo.R;
+					double albedoG = sampleGuide.albedo.G - centreGuide.albedo.G;
+					double albedoB = sampleGuide.albedo.B - centreGuide.albedo.B;
+					double albedoDiff =
+						(albedoR * albedoR + albedoG * albedoG + albedoB * albedoB) / DENOISER_SIGMA_ALBEDO;
+					double luminanceDiff = fabs(Luminance(sample) - centreLuminance) / luminanceRange;
+
+					double weight = kernel[kx] * kernel[ky] * weightNormal
+													* exp(-depthDiff - albedoDiff - luminanceDiff);
+					sumR += sample.R * weight;
+					sumG += sample.G * weight;
+					sumB += sample.B * weight;
+					sumWeight += weight;
+					sumVariance += weight * weight * variance[samplePtr];
+				}
+			}
+
+			// centre sample has always non-zero weight
+			colourTemp[ptr] = sRGBfloat(sumR / sumWeight, sumG / sumWeight, sumB / sumWeight);
+			varianceTemp[ptr] = sumVariance / (sumWeight * sumWeight);
+		}
+	}
+
+	colour.swap(colourTemp);
+	variance.swap(varianceTemp);
+}
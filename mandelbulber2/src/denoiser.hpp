@@ -0,0 +1,91 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPostRenderingDenoiser class - edge-aware filter of noise of Monte Carlo effects
+ *
+ * Noise of Monte Carlo DOF, multi-ray ambient occlusion and soft shadows is removed
+ * with a-trous wavelet filter. Weights of samples depend on differences of depth,
+ * normal vectors and surface colour, so edges and textures are preserved, and on
+ * difference of luminance relative to estimated local noise
+ */
+
+
+#ifndef MANDELBULBER2_SRC_DENOISER_HPP_
+#define MANDELBULBER2_SRC_DENOISER_HPP_
+
+#include <QObject>
+#include <QVector>
+
+#include "algebra.hpp"
+#include "color_structures.hpp"
+#include "region.hpp"
+
+// forward declarations
+class cImage;
+
+class cPostRenderingDenoiser : public QObject
+{
+	Q_OBJECT
+
+public:
+	cPostRenderingDenoiser(cImage *_image);
+
+	// filters float image of the region. Higher strength allows bigger differences of luminance
+	// to be smoothed. Every iteration doubles radius of the filter
+	void Render(const cRegion<int> &region, double strength, int iterations, bool *stopRequest);
+
+private:
+	struct sGuide
+	{
+		CVector3 normal; // zero vector for background
+		sRGBfloat albedo;
+		float depth;
+	};
+
+	static float Luminance(const sRGBfloat &pixel)
+	{
+		return 0.2126f * pixel.R + 0.7152f * pixel.G + 0.0722f * pixel.B;
+	}
+	void PrepareBuffers(const cRegion<int> &region);
+	void FilterIteration(int width, int height, int step, double strength);
+
+	cImage *image;
+	QVector<sGuide> guide;
+	QVector<sRGBfloat> colour;
+	QVector<sRGBfloat> colourTemp;
+	QVector<float> variance;
+	QVector<float> varianceTemp;
+
+signals:
+	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
+};
+
+#endif /* MANDELBULBER2_SRC_DENOISER_HPP_ */
@@ -0,0 +1,87 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDepthPrepass class - coarse depth buffer rendered before the main passes
+ */
+
+#include "depth_prepass.hpp"
+
+cDepthPrepass::cDepthPrepass(const cRegion<int> &_screenRegion, int _blockSize)
+{
+	screenRegion = _screenRegion;
+	blockSize = _blockSize;
+	if (blockSize < 1) blockSize = 1;
+	width = (screenRegion.width + blockSize - 1) / blockSize;
+	height = (screenRegion.height + blockSize - 1) / blockSize;
+	if (width < 1) width = 1;
+	if (height < 1) height = 1;
+	depthBuffer.fill(0.0f, width * height);
+	nextRow.store(0);
+	rendering = false;
+}
+
+cDepthPrepass::~cDepthPrepass()
+{
+}
+
+CVector2<int> cDepthPrepass::GetBlockCenter(int bx, int by) const
+{
+	return CVector2<int>(screenRegion.x1 + bx * blockSize + blockSize / 2,
+		screenRegion.y1 + by * blockSize + blockSize / 2);
+}
+
+CVector2<int> cDepthPrepass::GetBlockCorner(int bx, int by, int corner) const
+{
+	int x = screenRegion.x1 + (bx + (corner & 1)) * blockSize;
+	int y = screenRegion.y1 + (by + ((corner >> 1) & 1)) * blockSize;
+	return CVector2<int>(x, y);
+}
+
+void cDepthPrepass::SetDepth(int bx, int by, double depth)
+{
+	if (bx >= 0 && bx < width && by >= 0 && by < height) depthBuffer[by * width + bx] = depth;
+}
+
+double cDepthPrepass::GetStartDistance(int xs, int ys) const
+{
+	if (rendering) return 0.0;
+	int bx = (xs - screenRegion.x1) / blockSize;
+	int by = (ys - screenRegion.y1) / blockSize;
+	if (bx < 0 || bx >= width || by < 0 || by >= height) return 0.0;
+	return depthBuffer[by * width + bx];
+}
+
+int cDepthPrepass::NextRow()
+{
+	int row = nextRow.fetchAndAddOrdered(1);
+	if (row >= height) return -1;
+	return row;
+}
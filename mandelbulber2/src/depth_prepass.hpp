@@ -0,0 +1,81 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDepthPrepass class - coarse depth buffer rendered before the main passes
+ *
+ * Each value is a conservative distance along primary rays of one block of
+ * pixels, at which ray-marching of all rays of the block can be started.
+ */
+
+#ifndef MANDELBULBER2_SRC_DEPTH_PREPASS_HPP_
+#define MANDELBULBER2_SRC_DEPTH_PREPASS_HPP_
+
+#include <QAtomicInt>
+#include <QVector>
+
+#include "region.hpp"
+
+class cDepthPrepass
+{
+public:
+	cDepthPrepass(const cRegion<int> &_screenRegion, int _blockSize);
+	~cDepthPrepass();
+
+	int GetBlockSize() const { return blockSize; }
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+
+	// screen coordinates of central pixel and corners of block
+	CVector2<int> GetBlockCenter(int bx, int by) const;
+	CVector2<int> GetBlockCorner(int bx, int by, int corner) const;
+
+	void SetDepth(int bx, int by, double depth);
+	// distance from which ray-marching of given pixel can be started (0 if unknown)
+	double GetStartDistance(int xs, int ys) const;
+
+	// rows of blocks are distributed between rendering threads. Returns -1 if all rows are taken
+	int NextRow();
+	void ResetRows() { nextRow.store(0); }
+
+	bool IsRendering() const { return rendering; }
+	void SetRendering(bool _rendering) { rendering = _rendering; }
+
+private:
+	cRegion<int> screenRegion;
+	int blockSize;
+	int width;
+	int height;
+	QVector<float> depthBuffer;
+	QAtomicInt nextRow;
+	bool rendering;
+};
+
+#endif /* MANDELBULBER2_SRC_DEPTH_PREPASS_HPP_ */
@@ -0,0 +1,226 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDirtyRegion class - estimation of image region changed by edited parameters
+ */
+
+#include "dirty_region.hpp"
+
+#include "algebra.hpp"
+#include "camera_target.hpp"
+#include "fractal_container.hpp"
+#include "fractparams.hpp"
+#include "parameters.hpp"
+#include "primitives.h"
+
+bool cDirtyRegion::ChangedParameters(
+	const cParameterContainer *par1, const cParameterContainer *par2, QStringList *list)
+{
+	QList<QString> names = par1->GetListOfParameters();
+	if (names.size() != par2->GetListOfParameters().size()) return false;
+
+	for (int i = 0; i < names.size(); i++)
+	{
+		const QString &name = names[i];
+		if (!par2->IfExists(name)) return false;
+		if (par1->GetParameterType(name) != paramStandard) continue;
+		if (par1->Get<QString>(name) != par2->Get<QString>(name)) list->append(name);
+	}
+	return true;
+}
+
+bool cDirtyRegion::OnlyShadingChanged(const cParameterContainer *oldPar,
+	const cFractalContainer *oldFractal, const cParameterContainer *newPar,
+	const cFractalContainer *newFractal)
+{
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		QStringList changedFractal;
+		if (!ChangedParameters(&oldFractal->at(i), &newFractal->at(i), &changedFractal)) return false;
+		if (!changedFractal.isEmpty()) return false;
+	}
+
+	QStringList changed;
+	if (!ChangedParameters(oldPar, newPar, &changed)) return false;
+	if (changed.isEmpty()) return false;
+
+	// parameters which don't move the surface seen by primary rays
+	const char *shadingPrefixes[] = {"main_light_", "aux_light_", "random_lights_", "fake_lights_",
+		"shadows_", "penetrating_lights", "ambient_occlusion", "raytraced_reflections",
+		"reflections_max", "env_mapping_", "background_", "basic_fog_", "fog_", "glow_",
+		"volumetric_fog_", "iteration_fog_", "brightness", "contrast", "gamma", "hdr", "DOF_"};
+	const int numberOfPrefixes = sizeof(shadingPrefixes) / sizeof(shadingPrefixes[0]);
+
+	for (int i = 0; i < changed.size(); i++)
+	{
+		const QString &name = changed[i];
+		bool shading = false;
+		if (name.startsWith("mat") && name.size() > 3 && name.at(3).isDigit())
+		{
+			// displacement, normal maps and colouring algorithms change stored geometry
+			shading = !name.contains("displacement") && !name.contains("normal_map")
+								&& !name.contains("fractal_coloring");
+		}
+		for (int p = 0; p < numberOfPrefixes && !shading; p++)
+			shading = name.startsWith(shadingPrefixes[p]);
+		if (!shading) return false;
+	}
+	return true;
+}
+
+bool cDirtyRegion::Estimate(const cParameterContainer *oldPar, const cFractalContainer *oldFractal,
+	const cParameterContainer *newPar, const cFractalContainer *newFractal, int width, int height,
+	cRegion<int> *region)
+{
+	if (width <= 0 || height <= 0) return false;
+
+	// changes of fractals affect the whole image
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		QStringList changedFractal;
+		if (!ChangedParameters(&oldFractal->at(i), &newFractal->at(i), &changedFractal)) return false;
+		if (!changedFractal.isEmpty()) return false;
+	}
+
+	QStringList changed;
+	if (!ChangedParameters(oldPar, newPar, &changed)) return false;
+	if (changed.isEmpty()) return false;
+
+	// effects which spread changes over the image
+	if (newPar->Get<bool>("raytraced_reflections") || newPar->Get<bool>("DOF_enabled")) return false;
+	if (newPar->Get<int>("perspective_type") != params::perspThreePoint) return false;
+
+	// names of edited primitives (primitive_<type>_<id>_<parameter>)
+	QStringList primitives;
+	for (int i = 0; i < changed.size(); i++)
+	{
+		QStringList parts = changed[i].split('_');
+		if (parts.size() < 4 || parts[0] != "primitive") return false;
+		QString primitiveName = parts[0] + "_" + parts[1] + "_" + parts[2];
+		if (!primitives.contains(primitiveName)) primitives.append(primitiveName);
+	}
+
+	// both old and new position of primitive have to be rendered
+	bool first = true;
+	for (int i = 0; i < primitives.size(); i++)
+	{
+		for (int version = 0; version < 2; version++)
+		{
+			const cParameterContainer *par = (version == 0) ? oldPar : newPar;
+			cRegion<int> primitiveRegion;
+			if (!PrimitiveRegion(par, primitives[i], width, height, &primitiveRegion)) return false;
+			if (primitiveRegion.width <= 0 || primitiveRegion.height <= 0) continue;
+
+			if (first)
+			{
+				*region = primitiveRegion;
+				first = false;
+			}
+			else
+			{
+				region->Set(qMin(region->x1, primitiveRegion.x1), qMin(region->y1, primitiveRegion.y1),
+					qMax(region->x2, primitiveRegion.x2), qMax(region->y2, primitiveRegion.y2));
+			}
+		}
+	}
+
+	// edited primitives are not visible at all
+	if (first) region->Set(0, 0, 0, 0);
+	return true;
+}
+
+double cDirtyRegion::PrimitiveRadius(const cParameterContainer *par, const QString &primitiveName)
+{
+	// conservative sum of all dimensions of the primitive
+	double radius = 0.0;
+	if (par->IfExists(primitiveName + "_size"))
+		radius += 0.5 * par->Get<CVector3>(primitiveName + "_size").Length();
+	const char *dimensions[] = {"_radius", "_tube_radius", "_height", "_width", "_length"};
+	for (int i = 0; i < 5; i++)
+	{
+		QString name = primitiveName + dimensions[i];
+		if (par->IfExists(name)) radius += fabs(par->Get<double>(name));
+	}
+	return radius;
+}
+
+bool cDirtyRegion::PrimitiveRegion(const cParameterContainer *par, const QString &primitiveName,
+	int width, int height, cRegion<int> *region)
+{
+	// infinite primitives
+	fractal::enumObjectType type = PrimitiveNameToEnum(primitiveName.section('_', 1, 1));
+	if (type == fractal::objPlane || type == fractal::objWater || type == fractal::objNone)
+		return false;
+	if (par->IfExists(primitiveName + "_repeat")
+			&& par->Get<CVector3>(primitiveName + "_repeat").Length() > 0.0)
+		return false;
+
+	double radius = PrimitiveRadius(par, primitiveName);
+	if (radius <= 0.0) return false;
+	double reach = 1.0;
+	if (par->Get<bool>("shadows_enabled")) reach += DIRTY_REGION_SHADOW_REACH;
+	if (par->Get<bool>("ambient_occlusion_enabled")) reach += DIRTY_REGION_AO_REACH;
+	radius *= reach;
+
+	// the same camera rotation as used by cRenderWorker
+	CVector3 camera = par->Get<CVector3>("camera");
+	cCameraTarget cameraTarget(
+		camera, par->Get<CVector3>("target"), par->Get<CVector3>("camera_top"));
+	CVector3 viewAngle = cameraTarget.GetRotation();
+	CRotationMatrix mRot;
+	mRot.RotateZ(viewAngle.x);
+	mRot.RotateX(viewAngle.y);
+	mRot.RotateY(viewAngle.z);
+	CRotationMatrix mRotInv = mRot.Transpose();
+
+	CVector3 v = mRotInv.RotateVector(par->Get<CVector3>(primitiveName + "_position") - camera);
+	// sphere touches the camera
+	if (v.y - radius <= 0.0) return false;
+
+	double fov = par->Get<double>("fov");
+	double aspectRatio = (double)width / height;
+	double yDirection = par->Get<bool>("legacy_coordinate_system") ? 1.0 : -1.0;
+	double nx = v.x / v.y / fov;
+	double ny = v.z / v.y / fov;
+	double xs = (nx / aspectRatio + 0.5) * width;
+	double ys = (ny * yDirection + 0.5) * height;
+
+	// projection of sphere is stretched towards edges of the image
+	double tan2 = (v.x * v.x + v.z * v.z) / (v.y * v.y);
+	double pixelRadius = radius / (v.y - radius) / fov * height * (1.0 + tan2) + DIRTY_REGION_MARGIN;
+
+	int x1 = qBound(0, (int)floor(xs - pixelRadius), width);
+	int y1 = qBound(0, (int)floor(ys - pixelRadius), height);
+	int x2 = qBound(0, (int)ceil(xs + pixelRadius), width);
+	int y2 = qBound(0, (int)ceil(ys + pixelRadius), height);
+	region->Set(x1, y1, x2, y2);
+	return true;
+}
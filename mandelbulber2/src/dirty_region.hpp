@@ -0,0 +1,85 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDirtyRegion class - estimation of image region changed by edited parameters
+ *
+ * If only primitives were changed, the old and the new bounding spheres of
+ * edited primitives are projected to the image. Spheres are enlarged by reach
+ * of shadows and ambient occlusion. Only this part of the image has to be
+ * rendered again. If only shading was changed, the whole image can be relit
+ * using geometry from the previous render.
+ */
+
+#ifndef MANDELBULBER2_SRC_DIRTY_REGION_HPP_
+#define MANDELBULBER2_SRC_DIRTY_REGION_HPP_
+
+#include <QStringList>
+
+#include "region.hpp"
+
+// reach of shadows and ambient occlusion (relative to size of primitive)
+#define DIRTY_REGION_SHADOW_REACH 3.0
+#define DIRTY_REGION_AO_REACH 1.0
+// margin of region in pixels
+#define DIRTY_REGION_MARGIN 4
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+
+class cDirtyRegion
+{
+public:
+	// part of image which has to be rendered again after change of parameters. Returns false if the
+	// whole image has to be rendered
+	static bool Estimate(const cParameterContainer *oldPar, const cFractalContainer *oldFractal,
+		const cParameterContainer *newPar, const cFractalContainer *newFractal, int width, int height,
+		cRegion<int> *region);
+
+	// only parameters of lights, materials, effects and image adjustments were changed, so
+	// geometry seen by primary rays is the same as in the previous image
+	static bool OnlyShadingChanged(const cParameterContainer *oldPar,
+		const cFractalContainer *oldFractal, const cParameterContainer *newPar,
+		const cFractalContainer *newFractal);
+
+	// names of standard parameters with different values. Returns false if sets of parameters
+	// are different
+	static bool ChangedParameters(
+		const cParameterContainer *par1, const cParameterContainer *par2, QStringList *list);
+
+private:
+	// region covered by bounding sphere of primitive. Returns false if it cannot be projected
+	static bool PrimitiveRegion(const cParameterContainer *par, const QString &primitiveName,
+		int width, int height, cRegion<int> *region);
+	static double PrimitiveRadius(const cParameterContainer *par, const QString &primitiveName);
+};
+
+#endif /* MANDELBULBER2_SRC_DIRTY_REGION_HPP_ */
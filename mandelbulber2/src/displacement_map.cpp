@@ -35,24 +35,66 @@
 #include "displacement_map.hpp"
 #include "texture_mapping.hpp"
 #include "render_data.hpp"
+#include "system.hpp"
 
-double DisplacementMap(double oldDistance, CVector3 point, int objectId, sRenderData *data)
+double DisplacementMap(
+	double oldDistance, CVector3 point, int objectId, sRenderData *data, double detailSize)
 {
 	double distance = oldDistance;
 	if (data)
 	{
-		const cMaterial *mat = &data->materials[data->objectData[objectId].materialId];
+		const cObjectData &objectData = data->objectData[objectId];
+		const cMaterial *mat = &data->materials[objectData.materialId];
 		if (mat->displacementTexture.IsLoaded())
 		{
+			// displaced surface is not closer than oldDistance - height, so far from the surface
+			// this bound is returned without any texture lookup
+			double maxHeight = mat->displacementTextureHeight;
+			if (oldDistance - maxHeight > detailSize) return oldDistance - maxHeight;
+
+			CVector3 textureVectorX, textureVectorY;
 			CVector2<double> textureCoordinates;
-			textureCoordinates =
-				TextureMapping(point, CVector3(0.0, 0.0, 1.0), data->objectData[objectId], mat)
-				+ CVector2<double>(0.5, 0.5);
-			sRGBfloat bump3 = mat->displacementTexture.Pixel(textureCoordinates);
+			textureCoordinates = TextureMapping(point, CVector3(0.0, 0.0, 1.0), objectData, mat,
+														 &textureVectorX, &textureVectorY)
+													 + CVector2<double>(0.5, 0.5);
+
+			// mip level is chosen from size of texture area covered by detail size
+			double texturePixelSize = 0.0;
+			if (detailSize > 0.0)
+			{
+				double deltaTexX =
+					((TextureMapping(point + textureVectorX * detailSize, CVector3(0.0, 0.0, 1.0),
+							 objectData, mat)
+						 + CVector2<double>(0.5, 0.5))
+						- textureCoordinates)
+						.Length();
+				double deltaTexY =
+					((TextureMapping(point + textureVectorY * detailSize, CVector3(0.0, 0.0, 1.0),
+							 objectData, mat)
+						 + CVector2<double>(0.5, 0.5))
+						- textureCoordinates)
+						.Length();
+				if (deltaTexX > 0.5) deltaTexX = 1.0 - deltaTexX;
+				if (deltaTexY > 0.5) deltaTexY = 1.0 - deltaTexY;
+				double deltaTex = max(fabs(deltaTexX), fabs(deltaTexY));
+				if (deltaTex > 0.0) texturePixelSize = 1.0 / deltaTex;
+			}
+
+			sRGBfloat bump3 = mat->displacementTexture.Pixel(textureCoordinates, texturePixelSize);
 			double bump = bump3.R;
-			distance -= bump * mat->displacementTextureHeight;
+			distance -= bump * maxHeight;
 			if (distance < 0.0) distance = 0.0;
 		}
 	}
 	return distance;
 }
+
+double DisplacementMaxHeight(int objectId, sRenderData *data)
+{
+	if (data)
+	{
+		const cMaterial *mat = &data->materials[data->objectData[objectId].materialId];
+		if (mat->displacementTexture.IsLoaded()) return mat->displacementTextureHeight;
+	}
+	return 0.0;
+}
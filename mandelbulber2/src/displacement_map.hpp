@@ -40,6 +40,13 @@
 // forward declarations
 struct sRenderData;
 
-double DisplacementMap(double oldDistance, CVector3 point, int objectId, sRenderData *data);
+// decreases distance by height from displacement texture. The texture is sampled at mip level
+// matching detailSize. If oldDistance - maximum height is bigger than detailSize, this lower bound
+// of distance is returned without texture lookup (error is at most the maximum height)
+double DisplacementMap(double oldDistance, CVector3 point, int objectId, sRenderData *data,
+	double detailSize = 0.0);
+
+// maximum decrease of distance which can be done by DisplacementMap()
+double DisplacementMaxHeight(int objectId, sRenderData *data);
 
 #endif /* MANDELBULBER2_SRC_DISPLACEMENT_MAP_HPP_ */
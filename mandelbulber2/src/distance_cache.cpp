@@ -0,0 +1,322 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceCache class - world-space cache of distance estimation
+ */
+
+#include "distance_cache.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+
+#include "calculate_distance.hpp"
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+#include "settings.hpp"
+#include "system.hpp"
+
+// bits of float NaN, used for samples which are not calculated
+#define DISTANCE_CACHE_EMPTY 0x7fc00000
+
+// cell size relative to distance to the surface. Error of interpolation is not bigger than
+// the cell size, so steps are shorter by this factor
+#define DISTANCE_CACHE_CELL_FACTOR 0.25
+
+// header of cache files
+#define DISTANCE_CACHE_FILE_MAGIC 0x4D444331
+
+uint qHash(const cDistanceCache::sBrickKey &key, uint seed)
+{
+	quint64 hash = (quint64)key.x * 73856093ULL ^ (quint64)key.y * 19349663ULL
+								 ^ (quint64)key.z * 83492791ULL ^ (quint64)key.level * 2654435761ULL;
+	return (uint)(hash ^ (hash >> 32)) ^ seed;
+}
+
+static inline int FloatToBits(float value)
+{
+	int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static inline float BitsToFloat(int bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+cDistanceCache::sBrick::sBrick()
+{
+	for (int i = 0; i < DISTANCE_CACHE_BRICK_SAMPLES; i++)
+		samples[i].store(DISTANCE_CACHE_EMPTY);
+}
+
+cDistanceCache *cDistanceCache::instance = NULL;
+
+cDistanceCache *cDistanceCache::Instance()
+{
+	if (!instance) instance = new cDistanceCache;
+	return instance;
+}
+
+cDistanceCache::cDistanceCache()
+{
+	shards = new sShard[DISTANCE_CACHE_SHARDS];
+	persistent = false;
+	modified.store(0);
+}
+
+cDistanceCache::~cDistanceCache()
+{
+	Clear();
+	delete[] shards;
+}
+
+void cDistanceCache::PrepareScene(const QString &fractalHash, bool _persistent)
+{
+	if (fractalHash != lastFractalHash)
+	{
+		// new samples of previous fractal are stored before they are cleared
+		Finish();
+		Clear();
+		lastFractalHash = fractalHash;
+		persistent = _persistent;
+		if (persistent && Load())
+			WriteLogDouble("Distance cache: bricks loaded from disk", GetNumberOfBricks(), 2);
+	}
+	persistent = _persistent;
+}
+
+void cDistanceCache::Finish()
+{
+	if (persistent && modified.load() && !lastFractalHash.isEmpty()) Save();
+	modified.store(0);
+}
+
+void cDistanceCache::Clear()
+{
+	for (int i = 0; i < DISTANCE_CACHE_SHARDS; i++)
+	{
+		QWriteLocker locker(&shards[i].lock);
+		qDeleteAll(shards[i].bricks);
+		shards[i].bricks.clear();
+	}
+}
+
+int cDistanceCache::GetNumberOfBricks() const
+{
+	int count = 0;
+	for (int i = 0; i < DISTANCE_CACHE_SHARDS; i++)
+	{
+		QReadLocker locker(&shards[i].lock);
+		count += shards[i].bricks.size();
+	}
+	return count;
+}
+
+cDistanceCache::sBrick *cDistanceCache::FindBrick(const sBrickKey &key)
+{
+	sShard &shard = shards[qHash(key, 0) % DISTANCE_CACHE_SHARDS];
+	{
+		QReadLocker locker(&shard.lock);
+		QHash<sBrickKey, sBrick *>::const_iterator it = shard.bricks.constFind(key);
+		if (it != shard.bricks.constEnd()) return it.value();
+	}
+
+	// brick could be created by other thread in the meantime
+	QWriteLocker locker(&shard.lock);
+	QHash<sBrickKey, sBrick *>::const_iterator it = shard.bricks.constFind(key);
+	if (it != shard.bricks.constEnd()) return it.value();
+	if (shard.bricks.size() >= DISTANCE_CACHE_MAX_BRICKS_PER_SHARD) return NULL;
+	sBrick *brick = new sBrick;
+	shard.bricks.insert(key, brick);
+	return brick;
+}
+
+bool cDistanceCache::GetDistance(const CVector3 &point, double approxDistance,
+	const cParamRender &params, const cNineFractals &fractals, sRenderData *data, double *distance)
+{
+	if (approxDistance <= 0.0) return false;
+
+	sBrickKey key;
+	key.level = (int)floor(log2(approxDistance * DISTANCE_CACHE_CELL_FACTOR));
+	double cellSize = ldexp(1.0, key.level);
+
+	// cell of the lattice and position inside the cell
+	CVector3 cellPoint = point / cellSize;
+	double cell[3] = {floor(cellPoint.x), floor(cellPoint.y), floor(cellPoint.z)};
+	double fraction[3] = {cellPoint.x - cell[0], cellPoint.y - cell[1], cellPoint.z - cell[2]};
+	qint64 brickIndex[3];
+	int local[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		brickIndex[axis] = (qint64)floor(cell[axis] / DISTANCE_CACHE_BRICK_CELLS);
+		local[axis] = (int)(cell[axis] - brickIndex[axis] * DISTANCE_CACHE_BRICK_CELLS);
+	}
+	key.x = brickIndex[0];
+	key.y = brickIndex[1];
+	key.z = brickIndex[2];
+
+	sBrick *brick = FindBrick(key);
+	if (!brick) return false;
+
+	const int size = DISTANCE_CACHE_BRICK_CELLS + 1;
+	double corners[8];
+	for (int c = 0; c < 8; c++)
+	{
+		int dx = c & 1;
+		int dy = (c >> 1) & 1;
+		int dz = (c >> 2) & 1;
+		int index = ((local[2] + dz) * size + (local[1] + dy)) * size + (local[0] + dx);
+		int bits = brick->samples[index].load();
+		if (bits == DISTANCE_CACHE_EMPTY)
+		{
+			// sample is calculated with detail size of the cell, so it doesn't depend on the camera
+			CVector3 samplePoint(
+				(cell[0] + dx) * cellSize, (cell[1] + dy) * cellSize, (cell[2] + dz) * cellSize);
+			sDistanceIn in(samplePoint, cellSize, false);
+			sDistanceOut out;
+			double sample = CalculateDistance(params, fractals, in, &out, data);
+			if (std::isnan(sample)) sample = 0.0;
+			bits = FloatToBits(sample);
+			brick->samples[index].store(bits);
+			modified.store(1);
+		}
+		corners[c] = BitsToFloat(bits);
+	}
+
+	// trilinear interpolation
+	double x0 = corners[0] + (corners[1] - corners[0]) * fraction[0];
+	double x1 = corners[2] + (corners[3] - corners[2]) * fraction[0];
+	double x2 = corners[4] + (corners[5] - corners[4]) * fraction[0];
+	double x3 = corners[6] + (corners[7] - corners[6]) * fraction[0];
+	double y0 = x0 + (x1 - x0) * fraction[1];
+	double y1 = x2 + (x3 - x2) * fraction[1];
+	double interpolated = y0 + (y1 - y0) * fraction[2];
+
+	// the point can be closer to the surface than samples by up to the size of the cell
+	*distance = interpolated - cellSize;
+	return true;
+}
+
+QString cDistanceCache::CacheFileName() const
+{
+	return systemData.GetDataDirectoryHidden() + "distance_cache" + QDir::separator()
+				 + lastFractalHash + ".dcache";
+}
+
+bool cDistanceCache::Load()
+{
+	QFile file(CacheFileName());
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	QDataStream stream(&file);
+	quint32 magic;
+	QString hash;
+	qint32 numberOfBricks;
+	stream >> magic >> hash >> numberOfBricks;
+	if (magic != DISTANCE_CACHE_FILE_MAGIC || hash != lastFractalHash || numberOfBricks < 0)
+	{
+		qWarning() << "cDistanceCache::Load(): wrong cache file" << file.fileName();
+		return false;
+	}
+
+	for (int i = 0; i < numberOfBricks && stream.status() == QDataStream::Ok; i++)
+	{
+		sBrickKey key;
+		qint32 level;
+		stream >> key.x >> key.y >> key.z >> level;
+		key.level = level;
+		sBrick *brick = FindBrick(key);
+		for (int s = 0; s < DISTANCE_CACHE_BRICK_SAMPLES; s++)
+		{
+			qint32 bits;
+			stream >> bits;
+			if (brick) brick->samples[s].store(bits);
+		}
+	}
+	return stream.status() == QDataStream::Ok;
+}
+
+void cDistanceCache::Save()
+{
+	QDir().mkpath(systemData.GetDataDirectoryHidden() + "distance_cache");
+	QFile file(CacheFileName());
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		qWarning() << "cDistanceCache::Save(): cannot write cache file" << file.fileName();
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream << (quint32)DISTANCE_CACHE_FILE_MAGIC << lastFractalHash << (qint32)GetNumberOfBricks();
+	for (int i = 0; i < DISTANCE_CACHE_SHARDS; i++)
+	{
+		QReadLocker locker(&shards[i].lock);
+		QHash<sBrickKey, sBrick *>::const_iterator it;
+		for (it = shards[i].bricks.constBegin(); it != shards[i].bricks.constEnd(); ++it)
+		{
+			const sBrickKey &key = it.key();
+			stream << key.x << key.y << key.z << (qint32)key.level;
+			for (int s = 0; s < DISTANCE_CACHE_BRICK_SAMPLES; s++)
+				stream << (qint32)it.value()->samples[s].load();
+		}
+	}
+	WriteLog("cDistanceCache::Save(): cache stored in " + file.fileName(), 2);
+}
+
+QString cDistanceCache::FractalHash(
+	const cParameterContainer *par, const cFractalContainer *fractPar)
+{
+	// parameters which don't change the shape are removed. Parameters of displacement textures
+	// change distance estimation, so they are kept
+	QRegularExpression skipped(
+		"^(camera|target|fov|perspective_type|sweet_spot|stereo|image_|main_light|aux_light|"
+		"shadow|penetrating_lights|raytraced_reflections|reflections_max|ambient_occlusion|"
+		"background|env_mapping|fake_lights|glow|fog|volumetric|iteration_fog|DOF|brightness|"
+		"contrast|gamma|saturation|hdr|frame_no|antialiasing|textured_background|opencl|"
+		"distance_cache|detail_level|DE_factor|view_distance|raymarching|slow_shading)"
+		"|^mat\\d+_(?!displacement)");
+
+	cParameterContainer scene = *par;
+	QList<QString> names = scene.GetListOfParameters();
+	for (int i = 0; i < names.size(); i++)
+	{
+		if (skipped.match(names.at(i)).hasMatch()) scene.DeleteParameter(names.at(i));
+	}
+
+	return cSettings::StructuralHash(&scene, fractPar);
+}
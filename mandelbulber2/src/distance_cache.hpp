@@ -0,0 +1,147 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceCache class - world-space cache of distance estimation
+ *
+ * The same fractal is often rendered many times with different camera, lights
+ * or materials. Distances are sampled on regular lattices with cell size close
+ * to the distance to the surface, so far from the surface the ray can step by
+ * trilinear interpolation of cached samples instead of calculation of the
+ * fractal. Samples are stored in sparse bricks of 8 x 8 x 8 cells, which are
+ * created when the ray comes to them. The cache is kept between render jobs
+ * while the fractal doesn't change and can be stored on disk.
+ */
+
+#ifndef MANDELBULBER2_SRC_DISTANCE_CACHE_HPP_
+#define MANDELBULBER2_SRC_DISTANCE_CACHE_HPP_
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+
+#include "algebra.hpp"
+
+// number of cells of brick in each direction
+#define DISTANCE_CACHE_BRICK_CELLS 8
+// samples of brick (also on the far walls, so cells of one brick don't need other bricks)
+#define DISTANCE_CACHE_BRICK_SAMPLES \
+	((DISTANCE_CACHE_BRICK_CELLS + 1) * (DISTANCE_CACHE_BRICK_CELLS + 1) \
+		* (DISTANCE_CACHE_BRICK_CELLS + 1))
+// number of independently locked parts of the cache
+#define DISTANCE_CACHE_SHARDS 64
+// maximum number of bricks stored in one shard (about 3 kB per brick)
+#define DISTANCE_CACHE_MAX_BRICKS_PER_SHARD 256
+// cached distances are used only if they are bigger than this number of distance thresholds.
+// Final steps close to the surface are always calculated
+#define DISTANCE_CACHE_MIN_DISTANCE 8.0
+
+// forward declarations
+class cFractalContainer;
+class cNineFractals;
+class cParamRender;
+class cParameterContainer;
+struct sRenderData;
+
+class cDistanceCache
+{
+public:
+	static cDistanceCache *Instance();
+
+	// cache is used by one render job at a time
+	bool TryLock() { return lock.tryLock(); }
+	void Unlock() { lock.unlock(); }
+
+	// clears stored distances if fractal is different than in previous job. Persistent cache of
+	// the fractal is loaded from disk
+	void PrepareScene(const QString &fractalHash, bool persistent);
+	// stores new samples of persistent cache on disk
+	void Finish();
+	void Clear();
+
+	// conservative distance interpolated from samples around the point. Size of cells is chosen
+	// by approximate distance to the surface. Missing samples are calculated. Returns false if
+	// the cache is full
+	bool GetDistance(const CVector3 &point, double approxDistance, const cParamRender &params,
+		const cNineFractals &fractals, sRenderData *data, double *distance);
+
+	int GetNumberOfBricks() const;
+
+	// hash of all parameters which influence distance estimation (camera, lights, materials and
+	// effects are skipped)
+	static QString FractalHash(const cParameterContainer *par, const cFractalContainer *fractPar);
+
+private:
+	cDistanceCache();
+	~cDistanceCache();
+
+	struct sBrickKey
+	{
+		qint64 x;
+		qint64 y;
+		qint64 z;
+		int level; // size of cell is 2^level
+		bool operator==(const sBrickKey &other) const
+		{
+			return x == other.x && y == other.y && z == other.z && level == other.level;
+		}
+	};
+
+	// distances are stored as bits of float numbers. NaN means that sample is not calculated
+	struct sBrick
+	{
+		sBrick();
+		QAtomicInt samples[DISTANCE_CACHE_BRICK_SAMPLES];
+	};
+
+	struct sShard
+	{
+		mutable QReadWriteLock lock;
+		QHash<sBrickKey, sBrick *> bricks;
+	};
+
+	friend uint qHash(const sBrickKey &key, uint seed);
+
+	sBrick *FindBrick(const sBrickKey &key);
+	QString CacheFileName() const;
+	bool Load();
+	void Save();
+
+	static cDistanceCache *instance;
+	QMutex lock;
+	sShard *shards;
+	QString lastFractalHash;
+	bool persistent;
+	QAtomicInt modified;
+};
+
+#endif /* MANDELBULBER2_SRC_DISTANCE_CACHE_HPP_ */
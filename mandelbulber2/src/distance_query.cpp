@@ -0,0 +1,238 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceQuery - distance estimation for interactive features
+ */
+
+#include "distance_query.hpp"
+
+#include <QThread>
+
+#include <cstring>
+
+#include "calculate_distance.hpp"
+#include "fractparams.hpp"
+#include "nine_fractals.hpp"
+
+cDistanceQuery *gDistanceQuery = NULL;
+
+uint qHash(const cDistanceQuery::sPointKey &key, uint seed)
+{
+	quint64 hash = key.x * 73856093ULL ^ key.y * 19349663ULL ^ key.z * 83492791ULL;
+	return (uint)(hash ^ (hash >> 32)) ^ seed;
+}
+
+void cDistanceQueryWorker::slotProcessRequests()
+{
+	query->ProcessRequests();
+}
+
+cDistanceQuery::cDistanceQuery(QObject *parent) : QObject(parent)
+{
+	lastRequestId = 0;
+	params = NULL;
+	fractals = NULL;
+
+	thread = new QThread;
+	thread->setObjectName("DistanceQuery");
+	worker = new cDistanceQueryWorker(this);
+	worker->moveToThread(thread);
+	connect(this, SIGNAL(requestsQueued()), worker, SLOT(slotProcessRequests()));
+	thread->start();
+}
+
+cDistanceQuery::~cDistanceQuery()
+{
+	thread->quit();
+	thread->wait();
+	delete worker;
+	delete thread;
+	delete params;
+	delete fractals;
+}
+
+cDistanceQuery::sPointKey cDistanceQuery::PointKey(const CVector3 &point)
+{
+	const quint64 mask = ~((quint64(1) << DISTANCE_QUERY_QUANTIZATION_BITS) - 1);
+	sPointKey key;
+	memcpy(&key.x, &point.x, sizeof(quint64));
+	memcpy(&key.y, &point.y, sizeof(quint64));
+	memcpy(&key.z, &point.z, sizeof(quint64));
+	key.x &= mask;
+	key.y &= mask;
+	key.z &= mask;
+	return key;
+}
+
+QVector<quint64> cDistanceQuery::ParameterHashes(
+	const cParameterContainer *par, const cFractalContainer *parFractal)
+{
+	QVector<quint64> hashes;
+	hashes.reserve(NUMBER_OF_FRACTALS + 1);
+	hashes.append(par->GetStructuralHash());
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+		hashes.append(parFractal->at(i).GetStructuralHash());
+	return hashes;
+}
+
+void cDistanceQuery::PrepareParameters(
+	const cParameterContainer *par, const cFractalContainer *parFractal)
+{
+	QVector<quint64> hashes = ParameterHashes(par, parFractal);
+	if (params && hashes == preparedHashes) return;
+
+	delete params;
+	delete fractals;
+	params = new cParamRender(par);
+	fractals = new cNineFractals(parFractal, par);
+	preparedHashes = hashes;
+	cache.clear();
+}
+
+QList<double> cDistanceQuery::CalculateDistances(const QList<CVector3> &points)
+{
+	QList<double> distances;
+	QVector<CVector3> missingPoints;
+	QVector<int> missingIndexes;
+	for (int i = 0; i < points.size(); i++)
+	{
+		QHash<sPointKey, double>::const_iterator it = cache.constFind(PointKey(points.at(i)));
+		if (it != cache.constEnd())
+		{
+			distances.append(it.value());
+		}
+		else
+		{
+			distances.append(0.0);
+			missingPoints.append(points.at(i));
+			missingIndexes.append(i);
+		}
+	}
+
+	int count = missingPoints.size();
+	if (count > 0)
+	{
+		QVector<double> detailSizes(count, 0.0);
+		QVector<double> missingDistances(count);
+		QVector<sDistanceOut> outs(count);
+		CalculateDistanceBatch(*params, *fractals, missingPoints.constData(), detailSizes.constData(),
+			count, missingDistances.data(), outs.data());
+
+		if (cache.size() + count > DISTANCE_QUERY_CACHE_SIZE) cache.clear();
+		for (int i = 0; i < count; i++)
+		{
+			distances[missingIndexes[i]] = missingDistances[i];
+			cache.insert(PointKey(missingPoints[i]), missingDistances[i]);
+		}
+	}
+	return distances;
+}
+
+double cDistanceQuery::GetDistance(
+	CVector3 point, const cParameterContainer *par, const cFractalContainer *parFractal)
+{
+	QMutexLocker lock(&mutex);
+	PrepareParameters(par, parFractal);
+	return CalculateDistances(QList<CVector3>() << point).first();
+}
+
+int cDistanceQuery::Request(const QList<CVector3> &points, const cParameterContainer *par,
+	const cFractalContainer *parFractal)
+{
+	sRequest request;
+	request.points = points;
+	request.par = *par;
+	request.parFractal = *parFractal;
+
+	QMutexLocker lock(&mutex);
+	request.id = ++lastRequestId;
+	// worker is notified only once for all requests queued before it takes them
+	bool notify = pendingRequests.isEmpty();
+	pendingRequests.append(request);
+	lock.unlock();
+
+	if (notify) emit requestsQueued();
+	return request.id;
+}
+
+void cDistanceQuery::ProcessRequests()
+{
+	QList<int> ids;
+	QList<QList<double> /* */> results;
+
+	QMutexLocker lock(&mutex);
+	QList<sRequest> requests = pendingRequests;
+	pendingRequests.clear();
+
+	// consecutive requests with the same parameters are calculated in one batch
+	int first = 0;
+	while (first < requests.size())
+	{
+		QVector<quint64> hashes = ParameterHashes(&requests[first].par, &requests[first].parFractal);
+		QList<CVector3> points = requests[first].points;
+		int last = first + 1;
+		while (last < requests.size()
+					 && ParameterHashes(&requests[last].par, &requests[last].parFractal) == hashes)
+		{
+			points += requests[last].points;
+			last++;
+		}
+
+		PrepareParameters(&requests[first].par, &requests[first].parFractal);
+		QList<double> distances = CalculateDistances(points);
+
+		int offset = 0;
+		for (int i = first; i < last; i++)
+		{
+			int count = requests[i].points.size();
+			ids.append(requests[i].id);
+			results.append(distances.mid(offset, count));
+			offset += count;
+		}
+		first = last;
+	}
+	lock.unlock();
+
+	for (int i = 0; i < ids.size(); i++)
+		emit distancesCalculated(ids[i], results[i]);
+}
+
+void cDistanceQuery::ClearCache()
+{
+	QMutexLocker lock(&mutex);
+	cache.clear();
+}
+
+int cDistanceQuery::GetCacheSize()
+{
+	QMutexLocker lock(&mutex);
+	return cache.size();
+}
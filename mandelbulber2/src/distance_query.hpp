@@ -0,0 +1,152 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cDistanceQuery - distance estimation for interactive features
+ *
+ * Navigation, statistics and flight recording need distances to the fractal at single points.
+ * Preparation of rendering parameters takes much more time than calculation of the distance,
+ * so prepared parameters are kept until structural hash of any container changes. Calculated
+ * distances are cached by quantized position: the last DISTANCE_QUERY_QUANTIZATION_BITS of
+ * mantissa of every coordinate are ignored, so relative precision of the position is still
+ * better than 1e-12. Asynchronous requests are calculated in own thread. Requests which were
+ * queued while the thread was busy are calculated together in one batch.
+ */
+
+#ifndef MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_
+#define MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+#include "algebra.hpp"
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+
+// forward declarations
+class cNineFractals;
+class cParamRender;
+class QThread;
+
+// number of ignored least significant bits of mantissa of coordinates of cached points
+#define DISTANCE_QUERY_QUANTIZATION_BITS 12
+// maximum number of cached distances. Cache is cleared when it gets full
+#define DISTANCE_QUERY_CACHE_SIZE 4096
+
+class cDistanceQuery;
+
+// calculates queued requests in own thread
+class cDistanceQueryWorker : public QObject
+{
+	Q_OBJECT
+public:
+	explicit cDistanceQueryWorker(cDistanceQuery *_query) : QObject(), query(_query) {}
+
+public slots:
+	void slotProcessRequests();
+
+private:
+	cDistanceQuery *query;
+};
+
+class cDistanceQuery : public QObject
+{
+	Q_OBJECT
+public:
+	explicit cDistanceQuery(QObject *parent = NULL);
+	~cDistanceQuery();
+
+	// distance calculated in calling thread. Cached distance is used if available
+	double GetDistance(
+		CVector3 point, const cParameterContainer *par, const cFractalContainer *parFractal);
+	// queues calculation of distances. Containers are implicitly shared, so they are copied
+	// cheaply. Returns id of request which is sent back with distancesCalculated()
+	int Request(const QList<CVector3> &points, const cParameterContainer *par,
+		const cFractalContainer *parFractal);
+	// calculates all queued requests in calling thread
+	void ProcessRequests();
+	void ClearCache();
+	int GetCacheSize();
+
+signals:
+	// emitted from worker thread
+	void distancesCalculated(int requestId, QList<double> distances);
+	// internal signal to worker
+	void requestsQueued();
+
+private:
+	struct sRequest
+	{
+		int id;
+		QList<CVector3> points;
+		cParameterContainer par;
+		cFractalContainer parFractal;
+	};
+
+	struct sPointKey
+	{
+		quint64 x;
+		quint64 y;
+		quint64 z;
+		bool operator==(const sPointKey &other) const
+		{
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+
+	friend uint qHash(const sPointKey &key, uint seed);
+
+	static sPointKey PointKey(const CVector3 &point);
+	static QVector<quint64> ParameterHashes(
+		const cParameterContainer *par, const cFractalContainer *parFractal);
+	// prepares parameters if they have changed since the last query. Needs locked mutex
+	void PrepareParameters(const cParameterContainer *par, const cFractalContainer *parFractal);
+	// calculates distances of points which are not cached. Needs locked mutex
+	QList<double> CalculateDistances(const QList<CVector3> &points);
+
+	QThread *thread;
+	cDistanceQueryWorker *worker;
+
+	// protects everything below
+	QMutex mutex;
+	QList<sRequest> pendingRequests;
+	int lastRequestId;
+	QVector<quint64> preparedHashes;
+	cParamRender *params;
+	cNineFractals *fractals;
+	QHash<sPointKey, double> cache;
+};
+
+extern cDistanceQuery *gDistanceQuery;
+
+#endif /* MANDELBULBER2_SRC_DISTANCE_QUERY_HPP_ */
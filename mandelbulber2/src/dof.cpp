@@ -37,29 +37,49 @@
 #include "common_math.h"
 #include "global_data.hpp"
 #include "progress_text.hpp"
+#include "system.hpp"
+#include "trace.hpp"
 #include <algorithm>
 
 using std::max;
 using std::min;
 
 #define MAX_DOF_BLUR_SIZE 500.0
+// size of tiles in fast gather mode
+#define DOF_GATHER_TILE_SIZE 16
+// max number of sample rings in fast gather mode
+#define DOF_GATHER_MAX_RINGS 6
 
-cPostRenderingDOF::cPostRenderingDOF(cImage *_image) : QObject(), image(_image)
+cPostRenderingDOF::cPostRenderingDOF(cImage *_image) : QObject(), arena(NULL), image(_image)
 {
 }
 
+cJobArena::sMark cPostRenderingDOF::GetArenaMark() const
+{
+	cJobArena::sMark mark = {0, 0};
+	if (arena) mark = arena->GetMark();
+	return mark;
+}
+
+void cPostRenderingDOF::ReleaseArena(const cJobArena::sMark &mark)
+{
+	if (arena) arena->Release(mark);
+}
+
 void cPostRenderingDOF::Render(cRegion<int> screenRegion, double deep, double neutral,
 	bool floatVersion, int numberOfPasses, double blurOpacity, bool *stopRequest)
 {
+	TRACE_SCOPE("cPostRenderingDOF::Render", "post");
 	int imageWidth = image->GetWidth();
 	int imageHeight = image->GetHeight();
+	cJobArena::sMark arenaMark = GetArenaMark();
 
 	if (floatVersion)
 	{
-		sRGBfloat *temp_image = new sRGBfloat[imageWidth * imageHeight];
-		unsigned short *temp_alpha = new unsigned short[imageWidth * imageHeight];
+		sRGBfloat *temp_image = NewTempBuffer<sRGBfloat>(imageWidth * imageHeight);
+		unsigned short *temp_alpha = NewTempBuffer<unsigned short>(imageWidth * imageHeight);
 		long int sortBufferSize = screenRegion.height * screenRegion.width;
-		sSortZ<float> *temp_sort = new sSortZ<float>[sortBufferSize];
+		sSortZ<float> *temp_sort = NewTempBuffer<sSortZ<float> >(sortBufferSize);
 		long int index = 0;
 		for (int y = screenRegion.y1; y < screenRegion.y2; y++)
 		{
@@ -207,7 +227,7 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, double deep, double ne
 				statusText, QObject::tr("Sorting zBuffer"), 1.0 / (numberOfPasses + 1.0));
 			gApplication->processEvents();
 
-			QuickSortZBuffer(temp_sort, 1, sortBufferSize - 1);
+			RadixSortZBuffer(temp_sort, sortBufferSize);
 
 			for (int pass = 0; pass < numberOfPasses; pass++)
 			{
@@ -357,17 +377,17 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, double deep, double ne
 		catch (QString &status)
 		{
 			emit updateProgressAndStatus(statusText, status, 1.0);
-			delete[] temp_image;
-			delete[] temp_alpha;
-			delete[] temp_sort;
+			DeleteTempBuffer(temp_image);
+			DeleteTempBuffer(temp_alpha);
+			DeleteTempBuffer(temp_sort);
 		}
 	}
 	else //**************** integer version compatible with SSAO *******************
 	{
-		sRGB16 *temp_image = new sRGB16[imageWidth * imageHeight];
-		unsigned short *temp_alpha = new unsigned short[imageWidth * imageHeight];
+		sRGB16 *temp_image = NewTempBuffer<sRGB16>(imageWidth * imageHeight);
+		unsigned short *temp_alpha = NewTempBuffer<unsigned short>(imageWidth * imageHeight);
 		long int sortBufferSize = screenRegion.height * screenRegion.width;
-		sSortZ<float> *temp_sort = new sSortZ<float>[sortBufferSize];
+		sSortZ<float> *temp_sort = NewTempBuffer<sSortZ<float> >(sortBufferSize);
 		long int index = 0;
 		for (int y = screenRegion.y1; y < screenRegion.y2; y++)
 		{
@@ -513,7 +533,7 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, double deep, double ne
 				statusText, QObject::tr("Sorting zBuffer"), 1.0 / (numberOfPasses + 1.0));
 			gApplication->processEvents();
 
-			QuickSortZBuffer(temp_sort, 1, sortBufferSize - 1);
+			RadixSortZBuffer(temp_sort, sortBufferSize);
 
 			for (int pass = 0; pass < numberOfPasses; pass++)
 			{
@@ -663,57 +683,312 @@ void cPostRenderingDOF::Render(cRegion<int> screenRegion, double deep, double ne
 		catch (QString &status)
 		{
 			emit updateProgressAndStatus(statusText, status, 1.0);
-			delete[] temp_image;
-			delete[] temp_alpha;
-			delete[] temp_sort;
+			DeleteTempBuffer(temp_image);
+			DeleteTempBuffer(temp_alpha);
+			DeleteTempBuffer(temp_sort);
 		}
 	}
+	ReleaseArena(arenaMark);
 }
 
-template <class T>
-void cPostRenderingDOF::QuickSortZBuffer(sSortZ<T> *buffer, int l, int r)
+void cPostRenderingDOF::RenderGather(cRegion<int> screenRegion, double deep, double neutral,
+	bool floatVersion, bool *stopRequest)
 {
-	// Sorts buffer by value of z asc
-	int i, j;
-	// Operating buffer typed variables
-	sSortZ<T> pivot, swap;
-	i = l;
-	j = r;
-	// set pivot to center of buffer
-	pivot = buffer[(l + r) / 2];
-	do
+	TRACE_SCOPE("cPostRenderingDOF::RenderGather", "post");
+
+	// Fast approximation of DOF. Instead of scattering every pixel, each pixel gathers a fixed
+	// number of samples placed on rings. Image is divided into tiles and in-focus tiles, which can't
+	// be reached by blur of near objects, are skipped
+
+	int imageWidth = image->GetWidth();
+	int width = screenRegion.width;
+	int height = screenRegion.height;
+	if (width <= 0 || height <= 0) return;
+	cJobArena::sMark arenaMark = GetArenaMark();
+
+	QString statusText = QObject::tr("Rendering Depth Of Field effect (fast gather)");
+	cProgressText progressText;
+	progressText.ResetTimer();
+	emit updateProgressAndStatus(statusText, progressText.getText(0.0), 0.0);
+	gApplication->processEvents();
+
+	// circle of confusion (signed: negative for near, positive for far objects)
+	float *coc = NewTempBuffer<float>(width * height);
+	sRGBfloat *source = NewTempBuffer<sRGBfloat>(width * height);
+	float *sourceAlpha = NewTempBuffer<float>(width * height);
+	sRGBfloat *temp_image = NewTempBuffer<sRGBfloat>(width * height);
+	float *temp_alpha = NewTempBuffer<float>(width * height);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int sx = x + screenRegion.x1;
+			int sy = y + screenRegion.y1;
+			int ptr = x + y * width;
+			double z = image->GetPixelZBuffer(sx, sy);
+			double blur = (z - neutral) / z * deep;
+			coc[ptr] = clamp(blur, -MAX_DOF_BLUR_SIZE, MAX_DOF_BLUR_SIZE);
+			if (floatVersion)
+			{
+				source[ptr] = image->GetPixelImage(sx, sy);
+			}
+			else
+			{
+				sRGB16 pixel = image->GetPixelImage16(sx, sy);
+				source[ptr] = sRGBfloat(pixel.R, pixel.G, pixel.B);
+			}
+			sourceAlpha[ptr] = image->GetPixelAlpha(sx, sy);
+		}
+	}
+
+	// max CoC of each tile, spread to all tiles which can be reached by the blur
+	int tilesX = (width + DOF_GATHER_TILE_SIZE - 1) / DOF_GATHER_TILE_SIZE;
+	int tilesY = (height + DOF_GATHER_TILE_SIZE - 1) / DOF_GATHER_TILE_SIZE;
+	float *tileMaxCoc = NewTempBuffer<float>(tilesX * tilesY);
+	float *tileMaxCocTemp = NewTempBuffer<float>(tilesX * tilesY);
+
+	for (int ty = 0; ty < tilesY; ty++)
 	{
-		while (buffer[i].z < pivot.z)
+		for (int tx = 0; tx < tilesX; tx++)
 		{
-			i++;
+			float maxCoc = 0.0f;
+			int yEnd = min((ty + 1) * DOF_GATHER_TILE_SIZE, height);
+			int xEnd = min((tx + 1) * DOF_GATHER_TILE_SIZE, width);
+			for (int y = ty * DOF_GATHER_TILE_SIZE; y < yEnd; y++)
+				for (int x = tx * DOF_GATHER_TILE_SIZE; x < xEnd; x++)
+					maxCoc = max(maxCoc, fabsf(coc[x + y * width]));
+			tileMaxCoc[tx + ty * tilesX] = maxCoc;
+			tileMaxCocTemp[tx + ty * tilesX] = 0.0f;
+		}
+	}
+
+	// separable dilation (horizontal then vertical)
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			float maxCoc = tileMaxCoc[tx + ty * tilesX];
+			int reach = ceil(maxCoc / DOF_GATHER_TILE_SIZE);
+			for (int dx = max(tx - reach, 0); dx <= min(tx + reach, tilesX - 1); dx++)
+				tileMaxCocTemp[dx + ty * tilesX] = max(tileMaxCocTemp[dx + ty * tilesX], maxCoc);
+		}
+	}
+	for (int i = 0; i < tilesX * tilesY; i++)
+		tileMaxCoc[i] = 0.0f;
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			float maxCoc = tileMaxCocTemp[tx + ty * tilesX];
+			int reach = ceil(maxCoc / DOF_GATHER_TILE_SIZE);
+			for (int dy = max(ty - reach, 0); dy <= min(ty + reach, tilesY - 1); dy++)
+				tileMaxCoc[tx + dy * tilesX] = max(tileMaxCoc[tx + dy * tilesX], maxCoc);
+		}
+	}
+
+	QElapsedTimer timerRefreshProgressBar;
+	timerRefreshProgressBar.start();
+
+	bool stopped = false;
+	for (int y = 0; y < height; y++)
+	{
+		if (*stopRequest)
+		{
+			stopped = true;
+			break;
+		}
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int x = 0; x < width; x++)
+		{
+			int ptr = x + y * width;
+			float radius = tileMaxCoc[x / DOF_GATHER_TILE_SIZE + (y / DOF_GATHER_TILE_SIZE) * tilesX];
+
+			// nothing around is blurred enough to change this pixel
+			if (radius < 0.5f)
+			{
+				temp_image[ptr] = source[ptr];
+				temp_alpha[ptr] = sourceAlpha[ptr];
+				continue;
+			}
+
+			float centerCoc = fabsf(coc[ptr]);
+			int rings = clamp(int(ceil(radius / 2.0f)), 1, DOF_GATHER_MAX_RINGS);
+			int numberOfSamples = 1 + 4 * rings * (rings + 1);
+			// area of image represented by one sample
+			float sampleArea = M_PI * radius * radius / numberOfSamples;
+
+			sRGBfloat sum;
+			float sumAlpha = 0.0f;
+			float totalWeight = 0.0f;
+
+			for (int ring = 0; ring <= rings; ring++)
+			{
+				float r = radius * ring / rings;
+				int samplesInRing = (ring == 0) ? 1 : ring * 8;
+				for (int i = 0; i < samplesInRing; i++)
+				{
+					// rings are rotated to avoid visible spokes
+					float angle = (i + 0.5f * ring) * 2.0f * M_PI / samplesInRing;
+					int sx = x + int(floorf(r * cosf(angle) + 0.5f));
+					int sy = y + int(floorf(r * sinf(angle) + 0.5f));
+					if (sx < 0 || sx >= width || sy < 0 || sy >= height) continue;
+
+					int samplePtr = sx + sy * width;
+					float sampleCoc = fabsf(coc[samplePtr]);
+					// background can't be blurred over sharper objects in front of it (near/far layers)
+					if (coc[samplePtr] > coc[ptr]) sampleCoc = min(sampleCoc, max(centerCoc, 0.5f));
+
+					float coverage = clamp(sampleCoc - r + 1.0f, 0.0f, 1.0f);
+					if (coverage <= 0.0f) continue;
+					// energy of blurred sample is distributed over its whole circle of confusion
+					float weight =
+						coverage * sampleArea / max(float(M_PI) * sampleCoc * sampleCoc, sampleArea);
+
+					sRGBfloat pixel = source[samplePtr];
+					sum.R += pixel.R * weight;
+					sum.G += pixel.G * weight;
+					sum.B += pixel.B * weight;
+					sumAlpha += sourceAlpha[samplePtr] * weight;
+					totalWeight += weight;
+				}
+			}
+
+			if (totalWeight > 0.0f)
+			{
+				temp_image[ptr] = sRGBfloat(sum.R / totalWeight, sum.G / totalWeight, sum.B / totalWeight);
+				temp_alpha[ptr] = sumAlpha / totalWeight;
+			}
+			else
+			{
+				temp_image[ptr] = source[ptr];
+				temp_alpha[ptr] = sourceAlpha[ptr];
+			}
 		}
-		while (pivot.z < buffer[j].z)
+
+		if (timerRefreshProgressBar.elapsed() > 100)
 		{
-			j--;
+			timerRefreshProgressBar.restart();
+			double percentDone = (double)y / height;
+			emit updateProgressAndStatus(statusText, progressText.getText(percentDone), percentDone);
+			gApplication->processEvents();
 		}
-		if (i <= j)
+	}
+
+	if (!stopped)
+	{
+		for (int y = 0; y < height; y++)
 		{
-			/* buffer[i] is to the left of pivot but greater
-			 *  buffer[j] is to the right of pivot but smaller
-			 * -> swap values of buffer[i] <> buffer[j] */
-			swap = buffer[i];
-			buffer[i] = buffer[j];
-			buffer[j] = swap;
-			i++;
-			j--;
+			for (int x = 0; x < width; x++)
+			{
+				int sx = x + screenRegion.x1;
+				int sy = y + screenRegion.y1;
+				int ptr = x + y * width;
+				sRGBfloat pixel = temp_image[ptr];
+				if (floatVersion)
+				{
+					image->PutPixelImage(sx, sy, pixel);
+				}
+				else
+				{
+					image->PutPixelImage16(sx, sy, sRGB16(pixel.R, pixel.G, pixel.B));
+				}
+				image->PutPixelAlpha(sx, sy, temp_alpha[ptr]);
+			}
 		}
-	} while (i <= j);
+		if (floatVersion) image->CompileImage();
+		emit updateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
+	}
+	else
+	{
+		emit updateProgressAndStatus(statusText, tr("DOF terminated"), 1.0);
+	}
+
+	DeleteTempBuffer(coc);
+	DeleteTempBuffer(source);
+	DeleteTempBuffer(sourceAlpha);
+	DeleteTempBuffer(temp_image);
+	DeleteTempBuffer(temp_alpha);
+	DeleteTempBuffer(tileMaxCoc);
+	DeleteTempBuffer(tileMaxCocTemp);
+	ReleaseArena(arenaMark);
+}
 
-	// sort left side of pivot element
-	if (l < j)
+int cPostRenderingDOF::GetMaxBlurRadius(
+	const cImage *image, const cRegion<int> &region, double deep, double neutral)
+{
+	QVector<double> lineMaxBlur(region.height);
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < region.height; y++)
 	{
-		QuickSortZBuffer(buffer, l, j);
+		double maxBlur = 0.0;
+		for (int x = region.x1; x < region.x2; x++)
+		{
+			double z = image->GetPixelZBuffer(x, y + region.y1);
+			double blur = fabs(z - neutral) / z * deep + 1.0;
+			maxBlur = max(maxBlur, blur);
+		}
+		lineMaxBlur[y] = maxBlur;
 	}
 
-	// sort right side of pivot element
-	if (i < r)
+	double maxBlur = 0.0;
+	for (int y = 0; y < region.height; y++)
+		maxBlur = max(maxBlur, lineMaxBlur[y]);
+	return int(ceil(min(maxBlur, MAX_DOF_BLUR_SIZE)));
+}
+
+void cPostRenderingDOF::RadixSortZBuffer(sSortZ<float> *buffer, qint64 size)
+{
+	// Sorts buffer by value of z asc. LSD radix sort, 8 bits per pass. Every thread counts and
+	// scatters its own contiguous chunk, so the sort stays stable
+	const int numberOfChunks = max(systemData.numberOfThreads, 1);
+	qint64 chunkSize = (size + numberOfChunks - 1) / numberOfChunks;
+
+	sSortZ<float> *source = buffer;
+	sSortZ<float> *destination = new sSortZ<float>[size];
+	qint64 *offsets = new qint64[numberOfChunks * 256];
+
+	for (int shift = 0; shift < 32; shift += 8)
 	{
-		QuickSortZBuffer(buffer, i, r);
+		memset(offsets, 0, sizeof(qint64) * numberOfChunks * 256);
+
+#pragma omp parallel for schedule(static, 1)
+		for (int chunk = 0; chunk < numberOfChunks; chunk++)
+		{
+			qint64 *counts = &offsets[chunk * 256];
+			qint64 end = min((chunk + 1) * chunkSize, size);
+			for (qint64 i = chunk * chunkSize; i < end; i++)
+				counts[(SortKey(source[i].z) >> shift) & 0xFF]++;
+		}
+
+		// digit-major order of chunks gives starting position of each chunk in each bucket
+		qint64 position = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			for (int chunk = 0; chunk < numberOfChunks; chunk++)
+			{
+				qint64 count = offsets[chunk * 256 + digit];
+				offsets[chunk * 256 + digit] = position;
+				position += count;
+			}
+		}
+
+#pragma omp parallel for schedule(static, 1)
+		for (int chunk = 0; chunk < numberOfChunks; chunk++)
+		{
+			qint64 *positions = &offsets[chunk * 256];
+			qint64 end = min((chunk + 1) * chunkSize, size);
+			for (qint64 i = chunk * chunkSize; i < end; i++)
+				destination[positions[(SortKey(source[i].z) >> shift) & 0xFF]++] = source[i];
+		}
+
+		std::swap(source, destination);
 	}
+
+	// even number of passes, so sorted data is back in buffer and destination is the temporary one
+	delete[] destination;
+	delete[] offsets;
 }
-template void cPostRenderingDOF::QuickSortZBuffer<double>(sSortZ<double> *buffer, int l, int p);
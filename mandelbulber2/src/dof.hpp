@@ -35,7 +35,10 @@
 #ifndef MANDELBULBER2_SRC_DOF_HPP_
 #define MANDELBULBER2_SRC_DOF_HPP_
 
+#include <cstring>
+
 #include "cimage.hpp"
+#include "job_arena.hpp"
 #include "region.hpp"
 
 class cPostRenderingDOF : public QObject
@@ -51,13 +54,45 @@ private:
 		int i;
 	};
 
+	// maps float to unsigned integer with the same ordering
+	static quint32 SortKey(float z)
+	{
+		quint32 bits;
+		memcpy(&bits, &z, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	// temporary buffers are taken from the arena of render job if it's set
+	template <typename T>
+	T *NewTempBuffer(qint64 size)
+	{
+		return arena ? arena->NewArray<T>(size) : new T[size];
+	}
+	template <typename T>
+	void DeleteTempBuffer(T *buffer)
+	{
+		if (!arena) delete[] buffer;
+	}
+	cJobArena::sMark GetArenaMark() const;
+	void ReleaseArena(const cJobArena::sMark &mark);
+
+	cJobArena *arena;
+
 public:
 	cPostRenderingDOF(cImage *_image);
+	// buffers are released to the arena at the end of every call of Render()
+	void SetArena(cJobArena *_arena) { arena = _arena; }
 
 	void Render(cRegion<int> screenRegion, double deep, double neutral, bool floatVersion,
 		int numberOfPasses, double blurOpacity, bool *stopRequest);
-	template <class T>
-	void QuickSortZBuffer(sSortZ<T> *buffer, int l, int p);
+	// fast tiled gather approximation of DOF used for previews and animation drafts
+	void RenderGather(cRegion<int> screenRegion, double deep, double neutral, bool floatVersion,
+		bool *stopRequest);
+	// largest blur radius (in pixels) of the region. Effect changes pixels only within this range
+	static int GetMaxBlurRadius(
+		const cImage *image, const cRegion<int> &region, double deep, double neutral);
+	// parallel radix sort of z-buffer (ascending)
+	static void RadixSortZBuffer(sSortZ<float> *buffer, qint64 size);
 
 	cImage *image;
 
@@ -0,0 +1,208 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * double-double numbers for deep zooms
+ *
+ * sDoubleDouble keeps a number as unevaluated sum of two doubles (hi + lo), which
+ * gives about 106 bits of mantissa. Arithmetic uses error-free transformations
+ * (TwoSum and fused multiply-add) and is several times faster than generic
+ * arbitrary precision libraries.
+ */
+
+
+#ifndef MANDELBULBER2_SRC_DOUBLE_DOUBLE_HPP_
+#define MANDELBULBER2_SRC_DOUBLE_DOUBLE_HPP_
+
+#include <math.h>
+
+#include "algebra.hpp"
+
+// a + b = sum + *error. Every intermediate result is volatile, because -ffast-math would
+// reassociate the expressions and remove the rounding error
+inline double DDTwoSum(double a, double b, double *error)
+{
+	volatile double s = a + b;
+	volatile double bb = s - a;
+	volatile double aa = s - bb;
+	volatile double errorA = a - aa;
+	volatile double errorB = b - bb;
+	*error = errorA + errorB;
+	return s;
+}
+
+// the same as DDTwoSum() when |a| >= |b|
+inline double DDQuickTwoSum(double a, double b, double *error)
+{
+	volatile double s = a + b;
+	volatile double bb = s - a;
+	*error = b - bb;
+	return s;
+}
+
+// a * b = product + *error
+inline double DDTwoProd(double a, double b, double *error)
+{
+	volatile double p = a * b;
+	*error = fma(a, b, -p);
+	return p;
+}
+
+struct sDoubleDouble
+{
+	sDoubleDouble() : hi(0.0), lo(0.0) {}
+	sDoubleDouble(double _hi) : hi(_hi), lo(0.0) {}
+	sDoubleDouble(double _hi, double _lo) : hi(_hi), lo(_lo) {}
+
+	double ToDouble() const { return hi + lo; }
+
+	inline sDoubleDouble operator-() const { return sDoubleDouble(-hi, -lo); }
+	inline sDoubleDouble &operator+=(const sDoubleDouble &b);
+	inline sDoubleDouble &operator-=(const sDoubleDouble &b);
+	inline sDoubleDouble &operator*=(const sDoubleDouble &b);
+	inline sDoubleDouble &operator/=(const sDoubleDouble &b);
+
+	double hi;
+	double lo;
+};
+
+inline sDoubleDouble operator+(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	double e;
+	double s = DDTwoSum(a.hi, b.hi, &e);
+	e += a.lo + b.lo;
+	s = DDQuickTwoSum(s, e, &e);
+	return sDoubleDouble(s, e);
+}
+
+inline sDoubleDouble operator-(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	return a + (-b);
+}
+
+inline sDoubleDouble operator*(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	double e;
+	double p = DDTwoProd(a.hi, b.hi, &e);
+	e += a.hi * b.lo + a.lo * b.hi;
+	p = DDQuickTwoSum(p, e, &e);
+	return sDoubleDouble(p, e);
+}
+
+inline sDoubleDouble operator/(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	// quotient approximated in double and corrected with the remainder
+	double q1 = a.hi / b.hi;
+	sDoubleDouble r = a - b * sDoubleDouble(q1);
+	double q2 = r.hi / b.hi;
+	double e;
+	q1 = DDQuickTwoSum(q1, q2, &e);
+	return sDoubleDouble(q1, e);
+}
+
+inline sDoubleDouble &sDoubleDouble::operator+=(const sDoubleDouble &b)
+{
+	return *this = *this + b;
+}
+
+inline sDoubleDouble &sDoubleDouble::operator-=(const sDoubleDouble &b)
+{
+	return *this = *this - b;
+}
+
+inline sDoubleDouble &sDoubleDouble::operator*=(const sDoubleDouble &b)
+{
+	return *this = *this * b;
+}
+
+inline sDoubleDouble &sDoubleDouble::operator/=(const sDoubleDouble &b)
+{
+	return *this = *this / b;
+}
+
+inline bool operator<(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline bool operator>(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	return b < a;
+}
+
+inline bool operator<=(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	return !(b < a);
+}
+
+inline bool operator>=(const sDoubleDouble &a, const sDoubleDouble &b)
+{
+	return !(a < b);
+}
+
+inline sDoubleDouble fabs(const sDoubleDouble &a)
+{
+	return (a.hi < 0.0) ? -a : a;
+}
+
+inline sDoubleDouble sqrt(const sDoubleDouble &a)
+{
+	if (a.hi <= 0.0) return sDoubleDouble();
+	// one Newton step from double square root
+	double x = sqrt(a.hi);
+	double e;
+	double x2 = DDTwoProd(x, x, &e);
+	sDoubleDouble r = a - sDoubleDouble(x2, e);
+	double correction = r.hi / (2.0 * x);
+	x = DDQuickTwoSum(x, correction, &e);
+	return sDoubleDouble(x, e);
+}
+
+// low part of point calculated as start + direction * scan and rounded to double (point)
+inline CVector3 DDPointResidual(
+	const CVector3 &start, const CVector3 &direction, double scan, const CVector3 &point)
+{
+	sDoubleDouble s(scan);
+	sDoubleDouble x = sDoubleDouble(start.x) + sDoubleDouble(direction.x) * s - point.x;
+	sDoubleDouble y = sDoubleDouble(start.y) + sDoubleDouble(direction.y) * s - point.y;
+	sDoubleDouble z = sDoubleDouble(start.z) + sDoubleDouble(direction.z) * s - point.z;
+	return CVector3(x.ToDouble(), y.ToDouble(), z.ToDouble());
+}
+
+// low part of point calculated as a + b and rounded to double (sum)
+inline CVector3 DDSumResidual(const CVector3 &a, const CVector3 &b, const CVector3 &sum)
+{
+	sDoubleDouble x = sDoubleDouble(a.x) + b.x - sum.x;
+	sDoubleDouble y = sDoubleDouble(a.y) + b.y - sum.y;
+	sDoubleDouble z = sDoubleDouble(a.z) + b.z - sum.z;
+	return CVector3(x.ToDouble(), y.ToDouble(), z.ToDouble());
+}
+
+#endif /* MANDELBULBER2_SRC_DOUBLE_DOUBLE_HPP_ */
@@ -0,0 +1,148 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cEmptySpaceMap class - skipping of empty space in volume export
+ *
+ * Volume is processed in layers. Points of the layer are calculated hierarchically,
+ * starting from a coarse grid. Distance estimated in already calculated points is
+ * a lower bound of distance to the surface around them, so points which are proven
+ * to be far from the surface don't need to be calculated. Bounds are carried to the
+ * next layer as well.
+ */
+
+#include "empty_space_map.hpp"
+
+#include <math.h>
+#include <QtGlobal>
+
+// number of levels of hierarchy. Coarsest grid has every 8th point
+#define EMPTY_SPACE_LEVELS 4
+
+cEmptySpaceMap::cEmptySpaceMap(int width, int height, double stepA, double stepB,
+	double stepLayer, double safetyFactor, double skipDistance)
+{
+	this->width = width;
+	this->height = height;
+	this->stepA = stepA;
+	this->stepB = stepB;
+	this->stepLayer = stepLayer;
+	this->safetyFactor = safetyFactor;
+	this->skipDistance = skipDistance;
+	numberOfLevels = EMPTY_SPACE_LEVELS;
+	bound.fill(0.0, width * height);
+	state.fill(stateUnknown, width * height);
+	numberOfCalculated = 0;
+	numberOfSkipped = 0;
+}
+
+cEmptySpaceMap::~cEmptySpaceMap()
+{
+}
+
+void cEmptySpaceMap::NextLayer()
+{
+	for (int i = 0; i < bound.size(); i++)
+	{
+		// for the first layer all points are unknown and bounds are 0
+		if (state[i] != stateUnknown) bound[i] = qMax(0.0, bound[i] - stepLayer);
+		state[i] = stateUnknown;
+	}
+}
+
+void cEmptySpaceMap::NextLayer(const cEmptySpaceMap &previous, int layerDistance)
+{
+	// previous can be the same map
+	for (int i = 0; i < bound.size(); i++)
+	{
+		if (previous.state[i] != stateUnknown)
+			bound[i] = qMax(0.0, previous.bound[i] - stepLayer * layerDistance);
+		else
+			bound[i] = 0.0;
+		state[i] = stateUnknown;
+	}
+}
+
+QVector<int> cEmptySpaceMap::PointsToCalculate(int level)
+{
+	QVector<int> list;
+	int stride = 1 << level;
+	int parentStride = stride * 2;
+	bool topLevel = level == numberOfLevels - 1;
+
+	for (int b = 0; b < height; b += stride)
+	{
+		for (int a = 0; a < width; a += stride)
+		{
+			// points of coarser grid are already processed
+			if (!topLevel && a % parentStride == 0 && b % parentStride == 0) continue;
+
+			int index = a + b * width;
+			double pointBound = bound[index];
+
+			if (!topLevel)
+			{
+				// corners of cell of coarser grid
+				int a0 = a - a % parentStride;
+				int b0 = b - b % parentStride;
+				for (int cb = b0; cb <= b0 + parentStride && cb < height; cb += parentStride)
+				{
+					for (int ca = a0; ca <= a0 + parentStride && ca < width; ca += parentStride)
+					{
+						int cornerIndex = ca + cb * width;
+						if (state[cornerIndex] == stateUnknown) continue;
+						double da = (a - ca) * stepA;
+						double db = (b - cb) * stepB;
+						pointBound = qMax(pointBound, bound[cornerIndex] - sqrt(da * da + db * db));
+					}
+				}
+			}
+
+			bound[index] = pointBound;
+			if (pointBound > skipDistance)
+			{
+				state[index] = stateSkipped;
+				numberOfSkipped++;
+			}
+			else
+			{
+				list.append(index);
+				numberOfCalculated++;
+			}
+		}
+	}
+	return list;
+}
+
+void cEmptySpaceMap::SetDistance(int index, double distance)
+{
+	bound[index] = qMax(0.0, distance * safetyFactor);
+	state[index] = stateCalculated;
+}
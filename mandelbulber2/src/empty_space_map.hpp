@@ -0,0 +1,93 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cEmptySpaceMap class - skipping of empty space in volume export
+ *
+ * Volume is processed in layers. Points of the layer are calculated hierarchically,
+ * starting from a coarse grid. Distance estimated in already calculated points is
+ * a lower bound of distance to the surface around them, so points which are proven
+ * to be far from the surface don't need to be calculated. Bounds are carried to the
+ * next layer as well.
+ */
+
+#ifndef MANDELBULBER2_SRC_EMPTY_SPACE_MAP_HPP_
+#define MANDELBULBER2_SRC_EMPTY_SPACE_MAP_HPP_
+
+#include <QVector>
+
+class cEmptySpaceMap
+{
+public:
+	// width and height are numbers of points in layer, stepA and stepB are distances between
+	// points along width and height, stepLayer is distance between layers.
+	// Points further from the surface than skipDistance are not calculated
+	cEmptySpaceMap(int width, int height, double stepA, double stepB, double stepLayer,
+		double safetyFactor, double skipDistance);
+	~cEmptySpaceMap();
+
+	// starts next layer. Bounds of distance are taken from previous layer
+	void NextLayer();
+	// starts layer which is layerDistance layers after the last layer of other map
+	void NextLayer(const cEmptySpaceMap &previous, int layerDistance);
+	int GetNumberOfLevels() const { return numberOfLevels; }
+	// indexes (a + b * width) of points of given level which have to be calculated
+	QVector<int> PointsToCalculate(int level);
+	// stores distance of calculated point. Can be called from many threads for different points
+	void SetDistance(int index, double distance);
+	bool IsCalculated(int index) const { return state[index] == stateCalculated; }
+	double GetDistanceBound(int index) const { return bound[index]; }
+
+	qint64 GetNumberOfCalculated() const { return numberOfCalculated; }
+	qint64 GetNumberOfSkipped() const { return numberOfSkipped; }
+
+private:
+	enum enumPointState
+	{
+		stateUnknown,
+		stateCalculated,
+		stateSkipped
+	};
+
+	int width;
+	int height;
+	double stepA;
+	double stepB;
+	double stepLayer;
+	double safetyFactor;
+	double skipDistance;
+	int numberOfLevels;
+	QVector<double> bound;
+	QVector<char> state;
+	qint64 numberOfCalculated;
+	qint64 numberOfSkipped;
+};
+
+#endif /* MANDELBULBER2_SRC_EMPTY_SPACE_MAP_HPP_ */
@@ -47,7 +47,9 @@ void cErrorMessage::showMessage(QString text, enumMessageType messageType, QWidg
 
 	QString messageText;
 
-	if (qobject_cast<QApplication *>(gApplication))
+	// message boxes can be shown only from GUI thread. Other threads print messages to console
+	if (qobject_cast<QApplication *>(gApplication)
+			&& QThread::currentThread() == gApplication->thread())
 	{
 		if (messageType == warningMessage)
 			messageText = QObject::tr("Warning");
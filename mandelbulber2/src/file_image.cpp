@@ -41,20 +41,35 @@
 #include "initparameters.hpp"
 #include "parameters.hpp"
 #include "cimage.hpp"
+#include "system.hpp"
 
 #define PNG_DEBUG 3
 
 #ifdef USE_TIFF
 #include "tiff.h"
 #include "tiffio.h"
+#include <zlib.h>
+
+// number of image lines compressed together
+#define TIFF_ROWS_PER_STRIP 64
 #endif // USE_TIFF
 
+#ifdef USE_JPEG
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+
+// number of image lines passed to encoder in one call
+#define JPEG_LINES_PER_CALL 16
+#endif // USE_JPEG
+
 #ifdef USE_EXR
 #include <ImfAttribute.h>
 #include <ImfChannelList.h>
 #include <ImfFrameBuffer.h>
 #include <ImfInputFile.h>
 #include <ImfOutputFile.h>
+#include <ImfThreading.h>
 #include <half.h>
 #endif // USE_EXR
 
@@ -106,6 +121,9 @@ QString ImageFileSave::ImageChannelName(enumImageContentType imageContentType)
 		case IMAGE_CONTENT_ALPHA: return "alpha"; break;
 		case IMAGE_CONTENT_ZBUFFER: return "zbuffer"; break;
 		case IMAGE_CONTENT_NORMAL: return "normal"; break;
+		case IMAGE_CONTENT_WORLD_POSITION: return "world_position"; break;
+		case IMAGE_CONTENT_OBJECT_ID: return "object_id"; break;
+		case IMAGE_CONTENT_COST: return "cost"; break;
 	}
 	return "";
 }
@@ -149,8 +167,13 @@ void ImageFileSavePNG::SaveImage()
 			case IMAGE_CONTENT_ALPHA:
 				if (!appendAlpha) SavePNG(fullFilename, image, channel.value());
 				break;
+			case IMAGE_CONTENT_WORLD_POSITION:
+			case IMAGE_CONTENT_OBJECT_ID:
+				qWarning() << "PNG cannot save" << ImageChannelName(currentChannelKey) << "(only EXR)";
+				break;
 			case IMAGE_CONTENT_ZBUFFER:
 			case IMAGE_CONTENT_NORMAL:
+			case IMAGE_CONTENT_COST:
 			default: SavePNG(fullFilename, image, channel.value()); break;
 		}
 	}
@@ -175,20 +198,28 @@ void ImageFileSaveJPG::SaveImage()
 		switch (currentChannelKey)
 		{
 			case IMAGE_CONTENT_COLOR:
-				SaveJPEGQt(fullFilename, image->ConvertTo8bit(), image->GetWidth(), image->GetHeight(),
+				SaveJPEG(fullFilename, image->ConvertTo8bit(), image->GetWidth(), image->GetHeight(),
 					gPar->Get<int>("jpeg_quality"));
 				break;
 			case IMAGE_CONTENT_ALPHA:
-				SaveJPEGQtGreyscale(fullFilename, image->ConvertAlphaTo8bit(), image->GetWidth(),
-					image->GetHeight(), gPar->Get<int>("jpeg_quality"));
+				SaveJPEG(fullFilename, image->ConvertAlphaTo8bit(), image->GetWidth(),
+					image->GetHeight(), gPar->Get<int>("jpeg_quality"), true);
 				break;
 			case IMAGE_CONTENT_ZBUFFER:
 				qWarning() << "JPG cannot save zbuffer (loss of precision to strong)";
 				break;
 			case IMAGE_CONTENT_NORMAL:
-				SaveJPEGQt(fullFilename, image->ConvertNormalto8Bit(), image->GetWidth(),
+				SaveJPEG(fullFilename, image->ConvertNormalto8Bit(), image->GetWidth(),
 					image->GetHeight(), gPar->Get<int>("jpeg_quality"));
 				break;
+			case IMAGE_CONTENT_COST:
+				SaveJPEG(fullFilename, image->ConvertCostTo8Bit(), image->GetWidth(), image->GetHeight(),
+					gPar->Get<int>("jpeg_quality"));
+				break;
+			case IMAGE_CONTENT_WORLD_POSITION:
+			case IMAGE_CONTENT_OBJECT_ID:
+				qWarning() << "JPG cannot save" << ImageChannelName(currentChannelKey) << "(only EXR)";
+				break;
 			default: qWarning() << "Unknown channel for JPG"; break;
 		}
 	}
@@ -221,6 +252,11 @@ void ImageFileSaveTIFF::SaveImage()
 			case IMAGE_CONTENT_ALPHA:
 				if (!appendAlpha) SaveTIFF(fullFilename, image, channel.value());
 				break;
+			case IMAGE_CONTENT_WORLD_POSITION:
+			case IMAGE_CONTENT_OBJECT_ID:
+			case IMAGE_CONTENT_COST:
+				qWarning() << "TIFF cannot save" << ImageChannelName(currentChannelKey) << "(only EXR)";
+				break;
 			case IMAGE_CONTENT_ZBUFFER:
 			case IMAGE_CONTENT_NORMAL:
 			default: SaveTIFF(fullFilename, image, channel.value()); break;
@@ -240,6 +276,69 @@ void ImageFileSaveEXR::SaveImage()
 }
 #endif /* USE_EXR */
 
+void ImageFileSavePNG::ConvertPNGLine(cImage *image, const structSaveImageChannel &imageChannel,
+	bool appendAlpha, uint64_t y, char *linePtr, float minZ, double kZ)
+{
+	uint64_t width = image->GetWidth();
+	for (uint64_t x = 0; x < width; x++)
+	{
+		switch (imageChannel.contentType)
+		{
+			case IMAGE_CONTENT_COLOR:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+				{
+					if (appendAlpha)
+					{
+						sRGBA16 *typedColorPtr = &((sRGBA16 *)linePtr)[x];
+						*typedColorPtr = sRGBA16(image->GetPixelImage16(x, y));
+						typedColorPtr->A = image->GetPixelAlpha(x, y);
+					}
+				}
+				else
+				{
+					if (appendAlpha)
+					{
+						sRGBA8 *typedColorPtr = &((sRGBA8 *)linePtr)[x];
+						*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
+						typedColorPtr->A = image->GetPixelAlpha8(x, y);
+					}
+				}
+			}
+			break;
+			case IMAGE_CONTENT_ALPHA:
+				// all alpha savings to PNG happen directly on buffers in cimage
+				break;
+			case IMAGE_CONTENT_ZBUFFER:
+			{
+				float z = image->GetPixelZBuffer(x, y);
+				float z1 = log(z / minZ) / kZ;
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+				{
+					int intZ = z1 * 60000;
+					if (z > 1e19) intZ = 65535;
+					((unsigned short *)linePtr)[x] = (unsigned short)(intZ);
+				}
+				else
+				{
+					int intZ = z1 * 240;
+					if (z > 1e19) intZ = 255;
+					((unsigned char *)linePtr)[x] = (unsigned char)(intZ);
+				}
+			}
+			break;
+			case IMAGE_CONTENT_NORMAL:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+					((sRGB16 *)linePtr)[x] = sRGB16(image->GetPixelNormal16(x, y));
+				else
+					((sRGB8 *)linePtr)[x] = sRGB8(image->GetPixelNormal8(x, y));
+			}
+			break;
+		}
+	}
+}
+
 void ImageFileSavePNG::SavePNG(
 	QString filename, cImage *image, structSaveImageChannel imageChannel, bool appendAlpha)
 {
@@ -277,6 +376,9 @@ void ImageFileSavePNG::SavePNG(
 			// for PNG no more than 16 bit per channel possible
 			imageChannel.channelQuality = IMAGE_CHANNEL_QUALITY_16;
 		}
+		// cost heatmap is only available as 8-bit colours
+		if (imageChannel.contentType == IMAGE_CONTENT_COST)
+			imageChannel.channelQuality = IMAGE_CHANNEL_QUALITY_8;
 
 		int qualitySize;
 		switch (imageChannel.channelQuality)
@@ -296,6 +398,7 @@ void ImageFileSavePNG::SavePNG(
 			case IMAGE_CONTENT_ALPHA: colorType = PNG_COLOR_TYPE_GRAY; break;
 			case IMAGE_CONTENT_ZBUFFER: colorType = PNG_COLOR_TYPE_GRAY; break;
 			case IMAGE_CONTENT_NORMAL: colorType = PNG_COLOR_TYPE_RGB; break;
+			case IMAGE_CONTENT_COST: colorType = PNG_COLOR_TYPE_RGB; break;
 			default: colorType = PNG_COLOR_TYPE_RGB; break;
 		}
 
@@ -320,11 +423,18 @@ void ImageFileSavePNG::SavePNG(
 			case IMAGE_CONTENT_ALPHA: pixelSize *= 1; break;
 			case IMAGE_CONTENT_ZBUFFER: pixelSize *= 1; break;
 			case IMAGE_CONTENT_NORMAL: pixelSize *= 3; break;
+			case IMAGE_CONTENT_COST: pixelSize *= 3; break;
 		}
 
+		uint64_t chunkSize = 100;
+		float minZ = 1.0e50;
+		float maxZ = 0.0;
+		double kZ = 0.0;
+
 		bool directOnBuffer = false;
 		if (imageChannel.contentType == IMAGE_CONTENT_COLOR && !appendAlpha) directOnBuffer = true;
 		if (imageChannel.contentType == IMAGE_CONTENT_ALPHA) directOnBuffer = true;
+		if (imageChannel.contentType == IMAGE_CONTENT_COST) directOnBuffer = true;
 
 		if (directOnBuffer)
 		{
@@ -355,6 +465,7 @@ void ImageFileSavePNG::SavePNG(
 					}
 				}
 				break;
+				case IMAGE_CONTENT_COST: directPointer = (char *)image->ConvertCostTo8Bit(); break;
 				case IMAGE_CONTENT_ZBUFFER:
 				case IMAGE_CONTENT_NORMAL:
 					// zbuffer and normals are float, so direct buffer write is not applicable
@@ -368,11 +479,7 @@ void ImageFileSavePNG::SavePNG(
 		}
 		else
 		{
-			colorPtr = new char[(uint64_t)width * height * pixelSize];
-
 			// calculate min / max values from zbuffer range
-			float minZ = 1.0e50;
-			float maxZ = 0.0;
 			if (imageChannel.contentType == IMAGE_CONTENT_ZBUFFER)
 			{
 				float *zbuffer = image->GetZBufferPtr();
@@ -384,97 +491,43 @@ void ImageFileSavePNG::SavePNG(
 					if (z < minZ) minZ = z;
 				}
 			}
-			double kZ = log(maxZ / minZ);
+			kZ = log(maxZ / minZ);
 
-			for (uint64_t y = 0; y < height; y++)
+			// derived buffers have to be ready before lines are converted by many threads
+			if (imageChannel.contentType == IMAGE_CONTENT_COLOR
+					&& imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_8)
 			{
-				for (uint64_t x = 0; x < width; x++)
-				{
-					uint64_t ptr = (x + y * width) * pixelSize;
-					switch (imageChannel.contentType)
-					{
-						case IMAGE_CONTENT_COLOR:
-						{
-							if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
-							{
-								if (appendAlpha)
-								{
-									sRGBA16 *typedColorPtr = (sRGBA16 *)&colorPtr[ptr];
-									*typedColorPtr = sRGBA16(image->GetPixelImage16(x, y));
-									typedColorPtr->A = image->GetPixelAlpha(x, y);
-								}
-							}
-							else
-							{
-								if (appendAlpha)
-								{
-									if (x == 0 && y == 0)
-									{
-										image->ConvertAlphaTo8bit();
-										image->ConvertTo8bit();
-									}
-									sRGBA8 *typedColorPtr = (sRGBA8 *)&colorPtr[ptr];
-									*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
-									typedColorPtr->A = image->GetPixelAlpha8(x, y);
-								}
-							}
-						}
-						break;
-						case IMAGE_CONTENT_ALPHA:
-							// all alpha savings to PNG happen directly on buffers in cimage
-							break;
-						case IMAGE_CONTENT_ZBUFFER:
-						{
-							if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
-							{
-								float z = image->GetPixelZBuffer(x, y);
-								float z1 = log(z / minZ) / kZ;
-								int intZ = z1 * 60000;
-								if (z > 1e19) intZ = 65535;
-
-								unsigned short *typedColorPtr = (unsigned short *)&colorPtr[ptr];
-								*typedColorPtr = (unsigned short)(intZ);
-							}
-							else
-							{
-								float z = image->GetPixelZBuffer(x, y);
-								float z1 = log(z / minZ) / kZ;
-								int intZ = z1 * 240;
-								if (z > 1e19) intZ = 255;
-
-								unsigned char *typedColorPtr = (unsigned char *)&colorPtr[ptr];
-								*typedColorPtr = (unsigned char)(intZ);
-							}
-						}
-						break;
-						case IMAGE_CONTENT_NORMAL:
-						{
-							if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
-							{
-								if (x == 0 && y == 0) image->ConvertNormalto16Bit();
-								sRGB16 *typedColorPtr = (sRGB16 *)&colorPtr[ptr];
-								*typedColorPtr = sRGB16(image->GetPixelNormal16(x, y));
-							}
-							else
-							{
-								if (x == 0 && y == 0) image->ConvertNormalto8Bit();
-								sRGB8 *typedColorPtr = (sRGB8 *)&colorPtr[ptr];
-								*typedColorPtr = sRGB8(image->GetPixelNormal8(x, y));
-							}
-						}
-						break;
-					}
-				}
-				row_pointers[y] = (png_byte *)&colorPtr[y * width * pixelSize];
+				image->ConvertAlphaTo8bit();
+				image->ConvertTo8bit();
+			}
+			if (imageChannel.contentType == IMAGE_CONTENT_NORMAL)
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+					image->ConvertNormalto16Bit();
+				else
+					image->ConvertNormalto8Bit();
 			}
+
+			// only one chunk of lines is converted at once, so the whole image is not copied
+			colorPtr = new char[chunkSize * width * pixelSize];
 		}
 
 		// png_write_image(png_ptr, row_pointers);
-		uint64_t chunkSize = 100;
 		for (uint64_t r = 0; r < height; r += chunkSize)
 		{
 			uint64_t leftToWrite = height - r;
-			png_write_rows(png_ptr, (png_bytepp)&row_pointers[r], min(leftToWrite, chunkSize));
+			int linesInChunk = min(leftToWrite, chunkSize);
+			if (colorPtr)
+			{
+#pragma omp parallel for
+				for (int i = 0; i < linesInChunk; i++)
+				{
+					char *linePtr = &colorPtr[i * width * pixelSize];
+					ConvertPNGLine(image, imageChannel, appendAlpha, r + i, linePtr, minZ, kZ);
+					row_pointers[r + i] = (png_byte *)linePtr;
+				}
+			}
+			png_write_rows(png_ptr, (png_bytepp)&row_pointers[r], linesInChunk);
 			/* TODO: make SavePNG private non static and rewrite direct accesses to static function
 			 emit updateProgressAndStatus(getJobName(),
 				QString("Saving channel %1").arg(ImageChannelName(currentChannelKey)),
@@ -705,6 +758,107 @@ void ImageFileSavePNG::SaveFromTilesPNG16(const char *filename, int width, int h
 	fclose(fp);
 }
 
+bool ImageFileSaveJPG::SaveJPEG(
+	QString filename, unsigned char *image, int width, int height, int quality, bool greyscale)
+{
+#ifdef USE_JPEG
+	return SaveJPEGLib(filename, image, width, height, quality, greyscale);
+#else
+	if (greyscale)
+		return SaveJPEGQtGreyscale(filename, image, width, height, quality);
+	else
+		return SaveJPEGQt(filename, image, width, height, quality);
+#endif // USE_JPEG
+}
+
+#ifdef USE_JPEG
+struct sJPEGErrorManager
+{
+	jpeg_error_mgr pub;
+	jmp_buf setjmpBuffer;
+	char message[JMSG_LENGTH_MAX];
+};
+
+// libjpeg calls exit() on fatal errors by default, so jump back to SaveJPEGLib instead
+static void JPEGErrorExit(j_common_ptr cinfo)
+{
+	sJPEGErrorManager *errorManager = (sJPEGErrorManager *)cinfo->err;
+	(*cinfo->err->format_message)(cinfo, errorManager->message);
+	longjmp(errorManager->setjmpBuffer, 1);
+}
+
+bool ImageFileSaveJPG::SaveJPEGLib(
+	QString filename, unsigned char *image, int width, int height, int quality, bool greyscale)
+{
+	if (!image)
+	{
+		qDebug() << "the image is a null pointer, this might be the case for optional channel(s). "
+								"If this is the case, just rerender the image with enabled channel(s).";
+		return false;
+	}
+
+	FILE *fp = fopen(filename.toLocal8Bit().constData(), "wb");
+	if (!fp)
+	{
+		cErrorMessage::showMessage(QObject::tr("Can't save image to JPEG file!\n") + filename
+																 + "\n" + QObject::tr("Can't open file for writing"),
+			cErrorMessage::errorMessage);
+		return false;
+	}
+
+	jpeg_compress_struct cinfo;
+	sJPEGErrorManager errorManager;
+	cinfo.err = jpeg_std_error(&errorManager.pub);
+	errorManager.pub.error_exit = JPEGErrorExit;
+
+	if (setjmp(errorManager.setjmpBuffer))
+	{
+		jpeg_destroy_compress(&cinfo);
+		fclose(fp);
+		cErrorMessage::showMessage(QObject::tr("Can't save image to JPEG file!\n") + filename
+																 + "\n" + QString(errorManager.message),
+			cErrorMessage::errorMessage);
+		return false;
+	}
+
+	jpeg_create_compress(&cinfo);
+	jpeg_stdio_dest(&cinfo, fp);
+
+	cinfo.image_width = width;
+	cinfo.image_height = height;
+	cinfo.input_components = greyscale ? 1 : 3;
+	cinfo.in_color_space = greyscale ? JCS_GRAYSCALE : JCS_RGB;
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, quality, TRUE);
+	// integer DCT is SIMD accelerated in libjpeg-turbo, same as RGB to YCbCr conversion
+	cinfo.dct_method = JDCT_ISLOW;
+
+	jpeg_start_compress(&cinfo, TRUE);
+
+	// rows are passed as pointers to the source buffer, so no copy of the image is made
+	uint64_t rowStride = (uint64_t)width * cinfo.input_components;
+	JSAMPROW rows[JPEG_LINES_PER_CALL];
+	while (cinfo.next_scanline < cinfo.image_height)
+	{
+		int count = qMin((int)(cinfo.image_height - cinfo.next_scanline), JPEG_LINES_PER_CALL);
+		for (int i = 0; i < count; i++)
+			rows[i] = &image[(cinfo.next_scanline + i) * rowStride];
+		jpeg_write_scanlines(&cinfo, rows, count);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	if (fclose(fp) != 0)
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Can't save image to JPEG file!\n") + filename, cErrorMessage::errorMessage);
+		return false;
+	}
+	return true;
+}
+#endif // USE_JPEG
+
 bool ImageFileSaveJPG::SaveJPEGQt(
 	QString filename, unsigned char *image, int width, int height, int quality)
 {
@@ -817,6 +971,9 @@ void ImageFileSaveEXR::SaveEXR(
 
 	header.compression() = Imf::ZIP_COMPRESSION;
 
+	// converted channels which are released after writing
+	QList<char *> buffers;
+
 	if (imageConfig.contains(IMAGE_CONTENT_COLOR))
 	{
 		// add rgb channel header
@@ -831,9 +988,11 @@ void ImageFileSaveEXR::SaveEXR(
 		int pixelSize = sizeof(tsRGB<half>);
 		if (imfQuality == Imf::FLOAT) pixelSize = sizeof(tsRGB<float>);
 		char *buffer = new char[(uint64_t)width * height * pixelSize];
+		buffers.append(buffer);
 		tsRGB<half> *halfPointer = (tsRGB<half> *)buffer;
 		tsRGB<float> *floatPointer = (tsRGB<float> *)buffer;
 
+#pragma omp parallel for
 		for (int y = 0; y < height; y++)
 		{
 			for (int x = 0; x < width; x++)
@@ -878,9 +1037,11 @@ void ImageFileSaveEXR::SaveEXR(
 		int pixelSize = sizeof(half);
 		if (imfQuality == Imf::FLOAT) pixelSize = sizeof(float);
 		char *buffer = new char[(uint64_t)width * height * pixelSize];
+		buffers.append(buffer);
 		half *halfPointer = (half *)buffer;
 		float *floatPointer = (float *)buffer;
 
+#pragma omp parallel for
 		for (int y = 0; y < height; y++)
 		{
 			for (int x = 0; x < width; x++)
@@ -923,8 +1084,10 @@ void ImageFileSaveEXR::SaveEXR(
 		{
 			int pixelSize = sizeof(half);
 			char *buffer = new char[(uint64_t)width * height * pixelSize];
+			buffers.append(buffer);
 			half *halfPointer = (half *)buffer;
 
+#pragma omp parallel for
 			for (int y = 0; y < height; y++)
 			{
 				for (int x = 0; x < width; x++)
@@ -952,9 +1115,11 @@ void ImageFileSaveEXR::SaveEXR(
 		int pixelSize = sizeof(tsRGB<half>);
 		if (imfQuality == Imf::FLOAT) pixelSize = sizeof(tsRGB<float>);
 		char *buffer = new char[(uint64_t)width * height * pixelSize];
+		buffers.append(buffer);
 		tsRGB<half> *halfPointer = (tsRGB<half> *)buffer;
 		tsRGB<float> *floatPointer = (tsRGB<float> *)buffer;
 
+#pragma omp parallel for
 		for (int y = 0; y < height; y++)
 		{
 			for (int x = 0; x < width; x++)
@@ -984,9 +1149,85 @@ void ImageFileSaveEXR::SaveEXR(
 			Imf::Slice(imfQuality, (char *)buffer + 2 * compSize, 3 * compSize, 3 * width * compSize));
 	}
 
-	Imf::OutputFile file(filename.toStdString().c_str(), header);
-	file.setFrameBuffer(frameBuffer);
-	file.writePixels(height);
+	if (imageConfig.contains(IMAGE_CONTENT_WORLD_POSITION) && image->GetWorldPositionPtr())
+	{
+		// add world position layer
+		Imf::PixelType imfQuality =
+			imageConfig[IMAGE_CONTENT_WORLD_POSITION].channelQuality == IMAGE_CHANNEL_QUALITY_32
+				? Imf::FLOAT
+				: Imf::HALF;
+
+		header.channels().insert("P.X", Imf::Channel(imfQuality));
+		header.channels().insert("P.Y", Imf::Channel(imfQuality));
+		header.channels().insert("P.Z", Imf::Channel(imfQuality));
+
+		char *buffer = (char *)image->GetWorldPositionPtr();
+		if (imfQuality == Imf::HALF)
+		{
+			buffer = new char[(uint64_t)width * height * sizeof(tsRGB<half>)];
+			buffers.append(buffer);
+			tsRGB<half> *halfPointer = (tsRGB<half> *)buffer;
+
+#pragma omp parallel for
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					uint64_t ptr = (x + y * width);
+					sRGBfloat position = image->GetPixelWorldPosition(x, y);
+					halfPointer[ptr].R = position.R;
+					halfPointer[ptr].G = position.G;
+					halfPointer[ptr].B = position.B;
+				}
+			}
+		}
+
+		// float positions are written directly from image buffer
+		size_t compSize = (imfQuality == Imf::FLOAT ? sizeof(float) : sizeof(half));
+		frameBuffer.insert("P.X",
+			Imf::Slice(imfQuality, buffer + 0 * compSize, 3 * compSize, 3 * width * compSize));
+		frameBuffer.insert("P.Y",
+			Imf::Slice(imfQuality, buffer + 1 * compSize, 3 * compSize, 3 * width * compSize));
+		frameBuffer.insert("P.Z",
+			Imf::Slice(imfQuality, buffer + 2 * compSize, 3 * compSize, 3 * width * compSize));
+	}
+
+	if (imageConfig.contains(IMAGE_CONTENT_OBJECT_ID) && image->GetObjectIdPtr())
+	{
+		// object ids are always stored as float to keep exact values
+		header.channels().insert("id", Imf::Channel(Imf::FLOAT));
+		frameBuffer.insert("id", Imf::Slice(Imf::FLOAT, (char *)image->GetObjectIdPtr(),
+															 sizeof(float), width * sizeof(float)));
+	}
+
+	if (imageConfig.contains(IMAGE_CONTENT_COST) && image->GetCostPtr())
+	{
+		// cost counters are always stored as float and written directly from image buffer
+		size_t compSize = sizeof(float);
+		char *buffer = (char *)image->GetCostPtr();
+		header.channels().insert("cost.evaluations", Imf::Channel(Imf::FLOAT));
+		header.channels().insert("cost.iterations", Imf::Channel(Imf::FLOAT));
+		header.channels().insert("cost.steps", Imf::Channel(Imf::FLOAT));
+		frameBuffer.insert("cost.evaluations",
+			Imf::Slice(Imf::FLOAT, buffer + 0 * compSize, 3 * compSize, 3 * width * compSize));
+		frameBuffer.insert("cost.iterations",
+			Imf::Slice(Imf::FLOAT, buffer + 1 * compSize, 3 * compSize, 3 * width * compSize));
+		frameBuffer.insert("cost.steps",
+			Imf::Slice(Imf::FLOAT, buffer + 2 * compSize, 3 * compSize, 3 * width * compSize));
+	}
+
+	// line blocks are compressed by thread pool of OpenEXR library
+	if (Imf::globalThreadCount() != systemData.numberOfThreads)
+		Imf::setGlobalThreadCount(systemData.numberOfThreads);
+
+	{
+		Imf::OutputFile file(filename.toStdString().c_str(), header, Imf::globalThreadCount());
+		file.setFrameBuffer(frameBuffer);
+		file.writePixels(height);
+	}
+
+	for (int i = 0; i < buffers.size(); i++)
+		delete[] buffers[i];
 }
 #endif /* USE_EXR */
 
@@ -1045,7 +1286,7 @@ bool ImageFileSaveTIFF::SaveTIFF(
 	TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, height);
 	TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, qualitySize);
 	TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, samplesPerPixel);
-	TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, height);
+	TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, TIFF_ROWS_PER_STRIP);
 
 	TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_DEFLATE);
 	TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, colorType);
@@ -1054,7 +1295,7 @@ bool ImageFileSaveTIFF::SaveTIFF(
 	TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, sampleFormat);
 
 	uint64_t pixelSize = samplesPerPixel * qualitySize / 8;
-	char *colorPtr = new char[(uint64_t)width * height * pixelSize];
+	uint64_t lineSize = width * pixelSize;
 
 	// calculate min / max values from zbuffer range
 	float minZ = 1.0e50;
@@ -1072,147 +1313,198 @@ bool ImageFileSaveTIFF::SaveTIFF(
 		}
 		rangeZ = maxZ - minZ;
 	}
-	for (uint64_t y = 0; y < height; y++)
+
+	// derived buffers have to be ready before lines are converted by many threads
+	if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_8)
+	{
+		if (imageChannel.contentType == IMAGE_CONTENT_COLOR) image->ConvertTo8bit();
+		if (imageChannel.contentType == IMAGE_CONTENT_ALPHA || appendAlpha)
+			image->ConvertAlphaTo8bit();
+		if (imageChannel.contentType == IMAGE_CONTENT_NORMAL) image->ConvertNormalto8Bit();
+	}
+	else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+	{
+		if (imageChannel.contentType == IMAGE_CONTENT_NORMAL) image->ConvertNormalto16Bit();
+	}
+
+	// strips are converted and compressed by many threads and then written in order
+	int numberOfStrips = (height + TIFF_ROWS_PER_STRIP - 1) / TIFF_ROWS_PER_STRIP;
+	int stripsInBatch = qMax(1, systemData.numberOfThreads);
+	uint64_t stripSize = TIFF_ROWS_PER_STRIP * lineSize;
+	uLong compressedSize = compressBound(stripSize);
+	char *stripBuffers = new char[stripsInBatch * stripSize];
+	Bytef *compressedBuffers = new Bytef[stripsInBatch * compressedSize];
+	uLongf *compressedLengths = new uLongf[stripsInBatch];
+	bool result = true;
+
+	for (int firstStrip = 0; firstStrip < numberOfStrips && result; firstStrip += stripsInBatch)
 	{
-		for (uint64_t x = 0; x < width; x++)
+		int strips = qMin(stripsInBatch, numberOfStrips - firstStrip);
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < strips; i++)
 		{
-			uint64_t ptr = (x + y * width) * pixelSize;
-			switch (imageChannel.contentType)
+			char *stripPtr = &stripBuffers[i * stripSize];
+			uint64_t firstLine = (uint64_t)(firstStrip + i) * TIFF_ROWS_PER_STRIP;
+			uint64_t lines = qMin((uint64_t)TIFF_ROWS_PER_STRIP, height - firstLine);
+			for (uint64_t l = 0; l < lines; l++)
 			{
-				case IMAGE_CONTENT_COLOR:
+				ConvertTIFFLine(image, imageChannel, appendAlpha, firstLine + l, pixelSize,
+					&stripPtr[l * lineSize], minZ, rangeZ);
+			}
+			compressedLengths[i] = compressedSize;
+			if (compress2(&compressedBuffers[i * compressedSize], &compressedLengths[i],
+						(Bytef *)stripPtr, lines * lineSize, Z_DEFAULT_COMPRESSION)
+					!= Z_OK)
+			{
+				compressedLengths[i] = 0;
+			}
+		}
+
+		for (int i = 0; i < strips; i++)
+		{
+			if (compressedLengths[i] == 0
+					|| TIFFWriteRawStrip(tiff, firstStrip + i, &compressedBuffers[i * compressedSize],
+							 tsize_t(compressedLengths[i]))
+							 < 0)
+			{
+				qCritical() << "SaveTiff() cannot write strip" << firstStrip + i;
+				result = false;
+				break;
+			}
+		}
+	}
+
+	TIFFClose(tiff);
+	delete[] stripBuffers;
+	delete[] compressedBuffers;
+	delete[] compressedLengths;
+	return result;
+}
+
+void ImageFileSaveTIFF::ConvertTIFFLine(cImage *image,
+	const structSaveImageChannel &imageChannel, bool appendAlpha, uint64_t y, uint64_t pixelSize,
+	char *linePtr, float minZ, float rangeZ)
+{
+	uint64_t width = image->GetWidth();
+	for (uint64_t x = 0; x < width; x++)
+	{
+		uint64_t ptr = x * pixelSize;
+		switch (imageChannel.contentType)
+		{
+			case IMAGE_CONTENT_COLOR:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
 				{
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
-					{
-						if (appendAlpha)
-						{
-							sRGBAfloat *typedColorPtr = (sRGBAfloat *)&colorPtr[ptr];
-							sRGB16 rgbPointer = image->GetPixelImage16(x, y);
-							typedColorPtr->R = rgbPointer.R / 65536.0;
-							typedColorPtr->G = rgbPointer.G / 65536.0;
-							typedColorPtr->B = rgbPointer.B / 65536.0;
-							typedColorPtr->A = image->GetPixelAlpha(x, y) / 65536.0;
-						}
-						else
-						{
-							sRGBfloat *typedColorPtr = (sRGBfloat *)&colorPtr[ptr];
-							sRGB16 rgbPointer = image->GetPixelImage16(x, y);
-							typedColorPtr->R = rgbPointer.R / 65536.0;
-							typedColorPtr->G = rgbPointer.G / 65536.0;
-							typedColorPtr->B = rgbPointer.B / 65536.0;
-						}
-					}
-					else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+					if (appendAlpha)
 					{
-						if (appendAlpha)
-						{
-							sRGBA16 *typedColorPtr = (sRGBA16 *)&colorPtr[ptr];
-							*typedColorPtr = sRGBA16(image->GetPixelImage16(x, y));
-							typedColorPtr->A = image->GetPixelAlpha(x, y);
-						}
-						else
-						{
-							sRGB16 *typedColorPtr = (sRGB16 *)&colorPtr[ptr];
-							*typedColorPtr = sRGB16(image->GetPixelImage16(x, y));
-						}
+						sRGBAfloat *typedColorPtr = (sRGBAfloat *)&linePtr[ptr];
+						sRGB16 rgbPointer = image->GetPixelImage16(x, y);
+						typedColorPtr->R = rgbPointer.R / 65536.0;
+						typedColorPtr->G = rgbPointer.G / 65536.0;
+						typedColorPtr->B = rgbPointer.B / 65536.0;
+						typedColorPtr->A = image->GetPixelAlpha(x, y) / 65536.0;
 					}
 					else
 					{
-						if (appendAlpha)
-						{
-							if (x == 0 && y == 0)
-							{
-								image->ConvertAlphaTo8bit();
-								image->ConvertTo8bit();
-							}
-							sRGBA8 *typedColorPtr = (sRGBA8 *)&colorPtr[ptr];
-							*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
-							typedColorPtr->A = image->GetPixelAlpha8(x, y);
-						}
-						else
-						{
-							if (x == 0 && y == 0)
-							{
-								image->ConvertTo8bit();
-							}
-							sRGB8 *typedColorPtr = (sRGB8 *)&colorPtr[ptr];
-							*typedColorPtr = sRGB8(image->GetPixelImage8(x, y));
-						}
+						sRGBfloat *typedColorPtr = (sRGBfloat *)&linePtr[ptr];
+						sRGB16 rgbPointer = image->GetPixelImage16(x, y);
+						typedColorPtr->R = rgbPointer.R / 65536.0;
+						typedColorPtr->G = rgbPointer.G / 65536.0;
+						typedColorPtr->B = rgbPointer.B / 65536.0;
 					}
 				}
-				break;
-				case IMAGE_CONTENT_ALPHA:
+				else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
 				{
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
+					if (appendAlpha)
 					{
-						float *typedColorPtr = (float *)&colorPtr[ptr];
-						*typedColorPtr = image->GetPixelAlpha(x, y) / 65536.0;
-					}
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
-					{
-						unsigned short *typedColorPtr = (unsigned short *)&colorPtr[ptr];
-						*typedColorPtr = image->GetPixelAlpha(x, y);
+						sRGBA16 *typedColorPtr = (sRGBA16 *)&linePtr[ptr];
+						*typedColorPtr = sRGBA16(image->GetPixelImage16(x, y));
+						typedColorPtr->A = image->GetPixelAlpha(x, y);
 					}
 					else
 					{
-						if (x == 0 && y == 0)
-						{
-							image->ConvertAlphaTo8bit();
-						}
-						unsigned char *typedColorPtr = (unsigned char *)&colorPtr[ptr];
-						*typedColorPtr = image->GetPixelAlpha8(x, y);
+						sRGB16 *typedColorPtr = (sRGB16 *)&linePtr[ptr];
+						*typedColorPtr = sRGB16(image->GetPixelImage16(x, y));
 					}
 				}
-				break;
-				case IMAGE_CONTENT_ZBUFFER:
+				else
 				{
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
-					{
-						float *typedColorPtr = (float *)&colorPtr[ptr];
-						*typedColorPtr = (image->GetPixelZBuffer(x, y) - minZ) / rangeZ;
-					}
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+					if (appendAlpha)
 					{
-						unsigned short *typedColorPtr = (unsigned short *)&colorPtr[ptr];
-						*typedColorPtr =
-							(unsigned short)(((image->GetPixelZBuffer(x, y) - minZ) / rangeZ) * 65535);
+						sRGBA8 *typedColorPtr = (sRGBA8 *)&linePtr[ptr];
+						*typedColorPtr = sRGBA8(image->GetPixelImage8(x, y));
+						typedColorPtr->A = image->GetPixelAlpha8(x, y);
 					}
 					else
 					{
-						unsigned char *typedColorPtr = (unsigned char *)&colorPtr[ptr];
-						*typedColorPtr =
-							(unsigned char)(((image->GetPixelZBuffer(x, y) - minZ) / rangeZ) * 255);
+						sRGB8 *typedColorPtr = (sRGB8 *)&linePtr[ptr];
+						*typedColorPtr = sRGB8(image->GetPixelImage8(x, y));
 					}
 				}
-				break;
-				case IMAGE_CONTENT_NORMAL:
+			}
+			break;
+			case IMAGE_CONTENT_ALPHA:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
 				{
-					if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
-					{
-						sRGBfloat *typedColorPtr = (sRGBfloat *)&colorPtr[ptr];
-						*typedColorPtr = sRGBfloat(image->GetPixelNormal(x, y));
-					}
-					else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
-					{
-						if (x == 0 && y == 0) image->ConvertNormalto16Bit();
-						sRGB16 *typedColorPtr = (sRGB16 *)&colorPtr[ptr];
-						*typedColorPtr = sRGB16(image->GetPixelNormal16(x, y));
-					}
-					else
-					{
-						if (x == 0 && y == 0) image->ConvertNormalto8Bit();
-						sRGB8 *typedColorPtr = (sRGB8 *)&colorPtr[ptr];
-						*typedColorPtr = sRGB8(image->GetPixelNormal8(x, y));
-					}
+					float *typedColorPtr = (float *)&linePtr[ptr];
+					*typedColorPtr = image->GetPixelAlpha(x, y) / 65536.0;
+				}
+				else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+				{
+					unsigned short *typedColorPtr = (unsigned short *)&linePtr[ptr];
+					*typedColorPtr = image->GetPixelAlpha(x, y);
+				}
+				else
+				{
+					unsigned char *typedColorPtr = (unsigned char *)&linePtr[ptr];
+					*typedColorPtr = image->GetPixelAlpha8(x, y);
+				}
+			}
+			break;
+			case IMAGE_CONTENT_ZBUFFER:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
+				{
+					float *typedColorPtr = (float *)&linePtr[ptr];
+					*typedColorPtr = (image->GetPixelZBuffer(x, y) - minZ) / rangeZ;
+				}
+				else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+				{
+					unsigned short *typedColorPtr = (unsigned short *)&linePtr[ptr];
+					*typedColorPtr =
+						(unsigned short)(((image->GetPixelZBuffer(x, y) - minZ) / rangeZ) * 65535);
+				}
+				else
+				{
+					unsigned char *typedColorPtr = (unsigned char *)&linePtr[ptr];
+					*typedColorPtr =
+						(unsigned char)(((image->GetPixelZBuffer(x, y) - minZ) / rangeZ) * 255);
+				}
+			}
+			break;
+			case IMAGE_CONTENT_NORMAL:
+			{
+				if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_32)
+				{
+					sRGBfloat *typedColorPtr = (sRGBfloat *)&linePtr[ptr];
+					*typedColorPtr = sRGBfloat(image->GetPixelNormal(x, y));
+				}
+				else if (imageChannel.channelQuality == IMAGE_CHANNEL_QUALITY_16)
+				{
+					sRGB16 *typedColorPtr = (sRGB16 *)&linePtr[ptr];
+					*typedColorPtr = sRGB16(image->GetPixelNormal16(x, y));
+				}
+				else
+				{
+					sRGB8 *typedColorPtr = (sRGB8 *)&linePtr[ptr];
+					*typedColorPtr = sRGB8(image->GetPixelNormal8(x, y));
 				}
-				break;
 			}
+			break;
 		}
 	}
-
-	TIFFWriteEncodedStrip(tiff, 0, (void *)colorPtr, tsize_t(width * height * pixelSize));
-	TIFFClose(tiff);
-	delete[] colorPtr;
-	return true;
 }
 
 #endif /* USE_TIFF */
@@ -82,7 +82,16 @@ public:
 		// x E[-1,1], y E[-1,1], z E[0,1] and rgb channels xyz mapped to full range of selected quality
 		// see reference Normal maps at
 		// https://www.blender.org/manual/render/blender_render/textures/influence/material/bump_and_normal.html
-		IMAGE_CONTENT_NORMAL = 3
+		IMAGE_CONTENT_NORMAL = 3,
+
+		// world coordinates of the surface (only in EXR files)
+		IMAGE_CONTENT_WORLD_POSITION = 4,
+
+		// index of the object for compositing masks (only in EXR files)
+		IMAGE_CONTENT_OBJECT_ID = 5,
+
+		// rendering cost of the pixel. EXR keeps raw counters, other formats get 8-bit heatmap
+		IMAGE_CONTENT_COST = 6
 	};
 
 	enum enumImageChannelQualityType
@@ -149,6 +158,11 @@ public:
 	static void SavePNG16(QString filename, int width, int height, sRGB16 *image16);
 	static void SaveFromTilesPNG16(const char *filename, int width, int height, int tiles);
 	static bool SavePNGQtBlackAndWhite(QString filename, unsigned char *image, int width, int height);
+
+private:
+	// converts one line of image channel, which can't be written directly from cImage buffer
+	static void ConvertPNGLine(cImage *image, const structSaveImageChannel &imageChannel,
+		bool appendAlpha, uint64_t y, char *linePtr, float minZ, double kZ);
 };
 
 class ImageFileSaveJPG : public ImageFileSave
@@ -163,8 +177,16 @@ public:
 	QString getJobName() { return tr("Saving %1").arg("JPG"); }
 	static bool SaveJPEGQt(
 		QString filename, unsigned char *image, int width, int height, int quality);
+	// saves 8-bit RGB or greyscale buffer. Uses libjpeg directly if available, otherwise Qt
+	static bool SaveJPEG(QString filename, unsigned char *image, int width, int height, int quality,
+		bool greyscale = false);
 	static bool SaveJPEGQtGreyscale(
 		QString filename, unsigned char *image, int width, int height, int quality);
+#ifdef USE_JPEG
+	// encodes lines straight from the buffer, without intermediate QImage
+	static bool SaveJPEGLib(QString filename, unsigned char *image, int width, int height,
+		int quality, bool greyscale);
+#endif // USE_JPEG
 };
 
 #ifdef USE_TIFF
@@ -180,6 +202,10 @@ public:
 	QString getJobName() { return tr("Saving %1").arg("TIFF"); }
 	static bool SaveTIFF(
 		QString filename, cImage *image, structSaveImageChannel imageChannel, bool appendAlpha = false);
+
+private:
+	static void ConvertTIFFLine(cImage *image, const structSaveImageChannel &imageChannel,
+		bool appendAlpha, uint64_t y, uint64_t pixelSize, char *linePtr, float minZ, float rangeZ);
 };
 #endif /* USE_TIFF */
 
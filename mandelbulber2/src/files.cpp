@@ -38,6 +38,9 @@
 #include "error_message.hpp"
 #include "files.h"
 #include "initparameters.hpp"
+#include "progress_stream.hpp"
+#include "resource_report.hpp"
+#include "trace.hpp"
 
 extern "C" {
 #include <png.h>
@@ -302,15 +305,17 @@ void BufferNormalize16(sRGB16 *buffer, unsigned int size)
  }
  */
 
-void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cImage *image,
-	QObject *updateReceiver)
+ImageFileSave::ImageConfig ImageConfigFromPreferences()
 {
 	ImageFileSave::ImageConfig imageConfig;
 	QStringList imageChannelNames;
 	imageChannelNames << "color"
 										<< "alpha"
 										<< "zbuffer"
-										<< "normal";
+										<< "normal"
+										<< "world_position"
+										<< "object_id"
+										<< "cost";
 	// read image config from preferences
 	for (int i = 0; i < imageChannelNames.size(); i++)
 	{
@@ -325,6 +330,19 @@ void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cIma
 				contentType, ImageFileSave::structSaveImageChannel(contentType, channelQuality, postfix));
 		}
 	}
+	return imageConfig;
+}
+
+void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cImage *image,
+	QObject *updateReceiver)
+{
+	SaveImage(filename, filetype, image, ImageConfigFromPreferences(), updateReceiver);
+}
+
+void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cImage *image,
+	const ImageFileSave::ImageConfig &imageConfig, QObject *updateReceiver)
+{
+	TRACE_SCOPE("SaveImage", "output");
 	QFileInfo fi(filename);
 	QString fileWithoutExtension = fi.path() + QDir::separator() + fi.baseName();
 	ImageFileSave *imageFileSave =
@@ -337,6 +355,19 @@ void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cIma
 	}
 	imageFileSave->SaveImage();
 	delete imageFileSave;
+	image->FreeDerivedBuffers();
+	cProgressStream::ImageSaved(filename);
+
+	// every channel can be saved to own file
+	QString extension = "." + ImageFileSave::ImageFileExtension(filetype);
+	QSet<QString> savedFiles;
+	savedFiles.insert(fileWithoutExtension + extension);
+	for (ImageFileSave::ImageConfig::const_iterator channel = imageConfig.constBegin();
+			 channel != imageConfig.constEnd(); ++channel)
+		savedFiles.insert(fileWithoutExtension + channel.value().postfix + extension);
+	for (QSet<QString>::const_iterator file = savedFiles.constBegin(); file != savedFiles.constEnd();
+			 ++file)
+		cResourceReport::AddBytesWritten(QFileInfo(*file).size());
 	// return SaveImage(fileWithoutExtension, filetype, image, imageConfig);
 }
 
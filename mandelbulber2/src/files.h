@@ -51,8 +51,12 @@ int fcopy(const char *source, const char *dest);
 std::string removeFileExtension(const std::string &filename);
 void BufferNormalize16(sRGB16 *buffer, unsigned int size);
 // void SaveAllImageLayers(const char *filename, cImage *image);
+// image channels selected in preferences
+ImageFileSave::ImageConfig ImageConfigFromPreferences();
 void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cImage *image,
 	QObject *updateReceiver = 0);
+void SaveImage(QString filename, ImageFileSave::enumImageFileType filetype, cImage *image,
+	const ImageFileSave::ImageConfig &imageConfig, QObject *updateReceiver = 0);
 sRGBA16 *LoadPNG(QString filename, int &outWidth, int &outHeight);
 
 #endif /* MANDELBULBER2_SRC_FILES_H_ */
@@ -0,0 +1,205 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFormulaBenchmark class - cost of one iteration of every fractal formula
+ */
+
+#include "formula_benchmark.hpp"
+
+#include <algorithm>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "compute_fractal.hpp"
+#include "fractal_container.hpp"
+#include "fractal_list.hpp"
+#include "fractparams.hpp"
+#include "initparameters.hpp"
+#include "nine_fractals.hpp"
+#include "system.hpp"
+
+// number of points in each direction of the grid and number of iterations for every point
+#define FORMULA_BENCHMARK_GRID 8
+#define FORMULA_BENCHMARK_ITERATIONS 50
+// minimum time of measurement of one formula in seconds
+#define FORMULA_BENCHMARK_TIME 0.02
+
+double cFormulaBenchmark::medianNsPerIteration = -1.0;
+
+cFormulaBenchmark::cFormulaBenchmark()
+{
+}
+
+cFormulaBenchmark::~cFormulaBenchmark()
+{
+}
+
+QString cFormulaBenchmark::ResultsFile()
+{
+	return systemData.GetDataDirectoryHidden() + "formula_benchmark.json";
+}
+
+QByteArray cFormulaBenchmark::Run()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	QJsonArray results;
+	for (int i = 0; i < fractalList.size(); i++)
+	{
+		if (fractalList[i].internalID == fractal::none) continue;
+		results.append(MeasureFormula(&fractalList[i]));
+	}
+	UpdateMedian();
+
+	QJsonObject document;
+	document["version"] = QString(MANDELBULBER_VERSION_STRING);
+	document["iterations_per_point"] = FORMULA_BENCHMARK_ITERATIONS;
+	document["points"] = FORMULA_BENCHMARK_GRID * FORMULA_BENCHMARK_GRID * FORMULA_BENCHMARK_GRID;
+	document["median_ns_per_iteration"] = medianNsPerIteration;
+	document["formulas"] = results;
+	document["total_time"] = timer.nsecsElapsed() / 1e9;
+	QByteArray text = QJsonDocument(document).toJson();
+
+	QFile file(ResultsFile());
+	if (file.open(QIODevice::WriteOnly))
+		file.write(text);
+	else
+		qWarning() << "Cannot save results of formula benchmark to" << ResultsFile();
+
+	return text;
+}
+
+QJsonObject cFormulaBenchmark::MeasureFormula(sFractalDescription *description)
+{
+	// every formula starts from default parameters
+	cParameterContainer par;
+	cFractalContainer fractalPar;
+	par.SetContainerName("main");
+	InitParams(&par);
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		fractalPar.at(i).SetContainerName(QString("fractal") + QString::number(i));
+		InitFractalParams(&fractalPar.at(i));
+	}
+	par.Set("formula", 1, (int)description->internalID);
+	par.Set("N", FORMULA_BENCHMARK_ITERATIONS);
+
+	cParamRender params(&par);
+	cNineFractals fractals(&fractalPar, &par);
+
+	const int grid = FORMULA_BENCHMARK_GRID;
+	double iterations = 0.0;
+	qint64 points = 0;
+	qint64 bailouts = 0;
+
+	QElapsedTimer timer;
+	timer.start();
+	do
+	{
+		// points of regular grid in the cube <-1.5, 1.5>
+		for (int i = 0; i < grid * grid * grid; i++)
+		{
+			CVector3 point((i % grid) * 3.0 / (grid - 1) - 1.5,
+				((i / grid) % grid) * 3.0 / (grid - 1) - 1.5, (i / (grid * grid)) * 3.0 / (grid - 1) - 1.5);
+			sFractalIn fractIn(point, params.minN, params.N, params.common, -1);
+			sFractalOut fractOut;
+			Compute<fractal::calcModeNormal>(fractals, fractIn, &fractOut);
+			iterations += fractOut.iters;
+			if (!fractOut.maxiter) bailouts++;
+		}
+		points += grid * grid * grid;
+	} while (timer.nsecsElapsed() < FORMULA_BENCHMARK_TIME * 1e9);
+	double time = timer.nsecsElapsed();
+
+	description->nsPerIteration = time / qMax(iterations, 1.0);
+	description->averageIterations = iterations / points;
+	description->bailoutRatio = (double)bailouts / points;
+
+	QJsonObject result;
+	result["name"] = description->internalName;
+	result["ns_per_iteration"] = description->nsPerIteration;
+	result["ns_per_point"] = time / points;
+	result["average_iterations"] = description->averageIterations;
+	result["bailout_ratio"] = description->bailoutRatio;
+	return result;
+}
+
+bool cFormulaBenchmark::LoadResults()
+{
+	QFile file(ResultsFile());
+	if (!file.open(QIODevice::ReadOnly)) return false;
+
+	QJsonArray results = QJsonDocument::fromJson(file.readAll()).object()["formulas"].toArray();
+	QHash<QString, QJsonObject> resultsByName;
+	for (int i = 0; i < results.size(); i++)
+	{
+		QJsonObject result = results[i].toObject();
+		resultsByName.insert(result["name"].toString(), result);
+	}
+
+	for (int i = 0; i < fractalList.size(); i++)
+	{
+		QHash<QString, QJsonObject>::const_iterator it =
+			resultsByName.constFind(fractalList[i].internalName);
+		if (it == resultsByName.constEnd()) continue;
+		fractalList[i].nsPerIteration = it.value()["ns_per_iteration"].toDouble(-1.0);
+		fractalList[i].averageIterations = it.value()["average_iterations"].toDouble(-1.0);
+		fractalList[i].bailoutRatio = it.value()["bailout_ratio"].toDouble(-1.0);
+	}
+	UpdateMedian();
+	return !resultsByName.isEmpty();
+}
+
+void cFormulaBenchmark::UpdateMedian()
+{
+	QList<double> times;
+	for (int i = 0; i < fractalList.size(); i++)
+	{
+		if (fractalList[i].nsPerIteration > 0.0) times.append(fractalList[i].nsPerIteration);
+	}
+
+	if (times.isEmpty())
+	{
+		medianNsPerIteration = -1.0;
+		return;
+	}
+	std::sort(times.begin(), times.end());
+	medianNsPerIteration = times[times.size() / 2];
+}
+
+bool cFormulaBenchmark::IsExpensive(const sFractalDescription &description)
+{
+	return medianNsPerIteration > 0.0
+				 && description.nsPerIteration > medianNsPerIteration * ExpensiveFactor();
+}
@@ -0,0 +1,75 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFormulaBenchmark class - cost of one iteration of every fractal formula
+ *
+ * Every formula of fractalList is iterated over fixed set of points. Time of
+ * one iteration and bailout behaviour are reported as JSON and stored in the
+ * data directory. Stored results are loaded to fractalList at startup, so the
+ * UI can warn about expensive formulas and cost of jobs can be estimated.
+ */
+
+#ifndef MANDELBULBER2_SRC_FORMULA_BENCHMARK_HPP_
+#define MANDELBULBER2_SRC_FORMULA_BENCHMARK_HPP_
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+struct sFractalDescription;
+
+class cFormulaBenchmark
+{
+public:
+	cFormulaBenchmark();
+	~cFormulaBenchmark();
+
+	// measures all formulas, updates fractalList and returns results as JSON text
+	QByteArray Run();
+
+	// results are saved by Run() to this file
+	static QString ResultsFile();
+	// loads saved results to fractalList. Returns false if there are no results
+	static bool LoadResults();
+
+	// formulas slower than this multiple of median time are reported as expensive
+	static double ExpensiveFactor() { return 3.0; }
+	static bool IsExpensive(const sFractalDescription &description);
+
+private:
+	// fills nsPerIteration, averageIterations and bailoutRatio of the formula
+	QJsonObject MeasureFormula(sFractalDescription *description);
+	static void UpdateMedian();
+
+	static double medianNsPerIteration;
+};
+
+#endif /* MANDELBULBER2_SRC_FORMULA_BENCHMARK_HPP_ */
@@ -41,6 +41,7 @@ cFractal::cFractal(const cParameterContainer *container)
 {
 	// WriteLog("cFractal::cFractal(const cParameterContainer *container)");
 	formula = fractal::none;
+	fastMath = false;
 
 	bulb.power = container->Get<double>("power");
 	bulb.alphaAngleOffset = container->Get<double>("alpha_angle_offset");
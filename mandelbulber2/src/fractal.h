@@ -600,6 +600,7 @@ public:
 	void RecalculateFractalParams(void);
 
 	fractal::enumFractalFormula formula;
+	bool fastMath; // use fast approximations of transcendental functions
 	sFractalMandelbulb bulb;
 	sFractalIFS IFS;
 	sFractalMandelbox mandelbox;
@@ -56,6 +56,29 @@ using namespace fractal;
  */
 void MandelbulbIteration(CVector3 &z, const cFractal *fractal, sExtendedAux &aux)
 {
+	if (fractal->fastMath)
+	{
+		if (fractal->bulb.power == 8.0 && fractal->bulb.alphaAngleOffset == 0.0
+				&& fractal->bulb.betaAngleOffset == 0.0)
+		{
+			double rp = MandelbulbPower8Polynomial(z.x, z.y, z.z, aux.r);
+			aux.r_dz = rp * aux.r_dz * 8.0 + 1.0;
+		}
+		else
+		{
+			double th0 = FastAsin(z.z / aux.r) + fractal->bulb.betaAngleOffset;
+			double ph0 = FastAtan2(z.y, z.x) + fractal->bulb.alphaAngleOffset;
+			double rp = pow(aux.r, fractal->bulb.power - 1.0);
+			double sth, cth, sph, cph;
+			FastSinCos(th0 * fractal->bulb.power, &sth, &cth);
+			FastSinCos(ph0 * fractal->bulb.power, &sph, &cph);
+			aux.r_dz = rp * aux.r_dz * fractal->bulb.power + 1.0;
+			rp *= aux.r;
+			z = CVector3(cth * cph, cth * sph, sth) * rp;
+		}
+		return;
+	}
+
 	// if (aux.r < 1e-21) aux.r = 1e-21;
 	double th0 = asin(z.z / aux.r) + fractal->bulb.betaAngleOffset;
 	double ph0 = atan2(z.y, z.x) + fractal->bulb.alphaAngleOffset;
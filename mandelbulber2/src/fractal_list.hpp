@@ -238,6 +238,10 @@ struct sFractalDescription
 	fractal::enumDEFunctionType DEFunctionType;
 	fractal::enumCPixelAddition cpixelAddition;
 	double defaultBailout;
+	// measured by cFormulaBenchmark (-1 if unknown)
+	double nsPerIteration;
+	double averageIterations;
+	double bailoutRatio; // part of points which reached bailout
 
 	sFractalDescription(QString _nameInComboBox, QString _internalName,
 		fractal::enumFractalFormula _internalID, fractal::enumDEType _DEType,
@@ -249,7 +253,10 @@ struct sFractalDescription
 				DEType(_DEType),
 				DEFunctionType(_DEFunctionType),
 				cpixelAddition(_cpixelAddition),
-				defaultBailout(_defaultBailout)
+				defaultBailout(_defaultBailout),
+				nsPerIteration(-1.0),
+				averageIterations(-1.0),
+				bailoutRatio(-1.0)
 	{
 	}
 	QString getIconName() const
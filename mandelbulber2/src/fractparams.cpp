@@ -39,11 +39,18 @@
 cParamRender::cParamRender(const cParameterContainer *container, QVector<cObjectData> *objectData)
 		: primitives(container, objectData)
 {
+	adaptiveSamplingEnabled = container->Get<bool>("adaptive_sampling_enabled");
+	adaptiveSamplingMaxStep = container->Get<int>("adaptive_sampling_max_step");
 	ambientOcclusion = container->Get<double>("ambient_occlusion");
 	ambientOcclusionEnabled = container->Get<bool>("ambient_occlusion_enabled");
 	ambientOcclusionFastTune = container->Get<double>("ambient_occlusion_fast_tune");
 	ambientOcclusionMode = (params::enumAOMode)container->Get<int>("ambient_occlusion_mode");
 	ambientOcclusionQuality = container->Get<int>("ambient_occlusion_quality");
+	ambientOcclusionResolutionDivider = container->Get<int>("ambient_occlusion_resolution_divider");
+	antialiasingEnabled = container->Get<bool>("antialiasing_enabled");
+	antialiasingSize = container->Get<int>("antialiasing_size");
+	antialiasingThreshold = container->Get<double>("antialiasing_threshold");
+	auxLightCulling = container->Get<bool>("aux_light_culling");
 	auxLightNumber = 4;
 	auxLightRandomNumber = container->Get<int>("random_lights_number");
 	auxLightRandomSeed = container->Get<int>("random_lights_random_seed");
@@ -53,12 +60,14 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 		container->Get<double>("random_lights_max_distance_from_fractal");
 	auxLightRandomIntensity = container->Get<double>("random_lights_intensity");
 	auxLightRandomEnabled = container->Get<bool>("random_lights_group");
+	auxLightStochasticSamples = container->Get<int>("aux_light_stochastic_samples");
 	auxLightVisibility = container->Get<double>("aux_light_visibility");
 	auxLightVisibilitySize = container->Get<double>("aux_light_visibility_size");
 	background_color1 = container->Get<sRGB>("background_color", 1);
 	background_color2 = container->Get<sRGB>("background_color", 2);
 	background_color3 = container->Get<sRGB>("background_color", 3);
 	background_brightness = container->Get<double>("background_brightness");
+	backgroundLUTEnabled = container->Get<bool>("background_lut_enabled");
 	booleanOperatorsEnabled = container->Get<bool>("boolean_operators");
 	camera = container->Get<CVector3>("camera");
 	cameraDistanceToTarget = container->Get<double>("camera_distance_to_target");
@@ -69,13 +78,23 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	delta_DE_method = (fractal::enumDEMethod)container->Get<int>("delta_DE_method");
 	detailLevel = container->Get<double>("detail_level");
 	DEThresh = container->Get<double>("DE_thresh");
+	denoiserEnabled = container->Get<bool>("denoiser_enabled");
+	denoiserIterations = container->Get<int>("denoiser_iterations");
+	denoiserStrength = container->Get<double>("denoiser_strength");
+	depthPrepassBlockSize = container->Get<int>("depth_prepass_block_size");
+	depthPrepassEnabled = container->Get<bool>("depth_prepass_enabled");
 	DOFEnabled = container->Get<bool>("DOF_enabled");
+	doubleDoublePrecision = container->Get<bool>("double_double_precision");
 	DOFFocus = container->Get<double>("DOF_focus");
 	DOFRadius = container->Get<double>("DOF_radius");
 	DOFHDRmode = container->Get<bool>("DOF_HDR");
+	DOFFastGather = container->Get<bool>("DOF_fast_gather");
 	DOFMonteCarlo = container->Get<bool>("DOF_monte_carlo");
 	DOFNumberOfPasses = container->Get<int>("DOF_number_of_passes");
 	DOFSamples = container->Get<int>("DOF_samples");
+	DOFMaxNoise = container->Get<double>("DOF_max_noise");
+	DOFMinSamples = container->Get<int>("DOF_min_samples");
+	DOFAdaptiveRedistribution = container->Get<bool>("DOF_adaptive_redistribution");
 	DOFBlurOpacity = container->Get<double>("DOF_blur_opacity");
 	envMappingEnable = container->Get<bool>("env_mapping_enable");
 	fakeLightsEnabled = container->Get<double>("fake_lights_enabled");
@@ -87,10 +106,12 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	fogVisibility = container->Get<double>("basic_fog_visibility");
 	fov = container->Get<double>("fov");
 	frameNo = container->Get<int>("frame_no");
+	fusedFractalColouring = container->Get<bool>("fused_fractal_colouring");
 	glowColor1 = container->Get<sRGB>("glow_color", 1);
 	glowColor2 = container->Get<sRGB>("glow_color", 2);
 	glowEnabled = container->Get<bool>("glow_enabled");
 	glowIntensity = container->Get<double>("glow_intensity");
+	hitRefinementMode = (params::enumRefinementMode)container->Get<int>("hit_refinement_mode");
 	hybridFractalEnable = container->Get<bool>("hybrid_fractal_enable");
 	imageAdjustments.brightness = container->Get<double>("brightness");
 	imageAdjustments.contrast = container->Get<double>("contrast");
@@ -107,6 +128,8 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	iterFogEnabled = container->Get<bool>("iteration_fog_enable");
 	iterFogOpacity = container->Get<double>("iteration_fog_opacity");
 	iterFogOpacityTrim = container->Get<double>("iteration_fog_opacity_trim");
+	iterationLODFactor = container->Get<double>("iteration_lod_factor");
+	iterationLODReference = 0.0;
 	legacyCoordinateSystem = container->Get<bool>("legacy_coordinate_system");
 	limitMax = container->Get<CVector3>("limit_max");
 	limitMin = container->Get<CVector3>("limit_min");
@@ -121,26 +144,45 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	mainLightVisibilitySize = container->Get<double>("main_light_visibility_size");
 	minN = container->Get<int>("minN");
 	N = container->Get<int>("N");
+	netRenderLineCompression = container->Get<bool>("netrender_line_compression");
+	netRenderLineFormat =
+		(params::enumNetRenderLineFormat)container->Get<int>("netrender_line_format");
+	netRenderPostTiles = container->Get<bool>("netrender_post_tiles");
+	netRenderPostTileHalo = container->Get<int>("netrender_post_tile_halo");
+	packetRayMarching = container->Get<bool>("packet_ray_marching");
+	wavefrontShadows = container->Get<bool>("wavefront_shadows");
 	penetratingLights = container->Get<bool>("penetrating_lights");
 	perspectiveType = (params::enumPerspectiveType)container->Get<int>("perspective_type");
+	progressiveDepthReuse = container->Get<bool>("progressive_depth_reuse");
+	raymarchingRelaxation = container->Get<double>("raymarching_relaxation");
 	raytracedReflections = container->Get<bool>("raytraced_reflections");
 	reflectionsMax = container->Get<int>("reflections_max");
 	repeatFrom = container->Get<int>("repeat_from");
 	resolution = 0.0;
+	samplerType = (params::enumSamplerType)container->Get<int>("sampler_type");
 	shadow = container->Get<bool>("shadows_enabled");
+	shadowCacheEnabled = container->Get<bool>("shadow_cache_enabled");
 	shadowConeAngle = container->Get<double>("shadows_cone_angle");
+	singlePrecision = container->Get<bool>("single_precision");
 	slowShading = container->Get<bool>("slow_shading");
 	smoothness = container->Get<double>("smoothness");
 	SSAO_random_mode = container->Get<bool>("SSAO_random_mode");
+	SSAO_hierarchical = container->Get<bool>("SSAO_hierarchical");
 	stereoEyeDistance = container->Get<double>("stereo_eye_distance");
 	stereoInfiniteCorrection = container->Get<double>("stereo_infinite_correction");
+	stereoSinglePass = container->Get<bool>("stereo_single_pass");
 	sweetSpotHAngle = container->Get<double>("sweet_spot_horizontal_angle") / 180.0 * M_PI;
 	sweetSpotVAngle = container->Get<double>("sweet_spot_vertical_angle") / 180.0 * M_PI;
 	target = container->Get<CVector3>("target");
 	target = container->Get<CVector3>("target");
+	temporalDepthReprojection = container->Get<bool>("temporal_depth_reprojection");
+	tetrahedralNormals = container->Get<bool>("tetrahedral_normals");
 	texturedBackground = container->Get<bool>("textured_background");
 	texturedBackgroundMapType =
 		(params::enumTextureMapType)container->Get<int>("textured_background_map_type");
+	tileSchedulerEnabled = container->Get<bool>("tile_scheduler_enabled");
+	tileOrder = container->Get<int>("tile_order");
+	tileSize = container->Get<int>("tile_size");
 	topVector = container->Get<CVector3>("camera_top");
 	useDefaultBailout = container->Get<bool>("use_default_bailout");
 	viewAngle = container->Get<CVector3>("camera_rotation");
@@ -154,6 +196,7 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	volFogDensity = container->Get<double>("volumetric_fog_density");
 	volFogDistanceFactor = container->Get<double>("volumetric_fog_distance_factor");
 	volFogEnabled = container->Get<bool>("volumetric_fog_enabled");
+	volumetricAdaptive = container->Get<bool>("volumetric_adaptive");
 	volumetricLightEnabled[0] = container->Get<double>("main_light_volumetric_enabled");
 	volumetricLightIntensity[0] = container->Get<double>("main_light_volumetric_intensity");
 
@@ -189,6 +232,7 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 		formulaRotation[i] = container->Get<CVector3>("formula_rotation", i + 1);
 		formulaRepeat[i] = container->Get<CVector3>("formula_repeat", i + 1);
 		formulaScale[i] = 1.0 / container->Get<double>("formula_scale", i + 1);
+		formulaBoundingRadius[i] = container->Get<double>("formula_bounding_radius", i + 1);
 		mRotFormulaRotation[i].SetRotation2(formulaRotation[i] * (M_PI / 180.0));
 		formulaMaterialId[i] = container->Get<int>("formula_material_id", i + 1);
 
@@ -224,6 +268,32 @@ cParamRender::cParamRender(const cParameterContainer *container, QVector<cObject
 	common.mRotFractalRotation.SetRotation2(common.fractalRotation / 180.0 * M_PI);
 	common.repeat = container->Get<CVector3>("repeat");
 	common.iterThreshMode = container->Get<bool>("iteration_threshold_mode");
+	common.periodicityCheck = container->Get<bool>("periodicity_check");
+	common.periodicityTolerance = container->Get<double>("periodicity_tolerance");
 
 	// formula = Get<int>("tile_number");
 }
+
+void cParamRender::UpdateCamera(const cParameterContainer *container)
+{
+	camera = container->Get<CVector3>("camera");
+	cameraDistanceToTarget = container->Get<double>("camera_distance_to_target");
+	fov = container->Get<double>("fov");
+	frameNo = container->Get<int>("frame_no");
+	target = container->Get<CVector3>("target");
+	topVector = container->Get<CVector3>("camera_top");
+	viewAngle = container->Get<CVector3>("camera_rotation");
+}
+
+QStringList cParamRender::UpdatableParameters()
+{
+	QStringList list;
+	list << "camera"
+			 << "camera_distance_to_target"
+			 << "fov"
+			 << "frame_no"
+			 << "target"
+			 << "camera_top"
+			 << "camera_rotation";
+	return list;
+}
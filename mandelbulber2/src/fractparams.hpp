@@ -41,6 +41,9 @@
 #include "projection_3d.hpp"
 #include "fractal_enums.h"
 #include "ao_modes.h"
+#include "netrender_line_formats.h"
+#include "refinement_modes.h"
+#include "sampler.hpp"
 
 // forward declarations
 class cObjectData;
@@ -69,18 +72,33 @@ public:
 	// constructor with init
 	cParamRender(const cParameterContainer *par, QVector<cObjectData> *objectData = NULL);
 
+	// updates only camera position and frame number (the parameters listed by
+	// UpdatableParameters()), when nothing else has changed
+	void UpdateCamera(const cParameterContainer *par);
+	static QStringList UpdatableParameters();
+
+	int adaptiveSamplingMaxStep; // maximum distance between rendered pixels of adaptive sampling
 	int ambientOcclusionQuality; // ambient occlusion quality
+	int ambientOcclusionResolutionDivider; // multi-ray AO is calculated for every n-th pixel
+	int antialiasingSize; // sub-pixel grid size for adaptive supersampling
 	int auxLightNumber;
 	int auxLightRandomNumber;
 	int auxLightRandomSeed;
+	int auxLightStochasticSamples; // number of randomly chosen aux lights shaded per point
+	int denoiserIterations;
+	int depthPrepassBlockSize; // size of pixel blocks of coarse depth prepass
 	int frameNo;
 	int imageHeight; // image height
 	int imageWidth;	// image width
 	int formulaMaterialId[NUMBER_OF_FRACTALS];
 	int minN; // minimum number of iterations
 	int N;
+	int netRenderPostTileHalo; // lines around tile post-processed by NetRender client
 	int reflectionsMax;
 	int repeatFrom;
+	int tileOrder; // order of tiles (cTileScheduler::enumTileOrder)
+	int tileSize; // size of tiles for tile scheduler
+	int DOFMinSamples;
 	int DOFNumberOfPasses;
 	int DOFSamples;
 
@@ -91,23 +109,36 @@ public:
 #endif
 
 	params::enumPerspectiveType perspectiveType;
+	params::enumSamplerType samplerType;
 	params::enumAOMode ambientOcclusionMode;
+	params::enumRefinementMode hitRefinementMode; // method of refinement of surface hit point
+	params::enumNetRenderLineFormat netRenderLineFormat; // channels and encoding of sent lines
 	params::enumTextureMapType texturedBackgroundMapType;
 	params::enumBooleanOperator booleanOperator[NUMBER_OF_FRACTALS - 1];
 	fractal::enumDEMethod delta_DE_method;
 	fractal::enumDEFunctionType delta_DE_function;
 
+	bool adaptiveSamplingEnabled; // less pixels where they cover small solid angle
 	bool ambientOcclusionEnabled; // enable global illumination
+	bool antialiasingEnabled;
+	bool auxLightCulling; // shade only aux lights from the grid cell of shaded point
 	bool auxLightPreEnabled[4];
 	bool auxLightRandomEnabled;
+	bool backgroundLUTEnabled; // background and env. map taken from precomputed tables
 	bool booleanOperatorsEnabled;
 	bool constantDEThreshold;
+	bool denoiserEnabled; // edge-aware filtering of noise of Monte Carlo effects
+	bool depthPrepassEnabled;
+	bool DOFAdaptiveRedistribution;
+	bool doubleDoublePrecision; // use double-double numbers for deep zooms
 	bool DOFEnabled;
+	bool DOFFastGather;
 	bool DOFHDRmode;
 	bool DOFMonteCarlo;
 	bool envMappingEnable;
 	bool fakeLightsEnabled;
 	bool fogEnabled;
+	bool fusedFractalColouring; // gather colour and orbit trap by the last evaluation of ray-marching
 	bool glowEnabled;
 	bool hybridFractalEnable;
 	bool interiorMode;
@@ -116,16 +147,29 @@ public:
 	bool limitsEnabled; // enable limits (intersections)
 	bool mainLightEnable;
 	bool mainLightPositionAsRelative;
+	bool netRenderLineCompression; // compress lines sent by NetRender client
+	bool netRenderPostTiles; // SSAO and DOF of still image are distributed to NetRender clients
+	bool packetRayMarching; // march primary rays of neighbouring pixels together
 	bool penetratingLights;
+	bool progressiveDepthReuse;
 	bool raytracedReflections;
 	bool shadow;			// enable shadows
+	bool shadowCacheEnabled; // reuse main light shadows in animations when only camera moves
+	bool singlePrecision; // use float numbers for fractal computation if precision is enough
 	bool slowShading; // enable fake gradient calculation for shading
+	bool SSAO_hierarchical;
 	bool SSAO_random_mode;
+	bool stereoSinglePass; // trace rays of both eyes together and share their shadows and AO
+	bool temporalDepthReprojection; // start rays from depth of previous animation frame
+	bool tetrahedralNormals; // normal vector from 4 distance samples instead of 6
 	bool texturedBackground; // enable testured background
+	bool tileSchedulerEnabled; // use tiles with work-stealing instead of lines
 	bool useDefaultBailout;
+	bool volumetricAdaptive; // skip and merge volumetric steps with negligible contribution
 	bool volumetricLightEnabled[5];
 	bool volumetricLightAnyEnabled;
 	bool volFogEnabled;
+	bool wavefrontShadows; // trace main light shadows of tiles in sorted batches
 
 #ifdef CLSUPPORT
 	bool useCustomOCLFormula;
@@ -148,6 +192,7 @@ public:
 
 	double ambientOcclusion;
 	double ambientOcclusionFastTune;
+	double antialiasingThreshold; // colour, depth or normal difference of edge pixels
 	double auxLightPreIntensity[4];
 	double auxLightVisibility;
 	double auxLightVisibilitySize;
@@ -160,13 +205,16 @@ public:
 	double DEFactor;		// factor for distance estimation steps
 	double detailLevel; // DE threshold factor
 	double DEThresh;
+	double denoiserStrength;
 	double DOFFocus;
 	double DOFRadius;
 	double DOFBlurOpacity;
+	double DOFMaxNoise; // 0 = fixed number of Monte Carlo samples
 	double fakeLightsIntensity;
 	double fakeLightsVisibility;
 	double fakeLightsVisibilitySize;
 	double fogVisibility;
+	double formulaBoundingRadius[NUMBER_OF_FRACTALS]; // bounding sphere in formula coordinates
 	double formulaScale[NUMBER_OF_FRACTALS];
 	double fov; // perspective factor
 	double glowIntensity;
@@ -174,11 +222,14 @@ public:
 	double iterFogColor2Maxiter;
 	double iterFogOpacity;
 	double iterFogOpacityTrim;
+	double iterationLODFactor; // iterations removed for each doubling of detail size
+	double iterationLODReference; // detail size where iterations start to be reduced
 	double mainLightAlpha;
 	double mainLightBeta;
 	double mainLightIntensity;
 	double mainLightVisibility;
 	double mainLightVisibilitySize;
+	double raymarchingRelaxation; // over-relaxation factor of ray-marching steps
 	double resolution; // resolution of image in fractal coordinates
 	double shadowConeAngle;
 	double smoothness;
@@ -0,0 +1,94 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFrameClaims class - claiming of animation frames by instances of render farm
+ */
+
+#include "frame_claims.hpp"
+
+#include <QtCore>
+
+#include "global_data.hpp"
+#include "system.hpp"
+
+cFrameClaims::cFrameClaims(int _staleTime)
+{
+	staleTime = _staleTime;
+	lockFile = NULL;
+}
+
+cFrameClaims::~cFrameClaims()
+{
+	Release();
+}
+
+bool cFrameClaims::Claim(const QString &frameFilename)
+{
+	Release();
+
+	QLockFile *file = new QLockFile(frameFilename + ".lock");
+	file->setStaleLockTime(staleTime * 60000);
+	if (!file->tryLock(0))
+	{
+		delete file;
+		return false;
+	}
+
+	// frame could be finished by other instance just before the lock was created
+	if (QFile::exists(frameFilename))
+	{
+		delete file;
+		return false;
+	}
+
+	lockFile = file;
+	WriteLogString("Frame claimed", frameFilename, 2);
+	return true;
+}
+
+void cFrameClaims::Release()
+{
+	if (lockFile)
+	{
+		// lock file is removed by destructor
+		delete lockFile;
+		lockFile = NULL;
+	}
+}
+
+void cFrameClaims::WaitForOtherInstances(bool *stopRequest)
+{
+	for (int i = 0; i < 100 && !*stopRequest && !systemData.globalStopRequest; i++)
+	{
+		gApplication->processEvents();
+		Wait(100);
+	}
+}
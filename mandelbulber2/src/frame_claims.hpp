@@ -0,0 +1,67 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFrameClaims class - claiming of animation frames by instances of render farm
+ *
+ * Many instances can render the same animation to a shared output folder. Before
+ * a frame is rendered it is claimed with a lock file placed next to the image,
+ * so other instances skip it. Claims of instances which were terminated expire
+ * after the given time and the frames are rendered again by somebody else.
+ */
+
+#ifndef MANDELBULBER2_SRC_FRAME_CLAIMS_HPP_
+#define MANDELBULBER2_SRC_FRAME_CLAIMS_HPP_
+
+#include <QString>
+
+// forward declarations
+class QLockFile;
+
+class cFrameClaims
+{
+public:
+	// claims older than _staleTime [minutes] are taken over. 0 means that claims never expire
+	cFrameClaims(int _staleTime);
+	~cFrameClaims();
+
+	// returns false if frame is claimed by other instance or it's already rendered
+	bool Claim(const QString &frameFilename);
+	void Release();
+
+	// waiting for frames which are still rendered by other instances
+	static void WaitForOtherInstances(bool *stopRequest);
+
+private:
+	int staleTime;
+	QLockFile *lockFile;
+};
+
+#endif /* MANDELBULBER2_SRC_FRAME_CLAIMS_HPP_ */
@@ -0,0 +1,95 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFrameTimeController class - quality of interactive frames adjusted to target frame time
+ */
+
+#include "frame_time_controller.hpp"
+
+#include <QtCore>
+
+#include "fractparams.hpp"
+#include "render_data.hpp"
+
+cFrameTimeController::cFrameTimeController()
+{
+	targetFrameTime = 1.0 / 15.0;
+	quality = 1.0;
+}
+
+void cFrameTimeController::FrameRendered(double seconds, bool finished)
+{
+	if (seconds <= 0.0) return;
+	if (!finished && seconds < targetFrameTime) return;
+
+	// rendering time is roughly proportional to the budget. Change is damped and limited, so
+	// single slow or fast frames don't make the quality jump
+	double ratio = qBound(0.25, targetFrameTime / seconds, 2.0);
+	quality = qBound(0.01, quality * pow(ratio, 0.7), 1.0);
+}
+
+double cFrameTimeController::EffectsBudget() const
+{
+	// switched off effects cost roughly 30% of frame each
+	double budget = quality;
+	if (!AmbientOcclusionAllowed()) budget /= 0.7;
+	if (!ShadowsAllowed()) budget /= 0.7;
+	return qMin(budget, 1.0);
+}
+
+int cFrameTimeController::GetPixelSize() const
+{
+	// every doubling of pixel size renders only quarter of pixels
+	double budget = EffectsBudget();
+	int pixelSize = 1;
+	while (budget < 0.5 && pixelSize < FRAME_TIME_MAX_PIXEL_SIZE)
+	{
+		budget *= 4.0;
+		pixelSize *= 2;
+	}
+	return pixelSize;
+}
+
+double cFrameTimeController::GetDetailFactor() const
+{
+	double budget = EffectsBudget();
+	int pixelSize = GetPixelSize();
+	budget *= pixelSize * pixelSize;
+	return qBound(0.25, budget, 1.0);
+}
+
+void cFrameTimeController::Apply(cParamRender *params, sRenderData *data) const
+{
+	data->reduceDetail = GetDetailFactor();
+	data->minProgressiveStep = GetPixelSize();
+	if (!AmbientOcclusionAllowed()) params->ambientOcclusionEnabled = false;
+	if (!ShadowsAllowed()) params->shadow = false;
+}
@@ -0,0 +1,84 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cFrameTimeController class - quality of interactive frames adjusted to target frame time
+ *
+ * Measured rendering time of each frame changes the relative cost budget of the
+ * next one. Budget is spent by switching off ambient occlusion and shadows,
+ * skipping the finest progressive passes (lower internal resolution) and
+ * reducing detail level.
+ */
+
+#ifndef MANDELBULBER2_SRC_FRAME_TIME_CONTROLLER_HPP_
+#define MANDELBULBER2_SRC_FRAME_TIME_CONTROLLER_HPP_
+
+// maximum size of pixels of reduced frames
+#define FRAME_TIME_MAX_PIXEL_SIZE 8
+// renders started within this time (ms) are treated as interactive navigation
+#define FRAME_TIME_NAVIGATION_INTERVAL 1000
+
+// forward declarations
+class cParamRender;
+struct sRenderData;
+
+class cFrameTimeController
+{
+public:
+	cFrameTimeController();
+
+	void SetTargetFrameTime(double seconds) { targetFrameTime = seconds; }
+	double GetTargetFrameTime() const { return targetFrameTime; }
+	// updates budget of next frame. Interrupted frames are used only if they were too slow
+	void FrameRendered(double seconds, bool finished);
+	// next frame is rendered in full quality
+	void Reset() { quality = 1.0; }
+
+	double GetQuality() const { return quality; }
+	bool IsFullQuality() const { return quality >= 1.0; }
+	bool AmbientOcclusionAllowed() const { return quality >= 0.7; }
+	bool ShadowsAllowed() const { return quality >= 0.4; }
+	// size of pixels rendered in the last progressive pass
+	int GetPixelSize() const;
+	// factor used as sRenderData::reduceDetail
+	double GetDetailFactor() const;
+
+	// reduces quality of already prepared parameters of the frame
+	void Apply(cParamRender *params, sRenderData *data) const;
+
+private:
+	// part of budget left after switching off effects
+	double EffectsBudget() const;
+
+	double targetFrameTime;
+	double quality; // relative cost of frame (1.0 = full quality)
+};
+
+#endif /* MANDELBULBER2_SRC_FRAME_TIME_CONTROLLER_HPP_ */
@@ -0,0 +1,153 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * conversion between single and half precision floating point numbers
+ *
+ * Half precision values are used for compact image buffers and NetRender lines. F16C
+ * instructions are used when they are enabled for compiler (e.g. -mf16c or -march=native).
+ * Too big numbers, infinity and NaN are clamped to the highest finite half value
+ */
+
+
+#ifndef MANDELBULBER2_SRC_HALF_FLOAT_H_
+#define MANDELBULBER2_SRC_HALF_FLOAT_H_
+
+#include <cstring>
+
+#include "color_structures.hpp"
+
+#ifdef __F16C__
+#define HALF_FLOAT_F16C
+#include <immintrin.h>
+#endif
+
+// rgb pixel stored in half precision
+struct sRGBhalf
+{
+	sRGBhalf() : R(0), G(0), B(0) {}
+	unsigned short R, G, B;
+};
+
+inline unsigned short FloatToHalf(float value)
+{
+#ifdef HALF_FLOAT_F16C
+	unsigned short half = _cvtss_sh(value, 0);
+	if ((half & 0x7c00) == 0x7c00) half = (half & 0x8000) | 0x7bff;
+	return half;
+#else
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	unsigned int sign = (bits >> 16) & 0x8000;
+	unsigned int absBits = bits & 0x7fffffff;
+
+	// numbers which round to 65520 or more (also infinity and NaN)
+	if (absBits >= 0x477ff000) return sign | 0x7bff;
+
+	if (absBits < 0x38800000)
+	{
+		// denormalized number or zero
+		if (absBits < 0x33000000) return sign;
+		unsigned int mantissa = (absBits & 0x7fffff) | 0x800000;
+		int shift = 126 - int(absBits >> 23);
+		unsigned int half = mantissa >> shift;
+		unsigned int rest = mantissa & ((1u << shift) - 1);
+		unsigned int halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) half++;
+		return sign | half;
+	}
+
+	// rounding to nearest even. Carry of mantissa goes to the exponent
+	unsigned int half = (absBits - 0x38000000) >> 13;
+	unsigned int rest = absBits & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+	return sign | half;
+#endif
+}
+
+inline float HalfToFloat(unsigned short half)
+{
+#ifdef HALF_FLOAT_F16C
+	return _cvtsh_ss(half);
+#else
+	unsigned int sign = (unsigned int)(half & 0x8000) << 16;
+	unsigned int exponent = (half >> 10) & 0x1f;
+	unsigned int mantissa = half & 0x3ff;
+
+	if (exponent == 0)
+	{
+		float value = mantissa / 16777216.0f;
+		return sign ? -value : value;
+	}
+
+	unsigned int bits;
+	if (exponent == 0x1f)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+#endif
+}
+
+inline sRGBhalf PixelToHalf(const sRGBfloat &pixel)
+{
+	sRGBhalf half;
+	half.R = FloatToHalf(pixel.R);
+	half.G = FloatToHalf(pixel.G);
+	half.B = FloatToHalf(pixel.B);
+	return half;
+}
+
+inline sRGBfloat HalfToPixel(const sRGBhalf &half)
+{
+	return sRGBfloat(HalfToFloat(half.R), HalfToFloat(half.G), HalfToFloat(half.B));
+}
+
+// converts line of pixels. With F16C 8 values are converted at once
+inline void HalfToPixelArray(const sRGBhalf *source, sRGBfloat *destination, int count)
+{
+	const unsigned short *halfs = &source[0].R;
+	float *floats = &destination[0].R;
+	int size = count * 3;
+	int i = 0;
+#ifdef HALF_FLOAT_F16C
+	for (; i + 8 <= size; i += 8)
+	{
+		__m128i half8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(halfs + i));
+		_mm256_storeu_ps(floats + i, _mm256_cvtph_ps(half8));
+	}
+#endif
+	for (; i < size; i++)
+		floats[i] = HalfToFloat(halfs[i]);
+}
+
+#endif /* MANDELBULBER2_SRC_HALF_FLOAT_H_ */
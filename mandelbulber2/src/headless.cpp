@@ -33,20 +33,36 @@
  */
 
 #include "headless.h"
+
+#include <algorithm>
+
 #include "animation_flight.hpp"
 #include "animation_keyframes.hpp"
+#include "command_line_interface.hpp"
 #include "cimage.hpp"
 #include "error_message.hpp"
 #include "file_image.hpp"
 #include "files.h"
 #include "fractal_container.hpp"
+#include "fractparams.hpp"
 #include "global_data.hpp"
 #include "initparameters.hpp"
 #include "interface.hpp"
+#include "memory_estimator.hpp"
+#include "netrender.hpp"
+#include "netrender_post_tiles.hpp"
+#include "parameter_sweep.hpp"
+#include "progress_stream.hpp"
 #include "queue.hpp"
+#include "render_checkpoint.hpp"
 #include "render_job.hpp"
+#include "render_time_budget.hpp"
+#include "render_worker_pool.hpp"
 #include "rendering_configuration.hpp"
+#include "resource_report.hpp"
+#include "tiled_render.hpp"
 #include "voxel_export.hpp"
+#include "mesh_export.hpp"
 
 cHeadless::cHeadless() : QObject()
 {
@@ -58,6 +74,42 @@ cHeadless::~cHeadless()
 
 void cHeadless::RenderStillImage(QString filename, QString imageFileFormat)
 {
+	// very big images are rendered in tiles and streamed to the file
+	if (cTiledRender::IsTiledRenderingRequired(gPar))
+	{
+		RenderTiledImage(filename, imageFileFormat);
+		return;
+	}
+
+	// quality is reduced to render the image within time budget
+	if (gPar->Get<double>("render_time_budget") > 0.0)
+	{
+		cRenderTimeBudget timeBudget(gPar->Get<double>("render_time_budget"));
+		if (timeBudget.Fit(gPar, *gParFractal))
+		{
+			QTextStream out(stdout);
+			QStringList changes = timeBudget.GetChanges();
+			for (int i = 0; i < changes.size(); i++)
+				out << QObject::tr("Time budget: ") << changes[i] << "\n";
+			out << QObject::tr("Time budget: estimated render time %1 s")
+							 .arg(timeBudget.GetEstimatedTime(), 0, 'f', 1)
+					<< "\n";
+			out.flush();
+		}
+	}
+
+	cResourceReport report;
+	bool reportEnabled = cResourceReport::IsEnabled();
+	if (reportEnabled)
+	{
+		report.Start(QFileInfo(filename).baseName());
+		int width = gPar->Get<int>("image_width");
+		int height = gPar->Get<int>("image_height");
+		sImageOptional optional = cMemoryEstimator::ImageOptionalFromParams(gPar);
+		report.SetEstimatedMemory(
+			cMemoryEstimator::EstimateJob(gPar, width, height, optional).Total());
+	}
+
 	cImage *image = new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
 	cRenderJob *renderJob = new cRenderJob(gPar, gParFractal, image, &gMainInterface->stopRequest);
 
@@ -72,12 +124,39 @@ void cHeadless::RenderStillImage(QString filename, QString imageFileFormat)
 	config.DisableProgressiveRender();
 	config.EnableNetRender();
 
+	// finished lines of long renders are saved, so the render can be resumed after crash
+	QString checkpointFile;
+	if (gPar->Get<int>("checkpoint_interval") > 0)
+	{
+		checkpointFile = cRenderCheckpoint::FileNameForImage(filename);
+		config.SetCheckpoint(checkpointFile, cRenderCheckpoint::SettingsHash(gPar, gParFractal),
+			gPar->Get<int>("checkpoint_interval"), systemData.resumeRendering);
+	}
+
 	renderJob->Init(cRenderJob::still, config);
-	renderJob->Execute();
+	bool finished = renderJob->Execute() && !gMainInterface->stopRequest;
 
 	QFileInfo fi(filename);
 	filename = fi.path() + QDir::separator() + fi.baseName();
+	SaveStillImage(filename, imageFileFormat, image);
 
+	if (finished && !checkpointFile.isEmpty()) QFile::remove(checkpointFile);
+
+	if (reportEnabled)
+	{
+		report.AddStatistics(renderJob->GetStatistics());
+		report.Finish();
+		report.Save(cResourceReport::FileNameForImage(filename));
+	}
+
+	delete renderJob;
+	delete image;
+	emit finished();
+}
+
+QString cHeadless::SaveStillImage(
+	const QString &filename, const QString &imageFileFormat, cImage *image)
+{
 	QString ext;
 	if (imageFileFormat == "png16" || imageFileFormat == "png16alpha")
 	{
@@ -86,6 +165,7 @@ void cHeadless::RenderStillImage(QString filename, QString imageFileFormat)
 			ImageFileSave::IMAGE_CONTENT_COLOR, ImageFileSave::IMAGE_CHANNEL_QUALITY_16, "");
 		bool appendAlpha = (imageFileFormat == "png16alpha");
 		ImageFileSavePNG::SavePNG(filename + ext, image, saveImageChannel, appendAlpha);
+		cProgressStream::ImageSaved(filename + ext);
 	}
 	else
 	{
@@ -96,12 +176,108 @@ void cHeadless::RenderStillImage(QString filename, QString imageFileFormat)
 
 	QTextStream out(stdout);
 	out << "Image saved to: " << filename << ext << "\n";
+	return filename + ext;
+}
 
-	delete renderJob;
+void cHeadless::RenderSweep(QString filename, QString imageFileFormat, const QString &sweepSpec)
+{
+	cParameterSweep sweep;
+	if (!sweep.Parse(sweepSpec))
+	{
+		cErrorMessage::showMessage(sweep.GetErrorText(), cErrorMessage::errorMessage);
+		emit finished();
+		return;
+	}
+
+	QFileInfo fi(filename);
+	QString baseName = fi.path() + QDir::separator() + fi.baseName();
+
+	// scene is loaded once. Worker threads, image buffers and textures are shared by variations
+	cParameterContainer basePar = *gPar;
+	cFractalContainer baseParFractal = *gParFractal;
+	cImage *image = new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
+	cRenderWorkerPool *workerPool = new cRenderWorkerPool;
+
+	QTextStream out(stdout);
+	for (int i = 0; i < sweep.GetNumberOfVariations(); i++)
+	{
+		if (gMainInterface->stopRequest) break;
+
+		*gPar = basePar;
+		*gParFractal = baseParFractal;
+		QString overrides = sweep.GetOverrides(i);
+		cCommandLineInterface::OverrideParameters(overrides, gPar, gParFractal);
+		out << QObject::tr("Sweep variation %1 of %2: %3")
+						 .arg(i + 1)
+						 .arg(sweep.GetNumberOfVariations())
+						 .arg(overrides)
+				<< "\n";
+		out.flush();
+
+		cRenderJob *renderJob = new cRenderJob(gPar, gParFractal, image, &gMainInterface->stopRequest);
+		renderJob->UseWorkerPool(workerPool);
+		QObject::connect(renderJob,
+			SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+			SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+		QObject::connect(renderJob, SIGNAL(updateStatistics(cStatistics)), this,
+			SLOT(slotUpdateStatistics(cStatistics)));
+
+		cRenderingConfiguration config;
+		config.DisableRefresh();
+		config.DisableProgressiveRender();
+		config.EnableNetRender();
+
+		renderJob->Init(cRenderJob::still, config);
+		bool result = renderJob->Execute();
+		delete renderJob;
+		if (!result) break;
+
+		SaveStillImage(cParameterSweep::VariationFileName(baseName, i + 1), imageFileFormat, image);
+	}
+
+	*gPar = basePar;
+	*gParFractal = baseParFractal;
+	delete workerPool;
 	delete image;
 	emit finished();
 }
 
+void cHeadless::RenderTiledImage(QString filename, QString imageFileFormat)
+{
+	if (imageFileFormat != "png16")
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Tiled rendering supports only 16-bit PNG files. Image will be saved as png16"),
+			cErrorMessage::warningMessage);
+	}
+
+	cTiledRender *tiledRender = new cTiledRender(gPar, gParFractal, &gMainInterface->stopRequest);
+	QObject::connect(tiledRender,
+		SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+		SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+	QObject::connect(tiledRender, SIGNAL(updateStatistics(cStatistics)), this,
+		SLOT(slotUpdateStatistics(cStatistics)));
+
+	QFileInfo fi(filename);
+	filename = fi.path() + QDir::separator() + fi.baseName();
+
+	QTextStream out(stdout);
+	if (tiledRender->Render(filename))
+	{
+		out << "Image saved to: " << filename << ".png\n";
+		cProgressStream::ImageSaved(filename + ".png");
+	}
+	else
+	{
+		cErrorMessage::showMessage(
+			QObject::tr("Tiled rendering failed or was stopped"), cErrorMessage::errorMessage);
+	}
+	out.flush();
+
+	delete tiledRender;
+	emit finished();
+}
+
 void cHeadless::RenderQueue()
 {
 	gQueue->slotQueueRender();
@@ -157,6 +333,38 @@ void cHeadless::RenderVoxel()
 	emit finished();
 }
 
+void cHeadless::RenderMesh()
+{
+	CVector3 limitMin;
+	CVector3 limitMax;
+	if (gPar->Get<bool>("voxel_custom_limit_enabled"))
+	{
+		limitMin = gPar->Get<CVector3>("voxel_limit_min");
+		limitMax = gPar->Get<CVector3>("voxel_limit_max");
+	}
+	else
+	{
+		limitMin = gPar->Get<CVector3>("limit_min");
+		limitMax = gPar->Get<CVector3>("limit_max");
+	}
+	int maxIter = gPar->Get<int>("voxel_max_iter");
+	QString outputFileName = gPar->Get<QString>("mesh_output_filename");
+	int samplesX = gPar->Get<int>("voxel_samples_x");
+	int samplesY = gPar->Get<int>("voxel_samples_y");
+	int samplesZ = gPar->Get<int>("voxel_samples_z");
+	cMeshExport::enumMeshFileFormat outputFormat =
+		cMeshExport::enumMeshFileFormat(gPar->Get<int>("mesh_output_format"));
+
+	cMeshExport *meshExport = new cMeshExport(samplesX, samplesY, samplesZ, limitMin, limitMax,
+		QFileInfo(outputFileName).absoluteFilePath(), maxIter, outputFormat);
+	QObject::connect(meshExport,
+		SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+		SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+	meshExport->ProcessVolume();
+	delete meshExport;
+	emit finished();
+}
+
 void cHeadless::RenderFlightAnimation()
 {
 	cImage *image = new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
@@ -223,19 +431,101 @@ void cHeadless::slotNetRender()
 	emit finished();
 }
 
+void cHeadless::slotNetRenderFrame()
+{
+	gMainInterface->stopRequest = true;
+	cImage *image = new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
+	cRenderJob *renderJob = new cRenderJob(gPar, gParFractal, image, &gMainInterface->stopRequest);
+	if (systemData.noGui)
+	{
+		QObject::connect(renderJob,
+			SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+			SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+		QObject::connect(renderJob, SIGNAL(updateStatistics(cStatistics)), this,
+			SLOT(slotUpdateStatistics(cStatistics)));
+	}
+
+	// whole frame is rendered locally, so lines are not exchanged with the server
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+
+	renderJob->Init(cRenderJob::still, config);
+	if (renderJob->Execute())
+		SaveImage(gNetRender->GetFrameJobFileName(), gNetRender->GetFrameJobImageType(), image);
+
+	delete renderJob;
+	delete image;
+	emit finished();
+}
+
+void cHeadless::slotNetRenderVoxelSlab()
+{
+	const sVoxelSlabJob &slab = gNetRender->GetSlabJob();
+	gMainInterface->stopRequest = false;
+
+	// folder is not used, because layers are sent to the server
+	cVoxelExport *voxelExport = new cVoxelExport(
+		slab.w, slab.h, slab.l, slab.limitMin, slab.limitMax, QDir(), slab.maxIter);
+
+	QByteArray voxels;
+	QByteArray distances;
+	if (voxelExport->CalculateSlab(slab.firstZ, slab.numberOfLayers, slab.storeDistances, &voxels,
+				&distances, &gMainInterface->stopRequest))
+	{
+		gNetRender->SetVoxelSlabResult(
+			qCompress(voxels), distances.isEmpty() ? QByteArray() : qCompress(distances));
+	}
+	else
+	{
+		gNetRender->SetVoxelSlabResult(QByteArray(), QByteArray());
+	}
+
+	delete voxelExport;
+	emit finished();
+}
+
+void cHeadless::slotNetRenderPostTile()
+{
+	const sPostTileJob &tile = gNetRender->GetPostTileJob();
+	QList<int> lineNumbers;
+	QList<QByteArray> lines;
+	gNetRender->TakePostTileLines(&lineNumbers, &lines);
+	gMainInterface->stopRequest = false;
+
+	// settings of the rendered image are still loaded
+	cParamRender params(gPar);
+	int width = gPar->Get<int>("image_width");
+	int height = gPar->Get<int>("image_height");
+	QByteArray result;
+	cImage *tileImage = cNetRenderPostTiles::CreateTileImage(width, tile, lineNumbers, lines);
+	if (tileImage)
+	{
+		result = cNetRenderPostTiles::RenderTile(
+			&params, tileImage, tile, width, height, &gMainInterface->stopRequest);
+		delete tileImage;
+	}
+	gNetRender->SetPostTileResult(result);
+	emit finished();
+}
+
 void cHeadless::slotUpdateProgressAndStatus(const QString &text, const QString &progressText,
 	double progress, cProgressText::enumProgressType progressType)
 {
+	cProgressStream::Progress(text, progress, progressType);
+	if (cProgressStream::UsesStdout()) return;
+
 	static bool firstCallProgressUpdate = true;
 	if (firstCallProgressUpdate)
 	{
 		firstCallProgressUpdate = false;
 		QTextStream out(stdout);
 		out << "\n\n\n";
-		if (systemData.statsOnCLI) out << "\n\n";
+		if (systemData.statsOnCLI) out << "\n\n\n";
 		out.flush();
 	}
-	if (systemData.statsOnCLI) MoveCursor(0, -2);
+	if (systemData.statsOnCLI) MoveCursor(0, -3);
 	if (gMainInterface->headless)
 	{
 		switch (progressType)
@@ -256,18 +546,19 @@ void cHeadless::slotUpdateProgressAndStatus(const QString &text, const QString &
 			case cProgressText::progress_ANIMATION: MoveCursor(0, 1); EraseLine();
 			case cProgressText::progress_IMAGE: MoveCursor(0, 1);
 		}
-		if (systemData.statsOnCLI) MoveCursor(0, 2);
+		if (systemData.statsOnCLI) MoveCursor(0, 3);
 	}
 }
 
 void cHeadless::slotUpdateStatistics(const cStatistics &stat)
 {
-	if (!systemData.statsOnCLI) return;
+	cProgressStream::Statistics(stat);
+	if (!systemData.statsOnCLI || cProgressStream::UsesStdout()) return;
 	/*ui->label_histogram_de->SetBarcolor(QColor(0, 255, 0));
 	 ui->label_histogram_de->UpdateHistogram(stat.histogramStepCount);
 	 ui->label_histogram_iter->UpdateHistogram(stat.histogramIterations);
 	 */
-	if (systemData.statsOnCLI) MoveCursor(0, -2);
+	if (systemData.statsOnCLI) MoveCursor(0, -3);
 	QTextStream out(stdout);
 	QString statsText = "";
 	statsText += tr("Total number of iters").leftJustified(25, ' ') + ": ";
@@ -288,6 +579,28 @@ void cHeadless::slotUpdateStatistics(const cStatistics &stat)
 	statsText += colorize(QString::number(stat.GetMissedDEPercentage()).rightJustified(12, ' '),
 								 ansiBlue, noExplicitColor, true)
 							 + "\n";
+
+	// the most time consuming stages of rendering threads (known when rendering is finished)
+	double totalStageTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		totalStageTime += stat.stageTimes[i];
+	statsText += tr("Rendering stages").leftJustified(25, ' ') + ": ";
+	if (totalStageTime > 0.0)
+	{
+		QList<QPair<double, int> > stages;
+		for (int i = 0; i < renderStageCount; i++)
+			stages.append(qMakePair(stat.stageTimes[i], i));
+		std::sort(stages.begin(), stages.end());
+		for (int i = 0; i < 4; i++)
+		{
+			const QPair<double, int> &stage = stages[renderStageCount - 1 - i];
+			if (i > 0) statsText += ", ";
+			statsText += cStageTimer::StageName(stage.second) + " "
+									 + colorize(QString::number(stage.first / totalStageTime * 100.0, 'f', 1) + "%",
+										 ansiBlue, noExplicitColor, true);
+		}
+	}
+	statsText += "\n";
 	out << statsText;
 	out.flush();
 }
@@ -39,6 +39,9 @@
 #include "statistics.h"
 #include <QtCore>
 
+// forward declarations
+class cImage;
+
 class cHeadless : public QObject
 {
 	Q_OBJECT
@@ -60,8 +63,13 @@ public:
 	};
 
 	void RenderStillImage(QString filename, QString imageFileFormat);
+	// renders all variations of parameters of loaded scene one after another
+	void RenderSweep(QString filename, QString imageFileFormat, const QString &sweepSpec);
+	// rendering of very big image in tiles, saved as 16-bit PNG
+	void RenderTiledImage(QString filename, QString imageFileFormat);
 	void RenderQueue();
 	void RenderVoxel();
+	void RenderMesh();
 	void RenderFlightAnimation();
 	void RenderKeyframeAnimation();
 	static void RenderingProgressOutput(
@@ -73,8 +81,15 @@ public:
 	static void MoveCursor(int leftRight, int downUp);
 	static void EraseLine();
 
+private:
+	// saves image in given format. Returns name of file with extension
+	QString SaveStillImage(const QString &filename, const QString &imageFileFormat, cImage *image);
+
 public slots:
 	void slotNetRender();
+	void slotNetRenderFrame();
+	void slotNetRenderVoxelSlab();
+	void slotNetRenderPostTile();
 	void slotUpdateProgressAndStatus(const QString &text, const QString &progressText,
 		double progress, cProgressText::enumProgressType progressType = cProgressText::progress_IMAGE);
 	void slotUpdateStatistics(const cStatistics &stat);
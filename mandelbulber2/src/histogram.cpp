@@ -50,7 +50,7 @@ cHistogram::cHistogram(int size)
 
 cHistogram::~cHistogram()
 {
-	if (data) delete[] data;
+	if (data) qFreeAligned(data);
 	data = NULL;
 }
 
@@ -71,14 +71,15 @@ cHistogram &cHistogram::operator=(const cHistogram &source)
 
 void cHistogram::Resize(int size)
 {
-	if (data) delete[] data;
+	if (data) qFreeAligned(data);
 	data = NULL;
 	Alloc(size);
 }
 
 void cHistogram::Alloc(int size)
 {
-	data = new long[size + 1];
+	// buckets start at cache line boundary, so histograms of different threads don't share lines
+	data = static_cast<long *>(qMallocAligned(sizeof(long) * (size + 1), 64));
 	histSize = size;
 	count = 0;
 	sum = 0;
@@ -122,3 +123,15 @@ void cHistogram::Clear()
 	count = 0;
 	sum = 0;
 }
+
+void cHistogram::Merge(const cHistogram &source)
+{
+	if (!data || !source.data) return;
+
+	for (int i = 0; i <= source.histSize; i++)
+	{
+		data[qMin(i, histSize)] += source.data[i];
+	}
+	count += source.count;
+	sum += source.sum;
+}
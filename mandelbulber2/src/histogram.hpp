@@ -48,6 +48,8 @@ public:
 	~cHistogram();
 	void Resize(int size);
 	void Clear();
+	// adds all entries of other histogram. Entries out of range are added to the last bucket
+	void Merge(const cHistogram &source);
 
 	inline void Add(int index)
 	{
@@ -0,0 +1,168 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cImageSaveQueue class - saving of animation frames in background thread
+ */
+
+#include "image_save_queue.hpp"
+
+#include "cimage.hpp"
+#include "files.h"
+#include "render_image.hpp"
+#include "system.hpp"
+
+cImageSaveQueue::cImageSaveQueue(int _maxDepth) : QObject()
+{
+	maxDepth = _maxDepth;
+	allocatedImages = 0;
+	imagesInUse = 0;
+	stopRequest = false;
+
+	// with zero depth images are saved immediately by calling thread
+	if (maxDepth > 0)
+	{
+		workerThread.setObjectName("ImageSaver");
+		moveToThread(&workerThread);
+		connect(this, SIGNAL(saveRequested()), this, SLOT(slotSaveNext()), Qt::QueuedConnection);
+		workerThread.start();
+	}
+}
+
+cImageSaveQueue::~cImageSaveQueue()
+{
+	Flush();
+	if (workerThread.isRunning())
+	{
+		workerThread.quit();
+		workerThread.wait();
+	}
+
+	for (int i = 0; i < spareImages.size(); i++)
+		delete spareImages[i];
+}
+
+void cImageSaveQueue::Enqueue(const QString &filename, ImageFileSave::enumImageFileType fileType,
+	cImage *image, QObject *updateReceiver, const cParameterContainer *postProcessingParams)
+{
+	if (maxDepth == 0)
+	{
+		if (postProcessingParams)
+			cRenderer::PostProcessImage(postProcessingParams, image, &stopRequest);
+		SaveImage(filename, fileType, image, updateReceiver);
+		return;
+	}
+
+	mutex.lock();
+	while (spareImages.isEmpty() && allocatedImages >= maxDepth)
+	{
+		stateChanged.wait(&mutex);
+	}
+
+	cImage *copy;
+	if (spareImages.isEmpty())
+	{
+		copy = new cImage(image->GetWidth(), image->GetHeight(), true);
+		allocatedImages++;
+	}
+	else
+	{
+		copy = spareImages.takeFirst();
+	}
+	imagesInUse++;
+	mutex.unlock();
+
+	WriteLog("cImageSaveQueue::Enqueue() " + filename, 2);
+
+	// image is copied without lock, because worker thread doesn't use spare images
+	if (!copy->CopyFrom(image))
+	{
+		// not enough memory for copy. Image is saved directly
+		mutex.lock();
+		spareImages.append(copy);
+		imagesInUse--;
+		stateChanged.wakeAll();
+		mutex.unlock();
+		if (postProcessingParams)
+			cRenderer::PostProcessImage(postProcessingParams, image, &stopRequest);
+		SaveImage(filename, fileType, image, updateReceiver);
+		return;
+	}
+
+	sSaveJob job;
+	job.filename = filename;
+	job.fileType = fileType;
+	job.imageConfig = ImageConfigFromPreferences();
+	job.image = copy;
+	job.postProcess = postProcessingParams != NULL;
+	if (postProcessingParams) job.postProcessingParams = *postProcessingParams;
+
+	mutex.lock();
+	pendingJobs.append(job);
+	mutex.unlock();
+	emit saveRequested();
+}
+
+void cImageSaveQueue::Flush()
+{
+	mutex.lock();
+	while (imagesInUse > 0)
+	{
+		stateChanged.wait(&mutex);
+	}
+	mutex.unlock();
+}
+
+void cImageSaveQueue::slotSaveNext()
+{
+	mutex.lock();
+	if (pendingJobs.isEmpty())
+	{
+		mutex.unlock();
+		return;
+	}
+	sSaveJob job = pendingJobs.takeFirst();
+	mutex.unlock();
+
+	if (job.postProcess)
+	{
+		cRenderer::PostProcessImage(&job.postProcessingParams, job.image, &stopRequest);
+		WriteLog("cImageSaveQueue::slotSaveNext() post-processed " + job.filename, 2);
+	}
+
+	SaveImage(job.filename, job.fileType, job.image, job.imageConfig);
+	WriteLog("cImageSaveQueue::slotSaveNext() saved " + job.filename, 2);
+
+	mutex.lock();
+	spareImages.append(job.image);
+	imagesInUse--;
+	stateChanged.wakeAll();
+	mutex.unlock();
+}
@@ -0,0 +1,104 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cImageSaveQueue class - saving of animation frames in background thread
+ *
+ * Finished frame is copied to one of spare images and saved by separate thread,
+ * so rendering of next frame can start immediately. Number of spare images is
+ * limited, so when saving is slower than rendering, rendering waits for free image.
+ *
+ * Frames rendered with deferred post-processing (cRenderJob::SetDeferredPostProcessing())
+ * go through two stages in the saving thread: SSAO and DOF, then saving. Effects of frame N
+ * are then calculated in parallel with rendering of frame N+1.
+ */
+
+#ifndef MANDELBULBER2_SRC_IMAGE_SAVE_QUEUE_HPP_
+#define MANDELBULBER2_SRC_IMAGE_SAVE_QUEUE_HPP_
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "file_image.hpp"
+#include "parameters.hpp"
+
+// forward declarations
+class cImage;
+
+class cImageSaveQueue : public QObject
+{
+	Q_OBJECT
+
+public:
+	// _maxDepth - maximum number of frames waiting for saving. 0 means saving without queue
+	cImageSaveQueue(int _maxDepth);
+	~cImageSaveQueue();
+
+	// copies image and schedules saving. Waits if all spare images are used
+	// updateReceiver gets progress only when image is saved without the queue
+	// postProcessingParams - settings of frame which effects were deferred (NULL if image is final)
+	void Enqueue(const QString &filename, ImageFileSave::enumImageFileType fileType, cImage *image,
+		QObject *updateReceiver = NULL, const cParameterContainer *postProcessingParams = NULL);
+
+	// waits until all scheduled images are saved
+	void Flush();
+
+signals:
+	void saveRequested();
+
+private slots:
+	void slotSaveNext();
+
+private:
+	struct sSaveJob
+	{
+		QString filename;
+		ImageFileSave::enumImageFileType fileType;
+		ImageFileSave::ImageConfig imageConfig;
+		cImage *image;
+		bool postProcess;
+		cParameterContainer postProcessingParams;
+	};
+
+	QThread workerThread;
+	QMutex mutex;
+	QWaitCondition stateChanged;
+	QList<sSaveJob> pendingJobs;
+	QList<cImage *> spareImages;
+	int maxDepth;
+	int allocatedImages;
+	int imagesInUse;
+	bool stopRequest; // effects of queued frames are never interrupted
+};
+
+#endif /* MANDELBULBER2_SRC_IMAGE_SAVE_QUEUE_HPP_ */
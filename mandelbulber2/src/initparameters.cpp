@@ -47,8 +47,63 @@
 
 cParameterContainer *gPar = NULL;
 
-// definition of all parameters
+static void DefineParams(cParameterContainer *par);
+static void DefineFractalParams(cParameterContainer *par);
+
+// prototype container with default parameters, built once and then copied
+struct sParameterPrototype
+{
+	sParameterPrototype() : container(NULL) {}
+	cParameterContainer *container;
+	QString key;
+};
+
+// default values of some parameters depend on data folders, so prototype is built again if they
+// were changed
+static QString PrototypeKey()
+{
+	return systemData.GetDataDirectoryUsed() + "|" + systemData.dataDirectory + "|"
+				 + systemData.sharedDir + "|" + QDir::tempPath();
+}
+
+// copies prototype to empty container. Not empty containers get parameters added one by one
+static void InitFromPrototype(cParameterContainer *par, sParameterPrototype *prototype,
+	void (*define)(cParameterContainer *par))
+{
+	static QMutex mutex;
+
+	if (!par->GetListOfParameters().isEmpty())
+	{
+		define(par);
+		return;
+	}
+
+	QMutexLocker lock(&mutex);
+	QString key = PrototypeKey();
+	if (!prototype->container || prototype->key != key)
+	{
+		delete prototype->container;
+		prototype->container = new cParameterContainer;
+		define(prototype->container);
+		prototype->key = key;
+	}
+	par->AssignFromPrototype(*prototype->container);
+}
+
 void InitParams(cParameterContainer *par)
+{
+	static sParameterPrototype prototype;
+	InitFromPrototype(par, &prototype, DefineParams);
+}
+
+void InitFractalParams(cParameterContainer *par)
+{
+	static sParameterPrototype prototype;
+	InitFromPrototype(par, &prototype, DefineFractalParams);
+}
+
+// definition of all parameters
+static void DefineParams(cParameterContainer *par)
 {
 	using namespace parameterContainer;
 
@@ -58,8 +113,11 @@ void InitParams(cParameterContainer *par)
 	par->addParam("image_width", 800, 5, 65535, morphNone, paramStandard);
 	par->addParam("image_height", 600, 5, 65535, morphNone, paramStandard);
 	par->addParam("tiles", 1, 1, 64, morphNone, paramStandard);
+	par->addParam("tiles_halo", 32, 0, 1024, morphNone, paramStandard);
 	par->addParam("tile_number", 0, morphNone, paramStandard);
 	par->addParam("image_proportion", 0, morphNone, paramNoSave);
+	// quality is reduced to render frame within given time [s], 0 = off
+	par->addParam("render_time_budget", 0.0, 0.0, 1e6, morphNone, paramStandard);
 
 	// flight animation
 	par->addParam("flight_first_to_render", 0, 0, 99999, morphNone, paramStandard);
@@ -77,6 +135,7 @@ void InitParams(cParameterContainer *par)
 	par->addParam("flight_rotation_speed_vector", CVector3(0.0, 0.0, 0.0), morphNone, paramStandard);
 	par->addParam("flight_sec_per_frame", 1.0, morphNone, paramApp);
 	par->addParam("flight_animation_image_type", 0, morphNone, paramApp);
+	par->addParam("flight_checkerboard", false, morphNone, paramStandard);
 	par->addParam("anim_flight_dir", systemData.GetAnimationFolder() + QDir::separator(), morphNone,
 		paramStandard);
 
@@ -90,8 +149,16 @@ void InitParams(cParameterContainer *par)
 		paramStandard);
 	par->addParam("keyframe_collision_thresh", 1.0e-6, 1e-15, 1.0e2, morphNone, paramStandard);
 	par->addParam("keyframe_auto_validate", true, morphNone, paramApp);
+	par->addParam("keyframe_skip_identical_frames", true, morphNone, paramApp);
 	par->addParam("keyframe_constant_target_distance", 0.1, 1e-10, 1.0e2, morphNone, paramStandard);
 
+	// rendering of animation by many instances sharing output folder
+	par->addParam("anim_farm_mode", false, morphNone, paramStandard);
+	par->addParam("anim_farm_claim_timeout", 60, 0, 99999, morphNone, paramStandard);
+
+	// variations of parameters rendered by queue (format of --sweep option)
+	par->addParam("sweep", QString(""), morphNone, paramStandard);
+
 	// camera
 	par->addParam("camera", CVector3(3.0, -6.0, 2.0), morphAkima, paramStandard);
 	par->addParam("target", CVector3(0.0, 0.0, 0.0), morphAkima, paramStandard);
@@ -144,6 +211,7 @@ void InitParams(cParameterContainer *par)
 		par->addParam("formula_rotation", i, CVector3(0.0, 0.0, 0.0), morphAkimaAngle, paramStandard);
 		par->addParam("formula_repeat", i, CVector3(0.0, 0.0, 0.0), morphAkima, paramStandard);
 		par->addParam("formula_scale", i, 1.0, morphAkima, paramStandard);
+		par->addParam("formula_bounding_radius", i, 0.0, 0.0, 1e10, morphAkima, paramStandard);
 		par->addParam("dont_add_c_constant", i, false, morphLinear, paramStandard);
 		par->addParam("check_for_bailout", i, true, morphLinear, paramStandard);
 		par->addParam("formula_material_id", i, 1, morphLinear, paramStandard);
@@ -161,6 +229,8 @@ void InitParams(cParameterContainer *par)
 	par->addParam("DE_thresh", 0.01, 1e-15, 1e5, morphLinear, paramStandard);
 	par->addParam("smoothness", 1.0, 1e-15, 1e15, morphLinear, paramStandard);
 	par->addParam("iteration_threshold_mode", false, morphNone, paramStandard);
+	par->addParam("periodicity_check", false, morphNone, paramStandard);
+	par->addParam("periodicity_tolerance", 1e-10, 1e-15, 1e-3, morphNone, paramStandard);
 	par->addParam("analityc_DE_mode", true, morphNone, paramStandard);
 	par->addParam("DE_factor", 1.0, 1e-15, 1e15, morphLinear, paramStandard);
 	par->addParam("slow_shading", false, morphLinear, paramStandard);
@@ -170,6 +240,7 @@ void InitParams(cParameterContainer *par)
 	par->addParam("limit_max", CVector3(10.0, 10.0, 10.0), morphLinear, paramStandard);
 	par->addParam("limits_enabled", false, morphLinear, paramStandard);
 	par->addParam("limit_outer_bounding", 100.0, 1e-15, 1e15, morphLinear, paramStandard);
+	par->addParam("limit_bounding_box_sampled", false, morphNone, paramApp);
 	par->addParam("interior_mode", false, morphLinear, paramStandard);
 	par->addParam("constant_DE_threshold", false, morphLinear, paramStandard);
 	par->addParam("hybrid_fractal_enable", false, morphNone, paramStandard);
@@ -180,6 +251,53 @@ void InitParams(cParameterContainer *par)
 	par->addParam("delta_DE_method", (int)fractal::preferedDEMethod, 0, 1, morphNone, paramStandard);
 	par->addParam("use_default_bailout", true, morphNone, paramStandard);
 	par->addParam("initial_waxis", 0.0, morphAkima, paramStandard);
+	par->addParam("tile_scheduler_enabled", false, morphNone, paramStandard);
+	par->addParam("tile_size", 64, 8, 1024, morphNone, paramStandard);
+	// 0 - rows, 1 - Hilbert curve, 2 - centre (or area under mouse) first
+	par->addParam("tile_order", 0, morphNone, paramStandard);
+	par->addParam("packet_ray_marching", false, morphNone, paramStandard);
+	par->addParam("wavefront_shadows", false, morphNone, paramStandard);
+	// float numbers are used automatically only when details are big enough (and double-double
+	// numbers only for deep zooms)
+	par->addParam("single_precision", true, morphNone, paramStandard);
+	par->addParam("double_double_precision", true, morphNone, paramStandard);
+	par->addParam("fast_math_formulas", false, morphNone, paramStandard);
+	par->addParam("raymarching_relaxation", 1.0, 1.0, 2.0, morphLinear, paramStandard);
+	par->addParam("depth_prepass_enabled", false, morphNone, paramStandard);
+	par->addParam("depth_prepass_block_size", 8, 2, 64, morphNone, paramStandard);
+	par->addParam("progressive_depth_reuse", false, morphNone, paramStandard);
+	par->addParam("temporal_depth_reprojection", false, morphNone, paramStandard);
+	par->addParam("interactive_reprojection", false, morphNone, paramApp);
+	par->addParam("frame_time_control", false, morphNone, paramApp);
+	par->addParam("frame_time_target_fps", 15, 1, 120, morphNone, paramApp);
+	par->addParam("render_region_auto", false, morphNone, paramApp);
+	par->addParam("relighting_mode", false, morphNone, paramApp);
+	par->addParam("antialiasing_enabled", false, morphNone, paramStandard);
+	par->addParam("antialiasing_size", 3, 2, 8, morphNone, paramStandard);
+	par->addParam("antialiasing_threshold", 0.1, 0.001, 10.0, morphNone, paramStandard);
+	par->addParam("sampler_type", (int)params::samplerRandom, morphNone, paramStandard);
+	par->addParam("fused_fractal_colouring", true, morphNone, paramStandard);
+	par->addParam("tetrahedral_normals", false, morphNone, paramStandard);
+	par->addParam("aux_light_culling", false, morphNone, paramStandard);
+	par->addParam("aux_light_stochastic_samples", 0, 0, 64, morphNone, paramStandard);
+	par->addParam("shadow_cache_enabled", false, morphNone, paramStandard);
+	par->addParam("distance_cache_enabled", false, morphNone, paramStandard);
+	par->addParam("adaptive_sampling_enabled", false, morphNone, paramStandard);
+	par->addParam("adaptive_sampling_max_step", 8, 1, 64, morphNone, paramStandard);
+	par->addParam("foveation_enabled", false, morphNone, paramStandard);
+	par->addParam("file_foveation_map", QString(""), morphNone, paramStandard);
+	par->addParam("volumetric_adaptive", false, morphNone, paramStandard);
+	par->addParam("background_lut_enabled", false, morphNone, paramStandard);
+	par->addParam("iteration_lod_factor", 0.0, 0.0, 100.0, morphLinear, paramStandard);
+	par->addParam("hit_refinement_mode", (int)params::refinementBisection, morphNone, paramStandard);
+	par->addParam(
+		"netrender_line_format", (int)params::netRenderLineCompact, morphNone, paramStandard);
+	par->addParam("netrender_line_compression", true, morphNone, paramStandard);
+	par->addParam("netrender_frame_distribution", false, morphNone, paramStandard);
+	par->addParam("netrender_job_pipelining", true, morphNone, paramStandard);
+	par->addParam("netrender_post_tiles", false, morphNone, paramStandard);
+	par->addParam("netrender_post_tile_halo", 64, 0, 1024, morphNone, paramStandard);
+	par->addParam("netrender_client_timeout", 10, 0, 3600, morphNone, paramStandard);
 
 	// stereoscopic
 	par->addParam("stereo_enabled", false, morphLinear, paramStandard);
@@ -187,6 +305,7 @@ void InitParams(cParameterContainer *par)
 	par->addParam("stereo_mode", (int)cStereo::stereoLeftRight, morphLinear, paramStandard);
 	par->addParam("stereo_swap_eyes", false, morphLinear, paramStandard);
 	par->addParam("stereo_infinite_correction", 0.0, 0.0, 10.0, morphAkima, paramStandard);
+	par->addParam("stereo_single_pass", false, morphNone, paramStandard);
 	par->addParam("stereo_actual_eye", (int)cStereo::eyeNone, morphAkima, paramOnlyForNet);
 
 	// volume slicing
@@ -201,10 +320,16 @@ void InitParams(cParameterContainer *par)
 		QDir::toNativeSeparators(systemData.GetSlicesFolder() + QDir::separator()), morphNone,
 		paramStandard);
 	par->addParam("voxel_show_information", true, morphLinear, paramApp);
+	par->addParam("voxel_output_format", 0, 0, 1, morphNone, paramStandard);
+	par->addParam("voxel_store_distances", false, morphNone, paramStandard);
+	par->addParam("voxel_netrender", true, morphNone, paramApp);
 
 	// mesh export
 	par->addParam("mesh_output_filename",
 		systemData.GetSlicesFolder() + QDir::separator() + "output.ply", morphNone, paramStandard);
+	par->addParam("mesh_output_format", 0, 0, 3, morphNone, paramStandard);
+	par->addParam("mesh_adaptive", false, morphNone, paramStandard);
+	par->addParam("mesh_adaptive_tolerance", 0.1, 0.0, 10.0, morphNone, paramStandard);
 
 	// foldings
 	par->addParam("box_folding", false, morphLinear, paramStandard);
@@ -224,9 +349,11 @@ void InitParams(cParameterContainer *par)
 	par->addParam("ambient_occlusion_quality", 4, 1, 10, morphLinear, paramStandard);
 	par->addParam("ambient_occlusion_fast_tune", 1.0, 1e-5, 1e5, morphLinear, paramStandard);
 	par->addParam("ambient_occlusion_enabled", false, morphLinear, paramStandard);
+	par->addParam("ambient_occlusion_resolution_divider", 1, 1, 4, morphNone, paramStandard);
 	par->addParam(
 		"ambient_occlusion_mode", (int)params::AOmodeScreenSpace, morphLinear, paramStandard);
 	par->addParam("SSAO_random_mode", false, morphLinear, paramStandard);
+	par->addParam("SSAO_hierarchical", false, morphNone, paramStandard);
 	par->addParam("glow_enabled", true, morphLinear, paramStandard);
 	par->addParam("glow_intensity", 0.2, 0.0, 1e15, morphLinear, paramStandard);
 	par->addParam("textured_background", false, morphLinear, paramStandard);
@@ -271,10 +398,17 @@ void InitParams(cParameterContainer *par)
 	par->addParam("DOF_focus", 6.0, 0.0, 200.0, morphLinear, paramStandard);
 	par->addParam("DOF_radius", 10.0, 0.0, 200.0, morphLinear, paramStandard);
 	par->addParam("DOF_HDR", false, morphLinear, paramStandard);
+	par->addParam("DOF_fast_gather", false, morphNone, paramStandard);
 	par->addParam("DOF_number_of_passes", 1, 1, 10, morphLinear, paramStandard);
 	par->addParam("DOF_blur_opacity", 4.0, 0.01, 10.0, morphLinear, paramStandard);
 	par->addParam("DOF_monte_carlo", false, morphLinear, paramStandard);
 	par->addParam("DOF_samples", 100, morphLinear, paramStandard);
+	par->addParam("DOF_max_noise", 0.0, 0.0, 1.0, morphLinear, paramStandard);
+	par->addParam("DOF_min_samples", 8, 1, 10000, morphLinear, paramStandard);
+	par->addParam("DOF_adaptive_redistribution", false, morphLinear, paramStandard);
+	par->addParam("denoiser_enabled", false, morphNone, paramStandard);
+	par->addParam("denoiser_strength", 1.0, 0.01, 10.0, morphLinear, paramStandard);
+	par->addParam("denoiser_iterations", 4, 1, 6, morphNone, paramStandard);
 
 	// main light
 	par->addParam("main_light_intensity", 1.0, 0.0, 1e15, morphLinear, paramStandard);
@@ -401,6 +535,10 @@ void InitParams(cParameterContainer *par)
 	par->addParam("netrender_client_remote_address", QString("localhost"), morphNone, paramApp);
 	par->addParam("netrender_client_remote_port", 5555, morphNone, paramApp);
 	par->addParam("netrender_server_local_port", 5555, morphNone, paramApp);
+	par->addParam("netrender_multicast", false, morphNone, paramApp);
+	par->addParam("netrender_multicast_group", QString("239.255.43.21"), morphNone, paramApp);
+	par->addParam("netrender_multicast_port", 5556, 1, 65535, morphNone, paramApp);
+	par->addParam("netrender_multicast_rate", 40, 1, 1000, morphNone, paramApp);
 
 	par->addParam("default_image_path", systemData.GetImagesFolder(), morphNone, paramApp);
 	par->addParam("default_textures_path", systemData.sharedDir + "textures", morphNone, paramApp);
@@ -408,6 +546,7 @@ void InitParams(cParameterContainer *par)
 
 	par->addParam("show_queue_thumbnails", false, morphNone, paramApp);
 	par->addParam("queue_image_format", 0, morphNone, paramApp);
+	par->addParam("queue_concurrent_jobs", 1, 1, 64, morphNone, paramApp);
 
 	par->addParam("quit_do_not_ask_again", false, morphNone, paramApp);
 	par->addParam("upgrade_do_not_ask_again", false, morphNone, paramApp);
@@ -432,12 +571,25 @@ void InitParams(cParameterContainer *par)
 	par->addParam("ui_font_size", 9, 5, 50, morphNone, paramApp);
 	par->addParam("toolbar_icon_size", 40, 20, 100, morphNone, paramApp);
 	par->addParam("limit_CPU_cores", get_cpu_count(), 1, get_cpu_count(), morphNone, paramApp);
+	par->addParam("image_lean_memory", false, morphNone, paramApp);
+	par->addParam("image_half_float", false, morphNone, paramApp);
+	par->addParam("image_memory_mapped", false, morphNone, paramApp);
+	par->addParam("image_scratch_folder", QDir::toNativeSeparators(QDir::tempPath()), morphNone,
+		paramApp);
+	par->addParam("memory_admission_control", true, morphNone, paramApp);
+	par->addParam("memory_budget_MB", 0, 0, 16777216, morphNone, paramApp);
+	par->addParam("anim_save_queue_depth", 2, 0, 16, morphNone, paramApp);
+	par->addParam("anim_deferred_post_processing", false, morphNone, paramApp);
+	par->addParam("anim_concurrent_frames", 1, 1, 64, morphNone, paramApp);
 
 	// image file configuration
 	par->addParam("color_enabled", true, morphNone, paramApp);
 	par->addParam("alpha_enabled", false, morphNone, paramApp);
 	par->addParam("zbuffer_enabled", false, morphNone, paramApp);
 	par->addParam("normal_enabled", false, morphNone, paramApp);
+	par->addParam("world_position_enabled", false, morphNone, paramApp);
+	par->addParam("object_id_enabled", false, morphNone, paramApp);
+	par->addParam("cost_enabled", false, morphNone, paramApp);
 
 	par->addParam("color_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_8, morphNone, paramApp);
 	par->addParam("alpha_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_8, morphNone, paramApp);
@@ -445,17 +597,41 @@ void InitParams(cParameterContainer *par)
 		"zbuffer_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_32, morphNone, paramApp);
 	par->addParam(
 		"normal_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_32, morphNone, paramApp);
+	par->addParam(
+		"world_position_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_32, morphNone, paramApp);
+	par->addParam(
+		"object_id_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_32, morphNone, paramApp);
+	par->addParam("cost_quality", (int)ImageFileSave::IMAGE_CHANNEL_QUALITY_32, morphNone, paramApp);
 
 	par->addParam("color_postfix", QString(""), morphNone, paramApp);
 	par->addParam("alpha_postfix", QString("_alpha"), morphNone, paramApp);
 	par->addParam("zbuffer_postfix", QString("_zbuffer"), morphNone, paramApp);
 	par->addParam("normal_postfix", QString("_normal"), morphNone, paramApp);
+	par->addParam("world_position_postfix", QString("_position"), morphNone, paramApp);
+	par->addParam("object_id_postfix", QString("_id"), morphNone, paramApp);
+	par->addParam("cost_postfix", QString("_cost"), morphNone, paramApp);
+	par->addParam("cost_overlay", false, morphNone, paramApp);
 
 	par->addParam("append_alpha_png", true, morphNone, paramApp);
 	par->addParam("jpeg_quality", 95, 1, 100, morphNone, paramApp);
 
 	par->addParam("logging_verbosity", 1, 0, 3, morphNone, paramApp);
 	par->addParam("threads_priority", 2, 0, 3, morphNone, paramApp);
+	par->addParam("threads_affinity", false, morphNone, paramApp);
+	par->addParam("threads_auto_tune", false, morphNone, paramApp);
+	// "formula/DE type=choice" pairs measured by auto-tuning of threads
+	par->addParam("threads_tuning_choices", QString(""), morphNone, paramApp);
+	// interval of saving of checkpoints of still images rendered in CLI mode [s], 0 - disabled
+	par->addParam("checkpoint_interval", 300, 0, 86400, morphNone, paramApp);
+	// reports of used resources are saved next to images rendered in CLI mode and by the queue
+	par->addParam("resource_reports", false, morphNone, paramApp);
+
+	// rendering of simple scenes by OpenCL device
+	par->addParam("opencl_rendering_enabled", false, morphNone, paramApp);
+	par->addParam("opencl_rendering_platform", 0, 0, 15, morphNone, paramApp);
+	par->addParam("opencl_rendering_device", 0, 0, 15, morphNone, paramApp);
+	// distances cached between render jobs are stored on disk
+	par->addParam("distance_cache_persistent", false, morphNone, paramApp);
 
 #ifdef CLSUPPORT
 	par->addParam("openCL_use_CPU", false, true);
@@ -482,8 +658,8 @@ void InitParams(cParameterContainer *par)
 	WriteLog("Parameters initialization finished", 3);
 }
 
-// definition of all parameters
-void InitFractalParams(cParameterContainer *par)
+// definition of all fractal parameters
+static void DefineFractalParams(cParameterContainer *par)
 {
 	WriteLog("Fractal parameters initialization started: " + par->GetContainerName(), 3);
 
@@ -940,6 +1116,7 @@ void InitPrimitiveParams(
 			par->addParam(QString(primitiveName) + "_anim_speed", 1.0, morphAkima, paramStandard);
 			par->addParam(QString(primitiveName) + "_iterations", 5, morphAkima, paramStandard);
 			par->addParam(QString(primitiveName) + "_empty", false, morphAkima, paramStandard);
+			par->addParam(QString(primitiveName) + "_baked", false, morphNone, paramStandard);
 			break;
 		case fractal::objTorus:
 			par->addParam(QString(primitiveName) + "_radius", 1.0, morphAkima, paramStandard);
@@ -1116,6 +1293,7 @@ void DeletePrimitiveParams(
 			par->DeleteParameter(QString(primitiveName) + "_anim_speed");
 			par->DeleteParameter(QString(primitiveName) + "_iterations");
 			par->DeleteParameter(QString(primitiveName) + "_empty");
+			par->DeleteParameter(QString(primitiveName) + "_baked");
 			break;
 
 		default: break;
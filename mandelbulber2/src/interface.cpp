@@ -46,20 +46,28 @@
 #include "animation_flight.hpp"
 #include "animation_keyframes.hpp"
 #include "ao_modes.h"
+#include "autosave.hpp"
 #include "calculate_distance.hpp"
 #include "camera_target.hpp"
 #include "common_math.h"
+#include "de_factor_optimizer.hpp"
+#include "dirty_region.hpp"
+#include "distance_query.hpp"
 #include "dof.hpp"
 #include "error_message.hpp"
 #include "fractparams.hpp"
+#include "frame_time_controller.hpp"
 #include "global_data.hpp"
 #include "headless.h"
 #include "initparameters.hpp"
 #include "my_ui_loader.h"
 #include "queue.hpp"
 #include "render_job.hpp"
+#include "render_worker_pool.hpp"
 #include "render_ssao.h"
 #include "settings.hpp"
+#include "temporal_depth.hpp"
+#include "tile_scheduler.hpp"
 #include "undo.h"
 #include "nine_fractals.hpp"
 #include "render_data.hpp"
@@ -92,11 +100,21 @@ cInterface::cInterface()
 	materialEditor = NULL;
 	scrollAreaMaterialEditor = NULL;
 	systemTray = NULL;
+	interactiveDepth = new cTemporalDepth;
+	frameTimeController = new cFrameTimeController;
+	refineTimer = NULL;
+	workerPool = NULL;
+	lastRenderedPar = NULL;
+	lastRenderedFractal = NULL;
+	lastRenderComplete = false;
+	renderRegionRequest = false;
 	stopRequest = false;
 	repeatRequest = false;
 	interfaceReady = false;
 	autoRefreshLastState = false;
 	lockedDetailLevel = 1.0;
+	reducedQualityShown = false;
+	refineRequest = false;
 }
 
 cInterface::~cInterface()
@@ -111,6 +129,11 @@ cInterface::~cInterface()
 	if (progressBarLayout) delete progressBarLayout;
 	if (qimage) delete qimage;
 	if (mainImage) delete mainImage;
+	delete interactiveDepth;
+	delete frameTimeController;
+	if (workerPool) delete workerPool;
+	if (lastRenderedPar) delete lastRenderedPar;
+	if (lastRenderedFractal) delete lastRenderedFractal;
 	if (headless) delete headless;
 	if (mainWindow) delete mainWindow;
 }
@@ -241,6 +264,8 @@ void cInterface::ShowUi(void)
 
 	ComboMouseClickUpdate();
 
+	// toolbar presets are installed only when the user interface needs them
+	RetrieveToolbarPresets(false);
 	mainWindow->slotPopulateToolbar();
 
 	systemTray = new cSystemTray(mainImage, mainWindow);
@@ -343,6 +368,8 @@ void cInterface::ConnectSignals(void)
 		renderedImage, SIGNAL(mouseMoved(int, int)), mainWindow, SLOT(slotMouseMovedOnImage(int, int)));
 	QApplication::connect(renderedImage, SIGNAL(singleClick(int, int, Qt::MouseButton)), mainWindow,
 		SLOT(slotMouseClickOnImage(int, int, Qt::MouseButton)));
+	QApplication::connect(renderedImage, SIGNAL(renderRegionSelected(const QRect &)), mainWindow,
+		SLOT(slotRenderRegionSelected(const QRect &)));
 	QApplication::connect(
 		renderedImage, SIGNAL(keyPress(Qt::Key)), mainWindow, SLOT(slotKeyPressOnImage(Qt::Key)));
 	QApplication::connect(
@@ -439,9 +466,7 @@ void cInterface::StartRender(bool noUndo)
 	if (mainWindow->ui->widgetDockNavigation->AutoRefreshIsChecked())
 	{
 		// check if something was changed in settings
-		cSettings tempSettings(cSettings::formatCondensedText);
-		tempSettings.CreateText(gPar, gParFractal);
-		autoRefreshLastHash = tempSettings.GetHashCode();
+		autoRefreshLastHash = cSettings::StructuralHash(gPar, gParFractal);
 	}
 
 	if (!noUndo) gUndo.Store(gPar, gParFractal);
@@ -451,17 +476,92 @@ void cInterface::StartRender(bool noUndo)
 	cRenderJob *renderJob = new cRenderJob(
 		gPar, gParFractal, mainImage, &stopRequest, renderedImage); // deleted by deleteLater()
 
+	// restart after change of parameters doesn't wait for creation of new threads
+	if (!workerPool) workerPool = new cRenderWorkerPool;
+	renderJob->UseWorkerPool(workerPool);
+
+	// only the part of the image which was changed is rendered again
+	cRegion<int> dirtyRegion;
+	bool useDirtyRegion = false;
+	// geometry from G-buffer of last image (reduced quality images are not good enough)
+	bool relight = gPar->Get<bool>("relighting_mode") && lastRenderComplete && lastRenderedPar
+								 && !reducedQualityShown && !renderRegionRequest
+								 && cDirtyRegion::OnlyShadingChanged(
+									 lastRenderedPar, lastRenderedFractal, gPar, gParFractal);
+	if (relight)
+	{
+		WriteLog("cInterface::StartRender(): relighting image", 2);
+		renderJob->SetRelighting();
+	}
+	else if (renderRegionRequest)
+	{
+		dirtyRegion = requestedRenderRegion;
+		useDirtyRegion = true;
+		renderRegionRequest = false;
+	}
+	else if (gPar->Get<bool>("render_region_auto") && lastRenderComplete && lastRenderedPar)
+	{
+		useDirtyRegion = cDirtyRegion::Estimate(lastRenderedPar, lastRenderedFractal, gPar,
+			gParFractal, mainImage->GetWidth(), mainImage->GetHeight(), &dirtyRegion);
+	}
+	if (useDirtyRegion && dirtyRegion.width > 0 && dirtyRegion.height > 0)
+	{
+		WriteLog(QString("cInterface::StartRender(): rendering region %1 %2 %3 %4")
+							 .arg(dirtyRegion.x1)
+							 .arg(dirtyRegion.y1)
+							 .arg(dirtyRegion.x2)
+							 .arg(dirtyRegion.y2),
+			2);
+		renderJob->SetDirtyRegion(dirtyRegion);
+	}
+
+	if (!lastRenderedPar) lastRenderedPar = new cParameterContainer;
+	if (!lastRenderedFractal) lastRenderedFractal = new cFractalContainer;
+	*lastRenderedPar = *gPar;
+	*lastRenderedFractal = *gParFractal;
+	lastRenderComplete = false;
+
+	// previous image is reprojected to the new camera, so navigation gets instant feedback
+	if (gPar->Get<bool>("interactive_reprojection"))
+		renderJob->SetInteractiveReprojection(interactiveDepth);
+	else
+		interactiveDepth->Clear();
+
+	// renders started shortly one after another are camera movements. They are rendered with
+	// reduced quality to keep the frame rate and refined when the camera stops
+	bool navigating = navigationTimer.isValid()
+										&& navigationTimer.elapsed() < FRAME_TIME_NAVIGATION_INTERVAL;
+	navigationTimer.restart();
+	reducedQualityShown = false;
+	if (gPar->Get<bool>("frame_time_control") && navigating && !refineRequest && refineTimer)
+	{
+		frameTimeController->SetTargetFrameTime(1.0 / gPar->Get<int>("frame_time_target_fps"));
+		renderJob->SetFrameTimeController(frameTimeController);
+		reducedQualityShown = true;
+		refineTimer->start(FRAME_TIME_NAVIGATION_INTERVAL);
+	}
+
 	QObject::connect(renderJob,
 		SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), mainWindow,
 		SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
 	QObject::connect(renderJob, SIGNAL(updateStatistics(cStatistics)),
 		mainWindow->ui->widgetDockStatistics, SLOT(slotUpdateStatistics(cStatistics)));
+	QObject::connect(renderJob, SIGNAL(fullyRendered(const QString &, const QString &)), mainWindow,
+		SLOT(slotMainImageRendered()));
 	QObject::connect(renderJob, SIGNAL(fullyRendered(const QString &, const QString &)), systemTray,
 		SLOT(showMessage(const QString &, const QString &)));
 
 	cRenderingConfiguration config;
 	config.EnableNetRender();
 
+	// part of the image under the mouse cursor is refined first
+	if (gPar->Get<int>("tile_order") == cTileScheduler::tileOrderFocusFirst && renderedImage
+			&& renderedImage->underMouse())
+	{
+		CVector2<double> mousePoint = renderedImage->GetLastMousePositionScaled();
+		config.SetFocusPoint(int(mousePoint.x), int(mousePoint.y));
+	}
+
 	if (!renderJob->Init(cRenderJob::still, config))
 	{
 		mainImage->ReleaseImage();
@@ -472,8 +572,8 @@ void cInterface::StartRender(bool noUndo)
 	}
 
 	// show distance in statistics table
-	double distance = GetDistanceForPoint(gPar->Get<CVector3>("camera"), gPar, gParFractal);
-	mainWindow->ui->widgetDockStatistics->UpdateDistanceToFractal(distance);
+	mainWindow->ui->widgetDockStatistics->RequestDistanceToFractal(
+		gPar->Get<CVector3>("camera"), gPar, gParFractal);
 
 	QThread *thread = new QThread; // deleted by deleteLater()
 	renderJob->moveToThread(thread);
@@ -892,10 +992,15 @@ void cInterface::RefreshMainImage()
 			gMainInterface->mainWindow,
 			SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
 		cRegion<int> screenRegion(0, 0, mainImage->GetWidth(), mainImage->GetHeight());
-		dof.Render(screenRegion,
-			params.DOFRadius * (mainImage->GetWidth() + mainImage->GetPreviewHeight()) / 2000.0,
-			params.DOFFocus, !ssaoUsed && gPar->Get<bool>("DOF_HDR"), params.DOFNumberOfPasses,
-			params.DOFBlurOpacity, &stopRequest);
+		double dofRadius =
+			params.DOFRadius * (mainImage->GetWidth() + mainImage->GetPreviewHeight()) / 2000.0;
+		if (params.DOFFastGather)
+			dof.RenderGather(screenRegion, dofRadius, params.DOFFocus,
+				!ssaoUsed && gPar->Get<bool>("DOF_HDR"), &stopRequest);
+		else
+			dof.Render(screenRegion, dofRadius, params.DOFFocus,
+				!ssaoUsed && gPar->Get<bool>("DOF_HDR"), params.DOFNumberOfPasses, params.DOFBlurOpacity,
+				&stopRequest);
 	}
 
 	mainImage->ConvertTo8bit();
@@ -903,6 +1008,29 @@ void cInterface::RefreshMainImage()
 	mainImage->GetImageWidget()->update();
 }
 
+void cInterface::PreviewImageAdjustments(const sImageAdjustments &imageAdjustments)
+{
+	if (!mainImage || mainImage->IsUsed() || !mainImage->IsPreview()) return;
+
+	// screen space effects are calculated on compiled image and would be lost in the preview
+	if (gPar->Get<bool>("ambient_occlusion_enabled")
+			&& gPar->Get<int>("ambient_occlusion_mode") == params::AOmodeScreenSpace)
+		return;
+	if (gPar->Get<bool>("DOF_enabled")) return;
+
+	mainImage->PreviewImageAdjustments(imageAdjustments);
+	mainImage->GetImageWidget()->update();
+}
+
+void cInterface::CompilePreviewedImageAdjustments()
+{
+	if (mainImage->IsAdjustmentsPreviewOnly())
+	{
+		mainImage->CompileImage();
+		mainImage->ConvertTo8bit();
+	}
+}
+
 void cInterface::AutoFog()
 {
 	SynchronizeInterface(gPar, gParFractal, qInterface::read);
@@ -921,14 +1049,8 @@ void cInterface::AutoFog()
 double cInterface::GetDistanceForPoint(
 	CVector3 point, cParameterContainer *par, cFractalContainer *parFractal)
 {
-	cParamRender *params = new cParamRender(par);
-	cNineFractals *fractals = new cNineFractals(parFractal, par);
-	sDistanceIn in(point, 0, false);
-	sDistanceOut out;
-	double distance = CalculateDistance(*params, *fractals, in, &out);
-	delete params;
-	delete fractals;
-	return distance;
+	// prepared parameters and distances are reused between queries
+	return gDistanceQuery->GetDistance(point, par, parFractal);
 }
 
 double cInterface::GetDistanceForPoint(CVector3 point)
@@ -1282,72 +1404,61 @@ void cInterface::SetBoundingBoxAsLimits()
 	cParamRender *params = new cParamRender(&parTemp);
 	cNineFractals *fractals = new cNineFractals(gParFractal, &parTemp);
 
-	CVector3 direction;
-	CVector3 orthDirection;
-	CVector3 point;
-	double dist;
 	double outerBounding = gPar->Get<double>("limit_outer_bounding");
 	stopRequest = false;
 
-	// negative x limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Negative X Limit"), 0.0 / 6.0);
-	direction = CVector3(1, 0, 0);
-	orthDirection = CVector3(0, 1, 0);
-	point = CVector3(-outerBounding, 0, 0);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double minX = point.x + dist;
-
-	// negative y limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Negative Y Limit"), 1.0 / 6.0);
-	direction = CVector3(0, 1, 0);
-	orthDirection = CVector3(0, 0, 1);
-	point = CVector3(0, -outerBounding, 0);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double minY = point.y + dist;
-
-	// negative z limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Negative Z Limit"), 2.0 / 6.0);
-	direction = CVector3(0, 0, 1);
-	orthDirection = CVector3(1, 0, 0);
-	point = CVector3(0, 0, -outerBounding);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double minZ = point.z + dist;
-
-	// positive x limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Positive X Limit"), 3.0 / 6.0);
-	direction = CVector3(-1, 0, 0);
-	orthDirection = CVector3(0, -1, 0);
-	point = CVector3(outerBounding, 0, 0);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double maxX = point.x - dist;
-
-	// positive y limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Positive Y Limit"), 4.0 / 6.0);
-	direction = CVector3(0, -1, 0);
-	orthDirection = CVector3(0, 0, -1);
-	point = CVector3(0, outerBounding, 0);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double maxY = point.y - dist;
-
-	// positive z limit
-	cProgressText::ProgressStatusText(
-		QObject::tr("bounding box as limit"), QObject::tr("Positive Z Limit"), 5.0 / 6.0);
-	direction = CVector3(0, 0, -1);
-	orthDirection = CVector3(-1, 0, 0);
-	point = CVector3(0, 0, outerBounding);
-	dist =
-		CalculateDistanceMinPlane(*params, *fractals, point, direction, orthDirection, &stopRequest);
-	double maxZ = point.z - dist;
+	double minX, minY, minZ, maxX, maxY, maxZ;
+	if (gPar->Get<bool>("limit_bounding_box_sampled"))
+	{
+		// whole volume is sampled, so also parts hidden behind other parts are found
+		cProgressText::ProgressStatusText(
+			QObject::tr("bounding box as limit"), QObject::tr("Sampling volume"), 0.0);
+		CVector3 boxMin, boxMax;
+		if (!CalculateBoundingBoxSampled(*params, *fractals, outerBounding, BOUNDING_BOX_SAMPLES,
+					&boxMin, &boxMax, &stopRequest))
+		{
+			cProgressText::ProgressStatusText(
+				QObject::tr("bounding box as limit"), QObject::tr("Fractal not found"), 1.0);
+			delete params;
+			delete fractals;
+			return;
+		}
+		minX = boxMin.x;
+		minY = boxMin.y;
+		minZ = boxMin.z;
+		maxX = boxMax.x;
+		maxY = boxMax.y;
+		maxZ = boxMax.z;
+	}
+	else
+	{
+		// limits in order: -x, -y, -z, +x, +y, +z
+		const CVector3 directions[6] = {CVector3(1, 0, 0), CVector3(0, 1, 0), CVector3(0, 0, 1),
+			CVector3(-1, 0, 0), CVector3(0, -1, 0), CVector3(0, 0, -1)};
+		const CVector3 orthDirections[6] = {CVector3(0, 1, 0), CVector3(0, 0, 1), CVector3(1, 0, 0),
+			CVector3(0, -1, 0), CVector3(0, 0, -1), CVector3(-1, 0, 0)};
+		double limits[6];
+
+		cProgressText::ProgressStatusText(
+			QObject::tr("bounding box as limit"), QObject::tr("Searching limits"), 0.0);
+
+		// planes are independent, so they are searched in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = 0; i < 6; i++)
+		{
+			CVector3 direction = directions[i];
+			CVector3 point = direction * -outerBounding;
+			double dist = CalculateDistanceMinPlane(
+				*params, *fractals, point, direction, orthDirections[i], &stopRequest);
+			limits[i] = (point + direction * dist).Dot(direction.Abs());
+		}
+		minX = limits[0];
+		minY = limits[1];
+		minZ = limits[2];
+		maxX = limits[3];
+		maxY = limits[4];
+		maxZ = limits[5];
+	}
 
 	double medX = (maxX + minX) / 2.0;
 	double medY = (maxY + minY) / 2.0;
@@ -1443,6 +1554,7 @@ void cInterface::NewPrimitive(const QString &primitiveType, int index)
 		// put widget into layout
 		QVBoxLayout *primitivesLayout = mainWindow->ui->widgetDockFractal->GetLayoutWithPrimitives();
 		primitivesLayout->addWidget(mainWidget);
+		cInterfaceBindings::Instance()->Invalidate(mainWidget);
 
 		// rename widgets
 		QList<QWidget *> listOfWidgets = primitiveWidget->findChildren<QWidget *>();
@@ -1603,6 +1715,10 @@ void cInterface::ComboMouseClickUpdate()
 	item.append((int)RenderedImage::clickGetPoint);
 	combo->addItem(QObject::tr("Get point coordinates"), item);
 
+	item.clear();
+	item.append((int)RenderedImage::clickRenderRegion);
+	combo->addItem(QObject::tr("Render selected region"), item);
+
 	if (listOfPrimitives.size() > 0)
 	{
 		for (int i = 0; i < listOfPrimitives.size(); i++)
@@ -1680,7 +1796,7 @@ bool cInterface::QuitApplicationDialog()
 				gApplication->processEvents();
 			}
 
-			QFile::remove(systemData.GetAutosaveFile());
+			gAutosave->Remove();
 
 			gApplication->quit();
 			quit = true;
@@ -1693,7 +1809,7 @@ bool cInterface::QuitApplicationDialog()
 
 void cInterface::AutoRecovery()
 {
-	if (QFile::exists(systemData.GetAutosaveFile()))
+	if (gAutosave->Exists())
 	{
 		// autorecovery dialog
 		QMessageBox::StandardButton reply;
@@ -1705,9 +1821,7 @@ void cInterface::AutoRecovery()
 
 		if (reply == QMessageBox::Yes)
 		{
-			cSettings parSettings(cSettings::formatFullText);
-			parSettings.LoadFromFile(systemData.GetAutosaveFile());
-			parSettings.Decode(gPar, gParFractal, gAnimFrames, gKeyframes);
+			gAutosave->Load(gPar, gParFractal, gAnimFrames, gKeyframes);
 			gMainInterface->RebuildPrimitives(gPar);
 			gMainInterface->materialListModel->Regenerate();
 			gMainInterface->SynchronizeInterface(gPar, gParFractal, qInterface::write);
@@ -1775,115 +1889,25 @@ bool cInterface::DataFolderUpgrade()
 
 void cInterface::OptimizeStepFactor(double qualityTarget)
 {
-	DisablePeriodicRefresh();
-
-	// check if main image is not used by other rendering process
-	if (mainImage->IsUsed())
-	{
-		cErrorMessage::showMessage(
-			QObject::tr("Rendering engine is busy. Stop unfinished rendering before starting new one"),
-			cErrorMessage::errorMessage);
-		return;
-	}
-
 	SynchronizeInterface(gPar, gParFractal, qInterface::read);
 	gUndo.Store(gPar, gParFractal);
 
-	cParameterContainer tempParam = *gPar;
-	cFractalContainer tempFractal = *gParFractal;
-
-	// disabling all slow effects
-	tempParam.Set("shadows_enabled", false);
-	tempParam.Set("ambient_occlusion", false);
-	tempParam.Set("DOF_enabled", false);
-	tempParam.Set("iteration_threshold_mode", false);
-	tempParam.Set("raytraced_reflections", false);
-	tempParam.Set("textured_background", false);
-	tempParam.Set("iteration_fog_enable", false);
-	tempParam.Set("fake_lights_enabled", false);
-	tempParam.Set("main_light_volumetric_enabled", false);
-	for (int i = 1; i <= 4; i++)
-	{
-		tempParam.Set("aux_light_enabled", i, false);
-		tempParam.Set("aux_light_volumetric_enabled", i, false);
-	}
-
-	int maxDimension = max(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
-	int newWidth = (double)gPar->Get<int>("image_width") / maxDimension * 256.0;
-	int newHeight = (double)gPar->Get<int>("image_height") / maxDimension * 256.0;
-
-	tempParam.Set("image_width", newWidth);
-	tempParam.Set("image_height", newHeight);
-	tempParam.Set("detail_level", 4.0);
-
-	int scanCount = 0;
-	double DEfactor = 1.0;
-	double step = 1.0;
-
-	cRenderJob *renderJob =
-		new cRenderJob(&tempParam, &tempFractal, mainImage, &stopRequest, renderedImage);
-	QObject::connect(renderJob, SIGNAL(updateStatistics(cStatistics)),
-		mainWindow->ui->widgetDockStatistics, SLOT(slotUpdateStatistics(cStatistics)));
-
-	cRenderingConfiguration config;
-	config.DisableRefresh();
-	config.DisableProgressiveRender();
-	config.DisableNetRender();
-	config.SetMaxRenderTime(5.0);
-
-	renderJob->Init(cRenderJob::still, config);
-
 	cProgressText::ProgressStatusText(QObject::tr("Looking for optimal DE factor"),
-		QString("Percentage of wrong distance estimations: ") + QString::number(0.0), 0.0,
-		cProgressText::progress_IMAGE);
+		QObject::tr("Marching of reference rays"), 0.0, cProgressText::progress_IMAGE);
+	gApplication->processEvents();
 
 	stopRequest = false;
 
+	// sparse rays are marched instead of rendering of images
+	cDEFactorOptimizer optimizer(gPar, gParFractal);
 	double missedDE = 0.0;
-
-	for (int i = 0; i < 100; i++)
+	double DEfactor = optimizer.Optimize(qualityTarget, &stopRequest, &missedDE);
+	if (DEfactor < 0.0)
 	{
-		if (stopRequest) return;
-		scanCount++;
-		tempParam.Set("DE_factor", DEfactor);
-
-		gPar->Set("DE_factor", DEfactor);
-		SynchronizeInterface(gPar, gParFractal, qInterface::write);
-
-		renderJob->UpdateParameters(&tempParam, &tempFractal);
-		renderJob->Execute();
-		missedDE = renderJob->GetStatistics().GetMissedDEPercentage();
-
-		if (missedDE < qualityTarget)
-		{
-			if (scanCount == 1)
-			{
-				if (step < 10000)
-				{
-					DEfactor = DEfactor * 2.0;
-					step = step * 2.0;
-					scanCount = 0;
-					continue;
-				}
-				else
-				{
-					return;
-				}
-			}
-			else
-			{
-				if (step < 0.05 * DEfactor) break;
-				DEfactor += step;
-			}
-		}
-
-		double progress = 1.0 - 1.0 / (1.0 + pow(qualityTarget / (missedDE - qualityTarget), 2.0));
-		cProgressText::ProgressStatusText(QObject::tr("Looking for optimal DE factor"),
-			QObject::tr("Percentage of wrong distance estimations: %1").arg(missedDE), progress,
+		cProgressText::ProgressStatusText(QObject::tr("Idle"),
+			QObject::tr("Looking for optimal DE factor was stopped"), 1.0,
 			cProgressText::progress_IMAGE);
-
-		step /= 2.0;
-		DEfactor -= step;
+		return;
 	}
 
 	gPar->Set("DE_factor", DEfactor);
@@ -1893,10 +1917,6 @@ void cInterface::OptimizeStepFactor(double qualityTarget)
 			.arg(DEfactor)
 			.arg(missedDE),
 		1.0, cProgressText::progress_IMAGE);
-
-	ReEnablePeriodicRefresh();
-
-	delete renderJob;
 }
 
 void cInterface::ResetFormula(int fractalNumber)
@@ -1915,9 +1935,7 @@ void cInterface::PeriodicRefresh()
 	{
 		// check if something was changed in settings
 		SynchronizeInterface(gPar, gParFractal, qInterface::read);
-		cSettings tempSettings(cSettings::formatCondensedText);
-		tempSettings.CreateText(gPar, gParFractal);
-		QString newHash = tempSettings.GetHashCode();
+		QString newHash = cSettings::StructuralHash(gPar, gParFractal);
 
 		if (newHash != autoRefreshLastHash)
 		{
@@ -1941,9 +1959,7 @@ void cInterface::DisablePeriodicRefresh()
 void cInterface::ReEnablePeriodicRefresh()
 {
 	SynchronizeInterface(gPar, gParFractal, qInterface::read);
-	cSettings tempSettings(cSettings::formatCondensedText);
-	tempSettings.CreateText(gPar, gParFractal);
-	autoRefreshLastHash = tempSettings.GetHashCode();
+	autoRefreshLastHash = cSettings::StructuralHash(gPar, gParFractal);
 	if (autoRefreshLastState)
 	{
 		mainWindow->ui->widgetDockNavigation->AutoRefreshSetChecked(true);
@@ -1956,6 +1972,28 @@ void cInterface::InitPeriodicRefresh()
 	autoRefreshTimer->setSingleShot(true);
 	QApplication::connect(autoRefreshTimer, SIGNAL(timeout()), mainWindow, SLOT(slotAutoRefresh()));
 	autoRefreshTimer->start(2000);
+
+	refineTimer = new QTimer(mainWindow);
+	refineTimer->setSingleShot(true);
+	QApplication::connect(refineTimer, SIGNAL(timeout()), mainWindow, SLOT(slotRefineRender()));
+}
+
+void cInterface::RenderRegion(const QRect &previewRect)
+{
+	double scale = mainImage->GetPreviewScale();
+	if (scale <= 0.0) return;
+	requestedRenderRegion.Set(int(previewRect.left() / scale), int(previewRect.top() / scale),
+		int((previewRect.right() + 1) / scale) + 1, int((previewRect.bottom() + 1) / scale) + 1);
+	renderRegionRequest = true;
+	StartRender();
+}
+
+void cInterface::RefineRender()
+{
+	if (!reducedQualityShown) return;
+	refineRequest = true;
+	StartRender(true);
+	refineRequest = false;
 }
 
 void cInterface::InitMaterialsUi()
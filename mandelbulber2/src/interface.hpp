@@ -38,6 +38,8 @@
 #include "primitives.h"
 #include "synchronize_interface.hpp"
 #include "algebra.hpp"
+#include "image_adjustments.h"
+#include "region.hpp"
 
 // forward declarations
 class cParameterContainer;
@@ -51,6 +53,9 @@ class cMaterialItemModel;
 class cMaterialEditor;
 class cSystemTray;
 class cImage;
+class cTemporalDepth;
+class cFrameTimeController;
+class cRenderWorkerPool;
 
 class cInterface
 {
@@ -80,6 +85,11 @@ public:
 	void SynchronizeInterface(
 		cParameterContainer *par, cFractalContainer *parFractal, qInterface::enumReadWrite mode);
 	void StartRender(bool noUndo = false);
+	// last frame rendered with reduced quality while navigating is rendered again in full quality
+	void RefineRender();
+	// only given part of the image (in preview coordinates) is rendered again
+	void RenderRegion(const QRect &previewRect);
+	void MainImageRendered() { lastRenderComplete = true; }
 	void MoveCamera(QString buttonName);
 	void RotateCamera(QString buttonName);
 	void CameraOrTargetEdited();
@@ -91,6 +101,10 @@ public:
 	void IFSDefaultsMengerSponge(cParameterContainer *parFractal);
 	void IFSDefaultsReset(cParameterContainer *parFractal);
 	void RefreshMainImage();
+	// instant preview of brightness, contrast, gamma and HDR changes
+	void PreviewImageAdjustments(const sImageAdjustments &imageAdjustments);
+	// main image has to be compiled when adjustments were applied only to the preview
+	void CompilePreviewedImageAdjustments();
 	void AutoFog();
 	double GetDistanceForPoint(CVector3 point);
 	double GetDistanceForPoint(
@@ -133,6 +147,19 @@ public:
 	QFrame *progressBarFrame;
 	QVBoxLayout *progressBarLayout;
 	cImage *mainImage;
+	cTemporalDepth *interactiveDepth; // last frame reprojected while navigating
+	cFrameTimeController *frameTimeController;
+	cRenderWorkerPool *workerPool; // threads reused by all renders of main image
+	QElapsedTimer navigationTimer; // time since last camera move
+	QTimer *refineTimer;
+	bool reducedQualityShown; // last render was done with reduced quality
+	bool refineRequest;
+	// parameters of last render of main image, used to find part of image changed by edits
+	cParameterContainer *lastRenderedPar;
+	cFractalContainer *lastRenderedFractal;
+	bool lastRenderComplete;
+	cRegion<int> requestedRenderRegion;
+	bool renderRegionRequest;
 	QList<sPrimitiveItem> listOfPrimitives;
 	QTimer *autoRefreshTimer;
 	QString autoRefreshLastHash;
@@ -0,0 +1,138 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cJobArena class - memory of short-lived buffers of rendering job
+ */
+
+#include "job_arena.hpp"
+
+#include "system.hpp"
+
+#define JOB_ARENA_ALIGNMENT 64
+#define JOB_ARENA_MIN_CHUNK_SIZE (1024 * 1024)
+
+cJobArena::cJobArena()
+{
+	actualChunk = 0;
+	actualOffset = 0;
+}
+
+cJobArena::~cJobArena()
+{
+	FreeChunks();
+}
+
+void cJobArena::FreeChunks()
+{
+	for (int i = 0; i < chunks.size(); i++)
+		qFreeAligned(chunks[i].memory);
+	chunks.clear();
+	actualChunk = 0;
+	actualOffset = 0;
+}
+
+void *cJobArena::Allocate(qint64 size)
+{
+	size = (size + JOB_ARENA_ALIGNMENT - 1) / JOB_ARENA_ALIGNMENT * JOB_ARENA_ALIGNMENT;
+
+	// next chunks are used if they are big enough, otherwise new chunk is allocated
+	while (actualChunk < chunks.size())
+	{
+		if (actualOffset + size <= chunks[actualChunk].size)
+		{
+			void *memory = chunks[actualChunk].memory + actualOffset;
+			actualOffset += size;
+			return memory;
+		}
+		actualChunk++;
+		actualOffset = 0;
+	}
+
+	sChunk chunk;
+	chunk.size = qMax(size, qint64(JOB_ARENA_MIN_CHUNK_SIZE));
+	if (!chunks.isEmpty()) chunk.size = qMax(chunk.size, chunks.last().size * 2);
+	chunk.memory = static_cast<char *>(qMallocAligned(chunk.size, JOB_ARENA_ALIGNMENT));
+	if (!chunk.memory) throw std::bad_alloc();
+	chunks.append(chunk);
+	actualChunk = chunks.size() - 1;
+	actualOffset = size;
+	return chunk.memory;
+}
+
+cJobArena::sMark cJobArena::GetMark() const
+{
+	sMark mark;
+	mark.chunk = actualChunk;
+	mark.offset = actualOffset;
+	return mark;
+}
+
+void cJobArena::Release(const sMark &mark)
+{
+	actualChunk = mark.chunk;
+	actualOffset = mark.offset;
+}
+
+void cJobArena::Reset()
+{
+	// memory used by the frame fits in one chunk at next frame
+	if (chunks.size() > 1)
+	{
+		qint64 capacity = GetCapacity();
+		FreeChunks();
+		sChunk chunk;
+		chunk.size = capacity;
+		chunk.memory = static_cast<char *>(qMallocAligned(chunk.size, JOB_ARENA_ALIGNMENT));
+		if (chunk.memory)
+			chunks.append(chunk);
+		else
+			qCritical() << "cJobArena::Reset(): cannot allocate" << capacity << "bytes";
+		WriteLogDouble("Job arena capacity [MB]", capacity / 1048576.0, 2);
+	}
+	actualChunk = 0;
+	actualOffset = 0;
+}
+
+qint64 cJobArena::GetUsedBytes() const
+{
+	qint64 used = 0;
+	for (int i = 0; i < actualChunk && i < chunks.size(); i++)
+		used += chunks[i].size;
+	return used + actualOffset;
+}
+
+qint64 cJobArena::GetCapacity() const
+{
+	qint64 capacity = 0;
+	for (int i = 0; i < chunks.size(); i++)
+		capacity += chunks[i].size;
+	return capacity;
+}
@@ -0,0 +1,97 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cJobArena class - memory of short-lived buffers of rendering job
+ *
+ * Buffers which live only during rendering of one frame (scheduler arrays, DOF
+ * temporary images) are taken from big chunks of memory by moving a pointer.
+ * Nothing is freed separately. Reset() between frames rewinds the arena and
+ * merges chunks into one, so after the first frame of an animation the same
+ * memory is reused without heap allocations. Only the main thread allocates.
+ */
+
+#ifndef MANDELBULBER2_SRC_JOB_ARENA_HPP_
+#define MANDELBULBER2_SRC_JOB_ARENA_HPP_
+
+#include <new>
+
+#include <QList>
+#include <QtGlobal>
+
+class cJobArena
+{
+public:
+	// position in the arena. Memory allocated after the mark can be released with Release()
+	struct sMark
+	{
+		int chunk;
+		qint64 offset;
+	};
+
+	cJobArena();
+	~cJobArena();
+
+	// memory is aligned to cache line
+	void *Allocate(qint64 size);
+	// elements are value-initialised. Destructors are never called, so it can be used only for
+	// simple structures
+	template <typename T>
+	T *NewArray(qint64 count)
+	{
+		T *array = static_cast<T *>(Allocate(sizeof(T) * qMax(count, qint64(1))));
+		for (qint64 i = 0; i < count; i++)
+			new (&array[i]) T();
+		return array;
+	}
+
+	sMark GetMark() const;
+	void Release(const sMark &mark);
+	// all memory is released to the arena, but not to the system
+	void Reset();
+
+	qint64 GetUsedBytes() const;
+	qint64 GetCapacity() const;
+
+private:
+	struct sChunk
+	{
+		char *memory;
+		qint64 size;
+	};
+
+	void FreeChunks();
+
+	QList<sChunk> chunks;
+	int actualChunk;
+	qint64 actualOffset;
+};
+
+#endif /* MANDELBULBER2_SRC_JOB_ARENA_HPP_ */
@@ -39,11 +39,15 @@
 
 #include "keyframes.hpp"
 
+#include "system.hpp"
+
 cKeyframes *gKeyframes = NULL;
 
 cKeyframes::cKeyframes() : cAnimationFrames()
 {
 	framesPerKeyframe = 5;
+	morphTableRowSize = -1;
+	morphTableKeyframes = 0;
 }
 
 cKeyframes::~cKeyframes()
@@ -54,6 +58,8 @@ cKeyframes::~cKeyframes()
 
 cKeyframes::cKeyframes(const cKeyframes &source)
 {
+	morphTableRowSize = -1;
+	morphTableKeyframes = 0;
 	*this = source;
 }
 
@@ -68,43 +74,172 @@ cKeyframes &cKeyframes::operator=(const cKeyframes &source)
 			this->morph.append(new cMorph(*source.morph.at(i)));
 		}
 	}
-	this->frames = source.frames;
+	this->columns = source.columns;
+	this->frameStates = source.frameStates;
 	this->listOfParameters = source.listOfParameters;
 	this->framesPerKeyframe = source.framesPerKeyframe;
+	InvalidateInterpolation();
 
 	return *this;
 }
 
 cAnimationFrames::sAnimationFrame cKeyframes::GetInterpolatedFrame(int index)
+{
+	if (!IsMorphTableValid()) PrepareMorphTable();
+	return InterpolateFrame(index, &morphInterpolator, &morph);
+}
+
+void cKeyframes::PrepareMorphTable()
+{
+	// frames were interpolated from previous table
+	precalculatedFrames.clear();
+	morphColumns.clear();
+	morphPaletteParameters.clear();
+	morphTable.clear();
+	morphTableRowSize = 0;
+	morphTableKeyframes = frameStates.size();
+	if (frameStates.isEmpty()) return;
+
+	// handles are the same in all containers created by GetFrame()
+	cParameterContainer firstKeyframe = GetFrame(0).parameters;
+	for (int i = 0; i < listOfParameters.size(); i++)
+	{
+		const cOneParameter &parameter = columns.at(i).prototype;
+		if (parameter.IsEmpty()) continue;
+		sMorphColumn column;
+		column.name = FullParameterName(i);
+		column.handle = firstKeyframe.GetHandle(column.name);
+		column.frameColumn = i;
+		column.varType = parameter.GetValueType();
+		column.morphType = parameter.GetMorphType();
+		column.firstValue = morphTableRowSize;
+		switch (column.varType)
+		{
+			case typeDouble:
+			case typeInt: column.numberOfValues = 1; break;
+			case typeRgb:
+			case typeVector3: column.numberOfValues = 3; break;
+			case typeVector4: column.numberOfValues = 4; break;
+			case typeColorPalette: morphPaletteParameters.append(i); continue;
+			default: continue; // strings and booleans are not interpolated
+		}
+		morphTableRowSize += column.numberOfValues;
+		morphColumns.append(column);
+	}
+
+	// columns of frame store have already values of all keyframes in one array
+	morphTable.resize(morphTableRowSize * frameStates.size());
+	for (int c = 0; c < morphColumns.size(); c++)
+	{
+		const sMorphColumn &column = morphColumns.at(c);
+		const double *source = columns.at(column.frameColumn).values.constData();
+		for (int k = 0; k < frameStates.size(); k++)
+		{
+			double *values = morphTable.data() + k * morphTableRowSize + column.firstValue;
+			for (int n = 0; n < column.numberOfValues; n++)
+				values[n] = source[k * column.numberOfValues + n];
+		}
+	}
+}
+
+cAnimationFrames::sAnimationFrame cKeyframes::InterpolateFrame(
+	int index, cMorph *interpolator, QList<cMorph *> *paletteMorph) const
 {
 	int keyframe = index / framesPerKeyframe;
 	int subIndex = index % framesPerKeyframe;
+	double factor = 1.0 * subIndex / framesPerKeyframe;
+	int lastKeyframe = frameStates.size() - 1;
 
-	// if(subIndex == 0)
-	//{
-	// no need to interpolate
-	//	return GetFrame(keyframe);
-	//}
-
+	// not interpolated parameters are the same as in the keyframe
 	sAnimationFrame interpolated;
-	QList<QString> parameterList = frames.at(keyframe).parameters.GetListOfParameters();
-	for (int i = 0; i < parameterList.size(); i++)
+	interpolated.parameters = GetFrame(keyframe).parameters;
+
+	// rows of neighbouring keyframes (from keyframe - 2 to keyframe + 3)
+	const double *rows[6];
+	for (int r = 0; r < 6; r++)
+	{
+		int k = qBound(0, keyframe - 2 + r, lastKeyframe);
+		rows[r] = morphTable.constData() + k * morphTableRowSize;
+	}
+
+	QVector<double> values(morphTableRowSize);
+	for (int c = 0; c < morphColumns.size(); c++)
+	{
+		const sMorphColumn &column = morphColumns.at(c);
+		int first = column.firstValue;
+		int last = first + column.numberOfValues;
+		switch (column.morphType)
+		{
+			case morphLinear:
+			case morphLinearAngle:
+			{
+				// last keyframe is not interpolated
+				if (keyframe == lastKeyframe) continue;
+				bool angular = column.morphType == morphLinearAngle;
+				for (int n = first; n < last; n++)
+					values[n] = interpolator->LinearInterpolate(factor, rows[2][n], rows[3][n], angular);
+				break;
+			}
+			case morphCatMullRom:
+			case morphCatMullRomAngle:
+			{
+				bool angular = column.morphType == morphCatMullRomAngle;
+				for (int n = first; n < last; n++)
+					values[n] = interpolator->CatmullRomInterpolate(
+						factor, rows[1][n], rows[2][n], rows[3][n], rows[4][n], angular);
+				break;
+			}
+			case morphAkima:
+			case morphAkimaAngle:
+			{
+				bool angular = column.morphType == morphAkimaAngle;
+				for (int n = first; n < last; n++)
+					values[n] = interpolator->AkimaInterpolate(factor, rows[0][n], rows[1][n], rows[2][n],
+						rows[3][n], rows[4][n], rows[5][n], angular);
+				break;
+			}
+			default: continue;
+		}
+
+		// write back interpolated values
+		sParameterHandle handle = interpolated.parameters.FindHandle(column.name, column.handle);
+		cOneParameter parameter = interpolated.parameters.GetAsOneParameter(handle);
+		cMultiVal val;
+		switch (column.varType)
+		{
+			case typeRgb:
+				val.Store(sRGB((int)values[first], (int)values[first + 1], (int)values[first + 2]));
+				break;
+			case typeVector3:
+				val.Store(CVector3(values[first], values[first + 1], values[first + 2]));
+				break;
+			case typeVector4:
+				val.Store(
+					CVector4(values[first], values[first + 1], values[first + 2], values[first + 3]));
+				break;
+			default: val.Store(values[first]); break;
+		}
+		parameter.SetMultival(val, valueActual);
+		interpolated.parameters.SetFromOneParameter(handle, parameter);
+	}
+
+	// palettes are interpolated separately
+	for (int i = 0; i < morphPaletteParameters.size(); i++)
 	{
-		// prepare interpolator
-		if (morph.size() <= i)
+		if (paletteMorph->size() <= i)
 		{
-			morph.append(new cMorph());
+			paletteMorph->append(new cMorph());
 		}
-		for (int k = fmax(0, keyframe - 2); k <= fmin(frames.size() - 1, keyframe + 3); k++)
+		int parameterIndex = morphPaletteParameters.at(i);
+		for (int k = qMax(0, keyframe - 2); k <= qMin(lastKeyframe, keyframe + 3); k++)
 		{
-			if (morph[i]->findInMorph(k) == -1)
+			if ((*paletteMorph)[i]->findInMorph(k) == -1)
 			{
-				morph[i]->AddData(k, frames.at(k).parameters.GetAsOneParameter(parameterList.at(i)));
+				(*paletteMorph)[i]->AddData(k, GetFrameValue(k, parameterIndex));
 			}
 		}
-		// interpolate each parameter and write back
-		interpolated.parameters.AddParamFromOneParameter(
-			parameterList.at(i), morph[i]->Interpolate(keyframe, 1.0 * subIndex / framesPerKeyframe));
+		interpolated.parameters.SetFromOneParameter(
+			FullParameterName(parameterIndex), (*paletteMorph)[i]->Interpolate(keyframe, factor));
 	}
 	return interpolated;
 }
@@ -112,18 +247,27 @@ cAnimationFrames::sAnimationFrame cKeyframes::GetInterpolatedFrame(int index)
 void cKeyframes::GetInterpolatedFrameAndConsolidate(
 	int index, cParameterContainer *params, cFractalContainer *fractal)
 {
-	if (index >= 0 && index < frames.count() * framesPerKeyframe)
+	if (index >= 0 && index < frameStates.count() * framesPerKeyframe)
 	{
-		sAnimationFrame frame = GetInterpolatedFrame(index);
+		sAnimationFrame frame;
+		// precalculated frames are valid only with the table they were interpolated from
+		if (!IsMorphTableValid()) PrepareMorphTable();
+		if (precalculatedFrames.contains(index))
+			frame = precalculatedFrames.take(index);
+		else
+			frame = GetInterpolatedFrame(index);
 
 		for (int i = 0; i < listOfParameters.size(); ++i)
 		{
 			cParameterContainer *container =
 				ContainerSelector(listOfParameters[i].containerName, params, fractal);
-			QString parameterName = listOfParameters[i].parameterName;
-			cOneParameter oneParameter =
-				frame.parameters.GetAsOneParameter(listOfParameters[i].containerName + "_" + parameterName);
-			container->SetFromOneParameter(parameterName, oneParameter);
+			sParameterDescription &description = listOfParameters[i];
+			description.frameHandle = frame.parameters.FindHandle(
+				description.containerName + "_" + description.parameterName, description.frameHandle);
+			description.containerHandle =
+				container->FindHandle(description.parameterName, description.containerHandle);
+			container->SetFromOneParameter(
+				description.containerHandle, frame.parameters.GetAsOneParameter(description.frameHandle));
 		}
 	}
 	else
@@ -135,19 +279,19 @@ void cKeyframes::GetInterpolatedFrameAndConsolidate(
 
 int cKeyframes::GetUnrenderedTotal()
 {
-	return GetUnrenderedTillIndex((frames.count() - 1) * GetFramesPerKeyframe());
+	return GetUnrenderedTillIndex((frameStates.count() - 1) * GetFramesPerKeyframe());
 }
 
 int cKeyframes::GetUnrenderedTillIndex(int frameIndex)
 {
-	if (frameIndex >= 0 && frameIndex < frames.count() * GetFramesPerKeyframe())
+	if (frameIndex >= 0 && frameIndex < frameStates.count() * GetFramesPerKeyframe())
 	{
 		int count = 0;
 		for (int index = 0; index < frameIndex; ++index)
 		{
 			int keyframe = index / GetFramesPerKeyframe();
 			int subIndex = index % GetFramesPerKeyframe();
-			if (!frames.at(keyframe).alreadyRenderedSubFrames[subIndex]) count++;
+			if (!frameStates.at(keyframe).alreadyRenderedSubFrames[subIndex]) count++;
 		}
 		return count;
 	}
@@ -166,35 +310,71 @@ void cKeyframes::ChangeMorphType(int parameterIndex, parameterContainer::enumMor
 	if (morphType != oldMorphType)
 	{
 		if (parameterIndex < morph.size()) morph[parameterIndex]->Clear();
+		InvalidateInterpolation();
 
 		listOfParameters[parameterIndex].morphType = morphType;
-		QString fullParameterName = listOfParameters[parameterIndex].containerName + "_"
-																+ listOfParameters[parameterIndex].parameterName;
-
-		for (int i = 0; i < frames.size(); i++)
-		{
-			cOneParameter parameter = frames[i].parameters.GetAsOneParameter(fullParameterName);
-			parameter.SetMorphType(morphType);
-			frames[i].parameters.SetFromOneParameter(fullParameterName, parameter);
-		}
+		// morph type is common for all frames
+		columns[parameterIndex].prototype.SetMorphType(morphType);
 	}
 }
 void cKeyframes::AddAnimatedParameter(
 	const QString &parameterName, const cOneParameter &defaultValue)
 {
-	morph.clear();
+	ClearMorphCache();
 	cAnimationFrames::AddAnimatedParameter(parameterName, defaultValue);
 }
 
 bool cKeyframes::AddAnimatedParameter(const QString &fullParameterName,
 	const cParameterContainer *param, const cFractalContainer *fractal)
 {
-	morph.clear();
+	ClearMorphCache();
 	return cAnimationFrames::AddAnimatedParameter(fullParameterName, param, fractal);
 }
 
 void cKeyframes::RemoveAnimatedParameter(const QString &fullParameterName)
 {
-	morph.clear();
+	ClearMorphCache();
 	cAnimationFrames::RemoveAnimatedParameter(fullParameterName);
 }
+
+void cKeyframes::ModifyFrame(int index, sAnimationFrame &frame)
+{
+	InvalidateInterpolation();
+	cAnimationFrames::ModifyFrame(index, frame);
+}
+
+void cKeyframes::PrecalculateInterpolatedFrames(int firstIndex, int count)
+{
+	if (!IsMorphTableValid()) PrepareMorphTable();
+
+	QList<int> indexes;
+	int lastIndex = qMin(firstIndex + count, (frameStates.count() - 1) * framesPerKeyframe);
+	for (int index = firstIndex; index < lastIndex; index++)
+	{
+		if (precalculatedFrames.contains(index)) continue;
+		const QList<bool> &rendered =
+			frameStates.at(index / framesPerKeyframe).alreadyRenderedSubFrames;
+		if (index % framesPerKeyframe < rendered.size() && rendered[index % framesPerKeyframe])
+			continue;
+		indexes.append(index);
+	}
+	if (indexes.isEmpty()) return;
+
+	QVector<sAnimationFrame> interpolated(indexes.size());
+
+	// every thread needs own interpolators
+#pragma omp parallel
+	{
+		cMorph threadInterpolator;
+		QList<cMorph *> threadMorph;
+#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < indexes.size(); i++)
+		{
+			interpolated[i] = InterpolateFrame(indexes[i], &threadInterpolator, &threadMorph);
+		}
+		qDeleteAll(threadMorph);
+	}
+
+	for (int i = 0; i < indexes.size(); i++)
+		precalculatedFrames.insert(indexes[i], interpolated[i]);
+}
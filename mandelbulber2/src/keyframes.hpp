@@ -57,10 +57,22 @@ public:
 	sAnimationFrame GetInterpolatedFrame(int index);
 	void GetInterpolatedFrameAndConsolidate(
 		int index, cParameterContainer *params, cFractalContainer *fractal);
-	void SetFramesPerKeyframe(int frPerKey) { framesPerKeyframe = frPerKey; }
+	void SetFramesPerKeyframe(int frPerKey)
+	{
+		if (frPerKey != framesPerKeyframe) precalculatedFrames.clear();
+		framesPerKeyframe = frPerKey;
+	}
 	int GetFramesPerKeyframe() const { return framesPerKeyframe; }
 	void ChangeMorphType(int parameterIndex, parameterContainer::enumMorphType morphType);
-	void ClearMorphCache() { morph.clear(); }
+	void ClearMorphCache()
+	{
+		morph.clear();
+		InvalidateInterpolation();
+	}
+	void ModifyFrame(int index, sAnimationFrame &frame);
+	// interpolates not rendered frames from given range in parallel. They are used later by
+	// GetInterpolatedFrameAndConsolidate()
+	void PrecalculateInterpolatedFrames(int firstIndex, int count);
 	int GetUnrenderedTotal();
 	int GetUnrenderedTillIndex(int frameIndex);
 	void AddAnimatedParameter(const QString &parameterName, const cOneParameter &defaultValue);
@@ -69,8 +81,43 @@ public:
 	void RemoveAnimatedParameter(const QString &fullParameterName);
 
 private:
+	// numeric parameter stored in the table of keyframe values
+	struct sMorphColumn
+	{
+		QString name;
+		sParameterHandle handle;
+		int frameColumn; // index on list of animated parameters
+		parameterContainer::enumVarType varType;
+		parameterContainer::enumMorphType morphType;
+		int firstValue;
+		int numberOfValues;
+	};
+
+	// collects values of all numeric parameters of all keyframes in one table
+	void PrepareMorphTable();
+	// morph table and precalculated frames are prepared again when they are needed
+	void InvalidateInterpolation()
+	{
+		precalculatedFrames.clear();
+		morphTableRowSize = -1;
+	}
+	bool IsMorphTableValid() const
+	{
+		return morphTableRowSize >= 0 && morphTableKeyframes == frameStates.size();
+	}
+	sAnimationFrame InterpolateFrame(
+		int index, cMorph *interpolator, QList<cMorph *> *paletteMorph) const;
+
 	int framesPerKeyframe;
 	QList<cMorph *> morph;
+	cMorph morphInterpolator;
+	QMap<int, sAnimationFrame> precalculatedFrames;
+
+	QList<sMorphColumn> morphColumns;
+	QList<int> morphPaletteParameters; // can't be stored in the table
+	QVector<double> morphTable;
+	int morphTableRowSize;
+	int morphTableKeyframes;
 };
 
 extern cKeyframes *gKeyframes;
@@ -0,0 +1,162 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cLightGrid class - spatial grid of auxiliary lights
+ */
+
+#include "light_grid.hpp"
+
+#include <algorithm>
+
+#include "lights.hpp"
+
+using std::max;
+using std::min;
+
+cLightGrid::cLightGrid(const cLights &lights, double maxSpecular)
+{
+	int numberOfLights = lights.GetNumberOfLights();
+
+	// AuxLightsShader() divides intensity by number of lights, but not less than 4
+	int intensityDivider = max(numberOfLights, 4);
+
+	// bounding box of all spheres of influence
+	QVector<int> usedLights;
+	QVector<double> radii;
+	CVector3 boxMax;
+	for (int i = 0; i < numberOfLights; i++)
+	{
+		const sLight *light = lights.GetLight(i);
+		if (!light->enabled || light->intensity <= 0.0) continue;
+
+		double radius = InfluenceRadius(light, intensityDivider, maxSpecular);
+		CVector3 low = light->position - CVector3(radius, radius, radius);
+		CVector3 high = light->position + CVector3(radius, radius, radius);
+		if (usedLights.isEmpty())
+		{
+			boxMin = low;
+			boxMax = high;
+		}
+		else
+		{
+			boxMin = CVector3(min(boxMin.x, low.x), min(boxMin.y, low.y), min(boxMin.z, low.z));
+			boxMax = CVector3(max(boxMax.x, high.x), max(boxMax.y, high.y), max(boxMax.z, high.z));
+		}
+		usedLights.append(i);
+		radii.append(radius);
+	}
+
+	// number of cells grows with number of lights
+	resolution = (int)ceil(pow((double)usedLights.size(), 1.0 / 3.0)) * 2;
+	resolution = min(max(resolution, 1), LIGHT_GRID_MAX_RESOLUTION);
+	cellSize = (boxMax - boxMin) / resolution;
+	if (usedLights.isEmpty()) cellSize = CVector3(1.0, 1.0, 1.0);
+
+	int numberOfCells = resolution * resolution * resolution;
+
+	// pairs of cell and light for all cells which intersect spheres of influence
+	QVector<int> pairCells;
+	QVector<int> pairLights;
+	for (int l = 0; l < usedLights.size(); l++)
+	{
+		const sLight *light = lights.GetLight(usedLights[l]);
+		double radius = radii[l];
+		CVector3 low = (light->position - boxMin - CVector3(radius, radius, radius));
+		CVector3 high = (light->position - boxMin + CVector3(radius, radius, radius));
+		int x1 = min(max((int)(low.x / cellSize.x), 0), resolution - 1);
+		int y1 = min(max((int)(low.y / cellSize.y), 0), resolution - 1);
+		int z1 = min(max((int)(low.z / cellSize.z), 0), resolution - 1);
+		int x2 = min(max((int)(high.x / cellSize.x), 0), resolution - 1);
+		int y2 = min(max((int)(high.y / cellSize.y), 0), resolution - 1);
+		int z2 = min(max((int)(high.z / cellSize.z), 0), resolution - 1);
+
+		for (int z = z1; z <= z2; z++)
+		{
+			for (int y = y1; y <= y2; y++)
+			{
+				for (int x = x1; x <= x2; x++)
+				{
+					// distance from light to the nearest point of the cell
+					CVector3 cellMin = boxMin + CVector3(x * cellSize.x, y * cellSize.y, z * cellSize.z);
+					CVector3 cellMax = cellMin + cellSize;
+					CVector3 nearest(min(max(light->position.x, cellMin.x), cellMax.x),
+						min(max(light->position.y, cellMin.y), cellMax.y),
+						min(max(light->position.z, cellMin.z), cellMax.z));
+					if ((nearest - light->position).Length() > radius) continue;
+
+					pairCells.append(CellIndex(x, y, z));
+					pairLights.append(usedLights[l]);
+				}
+			}
+		}
+	}
+
+	// lights are sorted by cells (counting sort)
+	cellFirst.fill(0, numberOfCells + 1);
+	for (int i = 0; i < pairCells.size(); i++)
+		cellFirst[pairCells[i] + 1]++;
+	for (int c = 0; c < numberOfCells; c++)
+		cellFirst[c + 1] += cellFirst[c];
+
+	lightIndices.resize(pairCells.size());
+	QVector<int> cursor = cellFirst;
+	for (int i = 0; i < pairCells.size(); i++)
+		lightIndices[cursor[pairCells[i]]++] = pairLights[i];
+}
+
+int cLightGrid::GetLights(const CVector3 &point, const int **indices) const
+{
+	CVector3 relative = point - boxMin;
+	double fx = relative.x / cellSize.x;
+	double fy = relative.y / cellSize.y;
+	double fz = relative.z / cellSize.z;
+
+	// outside of the grid there is no light with not negligible influence
+	if (fx < 0.0 || fy < 0.0 || fz < 0.0 || fx >= resolution || fy >= resolution
+			|| fz >= resolution)
+	{
+		*indices = NULL;
+		return 0;
+	}
+
+	int cell = CellIndex((int)fx, (int)fy, (int)fz);
+	*indices = lightIndices.constData() + cellFirst[cell];
+	return cellFirst[cell + 1] - cellFirst[cell];
+}
+
+double cLightGrid::InfluenceRadius(const sLight *light, int numberOfLights, double maxSpecular)
+{
+	// in LightShading() intensity = 100 * I / d^2 / numberOfLights / 6. Diffuse shading is not
+	// higher than intensity and specular shading is not higher than intensity * specular
+	double factor = max(1.0, maxSpecular);
+	return sqrt(
+		100.0 * light->intensity * factor / numberOfLights / 6.0 / LIGHT_GRID_SHADING_THRESHOLD);
+}
@@ -0,0 +1,80 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cLightGrid class - spatial grid of auxiliary lights
+ *
+ * Influence of aux light on surface decreases with square of distance. Light
+ * is inserted into all grid cells which intersect the sphere of its influence,
+ * so for a shaded point only lights from its cell have to be calculated.
+ */
+
+#ifndef MANDELBULBER2_SRC_LIGHT_GRID_HPP_
+#define MANDELBULBER2_SRC_LIGHT_GRID_HPP_
+
+#include <QVector>
+
+#include "algebra.hpp"
+
+// forward declarations
+class cLights;
+struct sLight;
+
+// shading of aux light below this value is not calculated (the same as in LightShading())
+#define LIGHT_GRID_SHADING_THRESHOLD 0.01
+// maximum number of cells along each axis
+#define LIGHT_GRID_MAX_RESOLUTION 32
+
+class cLightGrid
+{
+public:
+	// maxSpecular is the highest specular factor of all materials
+	cLightGrid(const cLights &lights, double maxSpecular);
+
+	// indices of lights which can illuminate given point. Returns number of lights
+	int GetLights(const CVector3 &point, const int **indices) const;
+
+	int GetNumberOfCells() const { return cellFirst.size() - 1; }
+
+	// distance where diffuse and specular shading of light drops below the threshold used by
+	// LightShading() for skipping of shadows
+	static double InfluenceRadius(const sLight *light, int numberOfLights, double maxSpecular);
+
+private:
+	int CellIndex(int x, int y, int z) const { return (z * resolution + y) * resolution + x; }
+
+	CVector3 boxMin;
+	CVector3 cellSize;
+	int resolution;
+	QVector<int> cellFirst; // index of first light of each cell in lightIndices
+	QVector<int> lightIndices;
+};
+
+#endif /* MANDELBULBER2_SRC_LIGHT_GRID_HPP_ */
@@ -35,9 +35,12 @@
 #include "main.hpp"
 #include "animation_flight.hpp"
 #include "animation_keyframes.hpp"
+#include "autosave.hpp"
 #include "cimage.hpp"
 #include "command_line_interface.hpp"
+#include "distance_query.hpp"
 #include "error_message.hpp"
+#include "formula_benchmark.hpp"
 #include "fractal_list.hpp"
 #include "global_data.hpp"
 #include "headless.h"
@@ -94,6 +97,7 @@ int main(int argc, char *argv[])
 	qRegisterMetaType<cStatistics>("cStatistics");
 	qRegisterMetaType<QList<QByteArray> /* */>("QList<QByteArray>");
 	qRegisterMetaType<QList<int> /* */>("QList<int>");
+	qRegisterMetaType<QList<double> /* */>("QList<double>");
 	qRegisterMetaType<cParameterContainer>("cParameterContainer");
 	qRegisterMetaType<cFractalContainer>("cFractalContainer");
 	qRegisterMetaType<sTextures>("sTextures");
@@ -134,10 +138,18 @@ int main(int argc, char *argv[])
 
 	// Define list of fractal formulas
 	DefineFractalList(&fractalList);
+	// costs of formulas measured with --benchmark-formulas
+	cFormulaBenchmark::LoadResults();
 
 	// Netrender
 	gNetRender = new CNetRender(systemData.numberOfThreads);
 
+	// autosave written in background
+	gAutosave = new cAutosave(systemData.GetAutosaveFile(), systemData.GetAutosaveJournalFile());
+
+	// distances for navigation and statistics
+	gDistanceQuery = new cDistanceQuery;
+
 	// loading AppSettings
 	if (QFile(systemData.GetIniFile()).exists())
 	{
@@ -212,6 +224,8 @@ int main(int argc, char *argv[])
 	delete gAnimFrames;
 	delete gKeyframes;
 	delete gNetRender;
+	delete gAutosave;
+	delete gDistanceQuery;
 	delete gQueue;
 	delete gMainInterface;
 	delete gErrorMessage;
@@ -34,6 +34,9 @@
 
 #include "marchingcubes.h"
 
+#include <math.h>
+#include <algorithm>
+
 namespace mc
 {
 
@@ -328,48 +331,67 @@ void mc_add_vertex(double x1, double y1, double z1, double c2, int axis, double
 	double isovalue, std::vector<double> *vertices, double colorIndex_1, double colorIndex_2,
 	std::vector<double> *colorIndices)
 {
+	double vertex[3];
+	double colorIndex;
+	mc_interpolate_vertex(
+		x1, y1, z1, c2, axis, f1, f2, isovalue, colorIndex_1, colorIndex_2, vertex, &colorIndex);
+	vertices->push_back(vertex[0]);
+	vertices->push_back(vertex[1]);
+	vertices->push_back(vertex[2]);
+	colorIndices->push_back(colorIndex);
+}
+
+void mc_interpolate_vertex(double x1, double y1, double z1, double c2, int axis, double f1,
+	double f2, double isovalue, double colorIndex_1, double colorIndex_2, double *vertex,
+	double *colorIndex)
+{
+	vertex[0] = x1;
+	vertex[1] = y1;
+	vertex[2] = z1;
 	if (axis == 0)
-	{
-		double x = mc_isovalue_interpolation(isovalue, f1, f2, x1, c2);
-		vertices->push_back(x);
-		vertices->push_back(y1);
-		vertices->push_back(z1);
+		vertex[0] = mc_isovalue_interpolation(isovalue, f1, f2, x1, c2);
+	else if (axis == 1)
+		vertex[1] = mc_isovalue_interpolation(isovalue, f1, f2, y1, c2);
+	else if (axis == 2)
+		vertex[2] = mc_isovalue_interpolation(isovalue, f1, f2, z1, c2);
 
-		// double f = (x - x1) / (c2 - x1);
-		double colorIndex = mc_isovalue_interpolation(
-			isovalue, f1, f2, colorIndex_1, colorIndex_2); // f * colorIndex_2 + (1.0 - f) * colorIndex_1;
-		colorIndices->push_back(colorIndex);
+	*colorIndex = mc_isovalue_interpolation(isovalue, f1, f2, colorIndex_1, colorIndex_2);
+}
 
-		return;
-	}
-	if (axis == 1)
+void mc_cube_normal(const mc_cube &cube, const double *point, double *normal)
+{
+	// local coordinates of the point inside the cube
+	double t[3];
+	for (int axis = 0; axis < 3; axis++)
 	{
-		double y = mc_isovalue_interpolation(isovalue, f1, f2, y1, c2);
-		vertices->push_back(x1);
-		vertices->push_back(y);
-		vertices->push_back(z1);
+		t[axis] = (point[axis] - cube.lower[axis]) / cube.size[axis];
+		t[axis] = std::min(1.0, std::max(0.0, t[axis]));
+	}
 
-		// double f = (y - y1) / (c2 - y1);
-		double colorIndex = mc_isovalue_interpolation(
-			isovalue, f1, f2, colorIndex_1, colorIndex_2); // f * colorIndex_2 + (1.0 - f) * colorIndex_1;
-		colorIndices->push_back(colorIndex);
+	// offsets of corners in x, y and z
+	static const int corners[8][3] = {
+		{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
 
-		return;
-	}
-	if (axis == 2)
+	double gradient[3] = {0.0, 0.0, 0.0};
+	for (int m = 0; m < 8; m++)
 	{
-		double z = mc_isovalue_interpolation(isovalue, f1, f2, z1, c2);
-		vertices->push_back(x1);
-		vertices->push_back(y1);
-		vertices->push_back(z);
-
-		// double f = (z - z1) / (c2 - z1);
-		double colorIndex = mc_isovalue_interpolation(
-			isovalue, f1, f2, colorIndex_1, colorIndex_2); // f * colorIndex_2 + (1.0 - f) * colorIndex_1;
-		colorIndices->push_back(colorIndex);
+		double weights[3];
+		for (int axis = 0; axis < 3; axis++)
+			weights[axis] = corners[m][axis] ? t[axis] : 1.0 - t[axis];
 
-		return;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double derivative = corners[m][axis] ? 1.0 : -1.0;
+			for (int other = 0; other < 3; other++)
+				if (other != axis) derivative *= weights[other];
+			gradient[axis] += cube.values[m] * derivative / cube.size[axis];
+		}
 	}
+
+	double length =
+		sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1] + gradient[2] * gradient[2]);
+	for (int axis = 0; axis < 3; axis++)
+		normal[axis] = (length > 0.0) ? gradient[axis] / length : 0.0;
 }
 }
 }
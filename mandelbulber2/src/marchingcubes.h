@@ -51,6 +51,35 @@ double mc_isovalue_interpolation(double isovalue, double f1, double f2, double x
 void mc_add_vertex(double x1, double y1, double z1, double c2, int axis, double f1, double f2,
 	double isovalue, std::vector<double> *vertices, double colorIndex_1, double colorIndex_2,
 	std::vector<double> *colorIndices);
+void mc_interpolate_vertex(double x1, double y1, double z1, double c2, int axis, double f1,
+	double f2, double isovalue, double colorIndex_1, double colorIndex_2, double *vertex,
+	double *colorIndex);
+
+// field values in corners of one cube
+struct mc_cube
+{
+	const double *values;
+	double lower[3];
+	double size[3];
+};
+
+// normal vector as normalized gradient of trilinear interpolation of the cube values
+void mc_cube_normal(const mc_cube &cube, const double *point, double *normal);
+
+template <typename meshWriter>
+size_t mc_write_vertex(double x1, double y1, double z1, double c2, int axis, double f1, double f2,
+	double isovalue, double colorIndex_1, double colorIndex_2, const mc_cube &cube,
+	meshWriter &writer)
+{
+	double vertex[3];
+	double colorIndex;
+	double normal[3];
+	mc_interpolate_vertex(
+		x1, y1, z1, c2, axis, f1, f2, isovalue, colorIndex_1, colorIndex_2, vertex, &colorIndex);
+	mc_cube_normal(cube, vertex, normal);
+	return writer.AddVertex(
+		vertex[0], vertex[1], vertex[2], colorIndex, normal[0], normal[1], normal[2]);
+}
 }
 
 template <typename coord_type, typename vector3, typename formula, typename progressFtor>
@@ -250,6 +279,213 @@ bailout:
 
 	delete[] shared_indices;
 }
+
+// variant of marching_cubes() which keeps in memory only two slabs of field values and two slabs
+// of shared vertex indices. Vertices and triangles are passed to the writer as they are found:
+// writer.AddVertex(x, y, z, colorIndex, nx, ny, nz) returns index of the vertex. Normals are
+// calculated from the field values of the cube, so they don't need any additional evaluations,
+// writer.AddTriangle(index1, index2, index3) receives one triangle.
+// Field is evaluated by whole slabs: f(x, y[], numberOfY, z[], numberOfZ, values[], colorIndices[])
+// with values stored as [iy * numberOfZ + iz], so f can evaluate the slab in parallel.
+// Polygonization is sequential, so the mesh doesn't depend on the number of threads
+template <typename coord_type, typename vector3, typename formula, typename progressFtor,
+	typename meshWriter>
+void marching_cubes_streaming(const vector3 &lower, const vector3 &upper, int numx, int numy,
+	int numz, formula f, double isovalue, bool *stop, progressFtor progress, meshWriter &writer)
+{
+	using namespace private_;
+
+	// numx, numy and numz are the numbers of evaluations in each direction
+	--numx;
+	--numy;
+	--numz;
+
+	coord_type dx = (upper[0] - lower[0]) / static_cast<coord_type>(numx);
+	coord_type dy = (upper[1] - lower[1]) / static_cast<coord_type>(numy);
+	coord_type dz = (upper[2] - lower[2]) / static_cast<coord_type>(numz);
+
+	// field values of two layers of grid points (x = i and x = i + 1)
+	const int slabSize = (numy + 1) * (numz + 1);
+	const int z1 = numz + 1;
+	std::vector<double> field(slabSize), fieldNext(slabSize);
+	std::vector<double> color(slabSize), colorNext(slabSize);
+
+	std::vector<double> yCoordinates(numy + 1), zCoordinates(numz + 1);
+	for (int j = 0; j <= numy; ++j)
+		yCoordinates[j] = lower[1] + dy * j;
+	for (int k = 0; k <= numz; ++k)
+		zCoordinates[k] = lower[2] + dz * k;
+
+	// indices of vertices shared with neighbouring cubes of current and previous layer
+	const int z3 = numz * 3;
+	std::vector<size_t> shared_indices(numy * z3), shared_indices_prev(numy * z3);
+
+	for (int i = 0; i <= numx; ++i)
+	{
+		if (i < numx) progress(i);
+
+		// evaluation of next layer of grid points
+		coord_type xLayer = lower[0] + dx * i;
+		f(xLayer, &yCoordinates[0], numy + 1, &zCoordinates[0], numz + 1, &fieldNext[0],
+			&colorNext[0]);
+
+		if (*stop)
+		{
+			progress(-1);
+			return;
+		}
+
+		if (i > 0)
+		{
+			int ii = i - 1;
+			coord_type x = lower[0] + dx * ii;
+			coord_type x_dx = lower[0] + dx * (ii + 1);
+			for (int j = 0; j < numy; ++j)
+			{
+				coord_type y = lower[1] + dy * j;
+				coord_type y_dy = lower[1] + dy * (j + 1);
+
+				for (int k = 0; k < numz; ++k)
+				{
+					coord_type z = lower[2] + dz * k;
+					coord_type z_dz = lower[2] + dz * (k + 1);
+
+					const int p = j * z1 + k;
+					double v[8];
+					double colorIndex[8];
+					v[0] = field[p];
+					v[1] = fieldNext[p];
+					v[2] = fieldNext[p + z1];
+					v[3] = field[p + z1];
+					v[4] = field[p + 1];
+					v[5] = fieldNext[p + 1];
+					v[6] = fieldNext[p + z1 + 1];
+					v[7] = field[p + z1 + 1];
+					colorIndex[0] = color[p];
+					colorIndex[1] = colorNext[p];
+					colorIndex[2] = colorNext[p + z1];
+					colorIndex[3] = color[p + z1];
+					colorIndex[4] = color[p + 1];
+					colorIndex[5] = colorNext[p + 1];
+					colorIndex[6] = colorNext[p + z1 + 1];
+					colorIndex[7] = color[p + z1 + 1];
+
+					unsigned int cubeindex = 0;
+					for (int m = 0; m < 8; ++m)
+						if (v[m] <= isovalue) cubeindex |= 1 << m;
+
+					int edges = edge_table[cubeindex];
+					if (edges == 0) continue;
+
+					mc_cube cube = {v, {x, y, z}, {dx, dy, dz}};
+
+					size_t indices[12];
+					size_t *shared = &shared_indices[j * z3 + k * 3];
+					if (edges & 0x040)
+					{
+						indices[6] = mc_write_vertex(x_dx, y_dy, z_dz, x, 0, v[6], v[7], isovalue,
+							colorIndex[7], colorIndex[7], cube, writer);
+						shared[0] = indices[6];
+					}
+					if (edges & 0x020)
+					{
+						indices[5] = mc_write_vertex(x_dx, y, z_dz, y_dy, 1, v[5], v[6], isovalue,
+							colorIndex[5], colorIndex[6], cube, writer);
+						shared[1] = indices[5];
+					}
+					if (edges & 0x400)
+					{
+						indices[10] = mc_write_vertex(x_dx, y + dx, z, z_dz, 2, v[2], v[6], isovalue,
+							colorIndex[2], colorIndex[6], cube, writer);
+						shared[2] = indices[10];
+					}
+
+					if (edges & 0x001)
+					{
+						if (j == 0 || k == 0)
+							indices[0] = mc_write_vertex(x, y, z, x_dx, 0, v[0], v[1], isovalue, colorIndex[0],
+								colorIndex[1], cube, writer);
+						else
+							indices[0] = shared_indices[(j - 1) * z3 + (k - 1) * 3 + 0];
+					}
+					if (edges & 0x002)
+					{
+						if (k == 0)
+							indices[1] = mc_write_vertex(x_dx, y, z, y_dy, 1, v[1], v[2], isovalue,
+								colorIndex[1], colorIndex[2], cube, writer);
+						else
+							indices[1] = shared_indices[j * z3 + (k - 1) * 3 + 1];
+					}
+					if (edges & 0x004)
+					{
+						if (k == 0)
+							indices[2] = mc_write_vertex(x_dx, y_dy, z, x, 0, v[2], v[3], isovalue,
+								colorIndex[2], colorIndex[3], cube, writer);
+						else
+							indices[2] = shared_indices[j * z3 + (k - 1) * 3 + 0];
+					}
+					if (edges & 0x008)
+					{
+						if (ii == 0 || k == 0)
+							indices[3] = mc_write_vertex(x, y_dy, z, y, 1, v[3], v[0], isovalue, colorIndex[3],
+								colorIndex[0], cube, writer);
+						else
+							indices[3] = shared_indices_prev[j * z3 + (k - 1) * 3 + 1];
+					}
+					if (edges & 0x010)
+					{
+						if (j == 0)
+							indices[4] = mc_write_vertex(x, y, z_dz, x_dx, 0, v[4], v[5], isovalue,
+								colorIndex[4], colorIndex[5], cube, writer);
+						else
+							indices[4] = shared_indices[(j - 1) * z3 + k * 3 + 0];
+					}
+					if (edges & 0x080)
+					{
+						if (ii == 0)
+							indices[7] = mc_write_vertex(x, y_dy, z_dz, y, 1, v[7], v[4], isovalue,
+								colorIndex[7], colorIndex[4], cube, writer);
+						else
+							indices[7] = shared_indices_prev[j * z3 + k * 3 + 1];
+					}
+					if (edges & 0x100)
+					{
+						if (ii == 0 || j == 0)
+							indices[8] = mc_write_vertex(x, y, z, z_dz, 2, v[0], v[4], isovalue, colorIndex[0],
+								colorIndex[4], cube, writer);
+						else
+							indices[8] = shared_indices_prev[(j - 1) * z3 + k * 3 + 2];
+					}
+					if (edges & 0x200)
+					{
+						if (j == 0)
+							indices[9] = mc_write_vertex(x_dx, y, z, z_dz, 2, v[1], v[5], isovalue,
+								colorIndex[1], colorIndex[3], cube, writer);
+						else
+							indices[9] = shared_indices[(j - 1) * z3 + k * 3 + 2];
+					}
+					if (edges & 0x800)
+					{
+						if (ii == 0)
+							indices[11] = mc_write_vertex(x, y_dy, z, z_dz, 2, v[3], v[7], isovalue,
+								colorIndex[3], colorIndex[7], cube, writer);
+						else
+							indices[11] = shared_indices_prev[j * z3 + k * 3 + 2];
+					}
+
+					const int *triangle_table_ptr = triangle_table[cubeindex];
+					for (int m = 0; triangle_table_ptr[m] != -1; m += 3)
+						writer.AddTriangle(indices[triangle_table_ptr[m]], indices[triangle_table_ptr[m + 1]],
+							indices[triangle_table_ptr[m + 2]]);
+				}
+			}
+			shared_indices.swap(shared_indices_prev);
+		}
+
+		field.swap(fieldNext);
+		color.swap(colorNext);
+	}
+}
 }
 
 #endif /* MANDELBULBER2_SRC_MARCHINGCUBES_H_ */
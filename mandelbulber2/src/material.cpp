@@ -33,6 +33,8 @@
  */
 
 #include "material.h"
+
+#include "fractal_enums.h"
 #include "netrender.hpp"
 #include "parameters.hpp"
 #include "texture_enums.hpp"
@@ -66,9 +68,10 @@ cMaterial::cMaterial()
 	normalMapTextureHeight = 0.0;
 }
 
-cMaterial::cMaterial(int _id, const cParameterContainer *materialParam, bool quiet)
+cMaterial::cMaterial(
+	int _id, const cParameterContainer *materialParam, bool quiet, bool loadTextures)
 {
-	setParameters(_id, materialParam, quiet);
+	setParameters(_id, materialParam, quiet, loadTextures);
 }
 
 cMaterial::~cMaterial()
@@ -91,7 +94,8 @@ QStringList cMaterial::paramsList = {"is_defined", "name", "shading", "specular"
 	"normal_map_texture_from_bumpmap", "normal_map_texture_height", "normal_map_texture_invert_green",
 	"file_normal_map_texture"};
 
-void cMaterial::setParameters(int _id, const cParameterContainer *materialParam, bool quiet = false)
+void cMaterial::setParameters(
+	int _id, const cParameterContainer *materialParam, bool quiet, bool loadTextures)
 {
 	id = _id;
 	shading = materialParam->Get<double>(Name("shading", id));
@@ -112,6 +116,7 @@ void cMaterial::setParameters(int _id, const cParameterContainer *materialParam,
 	transparencyInteriorColor = materialParam->Get<sRGB>(Name("transparency_interior_color", id));
 
 	palette = materialParam->Get<cColorPalette>(Name("surface_color_palette", id));
+	palette.PrepareLookupTable();
 
 	textureCenter = materialParam->Get<CVector3>(Name("texture_center", id));
 	textureRotation = materialParam->Get<CVector3>(Name("texture_rotation", id));
@@ -148,7 +153,11 @@ void cMaterial::setParameters(int _id, const cParameterContainer *materialParam,
 	fractalColoring.lineDirection =
 		materialParam->Get<CVector3>(Name("fractal_coloring_line_direction", id));
 
-	if (gNetRender->IsClient())
+	if (!loadTextures)
+	{
+		// material is not used by any object
+	}
+	else if (gNetRender->IsClient())
 	{
 		if (useColorTexture)
 			colorTexture.FromQByteArray(
@@ -168,7 +177,7 @@ void cMaterial::setParameters(int _id, const cParameterContainer *materialParam,
 		if (useDisplacementTexture)
 			displacementTexture.FromQByteArray(
 				gNetRender->GetTexture(materialParam->Get<QString>(Name("file_displacement_texture", id))),
-				cTexture::doNotUseMipmaps);
+				cTexture::useMipmaps);
 
 		if (useNormalMapTexture)
 		{
@@ -197,7 +206,7 @@ void cMaterial::setParameters(int _id, const cParameterContainer *materialParam,
 		if (useDisplacementTexture)
 			displacementTexture =
 				cTexture(materialParam->Get<QString>(Name("file_displacement_texture", id)),
-					cTexture::doNotUseMipmaps, quiet);
+					cTexture::useMipmaps, quiet);
 
 		if (useNormalMapTexture)
 		{
@@ -208,12 +217,48 @@ void cMaterial::setParameters(int _id, const cParameterContainer *materialParam,
 		}
 	}
 
+	// bump map is converted to slopes once instead of in every shading sample
+	if (useNormalMapTexture && normalMapTextureFromBumpmap) normalMapTexture.PrepareBumpMapSlopes();
+
 	rotMatrix.SetRotation2(textureRotation / 180 * M_PI);
 }
 
-void CreateMaterialsMap(
-	const cParameterContainer *params, QMap<int, cMaterial> *materials, bool quiet)
+void cMaterial::ListOfTextures(
+	int _id, const cParameterContainer *materialParam, QList<cTexture::sTextureRequest> *list)
 {
+	// has to be the same what setParameters() loads
+	const char *names[] = {"color", "diffusion", "luminosity", "displacement", "normal_map"};
+	const cTexture::enumUseMipmaps modes[] = {cTexture::useMipmaps, cTexture::useMipmaps,
+		cTexture::useMipmaps, cTexture::useMipmaps, cTexture::useMipmaps};
+
+	for (int i = 0; i < 5; i++)
+	{
+		QString textureName(names[i]);
+		if (materialParam->Get<bool>(Name("use_" + textureName + "_texture", _id)))
+		{
+			cTexture::sTextureRequest request;
+			request.filename = materialParam->Get<QString>(Name("file_" + textureName + "_texture", _id));
+			request.mode = modes[i];
+			list->append(request);
+		}
+	}
+}
+
+void CreateMaterialsMap(const cParameterContainer *params, QMap<int, cMaterial> *materials,
+	bool quiet, const QSet<int> *usedMaterials)
+{
+	QList<int> definedMaterials = ListOfDefinedMaterials(params);
+	for (int i = 0; i < definedMaterials.size(); i++)
+	{
+		int matIndex = definedMaterials[i];
+		bool loadTextures = !usedMaterials || usedMaterials->contains(matIndex);
+		materials->insert(matIndex, cMaterial(matIndex, params, quiet, loadTextures));
+	}
+}
+
+QList<int> ListOfDefinedMaterials(const cParameterContainer *params)
+{
+	QList<int> list;
 	QList<QString> listOfParameters = params->GetListOfParameters();
 	for (int i = 0; i < listOfParameters.size(); i++)
 	{
@@ -225,8 +270,29 @@ void CreateMaterialsMap(
 			QString shortName = parameterName.mid(positionOfDash + 1);
 			if (shortName == "is_defined")
 			{
-				materials->insert(matIndex, cMaterial(matIndex, params, quiet));
+				list.append(matIndex);
 			}
 		}
 	}
+	return list;
+}
+
+QSet<int> ListOfUsedMaterials(const cParameterContainer *params)
+{
+	QSet<int> usedMaterials;
+
+	// fractal formulas (single one or each in boolean mode)
+	usedMaterials.insert(params->Get<int>("formula_material_id"));
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+		usedMaterials.insert(params->Get<int>("formula_material_id", i + 1));
+
+	// primitives
+	QList<QString> listOfParameters = params->GetListOfParameters();
+	for (int i = 0; i < listOfParameters.size(); i++)
+	{
+		QString parameterName = listOfParameters.at(i);
+		if (parameterName.startsWith("primitive_") && parameterName.endsWith("_material_id"))
+			usedMaterials.insert(params->Get<int>(parameterName));
+	}
+	return usedMaterials;
 }
@@ -36,6 +36,7 @@
 #define MANDELBULBER2_SRC_MATERIAL_H_
 
 #include <QMap>
+#include <QSet>
 
 #include "color_palette.hpp"
 #include "color_structures.hpp"
@@ -50,9 +51,14 @@ class cMaterial
 {
 public:
 	cMaterial();
-	cMaterial(int _id, const cParameterContainer *materialParam, bool quiet);
+	cMaterial(
+		int _id, const cParameterContainer *materialParam, bool quiet, bool loadTextures = true);
 	~cMaterial();
-	void setParameters(int _id, const cParameterContainer *materialParam, bool quiet);
+	void setParameters(
+		int _id, const cParameterContainer *materialParam, bool quiet, bool loadTextures = true);
+	// textures which are loaded by setParameters() for given material
+	static void ListOfTextures(
+		int _id, const cParameterContainer *materialParam, QList<cTexture::sTextureRequest> *list);
 
 	static QString Name(const QString &name, int materialId)
 	{
@@ -112,7 +118,12 @@ public:
 	sFractalColoring fractalColoring;
 };
 
-void CreateMaterialsMap(
-	const cParameterContainer *params, QMap<int, cMaterial> *materials, bool quiet);
+// textures are loaded only for materials from usedMaterials (all materials if NULL)
+void CreateMaterialsMap(const cParameterContainer *params, QMap<int, cMaterial> *materials,
+	bool quiet, const QSet<int> *usedMaterials = NULL);
+// indexes of all defined materials
+QList<int> ListOfDefinedMaterials(const cParameterContainer *params);
+// materials assigned to fractal formulas and primitives
+QSet<int> ListOfUsedMaterials(const cParameterContainer *params);
 
 #endif /* MANDELBULBER2_SRC_MATERIAL_H_ */
@@ -159,8 +159,20 @@ void cMaterialItemView::rowsInserted(const QModelIndex &parent, int start, int e
 	{
 		cMaterialWidget *widget = new cMaterialWidget(this);
 		widget->setAutoFillBackground(true);
-		setIndexWidget(model()->index(r, 0, parent), widget);
+		QModelIndex index = model()->index(r, 0, parent);
+		setIndexWidget(index, widget);
+		widget->AssignMaterial(
+			model()->data(index).toString(), model()->data(index, Qt::UserRole).toInt());
 	}
+
+	// textures of all previews are decoded together and shared by their render jobs
+	QList<cTexture::sTextureRequest> requests;
+	for (int r = 0; r < model()->rowCount(parent); r++)
+	{
+		cMaterialWidget *widget = (cMaterialWidget *)indexWidget(model()->index(r, 0, parent));
+		if (widget) widget->ListOfTextures(&requests);
+	}
+	previewTextures = cTexture::LoadInParallel(requests);
 	QAbstractItemView::rowsInserted(parent, start, end);
 	// updateGeometries();
 
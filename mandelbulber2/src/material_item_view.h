@@ -40,6 +40,8 @@
 
 #include <qabstractitemview.h>
 
+#include "texture.hpp"
+
 class cMaterialItemView : public QAbstractItemView
 {
 	Q_OBJECT
@@ -68,6 +70,8 @@ private:
 	int viewHeight;
 	int iconMargin;
 	int maxNameHeight;
+	// keeps decoded textures of material previews in the texture cache
+	QList<cTexture> previewTextures;
 
 protected slots:
 	virtual void dataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
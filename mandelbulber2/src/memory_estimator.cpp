@@ -0,0 +1,218 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cMemoryEstimator class - estimation of memory needed by render job
+ */
+
+#include "memory_estimator.hpp"
+
+#include <QFile>
+#include <QImageReader>
+#include <QTextStream>
+
+#ifdef WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+
+#include "ao_modes.h"
+#include "material.h"
+#include "parameters.hpp"
+#include "texture.hpp"
+
+// bytes per pixel of temporary buffers of post effects (see dof.cpp, render_ssao.cpp, denoiser.cpp)
+#define MEMORY_DOF_SCATTER_PIXEL 30
+#define MEMORY_DOF_GATHER_PIXEL 36
+#define MEMORY_SSAO_PIXEL 6
+#define MEMORY_DENOISER_PIXEL 60
+
+sImageOptional cMemoryEstimator::ImageOptionalFromParams(const cParameterContainer *params)
+{
+	sImageOptional optional;
+	// normals are also a guide of the denoiser
+	optional.optionalNormal =
+		params->Get<bool>("normal_enabled") || params->Get<bool>("denoiser_enabled");
+	optional.optionalWorldPosition = params->Get<bool>("world_position_enabled");
+	optional.optionalObjectId = params->Get<bool>("object_id_enabled");
+	optional.optionalCost = params->Get<bool>("cost_enabled");
+	optional.optionalGBuffer = params->Get<bool>("relighting_mode");
+	optional.leanMemory = params->Get<bool>("image_lean_memory");
+	optional.halfFloat = params->Get<bool>("image_half_float");
+	optional.memoryMapped = params->Get<bool>("image_memory_mapped");
+	optional.scratchFolder = params->Get<QString>("image_scratch_folder");
+	return optional;
+}
+
+qint64 cMemoryEstimator::ImageBytes(int width, int height, const sImageOptional &optional)
+{
+	// the same buffers as allocated by cImage::AllocMem()
+	if (optional.memoryMapped) return 0; // buffers are backed by the scratch file
+
+	qint64 floatPixel = optional.halfFloat ? sizeof(sRGBhalf) : sizeof(sRGBfloat);
+	qint64 pixelSize = floatPixel + sizeof(sRGB16) + sizeof(float) + sizeof(unsigned short)
+										 + sizeof(unsigned short) + sizeof(sRGB8);
+	if (!optional.leanMemory) pixelSize += sizeof(sRGB8) + sizeof(unsigned char);
+	if (optional.optionalNormal)
+	{
+		pixelSize += floatPixel;
+		if (!optional.leanMemory) pixelSize += sizeof(sRGB16) + sizeof(sRGB8);
+	}
+	if (optional.optionalWorldPosition) pixelSize += sizeof(sRGBfloat);
+	if (optional.optionalObjectId) pixelSize += sizeof(float);
+	if (optional.optionalCost) pixelSize += sizeof(sRGBfloat);
+	if (optional.optionalGBuffer) pixelSize += sizeof(sGBufferPixel);
+	return pixelSize * width * height;
+}
+
+sMemoryEstimate cMemoryEstimator::EstimateJob(
+	const cParameterContainer *params, int width, int height, const sImageOptional &optional)
+{
+	sMemoryEstimate estimate;
+	qint64 pixels = qint64(width) * height;
+	estimate.image = ImageBytes(width, height, optional);
+
+	// post effects are rendered one after another, so only the biggest one counts
+	qint64 postEffects = 0;
+	if (params->Get<bool>("DOF_enabled") && !params->Get<bool>("DOF_monte_carlo"))
+	{
+		int pixelSize = params->Get<bool>("DOF_fast_gather") ? MEMORY_DOF_GATHER_PIXEL
+																												: MEMORY_DOF_SCATTER_PIXEL;
+		postEffects = qMax(postEffects, pixels * pixelSize);
+	}
+	if (params->Get<bool>("ambient_occlusion_enabled")
+			&& params->Get<int>("ambient_occlusion_mode") == params::AOmodeScreenSpace)
+		postEffects = qMax(postEffects, pixels * MEMORY_SSAO_PIXEL);
+	if (params->Get<bool>("denoiser_enabled"))
+		postEffects = qMax(postEffects, pixels * MEMORY_DENOISER_PIXEL);
+	estimate.postEffects = postEffects;
+
+	// textures are not decoded here, only sizes are read from file headers
+	QList<cTexture::sTextureRequest> requests;
+	cTexture::sTextureRequest request;
+	request.mode = cTexture::doNotUseMipmaps;
+	const char *flags[] = {"textured_background", "env_mapping_enable", "foveation_enabled"};
+	const char *files[] = {"file_background", "file_envmap", "file_foveation_map"};
+	for (int i = 0; i < 3; i++)
+	{
+		if (!params->Get<bool>(flags[i])) continue;
+		request.filename = params->Get<QString>(files[i]);
+		requests.append(request);
+	}
+	if (params->Get<bool>("ambient_occlusion_enabled")
+			&& params->Get<int>("ambient_occlusion_mode") == params::AOmodeMultipeRays)
+	{
+		request.filename = params->Get<QString>("file_lightmap");
+		requests.append(request);
+	}
+	// upper limit: all defined materials, also not used by any fractal
+	QList<int> definedMaterials = ListOfDefinedMaterials(params);
+	for (int i = 0; i < definedMaterials.size(); i++)
+		cMaterial::ListOfTextures(definedMaterials[i], params, &requests);
+
+	QStringList counted;
+	for (int i = 0; i < requests.size(); i++)
+	{
+		if (counted.contains(requests[i].filename)) continue;
+		counted.append(requests[i].filename);
+		QSize size = QImageReader(requests[i].filename).size();
+		if (!size.isValid()) continue;
+
+		// 16-bit bitmap and float mip levels (together 4/3 of texture size)
+		qint64 texels = qint64(size.width()) * size.height();
+		qint64 bytes = texels * sizeof(sRGBA16);
+		if (requests[i].mode == cTexture::useMipmaps) bytes += texels * 4 / 3 * sizeof(sRGBAfloat);
+		estimate.textures += bytes;
+	}
+
+	return estimate;
+}
+
+qint64 cMemoryEstimator::GetAvailableMemory()
+{
+#ifdef WIN32
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status)) return qint64(status.ullAvailPhys);
+	return -1;
+#elif defined(__APPLE__)
+	// free memory is not easy to get, so total physical memory is used
+	int64_t memory = 0;
+	size_t length = sizeof(memory);
+	if (sysctlbyname("hw.memsize", &memory, &length, NULL, 0) == 0) return qint64(memory);
+	return -1;
+#else
+	QFile file("/proc/meminfo");
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+	QTextStream stream(&file);
+	QString line;
+	while (!(line = stream.readLine()).isNull())
+	{
+		if (line.startsWith("MemAvailable:"))
+		{
+			QStringList fields = line.simplified().split(' ');
+			if (fields.size() >= 2) return fields[1].toLongLong() * 1024;
+		}
+	}
+	return -1;
+#endif
+}
+
+qint64 cMemoryEstimator::GetMemoryBudget(const cParameterContainer *params)
+{
+	int budgetMB = params->Get<int>("memory_budget_MB");
+	if (budgetMB > 0) return qint64(budgetMB) * 1024 * 1024;
+	return GetAvailableMemory();
+}
+
+bool cMemoryEstimator::FitToBudget(const cParameterContainer *params, int width, int height,
+	qint64 budget, sImageOptional *optional)
+{
+	if (budget < 0) return true;
+
+	for (int step = 0; step < 4; step++)
+	{
+		if (EstimateJob(params, width, height, *optional).Total() <= budget) return true;
+
+		// every step makes buffers more compact
+		switch (step)
+		{
+			case 0: optional->leanMemory = true; break;
+			case 1: optional->halfFloat = true; break;
+			case 2:
+				if (!optional->scratchFolder.isEmpty()) optional->memoryMapped = true;
+				break;
+			default: break;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,81 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cMemoryEstimator class - estimation of memory needed by render job
+ *
+ * Memory of image buffers, temporary buffers of post effects and decoded textures
+ * is calculated from settings before anything is allocated. Render job uses it to
+ * switch image buffers to more compact formats when the job doesn't fit in the
+ * memory budget, queue uses it to not start concurrent jobs which would exceed it
+ * and NetRender server to not send animation frames to clients without enough memory.
+ */
+
+#ifndef MANDELBULBER2_SRC_MEMORY_ESTIMATOR_HPP_
+#define MANDELBULBER2_SRC_MEMORY_ESTIMATOR_HPP_
+
+#include <QtGlobal>
+
+#include "cimage.hpp"
+
+// forward declarations
+class cParameterContainer;
+
+struct sMemoryEstimate
+{
+	sMemoryEstimate() : image(0), postEffects(0), textures(0) {}
+	qint64 Total() const { return image + postEffects + textures; }
+
+	qint64 image; // buffers of cImage kept in RAM
+	qint64 postEffects; // temporary buffers of DOF, SSAO and denoiser
+	qint64 textures; // decoded textures with mipmaps
+};
+
+class cMemoryEstimator
+{
+public:
+	// options of image buffers requested by settings
+	static sImageOptional ImageOptionalFromParams(const cParameterContainer *params);
+	// bytes of image buffers allocated in RAM by cImage with given options
+	static qint64 ImageBytes(int width, int height, const sImageOptional &optional);
+	// memory needed by render job of image with given size
+	static sMemoryEstimate EstimateJob(
+		const cParameterContainer *params, int width, int height, const sImageOptional &optional);
+	// physical memory which can be allocated without swapping [bytes] (-1 if unknown)
+	static qint64 GetAvailableMemory();
+	// limit of memory for render jobs from settings or available memory (-1 if not limited)
+	static qint64 GetMemoryBudget(const cParameterContainer *params);
+	// image is switched to lean, half precision and then memory mapped buffers until the job
+	// fits in the budget. Returns false if it doesn't fit even with the most compact buffers
+	static bool FitToBudget(const cParameterContainer *params, int width, int height,
+		qint64 budget, sImageOptional *optional);
+};
+
+#endif /* MANDELBULBER2_SRC_MEMORY_ESTIMATOR_HPP_ */
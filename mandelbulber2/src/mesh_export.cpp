@@ -33,8 +33,10 @@
  */
 
 #include "mesh_export.hpp"
+#include "adaptive_mesh.hpp"
 #include "calculate_distance.hpp"
 #include "common_math.h"
+#include "empty_space_map.hpp"
 #include "file_image.hpp"
 #include "fractparams.hpp"
 #include "fractal_container.hpp"
@@ -43,8 +45,13 @@
 #include "marchingcubes.h"
 #include "compute_fractal.hpp"
 
-cMeshExport::cMeshExport(
-	int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QString outputFileName, int maxIter)
+// size of buffer for writing of output file
+#define MESH_WRITE_BUFFER_SIZE (1 << 22)
+// vertex is stored as x, y, z, color index, normal x, y, z
+#define MESH_VERTEX_VALUES 7
+
+cMeshExport::cMeshExport(int w, int h, int l, CVector3 limitMin, CVector3 limitMax,
+	QString outputFileName, int maxIter, enumMeshFileFormat outputFormat)
 		: QObject()
 {
 	this->w = w;
@@ -54,6 +61,10 @@ cMeshExport::cMeshExport(
 	this->limitMax = limitMax;
 	this->outputFileName = outputFileName;
 	this->maxIter = maxIter;
+	this->outputFormat = outputFormat;
+	numberOfVertices = 0;
+	numberOfTriangles = 0;
+	maxColorIndex = 1.0;
 	stop = false;
 }
 
@@ -75,13 +86,18 @@ struct FormulaFtor
 	double dist_thresh;
 	cParamRender *params;
 	const cNineFractals *fractals;
+	cEmptySpaceMap *emptySpace;
+	bool *stop;
 
-	FormulaFtor(double dist_thresh, cParamRender *params, const cNineFractals *fractals)
+	FormulaFtor(double dist_thresh, cParamRender *params, const cNineFractals *fractals,
+		cEmptySpaceMap *emptySpace, bool *stop)
 	{
 
 		this->dist_thresh = dist_thresh;
 		this->params = params;
 		this->fractals = fractals;
+		this->emptySpace = emptySpace;
+		this->stop = stop;
 	}
 
 	double operator()(double x, double y, double z, double *colorIndex)
@@ -114,6 +130,176 @@ struct FormulaFtor
 
 		// return (double)(dist <= dist_thresh);
 	}
+
+	// calculates slab of points with the same x coordinate. Points far from the surface are not
+	// calculated, they get bound of the distance
+	void operator()(double x, const double *y, int numberOfY, const double *z, int numberOfZ,
+		double *values, double *colorIndices)
+	{
+		emptySpace->NextLayer();
+
+		for (int level = emptySpace->GetNumberOfLevels() - 1; level >= 0; level--)
+		{
+			QVector<int> indices = emptySpace->PointsToCalculate(level);
+
+			// points are calculated in batches
+			const int batchSize = 64;
+			int numberOfBatches = (indices.size() + batchSize - 1) / batchSize;
+
+#pragma omp parallel for schedule(dynamic, 1)
+			for (int batch = 0; batch < numberOfBatches; batch++)
+			{
+				if (*stop) continue;
+
+				CVector3 points[batchSize];
+				double detailSizes[batchSize];
+				double distances[batchSize];
+				sDistanceOut distanceOuts[batchSize];
+
+				int first = batch * batchSize;
+				int count = qMin(batchSize, indices.size() - first);
+				for (int i = 0; i < count; i++)
+				{
+					int index = indices[first + i];
+					points[i] = CVector3(x, y[index / numberOfZ], z[index % numberOfZ]);
+					detailSizes[i] = dist_thresh;
+				}
+
+				// colour index is calculated in the same pass as distance
+				CalculateDistanceAndColourBatch(
+					*params, *fractals, points, detailSizes, count, distances, distanceOuts);
+
+				for (int i = 0; i < count; i++)
+				{
+					int index = indices[first + i];
+					emptySpace->SetDistance(index, distances[i]);
+					values[index] = distances[i];
+					colorIndices[index] = distanceOuts[i].colorIndex;
+				}
+			}
+		}
+
+		for (int index = 0; index < numberOfY * numberOfZ; index++)
+		{
+			if (!emptySpace->IsCalculated(index))
+			{
+				values[index] = emptySpace->GetDistanceBound(index);
+				colorIndices[index] = 0.0;
+			}
+		}
+	}
+};
+
+// distance field for adaptive mesh. Space outside the limits is treated as empty, so the mesh
+// is closed at the limits
+class cMeshField : public cAdaptiveMesh::cField
+{
+public:
+	cMeshField(double dist_thresh, cParamRender *params, const cNineFractals *fractals,
+		CVector3 limitMin, CVector3 limitMax, bool *stop)
+	{
+		this->dist_thresh = dist_thresh;
+		this->params = params;
+		this->fractals = fractals;
+		this->limitMin = limitMin;
+		this->limitMax = limitMax;
+		this->stop = stop;
+	}
+
+	virtual void Evaluate(const CVector3 *points, int count, double *values, double *colorIndices)
+	{
+		const int batchSize = 64;
+		int numberOfBatches = (count + batchSize - 1) / batchSize;
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int batch = 0; batch < numberOfBatches; batch++)
+		{
+			if (*stop) continue;
+
+			double detailSizes[batchSize];
+			sDistanceOut distanceOuts[batchSize];
+
+			int first = batch * batchSize;
+			int batchCount = qMin(batchSize, count - first);
+			for (int i = 0; i < batchCount; i++)
+				detailSizes[i] = dist_thresh;
+
+			if (colorIndices)
+				CalculateDistanceAndColourBatch(*params, *fractals, points + first, detailSizes,
+					batchCount, values + first, distanceOuts);
+			else
+				CalculateDistanceBatch(*params, *fractals, points + first, detailSizes, batchCount,
+					values + first, distanceOuts);
+
+			for (int i = 0; i < batchCount; i++)
+			{
+				const CVector3 &point = points[first + i];
+				double boxDistance = dMax(qMax(limitMin.x - point.x, point.x - limitMax.x),
+					qMax(limitMin.y - point.y, point.y - limitMax.y),
+					qMax(limitMin.z - point.z, point.z - limitMax.z));
+				values[first + i] = qMax(values[first + i], dist_thresh + boxDistance);
+				if (colorIndices) colorIndices[first + i] = distanceOuts[i].colorIndex;
+			}
+		}
+	}
+
+private:
+	double dist_thresh;
+	cParamRender *params;
+	const cNineFractals *fractals;
+	CVector3 limitMin;
+	CVector3 limitMax;
+	bool *stop;
+};
+
+// vertices and triangles are streamed to temporary files, because their number is known only
+// after the whole volume is processed
+struct MeshWriterFtor
+{
+	QFile *vertexFile;
+	QFile *faceFile;
+	QByteArray vertexBuffer;
+	QByteArray faceBuffer;
+	size_t numberOfVertices;
+	size_t numberOfTriangles;
+	double maxColorIndex;
+
+	MeshWriterFtor(QFile *vertexFile, QFile *faceFile)
+	{
+		this->vertexFile = vertexFile;
+		this->faceFile = faceFile;
+		numberOfVertices = 0;
+		numberOfTriangles = 0;
+		maxColorIndex = -1.0;
+	}
+
+	size_t AddVertex(
+		double x, double y, double z, double colorIndex, double nx, double ny, double nz)
+	{
+		double vertex[MESH_VERTEX_VALUES] = {x, y, z, colorIndex, nx, ny, nz};
+		vertexBuffer.append(reinterpret_cast<const char *>(vertex), sizeof(vertex));
+		if (vertexBuffer.size() > bufferSize) Flush();
+		maxColorIndex = qMax(maxColorIndex, colorIndex);
+		return numberOfVertices++;
+	}
+
+	void AddTriangle(size_t index1, size_t index2, size_t index3)
+	{
+		qint32 triangle[] = {qint32(index1), qint32(index2), qint32(index3)};
+		faceBuffer.append(reinterpret_cast<const char *>(triangle), sizeof(triangle));
+		if (faceBuffer.size() > bufferSize) Flush();
+		numberOfTriangles++;
+	}
+
+	void Flush()
+	{
+		vertexFile->write(vertexBuffer);
+		vertexBuffer.clear();
+		faceFile->write(faceBuffer);
+		faceBuffer.clear();
+	}
+
+	static const int bufferSize = 1 << 20;
 };
 
 void cMeshExport::updateProgressAndStatus(int i)
@@ -143,108 +329,116 @@ void cMeshExport::ProcessVolume()
 
 	double lower[] = {limitMin.x, limitMin.y, limitMin.z};
 	double upper[] = {limitMax.x, limitMax.x, limitMax.z};
-	vector<double> vertices;
-	vector<size_t> polygons;
-	vector<double> colorIndices;
-
-	ProgressFtor progressFtor(this);
-	FormulaFtor formulaFtor(dist_thresh, params.data(), fractals.data());
-
-	qDebug() << "Starting marching cubes...";
-
-	mc::marching_cubes<double, double[3], FormulaFtor, ProgressFtor>(lower, upper, w, h, l,
-		formulaFtor, dist_thresh, vertices, polygons, &stop, progressFtor, colorIndices);
-
-	qDebug() << "Marching cubes done.";
-
-	double maxColorIndex = -1.0;
-	for (unsigned int i = 0; i < colorIndices.size(); i++)
-	{
-		maxColorIndex = qMax(maxColorIndex, colorIndices[i]);
-	}
-	for (unsigned int i = 0; i < colorIndices.size(); i++)
-	{
-		colorIndices[i] /= maxColorIndex;
-	}
-
-	qDebug() << "Opening..." << outputFileName;
 
+	QTemporaryFile vertexFile(outputFileName + ".vertices");
+	QTemporaryFile faceFile(outputFileName + ".faces");
 	QFile f(outputFileName);
-	if (!f.open(QFile::WriteOnly))
+	if (!vertexFile.open() || !faceFile.open() || !f.open(QFile::WriteOnly))
 	{
 		QString statusText = tr("Mesh Export - Failed to open output file!");
 		emit updateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
 		emit finished();
 		return;
 	}
-	f.write(QString("ply\n").toLatin1());
-	f.write(QString("format ascii 1.0\n").toLatin1());
-	f.write(QString("comment Mandelbulber Exported Mesh\n").toLatin1());
-	f.write(QString("element vertex %1\n").arg(vertices.size() / 3).toLatin1());
-	f.write(QString("property float x\n").toLatin1());
-	f.write(QString("property float y\n").toLatin1());
-	f.write(QString("property float z\n").toLatin1());
-	f.write(QString("property float s\n").toLatin1());
-	f.write(QString("property float t\n").toLatin1());
-	// f.write(QString("property float red\n").toLatin1());
-	// f.write(QString("property float green\n").toLatin1());
-	// f.write(QString("property float blue\n").toLatin1());
-	f.write(QString("element face %1\n").arg(polygons.size() / 3).toLatin1());
-	f.write(QString("property list uchar int vertex_indices\n").toLatin1());
-	// f.write(QString("property list uchar float texcoord\n").toLatin1());
-	f.write(QString("end_header\n").toLatin1());
-	for (unsigned int i = 0; i < vertices.size() / 3; i++)
-	{
 
-		// float v[] = {(float) vertices[i * 3], (float) vertices[i * 3 + 1],
-		//(float) vertices[i * 3 + 2]};
+	MeshWriterFtor meshWriter(&vertexFile, &faceFile);
 
-		// f.write((char*) &v[0], sizeof(float) * 3);
-		f.write(QString("%1 %2 %3 ")
-							.arg(vertices[i * 3])
-							.arg(vertices[i * 3 + 1])
-							.arg(vertices[i * 3 + 2])
-							.toLatin1());
-		f.write(QString("%1 %1\n").arg(colorIndices[i]).toLatin1());
+	if (gPar->Get<bool>("mesh_adaptive"))
+	{
+		// the finest cells of octree are as small as the smallest step of the grid
+		CVector3 extent = limitMax - limitMin;
+		double cellSize = dMin(extent.x / (w - 1), extent.y / (h - 1), extent.z / (l - 1));
+		int maxDepth = qMax(1, int(ceil(log2(dMax(extent.x, extent.y, extent.z) / cellSize))));
 
-		/* double colorIndex = colorIndices[i];
-		int nrCol = floor(colorIndex);
-		nrCol = abs(nrCol) % (248 * 256);
+		cMeshField field(dist_thresh, params.data(), fractals.data(), limitMin, limitMax, &stop);
+		cAdaptiveMesh adaptiveMesh(limitMin, cellSize, maxDepth, dist_thresh,
+			qMin(1.0, params->DEFactor), gPar->Get<double>("mesh_adaptive_tolerance"));
 
+		qDebug() << "Starting adaptive mesh extraction...";
 
-		int color_number;
-		if (nrCol >= 248 * 256)
+		while (!stop)
 		{
-						color_number = nrCol;
+			int level = adaptiveMesh.GetCurrentLevel();
+			QString statusText =
+				" - " + tr("Processing octree level %1 of %2").arg(level + 1).arg(maxDepth + 1);
+			double percentDone = double(level) / (maxDepth + 1);
+			emit updateProgressAndStatus(
+				tr("Mesh Export") + statusText, progressText.getText(percentDone), percentDone);
+
+			if (!adaptiveMesh.BuildNextLevel(&field)) break;
 		}
-		else
+		adaptiveMesh.Contour();
+
+		const QVector<CVector3> &meshVertices = adaptiveMesh.GetVertices();
+		const QVector<double> &meshColorIndices = adaptiveMesh.GetColorIndices();
+		const QVector<CVector3> &meshNormals = adaptiveMesh.GetNormals();
+		const QVector<qint32> &meshTriangles = adaptiveMesh.GetTriangles();
+		for (int i = 0; i < meshVertices.size(); i++)
 		{
-						color_number =
-										(int)(nrCol * input.material->coloring_speed + 256 *
-		input.material->paletteOffset)
-										% 65536;
+			const CVector3 &v = meshVertices[i];
+			const CVector3 &n = meshNormals[i];
+			meshWriter.AddVertex(v.x, v.y, v.z, meshColorIndices[i], n.x, n.y, n.z);
 		}
-		colour = input.material->palette.IndexToColour(color_number);
+		for (int i = 0; i < meshTriangles.size(); i += 3)
+			meshWriter.AddTriangle(meshTriangles[i], meshTriangles[i + 1], meshTriangles[i + 2]);
+		meshWriter.Flush();
 
+		qDebug() << "Adaptive mesh done. Vertices:" << meshVertices.size()
+						 << "triangles:" << meshTriangles.size() / 3;
+	}
+	else
+	{
+		ProgressFtor progressFtor(this);
+		// grid of marching cubes has first and last points at the limits
+		double gridStepX = (upper[0] - lower[0]) / (w - 1);
+		double gridStepY = (upper[1] - lower[1]) / (h - 1);
+		double gridStepZ = (upper[2] - lower[2]) / (l - 1);
 
-		uchar rgb[3] = {color, color, color};
-		f.write((char*) &rgb[0], sizeof(char) * 3); */
+		// values of points which are not calculated don't matter if none of the neighbouring cubes
+		// crosses the surface
+		double skipDistance =
+			dist_thresh + sqrt(gridStepX * gridStepX + gridStepY * gridStepY + gridStepZ * gridStepZ);
+		cEmptySpaceMap emptySpace(
+			l, h, gridStepZ, gridStepY, gridStepX, qMin(1.0, params->DEFactor), skipDistance);
+
+		FormulaFtor formulaFtor(dist_thresh, params.data(), fractals.data(), &emptySpace, &stop);
+
+		qDebug() << "Starting marching cubes...";
+
+		mc::marching_cubes_streaming<double, double[3], FormulaFtor, ProgressFtor, MeshWriterFtor>(
+			lower, upper, w, h, l, formulaFtor, dist_thresh, &stop, progressFtor, meshWriter);
+		meshWriter.Flush();
+
+		qDebug() << "Marching cubes done. Calculated points:" << emptySpace.GetNumberOfCalculated()
+						 << "skipped points:" << emptySpace.GetNumberOfSkipped();
 	}
-	for (unsigned int i = 0; i < polygons.size(); i += 3)
+
+	qDebug() << "Writing..." << outputFileName;
+
+	numberOfVertices = meshWriter.numberOfVertices;
+	numberOfTriangles = meshWriter.numberOfTriangles;
+	maxColorIndex = meshWriter.maxColorIndex;
+
+	// temporary files are mapped to memory, so writers can access vertices in any order
+	const double *vertices = NULL;
+	const qint32 *triangles = NULL;
+	if (numberOfVertices > 0)
+		vertices = reinterpret_cast<const double *>(vertexFile.map(0, vertexFile.size()));
+	if (numberOfTriangles > 0)
+		triangles = reinterpret_cast<const qint32 *>(faceFile.map(0, faceFile.size()));
+	if ((numberOfVertices > 0 && !vertices) || (numberOfTriangles > 0 && !triangles))
 	{
-		// uchar n = 3;
-		// int p[] = {polygons[i], polygons[i + 1], polygons[i + 2]};
-		// f.write((char*) &n, sizeof(uchar));
-		// f.write((char*) &polygons[i], 3 * sizeof(int));
-
-		f.write(QString("3 %1 %2 %3\n")
-							.arg(polygons[i])
-							.arg(polygons[i + 1])
-							.arg(polygons[i + 2])
-							.toLatin1());
-
-		// f.write(QString("6 %1 %1 %2 %2 %3 %3\n").arg(colorIndices[polygons[i]])
-		// .arg(colorIndices[polygons[i + 1]]).arg(colorIndices[polygons[i + 2]]).toLatin1());
+		qCritical() << "cMeshExport::ProcessVolume(): cannot map temporary files";
+		numberOfVertices = 0;
+		numberOfTriangles = 0;
+	}
+
+	switch (outputFormat)
+	{
+		case meshFormatPlyText: WritePlyText(&f, vertices, triangles); break;
+		case meshFormatPlyBinary: WritePlyBinary(&f, vertices, triangles); break;
+		case meshFormatStlBinary: WriteStlBinary(&f, vertices, triangles); break;
+		case meshFormatObjText: WriteObjText(&f, vertices, triangles); break;
 	}
 	f.close();
 
@@ -256,3 +450,196 @@ void cMeshExport::ProcessVolume()
 	emit updateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
 	emit finished();
 }
+
+void cMeshExport::WritePlyText(QFile *f, const double *vertices, const qint32 *triangles)
+{
+	QByteArray buffer;
+	buffer.append("ply\n");
+	buffer.append("format ascii 1.0\n");
+	buffer.append("comment Mandelbulber Exported Mesh\n");
+	buffer.append(QString("element vertex %1\n").arg(numberOfVertices).toLatin1());
+	buffer.append("property float x\n");
+	buffer.append("property float y\n");
+	buffer.append("property float z\n");
+	buffer.append("property float nx\n");
+	buffer.append("property float ny\n");
+	buffer.append("property float nz\n");
+	buffer.append("property float s\n");
+	buffer.append("property float t\n");
+	buffer.append(QString("element face %1\n").arg(numberOfTriangles).toLatin1());
+	buffer.append("property list uchar int vertex_indices\n");
+	buffer.append("end_header\n");
+
+	for (qint64 i = 0; i < numberOfVertices; i++)
+	{
+		const double *vertex = &vertices[i * MESH_VERTEX_VALUES];
+		buffer.append(QString("%1 %2 %3 ").arg(vertex[0]).arg(vertex[1]).arg(vertex[2]).toLatin1());
+		buffer.append(QString("%1 %2 %3 ").arg(vertex[4]).arg(vertex[5]).arg(vertex[6]).toLatin1());
+		buffer.append(QString("%1 %1\n").arg(vertex[3] / maxColorIndex).toLatin1());
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+		}
+	}
+	for (qint64 i = 0; i < numberOfTriangles; i++)
+	{
+		const qint32 *triangle = &triangles[i * 3];
+		buffer.append(
+			QString("3 %1 %2 %3\n").arg(triangle[0]).arg(triangle[1]).arg(triangle[2]).toLatin1());
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+		}
+	}
+	f->write(buffer);
+}
+
+void cMeshExport::WritePlyBinary(QFile *f, const double *vertices, const qint32 *triangles)
+{
+	QByteArray buffer;
+	buffer.append("ply\n");
+	buffer.append("format binary_little_endian 1.0\n");
+	buffer.append("comment Mandelbulber Exported Mesh\n");
+	buffer.append(QString("element vertex %1\n").arg(numberOfVertices).toLatin1());
+	buffer.append("property float x\n");
+	buffer.append("property float y\n");
+	buffer.append("property float z\n");
+	buffer.append("property float nx\n");
+	buffer.append("property float ny\n");
+	buffer.append("property float nz\n");
+	buffer.append("property float s\n");
+	buffer.append("property float t\n");
+	buffer.append(QString("element face %1\n").arg(numberOfTriangles).toLatin1());
+	buffer.append("property list uchar int vertex_indices\n");
+	buffer.append("end_header\n");
+
+	QDataStream stream(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+	for (qint64 i = 0; i < numberOfVertices; i++)
+	{
+		const double *vertex = &vertices[i * MESH_VERTEX_VALUES];
+		double colorIndex = vertex[3] / maxColorIndex;
+		stream << vertex[0] << vertex[1] << vertex[2];
+		stream << vertex[4] << vertex[5] << vertex[6];
+		stream << colorIndex << colorIndex;
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+			stream.device()->seek(0);
+		}
+	}
+	for (qint64 i = 0; i < numberOfTriangles; i++)
+	{
+		const qint32 *triangle = &triangles[i * 3];
+		stream << quint8(3) << triangle[0] << triangle[1] << triangle[2];
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+			stream.device()->seek(0);
+		}
+	}
+	f->write(buffer);
+}
+
+void cMeshExport::WriteStlBinary(QFile *f, const double *vertices, const qint32 *triangles)
+{
+	QByteArray buffer;
+	QByteArray header("Mandelbulber Exported Mesh");
+	header.append(QByteArray(80 - header.size(), ' '));
+	buffer.append(header);
+
+	QDataStream stream(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+	stream << quint32(numberOfTriangles);
+
+	for (qint64 i = 0; i < numberOfTriangles; i++)
+	{
+		const qint32 *triangle = &triangles[i * 3];
+		CVector3 corners[3];
+		for (int c = 0; c < 3; c++)
+		{
+			const double *vertex = &vertices[qint64(triangle[c]) * MESH_VERTEX_VALUES];
+			corners[c] = CVector3(vertex[0], vertex[1], vertex[2]);
+		}
+		CVector3 normal = (corners[1] - corners[0]).Cross(corners[2] - corners[0]);
+		double length = normal.Length();
+		if (length > 0.0) normal /= length;
+
+		stream << normal.x << normal.y << normal.z;
+		for (int c = 0; c < 3; c++)
+			stream << corners[c].x << corners[c].y << corners[c].z;
+		stream << quint16(0);
+
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+			stream.device()->seek(0);
+		}
+	}
+	f->write(buffer);
+}
+
+void cMeshExport::WriteObjText(QFile *f, const double *vertices, const qint32 *triangles)
+{
+	// color index is stored as texture coordinates. Every vertex has own normal
+	QByteArray buffer;
+	buffer.append("# Mandelbulber Exported Mesh\n");
+	for (qint64 i = 0; i < numberOfVertices; i++)
+	{
+		const double *vertex = &vertices[i * MESH_VERTEX_VALUES];
+		QByteArray colorIndex = QByteArray::number(vertex[3] / maxColorIndex);
+		buffer.append("v ");
+		buffer.append(QByteArray::number(vertex[0]));
+		buffer.append(' ');
+		buffer.append(QByteArray::number(vertex[1]));
+		buffer.append(' ');
+		buffer.append(QByteArray::number(vertex[2]));
+		buffer.append("\nvn ");
+		buffer.append(QByteArray::number(vertex[4]));
+		buffer.append(' ');
+		buffer.append(QByteArray::number(vertex[5]));
+		buffer.append(' ');
+		buffer.append(QByteArray::number(vertex[6]));
+		buffer.append("\nvt ");
+		buffer.append(colorIndex);
+		buffer.append(' ');
+		buffer.append(colorIndex);
+		buffer.append('\n');
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+		}
+	}
+	for (qint64 i = 0; i < numberOfTriangles; i++)
+	{
+		const qint32 *triangle = &triangles[i * 3];
+		buffer.append('f');
+		for (int c = 0; c < 3; c++)
+		{
+			// indices in OBJ files start from 1
+			QByteArray index = QByteArray::number(triangle[c] + 1);
+			buffer.append(' ');
+			buffer.append(index);
+			buffer.append('/');
+			buffer.append(index);
+			buffer.append('/');
+			buffer.append(index);
+		}
+		buffer.append('\n');
+		if (buffer.size() > MESH_WRITE_BUFFER_SIZE)
+		{
+			f->write(buffer);
+			buffer.clear();
+		}
+	}
+	f->write(buffer);
+}
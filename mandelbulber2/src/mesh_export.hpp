@@ -44,8 +44,16 @@ class cMeshExport : public QObject
 	Q_OBJECT
 
 public:
-	cMeshExport(
-		int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QString outputFileName, int maxIter);
+	enum enumMeshFileFormat
+	{
+		meshFormatPlyText = 0,
+		meshFormatPlyBinary = 1,
+		meshFormatStlBinary = 2,
+		meshFormatObjText = 3
+	};
+
+	cMeshExport(int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QString outputFileName,
+		int maxIter, enumMeshFileFormat outputFormat = meshFormatPlyText);
 	~cMeshExport();
 
 	void updateProgressAndStatus(int i);
@@ -59,11 +67,22 @@ public slots:
 	void ProcessVolume();
 
 private:
+	// vertices are stored as x, y, z, color index, normal x, y, z (double), triangles as three
+	// indices (qint32)
+	void WritePlyText(QFile *f, const double *vertices, const qint32 *triangles);
+	void WritePlyBinary(QFile *f, const double *vertices, const qint32 *triangles);
+	void WriteStlBinary(QFile *f, const double *vertices, const qint32 *triangles);
+	void WriteObjText(QFile *f, const double *vertices, const qint32 *triangles);
+
 	int w, h, l;
 	CVector3 limitMin;
 	CVector3 limitMax;
 	QString outputFileName;
 	int maxIter;
+	enumMeshFileFormat outputFormat;
+	qint64 numberOfVertices;
+	qint64 numberOfTriangles;
+	double maxColorIndex;
 	bool stop;
 	cProgressText progressText;
 };
@@ -331,3 +331,43 @@ bool cMultiVal::operator==(const cMultiVal &m) const
 {
 	return isEqual(m);
 }
+
+quint64 cMultiVal::HashBytes(const void *data, int size, quint64 seed)
+{
+	const uchar *bytes = (const uchar *)data;
+	quint64 hash = seed ^ 14695981039346656037ULL;
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// the same fields are hashed as compared by isEqual()
+quint64 cMultiVal::GetHash(quint64 seed) const
+{
+	quint64 hash = HashBytes(&type, sizeof(type), seed);
+	switch (type)
+	{
+		case typeBool:
+		case typeInt:
+		case typeRgb: hash = HashBytes(iVal, sizeof(iVal), hash); break;
+		case typeDouble:
+		case typeVector3:
+		case typeVector4:
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				// -0.0 is equal to 0.0
+				double value = dVal[i] + 0.0;
+				hash = HashBytes(&value, sizeof(value), hash);
+			}
+			break;
+		}
+		case typeColorPalette:
+		case typeString: hash = HashBytes(sVal.constData(), sVal.size() * sizeof(QChar), hash); break;
+		case typeNull: break;
+	}
+	return hash;
+}
@@ -82,6 +82,10 @@ public:
 	enumVarType Get(cColorPalette &val) const;
 	enumVarType GetDefaultype(void) const { return type; }
 	bool operator==(const cMultiVal &m) const;
+	// hash of the value, equal for values which are equal by operator==
+	quint64 GetHash(quint64 seed) const;
+	// 64-bit FNV-1a hash, stable between program runs and platforms with the same byte order
+	static quint64 HashBytes(const void *data, int size, quint64 seed);
 
 private:
 	QString MakePaletteString(cColorPalette &palette);
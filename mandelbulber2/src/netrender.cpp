@@ -39,12 +39,15 @@
 #include "headless.h"
 #include "initparameters.hpp"
 #include "interface.hpp"
+#include "memory_estimator.hpp"
+#include "netrender_multicast.hpp"
 #include "settings.hpp"
 #include "system.hpp"
 #include <QAbstractSocket>
 #include <QHostInfo>
 #include "render_window.hpp"
 #include "texture.hpp"
+#include "trace.hpp"
 
 CNetRender *gNetRender = NULL;
 
@@ -58,10 +61,30 @@ CNetRender::CNetRender(qint32 workerCount) : QObject(NULL)
 	portNo = 0;
 	status = netRender_NEW;
 	reconnectTimer = NULL;
+	heartbeatTimer = NULL;
 	actualId = 0;
 	totalReceivedUncompressed = 0;
 	totalReceived = 0;
 	isUsed = false;
+	frameJobIndex = -1;
+	frameJobImageType = ImageFileSave::IMAGE_FILE_TYPE_PNG;
+	frameDistribution = false;
+	slabDistribution = false;
+	nextJobPending = false;
+	nextJobId = 0;
+	nextJobSent = false;
+	relayConnected = false;
+	relayAcksPending = 0;
+	relayFrameClient = NULL;
+	relaySlabClient = NULL;
+
+	multicast = new cNetRenderMulticast(this);
+	connect(multicast, SIGNAL(TextureReceived(QByteArray, QByteArray)), this,
+		SLOT(MulticastTextureReceived(QByteArray, QByteArray)));
+	multicastWaitTimer = new QTimer(this);
+	multicastWaitTimer->setSingleShot(true);
+	multicastWaitTimer->setInterval(NETRENDER_MULTICAST_TIMEOUT);
+	connect(multicastWaitTimer, SIGNAL(timeout()), this, SLOT(RequestMissingTextures()));
 }
 
 CNetRender::~CNetRender()
@@ -102,6 +125,18 @@ void CNetRender::SetServer(qint32 portNo)
 		deviceType = netRender_SERVER;
 		WriteLog("NetRender - Server Setup on localhost, port: " + QString::number(portNo), 2);
 
+		heartbeatTimer = new QTimer;
+		heartbeatTimer->setInterval(NETRENDER_HEARTBEAT_INTERVAL);
+		connect(heartbeatTimer, SIGNAL(timeout()), this, SLOT(CheckClients()));
+		heartbeatTimer->start();
+		lastHeartbeat.start();
+
+		if (gPar && gPar->Get<bool>("netrender_multicast"))
+		{
+			multicast->StartSender(QHostAddress(gPar->Get<QString>("netrender_multicast_group")),
+				gPar->Get<int>("netrender_multicast_port"), gPar->Get<int>("netrender_multicast_rate"));
+		}
+
 		if (systemData.noGui)
 		{
 			QTextStream out(stdout);
@@ -115,7 +150,8 @@ void CNetRender::SetServer(qint32 portNo)
 
 void CNetRender::DeleteServer()
 {
-	if (deviceType != netRender_SERVER) return;
+	if (deviceType != netRender_SERVER && deviceType != netRender_RELAY) return;
+	if (deviceType == netRender_RELAY) DisconnectFromServer();
 
 	deviceType = netRender_UNKNOWN;
 	WriteLog("NetRender - Delete Server", 2);
@@ -125,7 +161,17 @@ void CNetRender::DeleteServer()
 		delete server;
 		server = NULL;
 	}
+	if (heartbeatTimer)
+	{
+		heartbeatTimer->stop();
+		delete heartbeatTimer;
+		heartbeatTimer = NULL;
+	}
 	clients.clear();
+	multicast->Stop();
+	nextJobSent = false;
+	nextJobLineNumbers.clear();
+	nextJobLines.clear();
 	emit ClientsChanged();
 	status = netRender_DISABLED;
 	emit NewStatusServer();
@@ -136,18 +182,10 @@ void CNetRender::DeleteClient()
 	if (deviceType != netRender_CLIENT) return;
 	deviceType = netRender_UNKNOWN;
 	WriteLog("NetRender - Delete Client", 2);
-	if (reconnectTimer)
-	{
-		if (reconnectTimer->isActive()) reconnectTimer->stop();
-		delete reconnectTimer;
-		reconnectTimer = NULL;
-	}
-	if (clientSocket)
-	{
-		clientSocket->close();
-		delete clientSocket;
-		clientSocket = NULL;
-	}
+	DisconnectFromServer();
+	multicast->Stop();
+	multicastWaitTimer->stop();
+	nextJobPending = false;
 	status = netRender_DISABLED;
 	emit NotifyStatus();
 }
@@ -162,6 +200,38 @@ int CNetRender::getTotalWorkerCount()
 	return totalCount;
 }
 
+double CNetRender::GetRelativeWorkerSpeed(qint32 index)
+{
+	// average speed of one CPU of clients which were already measured
+	double totalSpeed = 0.0;
+	int measuredWorkers = 0;
+	for (int i = 0; i < clients.count(); i++)
+	{
+		if (clients[i].linesPerSecond > 0.0 && clients[i].clientWorkerCount > 0)
+		{
+			totalSpeed += clients[i].linesPerSecond;
+			measuredWorkers += clients[i].clientWorkerCount;
+		}
+	}
+
+	const sClient &client = clients[index];
+	if (client.status == netRender_ERROR) return 0.0;
+	if (measuredWorkers == 0 || client.linesPerSecond <= 0.0 || client.clientWorkerCount <= 0)
+		return client.reliability;
+	return (client.linesPerSecond / client.clientWorkerCount) / (totalSpeed / measuredWorkers)
+				 * client.reliability;
+}
+
+void CNetRender::DecreaseReliability(int index)
+{
+	clients[index].reliability *= NETRENDER_RELIABILITY_LOSS;
+	clientReliability.insert(clients[index].name, clients[index].reliability);
+	WriteLog(QString("NetRender - reliability of client %1 decreased to %2")
+						 .arg(clients[index].name)
+						 .arg(clients[index].reliability),
+		2);
+}
+
 void CNetRender::HandleNewConnection()
 {
 	while (server->hasPendingConnections())
@@ -170,6 +240,7 @@ void CNetRender::HandleNewConnection()
 		// push new socket to list
 		sClient client;
 		client.socket = server->nextPendingConnection();
+		client.lastActivity.start();
 		clients.append(client);
 
 		connect(client.socket, SIGNAL(disconnected()), this, SLOT(ClientDisconnected()));
@@ -196,8 +267,43 @@ void CNetRender::ClientDisconnected()
 			2);
 		if (index > -1)
 		{
+			if (clients[index].status == netRender_WORKING) DecreaseReliability(index);
 			clients.removeAt(index);
 		}
+
+		if (IsRelay())
+		{
+			// answers for the lost client are not forwarded
+			for (int i = 0; i < relayTextureRequests.size(); i++)
+				if (relayTextureRequests[i] == socket) relayTextureRequests[i] = NULL;
+
+			// server will render the frame again
+			if (relayFrameClient == socket)
+			{
+				relayFrameClient = NULL;
+				sMessage msg;
+				msg.command = netRender_FRAME_DATA;
+				QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+				stream << (qint32)frameJobIndex;
+				stream << (qint32)0;
+				SendData(clientSocket, msg);
+				frameJobIndex = -1;
+			}
+
+			// server will calculate the slab again
+			if (relaySlabClient == socket)
+			{
+				relaySlabClient = NULL;
+				sMessage msg;
+				msg.command = netRender_VOXEL_DATA;
+				QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+				stream << (qint32)slabJob.index;
+				SendData(clientSocket, msg);
+				slabJob = sVoxelSlabJob();
+			}
+			SendRelayWorkers();
+			UpdateRelayStatus();
+		}
 		socket->close();
 		socket->deleteLater();
 		emit ClientsChanged();
@@ -224,7 +330,12 @@ void CNetRender::ReceiveFromClient()
 	if (index != -1)
 	{
 		WriteLog("NetRender - ReceiveFromClient()", 3);
+		clients[index].lastActivity.restart();
+		qint64 bytesAvailable = socket->bytesAvailable();
 		ReceiveData(socket, &clients[index].msg);
+		// client could be removed while the message was processed
+		index = GetClientIndexFromSocket(socket);
+		if (index != -1) clients[index].bytesReceived += bytesAvailable - socket->bytesAvailable();
 	}
 }
 
@@ -233,6 +344,57 @@ void CNetRender::SetClient(QString address, int portNo)
 	DeleteServer();
 	deviceType = netRender_CLIENT;
 	status = netRender_NEW;
+	ConnectToServer(address, portNo);
+	if (gPar && gPar->Get<bool>("netrender_multicast"))
+	{
+		multicast->StartReceiver(QHostAddress(gPar->Get<QString>("netrender_multicast_group")),
+			gPar->Get<int>("netrender_multicast_port"));
+	}
+	WriteLog(
+		"NetRender - Client Setup, link to server: " + address + ", port: " + QString::number(portNo),
+		2);
+	emit NotifyStatus();
+
+	if (systemData.noGui)
+	{
+		QTextStream out(stdout);
+		out << "NetRender - Client Setup, link to server: " + address + ", port: "
+						 + QString::number(portNo) + "\n";
+	}
+}
+
+void CNetRender::SetRelay(QString address, qint32 portNo, qint32 localPortNo)
+{
+	// relay accepts clients in the same way as server
+	SetServer(localPortNo);
+	if (!IsServer()) return;
+	// relay doesn't have texture files, so textures are forwarded over TCP
+	multicast->Stop();
+
+	deviceType = netRender_RELAY;
+	relayConnected = false;
+	relayData.clear();
+	relayAcksPending = 0;
+	relayTextureRequests.clear();
+	relayFrameClient = NULL;
+	relaySlabClient = NULL;
+	frameJobIndex = -1;
+	slabJob = sVoxelSlabJob();
+	ConnectToServer(address, portNo);
+	WriteLog("NetRender - Relay Setup, link to server: " + address + ", port: "
+						 + QString::number(portNo) + ", local port: " + QString::number(localPortNo),
+		2);
+
+	if (systemData.noGui)
+	{
+		QTextStream out(stdout);
+		out << "NetRender - Relay Setup, link to server: " + address + ", port: "
+						 + QString::number(portNo) + ", local port: " + QString::number(localPortNo) + "\n";
+	}
+}
+
+void CNetRender::ConnectToServer(QString address, qint32 portNo)
+{
 	this->address = address;
 	this->portNo = portNo;
 	ResetMessage(&msgFromServer);
@@ -246,22 +408,35 @@ void CNetRender::SetClient(QString address, int portNo)
 
 	reconnectTimer->start();
 	QTimer::singleShot(50, this, SLOT(TryServerConnect()));
-	WriteLog(
-		"NetRender - Client Setup, link to server: " + address + ", port: " + QString::number(portNo),
-		2);
-	emit NotifyStatus();
+}
 
-	if (systemData.noGui)
+void CNetRender::DisconnectFromServer()
+{
+	if (reconnectTimer)
 	{
-		QTextStream out(stdout);
-		out << "NetRender - Client Setup, link to server: " + address + ", port: "
-						 + QString::number(portNo) + "\n";
+		if (reconnectTimer->isActive()) reconnectTimer->stop();
+		delete reconnectTimer;
+		reconnectTimer = NULL;
+	}
+	if (clientSocket)
+	{
+		clientSocket->close();
+		delete clientSocket;
+		clientSocket = NULL;
 	}
 }
 
 void CNetRender::ServerDisconnected()
 {
-	if (deviceType != netRender_CLIENT) return;
+	if (deviceType != netRender_CLIENT && deviceType != netRender_RELAY) return;
+	if (IsRelay())
+	{
+		// clients of relay can't send results anywhere
+		relayConnected = false;
+		relayData.clear();
+		relayAcksPending = 0;
+		Stop();
+	}
 	status = netRender_ERROR;
 	emit NotifyStatus();
 
@@ -325,13 +500,14 @@ bool CNetRender::SendData(QTcpSocket *socket, sMessage msg)
 	QDataStream socketWriteStream(&byteArray, QIODevice::ReadWrite);
 
 	msg.size = msg.payload.size();
-	msg.id = actualId;
+	if (msg.id == 0) msg.id = actualId;
 
 	WriteLog(QString("NetRender - send data, command %1, bytes %2, id %3")
 						 .arg(msg.command)
 						 .arg(msg.size)
 						 .arg(msg.id),
 		3);
+	TRACE_INSTANT("NetRender send", "netrender", "command", msg.command);
 
 	// append header
 	socketWriteStream << msg.command << msg.id << msg.size;
@@ -349,6 +525,9 @@ bool CNetRender::SendData(QTcpSocket *socket, sMessage msg)
 	socket->write(byteArray);
 	// socket->waitForBytesWritten();
 
+	int index = GetClientIndexFromSocket(socket);
+	if (index != -1) clients[index].bytesSent += byteArray.size();
+
 	return true;
 }
 
@@ -432,6 +611,8 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 	// beware: payload points to char, first cast to target type pointer, then dereference
 	// *(qint32*)msg->payload
 
+	TRACE_SCOPE_ARG("NetRender ProcessData", "netrender", "command", inMsg->command);
+
 	//------------------------- CLIENT ------------------------
 	if (IsClient())
 	{
@@ -462,6 +643,8 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 					QString machineName = QHostInfo::localHostName();
 					stream << (qint32)machineName.toUtf8().size();
 					stream.writeRawData(machineName.toUtf8().data(), machineName.toUtf8().size());
+					// lets the server skip frames which wouldn't fit
+					stream << cMemoryEstimator::GetMemoryBudget(gPar);
 					status = netRender_READY;
 					emit NewStatusClient();
 					WriteLog(
@@ -482,10 +665,23 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 			}
 			case netRender_STOP:
 			{
-				// status = netRender_READY;
-				gMainInterface->stopRequest = true;
-				// emit NotifyStatus();
-				WriteLog("NetRender - ProcessData(), command STOP", 2);
+				if (inMsg->id == actualId)
+				{
+					// status = netRender_READY;
+					gMainInterface->stopRequest = true;
+					// emit NotifyStatus();
+					WriteLog("NetRender - ProcessData(), command STOP", 2);
+				}
+				else if (nextJobPending && inMsg->id == nextJobId)
+				{
+					nextJobPending = false;
+					WriteLog("NetRender - ProcessData(), command STOP, next job cancelled", 2);
+				}
+				else
+				{
+					// end of job which was already replaced by the next one
+					WriteLog("NetRender - received STOP message with old id", 2);
+				}
 				break;
 			}
 			case netRender_STATUS:
@@ -500,91 +696,175 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 				{
 					WriteLog("NetRender - ProcessData(), command JOB", 2);
 					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
-					QByteArray buffer;
-					qint32 size;
-					status = netRender_WORKING;
-					emit NotifyStatus();
+					frameJobIndex = -1;
+					slabJob = sVoxelSlabJob();
+					sentLines.clear();
+					ReadJob(&stream);
+				}
+				else
+				{
+					WriteLog("NetRender - received JOB message with wrong id", 1);
+				}
+				break;
+			}
+			case netRender_JOB_NEXT:
+			{
+				WriteLog("NetRender - ProcessData(), command JOB_NEXT", 2);
+				QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+				qint32 numberOfPositions;
+				stream >> nextJobId;
+				stream >> numberOfPositions;
+				nextJobStartingPositions.clear();
+				for (int i = 0; i < numberOfPositions; i++)
+				{
+					qint32 position;
+					stream >> position;
+					nextJobStartingPositions.append(position);
+				}
+				nextJobPayload = inMsg->payload.mid(stream.device()->pos());
+				nextJobPending = true;
 
-					// read settings
-					stream >> size;
-					buffer.resize(size);
-					stream.readRawData(buffer.data(), size);
-					settingsText = QString::fromUtf8(buffer.data(), buffer.size());
+				// client which already finished its part of the current job can start immediately
+				if (status != netRender_WORKING) StartNextJob();
+				break;
+			}
+			case netRender_FRAME:
+			{
+				if (inMsg->id == actualId)
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					qint32 imageFileType;
+					stream >> frameJobIndex;
+					stream >> imageFileType;
+					frameJobImageType = (ImageFileSave::enumImageFileType)imageFileType;
+					slabJob = sVoxelSlabJob();
 					WriteLog(
-						QString("NetRender - ProcessData(), command JOB, settings size: %1").arg(size), 2);
+						QString("NetRender - ProcessData(), command FRAME, frame %1").arg(frameJobIndex), 2);
+					ReadJob(&stream);
+				}
+				else
+				{
+					WriteLog("NetRender - received FRAME message with wrong id", 1);
+				}
+				break;
+			}
+			case netRender_VOXEL_SLAB:
+			{
+				if (inMsg->id == actualId)
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					frameJobIndex = -1;
+					slabJob = ReadVoxelSlabJob(&stream);
 					WriteLog(
-						QString("NetRender - ProcessData(), command JOB, settings: %1").arg(settingsText), 3);
+						QString("NetRender - ProcessData(), command VOXEL_SLAB, slab %1").arg(slabJob.index),
+						2);
+					ReadJob(&stream);
+				}
+				else
+				{
+					WriteLog("NetRender - received VOXEL_SLAB message with wrong id", 1);
+				}
+				break;
+			}
+			case netRender_POST_TILE:
+			{
+				if (inMsg->id == actualId)
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					qint32 numberOfLines;
+					stream >> postTileJob.index >> postTileJob.y1 >> postTileJob.y2;
+					stream >> postTileJob.haloY1 >> postTileJob.haloY2;
+					stream >> numberOfLines;
+					postTileLineNumbers.clear();
+					postTileLines.clear();
+					for (int i = 0; i < numberOfLines; i++)
+					{
+						qint32 line;
+						QByteArray lineData;
+						stream >> line >> lineData;
+						postTileLineNumbers.append(line);
+						postTileLines.append(lineData);
+					}
+					WriteLog(QString("NetRender - ProcessData(), command POST_TILE, band %1, lines %2")
+										 .arg(postTileJob.index)
+										 .arg(numberOfLines),
+						2);
+
+					status = netRender_WORKING;
+					emit NotifyStatus();
 
+					// band is processed in separate thread and then its lines are sent to the server
+					cHeadless *headless = new cHeadless;
+					QThread *thread = new QThread; // deleted by deleteLater()
+					headless->moveToThread(thread);
+					QObject::connect(thread, SIGNAL(started()), headless, SLOT(slotNetRenderPostTile()));
+					thread->setObjectName("PostTileJob");
+					thread->start();
+
+					QObject::connect(headless, SIGNAL(finished()), this, SLOT(SendPostTileData()));
+					QObject::connect(headless, SIGNAL(finished()), headless, SLOT(deleteLater()));
+					QObject::connect(headless, SIGNAL(finished()), thread, SLOT(quit()));
+					QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+				}
+				else
+				{
+					WriteLog("NetRender - received POST_TILE message with wrong id", 1);
+				}
+				break;
+			}
+			case netRender_TEXTURES:
+			{
+				if (inMsg->id == actualId && !missingTextures.isEmpty())
+				{
+					WriteLog("NetRender - ProcessData(), command TEXTURES", 2);
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
 					qint32 numberOfTextures;
 					stream >> numberOfTextures;
 
-					WriteLog(QString("NetRender - ProcessData(), command JOB, number of textures: %1")
-										 .arg(numberOfTextures),
-						2);
-
-					// read textures
 					for (int i = 0; i < numberOfTextures; i++)
 					{
-						qint32 sizeOfName;
-						stream >> sizeOfName;
-
-						QString textureName;
-						if (sizeOfName > 0)
-						{
-							QByteArray bufferForName;
-							bufferForName.resize(sizeOfName);
-							stream.readRawData(bufferForName.data(), sizeOfName);
-							textureName = QString::fromUtf8(bufferForName);
-							WriteLog(QString("NetRender - ProcessData(), command JOB, texture name: %1")
-												 .arg(textureName),
-								2);
-						}
+						qint32 size;
+						stream >> size;
+						QByteArray hash;
+						hash.resize(size);
+						stream.readRawData(hash.data(), size);
 
-						cTexture texture;
 						stream >> size;
-						WriteLog(
-							QString("NetRender - ProcessData(), command JOB, texture size: %1").arg(size), 2);
+						QByteArray buffer;
 						if (size > 0)
 						{
 							buffer.resize(size);
 							stream.readRawData(buffer.data(), size);
 						}
-						textures.insert(textureName, buffer);
-					}
+						WriteLog(
+							QString("NetRender - ProcessData(), command TEXTURES, texture size: %1").arg(size),
+							2);
 
-					cSettings parSettings(cSettings::formatCondensedText);
-					parSettings.BeQuiet(true);
-					parSettings.LoadFromString(settingsText);
-					parSettings.Decode(gPar, gParFractal);
+						// empty entry means that server couldn't read the file, so it is not cached
+						if (size > 0) textureCache.insert(hash, buffer);
+						multicast->Discard(hash);
 
-					WriteLog("NetRender - ProcessData(), command JOB, starting rendering", 2);
+						QList<QString> names = missingTextures.values(hash);
+						for (int n = 0; n < names.size(); n++)
+						{
+							textures.insert(names.at(n), buffer);
+						}
+						missingTextures.remove(hash);
+					}
 
-					if (!systemData.noGui)
+					if (missingTextures.isEmpty())
 					{
-						gMainInterface->SynchronizeInterface(gPar, gParFractal, qInterface::write);
-						gMainInterface->StartRender(true);
+						multicastWaitTimer->stop();
+						StartJob();
 					}
-					else
+					else if (!multicastWaitTimer->isActive())
 					{
-						// in noGui mode it must be started as separate thread to be able to process event loop
-						gMainInterface->headless = new cHeadless;
-
-						QThread *thread = new QThread; // deleted by deleteLater()
-						gMainInterface->headless->moveToThread(thread);
-						QObject::connect(
-							thread, SIGNAL(started()), gMainInterface->headless, SLOT(slotNetRender()));
-						thread->setObjectName("RenderJob");
-						thread->start();
-
-						QObject::connect(gMainInterface->headless, SIGNAL(finished()), gMainInterface->headless,
-							SLOT(deleteLater()));
-						QObject::connect(gMainInterface->headless, SIGNAL(finished()), thread, SLOT(quit()));
-						QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+						WriteLog("NetRender - TEXTURES message doesn't contain all requested textures", 1);
 					}
 				}
 				else
 				{
-					WriteLog("NetRender - received JOB message with wrong id", 1);
+					WriteLog("NetRender - received TEXTURES message with wrong id", 1);
 				}
 				break;
 			}
@@ -683,8 +963,13 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 					buffer.resize(size);
 					stream.readRawData(buffer.data(), size);
 					clients[index].name = QString::fromUtf8(buffer.data(), buffer.size());
+					clients[index].reliability = clientReliability.value(clients[index].name, 1.0);
+					// older clients don't report memory
+					if (!stream.atEnd()) stream >> clients[index].memoryBudget;
 
-					if (clients[index].status == netRender_NEW) clients[index].status = netRender_READY;
+					// relays send WORKER again when number of their clients changes
+					bool newClient = clients[index].status == netRender_NEW;
+					if (newClient) clients[index].status = netRender_READY;
 					WriteLog("NetRender - new Client #" + QString::number(index) + "(" + clients[index].name
 										 + " - " + clients[index].socket->peerAddress().toString() + ")",
 						1);
@@ -700,17 +985,27 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 
 					// when the client connects while a render is in progress, send the current job to the
 					// client
-					if (msgCurrentJob.command != netRender_NONE)
+					if (!newClient)
+					{
+						break;
+					}
+					else if (frameDistribution || slabDistribution)
+					{
+						emit ClientIdle(index);
+					}
+					else if (msgCurrentJob.command != netRender_NONE)
 					{
 						SendData(clients[index].socket, msgCurrentJob);
 						clients[index].linesRendered = 0;
+						clients[index].receivedLines.clear();
+						clients[index].jobTimer.start();
 					}
 					break;
 				}
 				case netRender_DATA:
 				{
 					WriteLog("NetRender - ProcessData(), command DATA", 3);
-					if (inMsg->id == actualId)
+					if (inMsg->id == actualId || (nextJobSent && inMsg->id == nextJobId))
 					{
 						QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
 						qint32 line;
@@ -734,12 +1029,29 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 									.arg(lineLength),
 								3);
 						}
-						clients[index].linesRendered += receivedLineNumbers.size();
-						emit NewLinesArrived(receivedLineNumbers, receivedRenderedLines);
+						if (inMsg->id == actualId)
+						{
+							clients[index].linesRendered += receivedLineNumbers.size();
+							// client keeps these lines for post-processing in bands
+							for (int i = 0; i < receivedLineNumbers.size(); i++)
+								clients[index].receivedLines.insert(receivedLineNumbers.at(i));
+
+							// throughput of client is used to balance work of the next jobs
+							double jobTime = clients[index].jobTimer.elapsed() / 1000.0;
+							if (jobTime > NETRENDER_MIN_SPEED_MEASUREMENT_TIME)
+								clients[index].linesPerSecond = clients[index].linesRendered / jobTime;
+							emit NewLinesArrived(receivedLineNumbers, receivedRenderedLines);
+						}
+						else
+						{
+							// client already works on the next job. Lines are kept until it is activated
+							nextJobLineNumbers.append(receivedLineNumbers);
+							nextJobLines.append(receivedRenderedLines);
+						}
 
 						// send acknowledge
 						sMessage outMsg;
-						outMsg.id = actualId;
+						outMsg.id = inMsg->id;
 						outMsg.command = netRender_ACK;
 						SendData(clients[index].socket, outMsg);
 					}
@@ -749,10 +1061,168 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 					}
 					break;
 				}
+				case netRender_FRAME_DATA:
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					qint32 frameIndex;
+					qint32 numberOfFiles;
+					stream >> frameIndex;
+					stream >> numberOfFiles;
+					WriteLog(QString("NetRender - ProcessData(), command FRAME_DATA, frame %1, files %2")
+										 .arg(frameIndex)
+										 .arg(numberOfFiles),
+						2);
+
+					// frames of interrupted distribution are ignored
+					if (frameIndex >= 0 && frameIndex == clients[index].frameIndex)
+					{
+						QString fileName = frameFileNames.value(frameIndex);
+						bool success = numberOfFiles > 0;
+						for (int i = 0; i < numberOfFiles; i++)
+						{
+							qint32 size;
+							stream >> size;
+							QByteArray suffix;
+							suffix.resize(size);
+							stream.readRawData(suffix.data(), size);
+
+							stream >> size;
+							QByteArray buffer;
+							buffer.resize(size);
+							stream.readRawData(buffer.data(), size);
+
+							// files are saved with the same postfixes as created by client
+							QFile file(fileName + QString::fromUtf8(suffix));
+							if (file.open(QIODevice::WriteOnly))
+							{
+								file.write(buffer);
+							}
+							else
+							{
+								WriteLog("NetRender - cannot save frame file " + file.fileName(), 1);
+								success = false;
+							}
+						}
+
+						clients[index].frameIndex = -1;
+						frameFileNames.remove(frameIndex);
+						emit FrameReceived(frameIndex, success);
+						if (frameDistribution) emit ClientIdle(index);
+					}
+					else
+					{
+						WriteLog("NetRender - received FRAME_DATA of not assigned frame", 1);
+					}
+					break;
+				}
+				case netRender_VOXEL_DATA:
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					qint32 slabIndex;
+					stream >> slabIndex;
+					QByteArray voxels;
+					QByteArray distances;
+					if (!stream.atEnd()) stream >> voxels >> distances;
+					WriteLog(QString("NetRender - ProcessData(), command VOXEL_DATA, slab %1, size %2")
+										 .arg(slabIndex)
+										 .arg(voxels.size()),
+						2);
+
+					// slabs of interrupted distribution are ignored
+					if (slabIndex >= 0 && slabIndex == clients[index].slabIndex)
+					{
+						clients[index].slabIndex = -1;
+						emit VoxelSlabReceived(slabIndex, voxels, distances);
+						if (slabDistribution) emit ClientIdle(index);
+					}
+					else
+					{
+						WriteLog("NetRender - received VOXEL_DATA of not assigned slab", 1);
+					}
+					break;
+				}
+				case netRender_POST_DATA:
+				{
+					QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+					qint32 tileIndex;
+					QByteArray data;
+					stream >> tileIndex;
+					if (!stream.atEnd()) stream >> data;
+					WriteLog(QString("NetRender - ProcessData(), command POST_DATA, band %1, size %2")
+										 .arg(tileIndex)
+										 .arg(data.size()),
+						2);
+
+					if (tileIndex >= 0 && tileIndex == clients[index].postTileIndex)
+					{
+						clients[index].postTileIndex = -1;
+						emit PostTileReceived(tileIndex, data);
+					}
+					else
+					{
+						WriteLog("NetRender - received POST_DATA of not assigned band", 1);
+					}
+					break;
+				}
+				case netRender_TEXTURE_REQUEST:
+				{
+					WriteLog("NetRender - ProcessData(), command TEXTURE_REQUEST", 2);
+					if (inMsg->id == actualId || (nextJobSent && inMsg->id == nextJobId))
+					{
+						QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+						qint32 numberOfTextures;
+						stream >> numberOfTextures;
+
+						sMessage outMsg;
+						outMsg.command = netRender_TEXTURES;
+						outMsg.id = inMsg->id;
+						QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+						outStream << numberOfTextures;
+
+						for (int i = 0; i < numberOfTextures; i++)
+						{
+							qint32 size;
+							stream >> size;
+							QByteArray hash;
+							hash.resize(size);
+							stream.readRawData(hash.data(), size);
+
+							// send hash and file content
+							outStream << (qint32)hash.size();
+							outStream.writeRawData(hash.data(), hash.size());
+
+							QFile file(jobTextureFiles.value(hash));
+							if (!hash.isEmpty() && file.open(QIODevice::ReadOnly))
+							{
+								QByteArray buffer = file.readAll();
+								outStream << (qint32)buffer.size();
+								outStream.writeRawData(buffer.data(), buffer.size());
+								continue;
+							}
+
+							outStream << (qint32)0; // empty entry
+						}
+						SendData(clients[index].socket, outMsg);
+					}
+					else
+					{
+						WriteLog("NetRender - received TEXTURE_REQUEST message with wrong id", 1);
+					}
+					break;
+				}
 				case netRender_STATUS:
 				{
 					WriteLog("NetRender - ProcessData(), command STATUS", 3);
-					clients[index].status = (netRenderStatus) * (qint32 *)inMsg->payload.data();
+					netRenderStatus newStatus = (netRenderStatus) * (qint32 *)inMsg->payload.data();
+
+					// client finished the job
+					if (clients[index].status == netRender_WORKING && newStatus == netRender_READY)
+					{
+						clients[index].reliability =
+							qMin(1.0, clients[index].reliability + NETRENDER_RELIABILITY_GAIN);
+						clientReliability.insert(clients[index].name, clients[index].reliability);
+					}
+					clients[index].status = newStatus;
 					emit ClientsChanged(index);
 					break;
 				}
@@ -765,20 +1235,470 @@ void CNetRender::ProcessData(QTcpSocket *socket, sMessage *inMsg)
 			qWarning() << "NetRender - client unknown, address: " + socket->peerAddress().toString();
 		}
 	}
+
+	//----------------------------- RELAY ----------------------
+	else if (IsRelay())
+	{
+		if (socket == clientSocket)
+		{
+			ProcessRelayDataFromServer(inMsg);
+		}
+		else
+		{
+			int index = GetClientIndexFromSocket(socket);
+			if (index > -1 && !ProcessRelayDataFromClient(socket, index, inMsg))
+				return; // to avoid reseting already deleted message buffer
+		}
+	}
 	ResetMessage(inMsg);
 }
 
-// send rendered lines
-void CNetRender::SendRenderedLines(QList<int> lineNumbers, QList<QByteArray> lines)
+void CNetRender::ProcessRelayDataFromServer(sMessage *inMsg)
 {
-	sMessage msg;
-	msg.command = netRender_DATA;
-	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
-	for (int i = 0; i < lineNumbers.size(); i++)
+	switch ((netCommand)inMsg->command)
 	{
-		stream << (qint32)lineNumbers.at(i);
-		stream << (qint32)lines.at(i).size();
+		case netRender_VERSION:
+		{
+			qint32 serverVersion = *(qint32 *)inMsg->payload.data();
+			if (CompareMajorVersion(serverVersion, version))
+			{
+				WriteLog("NetRender - relay - version matches, connection established", 2);
+				relayConnected = true;
+				status = netRender_READY;
+				SendRelayWorkers();
+				UpdateRelayStatus();
+			}
+			else
+			{
+				WriteLog(QString("NetRender - relay - version mismatch, server version %1, relay %2")
+									 .arg(serverVersion)
+									 .arg(version),
+					1);
+				sMessage outMsg;
+				outMsg.command = netRender_BAD;
+				SendData(clientSocket, outMsg);
+			}
+			break;
+		}
+		case netRender_SETUP:
+		{
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			qint32 id;
+			qint32 numberOfPositions;
+			QList<int> positions;
+			stream >> id;
+			stream >> numberOfPositions;
+			for (int i = 0; i < numberOfPositions; i++)
+			{
+				qint32 position;
+				stream >> position;
+				positions.append(position);
+			}
+			WriteLog(QString("NetRender - relay - command SETUP, id %1").arg(id), 2);
+
+			QList<QList<int> > clientPositions = SplitRelayStartingPositions(positions);
+			for (int i = 0; i < clients.size(); i++)
+				SendSetup(i, id, clientPositions.at(i));
+			actualId = id;
+			break;
+		}
+		case netRender_JOB:
+		{
+			WriteLog("NetRender - relay - command JOB", 2);
+			// for clients connected later
+			msgCurrentJob.command = netRender_JOB;
+			msgCurrentJob.payload = inMsg->payload;
+
+			for (int i = 0; i < clients.size(); i++)
+			{
+				sMessage outMsg;
+				outMsg.command = inMsg->command;
+				outMsg.id = inMsg->id;
+				outMsg.payload = inMsg->payload;
+				SendData(clients[i].socket, outMsg);
+				clients[i].linesRendered = 0;
+				clients[i].jobTimer.start();
+			}
+			break;
+		}
+		case netRender_JOB_NEXT:
+		{
+			WriteLog("NetRender - relay - command JOB_NEXT", 2);
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			qint32 id;
+			qint32 numberOfPositions;
+			QList<int> positions;
+			stream >> id;
+			stream >> numberOfPositions;
+			for (int i = 0; i < numberOfPositions; i++)
+			{
+				qint32 position;
+				stream >> position;
+				positions.append(position);
+			}
+			QByteArray payload = inMsg->payload.mid(stream.device()->pos());
+
+			QList<QList<int> > clientPositions = SplitRelayStartingPositions(positions);
+			for (int i = 0; i < clients.size(); i++)
+			{
+				sMessage outMsg;
+				outMsg.command = netRender_JOB_NEXT;
+				outMsg.id = inMsg->id;
+				QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+				outStream << id;
+				outStream << (qint32)clientPositions.at(i).size();
+				for (int p = 0; p < clientPositions.at(i).size(); p++)
+				{
+					outStream << (qint32)clientPositions.at(i).at(p);
+				}
+				outMsg.payload.append(payload);
+				SendData(clients[i].socket, outMsg);
+			}
+			break;
+		}
+		case netRender_RENDER:
+		case netRender_STOP:
+		{
+			// one message of the server is forwarded to all clients of relay
+			for (int i = 0; i < clients.size(); i++)
+			{
+				if (inMsg->command == netRender_RENDER && clients[i].status == netRender_ERROR) continue;
+				sMessage outMsg;
+				outMsg.command = inMsg->command;
+				outMsg.id = inMsg->id;
+				outMsg.payload = inMsg->payload;
+				SendData(clients[i].socket, outMsg);
+			}
+			break;
+		}
+		case netRender_STATUS:
+		{
+			NotifyStatus();
+			break;
+		}
+		case netRender_ACK:
+		{
+			if (relayAcksPending > 0) relayAcksPending--;
+			FlushRelayData();
+			break;
+		}
+		case netRender_TEXTURES:
+		{
+			// server answers texture requests in the same order as they were sent
+			if (!relayTextureRequests.isEmpty())
+			{
+				QTcpSocket *socket = relayTextureRequests.takeFirst();
+				if (socket)
+				{
+					sMessage outMsg;
+					outMsg.command = inMsg->command;
+					outMsg.id = inMsg->id;
+					outMsg.payload = inMsg->payload;
+					SendData(socket, outMsg);
+				}
+			}
+			break;
+		}
+		case netRender_FRAME:
+		{
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			stream >> frameJobIndex;
+			WriteLog(QString("NetRender - relay - command FRAME, frame %1").arg(frameJobIndex), 2);
+
+			// whole frame is rendered by one ready client
+			relayFrameClient = NULL;
+			for (int i = 0; i < clients.size(); i++)
+			{
+				if (clients[i].status == netRender_READY)
+				{
+					relayFrameClient = clients[i].socket;
+					break;
+				}
+			}
+
+			if (relayFrameClient)
+			{
+				sMessage outMsg;
+				outMsg.command = inMsg->command;
+				outMsg.id = inMsg->id;
+				outMsg.payload = inMsg->payload;
+				SendData(relayFrameClient, outMsg);
+			}
+			else
+			{
+				// server will give the frame to someone else
+				sMessage outMsg;
+				outMsg.command = netRender_FRAME_DATA;
+				QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+				outStream << frameJobIndex;
+				outStream << (qint32)0;
+				SendData(clientSocket, outMsg);
+				frameJobIndex = -1;
+			}
+			break;
+		}
+		case netRender_VOXEL_SLAB:
+		{
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			slabJob = ReadVoxelSlabJob(&stream);
+			WriteLog(QString("NetRender - relay - command VOXEL_SLAB, slab %1").arg(slabJob.index), 2);
+
+			// whole slab is calculated by one ready client
+			relaySlabClient = NULL;
+			for (int i = 0; i < clients.size(); i++)
+			{
+				if (clients[i].status == netRender_READY && clients[i].socket != relayFrameClient)
+				{
+					relaySlabClient = clients[i].socket;
+					break;
+				}
+			}
+
+			if (relaySlabClient)
+			{
+				sMessage outMsg;
+				outMsg.command = inMsg->command;
+				outMsg.id = inMsg->id;
+				outMsg.payload = inMsg->payload;
+				SendData(relaySlabClient, outMsg);
+			}
+			else
+			{
+				// server will give the slab to someone else
+				sMessage outMsg;
+				outMsg.command = netRender_VOXEL_DATA;
+				QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+				outStream << (qint32)slabJob.index;
+				SendData(clientSocket, outMsg);
+				slabJob = sVoxelSlabJob();
+			}
+			break;
+		}
+		case netRender_POST_TILE:
+		{
+			// lines rendered by clients of relay are spread over many clients, so the server has to
+			// process the band itself
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			qint32 tileIndex;
+			stream >> tileIndex;
+			sMessage outMsg;
+			outMsg.command = netRender_POST_DATA;
+			QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+			outStream << tileIndex;
+			SendData(clientSocket, outMsg);
+			break;
+		}
+		default: break;
+	}
+}
+
+bool CNetRender::ProcessRelayDataFromClient(QTcpSocket *socket, int index, sMessage *inMsg)
+{
+	switch ((netCommand)inMsg->command)
+	{
+		case netRender_BAD:
+		{
+			WriteLog("NetRender - relay - client version mismatch, address: "
+								 + socket->peerAddress().toString(),
+				1);
+			clients.removeAt(index);
+			emit ClientsChanged();
+			SendRelayWorkers();
+			return false;
+		}
+		case netRender_WORKER:
+		{
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			stream >> clients[index].clientWorkerCount;
+			QByteArray buffer;
+			qint32 size;
+			stream >> size;
+			buffer.resize(size);
+			stream.readRawData(buffer.data(), size);
+			clients[index].name = QString::fromUtf8(buffer.data(), buffer.size());
+			clients[index].reliability = clientReliability.value(clients[index].name, 1.0);
+			if (!stream.atEnd()) stream >> clients[index].memoryBudget;
+			WriteLog("NetRender - relay - new Client #" + QString::number(index) + "("
+								 + clients[index].name + " - " + socket->peerAddress().toString() + ")",
+				1);
+
+			if (clients[index].status == netRender_NEW)
+			{
+				clients[index].status = netRender_READY;
+				if (msgCurrentJob.command != netRender_NONE)
+				{
+					SendData(socket, msgCurrentJob);
+					clients[index].linesRendered = 0;
+					clients[index].jobTimer.start();
+				}
+			}
+			emit ClientsChanged(index);
+			SendRelayWorkers();
+			break;
+		}
+		case netRender_DATA:
+		{
+			// messages of many clients are sent to the server as one. Id is checked by the server
+			qint32 numberOfLines = 0;
+			QDataStream stream(&inMsg->payload, QIODevice::ReadOnly);
+			while (!stream.atEnd())
+			{
+				qint32 line;
+				qint32 lineLength;
+				stream >> line;
+				stream >> lineLength;
+				stream.skipRawData(lineLength);
+				numberOfLines++;
+			}
+			clients[index].linesRendered += numberOfLines;
+			relayData[inMsg->id].append(inMsg->payload);
+
+			sMessage outMsg;
+			outMsg.command = netRender_ACK;
+			outMsg.id = inMsg->id;
+			SendData(socket, outMsg);
+
+			FlushRelayData();
+			break;
+		}
+		case netRender_STATUS:
+		{
+			clients[index].status = (netRenderStatus) * (qint32 *)inMsg->payload.data();
+			emit ClientsChanged(index);
+			UpdateRelayStatus();
+			break;
+		}
+		case netRender_TEXTURE_REQUEST:
+		{
+			relayTextureRequests.append(socket);
+			sMessage outMsg;
+			outMsg.command = inMsg->command;
+			outMsg.id = inMsg->id;
+			outMsg.payload = inMsg->payload;
+			SendData(clientSocket, outMsg);
+			break;
+		}
+		case netRender_FRAME_DATA:
+		{
+			if (socket == relayFrameClient)
+			{
+				relayFrameClient = NULL;
+				frameJobIndex = -1;
+			}
+			sMessage outMsg;
+			outMsg.command = inMsg->command;
+			outMsg.id = inMsg->id;
+			outMsg.payload = inMsg->payload;
+			SendData(clientSocket, outMsg);
+			break;
+		}
+		case netRender_VOXEL_DATA:
+		{
+			if (socket == relaySlabClient)
+			{
+				relaySlabClient = NULL;
+				slabJob = sVoxelSlabJob();
+			}
+			sMessage outMsg;
+			outMsg.command = inMsg->command;
+			outMsg.id = inMsg->id;
+			outMsg.payload = inMsg->payload;
+			SendData(clientSocket, outMsg);
+			break;
+		}
+		default: break;
+	}
+	return true;
+}
+
+void CNetRender::SendRelayWorkers()
+{
+	if (!relayConnected) return;
+
+	qint32 totalWorkerCount = 0;
+	// frame can be rendered by any client of the relay, so the smallest memory is reported
+	qint64 memoryBudget = -1;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		totalWorkerCount += clients[i].clientWorkerCount;
+		if (clients[i].memoryBudget >= 0
+				&& (memoryBudget < 0 || clients[i].memoryBudget < memoryBudget))
+			memoryBudget = clients[i].memoryBudget;
+	}
+
+	sMessage msg;
+	msg.command = netRender_WORKER;
+	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+	stream << totalWorkerCount;
+	QByteArray machineName = (QHostInfo::localHostName() + " (relay)").toUtf8();
+	stream << (qint32)machineName.size();
+	stream.writeRawData(machineName.data(), machineName.size());
+	stream << memoryBudget;
+	SendData(clientSocket, msg);
+}
+
+QList<QList<int> > CNetRender::SplitRelayStartingPositions(const QList<int> &positions)
+{
+	QList<QList<int> > clientPositions;
+	int position = 0;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		QList<int> part;
+		for (int w = 0; w < clients[i].clientWorkerCount && position < positions.size(); w++)
+			part.append(positions.at(position++));
+		clientPositions.append(part);
+	}
+	return clientPositions;
+}
+
+void CNetRender::FlushRelayData()
+{
+	// lines are collected while waiting for acknowledge of previous data
+	if (!relayConnected || relayAcksPending > 0 || relayData.isEmpty()) return;
+
+	QMap<qint32, QByteArray>::const_iterator it;
+	for (it = relayData.constBegin(); it != relayData.constEnd(); ++it)
+	{
+		sMessage msg;
+		msg.command = netRender_DATA;
+		msg.id = it.key();
+		msg.payload = it.value();
+		SendData(clientSocket, msg);
+		relayAcksPending++;
+	}
+	relayData.clear();
+}
+
+void CNetRender::UpdateRelayStatus()
+{
+	if (!relayConnected) return;
+
+	netRenderStatus newStatus = netRender_READY;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].status == netRender_WORKING) newStatus = netRender_WORKING;
+	}
+
+	if (newStatus != status)
+	{
+		status = newStatus;
+		NotifyStatus();
+	}
+}
+
+// send rendered lines
+void CNetRender::SendRenderedLines(QList<int> lineNumbers, QList<QByteArray> lines)
+{
+	sMessage msg;
+	msg.command = netRender_DATA;
+	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+	for (int i = 0; i < lineNumbers.size(); i++)
+	{
+		stream << (qint32)lineNumbers.at(i);
+		stream << (qint32)lines.at(i).size();
 		stream.writeRawData(lines.at(i).data(), lines.at(i).size());
+		// lines are kept for post-processing of bands of the image
+		sentLines.insert(lineNumbers.at(i), lines.at(i));
 	}
 	SendData(clientSocket, msg);
 }
@@ -798,50 +1718,80 @@ void CNetRender::SetCurrentJob(
 	cParameterContainer settings, cFractalContainer fractal, QStringList listOfTextures)
 {
 	WriteLog("NetRender - Sending job", 2);
-	cSettings settingsData(cSettings::formatNetRender);
-	size_t dataSize = settingsData.CreateText(&settings, &fractal);
-	if (dataSize > 0)
+	QByteArray payload;
+	QDataStream stream(&payload, QIODevice::WriteOnly);
+	jobTextureFiles.clear();
+	if (WriteJob(&stream, settings, fractal, listOfTextures))
 	{
-		QString settingsText = settingsData.GetSettingsText();
 		msgCurrentJob.command = netRender_JOB;
-		QDataStream stream(&msgCurrentJob.payload, QIODevice::WriteOnly);
+		msgCurrentJob.payload = payload;
 
-		// write settings
-		stream << (qint32)settingsText.toUtf8().size();
-		stream.writeRawData(settingsText.toUtf8().data(), settingsText.toUtf8().size());
+		for (int i = 0; i < clients.size(); i++)
+		{
+			SendData(clients[i].socket, msgCurrentJob);
+			clients[i].linesRendered = 0;
+			clients[i].receivedLines.clear();
+			clients[i].jobTimer.start();
+		}
+		MulticastJobTextures();
+	}
+}
 
-		// send number of textures
-		stream << (qint32)listOfTextures.size();
+void CNetRender::MulticastJobTextures()
+{
+	if (!multicast->IsActive()) return;
 
-		// write textures (from files)
-		for (int i = 0; i < listOfTextures.size(); i++)
-		{
-			// send length of texture name
-			stream << (qint32)listOfTextures[i].toUtf8().size();
+	// every texture is sent once, clients keep it in the cache for the next jobs
+	QMap<QByteArray, QString>::const_iterator it;
+	for (it = jobTextureFiles.constBegin(); it != jobTextureFiles.constEnd(); ++it)
+	{
+		if (it.key().isEmpty() || multicast->WasSent(it.key())) continue;
+		QFile file(it.value());
+		if (file.open(QIODevice::ReadOnly)) multicast->Send(it.key(), file.readAll());
+	}
+}
 
-			// send texture name
-			stream.writeRawData(listOfTextures[i].toUtf8(), listOfTextures[i].length());
+bool CNetRender::WriteJob(QDataStream *stream, const cParameterContainer &settings,
+	const cFractalContainer &fractal, const QStringList &listOfTextures)
+{
+	cSettings settingsData(cSettings::formatNetRender);
+	size_t dataSize = settingsData.CreateText(&settings, &fractal);
+	if (dataSize == 0) return false;
 
-			QFile file(listOfTextures[i]);
-			if (file.open(QIODevice::ReadOnly))
-			{
-				QByteArray buffer = file.readAll();
-				// send size of file
-				stream << (qint32)buffer.size();
-				// send file content
-				stream.writeRawData(buffer.data(), buffer.size());
-				continue;
-			}
+	QByteArray settingsText = settingsData.GetSettingsText().toUtf8();
 
-			stream << (qint32)0; // empty entry
-		}
+	// write settings
+	*stream << (qint32)settingsText.size();
+	stream->writeRawData(settingsText.data(), settingsText.size());
 
-		for (int i = 0; i < clients.size(); i++)
+	// send number of textures
+	*stream << (qint32)listOfTextures.size();
+
+	// write names and content hashes of textures. Content is sent only on client request
+	for (int i = 0; i < listOfTextures.size(); i++)
+	{
+		QByteArray name = listOfTextures[i].toUtf8();
+		// send length of texture name
+		*stream << (qint32)name.size();
+
+		// send texture name
+		stream->writeRawData(name.data(), name.size());
+
+		QByteArray hash;
+		QFile file(listOfTextures[i]);
+		if (file.open(QIODevice::ReadOnly))
 		{
-			SendData(clients[i].socket, msgCurrentJob);
-			clients[i].linesRendered = 0;
+			QCryptographicHash hashGenerator(QCryptographicHash::Sha1);
+			hashGenerator.addData(&file);
+			hash = hashGenerator.result();
 		}
+		jobTextureFiles.insert(hash, listOfTextures[i]); // empty hash if file is not readable
+
+		// send hash of file content
+		*stream << (qint32)hash.size();
+		stream->writeRawData(hash.data(), hash.size());
 	}
+	return true;
 }
 
 void CNetRender::NotifyStatus()
@@ -854,12 +1804,17 @@ void CNetRender::NotifyStatus()
 		SendData(clientSocket, outMsg);
 	}
 	emit NewStatusClient();
+
+	if (nextJobPending && status == netRender_READY) StartNextJob();
 }
 
 void CNetRender::SendToDoList(int clientIndex, QList<int> done)
 {
 	if (clientIndex < clients.size())
 	{
+		// stalled client wouldn't read it
+		if (clients[clientIndex].status == netRender_ERROR) return;
+
 		sMessage msg;
 		msg.command = netRender_RENDER;
 		QDataStream stream(&msg.payload, QIODevice::WriteOnly);
@@ -908,6 +1863,100 @@ void CNetRender::SendSetup(int clientIndex, int id, QList<int> startingPositions
 	}
 }
 
+void CNetRender::SetNextJob(qint32 id, QList<QList<int> > clientStartingPositions,
+	const cParameterContainer &settings, const cFractalContainer &fractal,
+	const QStringList &listOfTextures)
+{
+	WriteLog("NetRender - Sending next job", 2);
+	CancelNextJob();
+
+	// textures of current job stay available for clients
+	QByteArray payload;
+	QDataStream stream(&payload, QIODevice::WriteOnly);
+	if (!WriteJob(&stream, settings, fractal, listOfTextures)) return;
+
+	cSettings settingsData(cSettings::formatNetRender);
+	settingsData.CreateText(&settings, &fractal);
+	nextJobSettingsText = settingsData.GetSettingsText();
+	nextJobId = id;
+	nextJobPayload = payload;
+	nextJobSent = true;
+
+	for (int i = 0; i < clients.size(); i++)
+	{
+		sMessage msg;
+		msg.command = netRender_JOB_NEXT;
+		QDataStream msgStream(&msg.payload, QIODevice::WriteOnly);
+		QList<int> positions;
+		if (i < clientStartingPositions.size()) positions = clientStartingPositions.at(i);
+		msgStream << (qint32)id;
+		msgStream << (qint32)positions.size();
+		for (int p = 0; p < positions.size(); p++)
+		{
+			msgStream << (qint32)positions.at(p);
+		}
+		msg.payload.append(payload);
+		SendData(clients[i].socket, msg);
+	}
+	MulticastJobTextures();
+}
+
+bool CNetRender::ActivateNextJob(
+	const cParameterContainer &settings, const cFractalContainer &fractal)
+{
+	if (!nextJobSent) return false;
+
+	cSettings settingsData(cSettings::formatNetRender);
+	settingsData.CreateText(&settings, &fractal);
+	if (settingsData.GetSettingsText() != nextJobSettingsText)
+	{
+		WriteLog("NetRender - next job doesn't match actual settings", 2);
+		CancelNextJob();
+		return false;
+	}
+
+	WriteLog(QString("NetRender - Activating next job, id %1").arg(nextJobId), 2);
+	nextJobSent = false;
+	actualId = nextJobId;
+
+	// for clients connected later
+	msgCurrentJob.command = netRender_JOB;
+	msgCurrentJob.payload = nextJobPayload;
+
+	for (int i = 0; i < clients.size(); i++)
+	{
+		clients[i].linesRendered = 0;
+		clients[i].receivedLines.clear();
+		clients[i].jobTimer.start();
+	}
+	return true;
+}
+
+void CNetRender::CancelNextJob()
+{
+	if (!nextJobSent) return;
+
+	WriteLog(QString("NetRender - Cancelling next job, id %1").arg(nextJobId), 2);
+	for (int i = 0; i < clients.size(); i++)
+	{
+		sMessage msg;
+		msg.command = netRender_STOP;
+		msg.id = nextJobId;
+		SendData(clients[i].socket, msg);
+	}
+	nextJobSent = false;
+	nextJobLineNumbers.clear();
+	nextJobLines.clear();
+}
+
+void CNetRender::TakeNextJobLines(QList<int> *lineNumbers, QList<QByteArray> *lines)
+{
+	*lineNumbers = nextJobLineNumbers;
+	*lines = nextJobLines;
+	nextJobLineNumbers.clear();
+	nextJobLines.clear();
+}
+
 QString CNetRender::GetStatusText(netRenderStatus displayStatus)
 {
 	switch (displayStatus)
@@ -971,7 +2020,8 @@ bool CNetRender::WaitForAllClientsReady(double timeout)
 		bool allReady = true;
 		for (int i = 0; i < GetClientCount(); i++)
 		{
-			if (GetClientStatus(i) != netRender_READY)
+			// stalled clients are not awaited
+			if (GetClientStatus(i) != netRender_READY && GetClientStatus(i) != netRender_ERROR)
 			{
 				allReady = false;
 				WriteLog(QString("Client # %1 is not ready yet").arg(i), 1);
@@ -993,6 +2043,46 @@ bool CNetRender::WaitForAllClientsReady(double timeout)
 	return false;
 }
 
+void CNetRender::CheckClients()
+{
+	int timeout = gPar->Get<int>("netrender_client_timeout");
+
+	// messages couldn't be received while the server was busy
+	bool serverWasBlocked = lastHeartbeat.elapsed() > 2 * NETRENDER_HEARTBEAT_INTERVAL;
+	lastHeartbeat.restart();
+
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].status == netRender_NEW) continue;
+		if (serverWasBlocked || clients[i].socket->bytesAvailable() > 0)
+			clients[i].lastActivity.restart();
+
+		// any answer from client updates its last activity time
+		sMessage msg;
+		msg.command = netRender_STATUS;
+		SendData(clients[i].socket, msg);
+
+		bool busy = clients[i].status == netRender_WORKING || clients[i].frameIndex >= 0;
+		if (timeout > 0 && busy && clients[i].lastActivity.elapsed() > timeout * 1000)
+		{
+			// lines of the client are not reserved, so they are rendered by the server and other
+			// clients. Frame rendered by the client is rendered again
+			WriteLog(QString("NetRender - client #%1 (%2) doesn't respond").arg(i).arg(clients[i].name),
+				1);
+			DecreaseReliability(i);
+			clients[i].status = netRender_ERROR;
+			if (clients[i].frameIndex >= 0)
+			{
+				sMessage stopMsg;
+				stopMsg.command = netRender_STOP;
+				SendData(clients[i].socket, stopMsg);
+				clients[i].frameIndex = -1;
+			}
+			emit ClientsChanged(i);
+		}
+	}
+}
+
 bool CNetRender::Block()
 {
 	if (isUsed)
@@ -1013,7 +2103,597 @@ bool CNetRender::CompareMajorVersion(qint32 version1, qint32 version2)
 	return majorVersion1 == majorVersion2;
 }
 
+void CNetRender::ReadJob(QDataStream *stream)
+{
+	QByteArray buffer;
+	qint32 size;
+	status = netRender_WORKING;
+	emit NotifyStatus();
+
+	// read settings
+	*stream >> size;
+	buffer.resize(size);
+	stream->readRawData(buffer.data(), size);
+	settingsText = QString::fromUtf8(buffer.data(), buffer.size());
+	WriteLog(QString("NetRender - ReadJob(), settings size: %1").arg(size), 2);
+	WriteLog(QString("NetRender - ReadJob(), settings: %1").arg(settingsText), 3);
+
+	qint32 numberOfTextures;
+	*stream >> numberOfTextures;
+
+	WriteLog(QString("NetRender - ReadJob(), number of textures: %1").arg(numberOfTextures), 2);
+
+	// read names and hashes of textures. Content is taken from the cache if possible
+	textures.clear();
+	missingTextures.clear();
+	jobTextureHashes.clear();
+	for (int i = 0; i < numberOfTextures; i++)
+	{
+		qint32 sizeOfName;
+		*stream >> sizeOfName;
+
+		QString textureName;
+		if (sizeOfName > 0)
+		{
+			QByteArray bufferForName;
+			bufferForName.resize(sizeOfName);
+			stream->readRawData(bufferForName.data(), sizeOfName);
+			textureName = QString::fromUtf8(bufferForName);
+		}
+
+		*stream >> size;
+		QByteArray hash;
+		hash.resize(size);
+		stream->readRawData(hash.data(), size);
+		jobTextureHashes.insert(hash);
+
+		if (hash.isEmpty())
+		{
+			// server couldn't read the file
+			textures.insert(textureName, QByteArray());
+		}
+		else if (textureCache.contains(hash))
+		{
+			textures.insert(textureName, textureCache.value(hash));
+			WriteLog(QString("NetRender - ReadJob(), texture from cache: %1").arg(textureName), 2);
+		}
+		else
+		{
+			missingTextures.insert(hash, textureName);
+			WriteLog(QString("NetRender - ReadJob(), missing texture: %1").arg(textureName), 2);
+		}
+	}
+
+	multicastWaitTimer->stop();
+	if (missingTextures.isEmpty())
+	{
+		StartJob();
+	}
+	else if (multicast->IsActive())
+	{
+		// content is probably on the way from multicast group. TCP is used if it doesn't arrive
+		multicastWaitTimer->start();
+	}
+	else
+	{
+		// ask server for content of missing textures
+		SendTextureRequest(missingTextures.uniqueKeys());
+	}
+}
+
+void CNetRender::SendTextureRequest(const QList<QByteArray> &hashes)
+{
+	sMessage outMsg;
+	outMsg.command = netRender_TEXTURE_REQUEST;
+	QDataStream outStream(&outMsg.payload, QIODevice::WriteOnly);
+	outStream << (qint32)hashes.size();
+	for (int i = 0; i < hashes.size(); i++)
+	{
+		outStream << (qint32)hashes.at(i).size();
+		outStream.writeRawData(hashes.at(i).data(), hashes.at(i).size());
+	}
+	SendData(clientSocket, outMsg);
+}
+
+void CNetRender::RequestMissingTextures()
+{
+	if (missingTextures.isEmpty()) return;
+
+	// textures are still coming
+	if (multicast->IsReceiving())
+	{
+		multicastWaitTimer->start();
+		return;
+	}
+
+	WriteLog(QString("NetRender - %1 textures not received from multicast group, requesting")
+						 .arg(missingTextures.uniqueKeys().size()),
+		2);
+	SendTextureRequest(missingTextures.uniqueKeys());
+}
+
+void CNetRender::MulticastTextureReceived(QByteArray hash, QByteArray content)
+{
+	WriteLog(QString("NetRender - texture received from multicast group, size %1")
+						 .arg(content.size()),
+		2);
+	textureCache.insert(hash, content);
+
+	if (!missingTextures.contains(hash)) return;
+	QList<QString> names = missingTextures.values(hash);
+	for (int n = 0; n < names.size(); n++)
+	{
+		textures.insert(names.at(n), content);
+	}
+	missingTextures.remove(hash);
+
+	if (missingTextures.isEmpty())
+	{
+		multicastWaitTimer->stop();
+		StartJob();
+	}
+}
+
+void CNetRender::StartJob()
+{
+	CleanTextureCache();
+
+	cSettings parSettings(cSettings::formatCondensedText);
+	parSettings.BeQuiet(true);
+	parSettings.LoadFromString(settingsText);
+	parSettings.Decode(gPar, gParFractal);
+
+	if (frameJobIndex >= 0)
+	{
+		WriteLog("NetRender - StartJob(), starting rendering of frame", 2);
+
+		// whole frame is rendered in separate thread and then its files are sent to the server
+		cHeadless *headless = new cHeadless;
+		if (systemData.noGui) gMainInterface->headless = headless;
+
+		QThread *thread = new QThread; // deleted by deleteLater()
+		headless->moveToThread(thread);
+		QObject::connect(thread, SIGNAL(started()), headless, SLOT(slotNetRenderFrame()));
+		thread->setObjectName("RenderJob");
+		thread->start();
+
+		QObject::connect(headless, SIGNAL(finished()), this, SLOT(SendRenderedFrame()));
+		QObject::connect(headless, SIGNAL(finished()), headless, SLOT(deleteLater()));
+		QObject::connect(headless, SIGNAL(finished()), thread, SLOT(quit()));
+		QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+		return;
+	}
+
+	if (slabJob.index >= 0)
+	{
+		WriteLog("NetRender - StartJob(), starting calculation of voxel slab", 2);
+
+		// slab is calculated in separate thread and then its data is sent to the server
+		cHeadless *headless = new cHeadless;
+		if (systemData.noGui) gMainInterface->headless = headless;
+
+		QThread *thread = new QThread; // deleted by deleteLater()
+		headless->moveToThread(thread);
+		QObject::connect(thread, SIGNAL(started()), headless, SLOT(slotNetRenderVoxelSlab()));
+		thread->setObjectName("VoxelSlabJob");
+		thread->start();
+
+		QObject::connect(headless, SIGNAL(finished()), this, SLOT(SendVoxelSlabData()));
+		QObject::connect(headless, SIGNAL(finished()), headless, SLOT(deleteLater()));
+		QObject::connect(headless, SIGNAL(finished()), thread, SLOT(quit()));
+		QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+		return;
+	}
+
+	WriteLog("NetRender - StartJob(), starting rendering", 2);
+
+	if (!systemData.noGui)
+	{
+		gMainInterface->SynchronizeInterface(gPar, gParFractal, qInterface::write);
+		gMainInterface->StartRender(true);
+	}
+	else
+	{
+		// in noGui mode it must be started as separate thread to be able to process event loop
+		gMainInterface->headless = new cHeadless;
+
+		QThread *thread = new QThread; // deleted by deleteLater()
+		gMainInterface->headless->moveToThread(thread);
+		QObject::connect(thread, SIGNAL(started()), gMainInterface->headless, SLOT(slotNetRender()));
+		thread->setObjectName("RenderJob");
+		thread->start();
+
+		QObject::connect(gMainInterface->headless, SIGNAL(finished()), gMainInterface->headless,
+			SLOT(deleteLater()));
+		QObject::connect(gMainInterface->headless, SIGNAL(finished()), thread, SLOT(quit()));
+		QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+	}
+}
+
+void CNetRender::StartNextJob()
+{
+	WriteLog(QString("NetRender - StartNextJob(), id %1").arg(nextJobId), 2);
+	nextJobPending = false;
+	actualId = nextJobId;
+	startingPositions = nextJobStartingPositions;
+	frameJobIndex = -1;
+	slabJob = sVoxelSlabJob();
+	sentLines.clear();
+	QDataStream stream(&nextJobPayload, QIODevice::ReadOnly);
+	ReadJob(&stream);
+}
+
+void CNetRender::CleanTextureCache()
+{
+	qint64 cacheSize = 0;
+	QHash<QByteArray, QByteArray>::const_iterator it;
+	for (it = textureCache.constBegin(); it != textureCache.constEnd(); ++it)
+		cacheSize += it.value().size();
+
+	if (cacheSize > NETRENDER_TEXTURE_CACHE_SIZE)
+	{
+		// only textures not used by current job are removed
+		QHash<QByteArray, QByteArray>::iterator cacheIt = textureCache.begin();
+		while (cacheIt != textureCache.end())
+		{
+			if (jobTextureHashes.contains(cacheIt.key()))
+				++cacheIt;
+			else
+				cacheIt = textureCache.erase(cacheIt);
+		}
+		WriteLog(QString("NetRender - texture cache cleaned, %1 textures left")
+							 .arg(textureCache.size()),
+			2);
+	}
+}
+
 QByteArray *CNetRender::GetTexture(QString textureName)
 {
 	return &textures[textureName];
 }
+
+void CNetRender::StartFrameDistribution()
+{
+	WriteLog("NetRender - start of frame distribution", 2);
+	frameDistribution = true;
+	jobTextureFiles.clear();
+	frameFileNames.clear();
+	msgCurrentJob.command = netRender_NONE;
+
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].status == netRender_READY && clients[i].frameIndex < 0) emit ClientIdle(i);
+	}
+}
+
+void CNetRender::StopFrameDistribution()
+{
+	WriteLog("NetRender - end of frame distribution", 2);
+	frameDistribution = false;
+
+	// clients still rendering frames are stopped and their results will be ignored
+	sMessage msg;
+	msg.command = netRender_STOP;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].frameIndex >= 0)
+		{
+			SendData(clients[i].socket, msg);
+			clients[i].frameIndex = -1;
+		}
+	}
+	frameFileNames.clear();
+}
+
+bool CNetRender::IsFrameAssigned(qint32 frameIndex)
+{
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].frameIndex == frameIndex) return true;
+	}
+	return false;
+}
+
+bool CNetRender::HasMemoryForFrame(int clientIndex, const cParameterContainer &frameParams)
+{
+	if (clientIndex < 0 || clientIndex >= clients.size()) return false;
+	qint64 budget = clients[clientIndex].memoryBudget;
+	if (budget < 0 || !frameParams.Get<bool>("memory_admission_control")) return true;
+
+	// scratch folder of the server doesn't exist on the client, so memory mapping isn't counted
+	sImageOptional optional = cMemoryEstimator::ImageOptionalFromParams(&frameParams);
+	optional.memoryMapped = false;
+	optional.scratchFolder.clear();
+	return cMemoryEstimator::FitToBudget(&frameParams, frameParams.Get<int>("image_width"),
+		frameParams.Get<int>("image_height"), budget, &optional);
+}
+
+qint32 CNetRender::GetNumberOfAssignedFrames()
+{
+	qint32 count = 0;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].frameIndex >= 0) count++;
+	}
+	return count;
+}
+
+QString CNetRender::GetFrameJobFileName()
+{
+	return QDir::tempPath() + QDir::separator()
+				 + QString("mandelbulber_netrender_frame_%1_").arg(QCoreApplication::applicationPid())
+				 + "." + ImageFileSave::ImageFileExtension(frameJobImageType);
+}
+
+void CNetRender::SendFrame(int clientIndex, int frameIndex, cParameterContainer settings,
+	cFractalContainer fractal, QStringList listOfTextures, int imageFileType, QString fileName)
+{
+	WriteLog(QString("NetRender - send frame %1 to client %2").arg(frameIndex).arg(clientIndex), 2);
+	if (clientIndex < clients.size())
+	{
+		sMessage msg;
+		msg.command = netRender_FRAME;
+		QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+		stream << (qint32)frameIndex;
+		stream << (qint32)imageFileType;
+		if (WriteJob(&stream, settings, fractal, listOfTextures))
+		{
+			// client gets id of messages without starting positions
+			SendSetup(clientIndex, actualId, QList<int>());
+			SendData(clients[clientIndex].socket, msg);
+
+			QFileInfo fi(fileName);
+			frameFileNames.insert(frameIndex, fi.path() + QDir::separator() + fi.baseName());
+			clients[clientIndex].frameIndex = frameIndex;
+			clients[clientIndex].linesRendered = 0;
+			clients[clientIndex].jobTimer.start();
+			MulticastJobTextures();
+		}
+	}
+	else
+	{
+		qCritical() << "CNetRender::SendFrame(): Client index out of range:" << clientIndex;
+	}
+}
+
+void CNetRender::SendRenderedFrame()
+{
+	// image can be saved in several files (channels saved separately)
+	QFileInfo fi(GetFrameJobFileName());
+	QString baseName = fi.baseName();
+	QDir dir(fi.path());
+	QStringList files = dir.entryList(QStringList(baseName + "*"), QDir::Files);
+
+	sMessage msg;
+	msg.command = netRender_FRAME_DATA;
+	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+	stream << (qint32)frameJobIndex;
+	stream << (qint32)files.size();
+	for (int i = 0; i < files.size(); i++)
+	{
+		QByteArray suffix = files[i].mid(baseName.length()).toUtf8();
+		stream << (qint32)suffix.size();
+		stream.writeRawData(suffix.data(), suffix.size());
+
+		QFile file(dir.absoluteFilePath(files[i]));
+		QByteArray buffer;
+		if (file.open(QIODevice::ReadOnly)) buffer = file.readAll();
+		stream << (qint32)buffer.size();
+		stream.writeRawData(buffer.data(), buffer.size());
+		file.remove();
+	}
+	WriteLog(QString("NetRender - send frame %1, files %2").arg(frameJobIndex).arg(files.size()), 2);
+
+	frameJobIndex = -1;
+	SendData(clientSocket, msg);
+	status = netRender_READY;
+	NotifyStatus();
+}
+
+void CNetRender::StartSlabDistribution()
+{
+	WriteLog("NetRender - start of voxel slab distribution", 2);
+	slabDistribution = true;
+	jobTextureFiles.clear();
+	msgCurrentJob.command = netRender_NONE;
+
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].status == netRender_READY && clients[i].slabIndex < 0) emit ClientIdle(i);
+	}
+}
+
+void CNetRender::StopSlabDistribution()
+{
+	WriteLog("NetRender - end of voxel slab distribution", 2);
+	slabDistribution = false;
+
+	// clients still calculating slabs are stopped and their results will be ignored
+	sMessage msg;
+	msg.command = netRender_STOP;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].slabIndex >= 0)
+		{
+			SendData(clients[i].socket, msg);
+			clients[i].slabIndex = -1;
+		}
+	}
+}
+
+bool CNetRender::IsSlabAssigned(qint32 slabIndex)
+{
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].slabIndex == slabIndex) return true;
+	}
+	return false;
+}
+
+void CNetRender::WriteVoxelSlabJob(QDataStream *stream, const sVoxelSlabJob &slab)
+{
+	*stream << slab.index << slab.firstZ << slab.numberOfLayers;
+	*stream << slab.w << slab.h << slab.l;
+	*stream << slab.limitMin.x << slab.limitMin.y << slab.limitMin.z;
+	*stream << slab.limitMax.x << slab.limitMax.y << slab.limitMax.z;
+	*stream << slab.maxIter << (qint32)slab.storeDistances;
+}
+
+sVoxelSlabJob CNetRender::ReadVoxelSlabJob(QDataStream *stream)
+{
+	sVoxelSlabJob slab;
+	qint32 storeDistances;
+	*stream >> slab.index >> slab.firstZ >> slab.numberOfLayers;
+	*stream >> slab.w >> slab.h >> slab.l;
+	*stream >> slab.limitMin.x >> slab.limitMin.y >> slab.limitMin.z;
+	*stream >> slab.limitMax.x >> slab.limitMax.y >> slab.limitMax.z;
+	*stream >> slab.maxIter >> storeDistances;
+	slab.storeDistances = storeDistances;
+	return slab;
+}
+
+void CNetRender::SendVoxelSlab(int clientIndex, const sVoxelSlabJob &slab,
+	const cParameterContainer &settings, const cFractalContainer &fractal)
+{
+	WriteLog(
+		QString("NetRender - send voxel slab %1 to client %2").arg(slab.index).arg(clientIndex), 2);
+	if (clientIndex < clients.size())
+	{
+		sMessage msg;
+		msg.command = netRender_VOXEL_SLAB;
+		QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+		WriteVoxelSlabJob(&stream, slab);
+		// textures are not used for calculation of distance estimation
+		if (WriteJob(&stream, settings, fractal, QStringList()))
+		{
+			// client gets id of messages without starting positions
+			SendSetup(clientIndex, actualId, QList<int>());
+			SendData(clients[clientIndex].socket, msg);
+
+			clients[clientIndex].slabIndex = slab.index;
+			clients[clientIndex].linesRendered = 0;
+			clients[clientIndex].jobTimer.start();
+		}
+	}
+	else
+	{
+		qCritical() << "CNetRender::SendVoxelSlab(): Client index out of range:" << clientIndex;
+	}
+}
+
+void CNetRender::SetVoxelSlabResult(const QByteArray &voxels, const QByteArray &distances)
+{
+	slabVoxels = voxels;
+	slabDistances = distances;
+}
+
+void CNetRender::SendVoxelSlabData()
+{
+	sMessage msg;
+	msg.command = netRender_VOXEL_DATA;
+	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+	stream << (qint32)slabJob.index;
+	// data of cancelled calculation is not sent, so the server calculates the slab again
+	if (!slabVoxels.isEmpty()) stream << slabVoxels << slabDistances;
+	WriteLog(QString("NetRender - send voxel slab %1, size %2")
+						 .arg(slabJob.index)
+						 .arg(slabVoxels.size()),
+		2);
+
+	slabJob = sVoxelSlabJob();
+	slabVoxels.clear();
+	slabDistances.clear();
+	SendData(clientSocket, msg);
+	status = netRender_READY;
+	NotifyStatus();
+}
+
+bool CNetRender::IsClientReadyForPostTile(int clientIndex)
+{
+	if (clientIndex < 0 || clientIndex >= clients.size()) return false;
+	return clients[clientIndex].status == netRender_READY && clients[clientIndex].postTileIndex < 0;
+}
+
+bool CNetRender::IsPostTileAssigned(qint32 tileIndex)
+{
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].postTileIndex == tileIndex) return true;
+	}
+	return false;
+}
+
+void CNetRender::SendPostTile(int clientIndex, const sPostTileJob &tile,
+	const QList<int> &lineNumbers, const QList<QByteArray> &lines)
+{
+	WriteLog(QString("NetRender - send band %1 to client %2, lines %3")
+						 .arg(tile.index)
+						 .arg(clientIndex)
+						 .arg(lineNumbers.size()),
+		2);
+	if (clientIndex < clients.size())
+	{
+		sMessage msg;
+		msg.command = netRender_POST_TILE;
+		QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+		stream << tile.index << tile.y1 << tile.y2 << tile.haloY1 << tile.haloY2;
+		stream << (qint32)lineNumbers.size();
+		for (int i = 0; i < lineNumbers.size(); i++)
+			stream << (qint32)lineNumbers.at(i) << lines.at(i);
+		SendData(clients[clientIndex].socket, msg);
+		clients[clientIndex].postTileIndex = tile.index;
+	}
+	else
+	{
+		qCritical() << "CNetRender::SendPostTile(): Client index out of range:" << clientIndex;
+	}
+}
+
+void CNetRender::StopPostTiles()
+{
+	// results of bands which are still processed will be ignored
+	sMessage msg;
+	msg.command = netRender_STOP;
+	for (int i = 0; i < clients.size(); i++)
+	{
+		if (clients[i].postTileIndex >= 0)
+		{
+			SendData(clients[i].socket, msg);
+			clients[i].postTileIndex = -1;
+		}
+	}
+}
+
+void CNetRender::TakePostTileLines(QList<int> *lineNumbers, QList<QByteArray> *lines)
+{
+	*lineNumbers = postTileLineNumbers;
+	*lines = postTileLines;
+	postTileLineNumbers.clear();
+	postTileLines.clear();
+
+	QMap<int, QByteArray>::const_iterator it = sentLines.lowerBound(postTileJob.haloY1);
+	for (; it != sentLines.constEnd() && it.key() < postTileJob.haloY2; ++it)
+	{
+		lineNumbers->append(it.key());
+		lines->append(it.value());
+	}
+}
+
+void CNetRender::SendPostTileData()
+{
+	sMessage msg;
+	msg.command = netRender_POST_DATA;
+	QDataStream stream(&msg.payload, QIODevice::WriteOnly);
+	stream << (qint32)postTileJob.index;
+	if (!postTileResult.isEmpty()) stream << postTileResult;
+	WriteLog(QString("NetRender - send band %1, size %2")
+						 .arg(postTileJob.index)
+						 .arg(postTileResult.size()),
+		2);
+
+	postTileJob = sPostTileJob();
+	postTileResult.clear();
+	SendData(clientSocket, msg);
+	status = netRender_READY;
+	NotifyStatus();
+}
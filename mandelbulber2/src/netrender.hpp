@@ -41,9 +41,54 @@
 
 #include "parameters.hpp"
 #include "fractal_container.hpp"
+#include "file_image.hpp"
+
+// speed of client is not measured before this time since start of job [s]
+#define NETRENDER_MIN_SPEED_MEASUREMENT_TIME 1.0
+// textures kept by client between jobs [bytes]
+#define NETRENDER_TEXTURE_CACHE_SIZE (512 * 1024 * 1024)
+// interval of status requests sent by server to check if clients are alive [ms]
+#define NETRENDER_HEARTBEAT_INTERVAL 1000
+// change of client reliability after successful job and after lost connection
+#define NETRENDER_RELIABILITY_GAIN 0.1
+#define NETRENDER_RELIABILITY_LOSS 0.5
 
 // forward declarations
 struct sRenderData;
+class cNetRenderMulticast;
+
+// part of volume (range of Z layers) calculated by client in distributed voxel export
+struct sVoxelSlabJob
+{
+	sVoxelSlabJob()
+			: index(-1),
+				firstZ(0),
+				numberOfLayers(0),
+				w(0),
+				h(0),
+				l(0),
+				maxIter(0),
+				storeDistances(false)
+	{
+	}
+	qint32 index;
+	qint32 firstZ;
+	qint32 numberOfLayers;
+	qint32 w, h, l; // size of the whole volume
+	CVector3 limitMin;
+	CVector3 limitMax;
+	qint32 maxIter;
+	bool storeDistances;
+};
+
+// band of lines of still image post-processed by client. Halo lines are used only as input
+struct sPostTileJob
+{
+	sPostTileJob() : index(-1), y1(0), y2(0), haloY1(0), haloY2(0) {}
+	qint32 index;
+	qint32 y1, y2; // lines of the band
+	qint32 haloY1, haloY2; // lines needed by the effects
+};
 
 class CNetRender : public QObject
 {
@@ -66,7 +111,16 @@ public:
 		netRender_STOP,
 		netRender_STATUS,
 		netRender_SETUP,
-		netRender_ACK
+		netRender_ACK,
+		netRender_TEXTURE_REQUEST,
+		netRender_TEXTURES,
+		netRender_FRAME,
+		netRender_FRAME_DATA,
+		netRender_JOB_NEXT,
+		netRender_VOXEL_SLAB,
+		netRender_VOXEL_DATA,
+		netRender_POST_TILE,
+		netRender_POST_DATA
 	};
 	// VERSION - ask for server version
 	// WORKER - ask for number of client CPU count
@@ -74,11 +128,27 @@ public:
 	// rendered first
 	// DATA - data of rendered lines (to Server)
 	// BAD - answer about wrong server version
-	// JOB - settings and textures for clients (to clients). Receiving of job will start rendering
+	// JOB - settings, names and content hashes of textures for clients (to clients). Receiving of
+	// job will start rendering if all textures are in the client cache
 	// STOP - terminate rendering request (to clients)
 	// STATUS - ask for status (to client)
 	// SETUP - setup job id and starting positions
 	// ACK - acknowledge after receive rendered lines
+	// TEXTURE_REQUEST - list of hashes of textures missing in the client cache (to server)
+	// TEXTURES - content of requested textures (to client). Receiving of textures will start
+	// rendering
+	// FRAME - animation frame to render as a whole (to client). Followed by the same data as JOB
+	// FRAME_DATA - image files of rendered animation frame (to server)
+	// JOB_NEXT - id, starting positions and the same data as JOB for the next animation frame (to
+	// client). Client starts it just after finishing the current job
+	// VOXEL_SLAB - range of layers of voxel export to calculate (to client). Followed by the same
+	// data as JOB
+	// VOXEL_DATA - compressed voxels and distances of calculated slab (to server). Empty data means
+	// that the slab was not calculated
+	// POST_TILE - band of lines to post-process with lines of the band which were not rendered by
+	// the client (to client)
+	// POST_DATA - compressed post-processed lines of the band (to server). Empty data means that the
+	// band was not processed
 
 	enum netRenderStatus
 	{
@@ -100,8 +170,11 @@ public:
 	{
 		netRender_CLIENT,
 		netRender_SERVER,
-		netRender_UNKNOWN
+		netRender_UNKNOWN,
+		netRender_RELAY
 	};
+	// RELAY - client of the main server and server for a group of clients. It doesn't render, but
+	// forwards jobs to its clients and sends their rendered lines to the server aggregated
 
 	enum enumUiNetRenderMode
 	{
@@ -125,12 +198,37 @@ public:
 	// all information about connected clients
 	struct sClient
 	{
-		sClient() : socket(NULL), status(netRender_NEW), linesRendered(0), clientWorkerCount(0) {}
+		sClient()
+				: socket(NULL),
+					status(netRender_NEW),
+					linesRendered(0),
+					clientWorkerCount(0),
+					linesPerSecond(0.0),
+					reliability(1.0),
+					frameIndex(-1),
+					slabIndex(-1),
+					postTileIndex(-1),
+					memoryBudget(-1),
+					bytesSent(0),
+					bytesReceived(0)
+		{
+		}
 		QTcpSocket *socket;
 		sMessage msg;
 		netRenderStatus status;
 		qint32 linesRendered;
 		qint32 clientWorkerCount;
+		double linesPerSecond; // measured throughput, kept between jobs (0 if unknown)
+		double reliability; // 1.0 for client which never failed, lowered when it stops responding
+		QElapsedTimer jobTimer; // time since the job was sent to the client
+		QElapsedTimer lastActivity; // time since the last message from the client
+		qint32 frameIndex; // animation frame rendered by the client (-1 if none)
+		qint32 slabIndex; // slab of voxel export calculated by the client (-1 if none)
+		qint32 postTileIndex; // band of still image post-processed by the client (-1 if none)
+		QSet<int> receivedLines; // lines of the current job received from the client
+		qint64 memoryBudget; // memory for render jobs reported by the client (-1 if unknown)
+		qint64 bytesSent; // traffic since connection of the client (for resource reports)
+		qint64 bytesReceived;
 		QString name;
 	};
 
@@ -140,6 +238,8 @@ public:
 	bool IsServer() { return deviceType == netRender_SERVER; }
 	// ask if client is connected
 	bool IsClient() { return deviceType == netRender_CLIENT; }
+	// ask if relay is established
+	bool IsRelay() { return deviceType == netRender_RELAY; }
 	// initializing server
 	void SetServer(qint32 portNo);
 	// deleting server
@@ -148,6 +248,8 @@ public:
 	void SetClient(QString address, qint32 portNo);
 	// deleting client
 	void DeleteClient();
+	// initializing relay connected to the server and listening for clients on local port
+	void SetRelay(QString address, qint32 portNo, qint32 localPortNo);
 
 	// get client
 	const sClient &GetClient(int index);
@@ -157,6 +259,9 @@ public:
 	qint32 GetWorkerCount(qint32 index) { return clients[index].clientWorkerCount; }
 	// get total number of available CPUs
 	qint32 getTotalWorkerCount();
+	// get relative speed of one CPU of selected client (1.0 = average of all measured clients)
+	// weighted by reliability of the client. Speed of stalled client is 0
+	double GetRelativeWorkerSpeed(qint32 index);
 	// get status
 	netRenderStatus GetStatus() { return status; }
 	// update status
@@ -181,6 +286,60 @@ public:
 	bool Block();
 	void Release() { isUsed = false; }
 
+	// distribution of whole animation frames between clients
+	void StartFrameDistribution();
+	void StopFrameDistribution();
+	bool IsFrameAssigned(qint32 frameIndex);
+	// checks if client has enough memory to render frame at least with the most compact buffers
+	bool HasMemoryForFrame(int clientIndex, const cParameterContainer &frameParams);
+	qint32 GetNumberOfAssignedFrames();
+	// client is rendering the whole animation frame received with FRAME command
+	bool IsFrameJob() { return frameJobIndex >= 0; }
+	ImageFileSave::enumImageFileType GetFrameJobImageType() { return frameJobImageType; }
+	// name of the file (without extension) where client saves rendered frame
+	QString GetFrameJobFileName();
+
+	// pipelining of animation frames: next job is sent while clients are finishing the current one
+	void SetNextJob(qint32 id, QList<QList<int> > clientStartingPositions,
+		const cParameterContainer &settings, const cFractalContainer &fractal,
+		const QStringList &listOfTextures);
+	// makes already sent next job the current one if it has the same settings
+	bool ActivateNextJob(const cParameterContainer &settings, const cFractalContainer &fractal);
+	void CancelNextJob();
+	bool HasNextJob() { return nextJobSent; }
+	// lines of next job received before it was activated
+	void TakeNextJobLines(QList<int> *lineNumbers, QList<QByteArray> *lines);
+
+	// distribution of slabs of voxel export between clients
+	void StartSlabDistribution();
+	void StopSlabDistribution();
+	bool IsSlabAssigned(qint32 slabIndex);
+	// server: send slab to be calculated by selected client
+	void SendVoxelSlab(int clientIndex, const sVoxelSlabJob &slab,
+		const cParameterContainer &settings, const cFractalContainer &fractal);
+	// client is calculating slab of voxel export received with VOXEL_SLAB command
+	bool IsSlabJob() { return slabJob.index >= 0; }
+	const sVoxelSlabJob &GetSlabJob() { return slabJob; }
+	// client: result of slab calculation, sent to the server by SendVoxelSlabData(). Empty voxels
+	// mean that calculation was cancelled
+	void SetVoxelSlabResult(const QByteArray &voxels, const QByteArray &distances);
+
+	// server: post-processing of still image in bands
+	bool IsClientReadyForPostTile(int clientIndex);
+	const QSet<int> &GetClientReceivedLines(int clientIndex)
+	{
+		return clients[clientIndex].receivedLines;
+	}
+	bool IsPostTileAssigned(qint32 tileIndex);
+	void SendPostTile(int clientIndex, const sPostTileJob &tile, const QList<int> &lineNumbers,
+		const QList<QByteArray> &lines);
+	void StopPostTiles();
+	// client: band to post-process received with POST_TILE command
+	const sPostTileJob &GetPostTileJob() { return postTileJob; }
+	// lines of the band rendered by the client and received from the server
+	void TakePostTileLines(QList<int> *lineNumbers, QList<QByteArray> *lines);
+	void SetPostTileResult(const QByteArray &data) { postTileResult = data; }
+
 private:
 	// send data to communication partner
 	bool SendData(QTcpSocket *socket, sMessage msg);
@@ -194,6 +353,43 @@ private:
 	int GetClientIndexFromSocket(const QTcpSocket *socket);
 	// compare major version of software
 	bool CompareMajorVersion(qint32 version1, qint32 version2);
+	// load received settings and start rendering of job
+	void StartJob();
+	// remove from texture cache textures not used by current job if the cache is too big
+	void CleanTextureCache();
+	// write settings and hashes of textures for JOB or FRAME message
+	bool WriteJob(QDataStream *stream, const cParameterContainer &settings,
+		const cFractalContainer &fractal, const QStringList &listOfTextures);
+	// read settings and textures of JOB or FRAME message
+	void ReadJob(QDataStream *stream);
+	// description of slab at the beginning of VOXEL_SLAB message
+	static void WriteVoxelSlabJob(QDataStream *stream, const sVoxelSlabJob &slab);
+	static sVoxelSlabJob ReadVoxelSlabJob(QDataStream *stream);
+	// lower reliability of client which stopped responding or disconnected during the job
+	void DecreaseReliability(int index);
+	// start connecting to the server (used by client and relay)
+	void ConnectToServer(QString address, qint32 portNo);
+	void DisconnectFromServer();
+	// relay: process message from the server or from one of relay clients
+	void ProcessRelayDataFromServer(sMessage *inMsg);
+	// relay: returns false if the client was removed
+	bool ProcessRelayDataFromClient(QTcpSocket *socket, int index, sMessage *inMsg);
+	// relay: send total number of CPUs of relay clients to the server
+	void SendRelayWorkers();
+	// relay: split starting positions received from the server between relay clients
+	QList<QList<int> > SplitRelayStartingPositions(const QList<int> &positions);
+	// relay: send aggregated rendered lines if the server acknowledged previous ones
+	void FlushRelayData();
+	// relay: status of relay is WORKING if any of its clients works
+	void UpdateRelayStatus();
+	// start rendering of job received with JOB_NEXT command
+	void StartNextJob();
+	// server: send content of textures of the job to multicast group (if enabled)
+	void MulticastJobTextures();
+	// client: ask server for content of textures over TCP
+	void SendTextureRequest(const QList<QByteArray> &hashes);
+	// client: put received texture content to the cache and start the job if it was the last one
+	void TextureContentArrived(const QByteArray &hash, const QByteArray &content);
 
 	//---------------- private data -----------------
 private:
@@ -212,6 +408,10 @@ private:
 	sMessage msgFromServer;
 	sMessage msgCurrentJob;
 	QTimer *reconnectTimer;
+	QTimer *heartbeatTimer;
+	QElapsedTimer lastHeartbeat;
+	cNetRenderMulticast *multicast; // texture distribution over UDP multicast
+	QTimer *multicastWaitTimer; // client: waiting for textures from multicast group
 
 	// client data buffers
 	QString settingsText;
@@ -219,6 +419,44 @@ private:
 	QList<int> startingPositions;
 	bool isUsed;
 	QMap<QString, QByteArray> textures;
+	QHash<QByteArray, QByteArray> textureCache; // texture content by its hash, kept between jobs
+	QMultiMap<QByteArray, QString> missingTextures; // names of textures waiting for content
+	QSet<QByteArray> jobTextureHashes; // hashes of textures used by current job
+	qint32 frameJobIndex; // animation frame to render (-1 for rendering of lines)
+	ImageFileSave::enumImageFileType frameJobImageType;
+	sVoxelSlabJob slabJob; // slab of voxel export to calculate (index -1 for other jobs)
+	QByteArray slabVoxels; // compressed result of slab calculation
+	QByteArray slabDistances;
+	QMap<int, QByteArray> sentLines; // lines of the current job sent to the server
+	sPostTileJob postTileJob; // band to post-process (index -1 if none)
+	QList<int> postTileLineNumbers; // lines of the band received with POST_TILE
+	QList<QByteArray> postTileLines;
+	QByteArray postTileResult;
+	bool nextJobPending; // JOB_NEXT received and not started yet
+	QList<int> nextJobStartingPositions;
+
+	// next job data buffers (client and server)
+	qint32 nextJobId;
+	QByteArray nextJobPayload;
+
+	// server data buffers
+	QMap<QByteArray, QString> jobTextureFiles; // files of textures of current job by content hash
+	QMap<qint32, QString> frameFileNames; // files of frames rendered by clients
+	QHash<QString, double> clientReliability; // kept by client name for reconnecting clients
+
+	// relay data buffers
+	bool relayConnected; // VERSION of the server was accepted
+	QMap<qint32, QByteArray> relayData; // rendered lines of clients by job id, not sent yet
+	qint32 relayAcksPending; // DATA messages not acknowledged by the server
+	QList<QTcpSocket *> relayTextureRequests; // clients waiting for TEXTURES, in order of requests
+	QTcpSocket *relayFrameClient; // client rendering animation frame received from the server
+	QTcpSocket *relaySlabClient; // client calculating slab of voxel export received from the server
+	bool frameDistribution;
+	bool slabDistribution;
+	bool nextJobSent; // JOB_NEXT sent and not activated yet
+	QString nextJobSettingsText;
+	QList<int> nextJobLineNumbers;
+	QList<QByteArray> nextJobLines;
 
 	//------------------- public slots -------------------
 public slots:
@@ -235,6 +473,15 @@ public slots:
 	void StopAll();
 	// send client id and list of list of lines to render at the beginning to selected client
 	void SendSetup(int clientIndex, int id, QList<int> startingPositions);
+	// send animation frame to be rendered by selected client and saved to given file
+	void SendFrame(int clientIndex, int frameIndex, cParameterContainer settings,
+		cFractalContainer fractal, QStringList listOfTextures, int imageFileType, QString fileName);
+	// send files of rendered frame to server
+	void SendRenderedFrame();
+	// send result of slab calculation to server
+	void SendVoxelSlabData();
+	// send post-processed band to server
+	void SendPostTileData();
 
 	//------------------- private slots ------------------
 private slots:
@@ -250,6 +497,12 @@ private slots:
 	void ReceiveFromServer();
 	// try to connect to server
 	void TryServerConnect();
+	// send status requests to clients and mark clients which don't answer as stalled
+	void CheckClients();
+	// texture received from multicast group
+	void MulticastTextureReceived(QByteArray hash, QByteArray content);
+	// request over TCP textures which didn't arrive from multicast group
+	void RequestMissingTextures();
 
 signals:
 	// request to update table of clients
@@ -262,6 +515,14 @@ signals:
 	void ToDoListArrived(QList<int> done);
 	// confirmation of data receive
 	void AckReceived();
+	// client can get next animation frame in frame distribution mode
+	void ClientIdle(int clientIndex);
+	// files of animation frame rendered by client were saved (success = false if client failed)
+	void FrameReceived(int frameIndex, bool success);
+	// compressed data of slab of voxel export calculated by client (empty if client failed)
+	void VoxelSlabReceived(int slabIndex, QByteArray voxels, QByteArray distances);
+	// compressed lines of band post-processed by client (empty if client failed)
+	void PostTileReceived(int tileIndex, QByteArray data);
 
 	void NewStatusClient();
 	void NewStatusServer();
@@ -0,0 +1,233 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderLineDecoder class - decoding of lines received from NetRender clients
+ */
+
+#include "netrender_line_decoder.hpp"
+
+#include <cstring>
+#include <QtCore>
+#include <zlib.h>
+
+#include "cimage.hpp"
+#include "half_float.h"
+
+// sequential reading of line data: raw bytes or zlib stream created by qCompress()
+class cLineDataReader
+{
+public:
+	cLineDataReader(const char *data, int size, bool _compressed);
+	~cLineDataReader();
+	// size of uncompressed data (-1 if stream header is wrong)
+	int GetSize() const { return totalSize; }
+	// copies next bytes of data to destination. Returns false if data is corrupted
+	bool Read(void *destination, int size);
+
+private:
+	z_stream stream;
+	bool compressed;
+	const char *cursor;
+	int remaining;
+	int totalSize;
+};
+
+cLineDataReader::cLineDataReader(const char *data, int size, bool _compressed)
+{
+	compressed = _compressed;
+	cursor = data;
+	remaining = size;
+	totalSize = size;
+	memset(&stream, 0, sizeof(stream));
+
+	if (compressed)
+	{
+		// qCompress() writes big endian size of uncompressed data before zlib stream
+		totalSize = -1;
+		if (size < 4) return;
+		const uchar *header = (const uchar *)data;
+		int expectedSize = (header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+		stream.next_in = (Bytef *)(data + 4);
+		stream.avail_in = size - 4;
+		if (inflateInit(&stream) == Z_OK)
+			totalSize = expectedSize;
+		else
+			compressed = false;
+	}
+}
+
+cLineDataReader::~cLineDataReader()
+{
+	if (compressed) inflateEnd(&stream);
+}
+
+bool cLineDataReader::Read(void *destination, int size)
+{
+	if (!compressed)
+	{
+		if (size > remaining) return false;
+		memcpy(destination, cursor, size);
+		cursor += size;
+		remaining -= size;
+		return true;
+	}
+
+	stream.next_out = (Bytef *)destination;
+	stream.avail_out = size;
+	while (stream.avail_out > 0)
+	{
+		int result = inflate(&stream, Z_NO_FLUSH);
+		if (result == Z_STREAM_END) return stream.avail_out == 0;
+		if (result != Z_OK) return false;
+	}
+	return true;
+}
+
+cNetRenderLineDecoder::cNetRenderLineDecoder(cImage *_image) : QObject()
+{
+	image = _image;
+}
+
+cNetRenderLineDecoder::~cNetRenderLineDecoder()
+{
+	// nothing to delete
+}
+
+int cNetRenderLineDecoder::LinePixelSize(int flags)
+{
+	int floatSize = (flags & lineDataHalfFloat) ? sizeof(unsigned short) : sizeof(float);
+	int size = 3 * floatSize + sizeof(unsigned short) + sizeof(float); // image, alpha, zBuffer
+	if (flags & lineDataColour) size += sizeof(sRGB8);
+	if (flags & lineDataOpacity) size += sizeof(unsigned short);
+	if (flags & lineDataNormal) size += 3 * floatSize;
+	return size;
+}
+
+void cNetRenderLineDecoder::slotDecodeLines(QList<int> lineNumbers, QList<QByteArray> lines)
+{
+	QList<int> decoded;
+	for (int i = 0; i < lineNumbers.size(); i++)
+	{
+		// only the malformed line is skipped, the following ones are still valid
+		if (!DecodeLine(lineNumbers.at(i), lines.at(i))) continue;
+		decoded.append(lineNumbers.at(i));
+	}
+
+	mutex.lock();
+	decodedLines.append(decoded);
+	mutex.unlock();
+}
+
+QList<int> cNetRenderLineDecoder::TakeDecodedLines()
+{
+	mutex.lock();
+	QList<int> list = decodedLines;
+	decodedLines.clear();
+	mutex.unlock();
+	return list;
+}
+
+bool cNetRenderLineDecoder::DecodeLine(int y, const QByteArray &line)
+{
+	if (y < 0 || y >= image->GetHeight() || line.size() == 0)
+	{
+		qCritical() << "cNetRenderLineDecoder::DecodeLine(int y, const QByteArray &line): "
+									 "wrong line number:"
+								<< y;
+		return false;
+	}
+
+	int width = image->GetWidth();
+	int flags = (unsigned char)line.at(0);
+	bool halfFloat = flags & lineDataHalfFloat;
+
+	cLineDataReader reader(line.constData() + 1, line.size() - 1, flags & lineDataCompressed);
+	if (reader.GetSize() != LinePixelSize(flags) * width)
+	{
+		qCritical() << "cNetRenderLineDecoder::DecodeLine(int y, const QByteArray &line): "
+									 "wrong size of line data:"
+								<< y;
+		return false;
+	}
+
+	// channels are read directly to rows of image buffers
+	long int offset = long(y) * width;
+	sRGBfloat *imageFloat = image->GetImageFloatPtr();
+	sRGBhalf *imageHalf = image->GetImageHalfPtr();
+	bool ok = ReadLineRGB(&reader, imageFloat ? imageFloat + offset : NULL,
+		imageHalf ? imageHalf + offset : NULL, width, halfFloat);
+	ok = ok && reader.Read(image->GetAlphaBufPtr() + offset, width * sizeof(unsigned short));
+	ok = ok && reader.Read(image->GetZBufferPtr() + offset, width * sizeof(float));
+	if (flags & lineDataColour)
+		ok = ok && reader.Read(image->GetColorPtr() + offset, width * sizeof(sRGB8));
+	if (flags & lineDataOpacity)
+		ok = ok && reader.Read(image->GetOpacityPtr() + offset, width * sizeof(unsigned short));
+	if (flags & lineDataNormal)
+	{
+		// normals are skipped if the image doesn't have normal buffer
+		sRGBfloat *normalFloat = image->GetNormalFloatPtr();
+		sRGBhalf *normalHalf = image->GetNormalHalfPtr();
+		ok = ok && ReadLineRGB(&reader, normalFloat ? normalFloat + offset : NULL,
+								 normalHalf ? normalHalf + offset : NULL, width, halfFloat);
+	}
+
+	if (!ok)
+	{
+		qCritical() << "cNetRenderLineDecoder::DecodeLine(int y, const QByteArray &line): "
+									 "corrupted line data:"
+								<< y;
+	}
+	return ok;
+}
+
+bool cNetRenderLineDecoder::ReadLineRGB(
+	cLineDataReader *reader, sRGBfloat *floatRow, sRGBhalf *halfRow, int width, bool halfFloat)
+{
+	// the same precision as in the buffer, so data doesn't need conversion
+	if (halfFloat && halfRow) return reader->Read(halfRow, width * sizeof(sRGBhalf));
+	if (!halfFloat && floatRow) return reader->Read(floatRow, width * sizeof(sRGBfloat));
+
+	int size = width * (halfFloat ? sizeof(sRGBhalf) : sizeof(sRGBfloat));
+	if (conversionBuffer.size() < size) conversionBuffer.resize(size);
+	if (!reader->Read(conversionBuffer.data(), size)) return false;
+
+	if (halfFloat && floatRow)
+	{
+		HalfToPixelArray((const sRGBhalf *)conversionBuffer.constData(), floatRow, width);
+	}
+	else if (!halfFloat && halfRow)
+	{
+		const sRGBfloat *source = (const sRGBfloat *)conversionBuffer.constData();
+		for (int x = 0; x < width; x++)
+			halfRow[x] = PixelToHalf(source[x]);
+	}
+	return true;
+}
@@ -0,0 +1,95 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderLineDecoder class - decoding of lines received from NetRender clients
+ *
+ * Lines are decompressed and written to the image in separate thread, so the thread
+ * which receives data from the network and supervises rendering is not blocked by it.
+ * Decoded line numbers are collected until the renderer takes them.
+ * Channels of line data have the same layout as rows of image buffers, so they are
+ * decompressed directly to the image memory. Only float / half float conversion goes
+ * through intermediate buffer.
+ */
+
+#ifndef MANDELBULBER2_SRC_NETRENDER_LINE_DECODER_HPP_
+#define MANDELBULBER2_SRC_NETRENDER_LINE_DECODER_HPP_
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+
+#include "color_structures.hpp"
+
+// forward declarations
+class cImage;
+class cLineDataReader;
+struct sRGBhalf;
+
+// flags stored in the first byte of every line sent by NetRender client
+enum enumLineDataFlags
+{
+	lineDataColour = 1,
+	lineDataOpacity = 2,
+	lineDataNormal = 4,
+	lineDataHalfFloat = 8,
+	lineDataCompressed = 16
+};
+
+class cNetRenderLineDecoder : public QObject
+{
+	Q_OBJECT
+public:
+	cNetRenderLineDecoder(cImage *_image);
+	~cNetRenderLineDecoder();
+
+	// size of one pixel of line data with given flags [bytes]
+	static int LinePixelSize(int flags);
+	// numbers of lines decoded since last call
+	QList<int> TakeDecodedLines();
+
+public slots:
+	void slotDecodeLines(QList<int> lineNumbers, QList<QByteArray> lines);
+
+private:
+	// returns false if data is corrupted
+	bool DecodeLine(int y, const QByteArray &line);
+	// reads RGB channel to full or half precision buffer (one of them is NULL)
+	bool ReadLineRGB(cLineDataReader *reader, sRGBfloat *floatRow, sRGBhalf *halfRow, int width,
+		bool halfFloat);
+
+	cImage *image;
+	QByteArray conversionBuffer; // reused for every line
+	QMutex mutex;
+	QList<int> decodedLines;
+};
+
+#endif /* MANDELBULBER2_SRC_NETRENDER_LINE_DECODER_HPP_ */
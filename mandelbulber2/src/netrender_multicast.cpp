@@ -0,0 +1,281 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderMulticast class - UDP multicast of texture content to NetRender clients
+ */
+
+#include "netrender_multicast.hpp"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include "system.hpp"
+
+// first bytes of every datagram, to ignore foreign traffic on the same port
+#define NETRENDER_MULTICAST_MAGIC 0x4d42544d
+
+cNetRenderMulticast::cNetRenderMulticast(QObject *parent) : QObject(parent)
+{
+	socket = NULL;
+	sendTimer = NULL;
+	port = 0;
+	chunksPerInterval = 1;
+}
+
+cNetRenderMulticast::~cNetRenderMulticast()
+{
+	Stop();
+}
+
+bool cNetRenderMulticast::StartSender(const QHostAddress &_group, quint16 _port, int rate)
+{
+	Stop();
+	group = _group;
+	port = _port;
+
+	// bandwidth is limited, because datagrams sent too fast are dropped by switches and clients
+	chunksPerInterval = qMax(1, int(rate * 1024.0 * 1024.0 * NETRENDER_MULTICAST_SEND_INTERVAL
+																	/ 1000.0 / NETRENDER_MULTICAST_CHUNK_SIZE));
+
+	socket = new QUdpSocket(this);
+	if (!socket->bind(QHostAddress(QHostAddress::AnyIPv4), 0))
+	{
+		WriteLog("NetRender - cannot create multicast socket: " + socket->errorString(), 1);
+		Stop();
+		return false;
+	}
+
+	sendTimer = new QTimer(this);
+	sendTimer->setInterval(NETRENDER_MULTICAST_SEND_INTERVAL);
+	connect(sendTimer, SIGNAL(timeout()), this, SLOT(SendChunks()));
+
+	WriteLog(QString("NetRender - multicast sender, group %1, port %2")
+						 .arg(group.toString())
+						 .arg(port),
+		2);
+	return true;
+}
+
+bool cNetRenderMulticast::StartReceiver(const QHostAddress &_group, quint16 _port)
+{
+	Stop();
+	group = _group;
+	port = _port;
+
+	socket = new QUdpSocket(this);
+	if (!socket->bind(QHostAddress(QHostAddress::AnyIPv4), port,
+				QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)
+			|| !socket->joinMulticastGroup(group))
+	{
+		WriteLog("NetRender - cannot join multicast group: " + socket->errorString(), 1);
+		Stop();
+		return false;
+	}
+
+	// big buffer is needed to not lose datagrams while main thread is busy
+	socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 8 * 1024 * 1024);
+	connect(socket, SIGNAL(readyRead()), this, SLOT(ReadDatagrams()));
+
+	WriteLog(QString("NetRender - multicast receiver, group %1, port %2")
+						 .arg(group.toString())
+						 .arg(port),
+		2);
+	return true;
+}
+
+void cNetRenderMulticast::Stop()
+{
+	if (sendTimer)
+	{
+		sendTimer->stop();
+		delete sendTimer;
+		sendTimer = NULL;
+	}
+	if (socket)
+	{
+		socket->close();
+		delete socket;
+		socket = NULL;
+	}
+	sendQueue.clear();
+	sentHashes.clear();
+	incoming.clear();
+	completedHashes.clear();
+	lastChunkTimer.invalidate();
+}
+
+void cNetRenderMulticast::Send(const QByteArray &hash, const QByteArray &content)
+{
+	if (!sendTimer || hash.isEmpty() || content.isEmpty()) return;
+	if (sentHashes.contains(hash)) return;
+	sentHashes.insert(hash);
+
+	sOutgoingTexture texture;
+	texture.hash = hash;
+	texture.content = content;
+	sendQueue.append(texture);
+	if (!sendTimer->isActive()) sendTimer->start();
+
+	WriteLog(QString("NetRender - multicast of texture, size %1").arg(content.size()), 2);
+}
+
+void cNetRenderMulticast::SendChunks()
+{
+	int sent = 0;
+	while (!sendQueue.isEmpty() && sent < chunksPerInterval)
+	{
+		sOutgoingTexture &texture = sendQueue.first();
+		QByteArray datagram = EncodeChunk(texture.hash, texture.content, texture.nextChunk);
+		if (socket->writeDatagram(datagram, group, port) < 0)
+		{
+			// send buffer is full. The same chunk is sent in the next interval
+			break;
+		}
+		sent++;
+		texture.nextChunk++;
+		if (texture.nextChunk >= NumberOfChunks(texture.content.size())) sendQueue.removeFirst();
+	}
+	if (sendQueue.isEmpty()) sendTimer->stop();
+}
+
+void cNetRenderMulticast::ReadDatagrams()
+{
+	while (socket && socket->hasPendingDatagrams())
+	{
+		QByteArray datagram;
+		datagram.resize(int(socket->pendingDatagramSize()));
+		socket->readDatagram(datagram.data(), datagram.size());
+
+		QByteArray hash;
+		QByteArray content;
+		if (ProcessDatagram(datagram, &hash, &content)) emit TextureReceived(hash, content);
+	}
+}
+
+bool cNetRenderMulticast::IsReceiving() const
+{
+	// textures are sent one after another, so any chunk means that the transfer is not finished
+	return lastChunkTimer.isValid() && lastChunkTimer.elapsed() < NETRENDER_MULTICAST_TIMEOUT;
+}
+
+void cNetRenderMulticast::Discard(const QByteArray &hash)
+{
+	incoming.remove(hash);
+	completedHashes.insert(hash);
+}
+
+int cNetRenderMulticast::NumberOfChunks(int contentSize)
+{
+	return (contentSize + NETRENDER_MULTICAST_CHUNK_SIZE - 1) / NETRENDER_MULTICAST_CHUNK_SIZE;
+}
+
+QByteArray cNetRenderMulticast::EncodeChunk(
+	const QByteArray &hash, const QByteArray &content, int chunkIndex)
+{
+	//			datagram format
+	// | quint32 | qint32		| hash	| qint32				| qint32			| 0 - CHUNK_SIZE |
+	// | magic	 | hashSize	|				| contentSize		| chunkIndex	| chunk data		 |
+
+	int start = chunkIndex * NETRENDER_MULTICAST_CHUNK_SIZE;
+	int size = qMin(NETRENDER_MULTICAST_CHUNK_SIZE, content.size() - start);
+
+	QByteArray datagram;
+	QDataStream stream(&datagram, QIODevice::WriteOnly);
+	stream << (quint32)NETRENDER_MULTICAST_MAGIC;
+	stream << (qint32)hash.size();
+	stream.writeRawData(hash.data(), hash.size());
+	stream << (qint32)content.size();
+	stream << (qint32)chunkIndex;
+	stream.writeRawData(content.data() + start, size);
+	return datagram;
+}
+
+bool cNetRenderMulticast::ProcessDatagram(
+	const QByteArray &datagram, QByteArray *hash, QByteArray *content)
+{
+	QDataStream stream(datagram);
+	quint32 magic;
+	qint32 hashSize;
+	stream >> magic >> hashSize;
+	if (stream.status() != QDataStream::Ok || magic != NETRENDER_MULTICAST_MAGIC) return false;
+	if (hashSize <= 0 || hashSize > 64) return false;
+
+	QByteArray chunkHash;
+	chunkHash.resize(hashSize);
+	stream.readRawData(chunkHash.data(), hashSize);
+	qint32 contentSize;
+	qint32 chunkIndex;
+	stream >> contentSize >> chunkIndex;
+	if (stream.status() != QDataStream::Ok) return false;
+	if (completedHashes.contains(chunkHash)) return false;
+
+	// size is checked before number of chunks is calculated, so the sum can't overflow
+	if (contentSize <= 0 || contentSize > NETRENDER_MULTICAST_MAX_SIZE) return false;
+	int numberOfChunks = NumberOfChunks(contentSize);
+	if (chunkIndex < 0 || chunkIndex >= numberOfChunks) return false;
+
+	int start = chunkIndex * NETRENDER_MULTICAST_CHUNK_SIZE;
+	int size = qMin(NETRENDER_MULTICAST_CHUNK_SIZE, contentSize - start);
+	if (datagram.size() - int(stream.device()->pos()) != size) return false;
+
+	sIncomingTexture &texture = incoming[chunkHash];
+	if (texture.content.size() != contentSize)
+	{
+		// new transfer (or size doesn't match, so previous chunks are not valid)
+		texture.content.resize(contentSize);
+		texture.received.fill(false, numberOfChunks);
+		texture.receivedChunks = 0;
+	}
+	lastChunkTimer.start();
+
+	if (texture.received.testBit(chunkIndex)) return false;
+	stream.readRawData(texture.content.data() + start, size);
+	texture.received.setBit(chunkIndex);
+	texture.receivedChunks++;
+
+	if (texture.receivedChunks < numberOfChunks) return false;
+
+	// all chunks are in place. Content is accepted only if it matches the hash
+	QByteArray completedContent = texture.content;
+	incoming.remove(chunkHash);
+	completedHashes.insert(chunkHash);
+	if (QCryptographicHash::hash(completedContent, QCryptographicHash::Sha1) != chunkHash)
+	{
+		WriteLog("NetRender - multicast texture doesn't match its hash", 1);
+		return false;
+	}
+
+	*hash = chunkHash;
+	*content = completedContent;
+	return true;
+}
@@ -0,0 +1,134 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderMulticast class - UDP multicast of texture content to NetRender clients
+ *
+ * Server sends content of each texture once to the multicast group instead of sending
+ * it to every client separately. Content is split into chunks which fit in a single
+ * datagram. Client collects chunks and reports texture when its hash is verified.
+ * Textures which are not completed (lost datagrams, client connected later) are
+ * requested with TEXTURE_REQUEST over TCP as before.
+ */
+
+#ifndef MANDELBULBER2_SRC_NETRENDER_MULTICAST_HPP_
+#define MANDELBULBER2_SRC_NETRENDER_MULTICAST_HPP_
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+// size of texture content in one datagram (fits in ethernet frame with headers) [bytes]
+#define NETRENDER_MULTICAST_CHUNK_SIZE 1200
+// interval between portions of sent datagrams [ms]
+#define NETRENDER_MULTICAST_SEND_INTERVAL 10
+// time without new chunks after which client requests missing textures over TCP [ms]
+#define NETRENDER_MULTICAST_TIMEOUT 1000
+// textures bigger than this are not accepted by client [bytes]
+#define NETRENDER_MULTICAST_MAX_SIZE (512 * 1024 * 1024)
+
+// forward declarations
+class QUdpSocket;
+class QTimer;
+
+class cNetRenderMulticast : public QObject
+{
+	Q_OBJECT
+public:
+	cNetRenderMulticast(QObject *parent = NULL);
+	~cNetRenderMulticast();
+
+	// server: socket for sending to the group with limited bandwidth [MB/s]
+	bool StartSender(const QHostAddress &_group, quint16 _port, int rate);
+	// client: join the group and listen for texture chunks
+	bool StartReceiver(const QHostAddress &_group, quint16 _port);
+	void Stop();
+	bool IsActive() const { return socket != NULL; }
+
+	// server: queue texture for sending. Every texture is sent only once
+	void Send(const QByteArray &hash, const QByteArray &content);
+	bool WasSent(const QByteArray &hash) const { return sentHashes.contains(hash); }
+	bool IsSending() const { return !sendQueue.isEmpty(); }
+
+	// client: chunks arrived recently, so it's worth to wait for missing textures
+	bool IsReceiving() const;
+	// client: texture was received in other way, so chunks of it are not needed anymore
+	void Discard(const QByteArray &hash);
+
+	// datagram with one chunk of texture
+	static QByteArray EncodeChunk(const QByteArray &hash, const QByteArray &content, int chunkIndex);
+	static int NumberOfChunks(int contentSize);
+	// returns true if the texture was completed and its content matches the hash
+	bool ProcessDatagram(const QByteArray &datagram, QByteArray *hash, QByteArray *content);
+
+private:
+	struct sOutgoingTexture
+	{
+		sOutgoingTexture() : nextChunk(0) {}
+		QByteArray hash;
+		QByteArray content;
+		int nextChunk;
+	};
+
+	struct sIncomingTexture
+	{
+		sIncomingTexture() : receivedChunks(0) {}
+		QByteArray content;
+		QBitArray received;
+		int receivedChunks;
+	};
+
+	QUdpSocket *socket;
+	QTimer *sendTimer;
+	QHostAddress group;
+	quint16 port;
+	int chunksPerInterval;
+
+	QList<sOutgoingTexture> sendQueue;
+	QSet<QByteArray> sentHashes;
+	QHash<QByteArray, sIncomingTexture> incoming;
+	QSet<QByteArray> completedHashes;
+	QElapsedTimer lastChunkTimer;
+
+private slots:
+	void SendChunks();
+	void ReadDatagrams();
+
+signals:
+	// client: content of texture was received and verified
+	void TextureReceived(QByteArray hash, QByteArray content);
+};
+
+#endif /* MANDELBULBER2_SRC_NETRENDER_MULTICAST_HPP_ */
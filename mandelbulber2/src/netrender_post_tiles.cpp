@@ -0,0 +1,236 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderPostTiles - post-processing of still image in bands of lines
+ */
+
+#include "netrender_post_tiles.hpp"
+
+#include <cstring>
+#include <QtCore>
+
+#include "cimage.hpp"
+#include "common_math.h"
+#include "dof.hpp"
+#include "fractparams.hpp"
+#include "netrender.hpp"
+#include "netrender_line_decoder.hpp"
+#include "render_data.hpp"
+#include "render_image.hpp"
+
+bool cNetRenderPostTiles::IsNeeded(const cParamRender *params)
+{
+	bool ssao =
+		params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeScreenSpace;
+	bool dof = params->DOFEnabled && !params->DOFMonteCarlo;
+	return ssao || dof;
+}
+
+bool cNetRenderPostTiles::ChangesFloatImage(const cParamRender *params)
+{
+	bool ssao =
+		params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeScreenSpace;
+	return params->DOFEnabled && !params->DOFMonteCarlo && params->DOFHDRmode && !ssao;
+}
+
+int cNetRenderPostTiles::TileHalo(
+	const cParamRender *params, const cImage *image, int fullWidth, int fullHeight)
+{
+	int halo = 0;
+	if (params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeScreenSpace)
+	{
+		// SSAO samples reach half of image width, so the halo is only approximation
+		halo = params->netRenderPostTileHalo;
+	}
+	if (params->DOFEnabled && !params->DOFMonteCarlo)
+	{
+		// pixels of halo are blurred with pixels up to the radius away, and then they are spread
+		// over pixels of the band up to the same radius
+		double dofRadius = params->DOFRadius * (fullWidth + fullHeight) / 2000.0;
+		cRegion<int> wholeImage(0, 0, image->GetWidth(), image->GetHeight());
+		int blurRadius =
+			cPostRenderingDOF::GetMaxBlurRadius(image, wholeImage, dofRadius, params->DOFFocus);
+		halo = max(halo, 2 * blurRadius + 1);
+	}
+	return halo;
+}
+
+QList<sPostTileJob> cNetRenderPostTiles::CreateTiles(int height, int halo, int numberOfComputers)
+{
+	int numberOfTiles = max(numberOfComputers, 1) * NETRENDER_POST_TILES_PER_COMPUTER;
+	// halo lines are processed by every band, so bands can't be much smaller than the halo
+	int tileHeight = max(NETRENDER_POST_TILE_MIN_HEIGHT,
+		max(halo, (height + numberOfTiles - 1) / numberOfTiles));
+
+	QList<sPostTileJob> tiles;
+	for (int y = 0; y < height; y += tileHeight)
+	{
+		sPostTileJob tile;
+		tile.index = tiles.size();
+		tile.y1 = y;
+		tile.y2 = min(y + tileHeight, height);
+		tile.haloY1 = max(tile.y1 - halo, 0);
+		tile.haloY2 = min(tile.y2 + halo, height);
+		tiles.append(tile);
+	}
+	return tiles;
+}
+
+cImage *cNetRenderPostTiles::CreateTileImage(const cImage *image, const sPostTileJob &tile)
+{
+	int width = image->GetWidth();
+	cImage *tileImage = new cImage(width, tile.haloY2 - tile.haloY1);
+	for (int y = tile.haloY1; y < tile.haloY2; y++)
+	{
+		int tileY = y - tile.haloY1;
+		for (int x = 0; x < width; x++)
+		{
+			tileImage->PutPixelImage(x, tileY, image->GetPixelImage(x, y));
+			tileImage->PutPixelAlpha(x, tileY, image->GetPixelAlpha(x, y));
+			tileImage->PutPixelZBuffer(x, tileY, image->GetPixelZBuffer(x, y));
+			tileImage->PutPixelColour(x, tileY, image->GetPixelColor(x, y));
+			tileImage->PutPixelOpacity(x, tileY, image->GetPixelOpacity(x, y));
+		}
+	}
+	return tileImage;
+}
+
+cImage *cNetRenderPostTiles::CreateTileImage(int width, const sPostTileJob &tile,
+	const QList<int> &lineNumbers, const QList<QByteArray> &lines)
+{
+	// line numbers are moved to the band image
+	QList<int> tileLineNumbers;
+	QList<QByteArray> tileLines;
+	for (int i = 0; i < lineNumbers.size(); i++)
+	{
+		int y = lineNumbers.at(i);
+		if (y < tile.haloY1 || y >= tile.haloY2) continue;
+		tileLineNumbers.append(y - tile.haloY1);
+		tileLines.append(lines.at(i));
+	}
+
+	cImage *tileImage = new cImage(width, tile.haloY2 - tile.haloY1);
+	cNetRenderLineDecoder decoder(tileImage);
+	decoder.slotDecodeLines(tileLineNumbers, tileLines);
+
+	// the same line can come from the client and from the server
+	QList<int> decoded = decoder.TakeDecodedLines();
+	QSet<int> decodedSet;
+	for (int i = 0; i < decoded.size(); i++)
+		decodedSet.insert(decoded.at(i));
+	if (decodedSet.size() != tile.haloY2 - tile.haloY1)
+	{
+		qCritical() << "cNetRenderPostTiles::CreateTileImage(): missing lines of band" << tile.index;
+		delete tileImage;
+		return NULL;
+	}
+	return tileImage;
+}
+
+QByteArray cNetRenderPostTiles::RenderTile(const cParamRender *params, cImage *tileImage,
+	const sPostTileJob &tile, int fullWidth, int fullHeight, bool *stopRequest)
+{
+	int width = tileImage->GetWidth();
+	tileImage->SetImageParameters(params->imageAdjustments);
+	tileImage->CompileImage();
+
+	// effects see the band as tile of the whole image
+	sRenderData data;
+	data.screenRegion = cRegion<int>(0, 0, width, tileImage->GetHeight());
+	data.fullImageSize = CVector2<int>(fullWidth, fullHeight);
+	data.tiled = true;
+	data.tileOffset = CVector2<int>(0, tile.haloY1);
+	data.stopRequest = stopRequest;
+	cRenderer::PostProcessEffects(params, &data, tileImage, NULL, NULL);
+	if (*stopRequest) return QByteArray();
+
+	bool floatImage = ChangesFloatImage(params);
+	int numberOfLines = tile.y2 - tile.y1;
+	int rowSize = width * int(sizeof(sRGB16));
+	int floatRowSize = floatImage ? width * int(sizeof(sRGBfloat)) : 0;
+	QByteArray raw(1 + numberOfLines * (rowSize + floatRowSize), 0);
+	raw[0] = char(floatImage);
+
+	// raw data is not aligned
+	char *rows16 = raw.data() + 1;
+	char *rowsFloat = raw.data() + 1 + numberOfLines * rowSize;
+	for (int y = 0; y < numberOfLines; y++)
+	{
+		int tileY = y + tile.y1 - tile.haloY1;
+		for (int x = 0; x < width; x++)
+		{
+			sRGB16 pixel = tileImage->GetPixelImage16(x, tileY);
+			memcpy(rows16 + (x + y * width) * sizeof(sRGB16), &pixel, sizeof(sRGB16));
+			if (floatImage)
+			{
+				sRGBfloat floatPixel = tileImage->GetPixelImage(x, tileY);
+				memcpy(rowsFloat + (x + y * width) * sizeof(sRGBfloat), &floatPixel, sizeof(sRGBfloat));
+			}
+		}
+	}
+	return qCompress(raw, 1);
+}
+
+bool cNetRenderPostTiles::ApplyTile(cImage *image, const sPostTileJob &tile, const QByteArray &data)
+{
+	QByteArray raw = qUncompress(data);
+	if (raw.isEmpty()) return false;
+
+	int width = image->GetWidth();
+	bool floatImage = raw[0] != 0;
+	int numberOfLines = tile.y2 - tile.y1;
+	int rowSize = width * int(sizeof(sRGB16));
+	int floatRowSize = floatImage ? width * int(sizeof(sRGBfloat)) : 0;
+	if (raw.size() != 1 + numberOfLines * (rowSize + floatRowSize))
+	{
+		qCritical() << "cNetRenderPostTiles::ApplyTile(): wrong size of band" << tile.index;
+		return false;
+	}
+
+	const char *rows16 = raw.constData() + 1;
+	const char *rowsFloat = raw.constData() + 1 + numberOfLines * rowSize;
+	for (int y = 0; y < numberOfLines; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			sRGB16 pixel;
+			memcpy(&pixel, rows16 + (x + y * width) * sizeof(sRGB16), sizeof(sRGB16));
+			image->PutPixelImage16(x, y + tile.y1, pixel);
+			if (floatImage)
+			{
+				sRGBfloat floatPixel;
+				memcpy(&floatPixel, rowsFloat + (x + y * width) * sizeof(sRGBfloat), sizeof(sRGBfloat));
+				image->PutPixelImage(x, y + tile.y1, floatPixel);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNetRenderPostTiles - post-processing of still image in bands of lines
+ *
+ * After rendering of still image with NetRender, SSAO and DOF are calculated in
+ * horizontal bands by the server and by clients. Every band is processed in own small
+ * image which contains also halo lines around the band, in the same way as tiles of
+ * cTiledRender. Client builds the band image from lines which it rendered itself and
+ * lines sent by the server. Only lines of the band (without halo) are sent back.
+ */
+
+#ifndef MANDELBULBER2_SRC_NETRENDER_POST_TILES_HPP_
+#define MANDELBULBER2_SRC_NETRENDER_POST_TILES_HPP_
+
+#include <QByteArray>
+#include <QList>
+
+// minimal height of band [lines]
+#define NETRENDER_POST_TILE_MIN_HEIGHT 64
+// number of bands for every computer, so faster ones can take more of them
+#define NETRENDER_POST_TILES_PER_COMPUTER 4
+
+// forward declarations
+class cImage;
+class cParamRender;
+struct sPostTileJob;
+
+class cNetRenderPostTiles
+{
+public:
+	// SSAO or DOF is used for the image
+	static bool IsNeeded(const cParamRender *params);
+	// lines needed above and below the band
+	static int TileHalo(
+		const cParamRender *params, const cImage *image, int fullWidth, int fullHeight);
+	// splits image into bands
+	static QList<sPostTileJob> CreateTiles(int height, int halo, int numberOfComputers);
+
+	// band image with lines copied from the whole image
+	static cImage *CreateTileImage(const cImage *image, const sPostTileJob &tile);
+	// band image decoded from NetRender line data. Returns NULL if some lines are missing
+	static cImage *CreateTileImage(int width, const sPostTileJob &tile,
+		const QList<int> &lineNumbers, const QList<QByteArray> &lines);
+	// compiles the band image, calculates effects and returns compressed lines of the band.
+	// Returns empty array if processing was stopped
+	static QByteArray RenderTile(const cParamRender *params, cImage *tileImage,
+		const sPostTileJob &tile, int fullWidth, int fullHeight, bool *stopRequest);
+	// puts post-processed lines of the band to the whole image
+	static bool ApplyTile(cImage *image, const sPostTileJob &tile, const QByteArray &data);
+
+private:
+	// effects change float image (HDR DOF without SSAO), so it's sent back together with 16-bit one
+	static bool ChangesFloatImage(const cParamRender *params);
+};
+
+#endif /* MANDELBULBER2_SRC_NETRENDER_POST_TILES_HPP_ */
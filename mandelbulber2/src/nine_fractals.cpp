@@ -33,6 +33,7 @@
  */
 
 #include "nine_fractals.hpp"
+#include "compute_fractal.hpp"
 
 #include <algorithm>
 
@@ -65,6 +66,7 @@ cNineFractals::cNineFractals(const cFractalContainer *par, const cParameterConta
 	double commonBailout = generalPar->Get<double>("bailout");
 	isHybrid = generalPar->Get<bool>("hybrid_fractal_enable");
 	bool isBoolean = generalPar->Get<bool>("boolean_operators");
+	bool fastMath = generalPar->Get<bool>("fast_math_formulas");
 	double maxBailout = 0.0;
 
 	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
@@ -75,6 +77,7 @@ cNineFractals::cNineFractals(const cFractalContainer *par, const cParameterConta
 		{
 			fractals[i]->formula = fractal::none;
 		}
+		fractals[i]->fastMath = fastMath;
 		formulaWeight[i] = generalPar->Get<double>("formula_weight", i + 1);
 		formulaStartIteriation[i] = generalPar->Get<int>("formula_start_iteration", i + 1);
 		formulaStopIteration[i] = generalPar->Get<int>("formula_stop_iteration", i + 1);
@@ -154,6 +157,11 @@ cNineFractals::cNineFractals(const cFractalContainer *par, const cParameterConta
 	maxN = generalPar->Get<int>("N");
 	maxFractalIndex = 0;
 	CreateSequence(generalPar);
+	computeKernel = SelectComputeKernel(*this);
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+		iterateFunction[i] = SelectIterateFunction(fractals[i]->formula);
+	CompileIterationOps();
+	CompileHotParams();
 
 	if (isHybrid || forceDeltaDE)
 	{
@@ -235,6 +243,67 @@ cNineFractals::cNineFractals(const cFractalContainer *par, const cParameterConta
 	}
 }
 
+// flags of every slot are resolved here, so the iteration loop doesn't need to check them
+void cNineFractals::CompileIterationOps()
+{
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		sIterationOps &op = hotParams[i].iterationOps;
+		op.ops = 0;
+		op.weight = formulaWeight[i];
+		op.multiplier = constantMultiplier[i];
+
+		if (!isHybrid || formulaWeight[i] > 0.0) op.ops |= iterationOpFormula;
+		if (isHybrid) op.ops |= iterationOpSmooth;
+
+		if (addCConstant[i])
+		{
+			bool swapXY = fractals[i]->formula == fractal::aboxMod1
+										|| fractals[i]->formula == fractal::amazingSurf;
+			if (swapXY) op.ops |= iterationOpSwapXY;
+
+			if (juliaEnabled[i])
+			{
+				op.ops |= iterationOpAddJuliaC;
+				CVector3 juliaC = juliaConstant[i] * constantMultiplier[i];
+				op.juliaC = swapXY ? CVector3(juliaC.y, juliaC.x, juliaC.z) : juliaC;
+			}
+			else
+			{
+				op.ops |= iterationOpAddC;
+			}
+		}
+	}
+}
+
+void cNineFractals::CompileHotParams()
+{
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		sFormulaHotParams &hot = hotParams[i];
+		const cFractal *fractal = fractals[i];
+		hot.formula = fractal->formula;
+		hot.bailout = bailout[i];
+		hot.checkForBailout = checkForBailout[i];
+		hot.fastMath = fractal->fastMath;
+
+		hot.bulbPower = fractal->bulb.power;
+		hot.bulbAlphaOffset = fractal->bulb.alphaAngleOffset;
+		hot.bulbBetaOffset = fractal->bulb.betaAngleOffset;
+
+		const sFractalMandelbox &mbox = fractal->mandelbox;
+		hot.mboxFoldingLimit = mbox.foldingLimit;
+		hot.mboxFoldingValue = mbox.foldingValue;
+		hot.mboxScale = mbox.scale;
+		hot.mboxMR2 = mbox.mR2;
+		hot.mboxFR2 = mbox.fR2;
+		hot.mboxFactor1 = mbox.mboxFactor1;
+		hot.mboxOffset = mbox.offset;
+		hot.mboxMainRotationEnabled = mbox.mainRotationEnabled;
+		hot.mboxMainRot = mbox.mainRot;
+	}
+}
+
 void cNineFractals::CreateSequence(const cParameterContainer *generalPar)
 {
 	if (hybridSequence) delete[] hybridSequence;
@@ -347,6 +416,20 @@ QString cNineFractals::GetDETypeString() const
 	return text;
 }
 
+double cNineFractals::GetEstimatedIterationTime() const
+{
+	if (hybridSequenceLength <= 0) return -1.0;
+
+	double totalTime = 0.0;
+	for (int i = 0; i < hybridSequenceLength; i++)
+	{
+		int index = GetIndexOnFractalList(fractals[hybridSequence[i]]->formula);
+		if (fractalList[index].nsPerIteration < 0.0) return -1.0;
+		totalTime += fractalList[index].nsPerIteration;
+	}
+	return totalTime / hybridSequenceLength;
+}
+
 int cNineFractals::GetIndexOnFractalList(fractal::enumFractalFormula formula)
 {
 	for (int i = 0; i < fractalList.size(); i++)
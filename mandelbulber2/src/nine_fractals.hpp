@@ -45,6 +45,54 @@ class cParameterContainer;
 class cFractalContainer;
 class cFractal;
 
+// operations of one hybrid slot iteration, compiled once from the settings
+enum enumIterationOp
+{
+	iterationOpFormula = 1, // formula is called (not hybrid or weight > 0)
+	iterationOpAddC = 2, // c * multiplier is added
+	iterationOpAddJuliaC = 4, // precalculated Julia constant is added
+	iterationOpSwapXY = 8, // constant is added with swapped x and y
+	iterationOpSmooth = 16 // result is blended with hybrid weight
+};
+
+struct sIterationOps
+{
+	sIterationOps() : ops(0), weight(1.0) {}
+	int ops;
+	CVector3 juliaC; // julia constant * constant multiplier (already swapped if needed)
+	CVector3 multiplier;
+	double weight;
+};
+
+// values read by iteration loops in every iteration of the slot, gathered when the job starts.
+// cFractal has parameters of all formulas, so values of one formula are spread over many cache
+// lines, and slot settings are in separate arrays of cNineFractals. Formula parameters are copied
+// only for formulas with vectorized kernels (see ComputeBatch())
+struct sFormulaHotParams
+{
+	sIterationOps iterationOps;
+	fractal::enumFractalFormula formula;
+	double bailout;
+	bool checkForBailout;
+	bool fastMath;
+
+	// mandelbulb
+	double bulbPower;
+	double bulbAlphaOffset;
+	double bulbBetaOffset;
+
+	// mandelbox
+	double mboxFoldingLimit;
+	double mboxFoldingValue;
+	double mboxScale;
+	double mboxMR2;
+	double mboxFR2;
+	double mboxFactor1;
+	CVector3 mboxOffset;
+	bool mboxMainRotationEnabled;
+	CRotationMatrix mboxMainRot;
+};
+
 class cNineFractals
 {
 public:
@@ -53,6 +101,9 @@ public:
 	cFractal *GetFractal(int index) const { return fractals[index]; }
 	cFractal **fractals;
 	int GetSequence(const int i) const;
+	inline int GetSequenceLength() const { return hybridSequenceLength; }
+	inline int GetComputeKernel() const { return computeKernel; }
+	inline int GetIterateFunction(int formulaIndex) const { return iterateFunction[formulaIndex]; }
 	bool IsHybrid() const { return isHybrid; }
 	fractal::enumDEType GetDEType(int formulaIndex) const;
 	fractal::enumDEFunctionType GetDEFunctionType(int formulaIndex) const;
@@ -62,6 +113,8 @@ public:
 	inline bool IsCheckForBailout(int formulaIndex) const { return checkForBailout[formulaIndex]; }
 	inline bool UseOptimizedDE() const { return useOptimizedDE; }
 	QString GetDETypeString() const;
+	// average time of one iteration in nanoseconds measured by formula benchmark (-1 if unknown)
+	double GetEstimatedIterationTime() const;
 	inline double GetBailout(int formulaIndex) const { return bailout[formulaIndex]; };
 	inline bool IsJuliaEnabled(int formulaIndex) const { return juliaEnabled[formulaIndex]; }
 	inline CVector3 GetJuliaConstant(int formulaIndex) const { return juliaConstant[formulaIndex]; }
@@ -70,6 +123,14 @@ public:
 		return constantMultiplier[formulaIndex];
 	}
 	inline double GetInitialWAxis(int formulaIndex) const { return initialWAxis[formulaIndex]; }
+	inline const sIterationOps &GetIterationOps(int formulaIndex) const
+	{
+		return hotParams[formulaIndex].iterationOps;
+	}
+	inline const sFormulaHotParams &GetHotParams(int formulaIndex) const
+	{
+		return hotParams[formulaIndex];
+	}
 
 private:
 	bool forceDeltaDE;
@@ -80,6 +141,8 @@ private:
 	int maxN;
 	int *hybridSequence;
 	int hybridSequenceLength;
+	int computeKernel;
+	int iterateFunction[NUMBER_OF_FRACTALS];
 
 	double formulaWeight[NUMBER_OF_FRACTALS];
 	fractal::enumDEFunctionType DEFunctionType[NUMBER_OF_FRACTALS];
@@ -94,7 +157,10 @@ private:
 	CVector3 juliaConstant[NUMBER_OF_FRACTALS];
 	CVector3 constantMultiplier[NUMBER_OF_FRACTALS];
 	double initialWAxis[NUMBER_OF_FRACTALS];
+	sFormulaHotParams hotParams[NUMBER_OF_FRACTALS];
 
+	void CompileIterationOps();
+	void CompileHotParams();
 	void CreateSequence(const cParameterContainer *generalPar);
 	static int GetIndexOnFractalList(fractal::enumFractalFormula formula);
 };
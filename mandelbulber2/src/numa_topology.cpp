@@ -0,0 +1,249 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNumaTopology class - NUMA nodes and binding of rendering threads to CPUs
+ */
+
+#include "numa_topology.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QStringList>
+#include <QThread>
+
+#ifdef WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "system.hpp"
+
+const cNumaTopology *cNumaTopology::Instance()
+{
+	static cNumaTopology *instance = NULL;
+	if (!instance) instance = new cNumaTopology;
+	return instance;
+}
+
+cNumaTopology::cNumaTopology()
+{
+#ifdef WIN32
+	ULONG highestNode = 0;
+	if (GetNumaHighestNodeNumber(&highestNode))
+	{
+		for (ULONG node = 0; node <= highestNode; node++)
+		{
+			ULONGLONG mask = 0;
+			if (!GetNumaNodeProcessorMask((UCHAR)node, &mask)) continue;
+			QList<int> cpus;
+			for (int cpu = 0; cpu < 64; cpu++)
+			{
+				if (mask & (1ULL << cpu)) cpus.append(cpu);
+			}
+			if (!cpus.isEmpty()) nodeCpus.append(cpus);
+		}
+	}
+#elif defined(__linux__)
+	// directories of nodes have to be sorted by number, not alphabetically
+	QDir nodesDir("/sys/devices/system/node");
+	QStringList entries = nodesDir.entryList(QStringList("node*"), QDir::Dirs);
+	QMap<int, QString> nodeDirs;
+	for (int i = 0; i < entries.size(); i++)
+	{
+		bool ok = false;
+		int number = entries[i].mid(4).toInt(&ok);
+		if (ok) nodeDirs.insert(number, entries[i]);
+	}
+	QList<QString> sortedDirs = nodeDirs.values();
+	for (int i = 0; i < sortedDirs.size(); i++)
+	{
+		QFile file(nodesDir.absoluteFilePath(sortedDirs[i] + "/cpulist"));
+		if (!file.open(QIODevice::ReadOnly)) continue;
+		QList<int> cpus = ParseCpuList(QString(file.readAll()).trimmed());
+		if (!cpus.isEmpty()) nodeCpus.append(cpus);
+	}
+#endif
+
+	// without NUMA information all CPUs belong to one node
+	if (nodeCpus.isEmpty())
+	{
+		QList<int> cpus;
+		for (int i = 0; i < QThread::idealThreadCount(); i++)
+			cpus.append(i);
+		nodeCpus.append(cpus);
+	}
+
+	// SMT siblings are used after all physical cores of the node
+	QSet<int> siblings = ReadSmtSiblings();
+	physicalCores = 0;
+	for (int node = 0; node < nodeCpus.size(); node++)
+	{
+		QList<int> primary;
+		QList<int> secondary;
+		for (int i = 0; i < nodeCpus[node].size(); i++)
+		{
+			int cpu = nodeCpus[node][i];
+			if (siblings.contains(cpu))
+				secondary.append(cpu);
+			else
+				primary.append(cpu);
+		}
+		physicalCores += primary.size();
+		nodeCpus[node] = primary + secondary;
+	}
+	physicalCores = qMax(physicalCores, 1);
+
+	WriteLogDouble("NUMA nodes", nodeCpus.size(), 2);
+	WriteLogDouble("Physical CPU cores", physicalCores, 2);
+}
+
+QSet<int> cNumaTopology::ReadSmtSiblings()
+{
+	QSet<int> siblings;
+#ifdef WIN32
+	DWORD length = 0;
+	GetLogicalProcessorInformation(NULL, &length);
+	int count = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+	if (count > 0)
+	{
+		QVector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(count);
+		if (GetLogicalProcessorInformation(info.data(), &length))
+		{
+			for (int i = 0; i < count; i++)
+			{
+				if (info[i].Relationship != RelationProcessorCore) continue;
+				// the lowest CPU of the core is the primary one
+				bool first = true;
+				for (int cpu = 0; cpu < (int)sizeof(ULONG_PTR) * 8; cpu++)
+				{
+					if (!(info[i].ProcessorMask & ((ULONG_PTR)1 << cpu))) continue;
+					if (!first) siblings.insert(cpu);
+					first = false;
+				}
+			}
+		}
+	}
+#elif defined(__linux__)
+	QDir cpusDir("/sys/devices/system/cpu");
+	QStringList entries = cpusDir.entryList(QStringList("cpu*"), QDir::Dirs);
+	for (int i = 0; i < entries.size(); i++)
+	{
+		bool ok = false;
+		int cpu = entries[i].mid(3).toInt(&ok);
+		if (!ok) continue;
+		QFile file(cpusDir.absoluteFilePath(entries[i] + "/topology/thread_siblings_list"));
+		if (!file.open(QIODevice::ReadOnly)) continue;
+		QList<int> coreCpus = ParseCpuList(QString(file.readAll()).trimmed());
+		// the lowest CPU of the core is the primary one
+		if (!coreCpus.isEmpty() && cpu != coreCpus.first()) siblings.insert(cpu);
+	}
+#endif
+	return siblings;
+}
+
+QList<int> cNumaTopology::ParseCpuList(const QString &list)
+{
+	QList<int> cpus;
+	QStringList ranges = list.split(',', QString::SkipEmptyParts);
+	for (int i = 0; i < ranges.size(); i++)
+	{
+		QStringList ends = ranges[i].split('-');
+		bool firstOk = false;
+		bool lastOk = true;
+		int first = ends[0].toInt(&firstOk);
+		int last = (ends.size() > 1) ? ends[1].toInt(&lastOk) : first;
+		if (!firstOk || !lastOk) continue;
+		for (int cpu = first; cpu <= last; cpu++)
+			cpus.append(cpu);
+	}
+	return cpus;
+}
+
+int cNumaTopology::NodeOfThread(int threadIndex, int numberOfThreads) const
+{
+	if (numberOfThreads <= 0) return 0;
+	int node = (qint64)threadIndex * nodeCpus.size() / numberOfThreads;
+	return qBound(0, node, nodeCpus.size() - 1);
+}
+
+int cNumaTopology::CpuOfThread(int threadIndex, int numberOfThreads) const
+{
+	int node = NodeOfThread(threadIndex, numberOfThreads);
+	int numberOfNodes = nodeCpus.size();
+	// index of the first thread of the node
+	int firstThread = ((qint64)node * numberOfThreads + numberOfNodes - 1) / numberOfNodes;
+	const QList<int> &cpus = nodeCpus[node];
+	return cpus[qMax(threadIndex - firstThread, 0) % cpus.size()];
+}
+
+QVector<int> cNumaTopology::NodesOfThreads(int numberOfThreads) const
+{
+	QVector<int> nodes(numberOfThreads);
+	for (int i = 0; i < numberOfThreads; i++)
+		nodes[i] = NodeOfThread(i, numberOfThreads);
+	return nodes;
+}
+
+bool cNumaTopology::SetCurrentThreadAffinity(int cpu)
+{
+#ifdef WIN32
+	DWORD_PTR mask = 0;
+	if (cpu >= 0 && cpu < (int)sizeof(DWORD_PTR) * 8)
+	{
+		mask = (DWORD_PTR)1 << cpu;
+	}
+	else
+	{
+		DWORD_PTR systemMask = 0;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask)) return false;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (cpu >= 0 && cpu < CPU_SETSIZE)
+	{
+		CPU_SET(cpu, &set);
+	}
+	else
+	{
+		for (int i = 0; i < CPU_SETSIZE; i++)
+			CPU_SET(i, &set);
+	}
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	// binding of threads to CPUs is not supported (e.g. macOS)
+	Q_UNUSED(cpu);
+	return false;
+#endif
+}
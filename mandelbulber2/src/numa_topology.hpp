@@ -0,0 +1,79 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cNumaTopology class - NUMA nodes and binding of rendering threads to CPUs
+ *
+ * Logical CPUs of each NUMA node are read from the system (sysfs on Linux,
+ * GetNumaNodeProcessorMask() on Windows). Rendering threads are split into
+ * continuous groups, one group for each node, so threads of one node render
+ * neighbouring tiles and touch the same part of the image memory. On systems
+ * without NUMA information all CPUs belong to one node.
+ *
+ * SMT siblings are placed at the end of CPU list of each node, so threads are
+ * bound to separate physical cores first.
+ */
+
+#ifndef MANDELBULBER2_SRC_NUMA_TOPOLOGY_HPP_
+#define MANDELBULBER2_SRC_NUMA_TOPOLOGY_HPP_
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class cNumaTopology
+{
+public:
+	static const cNumaTopology *Instance();
+
+	int GetNumberOfNodes() const { return nodeCpus.size(); }
+	// number of logical CPUs without SMT siblings
+	int GetNumberOfPhysicalCores() const { return physicalCores; }
+	int NodeOfThread(int threadIndex, int numberOfThreads) const;
+	// logical CPU for the thread. Threads of the node are distributed over its CPUs
+	int CpuOfThread(int threadIndex, int numberOfThreads) const;
+	QVector<int> NodesOfThreads(int numberOfThreads) const;
+
+	// binds calling thread to the CPU. With cpu = -1 the thread can run on all CPUs
+	static bool SetCurrentThreadAffinity(int cpu);
+
+private:
+	cNumaTopology();
+	// list in format used by Linux kernel, e.g. "0-7,16-23"
+	static QList<int> ParseCpuList(const QString &list);
+	// logical CPUs which are second or next hardware thread of a physical core
+	static QSet<int> ReadSmtSiblings();
+
+	QList<QList<int> > nodeCpus;
+	int physicalCores;
+};
+
+#endif /* MANDELBULBER2_SRC_NUMA_TOPOLOGY_HPP_ */
@@ -0,0 +1,751 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cOpenClEngine class - rendering of simple scenes by OpenCL devices
+ */
+
+#include "opencl_engine.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+
+#include "ao_modes.h"
+#include "camera_target.hpp"
+#include "cimage.hpp"
+#include "compute_fractal.hpp"
+#include "fractal.h"
+#include "fractparams.hpp"
+#include "material.h"
+#include "nine_fractals.hpp"
+#include "projection_3d.hpp"
+#include "render_data.hpp"
+#include "render_worker.hpp"
+#include "system.hpp"
+
+// pixels calculated by the first call of the kernel. Next jobs are sized by measured
+// throughput. Small jobs keep the interface responsive and don't trigger watchdog of display
+// drivers
+#define OPENCL_PIXELS_PER_JOB 16384
+
+// maximum number of ambient occlusion vectors, the same as in cRenderWorker
+#define OPENCL_MAX_AO_VECTORS 10000
+
+// entries of palette look-up table. The last one is used for negative colour indices
+#define OPENCL_PALETTE_SIZE (65536 + 1)
+
+#ifdef USE_OPENCL
+// scene parameters. Layout has to be the same as sClParams in ray_marcher.cl
+struct sClParams
+{
+	cl_float4 camera;
+	cl_float4 rotX; // columns of camera rotation matrix
+	cl_float4 rotY;
+	cl_float4 rotZ;
+	cl_float4 rotInvX; // columns of inverted camera rotation matrix
+	cl_float4 rotInvY;
+	cl_float4 rotInvZ;
+	cl_float4 lightVector;
+	cl_float4 repeat;
+	cl_float4 fractalPosition;
+	cl_float4 fractalRotX;
+	cl_float4 fractalRotY;
+	cl_float4 fractalRotZ;
+	cl_float4 constantMultiplier;
+	cl_float4 juliaConstant;
+	cl_float4 mboxOffset;
+	cl_float4 mboxRotX;
+	cl_float4 mboxRotY;
+	cl_float4 mboxRotZ;
+	cl_float4 mboxColorFactor; // w is factor of r
+	cl_float4 mainLightColour;
+	cl_float4 background1; // in 16-bit units
+	cl_float4 background2;
+	cl_float4 background3;
+	cl_float4 materialColour;
+	cl_float4 specularColour;
+	cl_float4 luminosity;
+
+	cl_float fov;
+	cl_float aspectRatio;
+	cl_float imageScaleX;
+	cl_float imageScaleY;
+	cl_float imageOffsetX;
+	cl_float imageOffsetY;
+	cl_float resolution;
+	cl_float detailLevel;
+	cl_float DEThresh;
+	cl_float DEFactor;
+	cl_float viewDistanceMax;
+	cl_float reduceDetail;
+	cl_float relaxation;
+	cl_float smoothness;
+	cl_float iterationLODFactor;
+	cl_float iterationLODReference;
+	cl_float bailout;
+	cl_float initialW;
+	cl_float power;
+	cl_float alphaAngleOffset;
+	cl_float betaAngleOffset;
+	cl_float mboxFoldingLimit;
+	cl_float mboxFoldingValue;
+	cl_float mboxScale;
+	cl_float mboxMR2;
+	cl_float mboxFR2;
+	cl_float mboxFactor1;
+	cl_float mboxColorSp1;
+	cl_float mboxColorSp2;
+	cl_float mainLightIntensity;
+	cl_float mainLightVisibility;
+	cl_float mainLightVisibilitySize;
+	cl_float shading;
+	cl_float specularExponent;
+	cl_float specularDiffuse;
+	cl_float shadowConeTan;
+	cl_float aoIntensity;
+	cl_float aoFastTune;
+	cl_float coloringSpeed;
+	cl_float paletteOffset;
+
+	cl_int perspectiveType;
+	cl_int formula;
+	cl_int N;
+	cl_int minN;
+	cl_int iterThreshMode;
+	cl_int checkForBailout;
+	cl_int addConstant;
+	cl_int juliaEnabled;
+	cl_int mboxMainRotation;
+	cl_int constantDEThreshold;
+	cl_int tetrahedralNormals;
+	cl_int mainLightEnable;
+	cl_int shadowEnabled;
+	cl_int penetratingLights;
+	cl_int softShadows;
+	cl_int aoMode;
+	cl_int aoQuality;
+	cl_int aoVectorsCount;
+	cl_int usePalette;
+	cl_int padding[1];
+};
+
+// direction of ambient occlusion ray and colour of light map
+struct sClAOVector
+{
+	cl_float4 direction;
+	cl_float4 colour;
+};
+
+static cl_float4 ClVector(const CVector3 &v, double w = 0.0)
+{
+	cl_float4 result;
+	result.s[0] = v.x;
+	result.s[1] = v.y;
+	result.s[2] = v.z;
+	result.s[3] = w;
+	return result;
+}
+
+static cl_float4 ClColour(const sRGB &colour, double factor)
+{
+	return ClVector(CVector3(colour.R, colour.G, colour.B) * factor);
+}
+
+// columns of rotation matrix
+static void ClMatrix(const CRotationMatrix &m, cl_float4 *x, cl_float4 *y, cl_float4 *z)
+{
+	*x = ClVector(m.RotateVector(CVector3(1.0, 0.0, 0.0)));
+	*y = ClVector(m.RotateVector(CVector3(0.0, 1.0, 0.0)));
+	*z = ClVector(m.RotateVector(CVector3(0.0, 0.0, 1.0)));
+}
+
+// returns true if OpenCL function succeeded. Otherwise the message is set
+static bool ClSucceeded(cl_int err, const QString &function, QString *error)
+{
+	if (err == CL_SUCCESS) return true;
+	*error = function + QObject::tr(" failed, OpenCL error %1").arg(err);
+	return false;
+}
+#endif // USE_OPENCL
+
+cOpenClEngine *cOpenClEngine::instance = NULL;
+
+cOpenClEngine *cOpenClEngine::Instance()
+{
+	if (!instance) instance = new cOpenClEngine;
+	return instance;
+}
+
+cOpenClEngine::cOpenClEngine()
+{
+	preparedPlatform = -1;
+	preparedDevice = -1;
+	ready = false;
+	storeNormals = false;
+#ifdef USE_OPENCL
+	device = NULL;
+	context = NULL;
+	queue = NULL;
+	program = NULL;
+	kernel = NULL;
+	paramsBuffer = NULL;
+	paletteBuffer = NULL;
+	aoVectorsBuffer = NULL;
+	tilesBuffer = NULL;
+	pixelsBuffer = NULL;
+	aoVectorsBufferSize = 0;
+	tilesBufferSize = 0;
+	pixelsBufferSize = 0;
+#endif
+}
+
+int cOpenClEngine::GetInitialPixelsPerJob()
+{
+	return OPENCL_PIXELS_PER_JOB;
+}
+
+cOpenClEngine::~cOpenClEngine()
+{
+	Release();
+}
+
+void cOpenClEngine::Release()
+{
+#ifdef USE_OPENCL
+	if (pixelsBuffer) clReleaseMemObject(pixelsBuffer);
+	if (tilesBuffer) clReleaseMemObject(tilesBuffer);
+	if (aoVectorsBuffer) clReleaseMemObject(aoVectorsBuffer);
+	if (paletteBuffer) clReleaseMemObject(paletteBuffer);
+	if (paramsBuffer) clReleaseMemObject(paramsBuffer);
+	if (kernel) clReleaseKernel(kernel);
+	if (program) clReleaseProgram(program);
+	if (queue) clReleaseCommandQueue(queue);
+	if (context) clReleaseContext(context);
+	pixelsBuffer = NULL;
+	tilesBuffer = NULL;
+	aoVectorsBuffer = NULL;
+	paletteBuffer = NULL;
+	paramsBuffer = NULL;
+	kernel = NULL;
+	program = NULL;
+	queue = NULL;
+	context = NULL;
+	device = NULL;
+	aoVectorsBufferSize = 0;
+	tilesBufferSize = 0;
+	pixelsBufferSize = 0;
+#endif
+	ready = false;
+	preparedPlatform = -1;
+	preparedDevice = -1;
+}
+
+bool cOpenClEngine::IsSceneSupported(const cParamRender *params, const cNineFractals *fractals,
+	const sRenderData *data, cImage *image, QString *reason)
+{
+#ifdef USE_OPENCL
+	const cFractal *fractal = fractals->GetFractal(0);
+	if (fractals->IsHybrid() || params->booleanOperatorsEnabled)
+	{
+		*reason = QObject::tr("hybrid fractals and boolean operators are not supported");
+		return false;
+	}
+	if (fractal->formula != fractal::mandelbulb
+			&& !(fractal->formula == fractal::mandelbox && !fractal->mandelbox.rotationsEnabled))
+	{
+		*reason = QObject::tr("only Mandelbulb and Mandelbox formulas are supported");
+		return false;
+	}
+	if (fractals->GetDEType(-1) != fractal::analyticDEType || params->common.foldings.boxEnable
+			|| params->common.foldings.sphericalEnable)
+	{
+		*reason = QObject::tr("only analytic DE without foldings is supported");
+		return false;
+	}
+	if (data->stereo.isEnabled() || (params->DOFMonteCarlo && params->DOFEnabled)
+			|| params->interiorMode || cRenderWorker::VolumetricEffectsEnabled(params, data))
+	{
+		*reason = QObject::tr(
+			"stereoscopic rendering, Monte Carlo DOF, interior mode and volumetric effects are not "
+			"supported");
+		return false;
+	}
+	if (params->primitives.IsAnyPrimitive() || params->limitsEnabled)
+	{
+		*reason = QObject::tr("primitives and limits are not supported");
+		return false;
+	}
+	if (params->envMappingEnable || params->fakeLightsEnabled || data->lights.IsAnyLightEnabled()
+			|| params->texturedBackground || params->slowShading)
+	{
+		*reason = QObject::tr(
+			"environment mapping, auxiliary lights, fake lights, textured background and slow shading "
+			"are not supported");
+		return false;
+	}
+
+	QMap<int, cMaterial>::const_iterator material =
+		data->objectData.isEmpty() ? data->materials.constEnd()
+															 : data->materials.constFind(data->objectData[0].materialId);
+	if (material == data->materials.constEnd())
+	{
+		*reason = QObject::tr("material of fractal is not defined");
+		return false;
+	}
+	const cMaterial &mat = material.value();
+	if (mat.colorTexture.IsLoaded() || mat.diffusionTexture.IsLoaded()
+			|| mat.luminosityTexture.IsLoaded() || mat.displacementTexture.IsLoaded()
+			|| mat.normalMapTexture.IsLoaded())
+	{
+		*reason = QObject::tr("textures of materials are not supported");
+		return false;
+	}
+	if (params->raytracedReflections && params->reflectionsMax > 0
+			&& (mat.reflectance > 0.0 || mat.transparencyOfSurface > 0.0))
+	{
+		*reason = QObject::tr("reflections and transparency are not supported");
+		return false;
+	}
+	if (mat.useColorsFromPalette
+			&& mat.fractalColoring.coloringAlgorithm != sFractalColoring::fractalColoringStandard)
+	{
+		*reason = QObject::tr("only standard fractal colouring is supported");
+		return false;
+	}
+
+	const sImageOptional *optional = image->GetImageOptional();
+	if (optional->optionalWorldPosition || optional->optionalObjectId || optional->optionalCost
+			|| optional->optionalGBuffer)
+	{
+		*reason = QObject::tr("world position, object id, cost and G-buffer layers are not supported");
+		return false;
+	}
+
+	// the same condition as for single precision of CPU rendering
+	double distThresh = params->constantDEThreshold ? params->DEThresh
+																									: (params->camera - params->target).Length()
+																											* params->resolution * params->fov
+																											/ params->detailLevel;
+	distThresh /= data->reduceDetail;
+	double range = qMax(params->camera.Length(), params->target.Length());
+	if (distThresh < range * SINGLE_PRECISION_LIMIT)
+	{
+		*reason = QObject::tr("single precision is not enough for this zoom");
+		return false;
+	}
+	return true;
+#else
+	Q_UNUSED(params);
+	Q_UNUSED(fractals);
+	Q_UNUSED(data);
+	Q_UNUSED(image);
+	*reason = QObject::tr("OpenCL support was not compiled in");
+	return false;
+#endif
+}
+
+bool cOpenClEngine::Prepare(int platformIndex, int deviceIndex, QString *error)
+{
+#ifdef USE_OPENCL
+	if (ready && platformIndex == preparedPlatform && deviceIndex == preparedDevice) return true;
+	Release();
+
+	cl_uint numberOfPlatforms = 0;
+	clGetPlatformIDs(0, NULL, &numberOfPlatforms);
+	if (platformIndex < 0 || platformIndex >= (int)numberOfPlatforms)
+	{
+		*error = QObject::tr("OpenCL platform %1 not found").arg(platformIndex);
+		return false;
+	}
+	QVector<cl_platform_id> platforms(numberOfPlatforms);
+	clGetPlatformIDs(numberOfPlatforms, platforms.data(), NULL);
+
+	cl_uint numberOfDevices = 0;
+	clGetDeviceIDs(platforms[platformIndex], CL_DEVICE_TYPE_ALL, 0, NULL, &numberOfDevices);
+	if (deviceIndex < 0 || deviceIndex >= (int)numberOfDevices)
+	{
+		*error = QObject::tr("OpenCL device %1 not found").arg(deviceIndex);
+		return false;
+	}
+	QVector<cl_device_id> devices(numberOfDevices);
+	clGetDeviceIDs(
+		platforms[platformIndex], CL_DEVICE_TYPE_ALL, numberOfDevices, devices.data(), NULL);
+	device = devices[deviceIndex];
+
+	char name[256];
+	clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL);
+	name[sizeof(name) - 1] = 0;
+	deviceName = QString(name).trimmed();
+
+	cl_int err;
+	context = clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+	if (!ClSucceeded(err, "clCreateContext()", error)) return false;
+	queue = clCreateCommandQueue(context, device, 0, &err);
+	if (!ClSucceeded(err, "clCreateCommandQueue()", error)) return false;
+
+	QString kernelFileName =
+		systemData.sharedDir + "opencl" + QDir::separator() + "ray_marcher.cl";
+	QFile kernelFile(kernelFileName);
+	if (!kernelFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		*error = QObject::tr("cannot open kernel file %1").arg(kernelFileName);
+		return false;
+	}
+	QByteArray source = kernelFile.readAll();
+	const char *sourceData = source.constData();
+	size_t sourceSize = source.size();
+	program = clCreateProgramWithSource(context, 1, &sourceData, &sourceSize, &err);
+	if (!ClSucceeded(err, "clCreateProgramWithSource()", error)) return false;
+
+	err = clBuildProgram(program, 1, &device, "-cl-mad-enable", NULL, NULL);
+	if (err != CL_SUCCESS)
+	{
+		size_t logSize = 0;
+		clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
+		QByteArray buildLog(logSize, 0);
+		clGetProgramBuildInfo(
+			program, device, CL_PROGRAM_BUILD_LOG, logSize, buildLog.data(), NULL);
+		qCritical() << "cOpenClEngine::Prepare(): build log:" << buildLog;
+		return ClSucceeded(err, "clBuildProgram()", error);
+	}
+
+	kernel = clCreateKernel(program, "RayMarcher", &err);
+	if (!ClSucceeded(err, "clCreateKernel()", error)) return false;
+
+	paramsBuffer = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(sClParams), NULL, &err);
+	if (!ClSucceeded(err, "clCreateBuffer()", error)) return false;
+	paletteBuffer = clCreateBuffer(
+		context, CL_MEM_READ_ONLY, sizeof(cl_float4) * OPENCL_PALETTE_SIZE, NULL, &err);
+	if (!ClSucceeded(err, "clCreateBuffer()", error)) return false;
+
+	ready = true;
+	preparedPlatform = platformIndex;
+	preparedDevice = deviceIndex;
+	WriteLog("cOpenClEngine::Prepare(): kernel compiled for " + deviceName, 2);
+	return true;
+#else
+	Q_UNUSED(platformIndex);
+	Q_UNUSED(deviceIndex);
+	*error = QObject::tr("OpenCL support was not compiled in");
+	return false;
+#endif
+}
+
+#ifdef USE_OPENCL
+// buffer is reallocated only if it is too small
+bool cOpenClEngine::PrepareBuffer(
+	cl_mem *buffer, size_t size, size_t *allocatedSize, QString *error)
+{
+	if (*buffer && *allocatedSize >= size) return true;
+	if (*buffer) clReleaseMemObject(*buffer);
+	*allocatedSize = 0;
+	cl_int err;
+	*buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, size, NULL, &err);
+	if (!ClSucceeded(err, "clCreateBuffer()", error))
+	{
+		*buffer = NULL;
+		return false;
+	}
+	*allocatedSize = size;
+	return true;
+}
+#endif
+
+bool cOpenClEngine::SetScene(const cParamRender *params, const cNineFractals *fractals,
+	const sRenderData *data, cImage *image, QString *error)
+{
+#ifdef USE_OPENCL
+	if (!ready)
+	{
+		*error = QObject::tr("OpenCL device is not prepared");
+		return false;
+	}
+
+	const cFractal *fractal = fractals->GetFractal(0);
+	const cMaterial &mat = data->materials.constFind(data->objectData[0].materialId).value();
+
+	sClParams p;
+	memset(&p, 0, sizeof(p));
+
+	// camera, the same as cRenderWorker::PrepareMainVectors()
+	cCameraTarget cameraTarget(params->camera, params->target, params->topVector);
+	CVector3 viewAngle = cameraTarget.GetRotation();
+	CRotationMatrix mRot;
+	mRot.RotateZ(viewAngle.x);
+	mRot.RotateX(viewAngle.y);
+	mRot.RotateY(viewAngle.z);
+
+	double alpha = params->mainLightAlpha / 180.0 * M_PI;
+	double beta = params->mainLightBeta / 180.0 * M_PI;
+	CVector3 lightVector(cos(alpha - 0.5 * M_PI) * cos(beta),
+		sin(alpha - 0.5 * M_PI) * cos(beta), sin(beta));
+	if (params->mainLightPositionAsRelative) lightVector = mRot.RotateVector(lightVector);
+
+	mRot.RotateZ(-params->sweetSpotHAngle);
+	mRot.RotateX(params->sweetSpotVAngle);
+
+	p.camera = ClVector(params->camera);
+	ClMatrix(mRot, &p.rotX, &p.rotY, &p.rotZ);
+	ClMatrix(mRot.Transpose(), &p.rotInvX, &p.rotInvY, &p.rotInvZ);
+	p.lightVector = ClVector(lightVector);
+
+	// fractal
+	p.repeat = ClVector(params->common.repeat);
+	p.fractalPosition = ClVector(params->common.fractalPosition);
+	ClMatrix(params->common.mRotFractalRotation, &p.fractalRotX, &p.fractalRotY, &p.fractalRotZ);
+	p.constantMultiplier = ClVector(fractals->GetConstantMultiplier(0));
+	p.juliaConstant = ClVector(fractals->GetJuliaConstant(0) * fractals->GetConstantMultiplier(0));
+	p.formula = (fractal->formula == fractal::mandelbulb) ? 0 : 1;
+	p.N = params->N;
+	p.minN = params->minN;
+	p.iterThreshMode = params->common.iterThreshMode;
+	p.checkForBailout = fractals->IsCheckForBailout(0);
+	p.addConstant = fractals->IsAddCConstant(0);
+	p.juliaEnabled = fractals->IsJuliaEnabled(0);
+	p.bailout = fractals->GetBailout(0);
+	p.initialW = fractals->GetInitialWAxis(0);
+	p.iterationLODFactor = params->iterationLODFactor;
+	p.iterationLODReference = params->iterationLODReference;
+	p.power = fractal->bulb.power;
+	p.alphaAngleOffset = fractal->bulb.alphaAngleOffset;
+	p.betaAngleOffset = fractal->bulb.betaAngleOffset;
+
+	const sFractalMandelbox &mbox = fractal->mandelbox;
+	p.mboxOffset = ClVector(mbox.offset);
+	ClMatrix(mbox.mainRot, &p.mboxRotX, &p.mboxRotY, &p.mboxRotZ);
+	p.mboxColorFactor = ClVector(mbox.color.factor, mbox.color.factorR);
+	p.mboxFoldingLimit = mbox.foldingLimit;
+	p.mboxFoldingValue = mbox.foldingValue;
+	p.mboxScale = mbox.scale;
+	p.mboxMR2 = mbox.mR2;
+	p.mboxFR2 = mbox.fR2;
+	p.mboxFactor1 = mbox.mboxFactor1;
+	p.mboxColorSp1 = mbox.color.factorSp1;
+	p.mboxColorSp2 = mbox.color.factorSp2;
+	p.mboxMainRotation = mbox.mainRotationEnabled;
+
+	// image and ray-marching
+	double aspectRatio = (double)data->fullImageSize.x / data->fullImageSize.y;
+	if (params->perspectiveType == params::perspEquirectangular) aspectRatio = 2.0;
+	double scaleX = data->imageRegion.width / data->screenRegion.width;
+	double scaleY = data->imageRegion.height / data->screenRegion.height;
+	p.fov = params->fov;
+	p.aspectRatio = aspectRatio;
+	p.imageScaleX = scaleX;
+	p.imageScaleY = scaleY;
+	p.imageOffsetX = data->imageRegion.x1 - scaleX * data->screenRegion.x1;
+	p.imageOffsetY = data->imageRegion.y1 - scaleY * data->screenRegion.y1;
+	p.perspectiveType = params->perspectiveType;
+	p.resolution = params->resolution;
+	p.detailLevel = params->detailLevel;
+	p.DEThresh = params->DEThresh;
+	p.constantDEThreshold = params->constantDEThreshold;
+	p.DEFactor = params->DEFactor;
+	p.viewDistanceMax = params->viewDistanceMax;
+	p.reduceDetail = data->reduceDetail;
+	p.relaxation = params->raymarchingRelaxation;
+	p.smoothness = params->smoothness;
+	p.tetrahedralNormals = params->tetrahedralNormals;
+
+	// shading
+	p.mainLightEnable = params->mainLightEnable;
+	p.mainLightIntensity = params->mainLightIntensity;
+	p.mainLightColour = ClColour(params->mainLightColour, 1.0 / 65536.0);
+	p.mainLightVisibility = params->mainLightVisibility;
+	p.mainLightVisibilitySize = params->mainLightVisibilitySize;
+	p.shadowEnabled = params->shadow;
+	p.penetratingLights = params->penetratingLights;
+	p.shadowConeTan = tan(params->shadowConeAngle / 180.0 * M_PI);
+	p.softShadows = !params->common.iterThreshMode && p.shadowConeTan > 0.0;
+	p.background1 = ClColour(params->background_color1, 1.0);
+	p.background2 = ClColour(params->background_color2, 1.0);
+	p.background3 = ClColour(params->background_color3, 1.0);
+	p.shading = mat.shading;
+	double diffuse = 10.0 * (1.1 - mat.diffussionTextureIntensity);
+	p.specularDiffuse = diffuse;
+	p.specularExponent = 30.0 / mat.specularWidth / diffuse;
+	p.specularColour = ClColour(mat.specularColor, mat.specular / 65536.0);
+	p.luminosity = ClColour(mat.luminosityColor, mat.luminosity / 65536.0);
+	p.materialColour = ClColour(mat.color, 1.0 / 65536.0);
+	p.usePalette = mat.useColorsFromPalette;
+	p.coloringSpeed = mat.coloring_speed;
+	p.paletteOffset = mat.paletteOffset;
+
+	// ambient occlusion. Screen space mode is calculated by CPU after rendering
+	p.aoMode = 0;
+	if (params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeFast)
+		p.aoMode = 1;
+	else if (params->ambientOcclusionEnabled
+					 && params->ambientOcclusionMode == params::AOmodeMultipeRays)
+		p.aoMode = 2;
+	p.aoIntensity = params->ambientOcclusion;
+	p.aoFastTune = params->ambientOcclusionFastTune;
+	p.aoQuality = params->ambientOcclusionQuality;
+
+	QVector<sClAOVector> aoVectors;
+	if (p.aoMode == 2)
+	{
+		QVector<cRenderWorker::sVectorsAround> vectors(OPENCL_MAX_AO_VECTORS);
+		int count =
+			cRenderWorker::GenerateAOVectors(params, data, vectors.data(), OPENCL_MAX_AO_VECTORS);
+		aoVectors.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			aoVectors[i].direction = ClVector(vectors[i].v);
+			aoVectors[i].colour =
+				ClVector(CVector3(vectors[i].R, vectors[i].G, vectors[i].B) * (1.0 / 65536.0));
+		}
+	}
+	else
+	{
+		// kernel argument cannot be empty
+		aoVectors.resize(1);
+		memset(aoVectors.data(), 0, sizeof(sClAOVector));
+	}
+	p.aoVectorsCount = (p.aoMode == 2) ? aoVectors.size() : 0;
+
+	QVector<cl_float4> palette(OPENCL_PALETTE_SIZE);
+	for (int i = 0; i < OPENCL_PALETTE_SIZE - 1; i++)
+	{
+		sRGBfloat colour = mat.palette.IndexToColourFloat(i);
+		palette[i] = ClVector(CVector3(colour.R, colour.G, colour.B));
+	}
+	sRGBfloat negativeColour = mat.palette.IndexToColourFloat(-1);
+	palette[OPENCL_PALETTE_SIZE - 1] =
+		ClVector(CVector3(negativeColour.R, negativeColour.G, negativeColour.B));
+
+	storeNormals = image->GetImageOptional()->optionalNormal;
+
+	size_t aoSize = sizeof(sClAOVector) * aoVectors.size();
+	if (!PrepareBuffer(&aoVectorsBuffer, aoSize, &aoVectorsBufferSize, error)) return false;
+
+	cl_int err = clEnqueueWriteBuffer(queue, paramsBuffer, CL_FALSE, 0, sizeof(p), &p, 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueWriteBuffer()", error)) return false;
+	err = clEnqueueWriteBuffer(queue, paletteBuffer, CL_FALSE, 0,
+		sizeof(cl_float4) * palette.size(), palette.data(), 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueWriteBuffer()", error)) return false;
+	err = clEnqueueWriteBuffer(
+		queue, aoVectorsBuffer, CL_FALSE, 0, aoSize, aoVectors.data(), 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueWriteBuffer()", error)) return false;
+
+	// host data has to be valid until the transfer is finished
+	err = clFinish(queue);
+	return ClSucceeded(err, "clFinish()", error);
+#else
+	Q_UNUSED(params);
+	Q_UNUSED(fractals);
+	Q_UNUSED(data);
+	Q_UNUSED(image);
+	*error = QObject::tr("OpenCL support was not compiled in");
+	return false;
+#endif
+}
+
+bool cOpenClEngine::Render(
+	const QList<cRegion<int> > &tiles, int tileSize, cImage *image, QString *error)
+{
+#ifdef USE_OPENCL
+	if (!ready || tiles.isEmpty() || tileSize <= 0)
+	{
+		*error = QObject::tr("wrong OpenCL job");
+		return false;
+	}
+
+	int tilePixels = tileSize * tileSize;
+	QVector<cl_int4> tileRegions(tiles.size());
+	for (int i = 0; i < tiles.size(); i++)
+	{
+		tileRegions[i].s[0] = tiles[i].x1;
+		tileRegions[i].s[1] = tiles[i].y1;
+		tileRegions[i].s[2] = tiles[i].x2;
+		tileRegions[i].s[3] = tiles[i].y2;
+	}
+	pixels.resize(tiles.size() * tilePixels);
+
+	size_t tilesSize = sizeof(cl_int4) * tileRegions.size();
+	if (!PrepareBuffer(&tilesBuffer, tilesSize, &tilesBufferSize, error)) return false;
+	size_t pixelsSize = sizeof(sClPixel) * pixels.size();
+	if (!PrepareBuffer(&pixelsBuffer, pixelsSize, &pixelsBufferSize, error)) return false;
+
+	cl_int err = clEnqueueWriteBuffer(
+		queue, tilesBuffer, CL_FALSE, 0, tilesSize, tileRegions.data(), 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueWriteBuffer()", error)) return false;
+
+	cl_int clTileSize = tileSize;
+	err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &paramsBuffer);
+	err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &paletteBuffer);
+	err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &aoVectorsBuffer);
+	err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &tilesBuffer);
+	err |= clSetKernelArg(kernel, 4, sizeof(cl_mem), &pixelsBuffer);
+	err |= clSetKernelArg(kernel, 5, sizeof(cl_int), &clTileSize);
+	if (!ClSucceeded(err, "clSetKernelArg()", error)) return false;
+
+	size_t globalSize[3] = {(size_t)tileSize, (size_t)tileSize, (size_t)tiles.size()};
+	err = clEnqueueNDRangeKernel(queue, kernel, 3, NULL, globalSize, NULL, 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueNDRangeKernel()", error)) return false;
+	err = clEnqueueReadBuffer(
+		queue, pixelsBuffer, CL_TRUE, 0, pixelsSize, pixels.data(), 0, NULL, NULL);
+	if (!ClSucceeded(err, "clEnqueueReadBuffer()", error)) return false;
+
+	// pixels are stored in the same way as by cRenderWorker::StorePixel()
+	for (int i = 0; i < tiles.size(); i++)
+	{
+		const cRegion<int> &tile = tiles[i];
+		for (int ys = tile.y1; ys < tile.y2; ys++)
+		{
+			for (int xs = tile.x1; xs < tile.x2; xs++)
+			{
+				const sClPixel &pixel =
+					pixels[i * tilePixels + (ys - tile.y1) * tileSize + (xs - tile.x1)];
+				image->PutPixelImage(
+					xs, ys, sRGBfloat(pixel.image.s[0], pixel.image.s[1], pixel.image.s[2]));
+				image->PutPixelColour(xs, ys, sRGB8(pixel.colour.s[0] * 255, pixel.colour.s[1] * 255,
+																				pixel.colour.s[2] * 255));
+				image->PutPixelAlpha(xs, ys, pixel.colour.s[3] * 65535);
+				image->PutPixelZBuffer(xs, ys, pixel.image.s[3]);
+				image->PutPixelOpacity(xs, ys, 0);
+				if (storeNormals)
+				{
+					image->PutPixelNormal(
+						xs, ys, sRGBfloat(pixel.normal.s[0], pixel.normal.s[1], pixel.normal.s[2]));
+				}
+			}
+		}
+	}
+	return true;
+#else
+	Q_UNUSED(tiles);
+	Q_UNUSED(tileSize);
+	Q_UNUSED(image);
+	*error = QObject::tr("OpenCL support was not compiled in");
+	return false;
+#endif
+}
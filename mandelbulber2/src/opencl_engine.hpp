@@ -0,0 +1,137 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cOpenClEngine class - rendering of simple scenes by OpenCL devices
+ *
+ * Primary rays are calculated by RayMarcher kernel (share/mandelbulber2/opencl) in single
+ * precision. Only scenes with one Mandelbulb or Mandelbox formula, main light, shadows and
+ * ambient occlusion are supported. Other scenes are rendered by CPU threads
+ */
+
+#ifndef MANDELBULBER2_SRC_OPENCL_ENGINE_HPP_
+#define MANDELBULBER2_SRC_OPENCL_ENGINE_HPP_
+
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "region.hpp"
+
+#ifdef USE_OPENCL
+#define CL_TARGET_OPENCL_VERSION 120
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+#endif
+
+// forward declarations
+class cParamRender;
+class cNineFractals;
+struct sRenderData;
+class cImage;
+
+class cOpenClEngine
+{
+public:
+	static cOpenClEngine *Instance();
+
+	// checks if all features of the scene are implemented by the kernel. If not, the reason is
+	// returned
+	static bool IsSceneSupported(const cParamRender *params, const cNineFractals *fractals,
+		const sRenderData *data, cImage *image, QString *reason);
+
+	// device is used by one render job at a time
+	bool TryLock() { return lock.tryLock(); }
+	void Unlock() { lock.unlock(); }
+
+	// initialization of the device and compilation of the kernel. Done again only if other device
+	// is selected
+	bool Prepare(int platformIndex, int deviceIndex, QString *error);
+
+	// uploads parameters of the scene. Has to be called before rendering of each image
+	bool SetScene(const cParamRender *params, const cNineFractals *fractals,
+		const sRenderData *data, cImage *image, QString *error);
+
+	// size of the first job, before throughput of the device is known
+	static int GetInitialPixelsPerJob();
+
+	// renders tiles of the image in one call of the kernel and stores pixels in the image. Tiles
+	// have to be clipped to screen region and not bigger than tileSize x tileSize
+	bool Render(const QList<cRegion<int> > &tiles, int tileSize, cImage *image, QString *error);
+
+	QString GetDeviceName() const { return deviceName; }
+
+private:
+	cOpenClEngine();
+	~cOpenClEngine();
+	void Release();
+
+	static cOpenClEngine *instance;
+	QMutex lock;
+	QString deviceName;
+	int preparedPlatform;
+	int preparedDevice;
+	bool ready;
+
+	bool storeNormals;
+
+#ifdef USE_OPENCL
+	// pixels of one job returned by the kernel. Layout is the same as sClPixel in the kernel
+	struct sClPixel
+	{
+		cl_float4 image; // w is depth
+		cl_float4 colour; // w is alpha
+		cl_float4 normal;
+	};
+
+	bool PrepareBuffer(cl_mem *buffer, size_t size, size_t *allocatedSize, QString *error);
+
+	cl_device_id device;
+	cl_context context;
+	cl_command_queue queue;
+	cl_program program;
+	cl_kernel kernel;
+	cl_mem paramsBuffer;
+	cl_mem paletteBuffer;
+	cl_mem aoVectorsBuffer;
+	cl_mem tilesBuffer;
+	cl_mem pixelsBuffer;
+	size_t aoVectorsBufferSize;
+	size_t tilesBufferSize;
+	size_t pixelsBufferSize;
+	QVector<sClPixel> pixels;
+#endif
+};
+
+#endif /* MANDELBULBER2_SRC_OPENCL_ENGINE_HPP_ */
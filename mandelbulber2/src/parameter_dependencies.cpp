@@ -0,0 +1,118 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cParameterDependencies class - list of parameters used to build derived structure
+ *
+ * Records which parameters of the container are read while a structure (e.g.
+ * cParamRender) is constructed, together with their modification stamps. Later it
+ * tells which of these parameters have changed, so the structure is rebuilt only
+ * when it is needed.
+ */
+
+#include "parameter_dependencies.hpp"
+
+#include <QSet>
+
+cParameterDependencies::cParameterDependencies()
+{
+	recordedContainer = NULL;
+	layoutStamp = 0;
+	valid = false;
+}
+
+void cParameterDependencies::BeginRecording(const cParameterContainer *container)
+{
+	Clear();
+	recordedContainer = container;
+	container->SetAccessLog(&accessLog);
+}
+
+void cParameterDependencies::EndRecording()
+{
+	if (!recordedContainer) return;
+	recordedContainer->SetAccessLog(NULL);
+
+	QSet<int> recorded;
+	for (int i = 0; i < accessLog.size(); i++)
+	{
+		if (recorded.contains(accessLog[i])) continue;
+		recorded.insert(accessLog[i]);
+
+		sDependency dependency;
+		dependency.handle = sParameterHandle(accessLog[i]);
+		dependency.name = recordedContainer->GetNameOfHandle(dependency.handle);
+		dependency.stamp = recordedContainer->GetModificationStamp(dependency.handle);
+		dependencies.append(dependency);
+	}
+	accessLog.clear();
+	layoutStamp = recordedContainer->GetLayoutStamp();
+	recordedContainer = NULL;
+	valid = true;
+}
+
+bool cParameterDependencies::IsChanged(const cParameterContainer *container)
+{
+	if (IsLayoutChanged(container)) return true;
+	for (int i = 0; i < dependencies.size(); i++)
+	{
+		if (container->GetModificationStamp(dependencies[i].handle) != dependencies[i].stamp)
+			return true;
+	}
+	return false;
+}
+
+QStringList cParameterDependencies::ChangedParameters(const cParameterContainer *container)
+{
+	QStringList list;
+	for (int i = 0; i < dependencies.size(); i++)
+	{
+		// layout is the same, so handles are still valid
+		if (container->GetModificationStamp(dependencies[i].handle) != dependencies[i].stamp)
+			list.append(dependencies[i].name);
+	}
+	return list;
+}
+
+void cParameterDependencies::Update(const cParameterContainer *container)
+{
+	for (int i = 0; i < dependencies.size(); i++)
+		dependencies[i].stamp = container->GetModificationStamp(dependencies[i].handle);
+}
+
+void cParameterDependencies::Clear()
+{
+	if (recordedContainer) recordedContainer->SetAccessLog(NULL);
+	recordedContainer = NULL;
+	dependencies.clear();
+	accessLog.clear();
+	layoutStamp = 0;
+	valid = false;
+}
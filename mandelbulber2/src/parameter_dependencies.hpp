@@ -0,0 +1,86 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cParameterDependencies class - list of parameters used to build derived structure
+ *
+ * Records which parameters of the container are read while a structure (e.g.
+ * cParamRender) is constructed, together with their modification stamps. Later it
+ * tells which of these parameters have changed, so the structure is rebuilt only
+ * when it is needed.
+ */
+
+#ifndef MANDELBULBER2_SRC_PARAMETER_DEPENDENCIES_HPP_
+#define MANDELBULBER2_SRC_PARAMETER_DEPENDENCIES_HPP_
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "parameters.hpp"
+
+class cParameterDependencies
+{
+public:
+	cParameterDependencies();
+
+	// parameters read from the container between these calls are recorded
+	void BeginRecording(const cParameterContainer *container);
+	void EndRecording();
+
+	// returns true if layout of the container or value of any recorded parameter is different
+	bool IsChanged(const cParameterContainer *container);
+	// names of recorded parameters which have changed. Not valid if layout has changed
+	QStringList ChangedParameters(const cParameterContainer *container);
+	// takes actual stamps of recorded parameters after derived structure was updated
+	void Update(const cParameterContainer *container);
+	bool IsLayoutChanged(const cParameterContainer *container) const
+	{
+		return !valid || container->GetLayoutStamp() != layoutStamp;
+	}
+
+	void Clear();
+
+private:
+	struct sDependency
+	{
+		QString name;
+		sParameterHandle handle;
+		quint64 stamp;
+	};
+
+	QList<sDependency> dependencies;
+	QList<int> accessLog;
+	const cParameterContainer *recordedContainer;
+	quint64 layoutStamp;
+	bool valid;
+};
+
+#endif /* MANDELBULBER2_SRC_PARAMETER_DEPENDENCIES_HPP_ */
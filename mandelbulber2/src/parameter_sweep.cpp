@@ -0,0 +1,222 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cParameterSweep class - list of parameter variations for batch rendering
+ */
+
+#include "parameter_sweep.hpp"
+
+#include <QFile>
+#include <QObject>
+#include <QFileInfo>
+#include <QTextStream>
+
+cParameterSweep::cParameterSweep()
+{
+}
+
+bool cParameterSweep::Parse(const QString &spec)
+{
+	names.clear();
+	variations.clear();
+	errorText.clear();
+
+	bool result;
+	if (QFileInfo(spec).isFile())
+		result = ParseCSV(spec);
+	else
+		result = ParseRanges(spec);
+
+	if (result && variations.isEmpty())
+	{
+		errorText = QObject::tr("Sweep doesn't contain any variations");
+		result = false;
+	}
+	return result;
+}
+
+bool cParameterSweep::ParseCSV(const QString &fileName)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		errorText = QObject::tr("Cannot open file ") + fileName;
+		return false;
+	}
+
+	QTextStream in(&file);
+	int lineNumber = 0;
+	while (!in.atEnd())
+	{
+		QString line = in.readLine().trimmed();
+		lineNumber++;
+		if (line.isEmpty()) continue;
+
+		QStringList fields = line.split(',');
+		for (int i = 0; i < fields.size(); i++)
+			fields[i] = fields[i].trimmed();
+
+		if (names.isEmpty())
+		{
+			names = fields;
+			continue;
+		}
+		if (fields.size() != names.size())
+		{
+			errorText = QObject::tr("Wrong number of values in line %1 of %2")
+										.arg(lineNumber)
+										.arg(fileName);
+			return false;
+		}
+		variations.append(fields);
+	}
+	return true;
+}
+
+bool cParameterSweep::ParseRanges(const QString &spec)
+{
+	QList<QStringList> values;
+	QStringList items = spec.split('#', QString::SkipEmptyParts);
+	for (int i = 0; i < items.size(); i++)
+	{
+		int equal = items[i].indexOf('=');
+		bool ok = equal > 0;
+		QStringList itemValues;
+		if (ok) itemValues = ExpandValues(items[i].mid(equal + 1), &ok);
+		if (!ok)
+		{
+			errorText = QObject::tr("Sweep item '%1' is not valid. Use NAME=START:END:STEPS or "
+															"NAME=VALUE1,VALUE2,...")
+										.arg(items[i]);
+			return false;
+		}
+		names.append(items[i].left(equal).trimmed());
+		values.append(itemValues);
+	}
+
+	// all combinations of values, the last parameter changes fastest
+	variations.append(QStringList());
+	for (int i = 0; i < values.size(); i++)
+	{
+		QList<QStringList> combined;
+		for (int v = 0; v < variations.size(); v++)
+		{
+			for (int k = 0; k < values[i].size(); k++)
+			{
+				combined.append(variations[v] + QStringList(values[i][k]));
+			}
+		}
+		variations = combined;
+	}
+	if (names.isEmpty()) variations.clear();
+	return true;
+}
+
+QStringList cParameterSweep::ExpandValues(const QString &text, bool *ok)
+{
+	QStringList range = text.split(':');
+	if (range.size() == 1)
+	{
+		QStringList list = text.split(',', QString::SkipEmptyParts);
+		for (int i = 0; i < list.size(); i++)
+			list[i] = list[i].trimmed();
+		*ok = !list.isEmpty();
+		return list;
+	}
+
+	QStringList result;
+	*ok = false;
+	if (range.size() != 3) return result;
+
+	int steps = range[2].toInt(ok);
+	if (!*ok || steps < 1) return result;
+
+	QStringList start = range[0].split(' ', QString::SkipEmptyParts);
+	QStringList end = range[1].split(' ', QString::SkipEmptyParts);
+	if (start.isEmpty() || start.size() != end.size())
+	{
+		*ok = false;
+		return result;
+	}
+
+	// integer parameters stay integer
+	bool integer = true;
+	QList<double> startValues;
+	QList<double> endValues;
+	for (int c = 0; c < start.size(); c++)
+	{
+		bool okStart, okEnd;
+		startValues.append(start[c].toDouble(&okStart));
+		endValues.append(end[c].toDouble(&okEnd));
+		if (!okStart || !okEnd)
+		{
+			*ok = false;
+			return result;
+		}
+		bool intStart, intEnd;
+		start[c].toInt(&intStart);
+		end[c].toInt(&intEnd);
+		integer = integer && intStart && intEnd;
+	}
+
+	for (int i = 0; i < steps; i++)
+	{
+		double t = (steps > 1) ? double(i) / (steps - 1) : 0.0;
+		QStringList components;
+		for (int c = 0; c < startValues.size(); c++)
+		{
+			double value = startValues[c] + (endValues[c] - startValues[c]) * t;
+			if (integer)
+				components.append(QString::number(qRound(value)));
+			else
+				components.append(QString::number(value, 'g', 16));
+		}
+		result.append(components.join(' '));
+	}
+	return result;
+}
+
+QString cParameterSweep::GetOverrides(int index) const
+{
+	QStringList overrides;
+	const QStringList &values = variations.at(index);
+	for (int i = 0; i < names.size(); i++)
+	{
+		// empty CSV field keeps value of the base scene
+		if (!values[i].isEmpty()) overrides.append(names[i] + "=" + values[i]);
+	}
+	return overrides.join('#');
+}
+
+QString cParameterSweep::VariationFileName(const QString &baseName, int index)
+{
+	return baseName + "_" + QString("%1").arg(index, 5, 10, QChar('0'));
+}
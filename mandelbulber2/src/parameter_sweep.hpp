@@ -0,0 +1,75 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cParameterSweep class - list of parameter variations for batch rendering
+ *
+ * Variations are given as NAME=START:END:STEPS or NAME=V1,V2,V3 separated by '#'
+ * (all combinations are rendered, the last parameter changes fastest) or as path
+ * to CSV file with parameter names in the first row and one variation in each
+ * next row. Every variation is converted to the format of --override option,
+ * so the scene is loaded once and only swept parameters are changed.
+ */
+
+#ifndef MANDELBULBER2_SRC_PARAMETER_SWEEP_HPP_
+#define MANDELBULBER2_SRC_PARAMETER_SWEEP_HPP_
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class cParameterSweep
+{
+public:
+	cParameterSweep();
+
+	// spec is list of ranges or name of CSV file
+	bool Parse(const QString &spec);
+	QString GetErrorText() const { return errorText; }
+
+	int GetNumberOfVariations() const { return variations.size(); }
+	QStringList GetParameterNames() const { return names; }
+	// KEY1=VALUE1#KEY2=VALUE2 list which is applied to the base scene
+	QString GetOverrides(int index) const;
+	// image file name of variation without extension: baseName_00001
+	static QString VariationFileName(const QString &baseName, int index);
+
+private:
+	bool ParseCSV(const QString &fileName);
+	bool ParseRanges(const QString &spec);
+	// values of NAME=START:END:STEPS or NAME=V1,V2,V3. START and END can be vectors
+	static QStringList ExpandValues(const QString &text, bool *ok);
+
+	QStringList names;
+	QList<QStringList> variations;
+	QString errorText;
+};
+
+#endif /* MANDELBULBER2_SRC_PARAMETER_SWEEP_HPP_ */
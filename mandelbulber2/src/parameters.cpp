@@ -40,9 +40,41 @@
 
 using namespace parameterContainer;
 
+QAtomicInteger<quint64> cParameterContainer::stampCounter(0);
+
 cParameterContainer::cParameterContainer()
 {
 	myMap.clear();
+	layoutStamp = NewStamp();
+	structuralHash = 0;
+	accessLog = NULL;
+}
+
+cParameterContainer::cParameterContainer(const cParameterContainer &other)
+		: myMap(other.myMap),
+			parameters(other.parameters),
+			names(other.names),
+			stamps(other.stamps),
+			parameterHashes(other.parameterHashes),
+			layoutStamp(other.layoutStamp),
+			structuralHash(other.structuralHash),
+			containerName(other.containerName)
+{
+	accessLog = NULL;
+}
+
+cParameterContainer &cParameterContainer::operator=(const cParameterContainer &other)
+{
+	// access log is not copied, it belongs to the object which records
+	myMap = other.myMap;
+	parameters = other.parameters;
+	names = other.names;
+	stamps = other.stamps;
+	parameterHashes = other.parameterHashes;
+	layoutStamp = other.layoutStamp;
+	structuralHash = other.structuralHash;
+	containerName = other.containerName;
+	return *this;
 }
 
 cParameterContainer::~cParameterContainer()
@@ -50,6 +82,49 @@ cParameterContainer::~cParameterContainer()
 	myMap.clear();
 }
 
+// parameter is appended to flat store, handle is its position in the store
+void cParameterContainer::InsertParameter(const QString &name, const cOneParameter &parameter)
+{
+	myMap.insert(name, parameters.size());
+	parameters.append(QSharedDataPointer<sSharedParameter>(new sSharedParameter(parameter)));
+	names.append(name);
+	stamps.append(NewStamp());
+	parameterHashes.append(0);
+	UpdateParameterHash(parameters.size() - 1);
+	layoutStamp = NewStamp();
+}
+
+// stamp is changed only if the value is different
+void cParameterContainer::SetParameterValue(int index, const cOneParameter &parameter)
+{
+	if (!(ParameterAt(index).GetMultival(valueActual) == parameter.GetMultival(valueActual)))
+		stamps[index] = NewStamp();
+	StoreParameter(index, parameter);
+	UpdateParameterHash(index);
+}
+
+quint64 cParameterContainer::ParameterHash(int index) const
+{
+	const cOneParameter &parameter = ParameterAt(index);
+	if (names[index].isEmpty() || parameter.GetParameterType() != paramStandard) return 0;
+	quint64 nameHash = cMultiVal::HashBytes(
+		names[index].constData(), names[index].size() * sizeof(QChar), 0);
+	return parameter.GetMultival(valueActual).GetHash(nameHash);
+}
+
+// hashes of parameters are summed, so one of them can be replaced without visiting the others
+void cParameterContainer::UpdateParameterHash(int index)
+{
+	quint64 newHash = ParameterHash(index);
+	structuralHash += newHash - parameterHashes[index];
+	parameterHashes[index] = newHash;
+}
+
+quint64 cParameterContainer::GetModificationStamp(sParameterHandle handle) const
+{
+	return IsValidHandle(handle) ? stamps[handle.index] : 0;
+}
+
 // defining of params without limits
 template <class T>
 void cParameterContainer::addParam(
@@ -68,7 +143,7 @@ void cParameterContainer::addParam(
 	}
 	else
 	{
-		myMap.insert(name, newRecord);
+		InsertParameter(name, newRecord);
 	}
 }
 template void cParameterContainer::addParam<double>(
@@ -108,7 +183,7 @@ void cParameterContainer::addParam(QString name, T defaultVal, T minVal, T maxVa
 	}
 	else
 	{
-		myMap.insert(name, newRecord);
+		InsertParameter(name, newRecord);
 	}
 }
 template void cParameterContainer::addParam<double>(QString name, double defaultVal, double minVal,
@@ -143,7 +218,7 @@ void cParameterContainer::addParam(
 		}
 		else
 		{
-			myMap.insert(indexName, newRecord);
+			InsertParameter(indexName, newRecord);
 		}
 	}
 	else
@@ -190,7 +265,7 @@ void cParameterContainer::addParam(QString name, int index, T defaultVal, T minV
 		}
 		else
 		{
-			myMap.insert(indexName, newRecord);
+			InsertParameter(indexName, newRecord);
 		}
 	}
 	else
@@ -214,11 +289,12 @@ template void cParameterContainer::addParam<sRGB>(QString name, int index, sRGB
 template <class T>
 void cParameterContainer::Set(QString name, T val)
 {
-	QMap<QString, cOneParameter>::iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
+	if (it != myMap.constEnd())
 	{
-		it->Set(val, valueActual);
+		cOneParameter parameter = ParameterAt(it.value());
+		parameter.Set(val, valueActual);
+		SetParameterValue(it.value(), parameter);
 	}
 	else
 	{
@@ -241,11 +317,12 @@ void cParameterContainer::Set(QString name, int index, T val)
 	if (index >= 0)
 	{
 		QString indexName = nameWithIndex(&name, index);
-		QMap<QString, cOneParameter>::iterator it;
-		it = myMap.find(indexName);
-		if (it != myMap.end())
+		QMap<QString, int>::const_iterator it = myMap.constFind(indexName);
+		if (it != myMap.constEnd())
 		{
-			it->Set(val, valueActual);
+			cOneParameter parameter = ParameterAt(it.value());
+		parameter.Set(val, valueActual);
+		SetParameterValue(it.value(), parameter);
 		}
 		else
 		{
@@ -269,12 +346,12 @@ template void cParameterContainer::Set<bool>(QString name, int index, bool val);
 template <class T>
 T cParameterContainer::Get(QString name) const
 {
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
 	T val = T();
-	if (it != myMap.end())
+	if (it != myMap.constEnd())
 	{
-		val = it.value().Get<T>(valueActual);
+		val = ParameterAt(it.value()).Get<T>(valueActual);
+		LogAccess(it.value());
 	}
 	else
 	{
@@ -299,11 +376,12 @@ T cParameterContainer::Get(QString name, int index) const
 	if (index >= 0)
 	{
 		QString indexName = nameWithIndex(&name, index);
-		QMap<QString, cOneParameter>::const_iterator it;
-		it = myMap.find(indexName);
-		if (it != myMap.end())
+		QMap<QString, int>::const_iterator it = myMap.constFind(indexName);
+		if (it != myMap.constEnd())
 		{
-			val = it.value().Get<T>(valueActual);
+			val = ParameterAt(it.value()).Get<T>(valueActual);
+			LogAccess(it.value());
+		LogAccess(it.value());
 		}
 		else
 		{
@@ -328,12 +406,11 @@ template bool cParameterContainer::Get<bool>(QString name, int index) const;
 template <class T>
 T cParameterContainer::GetDefault(QString name) const
 {
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
 	T val = T();
-	if (it != myMap.end())
+	if (it != myMap.constEnd())
 	{
-		val = it.value().Get<T>(valueDefault);
+		val = ParameterAt(it.value()).Get<T>(valueDefault);
 	}
 	else
 	{
@@ -358,11 +435,10 @@ T cParameterContainer::GetDefault(QString name, int index) const
 	if (index >= 0)
 	{
 		QString indexName = nameWithIndex(&name, index);
-		QMap<QString, cOneParameter>::const_iterator it;
-		it = myMap.find(indexName);
-		if (it != myMap.end())
+		QMap<QString, int>::const_iterator it = myMap.constFind(indexName);
+		if (it != myMap.constEnd())
 		{
-			val = it.value().Get<T>(valueDefault);
+			val = ParameterAt(it.value()).Get<T>(valueDefault);
 		}
 		else
 		{
@@ -392,15 +468,19 @@ QString cParameterContainer::nameWithIndex(QString *str, int index) const
 
 void cParameterContainer::Copy(QString name, const cParameterContainer *sourceContainer)
 {
-	QMap<QString, cOneParameter>::const_iterator itSource;
-	QMap<QString, cOneParameter>::iterator itDest;
-	itDest = myMap.find(name);
-	if (itDest != myMap.end())
+	QMap<QString, int>::const_iterator itDest = myMap.constFind(name);
+	if (itDest != myMap.constEnd())
 	{
-		itSource = sourceContainer->myMap.find(name);
-		if (itSource != myMap.end())
+		QMap<QString, int>::const_iterator itSource = sourceContainer->myMap.constFind(name);
+		if (itSource != sourceContainer->myMap.constEnd())
 		{
-			itDest.value() = itSource.value();
+			// record is shared with source container
+			int destIndex = itDest.value();
+			const cOneParameter &source = sourceContainer->ParameterAt(itSource.value());
+			if (!(ParameterAt(destIndex).GetMultival(valueActual) == source.GetMultival(valueActual)))
+				stamps[destIndex] = NewStamp();
+			parameters[destIndex] = sourceContainer->parameters.at(itSource.value());
+			UpdateParameterHash(destIndex);
 		}
 		else
 		{
@@ -424,11 +504,10 @@ enumVarType cParameterContainer::GetVarType(QString name) const
 {
 	enumVarType type = typeNull;
 
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
+	if (it != myMap.constEnd())
 	{
-		type = it.value().GetValueType();
+		type = ParameterAt(it.value()).GetValueType();
 	}
 	else
 	{
@@ -441,11 +520,10 @@ enumParameterType cParameterContainer::GetParameterType(QString name) const
 {
 	enumParameterType type = paramStandard;
 
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
+	if (it != myMap.constEnd())
 	{
-		type = it.value().GetParameterType();
+		type = ParameterAt(it.value()).GetParameterType();
 	}
 	else
 	{
@@ -458,11 +536,10 @@ bool cParameterContainer::isDefaultValue(QString name) const
 {
 	bool isDefault = true;
 
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
+	if (it != myMap.constEnd())
 	{
-		isDefault = it.value().isDefaultValue();
+		isDefault = ParameterAt(it.value()).isDefaultValue();
 	}
 	else
 	{
@@ -472,23 +549,42 @@ bool cParameterContainer::isDefaultValue(QString name) const
 	return isDefault;
 }
 
+// storage of prototype is implicitly shared, so copy is made without inserting parameters one by
+// one. Original container names of parameters are updated only if they are different
+void cParameterContainer::AssignFromPrototype(const cParameterContainer &prototype)
+{
+	QString name = containerName;
+	*this = prototype;
+	containerName = name;
+	if (prototype.containerName != containerName)
+	{
+		for (int i = 0; i < parameters.size(); i++)
+		{
+			cOneParameter parameter = ParameterAt(i);
+			parameter.SetOriginalContainerName(containerName);
+			StoreParameter(i, parameter);
+		}
+	}
+}
+
 void cParameterContainer::ResetAllToDefault(void)
 {
-	QMap<QString, cOneParameter>::iterator it = myMap.begin();
-	while (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constBegin();
+	while (it != myMap.constEnd())
 	{
-		cOneParameter record = it.value();
+		cOneParameter record = ParameterAt(it.value());
 		if (record.GetParameterType() != paramApp)
-			it.value().SetMultival(record.GetMultival(valueDefault), valueActual);
+		{
+			record.SetMultival(record.GetMultival(valueDefault), valueActual);
+			SetParameterValue(it.value(), record);
+		}
 		++it;
 	}
 }
 
 bool cParameterContainer::IfExists(const QString &name) const
 {
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	if (myMap.contains(name))
 	{
 		return true;
 	}
@@ -500,11 +596,15 @@ bool cParameterContainer::IfExists(const QString &name) const
 
 void cParameterContainer::DeleteParameter(const QString &name)
 {
-	QMap<QString, cOneParameter>::iterator it;
-	it = myMap.find(name);
+	QMap<QString, int>::iterator it = myMap.find(name);
 	if (it != myMap.end())
 	{
-		myMap.remove(name);
+		// slot in the store is left empty, so handles of other parameters stay valid
+		StoreParameter(it.value(), cOneParameter());
+		names[it.value()].clear();
+		UpdateParameterHash(it.value());
+		myMap.erase(it);
+		layoutStamp = NewStamp();
 	}
 	else
 	{
@@ -514,12 +614,12 @@ void cParameterContainer::DeleteParameter(const QString &name)
 
 cOneParameter cParameterContainer::GetAsOneParameter(QString name) const
 {
-	QMap<QString, cOneParameter>::const_iterator it;
-	it = myMap.find(name);
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
 	cOneParameter val;
-	if (it != myMap.end())
+	if (it != myMap.constEnd())
 	{
-		val = it.value();
+		val = ParameterAt(it.value());
+		LogAccess(it.value());
 	}
 	else
 	{
@@ -531,11 +631,10 @@ cOneParameter cParameterContainer::GetAsOneParameter(QString name) const
 
 void cParameterContainer::SetFromOneParameter(QString name, const cOneParameter &parameter)
 {
-	QMap<QString, cOneParameter>::iterator it;
-	it = myMap.find(name);
-	if (it != myMap.end())
+	QMap<QString, int>::const_iterator it = myMap.constFind(name);
+	if (it != myMap.constEnd())
 	{
-		it.value() = parameter;
+		SetParameterValue(it.value(), parameter);
 	}
 	else
 	{
@@ -555,6 +654,101 @@ void cParameterContainer::AddParamFromOneParameter(QString name, const cOneParam
 	}
 	else
 	{
-		myMap.insert(name, parameter);
+		InsertParameter(name, parameter);
+	}
+}
+
+sParameterHandle cParameterContainer::GetHandle(const QString &name) const
+{
+	return sParameterHandle(myMap.value(name, -1));
+}
+
+sParameterHandle cParameterContainer::GetHandle(QString name, int index) const
+{
+	return sParameterHandle(myMap.value(nameWithIndex(&name, index), -1));
+}
+
+sParameterHandle cParameterContainer::FindHandle(const QString &name, sParameterHandle hint) const
+{
+	if (IsValidHandle(hint) && names[hint.index] == name) return hint;
+	return GetHandle(name);
+}
+
+// set parameter value by handle
+template <class T>
+void cParameterContainer::Set(sParameterHandle handle, T val)
+{
+	if (IsValidHandle(handle))
+	{
+		cOneParameter parameter = ParameterAt(handle.index);
+		parameter.Set(val, valueActual);
+		SetParameterValue(handle.index, parameter);
+	}
+	else
+	{
+		qWarning() << "Set(): wrong parameter handle" << handle.index << endl;
+	}
+}
+template void cParameterContainer::Set<double>(sParameterHandle handle, double val);
+template void cParameterContainer::Set<int>(sParameterHandle handle, int val);
+template void cParameterContainer::Set<QString>(sParameterHandle handle, QString val);
+template void cParameterContainer::Set<CVector3>(sParameterHandle handle, CVector3 val);
+template void cParameterContainer::Set<CVector4>(sParameterHandle handle, CVector4 val);
+template void cParameterContainer::Set<sRGB>(sParameterHandle handle, sRGB val);
+template void cParameterContainer::Set<bool>(sParameterHandle handle, bool val);
+template void cParameterContainer::Set<cColorPalette>(sParameterHandle handle, cColorPalette val);
+
+// get parameter value by handle
+template <class T>
+T cParameterContainer::Get(sParameterHandle handle) const
+{
+	T val = T();
+	if (IsValidHandle(handle))
+	{
+		val = ParameterAt(handle.index).Get<T>(valueActual);
+		LogAccess(handle.index);
+	}
+	else
+	{
+		qWarning() << "Get(): wrong parameter handle" << handle.index << endl;
+	}
+	return val;
+}
+template double cParameterContainer::Get<double>(sParameterHandle handle) const;
+template int cParameterContainer::Get<int>(sParameterHandle handle) const;
+template QString cParameterContainer::Get<QString>(sParameterHandle handle) const;
+template CVector3 cParameterContainer::Get<CVector3>(sParameterHandle handle) const;
+template CVector4 cParameterContainer::Get<CVector4>(sParameterHandle handle) const;
+template sRGB cParameterContainer::Get<sRGB>(sParameterHandle handle) const;
+template bool cParameterContainer::Get<bool>(sParameterHandle handle) const;
+template cColorPalette cParameterContainer::Get<cColorPalette>(sParameterHandle handle) const;
+
+cOneParameter cParameterContainer::GetAsOneParameter(sParameterHandle handle) const
+{
+	cOneParameter val;
+	if (IsValidHandle(handle))
+	{
+		val = ParameterAt(handle.index);
+		LogAccess(handle.index);
+	}
+	else
+	{
+		qWarning() << "cParameterContainer::GetAsOneParameter(): wrong parameter handle"
+							 << handle.index << endl;
+	}
+	return val;
+}
+
+void cParameterContainer::SetFromOneParameter(
+	sParameterHandle handle, const cOneParameter &parameter)
+{
+	if (IsValidHandle(handle))
+	{
+		SetParameterValue(handle.index, parameter);
+	}
+	else
+	{
+		qWarning() << "cParameterContainer::SetFromOneParameter(): wrong parameter handle"
+							 << handle.index << endl;
 	}
 }
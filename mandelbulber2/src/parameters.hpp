@@ -39,10 +39,22 @@
 #include <QtCore>
 
 using namespace parameterContainer;
+
+// stable position of parameter in the flat store of container. Valid for the container where it
+// was obtained and for its copies
+struct sParameterHandle
+{
+	sParameterHandle() : index(-1) {}
+	explicit sParameterHandle(int _index) : index(_index) {}
+	int index;
+};
+
 class cParameterContainer
 {
 public:
 	cParameterContainer();
+	cParameterContainer(const cParameterContainer &other);
+	cParameterContainer &operator=(const cParameterContainer &other);
 	~cParameterContainer();
 
 	template <class T>
@@ -73,6 +85,38 @@ public:
 
 	cOneParameter GetAsOneParameter(QString name) const;
 	void SetFromOneParameter(QString name, const cOneParameter &parameter);
+
+	// access by handle, without looking up parameter name
+	sParameterHandle GetHandle(const QString &name) const;
+	sParameterHandle GetHandle(QString name, int index) const;
+	// returns hint if it still points to parameter with given name, otherwise looks up the name
+	sParameterHandle FindHandle(const QString &name, sParameterHandle hint) const;
+	bool IsValidHandle(sParameterHandle handle) const
+	{
+		return handle.index >= 0 && handle.index < names.size() && !names[handle.index].isEmpty();
+	}
+	// handles are indexes from 0 to GetNumberOfHandles() - 1, including deleted parameters
+	int GetNumberOfHandles() const { return names.size(); }
+	template <class T>
+	void Set(sParameterHandle handle, T val);
+	template <class T>
+	T Get(sParameterHandle handle) const;
+	cOneParameter GetAsOneParameter(sParameterHandle handle) const;
+	void SetFromOneParameter(sParameterHandle handle, const cOneParameter &parameter);
+
+	// dirty tracking. Every change of parameter value gets new unique stamp, which is copied
+	// together with the value. The layout stamp changes when parameters are added or deleted
+	quint64 GetModificationStamp(sParameterHandle handle) const;
+	quint64 GetLayoutStamp() const { return layoutStamp; }
+	// hash of names and values of all standard parameters (the ones stored in settings files).
+	// It is updated with every change, so it is available without serialization of settings
+	quint64 GetStructuralHash() const { return structuralHash; }
+	QString GetNameOfHandle(sParameterHandle handle) const
+	{
+		return IsValidHandle(handle) ? names[handle.index] : QString();
+	}
+	// handles of parameters read by Get() are appended to the log while it is set
+	void SetAccessLog(QList<int> *log) const { accessLog = log; }
 	void AddParamFromOneParameter(QString name, const cOneParameter &parameter);
 
 	enumVarType GetVarType(QString name) const;
@@ -81,6 +125,8 @@ public:
 	void Copy(QString name, const cParameterContainer *sourceContainer);
 	QList<QString> GetListOfParameters(void) const;
 	void ResetAllToDefault(void);
+	// replaces all parameters with copy of prototype. Container name is kept
+	void AssignFromPrototype(const cParameterContainer &prototype);
 	void SetContainerName(QString name) { containerName = name; }
 	QString GetContainerName(void) const { return containerName; }
 	bool IfExists(const QString &name) const;
@@ -88,14 +134,47 @@ public:
 
 private:
 	QString nameWithIndex(QString *str, int index) const;
+	void InsertParameter(const QString &name, const cOneParameter &parameter);
+	void SetParameterValue(int index, const cOneParameter &parameter);
+	void LogAccess(int index) const
+	{
+		if (accessLog) accessLog->append(index);
+	}
+	static quint64 NewStamp() { return stampCounter.fetchAndAddRelaxed(1) + 1; }
+	// contribution of parameter to structural hash, zero for deleted and non-standard parameters
+	quint64 ParameterHash(int index) const;
+	void UpdateParameterHash(int index);
+
+	// parameter record shared by copies of container. Modified parameter is replaced with new
+	// record, so copying container never copies parameters and writes allocate only one record
+	struct sSharedParameter : public QSharedData
+	{
+		explicit sSharedParameter(const cOneParameter &_parameter) : parameter(_parameter) {}
+		cOneParameter parameter;
+	};
+	// read access which doesn't detach shared record
+	const cOneParameter &ParameterAt(int index) const { return parameters.at(index)->parameter; }
+	void StoreParameter(int index, const cOneParameter &parameter)
+	{
+		parameters[index] = QSharedDataPointer<sSharedParameter>(new sSharedParameter(parameter));
+	}
 
 	static bool compareStrings(const QString &p1, const QString &p2)
 	{
 		return QString::compare(p1, p2, Qt::CaseInsensitive) < 0;
 	}
 
-	// std::map contairer
-	QMap<QString, cOneParameter> myMap;
+	// handles of parameters sorted by name
+	QMap<QString, int> myMap;
+	// flat store of parameters and their names (empty name for deleted parameter)
+	QVector<QSharedDataPointer<sSharedParameter>> parameters;
+	QVector<QString> names;
+	QVector<quint64> stamps;
+	QVector<quint64> parameterHashes;
+	quint64 layoutStamp;
+	quint64 structuralHash;
+	mutable QList<int> *accessLog;
+	static QAtomicInteger<quint64> stampCounter;
 	QString containerName;
 };
 
@@ -0,0 +1,185 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPlayerFrameCache class - decoded frames of animation player
+ *
+ * Frames are decoded in background threads ahead of the played frame and kept in
+ * RAM cache limited by memory size, so playback doesn't wait for disk and image
+ * decoder. Frames are downscaled to the size of player widget while decoded.
+ */
+
+#include "player_frame_cache.hpp"
+
+#include <QImageReader>
+#include <QThread>
+
+cPlayerFrameDecoder::cPlayerFrameDecoder(const QAtomicInt *_generation)
+		: QObject(), generation(_generation)
+{
+}
+
+QImage cPlayerFrameDecoder::Decode(const QString &fileName, const QSize &size)
+{
+	QImageReader reader(fileName);
+	QSize imageSize = reader.size();
+	// JPEG decoder can skip pixels when image is downscaled while reading
+	if (imageSize.isValid() && size.isValid()
+			&& (imageSize.width() > size.width() || imageSize.height() > size.height()))
+		reader.setScaledSize(imageSize.scaled(size, Qt::KeepAspectRatio));
+	return reader.read();
+}
+
+void cPlayerFrameDecoder::slotDecode(int requestGeneration, int index, QString fileName, QSize size)
+{
+	// file list or size was changed after request
+	if (requestGeneration != generation->load())
+	{
+		emit frameDecoded(requestGeneration, index, QImage());
+		return;
+	}
+	emit frameDecoded(requestGeneration, index, Decode(fileName, size));
+}
+
+cPlayerFrameCache::cPlayerFrameCache(QObject *parent) : QObject(parent)
+{
+	nextDecoder = 0;
+	frameKB = 0;
+	cache.setMaxCost(PLAYER_FRAME_CACHE_MB * 1024);
+
+	// one thread is left for the player and GUI
+	int numberOfThreads = qBound(1, QThread::idealThreadCount() - 1, 4);
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		QThread *thread = new QThread;
+		thread->setObjectName("PlayerFrameDecoder #" + QString::number(i));
+		cPlayerFrameDecoder *decoder = new cPlayerFrameDecoder(&generation);
+		decoder->moveToThread(thread);
+		connect(decoder, SIGNAL(frameDecoded(int, int, QImage)), this,
+			SLOT(slotFrameDecoded(int, int, QImage)));
+		thread->start();
+		threads.append(thread);
+		decoders.append(decoder);
+	}
+}
+
+cPlayerFrameCache::~cPlayerFrameCache()
+{
+	// waiting requests are skipped
+	generation.ref();
+	for (int i = 0; i < threads.size(); i++)
+	{
+		threads[i]->quit();
+		threads[i]->wait();
+		delete decoders[i];
+		delete threads[i];
+	}
+}
+
+void cPlayerFrameCache::Clear()
+{
+	generation.ref();
+	cache.clear();
+	pending.clear();
+}
+
+void cPlayerFrameCache::SetFiles(const QString &_dirPath, const QStringList &_fileNames)
+{
+	if (_dirPath == dirPath && _fileNames == fileNames) return;
+	dirPath = _dirPath;
+	fileNames = _fileNames;
+	Clear();
+}
+
+void cPlayerFrameCache::SetTargetSize(const QSize &size)
+{
+	if (size == targetSize) return;
+	targetSize = size;
+	Clear();
+}
+
+QImage cPlayerFrameCache::GetFrame(int index)
+{
+	if (index < 0 || index >= fileNames.size()) return QImage();
+
+	QImage image;
+	if (cache.contains(index))
+	{
+		image = *cache.object(index);
+	}
+	else
+	{
+		image = cPlayerFrameDecoder::Decode(dirPath + "/" + fileNames.at(index), targetSize);
+		if (!image.isNull()) Insert(index, image);
+	}
+	Prefetch(index);
+	return image;
+}
+
+void cPlayerFrameCache::Insert(int index, const QImage &image)
+{
+	frameKB = qMax(1, int(image.byteCount() / 1024));
+	cache.insert(index, new QImage(image), frameKB);
+}
+
+void cPlayerFrameCache::Prefetch(int index)
+{
+	// prefetched frames can't push out frames which will be played before them
+	int framesInCache = frameKB > 0 ? cache.maxCost() / frameKB - 1 : 1;
+	int count = qMin(qMin(PLAYER_PREFETCH_FRAMES, framesInCache), fileNames.size() - 1);
+
+	// frames which will be played first are the most recently used ones
+	for (int i = count; i >= 1; i--)
+	{
+		int frame = (index + i) % fileNames.size();
+		if (cache.contains(frame)) cache.object(frame);
+	}
+
+	for (int i = 1; i <= count; i++)
+	{
+		int frame = (index + i) % fileNames.size();
+		if (cache.contains(frame) || pending.contains(frame)) continue;
+
+		pending.insert(frame);
+		// requests are distributed between threads
+		cPlayerFrameDecoder *decoder = decoders[nextDecoder];
+		nextDecoder = (nextDecoder + 1) % decoders.size();
+		QMetaObject::invokeMethod(decoder, "slotDecode", Qt::QueuedConnection,
+			Q_ARG(int, generation.load()), Q_ARG(int, frame),
+			Q_ARG(QString, dirPath + "/" + fileNames.at(frame)), Q_ARG(QSize, targetSize));
+	}
+}
+
+void cPlayerFrameCache::slotFrameDecoded(int requestGeneration, int index, QImage image)
+{
+	if (requestGeneration != generation.load()) return;
+	pending.remove(index);
+	if (!image.isNull()) Insert(index, image);
+}
@@ -0,0 +1,114 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cPlayerFrameCache class - decoded frames of animation player
+ *
+ * Frames are decoded in background threads ahead of the played frame and kept in
+ * RAM cache limited by memory size, so playback doesn't wait for disk and image
+ * decoder. Frames are downscaled to the size of player widget while decoded.
+ */
+
+#ifndef MANDELBULBER2_SRC_PLAYER_FRAME_CACHE_HPP_
+#define MANDELBULBER2_SRC_PLAYER_FRAME_CACHE_HPP_
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QSize>
+#include <QStringList>
+
+// forward declarations
+class QThread;
+
+// limit of memory used by decoded frames
+#define PLAYER_FRAME_CACHE_MB 512
+// maximum number of frames decoded ahead of the played one
+#define PLAYER_PREFETCH_FRAMES 32
+
+// decodes frames in own thread
+class cPlayerFrameDecoder : public QObject
+{
+	Q_OBJECT
+public:
+	cPlayerFrameDecoder(const QAtomicInt *_generation);
+
+	// image file downscaled to fit in size (not upscaled)
+	static QImage Decode(const QString &fileName, const QSize &size);
+
+public slots:
+	void slotDecode(int generation, int index, QString fileName, QSize size);
+
+signals:
+	void frameDecoded(int generation, int index, QImage image);
+
+private:
+	const QAtomicInt *generation; // requests of older generations are skipped
+};
+
+class cPlayerFrameCache : public QObject
+{
+	Q_OBJECT
+public:
+	cPlayerFrameCache(QObject *parent = NULL);
+	~cPlayerFrameCache();
+
+	// list of frame files. Cached frames are cleared
+	void SetFiles(const QString &dirPath, const QStringList &fileNames);
+	// frames are decoded to fit in this size. Cached frames are cleared when it's changed
+	void SetTargetSize(const QSize &size);
+	// frame from the cache (decoded immediately if not cached). Next frames are prefetched
+	QImage GetFrame(int index);
+	bool IsCached(int index) const { return cache.contains(index); }
+
+private slots:
+	void slotFrameDecoded(int generation, int index, QImage image);
+
+private:
+	void Clear();
+	void Prefetch(int index);
+	void Insert(int index, const QImage &image);
+
+	QList<QThread *> threads;
+	QList<cPlayerFrameDecoder *> decoders;
+	int nextDecoder;
+	QAtomicInt generation;
+	QCache<int, QImage> cache; // cost in kilobytes
+	QSet<int> pending;
+	QString dirPath;
+	QStringList fileNames;
+	QSize targetSize;
+	int frameKB; // size of last decoded frame
+};
+
+#endif /* MANDELBULBER2_SRC_PLAYER_FRAME_CACHE_HPP_ */
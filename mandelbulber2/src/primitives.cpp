@@ -33,11 +33,15 @@
  */
 
 #include <QtAlgorithms>
+#include <algorithm>
 
 #include "primitives.h"
 #include "displacement_map.hpp"
+#include "material.h"
 #include "parameters.hpp"
+#include "render_data.hpp"
 #include "system.hpp"
+#include "water_heightfield.hpp"
 
 using namespace fractal;
 
@@ -172,6 +176,13 @@ cPrimitives::cPrimitives(const cParameterContainer *par, QVector<cObjectData> *o
 				obj->iterations = par->Get<int>(item.name + "_iterations");
 				obj->animFrame = par->Get<int>("frame_no");
 				obj->size = CVector3(1.0, 1.0, 1.0);
+				obj->heightfield = NULL;
+				if (par->Get<bool>(item.name + "_baked"))
+				{
+					cWaterHeightfield *heightfield = new cWaterHeightfield(obj);
+					waterHeightfields.append(heightfield);
+					obj->heightfield = heightfield;
+				}
 				break;
 			}
 			case objCone:
@@ -258,12 +269,188 @@ cPrimitives::cPrimitives(const cParameterContainer *par, QVector<cObjectData> *o
 	allPrimitivesRotation = par->Get<CVector3>("all_primitives_rotation");
 	mRotAllPrimitivesRotation.SetRotation2(allPrimitivesRotation / 180.0 * M_PI);
 
+	BuildBVH(par);
+
 	WriteLog("cPrimitives::cPrimitives(const cParameterContainer *par) finished", 2);
 }
 
+// calculates sphere which encloses primitive. Returns false for infinite or repeated objects
+static bool PrimitiveBoundingSphere(
+	const sPrimitiveBasic *primitive, double *radius, double *distanceFactor)
+{
+	using namespace fractal;
+	*distanceFactor = 1.0;
+	switch (primitive->objectType)
+	{
+		case objBox:
+		{
+			const sPrimitiveBox *obj = (const sPrimitiveBox *)primitive;
+			if (obj->repeat.Length() > 0.0) return false;
+			*radius = (obj->size * 0.5).Length() + max(obj->rounding, 0.0);
+			// distance of empty box is max() of three components
+			if (obj->empty) *distanceFactor = 1.0 / sqrt(3.0);
+			return true;
+		}
+		case objSphere:
+		{
+			const sPrimitiveSphere *obj = (const sPrimitiveSphere *)primitive;
+			if (obj->repeat.Length() > 0.0) return false;
+			*radius = fabs(obj->radius);
+			return true;
+		}
+		case objCylinder:
+		{
+			const sPrimitiveCylinder *obj = (const sPrimitiveCylinder *)primitive;
+			if (obj->repeat.Length() > 0.0) return false;
+			*radius = CVector2<double>(obj->radius, obj->height * 0.5).Length();
+			// distance is calculated as max() of two components, so it can be up to sqrt(2) smaller
+			*distanceFactor = M_SQRT1_2;
+			return true;
+		}
+		case objTorus:
+		{
+			const sPrimitiveTorus *obj = (const sPrimitiveTorus *)primitive;
+			if (obj->repeat.Length() > 0.0) return false;
+			*radius = fabs(obj->radius) + fabs(obj->tube_radius);
+			return true;
+		}
+		case objCircle:
+		{
+			const sPrimitiveCircle *obj = (const sPrimitiveCircle *)primitive;
+			*radius = fabs(obj->radius);
+			*distanceFactor = M_SQRT1_2;
+			return true;
+		}
+		case objRectangle:
+		{
+			const sPrimitiveRectangle *obj = (const sPrimitiveRectangle *)primitive;
+			*radius = CVector2<double>(obj->width * 0.5, obj->height * 0.5).Length();
+			return true;
+		}
+		// planes and water are infinite and distance of cone is not bounded from below
+		default: return false;
+	}
+}
+
+struct sCompareBVHCenters
+{
+	sCompareBVHCenters(const QVector<CVector3> &_centers, int _axis) : centers(_centers), axis(_axis)
+	{
+	}
+	double Component(int index) const
+	{
+		const CVector3 &c = centers[index];
+		return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+	}
+	bool operator()(int a, int b) const { return Component(a) < Component(b); }
+	const QVector<CVector3> &centers;
+	int axis;
+};
+
+void cPrimitives::BuildBVH(const cParameterContainer *par)
+{
+	int numberOfPrimitives = allPrimitives.size();
+	QVector<CVector3> centers(numberOfPrimitives);
+	QVector<double> radii(numberOfPrimitives);
+	QVector<double> factors(numberOfPrimitives);
+
+	for (int i = 0; i < numberOfPrimitives; i++)
+	{
+		const sPrimitiveBasic *primitive = allPrimitives.at(i);
+		if (!primitive->enable) continue;
+
+		double radius = 0.0;
+		double distanceFactor = 1.0;
+		if (PrimitiveBoundingSphere(primitive, &radius, &distanceFactor))
+		{
+			// displacement map can move surface towards the point
+			QString useDisplacement = cMaterial::Name("use_displacement_texture", primitive->materialId);
+			if (par->IfExists(useDisplacement) && par->Get<bool>(useDisplacement))
+			{
+				radius += fabs(par->Get<double>(
+										cMaterial::Name("displacement_texture_height", primitive->materialId)))
+									/ distanceFactor;
+			}
+			centers[i] = primitive->position;
+			radii[i] = radius;
+			factors[i] = distanceFactor;
+			bvhPrimitives.append(i);
+		}
+		else
+		{
+			unboundedPrimitives.append(i);
+		}
+	}
+
+	if (bvhPrimitives.size() > 0)
+	{
+		bvhNodes.resize(1);
+		BuildBVHNode(0, 0, bvhPrimitives.size(), centers, radii, factors);
+	}
+}
+
+void cPrimitives::BuildBVHNode(int nodeIndex, int begin, int end, const QVector<CVector3> &centers,
+	const QVector<double> &radii, const QVector<double> &factors)
+{
+	sPrimitiveBVHNode node;
+
+	// bounding box of all spheres in the node
+	CVector3 boxMin(1e20, 1e20, 1e20);
+	CVector3 boxMax(-1e20, -1e20, -1e20);
+	CVector3 centersMin = boxMin;
+	CVector3 centersMax = boxMax;
+	node.distanceFactor = 1.0;
+	for (int i = begin; i < end; i++)
+	{
+		int index = bvhPrimitives[i];
+		const CVector3 &c = centers[index];
+		double r = radii[index];
+		boxMin = CVector3(min(boxMin.x, c.x - r), min(boxMin.y, c.y - r), min(boxMin.z, c.z - r));
+		boxMax = CVector3(max(boxMax.x, c.x + r), max(boxMax.y, c.y + r), max(boxMax.z, c.z + r));
+		centersMin = CVector3(min(centersMin.x, c.x), min(centersMin.y, c.y), min(centersMin.z, c.z));
+		centersMax = CVector3(max(centersMax.x, c.x), max(centersMax.y, c.y), max(centersMax.z, c.z));
+		node.distanceFactor = min(node.distanceFactor, factors[index]);
+	}
+
+	node.center = (boxMin + boxMax) * 0.5;
+	node.radius = 0.0;
+	for (int i = begin; i < end; i++)
+	{
+		int index = bvhPrimitives[i];
+		node.radius = max(node.radius, (centers[index] - node.center).Length() + radii[index]);
+	}
+
+	if (end - begin <= 2)
+	{
+		node.first = begin;
+		node.count = end - begin;
+		bvhNodes[nodeIndex] = node;
+		return;
+	}
+
+	// split along the longest axis at the median of primitive centers
+	CVector3 extent = centersMax - centersMin;
+	int splitAxis = 0;
+	if (extent.y > extent.x) splitAxis = 1;
+	if (extent.z > max(extent.x, extent.y)) splitAxis = 2;
+	std::sort(bvhPrimitives.begin() + begin, bvhPrimitives.begin() + end,
+		sCompareBVHCenters(centers, splitAxis));
+	int middle = (begin + end) / 2;
+
+	int children = bvhNodes.size();
+	bvhNodes.resize(children + 2);
+	node.first = children;
+	node.count = 0;
+	bvhNodes[nodeIndex] = node;
+
+	BuildBVHNode(children, begin, middle, centers, radii, factors);
+	BuildBVHNode(children + 1, middle, end, centers, radii, factors);
+}
+
 cPrimitives::~cPrimitives()
 {
 	qDeleteAll(allPrimitives);
+	qDeleteAll(waterHeightfields);
 }
 
 double sPrimitivePlane::PrimitiveDistance(CVector3 _point) const
@@ -355,7 +542,33 @@ double sPrimitiveCone::PrimitiveDistance(CVector3 _point) const
 	return empty ? fabs(dist) : dist;
 }
 
-double sPrimitiveWater::PrimitiveDistance(CVector3 _point) const
+double sPrimitiveWater::WaveHeight(double x, double y) const
+{
+	double phase = animSpeed * animFrame * 0.1;
+	double k = 0.23;
+	double waveXtemp;
+	double waveYtemp;
+	double waveX = 0;
+	double waveY = 0;
+	double p = 1.0;
+	double p2 = 0.05;
+	for (int i = 1; i <= iterations; i++)
+	{
+		float p3 = p * p2;
+		double shift = phase / (i / 3.0 + 1.0);
+		waveXtemp =
+			sin(i + 0.4 * (waveX)*p3 + sin(k * y / length * p3) + x / length * p3 + shift) / p;
+		waveYtemp =
+			cos(i + 0.4 * (waveY)*p3 + sin(x / length * p3) + k * y / length * p3 + shift * 0.23) / p;
+		waveX += waveXtemp;
+		waveY += waveYtemp;
+		p2 = p2 + (1.0 - p2) * 0.7;
+		p *= 1.872;
+	}
+	return waveX + waveY;
+}
+
+double sPrimitiveWater::PrimitiveDistance(CVector3 _point, double detailSize) const
 {
 	// TODO to use rendering technique from here: //https://www.shadertoy.com/view/Ms2SD1
 
@@ -363,33 +576,13 @@ double sPrimitiveWater::PrimitiveDistance(CVector3 _point) const
 	point = rotationMatrix.RotateVector(point);
 
 	double planeDistance = point.z;
+	// waves are always below amplitude * 10, so far above the surface they are not needed
 	if (planeDistance < amplitude * 10.0)
 	{
-		double phase = animSpeed * animFrame * 0.1;
-		double k = 0.23;
-		double waveXtemp = point.x;
-		double waveYtemp = point.y;
-		double waveX = 0;
-		double waveY = 0;
-		double p = 1.0;
-		double p2 = 0.05;
-		for (int i = 1; i <= iterations; i++)
-		{
-			float p3 = p * p2;
-			double shift = phase / (i / 3.0 + 1.0);
-			waveXtemp =
-				sin(i + 0.4 * (waveX)*p3 + sin(k * point.y / length * p3) + point.x / length * p3 + shift)
-				/ p;
-			waveYtemp = cos(i + 0.4 * (waveY)*p3 + sin(point.x / length * p3) + k * point.y / length * p3
-											+ shift * 0.23)
-									/ p;
-			waveX += waveXtemp;
-			waveY += waveYtemp;
-			p2 = p2 + (1.0 - p2) * 0.7;
-			p *= 1.872;
-		}
-
-		planeDistance += (waveX + waveY) * amplitude;
+		if (heightfield)
+			planeDistance += heightfield->Sample(point.x, point.y, detailSize) * amplitude;
+		else
+			planeDistance += WaveHeight(point.x, point.y) * amplitude;
 	}
 	return empty ? fabs(planeDistance) : planeDistance;
 }
@@ -405,59 +598,103 @@ double sPrimitiveTorus::PrimitiveDistance(CVector3 _point) const
 	return empty ? fabs(dist) : dist;
 }
 
-double cPrimitives::TotalDistance(
-	CVector3 point, double fractalDistance, int *closestObjectId, sRenderData *data) const
+double cPrimitives::PrimitiveDistance(
+	const sPrimitiveBasic *primitive, CVector3 point, double detailSize) const
 {
 	using namespace fractal;
+	switch (primitive->objectType)
+	{
+		case objPlane: return ((sPrimitivePlane *)primitive)->PrimitiveDistance(point);
+		case objBox: return ((sPrimitiveBox *)primitive)->PrimitiveDistance(point);
+		case objSphere: return ((sPrimitiveSphere *)primitive)->PrimitiveDistance(point);
+		case objWater:
+			return ((sPrimitiveWater *)primitive)->PrimitiveDistance(point, detailSize);
+		case objCone: return ((sPrimitiveCone *)primitive)->PrimitiveDistance(point);
+		case objCylinder: return ((sPrimitiveCylinder *)primitive)->PrimitiveDistance(point);
+		case objTorus: return ((sPrimitiveTorus *)primitive)->PrimitiveDistance(point);
+		case objCircle: return ((sPrimitiveCircle *)primitive)->PrimitiveDistance(point);
+		case objRectangle: return ((sPrimitiveRectangle *)primitive)->PrimitiveDistance(point);
+		default:
+			qCritical() << "cannot handle " << PrimitiveNames(primitive->objectType)
+									<< " in cPrimitives::TotalDistance()";
+			return 0.0;
+	}
+}
+
+double cPrimitives::TotalDistance(CVector3 point, double fractalDistance, int *closestObjectId,
+	sRenderData *data, double detailSize, int *evaluations) const
+{
 	int closestObject = *closestObjectId;
 	double distance = fractalDistance;
 
 	if (isAnyPrimitive)
 	{
-		CVector3 point2 = point - allPrimitivesPosition;
-		point2 = mRotAllPrimitivesRotation.RotateVector(point2);
+		int numberOfEvaluations = 0;
 
-		for (int i = 0; i < allPrimitives.size(); i++)
+		// infinite objects have to be always calculated
+		for (int i = 0; i < unboundedPrimitives.size(); i++)
 		{
-			const sPrimitiveBasic *primitive = allPrimitives.at(i);
-			if (primitive->enable)
+			const sPrimitiveBasic *primitive = allPrimitives.at(unboundedPrimitives[i]);
+			double distTemp = PrimitiveDistance(primitive, point, detailSize);
+			distTemp = DisplacementMap(distTemp, point, primitive->objectId, data, detailSize);
+			numberOfEvaluations++;
+			if (distTemp < distance)
 			{
-				double distTemp = 0;
-				switch (primitive->objectType)
+				closestObject = primitive->objectId;
+				distance = distTemp;
+			}
+		}
+
+		// traversing hierarchy, skipping nodes which cannot be closer than found distance
+		if (bvhNodes.size() > 0)
+		{
+			int stack[64];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const sPrimitiveBVHNode &node = bvhNodes[stack[--stackSize]];
+				double boundDistance = ((point - node.center).Length() - node.radius) * node.distanceFactor;
+				if (boundDistance >= distance) continue;
+
+				if (node.count > 0)
 				{
-					case objPlane: distTemp = ((sPrimitivePlane *)primitive)->PrimitiveDistance(point); break;
-					case objBox: distTemp = ((sPrimitiveBox *)primitive)->PrimitiveDistance(point); break;
-					case objSphere:
-						distTemp = ((sPrimitiveSphere *)primitive)->PrimitiveDistance(point);
-						break;
-					case objWater: distTemp = ((sPrimitiveWater *)primitive)->PrimitiveDistance(point); break;
-					case objCone: distTemp = ((sPrimitiveCone *)primitive)->PrimitiveDistance(point); break;
-					case objCylinder:
-						distTemp = ((sPrimitiveCylinder *)primitive)->PrimitiveDistance(point);
-						break;
-					case objTorus: distTemp = ((sPrimitiveTorus *)primitive)->PrimitiveDistance(point); break;
-					case objCircle:
-						distTemp = ((sPrimitiveCircle *)primitive)->PrimitiveDistance(point);
-						break;
-					case objRectangle:
-						distTemp = ((sPrimitiveRectangle *)primitive)->PrimitiveDistance(point);
-						break;
-					default:
-						qCritical() << "cannot handle " << PrimitiveNames(primitive->objectType)
-												<< " in cPrimitives::TotalDistance()";
-						break;
+					for (int i = node.first; i < node.first + node.count; i++)
+					{
+						const sPrimitiveBasic *primitive = allPrimitives.at(bvhPrimitives[i]);
+						double distTemp = PrimitiveDistance(primitive, point, detailSize);
+						distTemp =
+							DisplacementMap(distTemp, point, primitive->objectId, data, detailSize);
+						numberOfEvaluations++;
+						if (distTemp < distance)
+						{
+							closestObject = primitive->objectId;
+							distance = distTemp;
+						}
+					}
 				}
-				distTemp = DisplacementMap(distTemp, point, primitive->objectId, data);
-				if (distTemp < distance)
+				else
 				{
-					closestObject = primitive->objectId;
-					// color = plane.color;
-					// reflect = plane.reflect;
+					// nearer child is pushed last to be visited first
+					const sPrimitiveBVHNode &left = bvhNodes[node.first];
+					const sPrimitiveBVHNode &right = bvhNodes[node.first + 1];
+					double leftDistance = (point - left.center).Length() - left.radius;
+					double rightDistance = (point - right.center).Length() - right.radius;
+					if (leftDistance < rightDistance)
+					{
+						stack[stackSize++] = node.first + 1;
+						stack[stackSize++] = node.first;
+					}
+					else
+					{
+						stack[stackSize++] = node.first;
+						stack[stackSize++] = node.first + 1;
+					}
 				}
-				distance = min(distance, distTemp);
 			}
 		}
 
+		if (evaluations) *evaluations = numberOfEvaluations;
 	} // if is any primitive
 
 	*closestObjectId = closestObject;
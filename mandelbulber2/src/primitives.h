@@ -43,6 +43,7 @@
 
 // forward declarations
 class cParameterContainer;
+class cWaterHeightfield;
 struct sRenderData;
 
 struct sPrimitiveItem
@@ -94,7 +95,11 @@ struct sPrimitiveWater : sPrimitiveBasic
 	double length;
 	int iterations;
 	int animFrame;
-	double PrimitiveDistance(CVector3 _point) const;
+	// waves baked for current frame. NULL if waves are calculated at every step
+	const cWaterHeightfield *heightfield;
+	// sum of waves at local coordinates (not multiplied by amplitude)
+	double WaveHeight(double x, double y) const;
+	double PrimitiveDistance(CVector3 _point, double detailSize = 0.0) const;
 };
 
 struct sPrimitiveCone : sPrimitiveBasic
@@ -140,6 +145,19 @@ struct sPrimitiveRectangle : sPrimitiveBasic
 	double PrimitiveDistance(CVector3 _point) const;
 };
 
+// node of bounding volume hierarchy built over bounded primitives
+struct sPrimitiveBVHNode
+{
+	CVector3 center;
+	double radius;
+	// scale of bound distance for not exact distance functions
+	double distanceFactor;
+	// index of first child node (inner node) or first primitive (leaf)
+	int first;
+	// number of primitives in leaf, 0 for inner node
+	int count;
+};
+
 QString PrimitiveNames(fractal::enumObjectType primitiveType);
 
 fractal::enumObjectType PrimitiveNameToEnum(const QString &primitiveType);
@@ -152,11 +170,23 @@ class cPrimitives
 public:
 	cPrimitives(const cParameterContainer *par, QVector<cObjectData> *obejctData = NULL);
 	~cPrimitives();
-	double TotalDistance(
-		CVector3 point, double fractalDistance, int *closestObjectId, sRenderData *data) const;
+	// number of evaluated primitives is stored in *evaluations if there is any primitive
+	double TotalDistance(CVector3 point, double fractalDistance, int *closestObjectId,
+		sRenderData *data, double detailSize = 0.0, int *evaluations = NULL) const;
+	bool IsAnyPrimitive() const { return isAnyPrimitive; }
 
 private:
+	double PrimitiveDistance(
+		const sPrimitiveBasic *primitive, CVector3 point, double detailSize) const;
+	void BuildBVH(const cParameterContainer *par);
+	void BuildBVHNode(int nodeIndex, int begin, int end, const QVector<CVector3> &centers,
+		const QVector<double> &radii, const QVector<double> &factors);
+
 	QList<sPrimitiveBasic *> allPrimitives;
+	QList<cWaterHeightfield *> waterHeightfields;
+	QVector<int> unboundedPrimitives;
+	QVector<int> bvhPrimitives;
+	QVector<sPrimitiveBVHNode> bvhNodes;
 	inline double Plane(CVector3 point, CVector3 position, CVector3 normal) const
 	{
 		return (normal.Dot(point - position));
@@ -0,0 +1,249 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cProgressStream class - machine-readable progress of CLI rendering
+ */
+
+#include "progress_stream.hpp"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "netrender.hpp"
+#include "statistics.h"
+
+cProgressStream *cProgressStream::instance = NULL;
+bool cProgressStream::usesStdout = false;
+
+cProgressStream::cProgressStream() : QObject()
+{
+	netRender = NULL;
+	for (int i = 0; i < 3; i++)
+	{
+		progressTimers[i].start();
+		lastProgress[i] = 0.0;
+	}
+	timer.start();
+}
+
+bool cProgressStream::Open(const QString &target, bool isDescriptor)
+{
+	if (instance) return false;
+
+	cProgressStream *stream = new cProgressStream;
+	bool result;
+	if (isDescriptor)
+	{
+		bool ok = false;
+		int fd = target.toInt(&ok);
+		result = ok && fd >= 0
+						 && stream->file.open(fd, QIODevice::WriteOnly, QFileDevice::DontCloseHandle);
+		usesStdout = result && fd == 1;
+	}
+	else
+	{
+		stream->file.setFileName(target);
+		result = stream->file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+	}
+
+	if (!result)
+	{
+		qCritical() << "Cannot open progress stream" << target;
+		delete stream;
+		return false;
+	}
+
+	instance = stream;
+	return true;
+}
+
+void cProgressStream::ConnectNetRender(CNetRender *_netRender)
+{
+	if (!instance || !_netRender) return;
+
+	instance->netRender = _netRender;
+	QObject::connect(_netRender, SIGNAL(ClientsChanged()), instance, SLOT(slotNetRenderStatus()));
+	QObject::connect(
+		_netRender, SIGNAL(ClientsChanged(int)), instance, SLOT(slotNetRenderStatus()));
+	QObject::connect(_netRender, SIGNAL(NewStatusClient()), instance, SLOT(slotNetRenderStatus()));
+	QObject::connect(_netRender, SIGNAL(NewStatusServer()), instance, SLOT(slotNetRenderStatus()));
+}
+
+void cProgressStream::Write(const QString &eventName, QJsonObject event)
+{
+	if (!instance) return;
+
+	QMutexLocker lock(&instance->mutex);
+	event["event"] = eventName;
+	event["time"] = instance->timer.elapsed() / 1000.0;
+	instance->file.write(QJsonDocument(event).toJson(QJsonDocument::Compact) + "\n");
+	instance->file.flush();
+}
+
+void cProgressStream::Progress(
+	const QString &text, double progress, cProgressText::enumProgressType progressType)
+{
+	if (!instance) return;
+
+	QString typeName;
+	switch (progressType)
+	{
+		case cProgressText::progress_IMAGE: typeName = "image"; break;
+		case cProgressText::progress_ANIMATION: typeName = "animation"; break;
+		case cProgressText::progress_QUEUE: typeName = "queue"; break;
+	}
+
+	// estimation is made from the time since progress of this type was started
+	double elapsed;
+	{
+		QMutexLocker lock(&instance->mutex);
+		if (progress < instance->lastProgress[progressType] || progress <= 0.0)
+			instance->progressTimers[progressType].restart();
+		instance->lastProgress[progressType] = progress;
+		elapsed = instance->progressTimers[progressType].elapsed() / 1000.0;
+	}
+
+	QJsonObject event;
+	event["type"] = typeName;
+	event["text"] = text;
+	event["progress"] = progress;
+	event["elapsed"] = elapsed;
+	if (progress > 0.0 && progress < 1.0)
+		event["eta"] = elapsed * (1.0 - progress) / progress;
+	else if (progress >= 1.0)
+		event["eta"] = 0.0;
+	Write("progress", event);
+}
+
+void cProgressStream::Statistics(const cStatistics &stat)
+{
+	if (!instance) return;
+
+	QJsonObject event;
+	event["renderTime"] = stat.time;
+	event["iterations"] = (double)stat.totalNumberOfIterations;
+	event["renderedPixels"] = stat.numberOfRenderedPixels;
+	event["antiAliasedPixels"] = stat.numberOfAntiAliasedPixels;
+	event["raymarchings"] = stat.numberOfRaymarchings;
+	if (stat.numberOfRenderedPixels > 0)
+		event["iterationsPerPixel"] = stat.GetNumberOfIterationsPerPixel();
+	if (stat.time > 0.0)
+	{
+		event["iterationsPerSecond"] = stat.GetNumberOfIterationsPerSecond();
+		event["pixelsPerSecond"] = stat.numberOfRenderedPixels / stat.time;
+	}
+	if (stat.numberOfRaymarchings > 0) event["missedDEPercentage"] = stat.GetMissedDEPercentage();
+	event["primitiveEvaluationsPerStep"] = stat.GetPrimitiveEvaluationsPerStep();
+	event["refinementStepsPerHit"] = stat.GetRefinementStepsPerHit();
+	event["periodicOrbits"] = (double)stat.numberOfPeriodicOrbits;
+	event["deType"] = stat.GetDETypeString();
+	event["shaderVariant"] = stat.GetShaderVariantString();
+
+	QJsonObject passes;
+	passes["prepass"] = stat.prepassTime;
+	passes["mainPass"] = stat.mainPassTime;
+	passes["antiAliasing"] = stat.antiAliasingTime;
+	passes["postProcessing"] = stat.postProcessingTime;
+	passes["ssao"] = stat.ssaoTime;
+	passes["dof"] = stat.dofTime;
+	event["passes"] = passes;
+
+	// summed for all rendering threads, known when rendering is finished
+	QJsonObject stages;
+	for (int i = 0; i < renderStageCount; i++)
+		stages[cStageTimer::StageName(i)] = stat.stageTimes[i];
+	event["stages"] = stages;
+
+	Write("statistics", event);
+}
+
+void cProgressStream::ImageSaved(const QString &fileName)
+{
+	if (!instance) return;
+
+	QJsonObject event;
+	event["file"] = fileName;
+	Write("imageSaved", event);
+}
+
+void cProgressStream::slotNetRenderStatus()
+{
+	if (!netRender) return;
+
+	QJsonObject event;
+	if (netRender->IsServer())
+		event["role"] = QString("server");
+	else if (netRender->IsClient())
+		event["role"] = QString("client");
+	else if (netRender->IsRelay())
+		event["role"] = QString("relay");
+	else
+		return;
+	event["status"] = NetRenderStatusName(netRender->GetStatus());
+
+	// list of clients is known only by server and relay
+	if (!netRender->IsClient())
+	{
+		QJsonArray clients;
+		for (int i = 0; i < netRender->GetClientCount(); i++)
+		{
+			const CNetRender::sClient &client = netRender->GetClient(i);
+			QJsonObject clientObject;
+			clientObject["index"] = i;
+			clientObject["name"] = client.name;
+			clientObject["status"] = NetRenderStatusName(client.status);
+			clientObject["workers"] = client.clientWorkerCount;
+			clientObject["linesRendered"] = client.linesRendered;
+			clientObject["linesPerSecond"] = client.linesPerSecond;
+			clientObject["reliability"] = client.reliability;
+			clientObject["frame"] = client.frameIndex;
+			clients.append(clientObject);
+		}
+		event["clients"] = clients;
+		event["totalWorkers"] = netRender->getTotalWorkerCount();
+	}
+	Write("netrender", event);
+}
+
+QString cProgressStream::NetRenderStatusName(int status)
+{
+	// names are not translated, so they can be compared by scripts
+	switch (status)
+	{
+		case CNetRender::netRender_DISABLED: return "disabled";
+		case CNetRender::netRender_READY: return "ready";
+		case CNetRender::netRender_WORKING: return "working";
+		case CNetRender::netRender_NEW: return "new";
+		case CNetRender::netRender_CONNECTING: return "connecting";
+		case CNetRender::netRender_ERROR: return "error";
+	}
+	return "unknown";
+}
@@ -0,0 +1,95 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cProgressStream class - machine-readable progress of CLI rendering
+ *
+ * Progress, statistics, saved images and status of NetRender are written as
+ * newline-delimited JSON events (one object per line) to a file or to already
+ * opened file descriptor (--stats-json and --progress-fd options). It is meant
+ * for render farm schedulers which would otherwise have to parse terminal output.
+ */
+
+#ifndef MANDELBULBER2_SRC_PROGRESS_STREAM_HPP_
+#define MANDELBULBER2_SRC_PROGRESS_STREAM_HPP_
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+
+#include "progress_text.hpp"
+
+// forward declarations
+class CNetRender;
+class cStatistics;
+
+class cProgressStream : public QObject
+{
+	Q_OBJECT
+
+public:
+	// target is a file name or number of file descriptor opened by parent process
+	static bool Open(const QString &target, bool isDescriptor);
+	static bool IsEnabled() { return instance != NULL; }
+	// events are written to standard output, so human readable progress has to be disabled
+	static bool UsesStdout() { return usesStdout; }
+	// status of server or client will be reported whenever it changes
+	static void ConnectNetRender(CNetRender *netRender);
+
+	static void Progress(
+		const QString &text, double progress, cProgressText::enumProgressType progressType);
+	static void Statistics(const cStatistics &stat);
+	static void ImageSaved(const QString &fileName);
+
+	// writes one event. "event" and "time" (seconds from opening the stream) fields are added
+	static void Write(const QString &eventName, QJsonObject event);
+
+private slots:
+	void slotNetRenderStatus();
+
+private:
+	cProgressStream();
+	static QString NetRenderStatusName(int status);
+
+	static cProgressStream *instance;
+	static bool usesStdout;
+
+	QFile file;
+	QMutex mutex;
+	QElapsedTimer timer;
+	// used for estimation of remaining time of image, animation and queue
+	QElapsedTimer progressTimers[3];
+	double lastProgress[3];
+	CNetRender *netRender;
+};
+
+#endif /* MANDELBULBER2_SRC_PROGRESS_STREAM_HPP_ */
@@ -0,0 +1,75 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cProgressiveDepth class - conservative depth of pixels rendered in previous
+ * progressive passes
+ *
+ * Value stored for rendered pixel is a distance along primary rays, which is
+ * free of surface for all rays of the block of pixels which will be refined
+ * in the next progressive pass.
+ */
+
+#ifndef MANDELBULBER2_SRC_PROGRESSIVE_DEPTH_HPP_
+#define MANDELBULBER2_SRC_PROGRESSIVE_DEPTH_HPP_
+
+#include <QVector>
+
+class cProgressiveDepth
+{
+public:
+	cProgressiveDepth(int _width, int _height) : width(_width), height(_height)
+	{
+		depthBuffer.fill(0.0f, width * height);
+	}
+
+	void SetDepth(int x, int y, double depth)
+	{
+		if (x >= 0 && x < width && y >= 0 && y < height) depthBuffer[y * width + x] = depth;
+	}
+
+	// start distance of pixel rendered with given progressive step. Value is taken from pixel which
+	// was rendered in previous pass (with double step)
+	double GetStartDistance(int x, int y, int progressiveStep) const
+	{
+		int previousStep = progressiveStep * 2;
+		int x0 = x - x % previousStep;
+		int y0 = y - y % previousStep;
+		if (x0 < 0 || x0 >= width || y0 < 0 || y0 >= height) return 0.0;
+		return depthBuffer[y0 * width + x0];
+	}
+
+private:
+	int width;
+	int height;
+	QVector<float> depthBuffer;
+};
+
+#endif /* MANDELBULBER2_SRC_PROGRESSIVE_DEPTH_HPP_ */
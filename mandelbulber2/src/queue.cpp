@@ -45,8 +45,11 @@
 #include "headless.h"
 #include "initparameters.hpp"
 #include "keyframes.hpp"
+#include "memory_estimator.hpp"
+#include "netrender.hpp"
 #include "parameters.hpp"
 #include "preview_file_dialog.h"
+#include "render_estimate.hpp"
 #include "render_queue.hpp"
 #include "settings.hpp"
 #include "system.hpp"
@@ -131,6 +134,16 @@ cQueue::cQueue(cInterface *_interface, const QString &_queueListFileName,
 	}
 
 	stopRequest = false;
+	journalRemovals = 0;
+	storedFileSize = -1;
+	concurrentJobs = 1;
+	runningRenderQueues = 0;
+	totalThreads = 1;
+	freeThreads = 1;
+	exclusiveRequests = 0;
+	memoryBudget = -1;
+	reservedMemory = 0;
+	jobsWithMemory = 0;
 }
 
 cQueue::~cQueue()
@@ -182,7 +195,7 @@ void cQueue::AppendList(const QString &filename)
 	// qDebug() << "AppendList: " << filename;
 	if (QFileInfo(filename).suffix() == QString("fractlist"))
 	{
-		mutex.lock();
+		QList<structQueueItem> queueItems;
 		QFile file(filename);
 		if (file.open(QIODevice::ReadOnly))
 		{
@@ -191,21 +204,15 @@ void cQueue::AppendList(const QString &filename)
 			{
 				QString line = in.readLine().trimmed();
 				if (line.startsWith("#") || line == "") continue;
-				QRegularExpression reType("^(.*?\\.fract)\\s*(STILL|KEYFRAME|FLIGHT)?$");
-				QRegularExpressionMatch matchType = reType.match(line);
-				if (matchType.hasMatch())
-				{
-					structQueueItem queueItem =
-						structQueueItem(matchType.captured(1), GetTypeEnum(matchType.captured(2)));
-					if (!queueListFromFile.contains(queueItem)) queueListFromFile << queueItem;
-				}
+				structQueueItem queueItem("", queue_STILL);
+				if (ParseQueueFileLine(line, &queueItem))
+					queueItems << queueItem;
 				else
 					qWarning() << "wrong format in line: " << line;
 			}
 			file.close();
 		}
-		mutex.unlock();
-		StoreList();
+		AppendItems(queueItems);
 	}
 }
 
@@ -219,15 +226,10 @@ void cQueue::AppendFolder(const QString &filename)
 		fractFileExtensions << "*.fract";
 		fractDir.setNameFilters(fractFileExtensions);
 		QStringList fractFiles = fractDir.entryList(QDir::NoDotAndDotDot | QDir::Files);
+		QList<structQueueItem> queueItems;
 		for (int i = 0; i < fractFiles.size(); i++)
-		{
-			mutex.lock();
-			structQueueItem queueItem =
-				structQueueItem(filename + QDir::separator() + fractFiles.at(i), queue_STILL);
-			if (!queueListFromFile.contains(queueItem)) queueListFromFile << queueItem;
-			mutex.unlock();
-		}
-		StoreList();
+			queueItems << structQueueItem(filename + QDir::separator() + fractFiles.at(i), queue_STILL);
+		AppendItems(queueItems);
 	}
 }
 
@@ -252,6 +254,26 @@ bool cQueue::Get(cParameterContainer *par, cFractalContainer *fractPar, cAnimati
 	return false;
 }
 
+bool cQueue::EstimateRenderTime(const structQueueItem &queueItem, cRenderEstimate *estimate)
+{
+	cParameterContainer tempPar = *gPar;
+	cFractalContainer tempFract = *gParFractal;
+	cAnimationFrames tempFrames;
+	cKeyframes tempKeyframes;
+	cSettings parSettings(cSettings::formatFullText);
+	parSettings.BeQuiet(true);
+	if (!parSettings.LoadFromFile(queueItem.filename)
+			|| !parSettings.Decode(&tempPar, &tempFract, &tempFrames, &tempKeyframes))
+		return false;
+
+	cRenderEstimate::enumJobType jobType = cRenderEstimate::jobStill;
+	if (queueItem.renderType == queue_FLIGHT) jobType = cRenderEstimate::jobFlight;
+	if (queueItem.renderType == queue_KEYFRAME) jobType = cRenderEstimate::jobKeyframe;
+	int numberOfFrames =
+		cRenderEstimate::NumberOfFrames(tempPar, &tempFrames, &tempKeyframes, jobType);
+	return estimate->Estimate(tempPar, tempFract, numberOfFrames);
+}
+
 QStringList cQueue::RemoveOrphanedFiles()
 {
 	// find and delete files which are not on the list
@@ -277,20 +299,21 @@ QStringList cQueue::AddOrphanedFilesToList()
 	mutex.lock();
 	// qDebug() << "add orphaned";
 	QStringList appendList;
+	QList<structQueueItem> queueItems;
 	for (int i = 0; i < queueListFileSystem.size(); i++)
 	{
 		structQueueItem queueItem = structQueueItem(queueListFileSystem.at(i), queue_STILL);
 		if (!queueListFromFile.contains(queueItem))
 		{
 			appendList << queueListFileSystem.at(i);
-			queueListFromFile << queueItem;
+			queueItems << queueItem;
 		}
 	}
 	mutex.unlock();
 
 	if (appendList.size() > 0)
 	{
-		StoreList();
+		AppendItems(queueItems);
 	}
 	// qDebug() << "add orphaned files " << appendList.size() << " total\n" << appendList;
 	return appendList;
@@ -310,6 +333,107 @@ cQueue::structQueueItem cQueue::GetNextFromList()
 	return structQueueItem("", queue_STILL);
 }
 
+cQueue::structQueueItem cQueue::TakeNextFromList()
+{
+	mutex.lock();
+	for (int i = 0; i < queueListFromFile.size(); i++)
+	{
+		cQueue::structQueueItem item = queueListFromFile.at(i);
+		if (!queueItemsInProgress.contains(item))
+		{
+			queueItemsInProgress.append(item);
+			mutex.unlock();
+			return item;
+		}
+	}
+	mutex.unlock();
+	return structQueueItem("", queue_STILL);
+}
+
+void cQueue::ReleaseQueueItem(const structQueueItem &queueItem)
+{
+	mutex.lock();
+	queueItemsInProgress.removeAll(queueItem);
+	mutex.unlock();
+}
+
+int cQueue::ReserveThreads(double samples, bool exclusive)
+{
+	threadsMutex.lock();
+	int threads = totalThreads;
+	if (concurrentJobs > 1)
+	{
+		if (exclusive)
+		{
+			exclusiveRequests++;
+			while (freeThreads < totalThreads)
+				threadsReleased.wait(&threadsMutex);
+			exclusiveRequests--;
+		}
+		else
+		{
+			// items waiting for all threads have priority
+			while (freeThreads == 0 || exclusiveRequests > 0)
+				threadsReleased.wait(&threadsMutex);
+			int wanted = int(ceil(samples / QUEUE_SAMPLES_PER_THREAD));
+			threads = qBound(1, wanted, freeThreads);
+		}
+		freeThreads -= threads;
+	}
+	threadsMutex.unlock();
+	return threads;
+}
+
+void cQueue::ReleaseThreads(int threads)
+{
+	threadsMutex.lock();
+	if (concurrentJobs > 1) freeThreads += threads;
+	threadsReleased.wakeAll();
+	threadsMutex.unlock();
+}
+
+void cQueue::ReserveMemory(qint64 bytes)
+{
+	if (concurrentJobs <= 1 || memoryBudget < 0) return;
+
+	threadsMutex.lock();
+	while (jobsWithMemory > 0 && reservedMemory + bytes > memoryBudget && !stopRequest)
+		threadsReleased.wait(&threadsMutex);
+	reservedMemory += bytes;
+	jobsWithMemory++;
+	threadsMutex.unlock();
+}
+
+void cQueue::ReleaseMemory(qint64 bytes)
+{
+	if (concurrentJobs <= 1 || memoryBudget < 0) return;
+
+	threadsMutex.lock();
+	reservedMemory -= bytes;
+	jobsWithMemory--;
+	threadsReleased.wakeAll();
+	threadsMutex.unlock();
+}
+
+void cQueue::AddResourceReport(const cResourceReport &report)
+{
+	reportMutex.lock();
+	runReport.Add(report);
+	reportMutex.unlock();
+}
+
+void cQueue::RenderQueueFinished()
+{
+	QMutexLocker lock(&reportMutex);
+	runningRenderQueues--;
+	if (runningRenderQueues > 0 || runReport.numberOfJobs == 0) return;
+
+	runReport.Finish();
+	QString fileName = gPar->Get<QString>("default_image_path") + QDir::separator() + "queue_report_"
+										 + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".json";
+	runReport.Save(fileName);
+}
+
 void cQueue::AddToList(const structQueueItem &queueItem)
 {
 	// add filename to the end of list
@@ -321,8 +445,31 @@ void cQueue::AddToList(const structQueueItem &queueItem)
 		return;
 	}
 	queueListFromFile << queueItem;
+	AppendToQueueFile(QStringList() << QueueFileLine(queueItem));
 	mutex.unlock();
-	StoreList();
+	emit queueChanged();
+}
+
+void cQueue::AppendItems(const QList<structQueueItem> &queueItems)
+{
+	mutex.lock();
+	// lines are compared as strings, so checking of duplicates doesn't depend on list size
+	QSet<QString> existingLines;
+	for (int i = 0; i < queueListFromFile.size(); i++)
+		existingLines.insert(QueueFileLine(queueListFromFile.at(i)));
+
+	QStringList newLines;
+	for (int i = 0; i < queueItems.size(); i++)
+	{
+		QString line = QueueFileLine(queueItems.at(i));
+		if (existingLines.contains(line)) continue;
+		existingLines.insert(line);
+		newLines << line;
+		queueListFromFile << queueItems.at(i);
+	}
+	if (!newLines.isEmpty()) AppendToQueueFile(newLines);
+	mutex.unlock();
+	if (!newLines.isEmpty()) emit queueChanged();
 }
 
 void cQueue::SwapQueueItem(int i, int j)
@@ -384,9 +531,20 @@ void cQueue::RemoveFromList(const structQueueItem &queueItem)
 {
 	mutex.lock();
 	// remove queue item if it is on the list
-	queueListFromFile.removeAll(queueItem);
+	if (queueListFromFile.removeAll(queueItem) == 0)
+	{
+		mutex.unlock();
+		return;
+	}
+	bool compact =
+		journalRemovals + 1 > qMax(QUEUE_JOURNAL_MIN_REMOVALS, queueListFromFile.size());
+	if (!compact) AppendToQueueFile(QStringList() << "- " + QueueFileLine(queueItem));
 	mutex.unlock();
-	StoreList();
+
+	if (compact)
+		StoreList();
+	else
+		emit queueChanged();
 }
 
 void cQueue::StoreList()
@@ -399,12 +557,46 @@ void cQueue::StoreList()
 		stream << "#\n# Mandelbulber queue file\n#\n";
 		for (int i = 0; i < queueListFromFile.size(); i++)
 		{
-			stream << queueListFromFile.at(i).filename << " "
-						 << GetTypeText(queueListFromFile.at(i).renderType) << endl;
+			stream << QueueFileLine(queueListFromFile.at(i)) << endl;
 		}
+		stream.flush();
+		storedFileSize = file.size();
+		journalRemovals = 0;
 	}
 	file.close();
 	mutex.unlock();
+	emit queueChanged();
+}
+
+void cQueue::AppendToQueueFile(const QStringList &lines)
+{
+	QFile file(queueListFileName);
+	if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append))
+	{
+		QTextStream stream(&file);
+		for (int i = 0; i < lines.size(); i++)
+		{
+			stream << lines.at(i) << endl;
+			if (lines.at(i).startsWith("-")) journalRemovals++;
+		}
+		stream.flush();
+		storedFileSize = file.size();
+	}
+	file.close();
+}
+
+QString cQueue::QueueFileLine(const structQueueItem &queueItem)
+{
+	return queueItem.filename + " " + GetTypeText(queueItem.renderType);
+}
+
+bool cQueue::ParseQueueFileLine(const QString &line, structQueueItem *queueItem)
+{
+	static const QRegularExpression reType("^(.*?\\.fract)\\s*(STILL|KEYFRAME|FLIGHT)?$");
+	QRegularExpressionMatch matchType = reType.match(line);
+	if (!matchType.hasMatch()) return false;
+	*queueItem = structQueueItem(matchType.captured(1), GetTypeEnum(matchType.captured(2)));
+	return true;
 }
 
 void cQueue::RemoveFromFileSystem(const QString &filename)
@@ -468,7 +660,11 @@ void cQueue::queueFileChanged(const QString &path)
 	// qDebug() << "queueFileChanged";
 	if (path == queueListFileName)
 	{
-		UpdateListFromQueueFile();
+		// list is already up to date when the file was changed by this instance
+		mutex.lock();
+		bool ownChange = QFileInfo(queueListFileName).size() == storedFileSize;
+		mutex.unlock();
+		if (!ownChange) UpdateListFromQueueFile();
 	}
 }
 
@@ -490,20 +686,31 @@ void cQueue::UpdateListFromQueueFile()
 	if (file.open(QIODevice::ReadOnly))
 	{
 		QTextStream in(&file);
+		journalRemovals = 0;
 		while (!in.atEnd())
 		{
 			QString line = in.readLine().trimmed();
 			if (line.startsWith("#") || line == "") continue;
-			QRegularExpression reType("^(.*?\\.fract)\\s*(STILL|KEYFRAME|FLIGHT)?$");
-			QRegularExpressionMatch matchType = reType.match(line);
-			if (matchType.hasMatch())
+			// journal lines which remove items
+			bool removal = line.startsWith("- ");
+			if (removal) line = line.mid(2);
+
+			structQueueItem queueItem("", queue_STILL);
+			if (!ParseQueueFileLine(line, &queueItem))
+			{
+				qWarning() << "wrong format in line: " << line;
+			}
+			else if (removal)
 			{
-				queueListFromFile << structQueueItem(
-					matchType.captured(1), GetTypeEnum(matchType.captured(2)));
+				queueListFromFile.removeAll(queueItem);
+				journalRemovals++;
 			}
 			else
-				qWarning() << "wrong format in line: " << line;
+			{
+				queueListFromFile << queueItem;
+			}
 		}
+		storedFileSize = file.size();
 		file.close();
 	}
 	mutex.unlock();
@@ -524,6 +731,38 @@ void cQueue::UpdateListFromFileSystem()
 
 void cQueue::RenderQueue()
 {
+	// NetRender clients can work only on one job
+	concurrentJobs = gNetRender->IsServer() ? 1 : gPar->Get<int>("queue_concurrent_jobs");
+	totalThreads = gPar->Get<int>("limit_CPU_cores");
+	freeThreads = totalThreads;
+	exclusiveRequests = 0;
+	memoryBudget =
+		gPar->Get<bool>("memory_admission_control") ? cMemoryEstimator::GetMemoryBudget(gPar) : -1;
+	reservedMemory = 0;
+	jobsWithMemory = 0;
+	queueItemsInProgress.clear();
+
+	reportMutex.lock();
+	runReport = cResourceReport();
+	runReport.Start("queue");
+	runningRenderQueues = concurrentJobs;
+	reportMutex.unlock();
+
+	// additional jobs are rendered to own images and don't report progress
+	for (int i = 1; i < concurrentJobs; i++)
+	{
+		QThread *thread = new QThread; // deleted by deleteLater()
+		cRenderQueue *renderQueue = new cRenderQueue(NULL, NULL);
+		renderQueue->moveToThread(thread);
+		renderQueue->setObjectName("Queue #" + QString::number(i));
+		QObject::connect(thread, SIGNAL(started()), renderQueue, SLOT(slotRenderQueue()));
+		QObject::connect(renderQueue, SIGNAL(finished()), renderQueue, SLOT(deleteLater()));
+		QObject::connect(renderQueue, SIGNAL(finished()), thread, SLOT(quit()));
+		QObject::connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+		thread->setObjectName("RenderQueue #" + QString::number(i));
+		thread->start();
+	}
+
 	QThread *thread = new QThread; // deleted by deleteLater()
 	cRenderQueue *renderQueue = new cRenderQueue(image, renderedImageWidget);
 	renderQueue->moveToThread(thread);
@@ -37,6 +37,14 @@
 
 #include <QtCore>
 
+#include "resource_report.hpp"
+
+// number of pixel samples of queue item which is rendered by one thread when many items are
+// rendered at the same time
+#define QUEUE_SAMPLES_PER_THREAD 200000
+// queue file is rewritten when it contains more removal lines than items (but at least this)
+#define QUEUE_JOURNAL_MIN_REMOVALS 256
+
 // forward declarations
 class cImage;
 class cParameterContainer;
@@ -45,6 +53,7 @@ class cAnimationFrames;
 class cKeyframes;
 class cInterface;
 class RenderedImage;
+class cRenderEstimate;
 
 namespace Ui
 {
@@ -88,6 +97,8 @@ public:
 		cKeyframes *keyframes, enumRenderType renderType = queue_STILL);
 	void AppendList(const QString &filename);
 	void AppendFolder(const QString &filename);
+	// adds many items with one write of queue file. Items already on the list are skipped
+	void AppendItems(const QList<structQueueItem> &queueItems);
 
 	// get next queue element into given containers
 	bool Get();
@@ -124,6 +135,24 @@ public:
 	void UpdateQueueItemType(int i, enumRenderType renderType);
 	// gives next filename
 	structQueueItem GetNextFromList();
+	// gives next item which is not rendered yet and marks it as rendered
+	structQueueItem TakeNextFromList();
+	// item is not rendered anymore
+	void ReleaseQueueItem(const structQueueItem &queueItem);
+	// reserves threads for queue item with given number of pixel samples. Animations are rendered
+	// with all threads (exclusive)
+	int ReserveThreads(double samples, bool exclusive);
+	void ReleaseThreads(int threads);
+	// reserves memory budget for concurrent queue item. Waits while other items use it, but
+	// an item is always started when nothing else is rendered
+	void ReserveMemory(qint64 bytes);
+	void ReleaseMemory(qint64 bytes);
+	// report of finished queue item is added to report of the whole queue run
+	void AddResourceReport(const cResourceReport &report);
+	// called by every render queue when it stops. The last one saves report of the queue run
+	void RenderQueueFinished();
+	// estimates time of rendering of queue item (all frames of animation)
+	bool EstimateRenderTime(const structQueueItem &queueItem, cRenderEstimate *estimate);
 	// remove queue item if it is on the list
 	void RemoveFromList(const structQueueItem &queueItem);
 	int GetQueueSize();
@@ -164,8 +193,14 @@ private:
 	void AddToList(const structQueueItem &queueItem);
 	// remove queue file from filesystem
 	void RemoveFromFileSystem(const QString &filename);
-	// store queueListFromFile to filesystem
+	// store queueListFromFile to filesystem (also compacts journal of changes)
 	void StoreList();
+	// appends lines to the end of queue file (mutex has to be locked)
+	void AppendToQueueFile(const QStringList &lines);
+	// line of queue file which describes the item
+	static QString QueueFileLine(const structQueueItem &queueItem);
+	// parses line of queue file. Returns false if line has wrong format
+	static bool ParseQueueFileLine(const QString &line, structQueueItem *queueItem);
 	// checks if file exists and it is a proper fractal file
 	bool ValidateEntry(const QString &filename);
 	// updates the list of fractals to render from queue file
@@ -187,8 +222,28 @@ private:
 
 	QString queueListFileName;
 	QString queueFolder;
+	// additions and removals are appended to queue file as a journal. Removal lines start with '-'
+	int journalRemovals;
+	qint64 storedFileSize; // size of queue file after the last write (to skip own changes)
 
 	QMutex mutex;
+
+	// concurrent rendering of queue items
+	QList<structQueueItem> queueItemsInProgress;
+	int concurrentJobs;
+	int totalThreads;
+	int freeThreads;
+	int exclusiveRequests;
+	qint64 memoryBudget; // -1 if not limited
+	qint64 reservedMemory;
+	int jobsWithMemory;
+	QMutex threadsMutex;
+	QWaitCondition threadsReleased;
+
+	// resource report of all items rendered by one run of the queue
+	cResourceReport runReport;
+	int runningRenderQueues;
+	QMutex reportMutex;
 };
 
 extern cQueue *gQueue;
@@ -0,0 +1,203 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderCheckpoint class - saving of finished lines of long renders
+ */
+
+#include "render_checkpoint.hpp"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+
+#include "cimage.hpp"
+#include "netrender_line_decoder.hpp"
+#include "settings.hpp"
+#include "system.hpp"
+
+// "MBCP" and version of the file format
+#define CHECKPOINT_MAGIC 0x4d424350
+#define CHECKPOINT_VERSION 1
+
+cRenderCheckpoint::cRenderCheckpoint(
+	const QString &_fileName, int _width, int _height, const QByteArray &_settingsHash)
+		: fileName(_fileName), width(_width), height(_height), settingsHash(_settingsHash),
+			file(_fileName)
+{
+	savedLines.fill(false, height);
+	validSize = 0;
+}
+
+cRenderCheckpoint::~cRenderCheckpoint()
+{
+	if (file.isOpen()) file.close();
+}
+
+QList<int> cRenderCheckpoint::Load(cImage *image)
+{
+	QList<int> loadedLines;
+	validSize = 0;
+
+	QFile input(fileName);
+	if (!input.open(QIODevice::ReadOnly)) return loadedLines;
+
+	QDataStream stream(&input);
+	quint32 magic, version;
+	qint32 fileWidth, fileHeight;
+	QByteArray fileHash;
+	stream >> magic >> version >> fileWidth >> fileHeight >> fileHash;
+	if (stream.status() != QDataStream::Ok || magic != CHECKPOINT_MAGIC
+			|| version != CHECKPOINT_VERSION)
+	{
+		qWarning() << "cRenderCheckpoint::Load(): wrong format of checkpoint file" << fileName;
+		return loadedLines;
+	}
+	if (fileWidth != width || fileHeight != height || fileHash != settingsHash)
+	{
+		qWarning() << "cRenderCheckpoint::Load(): checkpoint" << fileName
+							 << "was saved for different settings. Rendering from the beginning";
+		return loadedLines;
+	}
+	qint64 headerSize = input.pos();
+
+	// records are read until the end of the file or until record written partially
+	QList<int> lineNumbers;
+	QList<QByteArray> lines;
+	QList<qint64> recordEnds;
+	while (!stream.atEnd())
+	{
+		qint32 line;
+		QByteArray data;
+		stream >> line >> data;
+		if (stream.status() != QDataStream::Ok || line < 0 || line >= height) break;
+		lineNumbers.append(line);
+		lines.append(data);
+		recordEnds.append(input.pos());
+	}
+	input.close();
+
+	// decoding stops at the first corrupted line, so the lines after it are removed from the file
+	cNetRenderLineDecoder decoder(image);
+	decoder.slotDecodeLines(lineNumbers, lines);
+	loadedLines = decoder.TakeDecodedLines();
+	for (int i = 0; i < loadedLines.size(); i++)
+		savedLines[loadedLines.at(i)] = true;
+	validSize = loadedLines.isEmpty() ? headerSize : recordEnds.at(loadedLines.size() - 1);
+
+	WriteLogDouble("cRenderCheckpoint::Load(): loaded lines", loadedLines.size(), 2);
+	return loadedLines;
+}
+
+void cRenderCheckpoint::WriteHeader()
+{
+	QDataStream stream(&file);
+	stream << quint32(CHECKPOINT_MAGIC) << quint32(CHECKPOINT_VERSION) << qint32(width)
+				 << qint32(height) << settingsHash;
+	file.flush();
+}
+
+bool cRenderCheckpoint::Open()
+{
+	if (validSize > 0)
+	{
+		if (!file.open(QIODevice::ReadWrite))
+		{
+			qCritical() << "cRenderCheckpoint::Open(): cannot open file" << fileName;
+			return false;
+		}
+		file.resize(validSize);
+		file.seek(validSize);
+	}
+	else
+	{
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qCritical() << "cRenderCheckpoint::Open(): cannot open file" << fileName;
+			return false;
+		}
+		savedLines.fill(false, height);
+		WriteHeader();
+	}
+	return true;
+}
+
+bool cRenderCheckpoint::Append(const QList<int> &lineNumbers, const QList<QByteArray> &lines)
+{
+	if (!file.isOpen()) return false;
+
+	QDataStream stream(&file);
+	for (int i = 0; i < lineNumbers.size(); i++)
+	{
+		stream << qint32(lineNumbers.at(i)) << lines.at(i);
+		savedLines[lineNumbers.at(i)] = true;
+	}
+	// data has to reach the disk, because the process can be killed at any time
+	file.flush();
+	validSize = file.pos();
+
+	if (stream.status() != QDataStream::Ok)
+	{
+		qCritical() << "cRenderCheckpoint::Append(): cannot write to file" << fileName;
+		return false;
+	}
+	return true;
+}
+
+void cRenderCheckpoint::Remove()
+{
+	if (file.isOpen()) file.close();
+	QFile::remove(fileName);
+	savedLines.fill(false, height);
+	validSize = 0;
+}
+
+int cRenderCheckpoint::GetNumberOfSavedLines() const
+{
+	int count = 0;
+	for (int i = 0; i < savedLines.size(); i++)
+		if (savedLines.at(i)) count++;
+	return count;
+}
+
+QString cRenderCheckpoint::FileNameForImage(const QString &imageFileName)
+{
+	QFileInfo fi(imageFileName);
+	return fi.path() + QDir::separator() + fi.completeBaseName() + ".checkpoint";
+}
+
+QByteArray cRenderCheckpoint::SettingsHash(
+	const cParameterContainer *par, const cFractalContainer *fractPar)
+{
+	cSettings settings(cSettings::formatCondensedText);
+	settings.BeQuiet(true);
+	settings.CreateText(par, fractPar);
+	return settings.GetHashCode().toLatin1();
+}
@@ -0,0 +1,94 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderCheckpoint class - saving of finished lines of long renders
+ *
+ * Lines which are rendered in whole width are appended to the file as compressed
+ * records in NetRender line format with full precision. After crash or
+ * preemption the render can be resumed: saved lines are loaded to the image and
+ * marked as done in the scheduler. Incomplete record at the end of the file
+ * (written while crashing) is discarded.
+ */
+
+#ifndef MANDELBULBER2_SRC_RENDER_CHECKPOINT_HPP_
+#define MANDELBULBER2_SRC_RENDER_CHECKPOINT_HPP_
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// forward declarations
+class cImage;
+class cParameterContainer;
+class cFractalContainer;
+
+class cRenderCheckpoint
+{
+public:
+	// checkpoint belongs to the image of given size rendered with settings of given hash
+	cRenderCheckpoint(
+		const QString &_fileName, int _width, int _height, const QByteArray &_settingsHash);
+	~cRenderCheckpoint();
+
+	// loads saved lines to the image and returns their numbers. Returns empty list if there is
+	// no checkpoint or it belongs to different render
+	QList<int> Load(cImage *image);
+	// opens the file for appending of lines. Loaded lines are kept, any other content is removed
+	bool Open();
+	// appends records of lines and flushes the file
+	bool Append(const QList<int> &lineNumbers, const QList<QByteArray> &lines);
+	// render is finished, so checkpoint is not needed anymore
+	void Remove();
+
+	bool IsLineSaved(int line) const { return savedLines.at(line); }
+	int GetNumberOfSavedLines() const;
+	const QString &GetFileName() const { return fileName; }
+
+	// checkpoint is saved next to the image file
+	static QString FileNameForImage(const QString &imageFileName);
+	static QByteArray SettingsHash(const cParameterContainer *par, const cFractalContainer *fractPar);
+
+private:
+	void WriteHeader();
+
+	QString fileName;
+	int width;
+	int height;
+	QByteArray settingsHash;
+	QFile file;
+	QVector<bool> savedLines;
+	// size of the file up to the last correct record
+	qint64 validSize;
+};
+
+#endif /* MANDELBULBER2_SRC_RENDER_CHECKPOINT_HPP_ */
@@ -44,11 +44,29 @@
 #include "stereo.h"
 #include "texture.hpp"
 
+// forward declarations
+class cAdaptiveSampling;
+class cAntiAliasing;
+class cAOBuffer;
+class cCheckerboardRender;
+class cCubeLUT;
+class cDepthPrepass;
+class cDistanceCache;
+class cJobArena;
+class cLightGrid;
+class cOpenClEngine;
+class cProgressiveDepth;
+class cRenderWorkerPool;
+class cShadowCache;
+class cTemporalDepth;
+
 struct sTextures
 {
 	cTexture backgroundTexture;
 	cTexture envmapTexture;
 	cTexture lightmapTexture;
+	// brightness is relative density of rendered pixels (not loaded if not used)
+	cTexture foveationMap;
 	QList<cTexture *> textureList;
 
 	sTextures()
@@ -56,28 +74,123 @@ struct sTextures
 		textureList.append(&backgroundTexture);
 		textureList.append(&envmapTexture);
 		textureList.append(&lightmapTexture);
+		textureList.append(&foveationMap);
 	};
 };
 
 struct sRenderData
 {
-	sRenderData() : rendererID(0), stopRequest(NULL), lastPercentage(1.0), reduceDetail(1.0) {}
+	sRenderData()
+			: rendererID(0),
+				stopRequest(NULL),
+				lastPercentage(1.0),
+				reduceDetail(1.0),
+				minProgressiveStep(1),
+				tiled(false),
+				partialRender(false),
+				relighting(false),
+				firstTouchClear(false),
+				stereoSinglePass(false),
+				deferredPostProcessing(false),
+				workerPool(NULL),
+				depthPrepass(NULL),
+				progressiveDepth(NULL),
+				temporalDepth(NULL),
+				antiAliasing(NULL),
+				aoBuffer(NULL),
+				lightGrid(NULL),
+				shadowCache(NULL),
+				aoCache(NULL),
+				backgroundLUT(NULL),
+				envMapLUT(NULL),
+				openClEngine(NULL),
+				distanceCache(NULL),
+				adaptiveSampling(NULL),
+				checkerboard(NULL),
+				arena(NULL)
+	{
+	}
 
 	int rendererID;
 	cRegion<int> screenRegion;
 	cRegion<double> imageRegion;
+	// size of the whole image and position of the rendered part when image is rendered in tiles
+	bool tiled;
+	CVector2<int> fullImageSize;
+	CVector2<int> tileOffset;
+	// only screenRegion of already rendered image is rendered again
+	bool partialRender;
+	// primary rays are not traced, geometry is taken from G-buffer of the image
+	bool relighting;
+	// rendering threads clear their bands of image buffers allocated without clearing, so memory
+	// is placed on their NUMA nodes
+	bool firstTouchClear;
 	sTextures textures;
 	cLights lights;
 	bool *stopRequest;
 	double lastPercentage;
 	double reduceDetail;
+	// progressive passes with smaller pixels are skipped (reduced resolution of interactive frames)
+	int minProgressiveStep;
 	cStatistics statistics;
 	QList<int> netRenderStartingPositions;
+	// rendering time of image lines measured in previous frame (used by scheduler)
+	QVector<double> lineCostMap;
 	cRenderingConfiguration configuration;
 
 	QMap<int, cMaterial> materials; // 'int' is an ID
 	QVector<cObjectData> objectData;
 	cStereo stereo;
+	// pixels of the second eye are rendered together with pixels of the first eye
+	bool stereoSinglePass;
+	// SSAO and DOF are not done by renderer, but later by the frame pipeline
+	bool deferredPostProcessing;
+
+	// persistent rendering threads owned by cRenderJob (if NULL, cRenderer uses temporary ones)
+	cRenderWorkerPool *workerPool;
+
+	// coarse depth buffer used as start distance of primary rays (NULL if not used)
+	cDepthPrepass *depthPrepass;
+
+	// depth of pixels from previous progressive passes (NULL if not used)
+	cProgressiveDepth *progressiveDepth;
+
+	// depth reprojected from previous animation frame (NULL if not used)
+	cTemporalDepth *temporalDepth;
+
+	// pixels refined with sub-pixel samples after main passes (NULL if not used)
+	cAntiAliasing *antiAliasing;
+
+	// multi-ray ambient occlusion rendered in reduced resolution (NULL if not used)
+	cAOBuffer *aoBuffer;
+
+	// aux lights sorted into cells of space for faster shading (NULL if not used)
+	cLightGrid *lightGrid;
+
+	// main light shadows from previous animation frames or the other stereo eye (NULL if not used)
+	cShadowCache *shadowCache;
+
+	// multi-ray ambient occlusion shared by both eyes of single-pass stereo (NULL if not used)
+	cShadowCache *aoCache;
+
+	// colours of background and environment map for all directions (NULL if not used)
+	cCubeLUT *backgroundLUT;
+	cCubeLUT *envMapLUT;
+
+	// primary rays rendered by OpenCL device (NULL if rendered by CPU)
+	cOpenClEngine *openClEngine;
+
+	// distances of the fractal shared with other render jobs (NULL if not used)
+	cDistanceCache *distanceCache;
+
+	// pixels interpolated from sparse samples after main passes (NULL if not used)
+	cAdaptiveSampling *adaptiveSampling;
+
+	// half of pixels rendered in alternating pattern, the rest reconstructed (NULL if not used)
+	cCheckerboardRender *checkerboard;
+
+	// memory of buffers which live only during rendering of the frame (NULL if not used)
+	cJobArena *arena;
 };
 
 #endif /* MANDELBULBER2_SRC_RENDER_DATA_HPP_ */
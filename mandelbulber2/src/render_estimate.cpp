@@ -0,0 +1,174 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderEstimate class - estimation of rendering time before the job is started
+ */
+
+#include "render_estimate.hpp"
+
+#include <QElapsedTimer>
+
+#include "animation_frames.hpp"
+#include "cimage.hpp"
+#include "fractal_container.hpp"
+#include "keyframes.hpp"
+#include "parameters.hpp"
+#include "render_job.hpp"
+#include "rendering_configuration.hpp"
+#include "statistics.h"
+
+cRenderEstimate::cRenderEstimate()
+{
+	width = 0;
+	height = 0;
+	sampleWidth = 0;
+	sampleHeight = 0;
+	numberOfFrames = 0;
+	numberOfThreads = 1;
+	setupTime = 0.0;
+	renderTime = 0.0;
+	ssaoTime = 0.0;
+	dofTime = 0.0;
+	otherPostTime = 0.0;
+	frameTime = 0.0;
+	totalTime = 0.0;
+}
+
+cRenderEstimate::~cRenderEstimate()
+{
+}
+
+bool cRenderEstimate::Estimate(
+	const cParameterContainer &par, const cFractalContainer &fractPar, int _numberOfFrames)
+{
+	cParameterContainer samplePar = par;
+	cFractalContainer sampleFractPar = fractPar;
+	numberOfFrames = _numberOfFrames;
+
+	// sample has the same aspect ratio as the image
+	width = par.Get<int>("image_width");
+	height = par.Get<int>("image_height");
+	double scale = qMin(1.0, sqrt((double)RENDER_ESTIMATE_SAMPLES / ((double)width * height)));
+	sampleWidth = qMax(4, qRound(width * scale));
+	sampleHeight = qMax(4, qRound(height * scale));
+	samplePar.Set("image_width", sampleWidth);
+	samplePar.Set("image_height", sampleHeight);
+
+	// resolution depends on image height, so distance threshold is kept by higher detail level
+	double detailFactor = (double)height / sampleHeight;
+	samplePar.Set("detail_level", par.Get<double>("detail_level") * detailFactor);
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+	config.EnableIgnoreErros();
+
+	bool stopRequest = false;
+	cImage image(sampleWidth, sampleHeight);
+	cRenderJob renderJob(&samplePar, &sampleFractPar, &image, &stopRequest);
+
+	// textures and other job data are loaded once per job, so they are not extrapolated
+	QElapsedTimer timer;
+	timer.start();
+	if (!renderJob.Init(cRenderJob::still, config)) return false;
+	setupTime = timer.nsecsElapsed() / 1e9;
+	if (!renderJob.Execute()) return false;
+
+	cStatistics statistics = renderJob.GetStatistics();
+	numberOfThreads = config.GetNumberOfThreads();
+	double pixelFactor = ((double)width * height) / ((double)sampleWidth * sampleHeight);
+
+	// tiny image doesn't keep all threads busy, so time of threads is used instead of wall time
+	double threadsTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		threadsTime += statistics.stageTimes[i];
+	renderTime = threadsTime * pixelFactor / numberOfThreads;
+	if (threadsTime <= 0.0)
+	{
+		renderTime = (statistics.prepassTime + statistics.mainPassTime + statistics.antiAliasingTime)
+								 * pixelFactor;
+	}
+
+	// blur radius in pixels grows with the resolution
+	ssaoTime = statistics.ssaoTime * pixelFactor;
+	dofTime = statistics.dofTime * pixelFactor * detailFactor;
+	otherPostTime =
+		qMax(0.0, statistics.postProcessingTime - statistics.ssaoTime - statistics.dofTime)
+		* pixelFactor;
+
+	frameTime = renderTime + ssaoTime + dofTime + otherPostTime;
+	totalTime = setupTime + frameTime * numberOfFrames;
+	return true;
+}
+
+int cRenderEstimate::NumberOfFrames(const cParameterContainer &par,
+	const cAnimationFrames *frames, const cKeyframes *keyframes, enumJobType jobType)
+{
+	switch (jobType)
+	{
+		case jobStill: return 1;
+		case jobFlight:
+		{
+			if (!frames) return 0;
+			int last = qMin(par.Get<int>("flight_last_to_render"), frames->GetNumberOfFrames() - 1);
+			return qMax(0, last - par.Get<int>("flight_first_to_render") + 1);
+		}
+		case jobKeyframe:
+		{
+			if (!keyframes) return 0;
+			int totalFrames =
+				(keyframes->GetNumberOfFrames() - 1) * par.Get<int>("frames_per_keyframe");
+			int last = qMin(par.Get<int>("keyframe_last_to_render"), totalFrames - 1);
+			return qMax(0, last - par.Get<int>("keyframe_first_to_render") + 1);
+		}
+	}
+	return 1;
+}
+
+QJsonObject cRenderEstimate::ToJson() const
+{
+	QJsonObject result;
+	result["width"] = width;
+	result["height"] = height;
+	result["sample_width"] = sampleWidth;
+	result["sample_height"] = sampleHeight;
+	result["threads"] = numberOfThreads;
+	result["frames"] = numberOfFrames;
+	result["setup_time"] = setupTime;
+	result["render_time"] = renderTime;
+	result["ssao_time"] = ssaoTime;
+	result["dof_time"] = dofTime;
+	result["other_post_processing_time"] = otherPostTime;
+	result["frame_time"] = frameTime;
+	result["total_time"] = totalTime;
+	return result;
+}
@@ -0,0 +1,100 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderEstimate class - estimation of rendering time before the job is started
+ *
+ * The job is rendered in tiny resolution (a few hundred pixels) with all
+ * shading effects. Detail level is increased, so distance threshold is the same
+ * as in full resolution. Time of rendering threads per pixel, post-processing
+ * effects and setup of the job are measured and extrapolated to the full frame
+ * and to the number of rendered animation frames.
+ */
+
+#ifndef MANDELBULBER2_SRC_RENDER_ESTIMATE_HPP_
+#define MANDELBULBER2_SRC_RENDER_ESTIMATE_HPP_
+
+#include <QJsonObject>
+
+// number of pixels rendered to estimate time of the job
+#define RENDER_ESTIMATE_SAMPLES 400
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+class cAnimationFrames;
+class cKeyframes;
+
+class cRenderEstimate
+{
+public:
+	enum enumJobType
+	{
+		jobStill,
+		jobFlight,
+		jobKeyframe
+	};
+
+	cRenderEstimate();
+	~cRenderEstimate();
+
+	// renders sample of the job. Returns false if rendering failed
+	bool Estimate(const cParameterContainer &par, const cFractalContainer &fractPar,
+		int numberOfFrames = 1);
+
+	// number of frames which will be rendered for given job type (settings of the animation
+	// are taken from frames or keyframes)
+	static int NumberOfFrames(const cParameterContainer &par, const cAnimationFrames *frames,
+		const cKeyframes *keyframes, enumJobType jobType);
+
+	// loading of textures and preparation of the job, done once per job
+	double GetSetupTime() const { return setupTime; }
+	double GetFrameTime() const { return frameTime; }
+	double GetTotalTime() const { return totalTime; }
+	QJsonObject ToJson() const;
+
+private:
+	int width;
+	int height;
+	int sampleWidth;
+	int sampleHeight;
+	int numberOfFrames;
+	int numberOfThreads;
+	// all times in seconds
+	double setupTime;
+	double renderTime; // ray-marching and shading (all passes)
+	double ssaoTime;
+	double dofTime;
+	double otherPostTime;
+	double frameTime;
+	double totalTime;
+};
+
+#endif /* MANDELBULBER2_SRC_RENDER_ESTIMATE_HPP_ */
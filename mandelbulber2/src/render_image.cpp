@@ -35,20 +35,50 @@
 #include "render_image.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <QtCore>
 
+#include "adaptive_sampling.hpp"
+#include "anti_aliasing.hpp"
+#include "ao_buffer.hpp"
 #include "ao_modes.h"
+#include "checkerboard_render.hpp"
+#include "denoiser.hpp"
+#include "depth_prepass.hpp"
 #include "dof.hpp"
+#include "half_float.h"
+#include "progressive_depth.hpp"
 #include "fractparams.hpp"
 #include "progress_text.hpp"
 #include "render_worker.hpp"
+#include "render_worker_pool.hpp"
 #include "global_data.hpp"
+#include "light_grid.hpp"
 #include "netrender.hpp"
+#include "netrender_line_decoder.hpp"
+#include "netrender_post_tiles.hpp"
+#include "numa_topology.hpp"
+#include "opencl_engine.hpp"
+#include "render_checkpoint.hpp"
 #include "render_data.hpp"
 #include "render_ssao.h"
 #include "scheduler.hpp"
+#include "tile_scheduler.hpp"
 #include "stereo.h"
 #include "system.hpp"
+#include "trace.hpp"
+
+// duration of one job of OpenCL device in seconds. The image is refreshed between jobs
+#define OPENCL_JOB_TIME 0.05
+
+// throughput of OpenCL device and CPU threads which render tiles of the same image
+struct sDeviceThroughput
+{
+	sDeviceThroughput() : deviceTiles(0), deviceTime(0.0) {}
+	int deviceTiles;
+	double deviceTime; // total time of device jobs in seconds
+	QElapsedTimer timer; // started together with the device
+};
 
 cRenderer::cRenderer(const cParamRender *_params, const cNineFractals *_fractal,
 	sRenderData *_renderData, cImage *_image)
@@ -59,17 +89,21 @@ cRenderer::cRenderer(const cParamRender *_params, const cNineFractals *_fractal,
 	data = _renderData;
 	image = _image;
 	scheduler = NULL;
+	lineDecoder = NULL;
+	lineDecoderThread = NULL;
 	netRenderAckReceived = true;
 }
 
 cRenderer::~cRenderer()
 {
+	StopLineDecoder();
 	if (scheduler) delete scheduler;
 }
 
 bool cRenderer::RenderImage()
 {
 	WriteLog("cRenderer::RenderImage()", 2);
+	TRACE_SCOPE("cRenderer::RenderImage", "render");
 
 	if (image->IsAllocated())
 	{
@@ -83,45 +117,133 @@ bool cRenderer::RenderImage()
 			progressiveSteps = 0;
 
 		if (progressiveSteps < 0) progressiveSteps = 0;
+		// OpenCL device renders only full resolution. Checkerboard pattern is defined only for
+		// single pixels
+		if (data->openClEngine || data->checkerboard) progressiveSteps = 0;
 		int progressive = pow(2.0, (double)progressiveSteps - 1);
 		if (progressive == 0) progressive = 1;
 
-		// prepare multiple threads
-		QThread **thread = new QThread *[data->configuration.GetNumberOfThreads()];
-		cRenderWorker::sThreadData *threadData =
-			new cRenderWorker::sThreadData[data->configuration.GetNumberOfThreads()];
-		cRenderWorker **worker = new cRenderWorker *[data->configuration.GetNumberOfThreads()];
+		// prepare multiple threads. Threads are reused for all progressive passes and, if render job
+		// provides own pool, also for all rendered frames
+		cRenderWorkerPool *localWorkerPool = NULL;
+		cRenderWorkerPool *workerPool = data->workerPool;
+		if (!workerPool)
+		{
+			localWorkerPool = new cRenderWorkerPool;
+			workerPool = localWorkerPool;
+		}
+		workerPool->Prepare(data->configuration.GetNumberOfThreads(), params, fractal, data, image);
 
 		if (scheduler) delete scheduler;
-		scheduler = new cScheduler(data->screenRegion, progressive);
+		if (params->tileSchedulerEnabled || data->openClEngine
+				|| params->tileOrder != cTileScheduler::tileOrderRows)
+		{
+			// with NetRender only completely rendered lines can be reported. OpenCL device takes
+			// tiles from the same pool as CPU threads
+			cTileScheduler *tileScheduler = new cTileScheduler(data->screenRegion, progressive,
+				params->tileSize, data->configuration.GetNumberOfThreads(),
+				data->configuration.UseNetRender(), data->arena);
+			// threads work on tiles of their own NUMA node as long as there are any
+			if (systemData.threadsAffinity)
+			{
+				tileScheduler->SetQueueNodes(cNumaTopology::Instance()->NodesOfThreads(
+					data->configuration.GetNumberOfThreads()));
+			}
+			if (params->tileOrder != cTileScheduler::tileOrderRows)
+			{
+				int focusX = (data->screenRegion.x1 + data->screenRegion.x2) / 2;
+				int focusY = (data->screenRegion.y1 + data->screenRegion.y2) / 2;
+				data->configuration.GetFocusPoint(&focusX, &focusY);
+				tileScheduler->SetTileOrder(
+					cTileScheduler::enumTileOrder(params->tileOrder), focusX, focusY);
+			}
+			scheduler = tileScheduler;
+		}
+		else
+		{
+			scheduler = new cScheduler(data->screenRegion, progressive, data->arena);
+			scheduler->SetCostMap(data->lineCostMap);
+		}
+
+		// lines of pipelined job which clients rendered before the server started it
+		if (data->configuration.UseNetRender() && gNetRender->IsServer())
+		{
+			StartLineDecoder();
+
+			QList<int> lineNumbers;
+			QList<QByteArray> lines;
+			gNetRender->TakeNextJobLines(&lineNumbers, &lines);
+			if (!lineNumbers.isEmpty()) NewLinesArrived(lineNumbers, lines);
+		}
 
 		cProgressText progressText;
 		progressText.ResetTimer();
 
 		for (int i = 0; i < data->configuration.GetNumberOfThreads(); i++)
 		{
-			threadData[i].id = i + 1;
+			cRenderWorker::sThreadData *threadData = workerPool->GetThreadData(i);
+			threadData->id = i + 1;
 			if (data->configuration.UseNetRender())
 			{
 				if (i < data->netRenderStartingPositions.size())
 				{
-					threadData[i].startLine = data->netRenderStartingPositions.at(i);
+					threadData->startLine = data->netRenderStartingPositions.at(i);
 				}
 				else
 				{
-					threadData[i].startLine = data->screenRegion.y1;
+					threadData->startLine = data->screenRegion.y1;
 					qCritical() << "NetRender - Mising starting positions data";
 				}
 			}
 			else
 			{
-				threadData[i].startLine =
-					(data->screenRegion.height / data->configuration.GetNumberOfThreads() * i
-						+ data->screenRegion.y1)
-					/ scheduler->GetProgressiveStep() * scheduler->GetProgressiveStep();
+				threadData->startLine =
+					scheduler->CostStartingPosition(i, data->configuration.GetNumberOfThreads());
+			}
+			threadData->scheduler = scheduler;
+
+			// statistics are collected by each thread separately and merged after rendering
+			cStatistics *threadStatistics = &threadData->statistics;
+			threadStatistics->histogramIterations.Resize(data->statistics.histogramIterations.GetSize());
+			threadStatistics->histogramStepCount.Resize(data->statistics.histogramStepCount.GetSize());
+			threadStatistics->Reset();
+		}
+
+		// buffers allocated with first-touch option are cleared by the threads which render them
+		if (image->IsClearPending())
+		{
+			WriteLog("First-touch clearing of image buffers", 2);
+			data->firstTouchClear = true;
+			workerPool->StartAll();
+			while (workerPool->IsAnyRunning())
+			{
+				gApplication->processEvents();
+			};
+			data->firstTouchClear = false;
+			image->MarkCleared();
+		}
+
+		// lines of interrupted render are loaded from checkpoint and are not rendered again. Only
+		// lines of the last progressive pass are final
+		cRenderCheckpoint *checkpoint = NULL;
+		if (!data->configuration.GetCheckpointFile().isEmpty() && progressive == 1
+				&& !(data->configuration.UseNetRender() && gNetRender->IsClient()))
+		{
+			checkpoint = new cRenderCheckpoint(data->configuration.GetCheckpointFile(),
+				image->GetWidth(), image->GetHeight(), data->configuration.GetCheckpointSettingsHash());
+			if (data->configuration.UseResume())
+			{
+				QList<int> loadedLines = checkpoint->Load(image);
+				if (!loadedLines.isEmpty()) scheduler->MarkReceivedLines(loadedLines);
+			}
+			if (!checkpoint->Open())
+			{
+				delete checkpoint;
+				checkpoint = NULL;
 			}
-			threadData[i].scheduler = scheduler;
 		}
+		QElapsedTimer checkpointTimer;
+		checkpointTimer.start();
 
 		QString statusText;
 		QString progressTxt;
@@ -135,37 +257,158 @@ bool cRenderer::RenderImage()
 		QElapsedTimer timerProgressRefresh;
 		timerProgressRefresh.start();
 
+		// coarse depth prepass and reusing of depth from progressive passes cannot be used when primary
+		// rays don't start from the camera or when effects are accumulated along the whole ray
+		bool skippingAllowed = !(params->DOFMonteCarlo && params->DOFEnabled)
+													 && !data->stereo.isEnabled() && !params->interiorMode
+													 && !cRenderWorker::VolumetricEffectsEnabled(params, data);
+		// primary rays are not traced when the image is relit or are traced by OpenCL device
+		if (data->relighting || data->openClEngine) skippingAllowed = false;
+
+		// depth reprojected from previous animation frame is prepared by cRenderJob
+		if (!skippingAllowed) data->temporalDepth = NULL;
+
+		// aux lights are sorted into grid cells, so only nearby lights are shaded
+		cLightGrid *lightGrid = NULL;
+		if (params->auxLightCulling && data->lights.IsAnyLightEnabled())
+		{
+			double maxSpecular = 0.0;
+			QList<int> keys = data->materials.keys();
+			for (int i = 0; i < keys.size(); i++)
+				maxSpecular = qMax(maxSpecular, data->materials[keys[i]].specular);
+			lightGrid = new cLightGrid(data->lights, maxSpecular);
+			data->lightGrid = lightGrid;
+			WriteLogDouble("Light grid cells", lightGrid->GetNumberOfCells(), 2);
+		}
+
+		cProgressiveDepth *progressiveDepth = NULL;
+		if (params->progressiveDepthReuse && progressiveSteps > 0 && skippingAllowed)
+		{
+			progressiveDepth = new cProgressiveDepth(image->GetWidth(), image->GetHeight());
+			data->progressiveDepth = progressiveDepth;
+		}
+
+		QElapsedTimer stageTimer;
+		stageTimer.start();
+
+		cDepthPrepass *depthPrepass = NULL;
+		if (params->depthPrepassEnabled && skippingAllowed)
+		{
+			WriteLog("Depth prepass", 2);
+			TRACE_SCOPE("depth prepass", "render");
+			depthPrepass = new cDepthPrepass(data->screenRegion, params->depthPrepassBlockSize);
+			depthPrepass->SetRendering(true);
+			data->depthPrepass = depthPrepass;
+			workerPool->StartAll();
+			while (workerPool->IsAnyRunning())
+			{
+				gApplication->processEvents();
+			};
+			depthPrepass->SetRendering(false);
+		}
+
+		// multi-ray ambient occlusion in reduced resolution. Samples don't follow eye positions
+		// of stereoscopic rendering
+		cAOBuffer *aoBuffer = NULL;
+		if (params->ambientOcclusionEnabled
+				&& params->ambientOcclusionMode == params::AOmodeMultipeRays
+				&& params->ambientOcclusionResolutionDivider > 1 && !data->stereo.isEnabled()
+				&& !data->openClEngine)
+		{
+			WriteLog("Ambient occlusion prepass", 2);
+			TRACE_SCOPE("ambient occlusion prepass", "render");
+			aoBuffer = new cAOBuffer(data->screenRegion, params->ambientOcclusionResolutionDivider);
+			aoBuffer->SetRendering(true);
+			data->aoBuffer = aoBuffer;
+			workerPool->StartAll();
+			while (workerPool->IsAnyRunning())
+			{
+				gApplication->processEvents();
+			};
+			aoBuffer->SetRendering(false);
+		}
+
+		data->statistics.prepassTime = stageTimer.nsecsElapsed() / 1e9;
+		stageTimer.restart();
+
+		// sparse pixels where they cover small solid angle or where foveation map is dark. OpenCL
+		// device renders all pixels of tiles
+		cAdaptiveSampling *adaptiveSampling = NULL;
+		if ((params->adaptiveSamplingEnabled || data->textures.foveationMap.IsLoaded())
+				&& !data->partialRender && !data->relighting && !data->openClEngine)
+		{
+			adaptiveSampling = new cAdaptiveSampling(params, data, image->GetWidth(), image->GetHeight());
+			WriteLogDouble("Adaptive sampling: rendered pixels [%]",
+				100.0 * adaptiveSampling->GetRenderedFraction(), 2);
+			data->adaptiveSampling = adaptiveSampling;
+		}
+
+		// tiles rendered by OpenCL device
+		cTileScheduler *openClScheduler = NULL;
+		sDeviceThroughput throughput;
+		bool tilesReleased = false;
+		if (data->openClEngine)
+		{
+			QString error;
+			if (data->openClEngine->SetScene(params, fractal, data, image, &error))
+			{
+				openClScheduler = static_cast<cTileScheduler *>(scheduler);
+				throughput.timer.start();
+			}
+			else
+			{
+				qWarning() << "OpenCL rendering failed, rendering by CPU:" << error;
+				DisableOpenCl();
+			}
+		}
+
 		WriteLog("Start rendering", 2);
 		do
 		{
 			WriteLogDouble("Progressive loop", scheduler->GetProgressiveStep(), 2);
-			for (int i = 0; i < data->configuration.GetNumberOfThreads(); i++)
-			{
-				WriteLog(QString("Thread ") + QString::number(i) + " create", 3);
-				thread[i] = new QThread;
-				worker[i] = new cRenderWorker(
-					params, fractal, &threadData[i], data, image); // Warning! not needed to delete object
-				worker[i]->moveToThread(thread[i]);
-				QObject::connect(thread[i], SIGNAL(started()), worker[i], SLOT(doWork()));
-				QObject::connect(worker[i], SIGNAL(finished()), thread[i], SLOT(quit()));
-				QObject::connect(worker[i], SIGNAL(finished()), worker[i], SLOT(deleteLater()));
-				thread[i]->setObjectName("RenderWorker #" + QString::number(i));
-				thread[i]->start();
-				thread[i]->setPriority(GetQThreadPriority(systemData.threadsPriority));
-				WriteLog(QString("Thread ") + QString::number(i) + " started", 3);
-			}
+			TRACE_SCOPE_ARG("progressive pass", "render", "step", scheduler->GetProgressiveStep());
+			image->progressiveFactor = scheduler->GetProgressiveStep();
+
+			workerPool->StartAll();
 
 			while (!scheduler->AllLinesDone())
 			{
 				gApplication->processEvents();
 
+				if (lineDecoder) scheduler->MarkReceivedLines(lineDecoder->TakeDecodedLines());
+
 				if (*data->stopRequest || progressText.getTime() > data->configuration.GetMaxRenderTime()
 						|| systemData.globalStopRequest)
 				{
 					scheduler->Stop();
 				}
 
-				Wait(10); // wait 10ms
+				// OpenCL device is fed by this thread between refreshes of the image
+				int deviceTiles = 0;
+				if (openClScheduler)
+				{
+					deviceTiles = RenderOpenClTiles(openClScheduler, &throughput);
+					if (deviceTiles < 0)
+					{
+						DisableOpenCl();
+						openClScheduler = NULL;
+						tilesReleased = true;
+					}
+				}
+				// threads which finished before tiles of the device were released are started again
+				if (tilesReleased && !workerPool->IsAnyRunning())
+				{
+					workerPool->StartAll();
+					tilesReleased = false;
+				}
+				if (deviceTiles <= 0) Wait(10); // wait 10ms
+
+				int checkpointInterval = qMax(1, data->configuration.GetCheckpointInterval());
+				if (checkpoint && checkpointTimer.elapsed() > 1000 * checkpointInterval)
+				{
+					SaveCheckpoint(checkpoint);
+					checkpointTimer.restart();
+				}
 
 				if (data->configuration.UseRefreshRenderedList())
 				{
@@ -185,7 +428,7 @@ bool cRenderer::RenderImage()
 				if (timerProgressRefresh.elapsed() > 1000)
 				{
 					emit updateProgressAndStatus(statusText, progressTxt, percentDone);
-					emit updateStatistics(data->statistics);
+					emit updateStatistics(CollectStatistics(workerPool));
 					timerProgressRefresh.restart();
 				}
 
@@ -198,7 +441,7 @@ bool cRenderer::RenderImage()
 						timerRefresh.restart();
 
 						emit updateProgressAndStatus(statusText, progressTxt, percentDone);
-						emit updateStatistics(data->statistics);
+						emit updateStatistics(CollectStatistics(workerPool));
 
 						QSet<int> set_listToRefresh = listToRefresh.toSet(); // removing duplicates
 						listToRefresh = set_listToRefresh.toList();
@@ -218,12 +461,11 @@ bool cRenderer::RenderImage()
 							}
 						}
 
-						image->ConvertTo8bit();
-
 						if (data->configuration.UseImageRefresh())
 						{
+							image->ConvertTo8bit(listToRefresh);
 							image->UpdatePreview(&listToRefresh);
-							image->GetImageWidget()->update();
+							image->GetImageWidget()->update(image->TakePreviewDirtyRegion());
 						}
 
 						// sending rendered lines to NetRender server
@@ -289,16 +531,63 @@ bool cRenderer::RenderImage()
 				}		// isPreview
 			}			// while scheduler
 
-			for (int i = 0; i < data->configuration.GetNumberOfThreads(); i++)
+			while (workerPool->IsAnyRunning())
 			{
-				while (thread[i]->isRunning())
-				{
-					gApplication->processEvents();
-				};
-				WriteLog(QString("Thread ") + QString::number(i) + " finished", 2);
-				delete thread[i];
+				gApplication->processEvents();
+			};
+			WriteLog("All render workers finished pass", 2);
+		} while (scheduler->GetProgressiveStep() > data->minProgressiveStep
+						 && scheduler->ProgressiveNextStep());
+
+		// optional buffers have only samples of blocks when rendering ended with a coarse pass. When
+		// the pass was interrupted, only the previous pass is complete
+		int lastStep = scheduler->GetProgressiveStep();
+		if (lastStep > 1)
+		{
+			if (*data->stopRequest && scheduler->GetProgressivePass() > 1) lastStep *= 2;
+			image->FillOptionalBlocks(data->screenRegion.x1, data->screenRegion.y1,
+				data->screenRegion.x2, data->screenRegion.y2, lastStep);
+		}
+		image->progressiveFactor = 1;
+
+		// checkpoint contains all rendered lines. It is removed by the caller after the image is saved
+		if (checkpoint)
+		{
+			SaveCheckpoint(checkpoint);
+			delete checkpoint;
+		}
+
+		if (openClScheduler && openClScheduler->GetNumberOfFinishedTiles() > 0)
+		{
+			WriteLogDouble("Tiles rendered by OpenCL device [%]",
+				100.0 * throughput.deviceTiles / openClScheduler->GetNumberOfFinishedTiles(), 2);
+		}
+
+		// lines of NetRender clients are changed by the server after they were received
+		bool linesChangedByServer = false;
+
+		// NetRender server interpolates also the lines rendered by clients
+		if (adaptiveSampling)
+		{
+			if (!(gNetRender->IsClient() && data->configuration.UseNetRender()) && !*data->stopRequest)
+			{
+				adaptiveSampling->Reconstruct(image);
+				linesChangedByServer = true;
 			}
-		} while (scheduler->ProgressiveNextStep());
+			data->adaptiveSampling = NULL;
+			delete adaptiveSampling;
+		}
+
+		// pixels of the other half of checkerboard pattern
+		if (data->checkerboard && !*data->stopRequest)
+		{
+			data->checkerboard->Reconstruct(image);
+			linesChangedByServer = true;
+		}
+
+		// measured cost of lines is used for scheduling of next frame
+		if (!scheduler->IsTileScheduler() && scheduler->IsCostMapMeasured())
+			data->lineCostMap = scheduler->GetCostMap();
 
 		// send last rendered lines
 		if (data->configuration.UseNetRender() && gNetRender->IsClient()
@@ -336,73 +625,124 @@ bool cRenderer::RenderImage()
 			if (gNetRender->IsServer())
 			{
 				emit StopAllClients();
+				StopLineDecoder();
 			}
 		}
-		// refresh image at end
-		WriteLog("image->CompileImage()", 2);
-		image->CompileImage();
 
-		if (!(gNetRender->IsClient() && data->configuration.UseNetRender()))
+		data->statistics.mainPassTime = stageTimer.nsecsElapsed() / 1e9;
+		stageTimer.restart();
+
+		// adaptive supersampling of pixels on edges. Monte Carlo DOF rays are already spread over
+		// pixels. NetRender clients don't have the whole image, so only server can do it
+		if (params->antialiasingEnabled && !(params->DOFMonteCarlo && params->DOFEnabled)
+				&& !(gNetRender->IsClient() && data->configuration.UseNetRender()) && !*data->stopRequest
+				&& !systemData.globalStopRequest)
 		{
-			bool ssaoUsed = false;
-			if (params->ambientOcclusionEnabled
-					&& params->ambientOcclusionMode == params::AOmodeScreenSpace)
+			cAntiAliasing *antiAliasing = new cAntiAliasing(data->screenRegion, params->antialiasingSize);
+			int edgePixels = antiAliasing->DetectEdges(image, params->antialiasingThreshold);
+			WriteLogDouble("Anti-aliasing of edge pixels", edgePixels, 2);
+			if (edgePixels > 0)
 			{
-				cRenderSSAO rendererSSAO(params, data, image);
-				connect(&rendererSSAO,
-					SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
-					SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
+				// start distances are not conservative for sub-pixel rays
+				cDepthPrepass *depthPrepassMain = data->depthPrepass;
+				cProgressiveDepth *progressiveDepthMain = data->progressiveDepth;
+				data->depthPrepass = NULL;
+				data->progressiveDepth = NULL;
+
+				statusText = QObject::tr("Anti-aliasing");
+				emit updateProgressAndStatus(statusText, progressTxt, data->lastPercentage);
 
-				if (data->stereo.isEnabled() && (data->stereo.GetMode() == cStereo::stereoLeftRight
-																					|| data->stereo.GetMode() == cStereo::stereoTopBottom))
+				antiAliasing->SetRendering(true);
+				data->antiAliasing = antiAliasing;
+				workerPool->StartAll();
+				while (workerPool->IsAnyRunning())
 				{
-					cRegion<int> region;
-					region = data->stereo.GetRegion(
-						CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeLeft);
-					rendererSSAO.SetRegion(region);
-					rendererSSAO.RenderSSAO();
-					region = data->stereo.GetRegion(
-						CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeRight);
-					rendererSSAO.SetRegion(region);
-					rendererSSAO.RenderSSAO();
-				}
-				else
+					gApplication->processEvents();
+				};
+				data->antiAliasing = NULL;
+
+				data->depthPrepass = depthPrepassMain;
+				data->progressiveDepth = progressiveDepthMain;
+				linesChangedByServer = true;
+			}
+			delete antiAliasing;
+		}
+
+		data->statistics.antiAliasingTime = stageTimer.nsecsElapsed() / 1e9;
+		stageTimer.restart();
+
+		// refresh image at end. After partial render only changed lines and halo of effects are
+		// compiled and post-processed again
+		QList<int> postProcessLines;
+		if (data->partialRender) PreparePostProcessLines(&postProcessLines);
+
+		// noise of Monte Carlo effects is filtered in float image before it's compiled
+		if (params->denoiserEnabled && !(gNetRender->IsClient() && data->configuration.UseNetRender())
+				&& !*data->stopRequest)
+		{
+			cPostRenderingDenoiser denoiser(image);
+			linesChangedByServer = true;
+			connect(&denoiser,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
+
+			if (data->stereo.isEnabled() && (data->stereo.GetMode() == cStereo::stereoLeftRight
+																				|| data->stereo.GetMode() == cStereo::stereoTopBottom))
+			{
+				CVector2<int> imageSize(image->GetWidth(), image->GetHeight());
+				denoiser.Render(data->stereo.GetRegion(imageSize, cStereo::eyeLeft),
+					params->denoiserStrength, params->denoiserIterations, data->stopRequest);
+				denoiser.Render(data->stereo.GetRegion(imageSize, cStereo::eyeRight),
+					params->denoiserStrength, params->denoiserIterations, data->stopRequest);
+			}
+			else
+			{
+				cRegion<int> denoiseRegion = data->screenRegion;
+				if (data->partialRender)
 				{
-					rendererSSAO.RenderSSAO();
+					denoiseRegion = cRegion<int>(
+						0, postProcessLines.first(), image->GetWidth(), postProcessLines.last() + 1);
 				}
-				ssaoUsed = true;
+				denoiser.Render(denoiseRegion, params->denoiserStrength, params->denoiserIterations,
+					data->stopRequest);
 			}
-			if (params->DOFEnabled && !*data->stopRequest && !params->DOFMonteCarlo)
+		}
+
+		WriteLog("image->CompileImage()", 2);
+		image->CompileImage(data->partialRender ? &postProcessLines : NULL);
+
+		// with deferred post-processing effects are done by the frame pipeline in parallel with
+		// rendering of the next frame
+		if (!(gNetRender->IsClient() && data->configuration.UseNetRender())
+				&& !data->deferredPostProcessing)
+		{
+			// bands of still image can be post-processed also by NetRender clients
+			bool distributed = false;
+			if (data->configuration.UseNetRender() && gNetRender->IsServer()
+					&& params->netRenderPostTiles && gNetRender->GetClientCount() > 0
+					&& cNetRenderPostTiles::IsNeeded(params) && !data->partialRender && !data->tiled
+					&& !data->stereo.isEnabled() && !*data->stopRequest)
 			{
-				cPostRenderingDOF dof(image);
-				connect(&dof, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
-					this, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
+				distributed = PostProcessDistributed(!linesChangedByServer);
+			}
 
-				if (data->stereo.isEnabled() && (data->stereo.GetMode() == cStereo::stereoLeftRight
-																					|| data->stereo.GetMode() == cStereo::stereoTopBottom))
-				{
-					cRegion<int> region;
-					region = data->stereo.GetRegion(
-						CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeLeft);
-					dof.Render(region, params->DOFRadius * (image->GetWidth() + image->GetHeight()) / 2000.0,
-						params->DOFFocus, !ssaoUsed && params->DOFHDRmode, params->DOFNumberOfPasses,
-						params->DOFBlurOpacity, data->stopRequest);
-					region = data->stereo.GetRegion(
-						CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeRight);
-					dof.Render(region, params->DOFRadius * (image->GetWidth() + image->GetHeight()) / 2000.0,
-						params->DOFFocus, !ssaoUsed && params->DOFHDRmode, params->DOFNumberOfPasses,
-						params->DOFBlurOpacity, data->stopRequest);
-				}
-				else
-				{
-					dof.Render(data->screenRegion,
-						params->DOFRadius * (image->GetWidth() + image->GetHeight()) / 2000.0, params->DOFFocus,
-						!ssaoUsed && params->DOFHDRmode, params->DOFNumberOfPasses, params->DOFBlurOpacity,
-						data->stopRequest);
-				}
+			if (!distributed)
+			{
+				PostProcessEffects(
+					params, data, image, data->partialRender ? &postProcessLines : NULL, this);
 			}
 		}
 
+		data->statistics.postProcessingTime = stageTimer.nsecsElapsed() / 1e9;
+
+		// timers and statistics of all threads are summed when no worker is running, so they don't
+		// need locks
+		for (int i = 0; i < workerPool->GetNumberOfThreads(); i++)
+		{
+			workerPool->GetThreadData(i)->stageTimer.AddTo(&data->statistics);
+			data->statistics.Add(workerPool->GetThreadData(i)->statistics);
+		}
+
 		if (image->IsPreview())
 		{
 			WriteLog("image->ConvertTo8bit()", 2);
@@ -434,9 +774,28 @@ bool cRenderer::RenderImage()
 			}
 		}
 
-		delete[] thread;
-		delete[] threadData;
-		delete[] worker;
+		if (localWorkerPool) delete localWorkerPool;
+
+		if (depthPrepass)
+		{
+			data->depthPrepass = NULL;
+			delete depthPrepass;
+		}
+		if (progressiveDepth)
+		{
+			data->progressiveDepth = NULL;
+			delete progressiveDepth;
+		}
+		if (aoBuffer)
+		{
+			data->aoBuffer = NULL;
+			delete aoBuffer;
+		}
+		if (lightGrid)
+		{
+			data->lightGrid = NULL;
+			delete lightGrid;
+		}
 
 		WriteLog("cRenderer::RenderImage(): memory released", 2);
 
@@ -452,62 +811,475 @@ bool cRenderer::RenderImage()
 	}
 }
 
-void cRenderer::CreateLineData(int y, QByteArray *lineData)
+// screen space ambient occlusion and depth of field. Progress is forwarded to given receiver
+// (can be NULL)
+void cRenderer::PostProcessEffects(const cParamRender *params, sRenderData *data, cImage *image,
+	QList<int> *postProcessLines, QObject *progressReceiver)
 {
-	if (y >= 0 && y < image->GetHeight())
+	bool ssaoUsed = false;
+	QElapsedTimer effectTimer;
+	effectTimer.start();
+	if (params->ambientOcclusionEnabled
+			&& params->ambientOcclusionMode == params::AOmodeScreenSpace)
 	{
-		int width = image->GetWidth();
-		sAllImageData *lineOfImage = new sAllImageData[width];
-		size_t dataSize = sizeof(sAllImageData) * width;
-		for (int x = 0; x < width; x++)
+		cRenderSSAO rendererSSAO(params, data, image);
+		if (progressReceiver)
 		{
-			lineOfImage[x].imageFloat = image->GetPixelImage(x, y);
-			lineOfImage[x].alphaBuffer = image->GetPixelAlpha(x, y);
-			lineOfImage[x].colourBuffer = image->GetPixelColor(x, y);
-			lineOfImage[x].zBuffer = image->GetPixelZBuffer(x, y);
-			lineOfImage[x].opacityBuffer = image->GetPixelOpacity(x, y);
-			if (image->GetImageOptional()->optionalNormal)
-				lineOfImage[x].normalFloat = image->GetPixelNormal(x, y);
+			connect(&rendererSSAO,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
+				progressReceiver,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
 		}
-		lineData->append((char *)lineOfImage, dataSize);
-		delete[] lineOfImage;
+
+		if (data->stereo.isEnabled() && (data->stereo.GetMode() == cStereo::stereoLeftRight
+																			|| data->stereo.GetMode() == cStereo::stereoTopBottom))
+		{
+			cRegion<int> region;
+			region = data->stereo.GetRegion(
+				CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeLeft);
+			rendererSSAO.SetRegion(region);
+			rendererSSAO.RenderSSAO();
+			region = data->stereo.GetRegion(
+				CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeRight);
+			rendererSSAO.SetRegion(region);
+			rendererSSAO.RenderSSAO();
+		}
+		else if (data->partialRender)
+		{
+			rendererSSAO.SetRegion(cRegion<int>(0, 0, image->GetWidth(), image->GetHeight()));
+			rendererSSAO.RenderSSAO(postProcessLines);
+		}
+		else
+		{
+			rendererSSAO.RenderSSAO();
+		}
+		ssaoUsed = true;
 	}
-	else
+	data->statistics.ssaoTime = effectTimer.nsecsElapsed() / 1e9;
+	effectTimer.restart();
+
+	if (params->DOFEnabled && !*data->stopRequest && !params->DOFMonteCarlo)
 	{
-		qCritical() << "cRenderer::CreateLineData(int y, QByteArray *lineData): wrong line:" << y;
+		// blur radius is relative to the whole image also when tile is rendered
+		double dofRadius =
+			params->DOFRadius * (data->fullImageSize.x + data->fullImageSize.y) / 2000.0;
+		cPostRenderingDOF dof(image);
+		dof.SetArena(data->arena);
+		if (progressReceiver)
+		{
+			connect(&dof, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
+				progressReceiver,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
+		}
+
+		if (data->stereo.isEnabled() && (data->stereo.GetMode() == cStereo::stereoLeftRight
+																			|| data->stereo.GetMode() == cStereo::stereoTopBottom))
+		{
+			cRegion<int> region;
+			region = data->stereo.GetRegion(
+				CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeLeft);
+			if (params->DOFFastGather)
+				dof.RenderGather(region, dofRadius, params->DOFFocus, !ssaoUsed && params->DOFHDRmode,
+					data->stopRequest);
+			else
+				dof.Render(region, dofRadius, params->DOFFocus, !ssaoUsed && params->DOFHDRmode,
+					params->DOFNumberOfPasses, params->DOFBlurOpacity, data->stopRequest);
+			region = data->stereo.GetRegion(
+				CVector2<int>(image->GetWidth(), image->GetHeight()), cStereo::eyeRight);
+			if (params->DOFFastGather)
+				dof.RenderGather(region, dofRadius, params->DOFFocus, !ssaoUsed && params->DOFHDRmode,
+					data->stopRequest);
+			else
+				dof.Render(region, dofRadius, params->DOFFocus, !ssaoUsed && params->DOFHDRmode,
+					params->DOFNumberOfPasses, params->DOFBlurOpacity, data->stopRequest);
+		}
+		else
+		{
+			cRegion<int> dofRegion = data->screenRegion;
+			// HDR version blurs float image in place, so only freshly rendered pixels can be blurred
+			if (data->partialRender && (ssaoUsed || !params->DOFHDRmode))
+			{
+				dofRegion = cRegion<int>(
+					0, postProcessLines->first(), image->GetWidth(), postProcessLines->last() + 1);
+			}
+
+			if (params->DOFFastGather)
+				dof.RenderGather(dofRegion, dofRadius, params->DOFFocus,
+					!ssaoUsed && params->DOFHDRmode, data->stopRequest);
+			else
+				dof.Render(dofRegion, dofRadius, params->DOFFocus, !ssaoUsed && params->DOFHDRmode,
+					params->DOFNumberOfPasses, params->DOFBlurOpacity, data->stopRequest);
+		}
 	}
+	data->statistics.dofTime = effectTimer.nsecsElapsed() / 1e9;
 }
 
-void cRenderer::NewLinesArrived(QList<int> lineNumbers, QList<QByteArray> lines)
+// effects of image rendered with deferred post-processing. The image has to be already compiled
+void cRenderer::PostProcessImage(const cParameterContainer *par, cImage *image, bool *stopRequest)
 {
-	for (int i = 0; i < lineNumbers.size(); i++)
+	cParamRender params(par);
+	sRenderData data;
+	data.screenRegion = cRegion<int>(0, 0, image->GetWidth(), image->GetHeight());
+	data.fullImageSize = CVector2<int>(image->GetWidth(), image->GetHeight());
+	data.stopRequest = stopRequest;
+	PostProcessEffects(&params, &data, image, NULL, NULL);
+}
+
+bool cRenderer::PostProcessDistributed(bool clientLinesValid)
+{
+	int width = image->GetWidth();
+	int height = image->GetHeight();
+	int halo = cNetRenderPostTiles::TileHalo(params, image, width, height);
+	QList<sPostTileJob> tiles =
+		cNetRenderPostTiles::CreateTiles(height, halo, gNetRender->GetClientCount() + 1);
+	if (tiles.size() < 2) return false;
+
+	WriteLog(QString("NetRender - post-processing in %1 bands, halo %2").arg(tiles.size()).arg(halo),
+		2);
+
+	enum enumTileState
+	{
+		tileWaiting,
+		tileRemote,
+		tileDone
+	};
+	QVector<enumTileState> states(tiles.size(), tileWaiting);
+	QVector<QByteArray> results(tiles.size());
+	int numberOfDone = 0;
+
+	receivedPostTiles.clear();
+	connect(gNetRender, SIGNAL(PostTileReceived(int, QByteArray)), this,
+		SLOT(PostTileReceived(int, QByteArray)));
+
+	QString statusText = QObject::tr("Post-processing with NetRender");
+	cProgressText progressText;
+	progressText.ResetTimer();
+
+	while (numberOfDone < tiles.size() && !*data->stopRequest)
 	{
-		int y = lineNumbers.at(i);
-		if (y >= 0 && y < image->GetHeight())
+		gApplication->processEvents();
+
+		// bands of clients. Empty result means that the band has to be processed by someone else
+		QHash<int, QByteArray>::const_iterator it;
+		for (it = receivedPostTiles.constBegin(); it != receivedPostTiles.constEnd(); ++it)
 		{
-			sAllImageData *lineOfImage = (sAllImageData *)lines.at(i).data();
-			int width = image->GetWidth();
-			for (int x = 0; x < width; x++)
+			int index = it.key();
+			if (index < 0 || index >= tiles.size() || states[index] != tileRemote) continue;
+			if (it.value().isEmpty())
+			{
+				states[index] = tileWaiting;
+			}
+			else
+			{
+				results[index] = it.value();
+				states[index] = tileDone;
+				numberOfDone++;
+			}
+		}
+		receivedPostTiles.clear();
+
+		// bands of disconnected clients
+		for (int i = 0; i < tiles.size(); i++)
+		{
+			if (states[i] == tileRemote && !gNetRender->IsPostTileAssigned(i)) states[i] = tileWaiting;
+		}
+
+		// clients take bands from the end of the image, the server from the beginning
+		for (int c = 0; c < gNetRender->GetClientCount(); c++)
+		{
+			if (!gNetRender->IsClientReadyForPostTile(c)) continue;
+			int index = states.lastIndexOf(tileWaiting);
+			if (index < 0) break;
+
+			// client already has lines which it rendered
+			const sPostTileJob &tile = tiles.at(index);
+			const QSet<int> &clientLines = gNetRender->GetClientReceivedLines(c);
+			QList<int> lineNumbers;
+			QList<QByteArray> lines;
+			for (int y = tile.haloY1; y < tile.haloY2; y++)
 			{
-				image->PutPixelImage(x, y, lineOfImage[x].imageFloat);
-				image->PutPixelAlpha(x, y, lineOfImage[x].alphaBuffer);
-				image->PutPixelColour(x, y, lineOfImage[x].colourBuffer);
-				image->PutPixelZBuffer(x, y, lineOfImage[x].zBuffer);
-				image->PutPixelOpacity(x, y, lineOfImage[x].opacityBuffer);
-				if (image->GetImageOptional()->optionalNormal)
-					image->PutPixelNormal(x, y, lineOfImage[x].normalFloat);
+				if (clientLinesValid && clientLines.contains(y)) continue;
+				QByteArray lineData;
+				CreateLineData(y, &lineData);
+				lineNumbers.append(y);
+				lines.append(lineData);
+			}
+			gNetRender->SendPostTile(c, tile, lineNumbers, lines);
+			states[index] = tileRemote;
+		}
+
+		int index = states.indexOf(tileWaiting);
+		if (index >= 0)
+		{
+			cImage *tileImage = cNetRenderPostTiles::CreateTileImage(image, tiles.at(index));
+			results[index] = cNetRenderPostTiles::RenderTile(
+				params, tileImage, tiles.at(index), width, height, data->stopRequest);
+			delete tileImage;
+			if (!results[index].isEmpty())
+			{
+				states[index] = tileDone;
+				numberOfDone++;
 			}
 		}
 		else
 		{
-			qCritical() << "cRenderer::NewLinesArrived(QList<int> lineNumbers, QList<QByteArray> lines): "
-										 "wrong line number:"
-									<< y;
-			return;
+			Wait(10);
+		}
+
+		double percentDone = (double)numberOfDone / tiles.size();
+		emit updateProgressAndStatus(statusText, progressText.getText(percentDone), percentDone);
+	}
+
+	disconnect(gNetRender, SIGNAL(PostTileReceived(int, QByteArray)), this,
+		SLOT(PostTileReceived(int, QByteArray)));
+	gNetRender->StopPostTiles();
+
+	// every band was processed from unmodified image, so they are put to the image at the end
+	for (int i = 0; i < tiles.size(); i++)
+	{
+		if (states[i] == tileDone && !cNetRenderPostTiles::ApplyTile(image, tiles.at(i), results[i]))
+			qCritical() << "NetRender - corrupted post-processed band" << i;
+	}
+	return true;
+}
+
+void cRenderer::PostTileReceived(int tileIndex, QByteArray data)
+{
+	receivedPostTiles.insert(tileIndex, data);
+}
+
+void cRenderer::DisableOpenCl()
+{
+	data->openClEngine = NULL;
+	data->statistics.usedShaderVariant =
+		cRenderWorker::GetShaderVariantName(cRenderWorker::SelectShaderVariant(params, data));
+}
+
+int cRenderer::RenderOpenClTiles(cTileScheduler *tileScheduler, sDeviceThroughput *throughput)
+{
+	int queuedTiles = tileScheduler->GetNumberOfQueuedTiles();
+	if (queuedTiles == 0) return 0;
+
+	int tileSize = tileScheduler->GetTileSize();
+	int maxTiles = cOpenClEngine::GetInitialPixelsPerJob() / (tileSize * tileSize);
+	if (throughput->deviceTiles > 0 && throughput->deviceTime > 0.0)
+	{
+		double deviceSpeed = throughput->deviceTiles / throughput->deviceTime;
+		maxTiles = deviceSpeed * OPENCL_JOB_TIME;
+
+		// device takes part of remaining tiles proportional to its speed, so the device and CPU
+		// threads finish at the same time
+		int cpuTiles = tileScheduler->GetNumberOfFinishedTiles() - throughput->deviceTiles;
+		double cpuTime = throughput->timer.nsecsElapsed() / 1e9;
+		if (cpuTiles > 0 && cpuTime > 0.0)
+		{
+			double cpuSpeed = cpuTiles / cpuTime;
+			int share = ceil(queuedTiles * deviceSpeed / (deviceSpeed + cpuSpeed));
+			maxTiles = min(maxTiles, share);
+		}
+	}
+	maxTiles = max(maxTiles, 1);
+
+	QList<int> tileIndexes;
+	if (tileScheduler->StealTiles(maxTiles, &tileIndexes) == 0) return 0;
+	TRACE_SCOPE_ARG("OpenCL tiles", "render", "tiles", tileIndexes.size());
+
+	// tiles can exceed screen region
+	QList<cRegion<int> > tiles;
+	int pixels = 0;
+	for (int i = 0; i < tileIndexes.size(); i++)
+	{
+		cRegion<int> tile = tileScheduler->GetTileRegion(tileIndexes.at(i));
+		tile.Set(max(tile.x1, data->screenRegion.x1), max(tile.y1, data->screenRegion.y1),
+			min(tile.x2, data->screenRegion.x2), min(tile.y2, data->screenRegion.y2));
+		tiles.append(tile);
+		pixels += tile.width * tile.height;
+	}
+
+	QElapsedTimer jobTimer;
+	jobTimer.start();
+	QString error;
+	if (!data->openClEngine->Render(tiles, tileSize, image, &error))
+	{
+		qWarning() << "OpenCL rendering failed, rendering by CPU:" << error;
+		tileScheduler->ReleaseTiles(tileIndexes);
+		return -1;
+	}
+	throughput->deviceTime += jobTimer.nsecsElapsed() / 1e9;
+	throughput->deviceTiles += tileIndexes.size();
+	data->statistics.numberOfRenderedPixels += pixels;
+
+	for (int i = 0; i < tileIndexes.size(); i++)
+		tileScheduler->TileDone(tileIndexes.at(i));
+	return tileIndexes.size();
+}
+
+template <typename T>
+static inline void WriteLineValue(char **cursor, T value)
+{
+	memcpy(*cursor, &value, sizeof(T));
+	*cursor += sizeof(T);
+}
+
+static void WriteLineRGB(char **cursor, const sRGBfloat &pixel, bool halfFloat)
+{
+	if (halfFloat)
+	{
+		WriteLineValue(cursor, FloatToHalf(pixel.R));
+		WriteLineValue(cursor, FloatToHalf(pixel.G));
+		WriteLineValue(cursor, FloatToHalf(pixel.B));
+	}
+	else
+	{
+		WriteLineValue(cursor, pixel.R);
+		WriteLineValue(cursor, pixel.G);
+		WriteLineValue(cursor, pixel.B);
+	}
+}
+
+void cRenderer::PreparePostProcessLines(QList<int> *lines) const
+{
+	int halo = 0;
+	if (params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeScreenSpace)
+	{
+		// SSAO samples reach half of image width
+		halo = image->GetWidth() / 2 + 1;
+	}
+	if (params->DOFEnabled && !params->DOFMonteCarlo)
+	{
+		double dofRadius =
+			params->DOFRadius * (data->fullImageSize.x + data->fullImageSize.y) / 2000.0;
+		cRegion<int> wholeImage(0, 0, image->GetWidth(), image->GetHeight());
+		halo = max(halo,
+			cPostRenderingDOF::GetMaxBlurRadius(image, wholeImage, dofRadius, params->DOFFocus) + 1);
+	}
+
+	int firstLine = max(data->screenRegion.y1 - halo, 0);
+	int lastLine = min(data->screenRegion.y2 + halo, image->GetHeight());
+	for (int y = firstLine; y < lastLine; y++)
+		lines->append(y);
+}
+
+cStatistics cRenderer::CollectStatistics(cRenderWorkerPool *workerPool) const
+{
+	// counters of running threads are read without locks. They can be slightly out of date
+	cStatistics statistics = data->statistics;
+	for (int i = 0; i < workerPool->GetNumberOfThreads(); i++)
+		statistics.Add(workerPool->GetThreadData(i)->statistics);
+	return statistics;
+}
+
+void cRenderer::CreateLineData(int y, QByteArray *lineData, bool lossless)
+{
+	if (y >= 0 && y < image->GetHeight())
+	{
+		int width = image->GetWidth();
+
+		// colour and opacity buffers are used only by SSAO of the server
+		bool ssao = params->ambientOcclusionEnabled
+								&& params->ambientOcclusionMode == params::AOmodeScreenSpace;
+		bool halfFloat =
+			params->netRenderLineFormat == params::netRenderLineCompactHalf && !lossless;
+
+		int flags = 0;
+		if (params->netRenderLineFormat == params::netRenderLineFull || ssao || lossless)
+			flags |= lineDataColour | lineDataOpacity;
+		if (image->GetImageOptional()->optionalNormal) flags |= lineDataNormal;
+		if (halfFloat) flags |= lineDataHalfFloat;
+		if (params->netRenderLineCompression || lossless) flags |= lineDataCompressed;
+
+		lineData->append(char(flags));
+
+		// pixels are written directly to the line data or to buffer for compression
+		QByteArray uncompressed;
+		QByteArray *payload = (flags & lineDataCompressed) ? &uncompressed : lineData;
+		int offset = payload->size();
+		payload->resize(offset + cNetRenderLineDecoder::LinePixelSize(flags) * width);
+		char *cursor = payload->data() + offset;
+
+		// channels are stored one after another, so they are better compressible
+		for (int x = 0; x < width; x++)
+			WriteLineRGB(&cursor, image->GetPixelImage(x, y), halfFloat);
+		for (int x = 0; x < width; x++)
+			WriteLineValue(&cursor, image->GetPixelAlpha(x, y));
+		for (int x = 0; x < width; x++)
+			WriteLineValue(&cursor, image->GetPixelZBuffer(x, y));
+		if (flags & lineDataColour)
+		{
+			for (int x = 0; x < width; x++)
+				WriteLineValue(&cursor, image->GetPixelColor(x, y));
+		}
+		if (flags & lineDataOpacity)
+		{
+			for (int x = 0; x < width; x++)
+				WriteLineValue(&cursor, image->GetPixelOpacity(x, y));
 		}
+		if (flags & lineDataNormal)
+		{
+			for (int x = 0; x < width; x++)
+				WriteLineRGB(&cursor, image->GetPixelNormal(x, y), halfFloat);
+		}
+
+		if (flags & lineDataCompressed) lineData->append(qCompress(uncompressed, 1));
 	}
+	else
+	{
+		qCritical() << "cRenderer::CreateLineData(int y, QByteArray *lineData): wrong line:" << y;
+	}
+}
 
-	scheduler->MarkReceivedLines(lineNumbers);
+void cRenderer::SaveCheckpoint(cRenderCheckpoint *checkpoint)
+{
+	QList<int> completedLines = scheduler->GetCompletedLines();
+	QList<int> lineNumbers;
+	QList<QByteArray> lines;
+	for (int i = 0; i < completedLines.size(); i++)
+	{
+		int y = completedLines.at(i);
+		if (checkpoint->IsLineSaved(y)) continue;
+		QByteArray lineData;
+		CreateLineData(y, &lineData, true);
+		lineNumbers.append(y);
+		lines.append(lineData);
+	}
+	if (!lineNumbers.isEmpty())
+	{
+		TRACE_SCOPE("checkpoint", "render");
+		checkpoint->Append(lineNumbers, lines);
+		WriteLogDouble("Checkpoint: saved lines", checkpoint->GetNumberOfSavedLines(), 2);
+	}
+}
+
+void cRenderer::StartLineDecoder()
+{
+	StopLineDecoder();
+
+	lineDecoderThread = new QThread;
+	lineDecoder = new cNetRenderLineDecoder(image);
+	lineDecoder->moveToThread(lineDecoderThread);
+	QObject::connect(this, SIGNAL(decodeLines(QList<int>, QList<QByteArray>)), lineDecoder,
+		SLOT(slotDecodeLines(QList<int>, QList<QByteArray>)));
+	lineDecoderThread->setObjectName("NetRenderDecoder");
+	lineDecoderThread->start();
+}
+
+void cRenderer::StopLineDecoder()
+{
+	if (lineDecoderThread)
+	{
+		lineDecoderThread->quit();
+		lineDecoderThread->wait();
+		delete lineDecoder;
+		delete lineDecoderThread;
+		lineDecoder = NULL;
+		lineDecoderThread = NULL;
+	}
+}
+
+void cRenderer::NewLinesArrived(QList<int> lineNumbers, QList<QByteArray> lines)
+{
+	// lines are decoded in separate thread and marked as done in the scheduler later
+	if (lineDecoder) emit decodeLines(lineNumbers, lines);
 }
 
 void cRenderer::ToDoListArrived(QList<int> toDo)
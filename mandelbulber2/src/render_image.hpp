@@ -35,15 +35,24 @@
 #ifndef MANDELBULBER2_SRC_RENDER_IMAGE_HPP_
 #define MANDELBULBER2_SRC_RENDER_IMAGE_HPP_
 
+#include <QByteArray>
+#include <QHash>
 #include <QObject>
 #include "statistics.h"
 
 // forward declarations
 class cNineFractals;
 class cParamRender;
+class cParameterContainer;
 struct sRenderData;
 class cImage;
 class cScheduler;
+class cNetRenderLineDecoder;
+class cTileScheduler;
+struct sDeviceThroughput;
+class cRenderWorkerPool;
+class cRenderCheckpoint;
+class QThread;
 
 class cRenderer : public QObject
 {
@@ -54,20 +63,48 @@ public:
 	~cRenderer();
 	bool RenderImage();
 
+	// screen space ambient occlusion and depth of field of compiled image
+	static void PostProcessEffects(const cParamRender *params, sRenderData *data, cImage *image,
+		QList<int> *postProcessLines, QObject *progressReceiver);
+	// effects of frame rendered with deferred post-processing (called by frame pipeline)
+	static void PostProcessImage(const cParameterContainer *par, cImage *image, bool *stopRequest);
+
 private:
-	void CreateLineData(int y, QByteArray *lineData);
+	// lossless lines contain all buffers in full precision (for checkpoints)
+	void CreateLineData(int y, QByteArray *lineData, bool lossless = false);
+	// lines completed since last checkpoint are appended to the file
+	void SaveCheckpoint(cRenderCheckpoint *checkpoint);
+	// one batch of tiles rendered by OpenCL device. Returns number of rendered tiles or -1 after
+	// error of the device (tiles are released for CPU threads)
+	int RenderOpenClTiles(cTileScheduler *tileScheduler, sDeviceThroughput *throughput);
+	// the rest of the image is rendered by CPU
+	void DisableOpenCl();
+	// lines received by NetRender server are decoded in separate thread
+	void StartLineDecoder();
+	void StopLineDecoder();
+	// lines which have to be post-processed again after partial render (changed lines + halo)
+	void PreparePostProcessLines(QList<int> *lines) const;
+	// statistics of finished passes and recent statistics of all rendering threads
+	cStatistics CollectStatistics(cRenderWorkerPool *workerPool) const;
+	// SSAO and DOF calculated in bands by NetRender server and clients. Lines received from clients
+	// are not sent back if clientLinesValid is true. Returns false if bands can't be distributed
+	bool PostProcessDistributed(bool clientLinesValid);
 
 	const cParamRender *params;
 	const cNineFractals *fractal;
 	sRenderData *data;
 	cImage *image;
 	cScheduler *scheduler;
+	cNetRenderLineDecoder *lineDecoder;
+	QThread *lineDecoderThread;
 	bool netRenderAckReceived;
+	QHash<int, QByteArray> receivedPostTiles; // bands post-processed by NetRender clients
 
 public slots:
 	void NewLinesArrived(QList<int> lineNumbers, QList<QByteArray> lines);
 	void ToDoListArrived(QList<int> done);
 	void AckReceived();
+	void PostTileReceived(int tileIndex, QByteArray data);
 
 signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
@@ -76,6 +113,7 @@ signals:
 	void SendToDoList(int clientIndex, QList<int> done);
 	void StopAllClients();
 	void NotifyClientStatus();
+	void decodeLines(QList<int> lineNumbers, QList<QByteArray> lines);
 };
 
 #endif /* MANDELBULBER2_SRC_RENDER_IMAGE_HPP_ */
@@ -34,18 +34,35 @@
 
 #include "render_job.hpp"
 
+#include <QElapsedTimer>
 #include <QWidget>
 #include "ao_modes.h"
+#include "checkerboard_render.hpp"
 #include "cimage.hpp"
+#include "compute_fractal.hpp"
+#include "cube_lut.hpp"
+#include "distance_cache.hpp"
 #include "fractparams.hpp"
+#include "frame_time_controller.hpp"
 #include "image_scale.hpp"
+#include "job_arena.hpp"
+#include "memory_estimator.hpp"
 #include "netrender.hpp"
+#include "numa_topology.hpp"
 #include "nine_fractals.hpp"
+#include "opencl_engine.hpp"
 #include "render_data.hpp"
 #include "render_image.hpp"
+#include "render_worker.hpp"
+#include "render_worker_pool.hpp"
 #include "rendering_configuration.hpp"
+#include "scheduler.hpp"
+#include "shadow_cache.hpp"
 #include "stereo.h"
 #include "system.hpp"
+#include "temporal_depth.hpp"
+#include "thread_tuning.hpp"
+#include "trace.hpp"
 
 cRenderJob::cRenderJob(const cParameterContainer *_params, const cFractalContainer *_fractal,
 	cImage *_image, bool *_stopRequest, QWidget *_qwidget)
@@ -60,9 +77,16 @@ cRenderJob::cRenderJob(const cParameterContainer *_params, const cFractalContain
 	fractalContainer = new cFractalContainer;
 	*fractalContainer = *_fractal;
 	canUseNetRender = false;
+	nextNetRenderParams = NULL;
+	nextNetRenderFractal = NULL;
+	cachedParams = NULL;
+	cachedFractals = NULL;
 
 	width = 0;
 	height = 0;
+	tiled = false;
+	partialRender = false;
+	relighting = false;
 	mode = still;
 	ready = false;
 	inProgress = false;
@@ -82,8 +106,22 @@ cRenderJob::cRenderJob(const cParameterContainer *_params, const cFractalContain
 	systemData.numberOfThreads = paramsContainer->Get<int>("limit_CPU_cores");
 	systemData.threadsPriority =
 		(enumRenderingThreadPriority)paramsContainer->Get<int>("threads_priority");
+	systemData.threadsAffinity = paramsContainer->Get<bool>("threads_affinity");
 	totalNumberOfCPUs = systemData.numberOfThreads;
 	renderData = NULL;
+	workerPool = NULL;
+	externalWorkerPool = false;
+	temporalDepth = NULL;
+	interactiveDepth = NULL;
+	checkerboardEnabled = false;
+	deferredPostProcessing = false;
+	checkerboard = NULL;
+	frameTimeController = NULL;
+	shadowCache = NULL;
+	aoCache = NULL;
+	backgroundLUT = NULL;
+	envMapLUT = NULL;
+	arena = new cJobArena;
 	useSizeFromImage = false;
 	stopRequest = _stopRequest;
 
@@ -100,8 +138,25 @@ cRenderJob::~cRenderJob()
 	delete paramsContainer;
 	delete fractalContainer;
 	if (renderData) delete renderData;
-
-	if (canUseNetRender) gNetRender->Release();
+	if (workerPool && !externalWorkerPool) delete workerPool;
+	if (temporalDepth) delete temporalDepth;
+	if (checkerboard) delete checkerboard;
+	if (shadowCache) delete shadowCache;
+	if (aoCache) delete aoCache;
+	if (backgroundLUT) delete backgroundLUT;
+	if (envMapLUT) delete envMapLUT;
+	delete arena;
+	if (nextNetRenderParams) delete nextNetRenderParams;
+	if (nextNetRenderFractal) delete nextNetRenderFractal;
+	if (cachedParams) delete cachedParams;
+	if (cachedFractals) delete cachedFractals;
+
+	if (canUseNetRender)
+	{
+		// clients don't need to start the next frame if animation was interrupted
+		if (gNetRender->IsServer()) gNetRender->CancelNextJob();
+		gNetRender->Release();
+	}
 
 	WriteLog("Job finished and closed", 2);
 }
@@ -109,6 +164,7 @@ cRenderJob::~cRenderJob()
 bool cRenderJob::Init(enumMode _mode, const cRenderingConfiguration &config)
 {
 	WriteLog("cRenderJob::Init id = " + QString::number(id), 2);
+	TRACE_SCOPE("cRenderJob::Init", "job");
 
 	mode = _mode;
 
@@ -137,8 +193,69 @@ bool cRenderJob::Init(enumMode _mode, const cRenderingConfiguration &config)
 		paramsContainer->Set("image_height", height);
 	}
 
-	sImageOptional imageOptional;
-	imageOptional.optionalNormal = paramsContainer->Get<bool>("normal_enabled");
+	// parameters keep size of the whole image, but only the tile is allocated
+	fullImageSize = CVector2<int>(width, height);
+	if (tiled)
+	{
+		width = tileRegion.width;
+		height = tileRegion.height;
+	}
+
+	sImageOptional imageOptional = cMemoryEstimator::ImageOptionalFromParams(paramsContainer);
+	// memory pages of image are placed on NUMA nodes of threads which render them
+	imageOptional.firstTouch =
+		systemData.threadsAffinity && cNumaTopology::Instance()->GetNumberOfNodes() > 1;
+
+	// image buffers are made more compact if the job doesn't fit in the memory budget
+	if (paramsContainer->Get<bool>("memory_admission_control"))
+	{
+		qint64 budget = cMemoryEstimator::GetMemoryBudget(paramsContainer);
+		// buffers of the current image are freed before the new allocation
+		if (budget >= 0 && paramsContainer->Get<int>("memory_budget_MB") == 0 && image->IsAllocated())
+			budget += qint64(image->GetUsedMB()) * 1024 * 1024;
+
+		sImageOptional requestedOptional = imageOptional;
+		if (!cMemoryEstimator::FitToBudget(paramsContainer, width, height, budget, &imageOptional))
+		{
+			WriteLog(QString("cRenderJob::Init(): job needs more memory than budget of %1 MB")
+								 .arg(budget / 1024 / 1024),
+				1);
+		}
+		if (!(imageOptional == requestedOptional))
+		{
+			WriteLog(QString("cRenderJob::Init(): image buffers reduced to fit budget: lean %1, "
+											 "half float %2, memory mapped %3")
+								 .arg(imageOptional.leanMemory)
+								 .arg(imageOptional.halfFloat)
+								 .arg(imageOptional.memoryMapped),
+				1);
+		}
+	}
+
+	// partial render needs the same image buffers. NetRender and stereo work on the whole image
+	if (partialRender)
+	{
+		if (dirtyRegion.width <= 0 || dirtyRegion.height <= 0 || tiled || stereo.isEnabled()
+				|| (config.UseNetRender() && canUseNetRender) || !image->IsAllocated()
+				|| image->GetWidth() != width || image->GetHeight() != height
+				|| !(imageOptional == *image->GetImageOptional()))
+		{
+			WriteLog("cRenderJob::Init(): partial render not possible, rendering whole image", 2);
+			partialRender = false;
+		}
+	}
+
+	// relighting needs G-buffer of already rendered image
+	if (relighting)
+	{
+		if (tiled || stereo.isEnabled() || (config.UseNetRender() && canUseNetRender)
+				|| !image->IsAllocated() || image->GetWidth() != width || image->GetHeight() != height
+				|| !imageOptional.optionalGBuffer || !(imageOptional == *image->GetImageOptional()))
+		{
+			WriteLog("cRenderJob::Init(): relighting not possible, rendering whole image", 2);
+			relighting = false;
+		}
+	}
 
 	emit updateProgressAndStatus(
 		QObject::tr("Initialization"), QObject::tr("Setting up image buffers"), 0.0);
@@ -220,11 +337,25 @@ bool cRenderJob::InitImage(int w, int h, const sImageOptional &optional)
 	}
 }
 
+void cRenderJob::SetTile(const cRegion<int> &_tileRegion)
+{
+	tiled = true;
+	tileRegion = _tileRegion;
+}
+
+void cRenderJob::SetDirtyRegion(const cRegion<int> &_dirtyRegion)
+{
+	partialRender = true;
+	dirtyRegion = _dirtyRegion;
+}
+
 void cRenderJob::PrepareData(const cRenderingConfiguration &config)
 {
 	WriteLog("Init renderData", 2);
+	TRACE_SCOPE("cRenderJob::PrepareData", "job");
 	renderData->rendererID = id;
 	renderData->configuration = config;
+	renderData->arena = arena;
 
 	if (!canUseNetRender) renderData->configuration.DisableNetRender();
 
@@ -240,6 +371,27 @@ void cRenderJob::PrepareData(const cRenderingConfiguration &config)
 
 	// renderData->screenRegion.Set(width*0.15, height*0.15, width*0.85, height*0.85);
 	renderData->screenRegion.Set(0, 0, width, height);
+	renderData->partialRender = partialRender;
+	if (partialRender)
+	{
+		renderData->screenRegion.Set(max(dirtyRegion.x1, 0), max(dirtyRegion.y1, 0),
+			min(dirtyRegion.x2, width), min(dirtyRegion.y2, height));
+	}
+
+	renderData->tiled = tiled;
+	renderData->fullImageSize = fullImageSize;
+	renderData->tileOffset = CVector2<int>(0, 0);
+	if (tiled)
+	{
+		// image region of the tile is the part of image region of the whole image
+		cRegion<int> fullScreen(0, 0, fullImageSize.x, fullImageSize.y);
+		CVector2<double> corner1 = fullScreen.transpose(
+			renderData->imageRegion, CVector2<int>(tileRegion.x1, tileRegion.y1));
+		CVector2<double> corner2 = fullScreen.transpose(
+			renderData->imageRegion, CVector2<int>(tileRegion.x2, tileRegion.y2));
+		renderData->imageRegion.Set(corner1.x, corner1.y, corner2.x, corner2.y);
+		renderData->tileOffset = CVector2<int>(tileRegion.x1, tileRegion.y1);
+	}
 	// TODO to correct resolution and aspect ratio according to region data
 
 	// textures are deleted with destruction of renderData
@@ -247,7 +399,14 @@ void cRenderJob::PrepareData(const cRenderingConfiguration &config)
 	emit updateProgressAndStatus(QObject::tr("Initialization"), QObject::tr("Loading textures"), 0.0);
 	// gApplication->processEvents();
 
-	if (gNetRender->IsClient() && renderData->configuration.UseNetRender())
+	// textures of materials which are not assigned to any object are not loaded
+	QSet<int> usedMaterials = ListOfUsedMaterials(paramsContainer);
+
+	// decoded textures are kept in the cache until materials are created
+	QList<cTexture> preloadedTextures;
+
+	if (gNetRender->IsClient()
+			&& (renderData->configuration.UseNetRender() || gNetRender->IsFrameJob()))
 	{
 		// get received textures from NetRender buffer
 		if (paramsContainer->Get<bool>("textured_background"))
@@ -265,9 +424,49 @@ void cRenderJob::PrepareData(const cRenderingConfiguration &config)
 			renderData->textures.lightmapTexture.FromQByteArray(
 				gNetRender->GetTexture(paramsContainer->Get<QString>("file_lightmap")),
 				cTexture::doNotUseMipmaps);
+
+		if (paramsContainer->Get<bool>("foveation_enabled"))
+			renderData->textures.foveationMap.FromQByteArray(
+				gNetRender->GetTexture(paramsContainer->Get<QString>("file_foveation_map")),
+				cTexture::doNotUseMipmaps);
 	}
 	else
 	{
+		TRACE_SCOPE("texture loading", "job");
+
+		// all needed textures are decoded in parallel first, then taken from cache
+		QList<cTexture::sTextureRequest> requests;
+		cTexture::sTextureRequest request;
+		request.mode = cTexture::doNotUseMipmaps;
+		if (paramsContainer->Get<bool>("textured_background"))
+		{
+			request.filename = paramsContainer->Get<QString>("file_background");
+			requests.append(request);
+		}
+		if (paramsContainer->Get<bool>("env_mapping_enable"))
+		{
+			request.filename = paramsContainer->Get<QString>("file_envmap");
+			requests.append(request);
+		}
+		if (paramsContainer->Get<int>("ambient_occlusion_mode") == params::AOmodeMultipeRays
+				&& paramsContainer->Get<bool>("ambient_occlusion_enabled"))
+		{
+			request.filename = paramsContainer->Get<QString>("file_lightmap");
+			requests.append(request);
+		}
+		if (paramsContainer->Get<bool>("foveation_enabled"))
+		{
+			request.filename = paramsContainer->Get<QString>("file_foveation_map");
+			requests.append(request);
+		}
+		QList<int> definedMaterials = ListOfDefinedMaterials(paramsContainer);
+		for (int i = 0; i < definedMaterials.size(); i++)
+		{
+			if (usedMaterials.contains(definedMaterials[i]))
+				cMaterial::ListOfTextures(definedMaterials[i], paramsContainer, &requests);
+		}
+		preloadedTextures = cTexture::LoadInParallel(requests);
+
 		if (paramsContainer->Get<bool>("textured_background"))
 			renderData->textures.backgroundTexture =
 				cTexture(paramsContainer->Get<QString>("file_background"), cTexture::doNotUseMipmaps,
@@ -282,13 +481,19 @@ void cRenderJob::PrepareData(const cRenderingConfiguration &config)
 			renderData->textures.lightmapTexture =
 				cTexture(paramsContainer->Get<QString>("file_lightmap"), cTexture::doNotUseMipmaps,
 					config.UseIgnoreErrors());
+
+		if (paramsContainer->Get<bool>("foveation_enabled"))
+			renderData->textures.foveationMap =
+				cTexture(paramsContainer->Get<QString>("file_foveation_map"), cTexture::doNotUseMipmaps,
+					config.UseIgnoreErrors());
 	}
 
 	// assign stop handler
 	renderData->stopRequest = stopRequest;
 
-	CreateMaterialsMap(
-		paramsContainer, &renderData->materials, renderData->configuration.UseIgnoreErrors());
+	CreateMaterialsMap(paramsContainer, &renderData->materials,
+		renderData->configuration.UseIgnoreErrors(), &usedMaterials);
+	preloadedTextures.clear();
 
 	// preparation of lights
 	// connect signal for progress bar update
@@ -365,46 +570,40 @@ bool cRenderJob::Execute(void)
 		{
 			if (gNetRender->IsServer())
 			{
-				// new id
-				qint32 id = rand();
-
-				// calculation of starting positions list and sending id to clients
-				renderData->netRenderStartingPositions.clear();
-
-				int clientIndex = 0;
-				int clientWorkerIndex = 0;
-
-				int workersCount =
-					gNetRender->getTotalWorkerCount() + renderData->configuration.GetNumberOfThreads();
-
-				QList<int> startingPositionsToSend;
+				QStringList listOfUsedTextures = CreateListOfUsedTextures();
 
-				for (int i = 0; i < workersCount; i++)
+				// pipelined job was already sent to clients together with the previous frame
+				if (gNetRender->ActivateNextJob(*paramsContainer, *fractalContainer))
 				{
-					// FIXME to correct starting positions considering region data
-					if (i < renderData->configuration.GetNumberOfThreads())
-					{
-						renderData->netRenderStartingPositions.append(i * image->GetHeight() / workersCount);
-					}
-					else
-					{
-						startingPositionsToSend.append(i * image->GetHeight() / workersCount);
-						clientWorkerIndex++;
-
-						if (clientWorkerIndex >= gNetRender->GetWorkerCount(clientIndex))
-						{
-							emit SendNetRenderSetup(clientIndex, id, startingPositionsToSend);
-							clientIndex++;
-							clientWorkerIndex = 0;
-							startingPositionsToSend.clear();
-						}
-					}
+					renderData->netRenderStartingPositions = nextNetRenderStartingPositions;
+				}
+				else
+				{
+					// new id
+					qint32 id = rand();
+
+					// calculation of starting positions list and sending id to clients
+					QList<QList<int> > clientStartingPositions;
+					CalculateNetRenderStartingPositions(
+						&renderData->netRenderStartingPositions, &clientStartingPositions);
+					for (int c = 0; c < clientStartingPositions.size(); c++)
+						emit SendNetRenderSetup(c, id, clientStartingPositions[c]);
+
+					// send settings to all clients
+					emit SendNetRenderJob(*paramsContainer, *fractalContainer, listOfUsedTextures);
 				}
 
-				QStringList listOfUsedTextures = CreateListOfUsedTextures();
-
-				// send settings to all clients
-				emit SendNetRenderJob(*paramsContainer, *fractalContainer, listOfUsedTextures);
+				// next frame is sent now, so clients can start it as soon as they finish this one
+				if (nextNetRenderParams && !twoPassStereo
+						&& QThread::currentThread() == gNetRender->thread())
+				{
+					QList<QList<int> > clientStartingPositions;
+					CalculateNetRenderStartingPositions(
+						&nextNetRenderStartingPositions, &clientStartingPositions);
+					nextNetRenderParams->Set("stereo_actual_eye", (int)cStereo::eyeNone);
+					gNetRender->SetNextJob(rand(), clientStartingPositions, *nextNetRenderParams,
+						*nextNetRenderFractal, listOfUsedTextures);
+				}
 			}
 
 			// get starting positions received from server
@@ -422,20 +621,76 @@ bool cRenderJob::Execute(void)
 		WriteLog("cRenderJob::Execute(void): running jobs = " + QString::number(runningJobs), 2);
 
 		// move parameters from containers to structures
-		cParamRender *params = new cParamRender(paramsContainer, &renderData->objectData);
-		cNineFractals *fractals = new cNineFractals(fractalContainer, paramsContainer);
+		cParamRender *params = PrepareParamRender();
+		cNineFractals *fractals = PrepareNineFractals();
+
+		if (repeat == 0 && mode == still && image->IsMainImage() && !tiled
+				&& !renderData->configuration.UseNetRender()
+				&& paramsContainer->Get<bool>("threads_auto_tune"))
+		{
+			TuneNumberOfThreads(fractals);
+		}
 
 		// recalculation of some parameters;
-		params->resolution = 1.0 / image->GetHeight();
-		ReduceDetail();
+		params->resolution = 1.0 / renderData->fullImageSize.y;
+		ReduceDetail(params);
+
+		// details smaller than pixel footprint at the camera target are not reduced
+		params->iterationLODReference =
+			(params->camera - params->target).Length() * params->resolution * params->fov
+			/ params->detailLevel;
+		if (params->perspectiveType == params::perspEquirectangular
+				|| params->perspectiveType == params::perspFishEye
+				|| params->perspectiveType == params::perspFishEyeCut)
+			params->iterationLODReference *= M_PI;
+
+		// precision of fractal computation is chosen by size of details relative to the scene
+		double distThresh = params->constantDEThreshold
+													? params->DEThresh
+													: (params->camera - params->target).Length() * params->resolution
+															* params->fov / params->detailLevel;
+		distThresh /= renderData->reduceDetail;
+		double precisionRange = qMax(params->camera.Length(), params->target.Length());
+
+		// single precision is not enough for deep zooms
+		if (params->singlePrecision && distThresh < precisionRange * SINGLE_PRECISION_LIMIT)
+		{
+			params->singlePrecision = false;
+			WriteLog("cRenderJob::Execute(void): single precision not enough, using double", 2);
+		}
+
+		// double-double numbers are prepared only for deep zooms
+		if (params->doubleDoublePrecision)
+		{
+			if (distThresh >= precisionRange * DOUBLE_DOUBLE_PRECISION_LIMIT)
+				params->doubleDoublePrecision = false;
+			else
+				WriteLog("cRenderJob::Execute(void): deep zoom, using double-double numbers", 2);
+		}
 
 		// initialize histograms
 		renderData->statistics.histogramIterations.Resize(paramsContainer->Get<int>("N"));
 		renderData->statistics.histogramStepCount.Resize(1000);
 		renderData->statistics.Reset();
 		renderData->statistics.usedDEType = fractals->GetDETypeString();
+		double iterationTime = fractals->GetEstimatedIterationTime();
+		if (iterationTime > 0.0)
+		{
+			WriteLog("cRenderJob::Execute(void): estimated time of iteration = "
+								 + QString::number(iterationTime) + " ns",
+				2);
+		}
+		renderData->statistics.usedShaderVariant = cRenderWorker::GetShaderVariantName(
+			cRenderWorker::SelectShaderVariant(params, renderData));
+		renderData->statistics.raymarchingRelaxation = params->raymarchingRelaxation;
+
+		// rendering threads are kept alive for all frames rendered by this job
+		if (!workerPool) workerPool = new cRenderWorkerPool;
+		renderData->workerPool = workerPool;
 
 		// create and execute renderer
+		// buffers of the previous frame are not used any more
+		arena->Reset();
 		cRenderer *renderer = new cRenderer(params, fractals, renderData, image);
 
 		// connect signal for progress bar update
@@ -466,12 +721,197 @@ bool cRenderJob::Execute(void)
 			}
 		}
 
+		PrepareCubeLUTs(params);
+
+		// primary rays of still image are not traced if only shading was changed. Effects
+		// accumulated along primary rays need the whole ray
+		renderData->relighting = relighting && mode == still && !twoPassStereo
+														 && !(params->DOFMonteCarlo && params->DOFEnabled)
+														 && !params->interiorMode
+														 && !cRenderWorker::VolumetricEffectsEnabled(params, renderData);
+		if (relighting && !renderData->relighting)
+			WriteLog("cRenderJob::Execute(): relighting not possible, rendering whole image", 2);
+
+		// primary rays of simple scenes are rendered by OpenCL device. Engine is locked for the
+		// whole frame, so other jobs use CPU at the same time
+		cOpenClEngine *openClEngine = NULL;
+		if (paramsContainer->Get<bool>("opencl_rendering_enabled") && !renderData->relighting
+				&& !renderData->configuration.UseNetRender())
+		{
+			QString reason;
+			cOpenClEngine *engine = cOpenClEngine::Instance();
+			if (!cOpenClEngine::IsSceneSupported(params, fractals, renderData, image, &reason))
+			{
+				WriteLog("cRenderJob::Execute(): scene rendered by CPU: " + reason, 2);
+			}
+			else if (!engine->TryLock())
+			{
+				WriteLog("cRenderJob::Execute(): OpenCL device is busy, scene rendered by CPU", 2);
+			}
+			else if (!engine->Prepare(paramsContainer->Get<int>("opencl_rendering_platform"),
+								 paramsContainer->Get<int>("opencl_rendering_device"), &reason))
+			{
+				engine->Unlock();
+				WriteLog("cRenderJob::Execute(): OpenCL not available: " + reason, 1);
+			}
+			else
+			{
+				openClEngine = engine;
+				renderData->openClEngine = engine;
+				renderData->statistics.usedShaderVariant = "OpenCL";
+			}
+		}
+
+		// depth of previous animation frame used as start distance of primary rays
+		bool useTemporalDepth = params->temporalDepthReprojection && !openClEngine
+														&& (mode == keyframeAnim || mode == flightAnim) && !twoPassStereo
+														&& !renderData->configuration.UseNetRender()
+														&& cTemporalDepth::IsSupported(params);
+		if (useTemporalDepth)
+		{
+			if (!temporalDepth) temporalDepth = new cTemporalDepth;
+			if (temporalDepth->Reproject(params, renderData, image->GetWidth(), image->GetHeight()))
+				renderData->temporalDepth = temporalDepth;
+		}
+
+		// half of pixels is rendered in alternating pattern during flight recording
+		bool useCheckerboard = checkerboardEnabled && mode == flightAnimRecord && !openClEngine
+													 && !twoPassStereo && !partialRender && !renderData->relighting
+													 && !renderData->configuration.UseNetRender()
+													 && cTemporalDepth::IsSupported(params);
+		if (useCheckerboard)
+		{
+			if (!checkerboard) checkerboard = new cCheckerboardRender;
+			checkerboard->PrepareFrame(params, renderData, image->GetWidth(), image->GetHeight(),
+				cShadowCache::SceneHash(paramsContainer, fractalContainer));
+			renderData->checkerboard = checkerboard;
+			if (!renderData->temporalDepth) renderData->temporalDepth = checkerboard->GetReprojection();
+		}
+
+		// interactive navigation: last frame is shown from the new camera and disoccluded lines
+		// are rendered first
+		bool useInteractiveDepth = interactiveDepth && mode == still && !twoPassStereo && !tiled
+															 && !partialRender && !renderData->relighting && !openClEngine
+															 && !renderData->configuration.UseNetRender()
+															 && cTemporalDepth::IsSupported(params);
+		if (useInteractiveDepth)
+		{
+			interactiveDepth->PrepareScene(cShadowCache::SceneHash(paramsContainer, fractalContainer));
+			if (interactiveDepth->Reproject(
+						params, renderData, image->GetWidth(), image->GetHeight()))
+			{
+				renderData->temporalDepth = interactiveDepth;
+				interactiveDepth->WarpImage(image, &renderData->lineCostMap);
+				if (image->IsPreview())
+				{
+					image->ConvertTo8bit();
+					image->UpdatePreview();
+					image->GetImageWidget()->update();
+				}
+			}
+		}
+
+		// both eyes of single-pass stereo are traced together and hit almost the same points
+		bool singlePassStereo =
+			params->stereoSinglePass && renderData->stereo.isEnabled() && !twoPassStereo;
+
+		// shadows of main light are reused while only the camera moves
+		bool useShadowCache =
+			params->shadow && params->mainLightEnable
+			&& ((params->shadowCacheEnabled && (mode == keyframeAnim || mode == flightAnim))
+					 || singlePassStereo);
+		if (useShadowCache)
+		{
+			if (!shadowCache) shadowCache = new cShadowCache;
+			shadowCache->PrepareFrame(cShadowCache::SceneHash(paramsContainer, fractalContainer));
+			renderData->shadowCache = shadowCache;
+		}
+
+		// multi-ray ambient occlusion calculated for one eye is reused by the other one
+		bool useAOCache = singlePassStereo && params->ambientOcclusionEnabled
+											&& params->ambientOcclusionMode == params::AOmodeMultipeRays;
+		if (useAOCache)
+		{
+			if (!aoCache) aoCache = new cShadowCache;
+			aoCache->PrepareFrame(cShadowCache::SceneHash(paramsContainer, fractalContainer));
+			renderData->aoCache = aoCache;
+		}
+
+		// rays of the other eye are started from the same pixel. NetRender and tiles split the image
+		// between eyes, and every sample of Monte Carlo DOF has own ray
+		renderData->stereoSinglePass = singlePassStereo && !renderData->tiled
+																	 && !renderData->configuration.UseNetRender()
+																	 && !(params->DOFMonteCarlo && params->DOFEnabled);
+
+		// SSAO and DOF of the whole frame are done by the frame pipeline of the caller. Stereo
+		// images, tiles and partial renders are post-processed in regions known only here
+		renderData->deferredPostProcessing = deferredPostProcessing && !renderData->stereo.isEnabled()
+																				 && !renderData->tiled && !renderData->partialRender;
+
+		// distances of the fractal are reused by next render jobs (other cameras, lights or
+		// materials). Only one job uses the cache at a time
+		cDistanceCache *distanceCache = NULL;
+		if (paramsContainer->Get<bool>("distance_cache_enabled") && !renderData->relighting)
+		{
+			cDistanceCache *cache = cDistanceCache::Instance();
+			if (cache->TryLock())
+			{
+				cache->PrepareScene(cDistanceCache::FractalHash(paramsContainer, fractalContainer),
+					paramsContainer->Get<bool>("distance_cache_persistent"));
+				distanceCache = cache;
+				renderData->distanceCache = cache;
+			}
+			else
+			{
+				WriteLog("cRenderJob::Execute(): distance cache is used by other job", 2);
+			}
+		}
+
+		QElapsedTimer frameTimer;
+		frameTimer.start();
 		result = renderer->RenderImage();
+		if (frameTimeController)
+			frameTimeController->FrameRendered(frameTimer.elapsed() / 1000.0, result);
+
+		renderData->backgroundLUT = NULL;
+		renderData->envMapLUT = NULL;
+		renderData->shadowCache = NULL;
+		renderData->aoCache = NULL;
+		renderData->openClEngine = NULL;
+		if (openClEngine) openClEngine->Unlock();
+		renderData->distanceCache = NULL;
+		if (distanceCache)
+		{
+			WriteLogDouble("Distance cache bricks", distanceCache->GetNumberOfBricks(), 2);
+			distanceCache->Finish();
+			distanceCache->Unlock();
+		}
+		if (useShadowCache) WriteLogDouble("Shadow cache cells", shadowCache->GetNumberOfCells(), 2);
+		if (useAOCache) WriteLogDouble("AO cache cells", aoCache->GetNumberOfCells(), 2);
+		if (params->common.periodicityCheck)
+			WriteLogDouble("Periodic orbits", renderData->statistics.numberOfPeriodicOrbits, 2);
+		renderData->temporalDepth = NULL;
+		renderData->checkerboard = NULL;
+		if (useCheckerboard)
+		{
+			if (result)
+				checkerboard->StoreFrame(image, params, renderData);
+			else
+				checkerboard->Clear();
+		}
+		if (useTemporalDepth)
+		{
+			// interrupted frame is not complete, so next frame starts without reprojection
+			if (result)
+				temporalDepth->StoreFrame(image, params, renderData);
+			else
+				temporalDepth->Clear();
+		}
+		// after interruption the last finished frame is kept
+		if (useInteractiveDepth && result) interactiveDepth->StoreFrame(image, params, renderData);
 
 		if (twoPassStereo && repeat == 0) renderData->stereo.StoreImageInBuffer(image);
 
-		delete params;
-		delete fractals;
 		delete renderer;
 	}
 
@@ -501,9 +941,94 @@ bool cRenderJob::Execute(void)
 	runningJobs--;
 	// qDebug() << "runningJobs" << runningJobs;
 
+	// events of whole frame are written, so the trace is complete when rendering is killed
+	TRACE_FLUSH();
+
 	return result;
 }
 
+cParamRender *cRenderJob::PrepareParamRender()
+{
+	if (cachedParams && !paramsDependencies.IsLayoutChanged(paramsContainer))
+	{
+		QStringList changed = paramsDependencies.ChangedParameters(paramsContainer);
+		QStringList updatable = cParamRender::UpdatableParameters();
+		bool canUpdate = true;
+		for (int i = 0; i < changed.size(); i++)
+		{
+			if (!updatable.contains(changed[i])) canUpdate = false;
+		}
+
+		if (canUpdate)
+		{
+			if (!changed.isEmpty())
+			{
+				cachedParams->UpdateCamera(paramsContainer);
+				paramsDependencies.Update(paramsContainer);
+			}
+			// could be changed by previous Execute()
+			cachedParams->singlePrecision = paramsContainer->Get<bool>("single_precision");
+			cachedParams->doubleDoublePrecision =
+				paramsContainer->Get<bool>("double_double_precision");
+			cachedParams->ambientOcclusionEnabled =
+				paramsContainer->Get<bool>("ambient_occlusion_enabled");
+			cachedParams->shadow = paramsContainer->Get<bool>("shadows_enabled");
+			renderData->objectData = cachedObjectData;
+			WriteLog("cRenderJob::PrepareParamRender(): parameters reused", 2);
+			return cachedParams;
+		}
+	}
+
+	if (cachedParams) delete cachedParams;
+	paramsDependencies.BeginRecording(paramsContainer);
+	cachedParams = new cParamRender(paramsContainer, &renderData->objectData);
+	paramsDependencies.EndRecording();
+	cachedObjectData = renderData->objectData;
+	return cachedParams;
+}
+
+cNineFractals *cRenderJob::PrepareNineFractals()
+{
+	bool changed = !cachedFractals || fractalsDependencies[0].IsChanged(paramsContainer);
+	for (int i = 0; i < NUMBER_OF_FRACTALS && !changed; i++)
+		changed = fractalsDependencies[i + 1].IsChanged(&fractalContainer->at(i));
+
+	if (!changed)
+	{
+		WriteLog("cRenderJob::PrepareNineFractals(): fractals reused", 2);
+		return cachedFractals;
+	}
+
+	if (cachedFractals) delete cachedFractals;
+	fractalsDependencies[0].BeginRecording(paramsContainer);
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+		fractalsDependencies[i + 1].BeginRecording(&fractalContainer->at(i));
+	cachedFractals = new cNineFractals(fractalContainer, paramsContainer);
+	for (int i = 0; i <= NUMBER_OF_FRACTALS; i++)
+		fractalsDependencies[i].EndRecording();
+	return cachedFractals;
+}
+
+void cRenderJob::TuneNumberOfThreads(const cNineFractals *fractals)
+{
+	int threadsLimit = renderData->configuration.GetNumberOfThreads();
+	if (threadsLimit <= cNumaTopology::Instance()->GetNumberOfPhysicalCores()) return;
+
+	QString key = cThreadTuning::Key(fractals);
+	cThreadTuning::enumChoice choice = cThreadTuning::GetChoice(key);
+	if (choice == cThreadTuning::choiceUnknown)
+	{
+		emit updateProgressAndStatus(
+			QObject::tr("Rendering image"), QObject::tr("Measuring speed of CPU threads"), 0.0);
+		choice = cThreadTuning::Measure(paramsContainer, fractalContainer, threadsLimit, stopRequest);
+		if (choice == cThreadTuning::choiceUnknown) return;
+		cThreadTuning::StoreChoice(key, choice);
+	}
+	renderData->configuration.SetThreadsLimit(cThreadTuning::NumberOfThreads(choice, threadsLimit));
+	WriteLogDouble("Threads tuning: number of threads",
+		renderData->configuration.GetNumberOfThreads(), 2);
+}
+
 void cRenderJob::ChangeCameraTargetPosition(cCameraTarget &cameraTarget)
 {
 	paramsContainer->Set("camera", cameraTarget.GetCamera());
@@ -528,9 +1053,139 @@ void cRenderJob::UpdateParameters(
 	PrepareData(renderData->configuration);
 }
 
-void cRenderJob::ReduceDetail()
+void cRenderJob::CalculateNetRenderStartingPositions(
+	QList<int> *serverPositions, QList<QList<int> > *clientPositions)
 {
-	if (mode == flightAnimRecord)
+	serverPositions->clear();
+	clientPositions->clear();
+
+	// every worker gets part of image proportional to its speed measured in previous jobs.
+	// Speed of server CPUs is not measured, so they have average speed
+	QList<double> workerSpeeds;
+	for (int i = 0; i < renderData->configuration.GetNumberOfThreads(); i++)
+		workerSpeeds.append(1.0);
+	for (int c = 0; c < gNetRender->GetClientCount(); c++)
+	{
+		double speed = gNetRender->GetRelativeWorkerSpeed(c);
+		for (int i = 0; i < gNetRender->GetWorkerCount(c); i++)
+			workerSpeeds.append(speed);
+	}
+	double totalSpeed = 0.0;
+	for (int i = 0; i < workerSpeeds.size(); i++)
+		totalSpeed += workerSpeeds[i];
+
+	// with cost of lines measured in previous frame, expensive regions get more workers
+	const QVector<double> &costMap = renderData->lineCostMap;
+	bool useCostMap = costMap.size() == image->GetHeight();
+	int lastLine = image->GetHeight() - 1;
+
+	// FIXME to correct starting positions considering region data
+	int workerIndex = 0;
+	double speedSum = 0.0;
+	for (int i = 0; i < renderData->configuration.GetNumberOfThreads(); i++)
+	{
+		double fraction = speedSum / totalSpeed;
+		int position = int(fraction * image->GetHeight());
+		if (useCostMap) position = cScheduler::CostQuantileLine(costMap, fraction, 0, lastLine);
+		serverPositions->append(position);
+		speedSum += workerSpeeds[workerIndex++];
+	}
+
+	// clients without CPUs (e.g. relays without clients) get empty lists
+	for (int c = 0; c < gNetRender->GetClientCount(); c++)
+	{
+		QList<int> startingPositionsToSend;
+		for (int i = 0; i < gNetRender->GetWorkerCount(c); i++)
+		{
+			double fraction = speedSum / totalSpeed;
+			int position = int(fraction * image->GetHeight());
+			if (useCostMap) position = cScheduler::CostQuantileLine(costMap, fraction, 0, lastLine);
+			startingPositionsToSend.append(position);
+			speedSum += workerSpeeds[workerIndex++];
+		}
+		clientPositions->append(startingPositionsToSend);
+	}
+}
+
+void cRenderJob::SetNextNetRenderJob(
+	const cParameterContainer *_params, const cFractalContainer *_fractal)
+{
+	if (nextNetRenderParams) delete nextNetRenderParams;
+	if (nextNetRenderFractal) delete nextNetRenderFractal;
+	nextNetRenderParams = NULL;
+	nextNetRenderFractal = NULL;
+
+	if (_params && _fractal)
+	{
+		nextNetRenderParams = new cParameterContainer;
+		*nextNetRenderParams = *_params;
+		nextNetRenderFractal = new cFractalContainer;
+		*nextNetRenderFractal = *_fractal;
+	}
+}
+
+void cRenderJob::PrepareCubeLUTs(const cParamRender *params)
+{
+	// tables are kept between animation frames while their parameters are not changed
+	renderData->backgroundLUT = NULL;
+	renderData->envMapLUT = NULL;
+	if (!params->backgroundLUTEnabled) return;
+
+	const cTexture &background = renderData->textures.backgroundTexture;
+	bool textured = params->texturedBackground && background.IsLoaded();
+	bool flat = params->texturedBackgroundMapType == params::mapFlat;
+	if (!params->texturedBackground || (textured && !flat))
+	{
+		QString key = paramsContainer->Get<QString>("textured_background") + " ";
+		if (textured)
+		{
+			key += paramsContainer->Get<QString>("textured_background_map_type") + " "
+						 + paramsContainer->Get<QString>("background_brightness") + " "
+						 + background.GetFileName() + " " + QString::number(background.Width());
+		}
+		else
+		{
+			for (int i = 1; i <= 3; i++)
+				key += paramsContainer->Get<QString>("background_color", i) + " ";
+		}
+
+		if (!backgroundLUT) backgroundLUT = new cCubeLUT;
+		if (backgroundLUT->GetKey() != key)
+		{
+			WriteLog("Preparing background look-up table", 2);
+			// gradient is smooth, texture needs similar resolution as the original image
+			int size = textured ? qBound(16, background.Width() / 4, 1024) : 64;
+			backgroundLUT->Resize(size);
+			cRenderWorker::FillBackgroundLUT(params, renderData, backgroundLUT);
+			backgroundLUT->SetKey(key);
+		}
+		renderData->backgroundLUT = backgroundLUT;
+	}
+
+	const cTexture &envmap = renderData->textures.envmapTexture;
+	if (params->envMappingEnable && envmap.IsLoaded())
+	{
+		QString key = envmap.GetFileName() + " " + QString::number(envmap.Width());
+		if (!envMapLUT) envMapLUT = new cCubeLUT;
+		if (envMapLUT->GetKey() != key)
+		{
+			WriteLog("Preparing environment map look-up table", 2);
+			envMapLUT->Resize(qBound(16, envmap.Width() / 4, 1024));
+			cRenderWorker::FillEnvMapLUT(renderData, envMapLUT);
+			envMapLUT->SetKey(key);
+		}
+		renderData->envMapLUT = envMapLUT;
+	}
+}
+
+void cRenderJob::ReduceDetail(cParamRender *params)
+{
+	renderData->minProgressiveStep = 1;
+	if (frameTimeController)
+	{
+		frameTimeController->Apply(params, renderData);
+	}
+	else if (mode == flightAnimRecord)
 	{
 		renderData->reduceDetail = sqrt(renderData->lastPercentage);
 		if (renderData->reduceDetail < 0.1) renderData->reduceDetail = 0.1;
@@ -541,6 +1196,11 @@ void cRenderJob::ReduceDetail()
 	}
 }
 
+bool cRenderJob::IsPostProcessingDeferred() const
+{
+	return renderData && renderData->deferredPostProcessing;
+}
+
 void cRenderJob::slotExecute()
 {
 	Execute();
@@ -45,12 +45,24 @@
 #include "statistics.h"
 #include "parameters.hpp"
 #include "fractal_container.hpp"
+#include "object_data.hpp"
+#include "parameter_dependencies.hpp"
+#include "region.hpp"
 
 // forward declarations
 class cImage;
 struct sRenderData;
 class cRenderingConfiguration;
 struct sImageOptional;
+class cRenderWorkerPool;
+class cCubeLUT;
+class cParamRender;
+class cNineFractals;
+class cShadowCache;
+class cTemporalDepth;
+class cCheckerboardRender;
+class cFrameTimeController;
+class cJobArena;
 
 class cRenderJob : public QObject
 {
@@ -75,12 +87,51 @@ public:
 	cImage *GetImagePtr() { return image; }
 	int GetNumberOfCPUs() { return totalNumberOfCPUs; }
 	void UseSizeFromImage(bool mode) { useSizeFromImage = mode; }
+	// only given part of the image is rendered (has to be called before Init())
+	void SetTile(const cRegion<int> &_tileRegion);
+	// only given part of already rendered image is rendered again and only lines around it are
+	// post-processed. Ignored if image size changes (has to be called before Init())
+	void SetDirtyRegion(const cRegion<int> &_dirtyRegion);
+	// last frame stored in given object is reprojected to the new camera before rendering of still
+	// image starts. Finished image is stored back there. Object is owned by the caller
+	void SetInteractiveReprojection(cTemporalDepth *_interactiveDepth)
+	{
+		interactiveDepth = _interactiveDepth;
+	}
+	// image is shaded again using geometry stored in its G-buffer by previous render. Ignored if
+	// image buffers change or effects need the whole primary rays (has to be called before Init())
+	void SetRelighting() { relighting = true; }
+	// frames of flight recording render half of pixels and reconstruct the rest from previous frame
+	void SetCheckerboard(bool enable) { checkerboardEnabled = enable; }
+	// SSAO and DOF are not done by Execute(). The caller passes frames to cImageSaveQueue, which
+	// post-processes them while next frame is rendered
+	void SetDeferredPostProcessing(bool enable) { deferredPostProcessing = enable; }
+	// true if effects of last executed frame were left for the caller
+	bool IsPostProcessingDeferred() const;
+	// parameters of last executed frame
+	const cParameterContainer *GetParameters() const { return paramsContainer; }
+	// rendering threads are taken from given pool instead of creating own ones, so tasks started
+	// one after another don't create and destroy threads. Pool is owned by the caller
+	void UseWorkerPool(cRenderWorkerPool *pool)
+	{
+		workerPool = pool;
+		externalWorkerPool = true;
+	}
+	// quality of frames is reduced to keep target frame time. Object is owned by the caller
+	void SetFrameTimeController(cFrameTimeController *_frameTimeController)
+	{
+		frameTimeController = _frameTimeController;
+	}
 	void ChangeCameraTargetPosition(cCameraTarget &cameraTarget);
 
 	void UpdateParameters(const cParameterContainer *_params, const cFractalContainer *_fractal);
 	void UpdateConfig(const cRenderingConfiguration &config);
+	// settings of next animation frame which NetRender clients get while rendering the current one
+	// (NULL if there is no next frame). Job has to be executed in the thread of gNetRender
+	void SetNextNetRenderJob(const cParameterContainer *_params, const cFractalContainer *_fractal);
 	static int GetRunningJobCount() { return runningJobs; }
 	cStatistics GetStatistics(void);
+	QStringList CreateListOfUsedTextures();
 
 public slots:
 	void slotExecute();
@@ -88,13 +139,27 @@ public slots:
 private:
 	bool InitImage(int w, int h, const sImageOptional &optional);
 	void PrepareData(const cRenderingConfiguration &config);
-	void ReduceDetail();
-	QStringList CreateListOfUsedTextures();
+	void ReduceDetail(cParamRender *params);
+	void PrepareCubeLUTs(const cParamRender *params);
+	// structures of previous frame are reused if their parameters didn't change
+	cParamRender *PrepareParamRender();
+	cNineFractals *PrepareNineFractals();
+	// physical cores only are used if SMT siblings were measured to slow down the formula
+	void TuneNumberOfThreads(const cNineFractals *fractals);
+	// lines where server and client workers start rendering, proportional to their speeds
+	void CalculateNetRenderStartingPositions(
+		QList<int> *serverPositions, QList<QList<int> > *clientPositions);
 
 	bool hasQWidget;
 	bool inProgress;
 	bool ready;
 	bool useSizeFromImage;
+	bool tiled;
+	cRegion<int> tileRegion;
+	CVector2<int> fullImageSize;
+	bool partialRender;
+	cRegion<int> dirtyRegion;
+	bool relighting;
 	cImage *image;
 	cFractalContainer *fractalContainer;
 	cParameterContainer *paramsContainer;
@@ -105,8 +170,30 @@ private:
 	int width;
 	QWidget *imageWidget;
 	sRenderData *renderData;
+	cRenderWorkerPool *workerPool;
+	bool externalWorkerPool;
+	cTemporalDepth *temporalDepth;
+	cTemporalDepth *interactiveDepth;
+	bool checkerboardEnabled;
+	bool deferredPostProcessing;
+	cCheckerboardRender *checkerboard;
+	cFrameTimeController *frameTimeController;
+	cShadowCache *shadowCache;
+	cShadowCache *aoCache;
+	cCubeLUT *backgroundLUT;
+	cCubeLUT *envMapLUT;
+	cJobArena *arena; // per-frame buffers, reused by all frames of the job
 	bool *stopRequest;
 	bool canUseNetRender;
+	cParameterContainer *nextNetRenderParams;
+	cFractalContainer *nextNetRenderFractal;
+	QList<int> nextNetRenderStartingPositions; // server part of already sent next job
+	cParamRender *cachedParams;
+	cNineFractals *cachedFractals;
+	QVector<cObjectData> cachedObjectData;
+	cParameterDependencies paramsDependencies;
+	// dependencies on main container and then on each fractal container
+	cParameterDependencies fractalsDependencies[NUMBER_OF_FRACTALS + 1];
 
 	static int id; // global identifier of actual rendering job
 	static int runningJobs;
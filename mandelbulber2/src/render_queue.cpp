@@ -41,6 +41,8 @@
 #include "../src/interface.hpp"
 #include "../src/rendered_image_widget.hpp"
 #include "animation_frames.hpp"
+#include "cimage.hpp"
+#include "command_line_interface.hpp"
 #include "error_message.hpp"
 #include "file_image.hpp"
 #include "files.h"
@@ -48,17 +50,26 @@
 #include "global_data.hpp"
 #include "initparameters.hpp"
 #include "keyframes.hpp"
+#include "memory_estimator.hpp"
+#include "parameter_sweep.hpp"
 #include "parameters.hpp"
 #include "progress_text.hpp"
 #include "queue.hpp"
+#include "render_checkpoint.hpp"
 #include "render_job.hpp"
+#include "render_worker_pool.hpp"
 #include "rendering_configuration.hpp"
+#include "resource_report.hpp"
 #include "settings.hpp"
 
 cRenderQueue::cRenderQueue(cImage *_image, RenderedImage *widget) : QObject()
 {
-	image = _image;
+	// concurrent queue jobs render to own images
+	ownImage = (_image == NULL);
+	image = ownImage ? new cImage(200, 200) : _image;
+	numberOfThreads = 0;
 	imageWidget = widget;
+	resourceReport = NULL;
 	queuePar = new cParameterContainer;
 	queueParFractal = new cFractalContainer;
 	queueAnimFrames = new cAnimationFrames;
@@ -111,6 +122,7 @@ cRenderQueue::~cRenderQueue()
 	delete queueKeyframeAnimation;
 	delete queueParFractal;
 	delete queuePar;
+	if (ownImage) delete image;
 }
 
 void cRenderQueue::slotRenderQueue()
@@ -123,7 +135,7 @@ void cRenderQueue::slotRenderQueue()
 	while (!gQueue->stopRequest)
 	{
 		int queueTotalLeft = gQueue->GetQueueSize();
-		cQueue::structQueueItem queueItem = gQueue->GetNextFromList();
+		cQueue::structQueueItem queueItem = gQueue->TakeNextFromList();
 		if (queueItem.filename == "") break; // last item reached
 
 		emit updateProgressAndStatus(QFileInfo(queueItem.filename).fileName(),
@@ -138,6 +150,21 @@ void cRenderQueue::slotRenderQueue()
 
 			queuePar->Set("image_preview_scale", 0);
 
+			qint64 memory = EstimateMemory();
+			gQueue->ReserveMemory(memory);
+			numberOfThreads = gQueue->ReserveThreads(
+				EstimateSamples(), queueItem.renderType != cQueue::queue_STILL);
+
+			cResourceReport itemReport;
+			if (cResourceReport::IsEnabled())
+			{
+				resourceReport = &itemReport;
+				itemReport.Start(QFileInfo(queueItem.filename).baseName());
+				itemReport.SetEstimatedMemory(memory);
+			}
+			queueFlightAnimation->SetResourceReport(resourceReport);
+			queueKeyframeAnimation->SetResourceReport(resourceReport);
+
 			bool result = false;
 			switch (queueItem.renderType)
 			{
@@ -146,6 +173,22 @@ void cRenderQueue::slotRenderQueue()
 				case cQueue::queue_KEYFRAME: result = RenderKeyframe(); break;
 			}
 
+			if (resourceReport)
+			{
+				// report is saved next to images of the queue item
+				itemReport.Finish();
+				itemReport.Save(cResourceReport::FileNameForImage(
+					ImageFolder(queueItem.renderType) + QFileInfo(queueItem.filename).baseName()));
+				gQueue->AddResourceReport(itemReport);
+				resourceReport = NULL;
+				queueFlightAnimation->SetResourceReport(NULL);
+				queueKeyframeAnimation->SetResourceReport(NULL);
+			}
+
+			gQueue->ReleaseThreads(numberOfThreads);
+			gQueue->ReleaseMemory(memory);
+			gQueue->ReleaseQueueItem(queueItem);
+
 			if (result)
 			{
 				gQueue->RemoveQueueItem(queueItem);
@@ -160,15 +203,27 @@ void cRenderQueue::slotRenderQueue()
 		{
 			cErrorMessage::showMessage("Cannot load file!\n", cErrorMessage::errorMessage);
 			qCritical() << "\nSetting file " << queueItem.filename << " not found\n";
+			gQueue->ReleaseQueueItem(queueItem);
 		}
 	}
 
 	emit updateProgressAndStatus(
 		QObject::tr("Queue Render"), QObject::tr("Queue Done"), 1.0, cProgressText::progress_QUEUE);
 
+	gQueue->RenderQueueFinished();
 	emit finished();
 }
 
+QString cRenderQueue::ImageFolder(int renderType) const
+{
+	switch (renderType)
+	{
+		case cQueue::queue_FLIGHT: return queuePar->Get<QString>("anim_flight_dir");
+		case cQueue::queue_KEYFRAME: return queuePar->Get<QString>("anim_keyframe_dir");
+		default: return gPar->Get<QString>("default_image_path") + QDir::separator();
+	}
+}
+
 bool cRenderQueue::RenderFlight()
 {
 	bool result = false;
@@ -200,15 +255,49 @@ bool cRenderQueue::RenderKeyframe()
 }
 
 bool cRenderQueue::RenderStill(const QString &filename)
+{
+	QString sweepSpec = queuePar->Get<QString>("sweep");
+	if (sweepSpec.isEmpty()) return RenderStillImage(QFileInfo(filename).baseName());
+
+	cParameterSweep sweep;
+	if (!sweep.Parse(sweepSpec))
+	{
+		cErrorMessage::showMessage(sweep.GetErrorText(), cErrorMessage::errorMessage);
+		return false;
+	}
+
+	// scene is loaded once. Worker threads, image buffers and textures are shared by variations
+	cParameterContainer basePar = *queuePar;
+	cFractalContainer baseParFractal = *queueParFractal;
+	basePar.Set("sweep", QString());
+	cRenderWorkerPool *workerPool = new cRenderWorkerPool;
+
+	bool result = true;
+	for (int i = 0; i < sweep.GetNumberOfVariations() && result; i++)
+	{
+		*queuePar = basePar;
+		*queueParFractal = baseParFractal;
+		cCommandLineInterface::OverrideParameters(
+			sweep.GetOverrides(i), queuePar, queueParFractal);
+		result = RenderStillImage(
+			cParameterSweep::VariationFileName(QFileInfo(filename).baseName(), i + 1), workerPool);
+	}
+
+	delete workerPool;
+	return result;
+}
+
+bool cRenderQueue::RenderStillImage(const QString &baseName, cRenderWorkerPool *workerPool)
 {
 	ImageFileSave::enumImageFileType imageFormat =
 		(ImageFileSave::enumImageFileType)gPar->Get<int>("queue_image_format");
 	QString extension = ImageFileSave::ImageFileExtension(imageFormat);
-	QString saveFilename = QFileInfo(filename).baseName() + extension;
+	QString saveFilename = baseName + extension;
 
 	// setup of rendering engine
 	cRenderJob *renderJob =
 		new cRenderJob(queuePar, queueParFractal, image, &gQueue->stopRequest, imageWidget);
+	if (workerPool) renderJob->UseWorkerPool(workerPool);
 
 	connect(renderJob, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)),
 		this, SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)));
@@ -222,6 +311,18 @@ bool cRenderQueue::RenderStill(const QString &filename)
 		config.DisableRefresh();
 	}
 	config.EnableNetRender();
+	config.SetThreadsLimit(numberOfThreads);
+
+	// checkpoints are used only in CLI mode, where the queue can be resumed after crash
+	QString checkpointFile;
+	if (systemData.noGui && gPar->Get<int>("checkpoint_interval") > 0)
+	{
+		checkpointFile = cRenderCheckpoint::FileNameForImage(
+			gPar->Get<QString>("default_image_path") + QDir::separator() + saveFilename);
+		config.SetCheckpoint(checkpointFile,
+			cRenderCheckpoint::SettingsHash(queuePar, queueParFractal),
+			gPar->Get<int>("checkpoint_interval"), systemData.resumeRendering);
+	}
 	renderJob->Init(cRenderJob::still, config);
 
 	gQueue->stopRequest = false;
@@ -233,13 +334,15 @@ bool cRenderQueue::RenderStill(const QString &filename)
 		delete renderJob;
 		return false;
 	}
+	if (resourceReport) resourceReport->AddStatistics(renderJob->GetStatistics());
 
 	QString fullSaveFilename =
 		gPar->Get<QString>("default_image_path") + QDir::separator() + saveFilename;
 	SaveImage(fullSaveFilename, imageFormat, image, this);
+	if (!checkpointFile.isEmpty()) QFile::remove(checkpointFile);
 
 	fullSaveFilename = gPar->Get<QString>("default_image_path") + QDir::separator()
-										 + QFileInfo(filename).baseName() + ".fract";
+										 + baseName + ".fract";
 	cSettings parSettings(cSettings::formatCondensedText);
 	parSettings.CreateText(queuePar, queueParFractal);
 	parSettings.SaveToFile(fullSaveFilename);
@@ -247,3 +350,19 @@ bool cRenderQueue::RenderStill(const QString &filename)
 	delete renderJob;
 	return true;
 }
+
+double cRenderQueue::EstimateSamples() const
+{
+	double samples = double(queuePar->Get<int>("image_width")) * queuePar->Get<int>("image_height");
+	if (queuePar->Get<bool>("DOF_enabled") && queuePar->Get<bool>("DOF_monte_carlo"))
+		samples *= queuePar->Get<int>("DOF_samples");
+	return samples;
+}
+
+qint64 cRenderQueue::EstimateMemory() const
+{
+	int width = queuePar->Get<int>("image_width");
+	int height = queuePar->Get<int>("image_height");
+	sImageOptional optional = cMemoryEstimator::ImageOptionalFromParams(queuePar);
+	return cMemoryEstimator::EstimateJob(queuePar, width, height, optional).Total();
+}
@@ -48,6 +48,8 @@ class cFlightAnimation;
 class cKeyframeAnimation;
 class cKeyframes;
 class cImage;
+class cRenderWorkerPool;
+class cResourceReport;
 
 class cRenderQueue : public QObject
 {
@@ -55,9 +57,14 @@ class cRenderQueue : public QObject
 public:
 	cRenderQueue(cImage *_image, RenderedImage *widget = NULL);
 	~cRenderQueue();
+	// renders settings from queue file. If parameter 'sweep' is set, all its variations are rendered
 	bool RenderStill(const QString &filename);
 	bool RenderFlight();
 	bool RenderKeyframe();
+	// number of pixel samples used to share threads between concurrent queue items
+	double EstimateSamples() const;
+	// memory needed by render job of queue item [bytes]
+	qint64 EstimateMemory() const;
 
 public slots:
 	void slotRenderQueue();
@@ -70,7 +77,14 @@ signals:
 	void finished();
 
 private:
+	// renders current queue settings and saves image and settings as baseName
+	bool RenderStillImage(const QString &baseName, cRenderWorkerPool *workerPool = NULL);
+	// folder where images of queue item of given type are saved (with trailing separator)
+	QString ImageFolder(int renderType) const;
+
 	cImage *image;
+	bool ownImage;
+	int numberOfThreads;
 	RenderedImage *imageWidget;
 	cParameterContainer *queuePar;
 	cFractalContainer *queueParFractal;
@@ -78,6 +92,8 @@ private:
 	cFlightAnimation *queueFlightAnimation;
 	cKeyframeAnimation *queueKeyframeAnimation;
 	cKeyframes *queueKeyframes;
+	// report of currently rendered queue item (NULL if reports are disabled)
+	cResourceReport *resourceReport;
 };
 
 #endif /* MANDELBULBER2_SRC_RENDER_QUEUE_HPP_ */
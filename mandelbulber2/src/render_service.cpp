@@ -0,0 +1,344 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderService class - headless render service with HTTP job API
+ */
+
+#include "render_service.hpp"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include "cimage.hpp"
+#include "command_line_interface.hpp"
+#include "file_image.hpp"
+#include "files.h"
+#include "fractal_container.hpp"
+#include "global_data.hpp"
+#include "render_job.hpp"
+#include "render_worker_pool.hpp"
+#include "rendering_configuration.hpp"
+#include "settings.hpp"
+
+cRenderService::cRenderService(QObject *parent) : QObject(parent)
+{
+	server = NULL;
+	workerPool = new cRenderWorkerPool;
+	image = new cImage(gPar->Get<int>("image_width"), gPar->Get<int>("image_height"));
+	busy = false;
+	quitRequest = false;
+	jobsDone = 0;
+}
+
+cRenderService::~cRenderService()
+{
+	delete image;
+	delete workerPool;
+}
+
+bool cRenderService::Listen(int port)
+{
+	server = new QTcpServer(this);
+	// only local processes can send jobs
+	if (!server->listen(QHostAddress::LocalHost, port))
+	{
+		qCritical() << "Render service - cannot listen on port" << port << ":"
+								<< server->errorString();
+		return false;
+	}
+	connect(server, SIGNAL(newConnection()), this, SLOT(slotNewConnection()));
+	WriteLog("Render service - listening on localhost, port: " + QString::number(port), 2);
+
+	QTextStream out(stdout);
+	out << "Render service - listening on localhost, port: " << port << "\n";
+	out.flush();
+	return true;
+}
+
+void cRenderService::slotNewConnection()
+{
+	while (server->hasPendingConnections())
+	{
+		QTcpSocket *socket = server->nextPendingConnection();
+		buffers.insert(socket, QByteArray());
+		connect(socket, SIGNAL(readyRead()), this, SLOT(slotReadyRead()));
+		connect(socket, SIGNAL(disconnected()), this, SLOT(slotDisconnected()));
+	}
+}
+
+void cRenderService::slotReadyRead()
+{
+	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+	if (!socket || !buffers.contains(socket)) return;
+
+	QByteArray &buffer = buffers[socket];
+	buffer.append(socket->readAll());
+	if (buffer.size() > RENDER_SERVICE_MAX_REQUEST_SIZE)
+	{
+		SendResponse(socket, 413, "text/plain", "Request too large\n");
+		buffers.remove(socket);
+		socket->disconnectFromHost();
+		return;
+	}
+
+	sRequest request;
+	request.socket = socket;
+	while (ParseRequest(&buffer, &request))
+	{
+		HandleRequest(request);
+	}
+}
+
+void cRenderService::slotDisconnected()
+{
+	QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+	if (!socket) return;
+
+	buffers.remove(socket);
+	// jobs of disconnected client are not rendered
+	for (int i = queue.size() - 1; i >= 0; i--)
+	{
+		if (queue[i].socket == socket) queue.removeAt(i);
+	}
+	socket->deleteLater();
+}
+
+bool cRenderService::ParseRequest(QByteArray *buffer, sRequest *request)
+{
+	int headerEnd = buffer->indexOf("\r\n\r\n");
+	if (headerEnd < 0) return false;
+
+	QList<QByteArray> lines = buffer->left(headerEnd).split('\n');
+	QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+	int contentLength = 0;
+	for (int i = 1; i < lines.size(); i++)
+	{
+		int colon = lines[i].indexOf(':');
+		if (colon < 0) continue;
+		if (lines[i].left(colon).trimmed().toLower() == "content-length")
+			contentLength = qMax(0, lines[i].mid(colon + 1).trimmed().toInt());
+	}
+
+	int bodyStart = headerEnd + 4;
+	if (buffer->size() < bodyStart + contentLength) return false;
+
+	request->method = requestLine.size() > 0 ? QString(requestLine[0]) : QString();
+	request->path = requestLine.size() > 1 ? QString(requestLine[1]) : QString();
+	request->body = buffer->mid(bodyStart, contentLength);
+	buffer->remove(0, bodyStart + contentLength);
+	return true;
+}
+
+void cRenderService::SendResponse(
+	QTcpSocket *socket, int code, const QByteArray &contentType, const QByteArray &body)
+{
+	QByteArray reason;
+	switch (code)
+	{
+		case 200: reason = "OK"; break;
+		case 400: reason = "Bad Request"; break;
+		case 404: reason = "Not Found"; break;
+		case 413: reason = "Payload Too Large"; break;
+		default: reason = "Internal Server Error"; break;
+	}
+
+	QByteArray header = "HTTP/1.1 " + QByteArray::number(code) + " " + reason + "\r\n";
+	header += "Content-Type: " + contentType + "\r\n";
+	header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+	socket->write(header);
+	socket->write(body);
+	socket->flush();
+}
+
+void cRenderService::SendJson(QTcpSocket *socket, int code, const QJsonObject &object)
+{
+	SendResponse(socket, code, "application/json", QJsonDocument(object).toJson());
+}
+
+void cRenderService::HandleRequest(const sRequest &request)
+{
+	if (request.method == "GET" && request.path == "/status")
+	{
+		QJsonObject status;
+		status["jobs_done"] = jobsDone;
+		status["queued"] = queue.size();
+		status["busy"] = busy;
+		SendJson(request.socket, 200, status);
+	}
+	else if (request.method == "POST" && request.path == "/render")
+	{
+		queue.append(request);
+		ProcessQueue();
+	}
+	else if (request.method == "POST" && request.path == "/quit")
+	{
+		QJsonObject reply;
+		reply["quit"] = true;
+		SendJson(request.socket, 200, reply);
+		quitRequest = true;
+		// if job is rendered, the service is stopped after it
+		ProcessQueue();
+	}
+	else
+	{
+		SendResponse(request.socket, 404, "text/plain", "Unknown request\n");
+	}
+}
+
+void cRenderService::ProcessQueue()
+{
+	// events are processed during rendering, so new requests can come here recursively
+	if (busy) return;
+	busy = true;
+
+	while (!queue.isEmpty() && !quitRequest)
+	{
+		sRequest request = queue.takeFirst();
+		RenderJob(request);
+	}
+
+	busy = false;
+	if (quitRequest)
+	{
+		server->close();
+		emit finished();
+	}
+}
+
+void cRenderService::RenderJob(const sRequest &request)
+{
+	QJsonParseError parseError;
+	QJsonDocument document = QJsonDocument::fromJson(request.body, &parseError);
+	if (document.isNull() || !document.isObject())
+	{
+		SendResponse(request.socket, 400, "text/plain",
+			"Invalid JSON: " + parseError.errorString().toUtf8() + "\n");
+		return;
+	}
+	QJsonObject job = document.object();
+
+	// all parameters are reset to defaults by decoding of settings
+	cSettings parSettings(cSettings::formatFullText);
+	parSettings.BeQuiet(true);
+	if (!parSettings.LoadFromString(job["settings"].toString())
+			|| !parSettings.Decode(gPar, gParFractal))
+	{
+		SendResponse(request.socket, 400, "text/plain", "Cannot decode settings\n");
+		return;
+	}
+	cCommandLineInterface::OverrideParameters(job["overrides"].toString(), gPar, gParFractal);
+
+	QString format = job["format"].toString("jpg");
+	if (!QStringList({"jpg", "png", "png16", "png16alpha", "exr", "tiff"}).contains(format))
+	{
+		SendResponse(request.socket, 400, "text/plain", "Unknown image format\n");
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+
+	bool stopRequest = false;
+	cRenderJob *renderJob = new cRenderJob(gPar, gParFractal, image, &stopRequest);
+	renderJob->UseWorkerPool(workerPool);
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+
+	renderJob->Init(cRenderJob::still, config);
+	bool result = renderJob->Execute();
+	delete renderJob;
+
+	// client could disconnect during rendering
+	if (!buffers.contains(request.socket)) return;
+
+	if (!result)
+	{
+		SendResponse(request.socket, 500, "text/plain", "Rendering failed\n");
+		return;
+	}
+
+	QString output = job["output"].toString();
+	bool returnImage = output.isEmpty();
+	QString ext = (format == "png16" || format == "png16alpha") ? "png" : format;
+	if (returnImage)
+	{
+		output = QDir::tempPath() + QDir::separator() + "mandelbulber_service_"
+						 + QString::number(QCoreApplication::applicationPid()) + "." + ext;
+	}
+
+	if (format == "png16" || format == "png16alpha")
+	{
+		ImageFileSave::structSaveImageChannel saveImageChannel(
+			ImageFileSave::IMAGE_CONTENT_COLOR, ImageFileSave::IMAGE_CHANNEL_QUALITY_16, "");
+		ImageFileSavePNG::SavePNG(output, image, saveImageChannel, format == "png16alpha");
+	}
+	else
+	{
+		SaveImage(output, ImageFileSave::ImageFileType(format), image);
+	}
+	jobsDone++;
+
+	if (returnImage)
+	{
+		QFile file(output);
+		if (!file.open(QIODevice::ReadOnly))
+		{
+			SendResponse(request.socket, 500, "text/plain", "Cannot read rendered image\n");
+			return;
+		}
+		QByteArray data = file.readAll();
+		file.close();
+		QFile::remove(output);
+
+		QByteArray contentType = "image/" + ext.toLatin1();
+		if (ext == "jpg") contentType = "image/jpeg";
+		if (ext == "exr") contentType = "image/x-exr";
+		SendResponse(request.socket, 200, contentType, data);
+	}
+	else
+	{
+		QJsonObject reply;
+		reply["file"] = output;
+		reply["render_time"] = timer.elapsed() / 1000.0;
+		reply["width"] = image->GetWidth();
+		reply["height"] = image->GetHeight();
+		SendJson(request.socket, 200, reply);
+	}
+}
@@ -0,0 +1,115 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderService class - headless render service with HTTP job API
+ *
+ * Long-running process accepts render jobs on local TCP port, so rendering
+ * threads, cache of textures and parameter containers are reused between jobs.
+ * Jobs are queued and rendered one after another.
+ *
+ * POST /render - body is JSON object:
+ *   settings  - text of settings file
+ *   overrides - optional KEY1=VALUE1#KEY2=VALUE2 list
+ *   format    - image format (jpg, png, png16, png16alpha, exr, tiff), default jpg
+ *   output    - optional file name. If it's not set, the encoded image is returned
+ * GET /status - number of finished and queued jobs
+ * POST /quit - stops the service after the current job
+ */
+
+#ifndef MANDELBULBER2_SRC_RENDER_SERVICE_HPP_
+#define MANDELBULBER2_SRC_RENDER_SERVICE_HPP_
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+// forward declarations
+class QTcpServer;
+class QTcpSocket;
+class QJsonObject;
+class cImage;
+class cRenderWorkerPool;
+
+// maximum size of request [bytes]
+#define RENDER_SERVICE_MAX_REQUEST_SIZE (64 * 1024 * 1024)
+
+class cRenderService : public QObject
+{
+	Q_OBJECT
+public:
+	cRenderService(QObject *parent = NULL);
+	~cRenderService();
+
+	// starts listening on localhost. Returns false if port cannot be opened
+	bool Listen(int port);
+
+private:
+	struct sRequest
+	{
+		QTcpSocket *socket;
+		QString method;
+		QString path;
+		QByteArray body;
+	};
+
+	// returns true if whole request was received and removed from the buffer
+	static bool ParseRequest(QByteArray *buffer, sRequest *request);
+	static void SendResponse(QTcpSocket *socket, int code, const QByteArray &contentType,
+		const QByteArray &body);
+	static void SendJson(QTcpSocket *socket, int code, const QJsonObject &object);
+	void HandleRequest(const sRequest &request);
+	void ProcessQueue();
+	void RenderJob(const sRequest &request);
+
+	QTcpServer *server;
+	QHash<QTcpSocket *, QByteArray> buffers;
+	QList<sRequest> queue;
+
+	// kept between jobs
+	cRenderWorkerPool *workerPool;
+	cImage *image;
+
+	bool busy;
+	bool quitRequest;
+	int jobsDone;
+
+private slots:
+	void slotNewConnection();
+	void slotReadyRead();
+	void slotDisconnected();
+
+signals:
+	void finished();
+};
+
+#endif /* MANDELBULBER2_SRC_RENDER_SERVICE_HPP_ */
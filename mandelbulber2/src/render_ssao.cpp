@@ -41,6 +41,10 @@
 #include "render_data.hpp"
 #include "ssao_worker.h"
 #include "system.hpp"
+#include "trace.hpp"
+
+// limit of depth pyramid levels in hierarchical mode
+#define SSAO_MAX_PYRAMID_LEVELS 12
 
 cRenderSSAO::cRenderSSAO(
 	const cParamRender *_params, const sRenderData *_renderData, cImage *_image)
@@ -75,6 +79,7 @@ void cRenderSSAO::SetRegion(const cRegion<int> &_region)
 void cRenderSSAO::RenderSSAO(QList<int> *list)
 {
 	WriteLog("cRenderSSAO::RenderSSAO()", 2);
+	TRACE_SCOPE("cRenderSSAO::RenderSSAO", "post");
 	// prepare multiple threads
 	QThread **thread = new QThread *[numberOfThreads];
 	cSSAOWorker::sThreadData *threadData = new cSSAOWorker::sThreadData[numberOfThreads];
@@ -108,6 +113,9 @@ void cRenderSSAO::RenderSSAO(QList<int> *list)
 	int quality = params->ambientOcclusionQuality * params->ambientOcclusionQuality * qualityFactor;
 	if (quality < 3) quality = 3;
 
+	QList<cSSAOWorker::sDepthLevel> depthPyramid;
+	if (params->SSAO_hierarchical) PrepareDepthPyramid(&depthPyramid);
+
 	for (int i = 0; i < numberOfThreads; i++)
 	{
 		threadData[i].startLine = startLine + i;
@@ -117,6 +125,7 @@ void cRenderSSAO::RenderSSAO(QList<int> *list)
 		threadData[i].progressive = progressive;
 		threadData[i].stopRequest = false;
 		threadData[i].region = region;
+		threadData[i].depthPyramid = params->SSAO_hierarchical ? &depthPyramid : NULL;
 
 		if (list)
 			threadData[i].list = &lists[i];
@@ -212,3 +221,51 @@ void cRenderSSAO::RenderSSAO(QList<int> *list)
 
 	WriteLog("Rendering SSAO finished", 2);
 }
+
+void cRenderSSAO::PrepareDepthPyramid(QList<cSSAOWorker::sDepthLevel> *pyramid) const
+{
+	WriteLog("cRenderSSAO::PrepareDepthPyramid()", 2);
+
+	int previousWidth = region.width;
+	int previousHeight = region.height;
+	const cSSAOWorker::sDepthLevel *previous = NULL;
+
+	while (previousWidth > 1 && previousHeight > 1 && pyramid->size() < SSAO_MAX_PYRAMID_LEVELS)
+	{
+		cSSAOWorker::sDepthLevel level;
+		level.width = (previousWidth + 1) / 2;
+		level.height = (previousHeight + 1) / 2;
+		level.depth.resize(level.width * level.height);
+		float *depth = level.depth.data();
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int y = 0; y < level.height; y++)
+		{
+			for (int x = 0; x < level.width; x++)
+			{
+				// nearest depth of 2x2 block, so occluders are never lost
+				float minZ = 1e20f;
+				for (int dy = 0; dy < 2; dy++)
+				{
+					int py = min(y * 2 + dy, previousHeight - 1);
+					for (int dx = 0; dx < 2; dx++)
+					{
+						int px = min(x * 2 + dx, previousWidth - 1);
+						float z;
+						if (previous)
+							z = previous->depth[px + py * previousWidth];
+						else
+							z = image->GetPixelZBuffer(px + region.x1, py + region.y1);
+						minZ = min(minZ, z);
+					}
+				}
+				depth[x + y * level.width] = minZ;
+			}
+		}
+
+		pyramid->append(level);
+		previous = &pyramid->last();
+		previousWidth = level.width;
+		previousHeight = level.height;
+	}
+}
@@ -38,6 +38,7 @@
 #include <QObject>
 
 #include "region.hpp"
+#include "ssao_worker.h"
 
 // forward declarations
 class cImage;
@@ -56,6 +57,9 @@ public:
 	void setProgressive(double step) { progressive = step; }
 
 private:
+	// builds min depth mip levels of the region for hierarchical SSAO
+	void PrepareDepthPyramid(QList<cSSAOWorker::sDepthLevel> *pyramid) const;
+
 	const cParamRender *params;
 	const sRenderData *data;
 	cImage *image;
@@ -0,0 +1,147 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderTimeBudget class - adjusts quality of the frame to render it within time budget
+ */
+
+#include "render_time_budget.hpp"
+
+#include <cmath>
+
+#include "ao_modes.h"
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+#include "render_estimate.hpp"
+#include "system.hpp"
+
+cRenderTimeBudget::cRenderTimeBudget(double _budget)
+{
+	budget = _budget;
+	estimatedTime = 0.0;
+	originalDetailLevel = 1.0;
+}
+
+bool cRenderTimeBudget::Fit(cParameterContainer *par, const cFractalContainer &fractPar)
+{
+	changes.clear();
+	estimatedTime = 0.0;
+	originalDetailLevel = par->Get<double>("detail_level");
+
+	for (int i = 0; i < RENDER_TIME_BUDGET_MAX_ITERATIONS; i++)
+	{
+		cRenderEstimate estimate;
+		if (!estimate.Estimate(*par, fractPar)) return false;
+		estimatedTime = estimate.GetSetupTime() + estimate.GetFrameTime();
+		if (estimatedTime <= budget) break;
+
+		if (!Reduce(par, budget * RENDER_TIME_BUDGET_MARGIN / estimatedTime)) break;
+	}
+
+	if (IsOverBudget())
+	{
+		WriteLog(QString("cRenderTimeBudget: frame doesn't fit into %1 s with the lowest quality")
+							 .arg(budget),
+			2);
+	}
+	WriteLogDouble("cRenderTimeBudget: estimated time of the frame", estimatedTime, 2);
+	return true;
+}
+
+bool cRenderTimeBudget::Reduce(cParameterContainer *par, double ratio)
+{
+	// supersampling is adaptive, but in the worst case it costs size^2 samples per pixel
+	if (par->Get<bool>("antialiasing_enabled"))
+	{
+		int size = par->Get<int>("antialiasing_size");
+		int newSize = int(size * sqrt(ratio));
+		if (newSize < 2)
+		{
+			par->Set("antialiasing_enabled", false);
+			LogChange("antialiasing_enabled", "true", "false");
+		}
+		else
+		{
+			newSize = qMin(newSize, size - 1);
+			par->Set("antialiasing_size", newSize);
+			LogChange("antialiasing_size", QString::number(size), QString::number(newSize));
+		}
+		return true;
+	}
+
+	if (par->Get<bool>("DOF_enabled") && par->Get<bool>("DOF_monte_carlo"))
+	{
+		int samples = par->Get<int>("DOF_samples");
+		int newSamples = qMax(1, int(samples * ratio));
+		if (newSamples < samples)
+		{
+			par->Set("DOF_samples", newSamples);
+			LogChange("DOF_samples", QString::number(samples), QString::number(newSamples));
+			return true;
+		}
+	}
+
+	if (par->Get<bool>("ambient_occlusion_enabled"))
+	{
+		// multiple rays mode casts quality^2 rays
+		int quality = par->Get<int>("ambient_occlusion_quality");
+		bool multipleRays =
+			par->Get<int>("ambient_occlusion_mode") == int(params::AOmodeMultipeRays);
+		int newQuality = qMax(1, int(quality * (multipleRays ? sqrt(ratio) : ratio)));
+		if (newQuality < quality)
+		{
+			par->Set("ambient_occlusion_quality", newQuality);
+			LogChange(
+				"ambient_occlusion_quality", QString::number(quality), QString::number(newQuality));
+			return true;
+		}
+	}
+
+	// bigger distance threshold needs less steps, but the shape of the fractal is changed
+	double detailLevel = par->Get<double>("detail_level");
+	double newDetailLevel =
+		qMax(detailLevel * ratio, originalDetailLevel * RENDER_TIME_BUDGET_MIN_DETAIL);
+	if (newDetailLevel < detailLevel * 0.99)
+	{
+		par->Set("detail_level", newDetailLevel);
+		LogChange("detail_level", QString::number(detailLevel), QString::number(newDetailLevel));
+		return true;
+	}
+
+	return false;
+}
+
+void cRenderTimeBudget::LogChange(
+	const QString &name, const QString &oldValue, const QString &newValue)
+{
+	QString change = name + ": " + oldValue + " -> " + newValue;
+	changes.append(change);
+	WriteLog("cRenderTimeBudget: " + change, 2);
+}
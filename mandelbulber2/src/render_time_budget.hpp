@@ -0,0 +1,83 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderTimeBudget class - adjusts quality of the frame to render it within time budget
+ *
+ * Render time is estimated by cRenderEstimate from tiny sample of the frame.
+ * If it's longer than the budget, the most expensive quality settings are reduced
+ * one after another (supersampling, samples of Monte Carlo DOF, quality of
+ * ambient occlusion and at the end detail level) and the frame is estimated
+ * again. Settings of the scene are upper limit, quality is never increased.
+ */
+
+#ifndef MANDELBULBER2_SRC_RENDER_TIME_BUDGET_HPP_
+#define MANDELBULBER2_SRC_RENDER_TIME_BUDGET_HPP_
+
+#include <QStringList>
+
+// maximum number of estimations of one frame
+#define RENDER_TIME_BUDGET_MAX_ITERATIONS 6
+// estimation is noisy, so the frame is fitted into this part of the budget
+#define RENDER_TIME_BUDGET_MARGIN 0.85
+// detail level is not reduced more than this part of the original one
+#define RENDER_TIME_BUDGET_MIN_DETAIL 0.25
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+
+class cRenderTimeBudget
+{
+public:
+	cRenderTimeBudget(double _budget);
+
+	// reduces quality settings in par. Returns false if the estimation failed
+	bool Fit(cParameterContainer *par, const cFractalContainer &fractPar);
+
+	double GetEstimatedTime() const { return estimatedTime; }
+	// true if the frame still doesn't fit into the budget with the lowest quality
+	bool IsOverBudget() const { return estimatedTime > budget; }
+	// list of changed parameters: 'name: old -> new'
+	QStringList GetChanges() const { return changes; }
+
+private:
+	// reduces the first setting which still can be reduced, to speed up rendering by given ratio.
+	// Returns false if nothing can be reduced
+	bool Reduce(cParameterContainer *par, double ratio);
+	void LogChange(const QString &name, const QString &oldValue, const QString &newValue);
+
+	double budget;
+	double estimatedTime;
+	double originalDetailLevel;
+	QStringList changes;
+};
+
+#endif /* MANDELBULBER2_SRC_RENDER_TIME_BUDGET_HPP_ */
@@ -112,6 +112,9 @@ private slots:
 	void slotQuestionMessage(const QString &questionTitle, const QString &questionText,
 		QMessageBox::StandardButtons buttons, QMessageBox::StandardButton *reply);
 	void slotAutoRefresh();
+	void slotRefineRender();
+	void slotRenderRegionSelected(const QRect &rect);
+	void slotMainImageRendered();
 	void slotMaterialSelected(int matIndex);
 	void slotMaterialEdited();
 
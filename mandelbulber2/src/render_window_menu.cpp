@@ -152,7 +152,7 @@ void RenderWindow::slotMenuLoadExample()
 	PreviewFileDialog dialog(this);
 	dialog.setOption(QFileDialog::DontUseNativeDialog);
 	dialog.setFileMode(QFileDialog::ExistingFile);
-	dialog.setNameFilter(tr("Fractals (*.txt *.fract)"));
+	dialog.setNameFilter(tr("Fractals (*.txt *.fract *.fractb)"));
 	dialog.setDirectory(QDir::toNativeSeparators(
 		systemData.sharedDir + QDir::separator() + "examples" + QDir::separator()));
 	dialog.selectFile(QDir::toNativeSeparators(QFileInfo(systemData.lastSettingsFile).fileName()));
@@ -187,7 +187,7 @@ void RenderWindow::slotMenuLoadSettings()
 	PreviewFileDialog dialog(this);
 	dialog.setOption(QFileDialog::DontUseNativeDialog);
 	dialog.setFileMode(QFileDialog::ExistingFile);
-	dialog.setNameFilter(tr("Fractals (*.txt *.fract)"));
+	dialog.setNameFilter(tr("Fractals (*.txt *.fract *.fractb)"));
 	dialog.setDirectory(
 		QDir::toNativeSeparators(QFileInfo(systemData.lastSettingsFile).absolutePath()));
 	dialog.selectFile(QDir::toNativeSeparators(systemData.lastSettingsFile));
@@ -289,6 +289,7 @@ void RenderWindow::slotMenuSaveImageJPEG()
 		cProgressText::ProgressStatusText(tr("Saving %1 image").arg("JPG"), tr("Saving image started"),
 			0.0, cProgressText::progress_IMAGE);
 		gApplication->processEvents();
+		gMainInterface->CompilePreviewedImageAdjustments();
 		SaveImage(filename, ImageFileSave::IMAGE_FILE_TYPE_JPG, gMainInterface->mainImage,
 			gMainInterface->mainWindow);
 		cProgressText::ProgressStatusText(tr("Saving %1 image").arg("JPG"), tr("Saving image finished"),
@@ -315,6 +316,7 @@ void RenderWindow::slotMenuSaveImagePNG()
 		filenames = dialog.selectedFiles();
 		QString filename = QDir::toNativeSeparators(filenames.first());
 		gApplication->processEvents();
+		gMainInterface->CompilePreviewedImageAdjustments();
 		SaveImage(filename, ImageFileSave::IMAGE_FILE_TYPE_PNG, gMainInterface->mainImage,
 			gMainInterface->mainWindow);
 		gApplication->processEvents();
@@ -340,6 +342,7 @@ void RenderWindow::slotMenuSaveImageEXR()
 		filenames = dialog.selectedFiles();
 		QString filename = QDir::toNativeSeparators(filenames.first());
 		gApplication->processEvents();
+		gMainInterface->CompilePreviewedImageAdjustments();
 		SaveImage(filename, ImageFileSave::IMAGE_FILE_TYPE_EXR, gMainInterface->mainImage,
 			gMainInterface->mainWindow);
 		gApplication->processEvents();
@@ -366,6 +369,7 @@ void RenderWindow::slotMenuSaveImageTIFF()
 		filenames = dialog.selectedFiles();
 		QString filename = QDir::toNativeSeparators(filenames.first());
 		gApplication->processEvents();
+		gMainInterface->CompilePreviewedImageAdjustments();
 		SaveImage(filename, ImageFileSave::IMAGE_FILE_TYPE_TIFF, gMainInterface->mainImage,
 			gMainInterface->mainWindow);
 		gApplication->processEvents();
@@ -395,6 +399,7 @@ void RenderWindow::slotMenuSaveImagePNG16()
 		gApplication->processEvents();
 		ImageFileSave::structSaveImageChannel saveImageChannel(
 			ImageFileSave::IMAGE_CONTENT_COLOR, ImageFileSave::IMAGE_CHANNEL_QUALITY_16, "");
+		gMainInterface->CompilePreviewedImageAdjustments();
 		ImageFileSavePNG::SavePNG(filename, gMainInterface->mainImage, saveImageChannel, false);
 		cProgressText::ProgressStatusText(tr("Saving %1 image").arg("16-bit PNG"),
 			tr("Saving image finished"), 1.0, cProgressText::progress_IMAGE);
@@ -424,6 +429,7 @@ void RenderWindow::slotMenuSaveImagePNG16Alpha()
 		gApplication->processEvents();
 		ImageFileSave::structSaveImageChannel saveImageChannel(
 			ImageFileSave::IMAGE_CONTENT_COLOR, ImageFileSave::IMAGE_CHANNEL_QUALITY_16, "");
+		gMainInterface->CompilePreviewedImageAdjustments();
 		ImageFileSavePNG::SavePNG(filename, gMainInterface->mainImage, saveImageChannel, true);
 		cProgressText::ProgressStatusText(tr("Saving %1 image").arg("16-bit PNG + alpha channel"),
 			tr("Saving image finished"), 1.0, cProgressText::progress_IMAGE);
@@ -441,7 +447,8 @@ void RenderWindow::slotMenuSaveSettings()
 	QFileDialog dialog(this);
 	dialog.setOption(QFileDialog::DontUseNativeDialog);
 	dialog.setFileMode(QFileDialog::AnyFile);
-	dialog.setNameFilter(tr("Fractals (*.txt *.fract)"));
+	dialog.setNameFilters(
+		QStringList() << tr("Fractals (*.txt *.fract)") << tr("Binary fractals (*.fractb)"));
 	dialog.setDirectory(
 		QDir::toNativeSeparators(QFileInfo(systemData.lastSettingsFile).absolutePath()));
 	dialog.selectFile(
@@ -454,6 +461,9 @@ void RenderWindow::slotMenuSaveSettings()
 	{
 		filenames = dialog.selectedFiles();
 		QString filename = QDir::toNativeSeparators(filenames.first());
+		// binary format keeps animation frames as tables which load much faster
+		if (QFileInfo(filename).suffix().toLower() == "fractb")
+			parSettings.CreateBinary(gPar, gParFractal, gAnimFrames, gKeyframes);
 		parSettings.SaveToFile(filename);
 		systemData.lastSettingsFile = filename;
 		this->setWindowTitle(QString("Mandelbulber (") + filename + ")");
@@ -449,6 +449,21 @@ void RenderWindow::slotAutoRefresh(void)
 	gMainInterface->PeriodicRefresh();
 }
 
+void RenderWindow::slotRefineRender()
+{
+	gMainInterface->RefineRender();
+}
+
+void RenderWindow::slotRenderRegionSelected(const QRect &rect)
+{
+	gMainInterface->RenderRegion(rect);
+}
+
+void RenderWindow::slotMainImageRendered()
+{
+	gMainInterface->MainImageRendered();
+}
+
 void RenderWindow::slotMaterialSelected(int matIndex)
 {
 	gMainInterface->MaterialSelected(matIndex);
@@ -35,19 +35,34 @@
 #include "render_worker.hpp"
 #include "calculate_distance.hpp"
 #include "common_math.h"
+#include "compute_fractal.hpp"
 #include "region.hpp"
 #include <QtCore>
+#include <algorithm>
 
+#include "adaptive_sampling.hpp"
+#include "anti_aliasing.hpp"
+#include "ao_buffer.hpp"
 #include "ao_modes.h"
 #include "camera_target.hpp"
+#include "checkerboard_render.hpp"
 #include "cimage.hpp"
+#include "depth_prepass.hpp"
+#include "distance_cache.hpp"
+#include "double_double.hpp"
+#include "progressive_depth.hpp"
 #include "material.h"
+#include "nine_fractals.hpp"
+#include "numa_topology.hpp"
 #include "projection_3d.hpp"
 #include "render_data.hpp"
 #include "stereo.h"
+#include "temporal_depth.hpp"
 #include "fractparams.hpp"
 #include "scheduler.hpp"
+#include "tile_scheduler.hpp"
 #include "system.hpp"
+#include "trace.hpp"
 
 cRenderWorker::cRenderWorker(const cParamRender *_params, const cNineFractals *_fractal,
 	sThreadData *_threadData, sRenderData *_data, cImage *_image)
@@ -57,8 +72,11 @@ cRenderWorker::cRenderWorker(const cParamRender *_params, const cNineFractals *_
 	data = _data;
 	image = _image;
 	threadData = _threadData;
+	pinnedCpu = -1;
 	cameraTarget = NULL;
 	rayBuffer = NULL;
+	rayStack = NULL;
+	packetRayBuffer = NULL;
 	AOvectorsAround = NULL;
 	AOvectorsCount = 0;
 	baseX = CVector3(1.0, 0.0, 0.0);
@@ -66,7 +84,16 @@ cRenderWorker::cRenderWorker(const cParamRender *_params, const cNineFractals *_
 	baseZ = CVector3(0.0, 0.0, 1.0);
 	maxraymarchingSteps = 10000;
 	reflectionsMax = 0;
+	rayBufferSize = 0;
 	stopRequest = false;
+	jobChanged = true;
+	limitBoxClipping = false;
+	recordSteps = false;
+	fusedFractalColouring = false;
+	wavefrontShadows = false;
+	wavefrontShadow = NULL;
+	shaderVariant = &shaderVariants[numberOfShaderVariants - 1];
+	DOFSampleBank = 0;
 }
 
 cRenderWorker::~cRenderWorker()
@@ -77,13 +104,16 @@ cRenderWorker::~cRenderWorker()
 		cameraTarget = NULL;
 	}
 
-	if (rayBuffer)
+	FreeReflectionBuffer();
+
+	if (packetRayBuffer)
 	{
-		for (int i = 0; i < reflectionsMax + 3; i++)
+		for (int i = 0; i < RAY_PACKET_SIZE; i++)
 		{
-			delete[] rayBuffer[i].stepBuff;
+			delete packetRayBuffer[i].stepBuff;
 		}
-		delete[] rayBuffer;
+		delete[] packetRayBuffer;
+		packetRayBuffer = NULL;
 	}
 
 	if (AOvectorsAround)
@@ -93,13 +123,105 @@ cRenderWorker::~cRenderWorker()
 	}
 }
 
+void cRenderWorker::UpdateJob(
+	const cParamRender *_params, const cNineFractals *_fractal, sRenderData *_data, cImage *_image)
+{
+	params = _params;
+	fractal = _fractal;
+	data = _data;
+	image = _image;
+	jobChanged = true;
+}
+
+// preparation of job dependent data. Done only once for all progressive passes
+void cRenderWorker::PrepareJob(void)
+{
+	PrepareMainVectors();
+
+	// without consumers of ray-marching steps they are only counted
+	recordSteps = VolumetricEffectsEnabled(params, data) || data->progressiveDepth;
+
+	PrepareReflectionBuffer();
+	if (params->packetRayMarching && !packetRayBuffer)
+	{
+		packetRayBuffer = new sRayBuffer[RAY_PACKET_SIZE];
+		for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		{
+			packetRayBuffer[i].stepBuff = NULL;
+			packetRayBuffer[i].buffCount = 0;
+		}
+	}
+	if (packetRayBuffer && recordSteps)
+	{
+		for (int i = 0; i < RAY_PACKET_SIZE; i++)
+		{
+			if (!packetRayBuffer[i].stepBuff)
+				packetRayBuffer[i].stepBuff = new sStepBuffer(maxraymarchingSteps + 2);
+		}
+	}
+	if (params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeMultipeRays)
+		PrepareAOVectors();
+
+	// rays can be clipped to limit box only if no volumetric effect is accumulated outside of it
+	limitBoxClipping = params->limitsEnabled && !VolumetricEffectsEnabled(params, data);
+
+	// with boolean operators colour is calculated in coordinates of the hit formula by shader
+	fusedFractalColouring = params->fusedFractalColouring && !params->booleanOperatorsEnabled;
+
+	// shadow rays traced out of shaders can't integrate volumetric effects
+	wavefrontShadows = params->wavefrontShadows && params->packetRayMarching && params->shadow
+										 && params->mainLightEnable && !recordSteps && !params->iterFogEnabled
+										 && !params->volumetricLightEnabled[0] && !data->shadowCache;
+
+	DOFSampleBank = 0;
+
+	// branches of disabled shader features are removed from specialized variants
+	shaderVariant = &shaderVariants[SelectShaderVariant(params, data)];
+
+	sampler.SetType(params->samplerType);
+	sampler.Seed(threadData->id + 1);
+
+	auxLightCandidates.reserve(data->lights.GetNumberOfLights());
+	auxLightWeights.reserve(data->lights.GetNumberOfLights());
+
+	if (params->volumetricAdaptive) volumetricDensity.resize(maxraymarchingSteps + 2);
+
+	jobChanged = false;
+}
+
+bool cRenderWorker::VolumetricEffectsEnabled(const cParamRender *params, const sRenderData *data)
+{
+	return params->glowEnabled || params->fogEnabled || params->volFogEnabled
+				 || params->iterFogEnabled || params->fakeLightsEnabled
+				 || params->volumetricLightAnyEnabled
+				 || (data->lights.IsAnyLightEnabled() && params->auxLightVisibility > 0);
+}
+
 // main render engine function called as multiple threads
 void cRenderWorker::doWork(void)
 {
 	// here will be rendering thread
+	if (threadData->cpu != pinnedCpu)
+	{
+		if (!cNumaTopology::SetCurrentThreadAffinity(threadData->cpu))
+			WriteLogDouble("Cannot bind rendering thread to CPU", threadData->cpu, 2);
+		pinnedCpu = threadData->cpu;
+	}
+
+	threadData->stageTimer.Start();
+	RenderPass();
+	threadData->stageTimer.Stop();
+
+	// emit signal to main thread when finished
+	emit finished();
+}
+
+void cRenderWorker::RenderPass(void)
+{
 	int width = image->GetWidth();
 	int height = image->GetHeight();
-	double aspectRatio = (double)width / height;
+	// tiles use aspect ratio of the whole image
+	double aspectRatio = (double)data->fullImageSize.x / data->fullImageSize.y;
 
 	if (params->perspectiveType == params::perspEquirectangular) aspectRatio = 2.0;
 
@@ -108,20 +230,61 @@ void cRenderWorker::doWork(void)
 	if (data->stereo.isEnabled() && (params->perspectiveType != params::perspEquirectangular))
 		aspectRatio = data->stereo.ModifyAspectRatio(aspectRatio);
 
-	PrepareMainVectors();
-	PrepareReflectionBuffer();
-	if (params->ambientOcclusionEnabled && params->ambientOcclusionMode == params::AOmodeMultipeRays)
-		PrepareAOVectors();
+	if (jobChanged) PrepareJob();
+
+	// image buffers are cleared by all threads before first pass
+	if (data->firstTouchClear)
+	{
+		int numberOfThreads = data->configuration.GetNumberOfThreads();
+		int index = threadData->id - 1;
+		image->ClearImageLines((qint64)height * index / numberOfThreads,
+			(qint64)height * (index + 1) / numberOfThreads);
+		return;
+	}
+
+	// coarse depth prepass is rendered by all threads before main passes
+	if (data->depthPrepass && data->depthPrepass->IsRendering())
+	{
+		RenderDepthPrepass(aspectRatio);
+		return;
+	}
+
+	// ambient occlusion in reduced resolution is rendered by all threads before main passes
+	if (data->aoBuffer && data->aoBuffer->IsRendering())
+	{
+		RenderAOPrepass(aspectRatio);
+		return;
+	}
+
+	// supersampling of edge pixels is done by all threads after main passes
+	if (data->antiAliasing && data->antiAliasing->IsRendering())
+	{
+		RenderAntiAliasing(aspectRatio);
+		return;
+	}
 
 	// init of scheduler
 	cScheduler *scheduler = threadData->scheduler;
 
-	// start point for ray-marching
-	CVector3 start = params->camera;
+	// packets of primary rays can be used only if there is one ray per pixel
+	bool usePackets = params->packetRayMarching && !monteCarloDOF && !data->stereo.isEnabled()
+										&& !data->relighting;
+	// rays of both eyes of single-pass stereo are always marched together
+	if (data->stereoSinglePass) usePackets = true;
+	int packetSize = data->stereoSinglePass ? RAY_PACKET_SIZE / 2 : RAY_PACKET_SIZE;
+
+	if (scheduler->IsTileScheduler())
+	{
+		RenderTiles(static_cast<cTileScheduler *>(scheduler), aspectRatio, monteCarloDOF, usePackets);
+
+		return;
+	}
 
 	scheduler->InitFirstLine(threadData->id, threadData->startLine);
 
 	bool lastLineWasBroken = false;
+	int packetX[RAY_PACKET_SIZE];
+	int packetCount = 0;
 
 	// main loop for y
 	for (int ys = threadData->startLine; scheduler->ThereIsStillSomethingToDo(threadData->id);
@@ -131,6 +294,8 @@ void cRenderWorker::doWork(void)
 		if (ys < 0) break;
 		if (ys < data->screenRegion.y1 || ys > data->screenRegion.y2) continue;
 
+		TRACE_SCOPE_ARG("line", "worker", "y", ys);
+
 		// main loop for x
 		for (int xs = 0; xs < width; xs += scheduler->GetProgressiveStep())
 		{
@@ -143,239 +308,1334 @@ void cRenderWorker::doWork(void)
 				break;
 			}
 
-			if (scheduler->GetProgressivePass() > 1 && xs % (scheduler->GetProgressiveStep() * 2) == 0
-					&& ys % (scheduler->GetProgressiveStep() * 2) == 0)
+			if (scheduler->GetProgressivePass() > 1
+					&& RenderedInPreviousPass(xs, ys, scheduler->GetProgressiveStep()))
 				continue;
 
 			// skip if pixel is out of region;
 			if (xs < data->screenRegion.x1 || xs > data->screenRegion.x2) continue;
 
-			// calculate point in image coordinate system
-			CVector2<int> screenPoint(xs, ys);
-			CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
-			cStereo::enumEye stereoEye = data->stereo.WhichEye(imagePoint);
-			if (data->stereo.isEnabled())
+			// pixels of the second eye were rendered with the first one
+			if (data->stereoSinglePass && IsSecondStereoEyePixel(xs, ys)) continue;
+
+			// pixels between sparse samples are interpolated after main passes
+			if (data->adaptiveSampling && !data->adaptiveSampling->IsRendered(xs, ys)) continue;
+
+			// the other half of checkerboard pattern is reconstructed from previous frame
+			if (data->checkerboard && !data->checkerboard->IsRendered(xs, ys)) continue;
+
+			if (usePackets)
 			{
-				imagePoint = data->stereo.ModifyImagePoint(imagePoint);
+				packetX[packetCount++] = xs;
+				if (packetCount == packetSize)
+				{
+					RenderPixelPacket(packetX, packetCount, ys, scheduler->GetProgressiveStep(), aspectRatio);
+					packetCount = 0;
+				}
 			}
-			imagePoint.x *= aspectRatio;
+			else
+			{
+				RenderPixel(xs, ys, scheduler->GetProgressiveStep(), aspectRatio, monteCarloDOF);
+			}
+		} // next xs
 
-			// full dome shemisphere cut
-			bool hemisphereCut = false;
-			if (params->perspectiveType == params::perspFishEyeCut
-					&& imagePoint.Length() > 0.5 / params->fov)
-				hemisphereCut = true;
+		// remaining pixels of the line
+		if (packetCount > 0 && !lastLineWasBroken)
+			RenderPixelPacket(packetX, packetCount, ys, scheduler->GetProgressiveStep(), aspectRatio);
+		packetCount = 0;
+	} // next ys
+}
 
-			//---------------- 1us -------------
+// main loop for tile based scheduler
+void cRenderWorker::RenderTiles(
+	cTileScheduler *scheduler, double aspectRatio, bool monteCarloDOF, bool usePackets)
+{
+	int width = image->GetWidth();
+	int progressiveStep = scheduler->GetProgressiveStep();
+	bool progressiveSkip = scheduler->GetProgressivePass() > 1;
+	int packetSize = data->stereoSinglePass ? RAY_PACKET_SIZE / 2 : RAY_PACKET_SIZE;
 
-			// Ray marching
-			int repeats = data->stereo.GetNumberOfRepeats();
+	for (int tile = scheduler->NextTile(threadData->id); tile >= 0;
+			 tile = scheduler->NextTile(threadData->id))
+	{
+		TRACE_SCOPE_ARG("tile", "worker", "tile", tile);
+		cRegion<int> tileRegion = scheduler->GetTileRegion(tile);
+		bool tileWasBroken = false;
 
-			sRGBfloat finallPixel;
-			sRGBfloat pixelLeftEye;
-			sRGBfloat pixelRightEye;
-			sRGB8 colour;
-			unsigned short alpha = 65535;
-			unsigned short opacity16 = 65535;
-			sRGBfloat normalFloat;
-			double depth = 1e20;
+		// pixels are collected and rendered together after the whole tile is scanned
+		bool useWavefront = usePackets && wavefrontShadows && !data->stereoSinglePass;
+		if (useWavefront)
+		{
+			wavefront.xs.clear();
+			wavefront.ys.clear();
+		}
 
-			if (monteCarloDOF) repeats = params->DOFSamples;
+		for (int ys = tileRegion.y1; ys < tileRegion.y2; ys += progressiveStep)
+		{
+			// skip if line is out of region
+			if (ys < data->screenRegion.y1 || ys >= data->screenRegion.y2) continue;
+
+			// break if tile was rendered by other computer (NetRender) or rendering was stopped
+			if (scheduler->ShouldIBreakTile(tile) || systemData.globalStopRequest)
+			{
+				tileWasBroken = true;
+				break;
+			}
 
-			sRGBfloat finalPixelDOF;
+			int packetX[RAY_PACKET_SIZE];
+			int packetCount = 0;
 
-			for (int repeat = 0; repeat < repeats; repeat++)
+			for (int xs = tileRegion.x1; xs < tileRegion.x2 && xs < width; xs += progressiveStep)
 			{
+				// pixels already rendered in previous progressive pass
+				if (progressiveSkip && RenderedInPreviousPass(xs, ys, progressiveStep)) continue;
+
+				// skip if pixel is out of region;
+				if (xs < data->screenRegion.x1 || xs >= data->screenRegion.x2) continue;
+
+				// pixels of the second eye were rendered with the first one
+				if (data->stereoSinglePass && IsSecondStereoEyePixel(xs, ys)) continue;
+
+				// pixels between sparse samples are interpolated after main passes
+				if (data->adaptiveSampling && !data->adaptiveSampling->IsRendered(xs, ys)) continue;
 
-				CVector3 viewVector;
-				CVector3 startRay;
+				// the other half of checkerboard pattern is reconstructed from previous frame
+				if (data->checkerboard && !data->checkerboard->IsRendered(xs, ys)) continue;
 
-				if (monteCarloDOF)
+				if (useWavefront)
 				{
-					MonteCarloDOF(imagePoint, &startRay, &viewVector);
+					wavefront.xs.append(xs);
+					wavefront.ys.append(ys);
 				}
-				else
+				else if (usePackets)
 				{
-					// calculate direction of ray-marching
-					viewVector = CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
-					startRay = start;
-				}
-
-				if (data->stereo.isEnabled())
-				{
-					data->stereo.WhichEyeForAnaglyph(&stereoEye, repeat);
-					if (params->perspectiveType == params::perspFishEyeCut)
-					{
-						CVector3 eyePosition;
-						CVector3 sideVector = viewVector.Cross(params->topVector);
-						sideVector.Normalize();
-						double eyeDistance = params->stereoEyeDistance;
-						if (data->stereo.AreSwapped()) eyeDistance *= -1.0;
-
-						if (stereoEye == cStereo::eyeLeft)
-						{
-							eyePosition =
-								startRay
-								+ 0.5 * (cameraTarget->GetRightVector() * eyeDistance + sideVector * eyeDistance);
-						}
-						else
-						{
-							eyePosition =
-								startRay
-								- 0.5 * (cameraTarget->GetRightVector() * eyeDistance + sideVector * eyeDistance);
-						}
-						startRay = eyePosition;
-					}
-					else
+					packetX[packetCount++] = xs;
+					if (packetCount == packetSize)
 					{
-						startRay = data->stereo.CalcEyePosition(
-							startRay, viewVector, params->topVector, params->stereoEyeDistance, stereoEye);
-						data->stereo.ViewVectorCorrection(params->stereoInfiniteCorrection, mRot, mRotInv,
-							stereoEye, params->perspectiveType, &viewVector);
+						RenderPixelPacket(packetX, packetCount, ys, progressiveStep, aspectRatio);
+						packetCount = 0;
 					}
 				}
+				else
+				{
+					RenderPixel(xs, ys, progressiveStep, aspectRatio, monteCarloDOF);
+				}
+			}
 
-				sRGBAfloat resultShader;
-				sRGBAfloat objectColour;
-				CVector3 normal;
+			// remaining pixels of the tile line
+			if (packetCount > 0) RenderPixelPacket(packetX, packetCount, ys, progressiveStep, aspectRatio);
+		}
 
-				double opacity = 1.0;
-				depth = 1e20;
+		if (useWavefront && !tileWasBroken) RenderWavefrontTile(progressiveStep, aspectRatio);
 
-				// raymarching loop (reflections)
+		if (!tileWasBroken) scheduler->TileDone(tile);
+	}
+}
 
-				if (!hemisphereCut) // in fulldome mode, will not render pixels out of the fulldome
-				{
-					sRayRecursionIn recursionIn;
-
-					sRayMarchingIn rayMarchingIn;
-					CVector3 direction = viewVector;
-					direction.Normalize();
-					rayMarchingIn.binaryEnable = true;
-					rayMarchingIn.direction = direction;
-					rayMarchingIn.maxScan = params->viewDistanceMax;
-					rayMarchingIn.minScan = params->viewDistanceMin;
-					rayMarchingIn.start = startRay;
-					rayMarchingIn.invertMode = false;
-					recursionIn.rayMarchingIn = rayMarchingIn;
-					recursionIn.calcInside = false;
-					recursionIn.resultShader = resultShader;
-					recursionIn.objectColour = objectColour;
-
-					sRayRecursionInOut recursionInOut;
-					sRayMarchingInOut rayMarchingInOut;
-					rayMarchingInOut.buffCount = &rayBuffer[0].buffCount;
-					rayMarchingInOut.stepBuff = rayBuffer[0].stepBuff;
-					recursionInOut.rayMarchingInOut = rayMarchingInOut;
-					recursionInOut.rayIndex = 0;
-
-					sRayRecursionOut recursionOut = RayRecursion(recursionIn, recursionInOut);
-
-					resultShader = recursionOut.resultShader;
-					objectColour = recursionOut.objectColour;
-					depth = recursionOut.rayMarchingOut.depth;
-					if (!recursionOut.found) depth = 1e20;
-					opacity = recursionOut.fogOpacity;
-					normal = recursionOut.normal;
-				}
+// rendering of coarse depth buffer. For each block of pixels one cone, which encloses rays of all
+// pixels of the block, is marched until it touches the surface
+void cRenderWorker::RenderDepthPrepass(double aspectRatio)
+{
+	cDepthPrepass *prepass = data->depthPrepass;
 
-				finallPixel.R = resultShader.R;
-				finallPixel.G = resultShader.G;
-				finallPixel.B = resultShader.B;
+	for (int by = prepass->NextRow(); by >= 0; by = prepass->NextRow())
+	{
+		for (int bx = 0; bx < prepass->GetWidth(); bx++)
+		{
+			if (systemData.globalStopRequest || *data->stopRequest) return;
 
-				if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
-				{
-					if (stereoEye == cStereo::eyeLeft)
-					{
-						pixelLeftEye.R += finallPixel.R;
-						pixelLeftEye.G += finallPixel.G;
-						pixelLeftEye.B += finallPixel.B;
-					}
-					else if (stereoEye == cStereo::eyeRight)
-					{
-						pixelRightEye.R += finallPixel.R;
-						pixelRightEye.G += finallPixel.G;
-						pixelRightEye.B += finallPixel.B;
-					}
-				}
+			CVector2<double> imagePoint =
+				data->screenRegion.transpose(data->imageRegion, prepass->GetBlockCenter(bx, by));
+			imagePoint.x *= aspectRatio;
+			CVector3 direction =
+				CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+			direction.Normalize();
 
-				alpha = resultShader.A * 65535;
-				opacity16 = opacity * 65535;
+			// distance between directions of central ray and corner rays
+			CVector2<int> corner = prepass->GetBlockCorner(bx, by, 0);
+			double coneFactor =
+				ConeFactor(corner.x, corner.y, prepass->GetBlockSize(), aspectRatio, direction);
 
-				colour.R = objectColour.R * 255;
-				colour.G = objectColour.G * 255;
-				colour.B = objectColour.B * 255;
+			prepass->SetDepth(bx, by, ConeMarchingDepth(params->camera, direction, coneFactor));
+		}
+	}
+}
 
-				if (image->GetImageOptional()->optionalNormal)
-				{
-					CVector3 normalRotated = mRotInv.RotateVector(normal);
-					normalFloat.R = (1.0 + normalRotated.x) / 2.0;
-					normalFloat.G = (1.0 + normalRotated.z) / 2.0;
-					normalFloat.B = 1.0 - normalRotated.y;
-				}
+// rendering of multi-ray ambient occlusion for every n-th pixel. Only first hits of primary rays
+// are calculated, without reflections and transparency
+void cRenderWorker::RenderAOPrepass(double aspectRatio)
+{
+	cAOBuffer *aoBuffer = data->aoBuffer;
+
+	for (int by = aoBuffer->NextRow(); by >= 0; by = aoBuffer->NextRow())
+	{
+		for (int bx = 0; bx < aoBuffer->GetWidth(); bx++)
+		{
+			if (systemData.globalStopRequest || *data->stopRequest) return;
+
+			CVector2<int> screenPoint = aoBuffer->GetSamplePixel(bx, by);
+			CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
+			imagePoint.x *= aspectRatio;
+			CVector3 direction =
+				CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+			direction.Normalize();
+
+			sRayMarchingIn in;
+			in.binaryEnable = true;
+			in.direction = direction;
+			in.maxScan = params->viewDistanceMax;
+			in.minScan = params->viewDistanceMin;
+			if (data->depthPrepass)
+				in.minScan =
+					max(in.minScan, data->depthPrepass->GetStartDistance(screenPoint.x, screenPoint.y));
+			in.start = params->camera;
+			in.invertMode = false;
+			in.gatherFractalData = false; // only distance and normal are used by AO
+
+			sRayMarchingInOut inOut = RayMarchingBuffers(0, recordSteps);
+			sRayMarchingOut out;
+			CVector3 point = RayMarching(in, &inOut, &out);
+			if (!out.found) continue;
+
+			sShaderInputData input;
+			input.distThresh = out.distThresh;
+			input.delta = CalcDelta(point);
+			input.lightVect = shadowVector;
+			input.point = point;
+			input.viewVector = direction;
+			input.lastDist = out.lastDist;
+			input.depth = out.depth;
+			input.stepCount = *inOut.buffCount;
+			input.stepBuff = inOut.stepBuff;
+			input.invertMode = false;
+			input.primaryRay = true;
+			input.objectId = out.objectId;
+			input.material = &data->materials[data->objectData[out.objectId].materialId];
+			input.fractalDataValid = false;
+			input.normal = CalculateNormals(input);
+
+			aoBuffer->SetSample(bx, by, AmbientOcclusion(input), out.depth, input.normal);
+		}
+	}
+}
 
-				finalPixelDOF.R += finallPixel.R;
-				finalPixelDOF.G += finallPixel.G;
-				finalPixelDOF.B += finallPixel.B;
+// marches cone around the ray. Returns distance to which all rays inside the cone are at least two
+// distance thresholds away from the surface
+double cRenderWorker::ConeMarchingDepth(CVector3 start, CVector3 direction, double coneFactor)
+{
+	double scan = params->viewDistanceMin;
+	double stepFactor = min(params->DEFactor, 1.0);
 
-			} // next repeat
+	for (int i = 0; i < maxraymarchingSteps; i++)
+	{
+		CVector3 point = start + direction * scan;
+		double distThresh = CalcDistThresh(point);
 
-			if (monteCarloDOF)
+		sDistanceIn distanceIn(point, distThresh, false);
+		sDistanceOut distanceOut;
+		double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
+		CountDistance(distanceOut);
+		if (dist > 3.0) dist = 3.0;
+
+		// part of the unbound sphere not used by cone radius
+		double freeDistance = dist * stepFactor - 2.0 * distThresh - scan * coneFactor;
+		if (freeDistance < 0.5 * distThresh)
+		{
+			// safety margin
+			return max(params->viewDistanceMin, scan - distThresh);
+		}
+
+		scan += freeDistance / (1.0 + coneFactor);
+		if (scan > params->viewDistanceMax) return params->viewDistanceMax;
+	}
+	return params->viewDistanceMin;
+}
+
+// distance between given ray direction and rays of corners of block of pixels starting at xs, ys
+double cRenderWorker::ConeFactor(
+	int xs, int ys, int blockSize, double aspectRatio, CVector3 direction) const
+{
+	double coneFactor = 0.0;
+	for (int corner = 0; corner < 4; corner++)
+	{
+		CVector2<int> cornerPixel(xs + (corner & 1) * blockSize, ys + ((corner >> 1) & 1) * blockSize);
+		CVector2<double> cornerPoint = data->screenRegion.transpose(data->imageRegion, cornerPixel);
+		cornerPoint.x *= aspectRatio;
+		CVector3 cornerDirection =
+			CalculateViewVector(cornerPoint, params->fov, params->perspectiveType, mRot);
+		cornerDirection.Normalize();
+		coneFactor = max(coneFactor, (cornerDirection - direction).Length());
+	}
+	return coneFactor;
+}
+
+// start distance of primary ray known from previous progressive pass
+double cRenderWorker::ProgressiveStartDistance(int xs, int ys, int progressiveStep) const
+{
+	if (data->progressiveDepth && threadData->scheduler->GetProgressivePass() > 1)
+	{
+		return max(
+			params->viewDistanceMin, data->progressiveDepth->GetStartDistance(xs, ys, progressiveStep));
+	}
+	return params->viewDistanceMin;
+}
+
+// finds distance to which the whole block of pixels refined in next progressive pass is free of
+// surface. Unbound spheres recorded during ray-marching of the pixel are used as a cone marching
+void cRenderWorker::StoreProgressiveDepth(int xs, int ys, int progressiveStep, double aspectRatio,
+	const sRayMarchingIn &in, double freeStart, const sRayBuffer &buffer)
+{
+	if (progressiveStep <= 1) return;
+
+	double coneFactor = ConeFactor(xs, ys, progressiveStep, aspectRatio, in.direction);
+	double stepFactor = min(params->DEFactor, 1.0);
+	double freeDistance = freeStart;
+	double margin = 0.0;
+
+	if (coneFactor < 1.0)
+	{
+		const sStepBuffer *steps = buffer.stepBuff;
+		for (int i = 0; i < buffer.buffCount; i++)
+		{
+			double scan = (steps->Point(i) - in.start).Length();
+			double distance = steps->distance[i];
+			double radius = min(distance, 3.0) * stepFactor - 2.0 * steps->distThresh[i];
+			if (radius <= 0.0) break;
+
+			// part of the ray covered by the sphere for all rays of the cone
+			double coveredFrom = (scan - radius) / (1.0 - coneFactor);
+			double coveredTo = (scan + radius) / (1.0 + coneFactor);
+			if (coveredFrom > freeDistance) break;
+			if (coveredTo > freeDistance)
 			{
-				if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
-				{
-					finallPixel = data->stereo.MixColorsRedCyan(pixelLeftEye, pixelRightEye);
-					finallPixel.R = finallPixel.R / repeats * 2.0;
-					finallPixel.G = finallPixel.G / repeats * 2.0;
-					finallPixel.B = finallPixel.B / repeats * 2.0;
-				}
+				freeDistance = coveredTo;
+				margin = step.distThresh;
+			}
+		}
+	}
+
+	freeDistance = max(freeStart, freeDistance - margin);
+	data->progressiveDepth->SetDepth(xs, ys, min(freeDistance, in.maxScan));
+}
+
+// rendering of single pixel (result is copied to whole progressive block)
+void cRenderWorker::RenderPixel(
+	int xs, int ys, int progressiveStep, double aspectRatio, bool monteCarloDOF)
+{
+	if (data->relighting)
+	{
+		RelightPixel(xs, ys, progressiveStep, aspectRatio);
+		return;
+	}
+	RenderPixel(xs, ys, progressiveStep, aspectRatio, monteCarloDOF, CVector2<double>(), NULL);
+}
+
+// rendering of pixel shifted by sub-pixel offset. If sampleOut is not NULL, the colour is only
+// returned and nothing is stored in the image
+void cRenderWorker::RenderPixel(int xs, int ys, int progressiveStep, double aspectRatio,
+	bool monteCarloDOF, CVector2<double> subPixel, sRGBfloat *sampleOut)
+{
+	// size of pixel in image coordinate system
+	CVector2<double> pixelSize(data->imageRegion.width / data->screenRegion.width,
+		data->imageRegion.height / data->screenRegion.height);
+
+	// calculate point in image coordinate system
+	CVector2<int> screenPoint(xs, ys);
+	CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
+	shadedPixel = CVector2<double>(xs + subPixel.x, ys + subPixel.y);
+	pixelCost = sPixelCost();
+	sampler.SetPixel(xs, ys);
+	imagePoint.x += subPixel.x * pixelSize.x;
+	imagePoint.y += subPixel.y * pixelSize.y;
+	cStereo::enumEye stereoEye = data->stereo.WhichEye(imagePoint);
+	if (data->stereo.isEnabled())
+	{
+		imagePoint = data->stereo.ModifyImagePoint(imagePoint);
+	}
+	imagePoint.x *= aspectRatio;
+
+	// full dome shemisphere cut
+	bool hemisphereCut = false;
+	if (params->perspectiveType == params::perspFishEyeCut
+			&& imagePoint.Length() > 0.5 / params->fov)
+		hemisphereCut = true;
+
+	//---------------- 1us -------------
+
+	// Ray marching
+	int repeats = data->stereo.GetNumberOfRepeats();
+
+	sRGBfloat finallPixel;
+	sRGBfloat pixelLeftEye;
+	sRGBfloat pixelRightEye;
+	sRGB8 colour;
+	unsigned short alpha = 65535;
+	unsigned short opacity16 = 65535;
+	sRGBfloat normalFloat;
+	sRGBfloat worldPosition;
+	float objectId = -1.0f;
+	double depth = 1e20;
+
+	if (monteCarloDOF) repeats = params->DOFSamples;
+
+	sRGBfloat finalPixelDOF;
+
+	// adaptive Monte Carlo DOF: sampling is stopped when noise of pixel brightness is low enough
+	bool redCyan = data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan;
+	bool adaptiveDOF = monteCarloDOF && params->DOFMaxNoise > 0.0 && !redCyan;
+	int maxRepeats = repeats;
+	// samples above 'DOF_samples' are taken from the budget saved by previous pixels
+	if (adaptiveDOF && params->DOFAdaptiveRedistribution)
+		maxRepeats += max(0, min(DOFSampleBank, repeats));
+	int samples = 0;
+	double brightnessMean = 0.0;
+	double brightnessM2 = 0.0;
+
+	for (int repeat = 0; repeat < maxRepeats; repeat++)
+	{
+
+		CVector3 viewVector;
+		CVector3 startRay;
+
+		if (monteCarloDOF)
+		{
+			// rays of Monte Carlo DOF are spread over whole pixel area, so they are anti-aliased
+			CVector2<double> samplePoint = imagePoint;
+			if (params->antialiasingEnabled)
+			{
+				CVector2<double> jitter = sampler.Get2D(repeat, 1);
+				samplePoint.x += (jitter.x - 0.5) * pixelSize.x * aspectRatio;
+				samplePoint.y += (jitter.y - 0.5) * pixelSize.y;
+			}
+			MonteCarloDOF(samplePoint, repeat, &startRay, &viewVector);
+		}
+		else
+		{
+			// calculate direction of ray-marching
+			viewVector = CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+			startRay = params->camera;
+		}
+
+		if (data->stereo.isEnabled())
+		{
+			data->stereo.WhichEyeForAnaglyph(&stereoEye, repeat);
+			StereoEyeRay(stereoEye, &startRay, &viewVector);
+		}
+
+		sRGBAfloat resultShader;
+		sRGBAfloat objectColour;
+		CVector3 normal;
+
+		double opacity = 1.0;
+		depth = 1e20;
+
+		// raymarching loop (reflections)
+
+		if (!hemisphereCut) // in fulldome mode, will not render pixels out of the fulldome
+		{
+			sRayRecursionIn recursionIn;
+
+			sRayMarchingIn rayMarchingIn;
+			CVector3 direction = viewVector;
+			direction.Normalize();
+			rayMarchingIn.binaryEnable = true;
+			rayMarchingIn.direction = direction;
+			rayMarchingIn.maxScan = params->viewDistanceMax;
+			double freeStart = ProgressiveStartDistance(xs, ys, progressiveStep);
+			rayMarchingIn.minScan = freeStart;
+			if (data->depthPrepass)
+				rayMarchingIn.minScan =
+					max(rayMarchingIn.minScan, data->depthPrepass->GetStartDistance(xs, ys));
+			if (data->temporalDepth)
+				rayMarchingIn.minScan =
+					max(rayMarchingIn.minScan, data->temporalDepth->GetStartDistance(xs, ys));
+			rayMarchingIn.start = startRay;
+			rayMarchingIn.invertMode = false;
+			rayMarchingIn.gatherFractalData = true;
+			recursionIn.rayMarchingIn = rayMarchingIn;
+			recursionIn.calcInside = false;
+			recursionIn.resultShader = resultShader;
+			recursionIn.objectColour = objectColour;
+
+			sRayRecursionInOut recursionInOut;
+			recursionInOut.rayMarchingInOut = RayMarchingBuffers(0, recordSteps);
+			recursionInOut.rayIndex = 0;
+
+			sRayRecursionOut recursionOut = RayRecursion(recursionIn, recursionInOut);
+
+			if (data->progressiveDepth)
+				StoreProgressiveDepth(
+					xs, ys, progressiveStep, aspectRatio, rayMarchingIn, freeStart, rayBuffer[0]);
+
+			resultShader = recursionOut.resultShader;
+			objectColour = recursionOut.objectColour;
+			depth = recursionOut.rayMarchingOut.depth;
+			if (!recursionOut.found) depth = 1e20;
+			opacity = recursionOut.fogOpacity;
+			normal = recursionOut.normal;
+			StoreAOVs(recursionOut, &worldPosition, &objectId);
+			if (!monteCarloDOF && !data->stereo.isEnabled() && !sampleOut)
+				StoreGBuffer(xs, ys, recursionOut);
+		}
+
+		finallPixel.R = resultShader.R;
+		finallPixel.G = resultShader.G;
+		finallPixel.B = resultShader.B;
+
+		if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
+		{
+			if (stereoEye == cStereo::eyeLeft)
+			{
+				pixelLeftEye.R += finallPixel.R;
+				pixelLeftEye.G += finallPixel.G;
+				pixelLeftEye.B += finallPixel.B;
+			}
+			else if (stereoEye == cStereo::eyeRight)
+			{
+				pixelRightEye.R += finallPixel.R;
+				pixelRightEye.G += finallPixel.G;
+				pixelRightEye.B += finallPixel.B;
+			}
+		}
+
+		alpha = resultShader.A * 65535;
+		opacity16 = opacity * 65535;
+
+		colour.R = objectColour.R * 255;
+		colour.G = objectColour.G * 255;
+		colour.B = objectColour.B * 255;
+
+		if (image->GetImageOptional()->optionalNormal)
+		{
+			CVector3 normalRotated = mRotInv.RotateVector(normal);
+			normalFloat.R = (1.0 + normalRotated.x) / 2.0;
+			normalFloat.G = (1.0 + normalRotated.z) / 2.0;
+			normalFloat.B = 1.0 - normalRotated.y;
+		}
+
+		finalPixelDOF.R += finallPixel.R;
+		finalPixelDOF.G += finallPixel.G;
+		finalPixelDOF.B += finallPixel.B;
+		samples++;
+
+		if (adaptiveDOF)
+		{
+			// running variance (Welford's algorithm)
+			double brightness = (finallPixel.R + finallPixel.G + finallPixel.B) / 3.0;
+			double delta = brightness - brightnessMean;
+			brightnessMean += delta / samples;
+			brightnessM2 += delta * (brightness - brightnessMean);
+
+			if (samples >= params->DOFMinSamples && samples > 1)
+			{
+				// relative standard error of the mean
+				double noise = sqrt(brightnessM2 / (samples - 1) / samples) / max(brightnessMean, 0.01);
+				if (noise < params->DOFMaxNoise) break;
+			}
+		}
+
+	} // next repeat
+
+	if (adaptiveDOF)
+	{
+		DOFSampleBank += repeats - samples;
+		repeats = samples;
+	}
+
+	if (monteCarloDOF)
+	{
+		if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
+		{
+			finallPixel = data->stereo.MixColorsRedCyan(pixelLeftEye, pixelRightEye);
+			finallPixel.R = finallPixel.R / repeats * 2.0;
+			finallPixel.G = finallPixel.G / repeats * 2.0;
+			finallPixel.B = finallPixel.B / repeats * 2.0;
+		}
+		else
+		{
+			finallPixel.R = finalPixelDOF.R / repeats;
+			finallPixel.G = finalPixelDOF.G / repeats;
+			finallPixel.B = finalPixelDOF.B / repeats;
+		}
+	}
+	else if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
+	{
+		finallPixel = data->stereo.MixColorsRedCyan(pixelLeftEye, pixelRightEye);
+	}
+
+	if (sampleOut)
+		*sampleOut = finallPixel;
+	else
+		StorePixel(xs, ys, progressiveStep, finallPixel, colour, alpha, depth, opacity16, normalFloat,
+			worldPosition, objectId, pixelCost);
+}
+
+// additional outputs of primary ray used for compositing
+void cRenderWorker::StoreAOVs(
+	const sRayRecursionOut &recursionOut, sRGBfloat *worldPosition, float *objectId) const
+{
+	if (recursionOut.found)
+	{
+		*worldPosition = sRGBfloat(recursionOut.point.x, recursionOut.point.y, recursionOut.point.z);
+		*objectId = recursionOut.rayMarchingOut.objectId;
+	}
+	else
+	{
+		*worldPosition = sRGBfloat();
+		*objectId = -1.0f;
+	}
+}
+
+// geometry of primary ray hit which is needed to shade the pixel again
+void cRenderWorker::StoreGBuffer(int xs, int ys, const sRayRecursionOut &recursionOut)
+{
+	if (!image->GetImageOptional()->optionalGBuffer) return;
+
+	sGBufferPixel pixel;
+	pixel.point = recursionOut.point;
+	pixel.normal = recursionOut.normal;
+	pixel.depth = recursionOut.rayMarchingOut.depth;
+	pixel.distThresh = recursionOut.rayMarchingOut.distThresh;
+	pixel.lastDist = recursionOut.rayMarchingOut.lastDist;
+	pixel.colorIndex = recursionOut.rayMarchingOut.colorIndex;
+	pixel.orbitTrapR = recursionOut.rayMarchingOut.orbitTrapR;
+	pixel.objectId = recursionOut.rayMarchingOut.objectId;
+	pixel.found = recursionOut.found;
+	pixel.fractalDataValid = recursionOut.rayMarchingOut.fractalDataValid;
+
+	// only the first pixel of progressive block (see StorePixel())
+	image->PutPixelGBuffer(xs, ys, pixel);
+}
+
+void cRenderWorker::RelightPixel(int xs, int ys, int progressiveStep, double aspectRatio)
+{
+	CVector2<int> screenPoint(xs, ys);
+	CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
+	imagePoint.x *= aspectRatio;
+
+	// pixels out of the fulldome are rendered in standard way
+	if (params->perspectiveType == params::perspFishEyeCut
+			&& imagePoint.Length() > 0.5 / params->fov)
+	{
+		RenderPixel(xs, ys, progressiveStep, aspectRatio, false, CVector2<double>(), NULL);
+		return;
+	}
+
+	shadedPixel = CVector2<double>(xs, ys);
+	pixelCost = sPixelCost();
+	sampler.SetPixel(xs, ys);
+
+	const sGBufferPixel gPixel = image->GetPixelGBuffer(xs, ys);
+
+	CVector3 direction = CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+	direction.Normalize();
+
+	sRayRecursionIn recursionIn;
+	recursionIn.rayMarchingIn.binaryEnable = true;
+	recursionIn.rayMarchingIn.direction = direction;
+	recursionIn.rayMarchingIn.maxScan = params->viewDistanceMax;
+	recursionIn.rayMarchingIn.minScan = 0.0;
+	recursionIn.rayMarchingIn.start = params->camera;
+	recursionIn.rayMarchingIn.invertMode = false;
+	recursionIn.rayMarchingIn.gatherFractalData = true;
+	recursionIn.calcInside = false;
+
+	// results of ray-marching are taken from G-buffer
+	sRayMarchingOut &rayMarchingOut = recursionIn.rayMarchingOut;
+	rayMarchingOut.lastDist = gPixel.lastDist;
+	rayMarchingOut.depth = gPixel.found ? gPixel.depth : params->viewDistanceMax;
+	rayMarchingOut.distThresh = gPixel.distThresh;
+	rayMarchingOut.colorIndex = gPixel.colorIndex;
+	rayMarchingOut.orbitTrapR = gPixel.orbitTrapR;
+	rayMarchingOut.objectId = gPixel.found ? gPixel.objectId : 0;
+	rayMarchingOut.found = gPixel.found;
+	rayMarchingOut.fractalDataValid = gPixel.fractalDataValid;
+	rayMarchingOut.cost = sPixelCost();
+	recursionIn.rayMarchingDone = true;
+	recursionIn.rayMarchingPoint =
+		gPixel.found ? gPixel.point : params->camera + direction * params->viewDistanceMax;
+	recursionIn.normalDone = true;
+	recursionIn.normal = gPixel.normal;
+
+	sRayRecursionInOut recursionInOut;
+	rayBuffer[0].buffCount = 0;
+	recursionInOut.rayMarchingInOut = RayMarchingBuffers(0, recordSteps);
+	recursionInOut.rayIndex = 0;
+
+	sRayRecursionOut recursionOut = RayRecursion(recursionIn, recursionInOut);
+
+	sRGBAfloat resultShader = recursionOut.resultShader;
+	sRGBAfloat objectColour = recursionOut.objectColour;
+	double depth = recursionOut.found ? recursionOut.rayMarchingOut.depth : 1e20;
+
+	sRGBfloat finallPixel(resultShader.R, resultShader.G, resultShader.B);
+
+	sRGB8 colour;
+	colour.R = objectColour.R * 255;
+	colour.G = objectColour.G * 255;
+	colour.B = objectColour.B * 255;
+
+	unsigned short alpha = resultShader.A * 65535;
+	unsigned short opacity16 = recursionOut.fogOpacity * 65535;
+
+	sRGBfloat normalFloat;
+	if (image->GetImageOptional()->optionalNormal)
+	{
+		CVector3 normalRotated = mRotInv.RotateVector(recursionOut.normal);
+		normalFloat.R = (1.0 + normalRotated.x) / 2.0;
+		normalFloat.G = (1.0 + normalRotated.z) / 2.0;
+		normalFloat.B = 1.0 - normalRotated.y;
+	}
+
+	sRGBfloat worldPosition;
+	float objectId;
+	StoreAOVs(recursionOut, &worldPosition, &objectId);
+
+	StorePixel(xs, ys, progressiveStep, finallPixel, colour, alpha, depth, opacity16, normalFloat,
+		worldPosition, objectId, pixelCost);
+}
+
+// supersampling of pixels marked by edge detection. Colour of pixel is replaced by average of
+// sub-pixel samples. Depth, alpha and normals are kept from the central sample
+void cRenderWorker::RenderAntiAliasing(double aspectRatio)
+{
+	cAntiAliasing *antiAliasing = data->antiAliasing;
+	const cRegion<int> &region = antiAliasing->GetRegion();
+	int numberOfSamples = antiAliasing->GetNumberOfSamples();
+
+	for (int ys = antiAliasing->NextRow(); ys >= 0; ys = antiAliasing->NextRow())
+	{
+		for (int xs = region.x1; xs < region.x2; xs++)
+		{
+			if (systemData.globalStopRequest || *data->stopRequest) return;
+			if (!antiAliasing->IsEdge(xs, ys)) continue;
+
+			sRGBfloat sum;
+			for (int i = 0; i < numberOfSamples; i++)
+			{
+				CVector2<double> offset = antiAliasing->GetSampleOffset(i);
+				sRGBfloat sample;
+				if (offset.x == 0.0 && offset.y == 0.0)
+					sample = image->GetPixelImage(xs, ys); // already rendered
 				else
-				{
-					finallPixel.R = finalPixelDOF.R / repeats;
-					finallPixel.G = finalPixelDOF.G / repeats;
-					finallPixel.B = finalPixelDOF.B / repeats;
-				}
+					RenderPixel(xs, ys, 1, aspectRatio, false, offset, &sample);
+				sum.R += sample.R;
+				sum.G += sample.G;
+				sum.B += sample.B;
+			}
+			sRGBfloat pixel(
+				sum.R / numberOfSamples, sum.G / numberOfSamples, sum.B / numberOfSamples);
+			image->PutPixelImage(xs, ys, pixel);
+			threadData->statistics.numberOfAntiAliasedPixels++;
+		}
+	}
+}
+
+// shifts the ray from the camera to the given eye
+void cRenderWorker::StereoEyeRay(
+	cStereo::enumEye eye, CVector3 *startRay, CVector3 *viewVector) const
+{
+	if (params->perspectiveType == params::perspFishEyeCut)
+	{
+		CVector3 sideVector = viewVector->Cross(params->topVector);
+		sideVector.Normalize();
+		double eyeDistance = params->stereoEyeDistance;
+		if (data->stereo.AreSwapped()) eyeDistance *= -1.0;
+
+		CVector3 shift =
+			0.5 * (cameraTarget->GetRightVector() * eyeDistance + sideVector * eyeDistance);
+		if (eye == cStereo::eyeLeft)
+			*startRay += shift;
+		else
+			*startRay -= shift;
+	}
+	else
+	{
+		*startRay = data->stereo.CalcEyePosition(
+			*startRay, *viewVector, params->topVector, params->stereoEyeDistance, eye);
+		data->stereo.ViewVectorCorrection(params->stereoInfiniteCorrection, mRot, mRotInv, eye,
+			params->perspectiveType, viewVector);
+	}
+}
+
+CVector2<int> cRenderWorker::StereoPairPixel(int xs, int ys) const
+{
+	switch (data->stereo.GetMode())
+	{
+		case cStereo::stereoLeftRight: return CVector2<int>(xs + image->GetWidth() / 2, ys);
+		case cStereo::stereoTopBottom: return CVector2<int>(xs, ys + image->GetHeight() / 2);
+		default: return CVector2<int>(xs, ys);
+	}
+}
+
+bool cRenderWorker::IsSecondStereoEyePixel(int xs, int ys) const
+{
+	switch (data->stereo.GetMode())
+	{
+		case cStereo::stereoLeftRight: return xs >= image->GetWidth() / 2;
+		case cStereo::stereoTopBottom: return ys >= image->GetHeight() / 2;
+		default: return false;
+	}
+}
+
+// pixel was rendered in previous progressive pass. In single-pass stereo the pixel is rendered
+// again if its pair of the other eye wasn't
+bool cRenderWorker::RenderedInPreviousPass(int xs, int ys, int progressiveStep) const
+{
+	int previousStep = progressiveStep * 2;
+	if (xs % previousStep != 0 || ys % previousStep != 0) return false;
+	if (!data->stereoSinglePass) return true;
+	CVector2<int> pair = StereoPairPixel(xs, ys);
+	return pair.x % previousStep == 0 && pair.y % previousStep == 0;
+}
+
+// rendering of packet of neighbouring pixels from one line. Primary rays are marched together
+// ray from the camera through given pixel. Returns false for pixels which have to be rendered in
+// standard way
+bool cRenderWorker::PreparePrimaryRay(
+	int xs, int ys, int progressiveStep, double aspectRatio, sRayMarchingIn *in, double *freeStart)
+{
+	// calculate point in image coordinate system
+	CVector2<int> screenPoint(xs, ys);
+	CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
+	imagePoint.x *= aspectRatio;
+
+	// pixels out of the fulldome are rendered in standard way
+	if (params->perspectiveType == params::perspFishEyeCut && imagePoint.Length() > 0.5 / params->fov)
+		return false;
+
+	// calculate direction of ray-marching
+	CVector3 direction = CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+	direction.Normalize();
+
+	in->binaryEnable = true;
+	in->direction = direction;
+	in->maxScan = params->viewDistanceMax;
+	*freeStart = ProgressiveStartDistance(xs, ys, progressiveStep);
+	in->minScan = *freeStart;
+	if (data->depthPrepass)
+		in->minScan = max(in->minScan, data->depthPrepass->GetStartDistance(xs, ys));
+	if (data->temporalDepth)
+		in->minScan = max(in->minScan, data->temporalDepth->GetStartDistance(xs, ys));
+	in->start = params->camera;
+	in->invertMode = false;
+	in->gatherFractalData = true;
+	return true;
+}
+
+void cRenderWorker::RenderPixelPacket(
+	const int *xs, int count, int ys, int progressiveStep, double aspectRatio)
+{
+	if (data->stereoSinglePass)
+	{
+		RenderStereoPacket(xs, count, ys, progressiveStep, aspectRatio);
+		return;
+	}
+
+	sRayMarchingIn rayMarchingIn[RAY_PACKET_SIZE];
+	sRayMarchingInOut rayMarchingInOut[RAY_PACKET_SIZE];
+	sRayMarchingOut rayMarchingOut[RAY_PACKET_SIZE];
+	CVector3 points[RAY_PACKET_SIZE];
+	double freeStarts[RAY_PACKET_SIZE];
+	int lanePixel[RAY_PACKET_SIZE];
+	int laneCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		sRayMarchingIn &in = rayMarchingIn[laneCount];
+		if (!PreparePrimaryRay(xs[i], ys, progressiveStep, aspectRatio, &in, &freeStarts[laneCount]))
+		{
+			RenderPixel(xs[i], ys, progressiveStep, aspectRatio, false);
+			continue;
+		}
+
+		rayMarchingInOut[laneCount].buffCount = &packetRayBuffer[laneCount].buffCount;
+		rayMarchingInOut[laneCount].stepBuff = recordSteps ? packetRayBuffer[laneCount].stepBuff : NULL;
+		lanePixel[laneCount] = xs[i];
+		laneCount++;
+	}
+
+	if (laneCount == 0) return;
+
+	threadData->stageTimer.Enter(renderStagePrimaryRays);
+	RayMarchingPacket(rayMarchingIn, rayMarchingInOut, rayMarchingOut, points, laneCount);
+	threadData->stageTimer.Leave();
+
+	if (data->progressiveDepth)
+	{
+		for (int lane = 0; lane < laneCount; lane++)
+			StoreProgressiveDepth(lanePixel[lane], ys, progressiveStep, aspectRatio, rayMarchingIn[lane],
+				freeStarts[lane], packetRayBuffer[lane]);
+	}
+
+	// shading is done for each pixel separately
+	for (int lane = 0; lane < laneCount; lane++)
+	{
+		pixelCost = sPixelCost();
+		ShadePrimaryRay(lanePixel[lane], ys, progressiveStep, rayMarchingIn[lane],
+			rayMarchingInOut[lane], rayMarchingOut[lane], points[lane]);
+	}
+}
+
+// shading of pixel which primary ray was already marched. Work done for the pixel is added to
+// pixelCost
+void cRenderWorker::ShadePrimaryRay(int xs, int ys, int progressiveStep, const sRayMarchingIn &in,
+	const sRayMarchingInOut &inOut, const sRayMarchingOut &out, const CVector3 &point)
+{
+	shadedPixel = CVector2<double>(xs, ys);
+
+	sRayRecursionIn recursionIn;
+	recursionIn.rayMarchingIn = in;
+	recursionIn.calcInside = false;
+	recursionIn.rayMarchingDone = true;
+	recursionIn.rayMarchingPoint = point;
+	recursionIn.rayMarchingOut = out;
+
+	sRayRecursionInOut recursionInOut;
+	recursionInOut.rayMarchingInOut = inOut;
+	recursionInOut.rayIndex = 0;
+
+	sRayRecursionOut recursionOut = RayRecursion(recursionIn, recursionInOut);
+
+	sRGBAfloat resultShader = recursionOut.resultShader;
+	sRGBAfloat objectColour = recursionOut.objectColour;
+	double depth = recursionOut.rayMarchingOut.depth;
+	if (!recursionOut.found) depth = 1e20;
+
+	sRGBfloat finallPixel;
+	finallPixel.R = resultShader.R;
+	finallPixel.G = resultShader.G;
+	finallPixel.B = resultShader.B;
+
+	sRGB8 colour;
+	colour.R = objectColour.R * 255;
+	colour.G = objectColour.G * 255;
+	colour.B = objectColour.B * 255;
+
+	unsigned short alpha = resultShader.A * 65535;
+	unsigned short opacity16 = recursionOut.fogOpacity * 65535;
+
+	sRGBfloat normalFloat;
+	if (image->GetImageOptional()->optionalNormal)
+	{
+		CVector3 normalRotated = mRotInv.RotateVector(recursionOut.normal);
+		normalFloat.R = (1.0 + normalRotated.x) / 2.0;
+		normalFloat.G = (1.0 + normalRotated.z) / 2.0;
+		normalFloat.B = 1.0 - normalRotated.y;
+	}
+
+	sRGBfloat worldPosition;
+	float objectId;
+	StoreAOVs(recursionOut, &worldPosition, &objectId);
+	StoreGBuffer(xs, ys, recursionOut);
+
+	StorePixel(xs, ys, progressiveStep, finallPixel, colour, alpha, depth, opacity16, normalFloat,
+		worldPosition, objectId, pixelCost);
+}
+
+// Morton code of point quantized to 21 bits per axis inside of given box
+static quint64 MortonKey(const CVector3 &point, const CVector3 &boxMin, double scale)
+{
+	quint64 key = 0;
+	quint64 coords[3] = {quint64((point.x - boxMin.x) * scale), quint64((point.y - boxMin.y) * scale),
+		quint64((point.z - boxMin.z) * scale)};
+	for (int bit = 0; bit < 21; bit++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			key |= ((coords[axis] >> bit) & 1) << (bit * 3 + axis);
+	}
+	return key;
+}
+
+// rendering of pixels collected for the tile in wavefront mode. Shadow rays of neighbouring hits
+// start close to each other and go in the same direction, so after sorting by origin they are
+// traced in coherent batches
+void cRenderWorker::RenderWavefrontTile(int progressiveStep, double aspectRatio)
+{
+	int count = wavefront.xs.size();
+	wavefront.in.resize(count);
+	wavefront.inOut.resize(count);
+	wavefront.out.resize(count);
+	wavefront.points.resize(count);
+	wavefront.stepCounts.resize(count);
+	wavefront.shadows.resize(count);
+	wavefront.costs.resize(count);
+
+	// pixels out of the fulldome are rendered in standard way and removed from the queue
+	int marchedCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		int xs = wavefront.xs[i];
+		int ys = wavefront.ys[i];
+		double freeStart;
+		if (!PreparePrimaryRay(
+					xs, ys, progressiveStep, aspectRatio, &wavefront.in[marchedCount], &freeStart))
+		{
+			RenderPixel(xs, ys, progressiveStep, aspectRatio, false);
+			continue;
+		}
+		wavefront.xs[marchedCount] = xs;
+		wavefront.ys[marchedCount] = ys;
+		wavefront.inOut[marchedCount].buffCount = &wavefront.stepCounts[marchedCount];
+		wavefront.inOut[marchedCount].stepBuff = NULL;
+		wavefront.shadows[marchedCount] = sRGBAfloat(1.0, 1.0, 1.0, 1.0);
+		wavefront.costs[marchedCount] = sPixelCost();
+		marchedCount++;
+	}
+
+	// primary rays
+	threadData->stageTimer.Enter(renderStagePrimaryRays);
+	for (int first = 0; first < marchedCount; first += RAY_PACKET_SIZE)
+	{
+		if (systemData.globalStopRequest) break;
+		RayMarchingPacket(&wavefront.in[first], &wavefront.inOut[first], &wavefront.out[first],
+			&wavefront.points[first], qMin(RAY_PACKET_SIZE, marchedCount - first));
+	}
+	threadData->stageTimer.Leave();
+	if (systemData.globalStopRequest) return;
+
+	// queue of shadow rays of all hits sorted by origin
+	wavefront.shadowQueue.clear();
+	CVector3 boxMin(1e300, 1e300, 1e300);
+	CVector3 boxMax(-1e300, -1e300, -1e300);
+	for (int i = 0; i < marchedCount; i++)
+	{
+		if (!wavefront.out[i].found) continue;
+		sWavefrontShadowRay ray;
+		ray.point = wavefront.points[i];
+		ray.distThresh = wavefront.out[i].distThresh;
+		ray.delta = CalcDelta(ray.point);
+		ray.key = 0;
+		ray.pixel = i;
+		wavefront.shadowQueue.append(ray);
+		boxMin = CVector3(qMin(boxMin.x, ray.point.x), qMin(boxMin.y, ray.point.y),
+			qMin(boxMin.z, ray.point.z));
+		boxMax = CVector3(qMax(boxMax.x, ray.point.x), qMax(boxMax.y, ray.point.y),
+			qMax(boxMax.z, ray.point.z));
+	}
+
+	int queueSize = wavefront.shadowQueue.size();
+	if (queueSize > 0)
+	{
+		CVector3 boxSize = boxMax - boxMin;
+		double maxSize = dMax(boxSize.x, boxSize.y, boxSize.z);
+		double scale = maxSize > 0.0 ? ((1 << 21) - 1) / maxSize : 0.0;
+		for (int i = 0; i < queueSize; i++)
+			wavefront.shadowQueue[i].key = MortonKey(wavefront.shadowQueue[i].point, boxMin, scale);
+		std::sort(wavefront.shadowQueue.begin(), wavefront.shadowQueue.end());
+
+		TraceShadowQueue(wavefront.shadowQueue.constData(), queueSize);
+	}
+
+	// shading with shadows taken from the queue
+	for (int i = 0; i < marchedCount; i++)
+	{
+		if (systemData.globalStopRequest) break;
+		pixelCost = wavefront.costs[i];
+		wavefrontShadow = wavefront.out[i].found ? &wavefront.shadows[i] : NULL;
+		ShadePrimaryRay(wavefront.xs[i], wavefront.ys[i], progressiveStep, wavefront.in[i],
+			wavefront.inOut[i], wavefront.out[i], wavefront.points[i]);
+		wavefrontShadow = NULL;
+	}
+}
+
+// main light shadows of wavefront queue. It is the same as MainShadow() without volumetric effects,
+// but distances of WAVEFRONT_BATCH_SIZE rays are calculated together. Finished rays are replaced by
+// next ones from the queue, so batches stay full
+void cRenderWorker::TraceShadowQueue(const sWavefrontShadowRay *rays, int count)
+{
+	cStageScope stage(&threadData->stageTimer, renderStageShadows);
+
+	struct sShadowLane
+	{
+		int ray;
+		double scan;
+		double end;
+		double factor;
+		double maxSoft;
+	};
+
+	sShadowLane lanes[WAVEFRONT_BATCH_SIZE];
+	CVector3 points[WAVEFRONT_BATCH_SIZE];
+	double detailSizes[WAVEFRONT_BATCH_SIZE];
+	double distances[WAVEFRONT_BATCH_SIZE];
+	sDistanceOut distanceOuts[WAVEFRONT_BATCH_SIZE];
+
+	double DEFactor = params->DEFactor;
+	double softRange = tan(params->shadowConeAngle / 180.0 * M_PI);
+	const bool bSoft = !params->limitsEnabled && !params->common.iterThreshMode && softRange > 0.0;
+
+	int laneCount = 0;
+	int next = 0;
+	while (true)
+	{
+		// free lanes are filled with next rays
+		while (laneCount < WAVEFRONT_BATCH_SIZE && next < count)
+		{
+			const sWavefrontShadowRay &ray = rays[next];
+			sShadowLane &lane = lanes[laneCount];
+			lane.ray = next++;
+			lane.factor = params->penetratingLights ? ray.delta / params->resolution
+																							: params->viewDistanceMax;
+			lane.scan = params->interiorMode ? ray.distThresh * DEFactor : ray.distThresh;
+			lane.end = ShadowRayEnd(ray.point, shadowVector, lane.scan, lane.factor);
+			lane.maxSoft = 0.0;
+			if (lane.scan < lane.end)
+				laneCount++;
+			else
+				wavefront.shadows[ray.pixel] = sRGBAfloat(1.0, 1.0, 1.0, 1.0);
+		}
+		if (laneCount == 0) break;
+
+		for (int b = 0; b < laneCount; b++)
+		{
+			const sWavefrontShadowRay &ray = rays[lanes[b].ray];
+			points[b] = ray.point + shadowVector * lanes[b].scan;
+			detailSizes[b] = ray.distThresh;
+		}
+
+		CalculateDistanceBatch(
+			*params, *fractal, points, detailSizes, laneCount, distances, distanceOuts, data);
+
+		int keptCount = 0;
+		for (int b = 0; b < laneCount; b++)
+		{
+			sShadowLane lane = lanes[b];
+			const sWavefrontShadowRay &ray = rays[lane.ray];
+			double dist = distances[b];
+			CountDistance(distanceOuts[b]);
+			wavefront.costs[ray.pixel].Count(distanceOuts[b].totalIters, true);
+
+			bool finished = false;
+			double shadowTemp = 1.0;
+			if (bSoft)
+			{
+				double angle = (dist - ray.distThresh) / lane.scan;
+				if (angle < 0 || dist < ray.distThresh) angle = 0;
+				double softShadow = (1.0 - angle / softRange);
+				if (params->penetratingLights) softShadow *= (lane.factor - lane.scan) / lane.factor;
+				if (softShadow < 0) softShadow = 0;
+				if (softShadow > lane.maxSoft) lane.maxSoft = softShadow;
+				// soft shadow can't be darker
+				if (lane.maxSoft > 1.0 - SHADOW_MIN_LIGHT) finished = true;
+			}
+
+			if (!finished && dist < ray.distThresh)
+			{
+				shadowTemp -= (lane.factor - lane.scan) / lane.factor;
+				if (!params->penetratingLights) shadowTemp = 0.0;
+				if (shadowTemp < 0.0) shadowTemp = 0.0;
+				finished = true;
 			}
-			else if (data->stereo.isEnabled() && data->stereo.GetMode() == cStereo::stereoRedCyan)
+
+			lane.scan += dist * DEFactor;
+			if (!finished && lane.scan >= lane.end) finished = true;
+
+			if (finished)
+			{
+				double light = bSoft ? 1.0 - lane.maxSoft : shadowTemp;
+				wavefront.shadows[ray.pixel] = sRGBAfloat(light, light, light, 1.0);
+			}
+			else
+			{
+				lanes[keptCount++] = lane;
+			}
+		}
+		laneCount = keptCount;
+	}
+}
+
+// rendering of pixels of single-pass stereo. Rays of both eyes of each pixel are almost the same,
+// so they are marched together in one packet
+void cRenderWorker::RenderStereoPacket(
+	const int *xs, int count, int ys, int progressiveStep, double aspectRatio)
+{
+	sRayMarchingIn rayMarchingIn[RAY_PACKET_SIZE];
+	sRayMarchingInOut rayMarchingInOut[RAY_PACKET_SIZE];
+	sRayMarchingOut rayMarchingOut[RAY_PACKET_SIZE];
+	CVector3 points[RAY_PACKET_SIZE];
+	CVector2<int> lanePixel[RAY_PACKET_SIZE];
+	int laneCount = 0;
+
+	bool redCyan = data->stereo.GetMode() == cStereo::stereoRedCyan;
+
+	for (int i = 0; i < count; i++)
+	{
+		// calculate point in image coordinate system
+		CVector2<int> screenPoint(xs[i], ys);
+		CVector2<double> imagePoint = data->screenRegion.transpose(data->imageRegion, screenPoint);
+		cStereo::enumEye firstEye = data->stereo.WhichEye(imagePoint);
+		imagePoint = data->stereo.ModifyImagePoint(imagePoint);
+		imagePoint.x *= aspectRatio;
+		CVector2<int> pair = StereoPairPixel(xs[i], ys);
+
+		// pixels out of the fulldome are rendered in standard way
+		if (params->perspectiveType == params::perspFishEyeCut
+				&& imagePoint.Length() > 0.5 / params->fov)
+		{
+			RenderPixel(xs[i], ys, progressiveStep, aspectRatio, false);
+			if (!redCyan) RenderPixel(pair.x, pair.y, progressiveStep, aspectRatio, false);
+			continue;
+		}
+
+		CVector3 viewVector =
+			CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+
+		for (int e = 0; e < 2; e++)
+		{
+			// anaglyph pixel has left eye in first lane, side-by-side pixel has the other eye in second
+			cStereo::enumEye eye;
+			if (redCyan)
+				eye = (e == 0) ? cStereo::eyeLeft : cStereo::eyeRight;
+			else if (e == 0)
+				eye = firstEye;
+			else
+				eye = (firstEye == cStereo::eyeLeft) ? cStereo::eyeRight : cStereo::eyeLeft;
+
+			CVector3 startRay = params->camera;
+			CVector3 direction = viewVector;
+			StereoEyeRay(eye, &startRay, &direction);
+			direction.Normalize();
+
+			CVector2<int> pixel = (e == 0) ? CVector2<int>(xs[i], ys) : pair;
+
+			sRayMarchingIn &in = rayMarchingIn[laneCount];
+			in.binaryEnable = true;
+			in.direction = direction;
+			in.maxScan = params->viewDistanceMax;
+			in.minScan = ProgressiveStartDistance(pixel.x, pixel.y, progressiveStep);
+			in.start = startRay;
+			in.invertMode = false;
+			in.gatherFractalData = true;
+
+			rayMarchingInOut[laneCount].buffCount = &packetRayBuffer[laneCount].buffCount;
+			rayMarchingInOut[laneCount].stepBuff =
+				recordSteps ? packetRayBuffer[laneCount].stepBuff : NULL;
+			lanePixel[laneCount] = pixel;
+			laneCount++;
+		}
+	}
+
+	if (laneCount == 0) return;
+
+	threadData->stageTimer.Enter(renderStagePrimaryRays);
+	RayMarchingPacket(rayMarchingIn, rayMarchingInOut, rayMarchingOut, points, laneCount);
+	threadData->stageTimer.Leave();
+
+	// shading is done for each eye separately. Shadows and AO are shared by the caches
+	sRGBfloat pixelLeftEye;
+	for (int lane = 0; lane < laneCount; lane++)
+	{
+		shadedPixel = CVector2<double>(lanePixel[lane].x, lanePixel[lane].y);
+		// cost of anaglyph pixel contains both eyes
+		if (!redCyan || lane % 2 == 0) pixelCost = sPixelCost();
+
+		sRayRecursionIn recursionIn;
+		recursionIn.rayMarchingIn = rayMarchingIn[lane];
+		recursionIn.calcInside = false;
+		recursionIn.rayMarchingDone = true;
+		recursionIn.rayMarchingPoint = points[lane];
+		recursionIn.rayMarchingOut = rayMarchingOut[lane];
+
+		sRayRecursionInOut recursionInOut;
+		recursionInOut.rayMarchingInOut = rayMarchingInOut[lane];
+		recursionInOut.rayIndex = 0;
+
+		sRayRecursionOut recursionOut = RayRecursion(recursionIn, recursionInOut);
+
+		sRGBAfloat resultShader = recursionOut.resultShader;
+		sRGBfloat finallPixel;
+		finallPixel.R = resultShader.R;
+		finallPixel.G = resultShader.G;
+		finallPixel.B = resultShader.B;
+
+		if (redCyan)
+		{
+			if (lane % 2 == 0)
 			{
-				finallPixel = data->stereo.MixColorsRedCyan(pixelLeftEye, pixelRightEye);
+				pixelLeftEye = finallPixel;
+				continue;
 			}
+			finallPixel = data->stereo.MixColorsRedCyan(pixelLeftEye, finallPixel);
+		}
+
+		sRGBAfloat objectColour = recursionOut.objectColour;
+		double depth = recursionOut.rayMarchingOut.depth;
+		if (!recursionOut.found) depth = 1e20;
+
+		sRGB8 colour;
+		colour.R = objectColour.R * 255;
+		colour.G = objectColour.G * 255;
+		colour.B = objectColour.B * 255;
+
+		unsigned short alpha = resultShader.A * 65535;
+		unsigned short opacity16 = recursionOut.fogOpacity * 65535;
+
+		sRGBfloat normalFloat;
+		if (image->GetImageOptional()->optionalNormal)
+		{
+			CVector3 normalRotated = mRotInv.RotateVector(recursionOut.normal);
+			normalFloat.R = (1.0 + normalRotated.x) / 2.0;
+			normalFloat.G = (1.0 + normalRotated.z) / 2.0;
+			normalFloat.B = 1.0 - normalRotated.y;
+		}
 
-			for (int yy = 0; yy < scheduler->GetProgressiveStep(); ++yy)
+		sRGBfloat worldPosition;
+		float objectId;
+		StoreAOVs(recursionOut, &worldPosition, &objectId);
+
+		StorePixel(lanePixel[lane].x, lanePixel[lane].y, progressiveStep, finallPixel, colour, alpha,
+			depth, opacity16, normalFloat, worldPosition, objectId, pixelCost);
+	}
+}
+
+// copies rendered pixel to the whole progressive block
+void cRenderWorker::StorePixel(int xs, int ys, int progressiveStep, const sRGBfloat &pixel,
+	const sRGB8 &colour, unsigned short alpha, double depth, unsigned short opacity16,
+	const sRGBfloat &normal, const sRGBfloat &worldPosition, float objectId, const sPixelCost &cost)
+{
+	const sImageOptional *optional = image->GetImageOptional();
+	sRGBfloat costFloat(cost.evaluations, cost.iterations, cost.steps);
+	for (int yy = 0; yy < progressiveStep; ++yy)
+	{
+		int yyy = ys + yy;
+		if (yyy < data->screenRegion.y2)
+		{
+			for (int xx = 0; xx < progressiveStep; ++xx)
 			{
-				int yyy = screenPoint.y + yy;
-				if (yyy < data->screenRegion.y2)
+				int xxx = xs + xx;
+				if (xxx < data->screenRegion.x2)
 				{
-					for (int xx = 0; xx < scheduler->GetProgressiveStep(); ++xx)
-					{
-						int xxx = screenPoint.x + xx;
-						if (xxx < data->screenRegion.x2)
-						{
-							image->PutPixelImage(xxx, yyy, finallPixel);
-							image->PutPixelColour(xxx, yyy, colour);
-							image->PutPixelAlpha(xxx, yyy, alpha);
-							image->PutPixelZBuffer(xxx, yyy, (float)depth);
-							image->PutPixelOpacity(xxx, yyy, opacity16);
-							if (image->GetImageOptional()->optionalNormal)
-								image->PutPixelNormal(xxx, yyy, normalFloat);
-						}
-					}
+					image->PutPixelImage(xxx, yyy, pixel);
+					image->PutPixelColour(xxx, yyy, colour);
+					image->PutPixelAlpha(xxx, yyy, alpha);
+					image->PutPixelZBuffer(xxx, yyy, (float)depth);
+					image->PutPixelOpacity(xxx, yyy, opacity16);
 				}
 			}
+		}
+	}
 
-			data->statistics.numberOfRenderedPixels++;
-
-		} // next xs
-	}		// next ys
+	// optional buffers are not read before the last pass, so blocks are not filled. Missing pixels
+	// are filled by cImage::FillOptionalBlocks() when rendering ends with a coarse pass
+	if (optional->optionalNormal) image->PutPixelNormal(xs, ys, normal);
+	if (optional->optionalWorldPosition) image->PutPixelWorldPosition(xs, ys, worldPosition);
+	if (optional->optionalObjectId) image->PutPixelObjectId(xs, ys, objectId);
+	if (optional->optionalCost) image->PutPixelCost(xs, ys, costFloat);
 
-	// emit signal to main thread when finished
-	emit finished();
-	return;
+	threadData->statistics.numberOfRenderedPixels++;
 }
 
 // calculation of base vectors
 void cRenderWorker::PrepareMainVectors(void)
 {
+	// worker can be reused for next job, so all accumulated data have to be reset
+	if (cameraTarget) delete cameraTarget;
+	mRot = CRotationMatrix();
+	baseX = CVector3(1.0, 0.0, 0.0);
+	baseY = CVector3(0.0, 1.0, 0.0);
+	baseZ = CVector3(0.0, 0.0, 1.0);
+
 	cameraTarget = new cCameraTarget(params->camera, params->target, params->topVector);
 	// cameraTarget->SetCameraTargetRotation(params->camera, params->target, params->viewAngle);
 	viewAngle = cameraTarget->GetRotation();
@@ -419,62 +1679,137 @@ void cRenderWorker::PrepareReflectionBuffer(void)
 
 	reflectionsMax = params->reflectionsMax * 2;
 	if (!params->raytracedReflections) reflectionsMax = 0;
-	rayBuffer = new sRayBuffer[reflectionsMax + 4];
 
-	for (int i = 0; i < reflectionsMax + 3; i++)
+	// buffers are reallocated only if number of reflections has changed
+	if (rayBuffer && rayBufferSize == reflectionsMax + 3)
+	{
+		for (int i = 0; i < rayBufferSize; i++)
+			rayBuffer[i].buffCount = 0;
+		return;
+	}
+
+	FreeReflectionBuffer();
+
+	rayBufferSize = reflectionsMax + 3;
+	rayBuffer = new sRayBuffer[rayBufferSize + 1];
+
+	// rayMarching buffers of ray recursion levels are allocated when they are used first time
+	for (int i = 0; i < rayBufferSize; i++)
+	{
+		rayBuffer[i].stepBuff = NULL;
+		rayBuffer[i].buffCount = 0;
+	}
+
+	// one level of recursion stack for each ray buffer is enough (index grows with depth)
+	rayStack = new sRayRecursionNode[rayBufferSize];
+}
+
+void cRenderWorker::FreeReflectionBuffer(void)
+{
+	if (rayBuffer)
+	{
+		for (int i = 0; i < rayBufferSize; i++)
+		{
+			delete rayBuffer[i].stepBuff;
+		}
+		delete[] rayBuffer;
+		rayBuffer = NULL;
+	}
+	if (rayStack)
 	{
-		// rayMarching buffers
-		rayBuffer[i].stepBuff = new sStep[maxraymarchingSteps + 2];
-		rayBuffer[i].buffCount = 0;
+		delete[] rayStack;
+		rayStack = NULL;
 	}
+	rayBufferSize = 0;
 }
 
 // calculating vectors for AmbientOcclusion
 void cRenderWorker::PrepareAOVectors(void)
 {
-	AOvectorsAround = new sVectorsAround[10000];
-	AOvectorsCount = 0;
+	if (!AOvectorsAround) AOvectorsAround = new sVectorsAround[10000];
+	AOvectorsCount = GenerateAOVectors(params, data, AOvectorsAround, 10000);
+}
+
+// directions of multi-ray ambient occlusion with colours of light map
+int cRenderWorker::GenerateAOVectors(
+	const cParamRender *params, const sRenderData *data, sVectorsAround *vectors, int maxCount)
+{
 	int counter = 0;
 	int lightMapWidth = data->textures.lightmapTexture.Width();
 	int lightMapHeight = data->textures.lightmapTexture.Height();
-	for (double b = -0.49 * M_PI; b < 0.49 * M_PI; b += 1.0 / params->ambientOcclusionQuality)
+
+	// directions from low discrepancy sequence. Number of vectors is the same as for regular grid
+	if (params->samplerType != params::samplerRandom)
 	{
-		for (double a = 0.0; a < 2.0 * M_PI; a += ((2.0 / params->ambientOcclusionQuality) / cos(b)))
+		int numberOfVectors = 0;
+		for (double b = -0.49 * M_PI; b < 0.49 * M_PI; b += 1.0 / params->ambientOcclusionQuality)
+			for (double a = 0.0; a < 2.0 * M_PI; a += ((2.0 / params->ambientOcclusionQuality) / cos(b)))
+				numberOfVectors++;
+		numberOfVectors = min(numberOfVectors, maxCount);
+
+		for (int i = 0; i < numberOfVectors; i++)
 		{
-			CVector3 d;
-			d.x = cos(a + b) * cos(b);
-			d.y = sin(a + b) * cos(b);
-			d.z = sin(b);
-			AOvectorsAround[counter].alpha = a;
-			AOvectorsAround[counter].beta = b;
-			AOvectorsAround[counter].v = d;
+			double u = cSampler::RadicalInverse(i, 2);
+			double v = params->samplerType == params::samplerSobol ? cSampler::Sobol2(i)
+																															: cSampler::RadicalInverse(i, 3);
+			// uniform distribution on a sphere
+			double b = asin(2.0 * u - 1.0);
+			double a = 2.0 * M_PI * v - b;
+			CVector3 d(cos(a + b) * cos(b), sin(a + b) * cos(b), sin(b));
+			vectors[counter].alpha = a;
+			vectors[counter].beta = b;
+			vectors[counter].v = d;
 			int X = (int)((a + b) / (2.0 * M_PI) * lightMapWidth + lightMapWidth * 8.5) % lightMapWidth;
 			int Y = (int)(b / (M_PI)*lightMapHeight + lightMapHeight * 8.5) % lightMapHeight;
-			AOvectorsAround[counter].R = data->textures.lightmapTexture.FastPixel(X, Y).R;
-			AOvectorsAround[counter].G = data->textures.lightmapTexture.FastPixel(X, Y).G;
-			AOvectorsAround[counter].B = data->textures.lightmapTexture.FastPixel(X, Y).B;
-			if (AOvectorsAround[counter].R > 10 || AOvectorsAround[counter].G > 10
-					|| AOvectorsAround[counter].B > 10)
+			vectors[counter].R = data->textures.lightmapTexture.FastPixel(X, Y).R;
+			vectors[counter].G = data->textures.lightmapTexture.FastPixel(X, Y).G;
+			vectors[counter].B = data->textures.lightmapTexture.FastPixel(X, Y).B;
+			if (vectors[counter].R > 10 || vectors[counter].G > 10 || vectors[counter].B > 10)
 			{
 				counter++;
 			}
-			if (counter >= 10000) break;
 		}
-		if (counter >= 10000) break;
+	}
+	else
+	{
+		for (double b = -0.49 * M_PI; b < 0.49 * M_PI; b += 1.0 / params->ambientOcclusionQuality)
+		{
+			for (double a = 0.0; a < 2.0 * M_PI; a += ((2.0 / params->ambientOcclusionQuality) / cos(b)))
+			{
+				CVector3 d;
+				d.x = cos(a + b) * cos(b);
+				d.y = sin(a + b) * cos(b);
+				d.z = sin(b);
+				vectors[counter].alpha = a;
+				vectors[counter].beta = b;
+				vectors[counter].v = d;
+				int X = (int)((a + b) / (2.0 * M_PI) * lightMapWidth + lightMapWidth * 8.5) % lightMapWidth;
+				int Y = (int)(b / (M_PI)*lightMapHeight + lightMapHeight * 8.5) % lightMapHeight;
+				vectors[counter].R = data->textures.lightmapTexture.FastPixel(X, Y).R;
+				vectors[counter].G = data->textures.lightmapTexture.FastPixel(X, Y).G;
+				vectors[counter].B = data->textures.lightmapTexture.FastPixel(X, Y).B;
+				if (vectors[counter].R > 10 || vectors[counter].G > 10 || vectors[counter].B > 10)
+				{
+					counter++;
+				}
+				if (counter >= maxCount) break;
+			}
+			if (counter >= maxCount) break;
+		}
 	}
 	if (counter == 0)
 	{
 		counter = 1;
-		AOvectorsAround[0].alpha = 0;
-		AOvectorsAround[0].beta = 0;
-		AOvectorsAround[0].v.x = 0;
-		AOvectorsAround[0].v.y = 0;
-		AOvectorsAround[0].v.z = 0;
-		AOvectorsAround[0].R = 0;
-		AOvectorsAround[0].G = 0;
-		AOvectorsAround[0].B = 0;
+		vectors[0].alpha = 0;
+		vectors[0].beta = 0;
+		vectors[0].v.x = 0;
+		vectors[0].v.y = 0;
+		vectors[0].v.z = 0;
+		vectors[0].R = 0;
+		vectors[0].G = 0;
+		vectors[0].B = 0;
 	}
-	AOvectorsCount = counter;
+	return counter;
 }
 
 // calculation of distance where ray-marching stops
@@ -510,146 +1845,387 @@ double cRenderWorker::CalcDelta(CVector3 point) const
 CVector3 cRenderWorker::RayMarching(
 	sRayMarchingIn &in, sRayMarchingInOut *inOut, sRayMarchingOut *out)
 {
-	CVector3 point;
-	bool found = false;
-	double scan = in.minScan;
-	double dist = 0;
-	double search_accuracy = 0.01 * params->detailLevel;
-	double search_limit = 1.0 - search_accuracy;
-	int counter = 0;
-	double step = 0.0;
-	(*inOut->buffCount) = 0;
-	double distThresh = 0;
-	out->objectId = 0;
+	sRayMarchingState state;
+	RayMarchingInit(in, inOut, out, &state);
 
 	// qDebug() << "Start ************************";
 
-	CVector3 lastPoint, lastGoodPoint;
-	bool deadComputationFound = false;
-
-	for (int i = 0; i < 10000; i++)
+	while (RayMarchingNextPoint(in, &state))
 	{
-		lastGoodPoint = lastPoint;
-		lastPoint = point;
+		double dist;
+		sDistanceOut distanceOut;
+		if (!CachedDistance(in, state, &dist, &distanceOut))
+		{
+			if (params->doubleDoublePrecision)
+			{
+				// low part of the point lost by rounding to double
+				CVector3 pointLow = DDPointResidual(in.start, in.direction, state.scan, state.point);
+				CalculateDistanceBatch(*params, *fractal, &state.point, &state.distThresh, 1, &dist,
+					&distanceOut, data, false, &pointLow);
+			}
+			else
+			{
+				sDistanceIn distanceIn(state.point, state.distThresh, false);
+				dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
+			}
+		}
 
-		counter++;
+		//-------------------- 4.18us for Calculate distance --------------
 
-		point = in.start + in.direction * scan;
+		if (!RayMarchingStep(in, inOut, out, &state, dist, distanceOut)) break;
+	}
+	//------------- 83.2473 us for RayMarching loop -------------------------
+
+	return RayMarchingFinish(in, out, &state);
+}
 
-		if (point == lastPoint || point == point / 0.0) // detection of dead calculation
+// Ray-Marching of packet of coherent rays. Distances for all active rays are calculated together
+void cRenderWorker::RayMarchingPacket(sRayMarchingIn *in, sRayMarchingInOut *inOut,
+	sRayMarchingOut *out, CVector3 *result, int count)
+{
+	sRayMarchingState state[RAY_PACKET_SIZE];
+	CVector3 points[RAY_PACKET_SIZE];
+	CVector3 pointsLow[RAY_PACKET_SIZE];
+	double detailSizes[RAY_PACKET_SIZE];
+	double distances[RAY_PACKET_SIZE];
+	sDistanceOut distanceOuts[RAY_PACKET_SIZE];
+	int lanes[RAY_PACKET_SIZE];
+
+	for (int i = 0; i < count; i++)
+		RayMarchingInit(in[i], &inOut[i], &out[i], &state[i]);
+
+	while (true)
+	{
+		// collect rays which are still marching. Rays with cached distances are moved at once
+		int batchCount = 0;
+		bool cachedSteps = false;
+		for (int i = 0; i < count; i++)
+		{
+			if (state[i].active && RayMarchingNextPoint(in[i], &state[i]))
+			{
+				double cachedDist;
+				sDistanceOut cachedOut;
+				if (CachedDistance(in[i], state[i], &cachedDist, &cachedOut))
+				{
+					RayMarchingStep(in[i], &inOut[i], &out[i], &state[i], cachedDist, cachedOut);
+					cachedSteps = true;
+					continue;
+				}
+				points[batchCount] = state[i].point;
+				if (params->doubleDoublePrecision)
+					pointsLow[batchCount] =
+						DDPointResidual(in[i].start, in[i].direction, state[i].scan, state[i].point);
+				detailSizes[batchCount] = state[i].distThresh;
+				lanes[batchCount] = i;
+				batchCount++;
+			}
+		}
+		if (batchCount == 0)
 		{
-			// qWarning() << "Dead computation\n"
-			//		<< "Point:" << point.Debug()
-			//		<< "\nPrevious point:" << lastPoint.Debug();
-			point = lastPoint;
-			found = true;
-			deadComputationFound = true;
+			if (cachedSteps) continue;
 			break;
 		}
 
-		distThresh = CalcDistThresh(point);
+		CalculateDistanceBatch(*params, *fractal, points, detailSizes, batchCount, distances,
+			distanceOuts, data, false, params->doubleDoublePrecision ? pointsLow : NULL);
 
-		sDistanceIn distanceIn(point, distThresh, false);
-		sDistanceOut distanceOut;
-		dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
-		// qDebug() <<"thresh" <<  distThresh << "dist" << dist << "scan" << scan;
-		if (in.invertMode)
+		for (int b = 0; b < batchCount; b++)
 		{
-			dist = distThresh * 1.99 - dist;
-			if (dist < 0.0) dist = 0.0;
+			int i = lanes[b];
+			RayMarchingStep(in[i], &inOut[i], &out[i], &state[i], distances[b], distanceOuts[b]);
 		}
-		out->objectId = distanceOut.objectId;
-
-		//-------------------- 4.18us for Calculate distance --------------
+	}
 
-		// printf("Distance = %g\n", dist/distThresh);
-		inOut->stepBuff[i].distance = dist;
-		inOut->stepBuff[i].iters = distanceOut.iters;
-		inOut->stepBuff[i].distThresh = distThresh;
+	// binary searching is done separately for each ray
+	for (int i = 0; i < count; i++)
+		result[i] = RayMarchingFinish(in[i], &out[i], &state[i]);
+}
 
-		data->statistics.histogramIterations.Add(distanceOut.iters);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+void cRenderWorker::RayMarchingInit(const sRayMarchingIn &in, sRayMarchingInOut *inOut,
+	sRayMarchingOut *out, sRayMarchingState *state) const
+{
+	state->point = CVector3();
+	state->lastPoint = CVector3();
+	state->scan = in.minScan;
+	state->maxScan = in.maxScan;
+	state->dist = 0.0;
+	state->step = 0.0;
+	state->distThresh = 0.0;
+	state->previousDist = 0.0;
+	state->conservativeStep = 0.0;
+	state->counter = 0;
+	state->stepIndex = 0;
+	state->found = false;
+	state->deadComputationFound = false;
+	state->active = true;
+	state->relaxedStep = false;
+	(*inOut->buffCount) = 0;
+	if (inOut->stepBuff)
+	{
+		inOut->stepBuff->start = in.start;
+		inOut->stepBuff->direction = in.direction;
+	}
+	out->objectId = 0;
+	out->cost = sPixelCost();
 
-		if (dist > 3.0) dist = 3.0;
-		if (dist < distThresh)
+	// inside of objects surface can be found at walls of limit box, so only normal rays are clipped
+	if (limitBoxClipping && !in.invertMode)
+	{
+		if (!ClipRayToLimitBox(in, &state->scan, &state->maxScan))
 		{
-			if (dist < 0.1 * distThresh) data->statistics.missedDE++;
-			found = true;
-			break;
+			// ray doesn't hit limit box, so there is nothing to find
+			state->scan = in.maxScan;
+			state->point = in.start + in.direction * state->scan;
+			state->active = false;
 		}
+	}
+}
+
+bool cRenderWorker::CachedDistance(const sRayMarchingIn &in, const sRayMarchingState &state,
+	double *dist, sDistanceOut *distanceOut) const
+{
+	// distance of previous point tells how far the surface is. Interior and inverted rays are
+	// inside of the surface
+	if (!data->distanceCache || in.invertMode || params->interiorMode) return false;
+	double minDistance = DISTANCE_CACHE_MIN_DISTANCE * state.distThresh;
+	if (state.previousDist < minDistance) return false;
+
+	double cachedDist;
+	if (!data->distanceCache->GetDistance(
+				state.point, state.previousDist, *params, *fractal, data, &cachedDist))
+		return false;
+	if (cachedDist < minDistance) return false;
+
+	*dist = cachedDist;
+	distanceOut->distance = cachedDist;
+	distanceOut->colorIndex = 0.0;
+	distanceOut->iters = 0;
+	distanceOut->totalIters = 0;
+	distanceOut->periodicOrbits = 0;
+	distanceOut->objectId = 0;
+	distanceOut->primitiveEvaluations = -1;
+	distanceOut->maxiter = false;
+	return true;
+}
 
-		inOut->stepBuff[i].step = step;
-		if (params->interiorMode)
+// intersection of ray with limit box. Scan range is reduced to the part of ray inside the box
+bool cRenderWorker::ClipRayToLimitBox(
+	const sRayMarchingIn &in, double *minScan, double *maxScan) const
+{
+	double tNear = in.minScan;
+	double tFar = in.maxScan;
+	double start[3] = {in.start.x, in.start.y, in.start.z};
+	double direction[3] = {in.direction.x, in.direction.y, in.direction.z};
+	double boxMin[3] = {params->limitMin.x, params->limitMin.y, params->limitMin.z};
+	double boxMax[3] = {params->limitMax.x, params->limitMax.y, params->limitMax.z};
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (fabs(direction[axis]) < 1e-20)
 		{
-			step = (dist - 0.8 * distThresh) * params->DEFactor * (1.0 - Random(1000) / 10000.0);
-			;
+			if (start[axis] < boxMin[axis] || start[axis] > boxMax[axis]) return false;
 		}
 		else
 		{
-			step = (dist - 0.5 * distThresh) * params->DEFactor * (1.0 - Random(1000) / 10000.0);
-			;
-		}
-		inOut->stepBuff[i].point = point;
-		// qDebug() << "i" << i << "dist" << inOut->stepBuff[i].distance << "iters" <<
-		// inOut->stepBuff[i].iters << "distThresh" << inOut->stepBuff[i].distThresh << "step" <<
-		// inOut->stepBuff[i].step << "point" << inOut->stepBuff[i].point.Debug();
-		(*inOut->buffCount) = i + 1;
-		// divided by length of view Vector to eliminate overstepping when fov is big
-		scan += step / in.direction.Length();
-		if (scan > in.maxScan)
-		{
-			break;
+			double t1 = (boxMin[axis] - start[axis]) / direction[axis];
+			double t2 = (boxMax[axis] - start[axis]) / direction[axis];
+			tNear = max(tNear, min(t1, t2));
+			tFar = min(tFar, max(t1, t2));
 		}
 	}
-	//------------- 83.2473 us for RayMarching loop -------------------------
+	if (tNear > tFar) return false;
+
+	// surface can be detected a little outside of the box (distance threshold)
+	CVector3 entryPoint = in.start + in.direction * tNear;
+	CVector3 exitPoint = in.start + in.direction * tFar;
+	double directionLength = in.direction.Length();
+	*minScan = max(in.minScan, tNear - CalcDistThresh(entryPoint) / directionLength);
+	*maxScan = min(in.maxScan, tFar + CalcDistThresh(exitPoint) / directionLength);
+	return true;
+}
 
-	// qDebug() << "------------ binary search";
-	if (found && in.binaryEnable && !deadComputationFound)
+double cRenderWorker::ShadowRayEnd(
+	const CVector3 &point, const CVector3 &direction, double start, double end) const
+{
+	if (!params->limitsEnabled) return end;
+	sRayMarchingIn in;
+	in.start = point;
+	in.direction = direction;
+	in.minScan = start;
+	in.maxScan = end;
+	in.binaryEnable = false;
+	in.invertMode = false;
+	in.gatherFractalData = false;
+	double minScan, maxScan;
+	// if the point is not inside of the box, the ray is not clipped
+	if (!ClipRayToLimitBox(in, &minScan, &maxScan)) return end;
+	return maxScan;
+}
+
+// calculates next point on the ray. Returns false if ray-marching has to be finished
+bool cRenderWorker::RayMarchingNextPoint(const sRayMarchingIn &in, sRayMarchingState *state) const
+{
+	if (!state->active) return false;
+
+	if (state->stepIndex >= maxraymarchingSteps)
 	{
-		step *= 0.5;
-		for (int i = 0; i < 30; i++)
-		{
-			counter++;
-			if (dist < distThresh && dist > distThresh * search_limit)
-			{
-				break;
-			}
-			else
-			{
-				if (dist > distThresh)
-				{
-					scan += step;
-					point = in.start + in.direction * scan;
-				}
-				else if (dist < distThresh * search_limit)
-				{
-					scan -= step;
-					point = in.start + in.direction * scan;
-				}
-			}
+		state->active = false;
+		return false;
+	}
+
+	// long ray marches are interrupted when rendering is stopped
+	if ((state->stepIndex & RAY_STOP_CHECK_MASK) == RAY_STOP_CHECK_MASK
+			&& (systemData.globalStopRequest || (data->stopRequest && *data->stopRequest)))
+	{
+		state->active = false;
+		return false;
+	}
+
+	state->lastPoint = state->point;
+	state->counter++;
+	state->point = in.start + in.direction * state->scan;
 
-			distThresh = CalcDistThresh(point);
+	// detection of dead calculation. With double-double numbers the point can stay the same in
+	// double precision while the ray is still moving
+	bool deadPoint = state->point == state->lastPoint;
+	if (deadPoint && params->doubleDoublePrecision)
+		deadPoint = state->step <= state->scan * 1e-16;
+	if (deadPoint || state->point == state->point / 0.0)
+	{
+		// qWarning() << "Dead computation\n"
+		//		<< "Point:" << point.Debug()
+		//		<< "\nPrevious point:" << lastPoint.Debug();
+		state->point = state->lastPoint;
+		state->found = true;
+		state->deadComputationFound = true;
+		state->active = false;
+		return false;
+	}
 
-			sDistanceIn distanceIn(point, distThresh, false);
-			sDistanceOut distanceOut;
-			dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
+	state->distThresh = CalcDistThresh(state->point);
+	return true;
+}
 
-			// qDebug() << "i" << i <<"thresh" <<  distThresh << "dist" << dist << "scan" << scan <<
-			// "step" << step;
+// uses calculated distance to make next step. Returns false if ray-marching is finished
+bool cRenderWorker::RayMarchingStep(const sRayMarchingIn &in, sRayMarchingInOut *inOut,
+	sRayMarchingOut *out, sRayMarchingState *state, double dist, const sDistanceOut &distanceOut)
+{
+	int i = state->stepIndex;
+	double distThresh = state->distThresh;
 
-			if (in.invertMode)
-			{
-				dist = distThresh * 1.99 - dist;
-				if (dist < 0.0) dist = 0.0;
-			}
+	// qDebug() <<"thresh" <<  distThresh << "dist" << dist << "scan" << scan;
+	if (in.invertMode)
+	{
+		dist = distThresh * 1.99 - dist;
+		if (dist < 0.0) dist = 0.0;
+	}
+	out->objectId = distanceOut.objectId;
 
-			out->objectId = distanceOut.objectId;
+	// printf("Distance = %g\n", dist/distThresh);
+	sStepBuffer *steps = inOut->stepBuff;
+	if (steps)
+	{
+		steps->distance[i] = dist;
+		steps->iters[i] = distanceOut.iters;
+		steps->distThresh[i] = distThresh;
+	}
 
-			data->statistics.histogramIterations.Add(distanceOut.iters);
-			data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+	threadData->statistics.histogramIterations.Add(distanceOut.iters);
+	CountDistance(distanceOut);
+	out->cost.Count(distanceOut.totalIters, true);
 
-			step *= 0.5;
-		}
+	if (dist > 3.0) dist = 3.0;
+
+	// enhanced sphere tracing: if unbound spheres of last two points don't overlap, the relaxed
+	// step could jump over the surface, so it is repeated as a conservative step
+	if (state->relaxedStep && state->previousDist + dist < state->step)
+	{
+		state->scan += (state->conservativeStep - state->step) / in.direction.Length();
+		state->step = state->conservativeStep;
+		state->relaxedStep = false;
+		threadData->statistics.numberOfRelaxationFallbacks++;
+		return true;
+	}
+
+	state->dist = dist;
+	if (dist < distThresh)
+	{
+		if (dist < 0.1 * distThresh) threadData->statistics.missedDE++;
+		state->found = true;
+		state->active = false;
+		return false;
+	}
+
+	if (steps) steps->step[i] = state->step;
+	if (params->interiorMode)
+	{
+		state->step = (dist - 0.8 * distThresh) * params->DEFactor * (1.0 - sampler.Random() * 0.1);
+	}
+	else
+	{
+		state->step = (dist - 0.5 * distThresh) * params->DEFactor * (1.0 - sampler.Random() * 0.1);
+	}
+	state->conservativeStep = state->step;
+	state->previousDist = dist;
+	state->relaxedStep = params->raymarchingRelaxation > 1.0 && !in.invertMode;
+	if (state->relaxedStep) state->step *= params->raymarchingRelaxation;
+
+	if (steps) steps->scan[i] = state->scan;
+	(*inOut->buffCount) = i + 1;
+	// divided by length of view Vector to eliminate overstepping when fov is big
+	state->scan += state->step / in.direction.Length();
+	state->stepIndex++;
+
+	// end of the ray has to be reached by conservative step
+	if (state->scan > state->maxScan && state->relaxedStep)
+	{
+		state->scan += (state->conservativeStep - state->step) / in.direction.Length();
+		state->step = state->conservativeStep;
+		state->relaxedStep = false;
+	}
+
+	if (state->scan > state->maxScan)
+	{
+		state->active = false;
+		return false;
+	}
+	return true;
+}
+
+// binary searching of surface and final results of ray-marching
+CVector3 cRenderWorker::RayMarchingFinish(
+	const sRayMarchingIn &in, sRayMarchingOut *out, sRayMarchingState *state)
+{
+	CVector3 point = state->point;
+	double scan = state->scan;
+	double dist = state->dist;
+	double step = state->step;
+	double distThresh = state->distThresh;
+	int counter = state->counter;
+
+	// qDebug() << "------------ binary search";
+	if (state->found && in.binaryEnable && !state->deadComputationFound)
+	{
+		sRefinedHit hit;
+		hit.point = point;
+		hit.scan = scan;
+		hit.dist = dist;
+		hit.distThresh = distThresh;
+		hit.counter = counter;
+
+		if (params->hitRefinementMode == params::refinementSecant)
+			RefineHitSecant(in, out, step, &hit);
+		else
+			RefineHitBisection(in, out, step, &hit);
+
+		threadData->statistics.numberOfRefinedHits++;
+		threadData->statistics.numberOfRefinementSteps += hit.counter - counter;
+
+		point = hit.point;
+		scan = hit.scan;
+		dist = hit.dist;
+		distThresh = hit.distThresh;
+		counter = hit.counter;
 	}
 	if (params->common.iterThreshMode)
 	{
@@ -660,200 +2236,442 @@ CVector3 cRenderWorker::RayMarching(
 
 	//---------- 7.19605us for binary searching ---------------
 
-	data->statistics.histogramStepCount.Add(counter);
+	threadData->statistics.histogramStepCount.Add(counter);
 
-	out->found = found;
+	out->found = state->found;
 	out->lastDist = dist;
 	out->depth = scan;
 	out->distThresh = distThresh;
-	data->statistics.numberOfRaymarchings++;
+	out->fractalDataValid = false;
+
+	// colour and orbit trap for shaders are gathered together by the last fractal evaluation
+	if (fusedFractalColouring && in.gatherFractalData && state->found
+			&& data->objectData[out->objectId].objectType == fractal::objFractal)
+	{
+		const cMaterial &material = data->materials[data->objectData[out->objectId].materialId];
+		if (material.useColorsFromPalette || params->fakeLightsEnabled)
+		{
+			// minimum number of iterations is 0 like in SurfaceColour()
+			sFractalIn fractIn(point, 0, params->N, params->common, -1, material.fractalColoring);
+			sFractalOut fractOut;
+			Compute<fractal::calcModeCombined>(*fractal, fractIn, &fractOut);
+			out->colorIndex = fractOut.colorIndex;
+			out->orbitTrapR = fractOut.orbitTrapR;
+			out->fractalDataValid = true;
+		}
+	}
+
+	threadData->statistics.numberOfRaymarchings++;
 	return point;
 }
 
+// distance used for refinement of hit point
+double cRenderWorker::RefinementDistance(
+	const sRayMarchingIn &in, const CVector3 &point, double distThresh, sRayMarchingOut *out)
+{
+	sDistanceIn distanceIn(point, distThresh, false);
+	sDistanceOut distanceOut;
+	double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
+
+	if (in.invertMode)
+	{
+		dist = distThresh * 1.99 - dist;
+		if (dist < 0.0) dist = 0.0;
+	}
+
+	out->objectId = distanceOut.objectId;
+
+	threadData->statistics.histogramIterations.Add(distanceOut.iters);
+	CountDistance(distanceOut);
+	out->cost.Count(distanceOut.totalIters, false);
+	return dist;
+}
+
+// binary searching of distance where DE is just below distance threshold
+void cRenderWorker::RefineHitBisection(
+	const sRayMarchingIn &in, sRayMarchingOut *out, double step, sRefinedHit *hit)
+{
+	double search_accuracy = 0.01 * params->detailLevel;
+	double search_limit = 1.0 - search_accuracy;
+
+	step *= 0.5;
+	for (int i = 0; i < 30; i++)
+	{
+		hit->counter++;
+		if (hit->dist < hit->distThresh && hit->dist > hit->distThresh * search_limit)
+		{
+			break;
+		}
+		else
+		{
+			if (hit->dist > hit->distThresh)
+			{
+				hit->scan += step;
+				hit->point = in.start + in.direction * hit->scan;
+			}
+			else if (hit->dist < hit->distThresh * search_limit)
+			{
+				hit->scan -= step;
+				hit->point = in.start + in.direction * hit->scan;
+			}
+		}
+
+		hit->distThresh = CalcDistThresh(hit->point);
+		hit->dist = RefinementDistance(in, hit->point, hit->distThresh, out);
+
+		// qDebug() << "i" << i <<"thresh" <<  distThresh << "dist" << dist << "scan" << scan <<
+		// "step" << step;
+
+		step *= 0.5;
+	}
+}
+
+// DE is almost linear function of distance along the ray close to the surface, so the root is
+// searched by false position method (Illinois variant) between the last two ray-marching points
+void cRenderWorker::RefineHitSecant(
+	const sRayMarchingIn &in, sRayMarchingOut *out, double step, sRefinedHit *hit)
+{
+	double search_accuracy = 0.01 * params->detailLevel;
+	double search_limit = 1.0 - search_accuracy;
+	// middle of accepted range of DE
+	double targetFactor = 1.0 - 0.5 * search_accuracy;
+
+	hit->counter++;
+	if (hit->dist < hit->distThresh && hit->dist > hit->distThresh * search_limit) return;
+
+	// point before the last step
+	double scanA = hit->scan - step;
+	CVector3 pointA = in.start + in.direction * scanA;
+	double distThreshA = CalcDistThresh(pointA);
+	int objectIdB = out->objectId;
+	double fA = RefinementDistance(in, pointA, distThreshA, out) - distThreshA * targetFactor;
+	out->objectId = objectIdB;
+	hit->counter++;
+
+	// surface is not between points, so nothing better than bisection can be done
+	if (fA <= 0.0)
+	{
+		RefineHitBisection(in, out, step, hit);
+		return;
+	}
+
+	// last point which was inside the threshold
+	sRefinedHit inside = *hit;
+	double scanB = hit->scan;
+	double fB = hit->dist - hit->distThresh * targetFactor;
+
+	int side = 0;
+	for (int i = 0; i < 30; i++)
+	{
+		hit->scan = (scanA * fB - scanB * fA) / (fB - fA);
+		hit->point = in.start + in.direction * hit->scan;
+		hit->distThresh = CalcDistThresh(hit->point);
+		hit->dist = RefinementDistance(in, hit->point, hit->distThresh, out);
+		hit->counter++;
+
+		if (hit->dist < hit->distThresh && hit->dist > hit->distThresh * search_limit) return;
+
+		double fX = hit->dist - hit->distThresh * targetFactor;
+		if (fX > 0.0)
+		{
+			scanA = hit->scan;
+			fA = fX;
+			if (side > 0) fB *= 0.5;
+			side = 1;
+		}
+		else
+		{
+			scanB = hit->scan;
+			fB = fX;
+			if (side < 0) fA *= 0.5;
+			side = -1;
+			inside = *hit;
+			objectIdB = out->objectId;
+		}
+	}
+
+	// point outside of the surface is never returned
+	if (hit->dist >= hit->distThresh)
+	{
+		inside.counter = hit->counter;
+		*hit = inside;
+		out->objectId = objectIdB;
+	}
+}
+
+// Ray tracing of reflections and refractions. Tree of secondary rays is traversed by iterative
+// loop. State of every level is kept on preallocated per-thread stack (rayStack)
 cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
-	sRayRecursionIn in, sRayRecursionInOut &inOut)
+	const sRayRecursionIn &in, sRayRecursionInOut &inOut)
 {
-	sRayMarchingOut rayMarchingOut;
+	int depth = 0;
+	sRayRecursionNode *root = &rayStack[0];
+	root->in = in;
+	root->rayIndex = inOut.rayIndex;
+	root->rayMarchingInOut = inOut.rayMarchingInOut;
+	root->result = NULL;
+	RayRecursionBegin(root);
+
+	while (true)
+	{
+		sRayRecursionNode *node = &rayStack[depth];
+
+		if (node->stage == rayStageRefraction)
+		{
+			node->stage = rayStageReflection;
+			if (node->traceRefraction)
+			{
+				depth++;
+				PrepareRefractedRay(*node, &rayStack[depth]);
+				RayRecursionBegin(&rayStack[depth]);
+				continue;
+			}
+		}
+
+		if (node->stage == rayStageReflection)
+		{
+			node->stage = rayStageShading;
+			if (node->traceReflection)
+			{
+				depth++;
+				PrepareReflectedRay(*node, &rayStack[depth]);
+				RayRecursionBegin(&rayStack[depth]);
+				continue;
+			}
+		}
 
-	*inOut.rayMarchingInOut.buffCount = 0;
+		// all secondary rays of this level are done
+		sRayRecursionOut out;
+		RayRecursionFinish(node, &out);
+		if (depth == 0) return out;
+		*node->result = out.resultShader;
+		depth--;
+	}
+}
 
-	// trace the light in given direction
-	CVector3 point = RayMarching(in.rayMarchingIn, &inOut.rayMarchingInOut, &rayMarchingOut);
+// ray-marching and shaders needed before secondary rays are traced
+void cRenderWorker::RayRecursionBegin(sRayRecursionNode *node)
+{
+	const sRayRecursionIn &in = node->in;
+	sRayMarchingOut &rayMarchingOut = node->rayMarchingOut;
+	CVector3 &point = node->point;
 
-	sRGBAfloat resultShader = in.resultShader;
-	sRGBAfloat objectColour = in.objectColour;
+	if (in.rayMarchingDone)
+	{
+		// primary ray was already traced by RayMarchingPacket()
+		rayMarchingOut = in.rayMarchingOut;
+		point = in.rayMarchingPoint;
+	}
+	else
+	{
+		*node->rayMarchingInOut.buffCount = 0;
 
-	// here will be called branch for RayRecursion();
+		// trace the light in given direction
+		threadData->stageTimer.Enter(
+			node->rayIndex == 0 ? renderStagePrimaryRays : renderStageSecondaryRays);
+		point = RayMarching(in.rayMarchingIn, &node->rayMarchingInOut, &rayMarchingOut);
+		threadData->stageTimer.Leave();
+	}
+	pixelCost.Add(rayMarchingOut.cost);
 
-	sRGBAfloat objectShader;
-	objectShader.A = 0.0;
-	sRGBAfloat backgroundShader;
-	sRGBAfloat volumetricShader;
-	sRGBAfloat specular;
+	node->objectColour = in.objectColour;
 
 	// prepare data for shaders
-	CVector3 lightVector = shadowVector;
-	sShaderInputData shaderInputData;
+	sShaderInputData &shaderInputData = node->shaderInputData;
 	shaderInputData.distThresh = rayMarchingOut.distThresh;
 	shaderInputData.delta = CalcDelta(point);
-	shaderInputData.lightVect = lightVector;
+	shaderInputData.lightVect = shadowVector;
 	shaderInputData.point = point;
 	shaderInputData.viewVector = in.rayMarchingIn.direction;
 	shaderInputData.lastDist = rayMarchingOut.lastDist;
 	shaderInputData.depth = rayMarchingOut.depth;
-	shaderInputData.stepCount = *inOut.rayMarchingInOut.buffCount;
-	shaderInputData.stepBuff = inOut.rayMarchingInOut.stepBuff;
+	shaderInputData.stepCount = *node->rayMarchingInOut.buffCount;
+	shaderInputData.stepBuff = node->rayMarchingInOut.stepBuff;
 	shaderInputData.invertMode = in.calcInside;
+	shaderInputData.primaryRay = node->rayIndex == 0 && !in.calcInside;
 	shaderInputData.objectId = rayMarchingOut.objectId;
+	shaderInputData.colorIndex = rayMarchingOut.colorIndex;
+	shaderInputData.orbitTrapR = rayMarchingOut.orbitTrapR;
+	shaderInputData.fractalDataValid = rayMarchingOut.found && rayMarchingOut.fractalDataValid;
 
-	cObjectData objectData = data->objectData[shaderInputData.objectId];
+	const cObjectData &objectData = data->objectData[shaderInputData.objectId];
 	shaderInputData.material = &data->materials[objectData.materialId];
 
-	sRGBAfloat reflectShader = in.resultShader;
-	double reflect = shaderInputData.material->reflectance;
+	node->reflectShader = in.resultShader;
+	node->reflect = shaderInputData.material->reflectance;
 
-	sRGBAfloat transparentShader = in.resultShader;
-	double transparent = shaderInputData.material->transparencyOfSurface;
-	sRGBfloat transparentColor =
+	node->transparentShader = in.resultShader;
+	node->transparent = shaderInputData.material->transparencyOfSurface;
+	node->transparentColor =
 		sRGBfloat(shaderInputData.material->transparencyInteriorColor.R / 65536.0,
 			shaderInputData.material->transparencyInteriorColor.G / 65536.0,
 			shaderInputData.material->transparencyInteriorColor.B / 65536.0);
-	resultShader.R = transparentColor.R;
-	resultShader.G = transparentColor.G;
-	resultShader.B = transparentColor.B;
+	node->resultShader = in.resultShader;
+	node->resultShader.R = node->transparentColor.R;
+	node->resultShader.G = node->transparentColor.G;
+	node->resultShader.B = node->transparentColor.B;
 
-	CVector3 vn;
+	node->stage = rayStageRefraction;
+	node->traceRefraction = false;
+	node->traceReflection = false;
 
 	// if found any object
 	if (rayMarchingOut.found)
 	{
 		// calculate normal vector
-		vn = CalculateNormals(shaderInputData);
-		shaderInputData.normal = vn;
-
-		// letting colors from textures (before normal map shader)
-		if (shaderInputData.material->colorTexture.IsLoaded())
-			shaderInputData.texColor =
-				TextureShader(shaderInputData, texture::texColor, shaderInputData.material);
+		if (in.normalDone)
+			node->vn = in.normal;
 		else
-			shaderInputData.texColor = sRGBfloat(1.0, 1.0, 1.0);
+			node->vn = CalculateNormals(shaderInputData);
+		shaderInputData.normal = node->vn;
 
-		if (shaderInputData.material->luminosityTexture.IsLoaded())
-			shaderInputData.texLuminosity =
-				TextureShader(shaderInputData, texture::texLuminosity, shaderInputData.material);
-		else
-			shaderInputData.texLuminosity = sRGBfloat(0.0, 0.0, 0.0);
+		// texture mapping is calculated once for all textures of the material
+		const cMaterial *mat = shaderInputData.material;
+		bool useNormalMap = mat->normalMapTexture.IsLoaded() && !in.normalDone;
+		sTextureFootprint footprint;
+		if (useNormalMap || mat->colorTexture.IsLoaded() || mat->luminosityTexture.IsLoaded()
+				|| mat->diffusionTexture.IsLoaded())
+			footprint = TextureFootprint(shaderInputData);
 
-		if (shaderInputData.material->diffusionTexture.IsLoaded())
-			shaderInputData.texDiffuse =
-				TextureShader(shaderInputData, texture::texDiffuse, shaderInputData.material);
-		else
-			shaderInputData.texDiffuse = sRGBfloat(1.0, 1.0, 1.0);
+		// letting colors from textures (before normal map shader)
+		MaterialTexturesShader(&shaderInputData, footprint);
 
-		if (shaderInputData.material->normalMapTexture.IsLoaded())
+		if (useNormalMap)
 		{
-			vn = NormalMapShader(shaderInputData);
+			node->vn = NormalMapShader(shaderInputData, footprint);
 		}
 
 		// prepare refraction values
-		double n1, n2;
 		if (in.calcInside) // if trace is inside the object
 		{
-			n1 = shaderInputData.material->transparencyIndexOfRefraction; // reverse refractive indices
-			n2 = 1.0;
+			// reverse refractive indices
+			node->n1 = shaderInputData.material->transparencyIndexOfRefraction;
+			node->n2 = 1.0;
 		}
 		else
 		{
-			n1 = 1.0;
-			n2 = shaderInputData.material->transparencyIndexOfRefraction;
-			;
+			node->n1 = 1.0;
+			node->n2 = shaderInputData.material->transparencyIndexOfRefraction;
 		}
 
-		if (inOut.rayIndex < reflectionsMax)
+		if (node->rayIndex < reflectionsMax)
 		{
+			node->traceRefraction = node->transparent > 0.0;
+			node->traceReflection = node->reflect > 0.0;
+		}
+	}
+}
 
-			// calculate refraction (transparency)
-			if (transparent > 0.0)
-			{
-				sRayRecursionIn recursionIn;
-				sRayMarchingIn rayMarchingIn;
-				sRayMarchingInOut rayMarchingInOut;
+// buffers for ray-marching data of given recursion index. Step buffers are allocated on demand
+// and used only if steps have to be recorded
+cRenderWorker::sRayMarchingInOut cRenderWorker::RayMarchingBuffers(int rayIndex, bool record)
+{
+	sRayBuffer &buffer = rayBuffer[rayIndex];
+	if (record && !buffer.stepBuff)
+	{
+		buffer.stepBuff = new sStepBuffer(maxraymarchingSteps + 2);
+		buffer.buffCount = 0;
+	}
+	sRayMarchingInOut rayMarchingInOut;
+	rayMarchingInOut.buffCount = &buffer.buffCount;
+	rayMarchingInOut.stepBuff = record ? buffer.stepBuff : NULL;
+	return rayMarchingInOut;
+}
 
-				// calculate direction of refracted light
-				CVector3 newDirection = RefractVector(vn, in.rayMarchingIn.direction, n1, n2);
+void cRenderWorker::PrepareRefractedRay(sRayRecursionNode &parent, sRayRecursionNode *child)
+{
+	const sRayRecursionIn &in = parent.in;
+	double distThresh = parent.shaderInputData.distThresh;
 
-				// move starting point a little
-				CVector3 newPoint = point + in.rayMarchingIn.direction * shaderInputData.distThresh * 1.0;
+	// calculate direction of refracted light
+	CVector3 newDirection =
+		RefractVector(parent.vn, in.rayMarchingIn.direction, parent.n1, parent.n2);
 
-				// if is total internal reflection the use reflection instead of refraction
-				bool internalReflection = false;
-				if (newDirection.Length() == 0.0)
-				{
-					newDirection = ReflectionVector(vn, in.rayMarchingIn.direction);
-					newPoint = point + in.rayMarchingIn.direction * shaderInputData.distThresh * 1.0;
-					internalReflection = true;
-				}
+	// move starting point a little
+	CVector3 newPoint = parent.point + in.rayMarchingIn.direction * distThresh * 1.0;
 
-				// preparation for new recursion
-				rayMarchingIn.binaryEnable = true;
-				rayMarchingIn.direction = newDirection;
-				rayMarchingIn.maxScan = params->viewDistanceMax;
-				rayMarchingIn.minScan = 0.0;
-				rayMarchingIn.start = newPoint;
-				rayMarchingIn.invertMode = !in.calcInside || internalReflection;
-				recursionIn.rayMarchingIn = rayMarchingIn;
-				recursionIn.calcInside = !in.calcInside || internalReflection;
-				recursionIn.resultShader = resultShader;
-				recursionIn.objectColour = objectColour;
-
-				// setup buffers for ray data
-				inOut.rayIndex++; // increase recursion index
-				rayMarchingInOut.buffCount = &rayBuffer[inOut.rayIndex].buffCount;
-				rayMarchingInOut.stepBuff = rayBuffer[inOut.rayIndex].stepBuff;
-				inOut.rayMarchingInOut = rayMarchingInOut;
-
-				// recursion for refraction
-				sRayRecursionOut recursionOutTransparent = RayRecursion(recursionIn, inOut);
-				transparentShader = recursionOutTransparent.resultShader;
-			}
+	// if is total internal reflection the use reflection instead of refraction
+	bool internalReflection = false;
+	if (newDirection.Length() == 0.0)
+	{
+		newDirection = ReflectionVector(parent.vn, in.rayMarchingIn.direction);
+		newPoint = parent.point + in.rayMarchingIn.direction * distThresh * 1.0;
+		internalReflection = true;
+	}
 
-			// calculate reflection
-			if (reflect > 0.0)
-			{
-				sRayRecursionIn recursionIn;
-				sRayMarchingIn rayMarchingIn;
-				sRayMarchingInOut rayMarchingInOut;
-
-				// calculate new direction of reflection
-				CVector3 newDirection = ReflectionVector(vn, in.rayMarchingIn.direction);
-				CVector3 newPoint = point + newDirection * shaderInputData.distThresh;
-
-				// prepare for new recursion
-				rayMarchingIn.binaryEnable = true;
-				rayMarchingIn.direction = newDirection;
-				rayMarchingIn.maxScan = params->viewDistanceMax;
-				rayMarchingIn.minScan = 0.0;
-				rayMarchingIn.start = newPoint;
-				rayMarchingIn.invertMode = false;
-				recursionIn.rayMarchingIn = rayMarchingIn;
-				recursionIn.calcInside = false;
-				recursionIn.resultShader = resultShader;
-				recursionIn.objectColour = objectColour;
-
-				// setup buffers for ray data
-				inOut.rayIndex++; // increase recursion index
-				rayMarchingInOut.buffCount = &rayBuffer[inOut.rayIndex].buffCount;
-				rayMarchingInOut.stepBuff = rayBuffer[inOut.rayIndex].stepBuff;
-				inOut.rayMarchingInOut = rayMarchingInOut;
-
-				// recursion for reflection
-				sRayRecursionOut recursionOutReflect = RayRecursion(recursionIn, inOut);
-				reflectShader = recursionOutReflect.resultShader;
-			}
-			if (transparent > 0.0) inOut.rayIndex--; // decrease recursion index
-			if (reflect > 0.0) inOut.rayIndex--;		 // decrease recursion index
-		}
+	// preparation for new level
+	sRayRecursionIn &recursionIn = child->in;
+	recursionIn = sRayRecursionIn();
+	recursionIn.rayMarchingIn.binaryEnable = true;
+	recursionIn.rayMarchingIn.direction = newDirection;
+	recursionIn.rayMarchingIn.maxScan = params->viewDistanceMax;
+	recursionIn.rayMarchingIn.minScan = 0.0;
+	recursionIn.rayMarchingIn.start = newPoint;
+	recursionIn.rayMarchingIn.invertMode = !in.calcInside || internalReflection;
+	recursionIn.rayMarchingIn.gatherFractalData = true;
+	recursionIn.calcInside = !in.calcInside || internalReflection;
+	recursionIn.resultShader = parent.resultShader;
+	recursionIn.objectColour = parent.objectColour;
+
+	// setup buffers for ray data (absorption inside of the object needs steps)
+	child->rayIndex = parent.rayIndex + 1;
+	child->rayMarchingInOut =
+		RayMarchingBuffers(child->rayIndex, recordSteps || recursionIn.calcInside);
+	child->result = &parent.transparentShader;
+}
 
+void cRenderWorker::PrepareReflectedRay(sRayRecursionNode &parent, sRayRecursionNode *child)
+{
+	const sRayRecursionIn &in = parent.in;
+
+	// calculate new direction of reflection
+	CVector3 newDirection = ReflectionVector(parent.vn, in.rayMarchingIn.direction);
+	CVector3 newPoint = parent.point + newDirection * parent.shaderInputData.distThresh;
+
+	// prepare for new level
+	sRayRecursionIn &recursionIn = child->in;
+	recursionIn = sRayRecursionIn();
+	recursionIn.rayMarchingIn.binaryEnable = true;
+	recursionIn.rayMarchingIn.direction = newDirection;
+	recursionIn.rayMarchingIn.maxScan = params->viewDistanceMax;
+	recursionIn.rayMarchingIn.minScan = 0.0;
+	recursionIn.rayMarchingIn.start = newPoint;
+	recursionIn.rayMarchingIn.invertMode = false;
+	recursionIn.rayMarchingIn.gatherFractalData = true;
+	recursionIn.calcInside = false;
+	recursionIn.resultShader = parent.resultShader;
+	recursionIn.objectColour = parent.objectColour;
+
+	// setup buffers for ray data (refracted ray already used next index)
+	child->rayIndex = parent.rayIndex + (parent.traceRefraction ? 2 : 1);
+	child->rayMarchingInOut = RayMarchingBuffers(child->rayIndex, recordSteps);
+	child->result = &parent.reflectShader;
+}
+
+// shaders which need results of secondary rays
+void cRenderWorker::RayRecursionFinish(sRayRecursionNode *node, sRayRecursionOut *out)
+{
+	const sRayRecursionIn &in = node->in;
+	const sRayMarchingOut &rayMarchingOut = node->rayMarchingOut;
+	sShaderInputData &shaderInputData = node->shaderInputData;
+	sRGBAfloat &resultShader = node->resultShader;
+	sRGBAfloat &objectColour = node->objectColour;
+	const sRGBAfloat &reflectShader = node->reflectShader;
+	const sRGBAfloat &transparentShader = node->transparentShader;
+	const sRGBfloat &transparentColor = node->transparentColor;
+	double reflect = node->reflect;
+	double transparent = node->transparent;
+	CVector3 vn = node->vn;
+
+	sRGBAfloat objectShader;
+	objectShader.A = 0.0;
+	sRGBAfloat backgroundShader;
+	sRGBAfloat volumetricShader;
+	sRGBAfloat specular;
+
+	// if found any object
+	if (rayMarchingOut.found)
+	{
 		shaderInputData.normal = vn;
 
 		// calculate effects for object surface
@@ -865,7 +2683,7 @@ cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
 
 		if (shaderInputData.material->fresnelReflectance)
 		{
-			reflectance = Reflectance(vn, in.rayMarchingIn.direction, n1, n2);
+			reflectance = Reflectance(vn, in.rayMarchingIn.direction, node->n1, node->n2);
 			if (reflectance < 0.0) reflectance = 0.0;
 			if (reflectance > 1.0) reflectance = 1.0;
 			reflectanceN = 1.0 - reflectance;
@@ -918,9 +2736,9 @@ cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
 	{
 		for (int index = shaderInputData.stepCount - 1; index > 0; index--)
 		{
-			double step = shaderInputData.stepBuff[index].step;
+			double step = shaderInputData.stepBuff->step[index];
 
-			// CVector3 point = shaderInputData.stepBuff[index].point;
+			// CVector3 point = shaderInputData.stepBuff->Point(index);
 			// shaderInputData.point = point;
 			// sRGBAfloat color = SurfaceColour(shaderInputData);
 			// transparentColor.R = color.R;
@@ -942,28 +2760,27 @@ cRenderWorker::sRayRecursionOut cRenderWorker::RayRecursion(
 	}
 
 	// prepare final result
-	sRayRecursionOut out;
-	out.point = point;
-	out.rayMarchingOut = rayMarchingOut;
-	out.objectColour = objectColour;
-	out.resultShader = resultShader;
-	out.found = (shaderInputData.depth == 1e20) ? false : true;
-	out.fogOpacity = opacityOut.R;
-	out.normal = vn;
-
-	return out;
+	out->point = node->point;
+	out->rayMarchingOut = rayMarchingOut;
+	out->objectColour = objectColour;
+	out->resultShader = resultShader;
+	out->found = (shaderInputData.depth == 1e20) ? false : true;
+	out->fogOpacity = opacityOut.R;
+	out->normal = vn;
 }
 
 void cRenderWorker::MonteCarloDOF(
-	CVector2<double> imagePoint, CVector3 *startRay, CVector3 *viewVector)
+	CVector2<double> imagePoint, int sampleIndex, CVector3 *startRay, CVector3 *viewVector)
 {
+	// uniform sample of lens disc
+	CVector2<double> lensSample = sampler.Get2D(sampleIndex, 0);
+	double randR = 0.0015 * params->DOFRadius * params->DOFFocus * sqrt(lensSample.x);
+	double randAngle = 2.0 * M_PI * lensSample.y;
+	CVector3 randVector(randR * sin(randAngle), 0.0, randR * cos(randAngle));
+
 	if (params->perspectiveType == params::perspThreePoint)
 	{
-		double randR = 0.0015 * params->DOFRadius * params->DOFFocus * sqrt(Random(65536) / 65536.0);
-		float randAngle = Random(65536);
-		CVector3 randVector(randR * sin(randAngle), 0.0, randR * cos(randAngle));
 		CVector3 randVectorRot = mRot.RotateVector(randVector);
-		CVector2<double> imagePoint2;
 		CVector3 viewVectorTemp =
 			CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
 		viewVectorTemp -= randVectorRot / params->DOFFocus;
@@ -974,9 +2791,6 @@ void cRenderWorker::MonteCarloDOF(
 	{
 		CVector3 viewVectorTemp =
 			CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
-		double randR = 0.0015 * params->DOFRadius * params->DOFFocus * sqrt(Random(65536) / 65536.0);
-		float randAngle = Random(65536);
-		CVector3 randVector(randR * sin(randAngle), 0.0, randR * cos(randAngle));
 
 		CVector3 side = viewVectorTemp.Cross(params->topVector);
 		side.Normalize();
@@ -984,7 +2798,6 @@ void cRenderWorker::MonteCarloDOF(
 		topTemp.Normalize();
 		CVector3 randVectorRot = side * randVector.x + topTemp * randVector.z;
 
-		CVector2<double> imagePoint2;
 		viewVectorTemp -= randVectorRot / params->DOFFocus;
 		*viewVector = viewVectorTemp;
 		*startRay = params->camera + randVectorRot;
@@ -41,16 +41,45 @@
 #include "color_structures.hpp"
 #include "texture_enums.hpp"
 #include "algebra.hpp"
+#include "calculate_distance.hpp"
+#include "sampler.hpp"
+#include "stage_timer.hpp"
+#include "statistics.h"
+#include "stereo.h"
 
 // forward declarations
 class cMaterial;
 struct sLight;
 class cCameraTarget;
+class cCubeLUT;
 class cImage;
 struct sRenderData;
 class cParamRender;
 class cNineFractals;
 class cScheduler;
+class cTileScheduler;
+struct sDistanceOut;
+
+// number of primary rays marched together
+#define RAY_PACKET_SIZE 4
+
+// stop request is checked every (mask + 1) steps of ray marching
+#define RAY_STOP_CHECK_MASK 63
+
+// adaptive volumetric integration: steps behind this transmittance are not evaluated
+#define VOLUMETRIC_MIN_TRANSMITTANCE 0.002
+// ... shadows of volumetric lights are reused from previous step below this transmittance
+#define VOLUMETRIC_SHADOW_REUSE_TRANSMITTANCE 0.1
+// ... steps are merged while opacity of merged segment is lower than this value
+#define VOLUMETRIC_LOW_DENSITY 0.001
+// ... maximum length of merged segment relative to the pixel footprint
+#define VOLUMETRIC_MAX_MERGE 8.0
+
+// shadow rays are finished when the light is attenuated below this value
+#define SHADOW_MIN_LIGHT 0.002
+
+// number of shadow rays from wavefront queue traced together
+#define WAVEFRONT_BATCH_SIZE 8
 
 class cRenderWorker : public QObject
 {
@@ -62,42 +91,90 @@ public:
 		int id;
 		int startLine;
 		cScheduler *scheduler;
+		int cpu;  // CPU which the thread is bound to, -1 if not bound
+		int node; // NUMA node of the thread
+		cStageTimer stageTimer; // used only by the thread of this worker
+		// statistics collected by this thread without locking. Merged with sRenderData::statistics
+		// by the main thread
+		cStatistics statistics;
+		char padding[64]; // data of neighbouring threads is not in the same cache line
+	};
+
+	// ambient occlusion data
+	struct sVectorsAround
+	{
+		double alpha;
+		double beta;
+		CVector3 v;
+		int R;
+		int G;
+		int B;
 	};
 
 	cRenderWorker(const cParamRender *_params, const cNineFractals *_fractal,
 		sThreadData *_threadData, sRenderData *_data, cImage *_image);
 	~cRenderWorker();
 
+	// true if glow, fog or visible lights are accumulated along whole rays, so empty parts of rays
+	// cannot be skipped
+	static bool VolumetricEffectsEnabled(const cParamRender *params, const sRenderData *data);
+
+	// shader variant with branches of disabled features removed, chosen for given settings
+	static int SelectShaderVariant(const cParamRender *params, const sRenderData *data);
+	static QString GetShaderVariantName(int variant);
+
+	// look-up tables of colours of background and environment map in all directions
+	static void FillBackgroundLUT(const cParamRender *params, const sRenderData *data, cCubeLUT *lut);
+	static void FillEnvMapLUT(const sRenderData *data, cCubeLUT *lut);
+
+	// directions of rays of multi-ray ambient occlusion. Returns number of vectors
+	static int GenerateAOVectors(
+		const cParamRender *params, const sRenderData *data, sVectorsAround *vectors, int maxCount);
+
+	// assigns new job data. Job dependent buffers are prepared at next doWork() call
+	void UpdateJob(
+		const cParamRender *_params, const cNineFractals *_fractal, sRenderData *_data, cImage *_image);
+
 	QThread workerThread;
 
 private:
-	// raymarching step data
-	struct sStep
+	// raymarching steps in SoA layout, recorded only for shaders which integrate along the ray.
+	// Points are stored as distances along the ray
+	struct sStepBuffer
 	{
-		double distance;
-		double step;
-		CVector3 point;
-		int iters;
-		double distThresh;
+		sStepBuffer(int size)
+				: distance(new float[size]),
+					step(new float[size]),
+					distThresh(new float[size]),
+					scan(new double[size]),
+					iters(new int[size])
+		{
+		}
+		~sStepBuffer()
+		{
+			delete[] distance;
+			delete[] step;
+			delete[] distThresh;
+			delete[] scan;
+			delete[] iters;
+		}
+		CVector3 Point(int i) const { return start + direction * scan[i]; }
+
+		float *distance;
+		float *step;
+		float *distThresh;
+		double *scan;
+		int *iters;
+		CVector3 start;
+		CVector3 direction;
 	};
 
 	struct sRayBuffer
 	{
-		sStep *stepBuff;
+		sStepBuffer *stepBuff;
 		int buffCount;
 	};
 
-	// ambient occlusion data
-	struct sVectorsAround
-	{
-		double alpha;
-		double beta;
-		CVector3 v;
-		int R;
-		int G;
-		int B;
-	};
-
 	struct sRayMarchingIn
 	{
 		CVector3 start;
@@ -106,29 +183,83 @@ private:
 		double maxScan;
 		bool binaryEnable;
 		bool invertMode;
+		bool gatherFractalData; // colour and orbit trap are needed by shaders at the hit point
 	};
 
 	struct sRayMarchingInOut
 	{
-		sStep *stepBuff;
+		sStepBuffer *stepBuff; // NULL if steps are only counted
 		int *buffCount;
 	};
 
+	// work done for the pixel (also by shadow, AO and reflection rays)
+	struct sPixelCost
+	{
+		sPixelCost() : evaluations(0), iterations(0), steps(0) {}
+		void Count(int totalIters, bool marchStep)
+		{
+			evaluations++;
+			iterations += totalIters;
+			if (marchStep) steps++;
+		}
+		void Add(const sPixelCost &other)
+		{
+			evaluations += other.evaluations;
+			iterations += other.iterations;
+			steps += other.steps;
+		}
+		int evaluations;
+		long long iterations;
+		int steps;
+	};
+
 	struct sRayMarchingOut
 	{
 		double lastDist;
 		double depth;
 		double distThresh;
+		double colorIndex; // fractal colour and orbit trap at the hit point
+		double orbitTrapR;
 		int objectId;
 		bool found;
+		bool fractalDataValid; // colorIndex and orbitTrapR were calculated
+		sPixelCost cost;
 	};
 
 	struct sRayRecursionIn
 	{
+		sRayRecursionIn() : calcInside(false), rayMarchingDone(false), normalDone(false) {}
 		sRayMarchingIn rayMarchingIn;
 		bool calcInside;
 		sRGBAfloat resultShader;
 		sRGBAfloat objectColour;
+		// results of ray-marching if it was already done for the packet of primary rays
+		bool rayMarchingDone;
+		CVector3 rayMarchingPoint;
+		sRayMarchingOut rayMarchingOut;
+		// normal vector taken from G-buffer (with normal map already applied)
+		bool normalDone;
+		CVector3 normal;
+	};
+
+	// state of single ray during ray-marching
+	struct sRayMarchingState
+	{
+		CVector3 point;
+		CVector3 lastPoint;
+		double scan;
+		double maxScan;
+		double dist;
+		double step;
+		double distThresh;
+		double previousDist;		 // distance at previous point (for over-relaxation)
+		double conservativeStep; // not relaxed length of last step
+		int counter;
+		int stepIndex;
+		bool found;
+		bool deadComputationFound;
+		bool active;
+		bool relaxedStep; // last step was over-relaxed
 	};
 
 	struct sRayRecursionOut
@@ -158,30 +289,227 @@ private:
 		double lastDist;
 		double delta; // initial step distance for shaders based on distance form camera
 		double depth;
-		sStep *stepBuff;
+		const sStepBuffer *stepBuff;
 		int stepCount;
 		int objectId;
 		bool invertMode;
+		bool primaryRay; // first hit of ray from the camera
 		cMaterial *material;
 		sRGBfloat texDiffuse;
 		sRGBfloat texColor;
 		sRGBfloat texLuminosity;
+		double colorIndex; // gathered by ray-marching if fractalDataValid
+		double orbitTrapR;
+		bool fractalDataValid;
+	};
+
+	// texture mapping of shaded point, calculated once for all textures of the material
+	struct sTextureFootprint
+	{
+		sTextureFootprint() : deltaX(0.0), deltaY(0.0), pixelSize(1.0) {}
+		CVector2<double> point;
+		CVector3 vectorX; // directions of texture axes
+		CVector3 vectorY;
+		double deltaX; // distances in texture between neighbouring pixels along texture axes
+		double deltaY;
+		double pixelSize; // size of texture in pixels of the image (mipmap selection)
+	};
+
+	// shadow ray in wavefront queue of the tile
+	struct sWavefrontShadowRay
+	{
+		CVector3 point;
+		double distThresh;
+		double delta;
+		quint64 key; // Morton code of the origin
+		int pixel;	 // index of pixel in the tile queue
+		bool operator<(const sWavefrontShadowRay &other) const { return key < other.key; }
+	};
+
+	// pixels of tile rendered in wavefront mode. Primary rays of all pixels are marched first, then
+	// shadow rays of all hits are traced in sorted batches and finally the pixels are shaded
+	struct sWavefront
+	{
+		QVector<int> xs;
+		QVector<int> ys;
+		QVector<sRayMarchingIn> in;
+		QVector<sRayMarchingInOut> inOut;
+		QVector<sRayMarchingOut> out;
+		QVector<CVector3> points;
+		QVector<int> stepCounts;
+		QVector<sRGBAfloat> shadows;
+		QVector<sPixelCost> costs; // work done by shadow rays
+		QVector<sWavefrontShadowRay> shadowQueue;
+	};
+
+	enum enumRayRecursionStage
+	{
+		rayStageRefraction,
+		rayStageReflection,
+		rayStageShading
+	};
+
+	// surface point refined by RayMarchingFinish()
+	struct sRefinedHit
+	{
+		CVector3 point;
+		double scan;
+		double dist;
+		double distThresh;
+		int counter;
+	};
+
+	// state of one level of ray recursion kept on per-thread stack
+	struct sRayRecursionNode
+	{
+		sRayRecursionIn in;
+		sRayMarchingInOut rayMarchingInOut;
+		sRayMarchingOut rayMarchingOut;
+		sShaderInputData shaderInputData;
+		CVector3 point;
+		CVector3 vn;
+		sRGBAfloat resultShader;
+		sRGBAfloat objectColour;
+		sRGBAfloat reflectShader;
+		sRGBAfloat transparentShader;
+		sRGBfloat transparentColor;
+		sRGBAfloat *result; // result of refraction or reflection of parent level
+		double reflect;
+		double transparent;
+		double n1;
+		double n2;
+		int rayIndex;
+		enumRayRecursionStage stage;
+		bool traceRefraction;
+		bool traceReflection;
 	};
 
+	// features of shaders which can be compiled out of specialized variants
+	enum enumShaderFeature
+	{
+		shaderFeatureMainLight = 1,
+		shaderFeatureShadow = 2,
+		shaderFeatureAO = 4,
+		shaderFeatureEnvMapping = 8,
+		shaderFeatureAuxLights = 16,
+		shaderFeatureFakeLights = 32,
+		shaderFeatureVolumetric = 64,
+		shaderFeatureAll = 127
+	};
+
+	typedef sRGBAfloat (cRenderWorker::*fnObjectShader)(
+		const sShaderInputData &input, sRGBAfloat *surfaceColour, sRGBAfloat *specularOut);
+	typedef sRGBAfloat (cRenderWorker::*fnVolumetricShader)(
+		const sShaderInputData &input, sRGBAfloat oldPixel, sRGBAfloat *opacityOut);
+
+	struct sShaderVariant
+	{
+		int features;
+		const char *name;
+		fnObjectShader objectShader;
+		fnVolumetricShader volumetricShader;
+	};
+
+	// precompiled shader variants. Variants with less features have to be first
+	static const sShaderVariant shaderVariants[];
+	static const int numberOfShaderVariants;
+
 	// functions
+	void PrepareJob(void);
 	void PrepareMainVectors(void);
 	void PrepareReflectionBuffer(void);
+	void FreeReflectionBuffer(void);
 	void PrepareAOVectors(void);
+	void RenderPass(void);
+	void RenderTiles(
+		cTileScheduler *scheduler, double aspectRatio, bool monteCarloDOF, bool usePackets);
+	void RenderPixel(int xs, int ys, int progressiveStep, double aspectRatio, bool monteCarloDOF);
+	void RenderPixel(int xs, int ys, int progressiveStep, double aspectRatio, bool monteCarloDOF,
+		CVector2<double> subPixel, sRGBfloat *sampleOut);
+	// shading of pixel using geometry stored in G-buffer. Only secondary rays are traced
+	void RelightPixel(int xs, int ys, int progressiveStep, double aspectRatio);
+	void RenderAntiAliasing(double aspectRatio);
+	void RenderAOPrepass(double aspectRatio);
+	void RenderPixelPacket(const int *xs, int count, int ys, int progressiveStep, double aspectRatio);
+	bool PreparePrimaryRay(
+		int xs, int ys, int progressiveStep, double aspectRatio, sRayMarchingIn *in, double *freeStart);
+	void ShadePrimaryRay(int xs, int ys, int progressiveStep, const sRayMarchingIn &in,
+		const sRayMarchingInOut &inOut, const sRayMarchingOut &out, const CVector3 &point);
+	void RenderWavefrontTile(int progressiveStep, double aspectRatio);
+	void TraceShadowQueue(const sWavefrontShadowRay *rays, int count);
+	// packet with rays of both eyes for each pixel of single-pass stereo
+	void RenderStereoPacket(
+		const int *xs, int count, int ys, int progressiveStep, double aspectRatio);
+	void StereoEyeRay(cStereo::enumEye eye, CVector3 *startRay, CVector3 *viewVector) const;
+	// pixel of the other eye rendered together with given pixel in single-pass stereo
+	CVector2<int> StereoPairPixel(int xs, int ys) const;
+	bool IsSecondStereoEyePixel(int xs, int ys) const;
+	bool RenderedInPreviousPass(int xs, int ys, int progressiveStep) const;
+	void RenderDepthPrepass(double aspectRatio);
+	double ConeMarchingDepth(CVector3 start, CVector3 direction, double coneFactor);
+	double ConeFactor(int xs, int ys, int blockSize, double aspectRatio, CVector3 direction) const;
+	double ProgressiveStartDistance(int xs, int ys, int progressiveStep) const;
+	void StoreProgressiveDepth(int xs, int ys, int progressiveStep, double aspectRatio,
+		const sRayMarchingIn &in, double freeStart, const sRayBuffer &buffer);
+	void StorePixel(int xs, int ys, int progressiveStep, const sRGBfloat &pixel, const sRGB8 &colour,
+		unsigned short alpha, double depth, unsigned short opacity16, const sRGBfloat &normal,
+		const sRGBfloat &worldPosition, float objectId, const sPixelCost &cost);
+	void StoreAOVs(
+		const sRayRecursionOut &recursionOut, sRGBfloat *worldPosition, float *objectId) const;
+	void StoreGBuffer(int xs, int ys, const sRayRecursionOut &recursionOut);
 	CVector3 RayMarching(sRayMarchingIn &in, sRayMarchingInOut *inOut, sRayMarchingOut *out);
+	void RayMarchingPacket(sRayMarchingIn *in, sRayMarchingInOut *inOut, sRayMarchingOut *out,
+		CVector3 *result, int count);
+	void RayMarchingInit(const sRayMarchingIn &in, sRayMarchingInOut *inOut, sRayMarchingOut *out,
+		sRayMarchingState *state) const;
+	bool RayMarchingNextPoint(const sRayMarchingIn &in, sRayMarchingState *state) const;
+	bool RayMarchingStep(const sRayMarchingIn &in, sRayMarchingInOut *inOut, sRayMarchingOut *out,
+		sRayMarchingState *state, double dist, const sDistanceOut &distanceOut);
+	CVector3 RayMarchingFinish(
+		const sRayMarchingIn &in, sRayMarchingOut *out, sRayMarchingState *state);
+	double RefinementDistance(
+		const sRayMarchingIn &in, const CVector3 &point, double distThresh, sRayMarchingOut *out);
+	void RefineHitBisection(
+		const sRayMarchingIn &in, sRayMarchingOut *out, double step, sRefinedHit *hit);
+	void RefineHitSecant(
+		const sRayMarchingIn &in, sRayMarchingOut *out, double step, sRefinedHit *hit);
+	bool ClipRayToLimitBox(const sRayMarchingIn &in, double *minScan, double *maxScan) const;
+	// end of shadow ray clipped to the limit box (there is nothing outside of it)
+	double ShadowRayEnd(const CVector3 &point, const CVector3 &direction, double start,
+		double end) const;
+	// distance interpolated by distance cache. Returns false if it has to be calculated
+	bool CachedDistance(const sRayMarchingIn &in, const sRayMarchingState &state, double *dist,
+		sDistanceOut *distanceOut) const;
 	double CalcDistThresh(CVector3 point) const;
 	double CalcDelta(CVector3 point) const;
+	// adds work of distance estimation to statistics of this thread
+	inline void CountDistance(const sDistanceOut &distanceOut) const
+	{
+		threadData->statistics.totalNumberOfIterations += distanceOut.totalIters;
+		threadData->statistics.numberOfPeriodicOrbits += distanceOut.periodicOrbits;
+		if (distanceOut.primitiveEvaluations >= 0)
+		{
+			threadData->statistics.totalNumberOfPrimitiveQueries++;
+			threadData->statistics.totalNumberOfPrimitiveEvaluations += distanceOut.primitiveEvaluations;
+		}
+	}
 	double IterOpacity(double step, double iters, double maxN, double trim, double opacitySp);
-	sRayRecursionOut RayRecursion(sRayRecursionIn in, sRayRecursionInOut &inOut);
-	void MonteCarloDOF(CVector2<double> imagePoint, CVector3 *startRay, CVector3 *viewVector);
+	int VolumetricDensities(const sShaderInputData &input);
+	sRayRecursionOut RayRecursion(const sRayRecursionIn &in, sRayRecursionInOut &inOut);
+	void RayRecursionBegin(sRayRecursionNode *node);
+	void RayRecursionFinish(sRayRecursionNode *node, sRayRecursionOut *out);
+	void PrepareRefractedRay(sRayRecursionNode &parent, sRayRecursionNode *child);
+	void PrepareReflectedRay(sRayRecursionNode &parent, sRayRecursionNode *child);
+	sRayMarchingInOut RayMarchingBuffers(int rayIndex, bool record);
+	void MonteCarloDOF(
+		CVector2<double> imagePoint, int sampleIndex, CVector3 *startRay, CVector3 *viewVector);
 
 	// shaders
 	sRGBAfloat ObjectShader(
 		const sShaderInputData &input, sRGBAfloat *surfaceColour, sRGBAfloat *specularOut);
+	template <int Features>
+	sRGBAfloat ObjectShaderVariant(
+		const sShaderInputData &input, sRGBAfloat *surfaceColour, sRGBAfloat *specularOut);
 	CVector3 CalculateNormals(const sShaderInputData &input);
 	sRGBAfloat MainShading(const sShaderInputData &input);
 	sRGBAfloat MainShadow(const sShaderInputData &input);
@@ -190,18 +518,28 @@ private:
 	sRGBAfloat FastAmbientOcclusion(const sShaderInputData &input);
 	sRGBAfloat AmbientOcclusion(const sShaderInputData &input);
 	sRGBAfloat EnvMapping(const sShaderInputData &input);
+	static sRGBfloat EnvMapColour(const sRenderData *data, const CVector3 &reflect);
 	sRGBAfloat AuxLightsShader(const sShaderInputData &input, sRGBAfloat *specularOut);
 	double AuxShadow(const sShaderInputData &input, double distance, CVector3 lightVector);
 	sRGBAfloat LightShading(
 		const sShaderInputData &input, const sLight *light, int number, sRGBAfloat *outSpecular);
 	sRGBAfloat BackgroundShader(const sShaderInputData &input);
+	// background without main light. Flat mapping is not supported (depends on camera)
+	static sRGBAfloat BackgroundColour(
+		const cParamRender *params, const sRenderData *data, const CVector3 &viewVector);
 	sRGBAfloat FakeLights(const sShaderInputData &input, sRGBAfloat *fakeSpec);
 	sRGBAfloat VolumetricShader(
 		const sShaderInputData &input, sRGBAfloat oldPixel, sRGBAfloat *opacityOut);
+	template <int Features>
+	sRGBAfloat VolumetricShaderVariant(
+		const sShaderInputData &input, sRGBAfloat oldPixel, sRGBAfloat *opacityOut);
 
-	sRGBfloat TextureShader(
-		const sShaderInputData &input, texture::enumTextureSelection texSelect, cMaterial *mat) const;
-	CVector3 NormalMapShader(const sShaderInputData &input);
+	sTextureFootprint TextureFootprint(const sShaderInputData &input) const;
+	sRGBfloat TextureShader(const sShaderInputData &input, const sTextureFootprint &footprint,
+		texture::enumTextureSelection texSelect) const;
+	// colour, luminosity and diffusion textures of the material fetched with the same mapping
+	void MaterialTexturesShader(sShaderInputData *input, const sTextureFootprint &footprint) const;
+	CVector3 NormalMapShader(const sShaderInputData &input, const sTextureFootprint &footprint);
 
 	// data got from main thread
 	const cParamRender *params;
@@ -209,6 +547,7 @@ private:
 	sRenderData *data;
 	sThreadData *threadData;
 	cImage *image;
+	int pinnedCpu; // CPU which the thread of this worker is currently bound to
 
 	// internal variables
 	int maxraymarchingSteps;
@@ -221,11 +560,29 @@ private:
 	CVector3 shadowVector;
 	int AOvectorsCount;
 	int reflectionsMax;
+	int rayBufferSize;
 	bool stopRequest;
+	bool jobChanged;
+	bool limitBoxClipping;
+	bool recordSteps; // ray-marching steps are needed by volumetric effects or progressive depth
+	bool fusedFractalColouring; // colour and orbit trap are gathered at the end of ray-marching
+	bool wavefrontShadows; // main light shadows of tiles are traced from sorted queues
+	int DOFSampleBank; // Monte Carlo DOF samples saved by converged pixels
+	const sShaderVariant *shaderVariant; // chosen by PrepareJob()
+	CVector2<double> shadedPixel; // screen coordinates of currently rendered pixel
+	sPixelCost pixelCost; // work done for currently rendered pixel
+	cSampler sampler;
+	QVector<int> auxLightCandidates; // lights considered for stochastic selection
+	QVector<double> auxLightWeights; // cumulative contributions of candidates
+	QVector<float> volumetricDensity; // opacity of ray-marching steps for adaptive integration
+	sWavefront wavefront;
+	const sRGBAfloat *wavefrontShadow; // main light shadow of shaded pixel traced in wavefront mode
 
 	// allocated objects
 	cCameraTarget *cameraTarget;
 	sRayBuffer *rayBuffer;
+	sRayRecursionNode *rayStack; // levels of RayRecursion()
+	sRayBuffer *packetRayBuffer;
 	sVectorsAround *AOvectorsAround;
 
 public slots:
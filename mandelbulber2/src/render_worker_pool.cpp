@@ -0,0 +1,137 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderWorkerPool class - set of persistent rendering threads
+ */
+
+#include "render_worker_pool.hpp"
+
+#include <QThread>
+
+#include "numa_topology.hpp"
+
+#include "system.hpp"
+
+cRenderWorkerPool::cRenderWorkerPool() : QObject()
+{
+	numberOfThreads = 0;
+	threadData = NULL;
+	runningWorkers.store(0);
+}
+
+cRenderWorkerPool::~cRenderWorkerPool()
+{
+	DeleteThreads();
+}
+
+void cRenderWorkerPool::CreateThreads(int _numberOfThreads)
+{
+	DeleteThreads();
+
+	numberOfThreads = _numberOfThreads;
+	threadData = new cRenderWorker::sThreadData[numberOfThreads];
+
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		WriteLog(QString("Thread ") + QString::number(i) + " create", 3);
+		threadData[i].id = i + 1;
+		threadData[i].startLine = 0;
+		threadData[i].scheduler = NULL;
+		threadData[i].cpu = -1;
+		threadData[i].node = 0;
+
+		QThread *thread = new QThread;
+		cRenderWorker *worker = new cRenderWorker(NULL, NULL, &threadData[i], NULL, NULL);
+		worker->moveToThread(thread);
+		// finished() is emitted by worker thread, so counter has to be updated directly
+		QObject::connect(
+			worker, SIGNAL(finished()), this, SLOT(slotWorkerFinished()), Qt::DirectConnection);
+		thread->setObjectName("RenderWorker #" + QString::number(i));
+		thread->start();
+		threads.append(thread);
+		workers.append(worker);
+		WriteLog(QString("Thread ") + QString::number(i) + " started", 3);
+	}
+}
+
+void cRenderWorkerPool::DeleteThreads()
+{
+	for (int i = 0; i < threads.size(); i++)
+	{
+		threads[i]->quit();
+		threads[i]->wait();
+		delete workers[i];
+		delete threads[i];
+		WriteLog(QString("Thread ") + QString::number(i) + " finished", 3);
+	}
+	threads.clear();
+	workers.clear();
+
+	if (threadData) delete[] threadData;
+	threadData = NULL;
+	numberOfThreads = 0;
+}
+
+void cRenderWorkerPool::Prepare(int _numberOfThreads, const cParamRender *params,
+	const cNineFractals *fractal, sRenderData *data, cImage *image)
+{
+	WriteLog("cRenderWorkerPool::Prepare()", 2);
+
+	if (_numberOfThreads != numberOfThreads)
+	{
+		CreateThreads(_numberOfThreads);
+	}
+
+	const cNumaTopology *topology = cNumaTopology::Instance();
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		threads[i]->setPriority(GetQThreadPriority(systemData.threadsPriority));
+		// binding is applied by the worker thread itself at next doWork() call
+		threadData[i].cpu =
+			systemData.threadsAffinity ? topology->CpuOfThread(i, numberOfThreads) : -1;
+		threadData[i].node = topology->NodeOfThread(i, numberOfThreads);
+		workers[i]->UpdateJob(params, fractal, data, image);
+	}
+}
+
+void cRenderWorkerPool::StartAll()
+{
+	runningWorkers.store(numberOfThreads);
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		QMetaObject::invokeMethod(workers[i], "doWork", Qt::QueuedConnection);
+	}
+}
+
+void cRenderWorkerPool::slotWorkerFinished()
+{
+	runningWorkers.fetchAndAddOrdered(-1);
+}
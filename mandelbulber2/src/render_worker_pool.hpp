@@ -0,0 +1,80 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cRenderWorkerPool class - set of persistent rendering threads
+ *
+ * Threads and cRenderWorker objects are created once and then reused for all
+ * progressive passes and for all frames rendered by the same cRenderJob.
+ */
+
+#ifndef MANDELBULBER2_SRC_RENDER_WORKER_POOL_HPP_
+#define MANDELBULBER2_SRC_RENDER_WORKER_POOL_HPP_
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QList>
+
+#include "render_worker.hpp"
+
+// forward declarations
+class QThread;
+
+class cRenderWorkerPool : public QObject
+{
+	Q_OBJECT
+public:
+	cRenderWorkerPool();
+	~cRenderWorkerPool();
+
+	// (re)creates threads if number of threads has changed and assigns new job data to workers
+	void Prepare(int _numberOfThreads, const cParamRender *params, const cNineFractals *fractal,
+		sRenderData *data, cImage *image);
+	// starts doWork() of all workers (one pass)
+	void StartAll();
+	bool IsAnyRunning() const { return runningWorkers.load() > 0; }
+	int GetNumberOfThreads() const { return numberOfThreads; }
+	cRenderWorker::sThreadData *GetThreadData(int index) { return &threadData[index]; }
+
+private:
+	void CreateThreads(int _numberOfThreads);
+	void DeleteThreads();
+
+	int numberOfThreads;
+	QList<QThread *> threads;
+	QList<cRenderWorker *> workers;
+	cRenderWorker::sThreadData *threadData;
+	QAtomicInt runningWorkers;
+
+private slots:
+	void slotWorkerFinished();
+};
+
+#endif /* MANDELBULBER2_SRC_RENDER_WORKER_POOL_HPP_ */
@@ -65,6 +65,7 @@ RenderedImage::RenderedImage(QWidget *parent) : QWidget(parent)
 	flightRotationDirection = 0;
 	clickMode = clickDoNothing;
 	anaglyphMode = false;
+	regionSelecting = false;
 
 	QList<QVariant> mode;
 	mode.append((int)RenderedImage::clickDoNothing);
@@ -112,6 +113,11 @@ void RenderedImage::paintEvent(QPaintEvent *event)
 
 		image->RedrawInWidget();
 
+		if (gPar->Get<bool>("cost_overlay") && image->GetImageOptional()->optionalCost)
+			DisplayCostOverlay();
+
+		if (regionSelecting) DisplayRegionSelection();
+
 		if (cursorVisible && isFocus && !anaglyphMode
 				&& (isOnObject || (enumClickMode)clickModeData.at(0).toInt() == clickFlightSpeedControl))
 		{
@@ -467,6 +473,13 @@ void RenderedImage::Draw3DBox(
 	}
 }
 
+CVector2<double> RenderedImage::GetLastMousePositionScaled()
+{
+	if (!image || image->GetPreviewScale() <= 0.0) return CVector2<double>(0.0, 0.0);
+	return CVector2<double>(lastMousePosition.x / image->GetPreviewScale(),
+		lastMousePosition.y / image->GetPreviewScale());
+}
+
 void RenderedImage::mouseMoveEvent(QMouseEvent *event)
 {
 	CVector2<int> screenPoint(event->x(), event->y());
@@ -481,7 +494,7 @@ void RenderedImage::mouseMoveEvent(QMouseEvent *event)
 
 	if (params)
 	{
-		if (cursorVisible && isFocus && redrawed)
+		if ((cursorVisible && isFocus && redrawed) || regionSelecting)
 		{
 			update();
 		}
@@ -508,6 +521,14 @@ void RenderedImage::mousePressEvent(QMouseEvent *event)
 			emit SpeedChanged(0.9);
 		}
 	}
+	else if ((enumClickMode)clickModeData.at(0).toInt() == clickRenderRegion)
+	{
+		if (event->button() == Qt::LeftButton)
+		{
+			regionSelecting = true;
+			regionStart = CVector2<int>(event->x(), event->y());
+		}
+	}
 	else
 	{
 		emit singleClick(event->x(), event->y(), event->button());
@@ -516,7 +537,13 @@ void RenderedImage::mousePressEvent(QMouseEvent *event)
 
 void RenderedImage::mouseReleaseEvent(QMouseEvent *event)
 {
-	(void)event;
+	if (regionSelecting && event->button() == Qt::LeftButton)
+	{
+		regionSelecting = false;
+		QRect rect = QRect(QPoint(regionStart.x, regionStart.y), event->pos()).normalized();
+		update();
+		if (rect.width() > 1 && rect.height() > 1) emit renderRegionSelected(rect);
+	}
 }
 
 void RenderedImage::enterEvent(QEvent *event)
@@ -670,6 +697,28 @@ void RenderedImage::wheelEvent(QWheelEvent *event)
 	}
 }
 
+void RenderedImage::DisplayCostOverlay()
+{
+	unsigned char *heatmap = image->ConvertCostTo8Bit();
+	if (!heatmap) return;
+
+	QPainter painter(this);
+	painter.setRenderHints(QPainter::SmoothPixmapTransform);
+	painter.setOpacity(0.6);
+
+	QImage qimage((const uchar *)heatmap, image->GetWidth(), image->GetHeight(),
+		image->GetWidth() * sizeof(sRGB8), QImage::Format_RGB888);
+	painter.drawImage(QRect(0, 0, image->GetPreviewWidth(), image->GetPreviewHeight()), qimage);
+}
+
+void RenderedImage::DisplayRegionSelection()
+{
+	QPainter painter(this);
+	painter.setPen(QPen(Qt::white, 1, Qt::DashLine));
+	painter.drawRect(QRect(QPoint(regionStart.x, regionStart.y),
+		QPoint(lastMousePosition.x, lastMousePosition.y)).normalized());
+}
+
 void RenderedImage::DisplayCrosshair()
 {
 	// calculate crosshair center point according to sweet point
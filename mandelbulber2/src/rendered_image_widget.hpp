@@ -62,7 +62,8 @@ public:
 		clickPlacePrimitive = 6,
 		clickFlightSpeedControl = 7,
 		clickPlaceRandomLightCenter = 8,
-		clickGetPoint = 9
+		clickGetPoint = 9,
+		clickRenderRegion = 10
 	};
 
 	struct sFlightData
@@ -89,6 +90,7 @@ public:
 	void SetFrontDist(double dist) { frontDist = dist; }
 	void SetCursorVisibility(bool enable) { cursorVisible = enable; }
 	void SetFlightData(const sFlightData &fData) { flightData = fData; }
+	// last mouse position in image coordinates
 	CVector2<double> GetLastMousePositionScaled(void);
 
 public slots:
@@ -118,6 +120,8 @@ private:
 	void DisplayCoordinates();
 	void Display3DCursor(CVector2<int> screenPoint, double z);
 	void DisplayCrosshair();
+	void DisplayCostOverlay();
+	void DisplayRegionSelection();
 	void DrawHud(CVector3 rotation);
 	void Draw3DBox(double scale, double fov, CVector2<double> point, double z, cStereo::enumEye eye);
 	CVector3 CalcPointPersp(const CVector3 &point, const CRotationMatrix &rot, double persp);
@@ -140,10 +144,14 @@ private:
 	double flightRotationDirection;
 	QTimer *timerRefreshImage;
 	bool anaglyphMode;
+	bool regionSelecting;
+	CVector2<int> regionStart;
 
 signals:
 	void mouseMoved(int x, int y);
 	void singleClick(int x, int y, Qt::MouseButton button);
+	// rectangle selected with clickRenderRegion mode (in preview coordinates)
+	void renderRegionSelected(const QRect &rect);
 	void keyPress(Qt::Key key);
 	void keyRelease(Qt::Key key);
 	void mouseWheelRotated(int delta);
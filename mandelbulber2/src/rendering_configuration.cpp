@@ -46,6 +46,20 @@ cRenderingConfiguration::cRenderingConfiguration()
 	enableIgnoreErrors = false;
 	refreshRate = 1000;
 	maxRenderTime = 1e50;
+	threadsLimit = 0;
+	checkpointInterval = 0;
+	resume = false;
+	focusX = -1;
+	focusY = -1;
+}
+
+void cRenderingConfiguration::SetCheckpoint(
+	const QString &_file, const QByteArray &_settingsHash, int _interval, bool _resume)
+{
+	checkpointFile = _file;
+	checkpointSettingsHash = _settingsHash;
+	checkpointInterval = _interval;
+	resume = _resume;
 }
 
 bool cRenderingConfiguration::UseNetRender() const
@@ -65,7 +79,9 @@ bool cRenderingConfiguration::UseProgressive() const
 
 int cRenderingConfiguration::GetNumberOfThreads() const
 {
-	if (enableMultiThread)
+	if (enableMultiThread && threadsLimit > 0)
+		return qMin(threadsLimit, systemData.numberOfThreads);
+	else if (enableMultiThread)
 		return systemData.numberOfThreads;
 	else
 		return 1;
@@ -93,3 +109,11 @@ bool cRenderingConfiguration::UseIgnoreErrors() const
 {
 	return enableIgnoreErrors;
 }
+
+bool cRenderingConfiguration::GetFocusPoint(int *x, int *y) const
+{
+	if (focusX < 0 || focusY < 0) return false;
+	*x = focusX;
+	*y = focusY;
+	return true;
+}
@@ -35,6 +35,9 @@
 #ifndef MANDELBULBER2_SRC_RENDERING_CONFIGURATION_HPP_
 #define MANDELBULBER2_SRC_RENDERING_CONFIGURATION_HPP_
 
+#include <QByteArray>
+#include <QString>
+
 class cRenderingConfiguration
 {
 public:
@@ -47,6 +50,18 @@ public:
 	void DisableMultiThread() { enableMultiThread = false; }
 	void EnableIgnoreErros() { enableIgnoreErrors = true; }
 	void SetMaxRenderTime(double _maxRenderTime) { maxRenderTime = _maxRenderTime; }
+	// 0 means that all threads are used
+	void SetThreadsLimit(int _threadsLimit) { threadsLimit = _threadsLimit; }
+	// finished lines are saved to the file every interval seconds. If resume is enabled, lines
+	// saved by interrupted render with the same settings are not rendered again
+	void SetCheckpoint(
+		const QString &_file, const QByteArray &_settingsHash, int _interval, bool _resume);
+	// point of the image which is refined first (e.g. under the mouse cursor)
+	void SetFocusPoint(int x, int y)
+	{
+		focusX = x;
+		focusY = y;
+	}
 
 	bool UseNetRender() const;
 	bool UseImageRefresh() const;
@@ -57,6 +72,12 @@ public:
 	int GetNumberOfThreads() const;
 	double GetMaxRenderTime() const { return maxRenderTime; }
 	int GetRefreshRate() const;
+	const QString &GetCheckpointFile() const { return checkpointFile; }
+	const QByteArray &GetCheckpointSettingsHash() const { return checkpointSettingsHash; }
+	int GetCheckpointInterval() const { return checkpointInterval; }
+	bool UseResume() const { return resume; }
+	// returns false if focus point is not set
+	bool GetFocusPoint(int *x, int *y) const;
 
 private:
 	bool enableImageRefresh;
@@ -66,6 +87,13 @@ private:
 	bool enableIgnoreErrors;
 	double maxRenderTime;
 	int refreshRate;
+	int threadsLimit;
+	QString checkpointFile;
+	QByteArray checkpointSettingsHash;
+	int checkpointInterval;
+	bool resume;
+	int focusX;
+	int focusY;
 };
 
 #endif /* MANDELBULBER2_SRC_RENDERING_CONFIGURATION_HPP_ */
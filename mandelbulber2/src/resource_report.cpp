@@ -0,0 +1,288 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cResourceReport - resource use of render jobs for cost accounting
+ */
+
+#include "resource_report.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+#include "initparameters.hpp"
+#include "netrender.hpp"
+#include "statistics.h"
+#include "system.hpp"
+
+QAtomicInteger<qint64> cResourceReport::bytesReadCounter(0);
+QAtomicInteger<qint64> cResourceReport::bytesWrittenCounter(0);
+
+cResourceReport::cResourceReport()
+{
+	numberOfJobs = 0;
+	numberOfImages = 0;
+	wallTime = 0.0;
+	cpuTime = 0.0;
+	prepassTime = 0.0;
+	mainPassTime = 0.0;
+	antiAliasingTime = 0.0;
+	postProcessingTime = 0.0;
+	ssaoTime = 0.0;
+	dofTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		stageTimes[i] = 0.0;
+	estimatedMemory = -1;
+	peakMemory = -1;
+	bytesRead = 0;
+	bytesWritten = 0;
+	startCpuTime = 0.0;
+	startBytesRead = 0;
+	startBytesWritten = 0;
+}
+
+bool cResourceReport::IsEnabled()
+{
+	return systemData.resourceReports || (gPar && gPar->Get<bool>("resource_reports"));
+}
+
+QString cResourceReport::FileNameForImage(const QString &imageFileName)
+{
+	QFileInfo fi(imageFileName);
+	return fi.path() + QDir::separator() + fi.completeBaseName() + ".report.json";
+}
+
+void cResourceReport::Start(const QString &_jobName)
+{
+	jobName = _jobName;
+	ResetPeakMemory();
+	timer.start();
+	startCpuTime = GetProcessCpuTime();
+	startBytesRead = bytesReadCounter.load();
+	startBytesWritten = bytesWrittenCounter.load();
+	startTraffic = NetRenderTraffic();
+}
+
+void cResourceReport::Finish()
+{
+	wallTime = timer.elapsed() / 1000.0;
+	double endCpuTime = GetProcessCpuTime();
+	cpuTime = (endCpuTime >= 0.0 && startCpuTime >= 0.0) ? endCpuTime - startCpuTime : -1.0;
+	// peak of concurrently rendered jobs could be reset by start of other job
+	peakMemory = qMax(peakMemory, GetPeakMemory());
+	bytesRead = bytesReadCounter.load() - startBytesRead;
+	bytesWritten = bytesWrittenCounter.load() - startBytesWritten;
+
+	netRenderTraffic.clear();
+	QMap<QString, sTraffic> traffic = NetRenderTraffic();
+	for (QMap<QString, sTraffic>::const_iterator it = traffic.constBegin(); it != traffic.constEnd();
+			 ++it)
+	{
+		// clients connected during the job are counted from zero
+		sTraffic start = startTraffic.value(it.key());
+		sTraffic jobTraffic;
+		jobTraffic.sent = it.value().sent - start.sent;
+		jobTraffic.received = it.value().received - start.received;
+		if (jobTraffic.sent > 0 || jobTraffic.received > 0)
+			netRenderTraffic.insert(it.key(), jobTraffic);
+	}
+	if (numberOfJobs == 0) numberOfJobs = 1;
+}
+
+void cResourceReport::AddStatistics(const cStatistics &stat)
+{
+	numberOfImages++;
+	prepassTime += stat.prepassTime;
+	mainPassTime += stat.mainPassTime;
+	antiAliasingTime += stat.antiAliasingTime;
+	postProcessingTime += stat.postProcessingTime;
+	ssaoTime += stat.ssaoTime;
+	dofTime += stat.dofTime;
+	for (int i = 0; i < renderStageCount; i++)
+		stageTimes[i] += stat.stageTimes[i];
+}
+
+void cResourceReport::Add(const cResourceReport &other)
+{
+	numberOfJobs += other.numberOfJobs;
+	numberOfImages += other.numberOfImages;
+	prepassTime += other.prepassTime;
+	mainPassTime += other.mainPassTime;
+	antiAliasingTime += other.antiAliasingTime;
+	postProcessingTime += other.postProcessingTime;
+	ssaoTime += other.ssaoTime;
+	dofTime += other.dofTime;
+	for (int i = 0; i < renderStageCount; i++)
+		stageTimes[i] += other.stageTimes[i];
+	// the biggest job decides about memory needed by the queue
+	estimatedMemory = qMax(estimatedMemory, other.estimatedMemory);
+	peakMemory = qMax(peakMemory, other.peakMemory);
+}
+
+QJsonObject cResourceReport::ToJson() const
+{
+	QJsonObject report;
+	report["job"] = jobName;
+	report["jobs"] = numberOfJobs;
+	report["images"] = numberOfImages;
+	report["wallTime"] = wallTime;
+	report["cpuTime"] = cpuTime;
+
+	QJsonObject passes;
+	passes["prepass"] = prepassTime;
+	passes["mainPass"] = mainPassTime;
+	passes["antiAliasing"] = antiAliasingTime;
+	passes["postProcessing"] = postProcessingTime;
+	passes["ssao"] = ssaoTime;
+	passes["dof"] = dofTime;
+	report["passes"] = passes;
+
+	// summed for all rendering threads
+	QJsonObject stages;
+	for (int i = 0; i < renderStageCount; i++)
+		stages[cStageTimer::StageName(i)] = stageTimes[i];
+	report["stages"] = stages;
+
+	QJsonObject memory;
+	memory["estimated"] = double(estimatedMemory);
+	memory["peak"] = double(peakMemory);
+	report["memory"] = memory;
+
+	QJsonObject files;
+	files["bytesRead"] = double(bytesRead);
+	files["bytesWritten"] = double(bytesWritten);
+	report["files"] = files;
+
+	QJsonObject netRender;
+	for (QMap<QString, sTraffic>::const_iterator it = netRenderTraffic.constBegin();
+			 it != netRenderTraffic.constEnd(); ++it)
+	{
+		QJsonObject client;
+		client["bytesSent"] = double(it.value().sent);
+		client["bytesReceived"] = double(it.value().received);
+		netRender[it.key()] = client;
+	}
+	report["netRender"] = netRender;
+
+	return report;
+}
+
+bool cResourceReport::Save(const QString &fileName) const
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		WriteLogString("Cannot write resource report", fileName, 1);
+		return false;
+	}
+	file.write(QJsonDocument(ToJson()).toJson(QJsonDocument::Indented));
+	file.close();
+	WriteLogString("Resource report written", fileName, 2);
+	return true;
+}
+
+double cResourceReport::GetProcessCpuTime()
+{
+#ifdef WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return -1.0;
+	quint64 kernel = (quint64(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	quint64 user = (quint64(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+	// units of 100 ns
+	return (kernel + user) * 1e-7;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return -1.0;
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec
+				 + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+qint64 cResourceReport::GetPeakMemory()
+{
+#ifdef WIN32
+	// peak working set needs psapi library which is not linked
+	return -1;
+#elif defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+	return qint64(usage.ru_maxrss); // in bytes on MacOS
+#else
+	QFile file("/proc/self/status");
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return -1;
+	QTextStream stream(&file);
+	QString line;
+	while (!(line = stream.readLine()).isNull())
+	{
+		if (line.startsWith("VmHWM:"))
+		{
+			QStringList fields = line.simplified().split(' ');
+			if (fields.size() >= 2) return fields[1].toLongLong() * 1024;
+		}
+	}
+	return -1;
+#endif
+}
+
+void cResourceReport::ResetPeakMemory()
+{
+#if !defined(WIN32) && !defined(__APPLE__)
+	// resets VmHWM (Linux 4.0 and newer), on other systems peak of the whole process is reported
+	QFile file("/proc/self/clear_refs");
+	if (file.open(QIODevice::WriteOnly)) file.write("5");
+#endif
+}
+
+QMap<QString, cResourceReport::sTraffic> cResourceReport::NetRenderTraffic()
+{
+	QMap<QString, sTraffic> traffic;
+	if (!gNetRender || !gNetRender->IsServer()) return traffic;
+
+	for (int i = 0; i < gNetRender->GetClientCount(); i++)
+	{
+		const CNetRender::sClient &client = gNetRender->GetClient(i);
+		QString address = client.socket ? client.socket->peerAddress().toString() : QString();
+		QString label = client.name.isEmpty() ? address : client.name + " (" + address + ")";
+		traffic[label].sent += client.bytesSent;
+		traffic[label].received += client.bytesReceived;
+	}
+	return traffic;
+}
@@ -0,0 +1,130 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cResourceReport - resource use of render jobs for cost accounting
+ *
+ * Report is started before rendering and finished when output files are written. It contains
+ * CPU time of the process, thread time of rendering stages summed from cStatistics of all
+ * rendered images, peak resident memory compared with estimation of cMemoryEstimator, bytes of
+ * textures read and images written, and traffic of every NetRender client. Reports of queue items
+ * are saved as JSON files next to output images and added together into report of queue run.
+ *
+ * CPU time, peak memory, file and network counters are measured for the whole process, so
+ * reports of queue items rendered concurrently include each other.
+ */
+
+#ifndef MANDELBULBER2_SRC_RESOURCE_REPORT_HPP_
+#define MANDELBULBER2_SRC_RESOURCE_REPORT_HPP_
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+
+#include "stage_timer.hpp"
+
+// forward declarations
+class cStatistics;
+
+class cResourceReport
+{
+public:
+	cResourceReport();
+
+	// reports are written when enabled with --resource-report or parameter 'resource_reports'
+	static bool IsEnabled();
+	// report file of job which saved given image
+	static QString FileNameForImage(const QString &imageFileName);
+
+	// takes snapshot of process counters. Peak memory is reset where it's supported
+	void Start(const QString &_jobName);
+	// process counters are calculated as difference from snapshot taken by Start()
+	void Finish();
+	// adds times of rendering passes and stages of one rendered image
+	void AddStatistics(const cStatistics &stat);
+	// adds times, number of images and jobs of other report (process counters are not added)
+	void Add(const cResourceReport &other);
+	void SetEstimatedMemory(qint64 bytes) { estimatedMemory = bytes; }
+
+	QJsonObject ToJson() const;
+	bool Save(const QString &fileName) const;
+
+	// counters of textures and images read and written by the whole process
+	static void AddBytesRead(qint64 bytes) { bytesReadCounter.fetchAndAddRelaxed(bytes); }
+	static void AddBytesWritten(qint64 bytes) { bytesWrittenCounter.fetchAndAddRelaxed(bytes); }
+	// user and system CPU time of the process [s] (-1 if unknown)
+	static double GetProcessCpuTime();
+	// peak resident memory of the process [bytes] (-1 if unknown)
+	static qint64 GetPeakMemory();
+	static void ResetPeakMemory();
+
+	struct sTraffic
+	{
+		sTraffic() : sent(0), received(0) {}
+		qint64 sent;
+		qint64 received;
+	};
+
+	QString jobName;
+	int numberOfJobs;
+	int numberOfImages;
+	double wallTime;
+	double cpuTime;
+	double prepassTime;
+	double mainPassTime;
+	double antiAliasingTime;
+	double postProcessingTime;
+	double ssaoTime;
+	double dofTime;
+	// thread time of rendering stages (summed for all threads)
+	double stageTimes[renderStageCount];
+	qint64 estimatedMemory;
+	qint64 peakMemory;
+	qint64 bytesRead;
+	qint64 bytesWritten;
+	// traffic of NetRender clients by name and address
+	QMap<QString, sTraffic> netRenderTraffic;
+
+private:
+	static QMap<QString, sTraffic> NetRenderTraffic();
+
+	QElapsedTimer timer;
+	double startCpuTime;
+	qint64 startBytesRead;
+	qint64 startBytesWritten;
+	QMap<QString, sTraffic> startTraffic;
+
+	static QAtomicInteger<qint64> bytesReadCounter;
+	static QAtomicInteger<qint64> bytesWrittenCounter;
+};
+
+#endif /* MANDELBULBER2_SRC_RESOURCE_REPORT_HPP_ */
@@ -0,0 +1,271 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSampler class - per-thread generator of sample sequences
+ */
+
+#include "sampler.hpp"
+
+#include <QVector>
+
+// size of blue-noise tile
+#define BLUE_NOISE_SIZE 64
+// sigma of gaussian filter used for void-and-cluster method
+#define BLUE_NOISE_SIGMA 1.5
+
+// blue-noise mask generated once with void-and-cluster method (Ulichney 1993)
+class cBlueNoiseTile
+{
+public:
+	cBlueNoiseTile();
+	float Get(int x, int y) const { return mask[y * BLUE_NOISE_SIZE + x]; }
+
+private:
+	void Toggle(int index, bool set);
+	int TightestCluster() const;
+	int LargestVoid() const;
+
+	QVector<float> mask;
+	QVector<double> energy;
+	QVector<double> kernel;
+	QVector<char> pattern;
+};
+
+cBlueNoiseTile::cBlueNoiseTile()
+{
+	const int size = BLUE_NOISE_SIZE;
+	const int count = size * size;
+	mask.fill(0.0f, count);
+	energy.fill(0.0, count);
+	pattern.fill(0, count);
+
+	// toroidal gaussian kernel
+	kernel.resize(count);
+	for (int y = 0; y < size; y++)
+	{
+		int dy = qMin(y, size - y);
+		for (int x = 0; x < size; x++)
+		{
+			int dx = qMin(x, size - x);
+			kernel[y * size + x] = exp(-(dx * dx + dy * dy) / (2.0 * BLUE_NOISE_SIGMA * BLUE_NOISE_SIGMA));
+		}
+	}
+
+	// initial random pattern (10% of points)
+	unsigned int random = 12345;
+	int ones = 0;
+	while (ones < count / 10)
+	{
+		random = random * 1103515245 + 12345;
+		int index = (random >> 8) % count;
+		if (!pattern[index])
+		{
+			Toggle(index, true);
+			ones++;
+		}
+	}
+
+	// moving points from clusters to voids until pattern is uniform
+	for (int i = 0; i < count; i++)
+	{
+		int cluster = TightestCluster();
+		Toggle(cluster, false);
+		int voidIndex = LargestVoid();
+		Toggle(voidIndex, true);
+		if (voidIndex == cluster) break;
+	}
+	QVector<char> initialPattern = pattern;
+	QVector<double> initialEnergy = energy;
+
+	// ranks of initial points
+	for (int rank = ones - 1; rank >= 0; rank--)
+	{
+		int cluster = TightestCluster();
+		Toggle(cluster, false);
+		mask[cluster] = rank;
+	}
+
+	// ranks of remaining points
+	pattern = initialPattern;
+	energy = initialEnergy;
+	for (int rank = ones; rank < count; rank++)
+	{
+		int voidIndex = LargestVoid();
+		Toggle(voidIndex, true);
+		mask[voidIndex] = rank;
+	}
+
+	for (int i = 0; i < count; i++)
+		mask[i] = (mask[i] + 0.5f) / count;
+}
+
+void cBlueNoiseTile::Toggle(int index, bool set)
+{
+	const int size = BLUE_NOISE_SIZE;
+	pattern[index] = set;
+	double sign = set ? 1.0 : -1.0;
+	int px = index % size;
+	int py = index / size;
+	for (int y = 0; y < size; y++)
+	{
+		const double *kernelLine = &kernel[((y - py + size) % size) * size];
+		double *energyLine = &energy[y * size];
+		for (int x = 0; x < size; x++)
+			energyLine[x] += sign * kernelLine[(x - px + size) % size];
+	}
+}
+
+int cBlueNoiseTile::TightestCluster() const
+{
+	int best = 0;
+	double bestEnergy = -1.0;
+	for (int i = 0; i < pattern.size(); i++)
+	{
+		if (pattern[i] && energy[i] > bestEnergy)
+		{
+			bestEnergy = energy[i];
+			best = i;
+		}
+	}
+	return best;
+}
+
+int cBlueNoiseTile::LargestVoid() const
+{
+	int best = 0;
+	double bestEnergy = 1e20;
+	for (int i = 0; i < pattern.size(); i++)
+	{
+		if (!pattern[i] && energy[i] < bestEnergy)
+		{
+			bestEnergy = energy[i];
+			best = i;
+		}
+	}
+	return best;
+}
+
+cSampler::cSampler()
+{
+	type = params::samplerRandom;
+	state = 2463534242u;
+	pixelX = 0;
+	pixelY = 0;
+}
+
+cSampler::~cSampler()
+{
+}
+
+void cSampler::Seed(unsigned int seed)
+{
+	state = seed * 2654435761u + 2463534242u;
+	if (state == 0) state = 2463534242u;
+}
+
+void cSampler::SetPixel(int x, int y)
+{
+	pixelX = x;
+	pixelY = y;
+}
+
+CVector2<double> cSampler::Get2D(int index, int dimension)
+{
+	if (type == params::samplerRandom) return CVector2<double>(Random(), Random());
+
+	static const unsigned int primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	const int numberOfPairs = sizeof(primes) / sizeof(primes[0]) / 2;
+
+	CVector2<double> point;
+	if (type == params::samplerSobol && dimension == 0)
+	{
+		point.x = RadicalInverse(index, 2);
+		point.y = Sobol2(index);
+	}
+	else
+	{
+		int pair = dimension % numberOfPairs;
+		point.x = RadicalInverse(index, primes[pair * 2]);
+		point.y = RadicalInverse(index, primes[pair * 2 + 1]);
+	}
+
+	// Cranley-Patterson rotation by blue-noise offsets of the pixel (different for each dimension)
+	int shift = dimension * 17;
+	point.x += BlueNoise(pixelX + shift, pixelY);
+	point.y += BlueNoise(pixelX, pixelY + shift + BLUE_NOISE_SIZE / 2);
+	if (point.x >= 1.0) point.x -= 1.0;
+	if (point.y >= 1.0) point.y -= 1.0;
+	return point;
+}
+
+double cSampler::RadicalInverse(unsigned int index, unsigned int base)
+{
+	if (base == 2)
+	{
+		// bit reversal (van der Corput sequence)
+		index = (index << 16) | (index >> 16);
+		index = ((index & 0x00ff00ffu) << 8) | ((index & 0xff00ff00u) >> 8);
+		index = ((index & 0x0f0f0f0fu) << 4) | ((index & 0xf0f0f0f0u) >> 4);
+		index = ((index & 0x33333333u) << 2) | ((index & 0xccccccccu) >> 2);
+		index = ((index & 0x55555555u) << 1) | ((index & 0xaaaaaaaau) >> 1);
+		return index * (1.0 / 4294967296.0);
+	}
+
+	double invBase = 1.0 / base;
+	double factor = invBase;
+	double result = 0.0;
+	while (index > 0)
+	{
+		result += (index % base) * factor;
+		index /= base;
+		factor *= invBase;
+	}
+	return result;
+}
+
+double cSampler::Sobol2(unsigned int index)
+{
+	// second dimension of Sobol sequence (primitive polynomial x + 1)
+	unsigned int result = 0;
+	for (unsigned int v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+	{
+		if (index & 1) result ^= v;
+	}
+	return result * (1.0 / 4294967296.0);
+}
+
+double cSampler::BlueNoise(int x, int y)
+{
+	static const cBlueNoiseTile tile;
+	x = ((x % BLUE_NOISE_SIZE) + BLUE_NOISE_SIZE) % BLUE_NOISE_SIZE;
+	y = ((y % BLUE_NOISE_SIZE) + BLUE_NOISE_SIZE) % BLUE_NOISE_SIZE;
+	return tile.Get(x, y);
+}
@@ -0,0 +1,95 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSampler class - per-thread generator of sample sequences
+ *
+ * Provides pseudo-random numbers without shared state (xorshift) and
+ * low-discrepancy Halton and Sobol sequences. Sequences of neighbouring
+ * pixels are decorrelated with offsets taken from tiled blue-noise mask,
+ * so remaining error is distributed as high frequency noise.
+ */
+
+#ifndef MANDELBULBER2_SRC_SAMPLER_HPP_
+#define MANDELBULBER2_SRC_SAMPLER_HPP_
+
+#include "algebra.hpp"
+
+namespace params
+{
+enum enumSamplerType
+{
+	samplerRandom = 0,
+	samplerHalton = 1,
+	samplerSobol = 2
+};
+}
+
+class cSampler
+{
+public:
+	cSampler();
+	~cSampler();
+
+	void SetType(params::enumSamplerType _type) { type = _type; }
+	params::enumSamplerType GetType() const { return type; }
+	void Seed(unsigned int seed);
+
+	// selects pixel for which next samples will be generated
+	void SetPixel(int x, int y);
+
+	// sample number 'index' from sequence of 2D points. Different dimensions give uncorrelated
+	// sequences (e.g. lens position and sub-pixel position)
+	CVector2<double> Get2D(int index, int dimension);
+
+	// uniform pseudo-random number in range [0, 1)
+	double Random()
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state * (1.0 / 4294967296.0);
+	}
+
+	// points of low discrepancy sequences in range [0, 1)
+	static double RadicalInverse(unsigned int index, unsigned int base);
+	static double Sobol2(unsigned int index);
+
+	// value of tiled blue-noise mask in range [0, 1)
+	static double BlueNoise(int x, int y);
+
+private:
+	params::enumSamplerType type;
+	unsigned int state;
+	int pixelX;
+	int pixelY;
+};
+
+#endif /* MANDELBULBER2_SRC_SAMPLER_HPP_ */
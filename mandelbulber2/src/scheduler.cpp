@@ -39,26 +39,44 @@
 #include "scheduler.hpp"
 #include <QtCore>
 
+#include "job_arena.hpp"
 #include "system.hpp"
-#define LINE_DONE_BY_SERVER 9999
 
-cScheduler::cScheduler(cRegion<int> screenRegion, int progressive)
+cScheduler::cScheduler(cRegion<int> screenRegion, int progressive, cJobArena *_arena)
 {
 	startLine = screenRegion.y1;
 	endLine = screenRegion.y2;
 	numberOfLines = screenRegion.height;
-	linePendingThreadId = new int[endLine];
-	lineDone = new bool[endLine];
-	lastLinesDone = new bool[endLine];
+	arena = _arena;
+	if (arena)
+	{
+		linePendingThreadId = arena->NewArray<int>(endLine);
+		lineDone = arena->NewArray<bool>(endLine);
+		lastLinesDone = arena->NewArray<bool>(endLine);
+	}
+	else
+	{
+		linePendingThreadId = new int[endLine];
+		lineDone = new bool[endLine];
+		lastLinesDone = new bool[endLine];
+	}
 	stopRequest = false;
 	progressiveStep = progressive;
 	progressivePass = 1;
 	progressiveEnabled = progressive > 1;
+	lineCost.fill(0.0, endLine);
+	lineStartTime.fill(0, endLine);
+	costKnown = false;
+	costMeasured = false;
+	costFloor = 0.0;
+	costTimer.start();
 	Reset();
 }
 
 cScheduler::~cScheduler()
 {
+	// memory of the arena is released by the render job
+	if (arena) return;
 	delete[] lineDone;
 	delete[] linePendingThreadId;
 	delete[] lastLinesDone;
@@ -129,14 +147,19 @@ int cScheduler::NextLine(int threadId, int actualLine, bool lastLineWasBroken)
 
 	int nextLine = -1;
 
+	qint64 time = costTimer.nsecsElapsed();
+
 	if (!lastLineWasBroken)
 	{
+		// line of progressive pass represents the whole block of lines
+		double cost = time - lineStartTime[actualLine];
 		for (int i = 0; i < progressiveStep; i++)
 		{
 			if (actualLine + i < endLine)
 			{
 				lineDone[actualLine + i] = true;
 				lastLinesDone[actualLine + i] = true;
+				lineCost[actualLine + i] = cost;
 			}
 		}
 	}
@@ -163,6 +186,7 @@ int cScheduler::NextLine(int threadId, int actualLine, bool lastLineWasBroken)
 	{
 		if (linePendingThreadId[nextLine] == 0)
 		{
+			lineStartTime[nextLine] = time;
 			for (int i = 0; i < progressiveStep; i++)
 			{
 				if (nextLine + i < endLine)
@@ -190,7 +214,8 @@ int cScheduler::FindBiggestGap() const
 	bool firstFreeFound = false;
 	int firstFree = -1;
 	int lastFree = -1;
-	int maxHole = 0;
+	double maxHole = 0.0;
+	double holeSize = 0.0;
 	int theBest = -1;
 
 	for (int i = startLine; i < endLine; i++)
@@ -199,6 +224,7 @@ int cScheduler::FindBiggestGap() const
 		{
 			firstFreeFound = true;
 			firstFree = i;
+			holeSize = LineWeight(i);
 			if (i == endLine - 1)
 			{
 				theBest = i;
@@ -209,17 +235,22 @@ int cScheduler::FindBiggestGap() const
 			continue;
 		}
 
+		if (firstFreeFound && linePendingThreadId[i] == 0) holeSize += LineWeight(i);
+
 		if (firstFreeFound && (linePendingThreadId[i] > 0 || i == endLine - 1))
 		{
 			lastFree = i;
-			int holeSize = lastFree - firstFree;
 			firstFreeFound = false;
 
+			// the hole is measured by estimated rendering time, so expensive regions are split finer
 			if (holeSize > maxHole)
 			{
 				maxHole = holeSize;
 				// next line should be in the middle of the biggest gap
-				theBest = (lastFree + firstFree) / 2;
+				if (costKnown)
+					theBest = CostQuantileLine(lineCost, 0.5, firstFree, lastFree);
+				else
+					theBest = (lastFree + firstFree) / 2;
 				theBest /= progressiveStep;
 				theBest *= progressiveStep;
 				// out << "Jump Id: " << threadId  << " first: " << firstFree << " last: " << lastFree <<
@@ -232,7 +263,10 @@ int cScheduler::FindBiggestGap() const
 
 void cScheduler::InitFirstLine(int threadId, int firstLine)
 {
+	mutex.lock();
 	linePendingThreadId[firstLine] = threadId;
+	lineStartTime[firstLine] = costTimer.nsecsElapsed();
+	mutex.unlock();
 }
 
 QList<int> cScheduler::GetLastRenderedLines(void)
@@ -281,7 +315,16 @@ bool cScheduler::ProgressiveNextStep()
 	progressiveStep /= 2;
 	progressivePass++;
 
-	if (progressiveStep == 0)
+	// measured lines of previous pass are the estimation for the next one
+	costMeasured = !stopRequest;
+	if (costMeasured)
+	{
+		costKnown = true;
+		UpdateCostFloor();
+	}
+
+	// after stop next passes wouldn't render anything
+	if (progressiveStep == 0 || stopRequest)
 	{
 		return false;
 	}
@@ -304,6 +347,11 @@ void cScheduler::MarkReceivedLines(const QList<int> &lineNumbers)
 	}
 }
 
+QList<int> cScheduler::GetCompletedLines() const
+{
+	return CreateDoneList();
+}
+
 QList<int> cScheduler::CreateDoneList() const
 {
 	QList<int> list;
@@ -339,3 +387,54 @@ bool cScheduler::IsLineDoneByServer(int line) const
 	}
 	return false;
 }
+
+void cScheduler::SetCostMap(const QVector<double> &costMap)
+{
+	if (costMap.size() != endLine) return;
+	lineCost = costMap;
+	costKnown = true;
+	UpdateCostFloor();
+}
+
+void cScheduler::UpdateCostFloor()
+{
+	// lines which were finished immediately still have some cost
+	double sum = 0.0;
+	for (int i = startLine; i < endLine; i++)
+		sum += lineCost[i];
+	costFloor = numberOfLines > 0 ? 0.01 * sum / numberOfLines : 0.0;
+	if (costFloor <= 0.0) costKnown = false;
+}
+
+int cScheduler::CostStartingPosition(int threadIndex, int numberOfThreads) const
+{
+	int line;
+	if (costKnown)
+	{
+		double fraction = double(threadIndex) / numberOfThreads;
+		line = CostQuantileLine(lineCost, fraction, startLine, endLine - 1);
+	}
+	else
+	{
+		line = numberOfLines / numberOfThreads * threadIndex + startLine;
+	}
+	return line / progressiveStep * progressiveStep;
+}
+
+int cScheduler::CostQuantileLine(
+	const QVector<double> &costMap, double fraction, int firstLine, int lastLine)
+{
+	double total = 0.0;
+	for (int i = firstLine; i <= lastLine; i++)
+		total += costMap[i];
+	if (total <= 0.0) return firstLine + int(fraction * (lastLine - firstLine));
+
+	double target = fraction * total;
+	double sum = 0.0;
+	for (int i = firstLine; i <= lastLine; i++)
+	{
+		sum += costMap[i];
+		if (sum > target) return i;
+	}
+	return lastLine;
+}
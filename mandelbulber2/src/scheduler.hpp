@@ -40,35 +40,58 @@
 #define MANDELBULBER2_SRC_SCHEDULER_HPP_
 
 #include "region.hpp"
+#include <QElapsedTimer>
 #include <QMutex>
 #include <qvector.h>
 
+#define LINE_DONE_BY_SERVER 9999
+
+class cJobArena;
+
 class cScheduler
 {
 public:
-	cScheduler(cRegion<int> screenRegion, int progressive);
-	~cScheduler();
+	// line arrays are taken from the arena if it's not NULL
+	cScheduler(cRegion<int> screenRegion, int progressive, cJobArena *_arena = NULL);
+	virtual ~cScheduler();
 	int NextLine(int threadId, int actualLine, bool lastLineWasBroken);
 	bool ShouldIBreak(int threadId, int actualLine) const;
 	bool ThereIsStillSomethingToDo(int ThreadId) const;
-	bool AllLinesDone() const;
+	virtual bool AllLinesDone() const;
 	void InitFirstLine(int threadId, int firstLine);
 	QList<int> GetLastRenderedLines(void);
-	double PercentDone() const;
+	virtual double PercentDone() const;
 	void Stop() { stopRequest = true; }
-	void MarkReceivedLines(const QList<int> &lineNumbers);
-	void UpdateDoneLines(const QList<int> &done);
+	virtual void MarkReceivedLines(const QList<int> &lineNumbers);
+	virtual void UpdateDoneLines(const QList<int> &done);
 
 	int GetProgressiveStep() const { return progressiveStep; }
 	int GetProgressivePass() const { return progressivePass; }
-	bool ProgressiveNextStep();
-	QList<int> CreateDoneList() const;
-	bool IsLineDoneByServer(int line) const;
+	virtual bool ProgressiveNextStep();
+	virtual QList<int> CreateDoneList() const;
+	virtual bool IsLineDoneByServer(int line) const;
+	virtual bool IsTileScheduler() const { return false; }
+	// lines which are rendered in whole width (used for checkpoints)
+	virtual QList<int> GetCompletedLines() const;
 
-private:
+	// rendering time of lines measured in previous frame is used to start and split expensive
+	// regions first. Map has to cover all lines of the image
+	void SetCostMap(const QVector<double> &costMap);
+	const QVector<double> &GetCostMap() const { return lineCost; }
+	bool IsCostMapMeasured() const { return costMeasured; }
+	// first lines of threads distributed evenly by estimated cost
+	int CostStartingPosition(int threadIndex, int numberOfThreads) const;
+	// line where given fraction of total cost of the image is reached
+	static int CostQuantileLine(
+		const QVector<double> &costMap, double fraction, int firstLine, int lastLine);
+
+protected:
 	void Reset(void);
 	int FindBiggestGap() const;
+	double LineWeight(int line) const { return costKnown ? lineCost[line] + costFloor : 1.0; }
+	void UpdateCostFloor();
 
+	cJobArena *arena;
 	int *linePendingThreadId;
 	bool *lineDone;
 	bool *lastLinesDone;
@@ -80,6 +103,13 @@ private:
 	int progressivePass;
 	bool progressiveEnabled;
 	QMutex mutex;
+
+	QVector<double> lineCost;			// rendering time of line in nanoseconds
+	QVector<qint64> lineStartTime; // time when rendering of line was started
+	QElapsedTimer costTimer;
+	bool costKnown;		 // lineCost contains estimation which can be used by scheduler
+	bool costMeasured; // all lines of last pass were measured
+	double costFloor;	// weight of lines which were measured as free
 };
 
 #endif /* MANDELBULBER2_SRC_SCHEDULER_HPP_ */
@@ -49,6 +49,10 @@
 #include "keyframes.hpp"
 #include "material.h"
 
+#define SETTINGS_BINARY_MAGIC "MB2S"
+#define SETTINGS_BINARY_VERSION 1
+#define SETTINGS_BINARY_BYTE_ORDER 0x01020304
+
 cSettings::cSettings(enumFormat _format)
 {
 	format = _format;
@@ -65,6 +69,7 @@ size_t cSettings::CreateText(const cParameterContainer *par, const cFractalConta
 {
 	WriteLog("Create settings text", 3);
 	settingsText.clear();
+	binaryData.clear();
 	settingsText += CreateHeader();
 	if ((format == formatFullText || format == formatCondensedText) && par->IfExists("description")
 			&& par->Get<QString>("description") != "")
@@ -122,6 +127,23 @@ size_t cSettings::CreateText(const cParameterContainer *par, const cFractalConta
 	return (size_t)settingsText.size();
 }
 
+QString cSettings::StructuralHash(const cParameterContainer *par, const cFractalContainer *fractPar)
+{
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	// like in the header of settings text, new version of program invalidates old hashes
+	stream << (double)MANDELBULBER_VERSION;
+	stream << par->GetStructuralHash();
+	if (fractPar)
+	{
+		for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+			stream << fractPar->at(f).GetStructuralHash();
+	}
+	QCryptographicHash hashCrypt(QCryptographicHash::Md4);
+	hashCrypt.addData(data);
+	return hashCrypt.result().toHex();
+}
+
 void cSettings::CreateAnimationString(
 	QString &text, const QString &headerText, const cAnimationFrames *frames)
 {
@@ -250,6 +272,69 @@ QString cSettings::CreateHeader()
 	return header;
 }
 
+size_t cSettings::CreateTextOfParameters(const cParameterContainer *par,
+	const cFractalContainer *fractPar, const QStringList &mainNames,
+	const QList<QStringList> &fractalNames)
+{
+	settingsText.clear();
+	binaryData.clear();
+
+	QString mainSettingsText;
+	for (int i = 0; i < mainNames.size(); i++)
+		mainSettingsText += CreateOneLine(par, mainNames[i]);
+	if (mainSettingsText.length() > 0)
+	{
+		settingsText += "[main_parameters]\n";
+		settingsText += mainSettingsText;
+	}
+
+	for (int f = 0; f < NUMBER_OF_FRACTALS && f < fractalNames.size(); f++)
+	{
+		QString fractalSettingsText;
+		for (int i = 0; i < fractalNames[f].size(); i++)
+			fractalSettingsText += CreateOneLine(&fractPar->at(f), fractalNames[f][i]);
+		if (fractalSettingsText.length() > 0)
+		{
+			settingsText += "[fractal_" + QString::number(f + 1) + "]\n";
+			settingsText += fractalSettingsText;
+		}
+	}
+
+	textPrepared = true;
+	return settingsText.size();
+}
+
+bool cSettings::DecodeParameters(cParameterContainer *par, cFractalContainer *fractPar)
+{
+	if (!textPrepared) return false;
+
+	// text is made by the same version of program
+	fileVersion = appVersion;
+
+	QStringList separatedText = settingsText.split(QRegExp("[\r\n]"), QString::KeepEmptyParts);
+	QString section;
+	int errorCount = 0;
+	for (int l = 0; l < separatedText.size(); l++)
+	{
+		QString line = separatedText[l];
+		if (CheckSection(line, section) || line == "") continue;
+
+		bool result = false;
+		if (section == QString("main_parameters"))
+		{
+			result = DecodeOneLine(par, line);
+		}
+		else if (section.contains("fractal"))
+		{
+			int i = section.right(1).toInt() - 1;
+			if (fractPar && i >= 0 && i < NUMBER_OF_FRACTALS)
+				result = DecodeOneLine(&fractPar->at(i), line);
+		}
+		if (!result) errorCount++;
+	}
+	return errorCount == 0;
+}
+
 QString cSettings::CreateOneLine(const cParameterContainer *par, QString name)
 {
 	QString text;
@@ -283,9 +368,16 @@ bool cSettings::SaveToFile(QString filename) const
 	QFile qfile(filename);
 	if (qfile.open(QIODevice::WriteOnly))
 	{
-		QTextStream outstream(&qfile);
-		outstream << settingsText;
-		outstream.flush();
+		if (!binaryData.isEmpty())
+		{
+			qfile.write(binaryData);
+		}
+		else
+		{
+			QTextStream outstream(&qfile);
+			outstream << settingsText;
+			outstream.flush();
+		}
 		qfile.close();
 		return true;
 	}
@@ -309,10 +401,18 @@ bool cSettings::LoadFromFile(QString filename)
 {
 	settingsText.clear();
 	textPrepared = false;
+	binaryAnimations.clear();
+	binaryFile.clear();
 	WriteLogString("Loading settings started", filename, 2);
 	QFile qfile(filename);
 	if (qfile.open(QIODevice::ReadOnly))
 	{
+		if (qfile.peek(4) == QByteArray(SETTINGS_BINARY_MAGIC))
+		{
+			qfile.close();
+			return LoadBinary(filename);
+		}
+
 		QTextStream instream(&qfile);
 		settingsText.append(instream.readAll());
 		qfile.close();
@@ -344,6 +444,8 @@ bool cSettings::LoadFromString(const QString &_settingsText)
 {
 	settingsText = _settingsText;
 	textPrepared = true;
+	binaryAnimations.clear();
+	binaryFile.clear();
 
 	QCryptographicHash hashCrypt(QCryptographicHash::Md4);
 	hashCrypt.addData(settingsText.toLocal8Bit());
@@ -556,6 +658,14 @@ bool cSettings::Decode(cParameterContainer *par, cFractalContainer *fractPar,
 			}
 		}
 
+		// animations stored as binary tables
+		for (int i = 0; i < binaryAnimations.size(); i++)
+		{
+			cAnimationFrames *animation = binaryAnimations[i].isKeyframes ? keyframes : frames;
+			if (animation && !DecodeBinaryAnimation(binaryAnimations[i], par, fractPar, animation))
+				return false;
+		}
+
 		// add default parameters for animation
 		if (keyframes)
 		{
@@ -1051,3 +1161,320 @@ QString cSettings::everyLocaleDouble(QString txt)
 	if (systemData.decimalPoint == '.') txtOut = txt.replace(',', '.');
 	return txtOut;
 }
+
+static void AppendUInt(QByteArray *data, quint32 value)
+{
+	data->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void AppendPadding(QByteArray *data)
+{
+	// tables of doubles have to be aligned
+	while (data->size() % sizeof(double) != 0)
+		data->append(char(0));
+}
+
+static bool ReadUInt(const uchar *data, qint64 size, qint64 *offset, quint32 *value)
+{
+	if (*offset + qint64(sizeof(quint32)) > size) return false;
+	memcpy(value, data + *offset, sizeof(quint32));
+	*offset += sizeof(quint32);
+	return true;
+}
+
+static void SkipPadding(qint64 *offset)
+{
+	while (*offset % sizeof(double) != 0)
+		(*offset)++;
+}
+
+int cSettings::NumberOfComponents(int varType)
+{
+	switch (varType)
+	{
+		case typeInt:
+		case typeDouble:
+		case typeBool: return 1;
+		case typeVector3:
+		case typeRgb: return 3;
+		case typeVector4: return 4;
+		default: return 0;
+	}
+}
+
+bool cSettings::CanStoreBinary(const cAnimationFrames *frames) const
+{
+	if (!frames || frames->GetNumberOfFrames() == 0) return false;
+	QList<cAnimationFrames::sParameterDescription> parameterList = frames->GetListOfUsedParameters();
+	for (int i = 0; i < parameterList.size(); i++)
+	{
+		// strings and palettes can be stored only as text
+		if (NumberOfComponents(parameterList[i].varType) == 0) return false;
+	}
+	return true;
+}
+
+size_t cSettings::CreateBinary(const cParameterContainer *par, const cFractalContainer *fractPar,
+	cAnimationFrames *frames, cKeyframes *keyframes)
+{
+	bool binaryFrames = format != formatAppSettings && CanStoreBinary(frames);
+	bool binaryKeyframes = format != formatAppSettings && CanStoreBinary(keyframes);
+
+	// animations which cannot be stored as tables stay in the text
+	CreateText(par, fractPar, binaryFrames ? NULL : frames, binaryKeyframes ? NULL : keyframes);
+
+	QByteArray text = settingsText.toUtf8();
+	QByteArray data;
+	data.append(SETTINGS_BINARY_MAGIC);
+	AppendUInt(&data, SETTINGS_BINARY_VERSION);
+	AppendUInt(&data, SETTINGS_BINARY_BYTE_ORDER);
+	AppendUInt(&data, text.size());
+	data.append(text);
+	AppendPadding(&data);
+
+	AppendUInt(&data, int(binaryFrames) + int(binaryKeyframes));
+	if (binaryFrames) AppendBinaryAnimation(&data, false, frames);
+	if (binaryKeyframes) AppendBinaryAnimation(&data, true, keyframes);
+
+	// hash covers also animation tables
+	QCryptographicHash hashCrypt(QCryptographicHash::Md4);
+	hashCrypt.addData(data);
+	hash = hashCrypt.result();
+
+	binaryData = data;
+	return (size_t)binaryData.size();
+}
+
+void cSettings::AppendBinaryAnimation(
+	QByteArray *data, bool isKeyframes, cAnimationFrames *frames) const
+{
+	QList<cAnimationFrames::sParameterDescription> parameterList = frames->GetListOfUsedParameters();
+	int valuesPerFrame = 0;
+	for (int i = 0; i < parameterList.size(); i++)
+		valuesPerFrame += NumberOfComponents(parameterList[i].varType);
+
+	AppendUInt(data, isKeyframes ? 1 : 0);
+	AppendUInt(data, parameterList.size());
+	AppendUInt(data, frames->GetNumberOfFrames());
+	AppendUInt(data, valuesPerFrame);
+	for (int i = 0; i < parameterList.size(); i++)
+	{
+		QByteArray name =
+			(parameterList[i].containerName + "_" + parameterList[i].parameterName).toUtf8();
+		AppendUInt(data, parameterList[i].varType);
+		AppendUInt(data, parameterList[i].morphType);
+		AppendUInt(data, name.size());
+		data->append(name);
+	}
+	AppendPadding(data);
+
+	QVector<sParameterHandle> handles(parameterList.size());
+	QVector<double> values(valuesPerFrame);
+	for (int f = 0; f < frames->GetNumberOfFrames(); f++)
+	{
+		const cParameterContainer &container = frames->GetFrame(f).parameters;
+		int column = 0;
+		for (int i = 0; i < parameterList.size(); i++)
+		{
+			handles[i] = container.FindHandle(
+				parameterList[i].containerName + "_" + parameterList[i].parameterName, handles[i]);
+			switch (parameterList[i].varType)
+			{
+				case typeVector3:
+				{
+					CVector3 val = container.Get<CVector3>(handles[i]);
+					values[column++] = val.x;
+					values[column++] = val.y;
+					values[column++] = val.z;
+					break;
+				}
+				case typeVector4:
+				{
+					CVector4 val = container.Get<CVector4>(handles[i]);
+					values[column++] = val.x;
+					values[column++] = val.y;
+					values[column++] = val.z;
+					values[column++] = val.w;
+					break;
+				}
+				case typeRgb:
+				{
+					sRGB val = container.Get<sRGB>(handles[i]);
+					values[column++] = val.R;
+					values[column++] = val.G;
+					values[column++] = val.B;
+					break;
+				}
+				case typeInt: values[column++] = container.Get<int>(handles[i]); break;
+				case typeBool: values[column++] = container.Get<bool>(handles[i]) ? 1.0 : 0.0; break;
+				default: values[column++] = container.Get<double>(handles[i]); break;
+			}
+		}
+		data->append(
+			reinterpret_cast<const char *>(values.constData()), valuesPerFrame * sizeof(double));
+	}
+}
+
+bool cSettings::LoadBinary(const QString &filename)
+{
+	QSharedPointer<QFile> file(new QFile(filename));
+	const uchar *data = NULL;
+	qint64 size = file->size();
+	if (file->open(QIODevice::ReadOnly)) data = file->map(0, size);
+
+	try
+	{
+		if (!data) throw QObject::tr("Cannot map binary settings file");
+
+		qint64 offset = 4;
+		quint32 version, byteOrder, textSize;
+		if (!ReadUInt(data, size, &offset, &version) || !ReadUInt(data, size, &offset, &byteOrder)
+				|| !ReadUInt(data, size, &offset, &textSize))
+			throw QObject::tr("Binary settings file is truncated");
+		if (version > SETTINGS_BINARY_VERSION)
+			throw QObject::tr("Binary settings file is made by newer version of program");
+		if (byteOrder != SETTINGS_BINARY_BYTE_ORDER)
+			throw QObject::tr("Binary settings file is made on computer with different byte order");
+		if (offset + textSize > size) throw QObject::tr("Binary settings file is truncated");
+
+		settingsText = QString::fromUtf8(reinterpret_cast<const char *>(data + offset), textSize);
+		offset += textSize;
+		SkipPadding(&offset);
+
+		quint32 numberOfAnimations;
+		if (!ReadUInt(data, size, &offset, &numberOfAnimations))
+			throw QObject::tr("Binary settings file is truncated");
+
+		for (quint32 a = 0; a < numberOfAnimations; a++)
+		{
+			sBinaryAnimation animation;
+			quint32 isKeyframes, numberOfColumns, numberOfFrames, valuesPerFrame;
+			if (!ReadUInt(data, size, &offset, &isKeyframes)
+					|| !ReadUInt(data, size, &offset, &numberOfColumns)
+					|| !ReadUInt(data, size, &offset, &numberOfFrames)
+					|| !ReadUInt(data, size, &offset, &valuesPerFrame))
+				throw QObject::tr("Binary settings file is truncated");
+
+			int values = 0;
+			for (quint32 i = 0; i < numberOfColumns; i++)
+			{
+				quint32 varType, morphType, nameSize;
+				if (!ReadUInt(data, size, &offset, &varType) || !ReadUInt(data, size, &offset, &morphType)
+						|| !ReadUInt(data, size, &offset, &nameSize) || offset + nameSize > size)
+					throw QObject::tr("Binary settings file is truncated");
+				animation.fullParameterNames.append(
+					QString::fromUtf8(reinterpret_cast<const char *>(data + offset), nameSize));
+				animation.varTypes.append(varType);
+				animation.morphTypes.append(morphType);
+				values += NumberOfComponents(varType);
+				offset += nameSize;
+			}
+			SkipPadding(&offset);
+
+			if (quint32(values) != valuesPerFrame)
+				throw QObject::tr("Wrong number of values in binary animation frames");
+			qint64 tableSize = qint64(numberOfFrames) * valuesPerFrame * sizeof(double);
+			if (offset + tableSize > size) throw QObject::tr("Binary settings file is truncated");
+
+			// frames are read directly from mapped memory while they are decoded
+			animation.isKeyframes = isKeyframes;
+			animation.numberOfFrames = numberOfFrames;
+			animation.valuesPerFrame = valuesPerFrame;
+			animation.table = reinterpret_cast<const double *>(data + offset);
+			offset += tableSize;
+			binaryAnimations.append(animation);
+		}
+	}
+	catch (QString &error)
+	{
+		binaryAnimations.clear();
+		if (!quiet)
+		{
+			cErrorMessage::showMessage(
+				QObject::tr("Settings file not loaded!\n") + filename + "\n" + error,
+				cErrorMessage::errorMessage);
+		}
+		return false;
+	}
+
+	binaryFile = file;
+	textPrepared = true;
+
+	QCryptographicHash hashCrypt(QCryptographicHash::Md4);
+	hashCrypt.addData(reinterpret_cast<const char *>(data), size);
+	hash = hashCrypt.result();
+
+	WriteLogString("Binary settings loaded", settingsText, 2);
+	return true;
+}
+
+bool cSettings::DecodeBinaryAnimation(const sBinaryAnimation &animation, cParameterContainer *par,
+	cFractalContainer *fractPar, cAnimationFrames *frames)
+{
+	CheckIfMaterialsAreDefined(par);
+	cParameterContainer parTemp = *par;
+	cFractalContainer fractTemp;
+	if (fractPar) fractTemp = *fractPar;
+
+	for (int i = 0; i < animation.fullParameterNames.size(); i++)
+	{
+		if (!frames->AddAnimatedParameter(animation.fullParameterNames[i], par, fractPar))
+		{
+			cErrorMessage::showMessage(QObject::tr("Unknown parameter in animation frames: ")
+																	 + animation.fullParameterNames[i],
+				cErrorMessage::errorMessage);
+			return false;
+		}
+		if (animation.isKeyframes)
+		{
+			static_cast<cKeyframes *>(frames)->ChangeMorphType(
+				i, parameterContainer::enumMorphType(animation.morphTypes[i]));
+		}
+	}
+	if (animation.numberOfFrames == 0) return true;
+
+	// all frames are made from the same template, so handles are the same for all of them
+	frames->AddFrame(parTemp, fractTemp);
+	int firstFrame = frames->GetNumberOfFrames() - 1;
+	cAnimationFrames::sAnimationFrame frameTemplate = frames->GetFrame(firstFrame);
+	QVector<sParameterHandle> handles(animation.fullParameterNames.size());
+	for (int i = 0; i < animation.fullParameterNames.size(); i++)
+		handles[i] = frameTemplate.parameters.GetHandle(animation.fullParameterNames[i]);
+
+	for (int f = 0; f < animation.numberOfFrames; f++)
+	{
+		cAnimationFrames::sAnimationFrame frame = frameTemplate;
+		const double *values = animation.table + qint64(f) * animation.valuesPerFrame;
+		int column = 0;
+		for (int i = 0; i < animation.fullParameterNames.size(); i++)
+		{
+			switch (animation.varTypes[i])
+			{
+				case typeVector3:
+					frame.parameters.Set(
+						handles[i], CVector3(values[column], values[column + 1], values[column + 2]));
+					column += 3;
+					break;
+				case typeVector4:
+					frame.parameters.Set(handles[i], CVector4(values[column], values[column + 1],
+																						 values[column + 2], values[column + 3]));
+					column += 4;
+					break;
+				case typeRgb:
+					frame.parameters.Set(handles[i],
+						sRGB(int(values[column]), int(values[column + 1]), int(values[column + 2])));
+					column += 3;
+					break;
+				case typeInt: frame.parameters.Set(handles[i], int(values[column++])); break;
+				case typeBool: frame.parameters.Set(handles[i], values[column++] != 0.0); break;
+				default: frame.parameters.Set(handles[i], values[column++]); break;
+			}
+		}
+
+		if (f == 0)
+			frames->ModifyFrame(firstFrame, frame);
+		else
+			frames->AddFrame(frame);
+	}
+	return true;
+}
@@ -33,6 +33,9 @@
  *
  * cSettings can transpose program internal settings to settings string and vice versa.
  * It has also methods to [load / save] [from / to] [clipboard / string / file]
+ *
+ * Binary settings file keeps main and fractal parameters as settings text and numeric
+ * animation frames as table of doubles, which is memory-mapped when the file is loaded
  */
 
 #ifndef MANDELBULBER2_SRC_SETTINGS_HPP_
@@ -60,6 +63,9 @@ public:
 	cSettings(enumFormat _format);
 	size_t CreateText(const cParameterContainer *par, const cFractalContainer *fractPar,
 		cAnimationFrames *frames = NULL, cKeyframes *keyframes = NULL);
+	// prepares binary file. Animations with non-numeric parameters are kept in the text part
+	size_t CreateBinary(const cParameterContainer *par, const cFractalContainer *fractPar,
+		cAnimationFrames *frames = NULL, cKeyframes *keyframes = NULL);
 	bool SaveToFile(QString filename) const;
 	void SaveToClipboard();
 	bool LoadFromFile(QString filename);
@@ -68,6 +74,16 @@ public:
 	bool Decode(cParameterContainer *par, cFractalContainer *fractPar,
 		cAnimationFrames *frames = NULL, cKeyframes *keyframes = NULL);
 	QString GetHashCode() { return hash.toHex(); }
+	// hash of settings which would be written by CreateText() in condensed format, made from
+	// hashes maintained by containers. It has the same length as GetHashCode(), but the values
+	// are different
+	static QString StructuralHash(const cParameterContainer *par, const cFractalContainer *fractPar);
+	// text with only listed parameters (also with default values), used by journal of autosave.
+	// fractalNames has a list for every fractal
+	size_t CreateTextOfParameters(const cParameterContainer *par, const cFractalContainer *fractPar,
+		const QStringList &mainNames, const QList<QStringList> &fractalNames);
+	// applies text made by CreateTextOfParameters() without resetting of other parameters
+	bool DecodeParameters(cParameterContainer *par, cFractalContainer *fractPar);
 	void BeQuiet(bool _quiet) { quiet = _quiet; }
 	QString GetSettingsText() const;
 
@@ -89,6 +105,24 @@ private:
 
 	QString everyLocaleDouble(QString txt);
 
+	struct sBinaryAnimation
+	{
+		bool isKeyframes;
+		QStringList fullParameterNames;
+		QList<int> varTypes;
+		QList<int> morphTypes;
+		int numberOfFrames;
+		int valuesPerFrame;
+		const double *table;
+	};
+
+	bool CanStoreBinary(const cAnimationFrames *frames) const;
+	void AppendBinaryAnimation(QByteArray *data, bool isKeyframes, cAnimationFrames *frames) const;
+	bool LoadBinary(const QString &filename);
+	bool DecodeBinaryAnimation(const sBinaryAnimation &animation, cParameterContainer *par,
+		cFractalContainer *fractPar, cAnimationFrames *frames);
+	static int NumberOfComponents(int varType);
+
 	bool CheckIfMaterialsAreDefined(cParameterContainer *par);
 
 	enumFormat format;
@@ -101,6 +135,10 @@ private:
 	QByteArray hash;
 	int csvNoOfColumns;
 	QStringList listOfLoadedPrimitives;
+
+	QByteArray binaryData; // whole binary file prepared by CreateBinary()
+	QSharedPointer<QFile> binaryFile; // mapped binary file
+	QList<sBinaryAnimation> binaryAnimations;
 };
 
 #endif /* MANDELBULBER2_SRC_SETTINGS_HPP_ */
@@ -0,0 +1,135 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSettingsPreviewLoader - loading of settings files for previews in background
+ */
+
+#include "settings_preview_loader.hpp"
+
+#include <QFileInfo>
+#include <QThread>
+
+#include "../qt/thumbnail_widget.h"
+#include "initparameters.hpp"
+#include "settings.hpp"
+
+cSettingsPreviewDecoder::cSettingsPreviewDecoder(const QAtomicInt *_generation)
+		: QObject(), generation(_generation), cache(SETTINGS_PREVIEW_CACHE_SIZE)
+{
+}
+
+void cSettingsPreviewDecoder::slotLoad(
+	int requestGeneration, QString fileName, int width, int height, int oversample)
+{
+	// another file was selected after request
+	if (IsCancelled(requestGeneration)) return;
+
+	QFileInfo fileInfo(fileName);
+	sDecodedSettings *decoded = cache.object(fileName);
+	if (!decoded || decoded->lastModified != fileInfo.lastModified()
+			|| decoded->fileSize != fileInfo.size())
+	{
+		cSettings parSettings(cSettings::formatFullText);
+		parSettings.BeQuiet(true);
+		bool loaded = parSettings.LoadFromFile(fileName);
+		if (IsCancelled(requestGeneration)) return;
+
+		decoded = new sDecodedSettings;
+		decoded->lastModified = fileInfo.lastModified();
+		decoded->fileSize = fileInfo.size();
+		InitParams(&decoded->par);
+		for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+			InitFractalParams(&decoded->fractal.at(i));
+
+		/****************** TEMPORARY CODE FOR MATERIALS *******************/
+
+		InitMaterialParams(1, &decoded->par);
+
+		/*******************************************************************/
+
+		decoded->valid = loaded && parSettings.Decode(&decoded->par, &decoded->fractal);
+		cache.insert(fileName, decoded);
+		if (IsCancelled(requestGeneration)) return;
+	}
+
+	QString description;
+	bool thumbnailStored = false;
+	if (decoded->valid)
+	{
+		description = decoded->par.Get<QString>("description");
+		thumbnailStored = cThumbnailWidget::PreloadStoredThumbnail(
+			decoded->par, decoded->fractal, width, height, oversample);
+	}
+	emit settingsLoaded(requestGeneration, fileName, decoded->valid, description, decoded->par,
+		decoded->fractal, thumbnailStored);
+}
+
+cSettingsPreviewLoader::cSettingsPreviewLoader(QObject *parent) : QObject(parent)
+{
+	thread = new QThread;
+	thread->setObjectName("SettingsPreviewLoader");
+	decoder = new cSettingsPreviewDecoder(&generation);
+	decoder->moveToThread(thread);
+	connect(this, SIGNAL(load(int, QString, int, int, int)), decoder,
+		SLOT(slotLoad(int, QString, int, int, int)));
+	connect(decoder,
+		SIGNAL(settingsLoaded(
+			int, QString, bool, QString, cParameterContainer, cFractalContainer, bool)),
+		this,
+		SLOT(slotSettingsLoaded(
+			int, QString, bool, QString, cParameterContainer, cFractalContainer, bool)));
+	thread->start();
+}
+
+cSettingsPreviewLoader::~cSettingsPreviewLoader()
+{
+	// waiting requests are skipped
+	generation.ref();
+	thread->quit();
+	thread->wait();
+	delete decoder;
+	delete thread;
+}
+
+void cSettingsPreviewLoader::Request(const QString &fileName, int width, int height, int oversample)
+{
+	int requestGeneration = generation.fetchAndAddOrdered(1) + 1;
+	emit load(requestGeneration, fileName, width, height, oversample);
+}
+
+void cSettingsPreviewLoader::slotSettingsLoaded(int requestGeneration, QString fileName,
+	bool valid, QString description, cParameterContainer par, cFractalContainer fractal,
+	bool thumbnailStored)
+{
+	// result of request which was cancelled when the decoder already finished it
+	if (requestGeneration != generation.load()) return;
+	emit settingsLoaded(fileName, valid, description, par, fractal, thumbnailStored);
+}
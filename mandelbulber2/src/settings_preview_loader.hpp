@@ -0,0 +1,117 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSettingsPreviewLoader - loading of settings files for previews in background
+ *
+ * File dialogs show description and thumbnail of selected settings file. Reading and decoding
+ * of the file (which can be on slow network storage) and looking for stored thumbnail are done
+ * in separate thread, so browsing through files doesn't block the GUI. Request for another file
+ * cancels waiting and unfinished requests. Decoded settings are kept in memory, so they are not
+ * loaded again while the file is not modified.
+ */
+
+#ifndef MANDELBULBER2_SRC_SETTINGS_PREVIEW_LOADER_HPP_
+#define MANDELBULBER2_SRC_SETTINGS_PREVIEW_LOADER_HPP_
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+
+// forward declarations
+class QThread;
+
+// maximum number of decoded settings files kept in memory
+#define SETTINGS_PREVIEW_CACHE_SIZE 256
+
+// decodes settings files in own thread
+class cSettingsPreviewDecoder : public QObject
+{
+	Q_OBJECT
+public:
+	cSettingsPreviewDecoder(const QAtomicInt *_generation);
+
+public slots:
+	void slotLoad(int generation, QString fileName, int width, int height, int oversample);
+
+signals:
+	// thumbnailStored is true if thumbnail was found and loaded to memory cache of thumbnails
+	void settingsLoaded(int generation, QString fileName, bool valid, QString description,
+		cParameterContainer par, cFractalContainer fractal, bool thumbnailStored);
+
+private:
+	struct sDecodedSettings
+	{
+		QDateTime lastModified;
+		qint64 fileSize;
+		bool valid;
+		cParameterContainer par;
+		cFractalContainer fractal;
+	};
+
+	bool IsCancelled(int requestGeneration) const { return requestGeneration != generation->load(); }
+
+	const QAtomicInt *generation; // requests of older generations are cancelled
+	QCache<QString, sDecodedSettings> cache;
+};
+
+class cSettingsPreviewLoader : public QObject
+{
+	Q_OBJECT
+public:
+	cSettingsPreviewLoader(QObject *parent = NULL);
+	~cSettingsPreviewLoader();
+
+	// previous requests are cancelled. Size is the size of thumbnail which will be shown
+	void Request(const QString &fileName, int width, int height, int oversample);
+	void Cancel() { generation.ref(); }
+
+signals:
+	void settingsLoaded(QString fileName, bool valid, QString description, cParameterContainer par,
+		cFractalContainer fractal, bool thumbnailStored);
+	// internal signal to decoder
+	void load(int generation, QString fileName, int width, int height, int oversample);
+
+private slots:
+	void slotSettingsLoaded(int generation, QString fileName, bool valid, QString description,
+		cParameterContainer par, cFractalContainer fractal, bool thumbnailStored);
+
+private:
+	QThread *thread;
+	cSettingsPreviewDecoder *decoder;
+	QAtomicInt generation;
+};
+
+#endif /* MANDELBULBER2_SRC_SETTINGS_PREVIEW_LOADER_HPP_ */
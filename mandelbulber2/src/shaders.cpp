@@ -33,18 +33,25 @@
  */
 
 #include <algorithm>
+#include "ao_buffer.hpp"
 #include "ao_modes.h"
 #include "calculate_distance.hpp"
 #include "common_math.h"
+#include "cube_lut.hpp"
+#include "double_double.hpp"
 #include "compute_fractal.hpp"
 #include "fractparams.hpp"
+#include "light_grid.hpp"
 #include "render_data.hpp"
 #include "render_worker.hpp"
+#include "shadow_cache.hpp"
 #include "texture_mapping.hpp"
 
 using std::max;
+using std::min;
 
-sRGBAfloat cRenderWorker::ObjectShader(
+template <int Features>
+sRGBAfloat cRenderWorker::ObjectShaderVariant(
 	const sShaderInputData &_input, sRGBAfloat *surfaceColour, sRGBAfloat *specularOut)
 {
 	sRGBAfloat output;
@@ -63,7 +70,7 @@ sRGBAfloat cRenderWorker::ObjectShader(
 
 	// calculate shading based on angle of incidence
 	sRGBAfloat shade;
-	if (params->mainLightEnable)
+	if ((Features & shaderFeatureMainLight) && params->mainLightEnable)
 	{
 		shade = MainShading(input);
 		shade.R = params->mainLightIntensity * ((1.0 - mat->shading) + mat->shading * shade.R);
@@ -73,11 +80,23 @@ sRGBAfloat cRenderWorker::ObjectShader(
 
 	// calculate shadow
 	sRGBAfloat shadow(1.0, 1.0, 1.0, 1.0);
-	if (params->shadow && params->mainLightEnable) shadow = MainShadow(input);
+	if ((Features & shaderFeatureShadow) && params->shadow && params->mainLightEnable)
+	{
+		// shadows of primary hits of tile were already traced in wavefront mode
+		if (input.primaryRay && wavefrontShadow)
+			shadow = *wavefrontShadow;
+		else if (!data->shadowCache)
+			shadow = MainShadow(input);
+		else if (!data->shadowCache->Get(input.point, input.delta, &shadow))
+		{
+			shadow = MainShadow(input);
+			data->shadowCache->Set(input.point, input.delta, shadow);
+		}
+	}
 
 	// calculate specular highlight
 	sRGBAfloat specular;
-	if (params->mainLightEnable)
+	if ((Features & shaderFeatureMainLight) && params->mainLightEnable)
 	{
 		specular = MainSpecular(input);
 		specular.R *= mat->specular;
@@ -96,7 +115,7 @@ sRGBAfloat cRenderWorker::ObjectShader(
 
 	// ambient occlusion
 	sRGBAfloat ambient(0.0, 0.0, 0.0, 0.0);
-	if (params->ambientOcclusionEnabled)
+	if ((Features & shaderFeatureAO) && params->ambientOcclusionEnabled)
 	{
 		// fast mode
 		if (params->ambientOcclusionMode == params::AOmodeFast)
@@ -105,7 +124,21 @@ sRGBAfloat cRenderWorker::ObjectShader(
 		}
 		else if (params->ambientOcclusionMode == params::AOmodeMultipeRays)
 		{
-			ambient = AmbientOcclusion(input);
+			// ambient occlusion of primary rays can be upsampled from reduced resolution
+			bool upsampled =
+				input.primaryRay && data->aoBuffer
+				&& data->aoBuffer->Interpolate(shadedPixel, input.depth, input.normal, &ambient);
+			if (!upsampled)
+			{
+				if (!data->aoCache)
+					ambient = AmbientOcclusion(input);
+				else if (!data->aoCache->Get(input.point, input.delta, &ambient))
+				{
+					// ambient occlusion doesn't depend on direction of view, so it is shared between eyes
+					ambient = AmbientOcclusion(input);
+					data->aoCache->Set(input.point, input.delta, ambient);
+				}
+			}
 		}
 	}
 	sRGBAfloat ambient2;
@@ -115,7 +148,7 @@ sRGBAfloat cRenderWorker::ObjectShader(
 
 	// environment mapping
 	sRGBAfloat envMapping(0.0, 0.0, 0.0, 0.0);
-	if (params->envMappingEnable)
+	if ((Features & shaderFeatureEnvMapping) && params->envMappingEnable)
 	{
 		envMapping = EnvMapping(input);
 	}
@@ -126,12 +159,12 @@ sRGBAfloat cRenderWorker::ObjectShader(
 	// additional lights
 	sRGBAfloat auxLights;
 	sRGBAfloat auxLightsSpecular;
-	auxLights = AuxLightsShader(input, &auxLightsSpecular);
+	if (Features & shaderFeatureAuxLights) auxLights = AuxLightsShader(input, &auxLightsSpecular);
 
 	// fake orbit trap lights
 	sRGBAfloat fakeLights(0.0, 0.0, 0.0, 0.0);
 	sRGBAfloat fakeLightsSpecular(0.0, 0.0, 0.0, 0.0);
-	if (params->fakeLightsEnabled)
+	if ((Features & shaderFeatureFakeLights) && params->fakeLightsEnabled)
 	{
 		fakeLights = FakeLights(input, &fakeLightsSpecular);
 	}
@@ -168,7 +201,8 @@ sRGBAfloat cRenderWorker::ObjectShader(
 	return output;
 }
 
-sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
+sRGBAfloat cRenderWorker::BackgroundColour(
+	const cParamRender *params, const sRenderData *data, const CVector3 &viewVector)
 {
 	sRGBAfloat pixel2;
 
@@ -178,8 +212,8 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 		{
 			case params::mapDoubleHemisphere:
 			{
-				double alphaTexture = input.viewVector.GetAlpha();
-				double betaTexture = input.viewVector.GetBeta();
+				double alphaTexture = viewVector.GetAlpha();
+				double betaTexture = viewVector.GetBeta();
 				int texWidth = data->textures.backgroundTexture.Width() * 0.5;
 				int texHeight = data->textures.backgroundTexture.Height();
 				int offset = 0;
@@ -203,8 +237,8 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 			}
 			case params::mapEquirectangular:
 			{
-				double alphaTexture = fmod(-input.viewVector.GetAlpha() + 3.5 * M_PI, 2 * M_PI);
-				double betaTexture = -input.viewVector.GetBeta();
+				double alphaTexture = fmod(-viewVector.GetAlpha() + 3.5 * M_PI, 2 * M_PI);
+				double betaTexture = -viewVector.GetBeta();
 				if (betaTexture > 0.5 * M_PI) betaTexture = 0.5 * M_PI - betaTexture;
 				if (betaTexture < -0.5 * M_PI) betaTexture = -0.5 * M_PI + betaTexture;
 				double texX = alphaTexture / (2.0 * M_PI) * data->textures.backgroundTexture.Width();
@@ -217,26 +251,7 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 			}
 			case params::mapFlat:
 			{
-				CVector3 vect = mRotInv.RotateVector(input.viewVector);
-				double texX, texY;
-				if (fabs(vect.y) > 1e-20)
-				{
-					texX = vect.x / vect.y / params->fov * params->imageHeight / params->imageWidth;
-					texY = -vect.z / vect.y / params->fov;
-				}
-				else
-				{
-					texX = (vect.x > 0.0) ? 1.0 : -1.0;
-					texY = (vect.z > 0.0) ? -1.0 : 1.0;
-				}
-
-				texX = (texX + 0.5);
-				texY = (texY + 0.5);
-
-				sRGBfloat pixel = data->textures.backgroundTexture.Pixel(CVector2<double>(texX, texY));
-				pixel2.R = pixel.R;
-				pixel2.G = pixel.G;
-				pixel2.B = pixel.B;
+				// depends on camera, calculated by BackgroundShader()
 				break;
 			}
 		}
@@ -248,7 +263,7 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 	{
 		CVector3 vector(0.0, 0.0, 1.0);
 		vector.Normalize();
-		CVector3 viewVectorNorm = input.viewVector;
+		CVector3 viewVectorNorm = viewVector;
 		viewVectorNorm.Normalize();
 		double grad = (viewVectorNorm.Dot(vector) + 1.0);
 		sRGB16 pixel;
@@ -273,6 +288,46 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 		pixel2.B = pixel.B / 65536.0;
 		pixel2.A = 0.0;
 	}
+	return pixel2;
+}
+
+sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
+{
+	cStageScope stage(&threadData->stageTimer, renderStageBackground);
+	sRGBAfloat pixel2;
+
+	if (data->backgroundLUT)
+	{
+		pixel2 = data->backgroundLUT->Get(input.viewVector);
+	}
+	else if (params->texturedBackground && params->texturedBackgroundMapType == params::mapFlat)
+	{
+		// flat background depends on camera, so it cannot be taken from the table
+		CVector3 vect = mRotInv.RotateVector(input.viewVector);
+		double texX, texY;
+		if (fabs(vect.y) > 1e-20)
+		{
+			texX = vect.x / vect.y / params->fov * params->imageHeight / params->imageWidth;
+			texY = -vect.z / vect.y / params->fov;
+		}
+		else
+		{
+			texX = (vect.x > 0.0) ? 1.0 : -1.0;
+			texY = (vect.z > 0.0) ? -1.0 : 1.0;
+		}
+
+		texX = (texX + 0.5);
+		texY = (texY + 0.5);
+
+		sRGBfloat pixel = data->textures.backgroundTexture.Pixel(CVector2<double>(texX, texY));
+		pixel2.R = pixel.R * params->background_brightness;
+		pixel2.G = pixel.G * params->background_brightness;
+		pixel2.B = pixel.B * params->background_brightness;
+	}
+	else
+	{
+		pixel2 = BackgroundColour(params, data, input.viewVector);
+	}
 
 	CVector3 viewVectorNorm = input.viewVector;
 	viewVectorNorm.Normalize();
@@ -286,7 +341,8 @@ sRGBAfloat cRenderWorker::BackgroundShader(const sShaderInputData &input)
 	return pixel2;
 }
 
-sRGBAfloat cRenderWorker::VolumetricShader(
+template <int Features>
+sRGBAfloat cRenderWorker::VolumetricShaderVariant(
 	const sShaderInputData &input, sRGBAfloat oldPixel, sRGBAfloat *opacityOut)
 {
 	sRGBAfloat output;
@@ -297,6 +353,13 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 	output.B = oldPixel.B;
 	output.A = oldPixel.A;
 
+	if (!(Features & shaderFeatureVolumetric))
+	{
+		// nothing is accumulated along the ray, only alpha is clamped like by the loop below
+		if (input.stepCount > 1 && output.A > 1.0) output.A = 1.0;
+		return output;
+	}
+
 	// volumetric fog init
 	double colourThresh = params->volFogColour1Distance;
 	double colourThresh2 = params->volFogColour2Distance;
@@ -317,28 +380,59 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 
 	double totalStep = 0.0;
 
+	// adaptive integration starts from the step where transmittance from camera is negligible
+	bool adaptive = params->volumetricAdaptive;
+	int firstIndex = input.stepCount - 1;
+	if (adaptive) firstIndex = VolumetricDensities(input);
+	float transmittance = 1.0; // from camera to the current step
+	if (adaptive)
+	{
+		for (int index = 1; index <= firstIndex; index++)
+			transmittance *= 1.0f - volumetricDensity[index];
+	}
+	double segmentDensity = 0.0;
+
+	// shadows are calculated once per step for volumetric lights and iteration fog. Index of step
+	// is stored to know when shadow can be reused
+	sRGBAfloat mainLightShadow;
+	double auxLightShadow[4] = {0.0, 0.0, 0.0, 0.0};
+	int mainLightShadowIndex = -1;
+	int auxLightShadowIndex[4] = {-1, -1, -1, -1};
+
 	// qDebug() << "Start volumetric shader &&&&&&&&&&&&&&&&&&&&";
 
 	sShaderInputData input2 = input;
-	for (int index = input.stepCount - 1; index > 0; index--)
+	for (int index = firstIndex; index > 0; index--)
 	{
-		double step = input.stepBuff[index].step;
-		double distance = input.stepBuff[index].distance;
-		CVector3 point = input.stepBuff[index].point;
+		double step = input.stepBuff->step[index];
+		double distance = input.stepBuff->distance[index];
+		CVector3 point = input.stepBuff->Point(index);
 		totalStep += step;
 
 		input2.point = point;
-		input2.distThresh = input.stepBuff[index].distThresh;
+		input2.distThresh = input.stepBuff->distThresh[index];
 
-		// qDebug() << "i" << index << "dist" << distance << "iters" << input.stepBuff[index].iters <<
-		// "distThresh" << input2.distThresh << "step" << step << "point" << point.Debug();
+		// steps with low density can be merged into longer segments. Glow is not merged, because
+		// its opacity depends on number of evaluated steps
+		double mergeFactor = 1.0;
+		if (adaptive)
+		{
+			transmittance /= 1.0f - volumetricDensity[index];
+			segmentDensity += volumetricDensity[index];
+			if (segmentDensity < VOLUMETRIC_LOW_DENSITY && !params->glowEnabled)
+				mergeFactor = VOLUMETRIC_MAX_MERGE;
+		}
 
-		if (totalStep < CalcDelta(point))
+		if (totalStep < CalcDelta(point) * mergeFactor && (!adaptive || index > 1))
 		{
 			continue;
 		}
 		step = totalStep;
 		totalStep = 0.0;
+		segmentDensity = 0.0;
+
+		// shadow rays of steps seen through dense fog are reused from the previous step
+		bool reuseShadows = adaptive && transmittance < VOLUMETRIC_SHADOW_REUSE_TRANSMITTANCE;
 
 		//------------------- glow
 		if (params->glowEnabled)
@@ -439,7 +533,12 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 		{
 			if (i == 0 && params->volumetricLightEnabled[0])
 			{
-				sRGBAfloat shadowOutputTemp = MainShadow(input2);
+				if (mainLightShadowIndex != index && !(reuseShadows && mainLightShadowIndex >= 0))
+				{
+					mainLightShadow = MainShadow(input2);
+					mainLightShadowIndex = index;
+				}
+				sRGBAfloat shadowOutputTemp = mainLightShadow;
 				output.R += shadowOutputTemp.R * step * params->volumetricLightIntensity[0]
 										* params->mainLightColour.R / 65536.0;
 				output.G += shadowOutputTemp.G * step * params->volumetricLightIntensity[0]
@@ -458,7 +557,13 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 					double distanceLight = lightVectorTemp.Length();
 					double distanceLight2 = distanceLight * distanceLight;
 					lightVectorTemp.Normalize();
-					double lightShadow = AuxShadow(input2, distanceLight, lightVectorTemp);
+					if (auxLightShadowIndex[i - 1] != index
+							&& !(reuseShadows && auxLightShadowIndex[i - 1] >= 0))
+					{
+						auxLightShadow[i - 1] = AuxShadow(input2, distanceLight, lightVectorTemp);
+						auxLightShadowIndex[i - 1] = index;
+					}
+					double lightShadow = auxLightShadow[i - 1];
 					output.R += lightShadow * light->colour.R / 65536.0 * params->volumetricLightIntensity[i]
 											* step / distanceLight2;
 					output.G += lightShadow * light->colour.G / 65536.0 * params->volumetricLightIntensity[i]
@@ -517,7 +622,7 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 		// iter fog
 		if (params->iterFogEnabled)
 		{
-			int L = input.stepBuff[index].iters;
+			int L = input.stepBuff->iters[index];
 			double opacity =
 				IterOpacity(step, L, params->N, params->iterFogOpacityTrim, params->iterFogOpacity);
 
@@ -552,7 +657,13 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 					{
 						if (params->mainLightEnable && params->mainLightIntensity > 0.0)
 						{
-							sRGBAfloat shadowOutputTemp = MainShadow(input2);
+							if (mainLightShadowIndex != index
+									&& !(reuseShadows && mainLightShadowIndex >= 0))
+							{
+								mainLightShadow = MainShadow(input2);
+								mainLightShadowIndex = index;
+							}
+							sRGBAfloat shadowOutputTemp = mainLightShadow;
 							newColour.R += shadowOutputTemp.R * params->mainLightColour.R / 65536.0
 														 * params->mainLightIntensity;
 							newColour.G += shadowOutputTemp.G * params->mainLightColour.G / 65536.0
@@ -571,7 +682,13 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 							double distanceLight = lightVectorTemp.Length();
 							double distanceLight2 = distanceLight * distanceLight;
 							lightVectorTemp.Normalize();
-							double lightShadow = AuxShadow(input2, distanceLight, lightVectorTemp);
+							if (auxLightShadowIndex[i - 1] != index
+									&& !(reuseShadows && auxLightShadowIndex[i - 1] >= 0))
+							{
+								auxLightShadow[i - 1] = AuxShadow(input2, distanceLight, lightVectorTemp);
+								auxLightShadowIndex[i - 1] = index;
+							}
+							double lightShadow = auxLightShadow[i - 1];
 							double intensity = light->intensity * 100.0;
 							newColour.R += lightShadow * light->colour.R / 65536.0 / distanceLight2 * intensity;
 							newColour.G += lightShadow * light->colour.G / 65536.0 / distanceLight2 * intensity;
@@ -610,8 +727,114 @@ sRGBAfloat cRenderWorker::VolumetricShader(
 	return output;
 }
 
+int cRenderWorker::VolumetricDensities(const sShaderInputData &input)
+{
+	// opacity of fog in every single step. Merging of steps in VolumetricShader() can only increase
+	// opacity, so transmittance calculated from these values is not lower than the real one
+	float transmittance = 1.0;
+	for (int index = 1; index < input.stepCount; index++)
+	{
+		double step = input.stepBuff->step[index];
+		double distance = input.stepBuff->distance[index];
+		double density = 0.0;
+
+		if (params->fogEnabled) density = min(step / params->fogVisibility, 1.0);
+
+		if (params->volFogDensity > 0.0 && params->volFogEnabled)
+		{
+			double fogReduce = params->volFogDistanceFactor;
+			double densityTemp = (step * fogReduce) / (distance * distance + fogReduce * fogReduce);
+			double fogDensity =
+				0.3 * params->volFogDensity * densityTemp / (1.0 + params->volFogDensity * densityTemp);
+			density = 1.0 - (1.0 - density) * (1.0 - min(fogDensity, 1.0));
+		}
+
+		if (params->iterFogEnabled)
+		{
+			double opacity = IterOpacity(step, input.stepBuff->iters[index], params->N,
+				params->iterFogOpacityTrim, params->iterFogOpacity);
+			density = 1.0 - (1.0 - density) * (1.0 - min(opacity, 1.0));
+		}
+
+		// limited to allow division in VolumetricShader()
+		volumetricDensity[index] = min(density, 0.999);
+		transmittance *= 1.0 - density;
+
+		// nothing behind this step is visible
+		if (transmittance < VOLUMETRIC_MIN_TRANSMITTANCE) return index;
+	}
+	return input.stepCount - 1;
+}
+
+#define SHADER_VARIANT(features, name) \
+	{ \
+		features, name, &cRenderWorker::ObjectShaderVariant<features>, \
+			&cRenderWorker::VolumetricShaderVariant<features> \
+	}
+
+// the most common combinations of shader features. The last one is generic
+const cRenderWorker::sShaderVariant cRenderWorker::shaderVariants[] = {
+	SHADER_VARIANT(shaderFeatureMainLight | shaderFeatureShadow, "main light"),
+	SHADER_VARIANT(shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureAO, "main light, AO"),
+	SHADER_VARIANT(shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureVolumetric,
+		"main light, volumetric"),
+	SHADER_VARIANT(shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureAuxLights,
+		"main light, aux lights"),
+	SHADER_VARIANT(
+		shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureAO | shaderFeatureVolumetric,
+		"main light, AO, volumetric"),
+	SHADER_VARIANT(
+		shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureAO | shaderFeatureEnvMapping,
+		"main light, AO, env mapping"),
+	SHADER_VARIANT(shaderFeatureMainLight | shaderFeatureShadow | shaderFeatureAO
+									 | shaderFeatureAuxLights | shaderFeatureVolumetric,
+		"main light, AO, aux lights, volumetric"),
+	SHADER_VARIANT(shaderFeatureAll, "generic")};
+
+const int cRenderWorker::numberOfShaderVariants =
+	sizeof(cRenderWorker::shaderVariants) / sizeof(cRenderWorker::sShaderVariant);
+
+int cRenderWorker::SelectShaderVariant(const cParamRender *params, const sRenderData *data)
+{
+	// collect features used by settings
+	int features = 0;
+	if (params->mainLightEnable) features |= shaderFeatureMainLight;
+	if (params->shadow && params->mainLightEnable) features |= shaderFeatureShadow;
+	if (params->ambientOcclusionEnabled) features |= shaderFeatureAO;
+	if (params->envMappingEnable) features |= shaderFeatureEnvMapping;
+	if (data->lights.IsAnyLightEnabled()) features |= shaderFeatureAuxLights;
+	if (params->fakeLightsEnabled) features |= shaderFeatureFakeLights;
+	if (VolumetricEffectsEnabled(params, data)) features |= shaderFeatureVolumetric;
+
+	for (int i = 0; i < numberOfShaderVariants; i++)
+	{
+		if ((shaderVariants[i].features & features) == features) return i;
+	}
+	return numberOfShaderVariants - 1;
+}
+
+QString cRenderWorker::GetShaderVariantName(int variant)
+{
+	return QString(shaderVariants[variant].name);
+}
+
+sRGBAfloat cRenderWorker::ObjectShader(
+	const sShaderInputData &input, sRGBAfloat *surfaceColour, sRGBAfloat *specularOut)
+{
+	cStageScope stage(&threadData->stageTimer, renderStageShading);
+	return (this->*shaderVariant->objectShader)(input, surfaceColour, specularOut);
+}
+
+sRGBAfloat cRenderWorker::VolumetricShader(
+	const sShaderInputData &input, sRGBAfloat oldPixel, sRGBAfloat *opacityOut)
+{
+	cStageScope stage(&threadData->stageTimer, renderStageVolumetric);
+	return (this->*shaderVariant->volumetricShader)(input, oldPixel, opacityOut);
+}
+
 sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 {
+	cStageScope stage(&threadData->stageTimer, renderStageShadows);
 	sRGBAfloat shadow(1.0, 1.0, 1.0, 1.0);
 
 	// starting point
@@ -638,7 +861,10 @@ sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 		(!params->iterFogEnabled && !params->limitsEnabled && !params->common.iterThreshMode)
 		&& softRange > 0.0;
 
-	for (double i = start; i < factor; i += dist * DEFactor)
+	// factor is still used for attenuation of penetrating lights
+	double end = ShadowRayEnd(input.point, input.lightVect, start, factor);
+
+	for (double i = start; i < end; i += dist * DEFactor)
 	{
 		point2 = input.point + input.lightVect * i;
 
@@ -653,7 +879,8 @@ sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 		sDistanceOut distanceOut;
 		sDistanceIn distanceIn(point2, dist_thresh, false);
 		dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+		CountDistance(distanceOut);
+		pixelCost.Count(distanceOut.totalIters, true);
 
 		if (bSoft)
 		{
@@ -664,6 +891,8 @@ sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 			if (params->penetratingLights) softShadow *= (factor - i) / factor;
 			if (softShadow < 0) softShadow = 0;
 			if (softShadow > maxSoft) maxSoft = softShadow;
+			// soft shadow can't be darker
+			if (maxSoft > 1.0 - SHADOW_MIN_LIGHT) break;
 		}
 
 		if (params->iterFogEnabled)
@@ -677,7 +906,7 @@ sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 		}
 		shadowTemp -= opacity * (factor - i) / factor;
 
-		if (dist < dist_thresh || shadowTemp < 0.0)
+		if (dist < dist_thresh || shadowTemp < SHADOW_MIN_LIGHT)
 		{
 			shadowTemp -= (factor - i) / factor;
 			if (!params->penetratingLights) shadowTemp = 0.0;
@@ -702,6 +931,7 @@ sRGBAfloat cRenderWorker::MainShadow(const sShaderInputData &input)
 
 sRGBAfloat cRenderWorker::FastAmbientOcclusion(const sShaderInputData &input)
 {
+	cStageScope stage(&threadData->stageTimer, renderStageAmbientOcclusion);
 	// reference Iñigo Quilez –iq/rgba:
 	// http://www.iquilezles.org/www/material/nvscene2008/rwwtt.pdf
 	double delta = input.distThresh;
@@ -718,7 +948,8 @@ sRGBAfloat cRenderWorker::FastAmbientOcclusion(const sShaderInputData &input)
 		double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
 		if (dist > lastDist * 2) dist = lastDist * 2.0;
 		lastDist = dist;
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+		CountDistance(distanceOut);
+		pixelCost.Count(distanceOut.totalIters, true);
 		aoTemp +=
 			1.0 / pow(2.0, i) * (scan - params->ambientOcclusionFastTune * dist) / input.distThresh;
 	}
@@ -730,6 +961,7 @@ sRGBAfloat cRenderWorker::FastAmbientOcclusion(const sShaderInputData &input)
 
 sRGBAfloat cRenderWorker::AmbientOcclusion(const sShaderInputData &input)
 {
+	cStageScope stage(&threadData->stageTimer, renderStageAmbientOcclusion);
 	sRGBAfloat AO(0, 0, 0, 1.0);
 
 	double start_dist = input.delta;
@@ -752,7 +984,8 @@ sRGBAfloat cRenderWorker::AmbientOcclusion(const sShaderInputData &input)
 			sDistanceOut distanceOut;
 			sDistanceIn distanceIn(point2, input.distThresh, false);
 			dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
-			data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+			CountDistance(distanceOut);
+			pixelCost.Count(distanceOut.totalIters, true);
 
 			if (params->iterFogEnabled)
 			{
@@ -796,6 +1029,7 @@ sRGBAfloat cRenderWorker::AmbientOcclusion(const sShaderInputData &input)
 
 CVector3 cRenderWorker::CalculateNormals(const sShaderInputData &input)
 {
+	cStageScope stage(&threadData->stageTimer, renderStageNormals);
 	CVector3 normal(0.0, 0.0, 0.0);
 	// calculating normal vector based on distance estimation (gradient of distance function)
 	if (!params->slowShading)
@@ -803,36 +1037,62 @@ CVector3 cRenderWorker::CalculateNormals(const sShaderInputData &input)
 		double delta = input.delta * params->smoothness;
 		if (params->interiorMode) delta = input.distThresh * 0.2 * params->smoothness;
 
-		double sx1, sx2, sy1, sy2, sz1, sz2;
-		sDistanceOut distanceOut;
+		CVector3 points[6];
+		CVector3 pointsLow[6];
+		double detailSizes[6];
+		double distances[6];
+		sDistanceOut distanceOuts[6];
+
+		// gradient from 4 samples in vertices of tetrahedron: sum of vertex * distance(vertex)
+		const CVector3 vertices[4] = {CVector3(1.0, -1.0, -1.0), CVector3(-1.0, -1.0, 1.0),
+			CVector3(-1.0, 1.0, -1.0), CVector3(1.0, 1.0, 1.0)};
+		// central differences along axes
+		const CVector3 deltas[6] = {CVector3(delta, 0.0, 0.0), CVector3(-delta, 0.0, 0.0),
+			CVector3(0.0, delta, 0.0), CVector3(0.0, -delta, 0.0), CVector3(0.0, 0.0, delta),
+			CVector3(0.0, 0.0, -delta)};
+
+		int numberOfTaps = params->tetrahedralNormals ? 4 : 6;
+		for (int i = 0; i < numberOfTaps; i++)
+		{
+			CVector3 offset = params->tetrahedralNormals ? vertices[i] * delta : deltas[i];
+			points[i] = input.point + offset;
+			if (params->doubleDoublePrecision)
+				pointsLow[i] = DDSumResidual(input.point, offset, points[i]);
+			detailSizes[i] = input.distThresh;
+		}
 
-		CVector3 deltax(delta, 0.0, 0.0);
-		sDistanceIn distanceIn1(input.point + deltax, input.distThresh, true);
-		sx1 = CalculateDistance(*params, *fractal, distanceIn1, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-		sDistanceIn distanceIn2(input.point - deltax, input.distThresh, true);
-		sx2 = CalculateDistance(*params, *fractal, distanceIn2, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-
-		CVector3 deltay(0.0, delta, 0.0);
-		sDistanceIn distanceIn3(input.point + deltay, input.distThresh, true);
-		sy1 = CalculateDistance(*params, *fractal, distanceIn3, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-		sDistanceIn distanceIn4(input.point - deltay, input.distThresh, true);
-		sy2 = CalculateDistance(*params, *fractal, distanceIn4, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-
-		CVector3 deltaz(0.0, 0.0, delta);
-		sDistanceIn distanceIn5(input.point + deltaz, input.distThresh, true);
-		sz1 = CalculateDistance(*params, *fractal, distanceIn5, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-		sDistanceIn distanceIn6(input.point - deltaz, input.distThresh, true);
-		sz2 = CalculateDistance(*params, *fractal, distanceIn6, &distanceOut, data);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
-
-		normal.x = sx1 - sx2;
-		normal.y = sy1 - sy2;
-		normal.z = sz1 - sz2;
+		if (params->doubleDoublePrecision)
+		{
+			// low parts of the points are used only by batched fractal computation
+			CalculateDistanceBatch(*params, *fractal, points, detailSizes, numberOfTaps, distances,
+				distanceOuts, data, true, pointsLow);
+		}
+		else
+		{
+			for (int i = 0; i < numberOfTaps; i++)
+			{
+				sDistanceIn distanceIn(points[i], detailSizes[i], true);
+				distances[i] = CalculateDistance(*params, *fractal, distanceIn, &distanceOuts[i], data);
+			}
+		}
+
+		if (params->tetrahedralNormals)
+		{
+			for (int i = 0; i < numberOfTaps; i++)
+				normal += vertices[i] * distances[i];
+		}
+		else
+		{
+			normal.x = distances[0] - distances[1];
+			normal.y = distances[2] - distances[3];
+			normal.z = distances[4] - distances[5];
+		}
+
+		for (int i = 0; i < numberOfTaps; i++)
+		{
+			CountDistance(distanceOuts[i]);
+			pixelCost.Count(distanceOuts[i].totalIters, false);
+		}
 	}
 
 	// calculating normal vector based on average value of binary central difference
@@ -854,7 +1114,8 @@ CVector3 cRenderWorker::CalculateNormals(const sShaderInputData &input)
 
 					sDistanceIn distanceIn(point3, input.distThresh, true);
 					double dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut, data);
-					data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+					CountDistance(distanceOut);
+					pixelCost.Count(distanceOut.totalIters, false);
 					normal += (point2 * dist);
 				}
 			}
@@ -922,6 +1183,33 @@ sRGBAfloat cRenderWorker::EnvMapping(const sShaderInputData &input)
 	double dot = -input.viewVector.Dot(input.normal);
 	reflect = input.normal * 2.0 * dot + input.viewVector;
 
+	sRGBfloat envColour;
+	if (data->envMapLUT)
+	{
+		sRGBAfloat colour = data->envMapLUT->Get(reflect);
+		envColour = sRGBfloat(colour.R, colour.G, colour.B);
+	}
+	else
+		envColour = EnvMapColour(data, reflect);
+
+	double reflectance = 1.0;
+	if (input.material->fresnelReflectance)
+	{
+		double n1 = 1.0;
+		double n2 = input.material->transparencyIndexOfRefraction;
+		reflectance = Reflectance(input.normal, input.viewVector, n1, n2);
+		if (reflectance < 0.0) reflectance = 0.0;
+		if (reflectance > 1.0) reflectance = 1.0;
+	}
+
+	envReflect.R = envColour.R * reflectance;
+	envReflect.G = envColour.G * reflectance;
+	envReflect.B = envColour.B * reflectance;
+	return envReflect;
+}
+
+sRGBfloat cRenderWorker::EnvMapColour(const sRenderData *data, const CVector3 &reflect)
+{
 	double alphaTexture = -reflect.GetAlpha() + M_PI;
 	double betaTexture = -reflect.GetBeta();
 	double texWidth = data->textures.envmapTexture.Width();
@@ -938,20 +1226,35 @@ sRGBAfloat cRenderWorker::EnvMapping(const sShaderInputData &input)
 	if (dtx < 0) dtx = 0;
 	if (dty < 0) dty = 0;
 
-	double reflectance = 1.0;
-	if (input.material->fresnelReflectance)
+	return data->textures.envmapTexture.Pixel(dtx, dty);
+}
+
+void cRenderWorker::FillBackgroundLUT(
+	const cParamRender *params, const sRenderData *data, cCubeLUT *lut)
+{
+	for (int face = 0; face < 6; face++)
 	{
-		double n1 = 1.0;
-		double n2 = input.material->transparencyIndexOfRefraction;
-		reflectance = Reflectance(input.normal, input.viewVector, n1, n2);
-		if (reflectance < 0.0) reflectance = 0.0;
-		if (reflectance > 1.0) reflectance = 1.0;
+		for (int y = 0; y < lut->GetSize(); y++)
+		{
+			for (int x = 0; x < lut->GetSize(); x++)
+				lut->Set(face, x, y, BackgroundColour(params, data, lut->Direction(face, x, y)));
+		}
 	}
+}
 
-	envReflect.R = data->textures.envmapTexture.Pixel(dtx, dty).R * reflectance;
-	envReflect.G = data->textures.envmapTexture.Pixel(dtx, dty).G * reflectance;
-	envReflect.B = data->textures.envmapTexture.Pixel(dtx, dty).B * reflectance;
-	return envReflect;
+void cRenderWorker::FillEnvMapLUT(const sRenderData *data, cCubeLUT *lut)
+{
+	for (int face = 0; face < 6; face++)
+	{
+		for (int y = 0; y < lut->GetSize(); y++)
+		{
+			for (int x = 0; x < lut->GetSize(); x++)
+			{
+				sRGBfloat colour = EnvMapColour(data, lut->Direction(face, x, y));
+				lut->Set(face, x, y, sRGBAfloat(colour.R, colour.G, colour.B, 1.0));
+			}
+		}
+	}
 }
 
 sRGBAfloat cRenderWorker::SurfaceColour(const sShaderInputData &input)
@@ -996,7 +1299,7 @@ sRGBAfloat cRenderWorker::SurfaceColour(const sShaderInputData &input)
 	{
 		case fractal::objFractal:
 		{
-			sRGB colour(256, 256, 256);
+			sRGBfloat colour(1.0f, 1.0f, 1.0f);
 			if (input.material->useColorsFromPalette)
 			{
 				int formulaIndex = input.objectId;
@@ -1013,11 +1316,21 @@ sRGBAfloat cRenderWorker::SurfaceColour(const sShaderInputData &input)
 					tempPoint *= params->formulaScale[formulaIndex];
 				}
 
-				sFractalIn fractIn(tempPoint, 0, params->N * 10, params->common, formulaIndex,
-					input.material->fractalColoring);
-				sFractalOut fractOut;
-				Compute<fractal::calcModeColouring>(*fractal, fractIn, &fractOut);
-				int nrCol = floor(fractOut.colorIndex);
+				double colorIndex;
+				if (input.fractalDataValid)
+				{
+					// already calculated at the end of ray-marching
+					colorIndex = input.colorIndex;
+				}
+				else
+				{
+					sFractalIn fractIn(tempPoint, 0, params->N * 10, params->common, formulaIndex,
+						input.material->fractalColoring);
+					sFractalOut fractOut;
+					Compute<fractal::calcModeColouring>(*fractal, fractIn, &fractOut);
+					colorIndex = fractOut.colorIndex;
+				}
+				int nrCol = floor(colorIndex);
 				nrCol = abs(nrCol) % (248 * 256);
 
 				int color_number;
@@ -1031,18 +1344,18 @@ sRGBAfloat cRenderWorker::SurfaceColour(const sShaderInputData &input)
 						(int)(nrCol * input.material->coloring_speed + 256 * input.material->paletteOffset)
 						% 65536;
 				}
-				colour = input.material->palette.IndexToColour(color_number);
+				colour = input.material->palette.IndexToColourFloat(color_number);
 			}
 			else
 			{
-				colour.R = input.material->color.R / 256.0;
-				colour.G = input.material->color.G / 256.0;
-				colour.B = input.material->color.B / 256.0;
+				colour.R = input.material->color.R / 65536.0f;
+				colour.G = input.material->color.G / 65536.0f;
+				colour.B = input.material->color.B / 65536.0f;
 			}
 
-			out.R = colour.R / 256.0;
-			out.G = colour.G / 256.0;
-			out.B = colour.B / 256.0;
+			out.R = colour.R;
+			out.G = colour.G;
+			out.B = colour.B;
 			break;
 		}
 
@@ -1144,8 +1457,59 @@ sRGBAfloat cRenderWorker::AuxLightsShader(const sShaderInputData &input, sRGBAfl
 	if (numberOfLights < 4) numberOfLights = 4;
 	sRGBAfloat shadeAuxSum;
 	sRGBAfloat specularAuxSum;
-	for (int i = 0; i < numberOfLights; i++)
+
+	// only lights from grid cell of the point can give noticeable contribution
+	const int *cellLights = NULL;
+	int count = numberOfLights;
+	if (data->lightGrid) count = data->lightGrid->GetLights(input.point, &cellLights);
+
+	int samples = params->auxLightStochasticSamples;
+	if (samples > 0 && count > samples)
 	{
+		// lights are chosen randomly with probability proportional to intensity / distance^2
+		auxLightCandidates.clear();
+		auxLightWeights.clear();
+		double totalWeight = 0.0;
+		for (int c = 0; c < count; c++)
+		{
+			int i = cellLights ? cellLights[c] : c;
+			const sLight *light = data->lights.GetLight(i);
+			if (!light->enabled || light->intensity <= 0.0) continue;
+			double distance2 = (light->position - input.point).Dot(light->position - input.point);
+			totalWeight += light->intensity / max(distance2, 1e-20);
+			auxLightCandidates.append(i);
+			auxLightWeights.append(totalWeight);
+		}
+
+		if (totalWeight > 0.0)
+		{
+			for (int s = 0; s < samples; s++)
+			{
+				double random = sampler.Random() * totalWeight;
+				int c = std::upper_bound(auxLightWeights.constBegin(), auxLightWeights.constEnd(), random)
+								- auxLightWeights.constBegin();
+				if (c >= auxLightCandidates.size()) c = auxLightCandidates.size() - 1;
+				double weight = auxLightWeights[c] - (c > 0 ? auxLightWeights[c - 1] : 0.0);
+				float factor = totalWeight / (weight * samples);
+
+				const sLight *light = data->lights.GetLight(auxLightCandidates[c]);
+				sRGBAfloat specularAuxOutTemp;
+				sRGBAfloat shadeAux = LightShading(input, light, numberOfLights, &specularAuxOutTemp);
+				shadeAuxSum.R += shadeAux.R * factor;
+				shadeAuxSum.G += shadeAux.G * factor;
+				shadeAuxSum.B += shadeAux.B * factor;
+				specularAuxSum.R += specularAuxOutTemp.R * factor;
+				specularAuxSum.G += specularAuxOutTemp.G * factor;
+				specularAuxSum.B += specularAuxOutTemp.B * factor;
+			}
+		}
+		*specularOut = specularAuxSum;
+		return shadeAuxSum;
+	}
+
+	for (int c = 0; c < count; c++)
+	{
+		int i = cellLights ? cellLights[c] : c;
 		const sLight *light = data->lights.GetLight(i);
 		if (i < params->auxLightNumber || light->enabled)
 		{
@@ -1166,6 +1530,7 @@ sRGBAfloat cRenderWorker::AuxLightsShader(const sShaderInputData &input, sRGBAfl
 double cRenderWorker::AuxShadow(
 	const sShaderInputData &input, double distance, CVector3 lightVector)
 {
+	cStageScope stage(&threadData->stageTimer, renderStageShadows);
 	double step = input.delta;
 	double dist = step;
 	double light = 1.0;
@@ -1176,14 +1541,18 @@ double cRenderWorker::AuxShadow(
 	double DE_factor = params->DEFactor;
 	if (params->iterFogEnabled || params->volumetricLightAnyEnabled) DE_factor = 1.0;
 
-	for (double i = input.delta; i < distance; i += dist * DE_factor)
+	// distance is still used for attenuation of penetrating lights
+	double end = ShadowRayEnd(input.point, lightVector, input.delta, distance);
+
+	for (double i = input.delta; i < end; i += dist * DE_factor)
 	{
 		CVector3 point2 = input.point + lightVector * i;
 
 		sDistanceOut distanceOut;
 		sDistanceIn distanceIn(point2, input.distThresh, false);
 		dist = CalculateDistance(*params, *fractal, distanceIn, &distanceOut);
-		data->statistics.totalNumberOfIterations += distanceOut.totalIters;
+		CountDistance(distanceOut);
+		pixelCost.Count(distanceOut.totalIters, true);
 
 		if (params->iterFogEnabled)
 		{
@@ -1204,7 +1573,7 @@ double cRenderWorker::AuxShadow(
 		else
 			dist_thresh = input.distThresh;
 
-		if (dist < dist_thresh || shadowTemp < 0.0)
+		if (dist < dist_thresh || shadowTemp < SHADOW_MIN_LIGHT)
 		{
 			if (params->penetratingLights)
 			{
@@ -1241,28 +1610,22 @@ sRGBAfloat cRenderWorker::FakeLights(const sShaderInputData &input, sRGBAfloat *
 	double delta = input.distThresh * params->smoothness;
 
 	sFractalIn fractIn(input.point, params->minN, params->N, params->common, -1);
-	sFractalOut fractOut;
-	Compute<fractal::calcModeOrbitTrap>(*fractal, fractIn, &fractOut);
-	double rr = fractOut.orbitTrapR;
+
+	// orbit trap of the point and of points shifted along axes are calculated in one batch. Orbit
+	// trap of central point is reused from the primary hit if it was calculated there
+	CVector3 points[4] = {input.point, input.point + CVector3(delta, 0.0, 0.0),
+		input.point + CVector3(0.0, delta, 0.0), input.point + CVector3(0.0, 0.0, delta)};
+	sFractalOut fractOuts[4];
+	int first = input.fractalDataValid ? 1 : 0;
+	ComputeBatch<fractal::calcModeOrbitTrap>(
+		*fractal, fractIn, points + first, 4 - first, fractOuts + first);
+	double rr = input.fractalDataValid ? input.orbitTrapR : fractOuts[0].orbitTrapR;
 
 	double fakeLight = params->fakeLightsIntensity / rr;
 	double r = 1.0 / (rr + 1e-30);
-
-	CVector3 deltax(delta, 0.0, 0.0);
-	CVector3 deltay(0.0, delta, 0.0);
-	CVector3 deltaz(0.0, 0.0, delta);
-
-	fractIn.point = input.point + deltax;
-	Compute<fractal::calcModeOrbitTrap>(*fractal, fractIn, &fractOut);
-	double rx = 1.0 / (fractOut.orbitTrapR + 1e-30);
-
-	fractIn.point = input.point + deltay;
-	Compute<fractal::calcModeOrbitTrap>(*fractal, fractIn, &fractOut);
-	double ry = 1.0 / (fractOut.orbitTrapR + 1e-30);
-
-	fractIn.point = input.point + deltaz;
-	Compute<fractal::calcModeOrbitTrap>(*fractal, fractIn, &fractOut);
-	double rz = 1.0 / (fractOut.orbitTrapR + 1e-30);
+	double rx = 1.0 / (fractOuts[1].orbitTrapR + 1e-30);
+	double ry = 1.0 / (fractOuts[2].orbitTrapR + 1e-30);
+	double rz = 1.0 / (fractOuts[3].orbitTrapR + 1e-30);
 
 	CVector3 fakeLightNormal;
 	fakeLightNormal.x = r - rx;
@@ -1302,36 +1665,64 @@ sRGBAfloat cRenderWorker::FakeLights(const sShaderInputData &input, sRGBAfloat *
 	return fakeLights;
 }
 
-sRGBfloat cRenderWorker::TextureShader(
-	const sShaderInputData &input, texture::enumTextureSelection texSelect, cMaterial *mat) const
+cRenderWorker::sTextureFootprint cRenderWorker::TextureFootprint(
+	const sShaderInputData &input) const
 {
-	cObjectData objectData = data->objectData[input.objectId];
-	double texturePixelSize = 1.0;
-	CVector3 textureVectorX, textureVectorY;
-	CVector2<double> texPoint =
-		TextureMapping(input.point, input.normal, objectData, mat, &textureVectorX, &textureVectorY)
-		+ CVector2<double>(0.5, 0.5);
+	const cObjectData &objectData = data->objectData[input.objectId];
+	cMaterial *mat = input.material;
+	sTextureFootprint footprint;
+	footprint.point = TextureMapping(input.point, input.normal, objectData, mat,
+											&footprint.vectorX, &footprint.vectorY)
+										+ CVector2<double>(0.5, 0.5);
 
-	// mipmapping - calculation of texture pixel size
+	// mipmapping - texture distance to neighbouring pixels
 	double delta = CalcDelta(input.point);
-	double deltaTexX =
-		((TextureMapping(input.point + textureVectorX * delta, input.normal, objectData, mat)
+	footprint.deltaX =
+		((TextureMapping(input.point + footprint.vectorX * delta, input.normal, objectData, mat)
 			 + CVector2<double>(0.5, 0.5))
-			- texPoint)
+			- footprint.point)
 			.Length();
-	double deltaTexY =
-		((TextureMapping(input.point + textureVectorY * delta, input.normal, objectData, mat)
+	footprint.deltaY =
+		((TextureMapping(input.point + footprint.vectorY * delta, input.normal, objectData, mat)
 			 + CVector2<double>(0.5, 0.5))
-			- texPoint)
+			- footprint.point)
 			.Length();
 
-	if (deltaTexX > 0.5) deltaTexX = 1.0 - deltaTexX;
-	if (deltaTexY > 0.5) deltaTexY = 1.0 - deltaTexY;
-
+	// texture coordinates could wrap around between pixels
+	double deltaTexX = footprint.deltaX > 0.5 ? 1.0 - footprint.deltaX : footprint.deltaX;
+	double deltaTexY = footprint.deltaY > 0.5 ? 1.0 - footprint.deltaY : footprint.deltaY;
 	deltaTexX = fabs(deltaTexX) / fabs(input.viewVector.Dot(input.normal));
 	deltaTexY = fabs(deltaTexY) / fabs(input.viewVector.Dot(input.normal));
+	footprint.pixelSize = 1.0 / max(deltaTexX, deltaTexY);
+	return footprint;
+}
+
+void cRenderWorker::MaterialTexturesShader(
+	sShaderInputData *input, const sTextureFootprint &footprint) const
+{
+	const cMaterial *mat = input->material;
+
+	if (mat->colorTexture.IsLoaded())
+		input->texColor = TextureShader(*input, footprint, texture::texColor);
+	else
+		input->texColor = sRGBfloat(1.0, 1.0, 1.0);
+
+	if (mat->luminosityTexture.IsLoaded())
+		input->texLuminosity = TextureShader(*input, footprint, texture::texLuminosity);
+	else
+		input->texLuminosity = sRGBfloat(0.0, 0.0, 0.0);
+
+	if (mat->diffusionTexture.IsLoaded())
+		input->texDiffuse = TextureShader(*input, footprint, texture::texDiffuse);
+	else
+		input->texDiffuse = sRGBfloat(1.0, 1.0, 1.0);
+}
 
-	texturePixelSize = 1.0 / max(deltaTexX, deltaTexY);
+sRGBfloat cRenderWorker::TextureShader(const sShaderInputData &input,
+	const sTextureFootprint &footprint, texture::enumTextureSelection texSelect) const
+{
+	const CVector2<double> &texPoint = footprint.point;
+	double texturePixelSize = footprint.pixelSize;
 
 	sRGBfloat tex;
 	switch (texSelect)
@@ -1361,30 +1752,17 @@ sRGBfloat cRenderWorker::TextureShader(
 	return sRGBfloat(tex.R, tex.G, tex.B);
 }
 
-CVector3 cRenderWorker::NormalMapShader(const sShaderInputData &input)
+CVector3 cRenderWorker::NormalMapShader(
+	const sShaderInputData &input, const sTextureFootprint &footprint)
 {
-	cObjectData objectData = data->objectData[input.objectId];
-	CVector3 texX, texY;
-	double texturePixelSize = 1.0;
-	CVector2<double> texPoint =
-		TextureMapping(input.point, input.normal, objectData, input.material, &texX, &texY)
-		+ CVector2<double>(0.5, 0.5);
+	const CVector3 &texX = footprint.vectorX;
+	const CVector3 &texY = footprint.vectorY;
+	const CVector2<double> &texPoint = footprint.point;
 
 	// mipmapping - calculation of texture pixel size
-	double delta = CalcDelta(input.point);
-	double deltaTexX =
-		((TextureMapping(input.point + texX * delta, input.normal, objectData, input.material)
-			 + CVector2<double>(0.5, 0.5))
-			- texPoint)
-			.Length();
-	double deltaTexY =
-		((TextureMapping(input.point + texY * delta, input.normal, objectData, input.material)
-			 + CVector2<double>(0.5, 0.5))
-			- texPoint)
-			.Length();
-	deltaTexX = fabs(deltaTexX) / fabs(input.viewVector.Dot(input.normal));
-	deltaTexY = fabs(deltaTexY) / fabs(input.viewVector.Dot(input.normal));
-	texturePixelSize = 1.0 / max(deltaTexX, deltaTexY);
+	double deltaTexX = fabs(footprint.deltaX) / fabs(input.viewVector.Dot(input.normal));
+	double deltaTexY = fabs(footprint.deltaY) / fabs(input.viewVector.Dot(input.normal));
+	double texturePixelSize = 1.0 / max(deltaTexX, deltaTexY);
 
 	CVector3 n = input.normal;
 	// tangent vectors:
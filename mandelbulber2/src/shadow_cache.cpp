@@ -0,0 +1,139 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cShadowCache class - world-space cache of main light shadows
+ */
+
+#include "shadow_cache.hpp"
+
+#include <cmath>
+
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+#include "settings.hpp"
+
+uint qHash(const cShadowCache::sCellKey &key, uint seed)
+{
+	quint64 hash = (quint64)key.x * 73856093ULL ^ (quint64)key.y * 19349663ULL
+								 ^ (quint64)key.z * 83492791ULL ^ (quint64)key.level * 2654435761ULL;
+	return (uint)(hash ^ (hash >> 32)) ^ seed;
+}
+
+cShadowCache::cShadowCache()
+{
+	shards = new sShard[SHADOW_CACHE_SHARDS];
+}
+
+cShadowCache::~cShadowCache()
+{
+	delete[] shards;
+}
+
+void cShadowCache::PrepareFrame(const QString &sceneHash)
+{
+	if (sceneHash != lastSceneHash)
+	{
+		Clear();
+		lastSceneHash = sceneHash;
+	}
+}
+
+void cShadowCache::Clear()
+{
+	for (int i = 0; i < SHADOW_CACHE_SHARDS; i++)
+	{
+		QWriteLocker locker(&shards[i].lock);
+		shards[i].cells.clear();
+	}
+}
+
+cShadowCache::sCellKey cShadowCache::CellKey(const CVector3 &point, double delta)
+{
+	// cell is not bigger than the pixel footprint, so reused shadows don't look blocky
+	sCellKey key;
+	key.level = (int)floor(log2(delta));
+	double cellSize = ldexp(1.0, key.level);
+	key.x = (qint64)floor(point.x / cellSize);
+	key.y = (qint64)floor(point.y / cellSize);
+	key.z = (qint64)floor(point.z / cellSize);
+	return key;
+}
+
+bool cShadowCache::Get(const CVector3 &point, double delta, sRGBAfloat *shadow) const
+{
+	sCellKey key = CellKey(point, delta);
+	const sShard &shard = shards[qHash(key, 0) % SHADOW_CACHE_SHARDS];
+
+	QReadLocker locker(&shard.lock);
+	QHash<sCellKey, sRGBAfloat>::const_iterator it = shard.cells.constFind(key);
+	if (it == shard.cells.constEnd()) return false;
+	*shadow = it.value();
+	return true;
+}
+
+void cShadowCache::Set(const CVector3 &point, double delta, const sRGBAfloat &shadow)
+{
+	sCellKey key = CellKey(point, delta);
+	sShard &shard = shards[qHash(key, 0) % SHADOW_CACHE_SHARDS];
+
+	QWriteLocker locker(&shard.lock);
+	if (shard.cells.size() < SHADOW_CACHE_MAX_CELLS_PER_SHARD) shard.cells.insert(key, shadow);
+}
+
+int cShadowCache::GetNumberOfCells() const
+{
+	int count = 0;
+	for (int i = 0; i < SHADOW_CACHE_SHARDS; i++)
+	{
+		QReadLocker locker(&shards[i].lock);
+		count += shards[i].cells.size();
+	}
+	return count;
+}
+
+QString cShadowCache::SceneHash(const cParameterContainer *par, const cFractalContainer *fractPar)
+{
+	// parameters of the camera are replaced by default values. When main light is relative to the
+	// camera, rotation of the camera changes the direction of light
+	cParameterContainer scene = *par;
+	scene.Set("camera", scene.GetDefault<CVector3>("camera"));
+	scene.Set("target", scene.GetDefault<CVector3>("target"));
+	scene.Set("camera_distance_to_target", scene.GetDefault<double>("camera_distance_to_target"));
+	scene.Set("fov", scene.GetDefault<double>("fov"));
+	scene.Set("frame_no", scene.GetDefault<int>("frame_no"));
+	if (!scene.Get<bool>("main_light_position_relative"))
+	{
+		scene.Set("camera_top", scene.GetDefault<CVector3>("camera_top"));
+		scene.Set("camera_rotation", scene.GetDefault<CVector3>("camera_rotation"));
+	}
+
+	return cSettings::StructuralHash(&scene, fractPar);
+}
@@ -0,0 +1,106 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cShadowCache class - world-space cache of main light shadows
+ *
+ * Shadow of main light at given point doesn't depend on the camera, so in
+ * animations where only the camera moves shadows calculated in previous
+ * frames can be reused. Hit points are quantized to cells with size close to
+ * the pixel footprint and stored in hash tables split into shards, each with
+ * own lock. When the scene differs from previous frame the cache is cleared.
+ */
+
+#ifndef MANDELBULBER2_SRC_SHADOW_CACHE_HPP_
+#define MANDELBULBER2_SRC_SHADOW_CACHE_HPP_
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+
+#include "algebra.hpp"
+#include "color_structures.hpp"
+
+// number of independently locked parts of the cache
+#define SHADOW_CACHE_SHARDS 64
+// maximum number of cells stored in one shard
+#define SHADOW_CACHE_MAX_CELLS_PER_SHARD 16384
+
+// forward declarations
+class cFractalContainer;
+class cParameterContainer;
+
+class cShadowCache
+{
+public:
+	cShadowCache();
+	~cShadowCache();
+
+	// clears stored shadows if scene is different than in previous frame
+	void PrepareFrame(const QString &sceneHash);
+	void Clear();
+
+	// returns false if there is no shadow stored for the cell of the point
+	bool Get(const CVector3 &point, double delta, sRGBAfloat *shadow) const;
+	void Set(const CVector3 &point, double delta, const sRGBAfloat &shadow);
+
+	int GetNumberOfCells() const;
+
+	// hash of all parameters which influence main light shadows (camera position is skipped)
+	static QString SceneHash(const cParameterContainer *par, const cFractalContainer *fractPar);
+
+private:
+	struct sCellKey
+	{
+		qint64 x;
+		qint64 y;
+		qint64 z;
+		int level; // size of cell is 2^level
+		bool operator==(const sCellKey &other) const
+		{
+			return x == other.x && y == other.y && z == other.z && level == other.level;
+		}
+	};
+
+	struct sShard
+	{
+		mutable QReadWriteLock lock;
+		QHash<sCellKey, sRGBAfloat> cells;
+	};
+
+	friend uint qHash(const sCellKey &key, uint seed);
+
+	static sCellKey CellKey(const CVector3 &point, double delta);
+
+	sShard *shards;
+	QString lastSceneHash;
+};
+
+#endif /* MANDELBULBER2_SRC_SHADOW_CACHE_HPP_ */
@@ -0,0 +1,248 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSparseVolumeWriter - writes voxel volume as single file with sparse bricks
+ */
+
+#include "sparse_volume_writer.hpp"
+
+#include <QDataStream>
+#include <QDebug>
+#include <limits>
+
+// maximum number of slabs waiting for writing
+#define SPARSE_VOLUME_MAX_PENDING_SLABS 2
+
+cSparseVolumeWriter::cSparseVolumeWriter(int w, int h, int l, CVector3 limitMin,
+	CVector3 limitMax, bool storeDistances, double bandDistance)
+		: QObject()
+{
+	this->w = w;
+	this->h = h;
+	this->l = l;
+	this->limitMin = limitMin;
+	this->limitMax = limitMax;
+	this->storeDistances = storeDistances;
+	this->bandDistance = bandDistance;
+	layersInSlab = 0;
+	slabsInUse = 0;
+	writeError = false;
+
+	workerThread.setObjectName("VolumeWriter");
+	moveToThread(&workerThread);
+	connect(this, SIGNAL(writeRequested()), this, SLOT(slotWriteNext()), Qt::QueuedConnection);
+	workerThread.start();
+}
+
+cSparseVolumeWriter::~cSparseVolumeWriter()
+{
+	Close();
+	workerThread.quit();
+	workerThread.wait();
+}
+
+bool cSparseVolumeWriter::Open(const QString &filename)
+{
+	file.setFileName(filename);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		qCritical() << "cSparseVolumeWriter::Open(): cannot open file" << filename;
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.writeRawData("MBVOXEL1", 8);
+	stream << qint32(w) << qint32(h) << qint32(l) << qint32(SPARSE_VOLUME_BRICK_SIZE);
+	stream << qint32(storeDistances ? 1 : 0);
+	stream << limitMin.x << limitMin.y << limitMin.z;
+	stream << limitMax.x << limitMax.y << limitMax.z;
+	if (stream.status() != QDataStream::Ok)
+	{
+		qCritical() << "cSparseVolumeWriter::Open(): cannot write header to file" << filename;
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+void cSparseVolumeWriter::AddLayer(const unsigned char *mask, const float *distances)
+{
+	int layerSize = w * h;
+	if (layersInSlab == 0)
+	{
+		// voxels of missing layers at the end of the volume stay empty
+		currentSlab.mask.fill(0, layerSize * SPARSE_VOLUME_BRICK_SIZE);
+		if (storeDistances)
+			currentSlab.distances.fill(
+				std::numeric_limits<float>::max(), layerSize * SPARSE_VOLUME_BRICK_SIZE);
+	}
+
+	memcpy(currentSlab.mask.data() + layersInSlab * layerSize, mask, layerSize);
+	if (storeDistances && distances)
+	{
+		memcpy(currentSlab.distances.data() + layersInSlab * layerSize, distances,
+			layerSize * sizeof(float));
+	}
+
+	layersInSlab++;
+	if (layersInSlab == SPARSE_VOLUME_BRICK_SIZE) EnqueueSlab();
+}
+
+void cSparseVolumeWriter::EnqueueSlab()
+{
+	mutex.lock();
+	while (pendingSlabs.size() >= SPARSE_VOLUME_MAX_PENDING_SLABS)
+	{
+		stateChanged.wait(&mutex);
+	}
+	pendingSlabs.append(currentSlab);
+	slabsInUse++;
+	mutex.unlock();
+
+	currentSlab = sSlab();
+	layersInSlab = 0;
+	emit writeRequested();
+}
+
+bool cSparseVolumeWriter::Close()
+{
+	if (!file.isOpen()) return !writeError;
+
+	if (layersInSlab > 0) EnqueueSlab();
+
+	mutex.lock();
+	while (slabsInUse > 0)
+	{
+		stateChanged.wait(&mutex);
+	}
+	mutex.unlock();
+
+	file.close();
+	return !writeError;
+}
+
+void cSparseVolumeWriter::slotWriteNext()
+{
+	mutex.lock();
+	if (pendingSlabs.isEmpty())
+	{
+		mutex.unlock();
+		return;
+	}
+	sSlab slab = pendingSlabs.takeFirst();
+	stateChanged.wakeAll();
+	mutex.unlock();
+
+	QByteArray block = qCompress(EncodeSlab(slab));
+	QByteArray blockSize;
+	QDataStream sizeStream(&blockSize, QIODevice::WriteOnly);
+	sizeStream.setByteOrder(QDataStream::LittleEndian);
+	sizeStream << qint32(block.size());
+
+	bool ok = file.write(blockSize) == blockSize.size() && file.write(block) == block.size();
+	if (!ok) qCritical() << "cSparseVolumeWriter: cannot write to file" << file.fileName();
+
+	mutex.lock();
+	if (!ok) writeError = true;
+	slabsInUse--;
+	stateChanged.wakeAll();
+	mutex.unlock();
+}
+
+QByteArray cSparseVolumeWriter::EncodeSlab(const sSlab &slab) const
+{
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+	const int size = SPARSE_VOLUME_BRICK_SIZE;
+	const int voxelsInBrick = size * size * size;
+	int bricksX = (w + size - 1) / size;
+	int bricksY = (h + size - 1) / size;
+
+	// index of voxel in slab or -1 for padding
+	QVector<int> indices(voxelsInBrick);
+
+	for (int by = 0; by < bricksY; by++)
+	{
+		for (int bx = 0; bx < bricksX; bx++)
+		{
+			int inside = 0;
+			bool nearSurface = false;
+			for (int i = 0; i < voxelsInBrick; i++)
+			{
+				int x = bx * size + i % size;
+				int y = by * size + (i / size) % size;
+				int z = i / (size * size);
+				indices[i] = (x < w && y < h) ? (z * h + y) * w + x : -1;
+				if (indices[i] < 0) continue;
+
+				if (slab.mask[indices[i]]) inside++;
+				if (storeDistances && slab.distances[indices[i]] <= bandDistance) nearSurface = true;
+			}
+
+			if (inside == voxelsInBrick)
+			{
+				stream << quint16(bx) << quint16(by) << quint8(1);
+			}
+			else if (storeDistances)
+			{
+				if (inside == 0 && !nearSurface) continue;
+
+				stream << quint16(bx) << quint16(by) << quint8(3);
+				for (int i = 0; i < voxelsInBrick; i++)
+				{
+					if (indices[i] >= 0)
+						stream << slab.distances[indices[i]];
+					else
+						stream << std::numeric_limits<float>::max();
+				}
+			}
+			else if (inside > 0)
+			{
+				stream << quint16(bx) << quint16(by) << quint8(2);
+				for (int i = 0; i < voxelsInBrick; i += 8)
+				{
+					quint8 bits = 0;
+					for (int bit = 0; bit < 8; bit++)
+					{
+						int index = indices[i + bit];
+						if (index >= 0 && slab.mask[index]) bits |= 1 << bit;
+					}
+					stream << bits;
+				}
+			}
+		}
+	}
+	return data;
+}
@@ -0,0 +1,121 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cSparseVolumeWriter - writes voxel volume as single file with sparse bricks
+ *
+ * Layers are collected into slabs of SPARSE_VOLUME_BRICK_SIZE layers which are divided
+ * into cubic bricks. Empty bricks are not stored, completely filled bricks are stored
+ * only as a flag. Slabs are compressed and written by separate thread, so calculation
+ * of next layers doesn't wait for the disk.
+ *
+ * File format (little endian):
+ *   header: char[8] "MBVOXEL1", qint32 width, height, depth, brick size, flags
+ *     (bit 0 - distances are stored), double limitMin x, y, z, limitMax x, y, z
+ *   every slab: qint32 size of compressed block, block compressed with qCompress()
+ *     (big endian quint32 of uncompressed size followed by zlib stream)
+ *   block contains brick records: quint16 brick x, quint16 brick y, quint8 type, data
+ *     type 1 - all voxels are inside, no data
+ *     type 2 - mask of voxels, one bit per voxel, x changes fastest
+ *     type 3 - distances of voxels as floats, x changes fastest
+ *   bricks at the end of volume are padded with empty voxels
+ */
+
+
+#ifndef MANDELBULBER2_SRC_SPARSE_VOLUME_WRITER_HPP_
+#define MANDELBULBER2_SRC_SPARSE_VOLUME_WRITER_HPP_
+
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "algebra.hpp"
+
+#define SPARSE_VOLUME_BRICK_SIZE 8
+
+class cSparseVolumeWriter : public QObject
+{
+	Q_OBJECT
+
+public:
+	// with storeDistances bricks are stored if any voxel is closer to the surface than bandDistance
+	cSparseVolumeWriter(int w, int h, int l, CVector3 limitMin, CVector3 limitMax,
+		bool storeDistances, double bandDistance);
+	~cSparseVolumeWriter();
+
+	// creates file and writes header
+	bool Open(const QString &filename);
+
+	// adds next layer. mask has w * h bytes (non zero inside), distances can be NULL if they
+	// are not stored. Waits if writing is too slow
+	void AddLayer(const unsigned char *mask, const float *distances);
+
+	// writes remaining layers, waits for the writing thread and closes file
+	bool Close();
+
+signals:
+	void writeRequested();
+
+private slots:
+	void slotWriteNext();
+
+private:
+	struct sSlab
+	{
+		QVector<unsigned char> mask;
+		QVector<float> distances;
+	};
+
+	void EnqueueSlab();
+	QByteArray EncodeSlab(const sSlab &slab) const;
+
+	int w, h, l;
+	CVector3 limitMin;
+	CVector3 limitMax;
+	bool storeDistances;
+	double bandDistance;
+
+	QFile file;
+	sSlab currentSlab;
+	int layersInSlab;
+
+	QThread workerThread;
+	QMutex mutex;
+	QWaitCondition stateChanged;
+	QList<sSlab> pendingSlabs;
+	int slabsInUse;
+	bool writeError;
+};
+
+#endif /* MANDELBULBER2_SRC_SPARSE_VOLUME_WRITER_HPP_ */
@@ -79,8 +79,21 @@ void cSSAOWorker::doWork()
 
 	params::enumPerspectiveType perspectiveType = params->perspectiveType;
 
-	double scale_factor = (double)width / (quality * quality) / 2.0;
-	double aspectRatio = (double)width / height;
+	// coordinates of the tile are calculated relative to the whole image
+	double offsetX = 0.0;
+	double offsetY = 0.0;
+	double frameWidth = width;
+	double frameHeight = height;
+	if (data->tiled)
+	{
+		offsetX = data->tileOffset.x;
+		offsetY = data->tileOffset.y;
+		frameWidth = data->fullImageSize.x;
+		frameHeight = data->fullImageSize.y;
+	}
+
+	double scale_factor = frameWidth / (quality * quality) / 2.0;
+	double aspectRatio = frameWidth / frameHeight;
 
 	if (perspectiveType == params::perspEquirectangular) aspectRatio = 2.0;
 
@@ -93,6 +106,9 @@ void cSSAOWorker::doWork()
 	int step = threadData->progressive;
 	if (step == 0) step = 1;
 
+	const QList<sDepthLevel> *depthPyramid = threadData->depthPyramid;
+	int maxLevel = depthPyramid ? depthPyramid->size() : 0;
+
 	for (int y = startLineInit; y < endLine; y += threadData->noOfThreads)
 	{
 		if (threadData->list)
@@ -125,8 +141,8 @@ void cSSAOWorker::doWork()
 				double x2, y2;
 				if (perspectiveType == params::perspFishEye)
 				{
-					x2 = M_PI * ((double)x / width - 0.5) * aspectRatio;
-					y2 = M_PI * ((double)y / height - 0.5);
+					x2 = M_PI * ((x + offsetX) / frameWidth - 0.5) * aspectRatio;
+					y2 = M_PI * ((y + offsetY) / frameHeight - 0.5);
 					double r = sqrt(x2 * x2 + y2 * y2);
 					if (r != 0.0)
 					{
@@ -136,15 +152,15 @@ void cSSAOWorker::doWork()
 				}
 				else if (perspectiveType == params::perspEquirectangular)
 				{
-					x2 = M_PI * ((double)x / width - 0.5) * aspectRatio;
-					y2 = M_PI * ((double)y / height - 0.5);
+					x2 = M_PI * ((x + offsetX) / frameWidth - 0.5) * aspectRatio;
+					y2 = M_PI * ((y + offsetY) / frameHeight - 0.5);
 					x2 = sin(fov * x2) * cos(fov * y2) * z;
 					y2 = sin(fov * y2) * z;
 				}
 				else
 				{
-					x2 = ((double)x / width - 0.5) * aspectRatio;
-					y2 = ((double)y / height - 0.5);
+					x2 = ((x + offsetX) / frameWidth - 0.5) * aspectRatio;
+					y2 = ((y + offsetY) / frameHeight - 0.5);
 					x2 = x2 * z * fov;
 					y2 = y2 * z * fov;
 				}
@@ -181,13 +197,33 @@ void cSSAOWorker::doWork()
 
 						if ((int)xx == x && (int)yy == y) continue;
 						if (xx < startX || xx > endX - 1 || yy < startLine || yy > endLine - 1) continue;
-						double z2 = image->GetPixelZBuffer((int)xx, (int)yy);
+
+						double z2;
+						// distant samples are sparse, so they are taken from coarser level of depth pyramid
+						int level = 0;
+						if (maxLevel > 0)
+						{
+							double sampleSpacing = 2.0 * r * scale_factor * rRandom;
+							while (level < maxLevel && (2 << level) <= sampleSpacing)
+								level++;
+						}
+						if (level > 0)
+						{
+							const sDepthLevel &depthLevel = depthPyramid->at(level - 1);
+							int px = ((int)xx - startX) >> level;
+							int py = ((int)yy - startLine) >> level;
+							z2 = depthLevel.depth[px + py * depthLevel.width];
+						}
+						else
+						{
+							z2 = image->GetPixelZBuffer((int)xx, (int)yy);
+						}
 
 						double xx2, yy2;
 						if (perspectiveType == params::perspFishEye)
 						{
-							xx2 = M_PI * (xx / width - 0.5) * aspectRatio;
-							yy2 = M_PI * (yy / height - 0.5);
+							xx2 = M_PI * ((xx + offsetX) / frameWidth - 0.5) * aspectRatio;
+							yy2 = M_PI * ((yy + offsetY) / frameHeight - 0.5);
 							double r2 = sqrt(xx2 * xx2 + yy2 * yy2);
 							if (r != 0.0)
 							{
@@ -197,15 +233,15 @@ void cSSAOWorker::doWork()
 						}
 						else if (perspectiveType == params::perspEquirectangular)
 						{
-							xx2 = M_PI * (xx / width - 0.5) * aspectRatio;
-							yy2 = M_PI * (yy / height - 0.5);
+							xx2 = M_PI * ((xx + offsetX) / frameWidth - 0.5) * aspectRatio;
+							yy2 = M_PI * ((yy + offsetY) / frameHeight - 0.5);
 							xx2 = sin(fov * xx2) * cos(fov * yy2) * z2;
 							yy2 = sin(fov * yy2) * z2;
 						}
 						else
 						{
-							xx2 = (xx / width - 0.5) * aspectRatio;
-							yy2 = (yy / height - 0.5);
+							xx2 = ((xx + offsetX) / frameWidth - 0.5) * aspectRatio;
+							yy2 = ((yy + offsetY) / frameHeight - 0.5);
 							xx2 = xx2 * (z2 * fov);
 							yy2 = yy2 * (z2 * fov);
 						}
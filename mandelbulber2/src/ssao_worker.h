@@ -41,6 +41,7 @@
 
 #include <QList>
 #include <QThread>
+#include <QVector>
 #include <qobject.h>
 
 #include "region.hpp"
@@ -54,6 +55,14 @@ class cSSAOWorker : public QObject
 {
 	Q_OBJECT
 public:
+	// min depth of 2^level x 2^level pixel blocks of the region (hierarchical mode)
+	struct sDepthLevel
+	{
+		int width;
+		int height;
+		QVector<float> depth;
+	};
+
 	struct sThreadData
 	{
 		int startLine;
@@ -64,6 +73,8 @@ public:
 		bool stopRequest;
 		QList<int> *list;
 		cRegion<int> region;
+		// levels 1, 2, 3... of depth pyramid. NULL if hierarchical mode is disabled
+		const QList<sDepthLevel> *depthPyramid;
 	};
 
 	cSSAOWorker(const cParamRender *_params, sThreadData *_threadData, const sRenderData *_data,
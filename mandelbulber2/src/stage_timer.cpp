@@ -0,0 +1,100 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cStageTimer class - low overhead measurement of time spent in rendering stages
+ */
+
+#include "stage_timer.hpp"
+
+#include <QObject>
+
+#include "statistics.h"
+
+cStageTimer::cStageTimer()
+{
+	Reset();
+}
+
+void cStageTimer::Reset()
+{
+	for (int i = 0; i < renderStageCount; i++)
+		ticks[i] = 0;
+	lastTicks = Ticks();
+	current = renderStageOther;
+	depth = 0;
+	wallTime = 0;
+}
+
+void cStageTimer::Start()
+{
+	current = renderStageOther;
+	depth = 0;
+	lastTicks = Ticks();
+	wallTimer.start();
+}
+
+void cStageTimer::Stop()
+{
+	Switch();
+	wallTime += wallTimer.nsecsElapsed();
+}
+
+void cStageTimer::AddTo(cStatistics *statistics)
+{
+	quint64 totalTicks = 0;
+	for (int i = 0; i < renderStageCount; i++)
+		totalTicks += ticks[i];
+
+	if (totalTicks > 0)
+	{
+		double secondsPerTick = wallTime / 1e9 / totalTicks;
+		for (int i = 0; i < renderStageCount; i++)
+			statistics->stageTimes[i] += ticks[i] * secondsPerTick;
+	}
+	Reset();
+}
+
+QString cStageTimer::StageName(int stage)
+{
+	switch (stage)
+	{
+		case renderStageOther: return QObject::tr("other");
+		case renderStagePrimaryRays: return QObject::tr("primary rays");
+		case renderStageSecondaryRays: return QObject::tr("reflections and refractions");
+		case renderStageNormals: return QObject::tr("normals");
+		case renderStageShading: return QObject::tr("surface shading");
+		case renderStageShadows: return QObject::tr("shadows");
+		case renderStageAmbientOcclusion: return QObject::tr("ambient occlusion");
+		case renderStageVolumetric: return QObject::tr("volumetric effects");
+		case renderStageBackground: return QObject::tr("background");
+		default: return QString();
+	}
+}
@@ -0,0 +1,149 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cStageTimer class - low overhead measurement of time spent in rendering stages
+ *
+ * Every rendering thread has its own timer, so no locks are needed. Time stamp
+ * counter is read only when the stage is changed and the time is charged to the
+ * current stage, so nested stages (e.g. shadows inside volumetric shader) are
+ * measured exclusively. Ticks are converted to seconds with the measured wall time
+ * of the thread, so the tick frequency doesn't need to be known.
+ */
+
+#ifndef MANDELBULBER2_SRC_STAGE_TIMER_HPP_
+#define MANDELBULBER2_SRC_STAGE_TIMER_HPP_
+
+#include <QElapsedTimer>
+#include <QString>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define STAGE_TIMER_USE_TSC
+#else
+#include <chrono>
+#endif
+
+// maximum depth of nested stages
+#define STAGE_TIMER_MAX_DEPTH 16
+
+class cStatistics;
+
+enum enumRenderStage
+{
+	renderStageOther = 0,
+	renderStagePrimaryRays = 1,
+	renderStageSecondaryRays = 2,
+	renderStageNormals = 3,
+	renderStageShading = 4,
+	renderStageShadows = 5,
+	renderStageAmbientOcclusion = 6,
+	renderStageVolumetric = 7,
+	renderStageBackground = 8,
+	renderStageCount = 9
+};
+
+class cStageTimer
+{
+public:
+	cStageTimer();
+
+	// starts measuring of one rendering pass of the thread
+	void Start();
+	// stops measuring. Elapsed wall time is split between stages
+	void Stop();
+
+	// charges elapsed time to current stage and makes given stage current
+	inline void Enter(enumRenderStage stage)
+	{
+		Switch();
+		if (depth < STAGE_TIMER_MAX_DEPTH) stack[depth] = current;
+		depth++;
+		current = stage;
+	}
+	inline void Leave()
+	{
+		Switch();
+		depth--;
+		current = depth < STAGE_TIMER_MAX_DEPTH ? stack[depth] : current;
+	}
+
+	// adds measured times (in seconds of thread time) to statistics and resets the timer
+	void AddTo(cStatistics *statistics);
+
+	static QString StageName(int stage);
+
+private:
+	static inline quint64 Ticks()
+	{
+#ifdef STAGE_TIMER_USE_TSC
+		return __rdtsc();
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	inline void Switch()
+	{
+		quint64 now = Ticks();
+		ticks[current] += now - lastTicks;
+		lastTicks = now;
+	}
+
+	void Reset();
+
+	quint64 ticks[renderStageCount];
+	quint64 lastTicks;
+	enumRenderStage current;
+	enumRenderStage stack[STAGE_TIMER_MAX_DEPTH];
+	int depth;
+	QElapsedTimer wallTimer;
+	qint64 wallTime; // nanoseconds
+};
+
+// measures the stage until end of the scope
+class cStageScope
+{
+public:
+	cStageScope(cStageTimer *_timer, enumRenderStage stage) : timer(_timer)
+	{
+		timer->Enter(stage);
+	}
+	~cStageScope() { timer->Leave(); }
+
+private:
+	cStageTimer *timer;
+};
+
+#endif /* MANDELBULBER2_SRC_STAGE_TIMER_HPP_ */
@@ -37,10 +37,26 @@
 cStatistics::cStatistics()
 {
 	totalNumberOfIterations = 0;
+	totalNumberOfPrimitiveEvaluations = 0;
+	totalNumberOfPrimitiveQueries = 0;
 	missedDE = 0;
+	numberOfRelaxationFallbacks = 0;
+	numberOfPeriodicOrbits = 0;
+	numberOfRefinementSteps = 0;
+	numberOfRefinedHits = 0;
 	numberOfRaymarchings = 0;
 	numberOfRenderedPixels = 0;
+	numberOfAntiAliasedPixels = 0;
 	time = 0.0;
+	prepassTime = 0.0;
+	mainPassTime = 0.0;
+	antiAliasingTime = 0.0;
+	postProcessingTime = 0.0;
+	ssaoTime = 0.0;
+	dofTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		stageTimes[i] = 0.0;
+	raymarchingRelaxation = 1.0;
 }
 
 cStatistics::~cStatistics()
@@ -50,10 +66,42 @@ cStatistics::~cStatistics()
 void cStatistics::Reset()
 {
 	totalNumberOfIterations = 0;
+	totalNumberOfPrimitiveEvaluations = 0;
+	totalNumberOfPrimitiveQueries = 0;
 	missedDE = 0;
+	numberOfRelaxationFallbacks = 0;
+	numberOfPeriodicOrbits = 0;
+	numberOfRefinementSteps = 0;
+	numberOfRefinedHits = 0;
 	numberOfRaymarchings = 0;
 	numberOfRenderedPixels = 0;
+	numberOfAntiAliasedPixels = 0;
 	time = 0.0;
+	prepassTime = 0.0;
+	mainPassTime = 0.0;
+	antiAliasingTime = 0.0;
+	postProcessingTime = 0.0;
+	ssaoTime = 0.0;
+	dofTime = 0.0;
+	for (int i = 0; i < renderStageCount; i++)
+		stageTimes[i] = 0.0;
 	histogramIterations.Clear();
 	histogramStepCount.Clear();
 }
+
+void cStatistics::Add(const cStatistics &source)
+{
+	totalNumberOfIterations += source.totalNumberOfIterations;
+	totalNumberOfPrimitiveEvaluations += source.totalNumberOfPrimitiveEvaluations;
+	totalNumberOfPrimitiveQueries += source.totalNumberOfPrimitiveQueries;
+	missedDE += source.missedDE;
+	numberOfRelaxationFallbacks += source.numberOfRelaxationFallbacks;
+	numberOfPeriodicOrbits += source.numberOfPeriodicOrbits;
+	numberOfRefinementSteps += source.numberOfRefinementSteps;
+	numberOfRefinedHits += source.numberOfRefinedHits;
+	numberOfRaymarchings += source.numberOfRaymarchings;
+	numberOfRenderedPixels += source.numberOfRenderedPixels;
+	numberOfAntiAliasedPixels += source.numberOfAntiAliasedPixels;
+	histogramIterations.Merge(source.histogramIterations);
+	histogramStepCount.Merge(source.histogramStepCount);
+}
@@ -36,6 +36,8 @@
 #define MANDELBULBER2_SRC_STATISTICS_H_
 
 #include "histogram.hpp"
+#include "stage_timer.hpp"
+
 class cStatistics
 {
 public:
@@ -44,11 +46,31 @@ public:
 	cHistogram histogramIterations;
 	cHistogram histogramStepCount;
 	long long totalNumberOfIterations;
+	long long totalNumberOfPrimitiveEvaluations;
+	long long totalNumberOfPrimitiveQueries;
 	int missedDE;
+	long long numberOfRelaxationFallbacks;
+	// fractal evaluations of interior points stopped by periodicity check
+	long long numberOfPeriodicOrbits;
+	long long numberOfRefinementSteps;
+	int numberOfRefinedHits;
 	int numberOfRaymarchings;
 	int numberOfRenderedPixels;
+	int numberOfAntiAliasedPixels;
 	double time;
+	// duration of rendering stages in seconds
+	double prepassTime;
+	double mainPassTime;
+	double antiAliasingTime;
+	double postProcessingTime;
+	// ... of post-processing effects
+	double ssaoTime;
+	double dofTime;
+	// time of rendering threads spent in shader stages (summed for all threads)
+	double stageTimes[renderStageCount];
+	double raymarchingRelaxation;
 	QString usedDEType;
+	QString usedShaderVariant;
 
 	double GetTotalNumberOfIterations() const { return totalNumberOfIterations; }
 	double GetNumberOfIterationsPerPixel() const
@@ -57,8 +79,21 @@ public:
 	}
 	double GetNumberOfIterationsPerSecond() const { return (double)totalNumberOfIterations / time; }
 	double GetMissedDEPercentage() const { return (double)missedDE / numberOfRaymarchings * 100.0; }
+	double GetPrimitiveEvaluationsPerStep() const
+	{
+		return totalNumberOfPrimitiveQueries > 0
+						 ? (double)totalNumberOfPrimitiveEvaluations / totalNumberOfPrimitiveQueries
+						 : 0.0;
+	}
+	double GetRefinementStepsPerHit() const
+	{
+		return numberOfRefinedHits > 0 ? (double)numberOfRefinementSteps / numberOfRefinedHits : 0.0;
+	}
 	QString GetDETypeString() const { return usedDEType; }
+	QString GetShaderVariantString() const { return usedShaderVariant; }
 	void Reset();
+	// adds counters and histograms of other statistics (collected by one rendering thread)
+	void Add(const cStatistics &source);
 };
 
 #endif /* MANDELBULBER2_SRC_STATISTICS_H_ */
@@ -44,6 +44,7 @@
 #include "../qt/my_line_edit.h"
 #include "../qt/my_spin_box.h"
 #include "fractal_list.hpp"
+#include <QEvent>
 #include <QtWidgets/QComboBox>
 #include <QtWidgets/QPlainTextEdit>
 #include "algebra.hpp"
@@ -51,663 +52,700 @@
 
 using namespace qInterface;
 
+cInterfaceBindings *cInterfaceBindings::instance = NULL;
+
+cInterfaceBindings *cInterfaceBindings::Instance()
+{
+	if (!instance) instance = new cInterfaceBindings;
+	return instance;
+}
+
 // Reading ad writing parameters from/to selected widget to/from parameters container
 void SynchronizeInterfaceWindow(QWidget *window, cParameterContainer *par, enumReadWrite mode)
 {
-	WriteLog("cInterface::SynchronizeInterface: QLineEdit", 3);
-	//----------- QLineEdit -------------------
+	cInterfaceBindings::Instance()->Synchronize(window, par, mode);
+}
+
+bool cInterfaceBindings::eventFilter(QObject *obj, QEvent *event)
+{
+	// filter is installed only on synchronized windows
+	if (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildRemoved)
+		tables.remove(static_cast<QWidget *>(obj));
+	return QObject::eventFilter(obj, event);
+}
+
+void cInterfaceBindings::slotWindowDestroyed(QObject *window)
+{
+	// window is already partially destroyed, so only the address is compared
+	QMap<QWidget *, QList<sBinding> >::iterator it = tables.begin();
+	while (it != tables.end())
+	{
+		if (static_cast<QObject *>(it.key()) == window)
+			it = tables.erase(it);
+		else
+			++it;
+	}
+}
+
+void cInterfaceBindings::Invalidate(QWidget *widget)
+{
+	QMap<QWidget *, QList<sBinding> >::iterator it = tables.begin();
+	while (it != tables.end())
+	{
+		if (it.key() == widget || it.key()->isAncestorOf(widget))
+			it = tables.erase(it);
+		else
+			++it;
+	}
+}
+
+bool cInterfaceBindings::IsTableValid(const QList<sBinding> &table)
+{
+	for (int i = 0; i < table.size(); i++)
 	{
-		QList<QLineEdit *> widgetListLineEdit = window->findChildren<QLineEdit *>();
-		QList<QLineEdit *>::iterator it;
+		if (table[i].widget.isNull()) return false;
+	}
+	return true;
+}
 
-		for (it = widgetListLineEdit.begin(); it != widgetListLineEdit.end(); ++it)
-		{
-			// qDebug() << "QLineEdit:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
+void cInterfaceBindings::AddBinding(
+	QList<sBinding> *table, QWidget *widget, enumBindingType type, const QString &parameterName)
+{
+	sBinding binding;
+	binding.widget = widget;
+	binding.wrapper = NULL;
+	binding.type = type;
+	binding.parameterName = parameterName;
+	binding.axis = 0;
+	binding.formulaSelection = false;
+
+	// vector components are named <vector name>_<axis>
+	if (type == bindLineEditVect3 || type == bindLineEditVect4 || type == bindDoubleSpinBox3
+			|| type == bindDoubleSpinBox4)
+	{
+		binding.axis = (parameterName.at(parameterName.length() - 1)).toLatin1();
+		binding.parameterName = parameterName.left(parameterName.length() - 2);
+	}
+	else if (type == bindComboBox)
+	{
+		binding.formulaSelection = parameterName.left(7) == QString("formula");
+	}
+	table->append(binding);
+}
 
-			QString name = (*it)->objectName();
-			QString className = (*it)->metaObject()->className();
+// widgets are found and their names are parsed only once
+QList<cInterfaceBindings::sBinding> cInterfaceBindings::BuildTable(QWidget *window)
+{
+	WriteLog("cInterfaceBindings::BuildTable(): " + window->objectName(), 3);
+	QList<sBinding> table;
+
+	//----------- QLineEdit -------------------
+	{
+		QList<QLineEdit *> widgetList = window->findChildren<QLineEdit *>();
+		for (int i = 0; i < widgetList.size(); i++)
+		{
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
 			if (name.length() > 1
 					&& (className == QString("QLineEdit") || className == QString("MyLineEdit")))
 			{
-				QLineEdit *lineEdit = *it;
-				// QString text = lineEdit->text();
-				// qDebug() << name << " - text: " << text << endl;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
-				// qDebug() << name << " - type: " << type << endl;
 
-				if (className == QString("MyLineEdit"))
-				{
-					MyLineEdit *mylineedit = (MyLineEdit *)*it;
-					mylineedit->AssignParameterContainer(par);
-					mylineedit->AssignParameterName(parameterName);
-				}
-
-				//----- get vectors ------------
+				enumBindingType bindingType = bindNone;
 				if (type == QString("vect3") || type == QString("logvect3"))
-				{
-					char lastChar = (parameterName.at(parameterName.length() - 1)).toLatin1();
-					QString nameVect = parameterName.left(parameterName.length() - 2);
-
-					if (mode == read)
-					{
-						double value = systemData.locale.toDouble(lineEdit->text());
-						// qDebug() << nameVect << " - " << lastChar << " axis = " << value << endl;
-						CVector3 vect = par->Get<CVector3>(nameVect);
-
-						switch (lastChar)
-						{
-							case 'x': vect.x = value; break;
-
-							case 'y': vect.y = value; break;
-
-							case 'z': vect.z = value; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): edit field " << nameVect
-													 << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						par->Set(nameVect, vect);
-					}
-					else if (mode == write)
-					{
-						CVector3 vect = par->Get<CVector3>(nameVect);
-						QString qtext;
-
-						switch (lastChar)
-						{
-							case 'x': qtext = QString("%L1").arg(vect.x, 0, 'g', 16); break;
-
-							case 'y': qtext = QString("%L1").arg(vect.y, 0, 'g', 16); break;
-
-							case 'z': qtext = QString("%L1").arg(vect.z, 0, 'g', 16); break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): edit field " << nameVect
-													 << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						lineEdit->setText(qtext);
-						lineEdit->setCursorPosition(0);
-					}
-				}
-
-				//----- get vectors 4D  ------------
-				if (type == QString("vect4"))
-				{
-					char lastChar = (parameterName.at(parameterName.length() - 1)).toLatin1();
-					QString nameVect = parameterName.left(parameterName.length() - 2);
-
-					if (mode == read)
-					{
-						double value = systemData.locale.toDouble(lineEdit->text());
-						// qDebug() << nameVect << " - " << lastChar << " axis = " << value << endl;
-						CVector4 vect = par->Get<CVector4>(nameVect);
-
-						switch (lastChar)
-						{
-							case 'x': vect.x = value; break;
-
-							case 'y': vect.y = value; break;
-
-							case 'z': vect.z = value; break;
-
-							case 'w': vect.w = value; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): edit field " << nameVect
-													 << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						par->Set(nameVect, vect);
-					}
-					else if (mode == write)
-					{
-						CVector4 vect = par->Get<CVector4>(nameVect);
-						QString qtext;
-
-						switch (lastChar)
-						{
-							case 'x': qtext = QString("%L1").arg(vect.x, 0, 'g', 16); break;
-
-							case 'y': qtext = QString("%L1").arg(vect.y, 0, 'g', 16); break;
-
-							case 'z': qtext = QString("%L1").arg(vect.z, 0, 'g', 16); break;
-
-							case 'w': qtext = QString("%L1").arg(vect.w, 0, 'g', 16); break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): edit field " << nameVect
-													 << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						lineEdit->setText(qtext);
-						lineEdit->setCursorPosition(0);
-					}
-				}
-
-				//---------- get double scalars --------
+					bindingType = bindLineEditVect3;
+				else if (type == QString("vect4"))
+					bindingType = bindLineEditVect4;
 				else if (type == QString("edit") || type == QString("logedit"))
-				{
-					if (mode == read)
-					{
-						double value = systemData.locale.toDouble(lineEdit->text());
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
-					{
-						double value = par->Get<double>(parameterName);
-						lineEdit->setText(QString("%L1").arg(value, 0, 'g', 16));
-						lineEdit->setCursorPosition(0);
-					}
-				}
-
-				//----------- get texts ------------
+					bindingType = bindLineEditDouble;
 				else if (type == QString("text"))
+					bindingType = bindLineEditText;
+
+				if (className == QString("MyLineEdit") || bindingType != bindNone)
 				{
-					if (mode == read)
-					{
-						QString value = lineEdit->text();
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
+					AddBinding(&table, widgetList[i], bindingType, parameterName);
+					if (className == QString("MyLineEdit"))
 					{
-						QString value = par->Get<QString>(parameterName);
-						lineEdit->setText(value);
+						table.last().wrapper = static_cast<MyLineEdit *>(widgetList[i]);
+						table.last().wrapperName = parameterName;
 					}
 				}
 			}
-		} // end foreach
+		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: QDoubleSpinBox", 3);
 	//------------ Double spin-box --------------
 	{
-		QList<QDoubleSpinBox *> widgetListDoubleSpinBox = window->findChildren<QDoubleSpinBox *>();
-		QList<QDoubleSpinBox *>::iterator it;
-		for (it = widgetListDoubleSpinBox.begin(); it != widgetListDoubleSpinBox.end(); ++it)
+		QList<QDoubleSpinBox *> widgetList = window->findChildren<QDoubleSpinBox *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "QDoubleSpinBox:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			QString className = (*it)->metaObject()->className();
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
 			if (name.length() > 1
 					&& (className == QString("QDoubleSpinBox") || className == QString("MyDoubleSpinBox")))
 			{
-				QDoubleSpinBox *spinbox = *it;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
 
-				if (className == QString("MyDoubleSpinBox"))
-				{
-					MyDoubleSpinBox *mydoublespinbox = (MyDoubleSpinBox *)*it;
-					mydoublespinbox->AssignParameterContainer(par);
-					mydoublespinbox->AssignParameterName(parameterName);
-				}
-
+				enumBindingType bindingType = bindNone;
 				if (type == QString("spinbox") || type == QString("spinboxd"))
-				{
-					if (mode == read)
-					{
-						double value = spinbox->value();
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
-					{
-						double value = par->Get<double>(parameterName);
-						spinbox->setValue(value);
-					}
-				}
+					bindingType = bindDoubleSpinBox;
 				else if (type == QString("spinbox3") || type == QString("spinboxd3"))
-				{
-					char lastChar = (parameterName.at(parameterName.length() - 1)).toLatin1();
-					QString nameVect = parameterName.left(parameterName.length() - 2);
-					if (mode == read)
-					{
-						double value = spinbox->value();
-						CVector3 vect = par->Get<CVector3>(nameVect);
-
-						switch (lastChar)
-						{
-							case 'x': vect.x = value; break;
-
-							case 'y': vect.y = value; break;
-
-							case 'z': vect.z = value; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): " << type << " "
-													 << nameVect << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						par->Set(nameVect, vect);
-					}
-					else if (mode == write)
-					{
-						CVector3 vect = par->Get<CVector3>(nameVect);
-						double value = 0;
-
-						switch (lastChar)
-						{
-							case 'x': value = vect.x; break;
-
-							case 'y': value = vect.y; break;
-
-							case 'z': value = vect.z; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): " << type << " "
-													 << nameVect << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						spinbox->setValue(value);
-					}
-				}
+					bindingType = bindDoubleSpinBox3;
 				else if (type == QString("spinbox4") || type == QString("spinboxd4"))
+					bindingType = bindDoubleSpinBox4;
+
+				if (className == QString("MyDoubleSpinBox") || bindingType != bindNone)
 				{
-					char lastChar = (parameterName.at(parameterName.length() - 1)).toLatin1();
-					QString nameVect = parameterName.left(parameterName.length() - 2);
-					if (mode == read)
+					AddBinding(&table, widgetList[i], bindingType, parameterName);
+					if (className == QString("MyDoubleSpinBox"))
 					{
-						double value = spinbox->value();
-						CVector4 vect = par->Get<CVector4>(nameVect);
-
-						switch (lastChar)
-						{
-							case 'x': vect.x = value; break;
-
-							case 'y': vect.y = value; break;
-
-							case 'z': vect.z = value; break;
-
-							case 'w': vect.w = value; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): " << type << " "
-													 << nameVect << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						par->Set(nameVect, vect);
-					}
-					else if (mode == write)
-					{
-						CVector4 vect = par->Get<CVector4>(nameVect);
-						double value = 0;
-
-						switch (lastChar)
-						{
-							case 'x': value = vect.x; break;
-
-							case 'y': value = vect.y; break;
-
-							case 'z': value = vect.z; break;
-
-							case 'w': value = vect.w; break;
-
-							default:
-								qWarning() << "cInterface::SynchronizeInterfaceWindow(): " << type << " "
-													 << nameVect << " has wrong axis name (is " << lastChar << ")" << endl;
-								break;
-						}
-						spinbox->setValue(value);
+						table.last().wrapper = static_cast<MyDoubleSpinBox *>(widgetList[i]);
+						table.last().wrapperName = parameterName;
 					}
 				}
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: QSpinBox", 3);
 	//------------ integer spin-box --------------
 	{
-		QList<QSpinBox *> widgetListDoubleSpinBox = window->findChildren<QSpinBox *>();
-		QList<QSpinBox *>::iterator it;
-		for (it = widgetListDoubleSpinBox.begin(); it != widgetListDoubleSpinBox.end(); ++it)
+		QList<QSpinBox *> widgetList = window->findChildren<QSpinBox *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "QDoubleSpinBox:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			QString className = (*it)->metaObject()->className();
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
 			if (name.length() > 1
 					&& (className == QString("QSpinBox") || className == QString("MySpinBox")))
 			{
-				QSpinBox *spinbox = *it;
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
 
-				if (className == QString("MySpinBox"))
-				{
-					MySpinBox *myspinbox = (MySpinBox *)*it;
-					myspinbox->AssignParameterContainer(par);
-					myspinbox->AssignParameterName(parameterName);
-				}
+				enumBindingType bindingType =
+					(type == QString("spinboxInt")) ? bindSpinBoxInt : bindNone;
 
-				if (type == QString("spinboxInt"))
+				if (className == QString("MySpinBox") || bindingType != bindNone)
 				{
-					if (mode == read)
-					{
-						int value = spinbox->value();
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
+					AddBinding(&table, widgetList[i], bindingType, parameterName);
+					if (className == QString("MySpinBox"))
 					{
-						int value = par->Get<int>(parameterName);
-						spinbox->setValue(value);
+						table.last().wrapper = static_cast<MySpinBox *>(widgetList[i]);
+						table.last().wrapperName = parameterName;
 					}
 				}
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: QCheckBox", 3);
 	// checkboxes
 	{
-		QList<QCheckBox *> widgetListDoubleSpinBox = window->findChildren<QCheckBox *>();
-		QList<QCheckBox *>::iterator it;
-		for (it = widgetListDoubleSpinBox.begin(); it != widgetListDoubleSpinBox.end(); ++it)
+		QList<QCheckBox *> widgetList = window->findChildren<QCheckBox *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "QCheckBox:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			QString className = (*it)->metaObject()->className();
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
 			if (name.length() > 1
 					&& (className == QString("QCheckBox") || className == QString("MyCheckBox")))
 			{
-				QCheckBox *checkbox = *it;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
 
-				if (className == QString("MyCheckBox"))
-				{
-					MyCheckBox *mycheckbox = (MyCheckBox *)*it;
-					mycheckbox->AssignParameterContainer(par);
-					mycheckbox->AssignParameterName(parameterName);
-				}
+				enumBindingType bindingType = (type == QString("checkBox")) ? bindCheckBox : bindNone;
 
-				if (type == QString("checkBox"))
+				if (className == QString("MyCheckBox") || bindingType != bindNone)
 				{
-					if (mode == read)
+					AddBinding(&table, widgetList[i], bindingType, parameterName);
+					if (className == QString("MyCheckBox"))
 					{
-						bool value = checkbox->isChecked();
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
-					{
-						bool value = par->Get<bool>(parameterName);
-						checkbox->setChecked(value);
+						table.last().wrapper = static_cast<MyCheckBox *>(widgetList[i]);
+						table.last().wrapperName = parameterName;
 					}
 				}
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: QGroupBox", 3);
 	// groupsBox with checkbox
 	{
-		QList<QGroupBox *> widgetListDoubleSpinBox = window->findChildren<QGroupBox *>();
-		QList<QGroupBox *>::iterator it;
-		for (it = widgetListDoubleSpinBox.begin(); it != widgetListDoubleSpinBox.end(); ++it)
+		QList<QGroupBox *> widgetList = window->findChildren<QGroupBox *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "QGroupBox:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			QString className = (*it)->metaObject()->className();
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
 			if (name.length() > 1
 					&& (className == QString("QGroupBox") || className == QString("MyGroupBox")))
 			{
-				QGroupBox *groupbox = *it;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
 
-				if (className == QString("MyGroupBox"))
-				{
-					MyGroupBox *mygroupbox = (MyGroupBox *)*it;
-					mygroupbox->AssignParameterContainer(par);
-					mygroupbox->AssignParameterName(parameterName);
-				}
+				enumBindingType bindingType = (type == QString("groupCheck")) ? bindGroupBox : bindNone;
 
-				if (type == QString("groupCheck"))
+				if (className == QString("MyGroupBox") || bindingType != bindNone)
 				{
-					if (mode == read)
-					{
-						bool value = groupbox->isChecked();
-						par->Set(parameterName, value);
-					}
-					else if (mode == write)
+					AddBinding(&table, widgetList[i], bindingType, parameterName);
+					if (className == QString("MyGroupBox"))
 					{
-						bool value = par->Get<bool>(parameterName);
-						groupbox->setChecked(value);
+						table.last().wrapper = static_cast<MyGroupBox *>(widgetList[i]);
+						table.last().wrapperName = parameterName;
 					}
 				}
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: FileSelectWidget", 3);
 	//---------- file select widgets -----------
 	{
-		QList<FileSelectWidget *> widgetListPushButton = window->findChildren<FileSelectWidget *>();
-		QList<FileSelectWidget *>::iterator it;
-		for (it = widgetListPushButton.begin(); it != widgetListPushButton.end(); ++it)
+		QList<FileSelectWidget *> widgetList = window->findChildren<FileSelectWidget *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// QString className = (*it)->metaObject()->className();
-			if (name.length() > 1 && (*it)->metaObject()->className() == QString("FileSelectWidget"))
+			QString name = widgetList[i]->objectName();
+			if (name.length() > 1
+					&& widgetList[i]->metaObject()->className() == QString("FileSelectWidget"))
 			{
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
-
-				FileSelectWidget *fileSelectWidget = *it;
-				fileSelectWidget->AssignParameterContainer(par);
-				fileSelectWidget->AssignParameterName(parameterName);
-
-				if (mode == read)
-				{
-					par->Set(parameterName, fileSelectWidget->GetPath());
-				}
-				else if (mode == write)
-				{
-					fileSelectWidget->SetPath(par->Get<QString>(parameterName));
-				}
+				AddBinding(&table, widgetList[i], bindFileSelect, parameterName);
+				table.last().wrapper = widgetList[i];
+				table.last().wrapperName = parameterName;
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: MyColorButton", 3);
 	//---------- color buttons -----------
 	{
-		QList<MyColorButton *> widgetListPushButton = window->findChildren<MyColorButton *>();
-		QList<MyColorButton *>::iterator it;
-		for (it = widgetListPushButton.begin(); it != widgetListPushButton.end(); ++it)
+		QList<MyColorButton *> widgetList = window->findChildren<MyColorButton *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// QString className = (*it)->metaObject()->className();
-			if (name.length() > 1 && (*it)->metaObject()->className() == QString("MyColorButton"))
+			QString name = widgetList[i]->objectName();
+			if (name.length() > 1 && widgetList[i]->metaObject()->className() == QString("MyColorButton"))
 			{
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
-
-				MyColorButton *colorButton = *it;
-				colorButton->AssignParameterContainer(par);
-				colorButton->AssignParameterName(parameterName);
-
-				if (mode == read)
-				{
-					par->Set(parameterName, colorButton->GetColor());
-				}
-				else if (mode == write)
-				{
-					colorButton->setText("");
-					colorButton->SetColor(par->Get<sRGB>(parameterName));
-				}
+				AddBinding(&table, widgetList[i], bindColorButton, parameterName);
+				table.last().wrapper = widgetList[i];
+				table.last().wrapperName = parameterName;
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: ColorPaletteWidget", 3);
 	//---------- colorpalette -----------
 	{
-		QList<ColorPaletteWidget *> widgetListColorPalette =
-			window->findChildren<ColorPaletteWidget *>();
-		QList<ColorPaletteWidget *>::iterator it;
-		for (it = widgetListColorPalette.begin(); it != widgetListColorPalette.end(); ++it)
+		QList<ColorPaletteWidget *> widgetList = window->findChildren<ColorPaletteWidget *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "ColorPalette:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			if (name.length() > 1 && (*it)->metaObject()->className() == QString("ColorPaletteWidget"))
+			QString name = widgetList[i]->objectName();
+			if (name.length() > 1
+					&& widgetList[i]->metaObject()->className() == QString("ColorPaletteWidget"))
 			{
-				ColorPaletteWidget *colorPaletteWidget = *it;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
-
-				colorPaletteWidget->AssignParameterContainer(par);
-				colorPaletteWidget->AssignParameterName(parameterName);
-
-				if (type == QString("colorpalette"))
-				{
-					if (mode == read)
-					{
-						cColorPalette palette = colorPaletteWidget->GetPalette();
-						par->Set(parameterName, palette);
-					}
-					else if (mode == write)
-					{
-						cColorPalette palette = par->Get<cColorPalette>(parameterName);
-						colorPaletteWidget->SetPalette(palette);
-					}
-				}
+				AddBinding(&table, widgetList[i],
+					(type == QString("colorpalette")) ? bindColorPalette : bindNone, parameterName);
+				table.last().wrapper = widgetList[i];
+				table.last().wrapperName = parameterName;
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: QComboBox", 3);
 	// combo boxes
 	{
-		QList<QComboBox *> widgetListPushButton = window->findChildren<QComboBox *>();
-		QList<QComboBox *>::iterator it;
-		for (it = widgetListPushButton.begin(); it != widgetListPushButton.end(); ++it)
+		QList<QComboBox *> widgetList = window->findChildren<QComboBox *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// qDebug() << "QComboBox:" << (*it)->objectName() << " Type:" <<
-			// (*it)->metaObject()->className() << endl;
-			if (name.length() > 1 && (*it)->metaObject()->className() == QString("QComboBox"))
+			QString name = widgetList[i]->objectName();
+			if (name.length() > 1 && widgetList[i]->metaObject()->className() == QString("QComboBox"))
 			{
-				QComboBox *comboBox = *it;
-
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
-
 				if (type == QString("comboBox"))
-				{
-					if (mode == read)
-					{
-						int selection = comboBox->currentIndex();
-						if (parameterName.left(7) == QString("formula"))
-						{
-							selection = fractalList[comboBox->itemData(selection).toInt()].internalID;
-						}
-						par->Set(parameterName, selection);
-					}
-					else if (mode == write)
-					{
-						int selection = par->Get<int>(parameterName);
-						if (parameterName.left(7) == QString("formula"))
-						{
-							for (int i = 0; i < fractalList.size(); i++)
-							{
-								if (fractalList[i].internalID == selection)
-								{
-									selection = comboBox->findData(i);
-									break;
-								}
-							}
-						}
-						comboBox->setCurrentIndex(selection);
-					}
-				}
+					AddBinding(&table, widgetList[i], bindComboBox, parameterName);
 			}
 		}
 	}
 
-	WriteLog("cInterface::SynchronizeInterface: cMaterialSelector", 3);
 	//---------- material selector -----------
 	{
-		QList<cMaterialSelector *> widgetListMaterialSelector =
-			window->findChildren<cMaterialSelector *>();
-		QList<cMaterialSelector *>::iterator it;
-		for (it = widgetListMaterialSelector.begin(); it != widgetListMaterialSelector.end(); ++it)
+		QList<cMaterialSelector *> widgetList = window->findChildren<cMaterialSelector *>();
+		for (int i = 0; i < widgetList.size(); i++)
+		{
+			QString name = widgetList[i]->objectName();
+			if (name.length() > 1
+					&& widgetList[i]->metaObject()->className() == QString("cMaterialSelector"))
+			{
+				QString type, parameterName;
+				GetNameAndType(name, &parameterName, &type);
+				AddBinding(&table, widgetList[i],
+					(type == QString("materialselector")) ? bindMaterialSelector : bindNone, parameterName);
+				table.last().wrapper = widgetList[i];
+				table.last().wrapperName = parameterName;
+			}
+		}
+	}
+
+	//----------- QPlainTextEdit -------------------
+	{
+		QList<QPlainTextEdit *> widgetList = window->findChildren<QPlainTextEdit *>();
+		for (int i = 0; i < widgetList.size(); i++)
 		{
-			QString name = (*it)->objectName();
-			// QString className = (*it)->metaObject()->className();
-			if (name.length() > 1 && (*it)->metaObject()->className() == QString("cMaterialSelector"))
+			QString name = widgetList[i]->objectName();
+			QString className = widgetList[i]->metaObject()->className();
+			if (name.length() > 1 && (className == QString("QPlainTextEdit")))
 			{
 				QString type, parameterName;
 				GetNameAndType(name, &parameterName, &type);
+				if (type == QString("text"))
+					AddBinding(&table, widgetList[i], bindPlainTextEdit, parameterName);
+			}
+		}
+	}
+
+	// children added to or removed from the window invalidate the table
+	window->installEventFilter(this);
+	connect(window, SIGNAL(destroyed(QObject *)), this, SLOT(slotWindowDestroyed(QObject *)),
+		Qt::UniqueConnection);
+
+	return table;
+}
+
+template <class T>
+T cInterfaceBindings::GetValue(const cParameterContainer *par, sBinding *binding)
+{
+	binding->handle = par->FindHandle(binding->parameterName, binding->handle);
+	if (par->IsValidHandle(binding->handle)) return par->Get<T>(binding->handle);
+	return par->Get<T>(binding->parameterName); // reports missing parameter
+}
 
-				cMaterialSelector *materialSelector = *it;
-				materialSelector->AssignParameterContainer(par);
-				materialSelector->AssignParameterName(parameterName);
+template <class T>
+void cInterfaceBindings::SetValue(cParameterContainer *par, sBinding *binding, T value)
+{
+	binding->handle = par->FindHandle(binding->parameterName, binding->handle);
+	if (par->IsValidHandle(binding->handle))
+		par->Set(binding->handle, value);
+	else
+		par->Set(binding->parameterName, value); // reports missing parameter
+}
+
+void cInterfaceBindings::Synchronize(QWidget *window, cParameterContainer *par, enumReadWrite mode)
+{
+	// NULL window is used for tabs without formula widget
+	if (!window) return;
+
+	WriteLog("cInterface::SynchronizeInterface: " + window->objectName(), 3);
+
+	QMap<QWidget *, QList<sBinding> >::iterator tableIt = tables.find(window);
+	// widgets deleted deeper in the window (e.g. replaced formula or primitive widgets)
+	if (tableIt != tables.end() && !IsTableValid(tableIt.value()))
+	{
+		tables.erase(tableIt);
+		tableIt = tables.end();
+	}
+	if (tableIt == tables.end()) tableIt = tables.insert(window, BuildTable(window));
+	QList<sBinding> &table = tableIt.value();
+
+	for (int i = 0; i < table.size(); i++)
+	{
+		sBinding &binding = table[i];
 
-				if (type == QString("materialselector"))
+		if (binding.wrapper)
+		{
+			binding.wrapper->AssignParameterContainer(par);
+			binding.wrapper->AssignParameterName(binding.wrapperName);
+		}
+
+		switch (binding.type)
+		{
+			case bindNone: break;
+
+			case bindLineEditVect3:
+			{
+				QLineEdit *lineEdit = static_cast<QLineEdit *>(binding.widget.data());
+				CVector3 vect = GetValue<CVector3>(par, &binding);
+				if (mode == read)
+				{
+					double value = systemData.locale.toDouble(lineEdit->text());
+					if (SetAxis(&vect, binding, value)) SetValue(par, &binding, vect);
+				}
+				else if (mode == write)
 				{
-					if (mode == read)
+					double value = 0.0;
+					if (GetAxis(vect, binding, &value))
 					{
-						par->Set(parameterName, materialSelector->GetMaterialIndex());
+						lineEdit->setText(QString("%L1").arg(value, 0, 'g', 16));
+						lineEdit->setCursorPosition(0);
 					}
-					else if (mode == write)
+				}
+				break;
+			}
+
+			case bindLineEditVect4:
+			{
+				QLineEdit *lineEdit = static_cast<QLineEdit *>(binding.widget.data());
+				CVector4 vect = GetValue<CVector4>(par, &binding);
+				if (mode == read)
+				{
+					double value = systemData.locale.toDouble(lineEdit->text());
+					if (SetAxis(&vect, binding, value)) SetValue(par, &binding, vect);
+				}
+				else if (mode == write)
+				{
+					double value = 0.0;
+					if (GetAxis(vect, binding, &value))
 					{
-						materialSelector->SetMaterialIndex(par->Get<int>(parameterName));
+						lineEdit->setText(QString("%L1").arg(value, 0, 'g', 16));
+						lineEdit->setCursorPosition(0);
 					}
 				}
+				break;
 			}
-		}
-	}
 
-	WriteLog("cInterface::SynchronizeInterface: QPlainTextEdit", 3);
-	//----------- QPlainTextEdit -------------------
-	{
-		QList<QPlainTextEdit *> widgetListLineEdit = window->findChildren<QPlainTextEdit *>();
-		QList<QPlainTextEdit *>::iterator it;
+			case bindLineEditDouble:
+			{
+				QLineEdit *lineEdit = static_cast<QLineEdit *>(binding.widget.data());
+				if (mode == read)
+				{
+					double value = systemData.locale.toDouble(lineEdit->text());
+					SetValue(par, &binding, value);
+				}
+				else if (mode == write)
+				{
+					double value = GetValue<double>(par, &binding);
+					lineEdit->setText(QString("%L1").arg(value, 0, 'g', 16));
+					lineEdit->setCursorPosition(0);
+				}
+				break;
+			}
 
-		for (it = widgetListLineEdit.begin(); it != widgetListLineEdit.end(); ++it)
-		{
-			QString name = (*it)->objectName();
-			QString className = (*it)->metaObject()->className();
-			if (name.length() > 1 && (className == QString("QPlainTextEdit")))
+			case bindLineEditText:
 			{
-				QPlainTextEdit *textEdit = *it;
+				QLineEdit *lineEdit = static_cast<QLineEdit *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, lineEdit->text());
+				else if (mode == write)
+					lineEdit->setText(GetValue<QString>(par, &binding));
+				break;
+			}
 
-				QString type, parameterName;
-				GetNameAndType(name, &parameterName, &type);
+			case bindDoubleSpinBox:
+			{
+				QDoubleSpinBox *spinbox = static_cast<QDoubleSpinBox *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, spinbox->value());
+				else if (mode == write)
+					spinbox->setValue(GetValue<double>(par, &binding));
+				break;
+			}
 
-				//----------- get texts ------------
-				if (type == QString("text"))
+			case bindDoubleSpinBox3:
+			{
+				QDoubleSpinBox *spinbox = static_cast<QDoubleSpinBox *>(binding.widget.data());
+				CVector3 vect = GetValue<CVector3>(par, &binding);
+				if (mode == read)
 				{
-					if (mode == read)
+					if (SetAxis(&vect, binding, spinbox->value())) SetValue(par, &binding, vect);
+				}
+				else if (mode == write)
+				{
+					double value = 0.0;
+					GetAxis(vect, binding, &value);
+					spinbox->setValue(value);
+				}
+				break;
+			}
+
+			case bindDoubleSpinBox4:
+			{
+				QDoubleSpinBox *spinbox = static_cast<QDoubleSpinBox *>(binding.widget.data());
+				CVector4 vect = GetValue<CVector4>(par, &binding);
+				if (mode == read)
+				{
+					if (SetAxis(&vect, binding, spinbox->value())) SetValue(par, &binding, vect);
+				}
+				else if (mode == write)
+				{
+					double value = 0.0;
+					GetAxis(vect, binding, &value);
+					spinbox->setValue(value);
+				}
+				break;
+			}
+
+			case bindSpinBoxInt:
+			{
+				QSpinBox *spinbox = static_cast<QSpinBox *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, spinbox->value());
+				else if (mode == write)
+					spinbox->setValue(GetValue<int>(par, &binding));
+				break;
+			}
+
+			case bindCheckBox:
+			{
+				QCheckBox *checkbox = static_cast<QCheckBox *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, checkbox->isChecked());
+				else if (mode == write)
+					checkbox->setChecked(GetValue<bool>(par, &binding));
+				break;
+			}
+
+			case bindGroupBox:
+			{
+				QGroupBox *groupbox = static_cast<QGroupBox *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, groupbox->isChecked());
+				else if (mode == write)
+					groupbox->setChecked(GetValue<bool>(par, &binding));
+				break;
+			}
+
+			case bindFileSelect:
+			{
+				FileSelectWidget *fileSelectWidget = static_cast<FileSelectWidget *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, fileSelectWidget->GetPath());
+				else if (mode == write)
+					fileSelectWidget->SetPath(GetValue<QString>(par, &binding));
+				break;
+			}
+
+			case bindColorButton:
+			{
+				MyColorButton *colorButton = static_cast<MyColorButton *>(binding.widget.data());
+				if (mode == read)
+				{
+					SetValue(par, &binding, colorButton->GetColor());
+				}
+				else if (mode == write)
+				{
+					colorButton->setText("");
+					colorButton->SetColor(GetValue<sRGB>(par, &binding));
+				}
+				break;
+			}
+
+			case bindColorPalette:
+			{
+				ColorPaletteWidget *colorPaletteWidget =
+					static_cast<ColorPaletteWidget *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, colorPaletteWidget->GetPalette());
+				else if (mode == write)
+					colorPaletteWidget->SetPalette(GetValue<cColorPalette>(par, &binding));
+				break;
+			}
+
+			case bindComboBox:
+			{
+				QComboBox *comboBox = static_cast<QComboBox *>(binding.widget.data());
+				if (mode == read)
+				{
+					int selection = comboBox->currentIndex();
+					if (binding.formulaSelection)
 					{
-						QString value = textEdit->toPlainText();
-						par->Set(parameterName, value);
+						selection = fractalList[comboBox->itemData(selection).toInt()].internalID;
 					}
-					else if (mode == write)
+					SetValue(par, &binding, selection);
+				}
+				else if (mode == write)
+				{
+					int selection = GetValue<int>(par, &binding);
+					if (binding.formulaSelection)
 					{
-						QString value = par->Get<QString>(parameterName);
-						textEdit->setPlainText(value);
+						for (int f = 0; f < fractalList.size(); f++)
+						{
+							if (fractalList[f].internalID == selection)
+							{
+								selection = comboBox->findData(f);
+								break;
+							}
+						}
 					}
+					comboBox->setCurrentIndex(selection);
 				}
+				break;
+			}
+
+			case bindMaterialSelector:
+			{
+				cMaterialSelector *materialSelector =
+					static_cast<cMaterialSelector *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, materialSelector->GetMaterialIndex());
+				else if (mode == write)
+					materialSelector->SetMaterialIndex(GetValue<int>(par, &binding));
+				break;
 			}
-		} // end foreach
+
+			case bindPlainTextEdit:
+			{
+				QPlainTextEdit *textEdit = static_cast<QPlainTextEdit *>(binding.widget.data());
+				if (mode == read)
+					SetValue(par, &binding, textEdit->toPlainText());
+				else if (mode == write)
+					textEdit->setPlainText(GetValue<QString>(par, &binding));
+				break;
+			}
+		}
 	}
 
 	WriteLog("cInterface::SynchronizeInterface: Done", 3);
 }
 
+bool cInterfaceBindings::GetAxis(const CVector3 &vect, const sBinding &binding, double *value)
+{
+	switch (binding.axis)
+	{
+		case 'x': *value = vect.x; return true;
+		case 'y': *value = vect.y; return true;
+		case 'z': *value = vect.z; return true;
+		default: WrongAxis(binding); return false;
+	}
+}
+
+bool cInterfaceBindings::GetAxis(const CVector4 &vect, const sBinding &binding, double *value)
+{
+	switch (binding.axis)
+	{
+		case 'x': *value = vect.x; return true;
+		case 'y': *value = vect.y; return true;
+		case 'z': *value = vect.z; return true;
+		case 'w': *value = vect.w; return true;
+		default: WrongAxis(binding); return false;
+	}
+}
+
+bool cInterfaceBindings::SetAxis(CVector3 *vect, const sBinding &binding, double value)
+{
+	switch (binding.axis)
+	{
+		case 'x': vect->x = value; return true;
+		case 'y': vect->y = value; return true;
+		case 'z': vect->z = value; return true;
+		default: WrongAxis(binding); return false;
+	}
+}
+
+bool cInterfaceBindings::SetAxis(CVector4 *vect, const sBinding &binding, double value)
+{
+	switch (binding.axis)
+	{
+		case 'x': vect->x = value; return true;
+		case 'y': vect->y = value; return true;
+		case 'z': vect->z = value; return true;
+		case 'w': vect->w = value; return true;
+		default: WrongAxis(binding); return false;
+	}
+}
+
+void cInterfaceBindings::WrongAxis(const sBinding &binding)
+{
+	qWarning() << "cInterface::SynchronizeInterfaceWindow(): " << binding.widget->objectName() << " "
+						 << binding.parameterName << " has wrong axis name (is " << binding.axis << ")"
+						 << endl;
+}
+
 // extract name and type string from widget name
 void GetNameAndType(QString name, QString *parameterName, QString *type)
 {
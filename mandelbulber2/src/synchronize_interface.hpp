@@ -35,10 +35,15 @@
 #ifndef MANDELBULBER2_SRC_SYNCHRONIZE_INTERFACE_HPP_
 #define MANDELBULBER2_SRC_SYNCHRONIZE_INTERFACE_HPP_
 
+#include <QMap>
+#include <QObject>
+#include <QPointer>
 #include <QWidget>
 
+#include "parameters.hpp"
+
 // forward declarations
-class cParameterContainer;
+class CommonMyWidgetWrapper;
 
 namespace qInterface
 {
@@ -53,4 +58,76 @@ void SynchronizeInterfaceWindow(
 	QWidget *window, cParameterContainer *par, qInterface::enumReadWrite mode);
 void GetNameAndType(QString name, QString *parameterName, QString *type);
 
+// widgets of each synchronized window with parsed parameter names. Table is built when the
+// window is synchronized for the first time and again after a child is added to or removed from
+// the window or any bound widget is deleted. Widgets added deeper in the window tree have to be
+// announced by Invalidate()
+class cInterfaceBindings : public QObject
+{
+	Q_OBJECT
+public:
+	static cInterfaceBindings *Instance();
+	void Synchronize(QWidget *window, cParameterContainer *par, qInterface::enumReadWrite mode);
+	// tables of windows which contain the widget are built again at next synchronization
+	void Invalidate(QWidget *widget);
+
+protected:
+	virtual bool eventFilter(QObject *obj, QEvent *event);
+
+private slots:
+	void slotWindowDestroyed(QObject *window);
+
+private:
+	enum enumBindingType
+	{
+		bindNone, // only parameter container is assigned to the widget
+		bindLineEditVect3,
+		bindLineEditVect4,
+		bindLineEditDouble,
+		bindLineEditText,
+		bindDoubleSpinBox,
+		bindDoubleSpinBox3,
+		bindDoubleSpinBox4,
+		bindSpinBoxInt,
+		bindCheckBox,
+		bindGroupBox,
+		bindFileSelect,
+		bindColorButton,
+		bindColorPalette,
+		bindComboBox,
+		bindMaterialSelector,
+		bindPlainTextEdit
+	};
+
+	struct sBinding
+	{
+		QPointer<QWidget> widget; // NULL when the widget was deleted
+		CommonMyWidgetWrapper *wrapper; // NULL for standard Qt widgets
+		enumBindingType type;
+		QString parameterName; // name of vector for vector components
+		QString wrapperName; // name assigned to wrapper (with axis for vector components)
+		char axis;
+		bool formulaSelection; // combo box selects formula from fractal list
+		// handle found in last synchronized container
+		sParameterHandle handle;
+	};
+
+	QList<sBinding> BuildTable(QWidget *window);
+	static bool IsTableValid(const QList<sBinding> &table);
+	static void AddBinding(
+		QList<sBinding> *table, QWidget *widget, enumBindingType type, const QString &parameterName);
+	template <class T>
+	static T GetValue(const cParameterContainer *par, sBinding *binding);
+	template <class T>
+	static void SetValue(cParameterContainer *par, sBinding *binding, T value);
+	static bool GetAxis(const CVector3 &vect, const sBinding &binding, double *value);
+	static bool GetAxis(const CVector4 &vect, const sBinding &binding, double *value);
+	static bool SetAxis(CVector3 *vect, const sBinding &binding, double value);
+	static bool SetAxis(CVector4 *vect, const sBinding &binding, double value);
+	static void WrongAxis(const sBinding &binding);
+
+	QMap<QWidget *, QList<sBinding> > tables;
+	static cInterfaceBindings *instance;
+};
+
 #endif /* MANDELBULBER2_SRC_SYNCHRONIZE_INTERFACE_HPP_ */
@@ -147,6 +147,9 @@ bool InitSystem(void)
 
 	systemData.globalStopRequest = false;
 
+	systemData.resumeRendering = false;
+	systemData.resourceReports = false;
+
 #ifndef WIN32
 	handle_winch(-1);
 #endif
@@ -213,42 +216,63 @@ void WriteLogDouble(QString text, double value, int verbosityLevel)
 
 bool CreateDefaultFolders(void)
 {
-	// create data directory if not exists
 	bool result = true;
 
-	result &= CreateFolder(systemData.GetDataDirectoryHidden());
-	result &= CreateFolder(systemData.GetDataDirectoryPublic());
-	result &= CreateFolder(systemData.GetImagesFolder());
-	result &= CreateFolder(systemData.GetThumbnailsFolder());
-	result &= CreateFolder(systemData.GetToolbarFolder());
-	result &= CreateFolder(systemData.GetSettingsFolder());
-	result &= CreateFolder(systemData.GetSlicesFolder());
-	result &= CreateFolder(systemData.GetMaterialsFolder());
-	result &= CreateFolder(systemData.GetAnimationFolder());
-
-	RetrieveToolbarPresets(false);
-	RetrieveExampleMaterials(false);
+	// folders were already verified by an earlier start of the same version. Skipping the checks
+	// saves a lot of file system calls on networked home directories (e.g. render nodes)
+	if (IsDataFoldersStampValid())
+	{
+		WriteLog("Data folders stamp valid, skipping folder verification", 2);
+	}
+	else
+	{
+		// create data directory if not exists
+		result &= CreateFolder(systemData.GetDataDirectoryHidden());
+		result &= CreateFolder(systemData.GetDataDirectoryPublic());
+		result &= CreateFolder(systemData.GetImagesFolder());
+		result &= CreateFolder(systemData.GetThumbnailsFolder());
+		result &= CreateFolder(systemData.GetAudioCacheFolder());
+		result &= CreateFolder(systemData.GetToolbarFolder());
+		result &= CreateFolder(systemData.GetSettingsFolder());
+		result &= CreateFolder(systemData.GetSlicesFolder());
+		result &= CreateFolder(systemData.GetMaterialsFolder());
+		result &= CreateFolder(systemData.GetAnimationFolder());
 
 #ifdef CLSUPPORT
-	string oclDir = systemData.dataDirectory + "/custom_ocl_formulas";
-	QString qoclDir = QString::fromStdString(oclDir);
-	if (!QDir(qoclDir).exists())
-	{
-		result &= CreateFolder(oclDir);
+		string oclDir = systemData.dataDirectory + "/custom_ocl_formulas";
+		QString qoclDir = QString::fromStdString(oclDir);
+		if (!QDir(qoclDir).exists())
+		{
+			result &= CreateFolder(oclDir);
+			if (result)
+			{
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example1.c",
+					oclDir + "/cl_example1.c");
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example2.c",
+					oclDir + "/cl_example2.c");
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example3.c",
+					oclDir + +"/cl_example3.c");
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example1Init.c",
+					oclDir + "/cl_example1Init.c");
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example2Init.c",
+					oclDir + "/cl_example2Init.c");
+				fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example3Init.c",
+					oclDir + "/cl_example3Init.c");
+			}
+		}
+#endif
+
+		// toolbar presets and example materials are installed on demand by the user interface
 		if (result)
 		{
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example1.c", oclDir + "/cl_example1.c");
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example2.c", oclDir + "/cl_example2.c");
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example3.c", oclDir + +"/cl_example3.c");
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example1Init.c",
-				oclDir + "/cl_example1Init.c");
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example2Init.c",
-				oclDir + "/cl_example2Init.c");
-			fcopy(systemData.sharedDir + "/exampleOCLformulas/cl_example3Init.c",
-				oclDir + "/cl_example3Init.c");
+			QFile stampFile(systemData.GetDataFoldersStampFile());
+			if (stampFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+			{
+				stampFile.write(DataFoldersStamp().toUtf8());
+				stampFile.close();
+			}
 		}
 	}
-#endif
 
 	actualFileNames.actualFilenameSettings =
 		QString("settings") + QDir::separator() + "default.fract";
@@ -267,6 +291,20 @@ bool CreateDefaultFolders(void)
 	return result;
 }
 
+QString DataFoldersStamp()
+{
+	return QString(MANDELBULBER_VERSION_STRING) + "\n" + systemData.GetDataDirectoryUsed();
+}
+
+bool IsDataFoldersStampValid()
+{
+	QFile stampFile(systemData.GetDataFoldersStampFile());
+	if (!stampFile.open(QIODevice::ReadOnly)) return false;
+	QString stamp = QString::fromUtf8(stampFile.readAll());
+	stampFile.close();
+	return stamp == DataFoldersStamp();
+}
+
 bool CreateFolder(QString qname)
 {
 	if (QDir(qname).exists())
@@ -114,8 +114,11 @@ public:
 	QString GetToolbarFolder() const { return dataDirectoryHidden + "toolbar"; }
 	QString GetQueueFractlistFile() const { return dataDirectoryHidden + "queue.fractlist"; }
 	QString GetThumbnailsFolder() const { return dataDirectoryHidden + "thumbnails"; }
+	QString GetAudioCacheFolder() const { return dataDirectoryHidden + "audio_cache"; }
 	QString GetAutosaveFile() const { return dataDirectoryHidden + ".autosave.fract"; }
+	QString GetAutosaveJournalFile() const { return dataDirectoryHidden + ".autosave.journal"; }
 	QString GetIniFile() const { return dataDirectoryHidden + "mandelbulber.ini"; }
+	QString GetDataFoldersStampFile() const { return dataDirectoryHidden + ".data_folders_stamp"; }
 
 	QString homedir;
 	QString sharedDir;
@@ -137,6 +140,11 @@ public:
 	QElapsedTimer globalTimer;
 	bool globalStopRequest;
 	enumRenderingThreadPriority threadsPriority;
+	// rendering threads are bound to CPUs and NUMA nodes
+	bool threadsAffinity;
+	// still images are resumed from checkpoints of interrupted renders
+	bool resumeRendering;
+	bool resourceReports;
 };
 
 struct sActualFileNames
@@ -156,6 +164,8 @@ void WriteLogString(QString text, QString value, int verbosityLevel);
 void handle_winch(int sig);
 int get_cpu_count();
 bool CreateDefaultFolders(void);
+QString DataFoldersStamp();
+bool IsDataFoldersStampValid();
 bool CreateFolder(QString name);
 void DeleteAllFilesFromDirectory(QString folder, QString filterExpression);
 int fcopy(QString source, QString dest);
@@ -0,0 +1,206 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTemporalDepth class - reprojection of depth of previous animation frame
+ */
+
+#include "temporal_depth.hpp"
+
+#include "camera_target.hpp"
+#include "cimage.hpp"
+#include "fractparams.hpp"
+#include "projection_3d.hpp"
+#include "render_data.hpp"
+
+// the same camera rotation as used by cRenderWorker
+static CRotationMatrix CameraRotation(const cParamRender *params)
+{
+	cCameraTarget cameraTarget(params->camera, params->target, params->topVector);
+	CVector3 viewAngle = cameraTarget.GetRotation();
+	CRotationMatrix mRot;
+	mRot.RotateZ(viewAngle.x);
+	mRot.RotateX(viewAngle.y);
+	mRot.RotateY(viewAngle.z);
+	return mRot;
+}
+
+cTemporalDepth::cTemporalDepth()
+{
+	width = 0;
+	height = 0;
+}
+
+cTemporalDepth::~cTemporalDepth()
+{
+}
+
+bool cTemporalDepth::IsSupported(const cParamRender *params)
+{
+	return params->perspectiveType == params::perspThreePoint;
+}
+
+void cTemporalDepth::StoreFrame(
+	const cImage *image, const cParamRender *params, const sRenderData *data)
+{
+	Clear();
+	if (!IsSupported(params)) return;
+
+	CRotationMatrix mRot = CameraRotation(params);
+	double aspectRatio = (double)image->GetWidth() / image->GetHeight();
+
+	for (int y = data->screenRegion.y1; y < data->screenRegion.y2; y++)
+	{
+		for (int x = data->screenRegion.x1; x < data->screenRegion.x2; x++)
+		{
+			double depth = image->GetPixelZBuffer(x, y);
+			if (depth >= 1e19) continue; // background
+
+			CVector2<double> imagePoint =
+				data->screenRegion.transpose(data->imageRegion, CVector2<int>(x, y));
+			imagePoint.x *= aspectRatio;
+			CVector3 direction =
+				CalculateViewVector(imagePoint, params->fov, params->perspectiveType, mRot);
+			direction.Normalize();
+			surfacePoints.append(params->camera + direction * depth);
+			colours.append(image->GetPixelImage(x, y));
+		}
+	}
+}
+
+bool cTemporalDepth::Reproject(
+	const cParamRender *params, const sRenderData *data, int _width, int _height)
+{
+	width = _width;
+	height = _height;
+	startDistance.fill(0.0f, width * height);
+	if (surfacePoints.size() == 0 || !IsSupported(params)) return false;
+
+	CRotationMatrix mRotInv = CameraRotation(params).Transpose();
+	double aspectRatio = (double)width / height;
+	const cRegion<int> &screen = data->screenRegion;
+	const cRegion<double> &imageRegion = data->imageRegion;
+
+	// minimum depth of points projected to each pixel
+	projectedDepth.fill(0.0f, width * height);
+	projectedPoint.fill(-1, width * height);
+	QVector<float> &projected = projectedDepth;
+	for (int i = 0; i < surfacePoints.size(); i++)
+	{
+		CVector3 relative = surfacePoints[i] - params->camera;
+		CVector3 v = mRotInv.RotateVector(relative);
+		if (v.y <= 0.0) continue; // behind the camera
+
+		// inversion of CalculateViewVector() and cRegion::transpose()
+		CVector2<double> imagePoint(v.x / v.y / params->fov / aspectRatio, v.z / v.y / params->fov);
+		double xs = (imagePoint.x - imageRegion.x1) * screen.width / imageRegion.width + screen.x1;
+		double ys = (imagePoint.y - imageRegion.y1) * screen.height / imageRegion.height + screen.y1;
+		int x = (int)floor(xs + 0.5);
+		int y = (int)floor(ys + 0.5);
+		if (x < 0 || x >= width || y < 0 || y >= height) continue;
+
+		float depth = relative.Length();
+		float &pixel = projected[y * width + x];
+		if (pixel == 0.0f || depth < pixel)
+		{
+			pixel = depth;
+			projectedPoint[y * width + x] = i;
+		}
+	}
+
+	// start distance is taken only if all neighbouring pixels got projected points
+	for (int y = 1; y < height - 1; y++)
+	{
+		for (int x = 1; x < width - 1; x++)
+		{
+			float minDepth = 1e20f;
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					float depth = projected[(y + dy) * width + x + dx];
+					if (depth == 0.0f) minDepth = 0.0f;
+					else if (depth < minDepth) minDepth = depth;
+				}
+			}
+			startDistance[y * width + x] = minDepth * TEMPORAL_DEPTH_SAFETY;
+		}
+	}
+	return true;
+}
+
+double cTemporalDepth::GetStartDistance(int x, int y) const
+{
+	if (x < 0 || x >= width || y < 0 || y >= height) return 0.0;
+	return startDistance[y * width + x];
+}
+
+bool cTemporalDepth::GetReprojectedPixel(int x, int y, sRGBfloat *colour, float *depth) const
+{
+	if (x < 0 || x >= width || y < 0 || y >= height || projectedPoint.size() != width * height)
+		return false;
+	int index = projectedPoint[y * width + x];
+	if (index < 0 || index >= colours.size()) return false;
+	*colour = colours[index];
+	*depth = projectedDepth[y * width + x];
+	return true;
+}
+
+void cTemporalDepth::WarpImage(cImage *image, QVector<double> *lineCost) const
+{
+	lineCost->fill(0.0, height);
+	if (image->GetWidth() != width || image->GetHeight() != height) return;
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int index = projectedPoint[y * width + x];
+			if (index >= 0 && index < colours.size())
+			{
+				image->PutPixelImage(x, y, colours[index]);
+				image->PutPixelZBuffer(x, y, projectedDepth[y * width + x]);
+			}
+			else
+			{
+				(*lineCost)[y] += 1.0;
+			}
+		}
+	}
+}
+
+void cTemporalDepth::PrepareScene(const QString &sceneHash)
+{
+	if (sceneHash != lastSceneHash)
+	{
+		Clear();
+		lastSceneHash = sceneHash;
+	}
+}
@@ -0,0 +1,102 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTemporalDepth class - reprojection of depth of previous animation frame
+ *
+ * Surface points of previous frame are projected into camera of the new
+ * frame. Minimum of projected depths around each pixel (reduced by safety
+ * margin) is used as start distance of primary ray. Where some neighbouring
+ * pixels didn't get any projected point (disocclusion, new areas at image
+ * edges, background) rays are marched from the camera.
+ *
+ * During interactive navigation also colours of the last frame are warped to
+ * the new camera, so there is instant feedback before rendering starts.
+ */
+
+#ifndef MANDELBULBER2_SRC_TEMPORAL_DEPTH_HPP_
+#define MANDELBULBER2_SRC_TEMPORAL_DEPTH_HPP_
+
+#include <QString>
+#include <QVector>
+
+#include "algebra.hpp"
+#include "color_structures.hpp"
+
+// part of reprojected depth used as start distance
+#define TEMPORAL_DEPTH_SAFETY 0.9
+
+// forward declarations
+class cImage;
+class cParamRender;
+struct sRenderData;
+
+class cTemporalDepth
+{
+public:
+	cTemporalDepth();
+	~cTemporalDepth();
+
+	// stores surface points of rendered frame
+	void StoreFrame(const cImage *image, const cParamRender *params, const sRenderData *data);
+	// projects stored points into camera of new frame. Returns false if there is nothing to use
+	bool Reproject(const cParamRender *params, const sRenderData *data, int _width, int _height);
+	// start distance of primary ray (0 if unknown)
+	double GetStartDistance(int x, int y) const;
+	// puts reprojected colours into the image (has to be called after Reproject()). Pixels which
+	// didn't get any point keep old colour and are counted for each line in lineCost
+	void WarpImage(cImage *image, QVector<double> *lineCost) const;
+	// colour and depth of the nearest point projected to the pixel. Returns false if nothing
+	// was projected there (has to be called after Reproject())
+	bool GetReprojectedPixel(int x, int y, sRGBfloat *colour, float *depth) const;
+	// stored frame is forgotten if anything else than the camera was changed
+	void PrepareScene(const QString &sceneHash);
+	// forgets stored frame
+	void Clear()
+	{
+		surfacePoints.clear();
+		colours.clear();
+	}
+
+	// reprojection is implemented only for standard perspective
+	static bool IsSupported(const cParamRender *params);
+
+private:
+	QVector<CVector3> surfacePoints;
+	QVector<sRGBfloat> colours;
+	QVector<float> startDistance;
+	QVector<float> projectedDepth; // 0 = nothing projected
+	QVector<int> projectedPoint;	 // index of nearest projected point
+	QString lastSceneHash;
+	int width;
+	int height;
+};
+
+#endif /* MANDELBULBER2_SRC_TEMPORAL_DEPTH_HPP_ */
@@ -33,19 +33,52 @@
  */
 
 #include "test.hpp"
+#include "../qt/thumbnail_widget.h"
 #include "animation_flight.hpp"
 #include "animation_frames.hpp"
 #include "animation_keyframes.hpp"
+#include "autosave.hpp"
+#include "calculate_distance.hpp"
+#include "checkerboard_render.hpp"
 #include "cimage.hpp"
+#include "de_factor_optimizer.hpp"
+#include "denoiser.hpp"
+#include "compute_fractal.hpp"
+#include "distance_cache.hpp"
+#include "distance_query.hpp"
+#include "double_double.hpp"
+#include "fractal_list.hpp"
+#include "fractparams.hpp"
+#include "half_float.h"
 #include "headless.h"
 #include "initparameters.hpp"
 #include "keyframes.hpp"
+#include "marchingcubes.h"
+#include "memory_estimator.hpp"
 #include "netrender.hpp"
+#include "netrender_line_decoder.hpp"
+#include "netrender_multicast.hpp"
+#include "netrender_post_tiles.hpp"
+#include "nine_fractals.hpp"
+#include "parameter_sweep.hpp"
+#include "player_frame_cache.hpp"
+#include "random.hpp"
+#include "render_checkpoint.hpp"
+#include "render_image.hpp"
 #include "render_job.hpp"
+#include "render_time_budget.hpp"
+#include "job_arena.hpp"
 #include "settings.hpp"
+#include "settings_preview_loader.hpp"
+#include "stereo.h"
+#include "texture.hpp"
+#include "tile_scheduler.hpp"
 #include "interface.hpp"
 #include "rendering_configuration.hpp"
+#include "resource_report.hpp"
 #include "system.hpp"
+#include "thumbnail_store.hpp"
+#include "voxel_export.hpp"
 
 QString Test::testFolder()
 {
@@ -56,14 +89,314 @@ void Test::initTestCase()
 {
 	if(QFileInfo(testFolder()).exists()) cleanupTestCase();
 	CreateFolder(testFolder());
+
+	perfBaselinesChanged = false;
+	QFile file(perfBaselineFile());
+	if (file.open(QIODevice::ReadOnly))
+		perfBaselines = QJsonDocument::fromJson(file.readAll()).object();
 }
 
 void Test::cleanupTestCase()
 {
 	DeleteAllFilesFromDirectory(testFolder(), "*");
 	QDir().rmdir(testFolder());
+
+	if (perfBaselinesChanged)
+	{
+		QFile file(perfBaselineFile());
+		if (file.open(QIODevice::WriteOnly))
+			file.write(QJsonDocument(perfBaselines).toJson());
+		else
+			qWarning() << "Cannot write performance baselines to" << perfBaselineFile();
+		perfBaselinesChanged = false;
+	}
+}
+
+QString Test::perfBaselineFile()
+{
+	QString fileName = QString::fromLocal8Bit(qgetenv("MANDELBULBER_PERF_BASELINE"));
+	if (fileName.isEmpty()) fileName = systemData.GetDataDirectoryHidden() + "perf_baselines.json";
+	return fileName;
+}
+
+double Test::perfTolerance()
+{
+	bool ok = false;
+	double tolerance = qgetenv("MANDELBULBER_PERF_TOLERANCE").toDouble(&ok);
+	return ok ? tolerance : 0.25;
+}
+
+double Test::measureThroughput(sPerfTask *task, double minTime)
+{
+	double bestThroughput = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		QElapsedTimer timer;
+		timer.start();
+		double items = 0.0;
+		do
+		{
+			items += task->Run();
+		} while (timer.nsecsElapsed() < minTime * 1e9);
+		double throughput = items / (timer.nsecsElapsed() / 1e9);
+		bestThroughput = qMax(bestThroughput, throughput);
+	}
+	return bestThroughput;
+}
+
+bool Test::checkPerformance(const QString &name, double throughput, QString *failures)
+{
+	qDebug() << qPrintable(name) << throughput << "/ s";
+	double baseline = perfBaselines.value(name).toDouble(0.0);
+	if (baseline <= 0.0 || !qgetenv("MANDELBULBER_PERF_UPDATE").isEmpty())
+	{
+		perfBaselines[name] = throughput;
+		perfBaselinesChanged = true;
+		return true;
+	}
+
+	if (throughput < baseline * (1.0 - perfTolerance()))
+	{
+		*failures += QString("%1: %2 / s, baseline %3 / s\n")
+									 .arg(name)
+									 .arg(throughput, 0, 'g', 4)
+									 .arg(baseline, 0, 'g', 4);
+		return false;
+	}
+	return true;
+}
+
+void Test::loadPerfScene(
+	const QString &file, cParameterContainer *par, cFractalContainer *parFractal)
+{
+	par->SetContainerName("main");
+	InitParams(par);
+	InitMaterialParams(1, par);
+	for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+	{
+		parFractal->at(i).SetContainerName(QString("fractal") + QString::number(i));
+		InitFractalParams(&parFractal->at(i));
+	}
+
+	// empty file name means default settings
+	if (file.isEmpty()) return;
+	QString fileName = QDir::toNativeSeparators(
+		systemData.sharedDir + "examples" + QDir::separator() + file);
+	cAnimationFrames frames;
+	cKeyframes keyframes;
+	cSettings parSettings(cSettings::formatFullText);
+	parSettings.BeQuiet(true);
+	parSettings.LoadFromFile(fileName);
+	parSettings.Decode(par, parFractal, &frames, &keyframes);
 }
 
+bool Test::renderPerfScene(cParameterContainer *par, cFractalContainer *parFractal, int width,
+	int height, cStatistics *statistics)
+{
+	par->Set("image_width", width);
+	par->Set("image_height", height);
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+
+	bool stopRequest = false;
+	cImage image(width, height);
+	cRenderJob renderJob(par, parFractal, &image, &stopRequest);
+	if (!renderJob.Init(cRenderJob::still, config)) return false;
+	if (!renderJob.Execute()) return false;
+	*statistics = renderJob.GetStatistics();
+	return true;
+}
+
+double Test::RenderAndCompare(const cParameterContainer &referencePar,
+	const cParameterContainer &testedPar, const cFractalContainer &parFractal,
+	sRenderComparison *comparison)
+{
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+	cRenderJob::enumMode mode =
+		comparison->deferredPostProcessing ? cRenderJob::keyframeAnim : cRenderJob::still;
+
+	bool stopRequest = false;
+	cParameterContainer par = referencePar;
+	cFractalContainer fractal = parFractal;
+	cImage imageReference(par.Get<int>("image_width"), par.Get<int>("image_height"));
+	{
+		cRenderJob renderJob(&par, &fractal, &imageReference, &stopRequest);
+		renderJob.Init(mode, config);
+		if (!renderJob.Execute())
+		{
+			comparison->error = "reference render failed.";
+			return -1.0;
+		}
+		comparison->referenceDeferred = renderJob.IsPostProcessingDeferred();
+	}
+
+	par = testedPar;
+	cImage imageTested(par.Get<int>("image_width"), par.Get<int>("image_height"));
+	for (int i = 0; i < comparison->testedRenders; i++)
+	{
+		cRenderJob renderJob(&par, &fractal, &imageTested, &stopRequest);
+		renderJob.Init(mode, config);
+		if (comparison->deferredPostProcessing) renderJob.SetDeferredPostProcessing(true);
+		if (!renderJob.Execute())
+		{
+			comparison->error = "tested render failed.";
+			return -1.0;
+		}
+		comparison->usedShaderVariant = renderJob.GetStatistics().usedShaderVariant;
+		comparison->testedDeferred = renderJob.IsPostProcessingDeferred();
+		if (comparison->deferredPostProcessing)
+			cRenderer::PostProcessImage(renderJob.GetParameters(), &imageTested, &stopRequest);
+	}
+
+	int width = imageReference.GetWidth();
+	int height = imageReference.GetHeight();
+	if (width != imageTested.GetWidth() || height != imageTested.GetHeight())
+	{
+		comparison->error = "sizes of images are different.";
+		return -1.0;
+	}
+
+	double totalDifference = 0.0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (comparison->deferredPostProcessing)
+			{
+				sRGB16 pixelReference = imageReference.GetPixelImage16(x, y);
+				sRGB16 pixelTested = imageTested.GetPixelImage16(x, y);
+				totalDifference += (abs(pixelReference.R - pixelTested.R)
+														 + abs(pixelReference.G - pixelTested.G)
+														 + abs(pixelReference.B - pixelTested.B))
+													 / 65535.0;
+			}
+			else
+			{
+				sRGBfloat pixelReference = imageReference.GetPixelImage(x, y);
+				sRGBfloat pixelTested = imageTested.GetPixelImage(x, y);
+				totalDifference += fabs(pixelReference.R - pixelTested.R)
+													 + fabs(pixelReference.G - pixelTested.G)
+													 + fabs(pixelReference.B - pixelTested.B);
+			}
+		}
+	}
+	return totalDifference / (width * height * 3);
+}
+
+// points of regular grid in the cube <-1.5, 1.5>
+static CVector3 PerfGridPoint(int index)
+{
+	return CVector3(
+		(index % 16) / 5.0 - 1.5, ((index / 16) % 16) / 5.0 - 1.5, ((index / 256) % 16) / 5.0 - 1.5);
+}
+
+struct sPerfComputeTask : public sPerfTask
+{
+	const cParamRender *params;
+	const cNineFractals *fractals;
+	virtual double Run()
+	{
+		for (int i = 0; i < 4096; i++)
+		{
+			sFractalIn fractIn(PerfGridPoint(i), params->minN, params->N, params->common, -1);
+			sFractalOut fractOut;
+			Compute<fractal::calcModeNormal>(*fractals, fractIn, &fractOut);
+		}
+		return 4096;
+	}
+};
+
+struct sPerfDistanceTask : public sPerfTask
+{
+	const cParamRender *params;
+	const cNineFractals *fractals;
+	virtual double Run()
+	{
+		for (int i = 0; i < 4096; i++)
+		{
+			sDistanceIn in(PerfGridPoint(i), 1e-4, false);
+			sDistanceOut out;
+			CalculateDistance(*params, *fractals, in, &out);
+		}
+		return 4096;
+	}
+};
+
+struct sPerfCompileImageTask : public sPerfTask
+{
+	cImage *image;
+	virtual double Run()
+	{
+		image->CompileImage();
+		return (double)image->GetWidth() * image->GetHeight();
+	}
+};
+
+struct sPerfDecodeTask : public sPerfTask
+{
+	cSettings *settings;
+	cParameterContainer *par;
+	cFractalContainer *parFractal;
+	virtual double Run()
+	{
+		cAnimationFrames frames;
+		cKeyframes keyframes;
+		settings->Decode(par, parFractal, &frames, &keyframes);
+		return 1;
+	}
+};
+
+struct sPerfInitParamsTask : public sPerfTask
+{
+	virtual double Run()
+	{
+		cParameterContainer par;
+		cFractalContainer parFractal;
+		InitParams(&par);
+		for (int i = 0; i < NUMBER_OF_FRACTALS; i++)
+			InitFractalParams(&parFractal.at(i));
+		return 1;
+	}
+};
+
+// sphere with waves, so all cube configurations appear
+struct sPerfField
+{
+	double operator()(double x, double y, double z, double *colorIndex) const
+	{
+		*colorIndex = 0.0;
+		return sqrt(x * x + y * y + z * z) - 1.0 + 0.1 * sin(8.0 * x) * sin(8.0 * y) * sin(8.0 * z);
+	}
+};
+
+struct sPerfNoProgress
+{
+	void operator()(int) const {}
+};
+
+struct sPerfMarchingCubesTask : public sPerfTask
+{
+	virtual double Run()
+	{
+		const int size = 48;
+		double lower[3] = {-1.5, -1.5, -1.5};
+		double upper[3] = {1.5, 1.5, 1.5};
+		std::vector<double> vertices;
+		std::vector<size_t> polygons;
+		std::vector<double> colorIndices;
+		bool stop = false;
+		mc::marching_cubes<double, double[3], sPerfField, sPerfNoProgress>(lower, upper, size, size,
+			size, sPerfField(), 0.0, vertices, polygons, &stop, sPerfNoProgress(), colorIndices);
+		return (double)(size - 1) * (size - 1) * (size - 1);
+	}
+};
+
 void Test::renderExamples()
 {
 	// this renders all example files in a resolution of 5x5 px
@@ -245,3 +578,1708 @@ void Test::testKeyframe()
 	testKeyframeAnimation = NULL;
 	return;
 }
+
+void Test::testKeyframePrecalculatedFrames()
+{
+	// frames precalculated before changes of keyframes are not used
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+
+	cKeyframes keyframes;
+	keyframes.AddAnimatedParameter("main_DE_factor", &testPar, &testParFractal);
+	const double values[4] = {1.0, 2.0, 4.0, 8.0};
+	for (int i = 0; i < 4; i++)
+	{
+		testPar.Set("DE_factor", values[i]);
+		keyframes.AddFrame(testPar, testParFractal);
+	}
+
+	keyframes.PrecalculateInterpolatedFrames(0, 15);
+	cAnimationFrames::sAnimationFrame keyframe = keyframes.GetFrame(1);
+	keyframe.parameters.Set("main_DE_factor", 10.0);
+	keyframes.ModifyFrame(1, keyframe);
+	keyframes.GetInterpolatedFrameAndConsolidate(5, &testPar, &testParFractal);
+	QCOMPARE(testPar.Get<double>("DE_factor"), 10.0);
+
+	keyframes.PrecalculateInterpolatedFrames(0, 15);
+	keyframes.ChangeMorphType(0, parameterContainer::morphNone);
+	cKeyframes freshKeyframes = keyframes;
+	double expected = freshKeyframes.GetInterpolatedFrame(2).parameters.Get<double>("main_DE_factor");
+	keyframes.GetInterpolatedFrameAndConsolidate(2, &testPar, &testParFractal);
+	QCOMPARE(testPar.Get<double>("DE_factor"), expected);
+}
+
+void Test::testSinglePrecision()
+{
+	// renders the same example in double and single precision and compares the images
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("mandelbulb001.fract", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+	testPar.Set("packet_ray_marching", true);
+
+	cParameterContainer singlePar = testPar;
+	testPar.Set("single_precision", false);
+	singlePar.Set("single_precision", true);
+	sRenderComparison comparison;
+	double averageDifference = RenderAndCompare(testPar, singlePar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(averageDifference < 0.02,
+		QString("single precision image differs too much: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testOpenClRendering()
+{
+	// renders default scene by CPU and by OpenCL device and compares the images
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+
+	cParameterContainer openClPar = testPar;
+	testPar.Set("opencl_rendering_enabled", false);
+	openClPar.Set("opencl_rendering_enabled", true);
+	sRenderComparison comparison;
+	double averageDifference = RenderAndCompare(testPar, openClPar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+
+	// average difference of pixel values has to be small (single precision of device)
+	if (comparison.usedShaderVariant != "OpenCL") QSKIP("OpenCL device not available");
+	QVERIFY2(averageDifference < 0.05,
+		QString("OpenCL image differs too much: %1").arg(averageDifference).toStdString().c_str());
+}
+
+void Test::testDistanceCache()
+{
+	// image rendered with distances from the cache of previous render has to be almost the same
+	// as rendered without the cache
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("mandelbulb001.fract", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+
+	cParameterContainer cachedPar = testPar;
+	testPar.Set("distance_cache_enabled", false);
+	cachedPar.Set("distance_cache_enabled", true);
+	cachedPar.Set("distance_cache_persistent", false);
+
+	// the first render fills the cache, the second one uses it
+	sRenderComparison comparison;
+	comparison.testedRenders = 2;
+	double averageDifference = RenderAndCompare(testPar, cachedPar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(cDistanceCache::Instance()->GetNumberOfBricks() > 0, "distance cache is empty.");
+	QVERIFY2(averageDifference < 0.02,
+		QString("image rendered with distance cache differs too much: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testStereoSinglePass()
+{
+	// both eyes rendered in one pass have to look almost the same as eyes rendered separately
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+	testPar.Set("stereo_enabled", true);
+	testPar.Set("stereo_mode", (int)cStereo::stereoLeftRight);
+
+	cParameterContainer singlePassPar = testPar;
+	testPar.Set("stereo_single_pass", false);
+	singlePassPar.Set("stereo_single_pass", true);
+	sRenderComparison comparison;
+	double averageDifference =
+		RenderAndCompare(testPar, singlePassPar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(averageDifference < 0.02,
+		QString("single-pass stereo image differs too much: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testAdaptiveSampling()
+{
+	// equirectangular image with interpolated pixels near the poles has to be almost the same as
+	// fully rendered one
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+	testPar.Set("image_width", 64);
+	testPar.Set("image_height", 32);
+	testPar.Set("perspective_type", (int)params::perspEquirectangular);
+	testPar.Set("fov", 1.0);
+
+	cParameterContainer adaptivePar = testPar;
+	testPar.Set("adaptive_sampling_enabled", false);
+	adaptivePar.Set("adaptive_sampling_enabled", true);
+	sRenderComparison comparison;
+	double averageDifference = RenderAndCompare(testPar, adaptivePar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(averageDifference < 0.03,
+		QString("image rendered with adaptive sampling differs too much: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testJobArena()
+{
+	// buffers of the second frame have to fit in memory allocated for the first one
+	cJobArena arena;
+	for (int frame = 0; frame < 3; frame++)
+	{
+		arena.Reset();
+		qint64 capacity = arena.GetCapacity();
+		int *lines = arena.NewArray<int>(100000);
+		QVERIFY2(((quintptr)lines % 64) == 0, "arena memory is not aligned");
+		QVERIFY2(lines[0] == 0 && lines[99999] == 0, "arena array is not initialised");
+		cJobArena::sMark mark = arena.GetMark();
+		for (int i = 0; i < 10; i++)
+			arena.NewArray<float>(500000);
+		arena.Release(mark);
+		float *buffer = arena.NewArray<float>(500000);
+		buffer[0] = 1.0f;
+		if (frame > 0)
+		{
+			QVERIFY2(arena.GetCapacity() == capacity,
+				QString("arena grew at frame %1").arg(frame).toStdString().c_str());
+		}
+	}
+}
+
+void Test::testDEFactorOptimizer()
+{
+	// found factor has to meet the target and should be bigger for less strict target
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("image_width", 256);
+	testPar->Set("image_height", 256);
+
+	bool stopRequest = false;
+	cDEFactorOptimizer optimizer(testPar, testParFractal);
+	double missedStrict = 0.0;
+	double factorStrict = optimizer.Optimize(0.1, &stopRequest, &missedStrict);
+	double missedLoose = 0.0;
+	double factorLoose = optimizer.Optimize(5.0, &stopRequest, &missedLoose);
+
+	QVERIFY2(optimizer.GetNumberOfHits() > 0, "reference rays don't hit the fractal");
+	QVERIFY2(factorStrict > 0.0 && missedStrict < 0.1,
+		QString("DE factor %1 gives %2% of wrong rays")
+			.arg(factorStrict)
+			.arg(missedStrict)
+			.toStdString()
+			.c_str());
+	QVERIFY2(factorLoose >= factorStrict, "DE factor for less strict target is smaller");
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testRenderCheckpoint()
+{
+	// image resumed from checkpoint of finished render has to be the same as the rendered one
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	bool stopRequest = false;
+	const int size = 32;
+	testPar->Set("image_width", size);
+	testPar->Set("image_height", size);
+	QString checkpointFile = QDir::tempPath() + QDir::separator() + "test_render.checkpoint";
+	QFile::remove(checkpointFile);
+	QByteArray hash = cRenderCheckpoint::SettingsHash(testPar, testParFractal);
+
+	cImage *imageRendered = new cImage(size, size);
+	cImage *imageResumed = new cImage(size, size);
+	for (int i = 0; i < 2; i++)
+	{
+		cRenderingConfiguration config;
+		config.DisableRefresh();
+		config.DisableProgressiveRender();
+		config.DisableNetRender();
+		config.SetCheckpoint(checkpointFile, hash, 1, i == 1);
+		cImage *image = (i == 0) ? imageRendered : imageResumed;
+		cRenderJob *renderJob = new cRenderJob(testPar, testParFractal, image, &stopRequest);
+		renderJob->Init(cRenderJob::still, config);
+		QVERIFY2(renderJob->Execute(), "render with checkpoint failed.");
+		delete renderJob;
+	}
+
+	cRenderCheckpoint checkpoint(checkpointFile, size, size, hash);
+	cImage *imageLoaded = new cImage(size, size);
+	QVERIFY2(checkpoint.Load(imageLoaded).size() == size, "checkpoint doesn't contain all lines");
+	QFile::remove(checkpointFile);
+
+	bool same = true;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			sRGBfloat pixelRendered = imageRendered->GetPixelImage(x, y);
+			sRGBfloat pixelResumed = imageResumed->GetPixelImage(x, y);
+			if (pixelRendered.R != pixelResumed.R || pixelRendered.G != pixelResumed.G
+					|| pixelRendered.B != pixelResumed.B
+					|| imageRendered->GetPixelZBuffer(x, y) != imageResumed->GetPixelZBuffer(x, y))
+				same = false;
+		}
+	}
+	QVERIFY2(same, "resumed image differs from rendered one");
+
+	delete imageLoaded;
+	delete imageRendered;
+	delete imageResumed;
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testParameterSweep()
+{
+	// ranges are expanded to all combinations with the last parameter changing fastest
+	cParameterSweep sweep;
+	QVERIFY2(sweep.Parse("DE_factor=0.5:1:3#fractal1_power=6,8#N=10:20:2"), "sweep not parsed");
+	QCOMPARE(sweep.GetNumberOfVariations(), 12);
+	QCOMPARE(sweep.GetOverrides(0), QString("DE_factor=0.5#fractal1_power=6#N=10"));
+	QCOMPARE(sweep.GetOverrides(3), QString("DE_factor=0.5#fractal1_power=8#N=20"));
+	QCOMPARE(sweep.GetOverrides(11), QString("DE_factor=1#fractal1_power=8#N=20"));
+
+	// vectors are interpolated per component
+	QVERIFY(sweep.Parse("camera=0 0 1:2 4 3:3"));
+	QCOMPARE(sweep.GetOverrides(1), QString("camera=1 2 2"));
+
+	QVERIFY2(!sweep.Parse("DE_factor=1:2"), "range without number of steps accepted");
+	QVERIFY2(!sweep.Parse("camera=0 0:1 1 1:2"), "range with different sizes accepted");
+}
+
+void Test::testRenderTimeBudget()
+{
+	// quality is reduced only when the frame doesn't fit into the budget
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("image_width", 256);
+	testPar->Set("image_height", 256);
+	testPar->Set("antialiasing_enabled", true);
+	testPar->Set("antialiasing_size", 4);
+	double detailLevel = testPar->Get<double>("detail_level");
+
+	cParameterContainer largeBudgetPar = *testPar;
+	cRenderTimeBudget largeBudget(1e5);
+	QVERIFY2(largeBudget.Fit(&largeBudgetPar, *testParFractal), "estimation failed");
+	QVERIFY2(largeBudget.GetChanges().isEmpty(), "quality reduced with enough time");
+
+	cRenderTimeBudget tinyBudget(1e-6);
+	QVERIFY2(tinyBudget.Fit(testPar, *testParFractal), "estimation failed");
+	QVERIFY2(!testPar->Get<bool>("antialiasing_enabled"), "supersampling not reduced");
+	double minDetailLevel = detailLevel * RENDER_TIME_BUDGET_MIN_DETAIL * 0.999;
+	QVERIFY2(testPar->Get<double>("detail_level") >= minDetailLevel, "detail level reduced too much");
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testTileOrder()
+{
+	// Hilbert curve visits every tile once and goes only to neighbouring tiles
+	const int n = 8;
+	QVector<int> tileAtIndex(n * n, -1);
+	for (int i = 0; i < n * n; i++)
+	{
+		int d = cTileScheduler::HilbertIndex(n, i % n, i / n);
+		QVERIFY2(d >= 0 && d < n * n && tileAtIndex[d] < 0, "Hilbert index is not unique");
+		tileAtIndex[d] = i;
+	}
+	for (int d = 1; d < n * n; d++)
+	{
+		int dx = qAbs(tileAtIndex[d] % n - tileAtIndex[d - 1] % n);
+		int dy = qAbs(tileAtIndex[d] / n - tileAtIndex[d - 1] / n);
+		QVERIFY2(dx + dy == 1, "Hilbert curve jumps to not neighbouring tile");
+	}
+
+	// tile with focus point is rendered first and every tile is rendered once
+	cTileScheduler scheduler(cRegion<int>(0, 0, 256, 256), 1, 64, 2, false);
+	scheduler.SetTileOrder(cTileScheduler::tileOrderFocusFirst, 200, 40);
+	QCOMPARE(scheduler.NextTile(1), 3);
+	QSet<int> tiles;
+	tiles.insert(3);
+	int tile;
+	while ((tile = scheduler.NextTile(2)) >= 0)
+	{
+		QVERIFY2(!tiles.contains(tile), "tile taken twice");
+		tiles.insert(tile);
+	}
+	QCOMPARE(tiles.size(), 16);
+}
+
+void Test::testCheckerboard()
+{
+	// without previous frame missing pixels are averaged from rendered neighbours
+	const int size = 4;
+	cImage image(size, size);
+	cCheckerboardRender checkerboard;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			if (!checkerboard.IsRendered(x, y)) continue;
+			image.PutPixelImage(x, y, sRGBfloat(x * 0.1f, y * 0.1f, 0.5f));
+			image.PutPixelZBuffer(x, y, 1.0f + x);
+		}
+	}
+	QVERIFY2(
+		checkerboard.IsRendered(1, 1) != checkerboard.IsRendered(1, 2), "pattern not alternating");
+	int x = checkerboard.IsRendered(1, 1) ? 2 : 1;
+	checkerboard.Reconstruct(&image);
+	sRGBfloat pixel = image.GetPixelImage(x, 1);
+	QVERIFY2(qAbs(pixel.R - x * 0.1f) < 1e-5f, "pixel not interpolated");
+	QVERIFY2(qAbs(pixel.G - 0.1f) < 1e-5f, "pixel not interpolated");
+	QVERIFY2(image.GetPixelZBuffer(x, 1) <= 1.0f + x, "depth not taken from neighbours");
+}
+
+void Test::testDenoiser()
+{
+	// noise is removed, but edge between two surfaces in different distance stays sharp
+	const int size = 16;
+	cImage image(size, size);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			float base = x < size / 2 ? 0.2f : 0.8f;
+			float noise = ((x + y) & 1) ? 0.05f : -0.05f;
+			image.PutPixelImage(x, y, sRGBfloat(base + noise, base + noise, base + noise));
+			image.PutPixelZBuffer(x, y, x < size / 2 ? 1.0f : 10.0f);
+		}
+	}
+	bool stopRequest = false;
+	cPostRenderingDenoiser denoiser(&image);
+	denoiser.Render(cRegion<int>(0, 0, size, size), 1.0, 3, &stopRequest);
+
+	float maxError = 0.0f;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			float base = x < size / 2 ? 0.2f : 0.8f;
+			maxError = qMax(maxError, qAbs(image.GetPixelImage(x, y).G - base));
+		}
+	}
+	QVERIFY2(maxError < 0.02f, "noise not removed or edge blurred");
+}
+
+void Test::testHalfFloatImage()
+{
+	QCOMPARE(HalfToFloat(FloatToHalf(1.0f)), 1.0f);
+	QCOMPARE(HalfToFloat(FloatToHalf(-0.5f)), -0.5f);
+	QCOMPARE(FloatToHalf(65504.0f), (unsigned short)0x7bff);
+	QCOMPARE(FloatToHalf(1e10f), (unsigned short)0x7bff);
+	QCOMPARE(FloatToHalf(1e-10f), (unsigned short)0);
+
+	// half precision buffers give the same image as float buffers within precision of half
+	const int size = 8;
+	sImageOptional optional;
+	optional.optionalNormal = true;
+	cImage imageFloat(size, size);
+	imageFloat.ChangeSize(size, size, optional);
+	optional.halfFloat = true;
+	cImage imageHalf(size, size);
+	imageHalf.ChangeSize(size, size, optional);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			sRGBfloat pixel(x * 0.37f, y * 1.91f, 0.001f * (x + y));
+			imageFloat.PutPixelImage(x, y, pixel);
+			imageHalf.PutPixelImage(x, y, pixel);
+			imageHalf.PutPixelNormal(x, y, sRGBfloat(x / 8.0f, y / 8.0f, 0.5f));
+		}
+	}
+	imageFloat.CompileImage();
+	imageHalf.CompileImage();
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			sRGBfloat pixelFloat = imageFloat.GetPixelImage(x, y);
+			sRGBfloat pixelHalf = imageHalf.GetPixelImage(x, y);
+			QVERIFY2(qAbs(pixelHalf.G - pixelFloat.G) <= pixelFloat.G / 1024.0f, "wrong half pixel");
+			QVERIFY2(qAbs(imageHalf.GetPixelNormal(x, y).R - x / 8.0f) < 1e-6f, "wrong half normal");
+			sRGB16 compiledFloat = imageFloat.GetPixelImage16(x, y);
+			sRGB16 compiledHalf = imageHalf.GetPixelImage16(x, y);
+			QVERIFY2(qAbs(int(compiledHalf.R) - int(compiledFloat.R)) < 256, "wrong compiled image");
+		}
+	}
+}
+
+void Test::testComputeBatch()
+{
+	// lanes escaping at different iterations give the same results as Compute()
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("N", 250);
+
+	const int count = 16;
+	CVector3 points[count];
+	for (int k = 0; k < count; k++)
+		points[k] = CVector3(-2.0 + 4.0 * k / (count - 1), 0.13, 0.07 * k);
+
+	QString failures;
+	const fractal::enumFractalFormula formulas[2] = {fractal::mandelbulb, fractal::mandelbox};
+	for (int f = 0; f < 2; f++)
+	{
+		testPar->Set("formula", 1, (int)formulas[f]);
+		cParamRender params(testPar);
+		cNineFractals fractals(testParFractal, testPar);
+		sFractalIn fractIn(CVector3(), params.minN, params.N, params.common, -1);
+
+		sFractalOut batchOuts[count];
+		ComputeBatch<fractal::calcModeNormal>(fractals, fractIn, points, count, batchOuts);
+		for (int k = 0; k < count; k++)
+		{
+			sFractalOut out;
+			fractIn.point = points[k];
+			Compute<fractal::calcModeNormal>(fractals, fractIn, &out);
+			const sFractalOut &batchOut = batchOuts[k];
+			if (batchOut.iters != out.iters || batchOut.maxiter != out.maxiter
+					|| !std::isfinite(batchOut.distance)
+					|| qAbs(batchOut.distance - out.distance) > 1e-9 * qAbs(out.distance)
+					|| (batchOut.z - out.z).Length() > 1e-9 * out.z.Length())
+			{
+				failures += QString("formula %1, point %2: iters %3/%4, distance %5/%6\n")
+											.arg(f)
+											.arg(k)
+											.arg(batchOut.iters)
+											.arg(out.iters)
+											.arg(batchOut.distance)
+											.arg(out.distance);
+			}
+		}
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::testBatchNormals()
+{
+	// normals from batched taps (with iteration limit of normals) are the same as from single taps
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+
+	const double delta = 1e-4;
+	const CVector3 deltas[6] = {CVector3(delta, 0.0, 0.0), CVector3(-delta, 0.0, 0.0),
+		CVector3(0.0, delta, 0.0), CVector3(0.0, -delta, 0.0), CVector3(0.0, 0.0, delta),
+		CVector3(0.0, 0.0, -delta)};
+
+	QString failures;
+	const fractal::enumFractalFormula formulas[2] = {fractal::mandelbulb, fractal::mandelbox};
+	for (int f = 0; f < 2; f++)
+	{
+		testPar->Set("formula", 1, (int)formulas[f]);
+		cParamRender params(testPar);
+		cNineFractals fractals(testParFractal, testPar);
+
+		for (int p = 0; p < 8; p++)
+		{
+			CVector3 point(-1.5 + 0.4 * p, 0.21, 0.05 * p);
+			CVector3 points[6];
+			double detailSizes[6];
+			double batchDistances[6];
+			sDistanceOut outs[6];
+			for (int i = 0; i < 6; i++)
+			{
+				points[i] = point + deltas[i];
+				detailSizes[i] = delta;
+			}
+			CalculateDistanceBatch(
+				params, fractals, points, detailSizes, 6, batchDistances, outs, NULL, true);
+
+			double distances[6];
+			for (int i = 0; i < 6; i++)
+			{
+				sDistanceIn in(points[i], detailSizes[i], true);
+				sDistanceOut out;
+				distances[i] = CalculateDistance(params, fractals, in, &out);
+			}
+
+			CVector3 batchNormal(batchDistances[0] - batchDistances[1],
+				batchDistances[2] - batchDistances[3], batchDistances[4] - batchDistances[5]);
+			CVector3 normal(
+				distances[0] - distances[1], distances[2] - distances[3], distances[4] - distances[5]);
+			if (batchNormal.IsNotANumber() || (batchNormal - normal).Length() > 1e-9 * normal.Length())
+			{
+				failures += QString("formula %1, point %2: batch normal %3, normal %4\n")
+											.arg(f)
+											.arg(p)
+											.arg(batchNormal.Debug())
+											.arg(normal.Debug());
+			}
+		}
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::testOrbitTrapBatch()
+{
+	// orbit traps used by fake lights are the same when calculated in one batch
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	cParamRender params(testPar);
+	cNineFractals fractals(testParFractal, testPar);
+	sFractalIn fractIn(CVector3(), params.minN, params.N, params.common, -1);
+	CVector3 points[4] = {CVector3(0.3, -0.2, 0.4), CVector3(0.301, -0.2, 0.4),
+		CVector3(0.3, -0.199, 0.4), CVector3(2.0, 2.0, 2.0)};
+	sFractalOut batchOuts[4];
+	ComputeBatch<fractal::calcModeOrbitTrap>(fractals, fractIn, points, 4, batchOuts);
+	for (int k = 0; k < 4; k++)
+	{
+		sFractalOut out;
+		fractIn.point = points[k];
+		Compute<fractal::calcModeOrbitTrap>(fractals, fractIn, &out);
+		QVERIFY2(qAbs(out.orbitTrapR - batchOuts[k].orbitTrapR) <= 1e-9 * qAbs(out.orbitTrapR),
+			"orbit trap of batch is different");
+	}
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testPeriodicityCheck()
+{
+	// iterations of interior point stop early, exterior point is not affected
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+	testPar->Set("N", 250);
+	testPar->Set("periodicity_check", true);
+
+	cParamRender params(testPar);
+	cNineFractals fractals(testParFractal, testPar);
+	sFractalOut out;
+	sFractalIn interiorIn(CVector3(0.05, 0.02, 0.01), params.minN, params.N, params.common, -1);
+	Compute<fractal::calcModeNormal>(fractals, interiorIn, &out);
+	QVERIFY2(out.periodic && out.maxiter, "periodic orbit not detected");
+	QVERIFY2(out.iters < params.N, "iterations not stopped");
+
+	sFractalIn exteriorIn(CVector3(3.0, 3.0, 3.0), params.minN, params.N, params.common, -1);
+	Compute<fractal::calcModeNormal>(fractals, exteriorIn, &out);
+	QVERIFY2(!out.periodic && !out.maxiter, "exterior point treated as periodic");
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testIterationOps()
+{
+	// compiled operations of hybrid slots follow julia mode and formula weights
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	{
+		cNineFractals fractals(testParFractal, testPar);
+		const sIterationOps &ops = fractals.GetIterationOps(0);
+		QVERIFY2(ops.ops & iterationOpFormula, "formula not called");
+		QVERIFY2(ops.ops & iterationOpAddC, "c constant not added");
+		QVERIFY2(!(ops.ops & iterationOpSmooth), "smoothing without hybrid");
+
+		// hot block mirrors values used by vectorized kernels and escape conditions
+		const sFormulaHotParams &hot = fractals.GetHotParams(0);
+		QVERIFY2(hot.formula == fractals.GetFractal(0)->formula, "wrong formula in hot block");
+		QVERIFY2(hot.bulbPower == fractals.GetFractal(0)->bulb.power, "wrong bulb power");
+		QVERIFY2(hot.bailout == fractals.GetBailout(0), "wrong bailout");
+		QVERIFY2(hot.checkForBailout == fractals.IsCheckForBailout(0), "wrong bailout check");
+	}
+
+	testPar->Set("hybrid_fractal_enable", true);
+	testPar->Set("formula_weight", 1, 0.0);
+	testPar->Set("julia_mode", true);
+	testPar->Set("julia_c", CVector3(0.1, 0.2, 0.3));
+	testPar->Set("fractal_constant_factor", CVector3(2.0, 2.0, 2.0));
+	{
+		cNineFractals fractals(testParFractal, testPar);
+		const sIterationOps &ops = fractals.GetIterationOps(0);
+		QVERIFY2(!(ops.ops & iterationOpFormula), "formula with zero weight called");
+		QVERIFY2(ops.ops & iterationOpSmooth, "hybrid weight not used");
+		QVERIFY2(ops.ops & iterationOpAddJuliaC, "julia constant not added");
+		QVERIFY2((ops.juliaC - CVector3(0.2, 0.4, 0.6)).Length() < 1e-12, "wrong julia constant");
+	}
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testNetRenderMulticast()
+{
+	// texture is reported only when all chunks arrived and content matches the hash
+	QByteArray content;
+	for (int i = 0; i < 3 * NETRENDER_MULTICAST_CHUNK_SIZE + 100; i++)
+		content.append(char(i * 7));
+	QByteArray hash = QCryptographicHash::hash(content, QCryptographicHash::Sha1);
+	int numberOfChunks = cNetRenderMulticast::NumberOfChunks(content.size());
+	QVERIFY2(numberOfChunks == 4, "wrong number of chunks");
+
+	cNetRenderMulticast receiver;
+	QByteArray receivedHash;
+	QByteArray receivedContent;
+	for (int i = numberOfChunks - 1; i > 0; i--)
+	{
+		QByteArray datagram = cNetRenderMulticast::EncodeChunk(hash, content, i);
+		QVERIFY2(!receiver.ProcessDatagram(datagram, &receivedHash, &receivedContent),
+			"texture completed too early");
+		QVERIFY2(!receiver.ProcessDatagram(datagram, &receivedHash, &receivedContent),
+			"duplicated chunk completed texture");
+	}
+	QVERIFY2(!receiver.ProcessDatagram(QByteArray("foreign datagram"), &receivedHash,
+						 &receivedContent),
+		"foreign datagram accepted");
+	QVERIFY2(receiver.ProcessDatagram(cNetRenderMulticast::EncodeChunk(hash, content, 0),
+						 &receivedHash, &receivedContent),
+		"texture not completed");
+	QVERIFY2(receivedHash == hash && receivedContent == content, "wrong texture content");
+
+	// content which doesn't match the hash is rejected
+	QByteArray wrongHash = QCryptographicHash::hash(QByteArray("other"), QCryptographicHash::Sha1);
+	bool completed = false;
+	for (int i = 0; i < numberOfChunks; i++)
+	{
+		completed |= receiver.ProcessDatagram(
+			cNetRenderMulticast::EncodeChunk(wrongHash, content, i), &receivedHash, &receivedContent);
+	}
+	QVERIFY2(!completed, "content with wrong hash accepted");
+}
+
+void Test::testNetRenderLineDecoder()
+{
+	// compressed half precision line is decoded directly to float and half image buffers
+	const int width = 5;
+	int flags = lineDataHalfFloat | lineDataNormal | lineDataCompressed;
+	QByteArray uncompressed;
+	for (int x = 0; x < width; x++)
+	{
+		sRGBhalf pixel = PixelToHalf(sRGBfloat(x * 0.5f, 1.0f, 0.25f));
+		uncompressed.append((const char *)&pixel, sizeof(pixel));
+	}
+	for (int x = 0; x < width; x++)
+	{
+		unsigned short alpha = 1000 * x;
+		uncompressed.append((const char *)&alpha, sizeof(alpha));
+	}
+	for (int x = 0; x < width; x++)
+	{
+		float z = 10.0f + x;
+		uncompressed.append((const char *)&z, sizeof(z));
+	}
+	for (int x = 0; x < width; x++)
+	{
+		sRGBhalf normal = PixelToHalf(sRGBfloat(0.0f, 0.0f, 1.0f));
+		uncompressed.append((const char *)&normal, sizeof(normal));
+	}
+	QCOMPARE(uncompressed.size(), cNetRenderLineDecoder::LinePixelSize(flags) * width);
+	QByteArray line;
+	line.append(char(flags));
+	line.append(qCompress(uncompressed, 1));
+
+	for (int precision = 0; precision < 2; precision++)
+	{
+		sImageOptional optional;
+		optional.optionalNormal = true;
+		optional.halfFloat = precision == 1;
+		cImage image(width, 3);
+		image.ChangeSize(width, 3, optional);
+		cNetRenderLineDecoder decoder(&image);
+		QList<QByteArray> lines;
+		lines.append(line);
+		lines.append(line.left(line.size() / 2)); // truncated stream
+		lines.append(line);
+		decoder.slotDecodeLines(QList<int>() << 1 << 0 << 2, lines);
+
+		// lines after the corrupted one are decoded as well
+		QList<int> decoded = decoder.TakeDecodedLines();
+		QVERIFY2(decoded == QList<int>() << 1 << 2, "corrupted line accepted or valid line dropped");
+		for (int y = 1; y < 3; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				QCOMPARE(image.GetPixelImage(x, y).R, x * 0.5f);
+				QCOMPARE(image.GetPixelAlpha(x, y), (unsigned short)(1000 * x));
+				QCOMPARE(image.GetPixelZBuffer(x, y), 10.0f + x);
+				QCOMPARE(image.GetPixelNormal(x, y).z, 1.0f);
+			}
+		}
+	}
+}
+
+void Test::testMemoryEstimator()
+{
+	// estimate of image buffers matches memory reported by allocated image
+	const int width = 512;
+	const int height = 512;
+	for (int variant = 0; variant < 4; variant++)
+	{
+		sImageOptional optional;
+		optional.optionalNormal = true;
+		optional.optionalObjectId = variant == 1;
+		optional.leanMemory = variant >= 2;
+		optional.halfFloat = variant == 3;
+		cImage image(width, height);
+		image.ChangeSize(width, height, optional);
+		QCOMPARE(
+			int(cMemoryEstimator::ImageBytes(width, height, optional) / 1024 / 1024), image.GetUsedMB());
+	}
+
+	// too small budget switches image to lean and half precision buffers
+	cParameterContainer *testPar = new cParameterContainer;
+	testPar->SetContainerName("main");
+	InitParams(testPar);
+	InitMaterialParams(1, testPar);
+	testPar->Set("image_scratch_folder", QString());
+
+	sImageOptional compact = cMemoryEstimator::ImageOptionalFromParams(testPar);
+	compact.leanMemory = true;
+	compact.halfFloat = true;
+	qint64 budget = cMemoryEstimator::EstimateJob(testPar, 1000, 1000, compact).Total();
+
+	sImageOptional optional = cMemoryEstimator::ImageOptionalFromParams(testPar);
+	QVERIFY(cMemoryEstimator::FitToBudget(testPar, 1000, 1000, budget, &optional));
+	QVERIFY(optional.leanMemory && optional.halfFloat && !optional.memoryMapped);
+
+	optional = cMemoryEstimator::ImageOptionalFromParams(testPar);
+	QVERIFY2(!cMemoryEstimator::FitToBudget(testPar, 1000, 1000, budget - 1, &optional),
+		"job accepted over the budget");
+
+	delete testPar;
+}
+
+void Test::testBumpMapSlopes()
+{
+	// precomputed slopes give the same normals as bump map sampled around texel
+	QImage bumpImage(16, 16, QImage::Format_RGB888);
+	for (int y = 0; y < 16; y++)
+		for (int x = 0; x < 16; x++)
+			bumpImage.setPixel(x, y, qRgb((x * x + 3 * y) % 256, 0, 0));
+	QByteArray buffer;
+	QBuffer device(&buffer);
+	device.open(QIODevice::WriteOnly);
+	bumpImage.save(&device, "PNG");
+
+	cTexture texture;
+	texture.FromQByteArray(&buffer, cTexture::doNotUseMipmaps);
+	QVERIFY(texture.IsLoaded());
+	cTexture prepared = texture;
+	prepared.PrepareBumpMapSlopes();
+
+	for (int i = 0; i < 16; i++)
+	{
+		CVector2<double> point((i % 12 + 2) / 16.0, (i + 1) / 16.0);
+		CVector3 expected = texture.NormalMapFromBumpMap(point, 2.0);
+		CVector3 normal = prepared.NormalMapFromBumpMap(point, 2.0);
+		QVERIFY2((normal - expected).Length() < 1e-4, "normal from slopes doesn't match");
+	}
+}
+
+void Test::testPlayerFrameCache()
+{
+	// frames are decoded downscaled and the following ones are prefetched in background
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QStringList fileNames;
+	for (int i = 0; i < 3; i++)
+	{
+		QImage frame(200, 100, QImage::Format_RGB32);
+		frame.fill(qRgb(i * 100, 0, 0));
+		QString fileName = QString("frame_%1.png").arg(i);
+		QVERIFY(frame.save(dir.path() + "/" + fileName));
+		fileNames.append(fileName);
+	}
+
+	cPlayerFrameCache frameCache;
+	frameCache.SetFiles(dir.path(), fileNames);
+	frameCache.SetTargetSize(QSize(50, 50));
+	QImage frame = frameCache.GetFrame(0);
+	QCOMPARE(frame.size(), QSize(50, 25));
+	QVERIFY(frameCache.IsCached(0));
+	QTRY_VERIFY(frameCache.IsCached(1) && frameCache.IsCached(2));
+	QCOMPARE(qRed(frameCache.GetFrame(2).pixel(10, 10)), 200);
+
+	// frames of other size are decoded again
+	frameCache.SetTargetSize(QSize(100, 100));
+	QVERIFY(!frameCache.IsCached(1));
+	QCOMPARE(frameCache.GetFrame(1).size(), QSize(100, 50));
+}
+
+void Test::testBoundingBoxSampled()
+{
+	// sampled bounding box contains limit found by plane search and is not much bigger
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("limits_enabled", false);
+	cParamRender params(testPar);
+	cNineFractals fractals(testParFractal, testPar);
+	bool stop = false;
+
+	const double outerBounding = 2.0;
+	const int samples = 32;
+	CVector3 boxMin, boxMax;
+	QVERIFY(CalculateBoundingBoxSampled(
+		params, fractals, outerBounding, samples, &boxMin, &boxMax, &stop));
+
+	double planeMinX = -outerBounding
+										 + CalculateDistanceMinPlane(params, fractals, CVector3(-outerBounding, 0, 0),
+											 CVector3(1, 0, 0), CVector3(0, 1, 0), &stop);
+	double cellSize = 2.0 * outerBounding / samples;
+	QVERIFY2(boxMin.x <= planeMinX + 0.5 * cellSize, "sampled box is smaller than the fractal");
+	QVERIFY2(boxMin.x > planeMinX - 2.0 * cellSize, "sampled box is too big");
+	QVERIFY(boxMax.x > boxMin.x && boxMax.y > boxMin.y && boxMax.z > boxMin.z);
+
+	delete testPar;
+	delete testParFractal;
+}
+
+void Test::testDoubleDouble()
+{
+	// arithmetic keeps digits beyond double precision
+	sDoubleDouble one(1.0);
+	sDoubleDouble small = (one + 1e-20) - one;
+	QVERIFY2(qAbs(small.ToDouble() - 1e-20) < 1e-30, "lost low part of sum");
+	sDoubleDouble root = sqrt(sDoubleDouble(2.0));
+	QVERIFY2(qAbs((root * root - 2.0).ToDouble()) < 1e-30, "wrong square root");
+	sDoubleDouble third = one / 3.0;
+	QVERIFY2(qAbs((third * 3.0 - one).ToDouble()) < 1e-30, "wrong division");
+
+	// lanes escaping at different iterations give the same results as Compute()
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("formula", 1, (int)fractal::mandelbox);
+	testPar->Set("N", 60);
+	cParamRender params(testPar);
+	cNineFractals fractals(testParFractal, testPar);
+	sFractalIn fractIn(CVector3(), params.minN, params.N, params.common, -1);
+
+	const int count = 10;
+	CVector3 points[count];
+	CVector3 pointsLow[count];
+	for (int k = 0; k < count - 2; k++)
+		points[k] = CVector3(-6.0 + 1.5 * k, 0.2 + 0.3 * k, 0.3);
+	points[count - 2] = points[count - 1] = CVector3(0.1, 0.2, 0.3);
+	pointsLow[count - 1] = CVector3(1e-20, 0.0, 0.0);
+	sFractalOut outsDD[count];
+	ComputeBatch<fractal::calcModeNormal>(fractals, fractIn, points, count, outsDD, false, pointsLow);
+
+	QString failures;
+	for (int k = 0; k < count - 1; k++)
+	{
+		sFractalOut out;
+		fractIn.point = points[k];
+		Compute<fractal::calcModeNormal>(fractals, fractIn, &out);
+		if (outsDD[k].iters != out.iters || outsDD[k].maxiter != out.maxiter
+				|| !(qAbs(outsDD[k].distance - out.distance) <= 1e-6 * qAbs(out.distance)))
+		{
+			failures += QString("point %1: iters %2/%3, distance %4/%5\n")
+										.arg(k)
+										.arg(outsDD[k].iters)
+										.arg(out.iters)
+										.arg(outsDD[k].distance)
+										.arg(out.distance);
+		}
+	}
+
+	// points closer than double precision give different orbits
+	if (outsDD[count - 2].z == outsDD[count - 1].z) failures += "low part of the point is ignored\n";
+
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::testWavefrontShadows()
+{
+	// shadows traced from sorted tile queues have to be the same as shadows traced by shaders
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+	testPar.Set("tile_scheduler_enabled", true);
+	testPar.Set("tile_size", 16);
+	testPar.Set("packet_ray_marching", true);
+	testPar.Set("shadows_enabled", true);
+
+	cParameterContainer wavefrontPar = testPar;
+	testPar.Set("wavefront_shadows", false);
+	wavefrontPar.Set("wavefront_shadows", true);
+	sRenderComparison comparison;
+	double averageDifference = RenderAndCompare(testPar, wavefrontPar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(averageDifference < 0.001,
+		QString("image with wavefront shadows differs: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testDeferredPostProcessing()
+{
+	// effects calculated by frame pipeline have to be the same as effects done by the renderer
+	cParameterContainer testPar;
+	cFractalContainer testParFractal;
+	loadPerfScene("", &testPar, &testParFractal);
+	testPar.Set("image_width", 32);
+	testPar.Set("image_height", 32);
+	testPar.Set("ambient_occlusion_enabled", true);
+	testPar.Set("ambient_occlusion_mode", (int)params::AOmodeScreenSpace);
+	testPar.Set("DOF_enabled", true);
+
+	sRenderComparison comparison;
+	comparison.deferredPostProcessing = true;
+	double averageDifference = RenderAndCompare(testPar, testPar, testParFractal, &comparison);
+	QVERIFY2(averageDifference >= 0.0, comparison.error.toStdString().c_str());
+	QVERIFY2(!comparison.referenceDeferred, "effects deferred without request.");
+	QVERIFY2(comparison.testedDeferred, "effects were not deferred.");
+	QVERIFY2(averageDifference < 0.01,
+		QString("image with deferred effects differs: %1")
+			.arg(averageDifference)
+			.toStdString()
+			.c_str());
+}
+
+void Test::testThumbnailStore()
+{
+	// thumbnails are found after reopening, legacy files are imported and least recently used
+	// thumbnails are dropped when the file is too big
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString storeFile = dir.path() + "/thumbnails.pack";
+	QString hashA = "0123456789abcdef0123456789abcdef";
+	QString hashB = "fedcba9876543210fedcba9876543210";
+	QString hashC = "00000000000000000000000000000000";
+
+	// noise doesn't compress, so size of PNG data is known approximately (about 30 kB)
+	QImage noise(100, 100, QImage::Format_RGB888);
+	cRandom random;
+	random.Initialize(1234);
+	for (int y = 0; y < noise.height(); y++)
+		for (int x = 0; x < noise.width(); x++)
+			noise.setPixel(x, y, qRgb(random.Random(255), random.Random(255), random.Random(255)));
+
+	{
+		cThumbnailStore store(storeFile);
+		QVERIFY(!store.Contains(hashA));
+		store.Insert(hashA, noise);
+		store.Insert(hashB, noise);
+		QCOMPARE(store.Count(), 2);
+	}
+	{
+		cThumbnailStore store(storeFile);
+		QCOMPARE(store.Count(), 2);
+		QImage image;
+		QVERIFY(store.Find(hashA, &image));
+		QCOMPARE(image.size(), noise.size());
+		QCOMPARE(image.pixel(10, 20), noise.pixel(10, 20));
+		store.Clear();
+		QCOMPARE(store.Count(), 0);
+	}
+
+	QVERIFY(noise.save(dir.path() + "/" + hashC + ".png"));
+	{
+		cThumbnailStore store(storeFile, THUMBNAIL_STORE_MAX_SIZE, dir.path());
+		QVERIFY(store.Contains(hashC));
+		QVERIFY(!QFile::exists(dir.path() + "/" + hashC + ".png"));
+	}
+
+	{
+		// limit for two thumbnails, so inserting the third one drops the least recently used
+		cThumbnailStore store(dir.path() + "/small.pack", 80 * 1024);
+		store.Insert(hashA, noise);
+		store.Insert(hashB, noise);
+		store.Touch(hashA);
+		store.Insert(hashC, noise);
+		QVERIFY(store.FileSize() <= 80 * 1024);
+		QVERIFY(store.Contains(hashC));
+		QVERIFY(!store.Contains(hashB));
+	}
+}
+
+void Test::testStructuralHash()
+{
+	// hash follows changes of standard parameters and doesn't depend on order of changes
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	QString hash = cSettings::StructuralHash(testPar, testParFractal);
+	cParameterContainer copy = *testPar;
+	QCOMPARE(cSettings::StructuralHash(&copy, testParFractal), hash);
+
+	double fov = testPar->Get<double>("fov");
+	testPar->Set("fov", fov * 2.0);
+	QString changedHash = cSettings::StructuralHash(testPar, testParFractal);
+	QVERIFY2(changedHash != hash, "change of parameter not detected");
+	testPar->Set("fov", fov);
+	QCOMPARE(cSettings::StructuralHash(testPar, testParFractal), hash);
+
+	// application settings are not stored in settings files
+	testPar->Set("ui_style_type", testPar->Get<int>("ui_style_type") + 1);
+	QCOMPARE(cSettings::StructuralHash(testPar, testParFractal), hash);
+
+	testParFractal->at(0).Set("power", testParFractal->at(0).Get<double>("power") + 1.0);
+	QVERIFY2(
+		cSettings::StructuralHash(testPar, testParFractal) != hash, "fractal change not detected");
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testSettingsPreviewLoader()
+{
+	// settings are decoded in background and only the last request is reported
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+	QStringList fileNames;
+	for (int i = 0; i < 2; i++)
+	{
+		testPar->Set("description", QString("preview %1").arg(i));
+		cSettings parSettings(cSettings::formatCondensedText);
+		parSettings.CreateText(testPar, testParFractal);
+		fileNames.append(dir.path() + QString("/preview%1.fract").arg(i));
+		QVERIFY(parSettings.SaveToFile(fileNames.last()));
+	}
+
+	cSettingsPreviewLoader loader;
+	QSignalSpy spy(&loader,
+		SIGNAL(settingsLoaded(QString, bool, QString, cParameterContainer, cFractalContainer, bool)));
+	loader.Request(fileNames[0], 50, 50, 1);
+	loader.Request(fileNames[1], 50, 50, 1);
+	QTRY_COMPARE(spy.count(), 1);
+	QCOMPARE(spy.at(0).at(0).toString(), fileNames[1]);
+	QVERIFY2(spy.at(0).at(1).toBool(), "settings not decoded");
+	QCOMPARE(spy.at(0).at(2).toString(), QString("preview 1"));
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testVoxelSlab()
+{
+	// slab calculated by NetRender client contains the same voxels as layers of the whole volume
+	cParameterContainer savedPar = *gPar;
+	cFractalContainer savedParFractal = *gParFractal;
+	loadPerfScene("mandelbulb001.fract", gPar, gParFractal);
+
+	const int size = 24;
+	CVector3 limitMin(-1.5, -1.5, -1.5);
+	CVector3 limitMax(1.5, 1.5, 1.5);
+	bool stopRequest = false;
+	QByteArray volume, volumeDistances;
+	cVoxelExport volumeExport(size, size, size, limitMin, limitMax, QDir(), 30);
+	QVERIFY(volumeExport.CalculateSlab(0, size, false, &volume, &volumeDistances, &stopRequest));
+	QCOMPARE(volume.size(), size * size * size);
+	QVERIFY2(volume.count(char(1)) > 0 && volume.count(char(0)) > 0, "empty volume");
+
+	const int firstZ = 10;
+	const int layers = 7;
+	QByteArray slab, slabDistances;
+	cVoxelExport slabExport(size, size, size, limitMin, limitMax, QDir(), 30);
+	QVERIFY(slabExport.CalculateSlab(firstZ, layers, true, &slab, &slabDistances, &stopRequest));
+	QCOMPARE(slab, volume.mid(firstZ * size * size, layers * size * size));
+	QCOMPARE(slabDistances.size(), slab.size() * int(sizeof(float)));
+
+	// stopped calculation is reported, so the server calculates the slab again
+	stopRequest = true;
+	QVERIFY(!slabExport.CalculateSlab(firstZ, layers, false, &slab, &slabDistances, &stopRequest));
+
+	*gPar = savedPar;
+	*gParFractal = savedParFractal;
+}
+
+void Test::testNetRenderPostTiles()
+{
+	// bands cover the image and put together give the same image as processing of whole image
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("ambient_occlusion_enabled", false);
+	testPar->Set("DOF_enabled", false);
+	cParamRender params(testPar);
+
+	const int width = 16;
+	const int height = 300;
+	cImage image(width, height);
+	image.SetImageParameters(params.imageAdjustments);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			image.PutPixelImage(x, y, sRGBfloat(x / 16.0f, y / 300.0f, 0.5f));
+			image.PutPixelAlpha(x, y, 65535);
+			image.PutPixelZBuffer(x, y, 1.0f + x + y);
+		}
+	}
+	image.CompileImage();
+
+	QList<sPostTileJob> tiles = cNetRenderPostTiles::CreateTiles(height, 10, 2);
+	QVERIFY(tiles.size() > 1);
+	QCOMPARE(tiles.first().y1, 0);
+	QCOMPARE(tiles.last().y2, height);
+	for (int i = 1; i < tiles.size(); i++)
+	{
+		QCOMPARE(tiles.at(i).y1, tiles.at(i - 1).y2);
+		QCOMPARE(tiles.at(i).haloY1, tiles.at(i).y1 - 10);
+	}
+
+	bool stopRequest = false;
+	cImage result(width, height);
+	for (int i = 0; i < tiles.size(); i++)
+	{
+		cImage *tileImage = cNetRenderPostTiles::CreateTileImage(&image, tiles.at(i));
+		QByteArray data = cNetRenderPostTiles::RenderTile(
+			&params, tileImage, tiles.at(i), width, height, &stopRequest);
+		delete tileImage;
+		QVERIFY(cNetRenderPostTiles::ApplyTile(&result, tiles.at(i), data));
+	}
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			QCOMPARE(result.GetPixelImage16(x, y).R, image.GetPixelImage16(x, y).R);
+			QCOMPARE(result.GetPixelImage16(x, y).G, image.GetPixelImage16(x, y).G);
+		}
+	}
+
+	// band image is built from line data of client. Missing line is detected
+	const sPostTileJob &tile = tiles.first();
+	QList<int> lineNumbers;
+	QList<QByteArray> lines;
+	for (int y = tile.haloY1; y < tile.haloY2; y++)
+	{
+		QByteArray line(1, char(0));
+		for (int x = 0; x < width; x++)
+		{
+			sRGBfloat pixel = image.GetPixelImage(x, y);
+			line.append((const char *)&pixel, sizeof(pixel));
+		}
+		for (int x = 0; x < width; x++)
+		{
+			unsigned short alpha = image.GetPixelAlpha(x, y);
+			line.append((const char *)&alpha, sizeof(alpha));
+		}
+		for (int x = 0; x < width; x++)
+		{
+			float z = image.GetPixelZBuffer(x, y);
+			line.append((const char *)&z, sizeof(z));
+		}
+		lineNumbers.append(y);
+		lines.append(line);
+	}
+	cImage *tileImage = cNetRenderPostTiles::CreateTileImage(width, tile, lineNumbers, lines);
+	QVERIFY(tileImage);
+	QCOMPARE(tileImage->GetPixelZBuffer(3, 5), image.GetPixelZBuffer(3, tile.haloY1 + 5));
+	delete tileImage;
+	lineNumbers.removeLast();
+	lines.removeLast();
+	QVERIFY2(!cNetRenderPostTiles::CreateTileImage(width, tile, lineNumbers, lines),
+		"band with missing line accepted");
+
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testPreviewImageAdjustments()
+{
+	// adjustments previewed on downsampled image give the same colours as compiled image
+	const int size = 64;
+	cImage image(size, size);
+	image.CreatePreview(0.25, size / 4, size / 4, NULL);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			image.PutPixelImage(x, y, sRGBfloat(0.2f, 0.5f, 1.5f));
+	image.CompileImage();
+	image.UpdatePreview();
+
+	sImageAdjustments adjustments;
+	adjustments.brightness = 1.5;
+	adjustments.contrast = 0.8;
+	adjustments.imageGamma = 2.2;
+	adjustments.hdrEnabled = true;
+	image.PreviewImageAdjustments(adjustments);
+	QVERIFY(image.IsAdjustmentsPreviewOnly());
+	sRGB8 previewPixel = ((sRGB8 *)image.GetPreviewPtr())[5 + 3 * image.GetPreviewWidth()];
+
+	image.CompileImage();
+	QVERIFY(!image.IsAdjustmentsPreviewOnly());
+	sRGB16 pixel = image.GetPixelImage16(20, 12);
+	QCOMPARE(int(previewPixel.R), pixel.R / 256);
+	QCOMPARE(int(previewPixel.G), pixel.G / 256);
+	QCOMPARE(int(previewPixel.B), pixel.B / 256);
+}
+
+void Test::testAutosaveJournal()
+{
+	// changes of parameters are appended to journal and applied when autosave is loaded
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString snapshotFile = dir.path() + "/.autosave.fract";
+	QString journalFile = dir.path() + "/.autosave.journal";
+
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+
+	cAutosave autosave(snapshotFile, journalFile);
+	autosave.Store(testPar, testParFractal, NULL, NULL);
+	autosave.WaitForFinish();
+	QVERIFY(QFile::exists(snapshotFile));
+	QVERIFY(!QFile::exists(journalFile));
+	QDateTime snapshotTime = QFileInfo(snapshotFile).lastModified();
+	qint64 snapshotSize = QFileInfo(snapshotFile).size();
+
+	testPar->Set("brightness", 1.7);
+	testParFractal->at(0).Set("power", 5.0);
+	autosave.Store(testPar, testParFractal, NULL, NULL);
+	autosave.WaitForFinish();
+	QVERIFY(QFile::exists(journalFile));
+	QCOMPARE(QFileInfo(snapshotFile).lastModified(), snapshotTime);
+	QVERIFY(QFileInfo(journalFile).size() < snapshotSize);
+
+	cParameterContainer *loadedPar = new cParameterContainer;
+	cFractalContainer *loadedParFractal = new cFractalContainer;
+	loadPerfScene("", loadedPar, loadedParFractal);
+	QVERIFY(autosave.Load(loadedPar, loadedParFractal, NULL, NULL));
+	QCOMPARE(loadedPar->Get<double>("brightness"), 1.7);
+	QCOMPARE(loadedParFractal->at(0).Get<double>("power"), 5.0);
+
+	autosave.Remove();
+	QVERIFY(!autosave.Exists());
+	QVERIFY(!QFile::exists(journalFile));
+
+	delete loadedParFractal;
+	delete loadedPar;
+	delete testParFractal;
+	delete testPar;
+}
+
+void Test::testThumbnailSourceImage()
+{
+	// already rendered frame is scaled down to size of thumbnail, missing file gives null image
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString fileName = dir.path() + "/frame_00000.png";
+	QImage frame(400, 200, QImage::Format_RGB32);
+	frame.fill(qRgb(200, 100, 50));
+	QVERIFY(frame.save(fileName));
+
+	cThumbnailImageLoader loader(fileName, 100, 70);
+	QSignalSpy spy(&loader, SIGNAL(loaded(QImage)));
+	loader.slotLoad();
+	QCOMPARE(spy.count(), 1);
+	QImage thumbnail = spy.at(0).at(0).value<QImage>();
+	QCOMPARE(thumbnail.width(), 100);
+	QCOMPARE(thumbnail.height(), 50);
+	QCOMPARE(thumbnail.format(), QImage::Format_RGB888);
+	QCOMPARE(thumbnail.pixel(50, 25), qRgb(200, 100, 50));
+
+	cThumbnailImageLoader missingLoader(dir.path() + "/frame_00001.png", 100, 70);
+	QSignalSpy missingSpy(&missingLoader, SIGNAL(loaded(QImage)));
+	missingLoader.slotLoad();
+	QCOMPARE(missingSpy.count(), 1);
+	QVERIFY(missingSpy.at(0).at(0).value<QImage>().isNull());
+}
+
+void Test::testFillOptionalBlocks()
+{
+	// optional buffers written only at block origins are filled when rendering ends coarse
+	const int size = 16;
+	const int step = 4;
+	sImageOptional optional;
+	optional.optionalNormal = true;
+	optional.optionalCost = true;
+	cImage image(size, size);
+	image.ChangeSize(size, size, optional);
+	for (int y = 0; y < size; y += step)
+	{
+		for (int x = 0; x < size; x += step)
+		{
+			image.PutPixelNormal(x, y, sRGBfloat(x, y, 1.0f));
+			image.PutPixelCost(x, y, sRGBfloat(x + y, 0.0f, 0.0f));
+		}
+	}
+	image.FillOptionalBlocks(0, 0, size, size, step);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			int xOrigin = x / step * step;
+			int yOrigin = y / step * step;
+			QCOMPARE(image.GetPixelNormal(x, y).R, float(xOrigin));
+			QCOMPARE(image.GetPixelNormal(x, y).G, float(yOrigin));
+			QCOMPARE(image.GetPixelCost(x, y).R, float(xOrigin + yOrigin));
+		}
+	}
+}
+
+void Test::testDataFoldersStamp()
+{
+	// second start skips verification of folders, examples are not installed at startup
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString oldHidden = systemData.GetDataDirectoryHidden();
+	QString oldPublic = systemData.GetDataDirectoryPublic();
+	systemData.SetDataDirectoryHidden(dir.path() + "/.mandelbulber/");
+	systemData.SetDataDirectoryPublic(dir.path() + "/mandelbulber/");
+
+	QVERIFY(!IsDataFoldersStampValid());
+	QVERIFY(CreateDefaultFolders());
+	QVERIFY(IsDataFoldersStampValid());
+	QVERIFY(QDir(systemData.GetImagesFolder()).exists());
+	QCOMPARE(QDir(systemData.GetToolbarFolder())
+						 .entryList(QDir::NoDotAndDotDot | QDir::AllEntries)
+						 .count(),
+		0);
+
+	QVERIFY(QDir().rmdir(systemData.GetImagesFolder()));
+	QVERIFY(CreateDefaultFolders());
+	QVERIFY(!QDir(systemData.GetImagesFolder()).exists());
+
+	// stamp of other version makes the folders verified again
+	QFile stampFile(systemData.GetDataFoldersStampFile());
+	QVERIFY(stampFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	stampFile.write("0.0\n");
+	stampFile.close();
+	QVERIFY(!IsDataFoldersStampValid());
+	QVERIFY(CreateDefaultFolders());
+	QVERIFY(QDir(systemData.GetImagesFolder()).exists());
+
+	systemData.SetDataDirectoryHidden(oldHidden);
+	systemData.SetDataDirectoryPublic(oldPublic);
+}
+
+void Test::testDistanceQuery()
+{
+	// cached and batched distances are the same as calculated directly
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	QList<CVector3> points;
+	points << CVector3(2.0, 0.5, 0.1) << CVector3(0.0, -3.0, 1.0) << CVector3(1.5, 1.5, -1.5);
+	QList<double> expected;
+	{
+		cParamRender params(testPar);
+		cNineFractals fractals(testParFractal, testPar);
+		for (int i = 0; i < points.size(); i++)
+		{
+			sDistanceIn in(points[i], 0, false);
+			sDistanceOut out;
+			expected.append(CalculateDistance(params, fractals, in, &out));
+		}
+	}
+
+	qRegisterMetaType<QList<double> /* */>("QList<double>");
+	cDistanceQuery query;
+	QCOMPARE(query.GetDistance(points[0], testPar, testParFractal), expected[0]);
+	QCOMPARE(query.GetCacheSize(), 1);
+	// difference below quantization uses the cached distance
+	CVector3 nearPoint = points[0] * (1.0 + 1e-15);
+	QCOMPARE(query.GetDistance(nearPoint, testPar, testParFractal), expected[0]);
+	QCOMPARE(query.GetCacheSize(), 1);
+
+	QSignalSpy spy(&query, SIGNAL(distancesCalculated(int, QList<double>)));
+	int firstId = query.Request(points.mid(0, 2), testPar, testParFractal);
+	int secondId = query.Request(points.mid(2, 1), testPar, testParFractal);
+	QTRY_COMPARE(spy.count(), 2);
+	QCOMPARE(spy.at(0).at(0).toInt(), firstId);
+	QCOMPARE(spy.at(1).at(0).toInt(), secondId);
+	QList<double> firstDistances = spy.at(0).at(1).value<QList<double> /* */>();
+	QList<double> secondDistances = spy.at(1).at(1).value<QList<double> /* */>();
+	QCOMPARE(firstDistances.size(), 2);
+	QCOMPARE(firstDistances[0], expected[0]);
+	QCOMPARE(firstDistances[1], expected[1]);
+	QCOMPARE(secondDistances.size(), 1);
+	QCOMPARE(secondDistances[0], expected[2]);
+	QCOMPARE(query.GetCacheSize(), 3);
+
+	// changed parameters invalidate cache
+	testPar->Set("fractal_constant_factor", CVector3(2.0, 1.0, 1.0));
+	query.GetDistance(points[0], testPar, testParFractal);
+	QCOMPARE(query.GetCacheSize(), 1);
+
+	delete testPar;
+	delete testParFractal;
+}
+
+void Test::testResourceReport()
+{
+	// reports of queue items are added together into report of queue run
+	cStatistics statistics;
+	statistics.mainPassTime = 2.0;
+	statistics.dofTime = 0.5;
+	statistics.stageTimes[0] = 1.5;
+
+	cResourceReport itemReport;
+	itemReport.Start("item");
+	cResourceReport::AddBytesWritten(1000);
+	itemReport.AddStatistics(statistics);
+	itemReport.AddStatistics(statistics);
+	itemReport.SetEstimatedMemory(3000);
+	itemReport.Finish();
+	QCOMPARE(itemReport.numberOfJobs, 1);
+	QCOMPARE(itemReport.numberOfImages, 2);
+	QCOMPARE(itemReport.mainPassTime, 4.0);
+	QCOMPARE(itemReport.stageTimes[0], 3.0);
+	QVERIFY(itemReport.bytesWritten >= 1000);
+	QVERIFY(itemReport.wallTime >= 0.0);
+
+	cResourceReport runReport;
+	runReport.Add(itemReport);
+	runReport.Add(itemReport);
+	QCOMPARE(runReport.numberOfJobs, 2);
+	QCOMPARE(runReport.numberOfImages, 4);
+	QCOMPARE(runReport.dofTime, 2.0);
+	QCOMPARE(runReport.estimatedMemory, qint64(3000));
+
+	QJsonObject json = itemReport.ToJson();
+	QCOMPARE(json["job"].toString(), QString("item"));
+	QCOMPARE(json["images"].toInt(), 2);
+	QCOMPARE(json["passes"].toObject()["mainPass"].toDouble(), 4.0);
+	QCOMPARE(json["memory"].toObject()["estimated"].toDouble(), 3000.0);
+	QVERIFY(json["stages"].toObject().size() == renderStageCount);
+	QVERIFY(json.contains("netRender"));
+
+	// report is saved next to the image
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString reportFile = cResourceReport::FileNameForImage(dir.path() + "/image.0001.png");
+	QCOMPARE(QFileInfo(reportFile).fileName(), QString("image.0001.report.json"));
+	QVERIFY(itemReport.Save(reportFile));
+	QFile file(reportFile);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	QCOMPARE(QJsonDocument::fromJson(file.readAll()).object(), json);
+}
+
+void Test::perfCompute()
+{
+	// throughput of fractal iteration loop of every formula in points per second
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+	testPar->Set("N", 50);
+
+	QString failures;
+	for (int f = 0; f < fractalList.size(); f++)
+	{
+		if (fractalList[f].internalID == fractal::none) continue;
+		testPar->Set("formula", 1, (int)fractalList[f].internalID);
+
+		cParamRender params(testPar);
+		cNineFractals fractals(testParFractal, testPar);
+		sPerfComputeTask task;
+		task.params = &params;
+		task.fractals = &fractals;
+		checkPerformance(
+			"compute." + fractalList[f].internalName, measureThroughput(&task, 0.02), &failures);
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfCalculateDistance()
+{
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	cParamRender *params = new cParamRender(testPar);
+	cNineFractals *fractals = new cNineFractals(testParFractal, testPar);
+	sPerfDistanceTask task;
+	task.params = params;
+	task.fractals = fractals;
+
+	QString failures;
+	checkPerformance("calculateDistance", measureThroughput(&task, 0.2), &failures);
+
+	delete fractals;
+	delete params;
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfRayMarching()
+{
+	// rays per second of main rendering pass
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+
+	double bestThroughput = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		cStatistics statistics;
+		QVERIFY2(renderPerfScene(testPar, testParFractal, 200, 150, &statistics), "render failed.");
+		if (statistics.mainPassTime > 0.0)
+		{
+			bestThroughput =
+				qMax(bestThroughput, statistics.numberOfRaymarchings / statistics.mainPassTime);
+		}
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QString failures;
+	checkPerformance("rayMarching", bestThroughput, &failures);
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfCompileImage()
+{
+	const int size = 512;
+	cImage *image = new cImage(size, size);
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			sRGBfloat pixel(x / (float)size, y / (float)size, 0.5f);
+			image->PutPixelImage(x, y, pixel);
+		}
+	}
+
+	sPerfCompileImageTask task;
+	task.image = image;
+	QString failures;
+	checkPerformance("compileImage", measureThroughput(&task, 0.2), &failures);
+
+	delete image;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfDOF()
+{
+	// pixels per second of post-processing depth of field
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+	testPar->Set("DOF_enabled", true);
+	testPar->Set("DOF_monte_carlo", false);
+
+	const int width = 320;
+	const int height = 240;
+	double bestThroughput = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		cStatistics statistics;
+		QVERIFY2(
+			renderPerfScene(testPar, testParFractal, width, height, &statistics), "render failed.");
+		if (statistics.dofTime > 0.0)
+			bestThroughput = qMax(bestThroughput, width * height / statistics.dofTime);
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QString failures;
+	checkPerformance("dof", bestThroughput, &failures);
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfSSAO()
+{
+	// pixels per second of screen space ambient occlusion
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("mandelbulb001.fract", testPar, testParFractal);
+	testPar->Set("ambient_occlusion_enabled", true);
+	testPar->Set("ambient_occlusion_mode", (int)params::AOmodeScreenSpace);
+
+	const int width = 320;
+	const int height = 240;
+	double bestThroughput = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		cStatistics statistics;
+		QVERIFY2(
+			renderPerfScene(testPar, testParFractal, width, height, &statistics), "render failed.");
+		if (statistics.ssaoTime > 0.0)
+			bestThroughput = qMax(bestThroughput, width * height / statistics.ssaoTime);
+	}
+
+	delete testParFractal;
+	delete testPar;
+	QString failures;
+	checkPerformance("ssao", bestThroughput, &failures);
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfSettingsDecoding()
+{
+	// decoded settings files per second
+	cParameterContainer *testPar = new cParameterContainer;
+	cFractalContainer *testParFractal = new cFractalContainer;
+	loadPerfScene("", testPar, testParFractal);
+
+	QString exampleFile = QDir::toNativeSeparators(
+		systemData.sharedDir + "examples" + QDir::separator() + "keyframe_anim_mandelbulb.fract");
+	cSettings parSettings(cSettings::formatFullText);
+	parSettings.BeQuiet(true);
+	QVERIFY2(parSettings.LoadFromFile(exampleFile), "cannot load settings file.");
+
+	sPerfDecodeTask task;
+	task.settings = &parSettings;
+	task.par = testPar;
+	task.parFractal = testParFractal;
+	QString failures;
+	checkPerformance("settingsDecoding", measureThroughput(&task, 0.2), &failures);
+
+	delete testParFractal;
+	delete testPar;
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfMarchingCubes()
+{
+	// cubes per second of marching cubes without fractal calculation
+	sPerfMarchingCubesTask task;
+	QString failures;
+	checkPerformance("marchingCubes", measureThroughput(&task, 0.2), &failures);
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
+
+void Test::perfInitParams()
+{
+	// complete sets of default parameters per second
+	sPerfInitParamsTask task;
+	QString failures;
+	checkPerformance("initParams", measureThroughput(&task, 0.2), &failures);
+
+	// copies made from prototype have to keep name of container
+	cParameterContainer par;
+	par.SetContainerName("fractal1");
+	InitFractalParams(&par);
+	QCOMPARE(par.GetContainerName(), QString("fractal1"));
+	QCOMPARE(par.GetAsOneParameter("power").GetOriginalContainerName(), QString("fractal1"));
+	QVERIFY2(failures.isEmpty(), failures.toStdString().c_str());
+}
@@ -35,15 +35,68 @@
 #ifndef MANDELBULBER2_SRC_TEST_HPP_
 #define MANDELBULBER2_SRC_TEST_HPP_
 
+#include <QJsonObject>
 #include <QWidget>
 #include <QtTest/QtTest>
 
+class cParameterContainer;
+class cFractalContainer;
+class cStatistics;
+
+// options and results of Test::RenderAndCompare()
+struct sRenderComparison
+{
+	sRenderComparison()
+			: testedRenders(1), deferredPostProcessing(false), referenceDeferred(false),
+				testedDeferred(false)
+	{
+	}
+
+	// tested image is rendered more times (e.g. to use cache filled by the previous render)
+	int testedRenders;
+	// images are rendered as animation frames and effects of the tested image are calculated
+	// later by cRenderer::PostProcessImage(). Then 16-bit images are compared
+	bool deferredPostProcessing;
+
+	QString usedShaderVariant; // by the tested image
+	bool referenceDeferred;
+	bool testedDeferred;
+	QString error;
+};
+
+// workload of performance test. Run() returns number of processed items
+struct sPerfTask
+{
+	virtual ~sPerfTask() {}
+	virtual double Run() = 0;
+};
+
 class Test : public QObject
 {
 	Q_OBJECT
 private:
 	QString testFolder();
 
+	// performance tests compare throughput with baselines recorded in a file. Baselines are
+	// recorded at first run or when MANDELBULBER_PERF_UPDATE is set. Test fails if throughput is
+	// lower than baseline by more than MANDELBULBER_PERF_TOLERANCE (default 0.25)
+	QString perfBaselineFile();
+	double perfTolerance();
+	// best throughput of three runs, each one repeats the task for at least minTime seconds
+	double measureThroughput(sPerfTask *task, double minTime);
+	bool checkPerformance(const QString &name, double throughput, QString *failures);
+	void loadPerfScene(const QString &file, cParameterContainer *par, cFractalContainer *parFractal);
+	bool renderPerfScene(cParameterContainer *par, cFractalContainer *parFractal, int width,
+		int height, cStatistics *statistics);
+	// renders reference and tested image and returns average difference of pixel values. Returns -1
+	// if rendering failed or sizes of images are different (comparison->error is set then)
+	double RenderAndCompare(const cParameterContainer &referencePar,
+		const cParameterContainer &testedPar, const cFractalContainer &parFractal,
+		sRenderComparison *comparison);
+
+	QJsonObject perfBaselines;
+	bool perfBaselinesChanged;
+
 private slots:
 	void initTestCase();
 	void cleanupTestCase();
@@ -51,6 +104,56 @@ private slots:
 	void netrender();
 	void testFlight();
 	void testKeyframe();
+	void testKeyframePrecalculatedFrames();
+	void testSinglePrecision();
+	void testOpenClRendering();
+	void testDistanceCache();
+	void testStereoSinglePass();
+	void testAdaptiveSampling();
+	void testJobArena();
+	void testDEFactorOptimizer();
+	void testRenderCheckpoint();
+	void testParameterSweep();
+	void testRenderTimeBudget();
+	void testTileOrder();
+	void testCheckerboard();
+	void testDenoiser();
+	void testHalfFloatImage();
+	void testComputeBatch();
+	void testBatchNormals();
+	void testOrbitTrapBatch();
+	void testPeriodicityCheck();
+	void testIterationOps();
+	void testNetRenderMulticast();
+	void testNetRenderLineDecoder();
+	void testMemoryEstimator();
+	void testBumpMapSlopes();
+	void testPlayerFrameCache();
+	void testBoundingBoxSampled();
+	void testDoubleDouble();
+	void testWavefrontShadows();
+	void testDeferredPostProcessing();
+	void testThumbnailStore();
+	void testStructuralHash();
+	void testSettingsPreviewLoader();
+	void testVoxelSlab();
+	void testNetRenderPostTiles();
+	void testPreviewImageAdjustments();
+	void testAutosaveJournal();
+	void testThumbnailSourceImage();
+	void testFillOptionalBlocks();
+	void testDataFoldersStamp();
+	void testDistanceQuery();
+	void testResourceReport();
+	void perfCompute();
+	void perfCalculateDistance();
+	void perfRayMarching();
+	void perfCompileImage();
+	void perfDOF();
+	void perfSSAO();
+	void perfSettingsDecoding();
+	void perfMarchingCubes();
+	void perfInitParams();
 };
 
 #endif /* MANDELBULBER2_SRC_TEST_HPP_ */
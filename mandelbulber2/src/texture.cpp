@@ -35,19 +35,72 @@
  * can be initialized by loading an image file, or by loading a QByteArray (network).
  * Pixel(...) gets the pixel at a given point. The image data is MipMap-ped and
  * bicubic interpolated to give a "smooth" result.
+ * Texture and all mip levels are kept as float texels in small square tiles, so
+ * interpolation doesn't convert pixels and reads only few cache lines.
  * more information on Mipmaps:  https://en.wikipedia.org/wiki/Mipmap
  */
 
 #include "texture.hpp"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSet>
+
 #include "common_math.h"
 #include "error_message.hpp"
 #include "files.h"
 #include "qimage.h"
+#include "resource_report.hpp"
+
+// unused textures are removed from the cache when it grows over this size
+#define TEXTURE_CACHE_LIMIT_MB 1024
+// slopes of bump map (range -4 to 4) are stored as 0.5 + slope / scale to fit in texel range
+#define TEXTURE_BUMP_SLOPE_SCALE 16.0f
+
+QMutex cTexture::cacheMutex;
+QHash<QString, QExplicitlySharedDataPointer<cTexture::sTextureData> > cTexture::cache;
+QList<QString> cTexture::cacheOrder;
+
+qint64 cTexture::sTextureData::UsedBytes() const
+{
+	qint64 bytes = bitmap ? (qint64)width * height * sizeof(sRGBA16) : 0;
+	for (int i = 0; i < levels.size(); i++)
+		bytes += levels[i].texels.size() * sizeof(sRGBAfloat);
+	if (bumpSlopes) bytes += bumpSlopes->UsedBytes();
+	return bytes;
+}
 
 // constructor
 cTexture::cTexture(QString filename, enumUseMipmaps mode, bool beQuiet)
 {
-	bitmap = NULL;
+	invertGreen = false;
+
+	// decoded textures are shared by all render jobs as long as the file is not modified
+	QFileInfo fileInfo(filename);
+	QString cacheKey;
+	if (fileInfo.exists())
+	{
+		cacheKey = fileInfo.absoluteFilePath() + "|"
+							 + QString::number(fileInfo.lastModified().toMSecsSinceEpoch()) + "|"
+							 + QString::number(int(mode));
+
+		QMutexLocker lock(&cacheMutex);
+		if (cache.contains(cacheKey))
+		{
+			textureData = cache.value(cacheKey);
+			cacheOrder.removeOne(cacheKey);
+			cacheOrder.append(cacheKey);
+			width = textureData->width;
+			height = textureData->height;
+			loaded = true;
+			originalFileName = filename;
+			return;
+		}
+	}
+
+	textureData = new sTextureData;
+	sRGBA16 *bitmap = NULL;
 
 	// try to load image if it's PNG format (this one supports 16-bit depth images)
 	bitmap = LoadPNG(filename, width, height);
@@ -78,22 +131,32 @@ cTexture::cTexture(QString filename, enumUseMipmaps mode, bool beQuiet)
 
 	if (bitmap)
 	{
-		// width = qimage.width();
-		// height = qimage.height();
-		// bitmap = new sRGB8[width * height];
-
-		// for (int y = 0; y < height; y++)
-		//{
-		//	memcpy(&bitmap[y * width], qimage.scanLine(y), sizeof(sRGB8) * width);
-		//}
-
-		// qDebug() << "cTexture::cTexture(QString filename, bool beQuiet): "
-		// 				 << "(sRGB8*)(qimage.bits());:" << width * height * sizeof(sRGB8);
 		loaded = true;
 		originalFileName = filename;
+		cResourceReport::AddBytesRead(QFileInfo(filename).size());
+		textureData->width = width;
+		textureData->height = height;
+		textureData->bitmap = bitmap;
+		CreateBaseLevel(textureData.data());
 		if (mode == useMipmaps)
 		{
-			CreateMipMaps();
+			CreateMipMaps(textureData.data());
+		}
+
+		if (!cacheKey.isEmpty())
+		{
+			QMutexLocker lock(&cacheMutex);
+			// the same texture could be loaded meanwhile by other render job
+			if (cache.contains(cacheKey))
+			{
+				textureData = cache.value(cacheKey);
+			}
+			else
+			{
+				cache.insert(cacheKey, textureData);
+				cacheOrder.append(cacheKey);
+				TrimCache();
+			}
 		}
 	}
 	else
@@ -101,52 +164,32 @@ cTexture::cTexture(QString filename, enumUseMipmaps mode, bool beQuiet)
 		if (!beQuiet)
 			cErrorMessage::showMessage(
 				QObject::tr("Can't load texture!\n") + filename, cErrorMessage::errorMessage);
-		width = 100;
-		height = 100;
 		loaded = false;
-		bitmap = new sRGBA16[100 * 100];
-		memset(bitmap, 255, sizeof(sRGBA16) * 100 * 100);
-		// qDebug() << "cTexture::cTexture(QString filename, bool beQuiet): "
-		// 				 << "new sRGB8[100 * 100];:" << width * height * sizeof(sRGB8);
+		CreateBlank();
 	}
-	invertGreen = false;
 }
 
 // copy constructor
 cTexture::cTexture(const cTexture &tex)
 {
+	// texture data is never modified, so it's shared instead of copied
+	textureData = tex.textureData;
+	bumpSlopes = tex.bumpSlopes;
 	width = tex.width;
 	height = tex.height;
 	loaded = tex.loaded;
 	originalFileName = tex.originalFileName;
-	bitmap = new sRGBA16[width * height];
-	// qDebug() << "cTexture::cTexture(const cTexture &tex): "
-	// 				 << "new sRGB8[width * height]:" << width * height * sizeof(sRGB8);
-	memcpy(bitmap, tex.bitmap, sizeof(sRGBA16) * width * height);
-	mipmaps = tex.mipmaps;
-	mipmapSizes = tex.mipmapSizes;
 	invertGreen = tex.invertGreen;
 }
 
 cTexture &cTexture::operator=(const cTexture &tex)
 {
-	if (bitmap)
-	{
-		delete[] bitmap;
-		bitmap = NULL;
-		// qDebug() << "cTexture& cTexture::operator=(const cTexture &tex): "
-		// 				 << "delete[] bitmap;:" << width * height * sizeof(sRGB8);
-	}
+	textureData = tex.textureData;
+	bumpSlopes = tex.bumpSlopes;
 	width = tex.width;
 	height = tex.height;
 	loaded = tex.loaded;
 	originalFileName = tex.originalFileName;
-	bitmap = new sRGBA16[width * height];
-	// qDebug() << "cTexture& cTexture::operator=(const cTexture &tex): "
-	// 				 << "new sRGB8[width * height];:" << width * height * sizeof(sRGB8);
-	memcpy(bitmap, tex.bitmap, sizeof(sRGBA16) * width * height);
-	mipmaps = tex.mipmaps;
-	mipmapSizes = tex.mipmapSizes;
 	invertGreen = tex.invertGreen;
 
 	return *this;
@@ -154,14 +197,10 @@ cTexture &cTexture::operator=(const cTexture &tex)
 
 void cTexture::FromQByteArray(QByteArray *buffer, enumUseMipmaps mode)
 {
-	if (bitmap)
-	{
-		// qDebug() << "void cTexture::FromQByteArray(QByteArray buffer):"
-		// 				 << "delete[] bitmap;:" << width * height * sizeof(sRGB8);
-		delete[] bitmap;
-	}
+	// textures received by NetRender are not cached here (they are cached as files)
+	textureData = new sTextureData;
+	bumpSlopes.reset();
 
-	bitmap = NULL;
 	QImage qimage(*buffer);
 	qimage.loadFromData(*buffer);
 	qimage = qimage.convertToFormat(QImage::Format_RGB888);
@@ -170,7 +209,7 @@ void cTexture::FromQByteArray(QByteArray *buffer, enumUseMipmaps mode)
 	{
 		width = qimage.width();
 		height = qimage.height();
-		bitmap = new sRGBA16[width * height];
+		sRGBA16 *bitmap = new sRGBA16[width * height];
 		for (int y = 0; y < height; y++)
 		{
 			sRGB8 *line = (sRGB8 *)qimage.scanLine(y);
@@ -183,52 +222,114 @@ void cTexture::FromQByteArray(QByteArray *buffer, enumUseMipmaps mode)
 		}
 
 		loaded = true;
+		textureData->width = width;
+		textureData->height = height;
+		textureData->bitmap = bitmap;
+		CreateBaseLevel(textureData.data());
 
 		if (mode == useMipmaps)
 		{
-			CreateMipMaps();
+			CreateMipMaps(textureData.data());
 		}
 	}
 	else
 	{
 		cErrorMessage::showMessage(
 			QObject::tr("Can't load texture from QByteArray!\n"), cErrorMessage::errorMessage);
-		width = 100;
-		height = 100;
 		loaded = false;
-		bitmap = new sRGBA16[100 * 100];
-		memset(bitmap, 255, sizeof(sRGBA16) * 100 * 100);
+		CreateBlank();
 	}
 }
 
 cTexture::cTexture(void)
 {
-	width = 100;
-	height = 100;
 	loaded = false;
-	bitmap = new sRGBA16[100 * 100];
-	memset(bitmap, 255, sizeof(sRGBA16) * 100 * 100);
-	// qDebug() << "cTexture::cTexture(void):"
-	// 				 << "new sRGB8[100 * 100]" << width * height * sizeof(sRGB8);
 	invertGreen = false;
+	CreateBlank();
 }
 
 // destructor
 cTexture::~cTexture(void)
 {
-	if (bitmap)
+	// texture data is released with the last reference
+}
+
+void cTexture::CreateBlank()
+{
+	width = 100;
+	height = 100;
+	textureData = new sTextureData;
+	bumpSlopes.reset();
+	textureData->width = width;
+	textureData->height = height;
+	textureData->bitmap = new sRGBA16[100 * 100];
+	memset(textureData->bitmap, 255, sizeof(sRGBA16) * 100 * 100);
+	CreateBaseLevel(textureData.data());
+}
+
+void cTexture::TrimCache()
+{
+	qint64 totalBytes = 0;
+	QHashIterator<QString, QExplicitlySharedDataPointer<sTextureData> > it(cache);
+	while (it.hasNext())
 	{
-		delete[] bitmap;
-		bitmap = NULL;
-		// qDebug() << "cTexture::~cTexture(void):"
-		// 				 << "delete[] bitmap:" << width * height * sizeof(sRGB8);
+		it.next();
+		totalBytes += it.value()->UsedBytes();
 	}
-	else
+
+	// least recently used textures are removed first. Textures used by render jobs stay
+	qint64 limit = (qint64)TEXTURE_CACHE_LIMIT_MB * 1024 * 1024;
+	for (int i = 0; i < cacheOrder.size() && totalBytes > limit;)
 	{
-		qCritical() << "cTexture::~cTexture(void): bitmap was not allocated before";
+		QExplicitlySharedDataPointer<sTextureData> entry = cache.value(cacheOrder[i]);
+		// one reference is held by the cache and one by the local copy
+		if (entry->ref.load() <= 2)
+		{
+			totalBytes -= entry->UsedBytes();
+			cache.remove(cacheOrder[i]);
+			cacheOrder.removeAt(i);
+		}
+		else
+		{
+			i++;
+		}
 	}
 }
 
+QList<cTexture> cTexture::LoadInParallel(const QList<sTextureRequest> &requests)
+{
+	// duplicated requests would be decoded twice at the same time
+	QList<sTextureRequest> uniqueRequests;
+	QSet<QString> keys;
+	for (int i = 0; i < requests.size(); i++)
+	{
+		QString key = requests[i].filename + "|" + QString::number(int(requests[i].mode));
+		if (!keys.contains(key))
+		{
+			keys.insert(key);
+			uniqueRequests.append(requests[i]);
+		}
+	}
+
+	QVector<cTexture> textures(uniqueRequests.size());
+
+	// errors are reported later when textures are taken from the cache
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < uniqueRequests.size(); i++)
+	{
+		textures[i] = cTexture(uniqueRequests[i].filename, uniqueRequests[i].mode, true);
+	}
+
+	return textures.toList();
+}
+
+void cTexture::ClearCache()
+{
+	QMutexLocker lock(&cacheMutex);
+	cache.clear();
+	cacheOrder.clear();
+}
+
 // read pixel
 sRGBfloat cTexture::Pixel(double x, double y, double pixelSize) const
 {
@@ -266,6 +367,7 @@ sRGBA16 cTexture::LinearInterpolation(double x, double y) const
 	int iy = (int)y;
 	double rx = (x - (int)x);
 	double ry = (y - (int)y);
+	const sRGBA16 *bitmap = textureData->bitmap;
 	sRGBA16 k1 = bitmap[iy * width + ix];
 	sRGBA16 k2 = bitmap[iy * width + ix + 1];
 	sRGBA16 k3 = bitmap[(iy + 1) * width + ix];
@@ -279,48 +381,75 @@ sRGBA16 cTexture::LinearInterpolation(double x, double y) const
 	return color;
 }
 
-sRGBfloat cTexture::BicubicInterpolation(
-	double x, double y, const sRGBA16 *bitmap, int w, int h) const
+// weights of Catmull-Rom spline, the same as used by cubicInterpolate()
+static inline void CubicWeights(float t, float w[4])
 {
+	float t2 = t * t;
+	float t3 = t2 * t;
+	w[0] = 0.5f * (-t + 2.0f * t2 - t3);
+	w[1] = 0.5f * (2.0f - 5.0f * t2 + 3.0f * t3);
+	w[2] = 0.5f * (t + 4.0f * t2 - 3.0f * t3);
+	w[3] = 0.5f * (t3 - t2);
+}
+
+sRGBfloat cTexture::BicubicInterpolation(double x, double y, const sTextureLevel &level) const
+{
+	int w = level.width;
+	int h = level.height;
 	int ix = (int)x;
 	int iy = (int)y;
-	double rx = (x - ix);
-	double ry = (y - iy);
 
-	double R[4][4], G[4][4], B[4][4];
+	float weightX[4], weightY[4];
+	CubicWeights(float(x - ix), weightX);
+	CubicWeights(float(y - iy), weightY);
 
+	int columns[4], rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		columns[i] = (ix + i - 1 + w) % w;
+		rows[i] = (iy + i - 1 + h) % h;
+	}
+
+	const sRGBAfloat *texels = level.texels.data();
+	float result[4];
+
+#ifdef ALGEBRA_SIMD
+	// all four channels of texel are interpolated as one vector
+	simd4f sum = simd4fSet1(0.0f);
 	for (int yy = 0; yy < 4; yy++)
 	{
+		simd4f row = simd4fSet1(0.0f);
 		for (int xx = 0; xx < 4; xx++)
 		{
-			int ixx = ix + xx - 1;
-			int iyy = iy + yy - 1;
-			ixx = (ixx + w) % w;
-			iyy = (iyy + h) % h;
-			int address2 = ixx + iyy * w;
-			sRGBA16 pixel = bitmap[address2];
-			R[xx][yy] = pixel.R;
-			G[xx][yy] = pixel.G;
-			B[xx][yy] = pixel.B;
+			const sRGBAfloat &texel = texels[level.Index(columns[xx], rows[yy])];
+			row = simd4fAdd(row, simd4fMul(simd4fLoad(&texel.R), simd4fSet1(weightX[xx])));
 		}
+		sum = simd4fAdd(sum, simd4fMul(row, simd4fSet1(weightY[yy])));
 	}
+	simd4fStore(result, sum);
+#else
+	result[0] = result[1] = result[2] = result[3] = 0.0f;
+	for (int yy = 0; yy < 4; yy++)
+	{
+		for (int xx = 0; xx < 4; xx++)
+		{
+			const sRGBAfloat &texel = texels[level.Index(columns[xx], rows[yy])];
+			float weight = weightX[xx] * weightY[yy];
+			result[0] += texel.R * weight;
+			result[1] += texel.G * weight;
+			result[2] += texel.B * weight;
+		}
+	}
+#endif // ALGEBRA_SIMD
 
-	double dR = bicubicInterpolate(R, rx, ry);
-	double dG = bicubicInterpolate(G, rx, ry);
-	double dB = bicubicInterpolate(B, rx, ry);
-	if (dR < 0) dR = 0;
-	if (dR > 65535) dR = 65535;
-	if (dG < 0) dG = 0;
-	if (dG > 65535) dG = 65535;
-	if (dB < 0) dB = 0;
-	if (dB > 65535) dB = 65535;
-
-	return sRGBfloat((float)(dR / 65536.0), (float)(dG / 65536.0), (float)(dB / 65536.0));
+	const float maxValue = 65535.0f / 65536.0f;
+	return sRGBfloat(clamp(result[0], 0.0f, maxValue), clamp(result[1], 0.0f, maxValue),
+		clamp(result[2], 0.0f, maxValue));
 }
 
 sRGBA16 cTexture::FastPixel(int x, int y) const
 {
-	return bitmap[x + y * width];
+	return textureData->bitmap[x + y * width];
 }
 
 CVector3 cTexture::NormalMapFromBumpMap(CVector2<double> point, double bump, double pixelSize) const
@@ -332,6 +461,18 @@ CVector3 cTexture::NormalMapFromBumpMap(CVector2<double> point, double bump, dou
 	if (point.x < 0.0) point.x += 1.0;
 	if (point.y < 0.0) point.y += 1.0;
 
+	if (bumpSlopes)
+	{
+		sRGBfloat slope =
+			MipMap(point.x * width, point.y * height, pixelSize, bumpSlopes->levels);
+		CVector3 normal;
+		normal.x = bump * (slope.R - 0.5f) * TEXTURE_BUMP_SLOPE_SCALE;
+		normal.y = bump * (slope.G - 0.5f) * TEXTURE_BUMP_SLOPE_SCALE;
+		normal.z = 1.0;
+		normal.Normalize();
+		return normal;
+	}
+
 	double m[3][3];
 	for (int y = 0; y <= 2; y++)
 	{
@@ -367,14 +508,21 @@ CVector3 cTexture::NormalMap(CVector2<double> point, double bump, double pixelSi
 }
 
 sRGBfloat cTexture::MipMap(double x, double y, double pixelSize) const
+{
+	return MipMap(x, y, pixelSize, textureData->levels);
+}
+
+sRGBfloat cTexture::MipMap(
+	double x, double y, double pixelSize, const QList<sTextureLevel> &levels) const
 {
 	pixelSize /= (double)max(width, height);
-	if (mipmaps.size() > 0 && pixelSize > 0)
+	int numberOfMipmaps = levels.size() - 1;
+	if (numberOfMipmaps > 0 && pixelSize > 0)
 	{
 		if (pixelSize < 1e-20) pixelSize = 1e-20;
 		double dMipLayer = -log(pixelSize) / log(2.0);
 		if (dMipLayer < 0) dMipLayer = 0;
-		if (dMipLayer + 1 >= mipmaps.size() - 1) dMipLayer = mipmaps.size() - 1;
+		if (dMipLayer + 1 >= numberOfMipmaps - 1) dMipLayer = numberOfMipmaps - 1;
 
 		int layerBig = (int)dMipLayer;
 		int layerSmall = (int)(dMipLayer + 1);
@@ -383,30 +531,13 @@ sRGBfloat cTexture::MipMap(double x, double y, double pixelSize) const
 		double trans = dMipLayer - layerBig;
 		double transN = 1.0 - trans;
 
-		const sRGBA16 *bigBitmap, *smallBitmap;
-		CVector2<int> bigBitmapSize, smallBitmapSize;
-		if (layerBig >= 0 && layerBig <= mipmaps.length() && layerSmall >= 0
-				&& layerSmall <= mipmaps.length())
+		if (layerBig >= 0 && layerBig <= numberOfMipmaps && layerSmall >= 0
+				&& layerSmall <= numberOfMipmaps)
 		{
-			if (layerBig == 0)
-			{
-				bigBitmap = bitmap;
-				smallBitmap = mipmaps[layerSmall - 1].data();
-				bigBitmapSize.x = width;
-				bigBitmapSize.y = height;
-				smallBitmapSize = mipmapSizes[layerSmall - 1];
-			}
-			else
-			{
-				bigBitmap = mipmaps[layerBig - 1].data();
-				smallBitmap = mipmaps[layerSmall - 1].data();
-				bigBitmapSize = mipmapSizes[layerBig - 1];
-				smallBitmapSize = mipmapSizes[layerSmall - 1];
-			}
-			sRGBfloat pixelFromBig = BicubicInterpolation(
-				x / sizeMultipBig, y / sizeMultipBig, bigBitmap, bigBitmapSize.x, bigBitmapSize.y);
-			sRGBfloat pixelFromSmall = BicubicInterpolation(x / sizeMultipSmall, y / sizeMultipSmall,
-				smallBitmap, smallBitmapSize.x, smallBitmapSize.y);
+			sRGBfloat pixelFromBig =
+				BicubicInterpolation(x / sizeMultipBig, y / sizeMultipBig, levels[layerBig]);
+			sRGBfloat pixelFromSmall =
+				BicubicInterpolation(x / sizeMultipSmall, y / sizeMultipSmall, levels[layerSmall]);
 
 			sRGBfloat pixel;
 			pixel.R = (float)(pixelFromSmall.R * trans + pixelFromBig.R * transN);
@@ -421,43 +552,119 @@ sRGBfloat cTexture::MipMap(double x, double y, double pixelSize) const
 	}
 	else
 	{
-		return BicubicInterpolation(x, y, bitmap, width, height);
+		return BicubicInterpolation(x, y, levels[0]);
+	}
+}
+
+void cTexture::CreateBaseLevel(sTextureData *data)
+{
+	int width = data->width;
+	int height = data->height;
+	const sRGBA16 *bitmap = data->bitmap;
+
+	sTextureLevel level;
+	level.Prepare(width, height);
+	sRGBAfloat *texels = level.texels.data();
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			sRGBA16 pixel = bitmap[x + y * width];
+			texels[level.Index(x, y)] = sRGBAfloat(pixel.R / 65536.0f, pixel.G / 65536.0f,
+				pixel.B / 65536.0f, pixel.A / 65536.0f);
+		}
+	}
+	data->levels.append(level);
+}
+
+void cTexture::PrepareBumpMapSlopes()
+{
+	if (!loaded || bumpSlopes) return;
+
+	// slopes are created once for all render jobs which use the same texture
+	QMutexLocker lock(&cacheMutex);
+	if (!textureData->bumpSlopes) textureData->bumpSlopes = CreateBumpMapSlopes(textureData.data());
+	bumpSlopes = textureData->bumpSlopes;
+}
+
+cTexture::sTextureData *cTexture::CreateBumpMapSlopes(const sTextureData *data)
+{
+	// Sobel operator on bump heights (red channel), the same as NormalMapFromBumpMap() used
+	// to calculate for every shading sample
+	const sTextureLevel &bumpLevel = data->levels.first();
+	int w = bumpLevel.width;
+	int h = bumpLevel.height;
+	const sRGBAfloat *bumpTexels = bumpLevel.texels.data();
+
+	sTextureData *slopes = new sTextureData;
+	slopes->width = data->width;
+	slopes->height = data->height;
+	sTextureLevel level;
+	level.Prepare(w, h);
+	sRGBAfloat *texels = level.texels.data();
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int y = 0; y < h; y++)
+	{
+		for (int x = 0; x < w; x++)
+		{
+			float m[3][3];
+			for (int yy = 0; yy <= 2; yy++)
+			{
+				for (int xx = 0; xx <= 2; xx++)
+				{
+					m[xx][yy] =
+						bumpTexels[bumpLevel.Index(WrapInt(x + xx - 1, w), WrapInt(y + yy - 1, h))].R;
+				}
+			}
+			float slopeX = m[2][2] - m[0][2] + 2.0f * (m[2][1] - m[0][1]) + m[2][0] - m[0][0];
+			float slopeY = m[0][0] - m[0][2] + 2.0f * (m[1][0] - m[1][2]) + m[2][0] - m[2][2];
+			texels[level.Index(x, y)] = sRGBAfloat(0.5f + slopeX / TEXTURE_BUMP_SLOPE_SCALE,
+				0.5f + slopeY / TEXTURE_BUMP_SLOPE_SCALE, 0.5f, 1.0f);
+		}
 	}
+	slopes->levels.append(level);
+
+	// mip levels of slopes are averages of full resolution slopes
+	if (data->levels.size() > 1) CreateMipMaps(slopes);
+	return slopes;
 }
 
-void cTexture::CreateMipMaps()
+void cTexture::CreateMipMaps(sTextureData *data)
 {
-	int prevW = width;
-	int prevH = height;
-	int w = width / 2;
-	int h = height / 2;
-	sRGBA16 *prevBitmap = bitmap;
+	int w = data->width / 2;
+	int h = data->height / 2;
 	while (w > 0 && h > 0)
 	{
-		QVector<sRGBA16> newMipmapV(w * h);
-		sRGBA16 *newMipmap = newMipmapV.data();
+		const sTextureLevel &prevLevel = data->levels.last();
+		int prevW = prevLevel.width;
+		int prevH = prevLevel.height;
+		const sRGBAfloat *prevTexels = prevLevel.texels.data();
+
+		sTextureLevel newLevel;
+		newLevel.Prepare(w, h);
+		sRGBAfloat *newTexels = newLevel.texels.data();
 
 		for (int y = 0; y < h; y++)
 		{
 			for (int x = 0; x < w; x++)
 			{
-				sRGBA16 newPixel;
-				sRGBA16 p1 = prevBitmap[WrapInt(x * 2, prevW) + WrapInt(y * 2, prevH) * prevW];
-				sRGBA16 p2 = prevBitmap[WrapInt(x * 2 + 1, prevW) + WrapInt(y * 2, prevH) * prevW];
-				sRGBA16 p3 = prevBitmap[WrapInt(x * 2, prevW) + WrapInt(y * 2 + 1, prevH) * prevW];
-				sRGBA16 p4 = prevBitmap[WrapInt(x * 2 + 1, prevW) + WrapInt(y * 2 + 1, prevH) * prevW];
-				newPixel.R = (unsigned short)(((int)p1.R + p2.R + p3.R + p4.R) / 4);
-				newPixel.G = (unsigned short)(((int)p1.G + p2.G + p3.G + p4.G) / 4);
-				newPixel.B = (unsigned short)(((int)p1.B + p2.B + p3.B + p4.B) / 4);
-				newMipmap[x + y * w] = newPixel;
+				sRGBAfloat p1 = prevTexels[prevLevel.Index(WrapInt(x * 2, prevW), WrapInt(y * 2, prevH))];
+				sRGBAfloat p2 =
+					prevTexels[prevLevel.Index(WrapInt(x * 2 + 1, prevW), WrapInt(y * 2, prevH))];
+				sRGBAfloat p3 =
+					prevTexels[prevLevel.Index(WrapInt(x * 2, prevW), WrapInt(y * 2 + 1, prevH))];
+				sRGBAfloat p4 =
+					prevTexels[prevLevel.Index(WrapInt(x * 2 + 1, prevW), WrapInt(y * 2 + 1, prevH))];
+				newTexels[newLevel.Index(x, y)] = sRGBAfloat((p1.R + p2.R + p3.R + p4.R) * 0.25f,
+					(p1.G + p2.G + p3.G + p4.G) * 0.25f, (p1.B + p2.B + p3.B + p4.B) * 0.25f,
+					(p1.A + p2.A + p3.A + p4.A) * 0.25f);
 			}
 		}
-		mipmapSizes.append(CVector2<int>(w, h));
-		mipmaps.append(newMipmapV);
-		prevH = h;
-		prevW = w;
+		data->levels.append(newLevel);
 		w /= 2;
 		h /= 2;
-		prevBitmap = mipmaps.last().data();
 	}
 }
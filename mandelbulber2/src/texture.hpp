@@ -35,19 +35,29 @@
  * can be initialized by loading an image file, or by loading a QByteArray (network).
  * Pixel(...) gets the pixel at a given point. The image data is MipMap-ped and
  * bicubic interpolated to give a "smooth" result.
+ * Texture and all mip levels are kept as float texels in small square tiles, so
+ * interpolation doesn't convert pixels and reads only few cache lines.
  * more information on Mipmaps:  https://en.wikipedia.org/wiki/Mipmap
  */
 
 #ifndef MANDELBULBER2_SRC_TEXTURE_HPP_
 #define MANDELBULBER2_SRC_TEXTURE_HPP_
 
+#include <QExplicitlySharedDataPointer>
+#include <QHash>
+#include <QMutex>
+#include <QSharedData>
 #include <qbytearray.h>
 #include <qlist.h>
 #include <qstring.h>
+#include <qvector.h>
 
 #include "algebra.hpp"
 #include "color_structures.hpp"
 
+// texture levels are stored in tiles of 2^TEXTURE_TILE_BITS x 2^TEXTURE_TILE_BITS texels
+#define TEXTURE_TILE_BITS 3
+
 class cTexture
 {
 public:
@@ -57,6 +67,12 @@ public:
 		useMipmaps
 	};
 
+	struct sTextureRequest
+	{
+		QString filename;
+		enumUseMipmaps mode;
+	};
+
 	cTexture(QString filename, enumUseMipmaps mode, bool beQuiet = false);
 	cTexture();
 	cTexture(const cTexture &tex);
@@ -74,21 +90,82 @@ public:
 	CVector3 NormalMapFromBumpMap(CVector2<double> point, double bump, double pixelSize = 0.0) const;
 	CVector3 NormalMap(CVector2<double> point, double bump, double pixelSize = 0.0) const;
 	void SetInvertGreen(bool invert) { invertGreen = invert; }
+	// converts bump map to mipmapped slopes once, so NormalMapFromBumpMap() needs only one fetch.
+	// Slopes are shared by all copies of the texture
+	void PrepareBumpMapSlopes();
+	// releases all decoded textures kept for next render jobs
+	static void ClearCache();
+	// decodes and mipmaps textures in parallel. Returned textures keep them in the cache, so
+	// following cTexture() calls for the same files don't decode them again
+	static QList<cTexture> LoadInParallel(const QList<sTextureRequest> &requests);
 
 private:
+	// texture or its mip level as float texels (divided by 65536) in tiled order
+	struct sTextureLevel
+	{
+		int width;
+		int height;
+		int tilesX;
+		QVector<sRGBAfloat> texels;
+
+		void Prepare(int w, int h)
+		{
+			const int tileSize = 1 << TEXTURE_TILE_BITS;
+			width = w;
+			height = h;
+			tilesX = (w + tileSize - 1) / tileSize;
+			int tilesY = (h + tileSize - 1) / tileSize;
+			texels.resize(tilesX * tilesY * tileSize * tileSize);
+		}
+		inline int Index(int x, int y) const
+		{
+			const int mask = (1 << TEXTURE_TILE_BITS) - 1;
+			int tile = (y >> TEXTURE_TILE_BITS) * tilesX + (x >> TEXTURE_TILE_BITS);
+			return (tile << (2 * TEXTURE_TILE_BITS)) + ((y & mask) << TEXTURE_TILE_BITS) + (x & mask);
+		}
+	};
+
+	// decoded texture. It's never modified after loading, so it's shared by all copies of cTexture
+	// and by all render jobs which use the same file
+	struct sTextureData : public QSharedData
+	{
+		sTextureData() : width(0), height(0), bitmap(NULL) {}
+		~sTextureData() { delete[] bitmap; }
+		qint64 UsedBytes() const;
+
+		int width;
+		int height;
+		sRGBA16 *bitmap;
+		QList<sTextureLevel> levels; // levels[0] is full resolution texture
+		// slopes of bump map created by PrepareBumpMapSlopes() (cacheMutex has to be locked)
+		QExplicitlySharedDataPointer<sTextureData> bumpSlopes;
+	};
+
 	sRGBA16 LinearInterpolation(double x, double y) const;
-	sRGBfloat BicubicInterpolation(double x, double y, const sRGBA16 *bitmap, int w, int h) const;
+	sRGBfloat BicubicInterpolation(double x, double y, const sTextureLevel &level) const;
 	sRGBfloat MipMap(double x, double y, double pixelSize) const;
-	void CreateMipMaps();
-	inline int WrapInt(int a, int size) { return (a + size) % size; }
-	sRGBA16 *bitmap;
+	sRGBfloat MipMap(
+		double x, double y, double pixelSize, const QList<sTextureLevel> &levels) const;
+	void CreateBlank();
+	static void CreateBaseLevel(sTextureData *data);
+	static void CreateMipMaps(sTextureData *data);
+	static sTextureData *CreateBumpMapSlopes(const sTextureData *data);
+	static inline int WrapInt(int a, int size) { return (a + size) % size; }
+	// removes least recently used textures which are not used anymore (cacheMutex has to be locked)
+	static void TrimCache();
+
+	QExplicitlySharedDataPointer<sTextureData> textureData;
+	QExplicitlySharedDataPointer<sTextureData> bumpSlopes; // NULL if not prepared
 	int width;
 	int height;
 	bool loaded;
 	QString originalFileName;
-	QList<QVector<sRGBA16>> mipmaps;
-	QList<CVector2<int>> mipmapSizes;
 	bool invertGreen;
+
+	// textures keyed by file path, modification time and mipmap mode
+	static QMutex cacheMutex;
+	static QHash<QString, QExplicitlySharedDataPointer<sTextureData> > cache;
+	static QList<QString> cacheOrder;
 };
 
 #endif /* MANDELBULBER2_SRC_TEXTURE_HPP_ */
@@ -0,0 +1,153 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cThreadTuning class - choice between physical and all logical CPU cores
+ */
+
+#include "thread_tuning.hpp"
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "cimage.hpp"
+#include "fractal.h"
+#include "fractal_container.hpp"
+#include "fractal_list.hpp"
+#include "initparameters.hpp"
+#include "nine_fractals.hpp"
+#include "numa_topology.hpp"
+#include "render_job.hpp"
+#include "rendering_configuration.hpp"
+#include "system.hpp"
+
+QString cThreadTuning::Key(const cNineFractals *fractals)
+{
+	fractal::enumFractalFormula formula = fractals->GetFractal(0)->formula;
+	QString name = "none";
+	for (int i = 0; i < fractalList.size(); i++)
+	{
+		if (fractalList[i].internalID == formula)
+		{
+			name = fractalList[i].internalName;
+			break;
+		}
+	}
+	if (fractals->IsHybrid()) name += " hybrid";
+	return name + "/" + fractals->GetDETypeString();
+}
+
+cThreadTuning::enumChoice cThreadTuning::GetChoice(const QString &key)
+{
+	QStringList pairs =
+		gPar->Get<QString>("threads_tuning_choices").split(';', QString::SkipEmptyParts);
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		int separator = pairs[i].lastIndexOf('=');
+		if (separator > 0 && pairs[i].left(separator) == key)
+			return (enumChoice)pairs[i].mid(separator + 1).toInt();
+	}
+	return choiceUnknown;
+}
+
+void cThreadTuning::StoreChoice(const QString &key, enumChoice choice)
+{
+	QStringList pairs =
+		gPar->Get<QString>("threads_tuning_choices").split(';', QString::SkipEmptyParts);
+	for (int i = pairs.size() - 1; i >= 0; i--)
+	{
+		if (pairs[i].left(pairs[i].lastIndexOf('=')) == key) pairs.removeAt(i);
+	}
+	if (choice != choiceUnknown) pairs.append(key + "=" + QString::number((int)choice));
+	gPar->Set("threads_tuning_choices", pairs.join(";"));
+	WriteLogString("Threads tuning: " + key, pairs.last(), 2);
+}
+
+cThreadTuning::enumChoice cThreadTuning::ChoiceForSpeedup(double speedup)
+{
+	return (speedup < 0.97) ? choicePhysicalCores : choiceAllLogicalCores;
+}
+
+int cThreadTuning::NumberOfThreads(enumChoice choice, int threadsLimit)
+{
+	if (choice != choicePhysicalCores) return threadsLimit;
+	return qBound(1, cNumaTopology::Instance()->GetNumberOfPhysicalCores(), threadsLimit);
+}
+
+cThreadTuning::enumChoice cThreadTuning::Measure(const cParameterContainer *params,
+	const cFractalContainer *fractals, int threadsLimit, bool *stopRequest, double *speedup)
+{
+	int physicalThreads = NumberOfThreads(choicePhysicalCores, threadsLimit);
+	if (physicalThreads >= threadsLimit) return choiceAllLogicalCores;
+
+	WriteLog("cThreadTuning::Measure(): rendering samples", 2);
+	double allTime = RenderSample(params, fractals, threadsLimit, stopRequest);
+	if (allTime <= 0.0) return choiceUnknown;
+	double physicalTime = RenderSample(params, fractals, physicalThreads, stopRequest);
+	if (physicalTime <= 0.0) return choiceUnknown;
+
+	double smtSpeedup = physicalTime / allTime;
+	WriteLogDouble("Threads tuning: SMT speedup", smtSpeedup, 2);
+	if (speedup) *speedup = smtSpeedup;
+	return ChoiceForSpeedup(smtSpeedup);
+}
+
+double cThreadTuning::RenderSample(const cParameterContainer *params,
+	const cFractalContainer *fractals, int threads, bool *stopRequest)
+{
+	// sample has the same view in small resolution
+	cParameterContainer sampleParams = *params;
+	int width = params->Get<int>("image_width");
+	int height = params->Get<int>("image_height");
+	double scale = qMin(1.0, 256.0 / qMax(width, height));
+	sampleParams.Set("image_width", qMax(16, int(width * scale)));
+	sampleParams.Set("image_height", qMax(16, int(height * scale)));
+	// the second sample can't reuse distances calculated for the first one
+	sampleParams.Set("distance_cache_enabled", false);
+	sampleParams.Set("threads_auto_tune", false);
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+	config.DisableNetRender();
+	config.EnableIgnoreErros();
+	config.SetThreadsLimit(threads);
+
+	cImage image(sampleParams.Get<int>("image_width"), sampleParams.Get<int>("image_height"));
+	cRenderJob renderJob(&sampleParams, fractals, &image, stopRequest);
+	if (!renderJob.Init(cRenderJob::still, config)) return -1.0;
+
+	QElapsedTimer timer;
+	timer.start();
+	bool finished = renderJob.Execute();
+	double time = timer.nsecsElapsed() / 1e9;
+	if (!finished || *stopRequest) return -1.0;
+	return time;
+}
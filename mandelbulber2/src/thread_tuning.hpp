@@ -0,0 +1,83 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cThreadTuning class - choice between physical and all logical CPU cores
+ *
+ * SMT siblings sometimes speed up and sometimes slow down rendering of DE-heavy
+ * formulas. Small samples of the scene are rendered with physical cores only and
+ * with all logical cores, and the faster choice is remembered in application
+ * settings for the formula and DE type.
+ */
+
+#ifndef MANDELBULBER2_SRC_THREAD_TUNING_HPP_
+#define MANDELBULBER2_SRC_THREAD_TUNING_HPP_
+
+#include <QString>
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+class cNineFractals;
+
+class cThreadTuning
+{
+public:
+	enum enumChoice
+	{
+		choiceUnknown = -1,
+		choicePhysicalCores = 0,
+		choiceAllLogicalCores = 1
+	};
+
+	// formula of the first slot and DE type, e.g. "mandelbulb/analytic logarithmic"
+	static QString Key(const cNineFractals *fractals);
+	static enumChoice GetChoice(const QString &key);
+	static void StoreChoice(const QString &key, enumChoice choice);
+
+	// physical cores are chosen only if they are faster by more than measurement noise.
+	// SMT speedup = time with physical cores / time with all logical cores
+	static enumChoice ChoiceForSpeedup(double speedup);
+
+	// renders samples with both numbers of threads and returns SMT speedup in *speedup. Returns
+	// choiceUnknown if rendering failed or was stopped
+	static enumChoice Measure(const cParameterContainer *params, const cFractalContainer *fractals,
+		int threadsLimit, bool *stopRequest, double *speedup = NULL);
+
+	// number of threads for the choice, not more than threadsLimit
+	static int NumberOfThreads(enumChoice choice, int threadsLimit);
+
+private:
+	// time of rendering of the sample in seconds, -1 if failed
+	static double RenderSample(const cParameterContainer *params, const cFractalContainer *fractals,
+		int threads, bool *stopRequest);
+};
+
+#endif /* MANDELBULBER2_SRC_THREAD_TUNING_HPP_ */
@@ -32,7 +32,6 @@
  * cThumbnail class - thumbnail rendering
  */
 
-#include <QFileInfo>
 #include <QPixmap>
 
 #include "thumbnail.hpp"
@@ -42,6 +41,7 @@
 #include "settings.hpp"
 #include "system.hpp"
 #include "rendering_configuration.hpp"
+#include "thumbnail_store.hpp"
 
 cThumbnail::cThumbnail(const cParameterContainer *_params, const cFractalContainer *_fractal,
 	int _width, int _height, const QString &_hash = QString())
@@ -62,18 +62,12 @@ QPixmap cThumbnail::Render()
 {
 	QPixmap pixmap;
 
-	if (hash.isEmpty())
-	{
-		cSettings tempSettings(cSettings::formatCondensedText);
-		tempSettings.CreateText(params, fractal);
-		hash = tempSettings.GetHashCode();
-	}
+	if (hash.isEmpty()) hash = cSettings::StructuralHash(params, fractal);
 
-	QString thumbnailFileName =
-		systemData.GetThumbnailsFolder() + QDir::separator() + hash + QString(".png");
-	if (QFileInfo::exists(thumbnailFileName))
+	QImage storedImage;
+	if (FindStored(hash, params, fractal, &storedImage))
 	{
-		pixmap.load(thumbnailFileName);
+		pixmap.convertFromImage(storedImage);
 	}
 	else
 	{
@@ -93,13 +87,28 @@ QPixmap cThumbnail::Render()
 			QImage::Format_RGB888);
 		pixmap.convertFromImage(qimage);
 		delete renderJob;
-		pixmap.save(thumbnailFileName, "PNG");
+		cThumbnailStore::Instance()->Insert(hash, qimage);
 	}
 	return pixmap;
 }
 
+bool cThumbnail::FindStored(const QString &hash, const cParameterContainer *params,
+	const cFractalContainer *fractal, QImage *image)
+{
+	cThumbnailStore *store = cThumbnailStore::Instance();
+	if (store->Find(hash, image)) return true;
+
+	// thumbnails rendered by older versions and downloaded from the server are named by hash of
+	// settings text. It is calculated only when the thumbnail would have to be rendered anyway
+	cSettings tempSettings(cSettings::formatCondensedText);
+	tempSettings.CreateText(params, fractal);
+	if (!store->Find(tempSettings.GetHashCode(), image)) return false;
+	store->Insert(hash, *image);
+	return true;
+}
+
 void cThumbnail::Save(QString filename)
 {
-	ImageFileSaveJPG::SaveJPEGQt(
+	ImageFileSaveJPG::SaveJPEG(
 		filename, image->ConvertTo8bit(), image->GetWidth(), image->GetHeight(), 85);
 }
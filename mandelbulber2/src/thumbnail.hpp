@@ -35,6 +35,7 @@
 #ifndef MANDELBULBER2_SRC_THUMBNAIL_HPP_
 #define MANDELBULBER2_SRC_THUMBNAIL_HPP_
 
+#include <QImage>
 #include <QtCore>
 
 // forward declarations
@@ -52,6 +53,10 @@ public:
 	QPixmap Render();
 	void Save(QString filename);
 
+	// looks for stored thumbnail by structural hash of settings, and then by hash of settings text
+	static bool FindStored(const QString &hash, const cParameterContainer *params,
+		const cFractalContainer *fractal, QImage *image);
+
 private:
 	cImage *image;
 	const cParameterContainer *params;
@@ -0,0 +1,338 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cThumbnailStore - packed file with rendered thumbnails
+ */
+
+#include "thumbnail_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QVector>
+
+#include "system.hpp"
+
+#define THUMBNAIL_STORE_MAGIC "MBTS"
+#define THUMBNAIL_STORE_VERSION 1
+
+cThumbnailStore *cThumbnailStore::instance = NULL;
+
+cThumbnailStore *cThumbnailStore::Instance()
+{
+	if (!instance)
+	{
+		QString folder = systemData.GetThumbnailsFolder();
+		instance = new cThumbnailStore(
+			folder + QDir::separator() + "thumbnails.pack", THUMBNAIL_STORE_MAX_SIZE, folder);
+	}
+	return instance;
+}
+
+cThumbnailStore::cThumbnailStore(
+	const QString &fileName, qint64 _maxSize, const QString &_legacyFolder)
+		: file(fileName), legacyFolder(_legacyFolder), maxSize(_maxSize)
+{
+	mapped = NULL;
+	mappedSize = 0;
+	QMutexLocker locker(&mutex);
+	if (!Open()) qCritical() << "cThumbnailStore: cannot open file" << fileName;
+}
+
+cThumbnailStore::~cThumbnailStore()
+{
+	Close();
+}
+
+QByteArray cThumbnailStore::HashKey(const QString &hash)
+{
+	QByteArray key = hash.toLatin1().left(sizeof(((sRecordHeader *)NULL)->hash));
+	key.append(QByteArray(sizeof(((sRecordHeader *)NULL)->hash) - key.size(), '\0'));
+	return key;
+}
+
+qint64 cThumbnailStore::RecordSize(quint32 dataSize)
+{
+	return sizeof(sRecordHeader) + ((qint64(dataSize) + 7) & ~qint64(7));
+}
+
+bool cThumbnailStore::Open()
+{
+	if (!file.open(QIODevice::ReadWrite)) return false;
+
+	bool valid = false;
+	if (file.size() >= qint64(sizeof(sFileHeader)))
+	{
+		sFileHeader header;
+		file.read((char *)&header, sizeof(header));
+		valid = memcmp(header.magic, THUMBNAIL_STORE_MAGIC, sizeof(header.magic)) == 0
+						&& header.version == THUMBNAIL_STORE_VERSION;
+	}
+	if (!valid)
+	{
+		// new file or file from incompatible version
+		sFileHeader header;
+		memcpy(header.magic, THUMBNAIL_STORE_MAGIC, sizeof(header.magic));
+		header.version = THUMBNAIL_STORE_VERSION;
+		header.useCounter = 0;
+		file.resize(0);
+		file.seek(0);
+		file.write((const char *)&header, sizeof(header));
+		file.flush();
+	}
+
+	if (!Map()) return false;
+	BuildIndex();
+	return true;
+}
+
+void cThumbnailStore::Close()
+{
+	if (mapped) file.unmap(mapped);
+	mapped = NULL;
+	mappedSize = 0;
+	index.clear();
+	file.close();
+}
+
+bool cThumbnailStore::Map()
+{
+	if (mapped) file.unmap(mapped);
+	mappedSize = file.size();
+	mapped = file.map(0, mappedSize);
+	if (!mapped) mappedSize = 0;
+	return mapped != NULL;
+}
+
+void cThumbnailStore::BuildIndex()
+{
+	index.clear();
+	qint64 offset = sizeof(sFileHeader);
+	while (offset + qint64(sizeof(sRecordHeader)) <= mappedSize)
+	{
+		sRecordHeader *record = Record(offset);
+		qint64 recordSize = RecordSize(record->size);
+		if (offset + recordSize > mappedSize) break;
+		if (!record->removed)
+		{
+			sIndexEntry entry;
+			entry.offset = offset;
+			entry.size = record->size;
+			index.insert(QByteArray(record->hash, sizeof(record->hash)), entry);
+		}
+		offset += recordSize;
+	}
+
+	if (offset < mappedSize)
+	{
+		// record was not fully written (program was terminated during saving)
+		file.unmap(mapped);
+		mapped = NULL;
+		file.resize(offset);
+		Map();
+	}
+}
+
+void cThumbnailStore::MarkUsed(qint64 offset)
+{
+	sFileHeader *header = (sFileHeader *)mapped;
+	header->useCounter++;
+	Record(offset)->lastUsed = header->useCounter;
+}
+
+bool cThumbnailStore::Find(const QString &hash, QImage *image)
+{
+	QMutexLocker locker(&mutex);
+	if (!mapped) return false;
+
+	QByteArray key = HashKey(hash);
+	QHash<QByteArray, sIndexEntry>::const_iterator it = index.constFind(key);
+	if (it == index.constEnd())
+	{
+		if (!ImportLegacyFile(hash)) return false;
+		it = index.constFind(key);
+		if (it == index.constEnd()) return false;
+	}
+
+	const uchar *data = mapped + it->offset + sizeof(sRecordHeader);
+	if (!image->loadFromData(data, it->size, "PNG")) return false;
+	MarkUsed(it->offset);
+	return true;
+}
+
+bool cThumbnailStore::Contains(const QString &hash)
+{
+	QMutexLocker locker(&mutex);
+	if (!mapped) return false;
+	return index.contains(HashKey(hash)) || ImportLegacyFile(hash);
+}
+
+void cThumbnailStore::Touch(const QString &hash)
+{
+	QMutexLocker locker(&mutex);
+	if (!mapped) return;
+	QHash<QByteArray, sIndexEntry>::const_iterator it = index.constFind(HashKey(hash));
+	if (it != index.constEnd()) MarkUsed(it->offset);
+}
+
+void cThumbnailStore::Insert(const QString &hash, const QImage &image)
+{
+	if (image.isNull()) return;
+
+	// encoding is done before locking, it is the slowest part
+	QByteArray pngData;
+	QBuffer buffer(&pngData);
+	buffer.open(QIODevice::WriteOnly);
+	if (!image.save(&buffer, "PNG")) return;
+
+	QMutexLocker locker(&mutex);
+	if (!mapped) return;
+	Append(HashKey(hash), pngData);
+	if (mappedSize > maxSize) Compact();
+}
+
+void cThumbnailStore::Append(const QByteArray &key, const QByteArray &pngData)
+{
+	QHash<QByteArray, sIndexEntry>::const_iterator it = index.constFind(key);
+	if (it != index.constEnd()) Record(it->offset)->removed = 1;
+
+	sRecordHeader record;
+	memcpy(record.hash, key.constData(), sizeof(record.hash));
+	record.size = pngData.size();
+	record.removed = 0;
+	record.lastUsed = 0;
+
+	qint64 offset = mappedSize;
+	qint64 padding = RecordSize(record.size) - sizeof(record) - record.size;
+	file.seek(offset);
+	file.write((const char *)&record, sizeof(record));
+	file.write(pngData);
+	file.write(QByteArray(padding, '\0'));
+	file.flush();
+
+	if (!Map())
+	{
+		index.clear();
+		return;
+	}
+
+	sIndexEntry entry;
+	entry.offset = offset;
+	entry.size = record.size;
+	index.insert(key, entry);
+	MarkUsed(offset);
+}
+
+void cThumbnailStore::Compact()
+{
+	struct sLiveRecord
+	{
+		qint64 offset;
+		quint64 lastUsed;
+		bool operator<(const sLiveRecord &other) const { return lastUsed > other.lastUsed; }
+	};
+
+	QVector<sLiveRecord> records;
+	records.reserve(index.size());
+	for (QHash<QByteArray, sIndexEntry>::const_iterator it = index.constBegin();
+			 it != index.constEnd(); ++it)
+	{
+		sLiveRecord live;
+		live.offset = it->offset;
+		live.lastUsed = Record(it->offset)->lastUsed;
+		records.append(live);
+	}
+	// most recently used first
+	std::sort(records.begin(), records.end());
+
+	QString fileName = file.fileName();
+	QFile compacted(fileName + ".tmp");
+	if (!compacted.open(QIODevice::WriteOnly)) return;
+
+	// some space is left free, so the store is not compacted again after every insertion
+	qint64 sizeLimit = maxSize * 3 / 4;
+	qint64 size = sizeof(sFileHeader);
+	compacted.write((const char *)mapped, sizeof(sFileHeader));
+	for (int i = 0; i < records.size(); i++)
+	{
+		qint64 recordSize = RecordSize(Record(records[i].offset)->size);
+		if (size + recordSize > sizeLimit) break;
+		compacted.write((const char *)Record(records[i].offset), recordSize);
+		size += recordSize;
+	}
+	compacted.close();
+
+	Close();
+	QFile::remove(fileName);
+	QFile::rename(fileName + ".tmp", fileName);
+	if (!Open()) qCritical() << "cThumbnailStore: cannot open file" << fileName;
+	WriteLogDouble("Thumbnail store compacted, number of thumbnails", index.size(), 2);
+}
+
+bool cThumbnailStore::ImportLegacyFile(const QString &hash)
+{
+	if (legacyFolder.isEmpty()) return false;
+
+	QString legacyFileName = legacyFolder + QDir::separator() + hash + QString(".png");
+	QFile legacyFile(legacyFileName);
+	if (!legacyFile.open(QIODevice::ReadOnly)) return false;
+	QByteArray pngData = legacyFile.readAll();
+	legacyFile.close();
+	if (pngData.isEmpty()) return false;
+
+	Append(HashKey(hash), pngData);
+	QFile::remove(legacyFileName);
+	if (mappedSize > maxSize) Compact();
+	return true;
+}
+
+void cThumbnailStore::Clear()
+{
+	QMutexLocker locker(&mutex);
+	QString fileName = file.fileName();
+	Close();
+	QFile::remove(fileName);
+	if (!Open()) qCritical() << "cThumbnailStore: cannot open file" << fileName;
+}
+
+int cThumbnailStore::Count()
+{
+	QMutexLocker locker(&mutex);
+	return index.size();
+}
+
+qint64 cThumbnailStore::FileSize()
+{
+	QMutexLocker locker(&mutex);
+	return mappedSize;
+}
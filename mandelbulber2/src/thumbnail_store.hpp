@@ -0,0 +1,124 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cThumbnailStore - packed file with rendered thumbnails
+ *
+ * All thumbnails are kept as PNG data in one file in thumbnails folder, so the folder
+ * doesn't grow to hundreds of thousands of small files. The file is memory mapped and
+ * the index of records (settings hash -> position) is built once when the store is opened,
+ * so finding a thumbnail doesn't need any file system calls. Every use of a thumbnail
+ * updates its use counter in the file. When the file exceeds the size limit it is
+ * compacted and least recently used thumbnails are dropped.
+ * Thumbnails from older versions (<hash>.png files) are moved to the store when they are
+ * used for the first time.
+ */
+
+#ifndef MANDELBULBER2_SRC_THUMBNAIL_STORE_HPP_
+#define MANDELBULBER2_SRC_THUMBNAIL_STORE_HPP_
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+// maximum size of thumbnail store file
+#define THUMBNAIL_STORE_MAX_SIZE (256 * 1024 * 1024)
+
+class cThumbnailStore
+{
+public:
+	cThumbnailStore(const QString &fileName, qint64 maxSize = THUMBNAIL_STORE_MAX_SIZE,
+		const QString &legacyFolder = QString());
+	~cThumbnailStore();
+
+	// store in thumbnails folder
+	static cThumbnailStore *Instance();
+
+	// returns false if there is no thumbnail with given settings hash
+	bool Find(const QString &hash, QImage *image);
+	bool Contains(const QString &hash);
+	void Insert(const QString &hash, const QImage &image);
+	// marks thumbnail as recently used
+	void Touch(const QString &hash);
+	void Clear();
+	int Count();
+	qint64 FileSize();
+
+private:
+	struct sFileHeader
+	{
+		char magic[4];
+		quint32 version;
+		quint64 useCounter;
+	};
+
+	// record is followed by PNG data padded to 8 bytes
+	struct sRecordHeader
+	{
+		char hash[32];
+		quint32 size;
+		quint32 removed;
+		quint64 lastUsed;
+	};
+
+	struct sIndexEntry
+	{
+		qint64 offset;
+		quint32 size;
+	};
+
+	bool Open();
+	void Close();
+	bool Map();
+	void BuildIndex();
+	// appends record with PNG data, old record with the same hash is marked as removed
+	void Append(const QByteArray &key, const QByteArray &pngData);
+	void Compact();
+	bool ImportLegacyFile(const QString &hash);
+	void MarkUsed(qint64 offset);
+	sRecordHeader *Record(qint64 offset) { return (sRecordHeader *)(mapped + offset); }
+	static QByteArray HashKey(const QString &hash);
+	static qint64 RecordSize(quint32 dataSize);
+
+	QMutex mutex;
+	QFile file;
+	QString legacyFolder;
+	qint64 maxSize;
+	uchar *mapped;
+	qint64 mappedSize;
+	QHash<QByteArray, sIndexEntry> index;
+
+	static cThumbnailStore *instance;
+};
+
+#endif /* MANDELBULBER2_SRC_THUMBNAIL_STORE_HPP_ */
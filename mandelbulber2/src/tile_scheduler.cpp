@@ -0,0 +1,521 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTileScheduler class - schedules rendering job between CPU cores using square tiles
+ */
+
+#include "tile_scheduler.hpp"
+
+#include <algorithm>
+#include <QtCore>
+
+#include "job_arena.hpp"
+#include "system.hpp"
+
+cTileScheduler::cTileScheduler(cRegion<int> screenRegion, int progressive, int _tileSize,
+	int numberOfThreads, bool _reportWholeRows, cJobArena *_arena)
+		: cScheduler(screenRegion, progressive, _arena)
+{
+	// tiles have to be aligned to the biggest progressive step
+	int step = max(progressive, 1);
+	tileSize = max(_tileSize, step);
+	tileSize = (tileSize + step - 1) / step * step;
+
+	reportWholeRows = _reportWholeRows;
+
+	if (screenRegion.width > 0 && screenRegion.height > 0)
+	{
+		firstTileX = screenRegion.x1 / tileSize;
+		firstTileY = screenRegion.y1 / tileSize;
+		tilesX = (screenRegion.x2 - 1) / tileSize - firstTileX + 1;
+		tilesY = (screenRegion.y2 - 1) / tileSize - firstTileY + 1;
+	}
+	else
+	{
+		firstTileX = 0;
+		firstTileY = 0;
+		tilesX = 0;
+		tilesY = 0;
+	}
+	numberOfTiles = tilesX * tilesY;
+	numberOfQueues = max(numberOfThreads, 1);
+
+	if (arena)
+	{
+		tileState = arena->NewArray<QAtomicInt>(max(numberOfTiles, 1));
+		rowTilesFinished = arena->NewArray<QAtomicInt>(max(tilesY, 1));
+		queues = arena->NewArray<QAtomicInteger<quint64> >(numberOfQueues);
+	}
+	else
+	{
+		tileState = new QAtomicInt[max(numberOfTiles, 1)];
+		rowTilesFinished = new QAtomicInt[max(tilesY, 1)];
+		queues = new QAtomicInteger<quint64>[numberOfQueues];
+	}
+
+	ResetTiles();
+}
+
+cTileScheduler::~cTileScheduler()
+{
+	if (arena) return;
+	delete[] tileState;
+	delete[] rowTilesFinished;
+	delete[] queues;
+}
+
+void cTileScheduler::ResetTiles()
+{
+	for (int i = 0; i < numberOfTiles; i++)
+		tileState[i].store(tileFree);
+
+	for (int i = 0; i < tilesY; i++)
+		rowTilesFinished[i].store(0);
+
+	tilesFinished.store(0);
+
+	ResetQueues();
+}
+
+void cTileScheduler::ResetQueues()
+{
+	// every thread gets continuous block of tiles (neighbouring tiles have similar rendering time)
+	for (int i = 0; i < numberOfQueues; i++)
+	{
+		quint64 begin = (quint64)numberOfTiles * i / numberOfQueues;
+		quint64 end = (quint64)numberOfTiles * (i + 1) / numberOfQueues;
+		queues[i].store(begin | (end << 32));
+	}
+}
+
+cRegion<int> cTileScheduler::GetTileRegion(int tileIndex) const
+{
+	int x = (firstTileX + tileIndex % tilesX) * tileSize;
+	int y = (firstTileY + tileIndex / tilesX) * tileSize;
+	return cRegion<int>(x, y, x + tileSize, y + tileSize);
+}
+
+bool cTileScheduler::TakeOwnTile(int queueIndex, int *tileIndex)
+{
+	while (true)
+	{
+		quint64 range = queues[queueIndex].load();
+		quint64 begin = range & 0xFFFFFFFFull;
+		quint64 end = range >> 32;
+		if (begin >= end) return false;
+
+		if (queues[queueIndex].testAndSetOrdered(range, (begin + 1) | (end << 32)))
+		{
+			*tileIndex = TileAtPosition(begin);
+			return true;
+		}
+	}
+}
+
+void cTileScheduler::SetQueueNodes(const QVector<int> &nodes)
+{
+	queueNodes = nodes;
+	queueNodes.resize(numberOfQueues);
+}
+
+int cTileScheduler::HilbertIndex(int n, int x, int y)
+{
+	int d = 0;
+	for (int s = n / 2; s > 0; s /= 2)
+	{
+		int rx = (x & s) > 0;
+		int ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+
+		// rotation of quadrant
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+// sort key of tile
+struct sTileKey
+{
+	double distance;
+	int hilbert;
+	int index;
+	bool operator<(const sTileKey &other) const
+	{
+		if (distance != other.distance) return distance < other.distance;
+		return hilbert < other.hilbert;
+	}
+};
+
+void cTileScheduler::SetTileOrder(enumTileOrder order, int focusX, int focusY)
+{
+	tileOrder.clear();
+	if (order == tileOrderRows || numberOfTiles == 0)
+	{
+		ResetQueues();
+		return;
+	}
+
+	int n = 1;
+	while (n < tilesX || n < tilesY)
+		n *= 2;
+
+	QVector<sTileKey> keys(numberOfTiles);
+	for (int i = 0; i < numberOfTiles; i++)
+	{
+		int tx = i % tilesX;
+		int ty = i / tilesX;
+		keys[i].hilbert = HilbertIndex(n, tx, ty);
+		keys[i].index = i;
+		keys[i].distance = 0.0;
+		if (order == tileOrderFocusFirst)
+		{
+			cRegion<int> region = GetTileRegion(i);
+			double dx = (region.x1 + region.x2) * 0.5 - focusX;
+			double dy = (region.y1 + region.y2) * 0.5 - focusY;
+			keys[i].distance = dx * dx + dy * dy;
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+
+	tileOrder.resize(numberOfTiles);
+	if (order == tileOrderHilbert)
+	{
+		// queues get continuous parts of the curve
+		for (int i = 0; i < numberOfTiles; i++)
+			tileOrder[i] = keys[i].index;
+	}
+	else
+	{
+		// tiles are dealt to queues one by one, so all threads start near the focus point and
+		// the most distant tiles are at the end of queues, where they are stolen from
+		QVector<int> filled(numberOfQueues, 0);
+		int queueIndex = 0;
+		for (int i = 0; i < numberOfTiles; i++)
+		{
+			int begin, end;
+			while (true)
+			{
+				begin = (int)((quint64)numberOfTiles * queueIndex / numberOfQueues);
+				end = (int)((quint64)numberOfTiles * (queueIndex + 1) / numberOfQueues);
+				if (begin + filled[queueIndex] < end) break;
+				queueIndex = (queueIndex + 1) % numberOfQueues;
+			}
+			tileOrder[begin + filled[queueIndex]] = keys[i].index;
+			filled[queueIndex]++;
+			queueIndex = (queueIndex + 1) % numberOfQueues;
+		}
+	}
+
+	ResetQueues();
+}
+
+bool cTileScheduler::StealTile(int *tileIndex, int node)
+{
+	bool sameNodeOnly = node >= 0 && !queueNodes.isEmpty();
+	while (true)
+	{
+		// find the longest queue, first among queues of the same NUMA node
+		int victim = -1;
+		quint64 longest = 0;
+		quint64 victimRange = 0;
+		for (int i = 0; i < numberOfQueues; i++)
+		{
+			if (sameNodeOnly && queueNodes[i] != node) continue;
+			quint64 range = queues[i].load();
+			quint64 begin = range & 0xFFFFFFFFull;
+			quint64 end = range >> 32;
+			if (end > begin && end - begin > longest)
+			{
+				longest = end - begin;
+				victim = i;
+				victimRange = range;
+			}
+		}
+		if (victim < 0)
+		{
+			if (!sameNodeOnly) return false;
+			sameNodeOnly = false;
+			continue;
+		}
+
+		// steal the last tile of the queue
+		quint64 begin = victimRange & 0xFFFFFFFFull;
+		quint64 end = victimRange >> 32;
+		if (queues[victim].testAndSetOrdered(victimRange, begin | ((end - 1) << 32)))
+		{
+			*tileIndex = TileAtPosition(end - 1);
+			return true;
+		}
+	}
+}
+
+int cTileScheduler::NextTile(int threadId)
+{
+	int queueIndex = (threadId - 1) % numberOfQueues;
+	int node = queueNodes.isEmpty() ? -1 : queueNodes[queueIndex];
+	int tileIndex = -1;
+
+	while (!stopRequest && !systemData.globalStopRequest)
+	{
+		if (!TakeOwnTile(queueIndex, &tileIndex) && !StealTile(&tileIndex, node)) return -1;
+
+		// tile could be already rendered by NetRender server or client
+		if (tileState[tileIndex].testAndSetOrdered(tileFree, tileRendering)) return tileIndex;
+	}
+	return -1;
+}
+
+int cTileScheduler::StealTiles(int maxTiles, QList<int> *tiles)
+{
+	int count = 0;
+	int tileIndex = -1;
+	while (count < maxTiles && !stopRequest && !systemData.globalStopRequest)
+	{
+		if (!StealTile(&tileIndex, -1)) break;
+		if (tileState[tileIndex].testAndSetOrdered(tileFree, tileRendering))
+		{
+			tiles->append(tileIndex);
+			count++;
+		}
+	}
+	return count;
+}
+
+void cTileScheduler::ReleaseTiles(const QList<int> &tiles)
+{
+	for (int i = 0; i < tiles.size(); i++)
+		tileState[tiles.at(i)].testAndSetOrdered(tileRendering, tileFree);
+
+	// queues cover all tiles again. Tiles which are already done or rendered are skipped by
+	// NextTile(), because state of tile is changed atomically
+	ResetQueues();
+}
+
+int cTileScheduler::GetNumberOfQueuedTiles() const
+{
+	int count = 0;
+	for (int i = 0; i < numberOfQueues; i++)
+	{
+		quint64 range = queues[i].load();
+		quint64 begin = range & 0xFFFFFFFFull;
+		quint64 end = range >> 32;
+		if (end > begin) count += (int)(end - begin);
+	}
+	return count;
+}
+
+bool cTileScheduler::ShouldIBreakTile(int tileIndex) const
+{
+	return tileState[tileIndex].load() != tileRendering || stopRequest;
+}
+
+void cTileScheduler::TileDone(int tileIndex)
+{
+	if (tileState[tileIndex].testAndSetOrdered(tileRendering, tileDone))
+	{
+		TileFinished(tileIndex);
+	}
+}
+
+void cTileScheduler::TileFinished(int tileIndex)
+{
+	int row = tileIndex / tilesX;
+	cRegion<int> tileRegion = GetTileRegion(tileIndex);
+
+	if (reportWholeRows)
+	{
+		if (rowTilesFinished[row].fetchAndAddOrdered(1) + 1 == tilesX)
+			MarkLinesAsRendered(tileRegion.y1, tileRegion.y2);
+	}
+	else
+	{
+		rowTilesFinished[row].fetchAndAddOrdered(1);
+		MarkLinesAsRendered(tileRegion.y1, tileRegion.y2);
+	}
+
+	tilesFinished.fetchAndAddOrdered(1);
+}
+
+void cTileScheduler::MarkLinesAsRendered(int y1, int y2)
+{
+	for (int y = max(y1, startLine); y < min(y2, endLine); y++)
+	{
+		lineDone[y] = true;
+		lastLinesDone[y] = true;
+	}
+}
+
+bool cTileScheduler::SetTileDoneByServer(int tileIndex)
+{
+	while (true)
+	{
+		int state = tileState[tileIndex].load();
+		if (state == tileDone || state == tileDoneByServer) return false;
+		if (tileState[tileIndex].testAndSetOrdered(state, tileDoneByServer)) return true;
+	}
+}
+
+bool cTileScheduler::AllLinesDone() const
+{
+	if (stopRequest) return true;
+	return tilesFinished.load() >= numberOfTiles;
+}
+
+double cTileScheduler::PercentDone() const
+{
+	if (numberOfTiles == 0) return 1.0;
+
+	double done = (double)tilesFinished.load() / numberOfTiles;
+
+	double progressiveDone, percent_done;
+	if (progressivePass == 1)
+		progressiveDone = 0;
+	else
+		progressiveDone = 0.25 / (progressiveStep * progressiveStep);
+
+	if (progressiveEnabled)
+	{
+		percent_done = done * 0.75 / (progressiveStep * progressiveStep) + progressiveDone;
+	}
+	else
+	{
+		percent_done = done;
+	}
+
+	return percent_done;
+}
+
+bool cTileScheduler::ProgressiveNextStep()
+{
+	if (!cScheduler::ProgressiveNextStep()) return false;
+	ResetTiles();
+	return true;
+}
+
+QList<int> cTileScheduler::CreateDoneList() const
+{
+	QList<int> list;
+	for (int i = 0; i < numberOfTiles; i++)
+	{
+		int state = tileState[i].load();
+		if (state == tileDone || state == tileDoneByServer)
+		{
+			list.append(i);
+		}
+	}
+	return list;
+}
+
+void cTileScheduler::UpdateDoneLines(const QList<int> &done)
+{
+	for (int i = 0; i < done.size(); i++)
+	{
+		int tileIndex = done.at(i);
+		if (tileIndex < 0 || tileIndex >= numberOfTiles)
+		{
+			qCritical() << "cTileScheduler::UpdateDoneLines(): wrong tile index:" << tileIndex;
+			continue;
+		}
+		if (SetTileDoneByServer(tileIndex)) TileFinished(tileIndex);
+	}
+}
+
+void cTileScheduler::MarkReceivedLines(const QList<int> &lineNumbers)
+{
+	cScheduler::MarkReceivedLines(lineNumbers);
+
+	// tile is done when all its lines were received
+	for (int i = 0; i < lineNumbers.size(); i++)
+	{
+		int row = lineNumbers.at(i) / tileSize - firstTileY;
+		if (row < 0 || row >= tilesY) continue;
+
+		int y1 = max((firstTileY + row) * tileSize, startLine);
+		int y2 = min((firstTileY + row + 1) * tileSize, endLine);
+		bool wholeRowReceived = true;
+		for (int y = y1; y < y2; y++)
+		{
+			if (linePendingThreadId[y] != LINE_DONE_BY_SERVER)
+			{
+				wholeRowReceived = false;
+				break;
+			}
+		}
+		if (!wholeRowReceived) continue;
+
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			int tileIndex = row * tilesX + tx;
+			if (SetTileDoneByServer(tileIndex))
+			{
+				rowTilesFinished[row].fetchAndAddOrdered(1);
+				tilesFinished.fetchAndAddOrdered(1);
+			}
+		}
+	}
+}
+
+QList<int> cTileScheduler::GetCompletedLines() const
+{
+	// line is complete when all tiles of its row are finished
+	QList<int> list;
+	for (int row = 0; row < tilesY; row++)
+	{
+		if (rowTilesFinished[row].load() < tilesX) continue;
+		int y1 = max((firstTileY + row) * tileSize, startLine);
+		int y2 = min((firstTileY + row + 1) * tileSize, endLine);
+		for (int y = y1; y < y2; y++)
+			list.append(y);
+	}
+	return list;
+}
+
+bool cTileScheduler::IsLineDoneByServer(int line) const
+{
+	if (cScheduler::IsLineDoneByServer(line)) return true;
+
+	// line is not complete if any tile from this row was rendered by another computer
+	int row = line / tileSize - firstTileY;
+	if (row < 0 || row >= tilesY) return false;
+	for (int tx = 0; tx < tilesX; tx++)
+	{
+		if (tileState[row * tilesX + tx].load() == tileDoneByServer) return true;
+	}
+	return false;
+}
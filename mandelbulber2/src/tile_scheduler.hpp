@@ -0,0 +1,139 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTileScheduler class - schedules rendering job between CPU cores using square tiles
+ *
+ * The image is divided into tiles of size [tileSize] x [tileSize]. Every thread has its own
+ * queue of neighbouring tiles. When own queue is empty, thread steals tiles from the end of
+ * the longest queue of other threads. Queues are lock-free (begin and end of each queue are
+ * packed into one atomic 64-bit value). OpenCL device doesn't have own queue. It steals
+ * batches of tiles in the same way, so CPU threads and the device share one pool of work.
+ * If NUMA nodes of threads are set, threads steal from queues of the same node first.
+ * Tiles can be ordered along Hilbert curve (queues cover compact areas of the image) or by
+ * distance from focus point, so the centre of the image or area under the mouse is refined
+ * first in every progressive step.
+ */
+
+#ifndef MANDELBULBER2_SRC_TILE_SCHEDULER_HPP_
+#define MANDELBULBER2_SRC_TILE_SCHEDULER_HPP_
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QVector>
+
+#include "scheduler.hpp"
+
+class cTileScheduler : public cScheduler
+{
+public:
+	enum enumTileOrder
+	{
+		tileOrderRows = 0,
+		tileOrderHilbert = 1,
+		tileOrderFocusFirst = 2
+	};
+
+	cTileScheduler(cRegion<int> screenRegion, int progressive, int _tileSize, int numberOfThreads,
+		bool _reportWholeRows, cJobArena *_arena = NULL);
+	~cTileScheduler();
+
+	// returns index of next tile to render or -1 if there is nothing more to do
+	int NextTile(int threadId);
+	void TileDone(int tileIndex);
+	bool ShouldIBreakTile(int tileIndex) const;
+	cRegion<int> GetTileRegion(int tileIndex) const;
+	int GetTileSize() const { return tileSize; }
+	// NUMA nodes of rendering threads (index 0 for thread with id 1)
+	void SetQueueNodes(const QVector<int> &nodes);
+	// order in which tiles are taken from queues. Focus point is used by tileOrderFocusFirst
+	void SetTileOrder(enumTileOrder order, int focusX, int focusY);
+	// distance of tile (x, y) from the beginning of Hilbert curve filling n x n square
+	static int HilbertIndex(int n, int x, int y);
+
+	// batch of tiles for OpenCL device. Returns number of taken tiles
+	int StealTiles(int maxTiles, QList<int> *tiles);
+	// tiles which couldn't be rendered are put back to queues of CPU threads
+	void ReleaseTiles(const QList<int> &tiles);
+	// tiles in queues which are not taken by any thread or device
+	int GetNumberOfQueuedTiles() const;
+	int GetNumberOfFinishedTiles() const { return tilesFinished.load(); }
+
+	bool AllLinesDone() const;
+	double PercentDone() const;
+	bool ProgressiveNextStep();
+	// NetRender done lists contain indexes of tiles
+	QList<int> CreateDoneList() const;
+	void UpdateDoneLines(const QList<int> &done);
+	void MarkReceivedLines(const QList<int> &lineNumbers);
+	bool IsLineDoneByServer(int line) const;
+	bool IsTileScheduler() const { return true; }
+	QList<int> GetCompletedLines() const;
+
+private:
+	enum enumTileState
+	{
+		tileFree = 0,
+		tileRendering = 1,
+		tileDone = 2,
+		tileDoneByServer = 3
+	};
+
+	void ResetTiles();
+	void ResetQueues();
+	// tile at given position of queues
+	int TileAtPosition(quint64 position) const
+	{
+		return tileOrder.isEmpty() ? (int)position : tileOrder[(int)position];
+	}
+	bool TakeOwnTile(int queueIndex, int *tileIndex);
+	// node < 0 - steals from any queue
+	bool StealTile(int *tileIndex, int node);
+	void TileFinished(int tileIndex);
+	void MarkLinesAsRendered(int y1, int y2);
+	bool SetTileDoneByServer(int tileIndex);
+
+	int tileSize;
+	int firstTileX;
+	int firstTileY;
+	int tilesX;
+	int tilesY;
+	int numberOfTiles;
+	int numberOfQueues;
+	bool reportWholeRows; // needed for NetRender, because only complete lines can be sent
+	QAtomicInt *tileState;
+	QAtomicInt *rowTilesFinished;
+	QAtomicInt tilesFinished;
+	QAtomicInteger<quint64> *queues; // packed ranges of tiles: begin | (end << 32)
+	QVector<int> queueNodes;
+	QVector<int> tileOrder; // indexes of tiles in the order of queues (empty - rows)
+};
+
+#endif /* MANDELBULBER2_SRC_TILE_SCHEDULER_HPP_ */
@@ -0,0 +1,215 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTiledRender class - rendering of very big still images in tiles
+ */
+
+#include "tiled_render.hpp"
+
+#include <QtCore>
+
+#include "cimage.hpp"
+#include "error_message.hpp"
+#include "file_image.hpp"
+#include "files.h"
+#include "fractal_container.hpp"
+#include "parameters.hpp"
+#include "region.hpp"
+#include "render_job.hpp"
+#include "rendering_configuration.hpp"
+#include "system.hpp"
+
+cTiledRender::cTiledRender(
+	const cParameterContainer *_params, const cFractalContainer *_fractal, bool *_stopRequest)
+		: QObject()
+{
+	// copies are needed because image size can be corrected
+	params = new cParameterContainer;
+	*params = *_params;
+	fractal = new cFractalContainer;
+	*fractal = *_fractal;
+	stopRequest = _stopRequest;
+	tiles = params->Get<int>("tiles");
+	tileIndex = 0;
+}
+
+cTiledRender::~cTiledRender()
+{
+	delete params;
+	delete fractal;
+}
+
+bool cTiledRender::IsTiledRenderingRequired(const cParameterContainer *params)
+{
+	// stereo images are composed from two full size images, so they can't be split
+	return params->Get<int>("tiles") > 1 && !params->Get<bool>("stereo_enabled");
+}
+
+bool cTiledRender::Render(const QString &filename)
+{
+	int fullWidth = params->Get<int>("image_width");
+	int fullHeight = params->Get<int>("image_height");
+
+	// all tiles have to be the same size
+	if (fullWidth % tiles != 0 || fullHeight % tiles != 0)
+	{
+		fullWidth -= fullWidth % tiles;
+		fullHeight -= fullHeight % tiles;
+		cErrorMessage::showMessage(
+			QObject::tr("Image size is not divisible by number of tiles. Image will be rendered with "
+									"size %1 x %2")
+				.arg(fullWidth)
+				.arg(fullHeight),
+			cErrorMessage::warningMessage);
+		params->Set("image_width", fullWidth);
+		params->Set("image_height", fullHeight);
+	}
+
+	int tileWidth = fullWidth / tiles;
+	int tileHeight = fullHeight / tiles;
+	int halo = params->Get<int>("tiles_halo");
+
+	WriteLog(QString("cTiledRender::Render(): %1 x %2 tiles, tile size %3 x %4")
+						 .arg(tiles)
+						 .arg(tiles)
+						 .arg(tileWidth)
+						 .arg(tileHeight),
+		2);
+
+	// the same image buffer is used for all tiles
+	cImage *image = new cImage(tileWidth + 2 * halo, tileHeight + 2 * halo);
+	sRGB16 *rowBuffer = new sRGB16[tileWidth];
+	QByteArray baseFilename = filename.toLocal8Bit();
+
+	cRenderingConfiguration config;
+	config.DisableRefresh();
+	config.DisableProgressiveRender();
+
+	bool result = true;
+	for (int tileRow = 0; tileRow < tiles && result; tileRow++)
+	{
+		for (int tile = 0; tile < tiles && result; tile++)
+		{
+			if (*stopRequest)
+			{
+				result = false;
+				break;
+			}
+
+			tileIndex = tile + tileRow * tiles;
+
+			// rendered region with halo limited to image borders
+			cRegion<int> centre(tile * tileWidth, tileRow * tileHeight, (tile + 1) * tileWidth,
+				(tileRow + 1) * tileHeight);
+			cRegion<int> rendered(qMax(centre.x1 - halo, 0), qMax(centre.y1 - halo, 0),
+				qMin(centre.x2 + halo, fullWidth), qMin(centre.y2 + halo, fullHeight));
+
+			cRenderJob *renderJob = new cRenderJob(params, fractal, image, stopRequest);
+			connect(renderJob,
+				SIGNAL(updateProgressAndStatus(const QString &, const QString &, double)), this,
+				SLOT(slotUpdateProgressAndStatus(const QString &, const QString &, double)));
+			connect(renderJob, SIGNAL(updateStatistics(cStatistics)), this,
+				SIGNAL(updateStatistics(cStatistics)));
+
+			renderJob->SetTile(rendered);
+			renderJob->Init(cRenderJob::still, config);
+			result = renderJob->Execute();
+			delete renderJob;
+			if (!result || *stopRequest)
+			{
+				result = false;
+				break;
+			}
+
+			// centre part of the tile is stored as raw 16-bit pixels
+			std::string tileFilename = IndexFilename(baseFilename.constData(), "tile", tileIndex);
+			FILE *file = fopen(tileFilename.c_str(), "wb");
+			if (!file)
+			{
+				cErrorMessage::showMessage(
+					QObject::tr("Can't write tile file!\n") + QString::fromStdString(tileFilename),
+					cErrorMessage::errorMessage);
+				result = false;
+				break;
+			}
+
+			int offsetX = centre.x1 - rendered.x1;
+			int offsetY = centre.y1 - rendered.y1;
+			for (int y = 0; y < tileHeight; y++)
+			{
+				for (int x = 0; x < tileWidth; x++)
+				{
+					rowBuffer[x] = image->GetPixelImage16(x + offsetX, y + offsetY);
+				}
+				if (fwrite(rowBuffer, sizeof(sRGB16), tileWidth, file) != (size_t)tileWidth)
+				{
+					result = false;
+					break;
+				}
+			}
+			fclose(file);
+		}
+	}
+
+	delete[] rowBuffer;
+	delete image;
+
+	if (result)
+	{
+		emit updateProgressAndStatus(
+			QObject::tr("Tiled rendering"), QObject::tr("Compiling image from tiles"), 1.0);
+
+		ImageFileSavePNG::SaveFromTilesPNG16(baseFilename.constData(), tileWidth, tileHeight, tiles);
+
+		QString finalFilename = filename + ".png";
+		QFile::remove(finalFilename);
+		result = QFile::rename(filename + "_fromTiles.png", finalFilename);
+	}
+	else
+	{
+		// temporary files of already rendered tiles are not needed anymore
+		for (int i = 0; i < tiles * tiles; i++)
+		{
+			QFile::remove(QString::fromStdString(IndexFilename(baseFilename.constData(), "tile", i)));
+		}
+	}
+
+	return result;
+}
+
+void cTiledRender::slotUpdateProgressAndStatus(
+	const QString &text, const QString &progressText, double progress)
+{
+	double totalProgress = (tileIndex + progress) / (tiles * tiles);
+	emit updateProgressAndStatus(text,
+		QObject::tr("Tile %1 of %2: ").arg(tileIndex + 1).arg(tiles * tiles) + progressText,
+		totalProgress);
+}
@@ -0,0 +1,85 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTiledRender class - rendering of very big still images in tiles
+ *
+ * Image is divided into tiles x tiles parts which are rendered one after another
+ * into the same small image buffer. Every tile is rendered with additional margin
+ * (halo) so post effects like SSAO and DOF have enough data on tile edges. Centre
+ * part of the tile is stored in temporary file and at the end all tiles are
+ * streamed row by row into the 16-bit PNG file, so whole image never has to fit
+ * into memory.
+ */
+
+#ifndef MANDELBULBER2_SRC_TILED_RENDER_HPP_
+#define MANDELBULBER2_SRC_TILED_RENDER_HPP_
+
+#include <QObject>
+#include <QString>
+
+#include "statistics.h"
+
+// forward declarations
+class cParameterContainer;
+class cFractalContainer;
+
+class cTiledRender : public QObject
+{
+	Q_OBJECT
+
+public:
+	cTiledRender(const cParameterContainer *_params, const cFractalContainer *_fractal,
+		bool *_stopRequest);
+	~cTiledRender();
+
+	// renders image to 16-bit PNG file (filename without extension). Returns false when failed
+	bool Render(const QString &filename);
+
+	// checks if image should be rendered in tiles
+	static bool IsTiledRenderingRequired(const cParameterContainer *params);
+
+signals:
+	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
+	void updateStatistics(cStatistics statistics);
+
+private slots:
+	void slotUpdateProgressAndStatus(
+		const QString &text, const QString &progressText, double progress);
+
+private:
+	cParameterContainer *params;
+	cFractalContainer *fractal;
+	bool *stopRequest;
+	int tiles;
+	int tileIndex;
+};
+
+#endif /* MANDELBULBER2_SRC_TILED_RENDER_HPP_ */
@@ -0,0 +1,194 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTrace class - recording of pipeline events in Chrome trace format
+ */
+
+
+#include "trace.hpp"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <cstdlib>
+
+#include "system.hpp"
+
+// events are written to the file when there is more of them
+#define TRACE_FLUSH_SIZE 20000
+
+bool cTrace::enabled = false;
+QFile cTrace::file;
+QElapsedTimer cTrace::timer;
+QMutex cTrace::mutex;
+QList<cTrace::sTraceEvent> cTrace::events;
+QHash<void *, int> cTrace::threadIndexes;
+QStringList cTrace::threadNames;
+int cTrace::writtenThreadNames = 0;
+
+bool cTrace::Enable(const QString &fileName)
+{
+	QMutexLocker lock(&mutex);
+	if (enabled) return true;
+
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qCritical() << "cTrace::Enable(): cannot open trace file" << fileName;
+		return false;
+	}
+
+	// closing bracket of the array is optional in Chrome trace format
+	file.write("[\n");
+	timer.start();
+	enabled = true;
+	atexit(FlushAtExit);
+	WriteLog("Trace of rendering pipeline is written to " + fileName, 1);
+	return true;
+}
+
+double cTrace::Now()
+{
+	return timer.nsecsElapsed() / 1000.0;
+}
+
+void cTrace::AddSpan(const char *name, const char *category, double start, double end,
+	const char *argName, qint64 argValue)
+{
+	sTraceEvent event;
+	event.name = name;
+	event.category = category;
+	event.argName = argName;
+	event.argValue = argValue;
+	event.start = start;
+	event.duration = end - start;
+	event.instant = false;
+	AddEvent(event);
+}
+
+void cTrace::AddInstant(
+	const char *name, const char *category, const char *argName, qint64 argValue)
+{
+	if (!enabled) return;
+
+	sTraceEvent event;
+	event.name = name;
+	event.category = category;
+	event.argName = argName;
+	event.argValue = argValue;
+	event.start = Now();
+	event.duration = 0.0;
+	event.instant = true;
+	AddEvent(event);
+}
+
+void cTrace::AddEvent(const sTraceEvent &event)
+{
+	mutex.lock();
+	events.append(event);
+	events.last().threadIndex = ThreadIndex();
+	bool flushNeeded = events.size() >= TRACE_FLUSH_SIZE;
+	mutex.unlock();
+
+	if (flushNeeded) Flush();
+}
+
+int cTrace::ThreadIndex()
+{
+	// has to be called with locked mutex
+	void *threadId = (void *)QThread::currentThreadId();
+	QHash<void *, int>::const_iterator it = threadIndexes.constFind(threadId);
+	if (it != threadIndexes.constEnd()) return it.value();
+
+	int index = threadIndexes.size() + 1;
+	threadIndexes.insert(threadId, index);
+
+	QString threadName = QThread::currentThread()->objectName();
+	if (threadName.isEmpty())
+	{
+		if (QCoreApplication::instance() && QThread::currentThread() == qApp->thread())
+			threadName = "main";
+		else
+			threadName = QString("thread %1").arg(index);
+	}
+	threadNames.append(threadName);
+	return index;
+}
+
+void cTrace::Flush()
+{
+	QMutexLocker lock(&mutex);
+	if (!enabled) return;
+
+	qint64 pid = QCoreApplication::applicationPid();
+	QByteArray text;
+
+	// names of threads are written as metadata events
+	for (; writtenThreadNames < threadNames.size(); writtenThreadNames++)
+	{
+		text += QString("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,\"tid\":%2,"
+										"\"args\":{\"name\":\"%3\"}},\n")
+							.arg(pid)
+							.arg(writtenThreadNames + 1)
+							.arg(threadNames.at(writtenThreadNames))
+							.toUtf8();
+	}
+
+	for (int i = 0; i < events.size(); i++)
+	{
+		const sTraceEvent &event = events.at(i);
+		QString line = QString("{\"name\":\"%1\",\"cat\":\"%2\",\"pid\":%3,\"tid\":%4,\"ts\":%5")
+										 .arg(event.name)
+										 .arg(event.category)
+										 .arg(pid)
+										 .arg(event.threadIndex)
+										 .arg(event.start, 0, 'f', 3);
+		if (event.instant)
+			line += ",\"ph\":\"i\",\"s\":\"t\"";
+		else
+			line += QString(",\"ph\":\"X\",\"dur\":%1").arg(event.duration, 0, 'f', 3);
+		if (event.argName)
+			line += QString(",\"args\":{\"%1\":%2}").arg(event.argName).arg(event.argValue);
+		line += "},\n";
+		text += line.toUtf8();
+	}
+	events.clear();
+
+	file.write(text);
+	file.flush();
+}
+
+void cTrace::FlushAtExit()
+{
+	Flush();
+	QMutexLocker lock(&mutex);
+	file.close();
+	enabled = false;
+}
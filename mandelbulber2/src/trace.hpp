@@ -0,0 +1,141 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cTrace class - recording of pipeline events in Chrome trace format
+ *
+ * Spans of rendering stages (jobs, progressive passes, lines and tiles of worker
+ * threads, post-processing, saving, NetRender messages) are written to JSON file
+ * which can be opened in chrome://tracing or Perfetto UI. Recording is compiled
+ * in only with USE_TRACE (qmake CONFIG+=trace) and enabled with --trace option.
+ * Without USE_TRACE all TRACE_ macros are empty.
+ */
+
+
+#ifndef MANDELBULBER2_SRC_TRACE_HPP_
+#define MANDELBULBER2_SRC_TRACE_HPP_
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class cTrace
+{
+public:
+	// opens trace file. Events are appended to the file in chunks, so the trace is usable also when
+	// program was terminated
+	static bool Enable(const QString &fileName);
+	static bool IsEnabled() { return enabled; }
+
+	// time in microseconds from enabling of tracing
+	static double Now();
+
+	// arguments with empty argName are not written
+	static void AddSpan(const char *name, const char *category, double start, double end,
+		const char *argName = NULL, qint64 argValue = 0);
+	static void AddInstant(
+		const char *name, const char *category, const char *argName = NULL, qint64 argValue = 0);
+
+	// writes all collected events to the file
+	static void Flush();
+
+private:
+	struct sTraceEvent
+	{
+		const char *name;
+		const char *category;
+		const char *argName;
+		qint64 argValue;
+		double start;
+		double duration;
+		int threadIndex;
+		bool instant;
+	};
+
+	static void AddEvent(const sTraceEvent &event);
+	static int ThreadIndex();
+	static void FlushAtExit();
+
+	static bool enabled;
+	static QFile file;
+	static QElapsedTimer timer;
+	static QMutex mutex;
+	static QList<sTraceEvent> events;
+	static QHash<void *, int> threadIndexes;
+	static QStringList threadNames;
+	static int writtenThreadNames;
+};
+
+// records span from construction to destruction of the object
+class cTraceScope
+{
+public:
+	cTraceScope(const char *_name, const char *_category, const char *_argName = NULL,
+		qint64 _argValue = 0)
+			: name(_name), category(_category), argName(_argName), argValue(_argValue)
+	{
+		start = cTrace::IsEnabled() ? cTrace::Now() : 0.0;
+	}
+	~cTraceScope()
+	{
+		if (cTrace::IsEnabled())
+			cTrace::AddSpan(name, category, start, cTrace::Now(), argName, argValue);
+	}
+
+private:
+	const char *name;
+	const char *category;
+	const char *argName;
+	qint64 argValue;
+	double start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+#ifdef USE_TRACE
+#define TRACE_SCOPE(name, category) cTraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+#define TRACE_SCOPE_ARG(name, category, argName, argValue) \
+	cTraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category, argName, argValue)
+#define TRACE_INSTANT(name, category, argName, argValue) \
+	cTrace::AddInstant(name, category, argName, argValue)
+#define TRACE_FLUSH() cTrace::Flush()
+#else
+#define TRACE_SCOPE(name, category)
+#define TRACE_SCOPE_ARG(name, category, argName, argValue)
+#define TRACE_INSTANT(name, category, argName, argValue)
+#define TRACE_FLUSH()
+#endif
+
+#endif /* MANDELBULBER2_SRC_TRACE_HPP_ */
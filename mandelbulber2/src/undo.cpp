@@ -36,12 +36,14 @@
  * The buffer is a simple LIFO buffer which holds the parameter entries.
  * (A Store() invocation while Undo-ed in the list will truncate to the current level
  * and append the new entry. The Redo entries will be lost.)
+ *
+ * Entries between checkpoints hold only changes against the previous entry.
  */
 
 #include "undo.h"
+#include "autosave.hpp"
 #include "error_message.hpp"
 #include "initparameters.hpp"
-#include "settings.hpp"
 #include "system.hpp"
 
 cUndo gUndo;
@@ -58,37 +60,19 @@ cUndo::~cUndo()
 void cUndo::Store(cParameterContainer *par, cFractalContainer *parFractal, cAnimationFrames *frames,
 	cKeyframes *keyframes)
 {
-	sUndoRecord record;
-
-	// autosave
-	WriteLog("Autosave started", 2);
-	cSettings parSettings(cSettings::formatCondensedText);
-	parSettings.CreateText(gPar, gParFractal, gAnimFrames, gKeyframes);
-	parSettings.SaveToFile(systemData.GetAutosaveFile());
-	WriteLog("Autosave finished", 2);
+	// autosave is written in background
+	if (gAutosave) gAutosave->Store(gPar, gParFractal, gAnimFrames, gKeyframes);
 
 	WriteLog("cUndo::Store() started", 2);
-	record.mainParams = *par;
-	record.fractParams = *parFractal;
-	if (frames)
-	{
-		record.animationFrames = *frames;
-		record.hasFrames = true;
-	}
-	else
-	{
-		record.hasFrames = false;
-	}
 
-	if (keyframes)
-	{
-		record.animationKeyframes = *keyframes;
-		record.hasKeyframes = true;
-	}
-	else
-	{
-		record.hasKeyframes = false;
-	}
+	// containers are implicitly shared, so copying of the state is cheap
+	sUndoState state;
+	state.mainParams = *par;
+	state.fractParams = *parFractal;
+	state.hasFrames = frames != NULL;
+	if (frames) state.animationFrames = *frames;
+	state.hasKeyframes = keyframes != NULL;
+	if (keyframes) state.animationKeyframes = *keyframes;
 
 	if (undoBuffer.size() > level)
 	{
@@ -98,7 +82,32 @@ void cUndo::Store(cParameterContainer *par, cFractalContainer *parFractal, cAnim
 		}
 	}
 
+	int lastCheckpoint = level - 1;
+	while (lastCheckpoint >= 0 && !undoBuffer.at(lastCheckpoint).checkpoint)
+		lastCheckpoint--;
+
+	sUndoRecord record;
+	record.checkpoint = level == 0 || level - lastCheckpoint >= UNDO_CHECKPOINT_INTERVAL
+											|| !SameLayout(currentState, state);
+	if (record.checkpoint)
+	{
+		record.state = state;
+	}
+	else
+	{
+		record.mainChanges = ParameterChanges(currentState.mainParams, state.mainParams);
+		for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+			record.fractalChanges[f] =
+				ParameterChanges(currentState.fractParams.at(f), state.fractParams.at(f));
+		if (state.hasFrames)
+			record.frameChanges = FrameChanges(currentState.animationFrames, state.animationFrames);
+		if (state.hasKeyframes)
+			record.keyframeChanges =
+				FrameChanges(currentState.animationKeyframes, state.animationKeyframes);
+	}
+
 	undoBuffer.append(record);
+	currentState = state;
 	level++;
 	WriteLog("cUndo::Store() finished", 2);
 }
@@ -108,23 +117,15 @@ bool cUndo::Undo(cParameterContainer *par, cFractalContainer *parFractal, cAnima
 {
 	if (level > 1)
 	{
-		sUndoRecord record;
 		if (undoBuffer.length() >= level)
 		{
+			const sUndoRecord &record = undoBuffer.at(level - 1);
+			if (record.checkpoint)
+				currentState = ReconstructState(level - 2);
+			else
+				ApplyRecord(&currentState, record, false);
 			level--;
-			record = undoBuffer.at(level - 1);
-			*par = record.mainParams;
-			*parFractal = record.fractParams;
-			if (frames && record.hasFrames)
-			{
-				*frames = record.animationFrames;
-				*refreshFrames = true;
-			}
-			if (keyframes && record.hasKeyframes)
-			{
-				*keyframes = record.animationKeyframes;
-				*refreshKeyframes = true;
-			}
+			WriteState(par, parFractal, frames, keyframes, refreshFrames, refreshKeyframes);
 		}
 		return true;
 	}
@@ -140,21 +141,13 @@ bool cUndo::Redo(cParameterContainer *par, cFractalContainer *parFractal, cAnima
 {
 	if (level < undoBuffer.size())
 	{
-		sUndoRecord record;
-		record = undoBuffer.at(level);
+		const sUndoRecord &record = undoBuffer.at(level);
+		if (record.checkpoint)
+			currentState = record.state;
+		else
+			ApplyRecord(&currentState, record, true);
 		level++;
-		*par = record.mainParams;
-		*parFractal = record.fractParams;
-		if (frames && record.hasFrames)
-		{
-			*frames = record.animationFrames;
-			*refreshFrames = true;
-		}
-		if (keyframes && record.hasKeyframes)
-		{
-			*keyframes = record.animationKeyframes;
-			*refreshKeyframes = true;
-		}
+		WriteState(par, parFractal, frames, keyframes, refreshFrames, refreshKeyframes);
 		return true;
 	}
 	else
@@ -163,3 +156,160 @@ bool cUndo::Redo(cParameterContainer *par, cFractalContainer *parFractal, cAnima
 		return false;
 	}
 }
+
+void cUndo::WriteState(cParameterContainer *par, cFractalContainer *parFractal,
+	cAnimationFrames *frames, cKeyframes *keyframes, bool *refreshFrames,
+	bool *refreshKeyframes) const
+{
+	*par = currentState.mainParams;
+	*parFractal = currentState.fractParams;
+	if (frames && currentState.hasFrames)
+	{
+		*frames = currentState.animationFrames;
+		*refreshFrames = true;
+	}
+	if (keyframes && currentState.hasKeyframes)
+	{
+		*keyframes = currentState.animationKeyframes;
+		*refreshKeyframes = true;
+	}
+}
+
+cUndo::sUndoState cUndo::ReconstructState(int index) const
+{
+	int checkpoint = index;
+	while (checkpoint > 0 && !undoBuffer.at(checkpoint).checkpoint)
+		checkpoint--;
+
+	sUndoState state = undoBuffer.at(checkpoint).state;
+	for (int i = checkpoint + 1; i <= index; i++)
+		ApplyRecord(&state, undoBuffer.at(i), true);
+	return state;
+}
+
+void cUndo::ApplyRecord(sUndoState *state, const sUndoRecord &record, bool forward)
+{
+	ApplyParameterChanges(&state->mainParams, record.mainChanges, forward);
+	for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+		ApplyParameterChanges(&state->fractParams.at(f), record.fractalChanges[f], forward);
+	ApplyFrameChanges(&state->animationFrames, record.frameChanges, forward);
+	ApplyFrameChanges(&state->animationKeyframes, record.keyframeChanges, forward);
+}
+
+bool cUndo::SameLayout(const sUndoState &oldState, const sUndoState &newState)
+{
+	if (oldState.mainParams.GetLayoutStamp() != newState.mainParams.GetLayoutStamp()) return false;
+	for (int f = 0; f < NUMBER_OF_FRACTALS; f++)
+	{
+		if (oldState.fractParams.at(f).GetLayoutStamp() != newState.fractParams.at(f).GetLayoutStamp())
+			return false;
+	}
+
+	if (oldState.hasFrames != newState.hasFrames || oldState.hasKeyframes != newState.hasKeyframes)
+		return false;
+	if (newState.hasFrames && !SameFramesLayout(oldState.animationFrames, newState.animationFrames))
+		return false;
+	if (newState.hasKeyframes)
+	{
+		if (oldState.animationKeyframes.GetFramesPerKeyframe()
+				!= newState.animationKeyframes.GetFramesPerKeyframe())
+			return false;
+		if (!SameFramesLayout(oldState.animationKeyframes, newState.animationKeyframes)) return false;
+	}
+	return true;
+}
+
+bool cUndo::SameFramesLayout(const cAnimationFrames &oldFrames, const cAnimationFrames &newFrames)
+{
+	// frames can be changed only one by one
+	if (oldFrames.GetNumberOfFrames() != newFrames.GetNumberOfFrames()) return false;
+
+	QList<cAnimationFrames::sParameterDescription> oldList = oldFrames.GetListOfParameters();
+	QList<cAnimationFrames::sParameterDescription> newList = newFrames.GetListOfParameters();
+	if (oldList.size() != newList.size()) return false;
+	for (int i = 0; i < newList.size(); i++)
+	{
+		if (oldList[i].parameterName != newList[i].parameterName
+				|| oldList[i].containerName != newList[i].containerName
+				|| oldList[i].morphType != newList[i].morphType)
+			return false;
+	}
+	return true;
+}
+
+bool cUndo::SameParameters(const cParameterContainer &oldPar, const cParameterContainer &newPar)
+{
+	if (oldPar.GetLayoutStamp() != newPar.GetLayoutStamp()) return false;
+	for (int i = 0; i < newPar.GetNumberOfHandles(); i++)
+	{
+		sParameterHandle handle;
+		handle.index = i;
+		if (oldPar.GetModificationStamp(handle) != newPar.GetModificationStamp(handle)) return false;
+	}
+	return true;
+}
+
+QList<cUndo::sParameterChange> cUndo::ParameterChanges(
+	const cParameterContainer &oldPar, const cParameterContainer &newPar)
+{
+	// both containers have the same layout, so handles are the same
+	QList<sParameterChange> changes;
+	for (int i = 0; i < newPar.GetNumberOfHandles(); i++)
+	{
+		sParameterHandle handle;
+		handle.index = i;
+		if (!newPar.IsValidHandle(handle)) continue;
+		if (oldPar.GetModificationStamp(handle) != newPar.GetModificationStamp(handle))
+		{
+			sParameterChange change;
+			change.handle = handle;
+			change.oldValue = oldPar.GetAsOneParameter(handle);
+			change.newValue = newPar.GetAsOneParameter(handle);
+			changes.append(change);
+		}
+	}
+	return changes;
+}
+
+QList<cUndo::sFrameChange> cUndo::FrameChanges(
+	const cAnimationFrames &oldFrames, const cAnimationFrames &newFrames)
+{
+	QList<sFrameChange> changes;
+	for (int i = 0; i < newFrames.GetNumberOfFrames(); i++)
+	{
+		cAnimationFrames::sAnimationFrame oldFrame = oldFrames.GetFrame(i);
+		cAnimationFrames::sAnimationFrame newFrame = newFrames.GetFrame(i);
+		if (oldFrame.alreadyRendered != newFrame.alreadyRendered
+				|| oldFrame.alreadyRenderedSubFrames != newFrame.alreadyRenderedSubFrames
+				|| !SameParameters(oldFrame.parameters, newFrame.parameters))
+		{
+			sFrameChange change;
+			change.index = i;
+			change.oldFrame = oldFrame;
+			change.newFrame = newFrame;
+			changes.append(change);
+		}
+	}
+	return changes;
+}
+
+void cUndo::ApplyParameterChanges(
+	cParameterContainer *par, const QList<sParameterChange> &changes, bool forward)
+{
+	for (int i = 0; i < changes.size(); i++)
+	{
+		const sParameterChange &change = changes.at(i);
+		par->SetFromOneParameter(change.handle, forward ? change.newValue : change.oldValue);
+	}
+}
+
+void cUndo::ApplyFrameChanges(
+	cAnimationFrames *frames, const QList<sFrameChange> &changes, bool forward)
+{
+	for (int i = 0; i < changes.size(); i++)
+	{
+		cAnimationFrames::sAnimationFrame frame =
+			forward ? changes.at(i).newFrame : changes.at(i).oldFrame;
+		frames->ModifyFrame(changes.at(i).index, frame);
+	}
+}
@@ -36,6 +36,10 @@
  * The buffer is a simple LIFO buffer which holds the parameter entries.
  * (A Store() invocation while Undo-ed in the list will truncate to the current level
  * and append the new entry. The Redo entries will be lost.)
+ *
+ * Most entries hold only changed parameters and animation frames (old and new values),
+ * found by modification stamps of parameters. Every UNDO_CHECKPOINT_INTERVAL entries, and
+ * when set of parameters has changed, the entry holds the whole state.
  */
 
 #ifndef MANDELBULBER2_SRC_UNDO_H_
@@ -48,6 +52,8 @@
 #include "keyframes.hpp"
 #include "parameters.hpp"
 
+#define UNDO_CHECKPOINT_INTERVAL 20
+
 class cUndo
 {
 public:
@@ -60,8 +66,13 @@ public:
 	bool Redo(cParameterContainer *par, cFractalContainer *parFractal, cAnimationFrames *frames,
 		cKeyframes *keyframes, bool *refreshFrames, bool *refreshKeyframes);
 
+	// comparisons by modification stamps, used also by autosave
+	static bool SameFramesLayout(const cAnimationFrames &oldFrames,
+		const cAnimationFrames &newFrames);
+	static bool SameParameters(const cParameterContainer &oldPar, const cParameterContainer &newPar);
+
 private:
-	struct sUndoRecord
+	struct sUndoState
 	{
 		cParameterContainer mainParams;
 		cFractalContainer fractParams;
@@ -71,7 +82,48 @@ private:
 		bool hasKeyframes;
 	};
 
+	struct sParameterChange
+	{
+		sParameterHandle handle;
+		cOneParameter oldValue;
+		cOneParameter newValue;
+	};
+
+	struct sFrameChange
+	{
+		int index;
+		cAnimationFrames::sAnimationFrame oldFrame;
+		cAnimationFrames::sAnimationFrame newFrame;
+	};
+
+	struct sUndoRecord
+	{
+		bool checkpoint;
+		sUndoState state; // only for checkpoint
+		QList<sParameterChange> mainChanges;
+		QList<sParameterChange> fractalChanges[NUMBER_OF_FRACTALS];
+		QList<sFrameChange> frameChanges;
+		QList<sFrameChange> keyframeChanges;
+	};
+
+	static bool SameLayout(const sUndoState &oldState, const sUndoState &newState);
+	static QList<sParameterChange> ParameterChanges(
+		const cParameterContainer &oldPar, const cParameterContainer &newPar);
+	static QList<sFrameChange> FrameChanges(
+		const cAnimationFrames &oldFrames, const cAnimationFrames &newFrames);
+	static void ApplyParameterChanges(
+		cParameterContainer *par, const QList<sParameterChange> &changes, bool forward);
+	static void ApplyFrameChanges(
+		cAnimationFrames *frames, const QList<sFrameChange> &changes, bool forward);
+	static void ApplyRecord(sUndoState *state, const sUndoRecord &record, bool forward);
+	// rebuilds state from the nearest checkpoint
+	sUndoState ReconstructState(int index) const;
+	void WriteState(cParameterContainer *par, cFractalContainer *parFractal,
+		cAnimationFrames *frames, cKeyframes *keyframes, bool *refreshFrames,
+		bool *refreshKeyframes) const;
+
 	QList<sUndoRecord> undoBuffer;
+	sUndoState currentState; // state of entry level - 1
 	int level;
 };
 
@@ -34,18 +34,26 @@
  * This class calculates the volume in between the limitMin and limitMax points
  * with a resolution of w * h * l. for each voxel ProcessVolume() determines if the point
  * is inside the fractal, or not. The result is saved in layers of X-Y planes in StoreLayer
- * to the output folder as a black-and-white PNG file.
+ * to the output folder as a black-and-white PNG file or all layers are stored in one sparse
+ * volume file by cSparseVolumeWriter.
  */
 
 #include "voxel_export.hpp"
 #include "calculate_distance.hpp"
 #include "common_math.h"
+#include "empty_space_map.hpp"
 #include "file_image.hpp"
 #include "fractparams.hpp"
 #include "fractal_container.hpp"
 #include "initparameters.hpp"
+#include "netrender.hpp"
 #include "progress_text.hpp"
 #include "nine_fractals.hpp"
+#include "sparse_volume_writer.hpp"
+#include "system.hpp"
+
+// number of layers calculated at the same time
+#define VOXEL_EXPORT_GROUP_SIZE 4
 
 cVoxelExport::cVoxelExport(
 	int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QDir folder, int maxIter)
@@ -58,7 +66,13 @@ cVoxelExport::cVoxelExport(
 	this->limitMax = limitMax;
 	this->folder = folder;
 	this->maxIter = maxIter;
-	voxelLayer = new unsigned char[w * h];
+	voxelLayer = new unsigned char[w * h * VOXEL_EXPORT_GROUP_SIZE];
+	params = NULL;
+	fractals = NULL;
+	volumeWriter = NULL;
+	stepX = stepY = stepZ = 0.0;
+	distThresh = 0.0;
+	externalStop = NULL;
 	stop = false;
 }
 
@@ -67,74 +81,484 @@ cVoxelExport::~cVoxelExport()
 	delete[] voxelLayer;
 }
 
-void cVoxelExport::ProcessVolume()
+void cVoxelExport::PrepareCalculation()
 {
-	const cNineFractals *fractals = new cNineFractals(gParFractal, gPar);
-	cParamRender *params = new cParamRender(gPar);
+	fractals = new cNineFractals(gParFractal, gPar);
+	params = new cParamRender(gPar);
 
 	params->N = maxIter;
 
-	double stepX = (limitMax.x - limitMin.x) * (1.0 / w);
-	double stepY = (limitMax.y - limitMin.y) * (1.0 / h);
-	double stepZ = (limitMax.z - limitMin.z) * (1.0 / l);
-	double dist_thresh = 0.5 * dMin(stepX, stepY, stepZ) / params->detailLevel;
+	stepX = (limitMax.x - limitMin.x) * (1.0 / w);
+	stepY = (limitMax.y - limitMin.y) * (1.0 / h);
+	stepZ = (limitMax.z - limitMin.z) * (1.0 / l);
+	distThresh = 0.5 * dMin(stepX, stepY, stepZ) / params->detailLevel;
+
+	ResetEmptySpaceMaps();
+}
+
+void cVoxelExport::ResetEmptySpaceMaps()
+{
+	// points which are far from the fractal are empty and don't need to be calculated.
+	// Every layer of the group has own map
+	qDeleteAll(emptySpaces);
+	emptySpaces.clear();
+	for (int k = 0; k < VOXEL_EXPORT_GROUP_SIZE; k++)
+	{
+		emptySpaces.append(
+			new cEmptySpaceMap(w, h, stepX, stepY, stepZ, qMin(1.0, params->DEFactor), distThresh));
+	}
+}
+
+void cVoxelExport::FinishCalculation()
+{
+	qint64 numberOfCalculated = 0;
+	qint64 numberOfSkipped = 0;
+	for (int k = 0; k < emptySpaces.size(); k++)
+	{
+		numberOfCalculated += emptySpaces[k]->GetNumberOfCalculated();
+		numberOfSkipped += emptySpaces[k]->GetNumberOfSkipped();
+	}
+	qDeleteAll(emptySpaces);
+	emptySpaces.clear();
+
+	WriteLog(QString("Voxel export: calculated %1 points, skipped %2 empty points")
+						 .arg(numberOfCalculated)
+						 .arg(numberOfSkipped),
+		2);
+
+	delete fractals;
+	delete params;
+	fractals = NULL;
+	params = NULL;
+}
+
+void cVoxelExport::ProcessVolume()
+{
+	PrepareCalculation();
 
 	cProgressText progressText;
 	progressText.ResetTimer();
 
-	for (int z = 0; z < l; z++)
+	enumVoxelFileFormat outputFormat = enumVoxelFileFormat(gPar->Get<int>("voxel_output_format"));
+	bool storeDistances = gPar->Get<bool>("voxel_store_distances");
+	QVector<float> distanceLayers;
+	if (outputFormat == voxelFormatSparseVolume)
 	{
-		QString statusText =
-			" - " + tr("Processing layer %1 of %2").arg(QString::number(z + 1), QString::number(l));
-		double percentDone = (double)z / l;
+		// distances are kept in narrow band around the surface which covers one brick
+		double bandDistance =
+			distThresh + SPARSE_VOLUME_BRICK_SIZE * sqrt(stepX * stepX + stepY * stepY + stepZ * stepZ);
+		volumeWriter =
+			new cSparseVolumeWriter(w, h, l, limitMin, limitMax, storeDistances, bandDistance);
+		QString filename = folder.absolutePath() + QDir::separator() + "volume.mbv";
+		if (!volumeWriter->Open(filename)) stop = true;
+		if (storeDistances) distanceLayers.resize(w * h * VOXEL_EXPORT_GROUP_SIZE);
+	}
+
+	bool distributed = false;
+	if (!stop && gPar->Get<bool>("voxel_netrender") && gNetRender->IsServer()
+			&& gNetRender->GetClientCount() > 0)
+	{
+		distributed = ProcessVolumeDistributed(volumeWriter && storeDistances);
+	}
+
+	int layerSize = w * h;
+
+	// layers are calculated in groups, so threads don't wait for each other after every layer
+	for (int firstZ = 0; firstZ < l && !distributed; firstZ += VOXEL_EXPORT_GROUP_SIZE)
+	{
+		int numberOfLayers = qMin(VOXEL_EXPORT_GROUP_SIZE, l - firstZ);
+
+		QString statusText = " - " + tr("Processing layer %1 of %2").arg(firstZ + 1).arg(l);
+		double percentDone = (double)firstZ / l;
 		emit updateProgressAndStatus(
 			tr("Voxel Export") + statusText, progressText.getText(percentDone), percentDone);
 
-#pragma omp parallel for
-		for (int x = 0; x < w; x++)
+		memset(voxelLayer, 0, layerSize * VOXEL_EXPORT_GROUP_SIZE);
+		CalculateGroup(firstZ, numberOfLayers, voxelLayer,
+			distanceLayers.isEmpty() ? NULL : distanceLayers.data());
+
+		if (stop) break;
+
+		if (!StoreLayers(firstZ, numberOfLayers, voxelLayer,
+					distanceLayers.isEmpty() ? NULL : distanceLayers.data()))
+			break;
+	}
+
+	if (volumeWriter && !volumeWriter->Close())
+	{
+		qCritical() << "Cannot write voxel volume to folder" << folder.absolutePath();
+	}
+	delete volumeWriter;
+	volumeWriter = NULL;
+
+	FinishCalculation();
+
+	QString statusText;
+	if (stop)
+		statusText = tr("Voxel Export finished - Cancelled export");
+	else
+		statusText = tr("Voxel Export finished - Processed %1 layers").arg(QString::number(l));
+	emit updateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
+	emit finished();
+}
+
+void cVoxelExport::CalculateGroup(
+	int firstZ, int numberOfLayers, unsigned char *voxels, float *distanceLayers)
+{
+	int layerSize = w * h;
+	cEmptySpaceMap *lastEmptySpace = emptySpaces.last();
+
+	// bounds of distance for all layers of the group come from the last layer of previous group.
+	// The last map is updated as the last one, because the others read from it
+	for (int k = 0; k < numberOfLayers; k++)
+		emptySpaces[k]->NextLayer(*lastEmptySpace, k + 1);
+
+	for (int level = lastEmptySpace->GetNumberOfLevels() - 1; level >= 0; level--)
+	{
+		// points of all layers are calculated together
+		QVector<int> indices;
+		QVector<int> layers;
+		for (int k = 0; k < numberOfLayers; k++)
 		{
-			CVector3 point;
-			for (int y = 0; y < h; y++)
+			QVector<int> layerIndices = emptySpaces[k]->PointsToCalculate(level);
+			indices += layerIndices;
+			for (int i = 0; i < layerIndices.size(); i++)
+				layers.append(k);
+		}
+
+		// points are calculated in batches
+		const int batchSize = 64;
+		int numberOfBatches = (indices.size() + batchSize - 1) / batchSize;
+
+#pragma omp parallel for schedule(dynamic, 1)
+		for (int batch = 0; batch < numberOfBatches; batch++)
+		{
+			if (IsStopped()) continue;
+
+			CVector3 points[batchSize];
+			double detailSizes[batchSize];
+			double distances[batchSize];
+			sDistanceOut distanceOuts[batchSize];
+
+			int first = batch * batchSize;
+			int count = qMin(batchSize, indices.size() - first);
+			for (int i = 0; i < count; i++)
 			{
-				if (stop) break;
-				point.x = limitMin.x + x * stepX;
-				point.y = limitMin.y + y * stepY;
-				point.z = limitMin.z + z * stepZ;
+				int index = indices[first + i];
+				points[i].x = limitMin.x + (index % w) * stepX;
+				points[i].y = limitMin.y + (index / w) * stepY;
+				points[i].z = limitMin.z + (firstZ + layers[first + i]) * stepZ;
+				detailSizes[i] = distThresh;
+			}
 
-				sDistanceOut distanceOut;
-				sDistanceIn distanceIn(point, dist_thresh, false);
+			CalculateDistanceBatch(
+				*params, *fractals, points, detailSizes, count, distances, distanceOuts);
+
+			for (int i = 0; i < count; i++)
+			{
+				int index = indices[first + i];
+				int k = layers[first + i];
+				emptySpaces.at(k)->SetDistance(index, distances[i]);
+				voxels[k * layerSize + index] = (unsigned char)(distances[i] <= distThresh);
+				if (distanceLayers) distanceLayers[k * layerSize + index] = float(distances[i]);
+			}
+		}
+	}
 
-				double dist = CalculateDistance(*params, *fractals, distanceIn, &distanceOut);
+	if (IsStopped()) stop = true;
 
-				voxelLayer[x + y * w] = (unsigned char)(dist <= dist_thresh);
+	if (distanceLayers)
+	{
+		// skipped points get only bound of the distance
+		for (int k = 0; k < numberOfLayers; k++)
+		{
+			float *distanceLayer = distanceLayers + k * layerSize;
+			for (int index = 0; index < layerSize; index++)
+			{
+				if (!emptySpaces[k]->IsCalculated(index))
+					distanceLayer[index] = float(emptySpaces[k]->GetDistanceBound(index));
 			}
 		}
+	}
+}
 
-		if (stop || !StoreLayer(z))
+bool cVoxelExport::StoreLayers(
+	int firstZ, int numberOfLayers, unsigned char *voxels, float *distanceLayers)
+{
+	int layerSize = w * h;
+	if (volumeWriter)
+	{
+		// sparse volume is compressed and written by separate thread
+		for (int k = 0; k < numberOfLayers; k++)
 		{
-			break;
+			volumeWriter->AddLayer(
+				voxels + k * layerSize, distanceLayers ? distanceLayers + k * layerSize : NULL);
 		}
+		return true;
 	}
+	else
+	{
+		// images of the group are compressed and saved in parallel
+		int failedLayers = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : failedLayers)
+		for (int k = 0; k < numberOfLayers; k++)
+		{
+			if (!StoreLayer(firstZ + k, voxels + k * layerSize)) failedLayers++;
+		}
+		return failedLayers == 0;
+	}
+}
 
-	delete fractals;
-	delete params;
-	QString statusText;
-	if (stop)
-		statusText = tr("Voxel Export finished - Cancelled export");
+bool cVoxelExport::CalculateSlab(int firstZ, int numberOfLayers, bool storeDistances,
+	QByteArray *voxels, QByteArray *distances, const bool *stopRequest)
+{
+	externalStop = stopRequest;
+	PrepareCalculation();
+
+	int layerSize = w * h;
+	voxels->fill(0, layerSize * numberOfLayers);
+	if (storeDistances)
+		distances->resize(layerSize * numberOfLayers * int(sizeof(float)));
 	else
-		statusText = tr("Voxel Export finished - Processed %1 layers").arg(QString::number(l));
-	emit updateProgressAndStatus(statusText, progressText.getText(1.0), 1.0);
-	emit finished();
+		distances->clear();
+
+	for (int z = 0; z < numberOfLayers; z += VOXEL_EXPORT_GROUP_SIZE)
+	{
+		int groupLayers = qMin(VOXEL_EXPORT_GROUP_SIZE, numberOfLayers - z);
+		float *distanceLayers =
+			storeDistances ? reinterpret_cast<float *>(distances->data()) + z * layerSize : NULL;
+		CalculateGroup(firstZ + z, groupLayers,
+			reinterpret_cast<unsigned char *>(voxels->data()) + z * layerSize, distanceLayers);
+		if (stop) break;
+	}
+
+	FinishCalculation();
+	externalStop = NULL;
+	return !stop;
+}
+
+bool cVoxelExport::ProcessVolumeDistributed(bool storeDistances)
+{
+	if (!gNetRender->Block()) return false;
+
+	QList<sVoxelSlabJob> slabs;
+	for (int firstZ = 0; firstZ < l; firstZ += VOXEL_EXPORT_SLAB_LAYERS)
+	{
+		sVoxelSlabJob slab;
+		slab.index = slabs.size();
+		slab.firstZ = firstZ;
+		slab.numberOfLayers = qMin(VOXEL_EXPORT_SLAB_LAYERS, l - firstZ);
+		slab.w = w;
+		slab.h = h;
+		slab.l = l;
+		slab.limitMin = limitMin;
+		slab.limitMax = limitMax;
+		slab.maxIter = maxIter;
+		slab.storeDistances = storeDistances;
+		slabs.append(slab);
+	}
+
+	// all calls of gNetRender are done in its thread
+	cVoxelSlabDistribution *distribution = new cVoxelSlabDistribution(slabs, *gPar, *gParFractal);
+	QThread *netRenderThread = gNetRender->thread();
+	bool sameThread = QThread::currentThread() == netRenderThread;
+	Qt::ConnectionType connectionType =
+		sameThread ? Qt::DirectConnection : Qt::BlockingQueuedConnection;
+	distribution->moveToThread(netRenderThread);
+	QMetaObject::invokeMethod(distribution, "slotStart", connectionType);
+
+	cProgressText progressText;
+	progressText.ResetTimer();
+	WriteLog(QString("Voxel export: %1 slabs distributed over NetRender").arg(slabs.size()), 2);
+
+	// slabs calculated by the server are kept until all previous slabs are stored
+	QHash<int, QPair<QByteArray, QByteArray>> localSlabs;
+	int nextToStore = 0;
+	while (nextToStore < slabs.size() && !stop)
+	{
+		QByteArray voxels;
+		QByteArray distances;
+		if (localSlabs.contains(nextToStore)
+				|| distribution->TakeReceivedSlab(nextToStore, &voxels, &distances))
+		{
+			if (localSlabs.contains(nextToStore))
+			{
+				voxels = localSlabs[nextToStore].first;
+				distances = localSlabs.take(nextToStore).second;
+			}
+			const sVoxelSlabJob &slab = slabs.at(nextToStore);
+			int layerSize = w * h;
+			bool valid = voxels.size() == layerSize * slab.numberOfLayers
+									 && (!storeDistances || distances.size() == voxels.size() * int(sizeof(float)));
+			if (!valid)
+			{
+				qCritical() << "Voxel export: wrong size of data of slab" << nextToStore;
+				stop = true;
+				break;
+			}
+			if (!StoreLayers(slab.firstZ, slab.numberOfLayers,
+						reinterpret_cast<unsigned char *>(voxels.data()),
+						storeDistances ? reinterpret_cast<float *>(distances.data()) : NULL))
+				break;
+			nextToStore++;
+			continue;
+		}
+
+		double percentDone = (double)nextToStore / slabs.size();
+		QString statusText =
+			" - " + tr("Processing slab %1 of %2 (NetRender)").arg(nextToStore + 1).arg(slabs.size());
+		emit updateProgressAndStatus(
+			tr("Voxel Export") + statusText, progressText.getText(percentDone), percentDone);
+
+		// server calculates slabs which are not taken by clients
+		int localSlab = distribution->TakeWaitingSlab();
+		if (localSlab >= 0)
+		{
+			const sVoxelSlabJob &slab = slabs.at(localSlab);
+			ResetEmptySpaceMaps();
+			int layerSize = w * h;
+			QByteArray slabVoxels(layerSize * slab.numberOfLayers, 0);
+			QByteArray slabDistances;
+			if (storeDistances) slabDistances.resize(slabVoxels.size() * int(sizeof(float)));
+			for (int z = 0; z < slab.numberOfLayers && !stop; z += VOXEL_EXPORT_GROUP_SIZE)
+			{
+				int groupLayers = qMin(VOXEL_EXPORT_GROUP_SIZE, slab.numberOfLayers - z);
+				CalculateGroup(slab.firstZ + z, groupLayers,
+					reinterpret_cast<unsigned char *>(slabVoxels.data()) + z * layerSize,
+					storeDistances ? reinterpret_cast<float *>(slabDistances.data()) + z * layerSize
+												 : NULL);
+			}
+			localSlabs.insert(localSlab, qMakePair(slabVoxels, slabDistances));
+			continue;
+		}
+
+		// waiting for clients
+		QMetaObject::invokeMethod(distribution, "slotCheckAssignments", Qt::QueuedConnection);
+		if (sameThread) QCoreApplication::processEvents();
+		Wait(10);
+	}
+
+	QMetaObject::invokeMethod(distribution, "slotStop", connectionType);
+	distribution->deleteLater();
+	return true;
 }
 
-bool cVoxelExport::StoreLayer(int z)
+bool cVoxelExport::StoreLayer(int z, unsigned char *layer)
 {
 	QString filename =
 		folder.absolutePath() + QDir::separator() + QString("layer_%1.png").arg(z, 5, 10, QChar('0'));
-	if (!ImageFileSavePNG::SavePNGQtBlackAndWhite(filename, voxelLayer, w, h))
+	if (!ImageFileSavePNG::SavePNGQtBlackAndWhite(filename, layer, w, h))
 	{
 		qCritical() << "Cannot write to file " << filename;
 		return false;
 	}
 	return true;
 }
+
+cVoxelSlabDistribution::cVoxelSlabDistribution(const QList<sVoxelSlabJob> &slabs,
+	const cParameterContainer &params, const cFractalContainer &fractal)
+		: QObject(), slabs(slabs), params(params), fractal(fractal)
+{
+	states.fill(slabWaiting, slabs.size());
+	started = false;
+}
+
+int cVoxelSlabDistribution::TakeWaitingSlab()
+{
+	QMutexLocker lock(&mutex);
+	// server takes slabs from the beginning, so they can be stored as soon as possible
+	for (int i = 0; i < states.size(); i++)
+	{
+		if (states[i] == slabWaiting)
+		{
+			states[i] = slabLocal;
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool cVoxelSlabDistribution::TakeReceivedSlab(
+	int slabIndex, QByteArray *voxels, QByteArray *distances)
+{
+	QByteArray voxelsCompressed;
+	QByteArray distancesCompressed;
+	{
+		QMutexLocker lock(&mutex);
+		if (!received.contains(slabIndex)) return false;
+		QPair<QByteArray, QByteArray> data = received.take(slabIndex);
+		voxelsCompressed = data.first;
+		distancesCompressed = data.second;
+	}
+	*voxels = qUncompress(voxelsCompressed);
+	*distances = distancesCompressed.isEmpty() ? QByteArray() : qUncompress(distancesCompressed);
+	return true;
+}
+
+void cVoxelSlabDistribution::slotStart()
+{
+	connect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotClientIdle(int)));
+	connect(gNetRender, SIGNAL(VoxelSlabReceived(int, QByteArray, QByteArray)), this,
+		SLOT(slotSlabReceived(int, QByteArray, QByteArray)));
+	started = true;
+	gNetRender->StartSlabDistribution();
+}
+
+void cVoxelSlabDistribution::slotStop()
+{
+	if (!started) return;
+	started = false;
+	gNetRender->StopSlabDistribution();
+	disconnect(gNetRender, SIGNAL(ClientIdle(int)), this, SLOT(slotClientIdle(int)));
+	disconnect(gNetRender, SIGNAL(VoxelSlabReceived(int, QByteArray, QByteArray)), this,
+		SLOT(slotSlabReceived(int, QByteArray, QByteArray)));
+	gNetRender->Release();
+}
+
+void cVoxelSlabDistribution::slotClientIdle(int clientIndex)
+{
+	if (!started) return;
+
+	// client gets the last waiting slab, so the server and clients meet in the middle
+	int slabIndex = -1;
+	{
+		QMutexLocker lock(&mutex);
+		for (int i = states.size() - 1; i >= 0; i--)
+		{
+			if (states[i] == slabWaiting)
+			{
+				states[i] = slabRemote;
+				slabIndex = i;
+				break;
+			}
+		}
+	}
+	if (slabIndex >= 0) gNetRender->SendVoxelSlab(clientIndex, slabs.at(slabIndex), params, fractal);
+}
+
+void cVoxelSlabDistribution::slotSlabReceived(
+	int slabIndex, QByteArray voxels, QByteArray distances)
+{
+	QMutexLocker lock(&mutex);
+	if (slabIndex < 0 || slabIndex >= states.size() || states[slabIndex] != slabRemote) return;
+
+	if (voxels.isEmpty())
+	{
+		// client couldn't calculate the slab
+		states[slabIndex] = slabWaiting;
+	}
+	else
+	{
+		states[slabIndex] = slabDone;
+		received.insert(slabIndex, qMakePair(voxels, distances));
+	}
+}
+
+void cVoxelSlabDistribution::slotCheckAssignments()
+{
+	QMutexLocker lock(&mutex);
+	for (int i = 0; i < states.size(); i++)
+	{
+		if (states[i] == slabRemote && !gNetRender->IsSlabAssigned(i)) states[i] = slabWaiting;
+	}
+}
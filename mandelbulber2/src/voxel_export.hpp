@@ -35,22 +35,49 @@
  * with a resolution of w * h * l. for each voxel ProcessVolume() determines if the point
  * is inside the fractal, or not. The result is saved in layers of X-Y planes in StoreLayer
  * to the output folder as a black-and-white PNG file.
+ *
+ * When the program works as NetRender server, slabs of layers are calculated also by clients
+ * (CalculateSlab()). cVoxelSlabDistribution assigns the slabs and collects received data.
  */
 
 #ifndef MANDELBULBER2_SRC_VOXEL_EXPORT_HPP_
 #define MANDELBULBER2_SRC_VOXEL_EXPORT_HPP_
 
 #include "algebra.hpp"
+#include "fractal_container.hpp"
+#include "netrender.hpp"
+#include "parameters.hpp"
 #include <QtCore>
 
+// number of layers of slab calculated by one NetRender client
+#define VOXEL_EXPORT_SLAB_LAYERS 16
+
+// forward declarations
+class cEmptySpaceMap;
+class cNineFractals;
+class cParamRender;
+class cSparseVolumeWriter;
+
 class cVoxelExport : public QObject
 {
 	Q_OBJECT
 
 public:
+	enum enumVoxelFileFormat
+	{
+		voxelFormatPngLayers = 0,
+		voxelFormatSparseVolume = 1
+	};
+
 	cVoxelExport(int w, int h, int l, CVector3 limitMin, CVector3 limitMax, QDir folder, int maxIter);
 	~cVoxelExport();
 
+	// calculates layers firstZ .. firstZ + numberOfLayers - 1 of the volume (used by NetRender
+	// client). Voxels are stored as one byte per point and distances as floats. Returns false
+	// if calculation was stopped
+	bool CalculateSlab(int firstZ, int numberOfLayers, bool storeDistances, QByteArray *voxels,
+		QByteArray *distances, const bool *stopRequest);
+
 signals:
 	void updateProgressAndStatus(const QString &text, const QString &progressText, double progress);
 	void finished();
@@ -60,9 +87,29 @@ public slots:
 	void ProcessVolume();
 
 private:
-	bool StoreLayer(int z);
+	void PrepareCalculation();
+	void FinishCalculation();
+	// empty space maps are carried between groups, so they have to be reset at start of each slab
+	void ResetEmptySpaceMaps();
+	// calculates group of up to VOXEL_EXPORT_GROUP_SIZE layers. Skipped points get bound of
+	// distance, so distances can be NULL if not needed
+	void CalculateGroup(int firstZ, int numberOfLayers, unsigned char *voxels, float *distances);
+	bool StoreLayers(int firstZ, int numberOfLayers, unsigned char *voxels, float *distances);
+	bool StoreLayer(int z, unsigned char *layer);
+	// calculates slabs together with NetRender clients. Returns false if distribution couldn't be
+	// started
+	bool ProcessVolumeDistributed(bool storeDistances);
+	bool IsStopped() const { return stop || (externalStop && *externalStop); }
 
+	// layers of currently calculated group
 	unsigned char *voxelLayer;
+	cParamRender *params;
+	const cNineFractals *fractals;
+	QList<cEmptySpaceMap *> emptySpaces;
+	cSparseVolumeWriter *volumeWriter;
+	double stepX, stepY, stepZ;
+	double distThresh;
+	const bool *externalStop;
 	int w, h, l;
 	CVector3 limitMin;
 	CVector3 limitMax;
@@ -71,4 +118,45 @@ private:
 	bool stop;
 };
 
+// assignment of slabs of voxel export to NetRender clients. Object lives in thread of gNetRender
+// and state of slabs is read by thread of voxel export
+class cVoxelSlabDistribution : public QObject
+{
+	Q_OBJECT
+
+public:
+	cVoxelSlabDistribution(const QList<sVoxelSlabJob> &slabs, const cParameterContainer &params,
+		const cFractalContainer &fractal);
+
+	// slab which is not assigned to any client (-1 if none). It is calculated by the server
+	int TakeWaitingSlab();
+	// takes decompressed data of slab calculated by client. Returns false if not received yet
+	bool TakeReceivedSlab(int slabIndex, QByteArray *voxels, QByteArray *distances);
+
+public slots:
+	void slotStart();
+	void slotStop();
+	void slotClientIdle(int clientIndex);
+	void slotSlabReceived(int slabIndex, QByteArray voxels, QByteArray distances);
+	// slabs of disconnected clients are given back to the queue
+	void slotCheckAssignments();
+
+private:
+	enum enumSlabState
+	{
+		slabWaiting,
+		slabLocal,
+		slabRemote,
+		slabDone
+	};
+
+	QMutex mutex;
+	QList<sVoxelSlabJob> slabs;
+	QVector<enumSlabState> states;
+	QHash<int, QPair<QByteArray, QByteArray>> received;
+	cParameterContainer params;
+	cFractalContainer fractal;
+	bool started;
+};
+
 #endif /* MANDELBULBER2_SRC_VOXEL_EXPORT_HPP_ */
@@ -0,0 +1,148 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cWaterHeightfield class - wave pattern of water primitive baked into heightfield
+ */
+
+#include "water_heightfield.hpp"
+
+#include <cmath>
+
+#include "primitives.h"
+#include "system.hpp"
+
+cWaterHeightfield::cWaterHeightfield(const sPrimitiveWater *water, int maxResolution)
+{
+	// lowest wave frequency has period about 126 wave lengths
+	tileSize = 128.0 * water->length;
+
+	// shortest wave period is 2*pi*length / 1.872^(iterations-1). It needs 4 texels
+	double shortestPeriod = 2.0 * M_PI * water->length / pow(1.872, water->iterations - 1);
+	double neededResolution = 4.0 * tileSize / shortestPeriod;
+	int resolution = 16;
+	while (resolution < neededResolution && resolution < maxResolution)
+		resolution *= 2;
+
+	Bake(water, resolution);
+	BuildMipLevels();
+
+	WriteLogDouble("cWaterHeightfield: baked water waves, resolution", resolution, 2);
+}
+
+void cWaterHeightfield::Bake(const sPrimitiveWater *water, int resolution)
+{
+	sLevel level;
+	level.size = resolution;
+	level.texelSize = tileSize / resolution;
+	level.offset = 0.0;
+	level.heights.resize(resolution * resolution);
+
+	// tile is blended from four copies shifted by tile size, so the opposite edges match
+	for (int iy = 0; iy < resolution; iy++)
+	{
+		double v = iy * level.texelSize;
+		double b = double(iy) / resolution;
+		for (int ix = 0; ix < resolution; ix++)
+		{
+			double u = ix * level.texelSize;
+			double a = double(ix) / resolution;
+			double h = (1.0 - a) * (1.0 - b) * water->WaveHeight(u, v)
+								 + a * (1.0 - b) * water->WaveHeight(u - tileSize, v)
+								 + (1.0 - a) * b * water->WaveHeight(u, v - tileSize)
+								 + a * b * water->WaveHeight(u - tileSize, v - tileSize);
+			level.heights[iy * resolution + ix] = float(h);
+		}
+	}
+	levels.clear();
+	levels.append(level);
+}
+
+void cWaterHeightfield::BuildMipLevels()
+{
+	while (levels.last().size > 4)
+	{
+		const sLevel &source = levels.last();
+		sLevel level;
+		level.size = source.size / 2;
+		level.texelSize = source.texelSize * 2.0;
+		// center of averaged texels is shifted by half of source texel
+		level.offset = (source.offset + 0.5) * 0.5;
+		level.heights.resize(level.size * level.size);
+		for (int y = 0; y < level.size; y++)
+		{
+			const float *row1 = &source.heights[2 * y * source.size];
+			const float *row2 = row1 + source.size;
+			for (int x = 0; x < level.size; x++)
+			{
+				level.heights[y * level.size + x] =
+					0.25f * (row1[2 * x] + row1[2 * x + 1] + row2[2 * x] + row2[2 * x + 1]);
+			}
+		}
+		levels.append(level);
+	}
+}
+
+double cWaterHeightfield::SampleLevel(const sLevel &level, double x, double y) const
+{
+	double fx = x / level.texelSize - level.offset;
+	double fy = y / level.texelSize - level.offset;
+	double flX = floor(fx);
+	double flY = floor(fy);
+	double kx = fx - flX;
+	double ky = fy - flY;
+
+	// tile is repeated, so coordinates are wrapped
+	int size = level.size;
+	int x1 = int(flX - floor(flX / size) * size);
+	int y1 = int(flY - floor(flY / size) * size);
+	if (x1 >= size) x1 = 0;
+	if (y1 >= size) y1 = 0;
+	int x2 = (x1 + 1 == size) ? 0 : x1 + 1;
+	int y2 = (y1 + 1 == size) ? 0 : y1 + 1;
+
+	const float *heights = level.heights.constData();
+	double h1 = heights[y1 * size + x1] * (1.0 - kx) + heights[y1 * size + x2] * kx;
+	double h2 = heights[y2 * size + x1] * (1.0 - kx) + heights[y2 * size + x2] * kx;
+	return h1 * (1.0 - ky) + h2 * ky;
+}
+
+double cWaterHeightfield::Sample(double x, double y, double detailSize) const
+{
+	if (levels.isEmpty()) return 0.0;
+
+	int levelIndex = 0;
+	if (detailSize > levels[0].texelSize)
+	{
+		levelIndex = int(log2(detailSize / levels[0].texelSize));
+		if (levelIndex >= levels.size()) levelIndex = levels.size() - 1;
+	}
+	return SampleLevel(levels[levelIndex], x, y);
+}
@@ -0,0 +1,79 @@
+/**
+ * Mandelbulber v2, a 3D fractal generator       ,=#MKNmMMKmmßMNWy,
+ *                                             ,B" ]L,,p%%%,,,§;, "K
+ * Copyright (C) 2016 Krzysztof Marczak        §R-==%w["'~5]m%=L.=~5N
+ *                                        ,=mm=§M ]=4 yJKA"/-Nsaj  "Bw,==,,
+ * This file is part of Mandelbulber.    §R.r= jw",M  Km .mM  FW ",§=ß., ,TN
+ *                                     ,4R =%["w[N=7]J '"5=],""]]M,w,-; T=]M
+ * Mandelbulber is free software:     §R.ß~-Q/M=,=5"v"]=Qf,'§"M= =,M.§ Rz]M"Kw
+ * you can redistribute it and/or     §w "xDY.J ' -"m=====WeC=\ ""%""y=%"]"" §
+ * modify it under the terms of the    "§M=M =D=4"N #"%==A%p M§ M6  R' #"=~.4M
+ * GNU General Public License as        §W =, ][T"]C  §  § '§ e===~ U  !§[Z ]N
+ * published by the                    4M",,Jm=,"=e~  §  §  j]]""N  BmM"py=ßM
+ * Free Software Foundation,          ]§ T,M=& 'YmMMpM9MMM%=w=,,=MT]M m§;'§,
+ * either version 3 of the License,    TWw [.j"5=~N[=§%=%W,T ]R,"=="Y[LFT ]N
+ * or (at your option)                   TW=,-#"%=;[  =Q:["V""  ],,M.m == ]N
+ * any later version.                      J§"mr"] ,=,," =="""J]= M"M"]==ß"
+ *                                          §= "=C=4 §"eM "=B:m|4"]#F,§~
+ * Mandelbulber is distributed in            "9w=,,]w em%wJ '"~" ,=,,ß"
+ * the hope that it will be useful,                 . "K=  ,=RMMMßM"""
+ * but WITHOUT ANY WARRANTY;                            .'''
+ * without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with Mandelbulber. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * ###########################################################################
+ *
+ * Authors: Krzysztof Marczak (buddhi1980@gmail.com)
+ *
+ * cWaterHeightfield class - wave pattern of water primitive baked into heightfield
+ *
+ * Waves are evaluated once per frame into square tile with mip levels and then
+ * sampled with bilinear interpolation during ray-marching. Wave pattern is not
+ * periodic, so the tile is made seamless by cross-fading of shifted copies.
+ */
+
+#ifndef MANDELBULBER2_SRC_WATER_HEIGHTFIELD_HPP_
+#define MANDELBULBER2_SRC_WATER_HEIGHTFIELD_HPP_
+
+#include <QVector>
+
+// forward declarations
+struct sPrimitiveWater;
+
+class cWaterHeightfield
+{
+public:
+	cWaterHeightfield(const sPrimitiveWater *water, int maxResolution = 2048);
+
+	// height of waves (not multiplied by amplitude) at local coordinates of primitive.
+	// Mip level is selected to match detail size
+	double Sample(double x, double y, double detailSize) const;
+
+	int GetResolution() const { return levels.isEmpty() ? 0 : levels[0].size; }
+	int GetNumberOfLevels() const { return levels.size(); }
+	double GetTileSize() const { return tileSize; }
+
+private:
+	struct sLevel
+	{
+		sLevel() : size(0), texelSize(0.0), offset(0.0) {}
+		int size;
+		double texelSize;
+		// distance of first texel center from tile origin (in texels)
+		double offset;
+		QVector<float> heights;
+	};
+
+	void Bake(const sPrimitiveWater *water, int resolution);
+	void BuildMipLevels();
+	double SampleLevel(const sLevel &level, double x, double y) const;
+
+	double tileSize;
+	QVector<sLevel> levels;
+};
+
+#endif /* MANDELBULBER2_SRC_WATER_HEIGHTFIELD_HPP_ */